@@ -0,0 +1,60 @@
+/**
+ * @file larsim/DetSim/RawDigitSignalROIs.h
+ * @brief Regions of the simulated raw digits where signal is present.
+ *
+ * Produced by `detsim::SimWire` with `StoreSignalROIs`.
+ */
+
+#ifndef LARSIM_DETSIM_RAWDIGITSIGNALROIS_H
+#define LARSIM_DETSIM_RAWDIGITSIGNALROIS_H
+
+#include "larcoreobj/SimpleTypesAndConstants/RawTypes.h" // raw::ChannelID_t
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sim {
+
+  /**
+   * @brief Tick ranges of each raw digit where the simulated signal is significant.
+   *
+   * Only the channels with signal are listed. The channel `i` is
+   * `channel[i]`, simulated in the raw digit `digitIndex[i]` of the
+   * collection produced together with this object; its regions of interest
+   * are the elements from `firstROI[i]` to `firstROI[i + 1]` (excluded) of
+   * `roiBegin` and `roiEnd`, each one covering the ticks from `roiBegin`
+   * to `roiEnd` (excluded). `firstROI` has one more element than the
+   * channels. The regions are sorted and do not overlap.
+   *
+   * A tick is in a region if the response to the charge of any TDC reaches
+   * there with more than the configured fraction of its peak; outside the
+   * regions, the digits hold only noise (or pedestal).
+   */
+  struct RawDigitSignalROIs {
+
+    std::vector<raw::ChannelID_t> channel;  ///< Channels with signal.
+    std::vector<std::uint32_t> digitIndex;  ///< Index of the raw digit of each channel.
+    std::vector<std::uint32_t> firstROI;    ///< First region of each channel (and end).
+    std::vector<std::uint32_t> roiBegin;    ///< First tick of each region.
+    std::vector<std::uint32_t> roiEnd;      ///< Tick after the last one of each region.
+
+    /// Number of channels with signal.
+    std::size_t
+    nChannels() const
+    {
+      return channel.size();
+    }
+
+    /// Total number of regions.
+    std::size_t
+    nROIs() const
+    {
+      return roiBegin.size();
+    }
+
+  }; // struct RawDigitSignalROIs
+
+} // namespace sim
+
+#endif // LARSIM_DETSIM_RAWDIGITSIGNALROIS_H
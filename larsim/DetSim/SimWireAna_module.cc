@@ -23,13 +23,23 @@
 
 #include "TH2.h"
 
+#include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
+
+#include <map>
 #include <string>
+#include <utility>
 
 
 ///Detector simulation of raw signals on wires
 namespace detsim {
 
   /// Base class for creation of raw signals on wires.
+  ///
+  /// The digits are compressed and checked in parallel; each thread counts
+  /// the values to be histogrammed, and the histograms are filled from the
+  /// counts of all the threads and events at the end of the job.
   class SimWireAna : public art::EDAnalyzer {
 
   public:
@@ -39,9 +49,21 @@ namespace detsim {
     /// read/write access to event
     void analyze (const art::Event& evt);
     void beginJob();
+    void endJob();
 
   private:
 
+    /// Occurrences of the histogrammed values, in the digits seen by a thread.
+    struct Counts {
+      std::map<int, unsigned long>    diffs;          ///< ADC(t) - ADC(t-1)
+      std::map<double, unsigned long> compressFactor; ///< compressed/original size
+      /// (original, uncompressed) ADC pairs
+      std::map<std::pair<short, short>, unsigned long> rawVsUncompressed;
+    };
+
+    /// Compresses and uncompresses `digit`, counting the results in `counts`.
+    void AnalyzeDigit(raw::RawDigit const& digit, Counts& counts) const;
+
     std::string            fDetSimModuleLabel;///< name of module that produced the digits
     TH1F*                  fDiffs;            ///< histogram of Raw tdc to tdc differences
 
@@ -52,6 +74,8 @@ namespace detsim {
     TH2F*                  fRawVsCompress;    ///< histogram of original tdc value vs compressesed value
     TH2F*                  fCompressErr2D;    ///< histogram of original tdc value vs compressesed value
 
+    tbb::enumerable_thread_specific<Counts> fCounts; ///< counts of each thread
+
 
   }; // class SimWire
 
@@ -91,54 +115,83 @@ namespace detsim{
     art::Handle< std::vector<raw::RawDigit> > rdHandle;
     evt.getByLabel(fDetSimModuleLabel,rdHandle);
 
-    art::PtrVector<raw::RawDigit> rdvec;
-    for(unsigned int i = 0; i < rdHandle->size(); ++i){
-      art::Ptr<raw::RawDigit> r(rdHandle,i);
-      rdvec.push_back(r);
-    }
+    std::vector<raw::RawDigit> const& rdvec = *rdHandle;
 
     /// loop over all the raw digits
-    for(unsigned int rd = 0; rd < rdvec.size(); ++rd){
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, rdvec.size()),
+                      [&](tbb::blocked_range<std::size_t> const& range) {
+                        Counts& counts = fCounts.local();
+                        for (std::size_t rd = range.begin(); rd != range.end(); ++rd)
+                          AnalyzeDigit(rdvec[rd], counts);
+                      });
+
+    return;
+  }//end analyze method
+
+  //-------------------------------------------------
+  void SimWireAna::AnalyzeDigit(raw::RawDigit const& digit, Counts& counts) const
+  {
+    std::vector<short> adc;
+    std::vector<short> uncompressed(digit.Samples());
+    for(unsigned int t = 1; t < digit.Samples(); ++t){
+      ++counts.diffs[digit.ADC(t) - digit.ADC(t-1)];
+      adc.push_back(digit.ADC(t-1));
+    }
 
-      std::vector<short> adc;
-      std::vector<short> uncompressed(rdvec[rd]->Samples());
-      for(unsigned int t = 1; t < rdvec[rd]->Samples(); ++t){
-	fDiffs->Fill(rdvec[rd]->ADC(t) - rdvec[rd]->ADC(t-1));
-	adc.push_back(rdvec[rd]->ADC(t-1));
-      }
+    //get the last one for the adc vector
+    adc.push_back(digit.ADC(digit.Samples()-1));
 
-      //get the last one for the adc vector
-      adc.push_back(rdvec[rd]->ADC(rdvec[rd]->Samples()-1));
+    raw::Compress(adc, raw::kHuffman);
 
-      raw::Compress(adc, raw::kHuffman);
+    ++counts.compressFactor[(1.*adc.size())/(1.*digit.Samples())];
 
-      fCompressFactor->Fill((1.*adc.size())/(1.*rdvec[rd]->Samples()));
+    raw::Uncompress(adc, uncompressed, raw::kHuffman);
 
-      raw::Uncompress(adc, uncompressed, raw::kHuffman);
+    if(uncompressed.size() != digit.Samples()){
+      cet::exception("WrongSizeUncompress")
+        << "uncompression does not produce same size vector as original: "
+        << "original = " << digit.Samples() << " uncompress = "
+        << uncompressed.size() << "\n";
+    }
 
-      if(uncompressed.size() != rdvec[rd]->Samples()){
-	cet::exception("WrongSizeUncompress")
-	  << "uncompression does not produce same size vector as original: "
-	  << "original = " << rdvec[rd]->Samples() << " uncompress = "
-	  << uncompressed.size() << "\n";
-      }
+    for(unsigned int t = 0; t <  uncompressed.size(); ++t){
+      if(uncompressed[t]-digit.ADC(t) > 1)
+        mf::LogWarning("SimWireAna") << "problem with event "
+                                     << " time " << t << " ADC " << digit.ADC(t)
+                                     << " uncompress " << uncompressed[t]
+                                     << " channel " << digit.Channel();
 
-      for(unsigned int t = 0; t <  uncompressed.size(); ++t){
-	//std::cout << t << " " << rdFE->ADC(t) << " " << uncompressed[t] << std::endl;
-	if(uncompressed[t]-rdvec[rd]->ADC(t) > 1)
-	  mf::LogWarning("SimWireAna") << "problem with event "
-				       << " time " << t << " ADC " << rdvec[rd]->ADC(t)
-				       << " uncompress " << uncompressed[t]
-				       << " channel " << rdvec[rd]->Channel();
+      ++counts.rawVsUncompressed[{digit.ADC(t), uncompressed[t]}];
+    }
+  }
 
-	fCompressErr->Fill(uncompressed[t]-rdvec[rd]->ADC(t));
-	fCompressErr2D->Fill(rdvec[rd]->ADC(t), uncompressed[t]-rdvec[rd]->ADC(t));
-	fRawVsCompress->Fill(rdvec[rd]->ADC(t), uncompressed[t]);
-      }
-    }//end loop over digits
+  //-------------------------------------------------
+  void SimWireAna::endJob()
+  {
+    // merge the counts of all the threads
+    Counts total;
+    for (Counts const& counts: fCounts) {
+      for (auto const& [value, n]: counts.diffs) total.diffs[value] += n;
+      for (auto const& [value, n]: counts.compressFactor) total.compressFactor[value] += n;
+      for (auto const& [values, n]: counts.rawVsUncompressed) total.rawVsUncompressed[values] += n;
+    }
 
-    return;
-  }//end analyze method
+    // each value is filled once, with its number of occurrences as weight
+    auto const fill = [](auto* hist, unsigned long n, auto... values)
+      {
+        hist->Fill(values..., static_cast<double>(n));
+        hist->SetEntries(hist->GetEntries() - 1 + n);
+      };
+
+    for (auto const& [diff, n]: total.diffs) fill(fDiffs, n, diff);
+    for (auto const& [factor, n]: total.compressFactor) fill(fCompressFactor, n, factor);
+    for (auto const& [values, n]: total.rawVsUncompressed) {
+      auto const [raw, uncompressed] = values;
+      fill(fCompressErr, n, uncompressed-raw);
+      fill(fCompressErr2D, n, raw, uncompressed-raw);
+      fill(fRawVsCompress, n, raw, uncompressed);
+    }
+  }
 
 
 }//end namespace
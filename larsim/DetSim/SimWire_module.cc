@@ -29,10 +29,19 @@
 
 // ROOT includes
 #include "TComplex.h"
+#include "TFFTComplexReal.h"
+#include "TFFTRealComplex.h"
 #include <TMath.h>
 
 // C++ includes
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib> // std::abs()
+#include <cstring> // std::memcmp()
+#include <fstream>
+#include <memory>
+#include <mutex>
 #include <string>
 
 // Framework includes
@@ -42,6 +51,7 @@
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "art_root_io/TFileService.h"
 #include "cetlib/search_path.h"
+#include "cetlib_except/exception.h"
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
@@ -50,6 +60,10 @@
 
 #include "CLHEP/Random/RandFlat.h"
 
+#include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
+
 // LArSoft includes
 #include "larcore/Geometry/Geometry.h"
 #include "larcorealg/Geometry/PlaneGeo.h"
@@ -59,6 +73,112 @@
 #include "lardataobj/RawData/RawDigit.h"
 #include "lardataobj/RawData/raw.h"
 #include "lardataobj/Simulation/SimChannel.h"
+#include "larsim/DetSim/RawDigitSignalROIs.h"
+#include "larsim/Simulation/ProductFootprint.h"
+
+namespace {
+
+  /// Returns the compression of the `CompressionType` configuration value.
+  raw::Compress_t
+  compressionType(std::string const& name)
+  {
+    if (name == "Huffman") return raw::kHuffman;
+    if (name == "ZeroSuppression") return raw::kZeroSuppression;
+    if (name == "ZeroHuffman") return raw::kZeroHuffman;
+    if ((name == "none") || (name == "None")) return raw::kNone;
+    throw cet::exception("SimWire")
+      << "CompressionType '" << name << "' not supported (use 'none', 'Huffman', "
+      << "'ZeroSuppression' or 'ZeroHuffman').\n";
+  }
+
+  /// Returns the largest absolute value of the samples in `adc`.
+  int
+  maxAbsADC(std::vector<short> const& adc)
+  {
+    // no branch in the loop, so that it can be vectorised
+    int maxAbs = 0;
+    for (short const sample : adc)
+      maxAbs = std::max(maxAbs, std::abs(static_cast<int>(sample)));
+    return maxAbs;
+  }
+
+  /// Identifier at the beginning of each noise bank file.
+  constexpr char NoiseBankMagic[8] = {'L', 'A', 'R', 'N', 'O', 'I', 'S', '\0'};
+
+  /// Version of the noise bank file format.
+  constexpr std::uint32_t NoiseBankVersion = 1U;
+
+  /// Writes the noise waveforms `noise` into `fileName`, tagged by `key`.
+  void
+  writeNoiseBank(std::string const& fileName,
+                 std::string const& key,
+                 std::vector<std::vector<float>> const& noise)
+  {
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      throw cet::exception("SimWire") << "Can't open '" << fileName << "' for writing.\n";
+    }
+    std::uint64_t const keySize = key.size();
+    std::uint64_t const nEntries = noise.size();
+    std::uint64_t const nTicks = noise.empty() ? 0 : noise.front().size();
+    out.write(NoiseBankMagic, sizeof(NoiseBankMagic));
+    out.write(reinterpret_cast<char const*>(&NoiseBankVersion), sizeof(NoiseBankVersion));
+    out.write(reinterpret_cast<char const*>(&keySize), sizeof(keySize));
+    out.write(key.data(), key.size());
+    out.write(reinterpret_cast<char const*>(&nEntries), sizeof(nEntries));
+    out.write(reinterpret_cast<char const*>(&nTicks), sizeof(nTicks));
+    for (auto const& waveform : noise)
+      out.write(reinterpret_cast<char const*>(waveform.data()), waveform.size() * sizeof(float));
+    if (!out) {
+      throw cet::exception("SimWire") << "Error while writing '" << fileName << "'.\n";
+    }
+  }
+
+  /// Reads `nEntries` waveforms of `nTicks` samples from `fileName`, if it
+  /// was created with the same `key`; `noise` is untouched on failure.
+  bool
+  readNoiseBank(std::string const& fileName,
+                std::string const& key,
+                std::size_t nEntries,
+                std::size_t nTicks,
+                std::vector<std::vector<float>>& noise)
+  {
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in) return false;
+
+    char magic[sizeof(NoiseBankMagic)];
+    if (!in.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, NoiseBankMagic, sizeof(NoiseBankMagic)) != 0)
+      return false;
+
+    std::uint32_t version = 0;
+    if (!in.read(reinterpret_cast<char*>(&version), sizeof(version)) ||
+        (version != NoiseBankVersion))
+      return false;
+
+    std::uint64_t keySize = 0;
+    if (!in.read(reinterpret_cast<char*>(&keySize), sizeof(keySize)) || (keySize != key.size()))
+      return false;
+    std::string fileKey(keySize, '\0');
+    if (!in.read(fileKey.data(), keySize) || (fileKey != key)) return false;
+
+    std::uint64_t fileEntries = 0, fileTicks = 0;
+    if (!in.read(reinterpret_cast<char*>(&fileEntries), sizeof(fileEntries)) ||
+        !in.read(reinterpret_cast<char*>(&fileTicks), sizeof(fileTicks)) ||
+        (fileEntries != nEntries) || (fileTicks != nTicks))
+      return false;
+
+    std::vector<std::vector<float>> fileNoise(nEntries, std::vector<float>(nTicks));
+    for (auto& waveform : fileNoise) {
+      if (!in.read(reinterpret_cast<char*>(waveform.data()), nTicks * sizeof(float)))
+        return false;
+    }
+
+    noise = std::move(fileNoise);
+    return true;
+  }
+
+} // local namespace
 
 // Detector simulation of raw signals on wires
 namespace detsim {
@@ -76,10 +196,92 @@ namespace detsim {
     void SetFieldResponse(); ///< response of wires to field
     void SetElectResponse(); ///< response of electronics
 
+    void SetNoiseSpectrum(); ///< noise model magnitude of each frequency
+
     void GenNoise(std::vector<float>& array, CLHEP::HepRandomEngine& engine);
 
+    /// Fills the noise pool `fNoise`, from the noise bank file if possible.
+    void GenNoisePool();
+
+    /// Picks the waveform from the noise pool, and its start, for a channel.
+    float const* PickPoolNoise(CLHEP::RandFlat& flat, unsigned int& noiseOffset) const;
+
+    /// Fills `noiseFrequency` (`fNTicks/2+1` bins) with a random noise spectrum.
+    void GenNoiseSpectrum(TComplex* noiseFrequency, CLHEP::HepRandomEngine& engine);
+
+    /// Digitizes on channel `chan` the (optional) `charge` with the (optional)
+    /// `noise`, starting from its sample `noiseOffset` and wrapping around.
+    raw::RawDigit MakeDigit(raw::ChannelID_t chan,
+                            double const* charge,
+                            float const* noise,
+                            unsigned int noiseOffset = 0) const;
+
+    /// Time offset of the response of `chan`, in ticks.
+    int TimeOffset(geo::GeometryCore const& geo, raw::ChannelID_t chan) const;
+
+    /// Rotates the convoluted `charge` by the response time offset of `chan`.
+    void ApplyTimeOffset(geo::GeometryCore const& geo,
+                         raw::ChannelID_t chan,
+                         std::vector<double>& charge) const;
+
+    /// Circular time-domain response, limited to the lags where it is significant.
+    struct TimeResponse {
+      int before = 0;             ///< number of lags before the charge tick
+      int after = 0;              ///< number of lags after the charge tick
+      std::vector<double> kernel; ///< response at lags from -before to after
+    };
+
+    /// Extracts from the time-domain `shape` the significant part of the response.
+    void SetTimeResponse(std::vector<double> const& shape, TimeResponse& response) const;
+
+    /// Fills `charge` (`fNTicks` samples) with the convolution of the charge
+    /// of `sc` and `response`, in the time domain.
+    void SparseConvolute(sim::SimChannel const& sc,
+                         TimeResponse const& response,
+                         double* charge) const;
+
+    /// Adds to `rois` the ticks where the signal of `sc` on `chan` is significant.
+    void AddSignalROIs(geo::GeometryCore const& geo,
+                       raw::ChannelID_t chan,
+                       std::size_t digitIndex,
+                       sim::SimChannel const& sc,
+                       sim::RawDigitSignalROIs& rois) const;
+
+    /// Simulates all the channels, in blocks of `fBatchSize`.
+    void ProcessBatches(geo::GeometryCore const& geo,
+                        std::vector<const sim::SimChannel*> const& channels,
+                        CLHEP::RandFlat& flat,
+                        std::vector<raw::RawDigit>& digits,
+                        sim::RawDigitSignalROIs* rois);
+
+    /// Forward and inverse FFT of a worker thread, with the same transforms
+    /// as `util::LArFFT` (whose objects are not thread-safe).
+    class FFTWorker {
+    public:
+      FFTWorker(int size, std::string const& options);
+
+      /// Convolutes in place the `fSize` samples of `data` with `kernel`.
+      void Convolute(double* data, std::vector<TComplex> const& kernel);
+
+      /// Inverse transform of `input` (`fSize/2+1` bins) into `output`.
+      void DoInvFFT(TComplex const* input, float* output);
+
+    private:
+      int fSize;
+      int fFreqSize;
+      std::unique_ptr<TFFTRealComplex> fFFT;
+      std::unique_ptr<TFFTComplexReal> fInverseFFT;
+      std::vector<TComplex> fCompTemp;
+    };
+
+    /// Returns the FFT worker of the current thread.
+    FFTWorker& LocalFFTWorker();
+
     std::string fDriftEModuleLabel; ///< module making the ionization electrons
     raw::Compress_t fCompression;   ///< compression type to use
+    unsigned int fZeroThreshold;    ///< zero suppression: threshold on the ADC counts
+    int fNearestNeighbor;           ///< zero suppression: ticks kept around each block
+    std::vector<short> fBaselineADC; ///< compressed digit with all samples below threshold
 
     int fNTicks;                         ///< number of ticks of the clock
     double fSampleRate;                  ///< sampling rate in ns
@@ -109,6 +311,22 @@ namespace detsim {
     std::vector<std::vector<float>> fNoise; ///< noise on each channel for each time
     std::vector<double> fNoiseModelPar;     ///< noise model params
     std::vector<double> fNoiseFluctPar;     ///< Poisson noise fluctuations params
+    std::vector<double> fNoiseSpectrum;     ///< noise model magnitude in each frequency bin
+    std::vector<double> fNoiseLowFilter;    ///< low frequency filter of the "Legacy" model
+    std::string fNoiseBankFile;             ///< file caching the noise pool
+    bool fNoiseRandomOffset;                ///< start pool noise at a random tick
+
+    bool fBatchedFFT;         ///< process the channels in blocks, with parallel FFT
+    unsigned int fBatchSize;  ///< number of channels in each block
+    std::string fFFTOptions;  ///< options of the FFT service, for the workers
+    tbb::enumerable_thread_specific<std::unique_ptr<FFTWorker>> fFFTWorkers;
+
+    bool fSparseSignal;               ///< convolute in the time domain, only around the charge
+    double fSparseResponseThreshold;  ///< response below this fraction of its peak is ignored
+    bool fStoreSignalROIs;            ///< produce the regions with signal of each digit
+    bool fStoreProductFootprints;     ///< produce the sizes of the output products
+    TimeResponse fColTimeResponse;    ///< significant response @ collection plane
+    TimeResponse fIndTimeResponse;    ///< significant response @ induction plane
 
     TH1D* fIndFieldResp; ///< response function for the field @ induction plane
     TH1D* fColFieldResp; ///< response function for the field @ collection plane
@@ -129,8 +347,9 @@ namespace detsim {
   SimWire::SimWire(fhicl::ParameterSet const& pset)
     : EDProducer{pset}
     , fDriftEModuleLabel{pset.get<std::string>("DriftEModuleLabel")}
-    , fCompression{pset.get<std::string>("CompressionType") == "Huffman" ? raw::kHuffman :
-                                                                           raw::kNone}
+    , fCompression{compressionType(pset.get<std::string>("CompressionType"))}
+    , fZeroThreshold{pset.get<unsigned int>("ZeroThreshold", 5)}
+    , fNearestNeighbor{pset.get<int>("NearestNeighbor", 4)}
     , fCol3DCorrection{pset.get<double>("Col3DCorrection")}
     , fInd3DCorrection{pset.get<double>("Ind3DCorrection")}
     , fInputFieldRespSamplingPeriod{pset.get<double>("InputFieldRespSamplingPeriod")}
@@ -146,6 +365,14 @@ namespace detsim {
     , fIndFieldParams{pset.get<std::vector<float>>("IndFieldParams")}
     , fNoiseModelPar{pset.get<std::vector<double>>("NoiseModelPar")}
     , fNoiseFluctPar{pset.get<std::vector<double>>("NoiseFluctPar")}
+    , fNoiseBankFile{pset.get<std::string>("NoiseBankFile", "")}
+    , fNoiseRandomOffset{pset.get<bool>("NoiseRandomOffset", false)}
+    , fBatchedFFT{pset.get<bool>("BatchedFFT", false)}
+    , fBatchSize{pset.get<unsigned int>("BatchSize", 256)}
+    , fSparseSignal{pset.get<bool>("SparseSignal", false)}
+    , fSparseResponseThreshold{pset.get<double>("SparseResponseThreshold", 1e-4)}
+    , fStoreSignalROIs{pset.get<bool>("StoreSignalROIs", false)}
+    , fStoreProductFootprints{pset.get<bool>("StoreProductFootprints", false)}
     // create a default random engine; obtain the random seed from NuRandomService,
     // unless overridden in configuration with key "Seed"
     , fEngine(art::ServiceHandle<rndm::NuRandomService> {}->createEngine(*this, pset, "Seed"))
@@ -156,12 +383,27 @@ namespace detsim {
     fSampleRate = sampling_rate(clockData);
     fNSamplesReadout = detProp.NumberTimeSamples();
 
+    // with zero suppression, most channels have only baseline noise below the
+    // threshold: their compressed content is the one of an empty waveform
+    if ((fCompression == raw::kZeroSuppression) || (fCompression == raw::kZeroHuffman)) {
+      fBaselineADC.assign(fNSamplesReadout, 0);
+      unsigned int threshold = fZeroThreshold;
+      int nearestNeighbor = fNearestNeighbor;
+      raw::Compress(fBaselineADC, fCompression, threshold, 0, nearestNeighbor);
+    }
+
     MF_LOG_WARNING("SimWire") << "SimWire is an example module that works for the "
                               << "MicroBooNE detector.  Each experiment should implement "
                               << "its own version of this module to simulate electronics "
                               << "response.";
 
+    if (fBatchSize == 0) {
+      throw cet::exception("SimWire") << "BatchSize must be positive" << std::endl;
+    }
+
     produces<std::vector<raw::RawDigit>>();
+    if (fStoreSignalROIs) produces<sim::RawDigitSignalROIs>();
+    if (fStoreProductFootprints) produces<std::vector<sim::ProductFootprint>>();
   }
 
   //-------------------------------------------------
@@ -175,6 +417,7 @@ namespace detsim {
 
     art::ServiceHandle<util::LArFFT const> fFFT;
     fNTicks = fFFT->FFTSize();
+    fFFTOptions = fFFT->FFTOptions();
 
     // ... Poisson dist function for fluctuating magnitude of noise frequency component
     if ( fNoiseFluctChoice == "SimplePoisson" ) {
@@ -196,8 +439,12 @@ namespace detsim {
         << " is an unknown noise fluctuation choice" << std::endl;
     }
 
+    SetNoiseSpectrum();
+
     // ... generate the noise in advance depending on value of fNoiseNchToSim:
     //     positive - generate N=fNoiseNchToSim channels & randomly pick from pool when adding to signal
+    //                (the pool is cached in fNoiseBankFile, if set, and optionally started
+    //                at a random tick for each channel: see PickPoolNoise())
     //     zero     - no noise
     //     negative - generate unique noise for each channel for each event
     if (fNoiseNchToSim>0) {
@@ -205,9 +452,8 @@ namespace detsim {
         throw cet::exception("SimWire::beginJob") << fNoiseNchToSim
           << " noise channels requested exceeds 10000" << std::endl;
       }
-      fNoise.resize(fNoiseNchToSim);
+      GenNoisePool();
       for (unsigned int p = 0; p < fNoise.size(); ++p) {
-        GenNoise(fNoise[p], fEngine);
         for (int i = 0; i < fNTicks; ++i) {
 	  fNoiseDist->Fill(fNoise[p][i]);
         }
@@ -229,7 +475,8 @@ namespace detsim {
     art::ServiceHandle<geo::Geometry const> geo;
 
     // ... generate unique noise for each channel in each event
-    if (fNoiseNchToSim<0) {
+    //     (in batched mode, this is done one block of channels at a time)
+    if (fNoiseNchToSim<0 && !fBatchedFFT) {
       fNoise.clear();
       fNoise.resize(geo->Nchannels());
       for(unsigned int p = 0; p < geo->Nchannels(); ++p){
@@ -252,82 +499,398 @@ namespace detsim {
     // ... make an unique_ptr of sim::SimDigits that allows ownership of the produced
     //     digits to be transferred to the art::Event after the put statement below
     auto digcol = std::make_unique<std::vector<raw::RawDigit>>();
-
-    art::ServiceHandle<util::LArFFT> fFFT;
+    auto rois = fStoreSignalROIs ? std::make_unique<sim::RawDigitSignalROIs>() : nullptr;
+    if (rois) rois->firstROI.push_back(0);
 
     // ... Add all channels
     CLHEP::RandFlat flat(fEngine);
 
-    std::map<int,double>::iterator mapIter;
-    for(unsigned int chan = 0; chan < geo->Nchannels(); chan++) {
+    if (fBatchedFFT) {
+      ProcessBatches(*geo, channels, flat, *digcol, rois.get());
+    }
+    else {
+      art::ServiceHandle<util::LArFFT> fFFT;
+
+      std::vector<double> fChargeWork;
+      for(unsigned int chan = 0; chan < geo->Nchannels(); chan++) {
+
+        // .. channels with no charge only get noise
+        if( channels[chan] ){
+
+          // .. get the sim::SimChannel for this channel
+          const sim::SimChannel* sc = channels[chan];
+          bool const induction = (geo->SignalType(chan) == geo::kInduction);
+
+          fChargeWork.assign(fNTicks, 0.);
+          if (fSparseSignal) {
+            SparseConvolute(*sc, induction ? fIndTimeResponse : fColTimeResponse, fChargeWork.data());
+          }
+          else {
+            // .. loop over the tdcs and grab the number of electrons for each
+            for(int t = 0; t < fNTicks; ++t)
+              fChargeWork[t] = sc->Charge(t);
+
+            // .. Convolve charge with appropriate response function
+            if(induction)
+              fFFT->Convolute(fChargeWork,fIndShape);
+            else
+              fFFT->Convolute(fChargeWork,fColShape);
+          }
+
+          ApplyTimeOffset(*geo, chan, fChargeWork);
+          if (rois) AddSignalROIs(*geo, chan, digcol->size(), *sc, *rois);
+        }
 
-      std::vector<short> adcvec(fNTicks, 0);
-      std::vector<double> fChargeWork(fNTicks, 0.);
+        // ... Add noise to signal depending on value of fNoiseNchToSim
+        float const* noise = nullptr;
+        unsigned int noiseOffset = 0;
+        if(fNoiseNchToSim>0){
+          noise = PickPoolNoise(flat, noiseOffset);
+        } else if(fNoiseNchToSim<0){
+          noise = fNoise[chan].data();
+        }
 
-      if( channels[chan] ){
+        // ... add this digit to the collection
+        digcol->push_back(
+          MakeDigit(chan, channels[chan] ? fChargeWork.data() : nullptr, noise, noiseOffset));
 
-	// .. get the sim::SimChannel for this channel
-	const sim::SimChannel* sc = channels[chan];
+      }//end loop over channels
+    }
 
-	// .. loop over the tdcs and grab the number of electrons for each
-	for(int t = 0; t < fNTicks; ++t)
-	  fChargeWork[t] = sc->Charge(t);
+    sim::ProductFootprints footprints{sim::makeFootprint("raw::RawDigit", *digcol)};
+    evt.put(std::move(digcol));
+    if (rois) evt.put(std::move(rois));
+    sim::reportFootprints(
+      evt, moduleDescription().moduleLabel(), std::move(footprints), fStoreProductFootprints);
 
-        int time_offset = 0;
+    return;
+  }
 
-        // .. Convolve charge with appropriate response function
-	if(geo->SignalType(chan) == geo::kInduction){
-	  fFFT->Convolute(fChargeWork,fIndShape);
-          time_offset = fFieldRespTOffset[1]+fCalibRespTOffset[1];
-	} else {
-          fFFT->Convolute(fChargeWork,fColShape);
-          time_offset = fFieldRespTOffset[0]+fCalibRespTOffset[0];
-        }
+  //-------------------------------------------------
+  int
+  SimWire::TimeOffset(geo::GeometryCore const& geo, raw::ChannelID_t chan) const
+  {
+    if(geo.SignalType(chan) == geo::kInduction)
+      return fFieldRespTOffset[1]+fCalibRespTOffset[1];
+    else
+      return fFieldRespTOffset[0]+fCalibRespTOffset[0];
+  }
 
-        // .. Apply field response offset
-        std::vector<int> temp;
-        if (time_offset <=0){
-          temp.assign(fChargeWork.begin(),fChargeWork.begin()-time_offset);
-          fChargeWork.erase(fChargeWork.begin(),fChargeWork.begin()-time_offset);
-          fChargeWork.insert(fChargeWork.end(),temp.begin(),temp.end());
-        }else{
-          temp.assign(fChargeWork.end()-time_offset,fChargeWork.end());
-          fChargeWork.erase(fChargeWork.end()-time_offset,fChargeWork.end());
-          fChargeWork.insert(fChargeWork.begin(),temp.begin(),temp.end());
-        }
+  //-------------------------------------------------
+  void
+  SimWire::ApplyTimeOffset(geo::GeometryCore const& geo,
+                           raw::ChannelID_t chan,
+                           std::vector<double>& fChargeWork) const
+  {
+    int const time_offset = TimeOffset(geo, chan);
+
+    // .. Apply field response offset
+    std::vector<int> temp;
+    if (time_offset <=0){
+      temp.assign(fChargeWork.begin(),fChargeWork.begin()-time_offset);
+      fChargeWork.erase(fChargeWork.begin(),fChargeWork.begin()-time_offset);
+      fChargeWork.insert(fChargeWork.end(),temp.begin(),temp.end());
+    }else{
+      temp.assign(fChargeWork.end()-time_offset,fChargeWork.end());
+      fChargeWork.erase(fChargeWork.end()-time_offset,fChargeWork.end());
+      fChargeWork.insert(fChargeWork.begin(),temp.begin(),temp.end());
+    }
+  }
 
+  //-------------------------------------------------
+  raw::RawDigit
+  SimWire::MakeDigit(raw::ChannelID_t chan,
+                     double const* fChargeWork,
+                     float const* noise,
+                     unsigned int noiseOffset) const
+  {
+    std::vector<short> adcvec(fNTicks, 0);
+    int const wrap = fNTicks - noiseOffset;
+    if(noise && fChargeWork){
+      for(int i = 0; i < wrap; ++i){
+        adcvec[i] = (short)TMath::Nint(noise[noiseOffset + i] + fChargeWork[i]);
+      }
+      for(int i = wrap; i < fNTicks; ++i){
+        adcvec[i] = (short)TMath::Nint(noise[i - wrap] + fChargeWork[i]);
+      }
+    } else if(noise){
+      // .. noise only
+      for(int i = 0; i < wrap; ++i){
+        adcvec[i] = (short)TMath::Nint(noise[noiseOffset + i]);
+      }
+      for(int i = wrap; i < fNTicks; ++i){
+        adcvec[i] = (short)TMath::Nint(noise[i - wrap]);
       }
+    } else if(fChargeWork){
+      for(int i = 0; i < fNTicks; ++i){
+        adcvec[i] = (short)TMath::Nint(fChargeWork[i]);
+      }
+    }
 
-      // ... Add noise to signal depending on value of fNoiseNchToSim
-      if(fNoiseNchToSim!=0){
-        int noisechan = chan;
-        if(fNoiseNchToSim>0){
-          noisechan = TMath::Nint(flat.fire()*(1.*(fNoise.size()-1)+0.1));
+    adcvec.resize(fNSamplesReadout);
+
+    // ... compress the adc vector using the desired compression scheme,
+    //     if raw::kNone is selected nothing happens to adcvec
+    //     This shrinks adcvec, if fCompression is not kNone.
+    if (fBaselineADC.empty()) {
+      raw::Compress(adcvec, fCompression);
+    }
+    else if ((fZeroThreshold > 0) && (maxAbsADC(adcvec) < static_cast<int>(fZeroThreshold))) {
+      // nothing survives the zero suppression
+      adcvec = fBaselineADC;
+    }
+    else {
+      unsigned int threshold = fZeroThreshold;
+      int nearestNeighbor = fNearestNeighbor;
+      raw::Compress(adcvec, fCompression, threshold, 0, nearestNeighbor);
+    }
+
+    return raw::RawDigit(chan, fNTicks, std::move(adcvec), fCompression);
+  }
+
+  //-------------------------------------------------
+  void
+  SimWire::ProcessBatches(geo::GeometryCore const& geo,
+                          std::vector<const sim::SimChannel*> const& channels,
+                          CLHEP::RandFlat& flat,
+                          std::vector<raw::RawDigit>& digits,
+                          sim::RawDigitSignalROIs* rois)
+  {
+    // ... the charge and the noise of a block of channels are packed in
+    //     2D buffers (one row per channel); the random numbers are drawn
+    //     serially and in the same order as channel by channel, then all
+    //     the FFT of the block are run in parallel
+    unsigned int const nChannels = geo.Nchannels();
+    std::size_t const nTicks = fNTicks;
+    std::size_t const freqSize = fNTicks/2 + 1;
+    bool const eventNoise = (fNoiseNchToSim < 0);
+
+    std::vector<double> charge(fBatchSize * nTicks);
+    std::vector<TComplex> noiseFrequency(eventNoise ? fBatchSize * freqSize : 0);
+    std::vector<float> noise(eventNoise ? fBatchSize * nTicks : 0);
+    std::vector<char> induction(fBatchSize);
+    std::vector<double> fChargeWork;
+
+    digits.reserve(nChannels);
+    for (unsigned int first = 0; first < nChannels; first += fBatchSize) {
+      unsigned int const n = std::min(fBatchSize, nChannels - first);
+
+      for (unsigned int i = 0; i < n; ++i) {
+        unsigned int const chan = first + i;
+        if (channels[chan]) {
+          induction[i] = (geo.SignalType(chan) == geo::kInduction);
+          if (!fSparseSignal) {
+            double* row = charge.data() + i * nTicks;
+            for (std::size_t t = 0; t < nTicks; ++t)
+              row[t] = channels[chan]->Charge(t);
+          }
         }
-        for(int i = 0; i < fNTicks; ++i){
-	  adcvec[i] = (short)TMath::Nint(fNoise[noisechan][i] + fChargeWork[i]);
+        if (eventNoise) GenNoiseSpectrum(noiseFrequency.data() + i * freqSize, fEngine);
+      }
+
+      tbb::parallel_for(tbb::blocked_range<unsigned int>(0, n),
+                        [&](tbb::blocked_range<unsigned int> const& range) {
+                          FFTWorker& worker = LocalFFTWorker();
+                          for (unsigned int i = range.begin(); i != range.end(); ++i) {
+                            sim::SimChannel const* sc = channels[first + i];
+                            if (sc && fSparseSignal)
+                              SparseConvolute(*sc,
+                                              induction[i] ? fIndTimeResponse : fColTimeResponse,
+                                              charge.data() + i * nTicks);
+                            else if (sc)
+                              worker.Convolute(charge.data() + i * nTicks,
+                                               induction[i] ? fIndShape : fColShape);
+                            if (eventNoise)
+                              worker.DoInvFFT(noiseFrequency.data() + i * freqSize,
+                                              noise.data() + i * nTicks);
+                          }
+                        });
+
+      for (unsigned int i = 0; i < n; ++i) {
+        unsigned int const chan = first + i;
+        if (channels[chan]) {
+          double const* row = charge.data() + i * nTicks;
+          fChargeWork.assign(row, row + nTicks);
+          ApplyTimeOffset(geo, chan, fChargeWork);
+          if (rois) AddSignalROIs(geo, chan, digits.size(), *channels[chan], *rois);
         }
-      } else {
-        for(int i = 0; i < fNTicks; ++i){
-	  adcvec[i] = (short)TMath::Nint(fChargeWork[i]);
+
+        float const* chanNoise = nullptr;
+        unsigned int noiseOffset = 0;
+        if (eventNoise) {
+          chanNoise = noise.data() + i * nTicks;
+        }
+        else if (fNoiseNchToSim > 0) {
+          chanNoise = PickPoolNoise(flat, noiseOffset);
         }
+        digits.push_back(MakeDigit(
+          chan, channels[chan] ? fChargeWork.data() : nullptr, chanNoise, noiseOffset));
       }
+    }
+  }
 
-      adcvec.resize(fNSamplesReadout);
+  //-------------------------------------------------
+  void
+  SimWire::SetTimeResponse(std::vector<double> const& shape, TimeResponse& response) const
+  {
+    // ... the response is circular: lags in the first half of the window
+    //     follow the charge tick, the ones in the second half precede it
+    int const n = shape.size();
+    double peak = 0.;
+    for (double const v : shape)
+      peak = std::max(peak, std::abs(v));
+    double const threshold = fSparseResponseThreshold * peak;
+
+    response.before = 0;
+    response.after = 0;
+    for (int i = 0; i < n; ++i) {
+      if (!(std::abs(shape[i]) > threshold)) continue;
+      if (i < n / 2)
+        response.after = std::max(response.after, i);
+      else
+        response.before = std::max(response.before, n - i);
+    }
+    response.kernel.resize(response.before + response.after + 1);
+    for (int lag = -response.before; lag <= response.after; ++lag)
+      response.kernel[lag + response.before] = shape[(lag + n) % n];
+  }
 
-      // ... compress the adc vector using the desired compression scheme,
-      //     if raw::kNone is selected nothing happens to adcvec
-      //     This shrinks adcvec, if fCompression is not kNone.
-      raw::Compress(adcvec, fCompression);
+  //-------------------------------------------------
+  void
+  SimWire::SparseConvolute(sim::SimChannel const& sc,
+                           TimeResponse const& response,
+                           double* charge) const
+  {
+    int const n = fNTicks;
+    std::fill(charge, charge + n, 0.);
+    double const* kernel = response.kernel.data() + response.before; // lag 0
+    for (auto const& tdcide : sc.TDCIDEMap()) {
+      int const tdc = tdcide.first;
+      if (tdc >= n) continue;
+      double const q = sc.Charge(tdc);
+      if (q == 0.) continue;
+      for (int lag = -response.before; lag <= response.after; ++lag) {
+        int t = tdc + lag;
+        if (t < 0) t += n;
+        else if (t >= n) t -= n;
+        charge[t] += q * kernel[lag];
+      }
+    }
+  }
 
-      // ... add this digit to the collection
-      digcol->emplace_back(chan, fNTicks, move(adcvec), fCompression);
+  //-------------------------------------------------
+  void
+  SimWire::AddSignalROIs(geo::GeometryCore const& geo,
+                         raw::ChannelID_t chan,
+                         std::size_t digitIndex,
+                         sim::SimChannel const& sc,
+                         sim::RawDigitSignalROIs& rois) const
+  {
+    // ... the response extends each charge tick to [ tdc - before, tdc + after ],
+    //     and the time offset rotates the whole window: the resulting ranges
+    //     are split where they wrap around, and clipped to the readout
+    int const n = fNTicks;
+    int const readout = std::min<int>(fNSamplesReadout, n);
+    TimeResponse const& response =
+      (geo.SignalType(chan) == geo::kInduction) ? fIndTimeResponse : fColTimeResponse;
+    int const offset = TimeOffset(geo, chan);
+
+    std::vector<std::pair<int, int>> ranges;
+    auto addRange = [&ranges, readout](int begin, int end) {
+      begin = std::max(begin, 0);
+      end = std::min(end, readout);
+      if (begin < end) ranges.emplace_back(begin, end);
+    };
+    for (auto const& tdcide : sc.TDCIDEMap()) {
+      int const tdc = tdcide.first;
+      if ((tdc >= n) || (sc.Charge(tdc) == 0.)) continue;
+      int begin = (tdc - response.before + offset) % n;
+      if (begin < 0) begin += n;
+      int const end = begin + response.before + response.after + 1;
+      addRange(begin, std::min(end, n));
+      if (end > n) addRange(0, end - n);
+    }
+    if (ranges.empty()) return;
+
+    std::sort(ranges.begin(), ranges.end());
+    rois.channel.push_back(chan);
+    rois.digitIndex.push_back(digitIndex);
+    int roiEnd = -1;
+    for (auto const& [begin, end] : ranges) {
+      if (begin <= roiEnd) {
+        roiEnd = std::max(roiEnd, end);
+        rois.roiEnd.back() = roiEnd;
+        continue;
+      }
+      rois.roiBegin.push_back(begin);
+      rois.roiEnd.push_back(end);
+      roiEnd = end;
+    }
+    rois.firstROI.push_back(rois.roiBegin.size());
+  }
+
+  //-------------------------------------------------
+  SimWire::FFTWorker&
+  SimWire::LocalFFTWorker()
+  {
+    auto& worker = fFFTWorkers.local();
+    if (!worker) {
+      // FFTW planning is not thread-safe
+      static std::mutex planMutex;
+      std::lock_guard<std::mutex> lock(planMutex);
+      worker = std::make_unique<FFTWorker>(fNTicks, fFFTOptions);
+    }
+    return *worker;
+  }
 
-    }//end loop over channels
+  //-------------------------------------------------
+  SimWire::FFTWorker::FFTWorker(int size, std::string const& options)
+    : fSize(size)
+    , fFreqSize(size/2 + 1)
+    , fFFT(std::make_unique<TFFTRealComplex>(size, false))
+    , fInverseFFT(std::make_unique<TFFTComplexReal>(size, false))
+    , fCompTemp(fFreqSize)
+  {
+    int dummy[1] = {0};
+    fFFT->Init(options.c_str(), -1, dummy);
+    fInverseFFT->Init(options.c_str(), 1, dummy);
+  }
 
-    evt.put(std::move(digcol));
+  //-------------------------------------------------
+  void
+  SimWire::FFTWorker::Convolute(double* data, std::vector<TComplex> const& kernel)
+  {
+    double real = 0.;
+    double imaginary = 0.;
+    for (int p = 0; p < fSize; ++p)
+      fFFT->SetPoint(p, data[p]);
+    fFFT->Transform();
+    for (int i = 0; i < fFreqSize; ++i) {
+      fFFT->GetPointComplex(i, real, imaginary);
+      fCompTemp[i] = TComplex(real, imaginary) * kernel[i];
+    }
 
-    return;
+    for (int i = 0; i < fFreqSize; ++i)
+      fInverseFFT->SetPoint(i, fCompTemp[i].Re(), fCompTemp[i].Im());
+    fInverseFFT->Transform();
+    double const factor = 1.0 / (double)fSize;
+    for (int i = 0; i < fSize; ++i)
+      data[i] = factor * fInverseFFT->GetPointReal(i, false);
+  }
+
+  //-------------------------------------------------
+  void
+  SimWire::FFTWorker::DoInvFFT(TComplex const* input, float* output)
+  {
+    for (int i = 0; i < fFreqSize; ++i)
+      fInverseFFT->SetPoint(i, input[i].Re(), input[i].Im());
+    fInverseFFT->Transform();
+    double const factor = 1.0 / (double)fSize;
+    for (int i = 0; i < fSize; ++i) {
+      output[i] = factor * fInverseFFT->GetPointReal(i, false);
+      // .. see GenNoise()
+      output[i] *= 1. * fSize;
+    }
   }
 
   //-------------------------------------------------
@@ -381,6 +944,10 @@ namespace detsim {
     fFFT->ShiftData(fIndShape, ticks);
     fFFT->DoInvFFT(fIndShape, ind);
 
+    // ... the same responses in the time domain, for the sparse convolution
+    SetTimeResponse(col, fColTimeResponse);
+    SetTimeResponse(ind, fIndTimeResponse);
+
     // ... write the time-domain shapes out to a file
     art::ServiceHandle<art::TFileService const> tfs;
     fColTimeShape = tfs->make<TH1D>(
@@ -401,17 +968,12 @@ namespace detsim {
 
   //-------------------------------------------------
   void
-  SimWire::GenNoise(std::vector<float>& noise, CLHEP::HepRandomEngine& engine)
+  SimWire::SetNoiseSpectrum()
   {
-    CLHEP::RandFlat flat(engine);
-
-    noise.clear();
-    noise.resize(fNTicks, 0.);
-    std::vector<TComplex> noiseFrequency(fNTicks/2+1, 0.); // noise in frequency space
-
-    double pval = 0.;
-    double phase = 0.;
-    double rnd[2] = {0.};
+    // ... the magnitude of each frequency component from the noise model,
+    //     before the random fluctuations, is the same for all the channels
+    fNoiseSpectrum.assign(fNTicks/2+1, 0.);
+    fNoiseLowFilter.assign(fNTicks/2+1, 1.);
 
     // .. width of frequencyBin in kHz
     double binWidth = 1.0/(fNTicks*fSampleRate*1.0e-6);
@@ -424,41 +986,117 @@ namespace detsim {
         // ... Legacy exponential model kept here for reference:
         //     par[0]=NoiseFact, par[1]=NoiseWidth, par[2]=LowCutoff, par[3-7]=0
         //     example parameter values for fcl: NoiseModelPar:[ 1.32e-1,120,7.5,0,0,0,0,0 ]
-        pval = fNoiseModelPar[0] * exp(-(double)i * binWidth / fNoiseModelPar[1]);
-        double lofilter = 1.0 / (1.0 + exp(-(i - fNoiseModelPar[2] / binWidth) / 0.5));
-        flat.fireArray(1, rnd, 0, 1);
-        pval *= lofilter * (0.9 + 0.2 * rnd[0]);
+        fNoiseSpectrum[i] = fNoiseModelPar[0] * exp(-(double)i * binWidth / fNoiseModelPar[1]);
+        fNoiseLowFilter[i] = 1.0 / (1.0 + exp(-(i - fNoiseModelPar[2] / binWidth) / 0.5));
       } else if ( fNoiseModelChoice == "ModUBooNE" ) {
         // ... Modified uBooNE model with additive exp to account for low freq region:
         //     example parameter values for fcl: NoiseModelPar:[
         //                                         4450.,-530.,280.,110.,
         //                                         -0.85,18.,0.064,74. ]
-        pval = fNoiseModelPar[0]*exp(-0.5*pow((x-fNoiseModelPar[1])/fNoiseModelPar[2],2))
+        fNoiseSpectrum[i] = fNoiseModelPar[0]*exp(-0.5*pow((x-fNoiseModelPar[1])/fNoiseModelPar[2],2))
                          *exp(-0.5*pow(x/fNoiseModelPar[3],fNoiseModelPar[4]))
                          +fNoiseModelPar[5]+exp(-fNoiseModelPar[6]*(x-fNoiseModelPar[7]));
-        double randomizer = fNoiseFluct->GetRandom();
-        pval = pval * randomizer/fNTicks;
       } else if ( fNoiseModelChoice == "ArgoNeuT" ) {
         // ... ArgoNeuT data driven model:
         //     In fcl set parameters to: NoiseModelPar:[
         //                                 5000,-5.52058e2,2.81587e2,-5.66561e1,
         //                                 4.10817e1,1.76284e1,1e-1,5.97838e1 ]
-        pval = fNoiseModelPar[0]*exp(-0.5*pow((x-fNoiseModelPar[1])/fNoiseModelPar[2],2))
+        fNoiseSpectrum[i] = fNoiseModelPar[0]*exp(-0.5*pow((x-fNoiseModelPar[1])/fNoiseModelPar[2],2))
                          *((fNoiseModelPar[3]/(x+fNoiseModelPar[4]))+1)
                          +fNoiseModelPar[5]+exp(-fNoiseModelPar[6]*(x-fNoiseModelPar[7]));
-        double randomizer = fNoiseFluct->GetRandom();
-        pval = pval * randomizer/fNTicks;
       } else {
-        throw cet::exception("SimWire::GenNoise") << fNoiseModelChoice
+        throw cet::exception("SimWire::SetNoiseSpectrum") << fNoiseModelChoice
           << " is an unknown choice for the noise model" << std::endl;
       }
+    }
+  }
+
+  //-------------------------------------------------
+  void
+  SimWire::GenNoiseSpectrum(TComplex* noiseFrequency, CLHEP::HepRandomEngine& engine)
+  {
+    CLHEP::RandFlat flat(engine);
+
+    bool const legacy = (fNoiseModelChoice == "Legacy");
+    double pval = 0.;
+    double phase = 0.;
+    double rnd[2] = {0.};
+
+    for (int i=0; i< fNTicks/2+1; ++i) {
+
+      pval = fNoiseSpectrum[i];
+      if ( legacy ) {
+        flat.fireArray(1, rnd, 0, 1);
+        pval *= fNoiseLowFilter[i] * (0.9 + 0.2 * rnd[0]);
+      } else {
+        double randomizer = fNoiseFluct->GetRandom();
+        pval = pval * randomizer/fNTicks;
+      }
 
       flat.fireArray(1,rnd,0,1);
       phase = rnd[0]*2.*TMath::Pi();
 
       TComplex tc(pval*cos(phase),pval*sin(phase));
+      noiseFrequency[i] = 0.;
       noiseFrequency[i] += tc;
     }
+  }
+
+  //-------------------------------------------------
+  void
+  SimWire::GenNoisePool()
+  {
+    // ... the pool depends on all the parameters of the noise model (but not
+    //     on the random seed: jobs sharing the bank file share the pool)
+    std::string key = fNoiseModelChoice + "/" + fNoiseFluctChoice + "/" +
+      std::to_string(fNTicks) + "/" + std::to_string(fSampleRate);
+    for (double const par : fNoiseModelPar) key += ":" + std::to_string(par);
+    key += "/";
+    for (double const par : fNoiseFluctPar) key += ":" + std::to_string(par);
+
+    if (!fNoiseBankFile.empty() &&
+        readNoiseBank(fNoiseBankFile, key, fNoiseNchToSim, fNTicks, fNoise)) {
+      mf::LogInfo("SimWire") << "Noise pool of " << fNoise.size() << " channels loaded from '"
+                             << fNoiseBankFile << "'";
+      return;
+    }
+
+    fNoise.resize(fNoiseNchToSim);
+    for (unsigned int p = 0; p < fNoise.size(); ++p)
+      GenNoise(fNoise[p], fEngine);
+
+    if (!fNoiseBankFile.empty()) {
+      writeNoiseBank(fNoiseBankFile, key, fNoise);
+      mf::LogInfo("SimWire") << "Noise pool of " << fNoise.size() << " channels saved into '"
+                             << fNoiseBankFile << "'";
+    }
+  }
+
+  //-------------------------------------------------
+  float const*
+  SimWire::PickPoolNoise(CLHEP::RandFlat& flat, unsigned int& noiseOffset) const
+  {
+    // ... a circular shift changes the phase of each frequency component by
+    //     an amount linear in frequency; since the phases of the pool are
+    //     already uniformly random, a shifted waveform has the same spectrum
+    //     and the same distribution as an unshifted one. Channels picking the
+    //     same pool entry are still correlated, at the lag between their
+    //     offsets, so the pool should be much larger than the number of
+    //     channels reading out coherent signals.
+    int const noisechan = TMath::Nint(flat.fire()*(1.*(fNoise.size()-1)+0.1));
+    noiseOffset = fNoiseRandomOffset ? flat.fireInt(fNTicks) : 0;
+    return fNoise[noisechan].data();
+  }
+
+  //-------------------------------------------------
+  void
+  SimWire::GenNoise(std::vector<float>& noise, CLHEP::HepRandomEngine& engine)
+  {
+    noise.clear();
+    noise.resize(fNTicks, 0.);
+    std::vector<TComplex> noiseFrequency(fNTicks/2+1, 0.); // noise in frequency space
+
+    GenNoiseSpectrum(noiseFrequency.data(), engine);
 
     // .. inverse FFT MCSignal
     art::ServiceHandle<util::LArFFT> fFFT;
@@ -8,7 +8,12 @@
 ////////////////////////////////////////////////////////////////////////
 
 // C++ includes
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 // Framework includes
 #include "art/Framework/Core/EDAnalyzer.h"
@@ -27,11 +32,22 @@
 #include "lardataobj/RawData/RawDigit.h"
 
 // ROOT includes
+#include <TFFTRealComplex.h>
 #include <TH1.h>
 
+// TBB
+#include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
+
 namespace detsim {
 
   /// Base class for creation of raw signals on wires.
+  ///
+  /// The spectra are accumulated over all the events and the histograms are
+  /// filled at the end of the job. Only the channels of the noise and signal
+  /// wire ranges are transformed; their FFT are run in parallel, in blocks of
+  /// `BatchSize` channels, and the spectra are then added in channel order.
   class WienerFilterAna : public art::EDAnalyzer {
 
   public:
@@ -43,7 +59,32 @@ namespace detsim {
     void endJob();
 
   private:
+    /// Magnitude of the FFT of the waveforms, on a worker thread (the objects
+    /// of `util::LArFFT` are not thread-safe).
+    class SpectrumWorker {
+    public:
+      explicit SpectrumWorker(int size);
+
+      /// Fills `spectrum` (`nBins` bins, as the histograms) from `digit`.
+      void Spectrum(raw::RawDigit const& digit, int nBins, double* spectrum);
+
+    private:
+      int fSize;
+      std::unique_ptr<TFFTRealComplex> fFFT;
+    };
+
+    /// Returns the spectrum worker of the current thread.
+    SpectrumWorker& LocalSpectrumWorker();
+
+    /// Index of the accumulated spectrum of the plane of `wireid`.
+    std::size_t
+    PlaneIndex(geo::WireID const& wireid) const
+    {
+      return (wireid.Cryostat * fNTPC + wireid.TPC) * fNPlanes + wireid.Plane;
+    }
+
     std::string fDetSimModuleLabel; //< name of module that produced the digits
+    unsigned int fBatchSize;        ///< number of channels transformed in each block
 
     TH1F* fCnoise[10][10][5];
     TH1F* fCsignal[10][10][5];
@@ -53,9 +94,22 @@ namespace detsim {
 
     TH1F* fFilter_av[10][10][5];
 
-    TH1* ff;
     TH1F* hh;
+    int fNTicks;
     int fNBins;
+    unsigned int fNCryostats;
+    unsigned int fNTPC;
+    unsigned int fNPlanes;
+
+    // spectra (fNBins bins per plane, indexed as the histograms), summed over
+    // all the events, and the ones of the sample wires of the last event
+    std::vector<double> fNoiseSum;
+    std::vector<double> fSignalSum;
+    std::vector<double> fNoiseSample;
+    std::vector<double> fSignalSample;
+    std::vector<short> fLastWaveform; ///< ADC of the last digit, for `hh`
+
+    tbb::enumerable_thread_specific<std::unique_ptr<SpectrumWorker>> fWorkers;
   }; // class WienerFilterAna
 
 } // End caldata namespace.
@@ -64,8 +118,14 @@ namespace detsim {
 
   //-------------------------------------------------
   WienerFilterAna::WienerFilterAna(fhicl::ParameterSet const& pset)
-    : EDAnalyzer(pset), fDetSimModuleLabel(pset.get<std::string>("DetSimModuleLabel"))
-  {}
+    : EDAnalyzer(pset)
+    , fDetSimModuleLabel(pset.get<std::string>("DetSimModuleLabel"))
+    , fBatchSize(pset.get<unsigned int>("BatchSize", 256))
+  {
+    if (fBatchSize == 0) {
+      throw cet::exception("WienerFilterAna") << "BatchSize must be positive" << std::endl;
+    }
+  }
 
   //-------------------------------------------------
   void
@@ -75,16 +135,22 @@ namespace detsim {
     art::ServiceHandle<art::TFileService const> tfs;
 
     art::ServiceHandle<util::LArFFT const> fFFT;
-    int fNTicks = fFFT->FFTSize();
+    fNTicks = fFFT->FFTSize();
     fNBins = fNTicks / 2 + 1;
     auto const clock_data =
       art::ServiceHandle<detinfo::DetectorClocksService const>()->DataForJob();
     double samprate = sampling_rate(clock_data);
     double sampfreq = 1. / samprate * 1e6; // in kHz
     art::ServiceHandle<geo::Geometry const> geo;
-    unsigned int fNPlanes = geo->Nplanes();
-    unsigned int fNCryostats = geo->Ncryostats();
-    unsigned int fNTPC = geo->NTPC();
+    fNPlanes = geo->Nplanes();
+    fNCryostats = geo->Ncryostats();
+    fNTPC = geo->NTPC();
+
+    std::size_t const nSpectrumBins = fNCryostats * fNTPC * fNPlanes * fNBins;
+    fNoiseSum.assign(nSpectrumBins, 0.0);
+    fSignalSum.assign(nSpectrumBins, 0.0);
+    fNoiseSample.assign(nSpectrumBins, 0.0);
+    fSignalSample.assign(nSpectrumBins, 0.0);
 
     for (unsigned int icstat = 0; icstat < fNCryostats; icstat++) {
       for (unsigned int itpc = 0; itpc < fNTPC; itpc++) {
@@ -137,10 +203,24 @@ namespace detsim {
   WienerFilterAna::endJob()
   {
 
-    art::ServiceHandle<geo::Geometry const> geom;
-    unsigned int nplanes = geom->Nplanes();
-    unsigned int fNCryostats = geom->Ncryostats();
-    unsigned int fNTPC = geom->NTPC();
+    unsigned int nplanes = fNPlanes;
+
+    // fill the spectra accumulated over the events
+    for (unsigned int icstat = 0; icstat < fNCryostats; icstat++) {
+      for (unsigned int itpc = 0; itpc < fNTPC; itpc++) {
+        for (unsigned int pp = 0; pp < nplanes; pp++) {
+          std::size_t const first = ((icstat * fNTPC + itpc) * nplanes + pp) * fNBins;
+          for (int ii = 0; ii < fNBins; ii++) {
+            fCnoise_av[icstat][itpc][pp]->SetBinContent(ii, fNoiseSum[first + ii]);
+            fCsignal_av[icstat][itpc][pp]->SetBinContent(ii, fSignalSum[first + ii]);
+            fCnoise[icstat][itpc][pp]->SetBinContent(ii, fNoiseSample[first + ii]);
+            fCsignal[icstat][itpc][pp]->SetBinContent(ii, fSignalSample[first + ii]);
+          }
+        }
+      }
+    }
+    for (std::size_t t = 1; t < fLastWaveform.size(); t++)
+      hh->SetBinContent(t, fLastWaveform[t]);
 
     // calculate filters
 
@@ -189,56 +269,102 @@ namespace detsim {
     mf::LogInfo("WienerFilterMicroBooNE")
       << "WienerFilterMicroBooNE:: rdHandle size is " << rdHandle->size();
 
-    // Read in the digit List object(s).
-
-    // Use the handle to get a particular (0th) element of collection.
-    art::PtrVector<raw::RawDigit> rdvec;
-    for (unsigned int i = 0; i < rdHandle->size(); ++i) {
-      art::Ptr<raw::RawDigit> r(rdHandle, i);
-      rdvec.push_back(r);
-      // std::cout << " i, rdvec: "<<i <<" " << r->ADC(0) << " "<< rdvec[i]->ADC(0)<< std::endl;
-    }
-
     art::ServiceHandle<geo::Geometry const> geom;
-    art::ServiceHandle<util::LArFFT const> fft;
-
-    for (unsigned int rd = 0; rd < rdvec.size(); ++rd) {
-
-      std::vector<double> adc(fft->FFTSize());
-
-      for (unsigned int t = 1; t < rdvec[rd]->Samples(); t++) {
-        adc[t - 1] = rdvec[rd]->ADC(t - 1);
-        hh->SetBinContent(t, rdvec[rd]->ADC(t));
-      }
 
-      geo::WireID wireid = geom->ChannelToWire(rdvec[rd]->Channel())[0];
-
-      // this is hardcoded for the time being. Should be automatized.
-      unsigned int plane = wireid.Plane; /// \todo  Need to change hardcoded values to an automatic
-                                         /// determination of noise vs. signal
-      unsigned int wire = wireid.Wire;
-      unsigned int cstat = wireid.Cryostat;
-      unsigned int tpc = wireid.TPC;
-      ff = hh->FFT(NULL, "MAG M");
-      if (wire >= 50 && wire < 250) {
-        for (int ii = 0; ii < fNBins; ii++) {
-          fCnoise_av[cstat][tpc][plane]->AddBinContent(ii, ff->GetBinContent(ii));
-          if (wire == 150) fCnoise[cstat][tpc][plane]->SetBinContent(ii, ff->GetBinContent(ii));
-        }
-      }
-      else if (wire >= 700 && wire < 900) {
-        for (int ii = 0; ii < fNBins; ii++) {
-          fCsignal_av[cstat][tpc][plane]->AddBinContent(ii, ff->GetBinContent(ii));
-          if (wire == 800) fCsignal[cstat][tpc][plane]->SetBinContent(ii, ff->GetBinContent(ii));
-        }
+    // this is hardcoded for the time being. Should be automatized.
+    /// \todo  Need to change hardcoded values to an automatic
+    /// determination of noise vs. signal
+    auto const isNoise = [](unsigned int wire) { return wire >= 50 && wire < 250; };
+    auto const isSignal = [](unsigned int wire) { return wire >= 700 && wire < 900; };
+
+    // only the channels in the noise and signal ranges contribute
+    std::vector<raw::RawDigit const*> selected;
+    std::vector<geo::WireID> wireids;
+    for (raw::RawDigit const& digit : *rdHandle) {
+      geo::WireID const wireid = geom->ChannelToWire(digit.Channel())[0];
+      if (!isNoise(wireid.Wire) && !isSignal(wireid.Wire)) continue;
+      selected.push_back(&digit);
+      wireids.push_back(wireid);
+    }
+    fLastWaveform = rdHandle->back().ADCs();
+
+    std::vector<double> spectra(fBatchSize * fNBins);
+    for (std::size_t first = 0; first < selected.size(); first += fBatchSize) {
+      std::size_t const n = std::min<std::size_t>(fBatchSize, selected.size() - first);
+
+      tbb::parallel_for(tbb::blocked_range<std::size_t>(0, n),
+                        [&](tbb::blocked_range<std::size_t> const& range) {
+                          SpectrumWorker& worker = LocalSpectrumWorker();
+                          for (std::size_t i = range.begin(); i != range.end(); ++i)
+                            worker.Spectrum(
+                              *selected[first + i], fNBins, spectra.data() + i * fNBins);
+                        });
+
+      // the sums are made in channel order, for reproducible results
+      for (std::size_t i = 0; i < n; ++i) {
+        geo::WireID const& wireid = wireids[first + i];
+        double const* spectrum = spectra.data() + i * fNBins;
+        std::size_t const offset = PlaneIndex(wireid) * fNBins;
+        bool const noise = isNoise(wireid.Wire);
+        double* sum = (noise ? fNoiseSum : fSignalSum).data() + offset;
+        for (int ii = 0; ii < fNBins; ii++)
+          sum[ii] += spectrum[ii];
+        if (wireid.Wire == (noise ? 150U : 800U))
+          std::copy(spectrum,
+                    spectrum + fNBins,
+                    (noise ? fNoiseSample : fSignalSample).begin() + offset);
       }
-
-      //
     } //end loop over rawDigits
 
     return;
   } //end analyze method
 
+  //-------------------------------------------------
+  WienerFilterAna::SpectrumWorker&
+  WienerFilterAna::LocalSpectrumWorker()
+  {
+    auto& worker = fWorkers.local();
+    if (!worker) {
+      // FFTW planning is not thread-safe
+      static std::mutex planMutex;
+      std::lock_guard<std::mutex> lock(planMutex);
+      worker = std::make_unique<SpectrumWorker>(fNTicks);
+    }
+    return *worker;
+  }
+
+  //-------------------------------------------------
+  WienerFilterAna::SpectrumWorker::SpectrumWorker(int size)
+    : fSize(size), fFFT(std::make_unique<TFFTRealComplex>(size, false))
+  {
+    // same transform as `TH1::FFT(..., "MAG M")`
+    int dummy[1] = {0};
+    fFFT->Init("M", -1, dummy);
+  }
+
+  //-------------------------------------------------
+  void
+  WienerFilterAna::SpectrumWorker::Spectrum(raw::RawDigit const& digit,
+                                            int nBins,
+                                            double* spectrum)
+  {
+    // the waveform starts from the second sample, as in the histogram it was
+    // historically transformed from
+    int const nSamples = std::min<int>(fSize, static_cast<int>(digit.Samples()) - 1);
+    for (int p = 0; p < fSize; ++p)
+      fFFT->SetPoint(p, (p < nSamples) ? digit.ADC(p + 1) : 0.);
+    fFFT->Transform();
+
+    // bin ii (from 1) holds the magnitude of the frequency ii-1
+    double real = 0.;
+    double imaginary = 0.;
+    spectrum[0] = 0.;
+    for (int ii = 1; ii < nBins; ii++) {
+      fFFT->GetPointComplex(ii - 1, real, imaginary);
+      spectrum[ii] = std::hypot(real, imaginary);
+    }
+  }
+
 } //end namespace
 
 namespace detsim {
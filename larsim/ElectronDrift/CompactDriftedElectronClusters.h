@@ -0,0 +1,87 @@
+/**
+ * @file larsim/ElectronDrift/CompactDriftedElectronClusters.h
+ * @brief Compact storage of the drifted electron clusters of an event.
+ *
+ * This is a lighter alternative to a `std::vector<sim::SimDriftedElectronCluster>`,
+ * produced by `detsim::SimDriftElectrons` with `StoreCompactDriftedElectronClusters`.
+ */
+
+#ifndef LARSIM_ELECTRONDRIFT_COMPACTDRIFTEDELECTRONCLUSTERS_H
+#define LARSIM_ELECTRONDRIFT_COMPACTDRIFTEDELECTRONCLUSTERS_H
+
+#include "larcoreobj/SimpleTypesAndConstants/RawTypes.h" // raw::ChannelID_t
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sim {
+
+  /**
+   * @brief Drifted electron clusters of an event, in "structure of arrays" layout.
+   *
+   * The clusters are grouped by the energy deposit they come from. For the
+   * deposit `i`, the per-deposit vectors (`depositIndex`, `trackID`,
+   * `depositX`...) have the element `i`, and its clusters are the elements
+   * from `firstCluster[i]` to `firstCluster[i + 1]` (excluded) of the
+   * per-cluster vectors (`channel`, `tdc`, `nElectrons`...): `firstCluster`
+   * has one more element than the deposits. Deposits with no stored cluster
+   * are not listed.
+   *
+   * The final position of a cluster is stored relative to the mean position
+   * of its deposit. All the floating point values are in single precision.
+   *
+   * The producer may store only one cluster every `prescale`, and may merge
+   * (`aggregated`) all the clusters of a deposit reaching the same channel
+   * in the same TDC tick: in that case the number of electrons and the
+   * energy are summed, and time and position are averaged weighting by the
+   * number of electrons.
+   */
+  struct CompactDriftedElectronClusters {
+
+    unsigned int prescale = 1U; ///< One cluster every `prescale` was stored.
+    bool aggregated = false;    ///< Clusters on the same channel and tick are merged.
+
+    /// @name Per-deposit information
+    /// @{
+    std::vector<std::uint32_t> depositIndex; ///< Index in the input deposit collection.
+    std::vector<int> trackID;                ///< Geant4 track ID of the deposit.
+    std::vector<float> depositX;             ///< Mean x of the deposit [cm].
+    std::vector<float> depositY;             ///< Mean y of the deposit [cm].
+    std::vector<float> depositZ;             ///< Mean z of the deposit [cm].
+    std::vector<float> longDiffSigma;        ///< Longitudinal diffusion width [cm].
+    std::vector<float> transDiffSigma;       ///< Transverse diffusion width [cm].
+    std::vector<std::uint32_t> firstCluster; ///< First cluster of each deposit (and end).
+    /// @}
+
+    /// @name Per-cluster information
+    /// @{
+    std::vector<raw::ChannelID_t> channel; ///< Channel reached by the cluster.
+    std::vector<unsigned int> tdc;         ///< TDC tick of the arrival.
+    std::vector<float> time;               ///< Arrival time [ns].
+    std::vector<float> nElectrons;         ///< Number of electrons.
+    std::vector<float> energy;             ///< Deposited energy the cluster comes from [MeV].
+    std::vector<float> dX;                 ///< Final x relative to the deposit [cm].
+    std::vector<float> dY;                 ///< Final y relative to the deposit [cm].
+    std::vector<float> dZ;                 ///< Final z relative to the deposit [cm].
+    /// @}
+
+    /// Number of deposits with stored clusters.
+    std::size_t
+    nDeposits() const
+    {
+      return depositIndex.size();
+    }
+
+    /// Number of stored clusters.
+    std::size_t
+    nClusters() const
+    {
+      return channel.size();
+    }
+
+  }; // struct CompactDriftedElectronClusters
+
+} // namespace sim
+
+#endif // LARSIM_ELECTRONDRIFT_COMPACTDRIFTEDELECTRONCLUSTERS_H
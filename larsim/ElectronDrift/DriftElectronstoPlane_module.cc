@@ -59,6 +59,8 @@
 #include "lardataobj/Simulation/SimEnergyDeposit.h"
 #include "larevt/SpaceChargeServices/SpaceChargeService.h"
 #include "larsim/ElectronDrift/ISCalculationSeparate.h"
+#include "larsim/Utils/DriftPhysicsTable.h"
+#include "larsim/Utils/ElectronClusterDrift.h"
 #include "larsim/Utils/SCEOffsetBounds.h"
 
 // Framework includes
@@ -73,7 +75,6 @@
 
 // External libraries
 #include "CLHEP/Random/RandGauss.h"
-#include "TMath.h"
 
 namespace detsim {
 
@@ -107,22 +108,22 @@ namespace detsim {
     bool fUseModBoxRecomb;
 
     double fElectronLifetime;
-    double fLifetimeCorr_const;
-    double fLDiff_const;
-    double fTDiff_const;
     double fRecipDriftVel[3];
 
+    // Attenuation and diffusion widths by drift time.
+    larsim::Utils::DriftPhysicsTable fDriftPhysics;
+
+    // Drift direction and time, splitting in clusters and their diffusion
+    // (shared with SimDriftElectrons).
+    larsim::Utils::ElectronClusterDrift fClusterDrift;
+
     // Save the number of cryostats, and the number of TPCs within
     // each cryostat.
     size_t fNCryostats;
     std::vector<size_t> fNTPCs;
 
     // Per-cluster information.
-    std::vector<double> fLongDiff;
-    std::vector<double> fTransDiff1;
-    std::vector<double> fTransDiff2;
-    std::vector<double> fnElDiff;
-    std::vector<double> fnEnDiff;
+    larsim::Utils::ElectronClusters fElectronClusters;
 
     double fDriftClusterPos[3];
 
@@ -182,10 +183,10 @@ namespace detsim {
       << "\n Drift velocity (cm/ns): " << 1. / fRecipDriftVel[0] << " " << 1. / fRecipDriftVel[1]
       << " " << 1. / fRecipDriftVel[2];
 
-    // Opposite of lifetime. Convert from us to standard LArSoft time units, ns;
-    fLifetimeCorr_const = -1000. * fElectronLifetime;
-    fLDiff_const = std::sqrt(2. * fLongitudinalDiffusion);
-    fTDiff_const = std::sqrt(2. * fTransverseDiffusion);
+    fDriftPhysics = larsim::Utils::DriftPhysicsTable{
+      fElectronLifetime, fLongitudinalDiffusion, fTransverseDiffusion};
+    fClusterDrift = larsim::Utils::ElectronClusterDrift{
+      fRecipDriftVel, fElectronClusterSize, fMinNumberOfElCluster};
 
     // For this detector's geometry, save the number of cryostats and
     // the number of TPCs within each cryostat.
@@ -236,95 +237,41 @@ namespace detsim {
       unsigned int tpc = 0;
       const geo::TPCGeo& tpcGeo = fGeometry->TPC(tpc, cryostat);
 
-      // The drift direction can be either in the positive
-      // or negative direction in any coordinate x, y or z.
-      // Charge drift in ...
-      // +x: tpcGeo.DetectDriftDirection()==1
-      // -x: tpcGeo.DetectDriftDirection()==-1
-      // +y: tpcGeo.DetectDriftDirection()==2
-      // -y tpcGeo.DetectDriftDirection()==-2
-      // +z: tpcGeo.DetectDriftDirection()==3
-      // -z: tpcGeo.DetectDriftDirection()==-3
-
       //Define charge drift direction: driftcoordinate (x, y or z) and driftsign (positive or negative). Also define coordinates perpendicular to drift direction.
-      int driftcoordinate = std::abs(tpcGeo.DetectDriftDirection()) - 1; //x:0, y:1, z:2
-
-      int transversecoordinate1 = 0;
-      int transversecoordinate2 = 0;
-      if (driftcoordinate == 0) {
-        transversecoordinate1 = 1;
-        transversecoordinate2 = 2;
-      }
-      else if (driftcoordinate == 1) {
-        transversecoordinate1 = 0;
-        transversecoordinate2 = 2;
-      }
-      else if (driftcoordinate == 2) {
-        transversecoordinate1 = 0;
-        transversecoordinate2 = 1;
-      }
-
-      if (transversecoordinate1 == transversecoordinate2)
-        continue; //this is the case when driftcoordinate != 0, 1 or 2
-
-      int driftsign = 0; //1: +x, +y or +z, -1: -x, -y or -z
-      if (tpcGeo.DetectDriftDirection() > 0)
-        driftsign = 1;
-      else
-        driftsign = -1;
+      larsim::Utils::ElectronClusterDrift::Axes axes;
+      if (!fClusterDrift.driftAxes(tpcGeo, axes)) continue;
+      int const driftcoordinate = axes.drift;
+      int const transversecoordinate1 = axes.trans1;
+      int const transversecoordinate2 = axes.trans2;
 
       //Check for charge deposits behind charge readout planes
-      if (driftsign == 1 && tpcGeo.PlaneLocation(0)[driftcoordinate] < xyz[driftcoordinate])
-        continue;
-      if (driftsign == -1 && tpcGeo.PlaneLocation(0)[driftcoordinate] > xyz[driftcoordinate])
-        continue;
-
-      /// \todo think about effects of drift between planes.
-      // Center of plane is also returned in cm units
-      double DriftDistance =
-        std::abs(xyz[driftcoordinate] - tpcGeo.PlaneLocation(0)[driftcoordinate]);
+      if (fClusterDrift.behindPlanes(tpcGeo, axes, xyz)) continue;
 
       // Space-charge effect (SCE): Get SCE {x,y,z} offsets for
       // particular location in TPC
-      geo::Vector_t posOffsets{0.0, 0.0, 0.0};
       double posOffsetxyz[3] = {
         0.0, 0.0, 0.0}; //need this array for the driftcoordinate and transversecoordinates
       auto const* SCE = lar::providerFrom<spacecharge::SpaceChargeService>();
       if (SCE->EnableSimSpatialSCE() == true) {
-        posOffsets = SCE->GetPosOffsets(mp);
-	if (larsim::Utils::SCE::out_of_bounds(posOffsets)) continue;
+        geo::Vector_t const posOffsets = SCE->GetPosOffsets(mp);
+        if (larsim::Utils::SCE::out_of_bounds(posOffsets)) continue;
         posOffsetxyz[0] = posOffsets.X();
         posOffsetxyz[1] = posOffsets.Y();
         posOffsetxyz[2] = posOffsets.Z();
       }
 
-      double avegagetransversePos1 = 0.;
-      double avegagetransversePos2 = 0.;
-
-      DriftDistance += -1. * posOffsetxyz[driftcoordinate];
-      avegagetransversePos1 = xyz[transversecoordinate1] + posOffsetxyz[transversecoordinate1];
-      avegagetransversePos2 = xyz[transversecoordinate2] + posOffsetxyz[transversecoordinate2];
-
-      // Space charge distortion could push the energy deposit beyond the wire
-      // plane (see issue #15131). Given that we don't have any subtlety in the
-      // simulation of this region, bringing the deposit exactly on the plane
-      // should be enough for the time being.
-      if (DriftDistance < 0.) DriftDistance = 0.;
+      double const avegagetransversePos1 =
+        xyz[transversecoordinate1] + posOffsetxyz[transversecoordinate1];
+      double const avegagetransversePos2 =
+        xyz[transversecoordinate2] + posOffsetxyz[transversecoordinate2];
 
       // Drift time in ns
-      double TDrift = DriftDistance * fRecipDriftVel[0];
-
-      if (
-        tpcGeo.Nplanes() == 2 &&
-        driftcoordinate ==
-          0) { // special case for ArgoNeuT (Nplanes = 2 and drift direction = x): plane 0 is the second wire plane
-        TDrift = ((DriftDistance - tpcGeo.PlanePitch(0, 1)) * fRecipDriftVel[0] +
-                  tpcGeo.PlanePitch(0, 1) * fRecipDriftVel[1]);
-      }
+      double const TDrift = fClusterDrift.driftTime(tpcGeo, axes, xyz, posOffsetxyz);
+
       const int nIonizedElectrons =
         fISAlg.CalculateIonizationAndScintillation(detProp, energyDeposit).numElectrons;
 
-      const double lifetimecorrection = TMath::Exp(TDrift / fLifetimeCorr_const);
+      const double lifetimecorrection = fDriftPhysics.attenuation(TDrift);
       const double energy = energyDeposit.Energy();
 
       // if we have no electrons (too small energy or too large recombination)
@@ -340,56 +287,17 @@ namespace detsim {
       const double nElectrons = nIonizedElectrons * lifetimecorrection;
 
       // Longitudinal & transverse diffusion sigma (cm)
-      double SqrtT = std::sqrt(TDrift);
-      double LDiffSig = SqrtT * fLDiff_const;
-      double TDiffSig = SqrtT * fTDiff_const;
-      double electronclsize = fElectronClusterSize;
-
-      // Number of electron clusters.
-      int nClus = (int)std::ceil(nElectrons / electronclsize);
-      if (nClus < fMinNumberOfElCluster) {
-        electronclsize = nElectrons / fMinNumberOfElCluster;
-        if (electronclsize < 1.0) { electronclsize = 1.0; }
-        nClus = (int)std::ceil(nElectrons / electronclsize);
-      }
-
-      // Empty and resize the electron-cluster vectors.
-      fLongDiff.clear();
-      fTransDiff1.clear();
-      fTransDiff2.clear();
-      fnElDiff.clear();
-      fnEnDiff.clear();
-      fLongDiff.resize(nClus);
-      fTransDiff1.resize(nClus);
-      fTransDiff2.resize(nClus);
-      fnElDiff.resize(nClus, electronclsize);
-      fnEnDiff.resize(nClus);
-
-      // fix the number of electrons in the last cluster, that has a smaller size
-      fnElDiff.back() = nElectrons - (nClus - 1) * electronclsize;
-
-      for (size_t xx = 0; xx < fnElDiff.size(); ++xx) {
-        if (nElectrons > 0)
-          fnEnDiff[xx] = energy / nElectrons * fnElDiff[xx];
-        else
-          fnEnDiff[xx] = 0.;
-      }
-
-      // Smear drift times by longitudinal diffusion
-      if (LDiffSig > 0.0)
-        fRandGauss.fireArray(nClus, &fLongDiff[0], 0., LDiffSig);
-      else
-        fLongDiff.assign(nClus, 0.0);
-
-      if (TDiffSig > 0.0) {
-        // Smear the coordinates in plane perpendicular to drift direction by the transverse diffusion
-        fRandGauss.fireArray(nClus, &fTransDiff1[0], avegagetransversePos1, TDiffSig);
-        fRandGauss.fireArray(nClus, &fTransDiff2[0], avegagetransversePos2, TDiffSig);
-      }
-      else {
-        fTransDiff1.assign(nClus, avegagetransversePos1);
-        fTransDiff2.assign(nClus, avegagetransversePos2);
-      }
+      double const LDiffSig = fDriftPhysics.longitudinalSigma(TDrift);
+      double const TDiffSig = fDriftPhysics.transverseSigma(TDrift);
+
+      // Split in electron clusters, and smear them by the diffusion
+      int const nClus = fClusterDrift.split(nElectrons, energy, fElectronClusters);
+      fClusterDrift.diffuse(fRandGauss,
+                            LDiffSig,
+                            TDiffSig,
+                            avegagetransversePos1,
+                            avegagetransversePos2,
+                            fElectronClusters);
 
       // make a collection of electrons for each plane
       for (size_t p = 0; p < tpcGeo.Nplanes(); ++p) {
@@ -400,7 +308,7 @@ namespace detsim {
         for (int k = 0; k < nClus; ++k) {
 
           // Correct drift time for longitudinal diffusion and plane
-          double TDiff = TDrift + fLongDiff[k] * fRecipDriftVel[0];
+          double TDiff = TDrift + fElectronClusters.longDiff[k] * fRecipDriftVel[0];
 
           // Take into account different Efields between planes
           // Also take into account special case for ArgoNeuT (Nplanes = 2 and drift direction = x): plane 0 is the second wire plane
@@ -411,12 +319,12 @@ namespace detsim {
               fRecipDriftVel[(tpcGeo.Nplanes() == 2 && driftcoordinate == 0) ? ip + 2 : ip + 1];
           }
 
-          fDriftClusterPos[transversecoordinate1] = fTransDiff1[k];
-          fDriftClusterPos[transversecoordinate2] = fTransDiff2[k];
+          fDriftClusterPos[transversecoordinate1] = fElectronClusters.trans1[k];
+          fDriftClusterPos[transversecoordinate2] = fElectronClusters.trans2[k];
           auto const simTime = energyDeposit.Time();
           /// \todo think about effects of drift between planes
           SimDriftedElectronClusterCollection->emplace_back(
-            fnElDiff[k],
+            fElectronClusters.nElectrons[k],
             TDiff + simTime,                      // timing
             geo::Point_t{mp.X(), mp.Y(), mp.Z()}, // mean position of the deposited energy
             geo::Point_t{fDriftClusterPos[0],
@@ -424,7 +332,7 @@ namespace detsim {
                          fDriftClusterPos[2]}, // final position of the drifted cluster
             geo::Point_t{
               LDiffSig, TDiffSig, TDiffSig}, // Longitudinal (X) and transverse (Y,Z) diffusion
-            fnEnDiff[k],                     //deposited energy that originated this cluster
+            fElectronClusters.energy[k],     //deposited energy that originated this cluster
             energyDeposit.TrackID());
 
         } // end loop over clusters
@@ -5,6 +5,9 @@
 //
 // Generated at Thu Apr 19 00:41:18 2018 by Wesley Ketchum using cetskelgen
 // from cetlib version v1_21_00.
+//
+// With CompactEnergyDeposits, EDepTag is read as a sim::CompactSimEnergyDeposits
+// (see IonAndScint); the output is always the full collection.
 ////////////////////////////////////////////////////////////////////////
 
 #include "art/Framework/Core/EDProducer.h"
@@ -12,10 +15,13 @@
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
 #include "art_root_io/TFileService.h"
+#include "canvas/Utilities/Exception.h"
 #include "canvas/Utilities/InputTag.h"
 #include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
 
 #include <memory>
+#include <vector>
 
 #include "TNtuple.h"
 #include "larcore/CoreUtils/ServiceUtil.h"
@@ -24,7 +30,9 @@
 #include "lardataobj/Simulation/SimEnergyDeposit.h"
 #include "larevt/SpaceChargeServices/SpaceChargeService.h"
 #include "larsim/IonizationScintillation/ISCalcSeparate.h"
+#include "larsim/Simulation/ReadSimEnergyDeposits.h"
 #include "larsim/Utils/SCEOffsetBounds.h"
+#include "larsim/Utils/SCEOffsetGrid.h"
 
 namespace spacecharge {
   class ShiftEdepSCE;
@@ -49,9 +57,16 @@ public:
 private:
   // Declare member data here.
   art::InputTag fEDepTag;
+  bool fCompactEdeps; // fEDepTag is a sim::CompactSimEnergyDeposits
+  std::vector<sim::SimEnergyDeposit> fEdepBuffer; // expanded compact deposits
   bool fMakeAnaTree;
   TNtuple* fNtEdepAna;
 
+  // Space charge offsets sampled on a grid at the beginning of the job
+  bool fUseSCEOffsetGrid;
+  double fSCEOffsetGridSpacing;
+  larsim::Utils::SCE::OffsetGrid fSCEOffsetGrid;
+
   //IS calculationg
   larg4::ISCalcSeparate fISAlg;
 };
@@ -59,7 +74,10 @@ private:
 spacecharge::ShiftEdepSCE::ShiftEdepSCE(fhicl::ParameterSet const& p)
   : EDProducer{p}
   , fEDepTag(p.get<art::InputTag>("EDepTag"))
+  , fCompactEdeps(p.get<bool>("CompactEnergyDeposits", false))
   , fMakeAnaTree(p.get<bool>("MakeAnaTree", true))
+  , fUseSCEOffsetGrid(p.get<bool>("UseSCEOffsetGrid", false))
+  , fSCEOffsetGridSpacing(p.get<double>("SCEOffsetGridSpacing", 5.0))
 {
   produces<std::vector<sim::SimEnergyDeposit>>();
 }
@@ -74,6 +92,16 @@ spacecharge::ShiftEdepSCE::beginJob()
       "Edep PosDiff Ana Ntuple",
       "energy:orig_x:orig_y:orig_z:orig_el:orig_ph:shift_x:shift_y:shift_z:shift_el:shift_ph");
   }
+
+  auto sce = lar::providerFrom<spacecharge::SpaceChargeService>();
+  if (fUseSCEOffsetGrid && sce->EnableSimSpatialSCE()) {
+    fSCEOffsetGrid = larsim::Utils::SCE::makeTPCOffsetGrid(
+      *lar::providerFrom<geo::Geometry>(), fSCEOffsetGridSpacing);
+    fSCEOffsetGrid.fill([sce](geo::Point_t const& p) { return sce->GetPosOffsets(p); });
+    mf::LogInfo("ShiftEdepSCE") << "Space charge offsets sampled on " << fSCEOffsetGrid.nNodes()
+                                << " nodes; " << (fSCEOffsetGrid.exactCellFraction() * 100.)
+                                << "% of the cells use the space charge service directly.";
+  }
 }
 
 void
@@ -82,18 +110,45 @@ spacecharge::ShiftEdepSCE::produce(art::Event& e)
   auto sce = lar::providerFrom<spacecharge::SpaceChargeService>();
   auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(e);
 
-  auto const& inEdepVec = *e.getValidHandle<std::vector<sim::SimEnergyDeposit>>(fEDepTag);
+  auto const* inEdeps = sim::readSimEnergyDeposits(e, fEDepTag, fCompactEdeps, fEdepBuffer);
+  if (!inEdeps) {
+    throw art::Exception(art::errors::ProductNotFound)
+      << "No energy deposits found with tag '" << fEDepTag.encode() << "'.\n";
+  }
+  auto const& inEdepVec = *inEdeps;
 
   auto outEdepVecPtr = std::make_unique<std::vector<sim::SimEnergyDeposit>>();
   auto& outEdepVec = *outEdepVecPtr;
   outEdepVec.reserve(inEdepVec.size());
 
+  // with the offset grid the offsets of all the deposits are computed together:
+  // start and end of the deposit i are at 2i and 2i+1
+  std::vector<geo::Vector_t> gridOffsets;
+  bool const useGrid = sce->EnableSimSpatialSCE() && fSCEOffsetGrid.isFilled();
+  if (useGrid) {
+    std::vector<geo::Point_t> points;
+    points.reserve(2 * inEdepVec.size());
+    for (auto const& edep : inEdepVec) {
+      points.emplace_back(edep.StartX(), edep.StartY(), edep.StartZ());
+      points.emplace_back(edep.EndX(), edep.EndY(), edep.EndZ());
+    }
+    fSCEOffsetGrid.GetPosOffsets(
+      points, gridOffsets, [sce](geo::Point_t const& p) { return sce->GetPosOffsets(p); });
+  }
+
   geo::Vector_t posOffsetsStart{0.0, 0.0, 0.0};
   geo::Vector_t posOffsetsEnd{0.0, 0.0, 0.0};
-  for (auto const& edep : inEdepVec) {
-    if (sce->EnableSimSpatialSCE()) {
+  for (size_t iEdep = 0; iEdep < inEdepVec.size(); ++iEdep) {
+    auto const& edep = inEdepVec[iEdep];
+    if (useGrid) {
+      posOffsetsStart = gridOffsets[2 * iEdep];
+      posOffsetsEnd = gridOffsets[2 * iEdep + 1];
+    }
+    else if (sce->EnableSimSpatialSCE()) {
       posOffsetsStart = sce->GetPosOffsets({edep.StartX(), edep.StartY(), edep.StartZ()});
       posOffsetsEnd = sce->GetPosOffsets({edep.EndX(), edep.EndY(), edep.EndZ()});
+    }
+    if (sce->EnableSimSpatialSCE()) {
       if (larsim::Utils::SCE::out_of_bounds(posOffsetsStart) ||
           larsim::Utils::SCE::out_of_bounds(posOffsetsEnd) ) { 
           continue; 
@@ -46,6 +46,52 @@
  *   is actually off it by less than the chosen margin, it's accounted for by
  *   that plane; by default the margin is 0 and all the charge off the plane
  *   is lost (with a warning)
+ * * parallel drift: with `ParallelTPCs`, the deposits of each TPC are drifted
+ *   in a separate task, with a random stream seeded from the event and the
+ *   TPC; the channels are then stored TPC by TPC
+ * * chunked drift: with `DepositChunkSize` positive, the deposits are drifted
+ *   that many at a time, so that the working data which grows with the
+ *   number of deposits (space charge offsets, partition among TPCs) stays
+ *   bounded for long readout windows; the results are the same as without
+ *   chunks, and the input and output collections are still whole
+ * * locality order: with `LocalityOrder`, the deposits of each chunk are
+ *   drifted sorted by cryostat, TPC and bin of `LocalityBinWires` wires of
+ *   the first plane (keeping their order within a bin), so that consecutive
+ *   deposits touch the same channels; the `sim::SimChannel` collection is
+ *   then put back in the order the deposits, taken in their original order,
+ *   create the channels. The random sequence is drifted in the new order,
+ *   so the result is statistically equivalent, not identical, to the
+ *   default; with `ParallelTPCs`, the deposits of each TPC are sorted
+ *   within their task, and each TPC restores its channel order before the
+ *   channels of all the TPCs are merged
+ * * tabulated attenuation: with `AttenuationTableStep` (in ns) positive, the
+ *   electron lifetime attenuation is interpolated from a table of drift times
+ *   built at the beginning of the job (see `larsim::Utils::DriftPhysicsTable`);
+ *   by default it is computed exactly for each deposit
+ * * adaptive clusters: with `AdaptiveClusters`, a deposit whose diffusion
+ *   cloud (`AdaptiveClusterSigmas` widths around its centre) lands within a
+ *   single wire and TDC tick on every plane is drifted as one cluster with
+ *   all its electrons, without sampling the diffusion; this changes the
+ *   random sequence, and the charge of the cloud tails beyond those widths
+ *   is collected with the rest
+ * * analytic diffusion: with `AnalyticDiffusion`, the Gaussian diffusion
+ *   cloud of each deposit is integrated over the wires and TDC ticks it
+ *   reaches (within `AnalyticDiffusionSigmas` widths), instead of being
+ *   sampled with electron clusters; the expected charge on each channel and
+ *   tick is the same, without the sampling fluctuations. Deposits in TPCs
+ *   with planes not following the affine wire coordinate model are sampled
+ * * compact channels: with `StoreCompactSimChannels`, the channels are also
+ *   stored as a `sim::CompactSimChannels`, with the IDE positions quantised
+ *   in steps of `CompactSimChannelResolution` (in cm); the full collection
+ *   is still produced for the downstream modules, and can be dropped from
+ *   the output file
+ * * compact deposits: with `CompactEnergyDeposits`, `SimulationLabel` is read
+ *   as a `sim::CompactSimEnergyDeposits` (see `IonAndScint`), expanded into
+ *   the deposits which are drifted
+ * * product sizes: the number of elements and estimated memory of the
+ *   channels and clusters are reported to `sim::ProductFootprintService`
+ *   when it is configured, and with `StoreProductFootprints` put into the
+ *   event as well (see `larsim/Simulation/ProductFootprint.h`)
  *
  * Update:
  * Christoph Alt, September 2018 (christoph.alt@cern.ch)
@@ -54,11 +100,22 @@
 
 // LArSoft includes
 #include "larcore/Geometry/Geometry.h"
+#include "larsim/ElectronDrift/CompactDriftedElectronClusters.h"
+#include "larsim/Simulation/ReadSimEnergyDeposits.h"
 #include "lardataobj/Simulation/SimChannel.h"
 #include "lardataobj/Simulation/SimDriftedElectronCluster.h"
 #include "lardataobj/Simulation/SimEnergyDeposit.h"
+#include "larsim/Simulation/CompactSimChannels.h"
 #include "larsim/Simulation/LArG4Parameters.h"
+#include "larsim/Simulation/ProductFootprint.h"
+#include "larsim/Utils/CounterBasedRandomEngine.h"
+#include "larsim/Utils/DriftPhysicsTable.h"
+#include "larsim/Utils/ElectronClusterDrift.h"
+#include "larsim/Utils/EventArena.h"
+#include "larsim/Utils/PlaneChannelLookup.h"
 #include "larsim/Utils/SCEOffsetBounds.h"
+#include "larsim/Utils/SCEOffsetGrid.h"
+#include "larsim/Utils/TraceZones.h"
 
 #include "larcoreobj/SimpleTypesAndConstants/RawTypes.h" // raw::ChannelID_t
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
@@ -72,18 +129,27 @@
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "canvas/Utilities/Exception.h"
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "nurandom/RandomUtils/NuRandomService.h"
 
 // External libraries
 #include "CLHEP/Random/RandGauss.h"
-#include "TMath.h"
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
 
 // C++ includes
-#include <algorithm> // std::find
+#include <algorithm> // std::min(), std::max(), std::move(), std::stable_sort()
 #include <cmath>
+#include <cstdint>
+#include <iterator> // std::back_inserter()
+#include <limits>
 #include <map>
+#include <memory> // std::make_unique()
+#include <memory_resource>
+#include <numeric> // std::iota()
+#include <tuple>
 
 // stuff from wes
 #include "larsim/IonizationScintillation/ISCalcSeparate.h"
@@ -104,6 +170,10 @@ namespace detsim {
     // The label of the module that created the sim::SimEnergyDeposit
     // objects (as of Oct-2017, this is probably "largeant").
     art::InputTag fSimModuleLabel;
+    // Whether fSimModuleLabel is a sim::CompactSimEnergyDeposits, and its
+    // deposits expanded for the current event.
+    bool fCompactEnergyDeposits;
+    std::vector<sim::SimEnergyDeposit> fEnergyDepositBuffer;
 
     CLHEP::RandGauss fRandGauss;
 
@@ -113,44 +183,261 @@ namespace detsim {
     double fLongitudinalDiffusion;
     double fTransverseDiffusion;
 
-    double fLifetimeCorr_const;
-    double fLDiff_const;
-    double fTDiff_const;
     double fRecipDriftVel[3];
 
+    // Attenuation and diffusion widths by drift time; with a positive
+    // fAttenuationTableStep [ns] the attenuation is tabulated.
+    double fAttenuationTableStep;
+    larsim::Utils::DriftPhysicsTable fDriftPhysics;
+
+    // Drift direction and time, splitting in clusters and their diffusion.
+    larsim::Utils::ElectronClusterDrift fClusterDrift;
+
+    // Drift as a single cluster the deposits whose diffusion cloud, within
+    // fAdaptiveClusterSigmas widths, falls on one wire and tick of each plane.
+    bool fAdaptiveClusters;
+    double fAdaptiveClusterSigmas;
+
+    // Integrate the diffusion cloud over wires and ticks instead of
+    // sampling clusters, within fAnalyticDiffusionSigmas widths.
+    bool fAnalyticDiffusion;
+    double fAnalyticDiffusionSigmas;
+
     bool fStoreDriftedElectronClusters;
 
+    // Compact storage of the drifted clusters (see sim::CompactDriftedElectronClusters).
+    bool fStoreCompactClusters;
+    unsigned int fCompactClusterPrescale; // keep one cluster every this many
+    bool fAggregateCompactClusters;        // merge clusters on the same channel and tick
+
+    // Compact copy of the channels (see sim::CompactSimChannels).
+    bool fStoreCompactSimChannels;
+    double fCompactSimChannelResolution; // step of the quantised IDE positions [cm]
+
+    bool fStoreProductFootprints; // put the sizes of the output products into the event
+
     // double fOffPlaneMargin;
 
     // In order to create the associations, for each channel we create
     // we have to keep track of its index in the output vector, and the
-    // indexes of all the steps that contributed to it.
+    // indexes of all the steps that contributed to it
+    // (the lists live in the arena of the workspace).
+    // The first step contributing to the channel in the original deposit
+    // order, and its rank among the channels that step reaches, tell the
+    // order the channels are created in without `LocalityOrder`.
     struct ChannelBookKeeping {
       size_t channelIndex;
-      std::vector<size_t> stepList;
+      std::pmr::vector<size_t> stepList;
+      size_t firstStep;
+      size_t firstStepRank;
     };
 
-    // Define type: channel -> sim::SimChannel's bookkeeping.
-    typedef std::map<raw::ChannelID_t, ChannelBookKeeping> ChannelMap_t;
+    // Index of the sim::SimChannel's bookkeeping of the channels of a TPC.
+    // The channels of a TPC are dense, so they are looked up in an array
+    // covering the range of their IDs; a map holds any channel outside it.
+    struct ChannelIndex_t {
+      static constexpr size_t NoChannel = std::numeric_limits<size_t>::max();
+      raw::ChannelID_t firstChannel = 0; ///< First channel of the range.
+      std::vector<size_t> index;         ///< Bookkeeping index, or `NoChannel`.
+      std::map<raw::ChannelID_t, size_t> others; ///< Channels off range.
+
+      size_t& operator[](raw::ChannelID_t channel)
+      {
+        if ((channel >= firstChannel) && (channel - firstChannel < index.size()))
+          return index[channel - firstChannel];
+        return others.emplace(channel, NoChannel).first->second;
+      }
+    };
 
-    // Array of maps of channel data indexed by [cryostat,tpc]
-    std::vector<std::vector<ChannelMap_t>> fChannelMaps;
+    // Arrays of channel indices indexed by [cryostat,tpc]
+    std::vector<std::vector<ChannelIndex_t>> fChannelIndices;
     // The above ensemble may be thought of as a 3D array of
     // ChannelBookKeepings: e.g., SimChannel[cryostat,tpc,channel ID].
+    // Each deposit is processed once: the last entry of stepList tells
+    // whether the current deposit was already recorded.
 
     // Save the number of cryostats, and the number of TPCs within
     // each cryostat.
     size_t fNCryostats;
     std::vector<size_t> fNTPCs;
 
-    // Per-cluster information.
-    std::vector<double> fLongDiff;
-    std::vector<double> fTransDiff1;
-    std::vector<double> fTransDiff2;
-    std::vector<double> fnElDiff;
-    std::vector<double> fnEnDiff;
+    // Readout information of each plane, computed once per job. The
+    // wire coordinate of a point is an affine function of its position,
+    // so the channels of all the clusters of a deposit are found with a
+    // dot product and a table lookup (see larsim::Utils::PlaneChannelLookup);
+    // planes where the geometry does not follow that model are handled by
+    // Geometry::NearestChannel().
+    struct PlaneReadout {
+      double timeOffset = 0.; ///< Drift time from the first plane [ns].
+      larsim::Utils::PlaneChannelLookup channels; ///< Channel of a position.
+    };
 
-    double fDriftClusterPos[3];
+    // Plane readout information indexed by [cryostat][tpc][plane]
+    std::vector<std::vector<std::vector<PlaneReadout>>> fPlaneReadout;
+
+    // Working data of the drift of a set of deposits, and its results.
+    struct DriftWorkspace {
+      // Memory of the transient containers below, released in each event;
+      // it is held by pointer so that its address survives moving the workspace.
+      std::unique_ptr<larsim::Utils::EventArena> arena =
+        std::make_unique<larsim::Utils::EventArena>();
+
+      // Per-cluster information.
+      larsim::Utils::ElectronClusters electronClusters;
+
+      double driftClusterPos[3];
+
+      // Per-cluster arrival time and channel on the current plane.
+      std::vector<double> clusterTime;
+      std::vector<double> clusterWireCoord;
+      std::vector<raw::ChannelID_t> clusterChannel;
+
+      // Fractions of the diffusion cloud on each wire and tick (analytic diffusion).
+      std::vector<double> wireFraction;
+      std::vector<double> tickFraction;
+
+      // Bookkeeping of the channels in `channels`, in the same order
+      std::vector<ChannelBookKeeping> bookKeeping;
+      // Channels with a sim::SimChannel here: [cryostat,tpc,channel]
+      std::vector<std::tuple<unsigned int, unsigned int, raw::ChannelID_t>> usedChannels;
+      // Channels reached by the current deposit so far.
+      size_t depositChannels = 0;
+
+      std::vector<sim::SimChannel> channels;
+      std::vector<sim::SimDriftedElectronCluster> clusters;
+
+      sim::CompactDriftedElectronClusters compactClusters;
+      unsigned int compactClusterCount; // clusters seen, for the prescale
+      // cluster of the current deposit, by channel and tick (for aggregation)
+      std::pmr::map<std::pair<raw::ChannelID_t, unsigned int>, size_t> compactClusterIndex{
+        arena->resource()};
+    };
+
+    // Services data of the current event.
+    struct EventContext {
+      detinfo::DetectorClocksData const& clockData;
+      detinfo::DetectorPropertiesData const& detProp;
+      spacecharge::SpaceCharge const* SCE;
+      // Space charge offsets of the middle point of each deposit, if precomputed,
+      // starting from the deposit with index SCEOffsetsBegin.
+      std::vector<geo::Vector_t> const* SCEOffsets;
+      size_t SCEOffsetsBegin;
+    };
+
+    // Drift all the deposits serially.
+    DriftWorkspace fWorkspace;
+
+    // Drift the deposits of each TPC in parallel.
+    bool fParallelTPCs;
+    size_t fDepositChunkSize; // deposits drifted at a time (0: all of them)
+
+    // Drift the deposits sorted by TPC and wire bin.
+    bool fLocalityOrder;
+    double fLocalityBinWires; // wires of the first plane in a bin
+
+    // A deposit with its TPC and wire bin.
+    struct LocatedDeposit {
+      size_t edIndex;
+      unsigned int cryostat;
+      unsigned int tpc;
+      long bin;
+    };
+    std::vector<LocatedDeposit> fLocatedDeposits; // deposits of the chunk (serial drift)
+    std::vector<std::pair<unsigned int, unsigned int>> fTPCIDs; // [cryostat,tpc] of each TPC
+    std::vector<size_t> fTPCOffsets; // index in fTPCIDs of the first TPC of each cryostat
+    std::vector<DriftWorkspace> fTPCWorkspaces;
+
+    // Space charge offsets sampled on a grid at the beginning of the job.
+    bool fUseSCEOffsetGrid;
+    double fSCEOffsetGridSpacing;
+    larsim::Utils::SCE::OffsetGrid fSCEOffsetGrid;
+    std::vector<geo::Point_t> fSCEPoints;    // middle points of the deposits of the chunk
+    std::vector<geo::Vector_t> fSCEOffsets; // offsets of the deposits of the chunk
+
+    void setupPlaneReadout();
+
+    // Finds the cryostat and TPC of the deposit; false if there is none.
+    bool locateDeposit(sim::SimEnergyDeposit const& energyDeposit,
+                       unsigned int& cryostat,
+                       unsigned int& tpc) const;
+
+    // Returns the `LocalityOrder` bin of the deposit in the TPC.
+    long localityBin(sim::SimEnergyDeposit const& energyDeposit,
+                     unsigned int cryostat,
+                     unsigned int tpc) const;
+
+    // Sorts the deposits by cryostat, TPC and bin, keeping the order within a bin.
+    static void sortByLocality(std::vector<LocatedDeposit>& deposits);
+
+    // Sorts the channels of `ws` in the order the deposits, drifted in their
+    // original order, would create them.
+    static void restoreChannelOrder(DriftWorkspace& ws);
+
+    // Prepares `ws` for a new event.
+    void resetWorkspace(DriftWorkspace& ws);
+
+    // Adds a cluster of the current deposit to the compact collection.
+    void addCompactCluster(DriftWorkspace& ws,
+                           raw::ChannelID_t channel,
+                           unsigned int tdc,
+                           double time,
+                           double nElectrons,
+                           double energy,
+                           geo::Point_t const& depositPos) const;
+
+    // Appends the compact clusters of `from` to `to`.
+    static void appendCompactClusters(sim::CompactDriftedElectronClusters& to,
+                                      sim::CompactDriftedElectronClusters const& from);
+
+    // Returns whether the diffusion cloud centred at `center` (on the
+    // transverse coordinates) lands on a single wire and tick of each plane.
+    bool cloudInSingleCell(EventContext const& context,
+                           std::vector<PlaneReadout> const& planeReadouts,
+                           geo::TPCGeo const& tpcGeo,
+                           int driftcoordinate,
+                           double const* center,
+                           double time,
+                           double LDiffSig,
+                           double TDiffSig) const;
+
+    // Returns the channel for the SimChannel of `channel`, adding it if needed,
+    // and records that deposit `edIndex` contributes to it.
+    sim::SimChannel& simChannel(DriftWorkspace& ws,
+                                unsigned int cryostat,
+                                unsigned int tpc,
+                                raw::ChannelID_t channel,
+                                size_t edIndex);
+
+    // Records the deposit in the compact clusters, if any of its clusters was stored.
+    void recordCompactDeposit(DriftWorkspace& ws,
+                              size_t edIndex,
+                              sim::SimEnergyDeposit const& energyDeposit,
+                              double LDiffSig,
+                              double TDiffSig) const;
+
+    // Adds the electrons of the diffusion cloud centred at `center` to the
+    // channels and ticks of each plane, integrating the Gaussian distributions.
+    void driftCloud(EventContext const& context,
+                    size_t edIndex,
+                    sim::SimEnergyDeposit const& energyDeposit,
+                    unsigned int cryostat,
+                    unsigned int tpc,
+                    int driftcoordinate,
+                    double const* center,
+                    double TDrift,
+                    double LDiffSig,
+                    double TDiffSig,
+                    double nElectrons,
+                    DriftWorkspace& ws);
+
+    // Drifts the electrons of a deposit to the readout planes of its TPC.
+    void driftDeposit(EventContext const& context,
+                      size_t edIndex,
+                      sim::SimEnergyDeposit const& energyDeposit,
+                      unsigned int cryostat,
+                      unsigned int tpc,
+                      CLHEP::RandGauss& gauss,
+                      DriftWorkspace& ws);
 
     art::ServiceHandle<geo::Geometry const> fGeometry; ///< Handle to the Geometry service
 
@@ -163,14 +450,63 @@ namespace detsim {
   SimDriftElectrons::SimDriftElectrons(fhicl::ParameterSet const& pset)
     : art::EDProducer{pset}
     , fSimModuleLabel{pset.get<art::InputTag>("SimulationLabel")}
+    , fCompactEnergyDeposits{pset.get<bool>("CompactEnergyDeposits", false)}
     // create a default random engine; obtain the random seed from
     // NuRandomService, unless overridden in configuration with key
     // "Seed"
     , fRandGauss{art::ServiceHandle<rndm::NuRandomService>{}->createEngine(*this, pset, "Seed")}
+    , fAttenuationTableStep{pset.get<double>("AttenuationTableStep", 0.0)}
+    , fAdaptiveClusters{pset.get<bool>("AdaptiveClusters", false)}
+    , fAdaptiveClusterSigmas{pset.get<double>("AdaptiveClusterSigmas", 3.0)}
+    , fAnalyticDiffusion{pset.get<bool>("AnalyticDiffusion", false)}
+    , fAnalyticDiffusionSigmas{pset.get<double>("AnalyticDiffusionSigmas", 5.0)}
     , fStoreDriftedElectronClusters{pset.get<bool>("StoreDriftedElectronClusters", false)}
+    , fStoreCompactClusters{pset.get<bool>("StoreCompactDriftedElectronClusters", false)}
+    , fCompactClusterPrescale{pset.get<unsigned int>("CompactClusterPrescale", 1U)}
+    , fAggregateCompactClusters{pset.get<bool>("AggregateCompactClusters", false)}
+    , fStoreCompactSimChannels{pset.get<bool>("StoreCompactSimChannels", false)}
+    , fCompactSimChannelResolution{pset.get<double>("CompactSimChannelResolution", 0.01)}
+    , fStoreProductFootprints{pset.get<bool>("StoreProductFootprints", false)}
+    , fParallelTPCs{pset.get<bool>("ParallelTPCs", false)}
+    , fDepositChunkSize{pset.get<size_t>("DepositChunkSize", 0)}
+    , fLocalityOrder{pset.get<bool>("LocalityOrder", false)}
+    , fLocalityBinWires{pset.get<double>("LocalityBinWires", 32.0)}
+    , fUseSCEOffsetGrid{pset.get<bool>("UseSCEOffsetGrid", false)}
+    , fSCEOffsetGridSpacing{pset.get<double>("SCEOffsetGridSpacing", 5.0)}
   {
+    if (fAttenuationTableStep < 0.) {
+      throw art::Exception(art::errors::Configuration)
+        << "SimDriftElectrons: AttenuationTableStep must not be negative.\n";
+    }
+    if (fAdaptiveClusters && !(fAdaptiveClusterSigmas > 0.)) {
+      throw art::Exception(art::errors::Configuration)
+        << "SimDriftElectrons: AdaptiveClusterSigmas must be positive.\n";
+    }
+    if (fAnalyticDiffusion && !(fAnalyticDiffusionSigmas > 0.)) {
+      throw art::Exception(art::errors::Configuration)
+        << "SimDriftElectrons: AnalyticDiffusionSigmas must be positive.\n";
+    }
+    if (fLocalityOrder && !(fLocalityBinWires > 0.)) {
+      throw art::Exception(art::errors::Configuration)
+        << "SimDriftElectrons: LocalityBinWires must be positive.\n";
+    }
     produces<std::vector<sim::SimChannel>>();
     if (fStoreDriftedElectronClusters) { produces<std::vector<sim::SimDriftedElectronCluster>>(); }
+    if (fStoreCompactClusters) {
+      if (fCompactClusterPrescale == 0) {
+        throw art::Exception(art::errors::Configuration)
+          << "SimDriftElectrons: CompactClusterPrescale must be positive.\n";
+      }
+      produces<sim::CompactDriftedElectronClusters>();
+    }
+    if (fStoreCompactSimChannels) {
+      if (!(fCompactSimChannelResolution > 0.)) {
+        throw art::Exception(art::errors::Configuration)
+          << "SimDriftElectrons: CompactSimChannelResolution must be positive.\n";
+      }
+      produces<sim::CompactSimChannels>();
+    }
+    if (fStoreProductFootprints) produces<std::vector<sim::ProductFootprint>>();
   }
 
   //-------------------------------------------------
@@ -207,367 +543,896 @@ namespace detsim {
       << "\n Drift velocity (cm/ns): " << 1. / fRecipDriftVel[0] << " " << 1. / fRecipDriftVel[1]
       << " " << 1. / fRecipDriftVel[2];
 
-    // Opposite of lifetime. Convert from us to standard LArSoft time units, ns;
-    fLifetimeCorr_const = -1000. * fElectronLifetime;
-    fLDiff_const = std::sqrt(2. * fLongitudinalDiffusion);
-    fTDiff_const = std::sqrt(2. * fTransverseDiffusion);
-
     // For this detector's geometry, save the number of cryostats and
     // the number of TPCs within each cryostat.
     fNCryostats = fGeometry->Ncryostats();
     fNTPCs.resize(fNCryostats);
     for (size_t n = 0; n < fNCryostats; ++n)
       fNTPCs[n] = fGeometry->NTPC(n);
+
+    // The attenuation table covers the longest drift of the detector (with
+    // some room for space charge displacement); longer drifts are computed.
+    double maxDriftTime = 0.;
+    if (fAttenuationTableStep > 0.) {
+      for (size_t n = 0; n < fNCryostats; ++n) {
+        for (size_t t = 0; t < fNTPCs[n]; ++t) {
+          geo::TPCGeo const& tpcGeo = fGeometry->TPC(t, n);
+          maxDriftTime = std::max(maxDriftTime, tpcGeo.DriftDistance() * fRecipDriftVel[0]);
+        }
+      }
+      maxDriftTime *= 1.1;
+    }
+    fDriftPhysics = larsim::Utils::DriftPhysicsTable{fElectronLifetime,
+                                                     fLongitudinalDiffusion,
+                                                     fTransverseDiffusion,
+                                                     maxDriftTime,
+                                                     fAttenuationTableStep};
+    fClusterDrift = larsim::Utils::ElectronClusterDrift{
+      fRecipDriftVel, fElectronClusterSize, fMinNumberOfElCluster};
+
+    fTPCIDs.clear();
+    fTPCOffsets.clear();
+    for (size_t n = 0; n < fNCryostats; ++n) {
+      fTPCOffsets.push_back(fTPCIDs.size());
+      for (size_t t = 0; t < fNTPCs[n]; ++t)
+        fTPCIDs.emplace_back(n, t);
+    }
+    if (fParallelTPCs) fTPCWorkspaces.resize(fTPCIDs.size());
+
+    setupPlaneReadout();
+
+    auto const* SCE = lar::providerFrom<spacecharge::SpaceChargeService>();
+    if (fUseSCEOffsetGrid && SCE->EnableSimSpatialSCE()) {
+      fSCEOffsetGrid =
+        larsim::Utils::SCE::makeTPCOffsetGrid(*fGeometry.get(), fSCEOffsetGridSpacing);
+      fSCEOffsetGrid.fill([SCE](geo::Point_t const& p) { return SCE->GetPosOffsets(p); });
+      mf::LogInfo("SimDriftElectrons")
+        << "Space charge offsets sampled on " << fSCEOffsetGrid.nNodes() << " nodes; "
+        << (fSCEOffsetGrid.exactCellFraction() * 100.)
+        << "% of the cells use the space charge service directly.";
+    }
+  }
+
+  //-------------------------------------------------
+  void
+  SimDriftElectrons::setupPlaneReadout()
+  {
+    fPlaneReadout.resize(fNCryostats);
+    fChannelIndices.resize(fNCryostats);
+    for (size_t cryo = 0; cryo < fNCryostats; ++cryo) {
+      fPlaneReadout[cryo].resize(fNTPCs[cryo]);
+      fChannelIndices[cryo].resize(fNTPCs[cryo]);
+      for (size_t tpc = 0; tpc < fNTPCs[cryo]; ++tpc) {
+        const geo::TPCGeo& tpcGeo = fGeometry->TPC(tpc, cryo);
+        int const driftcoordinate = std::abs(tpcGeo.DetectDriftDirection()) - 1;
+        auto& planes = fPlaneReadout[cryo][tpc];
+        planes.resize(tpcGeo.Nplanes());
+
+        double timeOffset = 0.;
+        for (size_t p = 0; p < tpcGeo.Nplanes(); ++p) {
+          PlaneReadout& readout = planes[p];
+
+          // Take into account different Efields between planes
+          // Also take into account special case for ArgoNeuT (Nplanes = 2 and
+          // drift direction = x): plane 0 is the second wire plane
+          if (p > 0) {
+            timeOffset += tpcGeo.PlanePitch(p, p - 1) *
+                          fRecipDriftVel[(tpcGeo.Nplanes() == 2 && driftcoordinate == 0) ? p + 1 : p];
+          }
+          readout.timeOffset = timeOffset;
+
+          geo::PlaneID const planeID(cryo, tpc, p);
+          readout.channels = larsim::Utils::PlaneChannelLookup{*fGeometry.get(), planeID};
+          if (!readout.channels.isAffine()) {
+            mf::LogInfo("SimDriftElectrons")
+              << "Wire coordinate of " << planeID << " is not affine: using the geometry service.";
+          }
+        } // for planes
+
+        // range of the channels of this TPC
+        raw::ChannelID_t firstChannel = raw::InvalidChannelID, lastChannel = 0;
+        for (PlaneReadout const& readout : planes) {
+          for (raw::ChannelID_t const channel : readout.channels.wireChannels()) {
+            if (!raw::isValidChannelID(channel)) continue;
+            firstChannel = std::min(firstChannel, channel);
+            lastChannel = std::max(lastChannel, channel);
+          }
+        }
+        ChannelIndex_t& channelIndex = fChannelIndices[cryo][tpc];
+        channelIndex.index.clear();
+        if (firstChannel <= lastChannel) {
+          channelIndex.firstChannel = firstChannel;
+          channelIndex.index.assign(lastChannel - firstChannel + 1, ChannelIndex_t::NoChannel);
+        }
+      }   // for TPCs
+    }     // for cryostats
   }
 
   //-------------------------------------------------
   void
   SimDriftElectrons::produce(art::Event& event)
   {
+    LARSIM_TRACE_ZONE("SimDriftElectrons::produce");
     // Fetch the SimEnergyDeposit objects for this event.
-    typedef art::Handle<std::vector<sim::SimEnergyDeposit>> energyDepositHandle_t;
-    energyDepositHandle_t energyDepositHandle;
     // If there aren't any energy deposits for this event, don't
     // panic. It's possible someone is doing a study with events
     // outside the TPC, or where there are only non-ionizing
     // particles, or something like that.
-    if (!event.getByLabel(fSimModuleLabel, energyDepositHandle)) return;
-
-    // Define the container for the SimChannel objects that will be
-    // transferred to the art::Event after the put statement below.
-    std::unique_ptr<std::vector<sim::SimChannel>> channels(new std::vector<sim::SimChannel>);
-    // Container for the SimDriftedElectronCluster objects
-    std::unique_ptr<std::vector<sim::SimDriftedElectronCluster>>
-      SimDriftedElectronClusterCollection(new std::vector<sim::SimDriftedElectronCluster>);
-
-    // Clear the channel maps from the last event. Remember,
-    // fChannelMaps is an array[cryo][tpc] of maps.
-    size_t cryo = 0;
-    fChannelMaps.resize(fNCryostats);
-    for (auto& cryoData : fChannelMaps) { // each, a vector of maps
-      cryoData.resize(fNTPCs[cryo++]);
-      for (auto& channelsMap : cryoData)
-        channelsMap.clear(); // each, a map
-    }
+    std::vector<sim::SimEnergyDeposit> const* energyDepositPtr = sim::readSimEnergyDeposits(
+      event, fSimModuleLabel, fCompactEnergyDeposits, fEnergyDepositBuffer);
+    if (!energyDepositPtr) return;
 
     auto const clockData =
       art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(event);
-    auto const& tpcClock = clockData.TPCClock();
 
     auto const detProp =
       art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(event, clockData);
+    auto const* SCE = lar::providerFrom<spacecharge::SpaceChargeService>();
+
     // We're going through the input vector by index, rather than by
     // iterator, because we need the index number to compute the
     // associations near the end of this method.
-    auto const& energyDeposits = *energyDepositHandle;
+    auto const& energyDeposits = *energyDepositPtr;
     auto energyDepositsSize = energyDeposits.size();
 
-    // For each energy deposit in this event
-    for (size_t edIndex = 0; edIndex < energyDepositsSize; ++edIndex) {
-      auto const& energyDeposit = energyDeposits[edIndex];
-
-      // "xyz" is the position of the energy deposit in world
-      // coordinates. Note that the units of distance in
-      // sim::SimEnergyDeposit are supposed to be cm.
-      auto const mp = energyDeposit.MidPoint();
-      double const xyz[3] = {mp.X(), mp.Y(), mp.Z()};
-
-      // From the position in world coordinates, determine the
-      // cryostat and tpc. If somehow the step is outside a tpc
-      // (e.g., cosmic rays in rock) just move on to the next one.
-      unsigned int cryostat = 0;
-      try {
-        fGeometry->PositionToCryostat(xyz, cryostat);
-      }
-      catch (cet::exception& e) {
-        mf::LogWarning("SimDriftElectrons") << "step " // << energyDeposit << "\n"
-                                            << "cannot be found in a cryostat\n"
-                                            << e;
-        continue;
+    // The deposits are drifted in chunks of [chunkBegin, chunkEnd).
+    size_t const chunkSize = (fDepositChunkSize > 0) ? fDepositChunkSize : energyDepositsSize;
+
+    // With the offset grid, the space charge offsets of all the deposits
+    // of a chunk are interpolated at once.
+    bool const useSCEGrid = SCE->EnableSimSpatialSCE() && fSCEOffsetGrid.isFilled();
+    auto const chunkContext = [&](size_t chunkBegin, size_t chunkEnd) -> EventContext {
+      if (useSCEGrid) {
+        fSCEPoints.clear();
+        for (size_t edIndex = chunkBegin; edIndex < chunkEnd; ++edIndex)
+          fSCEPoints.push_back(energyDeposits[edIndex].MidPoint());
+        fSCEOffsetGrid.GetPosOffsets(
+          fSCEPoints, fSCEOffsets, [SCE](geo::Point_t const& p) { return SCE->GetPosOffsets(p); });
       }
+      return {clockData, detProp, SCE, useSCEGrid ? &fSCEOffsets : nullptr, chunkBegin};
+    };
 
-      unsigned int tpc = 0;
-      try {
-        fGeometry->PositionToTPC(xyz, tpc, cryostat);
-      }
-      catch (cet::exception& e) {
-        mf::LogWarning("SimDriftElectrons") << "step " // << energyDeposit << "\n"
-                                            << "cannot be found in a TPC\n"
-                                            << e;
-        continue;
+    // Define the container for the SimChannel objects that will be
+    // transferred to the art::Event after the put statement below.
+    std::unique_ptr<std::vector<sim::SimChannel>> channels(new std::vector<sim::SimChannel>);
+    // Container for the SimDriftedElectronCluster objects
+    std::unique_ptr<std::vector<sim::SimDriftedElectronCluster>>
+      SimDriftedElectronClusterCollection(new std::vector<sim::SimDriftedElectronCluster>);
+    auto compactClusters = std::make_unique<sim::CompactDriftedElectronClusters>();
+    compactClusters->prescale = fCompactClusterPrescale;
+    compactClusters->aggregated = fAggregateCompactClusters;
+    compactClusters->firstCluster.push_back(0);
+
+    if (!fParallelTPCs) {
+      resetWorkspace(fWorkspace);
+
+      for (size_t chunkBegin = 0; chunkBegin < energyDepositsSize; chunkBegin += chunkSize) {
+        size_t const chunkEnd = std::min(chunkBegin + chunkSize, energyDepositsSize);
+        EventContext const context = chunkContext(chunkBegin, chunkEnd);
+
+        if (fLocalityOrder) {
+          fLocatedDeposits.clear();
+          for (size_t edIndex = chunkBegin; edIndex < chunkEnd; ++edIndex) {
+            unsigned int cryostat = 0, tpc = 0;
+            if (!locateDeposit(energyDeposits[edIndex], cryostat, tpc)) continue;
+            fLocatedDeposits.push_back(
+              {edIndex, cryostat, tpc, localityBin(energyDeposits[edIndex], cryostat, tpc)});
+          }
+          sortByLocality(fLocatedDeposits);
+          for (LocatedDeposit const& deposit : fLocatedDeposits)
+            driftDeposit(context, deposit.edIndex, energyDeposits[deposit.edIndex],
+                         deposit.cryostat, deposit.tpc, fRandGauss, fWorkspace);
+          continue;
+        }
+
+        // For each energy deposit in this chunk
+        for (size_t edIndex = chunkBegin; edIndex < chunkEnd; ++edIndex) {
+          auto const& energyDeposit = energyDeposits[edIndex];
+          unsigned int cryostat = 0, tpc = 0;
+          if (!locateDeposit(energyDeposit, cryostat, tpc)) continue;
+          driftDeposit(context, edIndex, energyDeposit, cryostat, tpc, fRandGauss, fWorkspace);
+        } // for each sim::SimEnergyDeposit
+      }   // for each chunk
+
+      if (fLocalityOrder) restoreChannelOrder(fWorkspace);
+      channels->swap(fWorkspace.channels);
+      SimDriftedElectronClusterCollection->swap(fWorkspace.clusters);
+      appendCompactClusters(*compactClusters, fWorkspace.compactClusters);
+    }
+    else {
+      // Each TPC gets its own counter-based random stream, keyed by the module
+      // engine (one number per event) and the TPC, so that the result
+      // does not depend on the number of threads; the stream carries on
+      // from one chunk to the next.
+      struct TPCRandom {
+        larsim::Utils::PhiloxRandomEngine engine;
+        CLHEP::RandGauss gauss{engine};
+        TPCRandom(std::uint32_t eventSeed, std::uint32_t key, size_t iTPC)
+          : engine{eventSeed, key, iTPC}
+        {}
+      };
+      constexpr std::uint32_t StreamKey = larsim::Utils::randomStreamKey("SimDriftElectrons");
+      std::uint32_t const eventSeed = static_cast<unsigned int>(fRandGauss.engine());
+      std::vector<std::unique_ptr<TPCRandom>> tpcRandom(fTPCIDs.size());
+      for (DriftWorkspace& ws : fTPCWorkspaces)
+        resetWorkspace(ws);
+
+      std::vector<std::vector<LocatedDeposit>> tpcDeposits(fTPCIDs.size());
+      for (size_t chunkBegin = 0; chunkBegin < energyDepositsSize; chunkBegin += chunkSize) {
+        size_t const chunkEnd = std::min(chunkBegin + chunkSize, energyDepositsSize);
+        EventContext const context = chunkContext(chunkBegin, chunkEnd);
+
+        // Partition the deposits of the chunk by TPC, keeping their order.
+        for (auto& deposits : tpcDeposits)
+          deposits.clear();
+        for (size_t edIndex = chunkBegin; edIndex < chunkEnd; ++edIndex) {
+          unsigned int cryostat = 0, tpc = 0;
+          if (!locateDeposit(energyDeposits[edIndex], cryostat, tpc)) continue;
+          long const bin = fLocalityOrder ? localityBin(energyDeposits[edIndex], cryostat, tpc) : 0;
+          tpcDeposits[fTPCOffsets[cryostat] + tpc].push_back({edIndex, cryostat, tpc, bin});
+        }
+
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, fTPCIDs.size(), 1),
+                          [&](tbb::blocked_range<size_t> const& range) {
+                            for (size_t iTPC = range.begin(); iTPC != range.end(); ++iTPC) {
+                              if (tpcDeposits[iTPC].empty()) continue;
+                              LARSIM_TRACE_ZONE("SimDriftElectrons::driftTPC");
+
+                              auto const [cryostat, tpc] = fTPCIDs[iTPC];
+                              if (!tpcRandom[iTPC])
+                                tpcRandom[iTPC] = std::make_unique<TPCRandom>(eventSeed, StreamKey, iTPC);
+                              DriftWorkspace& ws = fTPCWorkspaces[iTPC];
+                              if (fLocalityOrder) sortByLocality(tpcDeposits[iTPC]);
+                              for (LocatedDeposit const& deposit : tpcDeposits[iTPC])
+                                driftDeposit(context, deposit.edIndex, energyDeposits[deposit.edIndex],
+                                             cryostat, tpc, tpcRandom[iTPC]->gauss, ws);
+                            }
+                          });
+      } // for each chunk
+
+      // Merge the results TPC by TPC, in geometry order.
+      for (DriftWorkspace& ws : fTPCWorkspaces) {
+        if (fLocalityOrder) restoreChannelOrder(ws);
+        std::move(ws.channels.begin(), ws.channels.end(), std::back_inserter(*channels));
+        std::move(ws.clusters.begin(), ws.clusters.end(),
+                  std::back_inserter(*SimDriftedElectronClusterCollection));
+        appendCompactClusters(*compactClusters, ws.compactClusters);
       }
+    }
 
-      const geo::TPCGeo& tpcGeo = fGeometry->TPC(tpc, cryostat);
-
-      // The drift direction can be either in the positive
-      // or negative direction in any coordinate x, y or z.
-      // Charge drift in ...
-      // +x: tpcGeo.DetectDriftDirection()==1
-      // -x: tpcGeo.DetectDriftDirection()==-1
-      // +y: tpcGeo.DetectDriftDirection()==2
-      // -y tpcGeo.DetectDriftDirection()==-2
-      // +z: tpcGeo.DetectDriftDirection()==3
-      // -z: tpcGeo.DetectDriftDirection()==-3
-
-      // Define charge drift direction: driftcoordinate (x, y or z) and
-      // driftsign (positive or negative). Also define coordinates perpendicular
-      // to drift direction.
-      int driftcoordinate = std::abs(tpcGeo.DetectDriftDirection()) - 1; // x:0, y:1, z:2
-
-      int transversecoordinate1 = 0;
-      int transversecoordinate2 = 0;
-      if (driftcoordinate == 0) {
-        transversecoordinate1 = 1;
-        transversecoordinate2 = 2;
-      }
-      else if (driftcoordinate == 1) {
-        transversecoordinate1 = 0;
-        transversecoordinate2 = 2;
-      }
-      else if (driftcoordinate == 2) {
-        transversecoordinate1 = 0;
-        transversecoordinate2 = 1;
-      }
+    LARSIM_TRACE_COUNTER("SimDriftElectrons deposits", energyDepositsSize);
+    LARSIM_TRACE_COUNTER("SimDriftElectrons clusters", SimDriftedElectronClusterCollection->size());
 
-      if (transversecoordinate1 == transversecoordinate2)
-        continue; // this is the case when driftcoordinate != 0, 1 or 2
+    sim::ProductFootprints footprints{sim::makeFootprint("sim::SimChannel", *channels)};
+    if (fStoreDriftedElectronClusters) {
+      footprints.push_back(
+        sim::makeFootprint("sim::SimDriftedElectronCluster", *SimDriftedElectronClusterCollection));
+    }
 
-      int driftsign = 0; // 1: +x, +y or +z, -1: -x, -y or -z
-      if (tpcGeo.DetectDriftDirection() > 0)
-        driftsign = 1;
-      else
-        driftsign = -1;
-
-      // Check for charge deposits behind charge readout planes
-      if (driftsign == 1 && tpcGeo.PlaneLocation(0)[driftcoordinate] < xyz[driftcoordinate])
-        continue;
-      if (driftsign == -1 && tpcGeo.PlaneLocation(0)[driftcoordinate] > xyz[driftcoordinate])
-        continue;
-
-      /// \todo think about effects of drift between planes.
-      // Center of plane is also returned in cm units
-      double DriftDistance =
-        std::abs(xyz[driftcoordinate] - tpcGeo.PlaneLocation(0)[driftcoordinate]);
-
-      // Space-charge effect (SCE): Get SCE {x,y,z} offsets for
-      // particular location in TPC
-      geo::Vector_t posOffsets{0.0, 0.0, 0.0};
-      double posOffsetxyz[3] = {0.0, 0.0, 0.0}; // need this array for the driftcoordinate and
-                                                // transversecoordinates
-      auto const* SCE = lar::providerFrom<spacecharge::SpaceChargeService>();
-      if (SCE->EnableSimSpatialSCE() == true) {
-        posOffsets = SCE->GetPosOffsets(mp);
-	if (larsim::Utils::SCE::out_of_bounds(posOffsets)) {
-          continue;
-	}
-        posOffsetxyz[0] = posOffsets.X();
-        posOffsetxyz[1] = posOffsets.Y();
-        posOffsetxyz[2] = posOffsets.Z();
-      }
+    // Write the sim::SimChannel collection.
+    if (fStoreCompactSimChannels) {
+      event.put(std::make_unique<sim::CompactSimChannels>(
+        sim::makeCompactSimChannels(*channels, fCompactSimChannelResolution)));
+    }
+    event.put(std::move(channels));
+    if (fStoreDriftedElectronClusters) event.put(std::move(SimDriftedElectronClusterCollection));
+    if (fStoreCompactClusters) event.put(std::move(compactClusters));
+    sim::reportFootprints(
+      event, moduleDescription().moduleLabel(), std::move(footprints), fStoreProductFootprints);
+  }
+
+  //-------------------------------------------------
+  bool
+  SimDriftElectrons::locateDeposit(sim::SimEnergyDeposit const& energyDeposit,
+                                   unsigned int& cryostat,
+                                   unsigned int& tpc) const
+  {
+    // From the position in world coordinates, determine the
+    // cryostat and tpc. If somehow the step is outside a tpc
+    // (e.g., cosmic rays in rock) just move on to the next one.
+    auto const mp = energyDeposit.MidPoint();
+    double const xyz[3] = {mp.X(), mp.Y(), mp.Z()};
+
+    cryostat = 0;
+    try {
+      fGeometry->PositionToCryostat(xyz, cryostat);
+    }
+    catch (cet::exception& e) {
+      mf::LogWarning("SimDriftElectrons") << "step " // << energyDeposit << "\n"
+                                          << "cannot be found in a cryostat\n"
+                                          << e;
+      return false;
+    }
 
-      double avegagetransversePos1 = 0.;
-      double avegagetransversePos2 = 0.;
+    tpc = 0;
+    try {
+      fGeometry->PositionToTPC(xyz, tpc, cryostat);
+    }
+    catch (cet::exception& e) {
+      mf::LogWarning("SimDriftElectrons") << "step " // << energyDeposit << "\n"
+                                          << "cannot be found in a TPC\n"
+                                          << e;
+      return false;
+    }
 
-      DriftDistance += -1. * posOffsetxyz[driftcoordinate];
-      avegagetransversePos1 = xyz[transversecoordinate1] + posOffsetxyz[transversecoordinate1];
-      avegagetransversePos2 = xyz[transversecoordinate2] + posOffsetxyz[transversecoordinate2];
+    return true;
+  }
 
-      // Space charge distortion could push the energy deposit beyond the wire
-      // plane (see issue #15131). Given that we don't have any subtlety in the
-      // simulation of this region, bringing the deposit exactly on the plane
-      // should be enough for the time being.
-      if (DriftDistance < 0.) DriftDistance = 0.;
+  //-------------------------------------------------
+  long
+  SimDriftElectrons::localityBin(sim::SimEnergyDeposit const& energyDeposit,
+                                 unsigned int cryostat,
+                                 unsigned int tpc) const
+  {
+    // planes off the affine model are not binned: their deposits keep their order
+    auto const& planes = fPlaneReadout[cryostat][tpc];
+    if (planes.empty() || !planes.front().channels.isAffine()) return 0;
+    auto const mp = energyDeposit.MidPoint();
+    double const xyz[3] = {mp.X(), mp.Y(), mp.Z()};
+    return static_cast<long>(
+      std::floor(planes.front().channels.wireCoordinate(xyz) / fLocalityBinWires));
+  }
 
-      // Drift time in ns
-      double TDrift = DriftDistance * fRecipDriftVel[0];
+  //-------------------------------------------------
+  void
+  SimDriftElectrons::sortByLocality(std::vector<LocatedDeposit>& deposits)
+  {
+    std::stable_sort(
+      deposits.begin(), deposits.end(), [](LocatedDeposit const& a, LocatedDeposit const& b) {
+        return std::tie(a.cryostat, a.tpc, a.bin) < std::tie(b.cryostat, b.tpc, b.bin);
+      });
+  }
 
-      if (tpcGeo.Nplanes() == 2 &&
-          driftcoordinate == 0) { // special case for ArgoNeuT (Nplanes = 2 and drift direction =
-                                  // x): plane 0 is the second wire plane
-        TDrift = ((DriftDistance - tpcGeo.PlanePitch(0, 1)) * fRecipDriftVel[0] +
-                  tpcGeo.PlanePitch(0, 1) * fRecipDriftVel[1]);
-      }
+  //-------------------------------------------------
+  void
+  SimDriftElectrons::restoreChannelOrder(DriftWorkspace& ws)
+  {
+    std::vector<size_t> order(ws.bookKeeping.size());
+    std::iota(order.begin(), order.end(), 0U);
+    std::sort(order.begin(), order.end(), [&ws](size_t a, size_t b) {
+      ChannelBookKeeping const& A = ws.bookKeeping[a];
+      ChannelBookKeeping const& B = ws.bookKeeping[b];
+      return std::tie(A.firstStep, A.firstStepRank) < std::tie(B.firstStep, B.firstStepRank);
+    });
+
+    std::vector<sim::SimChannel> channels;
+    channels.reserve(ws.channels.size());
+    for (size_t const iBookKeeping : order) {
+      ChannelBookKeeping& bookKeeping = ws.bookKeeping[iBookKeeping];
+      channels.push_back(std::move(ws.channels[bookKeeping.channelIndex]));
+      bookKeeping.channelIndex = channels.size() - 1;
+    }
+    ws.channels = std::move(channels);
+  }
 
-      const int nIonizedElectrons = fISAlg.CalcIonAndScint(detProp, energyDeposit).numElectrons;
-      const double lifetimecorrection = TMath::Exp(TDrift / fLifetimeCorr_const);
-      const double energy = energyDeposit.Energy();
-
-      // if we have no electrons (too small energy or too large recombination)
-      // we are done already here
-      if (nIonizedElectrons <= 0) {
-        MF_LOG_DEBUG("SimDriftElectrons")
-          << "step " // << energyDeposit << "\n"
-          << "No electrons drifted to readout, " << energy << " MeV lost.";
-        continue;
-      }
+  //-------------------------------------------------
+  void
+  SimDriftElectrons::resetWorkspace(DriftWorkspace& ws)
+  {
+    // Clear the channel indices used by this workspace in the last event.
+    // Remember, fChannelIndices is an array[cryo][tpc].
+    for (auto const& [cryostat, tpc, channel] : ws.usedChannels) {
+      ChannelIndex_t& channelIndex = fChannelIndices[cryostat][tpc];
+      if ((channel >= channelIndex.firstChannel) &&
+          (channel - channelIndex.firstChannel < channelIndex.index.size()))
+        channelIndex.index[channel - channelIndex.firstChannel] = ChannelIndex_t::NoChannel;
+      else
+        channelIndex.others.erase(channel);
+    }
+    ws.usedChannels.clear();
+    ws.bookKeeping.clear();
+    ws.compactClusterIndex.clear();
+    ws.arena->release(); // nothing is left in the arena now
+    ws.channels.clear();
+    ws.clusters.clear();
+
+    sim::CompactDriftedElectronClusters& compact = ws.compactClusters;
+    compact = sim::CompactDriftedElectronClusters{};
+    compact.firstCluster.push_back(0);
+    ws.compactClusterCount = 0;
+  }
 
-      // includes the effect of lifetime: lifetimecorrection = exp[-tdrift/tau]
-      const double nElectrons = nIonizedElectrons * lifetimecorrection;
-
-      // Longitudinal & transverse diffusion sigma (cm)
-      double SqrtT = std::sqrt(TDrift);
-      double LDiffSig = SqrtT * fLDiff_const;
-      double TDiffSig = SqrtT * fTDiff_const;
-      double electronclsize = fElectronClusterSize;
-
-      // Number of electron clusters.
-      int nClus = (int)std::ceil(nElectrons / electronclsize);
-      if (nClus < fMinNumberOfElCluster) {
-        electronclsize = nElectrons / fMinNumberOfElCluster;
-        if (electronclsize < 1.0) { electronclsize = 1.0; }
-        nClus = (int)std::ceil(nElectrons / electronclsize);
+  //-------------------------------------------------
+  void
+  SimDriftElectrons::addCompactCluster(DriftWorkspace& ws,
+                                       raw::ChannelID_t channel,
+                                       unsigned int tdc,
+                                       double time,
+                                       double nElectrons,
+                                       double energy,
+                                       geo::Point_t const& depositPos) const
+  {
+    if (ws.compactClusterCount++ % fCompactClusterPrescale != 0) return;
+
+    sim::CompactDriftedElectronClusters& compact = ws.compactClusters;
+    float const dX = ws.driftClusterPos[0] - depositPos.X();
+    float const dY = ws.driftClusterPos[1] - depositPos.Y();
+    float const dZ = ws.driftClusterPos[2] - depositPos.Z();
+
+    if (fAggregateCompactClusters) {
+      auto const [it, added] =
+        ws.compactClusterIndex.emplace(std::make_pair(channel, tdc), compact.nClusters());
+      if (!added) {
+        // merge: sums, and averages weighted by the number of electrons
+        size_t const i = it->second;
+        double const total = compact.nElectrons[i] + nElectrons;
+        float const w = (total > 0.) ? nElectrons / total : 0.f;
+        compact.time[i] += w * (time - compact.time[i]);
+        compact.dX[i] += w * (dX - compact.dX[i]);
+        compact.dY[i] += w * (dY - compact.dY[i]);
+        compact.dZ[i] += w * (dZ - compact.dZ[i]);
+        compact.nElectrons[i] += nElectrons;
+        compact.energy[i] += energy;
+        return;
       }
+    }
+
+    compact.channel.push_back(channel);
+    compact.tdc.push_back(tdc);
+    compact.time.push_back(time);
+    compact.nElectrons.push_back(nElectrons);
+    compact.energy.push_back(energy);
+    compact.dX.push_back(dX);
+    compact.dY.push_back(dY);
+    compact.dZ.push_back(dZ);
+  }
 
-      // Empty and resize the electron-cluster vectors.
-      fLongDiff.clear();
-      fTransDiff1.clear();
-      fTransDiff2.clear();
-      fnElDiff.clear();
-      fnEnDiff.clear();
-      fLongDiff.resize(nClus);
-      fTransDiff1.resize(nClus);
-      fTransDiff2.resize(nClus);
-      fnElDiff.resize(nClus, electronclsize);
-      fnEnDiff.resize(nClus);
-
-      // fix the number of electrons in the last cluster, that has a smaller size
-      fnElDiff.back() = nElectrons - (nClus - 1) * electronclsize;
-
-      for (size_t xx = 0; xx < fnElDiff.size(); ++xx) {
-        if (nElectrons > 0)
-          fnEnDiff[xx] = energy / nElectrons * fnElDiff[xx];
-        else
-          fnEnDiff[xx] = 0.;
+  //-------------------------------------------------
+  void
+  SimDriftElectrons::appendCompactClusters(sim::CompactDriftedElectronClusters& to,
+                                           sim::CompactDriftedElectronClusters const& from)
+  {
+    auto append = [](auto& dest, auto const& src) {
+      dest.insert(dest.end(), src.begin(), src.end());
+    };
+    std::uint32_t const offset = to.nClusters();
+    append(to.depositIndex, from.depositIndex);
+    append(to.trackID, from.trackID);
+    append(to.depositX, from.depositX);
+    append(to.depositY, from.depositY);
+    append(to.depositZ, from.depositZ);
+    append(to.longDiffSigma, from.longDiffSigma);
+    append(to.transDiffSigma, from.transDiffSigma);
+    for (size_t i = 1; i < from.firstCluster.size(); ++i)
+      to.firstCluster.push_back(offset + from.firstCluster[i]);
+    append(to.channel, from.channel);
+    append(to.tdc, from.tdc);
+    append(to.time, from.time);
+    append(to.nElectrons, from.nElectrons);
+    append(to.energy, from.energy);
+    append(to.dX, from.dX);
+    append(to.dY, from.dY);
+    append(to.dZ, from.dZ);
+  }
+
+  //-------------------------------------------------
+  sim::SimChannel&
+  SimDriftElectrons::simChannel(DriftWorkspace& ws,
+                                unsigned int cryostat,
+                                unsigned int tpc,
+                                raw::ChannelID_t channel,
+                                size_t edIndex)
+  {
+    // Find whether we already have this channel in our index.
+    size_t& bookKeepingIndex = fChannelIndices[cryostat][tpc][channel];
+
+    // We will find (or create) the pointer to a
+    // sim::SimChannel.
+    size_t channelIndex = 0;
+
+    // Have we created the sim::SimChannel corresponding to
+    // channel ID?
+    if (bookKeepingIndex == ChannelIndex_t::NoChannel) {
+      // We haven't. Initialize the bookkeeping information
+      // for this channel.
+      ChannelBookKeeping bookKeeping{
+        0, std::pmr::vector<size_t>{ws.arena->resource()}, edIndex, ws.depositChannels++};
+
+      // Add a new channel to the end of the list we'll
+      // write out after we've processed this event.
+      bookKeeping.channelIndex = ws.channels.size();
+      ws.channels.emplace_back(channel);
+      channelIndex = bookKeeping.channelIndex;
+
+      // Initialize a vector with the index of the step that
+      // created this channel.
+      bookKeeping.stepList.push_back(edIndex);
+
+      // Save the bookkeeping information for this channel.
+      bookKeepingIndex = ws.bookKeeping.size();
+      ws.bookKeeping.push_back(std::move(bookKeeping));
+      ws.usedChannels.push_back({cryostat, tpc, channel});
+    }
+    else {
+      // We've created this SimChannel for a previous energy
+      // deposit. Get its address.
+
+      auto& bookKeeping = ws.bookKeeping[bookKeepingIndex];
+      channelIndex = bookKeeping.channelIndex;
+
+      // Has this step contributed to this channel before?
+      // Each step is processed at once, so it would be the last one.
+      auto& stepList = bookKeeping.stepList;
+      if (stepList.back() != edIndex) {
+        // No, so add this step's index to the list.
+        stepList.push_back(edIndex);
+        // With LocalityOrder the steps are not in their original order.
+        if (edIndex < bookKeeping.firstStep) {
+          bookKeeping.firstStep = edIndex;
+          bookKeeping.firstStepRank = ws.depositChannels;
+        }
+        ++ws.depositChannels;
       }
+    }
 
-      // Smear drift times by longitudinal diffusion
-      if (LDiffSig > 0.0)
-        fRandGauss.fireArray(nClus, &fLongDiff[0], 0., LDiffSig);
-      else
-        fLongDiff.assign(nClus, 0.0);
+    return ws.channels.at(channelIndex);
+  }
 
-      if (TDiffSig > 0.0) {
-        // Smear the coordinates in plane perpendicular to drift direction by the transverse diffusion
-        fRandGauss.fireArray(nClus, &fTransDiff1[0], avegagetransversePos1, TDiffSig);
-        fRandGauss.fireArray(nClus, &fTransDiff2[0], avegagetransversePos2, TDiffSig);
+  //-------------------------------------------------
+  void
+  SimDriftElectrons::recordCompactDeposit(DriftWorkspace& ws,
+                                          size_t edIndex,
+                                          sim::SimEnergyDeposit const& energyDeposit,
+                                          double LDiffSig,
+                                          double TDiffSig) const
+  {
+    // record the deposit, if any of its clusters was stored
+    sim::CompactDriftedElectronClusters& compact = ws.compactClusters;
+    if (compact.nClusters() > compact.firstCluster.back()) {
+      auto const mp = energyDeposit.MidPoint();
+      compact.depositIndex.push_back(edIndex);
+      compact.trackID.push_back(energyDeposit.TrackID());
+      compact.depositX.push_back(mp.X());
+      compact.depositY.push_back(mp.Y());
+      compact.depositZ.push_back(mp.Z());
+      compact.longDiffSigma.push_back(LDiffSig);
+      compact.transDiffSigma.push_back(TDiffSig);
+      compact.firstCluster.push_back(compact.nClusters());
+    }
+  }
+
+  //-------------------------------------------------
+  void
+  SimDriftElectrons::driftCloud(EventContext const& context,
+                                size_t edIndex,
+                                sim::SimEnergyDeposit const& energyDeposit,
+                                unsigned int cryostat,
+                                unsigned int tpc,
+                                int driftcoordinate,
+                                double const* center,
+                                double TDrift,
+                                double LDiffSig,
+                                double TDiffSig,
+                                double nElectrons,
+                                DriftWorkspace& ws)
+  {
+    // fraction of a Gaussian distribution (mean 0, width 1) below x
+    auto const cdf = [](double x) { return 0.5 * std::erfc(-x * M_SQRT1_2); };
+
+    // fills `fractions` with the fraction of the distribution in each bin
+    // [ first + i, first + i + 1 ) of the range, normalised to the range;
+    // returns the first bin
+    auto const binFractions = [this, &cdf](double mean, double sigma, std::vector<double>& fractions) {
+      if (!(sigma > 0.)) {
+        fractions.assign(1U, 1.);
+        return std::floor(mean);
       }
-      else {
-        fTransDiff1.assign(nClus, avegagetransversePos1);
-        fTransDiff2.assign(nClus, avegagetransversePos2);
+      double const first = std::floor(mean - fAnalyticDiffusionSigmas * sigma);
+      double const last = std::floor(mean + fAnalyticDiffusionSigmas * sigma);
+      fractions.resize(static_cast<size_t>(last - first) + 1U);
+      double lowerCDF = cdf((first - mean) / sigma);
+      double total = 0.;
+      for (size_t i = 0; i < fractions.size(); ++i) {
+        double const upperCDF = cdf((first + i + 1. - mean) / sigma);
+        fractions[i] = upperCDF - lowerCDF;
+        total += fractions[i];
+        lowerCDF = upperCDF;
       }
+      for (double& fraction : fractions)
+        fraction /= total;
+      return first;
+    };
+
+    auto const& tpcClock = context.clockData.TPCClock();
+    geo::TPCGeo const& tpcGeo = fGeometry->TPC(tpc, cryostat);
+    auto const& planeReadouts = fPlaneReadout[cryostat][tpc];
+    auto const mp = energyDeposit.MidPoint();
+    double const xyz[3] = {mp.X(), mp.Y(), mp.Z()};
+    double const energy = energyDeposit.Energy();
+    double const simTime = energyDeposit.Time();
+
+    // ticks are in electronics time [us], of which the drift time is a shift
+    double const tickSigma = LDiffSig * fRecipDriftVel[0] * 1.e-3 * tpcClock.Frequency();
+
+    ws.driftClusterPos[0] = center[0];
+    ws.driftClusterPos[1] = center[1];
+    ws.driftClusterPos[2] = center[2];
+    for (size_t p = 0; p < planeReadouts.size(); ++p) {
+      PlaneReadout const& readout = planeReadouts[p];
+      larsim::Utils::PlaneChannelLookup const& lookup = readout.channels;
+      ws.driftClusterPos[driftcoordinate] = tpcGeo.PlaneLocation(p)[driftcoordinate];
+
+      // the wire coordinate is a combination of the two transverse ones
+      double wireSlope2 = 0.;
+      for (int i = 0; i < 3; ++i)
+        if (i != driftcoordinate) wireSlope2 += std::pow(lookup.wireCoordinateSlope(i), 2);
+      double const wireSigma = TDiffSig * std::sqrt(wireSlope2);
+      // wire w collects the wire coordinates in [ w - 0.5, w + 0.5 )
+      double const firstWire =
+        binFractions(lookup.wireCoordinate(ws.driftClusterPos) + 0.5, wireSigma, ws.wireFraction);
+
+      double const time = TDrift + readout.timeOffset + simTime;
+      double const tick = context.clockData.G4ToElecTime(time) * tpcClock.Frequency();
+      double const firstTick = binFractions(tick, tickSigma, ws.tickFraction);
+
+      for (size_t iWire = 0; iWire < ws.wireFraction.size(); ++iWire) {
+        // charge off the plane is lost
+        raw::ChannelID_t const channel = lookup.channelAtWireCoordinate(firstWire + iWire);
+        if (!raw::isValidChannelID(channel) || !(ws.wireFraction[iWire] > 0.)) continue;
+
+        sim::SimChannel& channelData = simChannel(ws, cryostat, tpc, channel, edIndex);
+        for (size_t iTick = 0; iTick < ws.tickFraction.size(); ++iTick) {
+          double const fraction = ws.wireFraction[iWire] * ws.tickFraction[iTick];
+          if (fraction <= 0.) continue;
+          unsigned int const tdc = static_cast<int>(firstTick + iTick);
+          channelData.AddIonizationElectrons(
+            energyDeposit.TrackID(), tdc, nElectrons * fraction, xyz, energy * fraction);
+
+          if (fStoreDriftedElectronClusters)
+            ws.clusters.emplace_back(
+              nElectrons * fraction,
+              time,                                 // timing of the cloud centre
+              geo::Point_t{mp.X(), mp.Y(), mp.Z()}, // mean position of the deposited energy
+              geo::Point_t{ws.driftClusterPos[0],
+                           ws.driftClusterPos[1],
+                           ws.driftClusterPos[2]}, // centre of the cloud on the plane
+              geo::Point_t{LDiffSig, TDiffSig, TDiffSig},
+              energy * fraction,
+              energyDeposit.TrackID());
+
+          if (fStoreCompactClusters)
+            addCompactCluster(ws, channel, tdc, time, nElectrons * fraction, energy * fraction, mp);
+        }
+      }
+    }
+  }
+
+  //-------------------------------------------------
+  bool
+  SimDriftElectrons::cloudInSingleCell(EventContext const& context,
+                                       std::vector<PlaneReadout> const& planeReadouts,
+                                       geo::TPCGeo const& tpcGeo,
+                                       int driftcoordinate,
+                                       double const* center,
+                                       double time,
+                                       double LDiffSig,
+                                       double TDiffSig) const
+  {
+    auto const& tpcClock = context.clockData.TPCClock();
+    double const timeSpread = fAdaptiveClusterSigmas * LDiffSig * fRecipDriftVel[0];
+    double const transSpread = fAdaptiveClusterSigmas * TDiffSig;
+
+    double pos[3] = {center[0], center[1], center[2]};
+    for (size_t p = 0; p < planeReadouts.size(); ++p) {
+      larsim::Utils::PlaneChannelLookup const& lookup = planeReadouts[p].channels;
+      if (!lookup.isAffine()) return false;
+
+      // the cloud is a box, which on the plane spans this range of wire coordinates
+      pos[driftcoordinate] = tpcGeo.PlaneLocation(p)[driftcoordinate];
+      double const wireCoord = lookup.wireCoordinate(pos);
+      double wireSpread = 0.;
+      for (int i = 0; i < 3; ++i)
+        if (i != driftcoordinate) wireSpread += std::abs(lookup.wireCoordinateSlope(i));
+      wireSpread *= transSpread;
+      if (std::round(wireCoord - wireSpread) != std::round(wireCoord + wireSpread) ||
+          !raw::isValidChannelID(lookup.channelAtWireCoordinate(wireCoord)))
+        return false;
+
+      double const planeTime = time + planeReadouts[p].timeOffset;
+      if (tpcClock.Ticks(context.clockData.G4ToElecTime(planeTime - timeSpread)) !=
+          tpcClock.Ticks(context.clockData.G4ToElecTime(planeTime + timeSpread)))
+        return false;
+    }
+    return true;
+  }
 
-      // make a collection of electrons for each plane
-      for (size_t p = 0; p < tpcGeo.Nplanes(); ++p) {
+  //-------------------------------------------------
+  void
+  SimDriftElectrons::driftDeposit(EventContext const& context,
+                                  size_t edIndex,
+                                  sim::SimEnergyDeposit const& energyDeposit,
+                                  unsigned int cryostat,
+                                  unsigned int tpc,
+                                  CLHEP::RandGauss& gauss,
+                                  DriftWorkspace& ws)
+  {
+    ws.depositChannels = 0;
+    auto const& tpcClock = context.clockData.TPCClock();
+
+    // "xyz" is the position of the energy deposit in world
+    // coordinates. Note that the units of distance in
+    // sim::SimEnergyDeposit are supposed to be cm.
+    auto const mp = energyDeposit.MidPoint();
+    double const xyz[3] = {mp.X(), mp.Y(), mp.Z()};
+
+    const geo::TPCGeo& tpcGeo = fGeometry->TPC(tpc, cryostat);
+
+    // Define charge drift direction: driftcoordinate (x, y or z) and
+    // driftsign (positive or negative). Also define coordinates perpendicular
+    // to drift direction.
+    larsim::Utils::ElectronClusterDrift::Axes axes;
+    if (!fClusterDrift.driftAxes(tpcGeo, axes)) return;
+    int const driftcoordinate = axes.drift;
+    int const transversecoordinate1 = axes.trans1;
+    int const transversecoordinate2 = axes.trans2;
+
+    // Check for charge deposits behind charge readout planes
+    if (fClusterDrift.behindPlanes(tpcGeo, axes, xyz)) return;
+
+    // Space-charge effect (SCE): Get SCE {x,y,z} offsets for
+    // particular location in TPC
+    double posOffsetxyz[3] = {0.0, 0.0, 0.0};
+    auto const* SCE = context.SCE;
+    if (SCE->EnableSimSpatialSCE() == true) {
+      geo::Vector_t const posOffsets =
+        context.SCEOffsets ? (*context.SCEOffsets)[edIndex - context.SCEOffsetsBegin] :
+                             SCE->GetPosOffsets(mp);
+      if (larsim::Utils::SCE::out_of_bounds(posOffsets)) { return; }
+      posOffsetxyz[0] = posOffsets.X();
+      posOffsetxyz[1] = posOffsets.Y();
+      posOffsetxyz[2] = posOffsets.Z();
+    }
 
-        fDriftClusterPos[driftcoordinate] = tpcGeo.PlaneLocation(p)[driftcoordinate];
+    double const avegagetransversePos1 =
+      xyz[transversecoordinate1] + posOffsetxyz[transversecoordinate1];
+    double const avegagetransversePos2 =
+      xyz[transversecoordinate2] + posOffsetxyz[transversecoordinate2];
+
+    // Drift time in ns
+    double const TDrift = fClusterDrift.driftTime(tpcGeo, axes, xyz, posOffsetxyz);
+
+    const int nIonizedElectrons = fISAlg.CalcIonAndScint(context.detProp, energyDeposit).numElectrons;
+    const double lifetimecorrection = fDriftPhysics.attenuation(TDrift);
+    const double energy = energyDeposit.Energy();
+
+    // if we have no electrons (too small energy or too large recombination)
+    // we are done already here
+    if (nIonizedElectrons <= 0) {
+      MF_LOG_DEBUG("SimDriftElectrons")
+        << "step " // << energyDeposit << "\n"
+        << "No electrons drifted to readout, " << energy << " MeV lost.";
+      return;
+    }
 
-        // Drift nClus electron clusters to the induction plane
-        for (int k = 0; k < nClus; ++k) {
+    // includes the effect of lifetime: lifetimecorrection = exp[-tdrift/tau]
+    const double nElectrons = nIonizedElectrons * lifetimecorrection;
+
+    // Longitudinal & transverse diffusion sigma (cm)
+    double LDiffSig = fDriftPhysics.longitudinalSigma(TDrift);
+    double TDiffSig = fDriftPhysics.transverseSigma(TDrift);
+
+    auto const& planeReadouts = fPlaneReadout[cryostat][tpc];
+
+    // a cloud landing on a single channel and tick is drifted as a whole
+    double cloudCenter[3] = {0., 0., 0.};
+    cloudCenter[transversecoordinate1] = avegagetransversePos1;
+    cloudCenter[transversecoordinate2] = avegagetransversePos2;
+    bool const singleCell = fAdaptiveClusters &&
+                            cloudInSingleCell(context, planeReadouts, tpcGeo, driftcoordinate,
+                                              cloudCenter, TDrift + energyDeposit.Time(),
+                                              LDiffSig, TDiffSig);
+
+    // the whole cloud is integrated, if the wire coordinates allow it
+    if (fAnalyticDiffusion &&
+        std::all_of(planeReadouts.begin(), planeReadouts.end(), [](PlaneReadout const& readout) {
+          return readout.channels.isAffine();
+        })) {
+      driftCloud(context, edIndex, energyDeposit, cryostat, tpc, driftcoordinate, cloudCenter,
+                 TDrift, LDiffSig, TDiffSig, nElectrons, ws);
+      if (fStoreCompactClusters) recordCompactDeposit(ws, edIndex, energyDeposit, LDiffSig, TDiffSig);
+      return;
+    }
 
-          // Correct drift time for longitudinal diffusion and plane
-          double TDiff = TDrift + fLongDiff[k] * fRecipDriftVel[0];
+    // Split in electron clusters, and smear them by the diffusion
+    larsim::Utils::ElectronClusters& eClusters = ws.electronClusters;
+    int const nClus = fClusterDrift.split(nElectrons, energy, eClusters, singleCell);
+    fClusterDrift.diffuse(gauss,
+                          singleCell ? 0.0 : LDiffSig,
+                          singleCell ? 0.0 : TDiffSig,
+                          avegagetransversePos1,
+                          avegagetransversePos2,
+                          eClusters);
+
+    // Correct drift time for longitudinal diffusion
+    ws.clusterTime.resize(nClus);
+    for (int k = 0; k < nClus; ++k)
+      ws.clusterTime[k] = TDrift + eClusters.longDiff[k] * fRecipDriftVel[0];
+
+    if (fStoreCompactClusters) ws.compactClusterIndex.clear();
+
+    unsigned int nLostClusters = 0;
+
+    // make a collection of electrons for each plane
+    for (size_t p = 0; p < tpcGeo.Nplanes(); ++p) {
+
+      PlaneReadout const& readout = planeReadouts[p];
+      ws.driftClusterPos[driftcoordinate] = tpcGeo.PlaneLocation(p)[driftcoordinate];
+
+      // find the nearest channel of all the clusters at once
+      larsim::Utils::PlaneChannelLookup const& lookup = readout.channels;
+      if (lookup.isAffine()) {
+        double const coord0 = lookup.wireCoordinateOrigin() +
+          lookup.wireCoordinateSlope(driftcoordinate) * ws.driftClusterPos[driftcoordinate];
+        double const slope1 = lookup.wireCoordinateSlope(transversecoordinate1);
+        double const slope2 = lookup.wireCoordinateSlope(transversecoordinate2);
+        double const* trans1 = eClusters.trans1.data();
+        double const* trans2 = eClusters.trans2.data();
+        ws.clusterWireCoord.resize(nClus);
+        double* wireCoord = ws.clusterWireCoord.data();
+        for (int k = 0; k < nClus; ++k)
+          wireCoord[k] = coord0 + slope1 * trans1[k] + slope2 * trans2[k];
+
+        ws.clusterChannel.resize(nClus);
+        for (int k = 0; k < nClus; ++k)
+          ws.clusterChannel[k] = lookup.channelAtWireCoordinate(wireCoord[k]);
+      }
 
-          // Take into account different Efields between planes
-          // Also take into account special case for ArgoNeuT (Nplanes = 2 and
-          // drift direction = x): plane 0 is the second wire plane
-          for (size_t ip = 0; ip < p; ++ip) {
-            TDiff +=  
-				tpcGeo.PlanePitch(ip+1, ip) *
-              	fRecipDriftVel[(tpcGeo.Nplanes() == 2 && driftcoordinate == 0) ? ip + 2 : ip + 1];
-          }
+      // Drift nClus electron clusters to the induction plane
+      for (int k = 0; k < nClus; ++k) {
 
-          fDriftClusterPos[transversecoordinate1] = fTransDiff1[k];
-          fDriftClusterPos[transversecoordinate2] = fTransDiff2[k];
-
-          /// \todo think about effects of drift between planes
-
-          // grab the nearest channel to the fDriftClusterPos position
-          try {
-            raw::ChannelID_t channel =
-              fGeometry->NearestChannel(fDriftClusterPos, p, tpc, cryostat);
-
-            /// \todo check on what happens if we allow the tdc value to be
-            /// \todo beyond the end of the expected number of ticks
-            // Add potential decay/capture/etc delay effect, simTime.
-            auto const simTime = energyDeposit.Time();
-            unsigned int tdc = tpcClock.Ticks(clockData.G4ToElecTime(TDiff + simTime));
-
-            // Find whether we already have this channel in our map.
-            ChannelMap_t& channelDataMap = fChannelMaps[cryostat][tpc];
-            auto search = channelDataMap.find(channel);
-
-            // We will find (or create) the pointer to a
-            // sim::SimChannel.
-            size_t channelIndex = 0;
-
-            // Have we created the sim::SimChannel corresponding to
-            // channel ID?
-            if (search == channelDataMap.end()) {
-              // We haven't. Initialize the bookkeeping information
-              // for this channel.
-              ChannelBookKeeping bookKeeping;
-
-              // Add a new channel to the end of the list we'll
-              // write out after we've processed this event.
-              bookKeeping.channelIndex = channels->size();
-              channels->emplace_back(channel);
-              channelIndex = bookKeeping.channelIndex;
-
-              // Initialize a vector with the index of the step that
-              // created this channel.
-              bookKeeping.stepList.push_back(edIndex);
-
-              // Save the bookkeeping information for this channel.
-              channelDataMap[channel] = bookKeeping;
-            }
-            else {
-              // We've created this SimChannel for a previous energy
-              // deposit. Get its address.
-
-              auto& bookKeeping = search->second;
-              channelIndex = bookKeeping.channelIndex;
-
-              // Has this step contributed to this channel before?
-              auto& stepList = bookKeeping.stepList;
-              auto stepSearch = std::find(stepList.begin(), stepList.end(), edIndex);
-              if (stepSearch == stepList.end()) {
-                // No, so add this step's index to the list.
-                stepList.push_back(edIndex);
-              }
-            }
-
-            sim::SimChannel* channelPtr = &(channels->at(channelIndex));
-
-            // Add the electron clusters and energy to the
-            // sim::SimChannel
-            channelPtr->AddIonizationElectrons(
-              energyDeposit.TrackID(), tdc, fnElDiff[k], xyz, fnEnDiff[k]);
-
-            if (fStoreDriftedElectronClusters)
-              SimDriftedElectronClusterCollection->emplace_back(
-                fnElDiff[k],
-                TDiff + simTime,                      // timing
-                geo::Point_t{mp.X(), mp.Y(), mp.Z()}, // mean position of the deposited energy
-                geo::Point_t{fDriftClusterPos[0],
-                             fDriftClusterPos[1],
-                             fDriftClusterPos[2]}, // final position of the drifted cluster
-                geo::Point_t{
-                  LDiffSig, TDiffSig, TDiffSig}, // Longitudinal (X) and transverse (Y,Z) diffusion
-                fnEnDiff[k],                     // deposited energy that originated this cluster
-                energyDeposit.TrackID());
-          }
-          catch (cet::exception& e) {
-            mf::LogDebug("SimDriftElectrons")
-              << "unable to drift electrons from point (" << xyz[0] << "," << xyz[1] << ","
-              << xyz[2] << ") with exception " << e;
-          } // end try to determine channel
-        }   // end loop over clusters
-      }     // end loop over planes
-    }       // for each sim::SimEnergyDeposit
+        // Correct drift time for the plane
+        double const TDiff = ws.clusterTime[k] + readout.timeOffset;
 
-    // Write the sim::SimChannel collection.
-    event.put(std::move(channels));
-    if (fStoreDriftedElectronClusters) event.put(std::move(SimDriftedElectronClusterCollection));
+        ws.driftClusterPos[transversecoordinate1] = eClusters.trans1[k];
+        ws.driftClusterPos[transversecoordinate2] = eClusters.trans2[k];
+
+        /// \todo think about effects of drift between planes
+
+        // grab the nearest channel to the ws.driftClusterPos position;
+        // clusters landing off the plane are lost
+        raw::ChannelID_t const channel = lookup.isAffine() ?
+          ws.clusterChannel[k] : lookup.nearestChannel(ws.driftClusterPos);
+        if (!raw::isValidChannelID(channel)) {
+          ++nLostClusters;
+          continue;
+        }
+
+        /// \todo check on what happens if we allow the tdc value to be
+        /// \todo beyond the end of the expected number of ticks
+        // Add potential decay/capture/etc delay effect, simTime.
+        auto const simTime = energyDeposit.Time();
+        unsigned int tdc = tpcClock.Ticks(context.clockData.G4ToElecTime(TDiff + simTime));
+
+        // Add the electron clusters and energy to the
+        // sim::SimChannel
+        simChannel(ws, cryostat, tpc, channel, edIndex).AddIonizationElectrons(
+          energyDeposit.TrackID(), tdc, eClusters.nElectrons[k], xyz, eClusters.energy[k]);
+
+        if (fStoreDriftedElectronClusters)
+          ws.clusters.emplace_back(
+            eClusters.nElectrons[k],
+            TDiff + simTime,                      // timing
+            geo::Point_t{mp.X(), mp.Y(), mp.Z()}, // mean position of the deposited energy
+            geo::Point_t{ws.driftClusterPos[0],
+                         ws.driftClusterPos[1],
+                         ws.driftClusterPos[2]}, // final position of the drifted cluster
+            geo::Point_t{
+              LDiffSig, TDiffSig, TDiffSig}, // Longitudinal (X) and transverse (Y,Z) diffusion
+            eClusters.energy[k],                     // deposited energy that originated this cluster
+            energyDeposit.TrackID());
+
+        if (fStoreCompactClusters)
+          addCompactCluster(ws, channel, tdc, TDiff + simTime, eClusters.nElectrons[k], eClusters.energy[k], mp);
+      }   // end loop over clusters
+    }     // end loop over planes
+
+    if (nLostClusters > 0) {
+      mf::LogDebug("SimDriftElectrons")
+        << nLostClusters << " electron clusters from point (" << xyz[0] << "," << xyz[1] << ","
+        << xyz[2] << ") drifted outside the wire planes";
+    }
+
+    if (fStoreCompactClusters) recordCompactDeposit(ws, edIndex, energyDeposit, LDiffSig, TDiffSig);
   }
 
 } // namespace detsim
@@ -0,0 +1,3 @@
+#include "canvas/Persistency/Common/Wrapper.h"
+
+#include "larsim/ElectronDrift/CompactDriftedElectronClusters.h"
@@ -26,8 +26,15 @@
 #include "nusimdata/SimulationBase/MCParticle.h"
 #include "larcore/Geometry/Geometry.h"
 #include "larcoreobj/SummaryData/RunData.h"
+#include "larsim/EventGenerator/InTimeParticleSelector.h"
 
 #include <sqlite3.h>
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <vector>
 #include "CLHEP/Random/RandFlat.h"
 #include "CLHEP/Random/RandPoissonQ.h"
 #include "ifdh.h"  //to handle flux files
@@ -201,6 +208,18 @@ namespace evgen {
    *     *shifts* to lower _x_, higher _x_, lower _y_, higher _y_, lower _z_
    *     and higher _z_, in that order [cm] (note that to extend e.g. the
    *     negative _x_ side by 5 meters the parameter value should be -500)
+   * * `ShowerLibraryInMemory` (flag; default: `false`): if set, the particle
+   *     table of each shower input is read once at construction into memory,
+   *     indexed by shower, and showers are drawn from there instead of
+   *     querying the database on each event; the selection of the showers
+   *     differs from the one of the database query (which orders the showers
+   *     by a pseudo-random key), but it is also uniform and without
+   *     repetitions within each group of at most `nshow` showers; the memory
+   *     cost is about 70 bytes per particle in the tables
+   * * `InTimeSelection` (table; default: none): if present, only the
+   *     particles reaching a cryostat within its `MinT`/`MaxT` time window
+   *     [ns] are stored, with the same selection as `FilterGenInTime` (see
+   *     `evgen::InTimeParticleSelector`)
    * * `SeedGenerator` (integer): force random number generator for event
    *     generation to the specified value
    * * `SeedPoisson` (integer): force random number generator for number of
@@ -230,7 +249,11 @@ namespace evgen {
     void openDBs(std::string const& module_label);
     void populateNShowers();
     void populateTOffset();
-    void GetSample(simb::MCTruth&);
+    void loadShowerLibraries();
+    /// Adds to `mctruth` the sampled particles crossing any (buffered) cryostat.
+    void GetSample(simb::MCTruth& mctruth);
+    /// Returns whether the line from `x0` along `dx` crosses a buffered cryostat.
+    bool IntersectsCryostats(const double x0[], const double dx[]) const;
     double wrapvar( const double var, const double low, const double high);
     double wrapvarBoxNo( const double var, const double low, const double high, int& boxno);
     /**
@@ -262,6 +285,20 @@ namespace evgen {
                                         const double zhi,
                                         double xyzout[]);
 
+    /// Particle table of one shower input, in memory and grouped by shower.
+    struct ShowerLibrary {
+      /// Database columns of the particles, with the same meaning and units.
+      std::vector<int> pdg;
+      std::vector<double> px, py, pz, x, z, t, e;
+      /// Particles of shower `i` start at `firstParticle[i]` and end at
+      /// `firstParticle[i + 1]`.
+      std::vector<std::size_t> firstParticle;
+      /// Scratch permutation of the showers, for sampling without repetition.
+      std::vector<std::size_t> order;
+
+      std::size_t nShowers() const { return order.size(); }
+    };
+
     int fShowerInputs=0; ///< Number of shower inputs to process from
     std::vector<double> fNShowersPerEvent; ///< Number of showers to put in each event of duration fSampleTime; one per showerinput
     std::vector<int> fMaxShowers; //< Max number of showers to query, one per showerinput
@@ -280,6 +317,10 @@ namespace evgen {
     double fShowerAreaExtension=0.; ///< Extend distribution of corsika particles in x,z by this much (e.g. 1000 will extend 10 m in -x, +x, -z, and +z) [cm]
     sqlite3* fdb[5]; ///< Pointers to sqlite3 database object, max of 5
     double fRandomXZShift=0.; ///< Each shower will be shifted by a random amount in xz so that showers won't repeatedly sample the same space [cm]
+    bool fShowerLibraryInMemory=false; ///< Whether to sample showers from tables in memory
+    std::vector<ShowerLibrary> fShowerLibraries; ///< In-memory particle tables, one per showerinput
+    std::vector<std::array<double, 6>> fCryoBounds; ///< Cryostat boundaries including fBuffBox
+    std::optional<InTimeParticleSelector> fInTimeSelector; ///< Selection of the particles in time (if any)
     CLHEP::HepRandomEngine& fGenEngine;
     CLHEP::HepRandomEngine& fPoisEngine;
   };
@@ -298,6 +339,7 @@ namespace evgen{
       fBuffBox(p.get< std::vector< double > >("BufferBox",{0.0, 0.0, 0.0, 0.0, 0.0, 0.0})),
       fShowerAreaExtension(p.get< double >("ShowerAreaExtension",0.)),
       fRandomXZShift(p.get< double >("RandomXZShift",0.)),
+      fShowerLibraryInMemory(p.get< bool >("ShowerLibraryInMemory",false)),
       fGenEngine(art::ServiceHandle<rndm::NuRandomService>{}->createEngine(*this, "HepJamesRandom", "gen", p, { "Seed", "SeedGenerator"})),
       fPoisEngine(art::ServiceHandle<rndm::NuRandomService>{}->createEngine(*this, "HepJamesRandom", "pois", p, "SeedPoisson"))
   {
@@ -315,6 +357,19 @@ namespace evgen{
     this->openDBs(p.get<std::string>("module_label"));
     this->populateNShowers();
     this->populateTOffset();
+    if (fShowerLibraryInMemory) this->loadShowerLibraries();
+    fInTimeSelector = makeInTimeParticleSelector(p, *art::ServiceHandle<geo::Geometry const>());
+
+    //add a buffer box around the cryostat bounds to increase the acceptance and account for scattering
+    //By default, the buffer box has zero size
+    art::ServiceHandle<geo::Geometry const> geom;
+    for(unsigned int c = 0; c < geom->Ncryostats(); ++c){
+      std::array<double, 6> bounds;
+      geom->CryostatBoundaries(bounds.data(), c);
+      for (unsigned int cb=0; cb<6; cb++)
+         bounds[cb] = bounds[cb]+fBuffBox[cb];
+      fCryoBounds.push_back(bounds);
+    }
 
     produces< std::vector<simb::MCTruth> >();
     produces< sumdata::RunData, art::InRun >();
@@ -558,6 +613,85 @@ namespace evgen{
     }
   }
 
+  void CORSIKAGen::loadShowerLibraries(){
+    //read the whole particles table of each db once, then group it by shower
+    //with a stable counting sort, keeping the order of the table within each shower
+    const std::string kIdStatement("select id from showers");
+    const std::string kStatement("select shower,pdg,px,py,pz,x,z,t,e from particles");
+
+    fShowerLibraries.resize(fShowerInputs);
+    for(int i=0; i<fShowerInputs; i++){
+      ShowerLibrary& library = fShowerLibraries[i];
+      sqlite3_stmt *statement;
+      int res=0;
+
+      std::vector<int> ids;
+      if ( sqlite3_prepare_v2(fdb[i], kIdStatement.c_str(), -1, &statement, 0 ) != SQLITE_OK )
+        throw cet::exception("CORSIKAGen") << "Error preparing statement: (" <<kIdStatement<<"); "<<"ERROR:"<<sqlite3_errmsg(fdb[i])<<"\n";
+      while ( (res = sqlite3_step(statement)) == SQLITE_ROW ) ids.push_back(sqlite3_column_int(statement,0));
+      sqlite3_finalize(statement);
+      if ( res != SQLITE_DONE )
+        throw cet::exception("CORSIKAGen") << "Unexpected sqlite3_step return value: (" <<res<<"); "<<"ERROR:"<<sqlite3_errmsg(fdb[i])<<"\n";
+      std::sort(ids.begin(), ids.end());
+      ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+      //particles of showers not in the showers table are never selected by the query
+      std::vector<std::size_t> showerOf; //index in ids of the shower of each particle
+      ShowerLibrary rows;
+      if ( sqlite3_prepare_v2(fdb[i], kStatement.c_str(), -1, &statement, 0 ) != SQLITE_OK )
+        throw cet::exception("CORSIKAGen") << "Error preparing statement: (" <<kStatement<<"); "<<"ERROR:"<<sqlite3_errmsg(fdb[i])<<"\n";
+      while ( (res = sqlite3_step(statement)) == SQLITE_ROW ){
+        int const shower = sqlite3_column_int(statement,0);
+        auto const iShower = std::lower_bound(ids.begin(), ids.end(), shower);
+        if ( iShower == ids.end() || *iShower != shower ) continue;
+        showerOf.push_back(iShower - ids.begin());
+        rows.pdg.push_back(sqlite3_column_int(statement,1));
+        rows.px.push_back(sqlite3_column_double(statement,2));
+        rows.py.push_back(sqlite3_column_double(statement,3));
+        rows.pz.push_back(sqlite3_column_double(statement,4));
+        rows.x.push_back(sqlite3_column_double(statement,5));
+        rows.z.push_back(sqlite3_column_double(statement,6));
+        rows.t.push_back(sqlite3_column_double(statement,7));
+        rows.e.push_back(sqlite3_column_double(statement,8));
+      }
+      sqlite3_finalize(statement);
+      if ( res != SQLITE_DONE )
+        throw cet::exception("CORSIKAGen") << "Unexpected sqlite3_step return value: (" <<res<<"); "<<"ERROR:"<<sqlite3_errmsg(fdb[i])<<"\n";
+
+      std::size_t const nParticles = showerOf.size();
+      library.firstParticle.assign(ids.size() + 1, 0);
+      for (std::size_t const iShower: showerOf) ++library.firstParticle[iShower + 1];
+      for (std::size_t iShower = 0; iShower < ids.size(); ++iShower)
+        library.firstParticle[iShower + 1] += library.firstParticle[iShower];
+
+      library.pdg.resize(nParticles);
+      library.px.resize(nParticles);
+      library.py.resize(nParticles);
+      library.pz.resize(nParticles);
+      library.x.resize(nParticles);
+      library.z.resize(nParticles);
+      library.t.resize(nParticles);
+      library.e.resize(nParticles);
+      std::vector<std::size_t> next(library.firstParticle.begin(), library.firstParticle.end() - 1);
+      for (std::size_t iRow = 0; iRow < nParticles; ++iRow){
+        std::size_t const dest = next[showerOf[iRow]]++;
+        library.pdg[dest] = rows.pdg[iRow];
+        library.px[dest] = rows.px[iRow];
+        library.py[dest] = rows.py[iRow];
+        library.pz[dest] = rows.pz[iRow];
+        library.x[dest] = rows.x[iRow];
+        library.z[dest] = rows.z[iRow];
+        library.t[dest] = rows.t[iRow];
+        library.e[dest] = rows.e[iRow];
+      }
+
+      library.order.resize(ids.size());
+      std::iota(library.order.begin(), library.order.end(), 0);
+
+      mf::LogInfo("CORSIKAGen")<<"For showers input "<< i<<" loaded "<<ids.size()<<" showers with "<<nParticles<<" particles in memory\n";
+    }
+  }
+
   void CORSIKAGen::GetSample(simb::MCTruth& mctruth){
     //for each input, randomly pull fNShowersPerEvent[i] showers from the Particles table
     //and randomly place them in time (between -fSampleTime/2 and fSampleTime/2)
@@ -604,6 +738,76 @@ namespace evgen{
     int nShowerQry=0; //number of showers to query from db
     int shower,pdg;
     double px,py,pz,x,z,tParticleTime,etot,showerTime=0.,showerTimex=0.,showerTimez=0.,showerXOffset=0.,showerZOffset=0.,t;
+
+    //each new shower gets its own random time and position offsets
+    auto newShower = [&](){
+      showerTime=1e9*(flat()*fSampleTime); //converting from s to ns
+      showerTimex=1e9*(flat()*fSampleTime); //converting from s to ns
+      showerTimez=1e9*(flat()*fSampleTime); //converting from s to ns
+      //and a random offset in both z and x controlled by the fRandomXZShift parameter
+      showerXOffset=flat()*fRandomXZShift - (fRandomXZShift/2);
+      showerZOffset=flat()*fRandomXZShift - (fRandomXZShift/2);
+    };
+
+    //arguments are the database columns [1] to [8] (see below)
+    auto addParticle = [&](int dbPdg, double dbPx, double dbPy, double dbPz,
+                           double dbX, double dbZ, double dbT, double dbE){
+      pdg=dbPdg;
+
+      //Note: position/momentum in db have north=-x and west=+z, rotate so that +z is north and +x is west
+      //get momentum components
+      px=dbPz;//uboone x=Particlez
+      py=dbPy;
+      pz=-dbPx;//uboone z=-Particlex
+      etot=dbE;
+
+      //get/calculate position components
+      int boxnoX=0,boxnoZ=0;
+      x=wrapvarBoxNo(dbZ+showerXOffset,fShowerBounds[0],fShowerBounds[1],boxnoX);
+      z=wrapvarBoxNo(-dbX+showerZOffset,fShowerBounds[4],fShowerBounds[5],boxnoZ);
+      tParticleTime=dbT; //time offset, includes propagation time from top of atmosphere
+      //actual particle time is particle surface arrival time
+      //+ shower start time
+      //+ global offset (fcl parameter, in s)
+      //- propagation time through atmosphere
+      //+ boxNo{X,Z} time offset to make grid boxes have different shower times
+      t=tParticleTime+showerTime+(1e9*fToffset)-fToffset_corsika + showerTimex*boxnoX + showerTimez*boxnoZ;
+      //wrap surface arrival so that it's in the desired time window
+      t=wrapvar(t,(1e9*fToffset),1e9*(fToffset+fSampleTime));
+
+      //project back to wordvol/fProjectToHeight
+      /*
+       * This back propagation goes from a point on the upper surface of
+       * the cryostat back to the edge of the world, except that that
+       * world is cut short by `fProjectToHeight` (`y2`) ceiling.
+       * The projection will most often lie on that ceiling, but it may
+       * end up instead on one of the side edges of the world, or even
+       * outside it.
+       */
+      double xyzo[3];
+      double x0[3]={x,fShowerBounds[3],z};
+      double dx[3]={px,py,pz};
+      this->ProjectToBoxEdge(x0, dx, x1, x2, y1, y2, z1, z2, xyzo);
+
+      //only keep the particles going through a cryostat in the detector;
+      //the track ID still counts all the sampled particles
+      int const trackID = ntotalCtr++;
+      if (!IntersectsCryostats(xyzo, dx)) return;
+
+      //get mass for this particle
+      double m = 0.; // in GeV
+      TParticlePDG* pdgp = pdgt->GetParticle(pdg);
+      if (pdgp) m = pdgp->Mass();
+
+      TLorentzVector pos(xyzo[0],xyzo[1],xyzo[2],t);// time needs to be in ns to match GENIE, etc
+      TLorentzVector mom(px,py,pz,etot);
+      if (fInTimeSelector && !fInTimeSelector->keep(pos, mom, m)) return;
+
+      simb::MCParticle p(trackID,pdg,"primary",-200,m,1);
+      p.AddTrajectoryPoint(pos,mom);
+      mctruth.Add(p);
+    };
+
     for(int i=0; i<fShowerInputs; i++){
       nShowerCntr=randpois.fire(fNShowersPerEvent[i]);
       mf::LogInfo("CORSIKAGEN") << " Shower input " << i << " with mean " << fNShowersPerEvent[i] << " generating " << nShowerCntr;
@@ -615,6 +819,30 @@ namespace evgen{
         }else{
           nShowerQry=nShowerCntr; //take the rest that are needed
         }
+
+        if (fShowerLibraryInMemory){
+          //draw nShowerQry different showers with a partial Fisher-Yates shuffle
+          ShowerLibrary& library = fShowerLibraries[i];
+          std::size_t const nShowers = library.nShowers();
+          std::size_t const nDraw = std::min(std::size_t(nShowerQry), nShowers);
+          for(std::size_t iDraw=0; iDraw<nDraw; iDraw++){
+            std::size_t const iPick = std::min
+              (iDraw + static_cast<std::size_t>(flat()*(nShowers - iDraw)), nShowers - 1);
+            std::swap(library.order[iDraw], library.order[iPick]);
+            std::size_t const iShower = library.order[iDraw];
+            std::size_t const begin = library.firstParticle[iShower];
+            std::size_t const end = library.firstParticle[iShower + 1];
+            if (begin == end) continue; // no particles, like in the database query
+            newShower();
+            for(std::size_t iP=begin; iP<end; iP++){
+              addParticle(library.pdg[iP], library.px[iP], library.py[iP], library.pz[iP],
+                          library.x[iP], library.z[iP], library.t[iP], library.e[iP]);
+            }
+          }
+          nShowerCntr=nShowerCntr-nShowerQry;
+          continue;
+        }
+
         //build and do query to get nshowers
         double thisrnd=flat(); //need a new random number for each query
         TString kthisStatement=TString::Format(kStatement.Data(),thisrnd,nShowerQry,thisrnd);
@@ -638,63 +866,15 @@ namespace evgen{
                * [8] energy [GeV]
                */
               shower=sqlite3_column_int(statement,0);
-              if(shower!=lastShower){
-                //each new shower gets its own random time and position offsets
-                showerTime=1e9*(flat()*fSampleTime); //converting from s to ns
-                showerTimex=1e9*(flat()*fSampleTime); //converting from s to ns
-                showerTimez=1e9*(flat()*fSampleTime); //converting from s to ns
-                //and a random offset in both z and x controlled by the fRandomXZShift parameter
-                showerXOffset=flat()*fRandomXZShift - (fRandomXZShift/2);
-                showerZOffset=flat()*fRandomXZShift - (fRandomXZShift/2);
-              }
-              pdg=sqlite3_column_int(statement,1);
-              //get mass for this particle
-              double m = 0.; // in GeV
-              TParticlePDG* pdgp = pdgt->GetParticle(pdg);
-              if (pdgp) m = pdgp->Mass();
-
-              //Note: position/momentum in db have north=-x and west=+z, rotate so that +z is north and +x is west
-              //get momentum components
-              px=sqlite3_column_double(statement,4);//uboone x=Particlez
-              py=sqlite3_column_double(statement,3);
-              pz=-sqlite3_column_double(statement,2);//uboone z=-Particlex
-              etot=sqlite3_column_double(statement,8);
-
-              //get/calculate position components
-              int boxnoX=0,boxnoZ=0;
-              x=wrapvarBoxNo(sqlite3_column_double(statement,6)+showerXOffset,fShowerBounds[0],fShowerBounds[1],boxnoX);
-              z=wrapvarBoxNo(-sqlite3_column_double(statement,5)+showerZOffset,fShowerBounds[4],fShowerBounds[5],boxnoZ);
-              tParticleTime=sqlite3_column_double(statement,7); //time offset, includes propagation time from top of atmosphere
-              //actual particle time is particle surface arrival time
-              //+ shower start time
-              //+ global offset (fcl parameter, in s)
-              //- propagation time through atmosphere
-              //+ boxNo{X,Z} time offset to make grid boxes have different shower times
-              t=tParticleTime+showerTime+(1e9*fToffset)-fToffset_corsika + showerTimex*boxnoX + showerTimez*boxnoZ;
-              //wrap surface arrival so that it's in the desired time window
-              t=wrapvar(t,(1e9*fToffset),1e9*(fToffset+fSampleTime));
-
-              simb::MCParticle p(ntotalCtr,pdg,"primary",-200,m,1);
-
-              //project back to wordvol/fProjectToHeight
-              /*
-               * This back propagation goes from a point on the upper surface of
-               * the cryostat back to the edge of the world, except that that
-               * world is cut short by `fProjectToHeight` (`y2`) ceiling.
-               * The projection will most often lie on that ceiling, but it may
-               * end up instead on one of the side edges of the world, or even
-               * outside it.
-               */
-              double xyzo[3];
-              double x0[3]={x,fShowerBounds[3],z};
-              double dx[3]={px,py,pz};
-              this->ProjectToBoxEdge(x0, dx, x1, x2, y1, y2, z1, z2, xyzo);
-
-              TLorentzVector pos(xyzo[0],xyzo[1],xyzo[2],t);// time needs to be in ns to match GENIE, etc
-              TLorentzVector mom(px,py,pz,etot);
-              p.AddTrajectoryPoint(pos,mom);
-              mctruth.Add(p);
-              ntotalCtr++;
+              if(shower!=lastShower) newShower();
+              addParticle(sqlite3_column_int(statement,1),
+                          sqlite3_column_double(statement,2),
+                          sqlite3_column_double(statement,3),
+                          sqlite3_column_double(statement,4),
+                          sqlite3_column_double(statement,5),
+                          sqlite3_column_double(statement,6),
+                          sqlite3_column_double(statement,7),
+                          sqlite3_column_double(statement,8));
               lastShower=shower;
             }else if ( res == SQLITE_DONE ){
               break;
@@ -708,6 +888,7 @@ namespace evgen{
         nShowerCntr=nShowerCntr-nShowerQry;
       }
     }
+    mf::LogInfo("CORSIKAGen")<<"GetSample number of particles sampled: "<<ntotalCtr<<"\n";
   }
 
   void CORSIKAGen::beginRun(art::Run& run)
@@ -716,72 +897,44 @@ namespace evgen{
     run.put(std::make_unique<sumdata::RunData>(geo->DetectorName()));
   }
 
-  void CORSIKAGen::produce(art::Event& evt){
-    std::unique_ptr< std::vector<simb::MCTruth> > truthcol(new std::vector<simb::MCTruth>);
-
-    art::ServiceHandle<geo::Geometry const> geom;
-
-    simb::MCTruth truth;
-    truth.SetOrigin(simb::kCosmicRay);
-
-    simb::MCTruth pretruth;
-    GetSample(pretruth);
-    mf::LogInfo("CORSIKAGen")<<"GetSample number of particles returned: "<<pretruth.NParticles()<<"\n";
-    // loop over particles in the truth object
-    for(int i = 0; i < pretruth.NParticles(); ++i){
-      simb::MCParticle particle = pretruth.GetParticle(i);
-      const TLorentzVector& v4 = particle.Position();
-      const TLorentzVector& p4 = particle.Momentum();
-      double x0[3] = {v4.X(),  v4.Y(),  v4.Z() };
-      double dx[3] = {p4.Px(), p4.Py(), p4.Pz()};
-
-      // now check if the particle goes through any cryostat in the detector
-      // if so, add it to the truth object.
-      for(unsigned int c = 0; c < geom->Ncryostats(); ++c){
-        double bounds[6] = {0.};
-        geom->CryostatBoundaries(bounds, c);
-
-        //add a buffer box around the cryostat bounds to increase the acceptance and account for scattering
-        //By default, the buffer box has zero size
-        for (unsigned int cb=0; cb<6; cb++)
-           bounds[cb] = bounds[cb]+fBuffBox[cb];
-
-        //calculate the intersection point with each cryostat surface
-        bool intersects_cryo = false;
-        for (int bnd=0; bnd!=6; ++bnd) {
-          if (bnd<2) {
-            double p2[3] = {bounds[bnd],  x0[1] + (dx[1]/dx[0])*(bounds[bnd] - x0[0]), x0[2] + (dx[2]/dx[0])*(bounds[bnd] - x0[0])};
-            if ( p2[1] >= bounds[2] && p2[1] <= bounds[3] &&
-                 p2[2] >= bounds[4] && p2[2] <= bounds[5] ) {
-              intersects_cryo = true;
-              break;
-            }
+  bool CORSIKAGen::IntersectsCryostats(const double x0[], const double dx[]) const {
+    //calculate the intersection point with each cryostat surface
+    for(auto const& bounds: fCryoBounds){
+      for (int bnd=0; bnd!=6; ++bnd) {
+        if (bnd<2) {
+          double p2[3] = {bounds[bnd],  x0[1] + (dx[1]/dx[0])*(bounds[bnd] - x0[0]), x0[2] + (dx[2]/dx[0])*(bounds[bnd] - x0[0])};
+          if ( p2[1] >= bounds[2] && p2[1] <= bounds[3] &&
+               p2[2] >= bounds[4] && p2[2] <= bounds[5] ) {
+            return true;
           }
-          else if (bnd>=2 && bnd<4) {
-            double p2[3] = {x0[0] + (dx[0]/dx[1])*(bounds[bnd] - x0[1]), bounds[bnd], x0[2] + (dx[2]/dx[1])*(bounds[bnd] - x0[1])};
-            if ( p2[0] >= bounds[0] && p2[0] <= bounds[1] &&
-                 p2[2] >= bounds[4] && p2[2] <= bounds[5] ) {
-              intersects_cryo = true;
-        break;
-            }
+        }
+        else if (bnd>=2 && bnd<4) {
+          double p2[3] = {x0[0] + (dx[0]/dx[1])*(bounds[bnd] - x0[1]), bounds[bnd], x0[2] + (dx[2]/dx[1])*(bounds[bnd] - x0[1])};
+          if ( p2[0] >= bounds[0] && p2[0] <= bounds[1] &&
+               p2[2] >= bounds[4] && p2[2] <= bounds[5] ) {
+            return true;
           }
-          else if (bnd>=4) {
-            double p2[3] = {x0[0] + (dx[0]/dx[2])*(bounds[bnd] - x0[2]), x0[1] + (dx[1]/dx[2])*(bounds[bnd] - x0[2]), bounds[bnd]};
-            if ( p2[0] >= bounds[0] && p2[0] <= bounds[1] &&
-                 p2[1] >= bounds[2] && p2[1] <= bounds[3] ) {
-              intersects_cryo = true;
-        break;
-            }
+        }
+        else if (bnd>=4) {
+          double p2[3] = {x0[0] + (dx[0]/dx[2])*(bounds[bnd] - x0[2]), x0[1] + (dx[1]/dx[2])*(bounds[bnd] - x0[2]), bounds[bnd]};
+          if ( p2[0] >= bounds[0] && p2[0] <= bounds[1] &&
+               p2[1] >= bounds[2] && p2[1] <= bounds[3] ) {
+            return true;
           }
         }
+      }
+    }
+    return false;
+  }
 
-        if (intersects_cryo){
-          truth.Add(particle);
-          break; //leave loop over cryostats to avoid adding particle multiple times
-        }// end if particle goes into a cryostat
-      }// end loop over cryostats in the detector
+  void CORSIKAGen::produce(art::Event& evt){
+    std::unique_ptr< std::vector<simb::MCTruth> > truthcol(new std::vector<simb::MCTruth>);
+
+    simb::MCTruth truth;
+    truth.SetOrigin(simb::kCosmicRay);
 
-    }// loop on particles
+    //particles not crossing any cryostat + bounding box are dropped while sampling
+    GetSample(truth);
 
     mf::LogInfo("CORSIKAGen")<<"Number of particles from getsample crossing cryostat + bounding box: "<<truth.NParticles()<<"\n";
 
@@ -29,21 +29,81 @@
 #include "nutools/EventGeneratorBase/CRY/CRYHelper.h"
 #include "larcore/Geometry/Geometry.h"
 #include "larcoreobj/SummaryData/RunData.h"
+#include "larsim/EventGenerator/InTimeParticleSelector.h"
+
+// C/C++ standard libraries
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 
 namespace evgen {
 
-  /// A module to check the results from the Monte Carlo generator
+  /**
+   * @brief A module to check the results from the Monte Carlo generator
+   *
+   * Only the particles whose straight line crosses any of the cryostats,
+   * enlarged by `BufferBox`, are kept. By default, CRY samples are drawn
+   * until at least one particle is kept; with `RequireCryostatCrossing` set
+   * to `false`, a single sample is drawn per event, which may then be empty:
+   * this keeps the cosmic ray flux in the CRY time window unbiased.
+   * With an `InTimeSelection` table (`MinT`, `MaxT` [ns]), only the particles
+   * reaching a cryostat in that time window are kept, with the selection of
+   * `FilterGenInTime`.
+   *
+   * With `PrefetchSamples` larger than `0`, CRY samples are drawn on a
+   * background thread, and up to that many of them are kept ready, with the
+   * selection of their particles already decided: while the resampling
+   * needed to find a cryostat crossing happens between events, the events
+   * get the same particles as without prefetching, in the same order. The
+   * random engine of the module is then used ahead of the events, so its
+   * state can't be restored event by event.
+   */
   class CosmicsGen : public art::EDProducer {
   public:
     explicit CosmicsGen(fhicl::ParameterSet const& pset);
+    ~CosmicsGen() override;
 
   private:
 
+    /// A CRY sample, and which of its particles are selected.
+    struct Sample_t {
+      simb::MCTruth truth;
+      std::vector<char> kept;
+    };
+
     void produce(art::Event& evt) override;
     void beginJob() override;
     void beginRun(art::Run& run) override;
 
+    /// Returns whether the line through `pos` along `mom` crosses a buffered cryostat.
+    bool IntersectsCryostats(TLorentzVector const& pos, TLorentzVector const& mom) const;
+
+    /// Draws a new CRY sample and selects its particles.
+    Sample_t DrawSample();
+
+    /// Returns the next sample, from the prefetched ones if enabled.
+    Sample_t NextSample();
+
+    /// Keeps drawing samples until there are fPrefetchSamples ready (background thread).
+    void PrefetchSamples();
+
+    /// Stops the prefetching thread.
+    void StopPrefetching();
+
     std::vector<double> fbuffbox;
+    bool fRequireCryostatCrossing; ///< Resample until a particle crosses a cryostat.
+    unsigned int fPrefetchSamples; ///< Number of samples kept ready (0: no prefetching).
+    double fSurfaceY;              ///< Height of the detector surface [cm].
+    double fDetLength;             ///< Length of the detector [cm].
+    std::vector<std::array<double, 6>> fCryoBounds; ///< Cryostat boundaries including fbuffbox
+    std::optional<InTimeParticleSelector> fInTimeSelector; ///< Selection of the particles in time (if any)
 
     TH2F* fPhotonAngles;       ///< Photon rate vs angle
     TH2F* fPhotonAnglesLo;     ///< Photon rate vs angle, low momenta
@@ -82,6 +142,14 @@ namespace evgen {
                                ///< the sampled time window
     CLHEP::HepRandomEngine& fEngine; ///< art-managed random-number engine
     evgb::CRYHelper fCRYHelp; ///< CRY generator object
+
+    std::deque<Sample_t> fSamples; ///< Prefetched samples, oldest first.
+    std::mutex fSampleMutex; ///< Protects fSamples, fStopPrefetch and fPrefetchError.
+    std::condition_variable fSampleAdded;   ///< Signals a new prefetched sample.
+    std::condition_variable fSampleRemoved; ///< Signals room for a new sample.
+    bool fStopPrefetch = false;         ///< Asks the prefetching thread to stop.
+    std::exception_ptr fPrefetchError;  ///< Error from the prefetching thread.
+    std::thread fPrefetcher;            ///< The prefetching thread (if any).
   };
 }
 
@@ -91,6 +159,8 @@ namespace evgen{
   CosmicsGen::CosmicsGen(fhicl::ParameterSet const& pset)
     : art::EDProducer{pset}
     , fbuffbox{pset.get<std::vector<double>>("BufferBox",{0.0, 0.0, 0.0, 0.0, 0.0, 0.0})}
+    , fRequireCryostatCrossing{pset.get<bool>("RequireCryostatCrossing", true)}
+    , fPrefetchSamples{pset.get<unsigned int>("PrefetchSamples", 0U)}
     // create a default random engine; obtain the random seed from NuRandomService,
     // unless overridden in configuration with key "Seed"
     , fEngine(art::ServiceHandle<rndm::NuRandomService>()->createEngine(*this, pset, "Seed"))
@@ -100,6 +170,129 @@ namespace evgen{
   {
     produces< std::vector<simb::MCTruth> >();
     produces< sumdata::RunData, art::InRun >();
+
+    //add a buffer box around the cryostat bounds to increase the acceptance
+    //(geometrically) at the CRY level to make up for particles we will loose
+    //due to multiple scattering effects that pitch in during GEANT4 tracking
+    //By default, the buffer box has zero size
+    art::ServiceHandle<geo::Geometry const> geom;
+    fSurfaceY = geom->SurfaceY();
+    fDetLength = geom->DetLength();
+    for(unsigned int c = 0; c < geom->Ncryostats(); ++c){
+      std::array<double, 6> bounds;
+      geom->CryostatBoundaries(bounds.data(), c);
+      for (unsigned int cb=0; cb<6; cb++)
+        bounds[cb] = bounds[cb]+fbuffbox[cb];
+      fCryoBounds.push_back(bounds);
+    }
+
+    fInTimeSelector = makeInTimeParticleSelector(pset, *geom);
+  }
+
+  //____________________________________________________________________________
+  CosmicsGen::~CosmicsGen()
+  {
+    StopPrefetching();
+  }
+
+  //____________________________________________________________________________
+  void CosmicsGen::StopPrefetching()
+  {
+    if (!fPrefetcher.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock{fSampleMutex};
+      fStopPrefetch = true;
+    }
+    fSampleRemoved.notify_all();
+    fPrefetcher.join();
+  }
+
+  //____________________________________________________________________________
+  auto CosmicsGen::DrawSample() -> Sample_t
+  {
+    Sample_t sample;
+    fCRYHelp.Sample(sample.truth, fSurfaceY, fDetLength, 0);
+
+    sample.kept.resize(sample.truth.NParticles());
+    for (int i = 0; i < sample.truth.NParticles(); ++i) {
+      simb::MCParticle const& particle = sample.truth.GetParticle(i);
+      sample.kept[i] = IntersectsCryostats(particle.Position(), particle.Momentum())
+                       && (!fInTimeSelector || fInTimeSelector->keep(particle));
+    }
+    return sample;
+  }
+
+  //____________________________________________________________________________
+  void CosmicsGen::PrefetchSamples()
+  {
+    try {
+      while (true) {
+        {
+          std::unique_lock<std::mutex> lock{fSampleMutex};
+          fSampleRemoved.wait(lock, [this]{ return fStopPrefetch || (fSamples.size() < fPrefetchSamples); });
+          if (fStopPrefetch) return;
+        }
+        // only this thread uses CRY and its engine while prefetching
+        Sample_t sample = DrawSample();
+        {
+          std::lock_guard<std::mutex> lock{fSampleMutex};
+          fSamples.push_back(std::move(sample));
+        }
+        fSampleAdded.notify_one();
+      }
+    }
+    catch (...) {
+      {
+        std::lock_guard<std::mutex> lock{fSampleMutex};
+        fPrefetchError = std::current_exception();
+      }
+      fSampleAdded.notify_one();
+    }
+  }
+
+  //____________________________________________________________________________
+  auto CosmicsGen::NextSample() -> Sample_t
+  {
+    if (!fPrefetcher.joinable()) return DrawSample();
+
+    std::unique_lock<std::mutex> lock{fSampleMutex};
+    fSampleAdded.wait(lock, [this]{ return !fSamples.empty() || fPrefetchError; });
+    // the samples drawn before the error are still used, in order
+    if (fSamples.empty()) std::rethrow_exception(fPrefetchError);
+    Sample_t sample = std::move(fSamples.front());
+    fSamples.pop_front();
+    lock.unlock();
+    fSampleRemoved.notify_one();
+    return sample;
+  }
+
+  //____________________________________________________________________________
+  bool CosmicsGen::IntersectsCryostats
+    (TLorentzVector const& pos, TLorentzVector const& mom) const
+  {
+    // slab test: the line crosses the box if the ranges of its parameter
+    // within the three pairs of planes of the box overlap
+    double const x0[3] = {pos.X(),  pos.Y(),  pos.Z() };
+    double const dx[3] = {mom.Px(), mom.Py(), mom.Pz()};
+    for (auto const& bounds: fCryoBounds) {
+      double tmin = -std::numeric_limits<double>::infinity();
+      double tmax = std::numeric_limits<double>::infinity();
+      for (int axis = 0; axis < 3; ++axis) {
+        double const lo = bounds[2*axis], hi = bounds[2*axis + 1];
+        if (dx[axis] == 0.0) {
+          if (x0[axis] < lo || x0[axis] > hi) { tmin = tmax + 1.0; break; }
+          continue;
+        }
+        double t1 = (lo - x0[axis])/dx[axis];
+        double t2 = (hi - x0[axis])/dx[axis];
+        if (t1 > t2) std::swap(t1, t2);
+        tmin = std::max(tmin, t1);
+        tmax = std::min(tmax, t2);
+        if (tmin > tmax) break;
+      }
+      if (tmin <= tmax) return true;
+    }
+    return false;
   }
 
   //____________________________________________________________________________
@@ -136,6 +329,9 @@ namespace evgen{
     fMuonsPerSample = tfs->make<TH1F>("fMuonsPerSample",  ";Number Muons;Samples", 100, 0, 1000);
     fMuonsInCStat   = tfs->make<TH1F>("fMuonsInCryostat", ";Number Muons;Samples", 100, 0, 1000);
     fMuonsInTPC     = tfs->make<TH1F>("fMuonsInTPC",      ";Number Muons;Samples", 100, 0, 1000);
+
+    if (fPrefetchSamples > 0)
+      fPrefetcher = std::thread{[this]{ PrefetchSamples(); }};
   }
 
   //____________________________________________________________________________
@@ -150,21 +346,13 @@ namespace evgen{
   {
     std::unique_ptr< std::vector<simb::MCTruth> > truthcol(new std::vector<simb::MCTruth>);
 
-    // fill some histograms about this event
-    art::ServiceHandle<geo::Geometry const> geom;
-
-    int nCrossCryostat = 0;
-
     simb::MCTruth truth;
 
-    while(nCrossCryostat < 1){
+    do {
 
-      simb::MCTruth pretruth;
+      Sample_t const sample = NextSample();
+      simb::MCTruth const& pretruth = sample.truth;
       truth.SetOrigin(simb::kCosmicRay);
-      fCRYHelp.Sample(pretruth,
-		       geom->SurfaceY(),
-		       geom->DetLength(),
-		       0);
 
       int numPhotons   = 0;
       int numElectrons = 0;
@@ -175,11 +363,8 @@ namespace evgen{
 
       // loop over particles in the truth object
       for(int i = 0; i < pretruth.NParticles(); ++i){
-	simb::MCParticle particle = pretruth.GetParticle(i);
-	const TLorentzVector& v4 = particle.Position();
+	simb::MCParticle const& particle = pretruth.GetParticle(i);
 	const TLorentzVector& p4 = particle.Momentum();
-	double x0[3] = {v4.X(),  v4.Y(),  v4.Z() };
-	double dx[3] = {p4.Px(), p4.Py(), p4.Pz()};
 
 	if      (std::abs(particle.PdgCode())==13) ++allMuons;
 	else if (std::abs(particle.PdgCode())==22) ++allPhotons;
@@ -218,89 +403,43 @@ namespace evgen{
 
 	// now check if the particle goes through any cryostat in the detector
 	// if so, add it to the truth object.
-	for(unsigned int c = 0; c < geom->Ncryostats(); ++c){
-
-	  double bounds[6] = {0.};
-	  geom->CryostatBoundaries(bounds, c);
-
-	  //add a buffer box around the cryostat bounds to increase the acceptance
-	  //(geometrically) at the CRY level to make up for particles we will loose
-	  //due to multiple scattering effects that pitch in during GEANT4 tracking
-	  //By default, the buffer box has zero size
-	  for (unsigned int cb=0; cb<6; cb++)
-	     bounds[cb] = bounds[cb]+fbuffbox[cb];
-
-	  //calculate the intersection point with each cryostat surface
-	  bool intersects_cryo = false;
-	  for (int bnd=0; bnd!=6; ++bnd) {
-	    if (bnd<2) {
-	      double p2[3] = {bounds[bnd],  x0[1] + (dx[1]/dx[0])*(bounds[bnd] - x0[0]), x0[2] + (dx[2]/dx[0])*(bounds[bnd] - x0[0])};
-	      if ( p2[1] >= bounds[2] && p2[1] <= bounds[3] &&
-	           p2[2] >= bounds[4] && p2[2] <= bounds[5] ) {
-	        intersects_cryo = true;
-		break;
-	      }
-	    }
-	    else if (bnd>=2 && bnd<4) {
-	      double p2[3] = {x0[0] + (dx[0]/dx[1])*(bounds[bnd] - x0[1]), bounds[bnd], x0[2] + (dx[2]/dx[1])*(bounds[bnd] - x0[1])};
-	      if ( p2[0] >= bounds[0] && p2[0] <= bounds[1] &&
-	           p2[2] >= bounds[4] && p2[2] <= bounds[5] ) {
-	        intersects_cryo = true;
-		break;
-	      }
-	    }
-	    else if (bnd>=4) {
-	      double p2[3] = {x0[0] + (dx[0]/dx[2])*(bounds[bnd] - x0[2]), x0[1] + (dx[1]/dx[2])*(bounds[bnd] - x0[2]), bounds[bnd]};
-	      if ( p2[0] >= bounds[0] && p2[0] <= bounds[1] &&
-	           p2[1] >= bounds[2] && p2[1] <= bounds[3] ) {
-	        intersects_cryo = true;
-		break;
-	      }
-	    }
+	if (sample.kept[i]) {
+	  truth.Add(particle);
+
+	  if      (std::abs(particle.PdgCode())==13) ++numMuons;
+	  else if (std::abs(particle.PdgCode())==22) ++numPhotons;
+	  else if (std::abs(particle.PdgCode())==11) ++numElectrons;
+
+	  //The following code no longer works now that we require intersection with the cryostat boundary
+	  //For example, the particle could intersect this cryostat but miss its TPC, but intersect a TPC
+	  //in another cryostat
+	  /*try{
+	    unsigned int tpc   = 0;
+	    unsigned int cstat = 0;
+	    geom->PositionToTPC(x2, tpc, cstat);
+	    if      (std::abs(particle.PdgCode())==13) ++tpcMuons;
+	    else if (std::abs(particle.PdgCode())==22) ++tpcPhotons;
+	    else if (std::abs(particle.PdgCode())==11) ++tpcElectrons;
 	  }
-
-
-	  if (intersects_cryo) {
-	    truth.Add(particle);
-
-	    if      (std::abs(particle.PdgCode())==13) ++numMuons;
-	    else if (std::abs(particle.PdgCode())==22) ++numPhotons;
-	    else if (std::abs(particle.PdgCode())==11) ++numElectrons;
-
-            //The following code no longer works now that we require intersection with the cryostat boundary
-	    //For example, the particle could intersect this cryostat but miss its TPC, but intersect a TPC
-	    //in another cryostat
-	    /*try{
-	      unsigned int tpc   = 0;
-	      unsigned int cstat = 0;
-	      geom->PositionToTPC(x2, tpc, cstat);
-	      if      (std::abs(particle.PdgCode())==13) ++tpcMuons;
-	      else if (std::abs(particle.PdgCode())==22) ++tpcPhotons;
-	      else if (std::abs(particle.PdgCode())==11) ++tpcElectrons;
-	    }
-	    catch(cet::exception &e){
-	      MF_LOG_DEBUG("CosmicsGen") << "current particle does not go through any tpc";
-	    }*///
-
-	    if (hCosQ!=0) {
-	      double cosq = -p4.Py()/p4.P();
-	      double phi  = std::atan2(p4.Pz(),p4.Px());
-	      phi *= 180/M_PI;
-	      hCosQ->Fill(cosq);
-	      hAngles->Fill(phi,cosq);
-	      if      (p4.E()<1.0)  hAnglesLo->Fill(phi,cosq);
-	      else if (p4.E()<10.0) hAnglesMi->Fill(phi,cosq);
-	      else                  hAnglesHi->Fill(phi,cosq);
-	      hEnergy->Fill(p4.E());
-	    }//end if there is a cos(theta) histogram
-	    break; //leave loop over cryostats to avoid adding particle multiple times
-	  }// end if particle goes into a cryostat
-	}// end loop over cryostats in the detector
+	  catch(cet::exception &e){
+	    MF_LOG_DEBUG("CosmicsGen") << "current particle does not go through any tpc";
+	  }*///
+
+	  if (hCosQ!=0) {
+	    double cosq = -p4.Py()/p4.P();
+	    double phi  = std::atan2(p4.Pz(),p4.Px());
+	    phi *= 180/M_PI;
+	    hCosQ->Fill(cosq);
+	    hAngles->Fill(phi,cosq);
+	    if      (p4.E()<1.0)  hAnglesLo->Fill(phi,cosq);
+	    else if (p4.E()<10.0) hAnglesMi->Fill(phi,cosq);
+	    else                  hAnglesHi->Fill(phi,cosq);
+	    hEnergy->Fill(p4.E());
+	  }//end if there is a cos(theta) histogram
+	}// end if particle goes into a cryostat
 
       }// loop on particles
 
-      nCrossCryostat = truth.NParticles();
-
       fPhotonsPerSample  ->Fill(allPhotons);
       fElectronsPerSample->Fill(allElectrons);
       fMuonsPerSample    ->Fill(allMuons);
@@ -312,7 +451,7 @@ namespace evgen{
       /*fPhotonsInTPC  ->Fill(tpcPhotons);
       fElectronsInTPC->Fill(tpcElectrons);
       fMuonsInTPC    ->Fill(tpcMuons);*/
-    }
+    } while(fRequireCryostatCrossing && (truth.NParticles() < 1));
 
     truthcol->push_back(truth);
     evt.put(std::move(truthcol));
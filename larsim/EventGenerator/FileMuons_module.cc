@@ -4,6 +4,9 @@
 ///
 /// Module designed to produce a set list of particles for a MC event
 ///
+/// With the ROOT input only the branches that are used are read, through
+/// a tree cache, as the muons are consumed in entry order.
+///
 /// \author  echurch@fnal.gov
 ////////////////////////////////////////////////////////////////////////
 // C++ includes.
@@ -65,6 +68,7 @@ namespace evgen {
     std::vector<std::string> fBranchNames;
 
     std::ifstream                *fMuonFile;
+    std::string              fLine;       // text line being parsed
     TFile                   *fMuonFileR;
     TTree                   *TNtuple;
     unsigned int             countFile;
@@ -180,6 +184,13 @@ namespace evgen{
 	TNtuple->SetBranchAddress("pz", &pztmp, &b_pz);
 	TNtuple->SetBranchAddress("charge", &charge, &b_charge);
 
+	// only the detector position, momentum and charge are used
+	TNtuple->SetBranchStatus("*", 0);
+	for (char const* name: { "xdet", "ydet", "zdet", "px", "py", "pz", "charge" })
+	  TNtuple->SetBranchStatus(name, 1);
+	TNtuple->SetCacheSize(10000000);
+	TNtuple->AddBranchToCache("*", true);
+
       }  // fMuonsFileType is a root file.
 
   }
@@ -226,6 +237,12 @@ namespace evgen{
 
 //     std::cout << "size of particle vector is " << fPDG.size() << std::endl;
 
+    // This is referenced from origin at center-right of first cryostat
+    // (see below).
+    const double cryoGap = 15.0;
+    art::ServiceHandle<geo::Geometry const> geom;
+    TVector3 const off3(geom->CryostatHalfWidth()*0.01,geom->CryostatHalfHeight()*0.01,geom->CryostatLength()*0.01+cryoGap*0.01/2.0) ;
+
     ///every event will have one of each particle species in the fPDG array
     for (unsigned int i=0; i<fPDG.size(); ++i) {
 
@@ -241,8 +258,7 @@ namespace evgen{
       if (fMuonsFileType.compare("text")==0)
 	{
 
-	  std::string line;
-	  getline(*fMuonFile,line);
+	  getline(*fMuonFile,fLine);
 	  if (!fMuonFile->good())
 	    {
 	      std::cout << "FileMuons: Problem reading muon file line ...."<< countFile << ". Perhaps you've exhausted the events in " << fFileName << std::endl; exit(0);
@@ -254,13 +270,10 @@ namespace evgen{
 	  countFile++;
 
 	  MF_LOG_DEBUG("FileMuons: countFile is ") << countFile <<std::endl;
-	  char * cstr, *ptok;
+	  char *ptok;
 
-      // Split this line into tokens
-	  cstr = new char [line.size()+1];
-	  strcpy (cstr, line.c_str());
-	  // cstr now contains a c-string copy of str
-	  ptok=strtok (cstr,"*");
+      // Split this line into tokens (in place)
+	  ptok=strtok (&fLine[0],"*");
 	  unsigned int fieldCount = 0;
 	  unsigned int posIndex = 0;
 	  unsigned int pIndex = 0;
@@ -287,8 +300,6 @@ namespace evgen{
 	      fieldCount++;
 	    }
 
-	  delete[] cstr;
-
 	}
       else if (fMuonsFileType.compare("root")==0) // from root file
 	{
@@ -323,7 +334,6 @@ namespace evgen{
       //       std::cout << "set the position "<<std::endl;
       // This gives coordinates at the center of the 300mx300m plate that is 3m above top of
       // cavern. Got these by histogramming deJong's xdet,ydet,zdet.
-      const double cryoGap = 15.0;
       x[0] -= fXYZ_Off[0];
       x[1] -= fXYZ_Off[1];
       x[2] -= fXYZ_Off[2]; // 3 for plate height above top of cryostat.
@@ -333,16 +343,12 @@ namespace evgen{
       p.RotateX(-M_PI/2);
       //add vector of the position of the center of the point between Cryostats
       // level with top. (To which I've added 3m - in above code - in height.)
-      // This is referenced from origin at center-right of first cryostat.
-      art::ServiceHandle<geo::Geometry const> geom;
-      TVector3 off3(geom->CryostatHalfWidth()*0.01,geom->CryostatHalfHeight()*0.01,geom->CryostatLength()*0.01+cryoGap*0.01/2.0) ;
       x += off3;
 
       TLorentzVector pos(x[0]*100.0, x[1]*100.0, x[2]*100.0, 0.0);
       TLorentzVector pvec(p[0]*1000.0,p[1]*1000.0,p[2]*1000.0,std::sqrt(p.Mag2()*1000.0*1000.0+m*m));
-      std::cout << "x[m] and p [TeV] are " << std::endl;
-      x.Print();
-      p.Print();
+      MF_LOG_DEBUG("FileMuons") << "x[m] = ( " << x[0] << ", " << x[1] << ", " << x[2]
+        << " ) and p [TeV] = ( " << p[0] << ", " << p[1] << ", " << p[2] << " )";
 
       int trackid = -1*(i+1); // set track id to -i as these are all primary particles and have id <= 0
       std::string primary("primary");
@@ -7,17 +7,28 @@
 //
 ////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <string>
 #include <iostream>
 #include <iomanip>
 #include <memory>
+#include <sstream>
+#include <system_error>
+#include <unistd.h> // ::getpid()
 
 // ROOT includes
 #include "TH1.h"
 #include "TH2.h"
 #include "TDatabasePDG.h"
 #include "TStopwatch.h"
+#include "TChain.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TVector3.h"
 
 // Framework includes
 #include "art/Framework/Core/ModuleMacros.h"
@@ -30,6 +41,8 @@
 #include "canvas/Persistency/Common/Assns.h"
 #include "art/Framework/Core/EDProducer.h"
 #include "art/Persistency/Common/PtrMaker.h"
+#include "canvas/Utilities/Exception.h"
+#include "cetlib_except/exception.h"
 
 // art extensions
 #include "nurandom/RandomUtils/NuRandomService.h"
@@ -41,6 +54,8 @@
 #include "nusimdata/SimulationBase/GTruth.h"
 #include "lardataobj/Simulation/BeamGateInfo.h"
 #include "larcore/Geometry/Geometry.h"
+#include "larcorealg/Geometry/BoxBoundedGeo.h"
+#include "larcorealg/Geometry/CryostatGeo.h"
 #include "larcoreobj/SummaryData/RunData.h"
 #include "larcoreobj/SummaryData/POTSummary.h"
 #include "nugen/EventGeneratorBase/GENIE/GENIEHelper.h"
@@ -77,6 +92,57 @@ namespace evgen {
    * As custom, if the random seed is not provided by the configuration, one is
    * fetched from `NuRandomService` (if available), with the behaviour in
 	* lar::util::FetchRandomSeed().
+   *
+   * Pregenerated spills
+   * --------------------
+   *
+   * Setting up GENIE (cross section splines, flux) takes a long time, and
+   * the interactions are generated serially. The spills can instead be
+   * generated in advance by a pool of jobs, each writing them to a ROOT file,
+   * and read back by the job simulating the detector:
+   *
+   * - *WritePregeneratedSpills* (string, default: empty): if not empty,
+   *   each generated spill (including the empty ones) is also written to a
+   *   tree in the ROOT file with this name, with its exposure
+   * - *PregeneratedSpills* (list of strings, default: empty): if not empty,
+   *   GENIE is not set up at all, and each event takes the next spill from
+   *   the trees in these files, in order; empty spills are skipped (and
+   *   their exposure counted) unless *PassEmptySpills* is set. Running out
+   *   of spills is an error.
+   *
+   * In both cases the exposure in `sumdata::POTSummary` is the one of the
+   * spills used in the subrun, as if they had been generated in the job.
+   *
+   * Most of the GENIE set up time is spent by `evgb::GENIEHelper` (nugen)
+   * parsing the cross section spline XML file (*XSecTable*); that parsing
+   * happens inside GENIE, which offers no other spline format, so it can't
+   * be cached from here. Jobs simulating few events each are better served
+   * by reading pregenerated spills, which skips the GENIE set up entirely;
+   * otherwise, a spline file restricted to the neutrino flavours and targets
+   * of the detector (as in the default `gxspl-FNALsmall.xml`) keeps the
+   * parsing short.
+   *
+   * Flux window and maximum path lengths
+   * -------------------------------------
+   *
+   * - *TightenFluxWindow* (boolean, default: `false`): with `histogram` and
+   *   `mono` fluxes, the disc the neutrinos are thrown from (*BeamCenter*,
+   *   *BeamRadius*) is shrunk to the shadow of the cryostats along
+   *   *BeamDirection*, enlarged by *FluxWindowMargin* (cm, default: 10).
+   *   Those fluxes are per unit area, so the exposure does not change, but
+   *   no neutrino crossing only the rest of *TopVolume* (like the dirt
+   *   around the cryostats) is thrown any more: this is meant for samples
+   *   without dirt interactions, which spend less time on rejected neutrinos.
+   *   The window is never made larger than configured.
+   * - *MaxPathLengthCache* (string, default: empty): directory to keep the
+   *   maximum path lengths in, which GENIE otherwise computes by scanning the
+   *   geometry at the start of each job (*GeomScan*). The file is named after
+   *   a hash of the geometry file and of the configuration the scan depends
+   *   on (*TopVolume*, *GeomScan*, *FiducialCut* and the flux window). If it
+   *   exists, it is read instead of scanning (as with `GeomScan: "file: ..."`);
+   *   otherwise the lengths computed by `GENIEHelper` (written into
+   *   `maxpathlength.xml` in the working directory) are copied there for the
+   *   next jobs. It is ignored if *GeomScan* already reads a file.
    */
   class GENIEGen : public art::EDProducer {
   public:
@@ -88,20 +154,51 @@ namespace evgen {
     void beginRun(art::Run& run);
     void beginSubRun(art::SubRun& sr);
     void endSubRun(art::SubRun& sr);
+    void endJob();
 
   private:
 
+    /// Total exposure (POT) of the spills used so far.
+    double TotalExposure() const;
+
+    /// Reads the next spill from the pregenerated ones into the collections;
+    /// returns its exposure.
+    double ReadPregeneratedSpill(std::vector<simb::MCTruth>& truthcol,
+                                 std::vector<simb::MCFlux>& fluxcol,
+                                 std::vector<simb::GTruth>& gtruthcol);
+
+    /// Writes a spill to the pregenerated spill file, if requested.
+    void WritePregeneratedSpill(std::vector<simb::MCTruth> const& truth,
+                                std::vector<simb::MCFlux> const& flux,
+                                std::vector<simb::GTruth> const& gtruth,
+                                double exposure);
+
     std::string ParticleStatus(int StatusCode);
     std::string ReactionChannel(int ccnc,int mode);
 
     void FillHistograms(simb::MCTruth mc);
 
+    /// Shrinks the flux window in `config` to the cryostats (`TightenFluxWindow`).
+    void TightenFluxWindow(fhicl::ParameterSet& config,
+                           geo::GeometryCore const& geom,
+                           double margin) const;
+
+    /// Reads the maximum path lengths from the cache in `cacheDir`, or books
+    /// their storage there.
+    void ConfigureMaxPathLengthCache(fhicl::ParameterSet& config,
+                                     geo::GeometryCore const& geom,
+                                     std::string const& cacheDir);
+
+    /// Copies the maximum path lengths computed by GENIE into the cache.
+    void StoreMaxPathLengths() const;
+
     evgb::GENIEHelper  *fGENIEHelp;       ///< GENIEHelper object
     bool 		fDefinedVtxHistRange;///use defined hist range; it is useful to have for asymmetric ranges like in DP FD.
     std::vector< double > fVtxPosHistRange;
 
     int                 fPassEmptySpills; ///< whether or not to kill evnets with no interactions
     TStopwatch          fStopwatch;       ///keep track of how long it takes to run the job
+    std::string         fMaxPathCacheFile; ///< Cache file for the computed maximum path lengths (empty if none)
 
     double fGlobalTimeOffset;             /// The start of a simulated "beam gate".
     double fRandomTimeOffset;             /// The width of a simulated "beam gate".
@@ -110,6 +207,19 @@ namespace evgen {
     double fPrevTotPOT;      ///< Total POT from subruns previous to current subrun
     double fPrevTotGoodPOT;  ///< Total good POT from subruns previous to current subrun
 
+    // Pregenerated spills: reading (instead of GENIE) and writing.
+    std::vector<std::string> fPregeneratedFiles; ///< Files with the spills to read
+    std::unique_ptr<TChain> fSpillChain;         ///< The trees of the spills to read
+    Long64_t fNextSpill = 0;                     ///< Entry of the next spill to read
+    double fReadExposure = 0.;                   ///< Exposure of the spills read so far
+    std::unique_ptr<TFile> fSpillFile;           ///< File of the spills being written
+    TTree* fSpillTree = nullptr;                 ///< Tree of the spills being written (owned by the file)
+    // spill buffers the trees are read into or written from
+    std::vector<simb::MCTruth>* fSpillTruth = nullptr;
+    std::vector<simb::MCFlux>* fSpillFlux = nullptr;
+    std::vector<simb::GTruth>* fSpillGTruth = nullptr;
+    double fSpillExposure = 0.;
+
     TH1F* fGenerated[6];  ///< Spectra as generated
 
     TH1F* fVertexX;    ///< vertex location of generated events in x
@@ -143,6 +253,39 @@ namespace evgen {
   };
 }
 
+namespace {
+
+  /// File `GENIEHelper` writes the computed maximum path lengths into.
+  constexpr char const* MaxPathLengthOutput = "maxpathlength.xml";
+
+  /// 64-bit FNV-1a hash of `size` bytes from `data`, continuing `hash`.
+  std::uint64_t fnv1a(char const* data, std::size_t size,
+                      std::uint64_t hash = 0xcbf29ce484222325ULL)
+  {
+    for (std::size_t i = 0; i < size; ++i) {
+      hash ^= static_cast<unsigned char>(data[i]);
+      hash *= 0x100000001b3ULL;
+    }
+    return hash;
+  }
+
+  /// Hash of the content of the file `fileName`.
+  std::uint64_t fileHash(std::string const& fileName)
+  {
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in) {
+      throw cet::exception("GENIEGen")
+        << "Can't open the geometry file '" << fileName << "' to hash it.\n";
+    }
+    std::uint64_t hash = fnv1a(nullptr, 0);
+    char buffer[65536];
+    while (in.read(buffer, sizeof(buffer)) || (in.gcount() > 0))
+      hash = fnv1a(buffer, in.gcount(), hash);
+    return hash;
+  }
+
+} // local namespace
+
 namespace evgen{
 
   //____________________________________________________________________________
@@ -155,6 +298,7 @@ namespace evgen{
     , fGlobalTimeOffset(pset.get< double >("GlobalTimeOffset",0))
     , fRandomTimeOffset(pset.get< double >("RandomTimeOffset",1600.)) // BNB default value
     , fBeamType(::sim::kBNB)
+    , fPregeneratedFiles(pset.get< std::vector<std::string> >("PregeneratedSpills", {}))
   {
     fStopwatch.Start();
 
@@ -181,6 +325,40 @@ namespace evgen{
 
       fBeamType = ::sim::kUnknown;
 
+    if (!fPregeneratedFiles.empty()) {
+      // GENIE is not needed at all
+      fSpillChain = std::make_unique<TChain>("GENIESpills");
+      for (std::string const& fileName: fPregeneratedFiles) {
+        if (fSpillChain->Add(fileName.c_str(), 0) == 0) {
+          throw cet::exception("GENIEGen")
+            << "No pregenerated spills found in '" << fileName << "'.\n";
+        }
+      }
+      fSpillChain->SetBranchAddress("truth", &fSpillTruth);
+      fSpillChain->SetBranchAddress("flux", &fSpillFlux);
+      fSpillChain->SetBranchAddress("gtruth", &fSpillGTruth);
+      fSpillChain->SetBranchAddress("exposure", &fSpillExposure);
+      mf::LogInfo("GENIEGen") << "Reading " << fSpillChain->GetEntries()
+                              << " pregenerated spills from " << fPregeneratedFiles.size()
+                              << " files.";
+      return;
+    }
+
+    std::string const spillFileName = pset.get<std::string>("WritePregeneratedSpills", "");
+    if (!spillFileName.empty()) {
+      TDirectory::TContext const context; // restores the current directory
+      fSpillFile.reset(TFile::Open(spillFileName.c_str(), "RECREATE"));
+      if (!fSpillFile || fSpillFile->IsZombie()) {
+        throw cet::exception("GENIEGen")
+          << "Can't create the pregenerated spill file '" << spillFileName << "'.\n";
+      }
+      fSpillTree = new TTree("GENIESpills", "GENIE spills");
+      fSpillTree->Branch("truth", &fSpillTruth);
+      fSpillTree->Branch("flux", &fSpillFlux);
+      fSpillTree->Branch("gtruth", &fSpillGTruth);
+      fSpillTree->Branch("exposure", &fSpillExposure);
+    }
+
     art::ServiceHandle<geo::Geometry const> geo;
 
     signed int temp_seed; // the seed read by GENIEHelper is a signed integer...
@@ -199,6 +377,12 @@ namespace evgen{
       GENIEconfig.put("RandomSeed", seed);
     } // if no RandomSeed present
 
+    if (pset.get<bool>("TightenFluxWindow", false))
+      TightenFluxWindow(GENIEconfig, *geo, pset.get<double>("FluxWindowMargin", 10.));
+
+    std::string const maxPathCache = pset.get<std::string>("MaxPathLengthCache", "");
+    if (!maxPathCache.empty()) ConfigureMaxPathLengthCache(GENIEconfig, *geo, maxPathCache);
+
     fGENIEHelp = new evgb::GENIEHelper(GENIEconfig,
 				       geo->ROOTGeoManager(),
 				       geo->ROOTFile(),
@@ -210,13 +394,26 @@ namespace evgen{
   GENIEGen::~GENIEGen()
   {
     if(fGENIEHelp) delete fGENIEHelp;
+    if (fSpillChain) {
+      // the spill buffers were allocated by ROOT when reading
+      fSpillChain->ResetBranchAddresses();
+      delete fSpillTruth;
+      delete fSpillFlux;
+      delete fSpillGTruth;
+    }
     fStopwatch.Stop();
     mf::LogInfo("GENIEProductionTime") << "real time to produce file: " << fStopwatch.RealTime();
   }
 
   //____________________________________________________________________________
   void GENIEGen::beginJob(){
-    fGENIEHelp->Initialize();
+    if (!fMaxPathCacheFile.empty()) {
+      // GENIEHelper appends to the file: a leftover one would spoil the cache
+      std::error_code error;
+      std::filesystem::remove(MaxPathLengthOutput, error);
+    }
+    if (fGENIEHelp) fGENIEHelp->Initialize();
+    if (!fMaxPathCacheFile.empty()) StoreMaxPathLengths();
 
     fPrevTotPOT = 0.;
     fPrevTotGoodPOT = 0.;
@@ -304,8 +501,8 @@ namespace evgen{
   void GENIEGen::beginSubRun(art::SubRun& sr)
   {
 
-    fPrevTotPOT = fGENIEHelp->TotalExposure();
-    fPrevTotGoodPOT = fGENIEHelp->TotalExposure();
+    fPrevTotPOT = TotalExposure();
+    fPrevTotGoodPOT = TotalExposure();
 
     return;
   }
@@ -316,14 +513,199 @@ namespace evgen{
 
     auto p = std::make_unique<sumdata::POTSummary>();
 
-    p->totpot = fGENIEHelp->TotalExposure() - fPrevTotPOT;
-    p->totgoodpot = fGENIEHelp->TotalExposure() - fPrevTotGoodPOT;
+    p->totpot = TotalExposure() - fPrevTotPOT;
+    p->totgoodpot = TotalExposure() - fPrevTotGoodPOT;
 
     sr.put(std::move(p));
 
     return;
   }
 
+  //____________________________________________________________________________
+  void GENIEGen::endJob()
+  {
+    if (fSpillFile) {
+      fSpillFile->cd();
+      fSpillTree->Write();
+      mf::LogInfo("GENIEGen") << "Wrote " << fSpillTree->GetEntries()
+                              << " pregenerated spills to '" << fSpillFile->GetName() << "'.";
+      fSpillFile->Close();
+      fSpillFile.reset();
+      fSpillTree = nullptr;
+    }
+  }
+
+  //____________________________________________________________________________
+  double GENIEGen::TotalExposure() const
+  {
+    return fGENIEHelp? fGENIEHelp->TotalExposure(): fReadExposure;
+  }
+
+  //____________________________________________________________________________
+  void GENIEGen::TightenFluxWindow(fhicl::ParameterSet& config,
+                                   geo::GeometryCore const& geom,
+                                   double margin) const
+  {
+    std::string const fluxType = config.get<std::string>("FluxType");
+    if ((fluxType != "histogram") && (fluxType != "mono")) {
+      mf::LogWarning("GENIEGen")
+        << "TightenFluxWindow is supported only with histogram and mono fluxes, not '"
+        << fluxType << "': the flux window is unchanged.";
+      return;
+    }
+
+    // GENIE flux lengths are in meters, the geometry ones in centimeters
+    std::vector<double> const center = config.get<std::vector<double>>("BeamCenter");
+    std::vector<double> const direction = config.get<std::vector<double>>("BeamDirection");
+    double const radius = config.get<double>("BeamRadius");
+    if ((center.size() != 3) || (direction.size() != 3)) {
+      throw art::Exception(art::errors::Configuration)
+        << "BeamCenter and BeamDirection must have three coordinates.\n";
+    }
+    TVector3 const beamDir = TVector3(direction[0], direction[1], direction[2]).Unit();
+    TVector3 const beamCenter(center[0], center[1], center[2]);
+
+    geo::BoxBoundedGeo box{geom.Cryostat(0).BoundingBox()};
+    for (geo::CryostatGeo const& cryo: geom.IterateCryostats())
+      box.ExtendToInclude(cryo.BoundingBox());
+
+    // the centre of the cryostats, moved along the beam to the window plane
+    TVector3 const boxCenter(box.CenterX() / 100., box.CenterY() / 100., box.CenterZ() / 100.);
+    TVector3 const windowCenter = boxCenter + (beamCenter - boxCenter).Dot(beamDir) * beamDir;
+    double windowRadius = 0.;
+    for (double const x: { box.MinX(), box.MaxX() }) {
+      for (double const y: { box.MinY(), box.MaxY() }) {
+        for (double const z: { box.MinZ(), box.MaxZ() }) {
+          TVector3 d = TVector3(x / 100., y / 100., z / 100.) - windowCenter;
+          d -= d.Dot(beamDir) * beamDir;
+          windowRadius = std::max(windowRadius, d.Mag());
+        }
+      }
+    }
+    windowRadius += margin / 100.;
+
+    if (windowRadius >= radius) {
+      mf::LogInfo("GENIEGen") << "The flux window (radius " << radius
+                              << " m) is already within the cryostat shadow.";
+      return;
+    }
+    config.put_or_replace("BeamCenter",
+                          std::vector<double>{windowCenter.X(), windowCenter.Y(), windowCenter.Z()});
+    config.put_or_replace("BeamRadius", windowRadius);
+    mf::LogInfo("GENIEGen") << "Flux window tightened to the cryostats: radius "
+                            << radius << " -> " << windowRadius << " m, centre ("
+                            << windowCenter.X() << ", " << windowCenter.Y() << ", "
+                            << windowCenter.Z() << ") m.";
+  }
+
+  //____________________________________________________________________________
+  void GENIEGen::ConfigureMaxPathLengthCache(fhicl::ParameterSet& config,
+                                             geo::GeometryCore const& geom,
+                                             std::string const& cacheDir)
+  {
+    std::string const geomScan = config.get<std::string>("GeomScan", "default");
+    if (geomScan.find("file:") == 0) {
+      mf::LogInfo("GENIEGen") << "Maximum path lengths already read from a file ('"
+                              << geomScan << "'): MaxPathLengthCache ignored.";
+      return;
+    }
+
+    // everything the scan depends on, besides the geometry
+    std::ostringstream key;
+    key << std::setprecision(17) << "geometry: " << std::hex << fileHash(geom.ROOTFile())
+        << std::dec << "; TopVolume: " << config.get<std::string>("TopVolume")
+        << "; GeomScan: " << geomScan
+        << "; FiducialCut: " << config.get<std::string>("FiducialCut", "none")
+        << "; FluxType: " << config.get<std::string>("FluxType");
+    for (char const* name: { "BeamCenter", "BeamDirection" }) {
+      key << "; " << name << ":";
+      for (double const coord: config.get<std::vector<double>>(name, {})) key << " " << coord;
+    }
+    key << "; BeamRadius: " << config.get<double>("BeamRadius", 0.);
+    std::string const keyString = key.str();
+
+    std::ostringstream fileName;
+    fileName << cacheDir << "/maxpathlength_" << std::hex << std::setw(16) << std::setfill('0')
+             << fnv1a(keyString.data(), keyString.size()) << ".xml";
+
+    std::error_code error;
+    if (std::filesystem::exists(fileName.str(), error)) {
+      config.put_or_replace("GeomScan", "file: " + fileName.str());
+      mf::LogInfo("GENIEGen") << "Reading the maximum path lengths from '" << fileName.str()
+                              << "'.";
+      return;
+    }
+    config.put_or_replace("MaxPathOutInfo", keyString);
+    fMaxPathCacheFile = fileName.str();
+  }
+
+  //____________________________________________________________________________
+  void GENIEGen::StoreMaxPathLengths() const
+  {
+    // many jobs may compute the same lengths at the same time: each copies
+    // its own file, then replaces the cached one in one step
+    std::string const tempName = fMaxPathCacheFile + ".part" + std::to_string(::getpid());
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(fMaxPathCacheFile).parent_path(),
+                                        error);
+    if (!error) {
+      std::filesystem::copy_file(MaxPathLengthOutput, tempName,
+                                 std::filesystem::copy_options::overwrite_existing, error);
+    }
+    if (!error) std::filesystem::rename(tempName, fMaxPathCacheFile, error);
+    if (error) {
+      std::error_code ignored;
+      std::filesystem::remove(tempName, ignored);
+      mf::LogWarning("GENIEGen") << "Can't store the maximum path lengths from '"
+                                 << MaxPathLengthOutput << "' into '" << fMaxPathCacheFile
+                                 << "': " << error.message();
+      return;
+    }
+    mf::LogInfo("GENIEGen") << "Maximum path lengths stored into '" << fMaxPathCacheFile << "'.";
+  }
+
+  //____________________________________________________________________________
+  double GENIEGen::ReadPregeneratedSpill(std::vector<simb::MCTruth>& truthcol,
+                                         std::vector<simb::MCFlux>& fluxcol,
+                                         std::vector<simb::GTruth>& gtruthcol)
+  {
+    if (fNextSpill >= fSpillChain->GetEntries()) {
+      throw cet::exception("GENIEGen")
+        << "All the " << fSpillChain->GetEntries() << " pregenerated spills have been used.\n";
+    }
+    fSpillChain->GetEntry(fNextSpill++);
+    if (!fSpillTruth || !fSpillFlux || !fSpillGTruth
+      || (fSpillFlux->size() != fSpillTruth->size())
+      || (fSpillGTruth->size() != fSpillTruth->size()))
+    {
+      throw cet::exception("GENIEGen")
+        << "Pregenerated spill #" << (fNextSpill - 1) << " is inconsistent.\n";
+    }
+    truthcol = std::move(*fSpillTruth);
+    fluxcol = std::move(*fSpillFlux);
+    gtruthcol = std::move(*fSpillGTruth);
+    fReadExposure += fSpillExposure;
+    return fSpillExposure;
+  }
+
+  //____________________________________________________________________________
+  void GENIEGen::WritePregeneratedSpill(std::vector<simb::MCTruth> const& truth,
+                                        std::vector<simb::MCFlux> const& flux,
+                                        std::vector<simb::GTruth> const& gtruth,
+                                        double exposure)
+  {
+    if (!fSpillTree) return;
+    // the tree only reads the collections
+    fSpillTruth = const_cast<std::vector<simb::MCTruth>*>(&truth);
+    fSpillFlux = const_cast<std::vector<simb::MCFlux>*>(&flux);
+    fSpillGTruth = const_cast<std::vector<simb::GTruth>*>(&gtruth);
+    fSpillExposure = exposure;
+    fSpillTree->Fill();
+    fSpillTruth = nullptr;
+    fSpillFlux = nullptr;
+    fSpillGTruth = nullptr;
+  }
+
   //____________________________________________________________________________
   void GENIEGen::produce(art::Event& evt)
   {
@@ -335,6 +717,20 @@ namespace evgen{
     std::unique_ptr< std::vector<sim::BeamGateInfo> > gateCollection(new std::vector<sim::BeamGateInfo>);
 
     while(truthcol->size() < 1){
+      if (fSpillChain) {
+        ReadPregeneratedSpill(*truthcol, *fluxcol, *gtruthcol);
+        for (size_t i = 0; i < truthcol->size(); ++i) {
+          auto const truthPtr = art::PtrMaker<simb::MCTruth>{evt}(i);
+          tfassn->addSingle(truthPtr, art::PtrMaker<simb::MCFlux>{evt}(i));
+          tgtassn->addSingle(truthPtr, art::PtrMaker<simb::GTruth>{evt}(i));
+          FillHistograms((*truthcol)[i]);
+        }
+        if(truthcol->size() < 1 && fPassEmptySpills) break;
+        continue;
+      }
+
+      // a new spill is generated only while there are no interactions
+      double const spillStartExposure = fGENIEHelp->TotalExposure();
       while(!fGENIEHelp->Stop()){
 
 	simb::MCTruth truth;
@@ -377,6 +773,12 @@ namespace evgen{
 
       }// end event generation loop
 
+      if (fSpillTree) {
+        // the spill is written with its exposure, also when empty
+        WritePregeneratedSpill(*truthcol, *fluxcol, *gtruthcol,
+                               fGENIEHelp->TotalExposure() - spillStartExposure);
+      }
+
       // check to see if we are to pass empty spills
       if(truthcol->size() < 1 && fPassEmptySpills){
 	MF_LOG_DEBUG("GENIEGen") << "no events made for this spill but "
@@ -0,0 +1,173 @@
+/**
+ * @file   larsim/EventGenerator/InTimeParticleSelector.cxx
+ * @brief  Selection of the generated particles reaching the detector in time.
+ * @see    larsim/EventGenerator/InTimeParticleSelector.h
+ */
+
+#include "larsim/EventGenerator/InTimeParticleSelector.h"
+
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "nusimdata/SimulationBase/MCParticle.h"
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include "TLorentzVector.h"
+#include "TMath.h"
+
+// C/C++ standard libraries
+#include <cmath>
+#include <utility> // std::move()
+
+namespace evgen {
+
+  //------------------------------------------------------------
+  InTimeParticleSelector::InTimeParticleSelector(double minT,
+                                                 double maxT,
+                                                 std::vector<Boundaries_t> volumes)
+    : fMinT(minT), fMaxT(maxT), fVolumes(std::move(volumes))
+  {}
+
+  //------------------------------------------------------------
+  InTimeParticleSelector::InTimeParticleSelector(fhicl::ParameterSet const& pset,
+                                                 geo::GeometryCore const& geom)
+    : InTimeParticleSelector(pset.get<double>("MinT", 0.0),
+                             pset.get<double>("MaxT"),
+                             cryostatBoundaries(geom))
+  {}
+
+  //------------------------------------------------------------
+  std::vector<InTimeParticleSelector::Boundaries_t>
+  InTimeParticleSelector::cryostatBoundaries(geo::GeometryCore const& geom)
+  {
+    std::vector<Boundaries_t> boundaries;
+    for (auto const& cryo : geom.IterateCryostats()) {
+      Boundaries_t this_cryo_boundaries{};
+      cryo.Boundaries(&this_cryo_boundaries[0]);
+      boundaries.push_back(this_cryo_boundaries);
+    }
+    return boundaries;
+  }
+
+  //------------------------------------------------------------
+  bool
+  InTimeParticleSelector::keep(simb::MCParticle const& part) const
+  {
+    return keep(part.Position(), part.Momentum(), part.Mass());
+  }
+
+  //------------------------------------------------------------
+  bool
+  InTimeParticleSelector::keep(TLorentzVector const& v4,
+                               TLorentzVector const& p4,
+                               double mass) const
+  {
+    // origin of particle
+    double x0[3] = {v4.X(), v4.Y(), v4.Z()};
+    // normalized direction of particle
+    double const mag = p4.Vect().Mag();
+    double dx[3] = {p4.Px() / mag, p4.Py() / mag, p4.Pz() / mag};
+
+    // tolernace for treating number as "zero"
+    double eps = 1e-5;
+
+    // Check to see if particle crosses boundary of any cryostat within appropriate time window;
+    // the first cryostat which does is enough to keep the particle
+    //
+    // Algorithmically, this is looking for ray-box intersection. This is a common problem in
+    // computer graphics. The algorithm below is taken from "Graphics Gems", Academic Press, 1990
+    for (auto const& bound : fVolumes) {
+      std::array<int, 3> quadrant{}; // 0 == RIGHT, 1 == LEFT, 2 == MIDDLE
+      std::array<double, 3> candidatePlane{};
+      std::array<double, 3> coord{};
+
+      std::array<double, 3> bound_lo = {{bound[0], bound[2], bound[4]}};
+      std::array<double, 3> bound_hi = {{bound[1], bound[3], bound[5]}};
+
+      // First check if origin is inside box
+      // Also check which of the two planes in each dimmension is the
+      // "candidate" for the ray to hit
+      bool inside = true;
+      for (int i = 0; i < 3; i++) {
+        if (x0[i] < bound_lo[i]) {
+          quadrant[i] = 1; // LEFT
+          candidatePlane[i] = bound_lo[i];
+          inside = false;
+        }
+        else if (x0[i] > bound_hi[i]) {
+          quadrant[i] = 0; // RIGHT
+          candidatePlane[i] = bound_hi[i];
+          inside = false;
+        }
+        else {
+          quadrant[i] = 2; // MIDDLE
+        }
+      }
+
+      // If the particle originates inside the cryostat, then
+      // we can't really say when it will leave. Thus, accept
+      // the particle
+      if (inside) return true;
+
+      // ray origin is outside the box -- calculate the distance to the cryostat and see if it intersects
+
+      // calculate distances to candidate planes
+      std::array<double, 3> maxT{};
+      for (int i = 0; i < 3; i++) {
+        if (quadrant[i] != 2 /* MIDDLE */ && std::abs(dx[i]) > eps) {
+          maxT[i] = (candidatePlane[i] - x0[i]) / dx[i];
+        }
+        // if a ray origin is between two the two planes in a dimmension, it would never hit that plane first
+        else {
+          maxT[i] = -1;
+        }
+      }
+
+      // The plane on the box that the ray hits is the one with the largest distance
+      int whichPlane = 0;
+      for (int i = 1; i < 3; i++) {
+        if (maxT[whichPlane] < maxT[i]) whichPlane = i;
+      }
+
+      // check if the candidate intersection point is inside the box
+
+      // no intersection
+      if (maxT[whichPlane] < 0.) continue;
+
+      for (int i = 0; i < 3; i++) {
+        if (whichPlane != i) { coord[i] = x0[i] + maxT[whichPlane] * dx[i]; }
+        else {
+          coord[i] = candidatePlane[i];
+        }
+      }
+
+      // check if intersection is in box
+      bool intersects = true;
+      for (int i = 0; i < 3; i++) {
+        if (coord[i] < bound_lo[i] || coord[i] > bound_hi[i]) {
+          intersects = false;
+          break;
+        }
+      }
+      if (!intersects) continue;
+
+      // check arrival time at boundary of cryostat
+      double ptime = (maxT[whichPlane] * 1e-2 /* cm -> m */) /
+                     (TMath::C() * std::sqrt(1 - std::pow(mass / p4.E(), 2))) /* velocity */;
+      double totT = v4.T() + ptime * 1e9 /* s -> ns */;
+      if (totT > fMinT && totT < fMaxT) { return true; }
+    }
+
+    return false;
+  }
+
+  //------------------------------------------------------------
+  std::optional<InTimeParticleSelector>
+  makeInTimeParticleSelector(fhicl::ParameterSet const& pset,
+                             geo::GeometryCore const& geom,
+                             std::string const& key /* = "InTimeSelection" */)
+  {
+    if (!pset.has_key(key)) return std::nullopt;
+    return InTimeParticleSelector{pset.get<fhicl::ParameterSet>(key), geom};
+  }
+
+} // namespace evgen
@@ -0,0 +1,84 @@
+/**
+ * @file   larsim/EventGenerator/InTimeParticleSelector.h
+ * @brief  Selection of the generated particles reaching the detector in time.
+ * @see    larsim/EventGenerator/InTimeParticleSelector.cxx
+ *
+ * Cosmic ray and background generators create many particles which never
+ * reach the detector within the readout window, and which `FilterGenInTime`
+ * removes downstream. The selector applies the same criterion as that
+ * filter (it is in fact the filter's own), so that generators can skip those
+ * particles before adding them to the `simb::MCTruth`: a particle is kept if
+ * it starts inside a cryostat, or if its straight line trajectory enters one
+ * within the time window.
+ */
+
+#ifndef LARSIM_EVENTGENERATOR_INTIMEPARTICLESELECTOR_H
+#define LARSIM_EVENTGENERATOR_INTIMEPARTICLESELECTOR_H
+
+// C/C++ standard libraries
+#include <array>
+#include <optional>
+#include <string>
+#include <vector>
+
+class TLorentzVector;
+
+namespace fhicl {
+  class ParameterSet;
+}
+namespace geo {
+  class GeometryCore;
+}
+namespace simb {
+  class MCParticle;
+}
+
+namespace evgen {
+
+  /**
+   * @brief Keeps the particles which may reach a cryostat in a time window.
+   *
+   * Configuration:
+   * * `MinT` (default: `0`), `MaxT` [ns]: the (exclusive) time window
+   *
+   * The particles are assumed to travel in a straight line from their
+   * starting point, at the speed given by their energy and mass. Particles
+   * starting inside a cryostat are always kept, since when they leave it is
+   * not known.
+   */
+  class InTimeParticleSelector {
+  public:
+    /// Boundaries of a volume: { x min, x max, y min, y max, z min, z max } [cm]
+    using Boundaries_t = std::array<double, 6>;
+
+    /// Selects the particles reaching any of `volumes` within `(minT, maxT)`.
+    InTimeParticleSelector(double minT, double maxT, std::vector<Boundaries_t> volumes);
+
+    /// Selects the particles reaching a cryostat of `geom` in the configured time.
+    InTimeParticleSelector(fhicl::ParameterSet const& pset, geo::GeometryCore const& geom);
+
+    /// Returns the boundaries of all the cryostats of `geom`.
+    static std::vector<Boundaries_t> cryostatBoundaries(geo::GeometryCore const& geom);
+
+    /// Returns whether the particle (starting at `position`, with
+    /// four-momentum `momentum` and `mass` [GeV]) should be kept.
+    bool keep(TLorentzVector const& position, TLorentzVector const& momentum, double mass) const;
+
+    /// Returns whether `part` (from its first trajectory point) should be kept.
+    bool keep(simb::MCParticle const& part) const;
+
+  private:
+    double fMinT;                      ///< Start of the time window [ns]
+    double fMaxT;                      ///< End of the time window [ns]
+    std::vector<Boundaries_t> fVolumes; ///< Volumes to be reached.
+  };
+
+  /// Returns the selector configured in the table `key` of `pset`, if present.
+  std::optional<InTimeParticleSelector> makeInTimeParticleSelector(
+    fhicl::ParameterSet const& pset,
+    geo::GeometryCore const& geom,
+    std::string const& key = "InTimeSelection");
+
+} // namespace evgen
+
+#endif // LARSIM_EVENTGENERATOR_INTIMEPARTICLESELECTOR_H
@@ -52,6 +52,27 @@
  *     bool    UseCustomRegion     - supply our own volume specification or use the full detector volume?
  *     vdouble[3]  RegionMin       - bounding corners of the custom volume specification
  *     vdouble[3]  RegionMax           (only used if UseCustomRegion=true)
+ *     string  CellList            - (optional) scan the cells of this list instead of the
+ *                                   voxels (adaptive library builds, see below)
+ *     int32   CellMaxLevel        - finest refinement level of the cells in CellList
+ *     int32   VoxelsPerEvent      - (optional, default 1) number of voxels to shoot from
+ *                                   in each event (batched library builds, see below)
+ *
+ * When `CellList` is specified, each event shoots from one of the cells of an
+ * adaptive refinement of the voxels (see `phot::AdaptiveVoxelGrid`), in the
+ * order of the list; `FirstVoxel` and `LastVoxel` are then positions in the
+ * list, and the light production is recorded under the first voxel of the
+ * cell. `BuildAdaptivePhotonLibrary` module writes the cell lists.
+ *
+ * With `VoxelsPerEvent` larger than one, each event shoots from that many
+ * consecutive voxels (or cells), saving the overhead of one event per voxel.
+ * The photons of each voxel are in their own `simb::MCTruth`, in scan order,
+ * and the light production of all the voxels is stored into
+ * `phot::PhotonVisibilityService`. `LArG4` simulates the truth records one
+ * after the other, so it can attribute each detected photon to its voxel: in
+ * batched library builds it is `LArG4` that fills the library entries and
+ * writes the library at the end of the job, and modules reading a single
+ * production per event (like `SimPhotonCounter`) must not be used. A batch never crosses the end of the scan.
  *
  *
  * Configuration parameters
@@ -109,6 +130,7 @@
 #include "larcorealg/Geometry/GeometryCore.h"
 #include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h"
 #include "larcoreobj/SummaryData/RunData.h"
+#include "larsim/PhotonPropagation/AdaptiveVoxelGrid.h"
 #include "larsim/PhotonPropagation/PhotonVisibilityService.h"
 #include "larsim/Simulation/PhotonVoxels.h"
 
@@ -170,6 +192,16 @@ namespace evgen {
 
     simb::MCTruth Sample();
 
+    /// Sets the source position and widths in scan mode for `fCurrentVoxel`.
+    void setScanSource();
+
+    /// Returns the voxel the light production of `fCurrentVoxel` is recorded under.
+    int
+    currentLibraryVoxel() const
+    {
+      return fCells.empty() ? fCurrentVoxel : fCells[fCurrentVoxel].voxel;
+    }
+
     /// Throws an exception if any of the configured materials is not present.
     void checkMaterials() const;
 
@@ -218,6 +250,14 @@ namespace evgen {
 
     int fVoxelCount;   // Total number of voxels
     int fCurrentVoxel; // Counter to keep track of vox ID
+    int fVoxelsPerEvent = 1; ///< Number of voxels shot from in each event.
+
+    /// A cell of an adaptive library build.
+    struct ScanCell_t {
+      int voxel;               ///< Voxel the light production is recorded under.
+      sim::PhotonVoxel volume; ///< Volume to shoot from.
+    };
+    std::vector<ScanCell_t> fCells; ///< Cells to scan (if empty, scan voxels).
 
     //  TPC Measurements
     geo::Vector_t fTPCCenter;
@@ -298,6 +338,11 @@ namespace evgen {
 
       fFirstVoxel = pset.get<int>("FirstVoxel");
       fLastVoxel = pset.get<int>("LastVoxel");
+      fVoxelsPerEvent = pset.get<int>("VoxelsPerEvent", 1);
+      if (fVoxelsPerEvent < 1) {
+        throw art::Exception(art::errors::Configuration)
+          << "LightSource: `VoxelsPerEvent` must be positive (" << fVoxelsPerEvent << ").\n";
+      }
 
       fP = pset.get<double>("P");
       fSigmaP = pset.get<double>("SigmaP");
@@ -348,6 +393,23 @@ namespace evgen {
 
       if (fLastVoxel < 0) fLastVoxel = fVoxelCount;
 
+      // adaptive library builds step through the cells of a list instead
+      std::string const cellList = pset.get<std::string>("CellList", "");
+      if (!cellList.empty()) {
+        phot::AdaptiveVoxelGrid const grid(fThePhotonVoxelDef,
+                                           pset.get<unsigned int>("CellMaxLevel"));
+        for (auto const& cell : grid.readCells(cellList))
+          fCells.push_back({(int)grid.FirstVoxel(cell), grid.GetCellVolume(cell)});
+        if (fCells.empty()) {
+          throw cet::exception("LightSource")
+            << "EVGEN Light Source : no cell in the list '" << cellList << "'\n";
+        }
+        fVoxelCount = fCells.size();
+        if ((fLastVoxel < 0) || (fLastVoxel >= fVoxelCount)) fLastVoxel = fVoxelCount - 1;
+        mf::LogVerbatim("LightSource")
+          << "Light Source : scanning " << fVoxelCount << " cells from '" << cellList << "'";
+      }
+
       mf::LogVerbatim("LightSource") << "Light Source : Determining voxel params : " << fVoxelCount
                                      << " " << fSigmaX << " " << fSigmaY << " " << fSigmaZ;
     }
@@ -415,20 +477,41 @@ namespace evgen {
 
       fCurrentVoxel=0;
     }
-    else if (fSourceMode == kSCAN) {
-      //  Step through detector using a number of steps provided in the config file
-      //  firing a constant number of photons from each point
-      fCenter = fThePhotonVoxelDef.GetPhotonVoxel(fCurrentVoxel).GetCenter();
-    }
-    else {
+    else if (fSourceMode != kSCAN) {
       //  Neither file or scan mode, probably a config file error
       throw cet::exception("LightSource") << "EVGEN : Light Source, unrecognised source mode\n";
     }
 
     auto truthcol = std::make_unique<std::vector<simb::MCTruth>>();
 
-    truthcol->push_back(Sample());
-    int const nPhotons = truthcol->back().NParticles();
+    // light production of each of the voxels of this event
+    std::vector<phot::PhotonVisibilityService::LightProd_t> lightProds;
+
+    if (fSourceMode == kFILE) {
+      truthcol->push_back(Sample());
+      lightProds.push_back({fCurrentVoxel, double(truthcol->back().NParticles())});
+    }
+    else {
+      //  Step through detector using a number of steps provided in the config file
+      //  firing a constant number of photons from each point
+      //  (one truth record per point)
+      truthcol->reserve(fVoxelsPerEvent);
+      lightProds.reserve(fVoxelsPerEvent);
+      while (true) {
+        setScanSource();
+        truthcol->push_back(Sample());
+        lightProds.push_back({currentLibraryVoxel(), double(truthcol->back().NParticles())});
+
+        if (fCurrentVoxel == fLastVoxel) {
+          mf::LogVerbatim("LightSource")
+            << "EVGEN Light Source fully scanned detector.  Starting over.";
+          fCurrentVoxel = fFirstVoxel;
+          break;
+        }
+        ++fCurrentVoxel;
+        if (lightProds.size() >= static_cast<std::size_t>(fVoxelsPerEvent)) break;
+      }
+    }
 
     evt.put(std::move(truthcol));
 
@@ -444,15 +527,26 @@ namespace evgen {
 
     if (vis && vis->IsBuildJob()) {
       mf::LogVerbatim("LightSource") << "Light source : Stowing voxel params ";
-      vis->StoreLightProd(fCurrentVoxel, nPhotons);
+      vis->StoreLightProd(lightProds);
     }
+  }
 
-    if (fCurrentVoxel != fLastVoxel) { ++fCurrentVoxel; }
-    else {
-      mf::LogVerbatim("LightSource")
-        << "EVGEN Light Source fully scanned detector.  Starting over.";
-      fCurrentVoxel = fFirstVoxel;
+  //----------------------------------------------------------------
+  void
+  LightSource::setScanSource()
+  {
+    if (fCells.empty()) {
+      fCenter = fThePhotonVoxelDef.GetPhotonVoxel(fCurrentVoxel).GetCenter();
+      return;
     }
+    // cells have different sizes: distribution widths follow them
+    sim::PhotonVoxel const& volume = fCells[fCurrentVoxel].volume;
+    geo::Point_t const& lower = volume.GetLowerCorner();
+    geo::Point_t const& upper = volume.GetUpperCorner();
+    fCenter = volume.GetCenter();
+    fSigmaX = (upper.X() - lower.X()) / 2.0;
+    fSigmaY = (upper.Y() - lower.Y()) / 2.0;
+    fSigmaZ = (upper.Z() - lower.Z()) / 2.0;
   }
 
   simb::MCTruth
@@ -14,6 +14,8 @@
 
 #include "ActiveVolumeVertexSampler.h"
 
+#include <algorithm>
+
 namespace {
   constexpr int MAX_BOX_ITERATIONS = 10000;
 }
@@ -22,7 +24,7 @@ namespace {
 evgen::ActiveVolumeVertexSampler::ActiveVolumeVertexSampler(
   const fhicl::Table<evgen::ActiveVolumeVertexSampler::Config>& conf,
   rndm::NuRandomService& rand_service, const geo::Geometry& geom,
-  const std::string& generator_name)
+  const std::string& generator_name, bool use_config_seed)
   : fVertexType(vertex_type_t::kSampled), fGeneratorName(generator_name),
   fTPCDist(nullptr)
 {
@@ -32,9 +34,8 @@ evgen::ActiveVolumeVertexSampler::ActiveVolumeVertexSampler(
   // Register the TPC sampling engine with the seed service. If you need the
   // seed later, get it from the seed service using the value of the variable
   // generator_name as the instance name.
-  rndm::NuRandomService::seed_t tpc_seed = rand_service.registerEngine(
-    [this](rndm::NuRandomService::EngineId const& /* unused */,
-      rndm::NuRandomService::seed_t lar_seed) -> void
+  auto seeder = [this](rndm::NuRandomService::EngineId const& /* unused */,
+    rndm::NuRandomService::seed_t lar_seed) -> void
     {
       auto seed = static_cast<uint_fast64_t>(lar_seed);
       // Use the obtained seed to prepare the random number engine.  This is
@@ -43,9 +44,11 @@ evgen::ActiveVolumeVertexSampler::ActiveVolumeVertexSampler(
       // http://www.pcg-random.org/posts/cpp-seeding-surprises.html)
       std::seed_seq seed_sequence{seed};
       fTPCEngine.seed(seed_sequence);
-    },
-    fGeneratorName, conf.get_PSet(), { "seed" }
-  );
+    };
+  rndm::NuRandomService::seed_t tpc_seed = use_config_seed
+    ? rand_service.registerEngine(seeder, fGeneratorName, conf.get_PSet(),
+      { "seed" })
+    : rand_service.registerEngine(seeder, fGeneratorName);
 
   // TODO: resolve the other workaround mentioned in the MARLEYHelper
   // class, then fix this as well
@@ -88,6 +91,28 @@ TLorentzVector evgen::ActiveVolumeVertexSampler::sample_vertex_pos(
     // Update the vertex position 4-vector
     fVertexPosition.SetXYZT(x, y, z, 0.); // TODO: add time sampling
   }
+  else if (fVertexType == vertex_type_t::kBox && fBoxPartDist) {
+
+    // Sample the part of the box in a TPC using the volumes as weights
+    size_t part_index = fBoxPartDist->operator()(fTPCEngine);
+    const BoxPart_t& part = fBoxParts[part_index];
+
+    std::uniform_real_distribution<double>::param_type x_range(part.min[0], part.max[0]);
+    std::uniform_real_distribution<double>::param_type y_range(part.min[1], part.max[1]);
+    std::uniform_real_distribution<double>::param_type z_range(part.min[2], part.max[2]);
+
+    // Sample a location uniformly over this part; no rejection is needed
+    std::uniform_real_distribution<double> uniform_dist;
+    double x = uniform_dist(fTPCEngine, x_range);
+    double y = uniform_dist(fTPCEngine, y_range);
+    double z = uniform_dist(fTPCEngine, z_range);
+    MF_LOG_INFO("ActiveVolumeVertexSampler " + fGeneratorName)
+      << "Sampled primary vertex at x = " << x << ", y = " << y
+      << ", z = " << z;
+
+    // Update the vertex position 4-vector
+    fVertexPosition.SetXYZT(x, y, z, 0.); // TODO: add time sampling
+  }
   else if (fVertexType == vertex_type_t::kBox) {
     bool ok = false;
     int num_iterations = 0;
@@ -201,6 +226,54 @@ void evgen::ActiveVolumeVertexSampler::reconfigure(
     fCheckActive = false;
     // If the user specified this optional parameter, use that instead
     conf().check_active_( fCheckActive );
+
+    // Find the parts of the box within each TPC, so that they can be sampled
+    // directly rather than by rejection
+    fBoxParts.clear();
+    fBoxPartDist.reset();
+    if ( fCheckActive ) {
+      std::vector<double> part_volumes;
+      size_t num_tpcs = geom.NTPC();
+      for (size_t iTPC = 0; iTPC < num_tpcs; ++iTPC) {
+        const auto& tpc = geom.TPC(iTPC);
+        BoxPart_t part {
+          { std::max(fXmin, tpc.MinX()), std::max(fYmin, tpc.MinY()), std::max(fZmin, tpc.MinZ()) },
+          { std::min(fXmax, tpc.MaxX()), std::min(fYmax, tpc.MaxY()), std::min(fZmax, tpc.MaxZ()) }
+        };
+        double volume = 1.;
+        for (size_t c = 0; c < 3; ++c) volume *= std::max(part.max[c] - part.min[c], 0.);
+        if ( volume <= 0. ) continue;
+        fBoxParts.push_back(part);
+        part_volumes.push_back(volume);
+      }
+
+      if ( fBoxParts.empty() ) throw cet::exception("ActiveVolumeVertexSampler " + fGeneratorName)
+        << "The vertex sampling box does not overlap with any TPC active volume";
+
+      // Volumes shared by two TPCs would be sampled twice as often; in that
+      // (unusual) case, fall back to rejection sampling in the whole box
+      bool overlapping = false;
+      for (size_t i = 0; i < fBoxParts.size() && !overlapping; ++i) {
+        for (size_t j = i + 1; j < fBoxParts.size() && !overlapping; ++j) {
+          overlapping = true;
+          for (size_t c = 0; c < 3; ++c) {
+            if ( fBoxParts[i].max[c] <= fBoxParts[j].min[c]
+              || fBoxParts[j].max[c] <= fBoxParts[i].min[c] ) overlapping = false;
+          }
+        }
+      }
+
+      if ( overlapping ) {
+        MF_LOG_WARNING("ActiveVolumeVertexSampler " + fGeneratorName)
+          << "TPC volumes overlap within the vertex sampling box;"
+          << " vertices will be sampled by rejection";
+        fBoxParts.clear();
+      }
+      else {
+        fBoxPartDist.reset(new std::discrete_distribution<size_t>(
+          part_volumes.begin(), part_volumes.end()));
+      }
+    }
   }
 
   else throw cet::exception("ActiveVolumeVertexSampler " + fGeneratorName)
@@ -11,9 +11,11 @@
 #define LARSIM_ALGORITHMS_ACTIVEVOLUMEVERTEXSAMPLER_H
 
 // standard library includes
+#include <array>
 #include <memory>
 #include <random>
 #include <string>
+#include <vector>
 
 // framework includes
 #include "fhiclcpp/types/OptionalAtom.h"
@@ -86,9 +88,12 @@ namespace evgen {
       enum class vertex_type_t { kSampled, kFixed, kBox };
 
       // Configuration-checking constructors
+      // If use_config_seed is false, the "seed" in the configuration is
+      // ignored and the seed is chosen by the NuRandomService (for samplers
+      // sharing one configuration, like the ones of different art schedules)
       ActiveVolumeVertexSampler(const fhicl::Table<Config>& conf,
         rndm::NuRandomService& rand_service, const geo::Geometry& geom,
-        const std::string& generator_name);
+        const std::string& generator_name, bool use_config_seed = true);
 
       ActiveVolumeVertexSampler(const fhicl::ParameterSet& pset,
         rndm::NuRandomService& rand_service, const geo::Geometry& geom,
@@ -131,6 +136,20 @@ namespace evgen {
 
       bool fCheckActive;
 
+      // Parts of the box inside each TPC, used by "box" sampling with
+      // check_active: a part is chosen by volume, then the vertex is sampled
+      // uniformly within it. If the parts overlap, vertices are instead
+      // sampled in the whole box and rejected when not in a TPC.
+      struct BoxPart_t {
+        std::array<double, 3> min;
+        std::array<double, 3> max;
+      };
+      std::vector<BoxPart_t> fBoxParts;
+
+      // Discrete distribution object used to sample the box parts based on
+      // their volumes
+      std::unique_ptr<std::discrete_distribution<size_t> > fBoxPartDist;
+
   }; // class evgen::ActiveVolumeVertexSampler
 
 } // namespace evgen
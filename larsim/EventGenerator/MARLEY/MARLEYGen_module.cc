@@ -4,17 +4,23 @@
 /// Yields) supernova neutrino event generator
 ///
 /// \author Steven Gardiner <sjgardiner@ucdavis.edu>
+///
+/// The module keeps one MARLEY generator and one vertex sampler per art
+/// schedule, so events can be generated concurrently. Saving the MARLEY event
+/// tree ("save_marley_events") serializes the module on the TFileService.
 //////////////////////////////////////////////////////////////////////////////
 
 // standard library includes
 #include <memory>
 #include <string>
+#include <vector>
 
 // framework includes
-#include "art/Framework/Core/EDProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art/Utilities/Globals.h"
 #include "art_root_io/TFileService.h"
 #include "fhiclcpp/types/Table.h"
 
@@ -36,7 +42,7 @@ namespace evgen {
   class MarleyGen;
 }
 
-class evgen::MarleyGen : public art::EDProducer {
+class evgen::MarleyGen : public art::SharedProducer {
 
   public:
 
@@ -66,32 +72,41 @@ class evgen::MarleyGen : public art::EDProducer {
         "MARLEYGen" // default value
       };
 
+      fhicl::Atom<bool> save_marley_events_ {
+        Name("save_marley_events"),
+        Comment("Whether to write the MARLEY events into a TTree of the"
+          " TFileService file (events are then generated one at a time)"),
+        true // default value
+      };
+
     }; // struct Config
 
     // Type to enable FHiCL parameter validation by art
-    using Parameters = art::EDProducer::Table<Config, KeysToIgnore>;
+    using Parameters = art::SharedProducer::Table<Config, KeysToIgnore>;
 
     // Configuration-checking constructors
-    explicit MarleyGen(const Parameters& p);
+    explicit MarleyGen(const Parameters& p, const art::ProcessingFrame& frame);
 
-    virtual void produce(art::Event& e) override;
-    virtual void beginRun(art::Run& run) override;
+    void produce(art::Event& e, const art::ProcessingFrame& frame) override;
+    void beginRun(art::Run& run, const art::ProcessingFrame& frame) override;
 
-    virtual void reconfigure(const Parameters& p);
+    void reconfigure(const Parameters& p);
 
   private:
 
     // Object that provides an interface to the MARLEY event generator
+    // (one generator per art schedule)
     std::unique_ptr<evgen::MARLEYHelper> fMarleyHelper;
 
-    // Algorithm that allows us to sample vertex locations within the active
-    // volume(s) of the detector
-    std::unique_ptr<evgen::ActiveVolumeVertexSampler> fVertexSampler;
+    // Algorithms that allow us to sample vertex locations within the active
+    // volume(s) of the detector (one per art schedule)
+    std::vector< std::unique_ptr<evgen::ActiveVolumeVertexSampler> >
+      fVertexSamplers;
 
     // unique_ptr to the current event created by MARLEY
     std::unique_ptr<marley::Event> fEvent;
 
-    // the MARLEY event TTree
+    // the MARLEY event TTree (nullptr if the events are not saved)
     TTree* fEventTree;
 
     // Run, subrun, and event numbers from the art::Event being processed
@@ -101,60 +116,77 @@ class evgen::MarleyGen : public art::EDProducer {
 };
 
 //------------------------------------------------------------------------------
-evgen::MarleyGen::MarleyGen(const Parameters& p)
-  : EDProducer{ p.get_PSet() },
-    fEvent(new marley::Event), fRunNumber(0), fSubRunNumber(0), fEventNumber(0)
+evgen::MarleyGen::MarleyGen(const Parameters& p,
+  const art::ProcessingFrame& /* frame */)
+  : SharedProducer{ p },
+    fEvent(new marley::Event), fEventTree(nullptr), fRunNumber(0),
+    fSubRunNumber(0), fEventNumber(0)
 {
   // Configure the module (including MARLEY itself) using the FHiCL parameters
   this->reconfigure( p );
 
-  // Create a ROOT TTree using the TFileService that will store the MARLEY
-  // event objects (useful for debugging purposes)
-  art::ServiceHandle<art::TFileService const> tfs;
-  fEventTree = tfs->make<TTree>("MARLEY_event_tree",
-    "Neutrino events generated by MARLEY");
-  fEventTree->Branch("event", "marley::Event", fEvent.get());
-
-  // Add branches that give the art::Event run, subrun, and event numbers for
-  // easy match-ups between the MARLEY and art TTrees. All three are recorded
-  // as 32-bit unsigned integers.
-  fEventTree->Branch("run_number", &fRunNumber, "run_number/i");
-  fEventTree->Branch("subrun_number", &fSubRunNumber, "subrun_number/i");
-  fEventTree->Branch("event_number", &fEventNumber, "event_number/i");
+  if ( p().save_marley_events_() ) {
+    // Create a ROOT TTree using the TFileService that will store the MARLEY
+    // event objects (useful for debugging purposes)
+    art::ServiceHandle<art::TFileService const> tfs;
+    fEventTree = tfs->make<TTree>("MARLEY_event_tree",
+      "Neutrino events generated by MARLEY");
+    fEventTree->Branch("event", "marley::Event", fEvent.get());
+
+    // Add branches that give the art::Event run, subrun, and event numbers
+    // for easy match-ups between the MARLEY and art TTrees. All three are
+    // recorded as 32-bit unsigned integers.
+    fEventTree->Branch("run_number", &fRunNumber, "run_number/i");
+    fEventTree->Branch("subrun_number", &fSubRunNumber, "subrun_number/i");
+    fEventTree->Branch("event_number", &fEventNumber, "event_number/i");
+
+    // The tree and its buffers are filled one event at a time
+    serialize(art::SharedResource<art::TFileService>);
+  }
+  else async<art::InEvent>();
 
   produces< std::vector<simb::MCTruth>   >();
   produces< sumdata::RunData, art::InRun >();
 }
 
 //------------------------------------------------------------------------------
-void evgen::MarleyGen::beginRun(art::Run& run)
+void evgen::MarleyGen::beginRun(art::Run& run,
+  const art::ProcessingFrame& /* frame */)
 {
   art::ServiceHandle<geo::Geometry const> geo;
   run.put(std::make_unique<sumdata::RunData>(geo->DetectorName()));
 }
 
 //------------------------------------------------------------------------------
-void evgen::MarleyGen::produce(art::Event& e)
+void evgen::MarleyGen::produce(art::Event& e,
+  const art::ProcessingFrame& frame)
 {
-  // Get the run, subrun, and event numbers from the current art::Event
-  fRunNumber = e.run();
-  fSubRunNumber = e.subRun();
-  fEventNumber = e.event();
+  // The generator and the vertex sampler of this schedule are used
+  const size_t schedule = frame.scheduleID().id();
 
   std::unique_ptr< std::vector<simb::MCTruth> >
     truthcol(new std::vector<simb::MCTruth>);
 
   // Get the primary vertex location for this event
   art::ServiceHandle<geo::Geometry const> geo;
-  TLorentzVector vertex_pos = fVertexSampler->sample_vertex_pos(*geo);
+  TLorentzVector vertex_pos
+    = fVertexSamplers.at(schedule)->sample_vertex_pos(*geo);
 
   // Create the MCTruth object, and retrieve the marley::Event object
-  // that was generated as it was created
+  // that was generated as it was created (only if it is saved: the module
+  // is then serialized, and the buffer of the tree can be used directly)
   simb::MCTruth truth = fMarleyHelper->create_MCTruth(vertex_pos,
-    fEvent.get());
+    fEventTree ? fEvent.get() : nullptr, schedule);
+
+  if ( fEventTree ) {
+    // Get the run, subrun, and event numbers from the current art::Event
+    fRunNumber = e.run();
+    fSubRunNumber = e.subRun();
+    fEventNumber = e.event();
 
-  // Write the marley::Event object to the event tree
-  fEventTree->Fill();
+    // Write the marley::Event object to the event tree
+    fEventTree->Fill();
+  }
 
   truthcol->push_back(truth);
 
@@ -167,16 +199,23 @@ void evgen::MarleyGen::reconfigure(const Parameters& p)
   const auto& seed_service = art::ServiceHandle<rndm::NuRandomService>();
   const auto& geom_service = art::ServiceHandle<geo::Geometry const>();
 
-  // Create a new evgen::ActiveVolumeVertexSampler object based on the current
-  // configuration
-  fVertexSampler = std::make_unique<evgen::ActiveVolumeVertexSampler>(
-    p().vertex_, *seed_service, *geom_service, "MARLEY_Vertex_Sampler");
+  const size_t num_schedules = art::Globals::instance()->nschedules();
+
+  // Create new evgen::ActiveVolumeVertexSampler objects based on the current
+  // configuration, one per schedule (the configured seed, if any, is used by
+  // the first one)
+  fVertexSamplers.clear();
+  for (size_t s = 0; s < num_schedules; ++s) {
+    fVertexSamplers.push_back(std::make_unique<evgen::ActiveVolumeVertexSampler>(
+      p().vertex_, *seed_service, *geom_service,
+      MARLEYHelper::instance_name("MARLEY_Vertex_Sampler", s), s == 0));
+  }
 
-  // Create a new marley::Generator object based on the current configuration
+  // Create new marley::Generator objects based on the current configuration
   fhicl::ParameterSet marley_pset = p.get_PSet().get< fhicl::ParameterSet >(
     "marley_parameters" );
   fMarleyHelper = std::make_unique<MARLEYHelper>( marley_pset,
-    *seed_service, "MARLEY" );
+    *seed_service, "MARLEY", num_schedules );
 }
 
 DEFINE_ART_MODULE(evgen::MarleyGen)
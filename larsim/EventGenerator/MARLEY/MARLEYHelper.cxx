@@ -23,6 +23,9 @@
 #include "marley/Event.hh"
 #include "marley/RootJSONConfig.hh"
 
+// standard library includes
+#include <algorithm>
+
 namespace {
   // We need to convert from MARLEY's energy units (MeV) to LArSoft's
   // (GeV) using this conversion factor
@@ -31,42 +34,52 @@ namespace {
 
 //------------------------------------------------------------------------------
 evgen::MARLEYHelper::MARLEYHelper( const fhicl::ParameterSet& pset,
-  rndm::NuRandomService& rand_service, const std::string& helper_name )
-  : fHelperName( helper_name )
+  rndm::NuRandomService& rand_service, const std::string& helper_name,
+  size_t num_generators )
+  : fMarleyGenerators( std::max<size_t>( num_generators, 1u ) ),
+  fHelperName( helper_name )
 {
   // Configure MARLEY using the FHiCL parameters
   this->reconfigure( pset );
 
-  // Register this MARLEY generator with the NuRandomService. For simplicity,
-  // we use a lambda as the seeder function (see NuRandomService.h for
-  // details). This allows the SeedService to automatically re-seed MARLEY
-  // whenever necessary. The user can set an explicit seed for MARLEY in the
-  // FHiCL configuration using the "seed" parameter. If you need to get the
-  // seed for MARLEY from the SeedService, note that we're using use the value
-  // of the input variable helper_name as its generator instance name.
-  rndm::NuRandomService::seed_t marley_seed = rand_service.registerEngine(
-    [this](rndm::NuRandomService::EngineId const& /* unused */,
+  for ( size_t g = 0u; g < fMarleyGenerators.size(); ++g ) {
+
+    // Register this MARLEY generator with the NuRandomService. For simplicity,
+    // we use a lambda as the seeder function (see NuRandomService.h for
+    // details). This allows the SeedService to automatically re-seed MARLEY
+    // whenever necessary. The user can set an explicit seed for MARLEY in the
+    // FHiCL configuration using the "seed" parameter. If you need to get the
+    // seed for MARLEY from the SeedService, note that we're using use the
+    // value of instance_name( helper_name, g ) as its generator instance name.
+    auto seeder = [this, g](rndm::NuRandomService::EngineId const& /* unused */,
       rndm::NuRandomService::seed_t lar_seed) -> void
     {
-      if ( fMarleyGenerator && fMarleyGenerator.get() ) {
+      auto& gen = fMarleyGenerators.at( g );
+      if ( gen ) {
         auto seed = static_cast<uint_fast64_t>( lar_seed );
-        fMarleyGenerator->reseed( seed );
+        gen->reseed( seed );
       }
-    },
-    fHelperName, pset, { "seed" }
-  );
-
-  // Unless I'm mistaken, the call to registerEngine should seed the generator
-  // with the seed from the FHiCL configuration file if one is included, but it
-  // doesn't appear to do so (as of 16 Aug 2016, larsoft v06_03_00). As a
-  // workaround, I manually reseed the generator (if needed) here using the
-  // result of the call to registerEngine, which will be the seed from the
-  // FHiCL file if one was given.
-  // TODO: figure out what's going on here, and remove this workaround as
-  // needed
-  uint_fast64_t marley_cast_seed = static_cast<uint_fast64_t>( marley_seed );
-  if ( marley_cast_seed != fMarleyGenerator->get_seed() ) {
-    fMarleyGenerator->reseed( marley_cast_seed );
+    };
+
+    // The explicit seed from the configuration would give the same sequence
+    // to all the generators, so only the first one uses it
+    std::string const instance = instance_name( fHelperName, g );
+    rndm::NuRandomService::seed_t marley_seed = ( g == 0u )
+      ? rand_service.registerEngine( seeder, instance, pset, { "seed" } )
+      : rand_service.registerEngine( seeder, instance );
+
+    // Unless I'm mistaken, the call to registerEngine should seed the
+    // generator with the seed from the FHiCL configuration file if one is
+    // included, but it doesn't appear to do so (as of 16 Aug 2016, larsoft
+    // v06_03_00). As a workaround, I manually reseed the generator (if
+    // needed) here using the result of the call to registerEngine, which will
+    // be the seed from the FHiCL file if one was given.
+    // TODO: figure out what's going on here, and remove this workaround as
+    // needed
+    uint_fast64_t marley_cast_seed = static_cast<uint_fast64_t>( marley_seed );
+    if ( marley_cast_seed != fMarleyGenerators[g]->get_seed() ) {
+      fMarleyGenerators[g]->reseed( marley_cast_seed );
+    }
   }
 
   // Log initialization information from the MARLEY generator
@@ -110,13 +123,13 @@ void evgen::MARLEYHelper::add_marley_particles( simb::MCTruth& truth,
 
 //------------------------------------------------------------------------------
 simb::MCTruth evgen::MARLEYHelper::create_MCTruth(
-  const TLorentzVector& vtx_pos, marley::Event* marley_event )
+  const TLorentzVector& vtx_pos, marley::Event* marley_event, size_t index )
 {
   simb::MCTruth truth;
 
   truth.SetOrigin( simb::kSuperNovaNeutrino );
 
-  marley::Event event = fMarleyGenerator->create_event();
+  marley::Event event = fMarleyGenerators.at( index )->create_event();
 
   // Add the initial and final state particles to the MCTruth object.
   add_marley_particles( truth, event.get_initial_particles(), vtx_pos, false );
@@ -162,6 +175,8 @@ simb::MCTruth evgen::MARLEYHelper::create_MCTruth(
 
   // Process the MARLEY logging messages (if any) captured by our
   // stringstream and forward them to the messagefacility logger
+  // (the stream is shared by all the generators)
+  std::lock_guard<std::mutex> lock( fMarleyLogMutex );
   std::string line;
   while( std::getline(fMarleyLogStream, line) ) {
     MF_LOG_INFO( fHelperName ) << line;
@@ -173,6 +188,14 @@ simb::MCTruth evgen::MARLEYHelper::create_MCTruth(
   return truth;
 }
 
+//------------------------------------------------------------------------------
+std::string evgen::MARLEYHelper::instance_name(
+  const std::string& helper_name, size_t index )
+{
+  if ( index == 0u ) return helper_name;
+  return helper_name + "_" + std::to_string( index );
+}
+
 //------------------------------------------------------------------------------
 std::string evgen::MARLEYHelper::find_file( const std::string& fileName,
   const std::string& fileType )
@@ -241,9 +264,13 @@ void evgen::MARLEYHelper::reconfigure( const fhicl::ParameterSet& pset )
     " the JSON configuration\n" << json.dump_string() << '\n';
   marley::RootJSONConfig config( json );
 
-  // Create a new marley::Generator object based on the current configuration
-  fMarleyGenerator = std::make_unique<marley::Generator>(
-    config.create_generator() );
+  // Create new marley::Generator objects based on the current configuration:
+  // the configuration (including the search of the data files) is shared,
+  // while each generator loads its own copy of the reaction and structure
+  // data, since MARLEY generators can't share them
+  for ( auto& gen : fMarleyGenerators ) {
+    gen = std::make_unique<marley::Generator>( config.create_generator() );
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -12,6 +12,7 @@
 // standard library includes
 #include <array>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -40,13 +41,21 @@ namespace marley {
 
 namespace evgen {
 
+  // The helper may own several independent MARLEY generators (e.g. one per
+  // art schedule), all created from the same configuration. Each generator
+  // has its own random engine and may be used by one thread at a time
+  // without further synchronization.
   class MARLEYHelper {
 
     public:
 
+      // The generator with index i is registered with the NuRandomService
+      // using instance_name( generator_name, i ) as its instance name. An
+      // explicit "seed" in the FHiCL configuration applies to the first
+      // generator only; the others get their seeds from the service.
       MARLEYHelper( const fhicl::ParameterSet& pset,
         rndm::NuRandomService& rand_service,
-        const std::string& generator_name );
+        const std::string& generator_name, size_t num_generators = 1 );
 
       void reconfigure( const fhicl::ParameterSet& pset );
 
@@ -54,15 +63,23 @@ namespace evgen {
       // object corresponding to the generated MCTruth object is loaded
       // into the target of the pointer.
       simb::MCTruth create_MCTruth( const TLorentzVector& vtx_pos,
-        marley::Event* marley_event = nullptr );
+        marley::Event* marley_event = nullptr, size_t index = 0 );
 
-      marley::Generator& get_generator() { return *fMarleyGenerator; }
-      const marley::Generator& get_generator() const
-        { return *fMarleyGenerator; }
+      marley::Generator& get_generator( size_t index = 0 )
+        { return *fMarleyGenerators.at( index ); }
+      const marley::Generator& get_generator( size_t index = 0 ) const
+        { return *fMarleyGenerators.at( index ); }
+
+      size_t num_generators() const { return fMarleyGenerators.size(); }
 
       std::string find_file( const std::string& fileName,
         const std::string& fileType );
 
+      // Name of the random engine instance of the generator with the given
+      // index: the helper name itself for the first one
+      static std::string instance_name( const std::string& helper_name,
+        size_t index );
+
     protected:
 
       void add_marley_particles( simb::MCTruth& truth,
@@ -72,7 +89,7 @@ namespace evgen {
       void load_full_paths_into_json( marley::JSON& json,
         const std::string& array_name, bool missing_ok = false );
 
-      std::unique_ptr< marley::Generator > fMarleyGenerator;
+      std::vector< std::unique_ptr< marley::Generator > > fMarleyGenerators;
 
       // name to use for this instance of MARLEYHelper
       std::string fHelperName;
@@ -80,6 +97,7 @@ namespace evgen {
       // string stream used to capture logger output from MARLEY
       // and redirect it to the LArSoft logger
       std::stringstream fMarleyLogStream;
+      std::mutex fMarleyLogMutex;
 
       // Loads ROOT dictionaries for the MARLEY Event and Particle classes.
       // This allows a module to write the generated events to a TTree.
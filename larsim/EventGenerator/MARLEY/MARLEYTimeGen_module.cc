@@ -4,21 +4,31 @@
 /// time-dependent supernova spectra. This module uses MARLEY to help generate
 /// events.
 ///
+/// The module keeps one MARLEY generator and one vertex sampler per art
+/// schedule, so events can be generated concurrently; the spectrum and the
+/// sampling tables derived from it are shared. Saving the MARLEY event tree
+/// ("save_marley_events") serializes the module on the TFileService.
+///
 /// @author Steven Gardiner <sjgardiner@ucdavis.edu>
 //////////////////////////////////////////////////////////////////////////////
 
 // standard library includes
 #include <fstream>
 #include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <random>
 #include <regex>
 #include <string>
+#include <vector>
 
 // framework includes
-#include "art/Framework/Core/EDProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art/Utilities/Globals.h"
 #include "art_root_io/TFileService.h"
 #include "art_root_io/TFileDirectory.h"
 #include "canvas/Persistency/Common/Assns.h"
@@ -108,7 +118,7 @@ namespace evgen {
   class MarleyTimeGen;
 }
 
-class evgen::MarleyTimeGen : public art::EDProducer {
+class evgen::MarleyTimeGen : public art::SharedProducer {
 
   public:
 
@@ -220,18 +230,26 @@ class evgen::MarleyTimeGen : public art::EDProducer {
         }
       };
 
+      fhicl::Atom<bool> save_marley_events_ {
+        Name("save_marley_events"),
+        Comment("Whether to write the MARLEY events into a TTree of the"
+          " TFileService file (events are then generated one at a time)"),
+        true // default value
+      };
+
     }; // struct Config
 
     // Type to enable FHiCL parameter validation by art
-    using Parameters = art::EDProducer::Table<Config, KeysToIgnore>;
+    using Parameters = art::SharedProducer::Table<Config, KeysToIgnore>;
 
     // @brief Configuration-checking constructor
-    explicit MarleyTimeGen(const Parameters& p);
+    explicit MarleyTimeGen(const Parameters& p,
+      const art::ProcessingFrame& frame);
 
-    virtual void produce(art::Event& e) override;
-    virtual void beginRun(art::Run& run) override;
+    void produce(art::Event& e, const art::ProcessingFrame& frame) override;
+    void beginRun(art::Run& run, const art::ProcessingFrame& frame) override;
 
-    virtual void reconfigure(const Parameters& p);
+    void reconfigure(const Parameters& p);
 
   protected:
 
@@ -367,7 +385,7 @@ class evgen::MarleyTimeGen : public art::EDProducer {
     /// from the full range of energies allowed by the incident spectrum and
     /// the currently defined reactions.
     simb::MCTruth make_uniform_energy_mctruth(double E_min, double E_max,
-      double& E_nu, const TLorentzVector& vertex_pos);
+      double& E_nu, const TLorentzVector& vertex_pos, size_t schedule);
 
     /// @brief Create a MARLEY neutrino source object using a set of fit
     /// parameters for a particular time bin
@@ -377,12 +395,14 @@ class evgen::MarleyTimeGen : public art::EDProducer {
     /// @brief Create simb::MCTruth and sim::SupernovaTruth objects using
     /// spectrum information from a ROOT TH2D
     void create_truths_th2d(simb::MCTruth& mc_truth,
-      sim::SupernovaTruth& sn_truth, const TLorentzVector& vertex_pos);
+      sim::SupernovaTruth& sn_truth, const TLorentzVector& vertex_pos,
+      size_t schedule);
 
     /// @brief Create simb::MCTruth and sim::SupernovaTruth objects using a
     /// neutrino spectrum described by a previously-parsed "fit"-format file
     void create_truths_time_fit(simb::MCTruth& mc_truth,
-      sim::SupernovaTruth& sn_truth, const TLorentzVector& vertex_pos);
+      sim::SupernovaTruth& sn_truth, const TLorentzVector& vertex_pos,
+      size_t schedule);
 
     /// @brief Helper function that makes a final dummy TimeFit object so that
     /// the final real time bin can have a right edge
@@ -392,14 +412,60 @@ class evgen::MarleyTimeGen : public art::EDProducer {
     /// bin when using a "fit"-format spectrum file
     void make_nu_emission_histograms() const;
 
+    /// @brief Time distribution of one energy bin of fSpectrumHist
+    /// @details The weights are the contents of the time projection, from
+    /// the underflow to the overflow bin; the sampling parameters use them
+    /// up to the last regular bin, as the per-event projections did.
+    struct TimeDistribution {
+      std::vector<double> weights;
+      std::discrete_distribution<int>::param_type params;
+      double integral; ///< Integral of the projection over the regular bins
+    };
+
+    /// @brief Energy bin index standing for the energy-integrated time
+    /// distribution in fTimeDistributions
+    static constexpr int ALL_ENERGIES = -1;
+
+    /// @brief Returns the time distribution for the energy bin
+    /// E_bin_index of fSpectrumHist (or ALL_ENERGIES), computing it on
+    /// first use
+    const TimeDistribution& time_distribution(int E_bin_index);
+
+    /// @brief Returns the energy spectrum of the time bin time_bin_index of
+    /// fSpectrumHist, projecting it on first use
+    const TH1D& energy_spectrum(int time_bin_index);
+
+    /// @brief Returns the integral of the energy probability density of the
+    /// neutrino source currently loaded in the generator on [ E_min, E_max ]
+    /// @details The source for time bin time_bin_index is assumed to be
+    /// loaded in the generator of the schedule; the integral is computed
+    /// once per time bin.
+    double E_pdf_integral(int time_bin_index, double E_min, double E_max,
+      size_t schedule);
+
     /// @brief Object that provides an interface to the MARLEY event generator
+    /// (one generator per art schedule)
     std::unique_ptr<evgen::MARLEYHelper> fMarleyHelper;
 
-    /// @brief Algorithm that allows us to sample vertex locations within the
-    /// active volume(s) of the detector
-    std::unique_ptr<evgen::ActiveVolumeVertexSampler> fVertexSampler;
+    /// @brief Neutrino vertex being generated by one art schedule
+    struct ScheduleState {
+      /// @brief Algorithm that allows us to sample vertex locations within
+      /// the active volume(s) of the detector
+      std::unique_ptr<evgen::ActiveVolumeVertexSampler> vertex_sampler;
+      /// @brief The current event created by MARLEY
+      marley::Event event;
+      /// @brief Time since the supernova core bounce for the current MARLEY
+      /// neutrino vertex
+      double t_nu = 0.;
+      /// @brief Statistical weight for the current MARLEY neutrino vertex
+      double weight = 0.;
+    };
+
+    /// @brief State of each art schedule
+    std::vector<ScheduleState> fScheduleStates;
 
-    /// @brief unique_ptr to the current event created by MARLEY
+    /// @brief unique_ptr to the current event created by MARLEY, as stored
+    /// in the event tree
     std::unique_ptr<marley::Event> fEvent;
 
     /// @brief ROOT TH2D that contains the time-dependent spectrum to use when
@@ -414,6 +480,21 @@ class evgen::MarleyTimeGen : public art::EDProducer {
     /// file.
     std::vector<TimeFit> fTimeFits;
 
+    /// @brief Sampling tables computed once from the spectrum, since it does
+    /// not change from event to event
+    /// @details They are filled on first use by any schedule, under
+    /// fTablesMutex; the map elements are never moved nor removed until
+    /// the module is reconfigured.
+    /// @{
+    std::map<int, TimeDistribution> fTimeDistributions; ///< Key: energy bin
+    std::map<int, double> fEnergyPdfIntegrals; ///< Key: time bin
+    std::map<int, std::unique_ptr<TH1D> > fEnergySpectra; ///< Key: time bin
+    /// Time bin distribution of each source PDG code for "fit" spectra
+    std::map<int, std::discrete_distribution<size_t>::param_type >
+      fFitTimeDistributions;
+    std::mutex fTablesMutex;
+    /// @}
+
     /// @enum TimeGenSamplingMode
     /// @brief Enumerated type that defines the allowed ways that a neutrino's
     /// energy and arrival time may be sampled
@@ -489,7 +570,8 @@ class evgen::MarleyTimeGen : public art::EDProducer {
     /// @brief The event TTree created by MARLEY
     /// @details This tree will be saved to the "hist" output file for
     /// validation purposes. The tree contains the same information as the
-    /// generated simb::MCTruth objects, but in MARLEY's internal format
+    /// generated simb::MCTruth objects, but in MARLEY's internal format.
+    /// It is nullptr if the events are not saved.
     TTree* fEventTree;
 
     /// @brief Run number from the art::Event being processed
@@ -500,10 +582,11 @@ class evgen::MarleyTimeGen : public art::EDProducer {
     uint_fast32_t fEventNumber;
 
     /// @brief Time since the supernova core bounce for the current MARLEY
-    /// neutrino vertex
+    /// neutrino vertex, as stored in the event tree
     double fTNu;
 
-    /// @brief Statistical weight for the current MARLEY neutrino vertex
+    /// @brief Statistical weight for the current MARLEY neutrino vertex, as
+    /// stored in the event tree
     double fWeight;
 
     /// @brief Flux-averaged total cross section (fm<sup>2</sup>, average is
@@ -525,28 +608,36 @@ class evgen::MarleyTimeGen : public art::EDProducer {
 };
 
 //------------------------------------------------------------------------------
-evgen::MarleyTimeGen::MarleyTimeGen(const Parameters& p)
-  : EDProducer{ p.get_PSet() }, fEvent(new marley::Event), fRunNumber(0),
-  fSubRunNumber(0), fEventNumber(0), fTNu(0.), fFluxAveragedCrossSection(0.)
+evgen::MarleyTimeGen::MarleyTimeGen(const Parameters& p,
+  const art::ProcessingFrame& /* frame */)
+  : SharedProducer{ p }, fEvent(new marley::Event), fEventTree(nullptr),
+  fRunNumber(0), fSubRunNumber(0), fEventNumber(0), fTNu(0.), fWeight(0.),
+  fFluxAveragedCrossSection(0.)
 {
   // Configure the module (including MARLEY itself) using the FHiCL parameters
   this->reconfigure(p);
 
-  // Create a ROOT TTree using the TFileService that will store the MARLEY
-  // event objects (useful for debugging purposes)
-  art::ServiceHandle<art::TFileService const> tfs;
-  fEventTree = tfs->make<TTree>("MARLEY_event_tree",
-    "Neutrino events generated by MARLEY");
-  fEventTree->Branch("event", "marley::Event", fEvent.get());
-
-  // Add branches that give the art::Event run, subrun, and event numbers for
-  // easy match-ups between the MARLEY and art TTrees. All three are recorded
-  // as 32-bit unsigned integers.
-  fEventTree->Branch("run_number", &fRunNumber, "run_number/i");
-  fEventTree->Branch("subrun_number", &fSubRunNumber, "subrun_number/i");
-  fEventTree->Branch("event_number", &fEventNumber, "event_number/i");
-  fEventTree->Branch("tSN", &fTNu, "tSN/D");
-  fEventTree->Branch("weight", &fWeight, "weight/D");
+  if ( p().save_marley_events_() ) {
+    // Create a ROOT TTree using the TFileService that will store the MARLEY
+    // event objects (useful for debugging purposes)
+    art::ServiceHandle<art::TFileService const> tfs;
+    fEventTree = tfs->make<TTree>("MARLEY_event_tree",
+      "Neutrino events generated by MARLEY");
+    fEventTree->Branch("event", "marley::Event", fEvent.get());
+
+    // Add branches that give the art::Event run, subrun, and event numbers
+    // for easy match-ups between the MARLEY and art TTrees. All three are
+    // recorded as 32-bit unsigned integers.
+    fEventTree->Branch("run_number", &fRunNumber, "run_number/i");
+    fEventTree->Branch("subrun_number", &fSubRunNumber, "subrun_number/i");
+    fEventTree->Branch("event_number", &fEventNumber, "event_number/i");
+    fEventTree->Branch("tSN", &fTNu, "tSN/D");
+    fEventTree->Branch("weight", &fWeight, "weight/D");
+
+    // The tree and its buffers are filled one event at a time
+    serialize(art::SharedResource<art::TFileService>);
+  }
+  else async<art::InEvent>();
 
   produces< std::vector<simb::MCTruth> >();
   produces< std::vector<sim::SupernovaTruth> >();
@@ -555,50 +646,52 @@ evgen::MarleyTimeGen::MarleyTimeGen(const Parameters& p)
 }
 
 //------------------------------------------------------------------------------
-void evgen::MarleyTimeGen::beginRun(art::Run& run) {
+void evgen::MarleyTimeGen::beginRun(art::Run& run,
+  const art::ProcessingFrame& /* frame */)
+{
   art::ServiceHandle<geo::Geometry const> geo;
   run.put(std::make_unique<sumdata::RunData>(geo->DetectorName()));
 }
 
 //------------------------------------------------------------------------------
 void evgen::MarleyTimeGen::create_truths_th2d(simb::MCTruth& mc_truth,
-  sim::SupernovaTruth& sn_truth, const TLorentzVector& vertex_pos)
+  sim::SupernovaTruth& sn_truth, const TLorentzVector& vertex_pos,
+  size_t schedule)
 {
   // Get a reference to the generator object created by MARLEY (we'll need
   // to do a few fancy things with it other than just creating events)
-  marley::Generator& gen = fMarleyHelper->get_generator();
+  marley::Generator& gen = fMarleyHelper->get_generator(schedule);
+  ScheduleState& state = fScheduleStates.at(schedule);
 
   if (fSamplingMode == TimeGenSamplingMode::HISTOGRAM)
   {
     // Generate a MARLEY event using the time-integrated spectrum
     // (the generator was already configured to use it by reconfigure())
     mc_truth = fMarleyHelper->create_MCTruth(vertex_pos,
-      fEvent.get());
+      &state.event, schedule);
 
     // Find the time distribution corresponding to the selected energy bin
-    double E_nu = fEvent->projectile().total_energy();
+    double E_nu = state.event.projectile().total_energy();
     int E_bin_index = fSpectrumHist->GetYaxis()->FindBin(E_nu);
-    TH1D* t_hist = fSpectrumHist->ProjectionX("dummy_time_hist", E_bin_index,
-      E_bin_index);
-    double* time_bin_weights = t_hist->GetArray();
+    const TimeDistribution& t_dist = time_distribution(E_bin_index);
 
     // Sample a time bin from the distribution
     std::discrete_distribution<int> time_dist;
-    std::discrete_distribution<int>::param_type time_params(time_bin_weights,
-      &(time_bin_weights[t_hist->GetNbinsX() + 1]));
-    int time_bin_index = gen.sample_from_distribution(time_dist, time_params);
+    int time_bin_index = gen.sample_from_distribution(time_dist,
+      t_dist.params);
 
     // Sample a time uniformly from within the selected time bin
-    double t_min = t_hist->GetBinLowEdge(time_bin_index);
-    double t_max = t_min + t_hist->GetBinWidth(time_bin_index);
+    TAxis* time_axis = fSpectrumHist->GetXaxis();
+    double t_min = time_axis->GetBinLowEdge(time_bin_index);
+    double t_max = t_min + time_axis->GetBinWidth(time_bin_index);
     // sample a time on [ t_min, t_max )
-    fTNu = gen.uniform_random_double(t_min, t_max, false);
+    state.t_nu = gen.uniform_random_double(t_min, t_max, false);
     // Unbiased sampling was used, so assign this neutrino vertex a
     // unit statistical weight
-    fWeight = ONE;
+    state.weight = ONE;
 
-    sn_truth = sim::SupernovaTruth(fTNu, fWeight, fFluxAveragedCrossSection,
-      sim::kUnbiased);
+    sn_truth = sim::SupernovaTruth(state.t_nu, state.weight,
+      fFluxAveragedCrossSection, sim::kUnbiased);
   }
 
   else if (fSamplingMode == TimeGenSamplingMode::UNIFORM_TIME)
@@ -606,7 +699,7 @@ void evgen::MarleyTimeGen::create_truths_th2d(simb::MCTruth& mc_truth,
     // Generate a MARLEY event using the time-integrated spectrum
     // (the generator was already configured to use it by reconfigure())
     mc_truth = fMarleyHelper->create_MCTruth(vertex_pos,
-      fEvent.get());
+      &state.event, schedule);
 
     // Sample a time uniformly
     TAxis* time_axis = fSpectrumHist->GetXaxis();
@@ -614,42 +707,40 @@ void evgen::MarleyTimeGen::create_truths_th2d(simb::MCTruth& mc_truth,
     double t_min = time_axis->GetBinLowEdge(1);
     double t_max = time_axis->GetBinLowEdge(time_axis->GetNbins() + 1);
     // sample a time on [ t_min, t_max )
-    fTNu = gen.uniform_random_double(t_min, t_max, false);
+    state.t_nu = gen.uniform_random_double(t_min, t_max, false);
 
     // Get the value of the true dependent probability density (probability
     // of the sampled time given the sampled energy) to use as a biasing
     // correction in the neutrino vertex weight.
-    double E_nu = fEvent->projectile().total_energy();
+    double E_nu = state.event.projectile().total_energy();
     int E_bin_index = fSpectrumHist->GetYaxis()->FindBin(E_nu);
-    TH1D* t_hist = fSpectrumHist->ProjectionX("dummy_time_hist", E_bin_index,
-      E_bin_index);
-    int t_bin_index = t_hist->FindBin(fTNu);
-    double weight_bias = t_hist->GetBinContent(t_bin_index) * (t_max - t_min)
-      / ( t_hist->Integral() * t_hist->GetBinWidth(t_bin_index) );
+    const TimeDistribution& t_dist = time_distribution(E_bin_index);
+    int t_bin_index = time_axis->FindBin(state.t_nu);
+    double weight_bias = t_dist.weights.at(t_bin_index) * (t_max - t_min)
+      / ( t_dist.integral * time_axis->GetBinWidth(t_bin_index) );
 
-    fWeight = weight_bias;
+    state.weight = weight_bias;
 
-    sn_truth = sim::SupernovaTruth(fTNu, fWeight, fFluxAveragedCrossSection,
-      sim::kUniformTime);
+    sn_truth = sim::SupernovaTruth(state.t_nu, state.weight,
+      fFluxAveragedCrossSection, sim::kUniformTime);
   }
 
   else if (fSamplingMode == TimeGenSamplingMode::UNIFORM_ENERGY)
   {
     // Select a time bin using the energy-integrated spectrum
-    TH1D* t_hist = fSpectrumHist->ProjectionX("dummy_time_hist");
-    double* time_bin_weights = t_hist->GetArray();
+    const TimeDistribution& t_dist = time_distribution(ALL_ENERGIES);
 
     // Sample a time bin from the distribution
     std::discrete_distribution<int> time_dist;
-    std::discrete_distribution<int>::param_type time_params(time_bin_weights,
-      &(time_bin_weights[t_hist->GetNbinsX() + 1]));
-    int time_bin_index = gen.sample_from_distribution(time_dist, time_params);
+    int time_bin_index = gen.sample_from_distribution(time_dist,
+      t_dist.params);
 
     // Sample a time uniformly from within the selected time bin
-    double t_min = t_hist->GetBinLowEdge(time_bin_index);
-    double t_max = t_min + t_hist->GetBinWidth(time_bin_index);
+    TAxis* time_axis = fSpectrumHist->GetXaxis();
+    double t_min = time_axis->GetBinLowEdge(time_bin_index);
+    double t_max = t_min + time_axis->GetBinWidth(time_bin_index);
     // sample a time on [ t_min, t_max )
-    fTNu = gen.uniform_random_double(t_min, t_max, false);
+    state.t_nu = gen.uniform_random_double(t_min, t_max, false);
 
     // Sample an energy uniformly over the entire allowed range
     // underflow bin has index zero
@@ -660,38 +751,37 @@ void evgen::MarleyTimeGen::create_truths_th2d(simb::MCTruth& mc_truth,
     double E_nu = std::numeric_limits<double>::lowest();
 
     // Generate a MARLEY event using a uniformly sampled energy
-    mc_truth = make_uniform_energy_mctruth(E_min, E_max, E_nu, vertex_pos);
+    mc_truth = make_uniform_energy_mctruth(E_min, E_max, E_nu, vertex_pos,
+      schedule);
 
     // Get the value of the true dependent probability density (probability
     // of the sampled energy given the sampled time) to use as a biasing
     // correction in the neutrino vertex weight.
     //
     // Get a 1D projection of the energy spectrum for the sampled time bin
-    TH1D* energy_spect = fSpectrumHist->ProjectionY("energy_spect",
-      time_bin_index, time_bin_index);
+    const TH1D& energy_spect = energy_spectrum(time_bin_index);
 
     // Create a new MARLEY neutrino source object using this projection (this
     // will create a normalized probability density that we can use) and load
     // it into the generator.
     auto nu_source = marley_root::make_root_neutrino_source(
-      marley_utils::ELECTRON_NEUTRINO, energy_spect);
+      marley_utils::ELECTRON_NEUTRINO, &energy_spect);
     double new_source_E_min = nu_source->get_Emin();
     double new_source_E_max = nu_source->get_Emax();
     gen.set_source(std::move(nu_source));
     // NOTE: The marley::Generator object normalizes the E_pdf to unity
     // automatically, but just in case, we redo it here.
-    double E_pdf_integ = integrate([&gen](double E_nu)
-      -> double { return gen.E_pdf(E_nu); }, new_source_E_min,
-      new_source_E_max);
+    double E_pdf_integ = E_pdf_integral(time_bin_index, new_source_E_min,
+      new_source_E_max, schedule);
 
     // Compute the likelihood ratio that we need to bias the neutrino vertex
     // weight
     double weight_bias = (gen.E_pdf(E_nu) / E_pdf_integ) * (E_max - E_min);
 
-    fWeight = weight_bias;
+    state.weight = weight_bias;
 
-    sn_truth = sim::SupernovaTruth(fTNu, fWeight, fFluxAveragedCrossSection,
-      sim::kUniformEnergy);
+    sn_truth = sim::SupernovaTruth(state.t_nu, state.weight,
+      fFluxAveragedCrossSection, sim::kUniformEnergy);
   }
 
   else {
@@ -702,14 +792,14 @@ void evgen::MarleyTimeGen::create_truths_th2d(simb::MCTruth& mc_truth,
 }
 
 //------------------------------------------------------------------------------
-void evgen::MarleyTimeGen::produce(art::Event& e)
+void evgen::MarleyTimeGen::produce(art::Event& e,
+  const art::ProcessingFrame& frame)
 {
   art::ServiceHandle<geo::Geometry const> geo;
 
-  // Get the run, subrun, and event numbers from the current art::Event
-  fRunNumber = e.run();
-  fSubRunNumber = e.subRun();
-  fEventNumber = e.event();
+  // The generator and the vertex sampler of this schedule are used
+  const size_t schedule = frame.scheduleID().id();
+  ScheduleState& state = fScheduleStates.at(schedule);
 
   // Prepare associations and vectors of truth objects that will be produced
   // and loaded into the current art::Event
@@ -729,24 +819,34 @@ void evgen::MarleyTimeGen::produce(art::Event& e)
   for (unsigned int n = 0; n < fNeutrinosPerEvent; ++n) {
 
     // Sample a primary vertex location for this event
-    TLorentzVector vertex_pos = fVertexSampler->sample_vertex_pos(*geo);
+    TLorentzVector vertex_pos
+      = state.vertex_sampler->sample_vertex_pos(*geo);
 
     // Reset the neutrino's time-since-supernova to a bogus value (for now)
-    fTNu = std::numeric_limits<double>::lowest();
+    state.t_nu = std::numeric_limits<double>::lowest();
 
     if (fSpectrumFileFormat == SpectrumFileFormat::RootTH2D) {
-      create_truths_th2d(truth, sn_truth, vertex_pos);
+      create_truths_th2d(truth, sn_truth, vertex_pos, schedule);
     }
     else if (fSpectrumFileFormat == SpectrumFileFormat::FIT) {
-      create_truths_time_fit(truth, sn_truth, vertex_pos);
+      create_truths_time_fit(truth, sn_truth, vertex_pos, schedule);
     }
     else {
       throw cet::exception("MARLEYTimeGen") << "Invalid spectrum file"
         << " format encountered in evgen::MarleyTimeGen::produce()";
     }
 
-    // Write the marley::Event object to the event tree
-    fEventTree->Fill();
+    if (fEventTree) {
+      // Write the marley::Event object to the event tree (the module is
+      // serialized when the tree is saved, so its buffers are not shared)
+      fRunNumber = e.run();
+      fSubRunNumber = e.subRun();
+      fEventNumber = e.event();
+      *fEvent = state.event;
+      fTNu = state.t_nu;
+      fWeight = state.weight;
+      fEventTree->Fill();
+    }
 
     // Add the truth objects to the appropriate vectors
     truthcol->push_back(truth);
@@ -774,20 +874,35 @@ void evgen::MarleyTimeGen::reconfigure(const Parameters& p)
   const auto& seed_service = art::ServiceHandle<rndm::NuRandomService>();
   const auto& geom_service = art::ServiceHandle<geo::Geometry const>();
 
-  // Create a new evgen::ActiveVolumeVertexSampler object based on the current
-  // configuration
-  fVertexSampler = std::make_unique<evgen::ActiveVolumeVertexSampler>(
-    p().vertex_, *seed_service, *geom_service, "MARLEY_Vertex_Sampler");
+  const size_t num_schedules = art::Globals::instance()->nschedules();
+
+  // Create new evgen::ActiveVolumeVertexSampler objects based on the current
+  // configuration, one per schedule (the configured seed, if any, is used by
+  // the first one)
+  fScheduleStates.clear();
+  fScheduleStates.resize(num_schedules);
+  for (size_t s = 0; s < num_schedules; ++s) {
+    fScheduleStates[s].vertex_sampler
+      = std::make_unique<evgen::ActiveVolumeVertexSampler>(p().vertex_,
+      *seed_service, *geom_service,
+      MARLEYHelper::instance_name("MARLEY_Vertex_Sampler", s), s == 0);
+  }
 
-  // Create a new marley::Generator object based on the current configuration
+  // Create new marley::Generator objects based on the current configuration
   const fhicl::ParameterSet marley_pset = p.get_PSet()
     .get< fhicl::ParameterSet >( "marley_parameters" );
   fMarleyHelper = std::make_unique<MARLEYHelper>( marley_pset,
-    *seed_service, "MARLEY" );
+    *seed_service, "MARLEY", num_schedules );
 
   // Get the number of neutrino vertices per event from the FHiCL parameters
   fNeutrinosPerEvent = p().nu_per_event_();
 
+  // The sampling tables are built again from the new spectrum
+  fTimeDistributions.clear();
+  fEnergyPdfIntegrals.clear();
+  fEnergySpectra.clear();
+  fFitTimeDistributions.clear();
+
   // Determine the current sampling mode from the FHiCL parameters
   const std::string& samp_mode_str = p().sampling_mode_();
   if (samp_mode_str == "histogram")
@@ -893,6 +1008,12 @@ void evgen::MarleyTimeGen::reconfigure(const Parameters& p)
     if (fSamplingMode == TimeGenSamplingMode::HISTOGRAM ||
       fSamplingMode == TimeGenSamplingMode::UNIFORM_TIME)
     {
+      // (all the generators use the same source)
+      for (size_t g = 1; g < fMarleyHelper->num_generators(); ++g) {
+        fMarleyHelper->get_generator(g).set_source(
+          marley_root::make_root_neutrino_source(
+          marley_utils::ELECTRON_NEUTRINO, energy_spect));
+      }
       gen.set_source(std::move(nu_source));
     }
 
@@ -1042,11 +1163,13 @@ void evgen::MarleyTimeGen::reconfigure(const Parameters& p)
 
 //------------------------------------------------------------------------------
 void evgen::MarleyTimeGen::create_truths_time_fit(simb::MCTruth& mc_truth,
-  sim::SupernovaTruth& sn_truth, const TLorentzVector& vertex_pos)
+  sim::SupernovaTruth& sn_truth, const TLorentzVector& vertex_pos,
+  size_t schedule)
 {
   // Get a reference to the generator object created by MARLEY (we'll need
   // to do a few fancy things with it other than just creating events)
-  marley::Generator& gen = fMarleyHelper->get_generator();
+  marley::Generator& gen = fMarleyHelper->get_generator(schedule);
+  ScheduleState& state = fScheduleStates.at(schedule);
 
   // Initialize the time bin index to something absurdly large. This will help
   // us detect strange bugs that arise when it is sampled incorrectly.
@@ -1069,12 +1192,27 @@ void evgen::MarleyTimeGen::create_truths_time_fit(simb::MCTruth& mc_truth,
   const auto lum_end = FitParameters::make_luminosity_iterator(
     fit_params_end);
 
-  std::discrete_distribution<size_t> time_dist(lum_begin, lum_end);
+  // The luminosities don't change, so the distribution parameters are made
+  // only once for each source (and shared by the schedules)
+  const std::discrete_distribution<size_t>::param_type* time_dist_params
+    = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(fTablesMutex);
+    auto time_dist_iter = fFitTimeDistributions.find(source_pdg_code);
+    if (time_dist_iter == fFitTimeDistributions.end()) {
+      time_dist_iter = fFitTimeDistributions.emplace(source_pdg_code,
+        std::discrete_distribution<size_t>::param_type(lum_begin, lum_end))
+        .first;
+    }
+    time_dist_params = &(time_dist_iter->second);
+  }
+  std::discrete_distribution<size_t> time_dist;
 
   if (fSamplingMode == TimeGenSamplingMode::HISTOGRAM
     || fSamplingMode == TimeGenSamplingMode::UNIFORM_ENERGY)
   {
-    time_bin_index = gen.sample_from_distribution(time_dist);
+    time_bin_index = gen.sample_from_distribution(time_dist,
+      *time_dist_params);
   }
 
   else if (fSamplingMode == TimeGenSamplingMode::UNIFORM_TIME) {
@@ -1099,7 +1237,7 @@ void evgen::MarleyTimeGen::create_truths_time_fit(simb::MCTruth& mc_truth,
   double t_min = fTimeFits.at(time_bin_index).Time();
   double t_max = fTimeFits.at(time_bin_index + 1).Time();
   // sample a time on [ t_min, t_max )
-  fTNu = gen.uniform_random_double(t_min, t_max, false);
+  state.t_nu = gen.uniform_random_double(t_min, t_max, false);
 
   // Create a "beta-fit" neutrino source using the correct parameters for the
   // sampled time bin. This will be used to sample a neutrino energy unless
@@ -1116,26 +1254,28 @@ void evgen::MarleyTimeGen::create_truths_time_fit(simb::MCTruth& mc_truth,
     gen.set_source(std::move(nu_source));
 
     // Generate a MARLEY event using the updated source
-    mc_truth = fMarleyHelper->create_MCTruth(vertex_pos, fEvent.get());
+    mc_truth = fMarleyHelper->create_MCTruth(vertex_pos, &state.event,
+      schedule);
 
     if (fSamplingMode == TimeGenSamplingMode::HISTOGRAM) {
       // Unbiased sampling creates neutrino vertices with unit weight
-      fWeight = ONE;
-      sn_truth = sim::SupernovaTruth(fTNu, fWeight, fFluxAveragedCrossSection,
-        sim::kUnbiased);
+      state.weight = ONE;
+      sn_truth = sim::SupernovaTruth(state.t_nu, state.weight,
+        fFluxAveragedCrossSection, sim::kUnbiased);
     }
     else {
       // fSamplingMode == TimeGenSamplingMode::UNIFORM_TIME
 
       // Multiply by the likelihood ratio in order to correct for uniform
       // time sampling if we're using that biasing method
-      double weight_bias = time_dist.probabilities().at(time_bin_index)
+      double weight_bias
+        = time_dist_params->probabilities().at(time_bin_index)
         / (t_max - t_min) * ( fTimeFits.back().Time()
         - fTimeFits.front().Time() );
 
-      fWeight = weight_bias;
-      sn_truth = sim::SupernovaTruth(fTNu, fWeight, fFluxAveragedCrossSection,
-        sim::kUniformTime);
+      state.weight = weight_bias;
+      sn_truth = sim::SupernovaTruth(state.t_nu, state.weight,
+        fFluxAveragedCrossSection, sim::kUniformTime);
     }
   }
 
@@ -1143,7 +1283,7 @@ void evgen::MarleyTimeGen::create_truths_time_fit(simb::MCTruth& mc_truth,
   {
     double E_nu = std::numeric_limits<double>::lowest();
     mc_truth = make_uniform_energy_mctruth(fFitEmin, fFitEmax, E_nu,
-      vertex_pos);
+      vertex_pos, schedule);
 
     // Get the value of the true dependent probability density (probability
     // of the sampled energy given the sampled time) to use as a biasing
@@ -1159,18 +1299,17 @@ void evgen::MarleyTimeGen::create_truths_time_fit(simb::MCTruth& mc_truth,
 
     // NOTE: The marley::Generator object normalizes the E_pdf to unity
     // automatically, but just in case, we redo it here.
-    double E_pdf_integ = integrate([&gen](double E_nu)
-      -> double { return gen.E_pdf(E_nu); }, nu_source_E_min,
-      nu_source_E_max);
+    double E_pdf_integ = E_pdf_integral(time_bin_index, nu_source_E_min,
+      nu_source_E_max, schedule);
 
     // Compute the likelihood ratio that we need to bias the neutrino vertex
     // weight
     double weight_bias = (gen.E_pdf(E_nu) / E_pdf_integ)
       * (fFitEmax - fFitEmin);
 
-    fWeight = weight_bias;
-    sn_truth = sim::SupernovaTruth(fTNu, fWeight, fFluxAveragedCrossSection,
-      sim::kUniformEnergy);
+    state.weight = weight_bias;
+    sn_truth = sim::SupernovaTruth(state.t_nu, state.weight,
+      fFluxAveragedCrossSection, sim::kUniformEnergy);
   }
 
   else {
@@ -1210,9 +1349,10 @@ std::unique_ptr<marley::NeutrinoSource>
 
 //------------------------------------------------------------------------------
 simb::MCTruth evgen::MarleyTimeGen::make_uniform_energy_mctruth(double E_min,
-  double E_max, double& E_nu, const TLorentzVector& vertex_pos)
+  double E_max, double& E_nu, const TLorentzVector& vertex_pos,
+  size_t schedule)
 {
-  marley::Generator& gen = fMarleyHelper->get_generator();
+  marley::Generator& gen = fMarleyHelper->get_generator(schedule);
 
   // Sample an energy uniformly over the entire allowed range
   double total_xs;
@@ -1250,11 +1390,78 @@ simb::MCTruth evgen::MarleyTimeGen::make_uniform_energy_mctruth(double E_min,
   gen.set_source(std::move(nu_source));
 
   // Generate a MARLEY event using the new monoenergetic source
-  auto mc_truth = fMarleyHelper->create_MCTruth(vertex_pos, fEvent.get());
+  auto mc_truth = fMarleyHelper->create_MCTruth(vertex_pos,
+    &fScheduleStates.at(schedule).event, schedule);
 
   return mc_truth;
 }
 
+//------------------------------------------------------------------------------
+const evgen::MarleyTimeGen::TimeDistribution&
+  evgen::MarleyTimeGen::time_distribution(int E_bin_index)
+{
+  std::lock_guard<std::mutex> lock(fTablesMutex);
+
+  auto iter = fTimeDistributions.find(E_bin_index);
+  if (iter != fTimeDistributions.end()) return iter->second;
+
+  std::unique_ptr<TH1D> t_hist( (E_bin_index == ALL_ENERGIES)
+    ? fSpectrumHist->ProjectionX("dummy_time_hist")
+    : fSpectrumHist->ProjectionX("dummy_time_hist", E_bin_index, E_bin_index)
+  );
+  double* time_bin_weights = t_hist->GetArray();
+  int num_bins = t_hist->GetNbinsX();
+
+  TimeDistribution t_dist;
+  t_dist.weights.assign(time_bin_weights, time_bin_weights + num_bins + 2);
+  t_dist.params = std::discrete_distribution<int>::param_type(
+    time_bin_weights, time_bin_weights + num_bins + 1);
+  t_dist.integral = t_hist->Integral();
+
+  return fTimeDistributions.emplace(E_bin_index, std::move(t_dist))
+    .first->second;
+}
+
+//------------------------------------------------------------------------------
+const TH1D& evgen::MarleyTimeGen::energy_spectrum(int time_bin_index)
+{
+  std::lock_guard<std::mutex> lock(fTablesMutex);
+
+  auto iter = fEnergySpectra.find(time_bin_index);
+  if (iter != fEnergySpectra.end()) return *(iter->second);
+
+  // The projection is detached from the current ROOT directory, so that
+  // projections of different time bins don't replace each other
+  std::unique_ptr<TH1D> energy_spect( fSpectrumHist->ProjectionY(
+    ("energy_spect_" + std::to_string(time_bin_index)).c_str(),
+    time_bin_index, time_bin_index) );
+  energy_spect->SetDirectory(nullptr);
+
+  return *(fEnergySpectra.emplace(time_bin_index, std::move(energy_spect))
+    .first->second);
+}
+
+//------------------------------------------------------------------------------
+double evgen::MarleyTimeGen::E_pdf_integral(int time_bin_index, double E_min,
+  double E_max, size_t schedule)
+{
+  {
+    std::lock_guard<std::mutex> lock(fTablesMutex);
+    auto iter = fEnergyPdfIntegrals.find(time_bin_index);
+    if (iter != fEnergyPdfIntegrals.end()) return iter->second;
+  }
+
+  // The integral is computed without holding the lock: if another schedule
+  // computes the same integral meanwhile, the results are the same
+  marley::Generator& gen = fMarleyHelper->get_generator(schedule);
+  double E_pdf_integ = integrate([&gen](double E_nu)
+    -> double { return gen.E_pdf(E_nu); }, E_min, E_max);
+
+  std::lock_guard<std::mutex> lock(fTablesMutex);
+  return fEnergyPdfIntegrals.emplace(time_bin_index, E_pdf_integ)
+    .first->second;
+}
+
 //------------------------------------------------------------------------------
 void evgen::MarleyTimeGen::make_final_timefit(double time)
 {
@@ -1366,7 +1573,9 @@ namespace {
   double integrate(const std::function<double(double)>& f, double x_min,
     double x_max)
   {
-    static marley::Integrator integrator(NUM_INTEGRATION_SAMPLING_POINTS);
+    // (one integrator per thread, since the module may run concurrently)
+    static thread_local marley::Integrator
+      integrator(NUM_INTEGRATION_SAMPLING_POINTS);
     return integrator.num_integrate(f, x_min, x_max);
   }
 
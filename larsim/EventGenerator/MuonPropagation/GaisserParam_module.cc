@@ -20,7 +20,9 @@
 #include <sys/stat.h>
 #include <exception>
 #include <map>
+#include <optional>
 #include <algorithm>
+#include <vector>
 
 // Framework includes
 #include "art/Framework/Core/EDProducer.h"
@@ -42,6 +44,7 @@
 // lar includes
 #include "larcore/Geometry/Geometry.h"
 #include "larcoreobj/SummaryData/RunData.h"
+#include "larsim/EventGenerator/InTimeParticleSelector.h"
 
 #include "TVector3.h"
 #include "TDatabasePDG.h"
@@ -79,8 +82,25 @@ namespace evgen {
     void SampleOne(unsigned int i, simb::MCTruth &mct, CLHEP::HepRandomEngine& engine);
     void Sample(simb::MCTruth &mct, CLHEP::HepRandomEngine& engine);
 
+    /// Cumulative distribution in one variable, from the histograms of `MakePDF()`.
+    struct CDFTable {
+      std::vector<double> content; ///< Bin contents, including underflow and overflow.
+      std::vector<double> lowEdge; ///< Low edge of each bin, including underflow and overflow.
+      std::vector<double> upEdge;  ///< Upper edge of each bin, including underflow and overflow.
+
+      /// First bin (from 1) with content not smaller than `r`; number of bins + 1 if none.
+      std::size_t FindBin(double r) const;
+      /// Value at `r`, interpolating within the bin found by `FindBin()`.
+      double Sample(double r) const;
+    };
+
     std::pair<double,double> GetThetaAndEnergy(double rand1, double rand2);
     void MakePDF();
+    void MakeSamplingTables();
+    static CDFTable MakeCDFTable(TH1 const& hist, bool storeEdges = true);
+
+    CDFTable m_thetaCDF;                ///< Sampling table of `m_thetaHist`.
+    std::vector<CDFTable> m_energyCDFs; ///< Energy sampling table for each theta bin (from 1).
     void ResetMap();
     double GaisserMuonFlux_Integrand(Double_t *x, Double_t *par);
     double GaisserFlux(double e, double theta);
@@ -124,6 +144,7 @@ namespace evgen {
     bool                fSetWrite;       ///< Whether to Write
     bool                fSetReWrite;     ///< Whether to ReWrite pdfs
     double              fEpsilon;        ///< Minimum integration sum....
+    std::optional<InTimeParticleSelector> fInTimeSelector; ///< Selection of the particles in time (if any)
 
     //Define TFS histograms.....
     /*
@@ -191,6 +212,8 @@ namespace evgen{
   {
     produces< std::vector<simb::MCTruth> >();
     produces< sumdata::RunData, art::InRun >();
+
+    fInTimeSelector = makeInTimeParticleSelector(pset, *art::ServiceHandle<geo::Geometry const>());
   }
 
   //____________________________________________________________________________
@@ -381,6 +404,7 @@ namespace evgen{
     std::cout << "Normalised..." << DirCosineX << " " << DirCosineY << " " << DirCosineZ << std::endl;
 
     fTree->Fill();
+    if (fInTimeSelector && !fInTimeSelector->keep(part)) return;
     mct.Add(part);
   }
 
@@ -412,44 +436,82 @@ namespace evgen{
     return;
   }
 
+  //__________________________________
+  std::size_t GaisserParam::CDFTable::FindBin(double r) const
+  {
+    // content is the cumulative distribution, so bins never decrease
+    // and the first bin not below r is also the closest one to it
+    auto const begin = content.begin() + 1, end = content.end() - 1;
+    return std::lower_bound(begin, end, r) - content.begin();
+  }
+
+  //__________________________________
+  double GaisserParam::CDFTable::Sample(double r) const
+  {
+    std::size_t const bin = FindBin(r);
+    double const drand = (content[bin] - r)/(content[bin] - content[bin-1]);
+    return drand*(upEdge[bin]-lowEdge[bin]) + lowEdge[bin];
+  }
+
   //__________________________________
   std::pair<double,double> GaisserParam::GetThetaAndEnergy(double rand1, double rand2)
   {
     if(rand1 < 0 || rand1 > 1) std::cerr << "GetThetaAndEnergy:\tInvalid random number " << rand1 << std::endl;
     if(rand2 < 0 || rand2 > 1) std::cerr << "GetThetaAndEnergy:\tInvalid random number " << rand2 << std::endl;
 
-    int thetaBin = 0;
-    m_thetaHist->GetBinWithContent(double(rand1),thetaBin,1,m_thetaHist->GetNbinsX(),1.0);
-    if(m_thetaHist->GetBinContent(thetaBin) < rand1) thetaBin += 1;
-    double drand1 = (m_thetaHist->GetBinContent(thetaBin) - rand1)/(m_thetaHist->GetBinContent(thetaBin) - m_thetaHist->GetBinContent(thetaBin-1));
-    double thetaLow = m_thetaHist->GetXaxis()->GetBinLowEdge(thetaBin);
-    double thetaUp  = m_thetaHist->GetXaxis()->GetBinUpEdge(thetaBin);
-    double theta = drand1*(thetaUp-thetaLow) + thetaLow;
-
-    int energyBin = 0;
-    TH1* energyHist = 0;
-    bool notFound = true;
-    for(dhist_Map_it mapit=m_PDFmap->begin(); mapit!=m_PDFmap->end(); mapit++){
-      if( fabs(mapit->first+thetaLow)<0.000001 ) {
-	energyHist = mapit->second;
-	notFound = false;
-	break;
-      }
-    }
-    if(notFound) std::cout << "GetThetaAndEnergy: ERROR:\tInvalid theta!" << std::endl;
-    //  MSG("string = " << To_TString(thetaLow) << ", double = " << thetaLow );
-
-    energyHist->GetBinWithContent(double(rand2),energyBin,1,energyHist->GetNbinsX(),1.0);
-    if(energyHist->GetBinContent(energyBin) < rand2) energyBin += 1;
-    double drand2 = (energyHist->GetBinContent(energyBin) - rand2)/(energyHist->GetBinContent(energyBin) - energyHist->GetBinContent(energyBin-1));
-    double energyLow = energyHist->GetXaxis()->GetBinLowEdge(energyBin);
-    double energyUp  = energyHist->GetXaxis()->GetBinUpEdge(energyBin);
-    double energy = drand2*(energyUp-energyLow) + energyLow;
+    std::size_t const thetaBin = m_thetaCDF.FindBin(rand1);
+    double const theta = m_thetaCDF.Sample(rand1);
+
+    // the energy tables have all the same binning, stored with the first one
+    CDFTable const& energyCDF = m_energyCDFs.at(std::min(thetaBin, m_energyCDFs.size()) - 1);
+    CDFTable const& energyEdges = m_energyCDFs.front();
+    std::size_t const energyBin = energyCDF.FindBin(rand2);
+    double const drand2 = (energyCDF.content[energyBin] - rand2)/(energyCDF.content[energyBin] - energyCDF.content[energyBin-1]);
+    double const energyLow = energyEdges.lowEdge[energyBin];
+    double const energyUp  = energyEdges.upEdge[energyBin];
+    double const energy = drand2*(energyUp-energyLow) + energyLow;
     //  MSG("MuFlux::GetThetaEnergy()\te = " << energy*1000. );
 
     return std::make_pair(theta,energy);
   }
 
+  //__________________________________
+  GaisserParam::CDFTable GaisserParam::MakeCDFTable(TH1 const& hist, bool storeEdges)
+  {
+    CDFTable table;
+    int const nBins = hist.GetNbinsX();
+    TAxis const* axis = hist.GetXaxis();
+    for(int bin=0; bin<=nBins+1; bin++){
+      table.content.push_back(hist.GetBinContent(bin));
+      if(!storeEdges) continue;
+      table.lowEdge.push_back(axis->GetBinLowEdge(bin));
+      table.upEdge.push_back(axis->GetBinUpEdge(bin));
+    }
+    return table;
+  }
+
+  //__________________________________
+  void GaisserParam::MakeSamplingTables()
+  {
+    // the histograms are converted into plain arrays, where a bin is found
+    // with a binary search instead of scanning the histograms on each sample
+    m_thetaCDF = MakeCDFTable(*m_thetaHist);
+
+    m_energyCDFs.clear();
+    for(int thetaBin=1; thetaBin<=m_thetaHist->GetNbinsX(); thetaBin++){
+      double const thetaLow = m_thetaHist->GetXaxis()->GetBinLowEdge(thetaBin);
+      TH1 const* energyHist = nullptr;
+      for(dhist_Map_it mapit=m_PDFmap->begin(); mapit!=m_PDFmap->end(); mapit++){
+        if( fabs(mapit->first+thetaLow)<0.000001 ) {
+          energyHist = mapit->second;
+          break;
+        }
+      }
+      if(!energyHist) throw cet::exception("GaisserParam") << "No energy PDF for theta bin " << thetaBin << " (from " << thetaLow << ")\n";
+      m_energyCDFs.push_back(MakeCDFTable(*energyHist, m_energyCDFs.empty()));
+    }
+  }
+
   //____________________________________________________________________________
   void GaisserParam::MakePDF()
   {
@@ -479,12 +541,6 @@ namespace evgen{
 			    fEmin, fEmax, fThetamin, fThetamax, 0,
 			    "GaisserParam", "GaisserMuonFlux_Integrand"
 			    );
-    //--------------------------------------------
-    //------------ Compute the pdfs
-
-    //---- compute pdf for the theta
-    TotalMuonFlux = muonSpec->Integral(fEmin, fEmax, fThetamin, fThetamax, fEpsilon ); // Work out the muon flux at the surface
-    std::cout << "Surface flux of muons = " << TotalMuonFlux << " cm-2 s-1" << std::endl;
 
     //---- work out if we're reading a file, writing to file, or neither
     std::ostringstream pdfFile;
@@ -546,6 +602,13 @@ namespace evgen{
 	m_File = new TFile(fileName.c_str(),"RECREATE");
       }
 
+      //--------------------------------------------
+      //------------ Compute the pdfs
+
+      //---- compute pdf for the theta
+      TotalMuonFlux = muonSpec->Integral(fEmin, fEmax, fThetamin, fThetamax, fEpsilon ); // Work out the muon flux at the surface
+      std::cout << "Surface flux of muons = " << TotalMuonFlux << " cm-2 s-1" << std::endl;
+
       double dnbins_theta = double(fThetaBins);
       m_thetaHist = new TH1D("pdf_theta", "pdf_theta", fThetaBins, fThetamin, fThetamax);
       for(int i=1; i<=fThetaBins; i++){
@@ -654,6 +717,7 @@ namespace evgen{
     }//---- if(!m_doRead)
 
     delete muonSpec;
+    MakeSamplingTables();
     return;
   } // Make PDF
 
@@ -141,14 +141,17 @@
 ////////////////////////////////////////////////////////////////////////
 
 // C++ includes.
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <exception>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <vector>
 
 // Framework includes
 #include "art/Framework/Core/EDProducer.h"
@@ -170,6 +173,7 @@
 // lar includes
 #include "larcore/Geometry/Geometry.h"
 #include "larcoreobj/SummaryData/RunData.h"
+#include "larsim/EventGenerator/InTimeParticleSelector.h"
 
 #include "TDatabasePDG.h"
 #include "TTree.h"
@@ -217,6 +221,8 @@ namespace evgen {
                   double& dep,
                   CLHEP::HepRandomEngine& engine);
 
+    void makeSamplingTables(int nCells);
+
     static const int kGAUS = 1;
 
     CLHEP::HepRandomEngine& fEngine; ///< art-managed random-number engine
@@ -254,6 +260,7 @@ namespace evgen {
     double fT0;     ///< Central t position (ns) in world coordinates
     double fSigmaT; ///< Variation in t position (ns)
     int fTDist;     ///< How to distribute t  (gaus, or uniform)
+    std::optional<InTimeParticleSelector> fInTimeSelector; ///< Selection of the particles in time (if any)
 
     //Define TFS histograms.....
     /*
@@ -286,6 +293,12 @@ namespace evgen {
 
     double spmu[121][62][51];
     double fnmu[32401];
+
+    /// Cumulative distributions in the layout used by `sampling()`:
+    /// a running maximum keeps them sorted, so that a binary search finds
+    /// the same bin the original linear scan would.
+    std::vector<double> fCellCDF;   ///< `fnmu` over the (theta, phi) cells
+    std::vector<double> fEnergyCDF; ///< `spmu`, 121 energy bins per (depth, cos theta)
     double depth[360][91];
     double fmu[360][91];
     // for c2: e1 and e2 are unused
@@ -351,6 +364,8 @@ namespace evgen {
   {
     produces<std::vector<simb::MCTruth>>();
     produces<sumdata::RunData, art::InRun>();
+
+    fInTimeSelector = makeInTimeParticleSelector(pset, *art::ServiceHandle<geo::Geometry const>());
   }
 
   ////////////////////////////////////////////////////////////////////////////////
@@ -635,7 +650,8 @@ namespace evgen {
     simb::MCParticle part(trackid, PdgCode, primary);
     part.AddTrajectoryPoint(pos, pvec);
 
-    mct.Add(part);
+    // the statistics below describe the generated flux, in time or not
+    if (!fInTimeSelector || fInTimeSelector->keep(part)) mct.Add(part);
 
     theta = theta * 180 / M_PI;
     phi = phi * 180 / M_PI;
@@ -891,6 +907,37 @@ namespace evgen {
     FI = sc;
     for (int ipc1 = 0; ipc1 < ipc; ipc1++)
       fnmu[ipc1] = fnmu[ipc1] / fnmu[ipc - 1];
+
+    makeSamplingTables(ipc);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  //  makeSamplingTables
+  ////////////////////////////////////////////////////////////////////////////////
+  void
+  MUSUN::makeSamplingTables(int nCells)
+  {
+    // the first index with a value not smaller than x is the same in a
+    // sequence and in its running maximum
+    auto const runningMax = [](std::vector<double>::iterator begin,
+                               std::vector<double>::iterator end) {
+      for (auto it = begin + 1; it < end; ++it)
+        *it = std::max(*it, *(it - 1));
+    };
+
+    fCellCDF.assign(fnmu, fnmu + nCells);
+    runningMax(fCellCDF.begin(), fCellCDF.end());
+
+    // energy is the slowest index of spmu: copy each column contiguous
+    fEnergyCDF.resize(62 * 51 * 121);
+    for (int ip1 = 0; ip1 < 62; ++ip1) {
+      for (int ic1 = 0; ic1 < 51; ++ic1) {
+        auto const column = fEnergyCDF.begin() + (ip1 * 51 + ic1) * 121;
+        for (int j = 0; j < 121; ++j)
+          column[j] = spmu[j][ip1][ic1];
+        runningMax(column, column + 121);
+      }
+    }
   }
 
   ////////////////////////////////////////////////////////////////////////////////
@@ -906,35 +953,15 @@ namespace evgen {
     CLHEP::RandFlat flat(engine);
     CLHEP::RandGaussQ gauss(engine);
 
-#if 0 // this code is disabled for good
-    double xfl = flat.fire();
-    int loIndex = 0, hiIndex = 32400;
-    int i = (loIndex+hiIndex)/2;
-    bool foundIndex = false;
-    if( xfl < fnmu[loIndex] ) {
-      i = loIndex;
-      foundIndex = true;
-    } else if ( xfl > fnmu[hiIndex] ) {
-      i = hiIndex;
-      foundIndex = true;
-    } else if ( xfl > fnmu[i-1] && xfl <= fnmu[i] )
-      foundIndex = true;
-    while( !foundIndex ) {
-      if( xfl < fnmu[i] )
-	hiIndex = i;
-      else
-	loIndex = i;
-      i = (loIndex + hiIndex)/2;
+    // first bin with a cumulative value not smaller than x
+    auto const findBin = [](std::vector<double>::const_iterator begin,
+                            std::vector<double>::const_iterator end,
+                            double x) -> int {
+      return std::min(std::lower_bound(begin, end, x), end - 1) - begin;
+    };
 
-      if( xfl > fnmu[i-1] && xfl <= fnmu[i] )
-	foundIndex = true;
-    }
-#else
     double xfl = flat.fire();
-    int i = 0;
-    while (xfl > fnmu[i])
-      ++i;
-#endif
+    int i = findBin(fCellCDF.cbegin(), fCellCDF.cend(), xfl);
     int ic = (i - 2) / 360;
     int ip = i - 2 - ic * 360;
 
@@ -953,33 +980,8 @@ namespace evgen {
     if (ip1 > 61) ip1 = 61;
 
     xfl = flat.fire();
-#if 0
-    loIndex = 0, hiIndex = 120;
-    int j = (loIndex+hiIndex)/2;
-    foundIndex = false;
-    if( xfl < spmu[loIndex][ip1][ic1] ) {
-      j = loIndex;
-      foundIndex = true;
-    } else if ( xfl > spmu[hiIndex][ip1][ic1] ) {
-      j = hiIndex;
-      foundIndex = true;
-    } else if ( xfl > spmu[j-1][ip1][ic1] && xfl <= spmu[j][ip1][ic1] )
-      foundIndex = true;
-    while( !foundIndex ) {
-      if( xfl < spmu[j][ip1][ic1] )
-	hiIndex = j;
-      else
-	loIndex = j;
-      j = (loIndex + hiIndex)/2;
-
-      if( xfl > spmu[j-1][ip1][ic1] && xfl <= spmu[j][ip1][ic1] )
-	foundIndex = true;
-    }
-#else
-    int j = 0;
-    while (xfl > spmu[j][ip1][ic1])
-      ++j;
-#endif
+    auto const column = fEnergyCDF.cbegin() + (ip1 * 51 + ic1) * 121;
+    int j = findBin(column, column + 121, xfl);
 
     double En1 = 0.05 * (j - 1);
     double En2 = 0.05 * (j);
@@ -3,6 +3,14 @@
 //
 // NDK neutrino event generator
 //
+// The event with art event number N is the one numbered N-1 in the GENIE
+// event dump `NdkFile`. With `UseEventIndex`, the module seeks directly to
+// it, using an index of the events in the file (`evgen::TextEventIndex`)
+// read from `EventIndexFile` (default: the dump name with a `.idx` suffix)
+// or built at the start of the job (and saved there, if `WriteEventIndex`);
+// otherwise the file is read on from the last event, which requires the
+// events of the job to be in the order of the file.
+//
 // echurch@fnal.gov
 //
 ////////////////////////////////////////////////////////////////////////
@@ -26,6 +34,7 @@
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "fhiclcpp/ParameterSet.h"
+#include "cetlib_except/exception.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "art_root_io/TFileService.h"
 
@@ -39,6 +48,7 @@
 #include "nusimdata/SimulationBase/MCNeutrino.h"
 #include "larcore/Geometry/Geometry.h"
 #include "larcoreobj/SummaryData/RunData.h"
+#include "larsim/EventGenerator/TextEventIndex.h"
 
 #include "art/Framework/Core/EDProducer.h"
 
@@ -65,6 +75,8 @@ namespace evgen {
 
 	std::string         fNdkFile;
     std::ifstream       fEventFile;
+    bool                fUseEventIndex;  ///< Whether to seek each event with the index.
+    TextEventIndex      fEventIndex;     ///< Offsets of the events in `fNdkFile`.
 	TStopwatch          fStopwatch;      ///keep track of how long it takes to run the job
 
 	std::string fNDKModuleLabel;
@@ -109,6 +121,7 @@ namespace evgen{
     : EDProducer{pset}
     , fNdkFile{pset.get<std::string>("NdkFile")}
     , fEventFile{fNdkFile}
+    , fUseEventIndex{pset.get<bool>("UseEventIndex", false)}
       // create a default random engine; obtain the random seed from NuRandomService,
       // unless overridden in configuration with key "Seed"
     , fEngine(art::ServiceHandle<rndm::NuRandomService>{}->createEngine(*this, pset, "Seed"))
@@ -123,6 +136,19 @@ namespace evgen{
         << "Could not open file: " << fNdkFile << '\n';
     }
 
+    if (fUseEventIndex) {
+      bool const writeIndex = pset.get<bool>("WriteEventIndex", true);
+      auto const origin = fEventIndex.prepare(fNdkFile,
+                                              pset.get<std::string>("EventIndexFile", ""),
+                                              TextEventIndex::genieDumpFormat(),
+                                              writeIndex);
+      std::cout << "NDKGen: index of the " << fEventIndex.nEvents() << " events in " << fNdkFile
+                << ((origin == TextEventIndex::Origin::Read) ? " read" : " built")
+                << ((origin == TextEventIndex::Origin::Written) ? " and saved" : "")
+                << ((writeIndex && (origin == TextEventIndex::Origin::Built)) ? " (could not be saved)" : "")
+                << std::endl;
+    }
+
   }
 
   //____________________________________________________________________________
@@ -320,6 +346,17 @@ namespace evgen{
 
     int GenieEvt = -999;
 
+    if (fUseEventIndex) {
+      std::size_t const iEvent = evt.id().event() - 1;
+      if (iEvent >= fEventIndex.nEvents()) {
+        throw cet::exception("NDKGen")
+          << "Event " << evt.id() << " requested, but " << fNdkFile << " has only "
+          << fEventIndex.nEvents() << " events.\n";
+      }
+      fEventFile.clear();
+      fEventFile.seekg(fEventIndex.offset(iEvent));
+    }
+
     if(!fEventFile.good())
       std::cout << "NdkFile: Problem reading Ndk file" << std::endl;
 
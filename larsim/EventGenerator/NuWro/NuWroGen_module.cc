@@ -1846,7 +1846,7 @@ namespace evgen{
 
     // Loop over the particle stack for this event
     for(int i = 0; i < mc.NParticles(); ++i){
-      simb::MCParticle part(mc.GetParticle(i));
+      simb::MCParticle const& part = mc.GetParticle(i);
       std::string name;
       if (part.PdgCode() == 18040)
 	name = "Ar40 18040";
@@ -1873,7 +1873,7 @@ namespace evgen{
       ///look for the outgoing lepton in the particle stack
       ///just interested in the first one
       for(int i = 0; i < mc.NParticles(); ++i){
-	simb::MCParticle part(mc.GetParticle(i));
+	simb::MCParticle const& part = mc.GetParticle(i);
 	if(std::abs(part.PdgCode()) == 11){
 	  fEMomentum->Fill(part.P());
 	  fEDCosX->Fill(part.Px()/part.P());
@@ -1893,6 +1893,21 @@ namespace evgen{
       }// end loop over particles
     }//end if CC interaction
 
+    // count the final state particles once for all the classifications
+    unsigned int ii(0);
+    unsigned int p(0), n(0), pip(0), pim(0), pi0(0), pThresh(0.);
+    while(ii<NuWroTTree->post.size())
+      {
+	if  (NuWroTTree->out[ii].pdg==211) pip++;
+	if  (NuWroTTree->out[ii].pdg==-211) pim++;
+	if  (NuWroTTree->out[ii].pdg==111) pi0++;
+	if  (NuWroTTree->out[ii].pdg==2112) n++;
+	if  (NuWroTTree->out[ii].pdg==2212) p++;
+	if  (NuWroTTree->out[ii].pdg==2212 &&
+	     (NuWroTTree->out[ii].t/1000.-0.939)>0.050) pThresh++;
+	ii++;
+      }
+
     // fill fDyn
     double bin(0.0);
     double binNew(0.0);
@@ -1905,17 +1920,6 @@ namespace evgen{
     else if (NuWroTTree->flag.coh && NuWroTTree->flag.nc) bin = 13.;
     else if (NuWroTTree->flag.res)
       {
-	unsigned int ii(0);
-	unsigned int p(0), n(0), pip(0), pim(0), pi0(0);
-	while(ii<NuWroTTree->post.size())
-	  {
-	    if  (NuWroTTree->out[ii].pdg==211) pip++;
-	    if  (NuWroTTree->out[ii].pdg==-211) pim++;
-	    if  (NuWroTTree->out[ii].pdg==111) pi0++;
-	    if  (NuWroTTree->out[ii].pdg==2112) n++;
-	    if  (NuWroTTree->out[ii].pdg==2212) p++;
-	      ii++;
-	  }
 	if      (NuWroTTree->flag.cc &&  pip &&  p) bin = 3.;
 	else if (NuWroTTree->flag.cc &&  pi0 &&  p) bin = 4.;
 	else if (NuWroTTree->flag.cc &&  pip &&  n) bin = 5.;
@@ -1927,20 +1931,6 @@ namespace evgen{
 	  std::cout << "NuWroGen: bin=0 events, cc?" << NuWroTTree->flag.cc << " nc?: " << NuWroTTree->flag.nc << " Num protons: " << p << " Num pi+s: " << pip << " Num pi-s: " << pim << " Num pi0s: " << pi0 << " Num neutrons: " << n  << std::endl;
       }
 
-    unsigned int ii(0);
-    unsigned int p(0), n(0), pip(0), pim(0), pi0(0), pThresh(0.);
-    while(ii<NuWroTTree->post.size())
-      {
-	if  (NuWroTTree->out[ii].pdg==211) pip++;
-	if  (NuWroTTree->out[ii].pdg==-211) pim++;
-	if  (NuWroTTree->out[ii].pdg==111) pi0++;
-	if  (NuWroTTree->out[ii].pdg==2112) n++;
-	if  (NuWroTTree->out[ii].pdg==2212) p++;
-	if  (NuWroTTree->out[ii].pdg==2212 &&
-	     (NuWroTTree->out[ii].t/1000.-0.939)>0.050) pThresh++;
-	ii++;
-      }
-
     if      (NuWroTTree->flag.cc && p==0 && (pip+pim)==0) binNew = 1;
     else if (NuWroTTree->flag.cc && p==1 && (pip+pim)==0) binNew = 2;
     else if (NuWroTTree->flag.cc && p>=2 && (pip+pim)==0) binNew = 3;
@@ -26,7 +26,9 @@
 #include "CLHEP/Random/RandPoisson.h"
 
 // C++ includes
+#include <algorithm>
 #include <cmath>
+#include <map>
 
 namespace evgen {
 
@@ -65,6 +67,8 @@ namespace evgen {
 
     InitializeVectors();
 
+    InitializeStartLevelMap();
+
   }
 
   //----------------------------------------------------------------------------
@@ -168,7 +172,7 @@ namespace evgen {
   }
 
   //----------------------------------------------------------------------------
-  // Sample energy spectrum from fEnergyProbabilityMap
+  // Sample energy spectrum from the spectrum tables
   // or return a constant value
   double NueAr40CCGenerator::GetNeutrinoEnergy
                                          (CLHEP::HepRandomEngine& engine) const
@@ -178,37 +182,27 @@ namespace evgen {
 
     CLHEP::RandFlat randFlat(engine);
 
-    double neutrinoEnergy = 0.0;
-
     double randomNumber   = randFlat.fire();
 
-    // We need this to get a previous entry in the map
-    std::pair< double, double > previousPair;
-
-    for (std::map< double, double >::const_iterator energyProbability =
-          fEnergyProbabilityMap.begin(); energyProbability !=
-          fEnergyProbabilityMap.end(); ++energyProbability)
-    {
-      if (randomNumber < energyProbability->second)
-      {
-        if (energyProbability != fEnergyProbabilityMap.begin())
-        {
-          neutrinoEnergy = energyProbability->first -
-            (energyProbability->second - randomNumber)*
-            (energyProbability->first - previousPair.first)/
-            (energyProbability->second - previousPair.second);
-          break;
-        }
-        else
-        {
-          neutrinoEnergy = energyProbability->first;
-          break;
-        }
-      }
-      previousPair = *energyProbability;
-    }
-
-    return neutrinoEnergy;
+    // Find the first entry with cumulative probability above randomNumber,
+    // starting from the guide of the bin randomNumber falls in
+    std::size_t const nGuides = fSpectrumGuide.size();
+    std::size_t const guide   = std::min(
+      static_cast< std::size_t >(randomNumber*nGuides), nGuides - 1);
+    std::size_t point = fSpectrumGuide[guide];
+    std::size_t const numberOfPoints = fSpectrumProbabilities.size();
+    while (point < numberOfPoints &&
+           randomNumber >= fSpectrumProbabilities[point])
+      ++point;
+
+    if (point == numberOfPoints) return 0.0;
+    if (point == 0) return fSpectrumEnergies[0];
+
+    // Interpolate linearly with the previous entry
+    return fSpectrumEnergies[point] -
+      (fSpectrumProbabilities[point] - randomNumber)*
+      (fSpectrumEnergies[point] - fSpectrumEnergies[point - 1])/
+      (fSpectrumProbabilities[point] - fSpectrumProbabilities[point - 1]);
 
   }
 
@@ -243,12 +237,37 @@ namespace evgen {
     for (int point = 0; point < numberOfPoints; ++point)
       integral += fluxValues[point];
 
+    // Sort by energy (and keep the first of repeated energies)
+    std::map< double, double > energyProbabilityMap;
     double  probability    = 0.0;
     for (int point = 0; point < numberOfPoints; ++point)
     {
       probability += fluxValues[point]/integral;
-      fEnergyProbabilityMap.insert(std::make_pair(energyValues[point],
-                                                          probability));
+      energyProbabilityMap.insert(std::make_pair(energyValues[point],
+                                                         probability));
+    }
+
+    fSpectrumEnergies.clear();
+    fSpectrumProbabilities.clear();
+    for (auto const& energyProbability : energyProbabilityMap)
+    {
+      fSpectrumEnergies.push_back(energyProbability.first);
+      fSpectrumProbabilities.push_back(energyProbability.second);
+    }
+
+    if (fSpectrumProbabilities.empty())
+      throw cet::exception("NueAr40CCGenerator")
+        << "The neutrino energy spectrum in " << fullName << " is empty\n";
+
+    // One guide per spectrum point
+    std::size_t const nGuides = fSpectrumProbabilities.size();
+    fSpectrumGuide.resize(nGuides);
+    for (std::size_t guide = 0; guide < nGuides; ++guide)
+    {
+      double const binStart = static_cast< double >(guide)/nGuides;
+      fSpectrumGuide[guide] = std::upper_bound(fSpectrumProbabilities.begin(),
+        fSpectrumProbabilities.end(), binStart)
+        - fSpectrumProbabilities.begin();
     }
 
   }
@@ -833,6 +852,52 @@ namespace evgen {
     // I have to put checks that the arrays really
     // have as many elements as they should
 
+    // Time delays
+    // Seems like this is not implemented yet
+    fLevelDelay.assign(fNumberOfLevels, 0.0);
+
+  }
+
+  //----------------------------------------------------------------------------
+  // Find the level each start level begins the gamma cascade from
+  void NueAr40CCGenerator::InitializeStartLevelMap()
+  {
+
+    fStartLevelToLevel.clear();
+
+    for (int startLevel = 0; startLevel < fNumberOfStartLevels; ++startLevel)
+    {
+      double const startEnergy = fStartEnergyLevels.at(startLevel);
+
+      // The highest n for which startEnergy is higher than fEnergyLevels.at(n)
+      int highestHigher = 0;
+      // The lowest n for which startEnergy is lower than fEnergyLevels.at(n)
+      int lowestLower   = 0;
+
+      // Finding lowestLower and highestHigher
+      for (int n = 0; n < fNumberOfLevels; ++n)
+      {
+        if (startEnergy < fEnergyLevels.at(n))
+          lowestLower = n;
+        if (startEnergy > fEnergyLevels.at(n))
+        {
+          highestHigher = n;
+          break;
+        }
+      }
+
+      // The start level is assigned to the closest of the two levels
+      int level = -1;
+      double const lowerDistance  =
+                           std::abs(startEnergy - fEnergyLevels.at(lowestLower));
+      double const higherDistance =
+                         std::abs(startEnergy - fEnergyLevels.at(highestHigher));
+      if (lowerDistance < higherDistance) level = lowestLower;
+      if (higherDistance < lowerDistance) level = highestHigher;
+
+      fStartLevelToLevel.push_back(level);
+    }
+
   }
 
   //----------------------------------------------------------------------------
@@ -866,86 +931,32 @@ namespace evgen {
 
     double totalCrossSection = 0;
     // Calculating total cross section
-    for (std::vector< double >::iterator crossSection =
-                                                     levelCrossSections.begin();
-                       crossSection != levelCrossSections.end(); ++crossSection)
-      totalCrossSection += *crossSection;
+    for (double crossSection : levelCrossSections)
+      totalCrossSection += crossSection;
 
     if (totalCrossSection == 0)
       return false;
 
-    std::vector< double > startLevelProbabilities;
-    // Calculating each level's probability
-    for (std::vector< double >::iterator crossSection =
-                                                     levelCrossSections.begin();
-                       crossSection != levelCrossSections.end(); ++crossSection)
-      startLevelProbabilities.push_back((*crossSection)/totalCrossSection);
-
     double randomNumber     = randFlat.fire();
     double tprob            =  0;
     int    chosenStartLevel = -1;
     // Picking a starting level
     for (int level = 0; level < highestLevel; ++level)
     {
-      if (randomNumber < (startLevelProbabilities.at(level) + tprob))
+      double const startLevelProbability =
+                                levelCrossSections[level]/totalCrossSection;
+      if (randomNumber < (startLevelProbability + tprob))
       {
         chosenStartLevel = level;
         break;
       }
-      tprob += startLevelProbabilities.at(level);
+      tprob += startLevelProbability;
     }
 
-    int lastLevel = -1;
-    int level     = -1;
-
-    // Time delays
-    // Seems like this is not implemented yet
-    std::vector< double > levelDelay;
-    for (int n = 0; n < fNumberOfLevels; ++n) levelDelay.push_back(0.0);
-
-    // The highest n for which fStartEnergyLevels.at(chosenStartLevel)
-    // is higher than fEnergyLevels.at(n)
-    int highestHigher = 0;
-    // The lowest n for which fStartEnergyLevels.at(chosenStartLevel)
-    // is lower than fEnergyLevels.at(n)
-    int lowestLower   = 0;
-
-    // Finding lowestLower and highestHigher
-    for (int n = 0; n < fNumberOfLevels; ++n)
-    {
-      if (fStartEnergyLevels.at(chosenStartLevel) < fEnergyLevels.at(n))
-        lowestLower = n;
-      if (fStartEnergyLevels.at(chosenStartLevel) > fEnergyLevels.at(n))
-      {
-        highestHigher = n;
-        break;
-      }
-    }
-
-    if (std::abs(fStartEnergyLevels.at(chosenStartLevel) -
-                                           fEnergyLevels.at(lowestLower))
-          < std::abs(fStartEnergyLevels.at(chosenStartLevel)
-                                       - fEnergyLevels.at(highestHigher)))
-    {
-      lastLevel = lowestLower;
-      level     = lowestLower;
-    }
-    // If the chosen start level energy is closest to the lowest level energy
-    // that it's lower than than the highest level energy
-    // that it's higher than, it starts at the level of
-    // the lowest level energy that it's lower than
-
-    if (std::abs(fStartEnergyLevels.at(chosenStartLevel)
-                                     - fEnergyLevels.at(highestHigher))
-          < std::abs(fStartEnergyLevels.at(chosenStartLevel)
-                                       - fEnergyLevels.at(lowestLower)))
-    {
-      lastLevel = highestHigher;
-      level     = highestHigher;
-    }
-    // If the chosen start level energy is closest to the highest level energy
-    // that it's higher than than the lowest level energy that it's lower than,
-    // it starts at the level of the highest level energy that it's higher than
+    // The cascade starts from the level closest in energy
+    // to the chosen start level
+    int level     = fStartLevelToLevel.at(chosenStartLevel);
+    int lastLevel = level;
 
     std::vector< double > vertex = GetUniformPosition(engine);
 
@@ -1058,7 +1069,7 @@ namespace evgen {
           //double gammaM  = 0.0; // unused
 
           double gammaTime = (-TMath::Log(randFlat.fire())/
-                              (1/(levelDelay.at(lastLevel)))) + ttime;
+                              (1/(fLevelDelay.at(lastLevel)))) + ttime;
 
           // Adding the gamma to truth
 
@@ -1130,32 +1141,31 @@ namespace evgen {
   {
 
     highestLevel = 0;
-    std::vector< double > levelCrossSections;
+    std::vector< double > levelCrossSections(fNumberOfStartLevels, 0.0);
 
     // Loop through energy levels, if neutrino has enough energy,
-    // calculate cross section
+    // calculate cross section.
+    // The cross section of a level includes the terms of all the levels
+    // up to it: the start levels are sorted by energy, so the levels
+    // allowed by the neutrino energy are the first ones, and each
+    // cross section adds one term to the one of the previous level
+    double sigma = 0.0;
     for (int level = 0; level < fNumberOfStartLevels; ++level)
     {
       // Electron energy in keV
-      double w = (neutrinoEnergy - (fStartEnergyLevels.at(level) + 1.5))*1000;
+      double w = (neutrinoEnergy - (fStartEnergyLevels[level] + 1.5))*1000;
 
-      double sigma = 0.0;
-      if (neutrinoEnergy > (fStartEnergyLevels.at(level) + 1.5) && w >= 511.)
-      {
-        ++highestLevel;
-        for (int n = 0; n <= level; ++n)
-        {
-          // Electron energy for level n to use in cross section
-          w = (neutrinoEnergy - (fStartEnergyLevels.at(n) + 1.5))*1000;
-          // Electron momentum in keV/c
-          double p = std::sqrt(pow(w, 2) - pow(511.0, 2));
-          // Fermi function approximation
-          double f = std::sqrt(3.0634 + (0.6814/(w - 1)));
-          // In cm^2*10^-42
-          sigma += 1.6e-8*(p*w*f*fB.at(n));
-        }
-      }
-      levelCrossSections.push_back(sigma);
+      if (!(neutrinoEnergy > (fStartEnergyLevels[level] + 1.5) && w >= 511.))
+        break;
+
+      ++highestLevel;
+      // Electron momentum in keV/c
+      double p = std::sqrt(pow(w, 2) - pow(511.0, 2));
+      // Fermi function approximation
+      double f = std::sqrt(3.0634 + (0.6814/(w - 1)));
+      // In cm^2*10^-42
+      sigma += 1.6e-8*(p*w*f*fB[level]);
+      levelCrossSections[level] = sigma;
     }
 
     return levelCrossSections;
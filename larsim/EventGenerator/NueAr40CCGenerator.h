@@ -9,8 +9,8 @@
 //=============================================================================
 
 // C++ includes
+#include <cstddef>
 #include <vector>
-#include <map>
 #include <string>
 
 namespace CLHEP { class HepRandomEngine; }
@@ -50,11 +50,11 @@ namespace evgen {
       // from fNeutrinoTimeBegin to fNeutrinoTimeEnd
       double GetNeutrinoTime(CLHEP::HepRandomEngine& engine) const;
 
-      // Use fEnergyProbabilityMap to sample one energy value
+      // Use the spectrum tables to sample one energy value
       // or return a constant value
       double GetNeutrinoEnergy(CLHEP::HepRandomEngine& engine) const;
 
-      // Read a ROOT file with a TGraph  and fill fEnergyProbabilityMap
+      // Read a ROOT file with a TGraph and fill the spectrum tables
       // Assume that the first point in TGraph is { 0, 0 }
       void ReadNeutrinoSpectrum();
 
@@ -63,6 +63,9 @@ namespace evgen {
       // number and energy of gammas produced
       void InitializeVectors();
 
+      // Fill fStartLevelToLevel (needs the level vectors)
+      void InitializeStartLevelMap();
+
       // Simulate particles
       void CreateKinematicsVector(simb::MCTruth& truth,
                                   CLHEP::HepRandomEngine& engine) const;
@@ -73,8 +76,14 @@ namespace evgen {
       std::vector< double > CalculateCrossSections
                             (double neutrinoEnergy, int& highestLevel) const;
 
-      // Assume that the first entry is { 0, 0 }
-      std::map< double, double > fEnergyProbabilityMap;
+      // Energies of the spectrum and their cumulative probabilities,
+      // sorted by energy; assume that the first entry is { 0, 0 }
+      std::vector< double > fSpectrumEnergies;
+      std::vector< double > fSpectrumProbabilities;
+      // For each of fSpectrumGuide.size() equal bins of cumulative
+      // probability, the first entry above the lower edge of the bin:
+      // the sampling starts there, with (on average) about one step
+      std::vector< std::size_t > fSpectrumGuide;
 
       int fNumberOfLevels;
       int fNumberOfStartLevels;
@@ -86,6 +95,11 @@ namespace evgen {
       std::vector< double > fB;
       std::vector< double > fEnergyLevels;
 
+      // Level each start level is assigned to (closest energy)
+      std::vector< int > fStartLevelToLevel;
+      // Time delays of the levels
+      std::vector< double > fLevelDelay;
+
       // Generate monoenergetic neutrinos if this variable is set to true
       bool fMonoenergeticNeutrinos;
       // Energy of monoenergetic neutrinos
@@ -0,0 +1,66 @@
+/**
+ * @file   larsim/EventGenerator/POTSummaryAccumulator.cxx
+ * @brief  Sum of the protons on target of subruns, by run.
+ * @see    larsim/EventGenerator/POTSummaryAccumulator.h
+ */
+
+#include "larsim/EventGenerator/POTSummaryAccumulator.h"
+
+//------------------------------------------------------------------------------
+void
+sim::POTSummaryAccumulator::add(RunNumber_t run,
+                                SubRunNumber_t subRun,
+                                sumdata::POTSummary const& POT)
+{
+  ++fPresentSubrunFragments[{run, subRun}];
+  fRunPOT[run].aggregate(POT);
+}
+
+//------------------------------------------------------------------------------
+void
+sim::POTSummaryAccumulator::addMissing(RunNumber_t run, SubRunNumber_t subRun)
+{
+  ++fMissingSubrunFragments[{run, subRun}];
+}
+
+//------------------------------------------------------------------------------
+void
+sim::POTSummaryAccumulator::merge(POTSummaryAccumulator const& other)
+{
+  for (auto const& [id, n] : other.fPresentSubrunFragments)
+    fPresentSubrunFragments[id] += n;
+  for (auto const& [id, n] : other.fMissingSubrunFragments)
+    fMissingSubrunFragments[id] += n;
+  for (auto const& [run, POT] : other.fRunPOT)
+    fRunPOT[run].aggregate(POT);
+}
+
+//------------------------------------------------------------------------------
+std::map<sim::POTSummaryAccumulator::RunNumber_t, unsigned int>
+sim::POTSummaryAccumulator::subRunCounts() const
+{
+  std::map<RunNumber_t, unsigned int> subrunCount;
+  for (auto const& fragments : fPresentSubrunFragments)
+    ++subrunCount[fragments.first.first];
+  return subrunCount;
+}
+
+//------------------------------------------------------------------------------
+sumdata::POTSummary
+sim::POTSummaryAccumulator::totalPOT() const
+{
+  sumdata::POTSummary totalPOT;
+  for (auto const& runPOT : fRunPOT)
+    totalPOT.aggregate(runPOT.second);
+  return totalPOT;
+}
+
+//------------------------------------------------------------------------------
+std::string
+sim::POTSummaryAccumulator::to_string(sumdata::POTSummary const& POT)
+{
+  using namespace std::string_literals;
+  return std::to_string(POT.totgoodpot) + " good POT ( "s + std::to_string(POT.goodspills) +
+         " spills); total: " + std::to_string(POT.totpot) + " POT ( "s +
+         std::to_string(POT.totspills) + " spills)";
+}
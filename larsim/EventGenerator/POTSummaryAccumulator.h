@@ -0,0 +1,97 @@
+/**
+ * @file   larsim/EventGenerator/POTSummaryAccumulator.h
+ * @brief  Sum of the protons on target of subruns, by run.
+ * @see    larsim/EventGenerator/POTSummaryAccumulator.cxx
+ *
+ * The bookkeeping is shared by the `POTaccumulator` module and by the
+ * `sumPOT` program, which reads the subrun summaries directly from the files.
+ */
+
+#ifndef LARSIM_EVENTGENERATOR_POTSUMMARYACCUMULATOR_H
+#define LARSIM_EVENTGENERATOR_POTSUMMARYACCUMULATOR_H
+
+// LArSoft libraries
+#include "larcoreobj/SummaryData/POTSummary.h"
+
+// C/C++ standard libraries
+#include <cstddef> // std::size_t
+#include <map>
+#include <string>
+#include <utility> // std::pair
+
+namespace sim {
+
+  /**
+   * @brief Accumulates the POT of subrun fragments, by run.
+   *
+   * Each subrun fragment is added with or without its POT summary. If a
+   * subrun is met more than once, the information from all its fragments are
+   * added together (i.e. it is assumed that summary information is
+   * complementary rather than duplicate). Accumulators filled independently
+   * (e.g. from different files) can be merged.
+   */
+  class POTSummaryAccumulator {
+  public:
+    using RunNumber_t = unsigned int;
+    using SubRunNumber_t = unsigned int;
+    using SubRunKey_t = std::pair<RunNumber_t, SubRunNumber_t>; ///< (run, subrun)
+
+    /// Adds a fragment of the subrun `subRun` of `run` with summary `POT`.
+    void add(RunNumber_t run, SubRunNumber_t subRun, sumdata::POTSummary const& POT);
+
+    /// Adds a fragment of the subrun `subRun` of `run` with no POT summary.
+    void addMissing(RunNumber_t run, SubRunNumber_t subRun);
+
+    /// Adds all the content of `other`.
+    void merge(POTSummaryAccumulator const& other);
+
+    /// Count of subrun fragments with POT information, by subrun.
+    std::map<SubRunKey_t, unsigned int> const&
+    presentFragments() const
+    {
+      return fPresentSubrunFragments;
+    }
+
+    /// Count of subrun fragments without POT information, by subrun.
+    std::map<SubRunKey_t, unsigned int> const&
+    missingFragments() const
+    {
+      return fMissingSubrunFragments;
+    }
+
+    /// POT in each run.
+    std::map<RunNumber_t, sumdata::POTSummary> const&
+    runPOT() const
+    {
+      return fRunPOT;
+    }
+
+    /// Number of subruns with POT information in each run.
+    std::map<RunNumber_t, unsigned int> subRunCounts() const;
+
+    /// Number of subruns with POT information.
+    std::size_t
+    nSubRuns() const
+    {
+      return fPresentSubrunFragments.size();
+    }
+
+    /// Aggregated POT of all the runs.
+    sumdata::POTSummary totalPOT() const;
+
+    /// Converts the information from `POT` in a compact string.
+    static std::string to_string(sumdata::POTSummary const& POT);
+
+  private:
+    /// Count of subrun fragments with POT information.
+    std::map<SubRunKey_t, unsigned int> fPresentSubrunFragments;
+    /// Count of subrun fragments without POT information.
+    std::map<SubRunKey_t, unsigned int> fMissingSubrunFragments;
+    /// Partial count of POT in the run, per run.
+    std::map<RunNumber_t, sumdata::POTSummary> fRunPOT;
+
+  }; // class POTSummaryAccumulator
+
+} // namespace sim
+
+#endif // LARSIM_EVENTGENERATOR_POTSUMMARYACCUMULATOR_H
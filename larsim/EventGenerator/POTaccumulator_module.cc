@@ -7,20 +7,20 @@
 
 // LArSoft libraries
 #include "larcoreobj/SummaryData/POTSummary.h"
+#include "larsim/EventGenerator/POTSummaryAccumulator.h"
 
 // framework libraries
 #include "art/Framework/Core/EDAnalyzer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Handle.h"
 #include "art/Framework/Principal/SubRun.h"
-#include "art/Framework/Principal/SummedValue.h"
+#include "canvas/Persistency/Provenance/RunID.h"
+#include "canvas/Persistency/Provenance/SubRunID.h"
 #include "canvas/Utilities/InputTag.h"
 #include "fhiclcpp/types/Atom.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
-#include "range/v3/view.hpp"
 
 // C/C++ standard libraries
-#include <map>
 #include <string>
 
 // -----------------------------------------------------------------------------
@@ -51,6 +51,10 @@ namespace sim {
  * The module reads information from objects of type `sumdata::POTSummary`
  * stored in each _subrun_.
  *
+ * For large datasets, the `sumPOT` program computes the same sums reading only
+ * the subrun information of the files, several files at a time, without
+ * processing them with _art_.
+ *
  *
  * Configuration
  * --------------
@@ -128,14 +132,8 @@ private:
 
   // -- BEGIN -- Internal cache variables --------------------------------------
 
-  /// Count of subrun fragments with POT information.
-  std::map<art::SubRunID, unsigned int> fPresentSubrunFragments;
-
-  /// Count of subrun fragments without POT information.
-  std::map<art::SubRunID, unsigned int> fMissingSubrunFragments;
-
-  /// Partial count of POT in the run, per run.
-  std::map<art::RunID, art::SummedValue<sumdata::POTSummary>> fRunPOT;
+  /// Subrun fragments and their POT, by run.
+  sim::POTSummaryAccumulator fPOT;
 
   // -- END -- Internal cache variables ----------------------------------------
 
@@ -176,22 +174,20 @@ sim::POTaccumulator::endSubRun(art::SubRun const& subRun)
   //
   art::Handle<sumdata::POTSummary> summaryHandle;
   if (!subRun.getByLabel(fPOTtag, summaryHandle)) {
-    ++fMissingSubrunFragments[ID];
+    fPOT.addMissing(ID.run(), ID.subRun());
     mf::LogDebug(fSummaryOutputCategory)
       << "Fragment of subrun " << ID << " has no '" << fPOTtag.encode() << "' POT summary.";
     return;
   }
 
-  ++fPresentSubrunFragments[ID];
-
   //
   // accumulate the information by run
   //
   sumdata::POTSummary const& subRunPOT = *summaryHandle;
 
-  fRunPOT[ID.runID()].update(summaryHandle);
+  fPOT.add(ID.run(), ID.subRun(), subRunPOT);
   MF_LOG_TRACE(fSummaryOutputCategory)
-    << "Fragment #" << fPresentSubrunFragments[ID] << " of subrun " << ID << ": "
+    << "Fragment #" << fPOT.presentFragments().at({ID.run(), ID.subRun()}) << " of subrun " << ID << ": "
     << sim::POTaccumulator::to_string(subRunPOT);
 
 } // sim::POTaccumulator::endSubRun()
@@ -207,7 +203,7 @@ sim::POTaccumulator::endJob()
 
   if (!fRunOutputCategory.empty()) {
 
-    if (!fMissingSubrunFragments.empty()) printMissingSubrunList();
+    if (!fPOT.missingFragments().empty()) printMissingSubrunList();
 
     printRunSummary();
 
@@ -219,11 +215,7 @@ sim::POTaccumulator::endJob()
 
   // here we skip _art_ aggregation mechanism
   // because it can't handle multiple runs
-  sumdata::POTSummary totalPOT;
-  for (auto const& POT : fRunPOT | ranges::views::values)
-    totalPOT.aggregate(POT.value());
-
-  printSummary(totalPOT);
+  printSummary(fPOT.totalPOT());
 
 } // sim::POTaccumulator::endJob()
 
@@ -236,18 +228,22 @@ sim::POTaccumulator::printMissingSubrunList() const
   // missing fragments information
   //
   mf::LogVerbatim log{fRunOutputCategory};
-  log << size(fMissingSubrunFragments) << " subruns lack POT information:";
+  auto const& missing = fPOT.missingFragments();
+  auto const& present = fPOT.presentFragments();
+  log << size(missing) << " subruns lack POT information:";
 
-  auto const fend = fPresentSubrunFragments.cend();
+  auto const fend = present.cend();
 
-  for (auto const& [id, nMissing] : fMissingSubrunFragments) {
+  for (auto const& [id, nMissing] : missing) {
 
     // add to the count of fragments the ones which we have actually found
     unsigned int nFragments = nMissing;
-    auto const iFound = fPresentSubrunFragments.find(id);
+    auto const iFound = present.find(id);
     if (iFound != fend) nFragments += iFound->second;
 
-    log << "\n" << id << ": " << nMissing << " / " << nFragments << " \"fragments\"";
+    log << "\n"
+        << art::SubRunID{id.first, id.second} << ": " << nMissing << " / " << nFragments
+        << " \"fragments\"";
 
   } // for
 
@@ -259,15 +255,13 @@ sim::POTaccumulator::printRunSummary() const
 {
 
   // count subruns in run
-  std::map<art::RunID, unsigned int> subrunCount;
-  for (art::SubRunID const& ID : fPresentSubrunFragments | ranges::views::keys)
-    ++subrunCount[ID.runID()];
+  auto subrunCount = fPOT.subRunCounts();
 
   mf::LogVerbatim log{fRunOutputCategory};
-  log << "POT from " << size(fRunPOT) << " runs:";
-  for (auto const& [id, POT] : fRunPOT) {
-    log << "\n " << id << " (" << subrunCount[id]
-        << " subruns): " << sim::POTaccumulator::to_string(POT.value());
+  log << "POT from " << size(fPOT.runPOT()) << " runs:";
+  for (auto const& [run, POT] : fPOT.runPOT()) {
+    log << "\n " << art::RunID{run} << " (" << subrunCount[run]
+        << " subruns): " << sim::POTaccumulator::to_string(POT);
   } // for
 
 } // sim::POTaccumulator::printRunSummary()
@@ -279,7 +273,7 @@ sim::POTaccumulator::printSummary(sumdata::POTSummary const& totalPOT) const
 
   // aggregate all run summaries
   mf::LogVerbatim{fSummaryOutputCategory}
-    << "Aggregated POT from " << fRunPOT.size() << " runs (" << fPresentSubrunFragments.size()
+    << "Aggregated POT from " << fPOT.runPOT().size() << " runs (" << fPOT.nSubRuns()
     << " subruns): " << sim::POTaccumulator::to_string(totalPOT);
 
 } // sim::POTaccumulator::printSummary()
@@ -288,10 +282,7 @@ sim::POTaccumulator::printSummary(sumdata::POTSummary const& totalPOT) const
 std::string
 sim::POTaccumulator::to_string(sumdata::POTSummary const& POT)
 {
-  using namespace std::string_literals;
-  return std::to_string(POT.totgoodpot) + " good POT ( "s + std::to_string(POT.goodspills) +
-         " spills); total: " + std::to_string(POT.totpot) + " POT ( "s +
-         std::to_string(POT.totspills) + " spills)";
+  return sim::POTSummaryAccumulator::to_string(POT);
 } // sim::POTaccumulator::to_string(sumdata::POTSummary)
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,452 @@
+////////////////////////////////////////////////////////////////////////
+/// \file  RadioDepositGen_module.cc
+/// \brief Radiological decays from a library of pre-simulated deposits
+///
+/// Same decay rates as `RadioGen`, but each decay is replaced by the energy
+/// deposits of a decay simulated in advance, so that Geant4 is not run for
+/// the radiological background.
+////////////////////////////////////////////////////////////////////////
+
+// LArSoft libraries
+#include "larcore/Geometry/Geometry.h"
+#include "larcorealg/CoreUtils/counter.h"
+#include "larcorealg/CoreUtils/enumerate.h"
+#include "larcorealg/Geometry/GeoNodePath.h"
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "larcorealg/Geometry/ROOTGeometryNavigator.h"
+#include "larcorealg/Geometry/TransformationMatrix.h"
+#include "larcorealg/Geometry/geo_vectors_utils.h" // geo::vect::makeFromCoords()
+#include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h"
+#include "lardata/DetectorInfoServices/DetectorClocksService.h"
+#include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+#include "lardataalg/DetectorInfo/DetectorPropertiesData.h"
+#include "lardataalg/DetectorInfo/DetectorTimings.h"
+#include "lardataobj/Simulation/SimEnergyDeposit.h"
+#include "larsim/EventGenerator/RadioDepositLibrary.h"
+
+// framework libraries
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "canvas/Utilities/Exception.h"
+#include "cetlib/search_path.h"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+#include "nurandom/RandomUtils/NuRandomService.h"
+
+// ROOT
+#include "Math/GenVector/Quaternion.h"
+#include "TFile.h"
+#include "TGeoBBox.h"
+#include "TGeoManager.h"
+#include "TGeoMaterial.h"
+#include "TGeoNode.h"
+#include "TGeoVolume.h"
+#include "TTree.h"
+
+#include "CLHEP/Random/RandFlat.h"
+#include "CLHEP/Random/RandPoisson.h"
+
+// C/C++ standard libraries
+#include <algorithm> // std::min(), std::max()
+#include <cmath>
+#include <cstdlib> // std::abs()
+#include <map>
+#include <memory>
+#include <regex>
+#include <string>
+#include <utility> // std::pair<>
+#include <vector>
+
+namespace evgen {
+
+  /**
+   * @brief Radiological decays from pre-simulated energy deposits.
+   *
+   * The module generates radioactive decays in the same way as `RadioGen`
+   * does, with the same number of decays on average, in the same volumes and
+   * materials and in the same time window; but instead of producing the decay
+   * products, each decay is replaced by the energy deposits
+   * (`sim::SimEnergyDeposit`) of a decay of the same nuclide picked at random
+   * from a library. The cluster of deposits is moved to the decay point,
+   * optionally rotated by a random rotation around it, and delayed to the
+   * decay time. No Geant4 simulation is needed for these decays.
+   *
+   * The library is written by `RadioDepositLibraryMaker` from a regular
+   * simulation of the decays (`RadioGen` and LArG4); it must be simulated in
+   * liquid argon, since the deposits are added as they are regardless of the
+   * materials they fall into. Unless `RandomRotation` is enabled, each
+   * cluster keeps the orientation it had in the library, and the number of
+   * distinct decays is the size of the library.
+   *
+   * The output collection is by default tagged with the instance name of the
+   * deposits in the TPC active volume from LArG4, so that `IonAndScint`
+   * merges them with the ones of the other simulated particles, if any.
+   * The track IDs of each cluster are shifted so that those of different
+   * decays do not overlap, but they are not matched by any `simb::MCParticle`.
+   *
+   *
+   * Configuration parameters
+   * -------------------------
+   *
+   * * `X0`, `Y0`, `Z0`, `X1`, `Y1`, `Z1`, `Volumes`, `Nuclide`, `Material`,
+   *     `BqPercc`, `T0`, `T1`: the activity of each nuclide, with the same
+   *     meaning as in `RadioGen`;
+   * * `LibraryFile` (string, mandatory): ROOT file with the deposit library,
+   *     searched for in `FW_SEARCH_PATH`; each nuclide `N` is read from the
+   *     tree named `N`;
+   * * `LibraryDirectory` (string, default: empty): directory of the trees in
+   *     the library file (`RadioDepositLibraryMaker` writes them in a
+   *     directory named after its module label);
+   * * `RandomRotation` (flag, default: `true`): rotate each cluster around the
+   *     decay point by a random rotation;
+   * * `InstanceName` (string, default: `LArG4DetectorServicevolTPCActive`):
+   *     instance name of the produced `sim::SimEnergyDeposit` collection;
+   * * `Seed` (integer, optional): random seed, from `NuRandomService` if
+   *     omitted.
+   */
+  class RadioDepositGen : public art::EDProducer {
+  public:
+    explicit RadioDepositGen(fhicl::ParameterSet const& pset);
+
+  private:
+    void produce(art::Event& evt) override;
+
+    /// Adds all volumes with the specified name to the coordinates.
+    std::size_t addvolume(std::string const& volumeName);
+
+    /// Returns whether (`x`, `y`, `z`) is in a material selected for volume `i`.
+    bool inmaterial(TGeoManager& geomanager, unsigned int i, double x, double y, double z);
+
+    /// Adds the deposits of a random decay of nuclide `i` at `pos` and `time`.
+    void SampleDecay(unsigned int i,
+                     geo::Point_t const& pos,
+                     double time,
+                     std::vector<sim::SimEnergyDeposit>& deposits);
+
+    /// Returns the start and end of the readout window.
+    std::pair<double, double> defaulttimewindow() const;
+
+    std::vector<std::string> fNuclide; ///< Nuclide of each volume.
+    std::vector<std::string> fMaterial; ///< Regex of the decaying materials in each volume.
+    std::vector<double> fBq; ///< Activity in each volume [Bq/cm^3].
+    std::vector<double> fT0; ///< Beginning of the time window of each volume [ns].
+    std::vector<double> fT1; ///< End of the time window of each volume [ns].
+    std::vector<double> fX0; ///< Bottom corner x position (cm) in world coordinates
+    std::vector<double> fY0; ///< Bottom corner y position (cm) in world coordinates
+    std::vector<double> fZ0; ///< Bottom corner z position (cm) in world coordinates
+    std::vector<double> fX1; ///< Top corner x position (cm) in world coordinates
+    std::vector<double> fY1; ///< Top corner y position (cm) in world coordinates
+    std::vector<double> fZ1; ///< Top corner z position (cm) in world coordinates
+    bool fRandomRotation; ///< Whether to rotate the clusters at random.
+    std::string fInstanceName; ///< Instance name of the output collection.
+
+    std::vector<std::regex> fMaterialRegex; ///< Compiled `fMaterial` patterns.
+    /// Cached material selection outcome, for each volume.
+    std::vector<std::map<TGeoMaterial const*, bool>> fMaterialMatch;
+
+    std::map<std::string, RadioDepositLibrary> fLibraries; ///< Library of each nuclide.
+    std::vector<RadioDepositLibrary const*> fLibrary; ///< Library of each volume.
+    int fTrackIDOffset = 0; ///< Shift of the track IDs of the next decay.
+
+    CLHEP::HepRandomEngine& fEngine;
+  };
+
+  //____________________________________________________________________________
+  RadioDepositGen::RadioDepositGen(fhicl::ParameterSet const& pset)
+    : EDProducer{pset}
+    , fX0{pset.get<std::vector<double>>("X0", {})}
+    , fY0{pset.get<std::vector<double>>("Y0", {})}
+    , fZ0{pset.get<std::vector<double>>("Z0", {})}
+    , fX1{pset.get<std::vector<double>>("X1", {})}
+    , fY1{pset.get<std::vector<double>>("Y1", {})}
+    , fZ1{pset.get<std::vector<double>>("Z1", {})}
+    , fRandomRotation{pset.get<bool>("RandomRotation", true)}
+    , fInstanceName{pset.get<std::string>("InstanceName", "LArG4DetectorServicevolTPCActive")}
+    // create a default random engine; obtain the random seed from NuRandomService,
+    // unless overridden in configuration with key "Seed"
+    , fEngine(art::ServiceHandle<rndm::NuRandomService>{}->createEngine(*this, pset, "Seed"))
+  {
+    produces<std::vector<sim::SimEnergyDeposit>>(fInstanceName);
+
+    auto const nuclide = pset.get<std::vector<std::string>>("Nuclide");
+    auto const material = pset.get<std::vector<std::string>>("Material");
+    auto const Bq = pset.get<std::vector<double>>("BqPercc");
+    auto t0 = pset.get<std::vector<double>>("T0", {});
+    auto t1 = pset.get<std::vector<double>>("T1", {});
+
+    if (t0.empty() || t1.empty()) { // better be both empty...
+      if (!t0.empty() || !t1.empty()) {
+        throw art::Exception(art::errors::Configuration)
+          << "RadioDepositGen T0 and T1 need to be both non-empty, or both empty"
+             " (now T0 has "
+          << t0.size() << " entries and T1 has " << t1.size() << ")\n";
+      }
+      auto const [defaultT0, defaultT1] = defaulttimewindow();
+      t0.push_back(defaultT0);
+      t1.push_back(defaultT1);
+    }
+
+    // the explicit boxes first, then each name for all the volumes it matches
+    std::size_t const nCoords = fX0.size();
+    std::vector<std::size_t> entries; // the configuration entry of each volume
+    for (std::size_t iCoord : util::counter(nCoords))
+      entries.push_back(iCoord);
+    auto const volumes = pset.get<std::vector<std::string>>("Volumes", {});
+    for (auto&& [iVolume, volName] : util::enumerate(volumes)) {
+      auto const nVolumes = addvolume(volName);
+      if (nVolumes == 0) {
+        throw art::Exception(art::errors::Configuration)
+          << "No volume named '" << volName << "' was found!\n";
+      }
+      entries.insert(entries.end(), nVolumes, nCoords + iVolume);
+    }
+
+    if (entries.empty()) {
+      throw art::Exception(art::errors::Configuration) << "No nuclide configured!\n";
+    }
+    std::size_t const nEntries = nCoords + volumes.size();
+    if (nuclide.size() < nEntries || material.size() < nEntries || Bq.size() < nEntries) {
+      throw art::Exception(art::errors::Configuration)
+        << "RadioDepositGen needs a Nuclide, a Material and a BqPercc for each of the "
+        << nEntries << " volume entries (now " << nuclide.size() << ", " << material.size()
+        << " and " << Bq.size() << ")\n";
+    }
+    if (fY0.size() != nCoords || fZ0.size() != nCoords || fX1.size() != nCoords ||
+        fY1.size() != nCoords || fZ1.size() != nCoords) {
+      throw art::Exception(art::errors::Configuration)
+        << "RadioDepositGen coordinate vectors X0, Y0, Z0, X1, Y1 and Z1 have different sizes\n";
+    }
+
+    for (std::size_t const iEntry : entries) {
+      fNuclide.push_back(nuclide[iEntry]);
+      fMaterial.push_back(material[iEntry]);
+      fBq.push_back(Bq[iEntry]);
+      // replicate the last timing if none is specified
+      fT0.push_back(t0[std::min(iEntry, t0.size() - 1U)]);
+      fT1.push_back(t1[std::min(iEntry, t1.size() - 1U)]);
+      fMaterialRegex.emplace_back(fMaterial.back());
+      fMaterialMatch.emplace_back();
+    }
+
+    //
+    // read the library of each of the nuclides
+    //
+    std::string const libraryName = pset.get<std::string>("LibraryFile");
+    std::string const libraryDir = pset.get<std::string>("LibraryDirectory", "");
+    cet::search_path sp("FW_SEARCH_PATH");
+    std::string libraryPath;
+    if (!sp.find_file(libraryName, libraryPath)) {
+      throw art::Exception(art::errors::Configuration)
+        << "Deposit library file '" << libraryName << "' not found in FW_SEARCH_PATH!\n";
+    }
+    TFile libraryFile(libraryPath.c_str(), "READ");
+    if (libraryFile.IsZombie()) {
+      throw cet::exception("RadioDepositGen")
+        << "Deposit library file '" << libraryPath << "' could not be opened.\n";
+    }
+    for (std::string const& nuclideName : fNuclide) {
+      if (fLibraries.count(nuclideName)) continue;
+      std::string const treeName =
+        libraryDir.empty() ? nuclideName : (libraryDir + "/" + nuclideName);
+      TTree* tree = nullptr;
+      libraryFile.GetObject(treeName.c_str(), tree);
+      if (!tree) {
+        throw cet::exception("RadioDepositGen")
+          << "No tree '" << treeName << "' for nuclide " << nuclideName
+          << " in deposit library file '" << libraryPath << "'.\n";
+      }
+      RadioDepositLibrary library{*tree};
+      if (library.empty()) {
+        throw cet::exception("RadioDepositGen")
+          << "The library of nuclide " << nuclideName << " ('" << treeName << "' in '"
+          << libraryPath << "') is empty.\n";
+      }
+      mf::LogInfo("RadioDepositGen")
+        << nuclideName << ": " << library.size() << " decays with " << library.nDeposits()
+        << " deposits from '" << libraryPath << "'";
+      fLibraries.emplace(nuclideName, std::move(library));
+    }
+    for (std::string const& nuclideName : fNuclide)
+      fLibrary.push_back(&fLibraries.at(nuclideName));
+
+    mf::LogInfo log("RadioDepositGen");
+    log << "Configuring activity:";
+    for (std::size_t i = 0; i < fNuclide.size(); ++i) {
+      log << "\n[#" << i << "]  " << fNuclide[i] << " (" << fBq[i] << " Bq/cm^3)"
+          << " in " << fMaterial[i] << " from " << fT0[i] << " to " << fT1[i] << " ns in ( "
+          << fX0[i] << ", " << fY0[i] << ", " << fZ0[i] << ") to ( " << fX1[i] << ", " << fY1[i]
+          << ", " << fZ1[i] << ")";
+    }
+  }
+
+  //____________________________________________________________________________
+  void
+  RadioDepositGen::produce(art::Event& evt)
+  {
+    TGeoManager* geomanager = art::ServiceHandle<geo::Geometry const>()->ROOTGeoManager();
+
+    CLHEP::RandFlat flat(fEngine);
+    CLHEP::RandPoisson poisson(fEngine);
+
+    auto deposits = std::make_unique<std::vector<sim::SimEnergyDeposit>>();
+    fTrackIDOffset = 0;
+    for (unsigned int i = 0; i < fNuclide.size(); ++i) {
+      // same normalization as RadioGen: the whole box is assumed to be made of
+      // the radioactive material, and decays in other materials are skipped
+      double const rate =
+        std::abs(fBq[i] * (fT1[i] - fT0[i]) * (fX1[i] - fX0[i]) * (fY1[i] - fY0[i]) *
+                 (fZ1[i] - fZ0[i])) /
+        1.0E9;
+      long const ndecays = poisson.shoot(rate);
+      for (long idecay = 0; idecay < ndecays; ++idecay) {
+        geo::Point_t const pos{fX0[i] + flat.fire() * (fX1[i] - fX0[i]),
+                               fY0[i] + flat.fire() * (fY1[i] - fY0[i]),
+                               fZ0[i] + flat.fire() * (fZ1[i] - fZ0[i])};
+        double const time = fT0[i] + flat.fire() * (fT1[i] - fT0[i]);
+        if (!inmaterial(*geomanager, i, pos.X(), pos.Y(), pos.Z())) continue;
+        SampleDecay(i, pos, time, *deposits);
+      }
+    } // for nuclides
+
+    MF_LOG_DEBUG("RadioDepositGen") << deposits->size() << " energy deposits generated";
+    evt.put(std::move(deposits), fInstanceName);
+  }
+
+  //____________________________________________________________________________
+  void
+  RadioDepositGen::SampleDecay(unsigned int i,
+                               geo::Point_t const& pos,
+                               double time,
+                               std::vector<sim::SimEnergyDeposit>& deposits)
+  {
+    CLHEP::RandFlat flat(fEngine);
+    RadioDepositLibrary const& library = *fLibrary[i];
+
+    std::size_t const iCluster =
+      std::min(static_cast<std::size_t>(flat.fire() * library.size()), library.size() - 1U);
+
+    // uniformly distributed rotation (K. Shoemake, Graphics Gems III, 1992)
+    ROOT::Math::Quaternion rotation;
+    if (fRandomRotation) {
+      double const u1 = flat.fire();
+      double const a = 2.0 * M_PI * flat.fire();
+      double const b = 2.0 * M_PI * flat.fire();
+      double const r1 = std::sqrt(1.0 - u1);
+      double const r2 = std::sqrt(u1);
+      rotation.SetComponents(r2 * std::cos(b), r1 * std::sin(a), r1 * std::cos(a), r2 * std::sin(b));
+    }
+
+    geo::Vector_t const shift = pos - geo::origin();
+    int maxTrackID = 0;
+    for (auto edep = library.begin(iCluster); edep != library.end(iCluster); ++edep) {
+      geo::Vector_t start = edep->Start() - geo::origin();
+      geo::Vector_t end = edep->End() - geo::origin();
+      if (fRandomRotation) {
+        start = rotation(start);
+        end = rotation(end);
+      }
+      int const trackID = edep->TrackID();
+      int const absTrackID = std::abs(trackID);
+      maxTrackID = std::max(maxTrackID, absTrackID);
+      deposits.emplace_back(edep->NumPhotons(),
+                            edep->NumElectrons(),
+                            edep->ScintYieldRatio(),
+                            edep->Energy(),
+                            geo::origin() + start + shift,
+                            geo::origin() + end + shift,
+                            edep->StartT() + time,
+                            edep->EndT() + time,
+                            (trackID < 0) ? (trackID - fTrackIDOffset) : (trackID + fTrackIDOffset),
+                            edep->PdgCode());
+    }
+    fTrackIDOffset += maxTrackID;
+  }
+
+  //____________________________________________________________________________
+  bool
+  RadioDepositGen::inmaterial(TGeoManager& geomanager,
+                              unsigned int i,
+                              double x,
+                              double y,
+                              double z)
+  {
+    TGeoMaterial const* material = geomanager.FindNode(x, y, z)->GetMedium()->GetMaterial();
+    auto& matches = fMaterialMatch[i];
+    auto iMatch = matches.find(material);
+    if (iMatch == matches.end()) {
+      iMatch =
+        matches.emplace(material, std::regex_match(material->GetName(), fMaterialRegex[i])).first;
+    }
+    return iMatch->second;
+  }
+
+  //____________________________________________________________________________
+  std::size_t
+  RadioDepositGen::addvolume(std::string const& volumeName)
+  {
+    auto const& geom = *(lar::providerFrom<geo::Geometry>());
+
+    std::vector<geo::GeoNodePath> volumePaths;
+    auto findVolume = [&volumePaths, volumeName](auto& path) {
+      if (path.current().GetVolume()->GetName() == volumeName) volumePaths.push_back(path);
+      return true;
+    };
+
+    geo::ROOTGeometryNavigator navigator{*(geom.ROOTGeoManager())};
+    navigator.apply(findVolume);
+
+    for (geo::GeoNodePath const& path : volumePaths) {
+      TGeoShape const* pShape = path.current().GetVolume()->GetShape();
+      auto pBox = dynamic_cast<TGeoBBox const*>(pShape);
+      if (!pBox) {
+        throw cet::exception("RadioDepositGen")
+          << "Volume '" << path.current().GetName() << "' is a " << pShape->IsA()->GetName()
+          << ", not a TGeoBBox.\n";
+      }
+
+      geo::Point_t const origin = geo::vect::makeFromCoords<geo::Point_t>(pBox->GetOrigin());
+      geo::Vector_t const diag = {pBox->GetDX(), pBox->GetDY(), pBox->GetDZ()};
+
+      auto const trans = path.currentTransformation<geo::TransformationMatrix>();
+      geo::Point_t min, max;
+      trans.Transform(origin - diag, min);
+      trans.Transform(origin + diag, max);
+
+      fX0.push_back(std::min(min.X(), max.X()));
+      fY0.push_back(std::min(min.Y(), max.Y()));
+      fZ0.push_back(std::min(min.Z(), max.Z()));
+      fX1.push_back(std::max(min.X(), max.X()));
+      fY1.push_back(std::max(min.Y(), max.Y()));
+      fZ1.push_back(std::max(min.Z(), max.Z()));
+    } // for
+
+    return volumePaths.size();
+  } // RadioDepositGen::addvolume()
+
+  //____________________________________________________________________________
+  std::pair<double, double>
+  RadioDepositGen::defaulttimewindow() const
+  {
+    // as in RadioGen: from one readout window before the trigger time to the
+    // end of the simulated TPC waveform, in simulation time scale [ns]
+    using namespace detinfo::timescales;
+
+    auto const& timings = detinfo::makeDetectorTimings(
+      art::ServiceHandle<detinfo::DetectorClocksService>()->DataForJob());
+    detinfo::DetectorPropertiesData const& detInfo =
+      art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataForJob();
+
+    auto const trigTimeTick = timings.toTick<electronics_tick>(timings.TriggerTime());
+    electronics_time_ticks const beforeTicks{-static_cast<int>(detInfo.ReadOutWindowSize())};
+    electronics_time_ticks const afterTicks{detInfo.NumberTimeSamples()};
+
+    return {double(timings.toTimeScale<simulation_time>(trigTimeTick + beforeTicks)),
+            double(timings.toTimeScale<simulation_time>(trigTimeTick + afterTicks))};
+  } // RadioDepositGen::defaulttimewindow()
+
+} // namespace evgen
+
+DEFINE_ART_MODULE(evgen::RadioDepositGen)
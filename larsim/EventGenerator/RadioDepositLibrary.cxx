@@ -0,0 +1,176 @@
+/**
+ * @file   larsim/EventGenerator/RadioDepositLibrary.cxx
+ * @brief  Library of the energy deposits of single radiological decays.
+ * @see    larsim/EventGenerator/RadioDepositLibrary.h
+ */
+
+#include "larsim/EventGenerator/RadioDepositLibrary.h"
+
+#include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h"
+
+#include "cetlib_except/exception.h"
+
+#include "TTree.h"
+
+// C/C++ standard libraries
+#include <array>
+
+namespace {
+
+  /// Content of one tree entry, one element per deposit of the cluster.
+  struct ClusterBuffer_t {
+    static constexpr std::size_t NReals = 10U;
+    static constexpr std::size_t NInts = 4U;
+
+    static constexpr std::array<char const*, NReals> RealNames{{"startX",
+                                                                "startY",
+                                                                "startZ",
+                                                                "endX",
+                                                                "endY",
+                                                                "endZ",
+                                                                "startT",
+                                                                "endT",
+                                                                "energy",
+                                                                "scintYieldRatio"}};
+    static constexpr std::array<char const*, NInts> IntNames{
+      {"numElectrons", "numPhotons", "trackID", "pdgCode"}};
+
+    std::array<std::vector<float>, NReals> reals;
+    std::array<std::vector<int>, NInts> ints;
+
+    std::array<std::vector<float>*, NReals> realPtrs;
+    std::array<std::vector<int>*, NInts> intPtrs;
+
+    ClusterBuffer_t()
+    {
+      for (std::size_t i = 0; i < NReals; ++i)
+        realPtrs[i] = &reals[i];
+      for (std::size_t i = 0; i < NInts; ++i)
+        intPtrs[i] = &ints[i];
+    }
+
+    void
+    clear()
+    {
+      for (auto& v : reals)
+        v.clear();
+      for (auto& v : ints)
+        v.clear();
+    }
+
+    std::size_t
+    size() const
+    {
+      return ints[0].size();
+    }
+
+    void
+    push_back(sim::SimEnergyDeposit const& edep)
+    {
+      double const values[NReals] = {edep.StartX(),
+                                     edep.StartY(),
+                                     edep.StartZ(),
+                                     edep.EndX(),
+                                     edep.EndY(),
+                                     edep.EndZ(),
+                                     edep.StartT(),
+                                     edep.EndT(),
+                                     edep.Energy(),
+                                     edep.ScintYieldRatio()};
+      for (std::size_t i = 0; i < NReals; ++i)
+        reals[i].push_back(static_cast<float>(values[i]));
+      ints[0].push_back(edep.NumElectrons());
+      ints[1].push_back(edep.NumPhotons());
+      ints[2].push_back(edep.TrackID());
+      ints[3].push_back(edep.PdgCode());
+    }
+
+    sim::SimEnergyDeposit
+    deposit(std::size_t i) const
+    {
+      return {ints[1][i],
+              ints[0][i],
+              reals[9][i],
+              reals[8][i],
+              geo::Point_t{reals[0][i], reals[1][i], reals[2][i]},
+              geo::Point_t{reals[3][i], reals[4][i], reals[5][i]},
+              reals[6][i],
+              reals[7][i],
+              ints[2][i],
+              ints[3][i]};
+    }
+  }; // ClusterBuffer_t
+
+} // local namespace
+
+namespace evgen {
+
+  //----------------------------------------------------------------------------
+  RadioDepositLibrary::RadioDepositLibrary(TTree& tree)
+  {
+    ClusterBuffer_t buffer;
+    for (std::size_t i = 0; i < ClusterBuffer_t::NReals; ++i) {
+      if (tree.SetBranchAddress(ClusterBuffer_t::RealNames[i], &buffer.realPtrs[i]) < 0) {
+        throw cet::exception("RadioDepositLibrary")
+          << "Tree '" << tree.GetName() << "' has no valid branch '"
+          << ClusterBuffer_t::RealNames[i] << "'.\n";
+      }
+    }
+    for (std::size_t i = 0; i < ClusterBuffer_t::NInts; ++i) {
+      if (tree.SetBranchAddress(ClusterBuffer_t::IntNames[i], &buffer.intPtrs[i]) < 0) {
+        throw cet::exception("RadioDepositLibrary")
+          << "Tree '" << tree.GetName() << "' has no valid branch '"
+          << ClusterBuffer_t::IntNames[i] << "'.\n";
+      }
+    }
+
+    Long64_t const nEntries = tree.GetEntries();
+    fFirst.reserve(nEntries + 1);
+    for (Long64_t entry = 0; entry < nEntries; ++entry) {
+      tree.GetEntry(entry);
+      std::size_t const n = buffer.size();
+      bool sameSize = true;
+      for (auto const& v : buffer.reals)
+        sameSize = sameSize && (v.size() == n);
+      for (auto const& v : buffer.ints)
+        sameSize = sameSize && (v.size() == n);
+      if (!sameSize) {
+        throw cet::exception("RadioDepositLibrary")
+          << "Entry " << entry << " of tree '" << tree.GetName()
+          << "' has branches of different sizes.\n";
+      }
+      for (std::size_t i = 0; i < n; ++i)
+        fDeposits.push_back(buffer.deposit(i));
+      fFirst.push_back(fDeposits.size());
+    }
+    tree.ResetBranchAddresses();
+  } // RadioDepositLibrary::RadioDepositLibrary()
+
+  //----------------------------------------------------------------------------
+  void
+  RadioDepositLibrary::addCluster(std::vector<sim::SimEnergyDeposit> const& deposits)
+  {
+    fDeposits.insert(fDeposits.end(), deposits.begin(), deposits.end());
+    fFirst.push_back(fDeposits.size());
+  }
+
+  //----------------------------------------------------------------------------
+  void
+  RadioDepositLibrary::write(TTree& tree) const
+  {
+    ClusterBuffer_t buffer;
+    for (std::size_t i = 0; i < ClusterBuffer_t::NReals; ++i)
+      tree.Branch(ClusterBuffer_t::RealNames[i], &buffer.reals[i]);
+    for (std::size_t i = 0; i < ClusterBuffer_t::NInts; ++i)
+      tree.Branch(ClusterBuffer_t::IntNames[i], &buffer.ints[i]);
+
+    for (std::size_t iCluster = 0; iCluster < size(); ++iCluster) {
+      buffer.clear();
+      for (auto edep = begin(iCluster); edep != end(iCluster); ++edep)
+        buffer.push_back(*edep);
+      tree.Fill();
+    }
+    tree.ResetBranchAddresses();
+  } // RadioDepositLibrary::write()
+
+} // namespace evgen
@@ -0,0 +1,95 @@
+/**
+ * @file   larsim/EventGenerator/RadioDepositLibrary.h
+ * @brief  Library of the energy deposits of single radiological decays.
+ * @see    larsim/EventGenerator/RadioDepositLibrary.cxx
+ *
+ * The library is a ROOT tree with one entry per decay ("cluster"), each
+ * entry holding the `sim::SimEnergyDeposit` of the decay products, with
+ * positions and times relative to the decay point and time. It is written by
+ * the `RadioDepositLibraryMaker` module and used by `RadioDepositGen`.
+ */
+
+#ifndef LARSIM_EVENTGENERATOR_RADIODEPOSITLIBRARY_H
+#define LARSIM_EVENTGENERATOR_RADIODEPOSITLIBRARY_H
+
+#include "lardataobj/Simulation/SimEnergyDeposit.h"
+
+// C/C++ standard libraries
+#include <cstddef> // std::size_t
+#include <vector>
+
+class TTree;
+
+namespace evgen {
+
+  /**
+   * @brief Clusters of energy deposits of single decays, all in memory.
+   *
+   * Each cluster is the list of deposits from one decay, in the frame where
+   * the decay happens at the origin and at time `0`. The deposits of all the
+   * clusters are stored in a single sequence, with the index of the first one
+   * of each cluster.
+   *
+   * The tree has one entry per cluster, with the branches `startX`, `startY`,
+   * `startZ`, `endX`, `endY`, `endZ` (cm), `startT`, `endT` (ns), `energy`
+   * (MeV), `scintYieldRatio` (vectors of `float`) and `numElectrons`,
+   * `numPhotons`, `trackID`, `pdgCode` (vectors of `int`), with one element
+   * per deposit.
+   */
+  class RadioDepositLibrary {
+  public:
+    /// Creates an empty library.
+    RadioDepositLibrary() = default;
+
+    /// Reads all the clusters from `tree`.
+    explicit RadioDepositLibrary(TTree& tree);
+
+    /// Returns the number of clusters in the library.
+    std::size_t
+    size() const
+    {
+      return fFirst.size() - 1U;
+    }
+
+    /// Returns whether there is no cluster in the library.
+    bool
+    empty() const
+    {
+      return size() == 0U;
+    }
+
+    /// Returns the number of deposits in all clusters.
+    std::size_t
+    nDeposits() const
+    {
+      return fDeposits.size();
+    }
+
+    /// Pointer to the first deposit of cluster `i`.
+    sim::SimEnergyDeposit const*
+    begin(std::size_t i) const
+    {
+      return fDeposits.data() + fFirst[i];
+    }
+
+    /// Pointer past the last deposit of cluster `i`.
+    sim::SimEnergyDeposit const*
+    end(std::size_t i) const
+    {
+      return fDeposits.data() + fFirst[i + 1];
+    }
+
+    /// Adds a cluster with the specified deposits.
+    void addCluster(std::vector<sim::SimEnergyDeposit> const& deposits);
+
+    /// Fills `tree` (which must have no branch yet) with all the clusters.
+    void write(TTree& tree) const;
+
+  private:
+    std::vector<sim::SimEnergyDeposit> fDeposits; ///< Deposits of all clusters.
+    std::vector<std::size_t> fFirst{0U}; ///< First deposit of each cluster, and the end.
+  };
+
+} // namespace evgen
+
+#endif // LARSIM_EVENTGENERATOR_RADIODEPOSITLIBRARY_H
@@ -0,0 +1,176 @@
+////////////////////////////////////////////////////////////////////////
+/// \file  RadioDepositLibraryMaker_module.cc
+/// \brief Writes the library of deposits of radiological decays
+///
+/// Collects the energy deposits of simulated decays (e.g. `RadioGen` and
+/// LArG4) into the library used by `RadioDepositGen`.
+////////////////////////////////////////////////////////////////////////
+
+// LArSoft libraries
+#include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h"
+#include "lardataobj/Simulation/SimEnergyDeposit.h"
+#include "larsim/EventGenerator/RadioDepositLibrary.h"
+
+// nusimdata libraries
+#include "nusimdata/SimulationBase/MCParticle.h"
+
+// framework libraries
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileService.h"
+#include "canvas/Utilities/InputTag.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// ROOT libraries
+#include "TLorentzVector.h"
+#include "TTree.h"
+
+// C/C++ standard libraries
+#include <array>
+#include <cstdlib> // std::abs()
+#include <map>
+#include <string>
+#include <vector>
+
+namespace evgen {
+
+  /**
+   * @brief Writes the energy deposits of each simulated decay in a library.
+   *
+   * Every decay in the input events becomes an entry ("cluster") of the
+   * library, with the energy deposits of all its products, in the frame where
+   * the decay happened at the origin and at time `0`. Each deposit is
+   * assigned to the primary particle it descends from, following the mothers
+   * of its track in the simulated particles; all the primary particles
+   * starting from the same point at the same time are from the same decay.
+   * Deposits whose track can't be followed back to a primary are dropped.
+   *
+   * The library is written at the end of the job, as a tree named after the
+   * nuclide in the `TFileService` directory of this module.
+   *
+   * The decays should be simulated in a volume of liquid argon large enough
+   * to contain their deposits, and all the deposits should be saved (e.g.
+   * `FillSimEnergyDeposits` in `LArG4Parameters`). `RadioDepositGen` adds each
+   * deposit to its events, so deposits from outside the active volume are
+   * better left out.
+   *
+   * Configuration parameters
+   * -------------------------
+   *
+   * * `Nuclide` (string, mandatory): name of the library tree, which is the
+   *     nuclide name in `RadioDepositGen` configuration (e.g. `39Ar`);
+   * * `DepositLabel` (input tag, default: `largeant:TPCActive`): the
+   *     `sim::SimEnergyDeposit` collection of the decays;
+   * * `ParticleLabel` (input tag, default: `largeant`): the simulated
+   *     particles (`simb::MCParticle`) of the decays.
+   */
+  class RadioDepositLibraryMaker : public art::EDAnalyzer {
+  public:
+    explicit RadioDepositLibraryMaker(fhicl::ParameterSet const& pset);
+
+  private:
+    void analyze(art::Event const& evt) override;
+    void endJob() override;
+
+    std::string fNuclide; ///< Name of the library tree.
+    art::InputTag fDepositTag; ///< Collection of the deposits to be stored.
+    art::InputTag fParticleTag; ///< Collection of the simulated particles.
+
+    RadioDepositLibrary fLibrary; ///< The library being collected.
+    unsigned long fNDropped = 0U; ///< Number of deposits with no primary particle.
+  };
+
+  //____________________________________________________________________________
+  RadioDepositLibraryMaker::RadioDepositLibraryMaker(fhicl::ParameterSet const& pset)
+    : EDAnalyzer{pset}
+    , fNuclide{pset.get<std::string>("Nuclide")}
+    , fDepositTag{pset.get<art::InputTag>("DepositLabel", "largeant:TPCActive")}
+    , fParticleTag{pset.get<art::InputTag>("ParticleLabel", "largeant")}
+  {
+    consumes<std::vector<sim::SimEnergyDeposit>>(fDepositTag);
+    consumes<std::vector<simb::MCParticle>>(fParticleTag);
+  }
+
+  //____________________________________________________________________________
+  void
+  RadioDepositLibraryMaker::analyze(art::Event const& evt)
+  {
+    auto const& deposits = *evt.getValidHandle<std::vector<sim::SimEnergyDeposit>>(fDepositTag);
+    auto const& particles = *evt.getValidHandle<std::vector<simb::MCParticle>>(fParticleTag);
+
+    std::map<int, simb::MCParticle const*> particleByID;
+    for (simb::MCParticle const& particle : particles)
+      particleByID[particle.TrackId()] = &particle;
+
+    // the decay of each primary particle, and the start of each decay
+    std::map<int, std::size_t> decayOfPrimary;
+    std::map<std::array<double, 4U>, std::size_t> decayIndex;
+    std::vector<TLorentzVector> decayStart;
+    std::vector<std::vector<sim::SimEnergyDeposit>> clusters;
+    for (simb::MCParticle const& particle : particles) {
+      if (particle.Mother() != 0) continue;
+      TLorentzVector const& start = particle.Position(0);
+      std::array<double, 4U> const key{{start.X(), start.Y(), start.Z(), start.T()}};
+      auto const iDecay = decayIndex.emplace(key, decayStart.size()).first;
+      if (iDecay->second == decayStart.size()) {
+        decayStart.push_back(start);
+        clusters.emplace_back();
+      }
+      decayOfPrimary[particle.TrackId()] = iDecay->second;
+    }
+
+    for (sim::SimEnergyDeposit const& edep : deposits) {
+      // follow the track back to its primary particle
+      int trackID = std::abs(edep.TrackID());
+      auto iParticle = particleByID.find(trackID);
+      while ((iParticle != particleByID.end()) && (iParticle->second->Mother() != 0))
+        iParticle = particleByID.find(iParticle->second->Mother());
+      if (iParticle == particleByID.end()) {
+        ++fNDropped;
+        continue;
+      }
+      std::size_t const iDecay = decayOfPrimary.at(iParticle->second->TrackId());
+
+      TLorentzVector const& start = decayStart[iDecay];
+      geo::Vector_t const shift{start.X(), start.Y(), start.Z()};
+      clusters[iDecay].emplace_back(edep.NumPhotons(),
+                                    edep.NumElectrons(),
+                                    edep.ScintYieldRatio(),
+                                    edep.Energy(),
+                                    edep.Start() - shift,
+                                    edep.End() - shift,
+                                    edep.StartT() - start.T(),
+                                    edep.EndT() - start.T(),
+                                    edep.TrackID(),
+                                    edep.PdgCode());
+    } // for deposits
+
+    for (auto const& cluster : clusters)
+      fLibrary.addCluster(cluster);
+
+    MF_LOG_DEBUG("RadioDepositLibraryMaker")
+      << evt.id() << ": " << clusters.size() << " decays, library now has " << fLibrary.size();
+  }
+
+  //____________________________________________________________________________
+  void
+  RadioDepositLibraryMaker::endJob()
+  {
+    TTree* tree = art::ServiceHandle<art::TFileService>()->make<TTree>(
+      fNuclide.c_str(), ("Energy deposits of " + fNuclide + " decays").c_str());
+    fLibrary.write(*tree);
+
+    mf::LogInfo log("RadioDepositLibraryMaker");
+    log << "Library of " << fNuclide << " written with " << fLibrary.size() << " decays and "
+        << fLibrary.nDeposits() << " deposits";
+    if (fNDropped > 0) {
+      log << "; " << fNDropped << " deposits not coming from a primary particle were dropped";
+    }
+  }
+
+} // namespace evgen
+
+DEFINE_ART_MODULE(evgen::RadioDepositLibraryMaker)
@@ -32,8 +32,14 @@
 // C++ includes.
 #include <string>
 #include <regex>
+#include <algorithm>
 #include <cmath>
 #include <memory>
+#include <vector>
+#include <array>
+#include <map>
+#include <optional>
+#include <cstdint>
 #include <iterator>
 #include <utility> // std::pair<>
 #include <cassert>
@@ -81,6 +87,7 @@
 #include "larcorealg/CoreUtils/counter.h"
 #include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h"
 #include "larcoreobj/SummaryData/RunData.h"
+#include "larsim/EventGenerator/InTimeParticleSelector.h"
 
 // root includes
 
@@ -88,8 +95,6 @@
 #include "TGenPhaseSpace.h"
 #include "TMath.h"
 #include "TFile.h"
-#include "TH1.h"
-#include "TH1D.h"
 #include "TGraph.h"
 
 #include "CLHEP/Random/RandFlat.h"
@@ -180,6 +185,17 @@ namespace evgen {
    *     ticks after the trigger time equivalent to the full simulated TPC
    *     waveform (`detinfo::DetectorPropertiesData::NumberTimeSamples()`);
    *     this makes it a quite poor default, so you may want to avoid it.
+   * * `AcceptanceVoxelSize` (real, default: `0`): if positive, each volume is
+   *     divided at the start of the job into cubic cells of about this size
+   *     (in centimeters), and the material is looked up at the corners of
+   *     each cell; decays are then generated only in cells with at least one
+   *     corner in a matching material, and the material is checked decay by
+   *     decay only in the cells where the corners disagree. This greatly
+   *     reduces the number of geometry queries when a volume only partially
+   *     overlaps the selected materials, but it will miss features of the
+   *     selected material thinner than the cell size which fall completely
+   *     between corners. With the default value, the positions are sampled
+   *     in the whole volume and each is checked against the geometry.
    * 
    */
   class RadioGen : public art::EDProducer {
@@ -212,8 +228,93 @@ namespace evgen {
     void Ar42Gamma4(std::vector<std::tuple<ti_PDGID, td_Mass, TLorentzVector>>& v_prods);
     void Ar42Gamma5(std::vector<std::tuple<ti_PDGID, td_Mass, TLorentzVector>>& v_prods);
 
-    // recoded so as to use the LArSoft-managed random number generator
-    double samplefromth1d(TH1D& hist);
+    /**
+     * @brief Walker alias table to sample a binned decay spectrum.
+     *
+     * The bins are one unit wide and start from 0, one per point of the
+     * spectrum graph. A draw picks a bin with probability proportional to its
+     * content, and a uniformly distributed position within that bin, from a
+     * single random number and in constant time.
+     */
+    class SpectrumSampler {
+    public:
+      SpectrumSampler() = default;
+
+      /// Builds the table from the `nBins` bin contents; `name` is used in errors.
+      SpectrumSampler(double const* content, std::size_t nBins, std::string const& name);
+
+      /// Returns whether there is no spectrum at all.
+      bool empty() const { return fProb.empty(); }
+
+      /// Returns the sum of the bin contents.
+      double integral() const { return fIntegral; }
+
+      /// Returns a value in [ 0, number of bins ) given a uniform `r` in [ 0, 1 ).
+      double sample(double r) const;
+
+    private:
+      std::vector<double> fProb;       ///< Probability to keep each bin rather than its alias.
+      std::vector<std::size_t> fAlias; ///< The bin drawn when the bin is not kept.
+      double fIntegral = 0.0;          ///< Sum of the bin contents.
+    }; // class SpectrumSampler
+
+    // uses the LArSoft-managed random number generator
+    double samplefromspectrum(SpectrumSampler const& spectrum);
+
+    /**
+     * @brief Cells of a volume box, classified by material at their corners.
+     *
+     * The box is divided in cells no larger than the requested size on each
+     * side. A cell is a candidate for decays if any of its corners passes the
+     * material selection, and it is `mixed` if not all of them do: in the
+     * latter case the selection needs to be checked for each decay.
+     */
+    class AcceptanceMap {
+    public:
+      AcceptanceMap() = default;
+
+      /// Builds the map of the box, with `accept(x, y, z)` the material selection.
+      template <typename Accept>
+      AcceptanceMap(geo::Point_t const& lower, geo::Point_t const& upper,
+                    double cellSize, Accept&& accept);
+
+      /// Returns whether the map has been built.
+      bool empty() const { return fCells.empty(); }
+
+      /// Fraction of the box volume in candidate cells.
+      double candidateFraction() const;
+
+      /**
+       * @brief Samples `n` positions uniformly in the candidate cells.
+       * @param n the number of positions to sample
+       * @param flat uniform random number generator
+       * @param accept the material selection, evaluated in mixed cells
+       * @param positions (output) the positions passing the selection
+       *
+       * All the random numbers are drawn at once. On average,
+       * `n * candidateFraction()` positions in the whole box are replaced by
+       * `n` in the candidate cells, so that the density of the accepted
+       * positions is the same as with plain rejection sampling in the box.
+       */
+      template <typename Accept>
+      void sample(std::size_t n, CLHEP::RandFlat& flat, Accept&& accept,
+                  std::vector<geo::Point_t>& positions) const;
+
+    private:
+      std::array<std::size_t, 3U> fNCells {{ 0U, 0U, 0U }};
+      std::array<double, 3U> fLower {{ 0.0, 0.0, 0.0 }};
+      std::array<double, 3U> fSize {{ 0.0, 0.0, 0.0 }}; ///< Cell size on each axis.
+      std::vector<std::uint32_t> fCells; ///< Candidate cells, mixed ones flagged by `MixedBit`.
+
+      static constexpr std::uint32_t MixedBit = 0x80000000U;
+    }; // class AcceptanceMap
+
+    /// Returns whether (`x`, `y`, `z`) is in a material selected for volume `i`.
+    bool inmaterial
+      (TGeoManager& geomanager, unsigned int i, double x, double y, double z);
+
+    /// Adds the products of one decay of nuclide `i` at `pos` to `mct`.
+    void SampleDecay(unsigned int i, TLorentzVector const& pos, simb::MCTruth &mct);
     
     /// Prints the settings for the specified nuclide and volume.
     template <typename Stream>
@@ -247,6 +348,12 @@ namespace evgen {
     std::vector<double> fY1;             ///< Top corner y position (cm) in world coordinates
     std::vector<double> fZ1;             ///< Top corner z position (cm) in world coordinates
     bool                fIsFirstSignalSpecial;
+    std::optional<InTimeParticleSelector> fInTimeSelector; ///< Selection of the particles in time (if any)
+    double              fAcceptanceVoxelSize; ///< Size of the acceptance map cells [cm] (0: no map).
+    std::vector<AcceptanceMap> fAcceptance;  ///< Acceptance map of each volume.
+    std::vector<std::regex> fMaterialRegex;  ///< Compiled `fMaterial` patterns.
+    /// Cached material selection outcome, for each volume.
+    std::vector<std::map<TGeoMaterial const*, bool>> fMaterialMatch;
     int trackidcounter;                  ///< Serial number for the MC track ID
 
 
@@ -255,16 +362,105 @@ namespace evgen {
     // TGenPhaseSpace rg;  // put this here so we don't constantly construct and destruct it
 
     std::vector<std::string> spectrumname;
-    std::vector<std::unique_ptr<TH1D>> alphaspectrum;
+    std::vector<SpectrumSampler> alphaspectrum;
     std::vector<double> alphaintegral;
-    std::vector<std::unique_ptr<TH1D>> betaspectrum;
+    std::vector<SpectrumSampler> betaspectrum;
     std::vector<double> betaintegral;
-    std::vector<std::unique_ptr<TH1D>> gammaspectrum;
+    std::vector<SpectrumSampler> gammaspectrum;
     std::vector<double> gammaintegral;
-    std::vector<std::unique_ptr<TH1D>> neutronspectrum;
+    std::vector<SpectrumSampler> neutronspectrum;
     std::vector<double> neutronintegral;
     CLHEP::HepRandomEngine& fEngine;
   };
+
+  //____________________________________________________________________________
+  template <typename Accept>
+  RadioGen::AcceptanceMap::AcceptanceMap
+    (geo::Point_t const& lower, geo::Point_t const& upper, double cellSize, Accept&& accept)
+  {
+    double const low[3] = { lower.X(), lower.Y(), lower.Z() };
+    double const high[3] = { upper.X(), upper.Y(), upper.Z() };
+    for (std::size_t axis = 0; axis < 3U; ++axis) {
+      double const length = high[axis] - low[axis];
+      fNCells[axis] = std::max
+        (static_cast<std::size_t>(std::ceil(length / cellSize)), std::size_t(1));
+      fLower[axis] = low[axis];
+      fSize[axis] = length / fNCells[axis];
+    }
+    std::size_t const nCells = fNCells[0] * fNCells[1] * fNCells[2];
+    if (nCells >= MixedBit) {
+      throw cet::exception("RadioGen") << "Acceptance map with " << nCells
+        << " cells is too large: choose a larger AcceptanceVoxelSize.\n";
+    }
+
+    // the selection at the corners, one plane of nodes at a time
+    std::size_t const nx = fNCells[0] + 1, ny = fNCells[1] + 1;
+    auto const evalPlane = [&](std::size_t iz, std::vector<std::uint8_t>& plane)
+      {
+        plane.resize(nx * ny);
+        double const z = fLower[2] + iz * fSize[2];
+        for (std::size_t iy = 0; iy < ny; ++iy) {
+          double const y = fLower[1] + iy * fSize[1];
+          for (std::size_t ix = 0; ix < nx; ++ix)
+            plane[iy * nx + ix] = accept(fLower[0] + ix * fSize[0], y, z)? 1: 0;
+        }
+      };
+    std::vector<std::uint8_t> front, back;
+    evalPlane(0, front);
+    std::uint32_t cell = 0;
+    for (std::size_t iz = 0; iz < fNCells[2]; ++iz) {
+      evalPlane(iz + 1, back);
+      for (std::size_t iy = 0; iy < fNCells[1]; ++iy) {
+        for (std::size_t ix = 0; ix < fNCells[0]; ++ix, ++cell) {
+          std::size_t const k = iy * nx + ix;
+          unsigned int const nAccepted
+            = front[k] + front[k + 1] + front[k + nx] + front[k + nx + 1]
+            + back[k] + back[k + 1] + back[k + nx] + back[k + nx + 1];
+          if (nAccepted == 0) continue;
+          fCells.push_back((nAccepted == 8)? cell: (cell | MixedBit));
+        }
+      }
+      std::swap(front, back);
+    }
+  } // RadioGen::AcceptanceMap::AcceptanceMap()
+
+
+  //____________________________________________________________________________
+  inline double RadioGen::AcceptanceMap::candidateFraction() const {
+    return double(fCells.size()) / (fNCells[0] * fNCells[1] * fNCells[2]);
+  }
+
+
+  //____________________________________________________________________________
+  template <typename Accept>
+  void RadioGen::AcceptanceMap::sample(std::size_t n, CLHEP::RandFlat& flat,
+    Accept&& accept, std::vector<geo::Point_t>& positions) const
+  {
+    positions.clear();
+    if (fCells.empty() || (n == 0)) return;
+
+    // four random numbers per position: the cell, and the point within it
+    std::vector<double> r(4 * n);
+    flat.fireArray(static_cast<int>(r.size()), r.data());
+
+    positions.reserve(n);
+    std::size_t const nCandidates = fCells.size();
+    for (std::size_t i = 0; i < n; ++i) {
+      double const* u = r.data() + 4 * i;
+      std::uint32_t const code = fCells
+        [std::min(static_cast<std::size_t>(u[0] * nCandidates), nCandidates - 1)];
+      std::uint32_t const cell = code & ~MixedBit;
+      std::size_t const ix = cell % fNCells[0];
+      std::size_t const iy = (cell / fNCells[0]) % fNCells[1];
+      std::size_t const iz = cell / (fNCells[0] * fNCells[1]);
+      double const x = fLower[0] + (ix + u[1]) * fSize[0];
+      double const y = fLower[1] + (iy + u[2]) * fSize[1];
+      double const z = fLower[2] + (iz + u[3]) * fSize[2];
+      if ((code & MixedBit) && !accept(x, y, z)) continue;
+      positions.emplace_back(x, y, z);
+    }
+  } // RadioGen::AcceptanceMap::sample()
+
 }
 
 namespace {
@@ -286,13 +482,15 @@ namespace evgen{
     , fY1{pset.get< std::vector<double> >("Y1", {})}
     , fZ1{pset.get< std::vector<double> >("Z1", {})}
     , fIsFirstSignalSpecial{pset.get< bool >("IsFirstSignalSpecial", false)}
+    , fAcceptanceVoxelSize{pset.get< double >("AcceptanceVoxelSize", 0.0)}
     // create a default random engine; obtain the random seed from NuRandomService,
     // unless overridden in configuration with key "Seed"
     , fEngine(art::ServiceHandle<rndm::NuRandomService>{}->createEngine(*this, pset, "Seed"))
   {
     produces< std::vector<simb::MCTruth> >();
     produces< sumdata::RunData, art::InRun >();
-    
+
+    fInTimeSelector = makeInTimeParticleSelector(pset, *art::ServiceHandle<geo::Geometry const>());
     
     auto const nuclide = pset.get< std::vector<std::string>>("Nuclide");
     auto const material = pset.get< std::vector<std::string>>("Material");
@@ -399,6 +597,31 @@ namespace evgen{
         readfile(nuclideName,searchName);
       }
     }
+
+    if (fAcceptanceVoxelSize > 0.0) {
+      TGeoManager* const geomanager
+        = lar::providerFrom<geo::Geometry>()->ROOTGeoManager();
+      for (unsigned int i=0; i<nsize; ++i) {
+        fMaterialRegex.emplace_back(fMaterial[i]);
+        fMaterialMatch.emplace_back();
+      }
+      for (unsigned int i=0; i<nsize; ++i) {
+        fAcceptance.emplace_back(
+          geo::Point_t{ std::min(fX0[i], fX1[i]), std::min(fY0[i], fY1[i]), std::min(fZ0[i], fZ1[i]) },
+          geo::Point_t{ std::max(fX0[i], fX1[i]), std::max(fY0[i], fY1[i]), std::max(fZ0[i], fZ1[i]) },
+          fAcceptanceVoxelSize,
+          [this, geomanager, i](double x, double y, double z)
+            { return inmaterial(*geomanager, i, x, y, z); }
+          );
+        mf::LogInfo("RadioGen") << "Volume #" << i << ": "
+          << (100.0 * fAcceptance.back().candidateFraction())
+          << "% of the volume is in cells with " << fMaterial[i];
+      }
+    }
+    else if (fAcceptanceVoxelSize < 0.0) {
+      throw art::Exception(art::errors::Configuration)
+        << "RadioGen AcceptanceVoxelSize must not be negative (" << fAcceptanceVoxelSize << ")\n";
+    }
   }
 
   //____________________________________________________________________________
@@ -504,6 +727,24 @@ namespace evgen{
     // we will skip over decays in other materials later.
 
     double rate = fabs( fBq[i] * (fT1[i] - fT0[i]) * (fX1[i] - fX0[i]) * (fY1[i] - fY0[i]) * (fZ1[i] - fZ0[i]) ) / 1.0E9;
+
+    if (!fAcceptance.empty())
+    {
+      // the decays in the box not falling in candidate cells are not even generated
+      std::vector<geo::Point_t> positions;
+      fAcceptance[i].sample(poisson.shoot(rate * fAcceptance[i].candidateFraction()), flat,
+        [this, geomanager, i](double x, double y, double z)
+          { return inmaterial(*geomanager, i, x, y, z); },
+        positions);
+      for (auto&& [ idecay, position ]: util::enumerate(positions))
+      {
+        TLorentzVector const pos( position.X(), position.Y(), position.Z(),
+          (idecay==0 && fIsFirstSignalSpecial) ? 0 : ( fT0[i] + flat.fire()*(fT1[i] - fT0[i]) ) );
+        SampleDecay(i, pos, mct);
+      }
+      return;
+    }
+
     long ndecays = poisson.shoot(rate);
 
     std::regex const re_material{fMaterial[i]};
@@ -523,83 +764,108 @@ namespace evgen{
       std::string volmaterial = geomanager->FindNode(pos.X(),pos.Y(),pos.Z())->GetMedium()->GetMaterial()->GetName();
         if (!std::regex_match(volmaterial, re_material)) continue;
 
-      //Moved pdgid into the next statement, so that it is localized.
-      // electron=11, photon=22, alpha = 1000020040, neutron = 2112
+      SampleDecay(i, pos, mct);
+    }
+  }
 
-      //JStock: Allow us to have different particles from the same decay. This requires multiple momenta.
-      std::vector<std::tuple<ti_PDGID, td_Mass, TLorentzVector>> v_prods; //(First is for PDGID, second is mass, third is Momentum)
+  //____________________________________________________________________________
+  void RadioGen::SampleDecay(unsigned int i, TLorentzVector const& pos, simb::MCTruth &mct)
+  {
+    CLHEP::RandFlat     flat(fEngine);
 
-      if (fNuclide[i] == "222Rn")          // Treat 222Rn separately
-      {
-        double p=0; double t=0.00548952; td_Mass m=m_alpha; ti_PDGID pdgid=1000020040; //td_Mass = double. ti_PDGID = int;
-        double energy = t + m;
-        double p2     = energy*energy - m*m;
-        if (p2 > 0) p = TMath::Sqrt(p2);
-        else        p = 0;
-            v_prods.emplace_back(pdgid, m, dirCalc(p, m));
-      }//End special case RN222
-      else if(fNuclide[i] == "59Ni"){ //Treat 59Ni Calibration Source separately (as I haven't made a spectrum for it, and ultimately it should be handeled with multiple particle outputs.
-        double p=0.008997; td_Mass m=0; ti_PDGID pdgid=22; // td_Mas=double. ti_PDFID=int. Assigning p directly, as t=p for gammas.
-          v_prods.emplace_back(pdgid, m, dirCalc(p,m));
-      }//end special case Ni59 calibration source
-      else if(fNuclide[i] == "42Ar"){   // Spot for special treatment of Ar42.
-        double p=0; double t=0; td_Mass m = 0; ti_PDGID pdgid=0; //td_Mass = double. ti_PDGID = int;
-        double bSelect = flat.fire();   //Make this a random number from 0 to 1.
-        if(bSelect<0.819){              //beta channel 1. No Gamma. beta Q value 3525.22 keV
-          samplespectrum("42Ar_1", pdgid, t, m, p);
-            v_prods.emplace_back(pdgid, m, dirCalc(p, m));
-          //No gamma here.
-        }else if(bSelect<0.9954){       //beta channel 2. 1 Gamma (1524.6 keV). beta Q value 2000.62
-          samplespectrum("42Ar_2", pdgid, t, m, p);
-            v_prods.emplace_back(pdgid, m, dirCalc(p, m));
-          Ar42Gamma2(v_prods);
-        }else if(bSelect<0.9988){       //beta channel 3. 1 Gamma Channel. 312.6 keV + gamma 2. beta Q value 1688.02 keV
-          samplespectrum("42Ar_3", pdgid, t, m, p);
-            v_prods.emplace_back(pdgid, m, dirCalc(p, m));
-          Ar42Gamma3(v_prods);
-        }else if(bSelect<0.9993){       //beta channel 4. 2 Gamma Channels. Either 899.7 keV (i 0.052) + gamma 2 or 2424.3 keV (i 0.020). beta Q value 1100.92 keV
-          samplespectrum("42Ar_4", pdgid, t, m, p);
-            v_prods.emplace_back(pdgid, m, dirCalc(p, m));
-          Ar42Gamma4(v_prods);
-        }else{                          //beta channel 5. 3 gamma channels. 692.0 keV + 1228.0 keV + Gamma 2 (i 0.0033) ||OR|| 1021.2 keV + gamma 4 (i 0.0201) ||OR|| 1920.8 keV + gamma 2 (i 0.041). beta Q value 79.82 keV
-          samplespectrum("42Ar_5", pdgid, t, m, p);
-            v_prods.emplace_back(pdgid, m, dirCalc(p, m));
-          Ar42Gamma5(v_prods);
-        }
-        //Add beta.
-        //Call gamma function for beta mode.
+    //Moved pdgid into the next statement, so that it is localized.
+    // electron=11, photon=22, alpha = 1000020040, neutron = 2112
+
+    //JStock: Allow us to have different particles from the same decay. This requires multiple momenta.
+    std::vector<std::tuple<ti_PDGID, td_Mass, TLorentzVector>> v_prods; //(First is for PDGID, second is mass, third is Momentum)
+
+    if (fNuclide[i] == "222Rn")          // Treat 222Rn separately
+    {
+      double p=0; double t=0.00548952; td_Mass m=m_alpha; ti_PDGID pdgid=1000020040; //td_Mass = double. ti_PDGID = int;
+      double energy = t + m;
+      double p2     = energy*energy - m*m;
+      if (p2 > 0) p = TMath::Sqrt(p2);
+      else        p = 0;
+          v_prods.emplace_back(pdgid, m, dirCalc(p, m));
+    }//End special case RN222
+    else if(fNuclide[i] == "59Ni"){ //Treat 59Ni Calibration Source separately (as I haven't made a spectrum for it, and ultimately it should be handeled with multiple particle outputs.
+      double p=0.008997; td_Mass m=0; ti_PDGID pdgid=22; // td_Mas=double. ti_PDFID=int. Assigning p directly, as t=p for gammas.
+        v_prods.emplace_back(pdgid, m, dirCalc(p,m));
+    }//end special case Ni59 calibration source
+    else if(fNuclide[i] == "42Ar"){   // Spot for special treatment of Ar42.
+      double p=0; double t=0; td_Mass m = 0; ti_PDGID pdgid=0; //td_Mass = double. ti_PDGID = int;
+      double bSelect = flat.fire();   //Make this a random number from 0 to 1.
+      if(bSelect<0.819){              //beta channel 1. No Gamma. beta Q value 3525.22 keV
+        samplespectrum("42Ar_1", pdgid, t, m, p);
+          v_prods.emplace_back(pdgid, m, dirCalc(p, m));
+        //No gamma here.
+      }else if(bSelect<0.9954){       //beta channel 2. 1 Gamma (1524.6 keV). beta Q value 2000.62
+        samplespectrum("42Ar_2", pdgid, t, m, p);
+          v_prods.emplace_back(pdgid, m, dirCalc(p, m));
+        Ar42Gamma2(v_prods);
+      }else if(bSelect<0.9988){       //beta channel 3. 1 Gamma Channel. 312.6 keV + gamma 2. beta Q value 1688.02 keV
+        samplespectrum("42Ar_3", pdgid, t, m, p);
+          v_prods.emplace_back(pdgid, m, dirCalc(p, m));
+        Ar42Gamma3(v_prods);
+      }else if(bSelect<0.9993){       //beta channel 4. 2 Gamma Channels. Either 899.7 keV (i 0.052) + gamma 2 or 2424.3 keV (i 0.020). beta Q value 1100.92 keV
+        samplespectrum("42Ar_4", pdgid, t, m, p);
+          v_prods.emplace_back(pdgid, m, dirCalc(p, m));
+        Ar42Gamma4(v_prods);
+      }else{                          //beta channel 5. 3 gamma channels. 692.0 keV + 1228.0 keV + Gamma 2 (i 0.0033) ||OR|| 1021.2 keV + gamma 4 (i 0.0201) ||OR|| 1920.8 keV + gamma 2 (i 0.041). beta Q value 79.82 keV
+        samplespectrum("42Ar_5", pdgid, t, m, p);
+          v_prods.emplace_back(pdgid, m, dirCalc(p, m));
+        Ar42Gamma5(v_prods);
       }
-      else{ //General Case.
-        double p=0; double t=0; td_Mass m = 0; ti_PDGID pdgid=0; //td_Mass = double. ti_PDGID = int;
-        samplespectrum(fNuclide[i],pdgid,t,m,p);
-        std::tuple<ti_PDGID, td_Mass, TLorentzVector> partMassMom = std::make_tuple(pdgid, m, dirCalc(p,m));
-        v_prods.push_back(partMassMom);
-      }//end else (not RN or other special case
-
-      //JStock: Modify this to now loop over the v_prods.
-      for(auto prodEntry : v_prods){
-        // set track id to a negative serial number as these are all primary particles and have id <= 0
-        int trackid = trackidcounter;
-        ti_PDGID pdgid = std::get<0>(prodEntry);
-        td_Mass  m = std::get<1>(prodEntry);
-        TLorentzVector pvec = std::get<2>(prodEntry);
-        trackidcounter--;
-        std::string primary("primary");
-
-        // alpha particles need a little help since they're not in the TDatabasePDG table
-        // // so don't rely so heavily on default arguments to the MCParticle constructor
-        if (pdgid == 1000020040){
-          simb::MCParticle part(trackid, pdgid, primary,-1,m,1);
-          part.AddTrajectoryPoint(pos, pvec);
-          mct.Add(part);
-        }// end "If alpha"
-        else{
-          simb::MCParticle part(trackid, pdgid, primary);
-          part.AddTrajectoryPoint(pos, pvec);
-          mct.Add(part);
-        }// end All standard cases.
-      }//End Loop over all particles produces in this single decay.
+      //Add beta.
+      //Call gamma function for beta mode.
+    }
+    else{ //General Case.
+      double p=0; double t=0; td_Mass m = 0; ti_PDGID pdgid=0; //td_Mass = double. ti_PDGID = int;
+      samplespectrum(fNuclide[i],pdgid,t,m,p);
+      std::tuple<ti_PDGID, td_Mass, TLorentzVector> partMassMom = std::make_tuple(pdgid, m, dirCalc(p,m));
+      v_prods.push_back(partMassMom);
+    }//end else (not RN or other special case
+
+    //JStock: Modify this to now loop over the v_prods.
+    for(auto prodEntry : v_prods){
+      // set track id to a negative serial number as these are all primary particles and have id <= 0
+      int trackid = trackidcounter;
+      ti_PDGID pdgid = std::get<0>(prodEntry);
+      td_Mass  m = std::get<1>(prodEntry);
+      TLorentzVector pvec = std::get<2>(prodEntry);
+      trackidcounter--;
+      std::string primary("primary");
+
+      // alpha particles need a little help since they're not in the TDatabasePDG table
+      // // so don't rely so heavily on default arguments to the MCParticle constructor
+      if (pdgid == 1000020040){
+        simb::MCParticle part(trackid, pdgid, primary,-1,m,1);
+        part.AddTrajectoryPoint(pos, pvec);
+        if (fInTimeSelector && !fInTimeSelector->keep(part)) continue;
+        mct.Add(part);
+      }// end "If alpha"
+      else{
+        simb::MCParticle part(trackid, pdgid, primary);
+        part.AddTrajectoryPoint(pos, pvec);
+        if (fInTimeSelector && !fInTimeSelector->keep(part)) continue;
+        mct.Add(part);
+      }// end All standard cases.
+    }//End Loop over all particles produces in this single decay.
+  }
+
+  //____________________________________________________________________________
+  bool RadioGen::inmaterial
+    (TGeoManager& geomanager, unsigned int i, double x, double y, double z)
+  {
+    TGeoMaterial const* material
+      = geomanager.FindNode(x, y, z)->GetMedium()->GetMaterial();
+    auto& matches = fMaterialMatch[i];
+    auto iMatch = matches.find(material);
+    if (iMatch == matches.end()) {
+      iMatch = matches.emplace
+        (material, std::regex_match(material->GetName(), fMaterialRegex[i])).first;
     }
+    return iMatch->second;
   }
 
   //Calculate an arbitrary direction with a given magnitude p
@@ -618,7 +884,7 @@ namespace evgen{
                           std::sqrt(p*p+m*m)};
   }
 
-  // only reads those files that are on the fNuclide list.  Copy information from the TGraphs to TH1D's
+  // only reads those files that are on the fNuclide list.  Copy information from the TGraphs to alias tables
 
   void RadioGen::readfile(std::string nuclide, std::string const& filename)
   {
@@ -637,10 +903,6 @@ namespace evgen{
     }
     if (!found) return;
 
-    Bool_t addStatus = TH1::AddDirectoryStatus();
-    TH1::AddDirectory(kFALSE); // cloned histograms go in memory, and aren't deleted when files are closed.
-    // be sure to restore this state when we're out of the routine.
-
     spectrumname.push_back(nuclide);
     cet::search_path sp("FW_SEARCH_PATH");
     std::string fn2 = "Radionuclides/";
@@ -654,104 +916,27 @@ namespace evgen{
         << " not found in FW_SEARCH_PATH!\n";
 
     TFile f(fullname.c_str(),"READ");
-    TGraph *alphagraph = (TGraph*) f.Get("Alphas");
-    TGraph *betagraph = (TGraph*) f.Get("Betas");
-    TGraph *gammagraph = (TGraph*) f.Get("Gammas");
-    TGraph *neutrongraph = (TGraph*) f.Get("Neutrons");
-
-    if (alphagraph)
-    {
-      int np = alphagraph->GetN();
-      double *y = alphagraph->GetY();
-      std::string name;
-      name = "RadioGen_";
-      name += nuclide;
-      name += "_Alpha";
-        auto alphahist = std::make_unique<TH1D>(name.c_str(),"Alpha Spectrum",np,0,np);
-        for (int i=0; i<np; i++) {
-        alphahist->SetBinContent(i+1,y[i]);
-        alphahist->SetBinError(i+1,0);
-      }
-      alphaintegral.push_back(alphahist->Integral());
-        alphaspectrum.push_back(move(alphahist));
-    }
-    else
-    {
-      alphaintegral.push_back(0);
-        alphaspectrum.push_back(nullptr);
-    }
-
-
-    if (betagraph)
-    {
-      int np = betagraph->GetN();
-
-      double *y = betagraph->GetY();
-      std::string name;
-      name = "RadioGen_";
-      name += nuclide;
-      name += "_Beta";
-        auto betahist = std::make_unique<TH1D>(name.c_str(),"Beta Spectrum",np,0,np);
-        for (int i=0; i<np; i++) {
-        betahist->SetBinContent(i+1,y[i]);
-        betahist->SetBinError(i+1,0);
-      }
-      betaintegral.push_back(betahist->Integral());
-        betaspectrum.push_back(move(betahist));
-    }
-    else
-    {
-      betaintegral.push_back(0);
-        betaspectrum.push_back(nullptr);
-    }
-
-    if (gammagraph)
-    {
-      int np = gammagraph->GetN();
-      double *y = gammagraph->GetY();
-      std::string name;
-      name = "RadioGen_";
-      name += nuclide;
-      name += "_Gamma";
-        auto gammahist = std::make_unique<TH1D>(name.c_str(),"Gamma Spectrum",np,0,np);
-        for (int i=0; i<np; i++) {
-        gammahist->SetBinContent(i+1,y[i]);
-        gammahist->SetBinError(i+1,0);
-      }
-      gammaintegral.push_back(gammahist->Integral());
-        gammaspectrum.push_back(move(gammahist));
-    }
-    else
-    {
-      gammaintegral.push_back(0);
-        gammaspectrum.push_back(nullptr);
-    }
-
-    if (neutrongraph)
-    {
-      int np = neutrongraph->GetN();
-      double *y = neutrongraph->GetY();
-      std::string name;
-      name = "RadioGen_";
-      name += nuclide;
-      name += "_Neutron";
-        auto neutronhist = std::make_unique<TH1D>(name.c_str(),"Neutron Spectrum",np,0,np);
-      for (int i=0; i<np; i++)
+    auto readspectrum = [&f,&nuclide](char const* graphname, char const* particle,
+                                      std::vector<SpectrumSampler>& spectrum,
+                                      std::vector<double>& integral)
       {
-        neutronhist->SetBinContent(i+1,y[i]);
-        neutronhist->SetBinError(i+1,0);
-      }
-      neutronintegral.push_back(neutronhist->Integral());
-        neutronspectrum.push_back(move(neutronhist));
-    }
-    else
-    {
-      neutronintegral.push_back(0);
-        neutronspectrum.push_back(nullptr);
-    }
-
+        TGraph *graph = (TGraph*) f.Get(graphname);
+        if (graph)
+        {
+          std::string const name = "RadioGen_" + nuclide + "_" + particle;
+          spectrum.emplace_back(graph->GetY(), graph->GetN(), name);
+        }
+        else
+        {
+          spectrum.emplace_back();
+        }
+        integral.push_back(spectrum.back().integral());
+      };
+    readspectrum("Alphas", "Alpha", alphaspectrum, alphaintegral);
+    readspectrum("Betas", "Beta", betaspectrum, betaintegral);
+    readspectrum("Gammas", "Gamma", gammaspectrum, gammaintegral);
+    readspectrum("Neutrons", "Neutron", neutronspectrum, neutronintegral);
     f.Close();
-    TH1::AddDirectory(addStatus);
 
     double total = alphaintegral.back() + betaintegral.back() + gammaintegral.back() + neutronintegral.back();
     if (total>0)
@@ -791,29 +976,29 @@ namespace evgen{
     p = 0;
     for (int itry=0;itry<10;itry++) // maybe a tiny normalization issue with a sum of 0.99999999999 or something, so try a few times.
     {
-        if (rtype <= alphaintegral[inuc] && alphaspectrum[inuc] != nullptr)
+        if (rtype <= alphaintegral[inuc] && !alphaspectrum[inuc].empty())
       {
         itype = 1000020040; // alpha
         m = m_alpha;
-            t = samplefromth1d(*alphaspectrum[inuc])/1000000.0;
+            t = samplefromspectrum(alphaspectrum[inuc])/1000000.0;
       }
-        else if (rtype <= alphaintegral[inuc]+betaintegral[inuc] && betaspectrum[inuc] != nullptr)
+        else if (rtype <= alphaintegral[inuc]+betaintegral[inuc] && !betaspectrum[inuc].empty())
       {
         itype = 11; // beta
         m = m_e;
-            t = samplefromth1d(*betaspectrum[inuc])/1000000.0;
+            t = samplefromspectrum(betaspectrum[inuc])/1000000.0;
       }
-        else if ( rtype <= alphaintegral[inuc] + betaintegral[inuc] + gammaintegral[inuc] && gammaspectrum[inuc] != nullptr)
+        else if ( rtype <= alphaintegral[inuc] + betaintegral[inuc] + gammaintegral[inuc] && !gammaspectrum[inuc].empty())
       {
         itype = 22; // gamma
         m = 0;
-            t = samplefromth1d(*gammaspectrum[inuc])/1000000.0;
+            t = samplefromspectrum(gammaspectrum[inuc])/1000000.0;
       }
-        else if( neutronspectrum[inuc] != nullptr)
+        else if( !neutronspectrum[inuc].empty())
       {
         itype = 2112;
         m     = m_neutron;
-            t     = samplefromth1d(*neutronspectrum[inuc])/1000000.0;
+            t     = samplefromspectrum(neutronspectrum[inuc])/1000000.0;
       }
       if (itype >= 0) break;
     }
@@ -829,36 +1014,64 @@ namespace evgen{
     { p=0; }
   }
 
-  // this is just a copy of TH1::GetRandom that uses the art-managed CLHEP random number generator instead of gRandom
-  // and a better handling of negative bin contents
-
-  double RadioGen::samplefromth1d(TH1D& hist)
+  // Vose's construction of the alias table: the bins with less than the
+  // average content are topped up with the excess of those with more
+  RadioGen::SpectrumSampler::SpectrumSampler
+    (double const* content, std::size_t nBins, std::string const& name)
+    : fProb(nBins, 0.0), fAlias(nBins, 0)
   {
-    CLHEP::RandFlat  flat(fEngine);
-
-    int nbinsx = hist.GetNbinsX();
-    std::vector<double> partialsum;
-    partialsum.resize(nbinsx+1);
-    partialsum[0] = 0;
+    for (std::size_t i = 0; i < nBins; ++i)
+    {
+      if (content[i] < 0) throw cet::exception("RadioGen") << "Negative bin:  " << (i+1) << " " << name << "\n";
+      fIntegral += content[i];
+    }
+    if (fIntegral == 0) return;
 
-    for (int i=1;i<=nbinsx;i++)
+    std::vector<std::size_t> small, large;
+    for (std::size_t i = 0; i < nBins; ++i)
     {
-        double hc = hist.GetBinContent(i);
-        if ( hc < 0) throw cet::exception("RadioGen") << "Negative bin:  " << i << " " << hist.GetName() << "\n";
-      partialsum[i] = partialsum[i-1] + hc;
+      fProb[i] = content[i] * nBins / fIntegral;
+      fAlias[i] = i;
+      (fProb[i] < 1.0? small: large).push_back(i);
     }
-    double integral = partialsum[nbinsx];
-    if (integral == 0) return 0;
-    // normalize to unit sum
-    for (int i=1;i<=nbinsx;i++) partialsum[i] /= integral;
-
-    double r1 = flat.fire();
-    int ibin = TMath::BinarySearch(nbinsx,&(partialsum[0]),r1);
-    Double_t x = hist.GetBinLowEdge(ibin+1);
-    if (r1 > partialsum[ibin]) {
-      x += hist.GetBinWidth(ibin+1)*(r1-partialsum[ibin])/(partialsum[ibin+1] - partialsum[ibin]);
+    while (!small.empty() && !large.empty())
+    {
+      std::size_t const s = small.back();
+      std::size_t const l = large.back();
+      small.pop_back();
+      fAlias[s] = l;
+      fProb[l] -= 1.0 - fProb[s];
+      if (fProb[l] < 1.0)
+      {
+        large.pop_back();
+        small.push_back(l);
+      }
     }
-    return x;
+    // whatever is left is full, up to rounding
+    for (std::size_t i: large) fProb[i] = 1.0;
+    for (std::size_t i: small) fProb[i] = 1.0;
+  }
+
+  double RadioGen::SpectrumSampler::sample(double r) const
+  {
+    // the integer part of r * nBins picks the column; the fractional part
+    // chooses between the bin and its alias, and then places the value in it
+    std::size_t const nBins = fProb.size();
+    double const u = r * nBins;
+    std::size_t const i = std::min(static_cast<std::size_t>(u), nBins - 1);
+    double const f = u - i;
+    double const p = fProb[i];
+    if (f < p) return i + f / p;
+    return fAlias[i] + (f - p) / (1.0 - p);
+  }
+
+  // replaces TH1::GetRandom, drawing the same single random number per sample
+  // from the art-managed CLHEP random number generator instead of gRandom
+  double RadioGen::samplefromspectrum(SpectrumSampler const& spectrum)
+  {
+    if (spectrum.integral() == 0) return 0;
+    CLHEP::RandFlat  flat(fEngine);
+    return spectrum.sample(flat.fire());
   }
 
 
@@ -14,17 +14,21 @@
 #include <memory>
 #include <iterator>
 #include <map>
+#include <optional>
 #include <initializer_list>
+#include <algorithm> // std::upper_bound()
 #include <cctype> // std::tolower()
 
 
 // Framework includes
 #include "art/Framework/Core/EDProducer.h"
 #include "art/Framework/Principal/Event.h"
+#include "fhiclcpp/ParameterSet.h"
 #include "fhiclcpp/types/Name.h"
 #include "fhiclcpp/types/Comment.h"
 #include "fhiclcpp/types/Atom.h"
 #include "fhiclcpp/types/OptionalAtom.h"
+#include "fhiclcpp/types/OptionalDelegatedParameter.h"
 #include "fhiclcpp/types/Sequence.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "art/Framework/Core/ModuleMacros.h"
@@ -44,6 +48,7 @@
 #include "larcore/Geometry/Geometry.h"
 #include "larcorealg/Geometry/GeometryCore.h"
 #include "larcoreobj/SummaryData/RunData.h"
+#include "larsim/EventGenerator/InTimeParticleSelector.h"
 
 
 #include "TVector3.h"
@@ -211,6 +216,11 @@ namespace evgen {
         Comment("override the random number generator seed")
       };
 
+      fhicl::OptionalDelegatedParameter InTimeSelection{
+        Name("InTimeSelection"),
+        Comment("if present, keep only the particles reaching a cryostat between MinT and MaxT [ns]")
+      };
+
 
         private:
 
@@ -241,8 +251,32 @@ namespace evgen {
     void Sample(simb::MCTruth &mct);
     void printVecs(std::vector<std::string> const& list);
     bool PadVector(std::vector<double> &vec);
-    double SelectFromHist(const TH1& h);
-    void SelectFromHist(const TH2& h, double &x, double &y);
+
+    /// Cumulative content of a 1D histogram, for sampling it.
+    struct HistCDF1D {
+      explicit HistCDF1D(const TH1& h);
+
+      double              integral;   ///< Integral of the histogram (no under/overflow).
+      std::vector<double> cumulative; ///< Sum of the contents up to each bin, from underflow.
+      std::vector<double> lowEdge;    ///< Lower edge of each bin.
+      std::vector<double> width;      ///< Width of each bin.
+    };
+
+    /// Cumulative content of a 2D histogram, for sampling it.
+    struct HistCDF2D {
+      explicit HistCDF2D(const TH2& h);
+
+      double              integral;   ///< Integral of the histogram (no under/overflow).
+      std::size_t         nCellsY;    ///< Bins on y, including the underflow.
+      std::vector<double> cumulative; ///< Sum of the contents up to each cell, x major.
+      std::vector<double> xLowEdge;   ///< Lower edge of each x bin.
+      std::vector<double> xWidth;     ///< Width of each x bin.
+      std::vector<double> yLowEdge;   ///< Lower edge of each y bin.
+      std::vector<double> yWidth;     ///< Width of each y bin.
+    };
+
+    double SelectFromHist(const HistCDF1D& h);
+    void SelectFromHist(const HistCDF2D& h, double &x, double &y);
 
     /// @{
     /// @name Constants for particle type extraction mode (`ParticleSelectionMode` parameter).
@@ -290,14 +324,16 @@ namespace evgen {
     std::vector<std::string> fPHist;     ///< name of histogram of momenta
     std::vector<std::string> fThetaXzYzHist;   ///< name of histogram for thetaxz/thetayz distribution
 
-    std::vector<std::unique_ptr<TH1>> hPHist ;     /// actual TH1 for momentum distributions
-    std::vector<std::unique_ptr<TH2>> hThetaXzYzHist ; /// actual TH2 for angle distributions - Xz on x axis .
+    std::vector<HistCDF1D> hPHist ;     /// sampling tables of the momentum distributions
+    std::vector<HistCDF2D> hThetaXzYzHist ; /// sampling tables of the angle distributions - Xz on x axis .
     // FYI - thetaxz and thetayz are related to standard polar angles as follows:
     // thetaxz = atan2(math.sin(theta) * cos(phi), cos(theta))
     // thetayz = asin(sin(theta) * sin(phi));
 
     CLHEP::HepRandomEngine& fEngine; ///< art-managed random-number engine
 
+    std::optional<InTimeParticleSelector> fInTimeSelector; ///< Selection of the particles in time (if any)
+
 
     /// Returns a vector with the name of particle selection mode keywords.
     static std::map<int, std::string> makeParticleSelectionModeNames();
@@ -499,6 +535,10 @@ namespace evgen{
       fEngine.setSeed(seed, 0 /* dummy? */);
     }
 
+    fhicl::ParameterSet inTimeConfig;
+    if (config().InTimeSelection.get_if_present(inTimeConfig))
+      fInTimeSelector.emplace(inTimeConfig, *(lar::providerFrom<geo::Geometry>()));
+
     produces< std::vector<simb::MCTruth> >();
     produces< sumdata::RunData, art::InRun >();
 
@@ -657,8 +697,8 @@ namespace evgen{
             throw art::Exception(art::errors::NotFound)
              << "Failed to read momentum histogram '" << histName << "' from '" << histFile->GetPath() << "\'";
           }
-          pHist->SetDirectory(nullptr); // make it independent of the input file
-          hPHist.emplace_back(pHist);
+          hPHist.emplace_back(*pHist); // only the sampling table is kept
+          delete pHist;
         } // for
         break;
       default: // supported, no further action needed
@@ -678,8 +718,8 @@ namespace evgen{
             throw art::Exception(art::errors::NotFound)
              << "Failed to read direction histogram '" << histName << "' from '" << histFile->GetPath() << "\'";
           }
-          pHist->SetDirectory(nullptr); // make it independent of the input file
-          hThetaXzYzHist.emplace_back(pHist);
+          hThetaXzYzHist.emplace_back(*pHist); // only the sampling table is kept
+          delete pHist;
         } // for
       default: // supported, no further action needed
         break;
@@ -751,7 +791,7 @@ namespace evgen{
       p = gauss.fire(fP0[i], fSigmaP[i]);
     }
     else if (fPDist == kHIST){
-      p = SelectFromHist(*(hPHist[i]));
+      p = SelectFromHist(hPHist[i]);
     }
     else{// if (fPDist == kUNIF) {
       p = fP0[i] + fSigmaP[i]*(2.0*flat.fire()-1.0);
@@ -800,7 +840,7 @@ namespace evgen{
     else if (fAngleDist == kHIST){ // Select thetaxz and thetayz from histogram
       double thetaxz = 0;
       double thetayz = 0;
-      SelectFromHist(*(hThetaXzYzHist[i]), thetaxz, thetayz);
+      SelectFromHist(hThetaXzYzHist[i], thetaxz, thetayz);
       thxz = (180./M_PI)*thetaxz;
       thyz = (180./M_PI)*thetayz;
     }
@@ -843,6 +883,7 @@ namespace evgen{
     //std::cout << "x: " <<  pos.X() << " y: " << pos.Y() << " z: " << pos.Z() << " time: " << pos.T() << std::endl;
     //std::cout << "YZ Angle: " << (thyzrad * (180./M_PI)) << " XZ Angle: " << (thxzrad * (180./M_PI)) << std::endl;
 
+    if (fInTimeSelector && !fInTimeSelector->keep(part)) return;
     mct.Add(part);
   }
 
@@ -887,7 +928,7 @@ namespace evgen{
         p = gauss.fire(fP0[i], fSigmaP[i]);
       }
       else if (fPDist == kHIST){
-        p = SelectFromHist(*(hPHist[i]));
+        p = SelectFromHist(hPHist[i]);
       }
       else {
         p = fP0[i] + fSigmaP[i]*(2.0*flat.fire()-1.0);
@@ -913,7 +954,7 @@ namespace evgen{
       else if (fAngleDist == kHIST){
         double thetaxz = 0;
         double thetayz = 0;
-        SelectFromHist(*(hThetaXzYzHist[i]), thetaxz, thetayz);
+        SelectFromHist(hThetaXzYzHist[i], thetaxz, thetayz);
         thxz = (180./M_PI)*thetaxz;
         thyz = (180./M_PI)*thetayz;
       }
@@ -955,6 +996,7 @@ namespace evgen{
       //std::cout << "Px: " <<  pvec.Px() << " Py: " << pvec.Py() << " Pz: " << pvec.Pz() << std::endl;
       //std::cout << "x: " <<  pos.X() << " y: " << pos.Y() << " z: " << pos.Z() << " time: " << pos.T() << std::endl;
       //std::cout << "YZ Angle: " << (thyzrad * (180./M_PI)) << " XZ Angle: " << (thxzrad * (180./M_PI)) << std::endl;
+      if (fInTimeSelector && !fInTimeSelector->keep(part)) continue;
       mct.Add(part);
     }
   }
@@ -1044,38 +1086,74 @@ namespace evgen{
 
 
   //____________________________________________________________________________
-  double SingleGen::SelectFromHist(const TH1& h) // select from a 1D histogram
+  // The bins are scanned in the same order (underflow first, overflow excluded)
+  // as the linear search they replace, so that sampling with the same random
+  // numbers returns the same values; contents are assumed not negative.
+  SingleGen::HistCDF1D::HistCDF1D(const TH1& h)
+    : integral(h.Integral())
   {
-    CLHEP::RandFlat   flat(fEngine);
-
-    double throw_value = h.Integral() * flat.fire();
+    int const nBins = h.GetNbinsX() + 1;
+    cumulative.reserve(nBins);
+    lowEdge.reserve(nBins);
+    width.reserve(nBins);
     double cum_value(0);
-    for (int i(0); i < h.GetNbinsX()+1; ++i){
+    for (int i(0); i < nBins; ++i){
       cum_value += h.GetBinContent(i);
-      if (throw_value < cum_value){
-        return flat.fire()*h.GetBinWidth(i) + h.GetBinLowEdge(i);
-      }
+      cumulative.push_back(cum_value);
+      lowEdge.push_back(h.GetBinLowEdge(i));
+      width.push_back(h.GetBinWidth(i));
     }
-    return throw_value; // for some reason we've gone through all bins and failed?
   }
+
   //____________________________________________________________________________
-  void SingleGen::SelectFromHist(const TH2& h, double &x, double &y) // select from a 2D histogram
+  SingleGen::HistCDF2D::HistCDF2D(const TH2& h)
+    : integral(h.Integral())
+    , nCellsY(h.GetNbinsY() + 1)
   {
-    CLHEP::RandFlat   flat(fEngine);
-
-    double throw_value = h.Integral() * flat.fire();
+    int const nBinsX = h.GetNbinsX() + 1;
+    int const nBinsY = h.GetNbinsY() + 1;
+    cumulative.reserve(nBinsX*nBinsY);
     double cum_value(0);
-    for (int i(0); i < h.GetNbinsX()+1; ++i){
-      for (int j(0); j < h.GetNbinsY()+1; ++j){
+    for (int i(0); i < nBinsX; ++i){
+      for (int j(0); j < nBinsY; ++j){
         cum_value += h.GetBinContent(i, j);
-        if (throw_value < cum_value){
-          x = flat.fire()*h.GetXaxis()->GetBinWidth(i) + h.GetXaxis()->GetBinLowEdge(i);
-          y = flat.fire()*h.GetYaxis()->GetBinWidth(j) + h.GetYaxis()->GetBinLowEdge(j);
-          return;
-        }
+        cumulative.push_back(cum_value);
       }
+      xLowEdge.push_back(h.GetXaxis()->GetBinLowEdge(i));
+      xWidth.push_back(h.GetXaxis()->GetBinWidth(i));
     }
-    return; // for some reason we've gone through all bins and failed?
+    for (int j(0); j < nBinsY; ++j){
+      yLowEdge.push_back(h.GetYaxis()->GetBinLowEdge(j));
+      yWidth.push_back(h.GetYaxis()->GetBinWidth(j));
+    }
+  }
+
+  //____________________________________________________________________________
+  double SingleGen::SelectFromHist(const HistCDF1D& h) // select from a 1D histogram
+  {
+    CLHEP::RandFlat   flat(fEngine);
+
+    double throw_value = h.integral * flat.fire();
+    auto const iBin = std::upper_bound(h.cumulative.begin(), h.cumulative.end(), throw_value);
+    if (iBin == h.cumulative.end())
+      return throw_value; // for some reason we've gone through all bins and failed?
+    std::size_t const i = std::distance(h.cumulative.begin(), iBin);
+    return flat.fire()*h.width[i] + h.lowEdge[i];
+  }
+  //____________________________________________________________________________
+  void SingleGen::SelectFromHist(const HistCDF2D& h, double &x, double &y) // select from a 2D histogram
+  {
+    CLHEP::RandFlat   flat(fEngine);
+
+    double throw_value = h.integral * flat.fire();
+    auto const iCell = std::upper_bound(h.cumulative.begin(), h.cumulative.end(), throw_value);
+    if (iCell == h.cumulative.end())
+      return; // for some reason we've gone through all bins and failed?
+    std::size_t const cell = std::distance(h.cumulative.begin(), iCell);
+    std::size_t const i = cell / h.nCellsY;
+    std::size_t const j = cell % h.nCellsY;
+    x = flat.fire()*h.xWidth[i] + h.xLowEdge[i];
+    y = flat.fire()*h.yWidth[j] + h.yLowEdge[j];
   }
   //____________________________________________________________________________
 
@@ -0,0 +1,220 @@
+/**
+ * @file   larsim/EventGenerator/TextEventIndex.cxx
+ * @brief  Byte offsets of the events in a text input file of a generator.
+ * @see    larsim/EventGenerator/TextEventIndex.h
+ */
+
+#include "larsim/EventGenerator/TextEventIndex.h"
+
+#include "cetlib_except/exception.h"
+
+// POSIX/UNIX
+#include <unistd.h> // ::getpid()
+
+// C/C++ standard libraries
+#include <cstdio>  // std::rename(), std::remove()
+#include <cstdlib> // std::strtod()
+#include <cstring> // std::memcmp()
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <system_error>
+
+namespace {
+
+  /// Identifier at the beginning of each index file.
+  constexpr char Magic[8] = {'L', 'A', 'R', 'T', 'X', 'I', 'X', '\0'};
+
+  /// Version of the index file format.
+  constexpr std::uint32_t FormatVersion = 1U;
+
+  template <typename T>
+  void
+  writeValue(std::ostream& out, T const& value)
+  {
+    out.write(reinterpret_cast<char const*>(&value), sizeof(T));
+  }
+
+  template <typename T>
+  bool
+  readValue(std::istream& in, T& value)
+  {
+    return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+  }
+
+} // local namespace
+
+namespace evgen {
+
+  //------------------------------------------------------------------------------
+  auto
+  TextEventIndex::hepevtFormat() -> Format
+  {
+    return {"hepevt", [](std::string const& line) -> long {
+              // header: event number and number of particles
+              char const* begin = line.c_str();
+              char* end = nullptr;
+              std::strtod(begin, &end);
+              if (end == begin) return NotAnEventStart;
+              begin = end;
+              double const nParticles = std::strtod(begin, &end);
+              if ((end == begin) || !(nParticles >= 0.)) return NotAnEventStart;
+              return static_cast<long>(nParticles);
+            }};
+  }
+
+  //------------------------------------------------------------------------------
+  auto
+  TextEventIndex::genieDumpFormat() -> Format
+  {
+    return {"geniedump", [](std::string const& line) -> long {
+              return (line.find("** Event:") != std::string::npos) ? 0L : NotAnEventStart;
+            }};
+  }
+
+  //------------------------------------------------------------------------------
+  std::string
+  TextEventIndex::fileKey(std::string const& inputFileName, Format const& format)
+  {
+    std::error_code error;
+    auto const size = std::filesystem::file_size(inputFileName, error);
+    if (error) {
+      throw cet::exception("TextEventIndex")
+        << "Can't find the size of '" << inputFileName << "': " << error.message() << "\n";
+    }
+    auto const time = std::filesystem::last_write_time(inputFileName, error);
+    if (error) {
+      throw cet::exception("TextEventIndex") << "Can't find the modification time of '"
+                                             << inputFileName << "': " << error.message() << "\n";
+    }
+    return format.name + ":" + std::to_string(size) + ":" +
+           std::to_string(time.time_since_epoch().count());
+  }
+
+  //------------------------------------------------------------------------------
+  std::uint64_t
+  TextEventIndex::offset(std::size_t event) const
+  {
+    if (event >= fOffsets.size()) {
+      throw cet::exception("TextEventIndex")
+        << "Event #" << event << " requested, but the file has only " << fOffsets.size()
+        << " events.\n";
+    }
+    return fOffsets[event];
+  }
+
+  //------------------------------------------------------------------------------
+  void
+  TextEventIndex::build(std::istream& in, Format const& format)
+  {
+    std::vector<std::uint64_t> offsets;
+    auto const start = in.tellg();
+    std::uint64_t offset = (start < 0) ? 0 : static_cast<std::uint64_t>(start);
+    std::string line;
+    while (std::getline(in, line)) {
+      std::uint64_t const lineStart = offset;
+      offset += line.size() + (in.eof() ? 0 : 1);
+      long const nSkip = format.eventStart(line);
+      if (nSkip == NotAnEventStart) continue;
+      offsets.push_back(lineStart);
+      for (long i = 0; (i < nSkip) && in; ++i) {
+        in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        offset += in.gcount();
+      }
+    }
+    fOffsets = std::move(offsets);
+  }
+
+  //------------------------------------------------------------------------------
+  auto
+  TextEventIndex::prepare(std::string const& inputFileName,
+                          std::string indexFileName,
+                          Format const& format,
+                          bool writeIndex) -> Origin
+  {
+    if (indexFileName.empty()) indexFileName = defaultIndexFileName(inputFileName);
+    std::string const key = fileKey(inputFileName, format);
+    if (readFile(indexFileName, key)) return Origin::Read;
+
+    std::ifstream in(inputFileName, std::ios::binary);
+    if (!in) {
+      throw cet::exception("TextEventIndex")
+        << "Can't open '" << inputFileName << "' to index its events.\n";
+    }
+    build(in, format);
+    if (!writeIndex) return Origin::Built;
+    try {
+      writeFile(indexFileName, key);
+    }
+    catch (cet::exception const&) {
+      return Origin::Built;
+    }
+    return Origin::Written;
+  }
+
+  //------------------------------------------------------------------------------
+  void
+  TextEventIndex::writeFile(std::string const& fileName, std::string const& key) const
+  {
+    // many jobs may build the same index at the same time: each writes its own
+    // copy, then replaces the sidecar in one step
+    std::string const tempName = fileName + ".part" + std::to_string(::getpid());
+    {
+      std::ofstream out(tempName, std::ios::binary | std::ios::trunc);
+      if (!out) {
+        throw cet::exception("TextEventIndex") << "Can't open '" << tempName << "' for writing.\n";
+      }
+
+      out.write(Magic, sizeof(Magic));
+      writeValue(out, FormatVersion);
+      writeValue(out, std::uint64_t(key.size()));
+      out.write(key.data(), key.size());
+      writeValue(out, std::uint64_t(fOffsets.size()));
+      out.write(reinterpret_cast<char const*>(fOffsets.data()),
+                fOffsets.size() * sizeof(std::uint64_t));
+
+      if (!out.flush()) {
+        std::remove(tempName.c_str());
+        throw cet::exception("TextEventIndex") << "Error while writing '" << tempName << "'.\n";
+      }
+    }
+    if (std::rename(tempName.c_str(), fileName.c_str()) != 0) {
+      std::remove(tempName.c_str());
+      throw cet::exception("TextEventIndex")
+        << "Can't move '" << tempName << "' into '" << fileName << "'.\n";
+    }
+  }
+
+  //------------------------------------------------------------------------------
+  bool
+  TextEventIndex::readFile(std::string const& fileName, std::string const& key)
+  {
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in) return false;
+
+    char magic[sizeof(Magic)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)) != 0)
+      return false;
+
+    std::uint32_t version = 0;
+    if (!readValue(in, version) || (version != FormatVersion)) return false;
+
+    std::uint64_t keySize = 0;
+    if (!readValue(in, keySize) || (keySize != key.size())) return false;
+    std::string fileKey(keySize, '\0');
+    if (!in.read(fileKey.data(), keySize) || (fileKey != key)) return false;
+
+    std::uint64_t nEvents = 0;
+    if (!readValue(in, nEvents)) return false;
+
+    // read into a copy, so that the index is untouched on failure
+    std::vector<std::uint64_t> offsets(nEvents);
+    if (!in.read(reinterpret_cast<char*>(offsets.data()), nEvents * sizeof(std::uint64_t)))
+      return false;
+    fOffsets = std::move(offsets);
+    return true;
+  }
+
+  //------------------------------------------------------------------------------
+
+} // namespace evgen
@@ -0,0 +1,117 @@
+/**
+ * @file   larsim/EventGenerator/TextEventIndex.h
+ * @brief  Byte offsets of the events in a text input file of a generator.
+ * @see    larsim/EventGenerator/TextEventIndex.cxx
+ *
+ * Generators reading their events from text files (`TextFileGen`, `NDKGen`)
+ * would have to parse a file from its beginning to reach an event. The index
+ * records where each event starts, so that a job can seek directly to its
+ * first event. The index is made by scanning the file once, and is saved in a
+ * small sidecar file (by default, the input file name with a `.idx` suffix)
+ * for the following jobs, or in advance with the `makeTextEventIndex` program.
+ * A sidecar file is used only if it was made from a file with the same format,
+ * size and modification time.
+ */
+
+#ifndef LARSIM_EVENTGENERATOR_TEXTEVENTINDEX_H
+#define LARSIM_EVENTGENERATOR_TEXTEVENTINDEX_H
+
+// C/C++ standard libraries
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace evgen {
+
+  /// Offsets of the events in a text file.
+  class TextEventIndex {
+  public:
+    /// Value of `Format::eventStart` for lines not starting an event.
+    static constexpr long NotAnEventStart = -1;
+
+    /// Description of the events of a file format.
+    struct Format {
+      std::string name; ///< Name of the format (part of the index key).
+      /// Returns how many of the following lines belong to the event started
+      /// by `line` and can be skipped without reading them (`0` if unknown),
+      /// or `NotAnEventStart`.
+      std::function<long(std::string const& line)> eventStart;
+    };
+
+    /// How `prepare()` got the index.
+    enum class Origin {
+      Read,    ///< From the sidecar file.
+      Built,   ///< Scanning the input file.
+      Written, ///< Scanning the input file, then saved in the sidecar file.
+    };
+
+    /// Format of the HEPEVT files of `TextFileGen`: the header of each event
+    /// has the event number and the number of particle lines following.
+    static Format hepevtFormat();
+
+    /// Format of the GENIE event dumps (`gevdump`) of `NDKGen`: each event
+    /// starts with a line with `** Event:`.
+    static Format genieDumpFormat();
+
+    /// Returns the default name of the index of `inputFileName`.
+    static std::string
+    defaultIndexFileName(std::string const& inputFileName)
+    {
+      return inputFileName + ".idx";
+    }
+
+    /// Returns the key of the index of `inputFileName` in `format`; throws
+    /// `cet::exception` (category: `"TextEventIndex"`) if the file is missing.
+    static std::string fileKey(std::string const& inputFileName, Format const& format);
+
+    /// Number of events in the index.
+    std::size_t
+    nEvents() const
+    {
+      return fOffsets.size();
+    }
+
+    /// Returns the offset [bytes] of the start of `event` (the first is `0`);
+    /// throws `cet::exception` (category: `"TextEventIndex"`) if not present.
+    std::uint64_t offset(std::size_t event) const;
+
+    /// Replaces the index with one of the events in `in`, from its current
+    /// position to its end.
+    void build(std::istream& in, Format const& format);
+
+    /**
+     * @brief Makes the index of a file, reading it from its sidecar if possible.
+     * @param inputFileName path of the text file
+     * @param indexFileName path of the sidecar file (default if empty)
+     * @param format format of the events in the file
+     * @param writeIndex whether to save a newly built index in the sidecar
+     * @return how the index was made
+     * @throw cet::exception (category: `"TextEventIndex"`) if the input can't be read
+     *
+     * An index which can't be saved (e.g. in a read-only directory) is still
+     * used: the result is then `Origin::Built` even with `writeIndex`.
+     */
+    Origin prepare(std::string const& inputFileName,
+                   std::string indexFileName,
+                   Format const& format,
+                   bool writeIndex);
+
+    /// Writes the index into `fileName` with `key`; throws `cet::exception`
+    /// (category: `"TextEventIndex"`) on error.
+    void writeFile(std::string const& fileName, std::string const& key) const;
+
+    /// Replaces the index with the one in `fileName`, if valid and made with
+    /// `key`; returns whether it did, otherwise the index is unchanged.
+    bool readFile(std::string const& fileName, std::string const& key);
+
+  private:
+    std::vector<std::uint64_t> fOffsets; ///< Offset of each event [bytes].
+
+  }; // class TextEventIndex
+
+} // namespace evgen
+
+#endif // LARSIM_EVENTGENERATOR_TEXTEVENTINDEX_H
@@ -51,12 +51,31 @@
  *  relations somewhat irrelevant.  That also means that you should let
  *  Geant4 handle any decays.
  *
+ *  The input is read through a large buffer, and each line is parsed
+ *  directly as numbers: a header line without two numbers or a particle
+ *  line without 15 numbers (including the end of file found before all the
+ *  particles announced in the header) is an error.
+ *
+ *  With `FirstEvent` set, the first events in the file are skipped: the job
+ *  seeks directly to the start of the event with that index (the first event
+ *  is `0`), found in an index of the events of the file
+ *  (`evgen::TextEventIndex`). The index is read from `EventIndexFile` (by
+ *  default, the input file name with a `.idx` suffix), or built scanning the
+ *  file and, with `WriteEventIndex` (default), saved there for the following
+ *  jobs; it can also be made in advance with `makeTextEventIndex`. Jobs
+ *  processing different ranges of events of the same file can then start
+ *  with no need to read the events before their range.
+ *
  *  The units in LArSoft are cm for distances and ns for time.
  *  The use of `TLorentzVector` below does not imply space and time have the same units
  *   (do not use `TLorentzVector::Boost()`).
  */
+#include <array>
+#include <cstdlib>
 #include <string>
 #include <fstream>
+#include <memory>
+#include <vector>
 
 #include "art/Framework/Core/EDProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
@@ -69,6 +88,7 @@
 
 #include "larcore/Geometry/Geometry.h"
 #include "larcoreobj/SummaryData/RunData.h"
+#include "larsim/EventGenerator/TextEventIndex.h"
 #include "nusimdata/SimulationBase/MCTruth.h"
 #include "nusimdata/SimulationBase/MCParticle.h"
 
@@ -76,6 +96,27 @@ namespace evgen {
   class TextFileGen;
 }
 
+namespace {
+
+  /// Parses up to `N` numbers from the start of `line` into `values`,
+  /// returning how many were found.
+  template <std::size_t N>
+  std::size_t parseNumbers(std::string const& line, std::array<double, N>& values)
+  {
+    char const* begin = line.c_str();
+    std::size_t n = 0;
+    while (n < N) {
+      char* end = nullptr;
+      double const value = std::strtod(begin, &end);
+      if (end == begin) break;
+      values[n++] = value;
+      begin = end;
+    }
+    return n;
+  }
+
+} // local namespace
+
 class evgen::TextFileGen : public art::EDProducer {
 public:
   explicit TextFileGen(fhicl::ParameterSet const & p);
@@ -86,17 +127,35 @@ public:
 
 private:
 
-  std::ifstream* fInputFile;
+  std::unique_ptr<std::ifstream> fInputFile;
   std::string    fInputFileName; ///< Name of text file containing events to simulate
   double fMoveY; ///< Project particles to a new y plane.
+  std::size_t    fFirstEvent; ///< Index of the first event to read from the file.
+  std::string    fEventIndexFileName; ///< Sidecar file of the event index.
+  bool           fWriteEventIndex; ///< Whether to save a newly built index.
+
+  std::vector<char> fBuffer;  ///< Input buffer of `fInputFile`.
+  std::string       fOneLine; ///< Line being parsed.
+  std::size_t       fLineNo = 0; ///< Number of lines read so far.
+
+  /// Reads the next line into `fOneLine`; throws if there is none.
+  void readLine();
+
+  /// Moves the input to the start of the event `fFirstEvent`.
+  void skipToFirstEvent();
+
+  /// Returns a description of the position of the last line read.
+  std::string lineLocation() const;
 };
 
 //------------------------------------------------------------------------------
 evgen::TextFileGen::TextFileGen(fhicl::ParameterSet const & p)
   : EDProducer{p}
-  , fInputFile(0)
   , fInputFileName{p.get<std::string>("InputFileName")}
   , fMoveY{p.get<double>("MoveY", -1e9)}
+  , fFirstEvent{p.get<std::size_t>("FirstEvent", 0U)}
+  , fEventIndexFileName{p.get<std::string>("EventIndexFile", "")}
+  , fWriteEventIndex{p.get<bool>("WriteEventIndex", true)}
 
 {
   if (fMoveY>-1e8){
@@ -110,13 +169,49 @@ evgen::TextFileGen::TextFileGen(fhicl::ParameterSet const & p)
 //------------------------------------------------------------------------------
 void evgen::TextFileGen::beginJob()
 {
-  fInputFile = new std::ifstream(fInputFileName.c_str());
+  // the buffer must be set before the file is opened
+  fBuffer.resize(1 << 20);
+  fInputFile = std::make_unique<std::ifstream>();
+  fInputFile->rdbuf()->pubsetbuf(fBuffer.data(), fBuffer.size());
+  fInputFile->open(fInputFileName.c_str());
 
   // check that the file is a good one
   if( !fInputFile->good() )
     throw cet::exception("TextFileGen") << "input text file "
 					<< fInputFileName
 					<< " cannot be read.\n";
+
+  if (fFirstEvent > 0) skipToFirstEvent();
+}
+
+//------------------------------------------------------------------------------
+void evgen::TextFileGen::skipToFirstEvent()
+{
+  evgen::TextEventIndex index;
+  auto const origin = index.prepare(fInputFileName, fEventIndexFileName,
+                                    evgen::TextEventIndex::hepevtFormat(),
+                                    fWriteEventIndex);
+  if (origin == evgen::TextEventIndex::Origin::Read)
+    mf::LogInfo("TextFileGen") << "Event index of " << fInputFileName << " read.";
+  else if (origin == evgen::TextEventIndex::Origin::Written)
+    mf::LogInfo("TextFileGen") << "Event index of " << fInputFileName << " built and saved.";
+  else if (fWriteEventIndex)
+    mf::LogWarning("TextFileGen") << "Event index of " << fInputFileName
+                                  << " built, but it could not be saved.";
+
+  if (fFirstEvent >= index.nEvents())
+    throw cet::exception("TextFileGen") << "input text file "
+					<< fInputFileName
+					<< " has only " << index.nEvents()
+					<< " events, can't start from event #"
+					<< fFirstEvent << ".\n";
+  fInputFile->seekg(index.offset(fFirstEvent));
+  if (!fInputFile->good())
+    throw cet::exception("TextFileGen") << "input text file "
+					<< fInputFileName
+					<< " can't be moved to event #" << fFirstEvent << ".\n";
+  mf::LogInfo("TextFileGen") << "Reading " << fInputFileName
+                             << " from event #" << fFirstEvent << ".";
 }
 
 //------------------------------------------------------------------------------
@@ -126,6 +221,27 @@ void evgen::TextFileGen::beginRun(art::Run& run)
     run.put(std::make_unique<sumdata::RunData>(geo->DetectorName()));
   }
 
+//------------------------------------------------------------------------------
+void evgen::TextFileGen::readLine()
+{
+  if (!std::getline(*fInputFile, fOneLine))
+    throw cet::exception("TextFileGen") << "input text file "
+					<< fInputFileName
+					<< " ended after " << fLineNo << " lines"
+					<< (fFirstEvent > 0 ? " read from the first event" : "")
+					<< ".\n";
+  ++fLineNo;
+}
+
+//------------------------------------------------------------------------------
+std::string evgen::TextFileGen::lineLocation() const
+{
+  std::string location = "line " + std::to_string(fLineNo);
+  if (fFirstEvent > 0)
+    location += " after the start of event #" + std::to_string(fFirstEvent);
+  return location + " of " + fInputFileName;
+}
+
 //------------------------------------------------------------------------------
 void evgen::TextFileGen::produce(art::Event & e)
 {
@@ -139,45 +255,37 @@ void evgen::TextFileGen::produce(art::Event & e)
   std::unique_ptr< std::vector<simb::MCTruth> > truthcol(new std::vector<simb::MCTruth>);
   simb::MCTruth truth;
 
-  // declare the variables for reading in the event record
-  int            event          = 0;
-  unsigned short nParticles 	= 0;
-  int            status         = 0;
-  int 	 	 pdg            = 0;
-  int 	 	 firstMother    = 0;
-  int 	 	 secondMother   = 0;
-  int 	 	 firstDaughter  = 0;
-  int 	 	 secondDaughter = 0;
-  double 	 xMomentum      = 0.;
-  double 	 yMomentum   	= 0.;
-  double 	 zMomentum   	= 0.;
-  double 	 energy      	= 0.;
-  double 	 mass        	= 0.;
-  double 	 xPosition   	= 0.;
-  double 	 yPosition   	= 0.;
-  double 	 zPosition   	= 0.;
-  double 	 time        	= 0.;
-
   // read in line to get event number and number of particles
-  std::string oneLine;
-  std::getline(*fInputFile, oneLine);
-  std::istringstream inputLine;
-  inputLine.str(oneLine);
-
-  inputLine >> event >> nParticles;
+  std::array<double, 2U> header;
+  readLine();
+  if (parseNumbers(fOneLine, header) != header.size())
+    throw cet::exception("TextFileGen") << lineLocation()
+					<< " is not a valid event header: '" << fOneLine << "'\n";
+  unsigned short const nParticles = static_cast<unsigned short>(header[1]);
 
   // now read in all the lines for the particles
   // in this interaction. only particles with
   // status = 1 get tracked in Geant4.
+  std::array<double, 15U> values;
   for(unsigned short i = 0; i < nParticles; ++i){
-    std::getline(*fInputFile, oneLine);
-    inputLine.clear();
-    inputLine.str(oneLine);
-
-    inputLine >> status      >> pdg
-	      >> firstMother >> secondMother >> firstDaughter >> secondDaughter
-	      >> xMomentum   >> yMomentum    >> zMomentum     >> energy >> mass
-	      >> xPosition   >> yPosition    >> zPosition     >> time;
+    readLine();
+    if (parseNumbers(fOneLine, values) != values.size())
+      throw cet::exception("TextFileGen") << lineLocation()
+					  << " (particle " << i << " of " << nParticles
+					  << ") does not have 15 entries: '" << fOneLine << "'\n";
+
+    int const    status      = static_cast<int>(values[0]);
+    int const    pdg         = static_cast<int>(values[1]);
+    int const    firstMother = static_cast<int>(values[2]);
+    double const xMomentum   = values[6];
+    double const yMomentum   = values[7];
+    double const zMomentum   = values[8];
+    double const energy      = values[9];
+    double const mass        = values[10];
+    double       xPosition   = values[11];
+    double       yPosition   = values[12];
+    double       zPosition   = values[13];
+    double const time        = values[14];
 
     //Project the particle to a new y plane
     if (fMoveY>-1e8){
@@ -0,0 +1,135 @@
+/**
+ * @file   larsim/EventGenerator/makeTextEventIndex.cc
+ * @brief  Writes the event index of text input files of generators.
+ * @see    larsim/EventGenerator/TextEventIndex.h
+ *
+ * Run with `--help` argument for usage instructions.
+ *
+ * The index is the same `TextFileGen` (`hepevt` format) and `NDKGen`
+ * (`geniedump` format) would build at the start of a job: making it in
+ * advance, next to the input file, saves each of the jobs reading the file
+ * from scanning it, or from racing to write the same index.
+ */
+
+// LArSoft libraries
+#include "larsim/EventGenerator/TextEventIndex.h"
+
+// POSIX/UNIX
+#include <getopt.h> // getopt_long(), option
+
+// C/C++ standard libraries
+#include <cstdlib> // std::exit()
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+namespace {
+
+  struct ConfigurationParameters {
+    std::string format = "hepevt"; ///< Format of the input files.
+    std::string indexFileName;     ///< Index file (default if empty).
+    std::vector<std::string> files; ///< Input files.
+  }; // struct ConfigurationParameters
+
+  [[noreturn]] void
+  printHelp(int exitCode, char const* progName)
+  {
+    std::cout
+      << "Writes the index of the events in text input files of generators."
+         "\n"
+         "\nUsage:  "
+      << progName
+      << "  [options] [--] file.txt [file.txt ...]"
+         "\n"
+         "\nOptions:"
+         "\n--format=FORMAT , -f FORMAT"
+         "\n    format of the files: 'hepevt' (TextFileGen, default) or 'geniedump' (NDKGen)"
+         "\n--output=INDEXFILE , -o INDEXFILE"
+         "\n    name of the index file (only with one input file; default: input name + '.idx')"
+         "\n--help , -h , -?"
+         "\n    print these usage instructions and exit"
+         "\n"
+      << std::endl;
+    std::exit(exitCode);
+  } // printHelp()
+
+  /// Parses the command line into `params`; exits on error.
+  void
+  parseArguments(ConfigurationParameters& params, int argc, char** argv)
+  {
+    static option const longopts[] = {{"format", required_argument, nullptr, 'f'},
+                                      {"output", required_argument, nullptr, 'o'},
+                                      {"help", no_argument, nullptr, 'h'},
+                                      {nullptr, 0, nullptr, 0}};
+
+    int ch;
+    while ((ch = getopt_long(argc, argv, ":f:o:h", longopts, nullptr)) != -1) {
+      switch (ch) {
+      case 'f': params.format = optarg; continue;
+      case 'o': params.indexFileName = optarg; continue;
+      case 'h': printHelp(0, argv[0]);
+      case '?':
+        if (optopt == '?') printHelp(0, argv[0]);
+        std::cerr << "Invalid option: '" << argv[optind - 1] << "'" << std::endl;
+        std::exit(1);
+      case ':':
+        std::cerr << "Option '" << argv[optind - 1] << "' requires an argument" << std::endl;
+        std::exit(1);
+      } // switch
+    }   // while
+
+    for (int iArg = optind; iArg < argc; ++iArg)
+      params.files.push_back(argv[iArg]);
+    if (params.files.empty()) printHelp(1, argv[0]);
+    if (!params.indexFileName.empty() && (params.files.size() > 1)) {
+      std::cerr << "The name of the index file can be chosen only with one input file."
+                << std::endl;
+      std::exit(1);
+    }
+  } // parseArguments()
+
+} // local namespace
+
+//------------------------------------------------------------------------------
+int
+main(int argc, char** argv)
+{
+  ConfigurationParameters params;
+  parseArguments(params, argc, argv);
+
+  evgen::TextEventIndex::Format format;
+  if (params.format == "hepevt")
+    format = evgen::TextEventIndex::hepevtFormat();
+  else if (params.format == "geniedump")
+    format = evgen::TextEventIndex::genieDumpFormat();
+  else {
+    std::cerr << "Unknown format: '" << params.format << "'" << std::endl;
+    return 1;
+  }
+
+  unsigned int nErrors = 0;
+  for (std::string const& fileName : params.files) {
+    std::string const indexFileName = params.indexFileName.empty() ?
+                                        evgen::TextEventIndex::defaultIndexFileName(fileName) :
+                                        params.indexFileName;
+    try {
+      std::string const key = evgen::TextEventIndex::fileKey(fileName, format);
+      std::ifstream in(fileName, std::ios::binary);
+      if (!in) throw std::runtime_error("can't open the file");
+      evgen::TextEventIndex index;
+      index.build(in, format);
+      index.writeFile(indexFileName, key);
+      std::cout << fileName << ": " << index.nEvents() << " events, index in '" << indexFileName
+                << "'" << std::endl;
+    }
+    catch (std::exception const& e) {
+      std::cerr << "Error in '" << fileName << "': " << e.what() << std::endl;
+      ++nErrors;
+    }
+  }
+  return (nErrors == 0) ? 0 : 1;
+}
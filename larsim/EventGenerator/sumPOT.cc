@@ -0,0 +1,278 @@
+/**
+ * @file   larsim/EventGenerator/sumPOT.cc
+ * @brief  Sums the protons on target from the subruns of _art_ ROOT files.
+ * @see    larsim/EventGenerator/POTaccumulator_module.cc
+ *
+ * Run with `--help` argument for usage instructions.
+ *
+ * The program computes the same sums as the `POTaccumulator` module, but it
+ * reads only the subrun tree of each file, with no _art_ job: the files are
+ * read in parallel, each into its own `sim::POTSummaryAccumulator`, and the
+ * results are merged in the order of the files.
+ * The data product dictionaries are loaded by ROOT, so the program needs the
+ * usual LArSoft runtime environment.
+ */
+
+// LArSoft libraries
+#include "larcoreobj/SummaryData/POTSummary.h"
+#include "larsim/EventGenerator/POTSummaryAccumulator.h"
+
+// framework libraries
+#include "canvas/Persistency/Common/Wrapper.h"
+#include "canvas/Persistency/Provenance/SubRunAuxiliary.h"
+
+// ROOT
+#include "TBranch.h"
+#include "TFile.h"
+#include "TObjArray.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+// TBB
+#include "tbb/parallel_for.h"
+#include "tbb/task_arena.h"
+
+// POSIX/UNIX
+#include <getopt.h> // getopt_long(), option
+
+// C/C++ standard libraries
+#include <cstdlib> // std::exit()
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+namespace {
+
+  /// Name of the _art_ subrun tree and of its auxiliary information branch.
+  constexpr char const* SubRunTreeName = "SubRuns";
+  constexpr char const* SubRunAuxBranchName = "SubRunAuxiliary";
+
+  struct ConfigurationParameters {
+    std::string label = "generator"; ///< Module label of the POT summary.
+    std::string instance;            ///< Instance name of the POT summary.
+    std::string process;             ///< Process name of the POT summary (any if empty).
+    bool runSummary = false;         ///< Print the POT of each run.
+    unsigned int nThreads = 0;       ///< Number of threads (`0`: TBB default).
+    std::vector<std::string> files;  ///< Input files.
+  }; // struct ConfigurationParameters
+
+  [[noreturn]] void
+  printHelp(int exitCode, char const* progName)
+  {
+    std::cout
+      << "Sums the POT (sumdata::POTSummary) of all the subruns in the input art ROOT files."
+         "\n"
+         "\nUsage:  "
+      << progName
+      << "  [options] [--] file.root [file.root ...]"
+         "\n"
+         "\nOptions:"
+         "\n--tag=LABEL[:INSTANCE[:PROCESS]] , -t LABEL[:INSTANCE[:PROCESS]]"
+         "\n    input tag of the POT summary (default: 'generator')"
+         "\n--filelist=LISTFILE , -S LISTFILE"
+         "\n    also read the files listed in LISTFILE (one per line)"
+         "\n--runs , -r"
+         "\n    print also the POT of each run"
+         "\n--threads=N , -j N"
+         "\n    read up to N files at the same time (default: as many as the cores)"
+         "\n--help , -h , -?"
+         "\n    print these usage instructions and exit"
+         "\n"
+      << std::endl;
+    std::exit(exitCode);
+  } // printHelp()
+
+  /// Parses the command line into `params`; exits on error.
+  void
+  parseArguments(ConfigurationParameters& params, int argc, char** argv)
+  {
+    static option const longopts[] = {{"tag", required_argument, nullptr, 't'},
+                                      {"filelist", required_argument, nullptr, 'S'},
+                                      {"runs", no_argument, nullptr, 'r'},
+                                      {"threads", required_argument, nullptr, 'j'},
+                                      {"help", no_argument, nullptr, 'h'},
+                                      {nullptr, 0, nullptr, 0}};
+
+    int ch;
+    while ((ch = getopt_long(argc, argv, ":t:S:rj:h", longopts, nullptr)) != -1) {
+      switch (ch) {
+      case 't': {
+        std::istringstream sstr(optarg);
+        std::getline(sstr, params.label, ':');
+        std::getline(sstr, params.instance, ':');
+        std::getline(sstr, params.process);
+        continue;
+      }
+      case 'S': {
+        std::ifstream list(optarg);
+        if (!list) {
+          std::cerr << "Can't open the file list '" << optarg << "'" << std::endl;
+          std::exit(1);
+        }
+        std::string line;
+        while (std::getline(list, line))
+          if (!line.empty() && (line[0] != '#')) params.files.push_back(line);
+        continue;
+      }
+      case 'r': params.runSummary = true; continue;
+      case 'j': {
+        std::istringstream sstr(optarg);
+        if (!(sstr >> params.nThreads)) {
+          std::cerr << "Invalid number of threads: '" << optarg << "'" << std::endl;
+          std::exit(1);
+        }
+        continue;
+      }
+      case 'h': printHelp(0, argv[0]);
+      case '?':
+        if (optopt == '?') printHelp(0, argv[0]);
+        std::cerr << "Invalid option: '" << argv[optind - 1] << "'" << std::endl;
+        std::exit(1);
+      case ':':
+        std::cerr << "Option '" << argv[optind - 1] << "' requires an argument" << std::endl;
+        std::exit(1);
+      } // switch
+    }   // while
+
+    for (int iArg = optind; iArg < argc; ++iArg)
+      params.files.push_back(argv[iArg]);
+    if (params.files.empty()) printHelp(1, argv[0]);
+  } // parseArguments()
+
+  /// Returns the name of the branch of the POT summary in `tree`; throws if ambiguous.
+  std::string
+  findPOTBranch(TTree& tree, ConfigurationParameters const& params)
+  {
+    // art branch names are "<type>_<label>_<instance>_<process>."
+    std::string const prefix = "sumdata::POTSummary_" + params.label + "_" + params.instance + "_";
+    std::string found;
+    for (TObject const* obj : *tree.GetListOfBranches()) {
+      std::string const name = obj->GetName();
+      if ((name.compare(0, prefix.size(), prefix) != 0) || (name.back() != '.')) continue;
+      std::string const process = name.substr(prefix.size(), name.size() - prefix.size() - 1);
+      if (!params.process.empty() && (process != params.process)) continue;
+      if (!found.empty()) {
+        throw std::runtime_error("POT summary '" + params.label + ":" + params.instance +
+                                 "' from more than one process ('" + found + "', '" + name +
+                                 "'): specify the process in the tag");
+      }
+      found = name;
+    }
+    return found;
+  } // findPOTBranch()
+
+  /// Adds to `POT` the summaries of all the subruns in the file `fileName`.
+  void
+  readFile(std::string const& fileName,
+           ConfigurationParameters const& params,
+           sim::POTSummaryAccumulator& POT)
+  {
+    std::unique_ptr<TFile> file{TFile::Open(fileName.c_str(), "READ")};
+    if (!file || file->IsZombie()) throw std::runtime_error("can't open the file");
+    TTree* tree = file->Get<TTree>(SubRunTreeName);
+    if (!tree) throw std::runtime_error(std::string("no '") + SubRunTreeName + "' tree");
+
+    std::string const branchName = findPOTBranch(*tree, params);
+
+    // read only the branches we need
+    tree->SetBranchStatus("*", false);
+    art::SubRunAuxiliary* aux = nullptr;
+    tree->SetBranchStatus((std::string(SubRunAuxBranchName) + "*").c_str(), true);
+    if (tree->SetBranchAddress(SubRunAuxBranchName, &aux) < 0)
+      throw std::runtime_error("can't read the subrun information");
+    art::Wrapper<sumdata::POTSummary>* summary = nullptr;
+    if (!branchName.empty()) {
+      tree->SetBranchStatus((branchName + "*").c_str(), true);
+      if (tree->SetBranchAddress(branchName.c_str(), &summary) < 0)
+        throw std::runtime_error("can't read the branch '" + branchName + "'");
+    }
+
+    Long64_t const nEntries = tree->GetEntries();
+    for (Long64_t iEntry = 0; iEntry < nEntries; ++iEntry) {
+      if (tree->GetEntry(iEntry) <= 0) throw std::runtime_error("error reading a subrun");
+      auto const& ID = aux->id();
+      if (summary && summary->isPresent())
+        POT.add(ID.run(), ID.subRun(), *(summary->product()));
+      else
+        POT.addMissing(ID.run(), ID.subRun());
+    }
+    tree->ResetBranchAddresses();
+    delete aux;
+    delete summary;
+  } // readFile()
+
+} // local namespace
+
+//------------------------------------------------------------------------------
+int
+main(int argc, char** argv)
+{
+  ConfigurationParameters params;
+  parseArguments(params, argc, argv);
+
+  ROOT::EnableThreadSafety();
+
+  // each file is read on its own, and the results are merged in order
+  std::vector<sim::POTSummaryAccumulator> filePOT(params.files.size());
+  std::vector<std::string> fileErrors(params.files.size());
+  tbb::task_arena arena{
+    (params.nThreads > 0) ? static_cast<int>(params.nThreads) : tbb::task_arena::automatic};
+  arena.execute([&] {
+    tbb::parallel_for(std::size_t{0}, params.files.size(), [&](std::size_t iFile) {
+      try {
+        readFile(params.files[iFile], params, filePOT[iFile]);
+      }
+      catch (std::exception const& e) {
+        fileErrors[iFile] = e.what();
+        filePOT[iFile] = sim::POTSummaryAccumulator{};
+      }
+    });
+  });
+
+  sim::POTSummaryAccumulator POT;
+  unsigned int nErrors = 0;
+  for (std::size_t iFile = 0; iFile < params.files.size(); ++iFile) {
+    if (!fileErrors[iFile].empty()) {
+      std::cerr << "Error in '" << params.files[iFile] << "': " << fileErrors[iFile]
+                << " (skipped)" << std::endl;
+      ++nErrors;
+      continue;
+    }
+    POT.merge(filePOT[iFile]);
+  }
+
+  if (params.runSummary) {
+    auto const& missing = POT.missingFragments();
+    auto const& present = POT.presentFragments();
+    if (!missing.empty()) {
+      std::cout << missing.size() << " subruns lack POT information:";
+      for (auto const& [id, nMissing] : missing) {
+        unsigned int nFragments = nMissing;
+        auto const iFound = present.find(id);
+        if (iFound != present.end()) nFragments += iFound->second;
+        std::cout << "\n run: " << id.first << " subRun: " << id.second << ": " << nMissing
+                  << " / " << nFragments << " \"fragments\"";
+      }
+      std::cout << std::endl;
+    }
+
+    auto subrunCount = POT.subRunCounts();
+    std::cout << "POT from " << POT.runPOT().size() << " runs:";
+    for (auto const& [run, runPOT] : POT.runPOT()) {
+      std::cout << "\n run: " << run << " (" << subrunCount[run]
+                << " subruns): " << sim::POTSummaryAccumulator::to_string(runPOT);
+    }
+    std::cout << std::endl;
+  }
+
+  std::cout << "Aggregated POT from " << POT.runPOT().size() << " runs (" << POT.nSubRuns()
+            << " subruns, " << (params.files.size() - nErrors) << " files): "
+            << sim::POTSummaryAccumulator::to_string(POT.totalPOT()) << std::endl;
+
+  return (nErrors == 0) ? 0 : 1;
+} // main()
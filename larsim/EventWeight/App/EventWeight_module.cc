@@ -7,22 +7,41 @@
 // from cetpkgsupport v1_08_04.
 //
 // Ported from uboonecode to larsim on Feb 14 2018 by Marco Del Tutto
+//
+// With "compact_weights" set to true, the weights are stored as
+// evwgh::CompactMCEventWeight (single precision, one contiguous vector per
+// neutrino) instead of evwgh::MCEventWeight, and the calculator names
+// are stored once per run in a evwgh::MCEventWeightTable.
+//
+// With "input_weights_label", the weights of an existing MCEventWeight
+// collection are reused for the calculators whose configuration did not
+// change from the job that produced it (see
+// evwgh::WeightManager::ConfigurationID()); only the other calculators are
+// run, and the output merges both.
 ////////////////////////////////////////////////////////////////////////
 
 #include "art/Framework/Core/EDProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Principal/Provenance.h"
+#include "art/Framework/Principal/Run.h"
+#include "canvas/Utilities/InputTag.h"
+#include "cetlib_except/exception.h"
 #include "nugen/EventGeneratorBase/GENIE/GENIE2ART.h"
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <iostream>
 #include <iomanip>
+#include <set>
 
 #include "larsim/EventWeight/Base/Weight_t.h"
 #include "larsim/EventWeight/Base/MCEventWeight.h"
+#include "larsim/EventWeight/Base/CompactMCEventWeight.h"
 #include "larsim/EventWeight/Base/WeightManager.h"
 
 #include "nusimdata/SimulationBase/MCTruth.h"
@@ -49,16 +68,34 @@ namespace evwgh {
     void produce(art::Event & e) override;
 
     //Optional functions.
+    void endRun(art::Run & r) override;
     void endJob() override;
 
     WeightManager _wgt_manager;
     std::string fGenieModuleLabel;
+    bool fCompactWeights;
+    std::vector<std::uint32_t> fNUniverses; ///< Largest weight count per calculator in the run.
+
+    fhicl::ParameterSet fConfig;
+    art::InputTag fInputWeightsTag;              ///< Weights to reuse (empty if none).
+    fhicl::ParameterSetID fInputConfigID;        ///< Configuration the reused weights come from.
+    std::set<std::string> fReused;               ///< Calculators with weights from the input.
+    std::map<std::string, std::string> fWeightKeys; ///< MCEventWeight key of each calculator.
+
+    void FindReusedCalculators(fhicl::ParameterSet const& inputConfig);
   };
 
   EventWeight::EventWeight(fhicl::ParameterSet const & p)
     : EDProducer{p}
     , fGenieModuleLabel{p.get<std::string>("genie_module_label", "generator")}
+    , fCompactWeights{p.get<bool>("compact_weights", false)}
+    , fConfig{p}
+    , fInputWeightsTag{p.get<art::InputTag>("input_weights_label", {})}
   {
+    if (fCompactWeights && !fInputWeightsTag.empty())
+      throw cet::exception("EventWeight")
+        << "input_weights_label can't be used together with compact_weights.\n";
+
     // Configure the appropriate GENIE tune if needed (important for v3+ only)
     // NOTE: In all normal use cases, relying on the ${GENIE_XSEC_TUNE} environment
     // variable set by the genie_xsec package should be sufficient. Only include
@@ -75,15 +112,42 @@ namespace evwgh {
     evgb::SetEventGeneratorListAndTune( evgen_list_name, genie_tune_name );
 
     auto const n_func = _wgt_manager.Configure(p, *this);
-    if ( n_func > 0 )
-      produces<std::vector<MCEventWeight> >();
+    if ( n_func > 0 ) {
+      if (fCompactWeights) {
+        produces<std::vector<CompactMCEventWeight> >();
+        produces<MCEventWeightTable, art::InRun>();
+      }
+      else
+        produces<std::vector<MCEventWeight> >();
+    }
+    fNUniverses.assign(n_func, 0);
+    for (auto const& calc : _wgt_manager.GetWeightCalcMap())
+      fWeightKeys[calc.first] = calc.first+"_"+calc.second->fWeightCalcType;
+    if (!fInputWeightsTag.empty())
+      consumes<std::vector<MCEventWeight> >(fInputWeightsTag);
   }
 
-  void EventWeight::produce(art::Event & e)
+  void EventWeight::FindReusedCalculators(fhicl::ParameterSet const& inputConfig)
   {
-    // Implementation of required member function here.
-    auto mcwghvec = std::make_unique<std::vector<MCEventWeight>>();
+    fInputConfigID = inputConfig.id();
+    fReused.clear();
+    auto const inputFuncs = inputConfig.get<std::vector<std::string>>("weight_functions", {});
+    for (auto const& calc : fWeightKeys) {
+      if (std::find(inputFuncs.begin(), inputFuncs.end(), calc.first) == inputFuncs.end())
+        continue;
+      if (WeightManager::ConfigurationID(inputConfig, calc.first)
+          == WeightManager::ConfigurationID(fConfig, calc.first))
+        fReused.insert(calc.first);
+    }
 
+    mf::LogInfo log("EventWeight");
+    log << fReused.size() << "/" << fWeightKeys.size()
+        << " weight calculators are reused from '" << fInputWeightsTag.encode() << "'";
+    for (auto const& func : fReused) log << "\n  " << func;
+  }
+
+  void EventWeight::produce(art::Event & e)
+  {
     // Get the MC generator information out of the event
     // these are all handles to mc information.
     std::vector<art::Ptr<simb::MCTruth> > mclist;
@@ -92,15 +156,58 @@ namespace evwgh {
     auto const mcTruthHandle = e.getValidHandle<std::vector<simb::MCTruth>>(fGenieModuleLabel);
       art::fill_ptr_vector(mclist, mcTruthHandle);
 
+    if (fCompactWeights) {
+      auto mcwghvec = std::make_unique<std::vector<CompactMCEventWeight>>();
+      for (unsigned int inu = 0; inu < mclist.size(); ++inu) {
+        mcwghvec->push_back(_wgt_manager.RunCompact(e, inu));
+        for (size_t calc = 0; calc < fNUniverses.size(); ++calc)
+          fNUniverses[calc] = std::max<std::uint32_t>(fNUniverses[calc], mcwghvec->back().NWeights(calc));
+      }
+      e.put(std::move(mcwghvec));
+      return;
+    }
+
+    std::vector<MCEventWeight> const* inputWeights = nullptr;
+    if (!fInputWeightsTag.empty()) {
+      auto const inputHandle = e.getValidHandle<std::vector<MCEventWeight>>(fInputWeightsTag);
+      if (inputHandle->size() != mclist.size())
+        throw cet::exception("EventWeight")
+          << "'" << fInputWeightsTag.encode() << "' has weights for " << inputHandle->size()
+          << " neutrinos, but there are " << mclist.size() << " in the event.\n";
+      fhicl::ParameterSet const& inputConfig = inputHandle.provenance()->parameterSet();
+      if (inputConfig.id() != fInputConfigID) FindReusedCalculators(inputConfig);
+      inputWeights = inputHandle.product();
+    }
+
+    // Implementation of required member function here.
+    auto mcwghvec = std::make_unique<std::vector<MCEventWeight>>();
+
     // Loop over all neutrinos in this event
     for (unsigned int inu = 0; inu < mclist.size(); ++inu) {
-      auto const mcwgh = _wgt_manager.Run(e, inu);
+      auto mcwgh = _wgt_manager.Run(e, inu, fReused);
+      for (auto const& func : fReused) {
+        auto const& input = (*inputWeights)[inu].fWeight;
+        auto it = input.find(fWeightKeys[func]);
+        if (it == input.end()) it = input.find("empty");
+        if (it != input.end()) mcwgh.fWeight.insert(*it);
+      }
       mcwghvec->push_back(mcwgh);
     }
 
     e.put(std::move(mcwghvec));
   }
 
+  void EventWeight::endRun(art::Run & r)
+  {
+    if (!fCompactWeights || fNUniverses.empty()) return;
+
+    auto table = std::make_unique<MCEventWeightTable>();
+    table->fNames = _wgt_manager.CalculatorNames();
+    table->fNUniverses = fNUniverses;
+    r.put(std::move(table), art::fullRun());
+    fNUniverses.assign(fNUniverses.size(), 0);
+  }
+
   void EventWeight::endJob()
   {
     // Get the map from sting to Weight_t from the manager
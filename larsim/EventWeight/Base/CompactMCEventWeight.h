@@ -0,0 +1,45 @@
+#ifndef _COMPACTMCEVENTWEIGHT_H_
+#define _COMPACTMCEVENTWEIGHT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace evwgh {
+
+  /**
+   * @brief Weight calculators of a run, shared by all its `CompactMCEventWeight`.
+   *
+   * The calculator ID used in `CompactMCEventWeight` is the index in these
+   * vectors. Names are the same as the keys of `MCEventWeight::fWeight`
+   * (calculator name and type). The number of universes is the largest
+   * number of weights found in the run for each calculator.
+   */
+  struct MCEventWeightTable
+  {
+    std::vector<std::string>   fNames;
+    std::vector<std::uint32_t> fNUniverses;
+  };
+
+  /**
+   * @brief Weights of a neutrino, contiguous in single precision.
+   *
+   * The weights of the calculator with ID `i` in the run `MCEventWeightTable`
+   * are the elements from `fFirst[i]` to `fFirst[i + 1]` (excluded) of
+   * `fWeights`; a calculator which gave no weight has none.
+   */
+  struct CompactMCEventWeight
+  {
+    std::vector<float>         fWeights;
+    std::vector<std::uint32_t> fFirst; ///< One more element than the calculators.
+
+    std::size_t NWeights(std::size_t calc) const
+    { return fFirst[calc + 1] - fFirst[calc]; }
+
+    float const* Weights(std::size_t calc) const
+    { return fWeights.data() + fFirst[calc]; }
+  };
+
+}
+#endif //_COMPACTMCEVENTWEIGHT_H_
@@ -0,0 +1,76 @@
+/**
+ * \file GHEPRecordCache.h
+ *
+ *
+ * \brief Event-scoped cache of the GENIE records reconstructed from the event
+ *
+ * The cache is owned by WeightManager and shared by all the calculators it
+ * runs, so that the GENIE record of each neutrino is rebuilt from
+ * simb::MCTruth and simb::GTruth only once per event.
+ * This header does not need the GENIE headers: the records are built by the
+ * calculators, which provide the builder function.
+ */
+
+#ifndef GHEPRECORDCACHE_H
+#define GHEPRECORDCACHE_H
+
+#include "canvas/Persistency/Provenance/EventID.h"
+#include "canvas/Persistency/Provenance/ProductID.h"
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <utility>
+
+namespace genie { class EventRecord; }
+
+namespace evwgh {
+  /**
+     \class GHEPRecordCache
+     The records are identified by the product ID of the simb::MCTruth
+     collection and by the index of the neutrino in it.
+     Cached records are shared and must not be modified: calculators that
+     need to change a record work on a copy of it.
+  */
+  class GHEPRecordCache {
+
+  public:
+
+    using Record_t = genie::EventRecord;
+
+    /// Prepares for the event `id`, removing the records of other events
+    void StartEvent(art::EventID const& id)
+    {
+      if (id == fEventID) return;
+      Clear();
+      fEventID = id;
+    }
+
+    /// Removes all the records
+    void Clear() { fRecords.clear(); }
+
+    /**
+      * @brief Returns the record of a neutrino, building it if not cached yet
+      * @param truthID product ID of the simb::MCTruth collection
+      * @param index index of the neutrino in the collection
+      * @param build callable returning a std::unique_ptr to the new record
+      */
+    template <typename Builder>
+    Record_t const& Get(art::ProductID const& truthID, std::size_t index, Builder&& build)
+    {
+      auto& record = fRecords[{truthID, index}];
+      if (!record) record = std::shared_ptr<Record_t const>{build()};
+      return *record;
+    }
+
+    /// Number of records in the cache
+    std::size_t size() const { return fRecords.size(); }
+
+  private:
+    art::EventID fEventID; ///< Event the records belong to
+    std::map<std::pair<art::ProductID, std::size_t>, std::shared_ptr<Record_t const>> fRecords;
+  };
+
+}
+
+#endif // GHEPRECORDCACHE_H
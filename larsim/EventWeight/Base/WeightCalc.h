@@ -8,6 +8,8 @@ namespace CLHEP {
   class RandGaussQ;
 }
 
+#include "GHEPRecordCache.h"
+
 #include "TMatrixD.h"
 #include <string>
 #include <map>
@@ -25,6 +27,9 @@ namespace evwgh {
     void                        SetName(std::string name) {fName=name;}
     std::string                 GetName() {return fName;}
 
+    /// Sets the GENIE record cache shared by the calculators (not owned)
+    void                        SetGHEPCache(GHEPRecordCache* cache) {fGHEPCache=cache;}
+
     /**
      * @brief Applies Gaussian smearing to a set of data
      * @param centralValues the values to be smeared
@@ -52,8 +57,13 @@ namespace evwgh {
                                                 std::vector<double> rand);
 
 
+  protected:
+    /// Returns the shared GENIE record cache (nullptr if none)
+    GHEPRecordCache*            GetGHEPCache() const {return fGHEPCache;}
+
   private:
     std::string fName;
+    GHEPRecordCache* fGHEPCache = nullptr;
   };
 
 }
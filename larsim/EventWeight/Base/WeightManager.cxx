@@ -1,5 +1,7 @@
 #include "WeightManager.h"
 
+#include "art/Framework/Principal/Event.h"
+
 
 namespace evwgh {
 
@@ -16,7 +18,7 @@ namespace evwgh {
   //
   // CORE FUNCTION
   //
-  MCEventWeight WeightManager::Run(art::Event & e, const int inu)
+  MCEventWeight WeightManager::Run(art::Event & e, const int inu, std::set<std::string> const& skip)
   {
 
     if (!_configured)
@@ -25,9 +27,13 @@ namespace evwgh {
     //
     // Loop over all functions ang calculate weights
     //
+    fGHEPCache.StartEvent(e.id());
+
     MCEventWeight mcwgh;
     for (auto it = fWeightCalcMap.begin() ;it != fWeightCalcMap.end(); it++) {
 
+      if (skip.count(it->first)) continue;
+
       auto const & weights = it->second->GetWeight(e);
 
       if(weights.size() == 0){
@@ -48,6 +54,54 @@ namespace evwgh {
 
 
 
+  CompactMCEventWeight WeightManager::RunCompact(art::Event & e, const int inu)
+  {
+
+    if (!_configured)
+      throw cet::exception(__PRETTY_FUNCTION__) << "Have not configured yet!" << std::endl;
+
+    fGHEPCache.StartEvent(e.id());
+
+    CompactMCEventWeight mcwgh;
+    mcwgh.fFirst.reserve(fWeightCalcMap.size() + 1);
+    mcwgh.fFirst.push_back(0);
+    for (auto it = fWeightCalcMap.begin() ;it != fWeightCalcMap.end(); it++) {
+
+      auto const & weights = it->second->GetWeight(e);
+
+      if(weights.size() != 0)
+        mcwgh.fWeights.insert(mcwgh.fWeights.end(), weights[inu].begin(), weights[inu].end());
+      mcwgh.fFirst.push_back(mcwgh.fWeights.size());
+    }
+
+    return mcwgh;
+  }
+
+
+  std::vector<std::string> WeightManager::CalculatorNames() const
+  {
+    std::vector<std::string> names;
+    names.reserve(fWeightCalcMap.size());
+    for (auto const& calc : fWeightCalcMap)
+      names.push_back(calc.first+"_"+calc.second->fWeightCalcType);
+    return names;
+  }
+
+
+
+  fhicl::ParameterSetID WeightManager::ConfigurationID(fhicl::ParameterSet const& cfg,
+                                                      std::string const& func)
+  {
+    fhicl::ParameterSet config = cfg;
+    for (auto const& other : cfg.get<std::vector<std::string>>("weight_functions", {}))
+      if (other != func) config.erase(other);
+    for (auto const& key : {"weight_functions", "module_type", "module_label",
+                            "compact_weights", "input_weights_label"})
+      config.erase(key);
+    return config.id();
+  }
+
+
   void WeightManager::PrintConfig() {
 
     return;
@@ -15,11 +15,16 @@
 #include "nurandom/RandomUtils/NuRandomService.h"
 #include "lardataobj/Simulation/sim.h"
 #include "fhiclcpp/ParameterSet.h"
+#include "fhiclcpp/ParameterSetID.h"
+
+#include <set>
 
 #include "Weight_t.h"
 #include "MCEventWeight.h"
+#include "CompactMCEventWeight.h"
 #include "WeightCalc.h"
 #include "WeightCalcFactory.h"
+#include "GHEPRecordCache.h"
 
 namespace evwgh {
   /**
@@ -54,14 +59,43 @@ namespace evwgh {
       * @brief Core function (previous call to Configure is needed)
       * @param e the art event
       * @param inu the index of the simulated neutrino in the event
+      * @param skip names of the calculators not to run
        CORE FUNCTION: executes algorithms to assign a weight to the event as requested users. \n
        WeightManager::Configure needs to be called first \n
        The execution takes following steps:             \n
        0) Loos over all the previously emplaced calculators \n
        1) For each of them calculates the weights (more weight can be requested per calculator) \n
+          (the GENIE records of the event are rebuilt only once, and shared by all calculators) \n
        3) Returns a map from "calculator name" to vector of weights calculated which is available inside MCEventWeight
      */
-    MCEventWeight Run(art::Event &e, const int inu);
+    MCEventWeight Run(art::Event &e, const int inu, std::set<std::string> const& skip = {});
+
+    /**
+      * @brief Same as Run(), with the weights in the compact format
+      * @param e the art event
+      * @param inu the index of the simulated neutrino in the event
+       The calculator IDs are the indices in the list from CalculatorNames().
+     */
+    CompactMCEventWeight RunCompact(art::Event &e, const int inu);
+
+    /**
+      * @brief Returns the names of the calculators, in calculator ID order
+       The names are the keys used in MCEventWeight ("name_type").
+      */
+    std::vector<std::string> CalculatorNames() const;
+
+    /**
+      * @brief Returns an identifier of the configuration of a calculator
+      * @param cfg the configuration of the EventWeight module
+      * @param func the name of the calculator
+       The identifier includes the table of the calculator and all the other
+       module parameters, except the list of calculators, the tables of the
+       other calculators and the EventWeight options on the output format
+       and on the input weights. Two jobs with the same identifier for a
+       calculator compute the same weights with it.
+      */
+    static fhicl::ParameterSetID ConfigurationID(fhicl::ParameterSet const& cfg,
+                                                 std::string const& func);
 
     /**
       * @brief Returns the map between calculator name and Weight_t product
@@ -77,6 +111,7 @@ namespace evwgh {
 
   private:
     std::map<std::string, Weight_t*> fWeightCalcMap; ///< A set of custom weight calculators
+    GHEPRecordCache fGHEPCache; ///< GENIE records of the event, shared by the calculators
     bool _configured{false}; ///< Readiness flag
     std::string _name; ///< Name
   };
@@ -105,6 +140,7 @@ namespace evwgh {
       // Create random engine for each rw function (name=func) (and seed it with random_seed set in the fcl)
       CLHEP::HepRandomEngine& engine = seedservice->createEngine(module, "HepJamesRandom", func, ps_func, "random_seed");
       wcalc->SetName(func);
+      wcalc->SetGHEPCache(&fGHEPCache);
       wcalc->Configure(p, engine);
       Weight_t* winfo=new Weight_t();
       winfo->fWeightCalcType=func_type;
@@ -3,3 +3,4 @@
 #include "canvas/Persistency/Common/Wrapper.h"
 
 #include "larsim/EventWeight/Base/MCEventWeight.h"
+#include "larsim/EventWeight/Base/CompactMCEventWeight.h"
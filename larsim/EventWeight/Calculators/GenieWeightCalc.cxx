@@ -25,6 +25,9 @@
 
 #include "CLHEP/Random/RandGaussQ.h"
 
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
 #include "nugen/EventGeneratorBase/GENIE/GENIE2ART.h"
 
 #include "nusimdata/SimulationBase/MCFlux.h"
@@ -217,6 +220,40 @@ namespace {
   // then variation weights will be thrown around the tuned CV.
   std::set< std::string > CALC_NAMES_THAT_IGNORE_TUNED_CV = { "RootinoFix" };
 
+  // Converts the MCTruth and GTruth objects from the event back into the
+  // original genie::EventRecord needed to compute the weights
+  std::unique_ptr< genie::EventRecord > BuildGenieEvent(
+    const simb::MCTruth& mctruth, const simb::GTruth& gtruth )
+  {
+    std::unique_ptr< genie::EventRecord >
+      genie_event( evgb::RetrieveGHEP(mctruth, gtruth) );
+
+    // Set the final lepton kinetic energy and scattering cosine
+    // in the owned GENIE kinematics object. This is done during
+    // event generation but is not reproduced by evgb::RetrieveGHEP().
+    // Several new CCMEC weight calculators developed for MicroBooNE
+    // expect the variables to be set in this way (so that differential
+    // cross sections can be recomputed). Failing to set them results
+    // in inf and NaN weights.
+    // TODO: maybe update evgb::RetrieveGHEP to handle this instead.
+    genie::Interaction* interaction = genie_event->Summary();
+    genie::Kinematics* kine_ptr = interaction->KinePtr();
+
+    // Final lepton mass
+    double ml = interaction->FSPrimLepton()->Mass();
+    // Final lepton 4-momentum
+    const TLorentzVector& p4l = kine_ptr->FSLeptonP4();
+    // Final lepton kinetic energy
+    double Tl = p4l.E() - ml;
+    // Final lepton scattering cosine
+    double ctl = p4l.CosTheta();
+
+    kine_ptr->SetKV( kKVTl, Tl );
+    kine_ptr->SetKV( kKVctl, ctl );
+
+    return genie_event;
+  }
+
 } // anonymous namespace
 
 namespace evwgh {
@@ -238,10 +275,18 @@ namespace evwgh {
 
       std::vector< genie::rew::GReWeight > reweightVector;
 
+      // Index in reweightVector of the reweighting engine of each universe:
+      // universes with the same dial values share one engine
+      std::vector< size_t > fUniverseEngine;
+
       std::string fGenieModuleLabel;
 
       bool fQuietMode;
 
+      // Evaluate the universes in parallel threads, each on its own copy of
+      // the event record (the GReWeight objects are configured only once)
+      bool fParallelUniverses;
+
       DECLARE_WEIGHTCALC(GenieWeightCalc)
   };
 
@@ -325,6 +370,8 @@ namespace evwgh {
 
     auto const mode = pset.get<std::string>( "mode" );
 
+    fParallelUniverses = pset.get<bool>( "parallel_universes", false );
+
     bool sigmas_ok = true;
     std::string array_name_for_exception;
     if ( mode.find("central_value") == std::string::npos
@@ -412,14 +459,6 @@ namespace evwgh {
       num_universes = 1u;
     }
 
-    // Create one default-constructed genie::rew::GReWeight object per universe
-    reweightVector.resize( num_universes );
-
-    // Set up the weight calculators for each universe
-    for ( auto& rwght : reweightVector ) {
-      this->SetupWeightCalculators( rwght, modes_to_use );
-    }
-
     // Prepare sigmas
     size_t num_usable_knobs = knobs_to_use.size();
     std::vector< std::vector<double> > reweightingSigmas( num_usable_knobs );
@@ -506,10 +545,41 @@ namespace evwgh {
     // TODO: deal with parameters that have a priori bounds (e.g., FFCCQEVec,
     // which can vary on the interval [0,1])
 
-    // Set up the knob values for each universe
-    for ( size_t u = 0; u < reweightVector.size(); ++u ) {
+    // Universes with exactly the same dial values give the same weights:
+    // only the first of them gets a reweighting engine (and reconfiguration),
+    // the others reuse its weights
+    fUniverseEngine.resize( num_universes );
+    std::vector< size_t > engineUniverse; // first universe of each engine
+    std::map< std::vector<double>, size_t > engineOfDials;
+    for ( size_t u = 0u; u < num_universes; ++u ) {
+      std::vector<double> dials( knobs_to_use.size() );
+      for ( size_t k = 0u; k < knobs_to_use.size(); ++k ) {
+        dials[k] = reweightingSigmas.at( k ).at( u );
+      }
+      auto const inserted = engineOfDials.emplace( std::move(dials),
+        engineUniverse.size() );
+      if ( inserted.second ) engineUniverse.push_back( u );
+      fUniverseEngine[u] = inserted.first->second;
+    }
+
+    if ( engineUniverse.size() < num_universes ) MF_LOG_INFO("GENIEWeightCalc")
+      << "GENIE weight calculator " << this->GetName() << " uses "
+      << engineUniverse.size() << " reweighting engines for its "
+      << num_universes << " universes.";
+
+    // Create one default-constructed genie::rew::GReWeight object per engine
+    reweightVector.resize( engineUniverse.size() );
+
+    // Set up the weight calculators for each engine
+    for ( auto& rwght : reweightVector ) {
+      this->SetupWeightCalculators( rwght, modes_to_use );
+    }
 
-      auto& rwght = reweightVector.at( u );
+    // Set up the knob values for each engine
+    for ( size_t e = 0; e < reweightVector.size(); ++e ) {
+
+      size_t const u = engineUniverse[e];
+      auto& rwght = reweightVector.at( e );
       genie::rew::GSystSet& syst = rwght.Systematics();
 
       for ( unsigned int k = 0; k < knobs_to_use.size(); ++k ) {
@@ -527,7 +597,7 @@ namespace evwgh {
 
       rwght.Reconfigure();
       rwght.Print();
-    } // loop over universes
+    } // loop over engines
 
   }
 
@@ -550,46 +620,49 @@ namespace evwgh {
     art::fill_ptr_vector( glist, gTruthHandle );
 
     size_t num_neutrinos = mclist.size();
-    size_t num_knobs = reweightVector.size();
+    size_t num_engines = reweightVector.size();
 
     // Calculate weight(s) here
     std::vector< std::vector<double> > weights( num_neutrinos );
+    GHEPRecordCache* cache = GetGHEPCache();
     for ( size_t v = 0u; v < num_neutrinos; ++v ) {
 
-      // Convert the MCTruth and GTruth objects from the event
-      // back into the original genie::EventRecord needed to
-      // compute the weights
-      std::unique_ptr< genie::EventRecord >
-        genie_event( evgb::RetrieveGHEP(*mclist[v], *glist[v]) );
-
-      // Set the final lepton kinetic energy and scattering cosine
-      // in the owned GENIE kinematics object. This is done during
-      // event generation but is not reproduced by evgb::RetrieveGHEP().
-      // Several new CCMEC weight calculators developed for MicroBooNE
-      // expect the variables to be set in this way (so that differential
-      // cross sections can be recomputed). Failing to set them results
-      // in inf and NaN weights.
-      // TODO: maybe update evgb::RetrieveGHEP to handle this instead.
-      genie::Interaction* interaction = genie_event->Summary();
-      genie::Kinematics* kine_ptr = interaction->KinePtr();
-
-      // Final lepton mass
-      double ml = interaction->FSPrimLepton()->Mass();
-      // Final lepton 4-momentum
-      const TLorentzVector& p4l = kine_ptr->FSLeptonP4();
-      // Final lepton kinetic energy
-      double Tl = p4l.E() - ml;
-      // Final lepton scattering cosine
-      double ctl = p4l.CosTheta();
-
-      kine_ptr->SetKV( kKVTl, Tl );
-      kine_ptr->SetKV( kKVctl, ctl );
+      // The event record is built only once per event, and shared by all
+      // the calculators: when running without the WeightManager cache,
+      // a private record is built instead
+      auto build = [&mclist, &glist, v]()
+        { return BuildGenieEvent( *mclist[v], *glist[v] ); };
+      std::unique_ptr< genie::EventRecord > own_event;
+      if ( !cache ) own_event = build();
+      const genie::EventRecord& genie_event = cache
+        ? cache->Get( mcTruthHandle.id(), v, build ): *own_event;
 
       // All right, the event record is fully ready. Now ask the GReWeight
       // objects to compute the weights.
-      weights[v].resize( num_knobs );
-      for (size_t k = 0u; k < num_knobs; ++k ) {
-        weights[v][k] = reweightVector.at( k ).CalcWeight( *genie_event );
+      std::vector<double> engine_weights( num_engines );
+      if ( !fParallelUniverses || num_engines < 2u ) {
+        // The shared record stays untouched: this calculator works on a copy
+        genie::EventRecord local_event( genie_event );
+        for (size_t k = 0u; k < num_engines; ++k ) {
+          engine_weights[k] = reweightVector.at( k ).CalcWeight( local_event );
+        }
+      }
+      else {
+        // The weight calculators may change the kinematics selection of the
+        // interaction while computing a weight, so each task works on a copy
+        // of the event record
+        tbb::parallel_for( tbb::blocked_range<size_t>( 0u, num_engines ),
+          [&]( tbb::blocked_range<size_t> const& engines ) {
+            genie::EventRecord local_event( genie_event );
+            for ( size_t k = engines.begin(); k != engines.end(); ++k ) {
+              engine_weights[k] = reweightVector.at( k ).CalcWeight( local_event );
+            }
+          } );
+      }
+
+      weights[v].resize( fUniverseEngine.size() );
+      for ( size_t u = 0u; u < fUniverseEngine.size(); ++u ) {
+        weights[v][u] = engine_weights[ fUniverseEngine[u] ];
       }
     }
     return weights;
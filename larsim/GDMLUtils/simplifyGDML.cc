@@ -126,6 +126,10 @@ void ConfigurationParser::printHelp
     "\nIt must be different from the input file:"
       " GEANT4 will refuse to overwrite."
     "\n"
+    "\nThe output has all the expressions, loops and references of the source"
+      " already resolved, and it is faster to load: jobs reading the same"
+      " geometry many times can be pointed to it instead of the source."
+    "\n"
     "\nNOTE: the path to the GDML schema in the output may need to be fixed by"
       " hand."
     "\nTo allow validation, the GDML schema must be present as described in the"
@@ -142,7 +146,7 @@ void ConfigurationParser::printHelp
     "\n    ask Geant4 to validated the GDML while reading (validation output"
     "\n    will be on screen, with no effect to the rest of the program)"
     "\n--overwrite , -f"
-    "\n    not implemented yet"
+    "\n    replace the output file if it already exists"
     "\n--nowrite , -r"
     "\n    only read (and validate as requested), do not write a new GDML file"
     "\n--setup=SETUPNAME , -s SETUPNAME"
@@ -288,7 +292,7 @@ std::string addNameSuffix(std::string name, std::string suffix) {
 } // addNameSuffix()
 
 bool exists(std::string path) {
-  return access(path.c_str(), F_OK);
+  return access(path.c_str(), F_OK) == 0;
 } // exists()
 
 //------------------------------------------------------------------------------
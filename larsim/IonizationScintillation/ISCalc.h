@@ -12,6 +12,9 @@
 #define LARG4_ISCALC_H
 
 #include "lardataobj/Simulation/SimEnergyDeposit.h"
+
+#include <vector>
+
 namespace detinfo {
   class DetectorPropertiesData;
 }
@@ -29,6 +32,18 @@ namespace larg4 {
     virtual ~ISCalc() = default;
     virtual ISCalcData CalcIonAndScint(detinfo::DetectorPropertiesData const& detProp,
                                        sim::SimEnergyDeposit const& edep) = 0;
+    // results for all the deposits in edeps, in the same order, replacing the
+    // content of results; same as calling the single-deposit version on each
+    virtual void
+    CalcIonAndScint(detinfo::DetectorPropertiesData const& detProp,
+                    std::vector<sim::SimEnergyDeposit> const& edeps,
+                    std::vector<ISCalcData>& results)
+    {
+      results.clear();
+      results.reserve(edeps.size());
+      for (sim::SimEnergyDeposit const& edep : edeps)
+        results.push_back(CalcIonAndScint(detProp, edep));
+    }
     virtual double EFieldAtStep(
       double efield,
       sim::SimEnergyDeposit const& edep) = 0; //value of field with any corrections for this step
@@ -18,7 +18,8 @@
 
 namespace larg4 {
   //----------------------------------------------------------------------------
-  ISCalcCorrelated::ISCalcCorrelated(detinfo::DetectorPropertiesData const& detProp)
+  ISCalcCorrelated::ISCalcCorrelated(detinfo::DetectorPropertiesData const& detProp,
+                                     bool useRecombTable)
     : fISTPC{*(lar::providerFrom<geo::Geometry>())}
   {
     std::cout << "IonizationAndScintillation/ISCalcCorrelated Initialize." << std::endl;
@@ -49,6 +50,40 @@ namespace larg4 {
 
     // ion+excitation work function (\todo: get from LArG4Parameters or LArProperties?)
     fWph = 19.5 * 1e-6; // MeV
+
+    // the table covers dE/dx up to 100 MeV/cm and +/-50% of the nominal field
+    double const field = detProp.Efield();
+    if (useRecombTable && field > 0.) {
+      fRecombTable = RecombinationTable{
+        [this](double dEdx, double EField) { return Recombination(dEdx, EField); },
+        1.,
+        100.,
+        0.025,
+        0.5 * field,
+        1.5 * field,
+        64};
+      mf::LogInfo("ISCalcCorrelated")
+        << "Recombination table for " << field << " kV/cm built; largest error found: "
+        << fRecombTable.maxError();
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  double
+  ISCalcCorrelated::Recombination(double dEdx, double EFieldStep) const
+  {
+    double recomb = 0.;
+    if (fUseModBoxRecomb) {
+      double Xi = fModBoxB * dEdx / EFieldStep;
+      recomb = log(fModBoxA + Xi) / Xi;
+    }
+    else {
+      recomb = fRecombA / (1. + dEdx * fRecombk / EFieldStep);
+    }
+    if (fUseModLarqlRecomb) { //Use corrections from LArQL model
+      recomb += EscapingEFraction(dEdx) * FieldCorrection(EFieldStep, dEdx); //Correction for low EF
+    }
+    return recomb;
   }
 
   //----------------------------------------------------------------------------
@@ -71,24 +106,14 @@ namespace larg4 {
     if(EFieldStep > 0) {
       // Guard against spurious values of dE/dx. Note: assumes density of LAr
       if (dEdx < 1.) dEdx = 1.;
+    }
 
-      // calculate recombination survival fraction
-      if (fUseModBoxRecomb) {
-	if (ds > 0) {
-	  double Xi = fModBoxB * dEdx / EFieldStep;
-	  recomb = log(fModBoxA + Xi) / Xi;
-	}
-	else {
-	  recomb = 0;
-	}
-      }
-      else {
-	recomb = fRecombA / (1. + dEdx * fRecombk / EFieldStep);
-      }
-
-    }//Efield
-
-    if(fUseModLarqlRecomb){ //Use corrections from LArQL model
+    // calculate recombination survival fraction (modified box needs a step length)
+    if ((EFieldStep > 0) && (ds > 0 || !fUseModBoxRecomb)) {
+      recomb = fRecombTable.contains(dEdx, EFieldStep) ? fRecombTable(dEdx, EFieldStep) :
+                                                          Recombination(dEdx, EFieldStep);
+    }
+    else if(fUseModLarqlRecomb){ //Use corrections from LArQL model
       recomb += EscapingEFraction(dEdx)*FieldCorrection(EFieldStep, dEdx); //Correction for low EF
     }
 
@@ -154,11 +179,11 @@ namespace larg4 {
 
 
 
-  double ISCalcCorrelated::EscapingEFraction(double const dEdx){ //LArQL chi0 function = fraction of escaping electrons
+  double ISCalcCorrelated::EscapingEFraction(double const dEdx) const { //LArQL chi0 function = fraction of escaping electrons
     return fLarqlChi0A/(fLarqlChi0B+exp(fLarqlChi0C+fLarqlChi0D*dEdx));
   }
 
-  double ISCalcCorrelated::FieldCorrection(double const EF, double const dEdx){ //LArQL f_corr function = correction factor for electric field dependence
+  double ISCalcCorrelated::FieldCorrection(double const EF, double const dEdx) const { //LArQL f_corr function = correction factor for electric field dependence
     return exp(-EF/(fLarqlAlpha*log(dEdx)+fLarqlBeta));
   }
 
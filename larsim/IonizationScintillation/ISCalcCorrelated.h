@@ -18,6 +18,7 @@
 
 #include "larsim/IonizationScintillation/ISCalc.h"
 #include "larsim/IonizationScintillation/ISTPC.h"
+#include "larsim/IonizationScintillation/RecombinationTable.h"
 
 #include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
 #include "lardata/DetectorInfoServices/LArPropertiesService.h"
@@ -34,11 +35,14 @@
 namespace larg4 {
   class ISCalcCorrelated : public ISCalc {
   public:
-    ISCalcCorrelated(detinfo::DetectorPropertiesData const& detProp);
+    // with useRecombTable, the recombination is interpolated from a table
+    // (see RecombinationTable) where the table covers the deposit
+    ISCalcCorrelated(detinfo::DetectorPropertiesData const& detProp, bool useRecombTable = false);
 
     double EFieldAtStep(double efield,
                         sim::SimEnergyDeposit const& edep)
       override; //value of field with any corrections for this step
+    using ISCalc::CalcIonAndScint;
     ISCalcData CalcIonAndScint(detinfo::DetectorPropertiesData const& detProp,
                                sim::SimEnergyDeposit const& edep) override;
 
@@ -59,6 +63,7 @@ namespace larg4 {
     double fLarqlBeta;        ///< from LArG4Parameters service
     bool fUseModBoxRecomb;    ///< from LArG4Parameters service
     bool fUseModLarqlRecomb;  ///< from LArG4Parameters service
+    RecombinationTable fRecombTable; ///< tabulated recombination (empty if not used)
 
     const spacecharge::SpaceCharge* fSCE;
     const detinfo::LArProperties* fLArProp;
@@ -66,8 +71,9 @@ namespace larg4 {
     void CalcIon(sim::SimEnergyDeposit const& edep);
     void CalcScint(sim::SimEnergyDeposit const& edep);
     double GetScintYieldRatio(sim::SimEnergyDeposit const& edep);
-    double EscapingEFraction(double const dEdx); //LArQL chi0 function = fraction of escaping electrons
-    double FieldCorrection(double const EF, double const dEdx); //LArQL f_corr function = correction factor for electric field dependence
+    double EscapingEFraction(double const dEdx) const; //LArQL chi0 function = fraction of escaping electrons
+    double FieldCorrection(double const EF, double const dEdx) const; //LArQL f_corr function = correction factor for electric field dependence
+    double Recombination(double dEdx, double EFieldStep) const; // for positive step length and field
     ISTPC fISTPC;
   };
 }
@@ -41,17 +41,68 @@ namespace larg4 {
   ISCalcNESTLAr::CalcIonAndScint(detinfo::DetectorPropertiesData const& detProp,
                                  sim::SimEnergyDeposit const& edep)
   {
-    CLHEP::RandGauss GaussGen(fEngine);
-    CLHEP::RandFlat UniformGen(fEngine);
+    FieldParams fieldParams;
+    return SampleYield(CalcMeanYield(detProp, edep, fieldParams));
+  }
+
+  //----------------------------------------------------------------------------
+  void
+  ISCalcNESTLAr::CalcIonAndScint(detinfo::DetectorPropertiesData const& detProp,
+                                 std::vector<sim::SimEnergyDeposit> const& edeps,
+                                 std::vector<ISCalcData>& results)
+  {
+    // the field-dependent parameters are computed again only when the field
+    // changes, which without space charge effects is never
+    FieldParams fieldParams;
+    std::vector<MeanYield> means;
+    means.reserve(edeps.size());
+    for (sim::SimEnergyDeposit const& edep : edeps)
+      means.push_back(CalcMeanYield(detProp, edep, fieldParams));
+
+    results.clear();
+    results.reserve(means.size());
+    for (MeanYield const& mean : means)
+      results.push_back(SampleYield(mean));
+  }
 
-    double yieldFactor = 1.0; // default quenching factor, for electronic recoils
-    double excitationRatio =
+  //----------------------------------------------------------------------------
+  void
+  ISCalcNESTLAr::UpdateFieldParams(FieldParams& params, double eField) const
+  {
+    if (params.eField == eField) return;
+    params.eField = eField;
+
+    if (eField) {
+      params.dokeBirks[0] = 0.07 * pow((eField / 1.0e3), -0.85);
+      params.dokeBirks[2] = 0.00;
+    }
+    else {
+      params.dokeBirks[0] = 0.0003;
+      params.dokeBirks[2] = 0.75;
+    }
+    params.dokeBirks[1] = params.dokeBirks[0] / (1 - params.dokeBirks[2]); //B=A/(1-C) (see paper)
+
+    params.nrExcitationRatio = 0.69337 + 0.3065 * exp(-0.008806 * pow(eField, 0.76313));
+  }
+
+  //----------------------------------------------------------------------------
+  ISCalcNESTLAr::MeanYield
+  ISCalcNESTLAr::CalcMeanYield(detinfo::DetectorPropertiesData const& detProp,
+                               sim::SimEnergyDeposit const& edep,
+                               FieldParams& fieldParams)
+  {
+    MeanYield mean;
+    mean.energyDeposit = edep.Energy();
+    mean.yieldFactor = 1.0; // default quenching factor, for electronic recoils
+    mean.excitationRatio =
       0.21; // ratio for light particle in LAr, such as e-, mu-, Aprile et. al book
+    mean.recombProb = 0.;
+    mean.scintYieldRatio = 0.;
 
-    double const energyDeposit = edep.Energy();
+    double const energyDeposit = mean.energyDeposit;
     if (energyDeposit < 1 * CLHEP::eV) // too small energy deposition
     {
-      return {0., 0., 0., 0.};
+      return mean;
     }
 
     int pdgcode = edep.PdgCode();
@@ -63,17 +114,9 @@ namespace larg4 {
     geo::Length_t endy = edep.EndY();
     geo::Length_t endz = edep.EndZ();
 
-    double DokeBirks[3];
-
     double eField = EFieldAtStep(detProp.Efield(), edep);
-    if (eField) {
-      DokeBirks[0] = 0.07 * pow((eField / 1.0e3), -0.85);
-      DokeBirks[2] = 0.00;
-    }
-    else {
-      DokeBirks[0] = 0.0003;
-      DokeBirks[2] = 0.75;
-    }
+    UpdateFieldParams(fieldParams, eField);
+    double const* DokeBirks = fieldParams.dokeBirks;
 
     double Density = detProp.Density() /
                      (CLHEP::g / CLHEP::cm3); // argon density at the temperature from Temperature()
@@ -84,32 +127,10 @@ namespace larg4 {
 
     if (pdgcode == 2112 || pdgcode == -2112) //nuclear recoil
     {
-      yieldFactor = 0.23 * (1 + exp(-5 * epsilon)); //liquid argon L_eff
-      excitationRatio = 0.69337 + 0.3065 * exp(-0.008806 * pow(eField, 0.76313));
-    }
-
-    // determine ultimate number of quanta from current E-deposition (ph+e-) total mean number of exc/ions
-    //the total number of either quanta produced is equal to product of the
-    //work function, the energy deposited, and yield reduction, for NR
-    double MeanNumQuanta = scint_yield * energyDeposit;
-    double sigma = sqrt(resolution_scale * MeanNumQuanta); //Fano
-    int NumQuanta = int(floor(GaussGen.fire(MeanNumQuanta, sigma) + 0.5));
-    double LeffVar = GaussGen.fire(yieldFactor, 0.25 * yieldFactor);
-    LeffVar = std::clamp(LeffVar, 0., 1.);
-
-    if (yieldFactor < 1) //nuclear reocils
-    {
-      NumQuanta = BinomFluct(NumQuanta, LeffVar);
+      mean.yieldFactor = 0.23 * (1 + exp(-5 * epsilon)); //liquid argon L_eff
+      mean.excitationRatio = fieldParams.nrExcitationRatio;
     }
 
-    //if Edep below work function, can't make any quanta, and if NumQuanta
-    //less than zero because Gaussian fluctuated low, update to zero
-    if (energyDeposit < 1 / scint_yield || NumQuanta < 0) { NumQuanta = 0; }
-
-    // next section binomially assigns quanta to excitons and ions
-    int NumExcitons = BinomFluct(NumQuanta, excitationRatio / (1 + excitationRatio));
-    int NumIons = NumQuanta - NumExcitons;
-
     // this section calculates recombination following the modified Birks'Law of Doke, deposition by deposition,
     // may be overridden later in code if a low enough energy necessitates switching to the
     // Thomas-Imel box model for recombination instead (determined by site)
@@ -151,24 +172,62 @@ namespace larg4 {
       }
     }
 
-    DokeBirks[1] = DokeBirks[0] / (1 - DokeBirks[2]); //B=A/(1-C) (see paper)    r
     recombProb = (DokeBirks[0] * LET) / (1 + DokeBirks[1] * LET) +
                  DokeBirks[2]; //Doke/Birks' Law as spelled out in the NEST pape
     recombProb *= (Density / Density_LAr);
 
     //check against unphysicality resulting from rounding errors
-    recombProb = std::clamp(recombProb, 0., 1.);
+    mean.recombProb = std::clamp(recombProb, 0., 1.);
+
+    mean.scintYieldRatio = GetScintYieldRatio(edep);
+    return mean;
+  }
+
+  //----------------------------------------------------------------------------
+  ISCalcData
+  ISCalcNESTLAr::SampleYield(MeanYield const& mean)
+  {
+    double const energyDeposit = mean.energyDeposit;
+    if (energyDeposit < 1 * CLHEP::eV) // too small energy deposition
+    {
+      return {0., 0., 0., 0.};
+    }
+
+    CLHEP::RandGauss GaussGen(fEngine);
+
+    // determine ultimate number of quanta from current E-deposition (ph+e-) total mean number of exc/ions
+    //the total number of either quanta produced is equal to product of the
+    //work function, the energy deposited, and yield reduction, for NR
+    double MeanNumQuanta = scint_yield * energyDeposit;
+    double sigma = sqrt(resolution_scale * MeanNumQuanta); //Fano
+    int NumQuanta = int(floor(GaussGen.fire(MeanNumQuanta, sigma) + 0.5));
+    double LeffVar = GaussGen.fire(mean.yieldFactor, 0.25 * mean.yieldFactor);
+    LeffVar = std::clamp(LeffVar, 0., 1.);
+
+    if (mean.yieldFactor < 1) //nuclear reocils
+    {
+      NumQuanta = BinomFluct(NumQuanta, LeffVar);
+    }
+
+    //if Edep below work function, can't make any quanta, and if NumQuanta
+    //less than zero because Gaussian fluctuated low, update to zero
+    if (energyDeposit < 1 / scint_yield || NumQuanta < 0) { NumQuanta = 0; }
+
+    // next section binomially assigns quanta to excitons and ions
+    int NumExcitons =
+      BinomFluct(NumQuanta, mean.excitationRatio / (1 + mean.excitationRatio));
+    int NumIons = NumQuanta - NumExcitons;
 
     //use binomial distribution to assign photons, electrons, where photons
     //are excitons plus recombined ionization electrons, while final
     //collected electrons are the "escape" (non-recombined) electrons
-    int const NumPhotons = NumExcitons + BinomFluct(NumIons, recombProb);
+    int const NumPhotons = NumExcitons + BinomFluct(NumIons, mean.recombProb);
     int const NumElectrons = NumQuanta - NumPhotons;
 
     return {energyDeposit,
             static_cast<double>(NumElectrons),
             static_cast<double>(NumPhotons),
-            GetScintYieldRatio(edep)};
+            mean.scintYieldRatio};
   }
 
   //----------------------------------------------------------------------------
@@ -204,8 +263,9 @@ namespace larg4 {
     double LET;
 
     if (E >= 1) {
-      LET = 116.70 - 162.97 * log10(E) + 99.361 * pow(log10(E), 2) - 33.405 * pow(log10(E), 3) +
-            6.5069 * pow(log10(E), 4) - 0.69334 * pow(log10(E), 5) + .031563 * pow(log10(E), 6);
+      double const logE = log10(E);
+      LET = 116.70 - 162.97 * logE + 99.361 * pow(logE, 2) - 33.405 * pow(logE, 3) +
+            6.5069 * pow(logE, 4) - 0.69334 * pow(logE, 5) + .031563 * pow(logE, 6);
     }
     else if (E > 0 && E < 1) {
       LET = 100;
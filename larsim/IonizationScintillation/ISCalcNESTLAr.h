@@ -19,6 +19,8 @@ namespace detinfo {
 
 #include "CLHEP/Random/RandEngine.h"
 
+#include <vector>
+
 namespace larg4 {
   class ISCalcNESTLAr : public ISCalc {
   public:
@@ -29,12 +31,40 @@ namespace larg4 {
       override; //value of field with any corrections for this step
     ISCalcData CalcIonAndScint(detinfo::DetectorPropertiesData const& detProp,
                                sim::SimEnergyDeposit const& edep) override;
+    // the deterministic part of the yields of all deposits is computed first,
+    // then the fluctuations are sampled in order: results are the same as
+    // from the single-deposit version
+    void CalcIonAndScint(detinfo::DetectorPropertiesData const& detProp,
+                         std::vector<sim::SimEnergyDeposit> const& edeps,
+                         std::vector<ISCalcData>& results) override;
 
   private:
+    // field-dependent parameters of the yield model
+    struct FieldParams {
+      double eField = -1.;         // field these parameters are computed for
+      double dokeBirks[3];         // modified Birks' law parameters
+      double nrExcitationRatio;    // exciton/ion ratio for nuclear recoils
+    };
+
+    // everything about a deposit that does not need random numbers
+    struct MeanYield {
+      double energyDeposit;        // total energy deposited in the step
+      double yieldFactor;          // quenching factor
+      double excitationRatio;      // exciton/ion ratio
+      double recombProb;           // recombination probability
+      double scintYieldRatio;      // liquid argon scintillation yield ratio
+    };
+
     CLHEP::HepRandomEngine& fEngine; // random engine
     const spacecharge::SpaceCharge* fSCE;
     const detinfo::LArProperties* fLArProp;
 
+    void UpdateFieldParams(FieldParams& params, double eField) const;
+    MeanYield CalcMeanYield(detinfo::DetectorPropertiesData const& detProp,
+                            sim::SimEnergyDeposit const& edep,
+                            FieldParams& fieldParams);
+    ISCalcData SampleYield(MeanYield const& mean);
+
     int BinomFluct(int N0, double prob);
     double CalcElectronLET(double E);
     double GetScintYieldRatio(sim::SimEnergyDeposit const& edep);
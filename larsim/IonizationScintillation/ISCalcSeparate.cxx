@@ -19,7 +19,7 @@ namespace {
 
 namespace larg4 {
   //----------------------------------------------------------------------------
-  ISCalcSeparate::ISCalcSeparate()
+  ISCalcSeparate::ISCalcSeparate(bool useRecombTable) : fUseRecombTable{useRecombTable}
   {
     fSCE = lar::providerFrom<spacecharge::SpaceChargeService>();
     fLArProp = lar::providerFrom<detinfo::LArPropertiesService>();
@@ -53,19 +53,12 @@ namespace larg4 {
     // Guard against spurious values of dE/dx. Note: assumes density of LAr
     if (dEdx < 1.) { dEdx = 1.; }
 
-    if (fUseModBoxRecomb) {
-      if (ds > 0) {
-        double const scaled_modboxb = fModBoxB / detProp.Density(detProp.Temperature());
-        double const Xi = scaled_modboxb * dEdx / EFieldStep;
-        recomb = log(fModBoxA + Xi) / Xi;
-      }
-      else {
-        recomb = 0;
-      }
+    if (fUseModBoxRecomb && !(ds > 0)) { recomb = 0; }
+    else if (fUseRecombTable && RecombTable(detProp).contains(dEdx, EFieldStep)) {
+      recomb = fRecombTable(dEdx, EFieldStep);
     }
     else {
-      double const scaled_recombk = fRecombk / detProp.Density(detProp.Temperature());
-      recomb = fRecombA / (1. + dEdx * scaled_recombk / EFieldStep);
+      recomb = Recombination(dEdx, EFieldStep, detProp.Density(detProp.Temperature()));
     }
 
     // 1.e-3 converts fEnergyDeposit to GeV
@@ -77,6 +70,52 @@ namespace larg4 {
     return numIonElectrons;
   }
 
+  //----------------------------------------------------------------------------
+  double
+  ISCalcSeparate::Recombination(double dEdx, double EFieldStep, double density) const
+  {
+    if (fUseModBoxRecomb) {
+      double const scaled_modboxb = fModBoxB / density;
+      double const Xi = scaled_modboxb * dEdx / EFieldStep;
+      return log(fModBoxA + Xi) / Xi;
+    }
+    else {
+      double const scaled_recombk = fRecombk / density;
+      return fRecombA / (1. + dEdx * scaled_recombk / EFieldStep);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // the table covers dE/dx up to 100 MeV/cm and +/-50% of the nominal field;
+  // it is built again if the density or the nominal field change
+  RecombinationTable const&
+  ISCalcSeparate::RecombTable(detinfo::DetectorPropertiesData const& detProp)
+  {
+    double const density = detProp.Density(detProp.Temperature());
+    double const field = detProp.Efield();
+    if ((density == fRecombTableDensity) && (field == fRecombTableField)) return fRecombTable;
+
+    fRecombTableDensity = density;
+    fRecombTableField = field;
+    if (field > 0.) {
+      fRecombTable = RecombinationTable{
+        [this, density](double dEdx, double EField) { return Recombination(dEdx, EField, density); },
+        1.,
+        100.,
+        0.025,
+        0.5 * field,
+        1.5 * field,
+        64};
+      mf::LogInfo("ISCalcSeparate")
+        << "Recombination table for " << field << " kV/cm built; largest error found: "
+        << fRecombTable.maxError();
+    }
+    else {
+      fRecombTable = RecombinationTable{};
+    }
+    return fRecombTable;
+  }
+
   //----------------------------------------------------------------------------
   std::pair<double, double>
   ISCalcSeparate::CalcScint(sim::SimEnergyDeposit const& edep)
@@ -14,6 +14,7 @@
 #define IS_ISCALCSEPARATE_H
 
 #include "larsim/IonizationScintillation/ISCalc.h"
+#include "larsim/IonizationScintillation/RecombinationTable.h"
 
 #include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
 #include "lardata/DetectorInfoServices/LArPropertiesService.h"
@@ -30,12 +31,15 @@
 namespace larg4 {
   class ISCalcSeparate : public ISCalc {
   public:
-    ISCalcSeparate();
+    // with useRecombTable, the recombination is interpolated from a table
+    // (see RecombinationTable) where the table covers the deposit
+    explicit ISCalcSeparate(bool useRecombTable = false);
     void Reset();
 
     double EFieldAtStep(double efield,
                         sim::SimEnergyDeposit const& edep)
       override; //value of field with any corrections for this step
+    using ISCalc::CalcIonAndScint;
     ISCalcData CalcIonAndScint(detinfo::DetectorPropertiesData const& detProp,
                                sim::SimEnergyDeposit const& edep) override;
 
@@ -46,12 +50,19 @@ namespace larg4 {
     double fModBoxA;        ///< from LArG4Parameters service
     double fModBoxB;        ///< from LArG4Parameters service
     bool fUseModBoxRecomb;  ///< from LArG4Parameters service
+    bool fUseRecombTable;   ///< whether to use the recombination table
+
+    RecombinationTable fRecombTable;    ///< tabulated recombination
+    double fRecombTableDensity = -1.;   ///< argon density the table is built for
+    double fRecombTableField = -1.;     ///< nominal field the table is built for
 
     const spacecharge::SpaceCharge* fSCE;
     const detinfo::LArProperties* fLArProp;
 
     double CalcIon(detinfo::DetectorPropertiesData const& detProp,
                    sim::SimEnergyDeposit const& edep);
+    double Recombination(double dEdx, double EFieldStep, double density) const;
+    RecombinationTable const& RecombTable(detinfo::DetectorPropertiesData const& detProp);
     std::pair<double, double> CalcScint(sim::SimEnergyDeposit const& edep);
     double GetScintYieldRatio(sim::SimEnergyDeposit const& edep);
   };
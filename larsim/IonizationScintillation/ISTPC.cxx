@@ -15,6 +15,11 @@
 
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
+#include <algorithm>
+#include <cmath>
+#include <numeric> // std::partial_sum()
+#include <utility> // std::make_pair()
+
 
 namespace larg4 {
   //----------------------------------------------------------------------------                 
@@ -31,6 +36,11 @@ namespace larg4 {
         log << "\n - C:" << iCryo << ": " << box.Min() << " -- " << box.Max() << " cm";
       }
     } // local scope        
+
+    buildTPCIndex(geom);
+    mf::LogTrace("IonAndScint") << "IonAndScint: " << fTPCIDs.size() << " TPCs indexed on a "
+                                << fNCells[0] << "x" << fNCells[1] << "x" << fNCells[2]
+                                << " grid.";
   }
 
 
@@ -38,10 +48,105 @@ namespace larg4 {
 
 
  bool
- ISTPC::isScintInActiveVolume(geo::Point_t const& ScintPoint)
+ ISTPC::isScintInActiveVolume(geo::Point_t const& ScintPoint) const
  {       
    return fActiveVolumes[0].ContainsPosition(ScintPoint);
  }
+
+  //----------------------------------------------------------------------------
+  geo::TPCID
+  ISTPC::TPCIndexOf(geo::Point_t const& point) const
+  {
+    std::size_t const cell = gridCell(point);
+    if (cell == NoCell) return {};
+    for (std::size_t i = fCellStart[cell]; i < fCellStart[cell + 1]; ++i) {
+      unsigned int const iTPC = fCellTPCs[i];
+      if (fTPCVolumes[iTPC].ContainsPosition(point)) return fTPCIDs[iTPC];
+    }
+    return {};
+  }
+
+  //----------------------------------------------------------------------------
+  std::size_t
+  ISTPC::gridCell(geo::Point_t const& point) const
+  {
+    double const coords[3] = {point.X(), point.Y(), point.Z()};
+    std::size_t cell = 0;
+    for (int i = 0; i < 3; ++i) {
+      double const f = (coords[i] - fGridMin[i]) * fInvCellSize[i];
+      if (!(f >= 0.) || (f > fNCells[i])) return NoCell;
+      // the upper boundary of the grid belongs to its last cell
+      cell = cell * fNCells[i] + std::min(static_cast<std::size_t>(f), fNCells[i] - 1);
+    }
+    return cell;
+  }
+
+  //----------------------------------------------------------------------------
+  void
+  ISTPC::buildTPCIndex(geo::GeometryCore const& geom)
+  {
+    // largest number of cells on each side of the grid
+    constexpr std::size_t MaxCellsPerAxis = 128;
+
+    fTPCIDs.clear();
+    fTPCVolumes.clear();
+    for (geo::TPCGeo const& TPC : geom.IterateTPCs()) {
+      fTPCIDs.push_back(TPC.ID());
+      fTPCVolumes.push_back(TPC.ActiveBoundingBox());
+    }
+    if (fTPCVolumes.empty()) return;
+
+    // the grid covers all the active volumes, with cells as large as the
+    // thinnest TPC on each side, so that a cell overlaps few TPCs
+    geo::BoxBoundedGeo all{fTPCVolumes.front()};
+    double minSize[3] = {all.SizeX(), all.SizeY(), all.SizeZ()};
+    for (geo::BoxBoundedGeo const& box : fTPCVolumes) {
+      all.ExtendToInclude(box);
+      double const sizes[3] = {box.SizeX(), box.SizeY(), box.SizeZ()};
+      for (int i = 0; i < 3; ++i)
+        if (sizes[i] > 0.) minSize[i] = std::min(minSize[i], sizes[i]);
+    }
+    double const allMin[3] = {all.MinX(), all.MinY(), all.MinZ()};
+    double const allSize[3] = {all.SizeX(), all.SizeY(), all.SizeZ()};
+    for (int i = 0; i < 3; ++i) {
+      fGridMin[i] = allMin[i];
+      fNCells[i] = (minSize[i] > 0.) ?
+        static_cast<std::size_t>(std::ceil(allSize[i] / minSize[i])) : 1;
+      fNCells[i] = std::clamp<std::size_t>(fNCells[i], 1, MaxCellsPerAxis);
+      fInvCellSize[i] = (allSize[i] > 0.) ? fNCells[i] / allSize[i] : 0.;
+    }
+
+    // range of cells overlapped by a box, on axis i
+    auto const cellRange = [this](int i, double min, double max) {
+      auto const cellOf = [this, i](double x) {
+        double const f = (x - fGridMin[i]) * fInvCellSize[i];
+        return std::min(static_cast<std::size_t>(std::max(f, 0.)), fNCells[i] - 1);
+      };
+      return std::make_pair(cellOf(min), cellOf(max));
+    };
+
+    // two passes: count the TPCs of each cell, then fill them in
+    std::size_t const nCells = fNCells[0] * fNCells[1] * fNCells[2];
+    std::vector<std::size_t> counts(nCells + 1, 0);
+    auto const forEachCell = [&](geo::BoxBoundedGeo const& box, auto&& action) {
+      auto const [x0, x1] = cellRange(0, box.MinX(), box.MaxX());
+      auto const [y0, y1] = cellRange(1, box.MinY(), box.MaxY());
+      auto const [z0, z1] = cellRange(2, box.MinZ(), box.MaxZ());
+      for (std::size_t x = x0; x <= x1; ++x)
+        for (std::size_t y = y0; y <= y1; ++y)
+          for (std::size_t z = z0; z <= z1; ++z)
+            action((x * fNCells[1] + y) * fNCells[2] + z);
+    };
+    for (geo::BoxBoundedGeo const& box : fTPCVolumes)
+      forEachCell(box, [&counts](std::size_t cell) { ++counts[cell + 1]; });
+
+    fCellStart.resize(nCells + 1);
+    std::partial_sum(counts.begin(), counts.end(), fCellStart.begin());
+    fCellTPCs.resize(fCellStart.back());
+    std::vector<std::size_t> next(fCellStart.begin(), fCellStart.end() - 1);
+    for (auto const& [iTPC, box] : util::enumerate(fTPCVolumes))
+      forEachCell(box, [&](std::size_t cell) { fCellTPCs[next[cell]++] = iTPC; });
+  }
   //----------------------------------------------------------------------------                                 
 
          
@@ -11,19 +11,43 @@
 
 #include "larcore/Geometry/Geometry.h"
 
+#include <cstddef>
+#include <vector>
+
 namespace larg4 {
   class ISTPC {
   public:
 
     explicit ISTPC(geo::GeometryCore const& geom);
-    bool isScintInActiveVolume(geo::Point_t const& ScintPoint);
+    bool isScintInActiveVolume(geo::Point_t const& ScintPoint) const;
     static std::vector<geo::BoxBoundedGeo> extractActiveLArVolume(geo::GeometryCore const& geom);
- 
+
+    /// Returns the TPC whose active volume contains `point` (invalid if none).
+    geo::TPCID TPCIndexOf(geo::Point_t const& point) const;
+
  private:
 
+    static constexpr std::size_t NoCell = static_cast<std::size_t>(-1);
+
     std::vector<geo::BoxBoundedGeo> fActiveVolumes;
-      
+
+    // Active volume of each TPC, and a uniform grid covering all of them:
+    // each cell lists the TPCs overlapping it, so that the TPC of a point
+    // is found among a few candidates (fCellTPCs[fCellStart[c]] to
+    // fCellTPCs[fCellStart[c + 1]] for cell c).
+    std::vector<geo::TPCID> fTPCIDs;
+    std::vector<geo::BoxBoundedGeo> fTPCVolumes;
+    double fGridMin[3] = {0., 0., 0.};
+    double fInvCellSize[3] = {0., 0., 0.};
+    std::size_t fNCells[3] = {0, 0, 0};
+    std::vector<std::size_t> fCellStart;
+    std::vector<unsigned int> fCellTPCs;
+
+    void buildTPCIndex(geo::GeometryCore const& geom);
+
+    /// Index of the grid cell of `point`, `NoCell` if out of the grid.
+    std::size_t gridCell(geo::Point_t const& point) const;
+
   };
 }
 #endif
-
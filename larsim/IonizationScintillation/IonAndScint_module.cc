@@ -13,6 +13,22 @@
 //fhicl parameter tag.
 //At the end of this module the numPhotons and numElectrons of sim:SimEnergyDeposit have been updated.
 //
+//With "UseRecombinationTable", the Separate and Correlated algorithms interpolate
+//the recombination from a (dE/dx, field) table instead of evaluating the model.
+//
+//With "ParallelDeposits", the deposits of all the input collections are split
+//in blocks of "ParallelBlockSize" which are processed in parallel threads.
+//Each block has its own random stream, identified by the event and the block
+//index, so the result does not depend on the number of threads (but it is
+//different from the serial processing when the algorithm uses random numbers).
+//
+//With "StoreCompactEnergyDeposits", the deposits are also stored as a
+//sim::CompactSimEnergyDeposits, with single precision positions and start times
+//quantised in steps of "CompactEnergyDepositTimeResolution" [ns]; the full
+//collection can then be dropped from the output, and SimDriftElectrons,
+//PDFastSimPAR, PDFastSimPVS and ShiftEdepSCE read the compact one with their
+//"CompactEnergyDeposits" option.
+//
 // Aug.18 by Mu Wei
 //
 // 10/28/2019 Wenqiang Gu (wgu@bnl.gov)
@@ -27,6 +43,8 @@
 #include "larsim/IonizationScintillation/ISCalcCorrelated.h"
 #include "larsim/IonizationScintillation/ISCalcNESTLAr.h"
 #include "larsim/IonizationScintillation/ISCalcSeparate.h"
+#include "larsim/Simulation/CompactSimEnergyDeposits.h"
+#include "larsim/Utils/CounterBasedRandomEngine.h"
 #include "nurandom/RandomUtils/NuRandomService.h"
 
 // Framework includes
@@ -35,8 +53,16 @@
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "canvas/Utilities/Exception.h"
 #include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
 
+#include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
+
+#include <algorithm> // std::find(), std::max()
+#include <cstdint>
 #include <iostream>
 #include <sstream> // std::stringstream, std::stringbuf
 #include <stdio.h>
@@ -53,12 +79,32 @@ namespace larg4 {
     void endJob() override;
 
   private:
+    // calculator and random stream of a thread in parallel mode
+    struct ThreadCalc {
+      larsim::Utils::PhiloxRandomEngine engine;
+      std::unique_ptr<ISCalc> alg;
+    };
+
+    std::unique_ptr<ISCalc> makeISCalc(CLHEP::HepRandomEngine& engine) const;
+
+    // copy of edepi with the yields from isCalcData, and shifted by SCE if shiftSCE
+    sim::SimEnergyDeposit makeDeposit(sim::SimEnergyDeposit const& edepi,
+                                      ISCalcData const& isCalcData,
+                                      spacecharge::SpaceCharge const* sce,
+                                      bool shiftSCE) const;
+
     art::InputTag calcTag; // name of calculator: Separate, Correlated, or NEST
     std::unique_ptr<ISCalc> fISAlg;
     CLHEP::HepRandomEngine& fEngine;
     string Instances;
     std::vector<string> instanceNames;
     bool fSavePriorSCE;
+    bool fUseRecombTable;              // interpolate the recombination from a table
+    bool fParallelDeposits;            // process blocks of deposits in parallel
+    std::size_t fParallelBlockSize;    // deposits sharing a random stream in parallel mode
+    bool fStoreCompactEdeps;           // also store the deposits in compact format
+    double fCompactEdepTimeResolution; // step of the compact start times [ns]
+    tbb::enumerable_thread_specific<ThreadCalc> fThreadCalc;
   };
 
   //......................................................................
@@ -71,7 +117,18 @@ namespace larg4 {
         pset.get<string>("Instances", "LArG4DetectorServicevolTPCActive"),
       }
     , fSavePriorSCE{pset.get<bool>("SavePriorSCE",  false)}
+    , fUseRecombTable{pset.get<bool>("UseRecombinationTable", false)}
+    , fParallelDeposits{pset.get<bool>("ParallelDeposits", false)}
+    , fParallelBlockSize{std::max(pset.get<unsigned int>("ParallelBlockSize", 4096U), 1U)}
+    , fStoreCompactEdeps{pset.get<bool>("StoreCompactEnergyDeposits", false)}
+    , fCompactEdepTimeResolution{pset.get<double>("CompactEnergyDepositTimeResolution", 0.1)}
   {
+    if (fStoreCompactEdeps && !(fCompactEdepTimeResolution > 0.0)) {
+      throw art::Exception(art::errors::Configuration)
+        << "CompactEnergyDepositTimeResolution must be positive ("
+        << fCompactEdepTimeResolution << " ns requested).\n";
+    }
+
     std::cout << "IonAndScint Module Construct" << std::endl;
 
     if (Instances.empty()) {
@@ -94,6 +151,7 @@ namespace larg4 {
 
     produces<std::vector<sim::SimEnergyDeposit>>();
     if (fSavePriorSCE) produces<std::vector<sim::SimEnergyDeposit>>("priorSCE");
+    if (fStoreCompactEdeps) produces<sim::CompactSimEnergyDeposits>();
   }
 
   //......................................................................
@@ -103,16 +161,59 @@ namespace larg4 {
     std::cout << "IonAndScint beginJob." << std::endl;
     std::cout << "Using " << calcTag.label() << " algorithm to calculate IS." << std::endl;
 
-    if (calcTag.label() == "Separate")
-      fISAlg = std::make_unique<ISCalcSeparate>();
-    else if (calcTag.label() == "Correlated") {
+    fISAlg = makeISCalc(fEngine);
+    if (!fISAlg) mf::LogWarning("IonAndScint") << "No ISCalculation set, this can't be good.";
+  }
+
+  //......................................................................
+  std::unique_ptr<ISCalc>
+  IonAndScint::makeISCalc(CLHEP::HepRandomEngine& engine) const
+  {
+    if (calcTag.label() == "Separate") return std::make_unique<ISCalcSeparate>(fUseRecombTable);
+    if (calcTag.label() == "Correlated") {
       auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataForJob();
-      fISAlg = std::make_unique<ISCalcCorrelated>(detProp);
+      return std::make_unique<ISCalcCorrelated>(detProp, fUseRecombTable);
     }
-    else if (calcTag.label() == "NEST")
-      fISAlg = std::make_unique<ISCalcNESTLAr>(fEngine);
-    else
-      mf::LogWarning("IonAndScint") << "No ISCalculation set, this can't be good.";
+    if (calcTag.label() == "NEST") return std::make_unique<ISCalcNESTLAr>(engine);
+    return nullptr;
+  }
+
+  //......................................................................
+  sim::SimEnergyDeposit
+  IonAndScint::makeDeposit(sim::SimEnergyDeposit const& edepi,
+                           ISCalcData const& isCalcData,
+                           spacecharge::SpaceCharge const* sce,
+                           bool shiftSCE) const
+  {
+    int ph_num = round(isCalcData.numPhotons);
+    int ion_num = round(isCalcData.numElectrons);
+    float scintyield = isCalcData.scintillationYieldRatio;
+    float edep_tmp = edepi.Energy();
+    geo::Point_t startPos_tmp = edepi.Start();
+    geo::Point_t endPos_tmp = edepi.End();
+
+    if (shiftSCE) {
+      auto posOffsetsStart = sce->GetPosOffsets({edepi.StartX(), edepi.StartY(), edepi.StartZ()});
+      auto posOffsetsEnd = sce->GetPosOffsets({edepi.EndX(), edepi.EndY(), edepi.EndZ()});
+      startPos_tmp =
+        geo::Point_t{(float)(edepi.StartX() - posOffsetsStart.X()), //x should be subtracted
+                     (float)(edepi.StartY() + posOffsetsStart.Y()),
+                     (float)(edepi.StartZ() + posOffsetsStart.Z())};
+      endPos_tmp = geo::Point_t{(float)(edepi.EndX() - posOffsetsEnd.X()), //x should be subtracted
+                                (float)(edepi.EndY() + posOffsetsEnd.Y()),
+                                (float)(edepi.EndZ() + posOffsetsEnd.Z())};
+    }
+
+    return {ph_num,
+            ion_num,
+            scintyield,
+            edep_tmp,
+            startPos_tmp,
+            endPos_tmp,
+            edepi.StartT(),
+            edepi.EndT(),
+            edepi.TrackID(),
+            edepi.PdgCode()};
   }
 
   //......................................................................
@@ -126,14 +227,12 @@ namespace larg4 {
   void
   IonAndScint::produce(art::Event& event)
   {
-    std::cout << "IonAndScint Module Producer" << std::endl;
-    //std::vector<art::Handle<std::vector<sim::SimEnergyDeposit>>> edepHandle;
+    MF_LOG_DEBUG("IonAndScint") << "IonAndScint Module Producer";
 
-    //event.getManyByType(edepHandle);
     auto edepHandle = event.getMany<std::vector<sim::SimEnergyDeposit>>();
 
     if (empty(edepHandle)) {
-      std::cout << "IonAndScint Module Cannot Retrive SimEnergyDeposit" << std::endl;
+      mf::LogWarning("IonAndScint") << "IonAndScint Module Cannot Retrive SimEnergyDeposit";
       return;
     }
 
@@ -141,80 +240,91 @@ namespace larg4 {
     auto const detProp =
       art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(event);
 
-    auto simedep = std::make_unique<std::vector<sim::SimEnergyDeposit>>();
-    auto simedep1 = std::make_unique<std::vector<sim::SimEnergyDeposit>>(); // for prior-SCE depos
-    for (auto edeps : edepHandle) {
+    // select the input collections first, to size the output in one go
+    std::vector<std::vector<sim::SimEnergyDeposit> const*> inputs;
+    std::size_t nDeposits = 0;
+    for (auto const& edeps : edepHandle) {
       // Do some checking before we proceed
       if (!edeps.isValid()) {
-        std::cout << "!edeps.isValid()" << std::endl;
+        MF_LOG_DEBUG("IonAndScint") << "!edeps.isValid()";
         continue;
       }
 
       auto index = std::find(
         instanceNames.begin(), instanceNames.end(), edeps.provenance()->productInstanceName());
       if (index == instanceNames.end()) {
-        std::cout << "Skip SimEnergyDeposit in: " << edeps.provenance()->productInstanceName()
-                  << std::endl;
+        MF_LOG_DEBUG("IonAndScint")
+          << "Skip SimEnergyDeposit in: " << edeps.provenance()->productInstanceName();
         continue;
       }
 
-      std::cout << "SimEnergyDeposit input module: " << edeps.provenance()->moduleLabel()
-                << ", instance name: " << edeps.provenance()->productInstanceName() << std::endl;
-
-      for (sim::SimEnergyDeposit const& edepi : *edeps) {
-        auto const isCalcData = fISAlg->CalcIonAndScint(detProp, edepi);
-
-        int ph_num = round(isCalcData.numPhotons);
-        int ion_num = round(isCalcData.numElectrons);
-        float scintyield = isCalcData.scintillationYieldRatio;
-        float edep_tmp = edepi.Energy();
-        geo::Point_t startPos_tmp = edepi.Start();
-        geo::Point_t endPos_tmp = edepi.End();
-        double startTime_tmp = edepi.StartT();
-        double endTime_tmp = edepi.EndT();
-        int trackID_tmp = edepi.TrackID();
-        int pdgCode_tmp = edepi.PdgCode();
-
-        if (sce->EnableSimSpatialSCE()) {
-          auto posOffsetsStart =
-            sce->GetPosOffsets({edepi.StartX(), edepi.StartY(), edepi.StartZ()});
-          auto posOffsetsEnd = sce->GetPosOffsets({edepi.EndX(), edepi.EndY(), edepi.EndZ()});
-          startPos_tmp =
-            geo::Point_t{(float)(edepi.StartX() - posOffsetsStart.X()), //x should be subtracted
-                         (float)(edepi.StartY() + posOffsetsStart.Y()),
-                         (float)(edepi.StartZ() + posOffsetsStart.Z())};
-          endPos_tmp =
-            geo::Point_t{(float)(edepi.EndX() - posOffsetsEnd.X()), //x should be subtracted
-                         (float)(edepi.EndY() + posOffsetsEnd.Y()),
-                         (float)(edepi.EndZ() + posOffsetsEnd.Z())};
-        }
+      MF_LOG_DEBUG("IonAndScint") << "SimEnergyDeposit input module: "
+                                  << edeps.provenance()->moduleLabel()
+                                  << ", instance name: " << edeps.provenance()->productInstanceName();
+      inputs.push_back(edeps.product());
+      nDeposits += edeps->size();
+    }
 
-        simedep->emplace_back(ph_num,
-                              ion_num,
-                              scintyield,
-                              edep_tmp,
-                              startPos_tmp,
-                              endPos_tmp,
-                              startTime_tmp,
-                              endTime_tmp,
-                              trackID_tmp,
-                              pdgCode_tmp);
-
-        if (fSavePriorSCE) {
-            simedep1->emplace_back(ph_num,
-                                  ion_num,
-                                  scintyield,
-                                  edepi.Energy(),
-                                  edepi.Start(),
-                                  edepi.End(),
-                                  edepi.StartT(),
-                                  edepi.EndT(),
-                                  edepi.TrackID(),
-                                  edepi.PdgCode());
-        }
+    bool const shiftSCE = sce->EnableSimSpatialSCE();
+
+    auto simedep = std::make_unique<std::vector<sim::SimEnergyDeposit>>();
+    auto simedep1 = std::make_unique<std::vector<sim::SimEnergyDeposit>>(); // for prior-SCE depos
+    simedep->reserve(nDeposits);
+    if (fSavePriorSCE && shiftSCE) simedep1->reserve(nDeposits);
 
+    if (!fParallelDeposits) {
+      std::vector<ISCalcData> isCalcResults;
+      for (std::vector<sim::SimEnergyDeposit> const* edeps : inputs) {
+
+        fISAlg->CalcIonAndScint(detProp, *edeps, isCalcResults);
+
+        for (std::size_t iedep = 0; iedep < edeps->size(); ++iedep) {
+          sim::SimEnergyDeposit const& edepi = (*edeps)[iedep];
+          simedep->push_back(makeDeposit(edepi, isCalcResults[iedep], sce, shiftSCE));
+          if (fSavePriorSCE && shiftSCE)
+            simedep1->push_back(makeDeposit(edepi, isCalcResults[iedep], sce, false));
+        }
       }
     }
+    else {
+      // the output is filled in place, keeping the input order
+      std::vector<sim::SimEnergyDeposit const*> deposits;
+      deposits.reserve(nDeposits);
+      for (std::vector<sim::SimEnergyDeposit> const* edeps : inputs)
+        for (sim::SimEnergyDeposit const& edepi : *edeps)
+          deposits.push_back(&edepi);
+      simedep->resize(nDeposits);
+      if (fSavePriorSCE && shiftSCE) simedep1->resize(nDeposits);
+
+      constexpr std::uint32_t StreamKey = larsim::Utils::randomStreamKey("IonAndScint");
+      std::uint32_t const eventSeed = static_cast<unsigned int>(fEngine);
+      std::size_t const nBlocks = (nDeposits + fParallelBlockSize - 1) / fParallelBlockSize;
+      tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(0, nBlocks, 1),
+        [&](tbb::blocked_range<std::size_t> const& blocks) {
+          ThreadCalc& calc = fThreadCalc.local();
+          if (!calc.alg) calc.alg = makeISCalc(calc.engine);
+          for (std::size_t iBlock = blocks.begin(); iBlock != blocks.end(); ++iBlock) {
+            calc.engine.setStream(eventSeed, StreamKey, iBlock);
+            std::size_t const end = std::min((iBlock + 1) * fParallelBlockSize, nDeposits);
+            for (std::size_t iDep = iBlock * fParallelBlockSize; iDep < end; ++iDep) {
+              sim::SimEnergyDeposit const& edepi = *(deposits[iDep]);
+              auto const isCalcData = calc.alg->CalcIonAndScint(detProp, edepi);
+              (*simedep)[iDep] = makeDeposit(edepi, isCalcData, sce, shiftSCE);
+              if (fSavePriorSCE && shiftSCE)
+                (*simedep1)[iDep] = makeDeposit(edepi, isCalcData, sce, false);
+            }
+          }
+        });
+    }
+
+    // without spatial distortions, the deposits before and after SCE are the same
+    if (fSavePriorSCE && !shiftSCE) *simedep1 = *simedep;
+
+    if (fStoreCompactEdeps) {
+      event.put(std::make_unique<sim::CompactSimEnergyDeposits>(
+        sim::makeCompactSimEnergyDeposits(*simedep, fCompactEdepTimeResolution)));
+    }
     event.put(std::move(simedep));
     if (fSavePriorSCE) event.put(std::move(simedep1), "priorSCE");
   }
@@ -0,0 +1,194 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       MergeEnergyDeposits
+// Plugin Type: producer
+// File:        MergeEnergyDeposits_module.cc
+// Description:
+// - merges adjacent sim::SimEnergyDeposit of the same track into one
+// Input: 'sim::SimEnergyDeposit'
+// Output: 'sim::SimEnergyDeposit', the merged deposits
+//
+//Geant4 steps are often much smaller than the resolution of the detector.
+//This module coarsens the deposits so that the ionization and light
+//simulation (IonAndScint, SimDriftElectrons, PDFastSimPAR, PDFastSimPVS)
+//have fewer deposits to process.
+//
+//Consecutive deposits in the input collection are merged when they belong
+//to the same track (and particle), the next one starts within
+//"MaxStepGap" cm and "MaxTimeGap" ns of the end of the previous one, and
+//the merged deposit would stay within "MaxLength" cm from its start and
+//"MaxDuration" ns. The merged deposit goes from the start of the first
+//deposit to the end of the last one; energy, electrons and photons are
+//summed, and the scintillation yield ratio is the one of the sum of the
+//photons, so that fast and slow photons are conserved too.
+//
+//The numbers of electrons and photons are conserved exactly when the module
+//runs after IonAndScint. When it runs before, IonAndScint computes them
+//from the merged deposit, whose dE/dx is the one of the original deposits
+//as long as they are aligned: "MaxLength" should be small compared with the
+//curvature of the tracks, as well as with the wire pitch.
+//
+////////////////////////////////////////////////////////////////////////
+
+// LArSoft includes
+#include "lardataobj/Simulation/SimEnergyDeposit.h"
+
+// Framework includes
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "canvas/Utilities/Exception.h"
+#include "canvas/Utilities/InputTag.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include <cmath> // std::abs()
+#include <memory>
+#include <vector>
+
+namespace larg4 {
+  class MergeEnergyDeposits : public art::EDProducer {
+  public:
+    explicit MergeEnergyDeposits(fhicl::ParameterSet const& pset);
+    void produce(art::Event& event) override;
+    void endJob() override;
+
+  private:
+    // deposits being merged into one
+    struct MergedDeposit {
+      sim::SimEnergyDeposit const* first = nullptr;
+      sim::SimEnergyDeposit const* last = nullptr;
+      double energy = 0.0;
+      long long numElectrons = 0;
+      long long numPhotons = 0;
+      double numFastPhotons = 0.0;
+
+      void start(sim::SimEnergyDeposit const& edep);
+      void add(sim::SimEnergyDeposit const& edep);
+      sim::SimEnergyDeposit make() const;
+    };
+
+    // whether edep can be merged into merged
+    bool canMerge(MergedDeposit const& merged, sim::SimEnergyDeposit const& edep) const;
+
+    art::InputTag fEDepTag;
+    double fMaxStepGap;  // cm
+    double fMaxTimeGap;  // ns
+    double fMaxLength;   // cm
+    double fMaxDuration; // ns
+
+    unsigned long long fNInput{0};
+    unsigned long long fNOutput{0};
+  };
+
+  //......................................................................
+  MergeEnergyDeposits::MergeEnergyDeposits(fhicl::ParameterSet const& pset)
+    : art::EDProducer{pset}
+    , fEDepTag{pset.get<art::InputTag>("EDepTag")}
+    , fMaxStepGap{pset.get<double>("MaxStepGap", 0.01)}
+    , fMaxTimeGap{pset.get<double>("MaxTimeGap", 0.1)}
+    , fMaxLength{pset.get<double>("MaxLength", 0.1)}
+    , fMaxDuration{pset.get<double>("MaxDuration", 1.0)}
+  {
+    if ((fMaxStepGap < 0.0) || (fMaxTimeGap < 0.0) || (fMaxLength < 0.0) ||
+        (fMaxDuration < 0.0)) {
+      throw art::Exception(art::errors::Configuration)
+        << "MergeEnergyDeposits: tolerances can't be negative.\n";
+    }
+    consumes<std::vector<sim::SimEnergyDeposit>>(fEDepTag);
+    produces<std::vector<sim::SimEnergyDeposit>>();
+  }
+
+  //......................................................................
+  void
+  MergeEnergyDeposits::MergedDeposit::start(sim::SimEnergyDeposit const& edep)
+  {
+    *this = MergedDeposit{};
+    first = &edep;
+    add(edep);
+  }
+
+  //......................................................................
+  void
+  MergeEnergyDeposits::MergedDeposit::add(sim::SimEnergyDeposit const& edep)
+  {
+    last = &edep;
+    energy += edep.Energy();
+    numElectrons += edep.NumElectrons();
+    numPhotons += edep.NumPhotons();
+    numFastPhotons += edep.ScintYieldRatio() * edep.NumPhotons();
+  }
+
+  //......................................................................
+  sim::SimEnergyDeposit
+  MergeEnergyDeposits::MergedDeposit::make() const
+  {
+    if (first == last) return *first;
+    float const scintYield =
+      (numPhotons > 0) ? (numFastPhotons / numPhotons) : first->ScintYieldRatio();
+    return {static_cast<int>(numPhotons),
+            static_cast<int>(numElectrons),
+            scintYield,
+            static_cast<float>(energy),
+            first->Start(),
+            last->End(),
+            first->StartT(),
+            last->EndT(),
+            first->TrackID(),
+            first->PdgCode()};
+  }
+
+  //......................................................................
+  bool
+  MergeEnergyDeposits::canMerge(MergedDeposit const& merged,
+                                sim::SimEnergyDeposit const& edep) const
+  {
+    sim::SimEnergyDeposit const& first = *merged.first;
+    sim::SimEnergyDeposit const& last = *merged.last;
+    if ((edep.TrackID() != first.TrackID()) || (edep.PdgCode() != first.PdgCode())) return false;
+    if (std::abs(edep.StartT() - last.EndT()) > fMaxTimeGap) return false;
+    if (edep.EndT() - first.StartT() > fMaxDuration) return false;
+    if ((edep.Start() - last.End()).Mag2() > fMaxStepGap * fMaxStepGap) return false;
+    if ((edep.End() - first.Start()).Mag2() > fMaxLength * fMaxLength) return false;
+    return true;
+  }
+
+  //......................................................................
+  void
+  MergeEnergyDeposits::produce(art::Event& event)
+  {
+    auto const& edeps = *event.getValidHandle<std::vector<sim::SimEnergyDeposit>>(fEDepTag);
+
+    auto merged = std::make_unique<std::vector<sim::SimEnergyDeposit>>();
+    merged->reserve(edeps.size());
+
+    MergedDeposit current;
+    for (sim::SimEnergyDeposit const& edep : edeps) {
+      if (current.first && canMerge(current, edep)) {
+        current.add(edep);
+        continue;
+      }
+      if (current.first) merged->push_back(current.make());
+      current.start(edep);
+    }
+    if (current.first) merged->push_back(current.make());
+
+    MF_LOG_DEBUG("MergeEnergyDeposits")
+      << "Merged " << edeps.size() << " deposits into " << merged->size();
+    fNInput += edeps.size();
+    fNOutput += merged->size();
+
+    event.put(std::move(merged));
+  }
+
+  //......................................................................
+  void
+  MergeEnergyDeposits::endJob()
+  {
+    mf::LogInfo log("MergeEnergyDeposits");
+    log << "Merged " << fNInput << " energy deposits into " << fNOutput;
+    if (fNOutput > 0) log << " (" << (double(fNInput) / fNOutput) << " per merged deposit)";
+  }
+
+} // namespace larg4
+
+DEFINE_ART_MODULE(larg4::MergeEnergyDeposits)
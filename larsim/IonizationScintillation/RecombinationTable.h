@@ -0,0 +1,156 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       RecombinationTable
+// Plugin Type: algorithm
+// File:        RecombinationTable.h
+// Description: Recombination survival fraction tabulated as a function of
+//              dE/dx and electric field, for use by the ISCalc algorithms
+//              in place of the analytic models.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef IS_RECOMBINATIONTABLE_H
+#define IS_RECOMBINATIONTABLE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace larg4 {
+
+  /**
+   * @brief Recombination survival fraction on a regular (dE/dx, field) grid.
+   *
+   * The table is sampled from a model `recomb(dEdx, field)` at construction,
+   * and evaluated by bilinear interpolation. It covers dE/dx in
+   * [ `dEdxMin`, `dEdxMax` ] (MeV/cm) and field in [ `fieldMin`, `fieldMax` ]
+   * (kV/cm): the caller is expected to use the model directly outside that
+   * range (see `contains()`).
+   *
+   * Error bound: for a model with continuous second derivatives, the bilinear
+   * interpolation error in a cell is at most
+   * `(h_dEdx^2 |d2f/ddEdx2| + h_field^2 |d2f/dfield2|) / 8`, and it is largest
+   * around the cell centre. At construction the model is also evaluated at the
+   * centre of each cell, and the largest absolute difference from the table is
+   * kept as `maxError()`. For the Birks and modified box models with the
+   * default steps it is a few 1e-5.
+   *
+   * Nodes are placed exactly on `fieldMin + i * (fieldMax - fieldMin) / nFieldBins`:
+   * when the field is one of the nodes (e.g. the nominal field without space
+   * charge distortions) only the dE/dx interpolation contributes to the error.
+   */
+  class RecombinationTable {
+  public:
+    RecombinationTable() = default;
+
+    template <typename Func>
+    RecombinationTable(Func&& recomb,
+                       double dEdxMin,
+                       double dEdxMax,
+                       double dEdxStep,
+                       double fieldMin,
+                       double fieldMax,
+                       std::size_t nFieldBins);
+
+    bool
+    empty() const
+    {
+      return fValues.empty();
+    }
+
+    /// Returns whether the point is covered by the table.
+    bool
+    contains(double dEdx, double field) const
+    {
+      return !empty() && (dEdx >= fdEdxMin) && (dEdx <= fdEdxMax) && (field >= fFieldMin) &&
+             (field <= fFieldMax);
+    }
+
+    /// Interpolated recombination factor; the point must be `contains()`'ed.
+    double operator()(double dEdx, double field) const;
+
+    /// Largest difference from the model found at the cell centres.
+    double
+    maxError() const
+    {
+      return fMaxError;
+    }
+
+  private:
+    double fdEdxMin = 0.;
+    double fdEdxMax = 0.;
+    double fdEdxStep = 1.;
+    double fFieldMin = 0.;
+    double fFieldMax = 0.;
+    double fFieldStep = 1.;
+    std::size_t fNdEdx = 0;  // nodes on the dE/dx axis
+    std::size_t fNField = 0; // nodes on the field axis
+    std::vector<float> fValues; // dE/dx index runs fastest
+    double fMaxError = 0.;
+
+    double
+    node(std::size_t idEdx, std::size_t iField) const
+    {
+      return fValues[iField * fNdEdx + idEdx];
+    }
+
+    static void
+    locate(double u, std::size_t nNodes, std::size_t& i, double& frac)
+    {
+      i = std::min(static_cast<std::size_t>(u), nNodes - 2);
+      frac = u - double(i);
+    }
+  };
+
+  //----------------------------------------------------------------------------
+  template <typename Func>
+  RecombinationTable::RecombinationTable(Func&& recomb,
+                                         double dEdxMin,
+                                         double dEdxMax,
+                                         double dEdxStep,
+                                         double fieldMin,
+                                         double fieldMax,
+                                         std::size_t nFieldBins)
+    : fdEdxMin(dEdxMin)
+    , fdEdxMax(dEdxMax)
+    , fFieldMin(fieldMin)
+    , fFieldMax(fieldMax)
+    , fNField(std::max(nFieldBins, std::size_t(1)) + 1)
+  {
+    fNdEdx = static_cast<std::size_t>(std::ceil((dEdxMax - dEdxMin) / dEdxStep)) + 1;
+    if (fNdEdx < 2) fNdEdx = 2;
+    fdEdxStep = (dEdxMax - dEdxMin) / (fNdEdx - 1);
+    fFieldStep = (fieldMax - fieldMin) / (fNField - 1);
+
+    fValues.resize(fNdEdx * fNField);
+    for (std::size_t iField = 0; iField < fNField; ++iField) {
+      double const field = fFieldMin + iField * fFieldStep;
+      for (std::size_t idEdx = 0; idEdx < fNdEdx; ++idEdx)
+        fValues[iField * fNdEdx + idEdx] = recomb(fdEdxMin + idEdx * fdEdxStep, field);
+    }
+
+    for (std::size_t iField = 0; iField + 1 < fNField; ++iField) {
+      double const field = fFieldMin + (iField + 0.5) * fFieldStep;
+      for (std::size_t idEdx = 0; idEdx + 1 < fNdEdx; ++idEdx) {
+        double const dEdx = fdEdxMin + (idEdx + 0.5) * fdEdxStep;
+        fMaxError = std::max(fMaxError, std::abs((*this)(dEdx, field) - recomb(dEdx, field)));
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  inline double
+  RecombinationTable::operator()(double dEdx, double field) const
+  {
+    std::size_t idEdx, iField;
+    double fdEdx, fField;
+    locate((dEdx - fdEdxMin) / fdEdxStep, fNdEdx, idEdx, fdEdx);
+    locate((field - fFieldMin) / fFieldStep, fNField, iField, fField);
+    double const low = node(idEdx, iField) + fdEdx * (node(idEdx + 1, iField) - node(idEdx, iField));
+    if (fField == 0.) return low;
+    double const high =
+      node(idEdx, iField + 1) + fdEdx * (node(idEdx + 1, iField + 1) - node(idEdx, iField + 1));
+    return low + fField * (high - low);
+  }
+
+}
+#endif // IS_RECOMBINATIONTABLE_H
@@ -8,6 +8,7 @@
 
 #include "larsim/LegacyLArG4/CustomPhysicsBuiltIns.hh"
 #include "larsim/LegacyLArG4/CustomPhysicsLArSoft.h"
+#include "larsim/LegacyLArG4/EMShowerFastModel.h"
 #include "larsim/LegacyLArG4/FastOpticalPhysics.h"
 #include "larsim/LegacyLArG4/NeutronHPphysics.hh"
 namespace detinfo {
@@ -36,9 +37,11 @@ namespace larg4 {
     Factory_t<G4HadronPhysicsQGSP_BERT_HP> fHadronHPPhysics{"HadronHP"};
     Factory_t<G4IonPhysics> fIonPhysics{"Ion"};
     Factory_t<G4NeutronTrackingCut> fNeutronTrackingCut{"NeutronTrackingCut"};
+    Factory_t<G4StepLimiterPhysics> fStepLimiterPhysics{"StepLimiter"};
     Factory_t<G4StoppingPhysics> fStoppingPhysics{"Stopping"};
 
     // LArSoft lists
+    Factory_t<EMShowerFastSimPhysics> fEMShowerFastSimPhysics{"EMShowerFastSim"};
     Factory_t<FastOpticalPhysics> fFastOpticalPhysics{"FastOptical"};
     Factory_t<NeutronHPphysics> fNeutronHPPhysics{"NeutronHP"};
     Factory_t<OpticalPhysics> fOpticalPhysics;
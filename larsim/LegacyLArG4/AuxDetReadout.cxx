@@ -12,7 +12,6 @@
 #include "Geant4/G4ThreeVector.hh"
 
 #include <utility> // std::move()
-#include <algorithm> // std::find()
 
 namespace larg4 {
 
@@ -37,11 +36,13 @@ namespace larg4 {
   void AuxDetReadout::EndOfEvent(G4HCofThisEvent*)
   {
     fAuxDetSimChannel = sim::AuxDetSimChannel(fAuxDet, std::move(fAuxDetIDEs), fAuxDetSensitive);
+    fTrackIDEIndex.clear();
   }
   //---------------------------------------------------------------------------------------
   void AuxDetReadout::clear()
   {
     fAuxDetIDEs.clear();
+    fTrackIDEIndex.clear();
   }
 
   //---------------------------------------------------------------------------------------
@@ -53,6 +54,13 @@ namespace larg4 {
 
     const int trackID = ParticleListAction::GetCurrentTrackID();
 
+    // the logical volume may be shared by the volumes of other readouts
+    AuxDetReadout* readout = this;
+    if(fVolumeReadouts){
+      auto const iReadout = fVolumeReadouts->find(step->GetPreStepPoint()->GetPhysicalVolume());
+      if(iReadout != fVolumeReadouts->end()) readout = iReadout->second;
+    }
+
     G4double energyDeposited = step->GetTotalEnergyDeposit()/CLHEP::GeV;
 
     G4ThreeVector startG4(step->GetPreStepPoint()->GetPosition() );
@@ -74,20 +82,20 @@ namespace larg4 {
 
     double stopTime = step->GetPostStepPoint()->GetGlobalTime()/CLHEP::ns;
 
-    this->AddParticleStep( trackID,
-                           energyDeposited,
-                           startWorld[0],
-                           startWorld[1],
-                           startWorld[2],
-                           startTime,
-                           stopWorld[0],
-                           stopWorld[1],
-                           stopWorld[2],
-                           stopTime,
-                           stopWorldMomVector[0],
-                           stopWorldMomVector[1],
-                           stopWorldMomVector[2]
-                           );
+    readout->AddParticleStep( trackID,
+                              energyDeposited,
+                              startWorld[0],
+                              startWorld[1],
+                              startWorld[2],
+                              startTime,
+                              stopWorld[0],
+                              stopWorld[1],
+                              stopWorld[2],
+                              stopTime,
+                              stopWorldMomVector[0],
+                              stopWorldMomVector[1],
+                              stopWorldMomVector[2]
+                              );
 
     return true;
   }
@@ -108,6 +116,24 @@ namespace larg4 {
 			float	inputExitMomentumY,
 			float	inputExitMomentumZ){
 
+    // look for the IDE of this track by index: a search in the list, for
+    // each step, grows with the number of tracks crossing the volume
+    auto const iIndex = fTrackIDEIndex.find(inputTrackID);
+    if(iIndex != fTrackIDEIndex.end()){ //If trackID is already in the map, update it
+
+      sim::AuxDetIDE& IDE = fAuxDetIDEs[iIndex->second];
+      IDE.energyDeposited += inputEnergyDeposited;
+      IDE.exitX            = inputExitX;
+      IDE.exitY            = inputExitY;
+      IDE.exitZ            = inputExitZ;
+      IDE.exitT            = inputExitT;
+      IDE.exitMomentumX    = inputExitMomentumX;
+      IDE.exitMomentumY    = inputExitMomentumY;
+      IDE.exitMomentumZ    = inputExitMomentumZ;
+      return;
+    }
+
+    //if trackID is not in the set yet, add it
     sim::AuxDetIDE auxDetIDE;
     auxDetIDE.trackID		= inputTrackID;
     auxDetIDE.energyDeposited	= inputEnergyDeposited;
@@ -123,23 +149,8 @@ namespace larg4 {
     auxDetIDE.exitMomentumY	= inputExitMomentumY;
     auxDetIDE.exitMomentumZ	= inputExitMomentumZ;
 
-    std::vector<sim::AuxDetIDE>::iterator IDEitr
-      = std::find(fAuxDetIDEs.begin(), fAuxDetIDEs.end(), auxDetIDE);
-
-    if(IDEitr != fAuxDetIDEs.end()){ //If trackID is already in the map, update it
-
-      IDEitr->energyDeposited += inputEnergyDeposited;
-      IDEitr->exitX            = inputExitX;
-      IDEitr->exitY            = inputExitY;
-      IDEitr->exitZ            = inputExitZ;
-      IDEitr->exitT            = inputExitT;
-      IDEitr->exitMomentumX    = inputExitMomentumX;
-      IDEitr->exitMomentumY    = inputExitMomentumY;
-      IDEitr->exitMomentumZ    = inputExitMomentumZ;
-    }
-    else{  //if trackID is not in the set yet, add it
-      fAuxDetIDEs.push_back(std::move(auxDetIDE));
-    }//else
+    fTrackIDEIndex.emplace(inputTrackID, fAuxDetIDEs.size());
+    fAuxDetIDEs.push_back(std::move(auxDetIDE));
   }//AddParticleStep
 
   //---------------------------------------------------------------------------------------
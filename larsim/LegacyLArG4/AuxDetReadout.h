@@ -14,7 +14,9 @@
 
 #include "larcore/Geometry/Geometry.h"
 #include "lardataobj/Simulation/AuxDetSimChannel.h"
+#include "larsim/LegacyLArG4/AuxDetReadoutGeometry.h"
 
+#include <unordered_map>
 #include <vector>
 
 // Forward declarations
@@ -72,12 +74,19 @@ namespace larg4 {
     // Independent method; returns the accumulated information
     sim::AuxDetSimChannel const GetAuxDetSimChannel() const { return fAuxDetSimChannel; };
 
+    // When the logical volume of this readout is placed more than once,
+    // each step is assigned to the readout of its physical volume.
+    void SetVolumeReadouts(AuxDetReadoutGeometry::VolumeReadouts_t const* volumeReadouts)
+    { fVolumeReadouts = volumeReadouts; }
+
   private:
     art::ServiceHandle<geo::Geometry const> fGeoHandle;        ///< Handle to the Geometry service
     uint32_t                          fAuxDet;           ///< which AuxDet this AuxDetReadout corresponds to
     uint32_t                          fAuxDetSensitive;  ///< which sensitive volume of the AuxDet this AuxDetReadout corresponds to
     sim::AuxDetSimChannel             fAuxDetSimChannel; ///< Contains the sim::AuxDetSimChannel for this AuxDet
     std::vector<sim::AuxDetIDE>       fAuxDetIDEs;       ///< list of IDEs in one channel
+    std::unordered_map<int, size_t>   fTrackIDEIndex;    ///< position in fAuxDetIDEs of the IDE of each track
+    AuxDetReadoutGeometry::VolumeReadouts_t const* fVolumeReadouts = nullptr; ///< readouts sharing the logical volume
 };
 }
 
@@ -75,17 +75,7 @@ namespace larg4 {
       size_t adNum = 0;
       size_t svNum = 0;
       fGeo->FindAuxDetSensitiveAtPosition(worldPos, adNum, svNum);
-      //  N.B. This name is expected by code in LArG4:
-      std::string SDName = "AuxDetSD_AuxDet" + std::to_string(adNum) + "_" + std::to_string(svNum);
-      AuxDetReadout* adReadout = new larg4::AuxDetReadout(SDName, adNum, svNum);
-
-      MF_LOG_DEBUG("AuxDetReadoutGeometry") << "found" << path[depth]->GetName()
-					 << ", number " << adNum << ":" << svNum;
-
-      // Tell Geant4's sensitive-detector manager about the AuxDetReadout class
-      (G4SDManager::GetSDMpointer())->AddNewDetector(adReadout);
-      LogicalVolumeAtDepth->SetSensitiveDetector(adReadout);
-      ++fNumSensitiveVol;
+      this->MakeReadout(path, depth, adNum, svNum);
       return;
     }
 
@@ -130,17 +120,7 @@ namespace larg4 {
 
       unsigned int adNum;
       fGeo->PositionToAuxDet(worldPos, adNum);
-      //  N.B. This name is expected by code in LArG4:
-      std::string SDName = "AuxDetSD_AuxDet" + std::to_string(adNum) + "_0";
-      AuxDetReadout* adReadout = new larg4::AuxDetReadout(SDName, adNum, 0);
-
-      MF_LOG_DEBUG("AuxDetReadoutGeometry") << "found" << path[depth]->GetName()
-					 << ", number " << adNum << ":0";
-
-      // Tell Geant4's sensitive-detector manager about the AuxDetReadout class
-      (G4SDManager::GetSDMpointer())->AddNewDetector(adReadout);
-      LogicalVolumeAtDepth->SetSensitiveDetector(adReadout);
-      ++fNumSensitiveVol;
+      this->MakeReadout(path, depth, adNum, 0);
       return;
     }
 
@@ -167,5 +147,46 @@ namespace larg4 {
 
   }
 
+  //---------------------------------------------------------------
+  void AuxDetReadoutGeometry::MakeReadout(std::vector<const G4VPhysicalVolume*> const& path,
+					  unsigned int depth,
+					  unsigned int adNum,
+					  unsigned int svNum)
+  {
+    G4VPhysicalVolume const* volume = path[depth];
+    G4LogicalVolume* LogicalVolumeAtDepth = volume->GetLogicalVolume();
+
+    //  N.B. This name is expected by code in LArG4:
+    std::string SDName = "AuxDetSD_AuxDet" + std::to_string(adNum) + "_" + std::to_string(svNum);
+    AuxDetReadout* adReadout = new larg4::AuxDetReadout(SDName, adNum, svNum);
+
+    MF_LOG_DEBUG("AuxDetReadoutGeometry") << "found" << volume->GetName()
+				       << ", number " << adNum << ":" << svNum;
+
+    if(fReadouts.size() <= adNum) fReadouts.resize(adNum + 1);
+    if(fReadouts[adNum].size() <= svNum) fReadouts[adNum].resize(svNum + 1, nullptr);
+    fReadouts[adNum][svNum] = adReadout;
+    // (a physical volume inside a volume placed more than once is reached
+    // through several paths: its steps go to the last of its readouts)
+    fVolumeReadouts[volume] = adReadout;
+
+    // Tell Geant4's sensitive-detector manager about the AuxDetReadout class
+    (G4SDManager::GetSDMpointer())->AddNewDetector(adReadout);
+
+    // a logical volume has only one sensitive detector: if it is placed
+    // as more than one AuxDet volume, the first readout attached to it
+    // hands each step to the readout of the physical volume of the step
+    auto* attached = dynamic_cast<AuxDetReadout*>(LogicalVolumeAtDepth->GetSensitiveDetector());
+    if(attached) attached->SetVolumeReadouts(&fVolumeReadouts);
+    else         LogicalVolumeAtDepth->SetSensitiveDetector(adReadout);
+    ++fNumSensitiveVol;
+  }
+
+  //---------------------------------------------------------------
+  AuxDetReadout* AuxDetReadoutGeometry::Readout(unsigned int adNum, unsigned int svNum) const
+  {
+    if(adNum >= fReadouts.size() || svNum >= fReadouts[adNum].size()) return nullptr;
+    return fReadouts[adNum][svNum];
+  }
 
 } // namespace larg4
@@ -21,6 +21,11 @@
 ///   readouts.  Geant4 allows the construction of multiple parallel
 ///   readouts, so this mechanism is relatively easy to extend for
 ///   each type of readout.
+///
+/// The readouts are recorded by AuxDet and sensitive volume number, and
+/// by the physical volume they are attached to, so that neither the
+/// Geant4 steps nor the collection of the channels at the end of the
+/// event have to find a sensitive detector by its name.
 
 #ifndef LArG4_AuxDetReadoutGeometry_h
 #define LArG4_AuxDetReadoutGeometry_h
@@ -32,10 +37,15 @@
 #include "Geant4/G4String.hh"
 #include "Geant4/G4Transform3D.hh"
 
+#include <unordered_map>
+#include <vector>
+
 class G4VPhysicalVolume;
 
 namespace larg4 {
 
+  class AuxDetReadout;
+
   class AuxDetReadoutGeometry : public G4VUserParallelWorld
   {
   public:
@@ -48,8 +58,21 @@ namespace larg4 {
     /// Required of  any class that inherits from G4VUserParallelWorld
     virtual void Construct();
 
+    /// Returns the readout of the sensitive volume `svNum` of the AuxDet
+    /// `adNum`, `nullptr` if there is none.
+    AuxDetReadout* Readout(unsigned int adNum, unsigned int svNum) const;
+
+    /// Table of the readout of each sensitive physical volume.
+    using VolumeReadouts_t = std::unordered_map<G4VPhysicalVolume const*, AuxDetReadout*>;
+
   private:
 
+    /// Creates the readout of the volume at the end of `path` and attaches it.
+    void MakeReadout(std::vector<const G4VPhysicalVolume*> const& path,
+                     unsigned int depth,
+                     unsigned int adNum,
+                     unsigned int svNum);
+
     void FindAndMakeAuxDet(std::vector<const G4VPhysicalVolume*>& path,
 			   unsigned int depth,
 			   G4Transform3D DepthToWorld);
@@ -60,6 +83,8 @@ namespace larg4 {
 
     art::ServiceHandle<geo::Geometry const> fGeo;             ///< Handle to the geometry
     uint32_t                          fNumSensitiveVol; ///< number of sensitive volumes
+    std::vector<std::vector<AuxDetReadout*>> fReadouts;  ///< readouts by AuxDet and sensitive volume
+    VolumeReadouts_t                  fVolumeReadouts;  ///< readout of each sensitive physical volume
 
   };
 
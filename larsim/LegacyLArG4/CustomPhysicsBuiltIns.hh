@@ -23,9 +23,13 @@
 #include "Geant4/G4HadronPhysicsQGSP_BERT_HP.hh"
 #include "Geant4/G4IonPhysics.hh"
 #include "Geant4/G4NeutronTrackingCut.hh"
+#include "Geant4/G4StepLimiterPhysics.hh"
 #include "Geant4/G4StoppingPhysics.hh"
 
 #include "larsim/LegacyLArG4/CustomPhysicsFactory.hh"
+#include "larsim/Simulation/LArG4Parameters.h"
+
+#include "CLHEP/Units/SystemOfUnits.h"
 
 namespace larg4 {
   template <>
@@ -115,7 +119,12 @@ namespace larg4 {
   G4VPhysicsConstructor*
   CustomPhysicsFactory<G4NeutronTrackingCut>::Build() const
   {
-    return new G4NeutronTrackingCut("Neutron tracking cut", 0);
+    auto* cut = new G4NeutronTrackingCut("Neutron tracking cut", 0);
+    // neutrons bouncing beyond the readout window only cost steps
+    art::ServiceHandle<sim::LArG4Parameters const> lgp;
+    if (lgp->NeutronTrackingTimeLimit() > 0.)
+      cut->SetTimeLimit(lgp->NeutronTrackingTimeLimit() * CLHEP::ns);
+    return cut;
   }
 }
 
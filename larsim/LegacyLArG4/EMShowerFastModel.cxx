@@ -0,0 +1,187 @@
+/**
+ * @file   larsim/LegacyLArG4/EMShowerFastModel.cxx
+ * @brief  Parameterised simulation of low energy electromagnetic showers.
+ * @see    larsim/LegacyLArG4/EMShowerFastModel.h
+ */
+
+#include "larsim/LegacyLArG4/EMShowerFastModel.h"
+#include "larsim/LegacyLArG4/LArVoxelReadout.h"
+
+#include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h"
+
+#include "cetlib_except/exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "Geant4/G4Electron.hh"
+#include "Geant4/G4FastSimulationManagerProcess.hh"
+#include "Geant4/G4FastStep.hh"
+#include "Geant4/G4FastTrack.hh"
+#include "Geant4/G4Gamma.hh"
+#include "Geant4/G4ParticleDefinition.hh"
+#include "Geant4/G4Positron.hh"
+#include "Geant4/G4ProcessManager.hh"
+#include "Geant4/G4SDManager.hh"
+#include "Geant4/G4ThreeVector.hh"
+#include "Geant4/G4Track.hh"
+
+#include "CLHEP/Random/RandFlat.h"
+#include "CLHEP/Random/RandGamma.h"
+#include "CLHEP/Units/PhysicalConstants.h"
+#include "CLHEP/Units/SystemOfUnits.h"
+
+// C/C++ standard libraries
+#include <algorithm> // std::max()
+#include <cmath>
+
+namespace {
+
+  /// Slope `b` of the longitudinal profile (PDG review, for liquid argon).
+  constexpr double LongitudinalSlope = 0.5;
+
+  /// Spots are not placed farther than this many Molière radii from the axis.
+  constexpr double MaxRadiusInMoliere = 3.5;
+
+} // local namespace
+
+namespace larg4 {
+
+  //----------------------------------------------------------------------------
+  EMShowerFastModel::EMShowerFastModel(G4String const& name,
+                                       G4Region* region,
+                                       Config_t const& config,
+                                       CLHEP::HepRandomEngine& engine)
+    : G4VFastSimulationModel(name, region), fConfig(config), fEngine(engine)
+  {
+    if (!(fConfig.spotEnergy > 0.)) {
+      throw cet::exception("EMShowerFastModel")
+        << "The energy of the shower spots must be positive (it's " << fConfig.spotEnergy
+        << " MeV).\n";
+    }
+    mf::LogInfo("EMShowerFastModel")
+      << "Electromagnetic showers between " << fConfig.minEnergy << " and " << fConfig.maxEnergy
+      << " MeV are parameterised, in spots of about " << fConfig.spotEnergy << " MeV";
+  }
+
+  //----------------------------------------------------------------------------
+  G4bool
+  EMShowerFastModel::IsApplicable(G4ParticleDefinition const& particle)
+  {
+    return &particle == G4Electron::ElectronDefinition() ||
+           &particle == G4Positron::PositronDefinition() || &particle == G4Gamma::GammaDefinition();
+  }
+
+  //----------------------------------------------------------------------------
+  G4bool
+  EMShowerFastModel::ModelTrigger(G4FastTrack const& fastTrack)
+  {
+    double const energy = fastTrack.GetPrimaryTrack()->GetKineticEnergy() / CLHEP::MeV;
+    return energy >= fConfig.minEnergy && energy < fConfig.maxEnergy;
+  }
+
+  //----------------------------------------------------------------------------
+  void
+  EMShowerFastModel::DoIt(G4FastTrack const& fastTrack, G4FastStep& fastStep)
+  {
+    G4Track const& track = *fastTrack.GetPrimaryTrack();
+    G4ParticleDefinition const* particle = track.GetDefinition();
+
+    // a positron is assumed to annihilate within the shower
+    double energy = track.GetKineticEnergy() / CLHEP::MeV;
+    if (particle == G4Positron::PositronDefinition())
+      energy += 2. * CLHEP::electron_mass_c2 / CLHEP::MeV;
+
+    fastStep.KillPrimaryTrack();
+    fastStep.ProposePrimaryTrackPathLength(0.0);
+    fastStep.ProposeTotalEnergyDeposited(energy * CLHEP::MeV);
+
+    LArVoxelReadout& readout = Readout();
+
+    G4ThreeVector const start = track.GetPosition() / CLHEP::cm;
+    G4ThreeVector const& dir = track.GetMomentumDirection();
+    G4ThreeVector const u = dir.orthogonal().unit();
+    G4ThreeVector const v = dir.cross(u);
+    double const startTime = track.GetGlobalTime();
+
+    // longitudinal profile: gamma distribution with its maximum at tmax
+    double const C = (particle == G4Gamma::GammaDefinition()) ? 0.5 : -0.5;
+    double const tmax = std::max(std::log(energy / fConfig.criticalEnergy) + C, 0.0);
+    double const a = 1.0 + LongitudinalSlope * tmax;
+
+    // transverse profile: 90% of the energy within r = 3R = Molière radius
+    double const R2 = std::pow(fConfig.moliereRadius / 3.0, 2);
+    double const maxR2 = std::pow(MaxRadiusInMoliere * fConfig.moliereRadius, 2);
+    double const maxF = maxR2 / (maxR2 + R2); // cumulative at the largest radius
+
+    unsigned int const nSpots =
+      std::max(1U, static_cast<unsigned int>(std::ceil(energy / fConfig.spotEnergy)));
+    double const spotEnergy = energy / nSpots;
+    double const spotElectrons = spotEnergy * fConfig.electronsPerMeV;
+
+    int electronsSoFar = 0;
+    for (unsigned int iSpot = 0; iSpot < nSpots; ++iSpot) {
+      double const depth =
+        CLHEP::RandGamma::shoot(&fEngine, a, LongitudinalSlope) * fConfig.radiationLength;
+      double const F = maxF * CLHEP::RandFlat::shoot(&fEngine);
+      double const r = std::sqrt(R2 * F / (1.0 - F));
+      double const phi = CLHEP::twopi * CLHEP::RandFlat::shoot(&fEngine);
+
+      G4ThreeVector const pos =
+        start + depth * dir + r * (std::cos(phi) * u + std::sin(phi) * v);
+
+      // the electrons are rounded on the running total, so that none is lost
+      int const electrons = static_cast<int>(std::round((iSpot + 1) * spotElectrons));
+      readout.AddEnergyDeposit(geo::Point_t{pos.x(), pos.y(), pos.z()},
+                               startTime + depth * CLHEP::cm / CLHEP::c_light,
+                               spotEnergy,
+                               electrons - electronsSoFar);
+      electronsSoFar = electrons;
+    } // for spots
+
+    MF_LOG_DEBUG("EMShowerFastModel")
+      << particle->GetParticleName() << " of " << energy << " MeV at " << start
+      << " cm parameterised in " << nSpots << " spots (tmax=" << tmax << " X0)";
+  } // EMShowerFastModel::DoIt()
+
+  //----------------------------------------------------------------------------
+  LArVoxelReadout&
+  EMShowerFastModel::Readout()
+  {
+    if (!fReadout) {
+      fReadout = dynamic_cast<LArVoxelReadout*>(
+        G4SDManager::GetSDMpointer()->FindSensitiveDetector("LArVoxelSD", false));
+      if (!fReadout) {
+        throw cet::exception("EMShowerFastModel")
+          << "No charge readout (sensitive detector \"LArVoxelSD\") to deposit showers into.\n";
+      }
+    }
+    return *fReadout;
+  }
+
+  //----------------------------------------------------------------------------
+  EMShowerFastSimPhysics::EMShowerFastSimPhysics(G4int /*verbose*/, G4String const& name)
+    : G4VPhysicsConstructor(name)
+  {}
+
+  //----------------------------------------------------------------------------
+  void
+  EMShowerFastSimPhysics::ConstructParticle()
+  {
+    G4Gamma::Gamma();
+    G4Electron::Electron();
+    G4Positron::Positron();
+  }
+
+  //----------------------------------------------------------------------------
+  void
+  EMShowerFastSimPhysics::ConstructProcess()
+  {
+    // one process per particle: the process manager owns it
+    G4ParticleDefinition* const particles[] = {
+      G4Gamma::Gamma(), G4Electron::Electron(), G4Positron::Positron()};
+    for (G4ParticleDefinition* particle : particles) {
+      particle->GetProcessManager()->AddDiscreteProcess(
+        new G4FastSimulationManagerProcess("fastSimProcess_massGeom"));
+    }
+  }
+
+} // namespace larg4
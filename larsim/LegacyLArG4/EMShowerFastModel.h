@@ -0,0 +1,106 @@
+/**
+ * @file   larsim/LegacyLArG4/EMShowerFastModel.h
+ * @brief  Parameterised simulation of low energy electromagnetic showers.
+ * @see    larsim/LegacyLArG4/EMShowerFastModel.cxx
+ *
+ * Electrons, positrons and photons in the region of the model, with kinetic
+ * energy in the configured range, are not tracked by Geant4: their energy is
+ * split into spots, distributed with the average longitudinal and transverse
+ * profiles of an electromagnetic shower in liquid argon, and added directly
+ * to the charge readout (`LArVoxelReadout::AddEnergyDeposit()`).
+ *
+ * The model needs the Geant4 fast simulation process, which is added to the
+ * physics list by the `EMShowerFastSimPhysics` constructor (enabled as
+ * `"EMShowerFastSim"` in `LArG4Parameters` `EnabledPhysics`), and a region,
+ * which `LArG4` module sets up on the TPC active volumes.
+ */
+
+#ifndef LARSIM_LEGACYLARG4_EMSHOWERFASTMODEL_H
+#define LARSIM_LEGACYLARG4_EMSHOWERFASTMODEL_H
+
+#include "Geant4/G4String.hh"
+#include "Geant4/G4Types.hh"
+#include "Geant4/G4VFastSimulationModel.hh"
+#include "Geant4/G4VPhysicsConstructor.hh"
+
+class G4FastStep;
+class G4FastTrack;
+class G4ParticleDefinition;
+class G4Region;
+
+namespace CLHEP {
+  class HepRandomEngine;
+}
+
+namespace larg4 {
+
+  class LArVoxelReadout;
+
+  /**
+   * @brief Fast simulation model of electromagnetic showers in liquid argon.
+   *
+   * The profiles are the average ones of the PDG review ("Passage of
+   * particles through matter"): the energy deposited at depth `t` (in
+   * radiation lengths) follows a gamma distribution `(bt)^(a-1) exp(-bt)`
+   * with `b = 0.5` and the maximum at `tmax = ln(E/Ec) + C` (`C` is `-0.5`
+   * for electrons and positrons and `+0.5` for photons), and the transverse
+   * distance `r` of each spot from the shower axis follows
+   * `2 r R^2 / (r^2 + R^2)^2`, with `R` set so that 90% of the energy is
+   * within one Molière radius. Below the critical energy, where the
+   * formula has no maximum, the longitudinal profile is taken exponential.
+   *
+   * Each spot carries the same energy and a number of ionization electrons
+   * proportional to it (`Config_t::electronsPerMeV`, which includes the
+   * recombination). All the deposits are attributed to the track which
+   * started the shower; no secondary particle is created, and no
+   * scintillation light is produced for the parameterised energy.
+   */
+  class EMShowerFastModel : public G4VFastSimulationModel {
+  public:
+    /// Configuration of the model.
+    struct Config_t {
+      double minEnergy = 0.;       ///< Lowest kinetic energy parameterised [MeV]
+      double maxEnergy = 0.;       ///< Kinetic energy parameterised from here on [MeV]
+      double spotEnergy = 1.;      ///< Approximate energy of each spot [MeV]
+      double electronsPerMeV = 0.; ///< Ionization electrons per deposited MeV
+      double radiationLength = 14.0;  ///< Radiation length of the medium [cm]
+      double criticalEnergy = 32.84;  ///< Critical energy of the medium [MeV]
+      double moliereRadius = 9.04;    ///< Molière radius of the medium [cm]
+    };
+
+    /// Creates the model, active in `region`.
+    EMShowerFastModel(G4String const& name,
+                      G4Region* region,
+                      Config_t const& config,
+                      CLHEP::HepRandomEngine& engine);
+
+    /// Electrons, positrons and photons are parameterised.
+    G4bool IsApplicable(G4ParticleDefinition const& particle) override;
+
+    /// Particles are parameterised in the configured energy range.
+    G4bool ModelTrigger(G4FastTrack const& fastTrack) override;
+
+    /// Stops the particle and deposits its energy in the readout.
+    void DoIt(G4FastTrack const& fastTrack, G4FastStep& fastStep) override;
+
+  private:
+    Config_t fConfig;
+    CLHEP::HepRandomEngine& fEngine;
+    LArVoxelReadout* fReadout = nullptr; ///< Charge readout, found on first use
+
+    /// Returns the charge readout; throws if it is not available.
+    LArVoxelReadout& Readout();
+  };
+
+  /// Adds the Geant4 fast simulation process to electrons, positrons and photons.
+  class EMShowerFastSimPhysics : public G4VPhysicsConstructor {
+  public:
+    EMShowerFastSimPhysics(G4int ver = 0, G4String const& name = "EMShowerFastSim");
+
+    void ConstructParticle() override;
+    void ConstructProcess() override;
+  };
+
+} // namespace larg4
+
+#endif // LARSIM_LEGACYLARG4_EMSHOWERFASTMODEL_H
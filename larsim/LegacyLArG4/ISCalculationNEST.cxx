@@ -41,10 +41,9 @@ namespace larg4 {
   void
   ISCalculationNEST::CalculateIonizationAndScintillation(const G4Step* step)
   {
-    // get a const representation of the track for this step
-    const G4Track track(*(step->GetTrack()));
-
-    fNest.CalculateIonizationAndScintillation(track, *step);
+    // the track is passed by reference: a copy of it, with its own dynamic
+    // particle, would be made and destroyed at each step
+    fNest.CalculateIonizationAndScintillation(*(step->GetTrack()), *step);
 
     // compare the energy deposition of this step to what is in the fNest object
     if (fNest.EnergyDeposition() != step->GetTotalEnergyDeposit() / CLHEP::MeV)
@@ -70,9 +70,6 @@ namespace larg4 {
     // Reset the values for the electrons, photons, and energy to 0
     // in the calculator
     fISCalc->Reset();
-    //set the current track and step number values to bogus so that it will run the first reset:
-    fStepNumber = -1;
-    fTrkID = -1;
 
     // make the histograms
     art::ServiceHandle<art::TFileService const> tfs;
@@ -94,60 +91,65 @@ namespace larg4 {
   }
 
   //......................................................................
-  void
+  IonizationAndScintillation::StepRecord_t const&
   IonizationAndScintillation::Reset(const G4Step* step)
   {
+    G4Track const* track = step->GetTrack();
 
-    if (fStepNumber == step->GetTrack()->GetCurrentStepNumber() &&
-        fTrkID == step->GetTrack()->GetTrackID())
-      return;
+    // the step is identified by its track and its number in the track;
+    // the track pointer protects from a new event or run repeating the IDs
+    if (fStepRecord.stepNumber == track->GetCurrentStepNumber() &&
+        fStepRecord.trackID == track->GetTrackID() && fStepRecord.track == track)
+      return fStepRecord;
 
-    fStepNumber = step->GetTrack()->GetCurrentStepNumber();
-    fTrkID = step->GetTrack()->GetTrackID();
-
-    fStep = step;
-
-    fISCalc->Reset();
+    fStepRecord = StepRecord_t{};
+    fStepRecord.track = track;
+    fStepRecord.trackID = track->GetTrackID();
+    fStepRecord.stepNumber = track->GetCurrentStepNumber();
 
     // check the material for this step and be sure it is LAr
-    if (step->GetTrack()->GetMaterial()->GetName() != "LAr") return;
+    if (track->GetMaterial()->GetName() != "LAr") return fStepRecord;
 
     // double check that the energy deposit is non-zero
     // then do the calculation if it is
     if (step->GetTotalEnergyDeposit() > 0) {
 
-      fISCalc->CalculateIonizationAndScintillation(fStep);
+      fISCalc->Reset();
+      fISCalc->CalculateIonizationAndScintillation(step);
+      fStepRecord.energyDeposit = fISCalc->EnergyDeposit();
+      fStepRecord.visibleEnergyDeposit = fISCalc->VisibleEnergyDeposit();
+      fStepRecord.numIonElectrons = fISCalc->NumberIonizationElectrons();
+      fStepRecord.numScintPhotons = fISCalc->NumberScintillationPhotons();
 
       MF_LOG_DEBUG("IonizationAndScintillation")
-        << "Step Size: " << fStep->GetStepLength() / CLHEP::cm
-        << "\nEnergy: " << fISCalc->EnergyDeposit()
-        << "\nElectrons: " << fISCalc->NumberIonizationElectrons()
-        << "\nPhotons: " << fISCalc->NumberScintillationPhotons();
+        << "Step Size: " << step->GetStepLength() / CLHEP::cm
+        << "\nEnergy: " << fStepRecord.energyDeposit
+        << "\nElectrons: " << fStepRecord.numIonElectrons
+        << "\nPhotons: " << fStepRecord.numScintPhotons;
 
-      G4ThreeVector totstep = fStep->GetPostStepPoint()->GetPosition();
-      totstep -= fStep->GetPreStepPoint()->GetPosition();
+      G4ThreeVector totstep = step->GetPostStepPoint()->GetPosition();
+      totstep -= step->GetPreStepPoint()->GetPosition();
 
       // Fill the histograms
-      fStepSize->Fill(totstep.mag() / CLHEP::cm);
-      fEnergyPerStep->Fill(fISCalc->EnergyDeposit());
-      fElectronsPerStep->Fill(fISCalc->NumberIonizationElectrons());
-      fPhotonsPerStep->Fill(fISCalc->NumberScintillationPhotons());
-      fElectronsVsPhotons->Fill(fISCalc->NumberScintillationPhotons(),
-                                fISCalc->NumberIonizationElectrons());
       double const stepSize = totstep.mag() / CLHEP::cm;
+      fStepSize->Fill(stepSize);
+      fEnergyPerStep->Fill(fStepRecord.energyDeposit);
+      fElectronsPerStep->Fill(fStepRecord.numIonElectrons);
+      fPhotonsPerStep->Fill(fStepRecord.numScintPhotons);
+      fElectronsVsPhotons->Fill(fStepRecord.numScintPhotons, fStepRecord.numIonElectrons);
       if (stepSize > 0.0) {
-        fElectronsPerLength->Fill(fISCalc->NumberIonizationElectrons() * 1.e-3 / stepSize);
-        fPhotonsPerLength->Fill(fISCalc->NumberScintillationPhotons() * 1.e-3 / stepSize);
+        fElectronsPerLength->Fill(fStepRecord.numIonElectrons * 1.e-3 / stepSize);
+        fPhotonsPerLength->Fill(fStepRecord.numScintPhotons * 1.e-3 / stepSize);
       }
-      double const energyDep = fISCalc->EnergyDeposit();
+      double const energyDep = fStepRecord.energyDeposit;
       if (energyDep) {
-        fElectronsPerEDep->Fill(fISCalc->NumberIonizationElectrons() * 1.e-3 / energyDep);
-        fPhotonsPerEDep->Fill(fISCalc->NumberScintillationPhotons() * 1.e-3 / energyDep);
+        fElectronsPerEDep->Fill(fStepRecord.numIonElectrons * 1.e-3 / energyDep);
+        fPhotonsPerEDep->Fill(fStepRecord.numScintPhotons * 1.e-3 / energyDep);
       }
 
     } // end if the energy deposition is non-zero
 
-    return;
+    return fStepRecord;
   }
 
 } // namespace
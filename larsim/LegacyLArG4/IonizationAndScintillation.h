@@ -14,6 +14,7 @@
 #include "larsim/LegacyLArG4/ISCalculation.h"
 
 class G4Step;
+class G4Track;
 class TH1F;
 class TH2F;
 
@@ -30,34 +31,53 @@ namespace larg4 {
   // The Ionization and Scintillation singleton
   class IonizationAndScintillation {
   public:
+    /// Ionization and scintillation of one step, computed once for all users.
+    struct StepRecord_t {
+      G4Track const* track{nullptr}; ///< track of the step
+      int trackID{-1};               ///< Geant4 ID of the track of the step
+      int stepNumber{-1};            ///< number of the step in its track
+      double energyDeposit{0.0};
+      double visibleEnergyDeposit{0.0};
+      double numIonElectrons{0.0};
+      double numScintPhotons{0.0};
+    };
+
     static IonizationAndScintillation* CreateInstance(
       detinfo::DetectorPropertiesData const& detProp,
       CLHEP::HepRandomEngine& engine);
     static IonizationAndScintillation* Instance();
 
-    // Method to reset the internal variables held in the ISCalculation
-    // This method should be called at the start of any G4Step
-    void Reset(const G4Step* step);
+    // Method to compute the ionization and scintillation of the step
+    // This method should be called at the start of any G4Step; the step is
+    // computed only on the first call, the others return the same record
+    StepRecord_t const& Reset(const G4Step* step);
+
+    /// Record of the last step passed to `Reset()`.
+    StepRecord_t const&
+    CurrentStep() const
+    {
+      return fStepRecord;
+    }
 
     double
     EnergyDeposit() const
     {
-      return fISCalc->EnergyDeposit();
+      return fStepRecord.energyDeposit;
     }
     double
     VisibleEnergyDeposit() const
     {
-      return fISCalc->VisibleEnergyDeposit();
+      return fStepRecord.visibleEnergyDeposit;
     }
     double
     NumberIonizationElectrons() const
     {
-      return fISCalc->NumberIonizationElectrons();
+      return fStepRecord.numIonElectrons;
     }
     double
     NumberScintillationPhotons() const
     {
-      return fISCalc->NumberScintillationPhotons();
+      return fStepRecord.numScintPhotons;
     }
     double
     StepSizeLimit() const
@@ -73,9 +93,7 @@ namespace larg4 {
       fISCalc;                    ///< object to calculate ionization and scintillation
                                   ///< produced by an energy deposition
     std::string fISCalculator;    ///< name of calculator to use, NEST or Separate
-    G4Step const* fStep{nullptr}; ///< pointer to the current G4 step
-    int fStepNumber{-1};          ///< last StepNumber checked
-    int fTrkID{-1};               ///< last TrkID checked
+    StepRecord_t fStepRecord;     ///< results for the current step
 
     TH1F* fElectronsPerStep{nullptr};   ///< histogram of electrons per step
     TH1F* fStepSize{nullptr};           ///< histogram of the step sizes
@@ -21,7 +21,11 @@
 #include "nug4/G4Base/G4Helper.h"
 
 // C++ Includes
+#include <algorithm> // std::max()
 #include <cassert>
+#include <cfloat> // DBL_MAX
+#include <cmath> // std::log()
+#include <fstream>
 #include <map>
 #include <set>
 #include <sstream>
@@ -59,6 +63,7 @@
 #include "larsim/LegacyLArG4/AllPhysicsLists.h"
 #include "larsim/LegacyLArG4/AuxDetReadout.h"
 #include "larsim/LegacyLArG4/AuxDetReadoutGeometry.h"
+#include "larsim/LegacyLArG4/EMShowerFastModel.h"
 #include "larsim/LegacyLArG4/IonizationAndScintillation.h"
 #include "larsim/LegacyLArG4/LArStackingAction.h"
 #include "larsim/LegacyLArG4/LArVoxelReadout.h"
@@ -68,16 +73,24 @@
 #include "larsim/LegacyLArG4/OpDetReadoutGeometry.h"
 #include "larsim/LegacyLArG4/OpDetSensitiveDetector.h"
 #include "larsim/LegacyLArG4/ParticleListAction.h"
+#include "larsim/LegacyLArG4/SimulationProfile.h"
 #include "larsim/PhotonPropagation/PhotonVisibilityService.h"
+#include "larsim/Simulation/CompactSimChannels.h"
 #include "larsim/Simulation/LArG4Parameters.h"
+#include "larsim/Simulation/ProductFootprint.h"
 #include "nug4/G4Base/UserActionManager.h"
 #include "nug4/ParticleNavigation/ParticleList.h"
 #include "nusimdata/SimulationBase/MCTruth.h"
 
 // G4 Includes
+#include "CLHEP/Units/SystemOfUnits.h"
+#include "Geant4/G4LogicalVolume.hh"
 #include "Geant4/G4LogicalVolumeStore.hh"
+#include "Geant4/G4ProductionCuts.hh"
+#include "Geant4/G4Region.hh"
 #include "Geant4/G4RunManager.hh"
 #include "Geant4/G4SDManager.hh"
+#include "Geant4/G4UserLimits.hh"
 #include "Geant4/G4VSensitiveDetector.hh"
 #include "Geant4/G4VUserDetectorConstruction.hh"
 
@@ -213,8 +226,38 @@ namespace larg4 {
    *     requires `MakeMCParticles` being `true`
    * - *DumpSimChannels* (bool, default: `false`):
    *     whether to print all depositions on each SimChannel
+   * - *StoreCompactSimChannels* (bool, default: `false`): also store the
+   *     channels as a `sim::CompactSimChannels`, with the IDE positions
+   *     quantised in steps of *CompactSimChannelResolution* (real, default:
+   *     `0.01` cm); the full collection can then be dropped from the output
+   * - *StoreProductFootprints* (bool, default: `false`): also store the
+   *     number of elements and estimated memory of each output collection
+   *     as a `std::vector<sim::ProductFootprint>`; they are reported to
+   *     `sim::ProductFootprintService` anyway, if it is configured
    * - *SmartStacking* (int, default: `0`):
    *     whether to use class to dictate how tracks are put on stack (nonzero is on)
+   * - *RoIMaxKineticEnergy* (real, default: `0`): secondary particles with a
+   *     kinetic energy below this threshold [MeV] are not tracked if they are
+   *     created farther than `RoIMaxDistance` from the active volume of all
+   *     TPCs; `0` disables this policy, which is independent of `SmartStacking`
+   * - *RoIMaxDistance* (real, default: `0`): distance from the TPC active
+   *     volumes for the `RoIMaxKineticEnergy` policy [cm]
+   * - *RoIGridSpacing* (real, default: `25`): spacing of the grid the distance
+   *     from the TPC active volumes is precomputed on [cm]; the distance is
+   *     estimated conservatively, so a coarser grid kills fewer particles;
+   *     the grid is shared with the neutron roulette
+   * - *NeutronMaxTime* (real, default: `0`): if positive, neutrons created
+   *     later than this global time [ns] are not tracked; neutrons already
+   *     in flight are stopped by the `NeutronTrackingCut` physics instead
+   *     (see `NeutronTrackingTimeLimit` in `sim::LArG4Parameters`)
+   * - *NeutronRouletteEnergy* (real, default: `0`): if positive, secondary
+   *     neutrons with less kinetic energy than this [MeV], created farther
+   *     than `NeutronRouletteDistance` [cm] from the active volume of all
+   *     TPCs, survive only with probability `NeutronSurvivalProbability`
+   *     (default: `0.1`), and the survivors have their weight divided by it;
+   *     the weight is stored in `simb::MCParticle::Weight()` of the neutron
+   *     and of its descendants. The statistics of these policies are printed
+   *     at the end of the job (see `LArStackingAction::NeutronPolicy_t`)
    * - *MakeMCParticles* (flag, default: `true`): keep a list of the particles
    *     seen in the detector, and eventually save it; you almost always want this on
    * - *KeepParticlesInVolumes* (list of strings, default: _empty_):
@@ -238,6 +281,49 @@ namespace larg4 {
    *     `larg4::LArVoxelReadout::SetOffPlaneChargeRecoveryMargin()`. A value of
    *     `0` effectively disables this feature. All TPCs will have the same
    *     margin applied.
+   * - *StepBatchSize* (unsigned integer, default: `0`): if not `0`, the
+   *     ionization of the energy deposition steps is drifted to the wire planes
+   *     in batches of this many steps (and at the end of each Geant4 event)
+   *     rather than while Geant4 is tracking; see
+   *     `larg4::LArVoxelReadout::SetStepBatchSize()`. The result is the same.
+   * - *AttenuationTableStep* (real, default: `0`): if positive, the electron
+   *     lifetime attenuation is interpolated from a table with this drift time
+   *     step (in nanoseconds) instead of being computed for each step; see
+   *     `larg4::LArVoxelReadout::SetAttenuationTableStep()`.
+   * - *TrajectoryTolerance* (real, default: `0`): if positive, the
+   *     trajectories of the particles are thinned while Geant4 tracks them,
+   *     dropping the points closer than this distance (in centimeters) to the
+   *     stored trajectory; points on volume boundaries and the ones of steps
+   *     producing secondaries are always kept. See
+   *     `larg4::ParticleListAction::SetTrajectoryTolerance()`.
+   * - *Profile* (boolean, default: `false`): if set, the time spent in each
+   *     stage of the simulation (Geant4 tracking, particle list bookkeeping,
+   *     ionization readout, fast scintillation and data product conversion)
+   *     and the number of Geant4 steps in each physical volume and in each
+   *     Geant4 region (see the `Regions` of `sim::LArG4Parameters`) are
+   *     recorded (see `larg4::SimulationProfile`); the counters of each event are
+   *     printed in the debug stream `LArG4Profile`, and the totals at the end
+   *     of the job
+   * - *ProfileSummaryFile* (string, default: empty): if not empty and
+   *     *Profile* is set, the totals are also written in JSON format into
+   *     this file at the end of the job
+   * - *EMShowerFastSimMaxEnergy* (real, default: `0`): if positive,
+   *     electrons, positrons and photons in the TPC active volumes with less
+   *     kinetic energy than this (in MeV) are not tracked, and their energy is
+   *     deposited with the average profile of an electromagnetic shower (see
+   *     `larg4::EMShowerFastModel`); requires `"EMShowerFastSim"` in the
+   *     `EnabledPhysics` list of `LArG4Parameters`. The parameterised energy
+   *     produces ionization only: no scintillation light, and no particle is
+   *     created for the shower products
+   * - *EMShowerFastSimMinEnergy* (real, default: `0`): particles with less
+   *     kinetic energy than this (in MeV) are still tracked by Geant4
+   * - *EMShowerFastSimSpotEnergy* (real, default: `1`): energy (in MeV) of
+   *     each deposit of the parameterised showers
+   * - *EMShowerFastSimDEdx* (real, default: `2.1`): energy loss (in MeV/cm)
+   *     assumed in the recombination of the parameterised deposits
+   * - *EMShowerFastSimSeed* (integer, not defined by default): if defined,
+   *     override the seed for the random generator of the parameterised
+   *     showers (obtained from the `NuRandomService` by default)
    *
    *
    * Simulation details
@@ -310,6 +396,23 @@ namespace larg4 {
    * and the single photons are distributed in time accordingly to their
    * component.
    *
+   *
+   * Threading
+   * ----------
+   *
+   * Each event is simulated sequentially, one `simb::MCTruth` after the
+   * other, by the run manager of `g4b::G4Helper` (from _nug4_), which is not
+   * a multithreaded one. Part of the per-event state is already kept per
+   * thread, so that Geant4 worker threads could fill it without locking:
+   * the photon tables (`larg4::OpDetPhotonTable::MergeThreadTables()`), the
+   * current track of `larg4::ParticleListAction` and the simulation profile.
+   * Tracking on worker threads would still need a multithreaded run manager
+   * in `g4b::G4Helper`, user actions and sensitive detectors created for each
+   * worker (including a `larg4::LArVoxelReadout` each, and a way to combine
+   * their channels; the `g4b::UserActionManager` and
+   * `larg4::IonizationAndScintillation` are single instances for the whole
+   * job) and a random engine per worker.
+   *
    */
   class LArG4 : public art::EDProducer {
   public:
@@ -321,6 +424,7 @@ namespace larg4 {
     /// produce the detector response.
     void produce(art::Event& evt) override;
     void beginJob() override;
+    void endJob() override;
     void beginRun(art::Run& run) override;
 
     std::unique_ptr<g4b::G4Helper> fG4Help{nullptr}; ///< G4 interface object
@@ -334,24 +438,51 @@ namespace larg4 {
     bool fMakeMCParticles;       ///< Whether to keep a `sim::MCParticle` list
     bool fdumpParticleList;      ///< Whether each event's sim::ParticleList will be displayed.
     bool fdumpSimChannels;       ///< Whether each event's sim::Channel will be displayed.
+    bool fStoreCompactSimChannels;       ///< Whether to store also `sim::CompactSimChannels`.
+    double fCompactSimChannelResolution; ///< Step of the compact IDE positions [cm]
+    bool fStoreProductFootprints;        ///< Whether to store the sizes of the products.
     bool fUseLitePhotons;
     bool fStoreReflected{false};
+    bool fLibraryBuildJob{false}; ///< Whether `PhotonVisibilityService` builds a library.
+    bool fFilledLibrary{false};   ///< Whether this module filled library entries.
     int fSmartStacking;          ///< Whether to instantiate and use class to
     double fOffPlaneMargin = 0.; ///< Off-plane charge recovery margin
                                  ///< dictate how tracks are put on stack.
+    LArStackingAction::RoIPolicy_t fRoIPolicy; ///< Region of interest stacking policy
+    LArStackingAction::NeutronPolicy_t fNeutronPolicy; ///< Neutron biasing stacking policy
+    LArStackingAction* fStackingAction = nullptr; ///< Stacking action (owned by Geant4)
+    unsigned int fStepBatchSize = 0U; ///< Steps drifted together by LArVoxelReadout
+    double fAttenuationTableStep = 0.; ///< Drift time step of the attenuation table [ns]
     std::vector<std::string> fInputLabels;
     std::vector<std::string>
       fKeepParticlesInVolumes; ///<Only write particles that have trajectories through these volumes
 
     bool fSparsifyTrajectories; ///< Sparsify MCParticle Trajectories
+    double fTrajectoryTolerance; ///< Online trajectory thinning tolerance [cm]
+
+    bool fProfile;                   ///< Whether to record the simulation profile
+    std::string fProfileSummaryFile; ///< JSON file for the profile of the job
+    SimulationProfile fJobProfile;   ///< Profile accumulated over the job
 
     CLHEP::HepRandomEngine& fEngine; ///< Random-number engine for IonizationAndScintillation
                                      ///< initialization
 
+    EMShowerFastModel::Config_t fEMShowerFastSim; ///< Parameterised EM shower configuration
+    double fEMShowerFastSimDEdx = 2.1;            ///< dE/dx assumed for their recombination
+    CLHEP::HepRandomEngine* fEMShowerEngine = nullptr; ///< Engine for parameterised showers
+
     detinfo::DetectorPropertiesData fDetProp; ///< Must outlive fAllPhysicsLists!
     AllPhysicsLists fAllPhysicsLists;
     LArVoxelReadoutGeometry* fVoxelReadoutGeometry{
       nullptr}; /// Pointer used for correctly updating the clock data state.
+    AuxDetReadoutGeometry* fAuxDetReadoutGeometry{
+      nullptr}; ///< Pointer used to collect the auxiliary detector channels.
+
+    /// Creates the region of the TPC active volumes and its shower model.
+    void SetupEMShowerFastSim(detinfo::DetectorPropertiesData const& detProp);
+
+    /// Creates the Geant4 regions configured in `LArG4Parameters`.
+    void SetupRegions() const;
 
     /// Configures and returns a particle filter
     std::unique_ptr<util::PositionInVolumeFilter> CreateParticleVolumeFilter(
@@ -408,10 +539,18 @@ namespace larg4 {
     , fMakeMCParticles(pset.get<bool>("MakeMCParticles", true))
     , fdumpParticleList(pset.get<bool>("DumpParticleList", false))
     , fdumpSimChannels(pset.get<bool>("DumpSimChannels", false))
+    , fStoreCompactSimChannels(pset.get<bool>("StoreCompactSimChannels", false))
+    , fCompactSimChannelResolution(pset.get<double>("CompactSimChannelResolution", 0.01))
+    , fStoreProductFootprints(pset.get<bool>("StoreProductFootprints", false))
     , fSmartStacking(pset.get<int>("SmartStacking", 0))
     , fOffPlaneMargin(pset.get<double>("ChargeRecoveryMargin", 0.0))
+    , fStepBatchSize(pset.get<unsigned int>("StepBatchSize", 0U))
+    , fAttenuationTableStep(pset.get<double>("AttenuationTableStep", 0.0))
     , fKeepParticlesInVolumes(pset.get<std::vector<std::string>>("KeepParticlesInVolumes", {}))
     , fSparsifyTrajectories(pset.get<bool>("SparsifyTrajectories", false))
+    , fTrajectoryTolerance(pset.get<double>("TrajectoryTolerance", 0.0))
+    , fProfile(pset.get<bool>("Profile", false))
+    , fProfileSummaryFile(pset.get<std::string>("ProfileSummaryFile", ""))
     , fEngine(art::ServiceHandle<rndm::NuRandomService> {}
                 ->createEngine(*this, "HepJamesRandom", "propagation", pset, "PropagationSeed"))
     , fDetProp{art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataForJob()}
@@ -420,6 +559,51 @@ namespace larg4 {
     MF_LOG_DEBUG("LArG4") << "Debug: LArG4()";
     art::ServiceHandle<art::RandomNumberGenerator const> rng;
 
+    fRoIPolicy.maxKineticEnergy = pset.get<double>("RoIMaxKineticEnergy", 0.0);
+    fRoIPolicy.maxDistance = pset.get<double>("RoIMaxDistance", 0.0);
+    fRoIPolicy.gridSpacing = pset.get<double>("RoIGridSpacing", 25.0);
+
+    fNeutronPolicy.maxTime = pset.get<double>("NeutronMaxTime", 0.0);
+    fNeutronPolicy.rouletteEnergy = pset.get<double>("NeutronRouletteEnergy", 0.0);
+    fNeutronPolicy.rouletteDistance = pset.get<double>("NeutronRouletteDistance", 0.0);
+    fNeutronPolicy.survivalProbability = pset.get<double>("NeutronSurvivalProbability", 0.1);
+
+    if (fNeutronPolicy.rouletteEnergy > 0. && !(fNeutronPolicy.survivalProbability > 0. &&
+                                                fNeutronPolicy.survivalProbability <= 1.)) {
+      throw art::Exception(art::errors::Configuration)
+        << "Option `NeutronSurvivalProbability` must be in ]0;1] (it's "
+        << fNeutronPolicy.survivalProbability << ").\n";
+    }
+
+    if ((fRoIPolicy.maxKineticEnergy > 0. || fNeutronPolicy.rouletteEnergy > 0.) &&
+        !(fRoIPolicy.gridSpacing > 0.)) {
+      throw art::Exception(art::errors::Configuration)
+        << "Option `RoIGridSpacing` must be positive (it's " << fRoIPolicy.gridSpacing << ").\n";
+    }
+
+    if (fProfile) SimulationProfile::Enable();
+
+    fEMShowerFastSim.maxEnergy = pset.get<double>("EMShowerFastSimMaxEnergy", 0.0);
+    if (fEMShowerFastSim.maxEnergy > 0.) {
+      fEMShowerFastSim.minEnergy = pset.get<double>("EMShowerFastSimMinEnergy", 0.0);
+      fEMShowerFastSim.spotEnergy = pset.get<double>("EMShowerFastSimSpotEnergy", 1.0);
+      fEMShowerFastSimDEdx = pset.get<double>("EMShowerFastSimDEdx", 2.1);
+      if (!(fEMShowerFastSim.spotEnergy > 0.) || !(fEMShowerFastSimDEdx > 0.)) {
+        throw art::Exception(art::errors::Configuration)
+          << "Options `EMShowerFastSimSpotEnergy` and `EMShowerFastSimDEdx` must be positive.\n";
+      }
+      art::ServiceHandle<sim::LArG4Parameters const> lgp;
+      auto const& enabled = lgp->EnabledPhysics();
+      if (!lgp->UseCustomPhysics() ||
+          std::find(enabled.begin(), enabled.end(), "EMShowerFastSim") == enabled.end()) {
+        throw art::Exception(art::errors::Configuration)
+          << "Option `EMShowerFastSimMaxEnergy` requires \"EMShowerFastSim\" in the custom"
+             " physics list (`EnabledPhysics` in `LArG4Parameters`).\n";
+      }
+      fEMShowerEngine = &(art::ServiceHandle<rndm::NuRandomService>()->createEngine(
+        *this, "HepJamesRandom", "emshower", pset, "EMShowerFastSimSeed"));
+    }
+
     if (!fMakeMCParticles) { // configuration option consistency
       if (fdumpParticleList) {
         throw art::Exception(art::errors::Configuration)
@@ -457,6 +641,7 @@ namespace larg4 {
       try {
         art::ServiceHandle<phot::PhotonVisibilityService const> pvs;
         fStoreReflected = pvs->StoreReflected();
+        fLibraryBuildJob = pvs->IsBuildJob();
       }
       catch (art::Exception const& e) {
         // If the service is not configured, then just keep the default
@@ -488,8 +673,19 @@ namespace larg4 {
       produces<std::vector<simb::MCParticle>>();
       produces<art::Assns<simb::MCTruth, simb::MCParticle, sim::GeneratedParticleInfo>>();
     }
-    if (!lgp->NoElectronPropagation()) produces<std::vector<sim::SimChannel>>();
+    if (!lgp->NoElectronPropagation()) {
+      produces<std::vector<sim::SimChannel>>();
+      if (fStoreCompactSimChannels) {
+        if (!(fCompactSimChannelResolution > 0.)) {
+          throw art::Exception(art::errors::Configuration)
+            << "Option `CompactSimChannelResolution` must be positive (it's "
+            << fCompactSimChannelResolution << ").\n";
+        }
+        produces<sim::CompactSimChannels>();
+      }
+    }
     produces<std::vector<sim::AuxDetSimChannel>>();
+    if (fStoreProductFootprints) produces<std::vector<sim::ProductFootprint>>();
 
     // constructor decides if initialized value is a path or an environment variable
     cet::search_path sp("FW_SEARCH_PATH");
@@ -519,6 +715,10 @@ namespace larg4 {
     mpl.GetPropertiesFromServices(detProp);
     mpl.UpdateGeometry(G4LogicalVolumeStore::GetInstance());
 
+    // the parameterised showers need their region before physics is set up
+    if (fEMShowerEngine) SetupEMShowerFastSim(detProp);
+    SetupRegions();
+
     // Tell the detector about the parallel LAr voxel geometry.
     std::vector<G4VUserParallelWorld*> pworlds;
 
@@ -533,6 +733,8 @@ namespace larg4 {
     // make a parallel world for each TPC in the detector
     LArVoxelReadoutGeometry::Setup_t readoutGeomSetupData;
     readoutGeomSetupData.readoutSetup.offPlaneMargin = fOffPlaneMargin;
+    readoutGeomSetupData.readoutSetup.stepBatchSize = fStepBatchSize;
+    readoutGeomSetupData.readoutSetup.attenuationTableStep = fAttenuationTableStep;
     readoutGeomSetupData.readoutSetup.propGen = &fEngine;
 
     fVoxelReadoutGeometry =
@@ -540,7 +742,8 @@ namespace larg4 {
     pworlds.push_back(fVoxelReadoutGeometry);
     pworlds.push_back(
       new OpDetReadoutGeometry(geom->OpDetGeoName(), "OpDetReadoutGeometry", fUseLitePhotons));
-    pworlds.push_back(new AuxDetReadoutGeometry("AuxDetReadoutGeometry"));
+    fAuxDetReadoutGeometry = new AuxDetReadoutGeometry("AuxDetReadoutGeometry");
+    pworlds.push_back(fAuxDetReadoutGeometry);
 
     fG4Help->SetParallelWorlds(pworlds);
 
@@ -560,6 +763,7 @@ namespace larg4 {
                                                         lgp->StoreTrajectories(),
                                                         lgp->KeepEMShowerDaughters(),
                                                         fMakeMCParticles);
+    fparticleListAction->SetTrajectoryTolerance(fTrajectoryTolerance);
     uaManager->AddAndAdoptAction(fparticleListAction);
 
     // UserActionManager is now configured so continue G4 initialization
@@ -567,9 +771,36 @@ namespace larg4 {
 
     // With an enormous detector with lots of rock ala LAr34 (nee LAr20)
     // we need to be smarter about stacking.
-    if (fSmartStacking > 0) {
-      G4UserStackingAction* stacking_action = new LArStackingAction(fSmartStacking);
-      fG4Help->GetRunManager()->SetUserAction(stacking_action);
+    if (fSmartStacking > 0 || fRoIPolicy.maxKineticEnergy > 0. || fNeutronPolicy.maxTime > 0. ||
+        fNeutronPolicy.rouletteEnergy > 0.) {
+      fStackingAction =
+        new LArStackingAction(std::max(fSmartStacking, 0), fRoIPolicy, fNeutronPolicy);
+      fG4Help->GetRunManager()->SetUserAction(fStackingAction);
+    }
+  }
+
+  void
+  LArG4::endJob()
+  {
+    if (fStackingAction) fStackingAction->PrintStatistics();
+
+    // in batched library builds there is no other module to write the library
+    if (fFilledLibrary) art::ServiceHandle<phot::PhotonVisibilityService>()->StoreLibrary();
+
+    if (fProfile) {
+      std::ostringstream sstr;
+      fJobProfile.Dump(sstr, "  ");
+      mf::LogInfo("LArG4Profile") << sstr.str();
+
+      if (!fProfileSummaryFile.empty()) {
+        std::ofstream out(fProfileSummaryFile);
+        fJobProfile.WriteJSON(out);
+        out.close();
+        if (!out) {
+          throw cet::exception("LArG4")
+            << "Error writing the simulation profile into '" << fProfileSummaryFile << "'\n";
+        }
+      }
     }
   }
 
@@ -626,6 +857,95 @@ namespace larg4 {
     return std::make_unique<util::PositionInVolumeFilter>(std::move(GeoVolumePairs));
   } // CreateParticleVolumeFilter()
 
+  //----------------------------------------------------------------------
+  void
+  LArG4::SetupEMShowerFastSim(detinfo::DetectorPropertiesData const& detProp)
+  {
+    // the recombination of all parameterised deposits is the one at the
+    // configured dE/dx, with the same model as the tracked steps
+    art::ServiceHandle<sim::LArG4Parameters const> lgp;
+    double const density = detProp.Density(detProp.Temperature());
+    double const efield = detProp.Efield();
+    double recomb = 0.;
+    if (lgp->UseModBoxRecomb()) {
+      double const Xi = lgp->ModBoxB() / density * fEMShowerFastSimDEdx / efield;
+      recomb = std::log(lgp->ModBoxA() + Xi) / Xi;
+    }
+    else {
+      recomb = lgp->RecombA() / (1. + fEMShowerFastSimDEdx * lgp->Recombk() / density / efield);
+    }
+    fEMShowerFastSim.electronsPerMeV = lgp->GeVToElectrons() * 1.e-3 * recomb;
+
+    // region and model live until the end of the job
+    auto* region = new G4Region("EMShowerFastSimRegion");
+    for (G4LogicalVolume* volume : *G4LogicalVolumeStore::GetInstance()) {
+      if (volume->GetName().contains("volTPCActive")) region->AddRootLogicalVolume(volume);
+    }
+    if (region->GetNumberOfRootVolumes() == 0) {
+      throw cet::exception("LArG4") << "No TPC active volume found for the parameterised showers.\n";
+    }
+    new EMShowerFastModel("EMShowerFastModel", region, fEMShowerFastSim, *fEMShowerEngine);
+  } // SetupEMShowerFastSim()
+
+  //----------------------------------------------------------------------
+  void
+  LArG4::SetupRegions() const
+  {
+    art::ServiceHandle<sim::LArG4Parameters const> lgp;
+    auto const& regions = lgp->Regions();
+    if (regions.empty()) return;
+
+    // user limits are only honoured by the processes of G4StepLimiterPhysics
+    auto const& enabled = lgp->EnabledPhysics();
+    bool const hasStepLimiter =
+      lgp->UseCustomPhysics() &&
+      std::find(enabled.begin(), enabled.end(), "StepLimiter") != enabled.end();
+
+    G4LogicalVolumeStore* store = G4LogicalVolumeStore::GetInstance();
+    mf::LogInfo log("LArG4");
+    for (sim::LArG4Parameters::RegionSettings_t const& settings : regions) {
+      // regions and their cuts and limits live until the end of the job
+      auto* region = new G4Region(settings.name);
+      for (std::string const& volName : settings.volumes) {
+        auto const iVolume = std::find_if(store->begin(), store->end(), [&volName](auto* volume) {
+          return volume->GetName() == volName;
+        });
+        if (iVolume == store->end()) {
+          throw art::Exception(art::errors::Configuration)
+            << "Volume '" << volName << "' of region '" << settings.name << "' not found.\n";
+        }
+        if ((*iVolume)->IsRootRegion()) {
+          throw art::Exception(art::errors::Configuration)
+            << "Volume '" << volName << "' of region '" << settings.name
+            << "' already starts the region '" << (*iVolume)->GetRegion()->GetName() << "'.\n";
+        }
+        region->AddRootLogicalVolume(*iVolume);
+      }
+
+      log << "Region '" << settings.name << "':";
+      if (settings.productionCut >= 0.) {
+        auto* cuts = new G4ProductionCuts;
+        cuts->SetProductionCut(settings.productionCut * CLHEP::cm);
+        region->SetProductionCuts(cuts);
+        log << " production cut " << settings.productionCut << " cm;";
+      }
+      if (settings.maxStepLength > 0. || settings.minKineticEnergy > 0.) {
+        if (!hasStepLimiter) {
+          throw art::Exception(art::errors::Configuration)
+            << "Limits of region '" << settings.name << "' require \"StepLimiter\" in the custom"
+               " physics list (`EnabledPhysics` in `LArG4Parameters`).\n";
+        }
+        double const maxStep =
+          (settings.maxStepLength > 0.) ? settings.maxStepLength * CLHEP::cm : DBL_MAX;
+        region->SetUserLimits(
+          new G4UserLimits(maxStep, DBL_MAX, DBL_MAX, settings.minKineticEnergy * CLHEP::MeV));
+        log << " max step " << settings.maxStepLength << " cm; min kinetic energy "
+            << settings.minKineticEnergy << " MeV;";
+      }
+      log << "\n";
+    } // for regions
+  } // SetupRegions()
+
   void
   LArG4::produce(art::Event& evt)
   {
@@ -666,13 +986,23 @@ namespace larg4 {
     art::ServiceHandle<sim::LArG4Parameters const> lgp;
     art::ServiceHandle<geo::Geometry const> geom;
 
-    // Clear the detected photon table
-    OpDetPhotonTable::Instance()->ClearTable(geom->NOpDets());
-    if (lgp->FillSimEnergyDeposits()) OpDetPhotonTable::Instance()->ClearEnergyDeposits();
+    // Clear the detected photon tables of all the threads
+    OpDetPhotonTable::ClearThreadTables(geom->NOpDets());
+    if (lgp->FillSimEnergyDeposits()) OpDetPhotonTable::ClearThreadEnergyDeposits();
 
     // reset the track ID offset as we have a new collection of interactions
     fparticleListAction->ResetTrackIDOffset();
 
+    // library builds with light from many voxels in the event (batched
+    // LightSource) have one interaction per voxel: the detected photons are
+    // counted under the interaction they come from
+    std::size_t const nLightSources =
+      fLibraryBuildJob ?
+        art::ServiceHandle<phot::PhotonVisibilityService const>()->GetLightProds().size() :
+        0;
+    bool const batchedLibraryBuild = (nLightSources > 1) && !lgp->NoPhotonPropagation();
+    std::size_t nTrackedSources = 0;
+
     //look to see if there is any MCTruth information for this
     //event
     std::vector<art::Handle<std::vector<simb::MCTruth>>> mclists;
@@ -697,10 +1027,16 @@ namespace larg4 {
 
         MF_LOG_DEBUG("LArG4") << *(mct.get());
 
+        if (batchedLibraryBuild) OpDetPhotonTable::SetCurrentLightSource(nTrackedSources++);
+
         // The following tells Geant4 to track the particles in this interaction.
-        fG4Help->G4Run(mct);
+        {
+          SimulationProfile::Scope const timer{SimulationProfile::G4Tracking};
+          fG4Help->G4Run(mct);
+        }
 
         if (!partCol) continue;
+        SimulationProfile::Scope const conversionTimer{SimulationProfile::ProductConversion};
         assert(tpassn);
 
         // receive the particle list
@@ -746,6 +1082,18 @@ namespace larg4 {
 
     } // end loop over interactions
 
+    if (batchedLibraryBuild) {
+      OpDetPhotonTable::SetCurrentLightSource(-1);
+      if (nTrackedSources != nLightSources) {
+        throw art::Exception(art::errors::LogicError)
+          << "Light was produced in " << nLightSources << " voxels, but " << nTrackedSources
+          << " interactions were simulated: batched library builds need one `simb::MCTruth`"
+             " per voxel.\n";
+      }
+    }
+
+    SimulationProfile::Scope conversionTimer{SimulationProfile::ProductConversion};
+
     // get the electrons from the LArVoxelReadout sensitive detector
     // Get the sensitive-detector manager.
     G4SDManager* sdManager = G4SDManager::GetSDMpointer();
@@ -755,8 +1103,30 @@ namespace larg4 {
       sdManager->FindSensitiveDetector("OpDetSensitiveDetector"));
 
     // Store the contents of the detected photon table
+    // (including the ones filled by other threads, if any)
     //
     if (theOpDetDet) {
+      OpDetPhotonTable::Instance()->MergeThreadTables();
+
+      if (batchedLibraryBuild) {
+        // visibility of each voxel: fraction of its photons detected by each channel
+        art::ServiceHandle<phot::PhotonVisibilityService> pvs;
+        auto const& lightProds = pvs->GetLightProds();
+        for (bool const Reflected : {false, true}) {
+          if (Reflected && !fStoreReflected) continue;
+          auto const counts = OpDetPhotonTable::Instance()->YieldLightSourceCounts(Reflected);
+          for (std::size_t iSource = 0; iSource < lightProds.size(); ++iSource) {
+            auto const& [voxel, N] = lightProds[iSource];
+            for (unsigned int opDet = 0; opDet < geom->NOpDets(); ++opDet) {
+              unsigned int const n = ((iSource < counts.size()) && (opDet < counts[iSource].size())) ?
+                                       counts[iSource][opDet] :
+                                       0U;
+              pvs->SetLibraryEntry(voxel, opDet, (N > 0.0) ? n / N : 0.0, Reflected);
+            }
+          }
+        }
+        fFilledLibrary = true;
+      }
 
       if (!lgp->NoPhotonPropagation()) {
 
@@ -781,21 +1151,10 @@ namespace larg4 {
           else {
             MF_LOG_DEBUG("Optical") << "Storing OpDet Hit Collection in Event";
 
-            std::map<int, std::map<int, int>> ThePhotons =
-              OpDetPhotonTable::Instance()->GetLitePhotons(Reflected);
-
-            if (size(ThePhotons) > 0) {
-              LitePhotonCol->reserve(ThePhotons.size());
-              for (auto const& [opChannel, detectedPhotons] : ThePhotons) {
-                sim::SimPhotonsLite ph;
-                ph.OpChannel = opChannel;
-                ph.DetectedPhotons = detectedPhotons;
-                if (Reflected)
-                  LitePhotonColRefl->push_back(std::move(ph));
-                else
-                  LitePhotonCol->push_back(std::move(ph));
-              }
-            }
+            std::vector<sim::SimPhotonsLite> ThePhotons =
+              OpDetPhotonTable::Instance()->YieldLitePhotons(Reflected);
+
+            append(Reflected ? *LitePhotonColRefl : *LitePhotonCol, std::move(ThePhotons));
           }
           if (Reflected)
             *cOpDetBacktrackerRecordColRefl =
@@ -862,14 +1221,13 @@ namespace larg4 {
               << "Sensitive detector '" << sd->GetName() << "' is not a LArVoxelReadout object\n";
           }
 
-          LArVoxelReadout::ChannelMap_t& channels = larVoxelReadout->GetSimChannelMap(c, t);
+          std::vector<sim::SimChannel> channels = larVoxelReadout->YieldSimChannels(c, t);
           if (!empty(channels)) {
             MF_LOG_DEBUG("LArG4") << "now put " << channels.size() << " SimChannels from C=" << c
                                   << " T=" << t << " into the event";
           }
 
-          for (auto ch_pair : channels) {
-            sim::SimChannel& sc = ch_pair.second;
+          for (sim::SimChannel& sc : channels) {
 
             // push sc onto scCol but only if we haven't already put something in scCol for this channel.
             // if we have, then merge the ionization deposits.  Skip the check if we only have one TPC
@@ -920,19 +1278,14 @@ namespace larg4 {
       // gdml file - see AuxDetGeo.cxx
       for (size_t sv = 0; sv < geom->AuxDet(a).NSensitiveVolume(); ++sv) {
 
-        // N.B. this name convention is used when creating the
-        //      AuxDetReadout SD in AuxDetReadoutGeometry
-        std::stringstream name;
-        name << "AuxDetSD_AuxDet" << a << "_" << sv;
-        G4VSensitiveDetector* sd = sdManager->FindSensitiveDetector(name.str().c_str());
-        if (!sd) {
+        // the readouts are recorded by number when AuxDetReadoutGeometry
+        // creates them (with the SD name "AuxDetSD_AuxDet<a>_<sv>")
+        larg4::AuxDetReadout* auxDetReadout = fAuxDetReadoutGeometry->Readout(a, sv);
+        if (!auxDetReadout) {
           throw cet::exception("LArG4")
-            << "Sensitive detector '" << name.str() << "' does not exist\n";
+            << "Sensitive detector 'AuxDetSD_AuxDet" << a << "_" << sv << "' does not exist\n";
         }
 
-        // Convert the G4VSensitiveDetector* to a AuxDetReadout*.
-        larg4::AuxDetReadout* auxDetReadout = dynamic_cast<larg4::AuxDetReadout*>(sd);
-
         MF_LOG_DEBUG("LArG4") << "now put the AuxDetSimTracks in the event";
 
         const sim::AuxDetSimChannel adsc = auxDetReadout->GetAuxDetSimChannel();
@@ -959,7 +1312,42 @@ namespace larg4 {
       } // for
     }   // if dump SimChannels
 
-    if (!lgp->NoElectronPropagation()) evt.put(std::move(scCol));
+    sim::ProductFootprints footprints;
+    if (!lgp->NoElectronPropagation())
+      footprints.push_back(sim::makeFootprint("sim::SimChannel", *scCol));
+    footprints.push_back(sim::makeFootprint("sim::AuxDetSimChannel", *adCol));
+    if (partCol) footprints.push_back(sim::makeFootprint("simb::MCParticle", *partCol));
+    if (!lgp->NoPhotonPropagation()) {
+      if (!fUseLitePhotons) {
+        footprints.push_back(sim::makeFootprint("sim::SimPhotons", *PhotonCol));
+        if (fStoreReflected)
+          footprints.push_back(sim::makeFootprint("sim::SimPhotons", *PhotonColRefl, "Reflected"));
+      }
+      else {
+        footprints.push_back(sim::makeFootprint("sim::SimPhotonsLite", *LitePhotonCol));
+        footprints.push_back(
+          sim::makeFootprint("sim::OpDetBacktrackerRecord", *cOpDetBacktrackerRecordCol));
+        if (fStoreReflected) {
+          footprints.push_back(
+            sim::makeFootprint("sim::SimPhotonsLite", *LitePhotonColRefl, "Reflected"));
+          footprints.push_back(sim::makeFootprint(
+            "sim::OpDetBacktrackerRecord", *cOpDetBacktrackerRecordColRefl, "Reflected"));
+        }
+      }
+    }
+    if (lgp->FillSimEnergyDeposits()) {
+      footprints.push_back(
+        sim::makeFootprint("sim::SimEnergyDeposit", *edepCol_TPCActive, "TPCActive"));
+      footprints.push_back(sim::makeFootprint("sim::SimEnergyDeposit", *edepCol_Other, "Other"));
+    }
+
+    if (!lgp->NoElectronPropagation()) {
+      if (fStoreCompactSimChannels) {
+        evt.put(std::make_unique<sim::CompactSimChannels>(
+          sim::makeCompactSimChannels(*scCol, fCompactSimChannelResolution)));
+      }
+      evt.put(std::move(scCol));
+    }
 
     evt.put(std::move(adCol));
     if (partCol) evt.put(std::move(partCol));
@@ -983,6 +1371,20 @@ namespace larg4 {
       evt.put(std::move(edepCol_TPCActive), "TPCActive");
       evt.put(std::move(edepCol_Other), "Other");
     }
+    sim::reportFootprints(
+      evt, moduleDescription().moduleLabel(), std::move(footprints), fStoreProductFootprints);
+
+    conversionTimer.Stop();
+    if (fProfile) {
+      SimulationProfile eventProfile = SimulationProfile::YieldThreadProfiles();
+      eventProfile.AddEvents();
+      if (mf::isDebugEnabled()) {
+        std::ostringstream sstr;
+        eventProfile.Dump(sstr, "  ");
+        MF_LOG_DEBUG("LArG4Profile") << "Event " << evt.id() << ":\n" << sstr.str();
+      }
+      fJobProfile.Merge(eventProfile);
+    }
     return;
   } // LArG4::produce()
 
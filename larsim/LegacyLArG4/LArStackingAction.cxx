@@ -31,6 +31,8 @@
 
 #include "Geant4/G4MuonMinus.hh"
 #include "Geant4/G4MuonPlus.hh"
+#include "Geant4/G4Neutron.hh"
+#include "Geant4/Randomize.hh"
 #include "Geant4/G4StackManager.hh"
 #include "Geant4/G4String.hh"
 #include "Geant4/G4ThreeVector.hh"
@@ -46,6 +48,12 @@
 
 // Framework includes
 #include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// C/C++ standard libraries
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 LArStackingAction::LArStackingAction(G4int dum)
  : fstage(0)
@@ -61,6 +69,35 @@ LArStackingAction::LArStackingAction(G4int dum)
 
 }
 
+LArStackingAction::LArStackingAction(G4int dum, RoIPolicy_t const& roiPolicy)
+  : LArStackingAction(dum, roiPolicy, NeutronPolicy_t{})
+{}
+
+LArStackingAction::LArStackingAction(G4int dum,
+                                     RoIPolicy_t const& roiPolicy,
+                                     NeutronPolicy_t const& neutronPolicy)
+  : LArStackingAction(dum)
+{
+  fRoI = roiPolicy;
+  fNeutrons = neutronPolicy;
+  double gridDistance = -1.;
+  if (fRoI.maxKineticEnergy > 0.) gridDistance = fRoI.maxDistance;
+  if (fNeutrons.rouletteEnergy > 0.)
+    gridDistance = std::max(gridDistance, fNeutrons.rouletteDistance);
+  if (gridDistance >= 0.) BuildDistanceGrid(gridDistance);
+
+  if (fNeutrons.maxTime > 0.) {
+    mf::LogInfo("LArStackingAction")
+      << "Killing neutrons created later than " << fNeutrons.maxTime << " ns";
+  }
+  if (fNeutrons.rouletteEnergy > 0.) {
+    mf::LogInfo("LArStackingAction")
+      << "Neutrons below " << fNeutrons.rouletteEnergy << " MeV farther than "
+      << fNeutrons.rouletteDistance << " cm from the TPCs survive with probability "
+      << fNeutrons.survivalProbability;
+  }
+}
+
 LArStackingAction::~LArStackingAction()
 { //delete theMessenger;
 }
@@ -68,6 +105,16 @@ LArStackingAction::~LArStackingAction()
 G4ClassificationOfNewTrack
 LArStackingAction::ClassifyNewTrack(const G4Track * aTrack)
 {
+  // the neutron and region of interest policies are applied first, and
+  // alone if there is no other stacking
+  bool const neutronPolicy = (fNeutrons.maxTime > 0. || fNeutrons.rouletteEnergy > 0.);
+  bool const roiPolicy = (fRoI.maxKineticEnergy > 0.);
+  if (neutronPolicy || roiPolicy) {
+    if (neutronPolicy && KillNeutron(aTrack)) return fKill;
+    if (roiPolicy && OutsideRoI(aTrack)) return fKill;
+    if (fStack == 0) return fUrgent;
+  }
+
   G4ClassificationOfNewTrack classification = fWaiting;
   art::ServiceHandle<geo::Geometry const> geom;
   TString volName(InsideTPC(aTrack));
@@ -170,6 +217,137 @@ LArStackingAction::ClassifyNewTrack(const G4Track * aTrack)
 }
 
 
+void LArStackingAction::BuildDistanceGrid(double maxDistance)
+{
+  art::ServiceHandle<geo::Geometry const> geom;
+
+  std::vector<geo::BoxBoundedGeo> activeBoxes;
+  for (geo::TPCGeo const& TPC : geom->IterateTPCs())
+    activeBoxes.push_back(TPC.ActiveBoundingBox());
+
+  geo::BoxBoundedGeo box{activeBoxes.front()};
+  for (geo::BoxBoundedGeo const& activeBox : activeBoxes)
+    box.ExtendToInclude(activeBox);
+
+  // the grid extends beyond the distance of interest by one cell, so that
+  // any point outside of it is farther than that from all the TPCs
+  double const spacing = fRoI.gridSpacing;
+  double const margin = maxDistance + spacing;
+  double const lower[3] = {box.MinX() - margin, box.MinY() - margin, box.MinZ() - margin};
+  double const upper[3] = {box.MaxX() + margin, box.MaxY() + margin, box.MaxZ() + margin};
+  for (std::size_t axis = 0; axis < 3U; ++axis) {
+    fGridLower[axis] = lower[axis];
+    fGridN[axis] = static_cast<std::size_t>(std::ceil((upper[axis] - lower[axis]) / spacing)) + 1;
+  }
+  // a point is never farther than half a cell diagonal from its closest node
+  fGridSlack = 0.5 * std::sqrt(3.0) * spacing;
+
+  // signed distance from the union of the boxes (negative inside)
+  fGridDistance.resize(fGridN[0] * fGridN[1] * fGridN[2]);
+  std::size_t node = 0;
+  for (std::size_t iz = 0; iz < fGridN[2]; ++iz) {
+    double const z = lower[2] + iz * spacing;
+    for (std::size_t iy = 0; iy < fGridN[1]; ++iy) {
+      double const y = lower[1] + iy * spacing;
+      for (std::size_t ix = 0; ix < fGridN[0]; ++ix) {
+        double const x = lower[0] + ix * spacing;
+        double distance = std::numeric_limits<double>::max();
+        for (geo::BoxBoundedGeo const& activeBox : activeBoxes) {
+          double const dx = std::max(activeBox.MinX() - x, x - activeBox.MaxX());
+          double const dy = std::max(activeBox.MinY() - y, y - activeBox.MaxY());
+          double const dz = std::max(activeBox.MinZ() - z, z - activeBox.MaxZ());
+          double const outside = std::hypot(std::max(dx, 0.), std::max(dy, 0.), std::max(dz, 0.));
+          double const inside = std::min(std::max({dx, dy, dz}), 0.);
+          distance = std::min(distance, outside + inside);
+        } // for boxes
+        fGridDistance[node++] = static_cast<float>(distance);
+      } // for x
+    }   // for y
+  }     // for z
+
+  mf::LogInfo("LArStackingAction")
+    << "Distance grid from the TPCs: " << fGridN[0] << "x" << fGridN[1] << "x" << fGridN[2]
+    << " nodes every " << spacing << " cm";
+  if (fRoI.maxKineticEnergy > 0.) {
+    mf::LogInfo("LArStackingAction")
+      << "Killing secondaries below " << fRoI.maxKineticEnergy << " MeV farther than "
+      << fRoI.maxDistance << " cm from the TPCs";
+  }
+}
+
+double LArStackingAction::DistanceFromActive(const G4Track * aTrack) const
+{
+  // G4 returns positions in mm, have to convert to cm for LArSoft coordinate systems
+  G4ThreeVector const& tr4Pos = aTrack->GetPosition();
+  double const pos[3] = {tr4Pos.x() / CLHEP::cm, tr4Pos.y() / CLHEP::cm, tr4Pos.z() / CLHEP::cm};
+
+  std::size_t index[3];
+  for (std::size_t axis = 0; axis < 3U; ++axis) {
+    double const u = std::round((pos[axis] - fGridLower[axis]) / fRoI.gridSpacing);
+    if (u < 0. || u >= double(fGridN[axis])) // outside the grid: far away
+      return std::numeric_limits<double>::max();
+    index[axis] = static_cast<std::size_t>(u);
+  }
+  return fGridDistance[(index[2] * fGridN[1] + index[1]) * fGridN[0] + index[0]] - fGridSlack;
+}
+
+bool LArStackingAction::OutsideRoI(const G4Track * aTrack) const
+{
+  if (aTrack->GetParentID() == 0) return false; // primaries are always tracked
+  ++fNRoIChecked;
+  if (aTrack->GetKineticEnergy() / CLHEP::MeV >= fRoI.maxKineticEnergy) return false;
+  if (DistanceFromActive(aTrack) <= fRoI.maxDistance) return false;
+  ++fNRoIKilled;
+  return true;
+}
+
+bool LArStackingAction::KillNeutron(const G4Track * aTrack) const
+{
+  if (aTrack->GetParentID() == 0) return false; // primaries are always tracked
+  if (aTrack->GetDefinition() != G4Neutron::NeutronDefinition()) return false;
+
+  if (fNeutrons.maxTime > 0. && aTrack->GetGlobalTime() / CLHEP::ns > fNeutrons.maxTime) {
+    ++fNNeutronsLate;
+    return true;
+  }
+
+  if (fNeutrons.rouletteEnergy <= 0.) return false;
+  if (aTrack->GetKineticEnergy() / CLHEP::MeV >= fNeutrons.rouletteEnergy) return false;
+  if (DistanceFromActive(aTrack) <= fNeutrons.rouletteDistance) return false;
+
+  ++fNNeutronsRoulette;
+  double const weight = aTrack->GetWeight();
+  fRouletteWeightIn += weight;
+  if (G4UniformRand() >= fNeutrons.survivalProbability) return true;
+
+  // the weight is carried by the track into its secondaries and MCParticle
+  double const newWeight = weight / fNeutrons.survivalProbability;
+  const_cast<G4Track*>(aTrack)->SetWeight(newWeight);
+  ++fNNeutronsSurvived;
+  fRouletteWeightOut += newWeight;
+  return false;
+}
+
+void LArStackingAction::PrintStatistics() const
+{
+  if (fRoI.maxKineticEnergy > 0.) {
+    mf::LogInfo("LArStackingAction")
+      << "Region of interest policy killed " << fNRoIKilled << " of " << fNRoIChecked
+      << " secondary tracks";
+  }
+  if (fNeutrons.maxTime > 0.) {
+    mf::LogInfo("LArStackingAction")
+      << "Neutron time cut killed " << fNNeutronsLate << " neutrons";
+  }
+  if (fNeutrons.rouletteEnergy > 0.) {
+    // the two weights are expected to agree within the roulette fluctuations
+    mf::LogInfo("LArStackingAction")
+      << "Neutron roulette: " << fNNeutronsSurvived << " of " << fNNeutronsRoulette
+      << " neutrons survived; weight " << fRouletteWeightIn << " in, " << fRouletteWeightOut
+      << " out";
+  }
+}
+
 std::string LArStackingAction::InsideTPC(const G4Track * aTrack)
 {
 
@@ -30,7 +30,10 @@
 #include "Geant4/G4UserStackingAction.hh"
 #include "Geant4/G4Types.hh"
 
+#include <array>
+#include <cstddef>
 #include <string>
+#include <vector>
 
 class G4Track;
 
@@ -41,9 +44,45 @@ class LArStackingActionMessenger;
 class LArStackingAction : public G4UserStackingAction
 {
   public:
+    /// Configuration of the region of interest policy.
+    ///
+    /// Secondary tracks with kinetic energy below `maxKineticEnergy`, starting
+    /// farther than `maxDistance` from the active volume of all TPCs, are
+    /// killed. The distance is looked up on a grid with `gridSpacing` spacing
+    /// that is precomputed at construction; it is conservative, so a track
+    /// is never killed closer than `maxDistance`.
+    struct RoIPolicy_t {
+      double maxKineticEnergy = 0.; ///< Kinetic energy threshold [MeV] (`0` disables)
+      double maxDistance = 0.;      ///< Distance from the active volumes [cm]
+      double gridSpacing = 25.;     ///< Spacing of the distance grid [cm]
+    };
+
+    /// Configuration of the neutron biasing policy.
+    ///
+    /// Neutrons created later than `maxTime` are killed. Neutrons with
+    /// kinetic energy below `rouletteEnergy`, starting farther than
+    /// `rouletteDistance` from the active volume of all TPCs, play Russian
+    /// roulette: they survive with probability `survivalProbability`, and the
+    /// survivors have their weight divided by it, so that weighted sums are
+    /// unbiased. The distance is looked up on the same grid as the region of
+    /// interest policy (with the spacing of `RoIPolicy_t`). Primaries are
+    /// never affected.
+    struct NeutronPolicy_t {
+      double maxTime = 0.;             ///< Creation time cut [ns] (`0` disables)
+      double rouletteEnergy = 0.;      ///< Kinetic energy threshold [MeV] (`0` disables)
+      double rouletteDistance = 0.;    ///< Distance from the active volumes [cm]
+      double survivalProbability = 1.; ///< Probability to survive the roulette
+    };
+
     LArStackingAction(int );
+    LArStackingAction(int, RoIPolicy_t const& roiPolicy);
+    LArStackingAction(int, RoIPolicy_t const& roiPolicy, NeutronPolicy_t const& neutronPolicy);
     virtual ~LArStackingAction();
 
+    /// Prints how many tracks the region of interest and neutron policies
+    /// have killed, and the weight of the roulette survivors.
+    void PrintStatistics() const;
+
   public:
     // These 3 methods must be implemented by us. EC, 16-Feb-2011.
     virtual G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* aTrack);
@@ -54,6 +93,39 @@ class LArStackingAction : public G4UserStackingAction
   private:
     //G4bool InsideRoI(const G4Track * aTrack,G4double ang);
     std::string InsideTPC(const G4Track * aTrack);
+
+    /// Fills the grid of signed distances from the TPC active volumes,
+    /// covering at least `maxDistance` [cm] around them.
+    void BuildDistanceGrid(double maxDistance);
+
+    /// Lower bound of the distance of `aTrack` from the active volumes [cm];
+    /// the maximum `double` value if it is beyond the grid.
+    double DistanceFromActive(const G4Track * aTrack) const;
+
+    /// Returns whether the region of interest policy kills `aTrack`.
+    bool OutsideRoI(const G4Track * aTrack) const;
+
+    /// Applies the neutron policy to `aTrack`; returns whether it is killed.
+    bool KillNeutron(const G4Track * aTrack) const;
+
+    RoIPolicy_t fRoI;
+    NeutronPolicy_t fNeutrons;
+
+    /// @name Grid of signed distances from the active volume [cm]
+    /// @{
+    std::array<double, 3U> fGridLower{{0., 0., 0.}};
+    std::array<std::size_t, 3U> fGridN{{0U, 0U, 0U}};
+    std::vector<float> fGridDistance; ///< Distance at each node (x fastest).
+    double fGridSlack = 0.;           ///< Maximum distance of a point from its node.
+    /// @}
+
+    mutable unsigned long long fNRoIChecked = 0ULL; ///< Tracks checked by the RoI policy.
+    mutable unsigned long long fNRoIKilled = 0ULL;  ///< Tracks killed by the RoI policy.
+    mutable unsigned long long fNNeutronsLate = 0ULL;     ///< Neutrons killed by the time cut.
+    mutable unsigned long long fNNeutronsRoulette = 0ULL; ///< Neutrons playing the roulette.
+    mutable unsigned long long fNNeutronsSurvived = 0ULL; ///< Neutrons surviving the roulette.
+    mutable double fRouletteWeightIn = 0.;  ///< Total weight entering the roulette.
+    mutable double fRouletteWeightOut = 0.; ///< Total weight of the roulette survivors.
     //G4VHitsCollection* GetCollection(G4String colName);
 
     //ExN04TrackerHitsCollection* trkHits;
@@ -6,9 +6,11 @@
 ////////////////////////////////////////////////////////////////////////
 
 // C/C++ standard library
+#include <algorithm> // std::stable_sort()
 #include <cassert>
 #include <cmath>  // std::ceil()
 #include <cstdio> // std::sscanf()
+#include <iterator> // std::next()
 #include <map>
 #include <string>
 #include <utility> // std::move()
@@ -35,7 +37,9 @@
 #include "larsim/LegacyLArG4/IonizationAndScintillation.h"
 #include "larsim/LegacyLArG4/LArVoxelReadout.h"
 #include "larsim/LegacyLArG4/ParticleListAction.h"
+#include "larsim/LegacyLArG4/SimulationProfile.h"
 #include "larsim/Utils/SCEOffsetBounds.h"
+#include "larsim/Utils/TraceZones.h"
 
 // CLHEP
 #include "CLHEP/Random/RandGauss.h"
@@ -75,6 +79,8 @@ namespace larg4 {
   {
     SetOffPlaneChargeRecoveryMargin(setupData.offPlaneMargin);
     SetRandomEngines(setupData.propGen);
+    SetStepBatchSize(setupData.stepBatchSize);
+    SetAttenuationTableStep(setupData.attenuationTableStep);
   }
 
   //---------------------------------------------------------------------------------------
@@ -129,6 +135,26 @@ namespace larg4 {
 
     fDontDriftThem = (fDontDriftThem || fLgpHandle->NoElectronPropagation());
 
+    // the drift constants are taken from the first event
+    if (!fDriftPhysicsReady) {
+      double maxDriftTime = 0.;
+      if (fAttenuationTableStep > 0.) {
+        for (geo::TPCGeo const& tpcg : fGeoHandle->IterateTPCs())
+          maxDriftTime = std::max(maxDriftTime, tpcg.DriftDistance() / fDriftVelocity[0]);
+        maxDriftTime *= 1.1; // room for space charge displacement
+      }
+      fDriftPhysics = larsim::Utils::DriftPhysicsTable{fElectronLifetime,
+                                                       fLongitudinalDiffusion,
+                                                       fTransverseDiffusion,
+                                                       maxDriftTime,
+                                                       fAttenuationTableStep};
+      double const recipDriftVel[3] = {
+        1. / fDriftVelocity[0], 1. / fDriftVelocity[1], 1. / fDriftVelocity[2]};
+      fClusterDrift = larsim::Utils::ElectronClusterDrift{
+        recipDriftVel, fElectronClusterSize, fMinNumberOfElCluster};
+      fDriftPhysicsReady = true;
+    }
+
     fNSteps = 0;
   }
 
@@ -137,6 +163,8 @@ namespace larg4 {
   void
   LArVoxelReadout::EndOfEvent(G4HCofThisEvent*)
   {
+    DriftBufferedSteps();
+    FoldStagedDeposits();
     MF_LOG_DEBUG("LArVoxelReadout") << "Total number of steps was " << fNSteps << std::endl;
   }
 
@@ -149,14 +177,55 @@ namespace larg4 {
   void
   LArVoxelReadout::ClearSimChannels()
   {
+    fBufferedSteps.clear();
     fChannelMaps.resize(fGeoHandle->Ncryostats());
-    size_t cryo = 0;
-    for (auto& cryoData : fChannelMaps) { // each, a vector of maps
-      cryoData.resize(fGeoHandle->NTPC(cryo++));
-      for (auto& channelsMap : cryoData)
+    fStagedDeposits.resize(fGeoHandle->Ncryostats());
+    for (size_t cryo = 0; cryo < fChannelMaps.size(); ++cryo) {
+      fChannelMaps[cryo].resize(fGeoHandle->NTPC(cryo));
+      for (auto& channelsMap : fChannelMaps[cryo])
         channelsMap.clear(); // each, a map
-    }                        // for cryostats
-  }                          // LArVoxelReadout::ClearSimChannels()
+      // the staging buffers keep their memory for the next event
+      fStagedDeposits[cryo].resize(fGeoHandle->NTPC(cryo));
+      for (auto& deposits : fStagedDeposits[cryo])
+        deposits.clear();
+    } // for cryostats
+  }   // LArVoxelReadout::ClearSimChannels()
+
+  //---------------------------------------------------------------------------------------
+  void
+  LArVoxelReadout::FoldStagedDeposits() const
+  {
+    for (size_t cryo = 0; cryo < fStagedDeposits.size(); ++cryo) {
+      for (size_t tpc = 0; tpc < fStagedDeposits[cryo].size(); ++tpc)
+        FoldStagedDeposits(cryo, tpc);
+    }
+  } // LArVoxelReadout::FoldStagedDeposits()
+
+  void
+  LArVoxelReadout::FoldStagedDeposits(unsigned short cryo, unsigned short tpc) const
+  {
+    std::vector<StagedDeposit_t>& deposits = fStagedDeposits.at(cryo).at(tpc);
+    if (deposits.empty()) return;
+
+    // The sorting is stable: deposits on the same channel and TDC are added
+    // in the order of their steps, which gives the same SimChannel content
+    // as adding each step as soon as it is processed. Each channel is looked
+    // up only once.
+    std::stable_sort(deposits.begin(), deposits.end());
+
+    ChannelMap_t& channels = fChannelMaps[cryo][tpc];
+    auto iChannel = channels.end();
+    for (StagedDeposit_t const& deposit : deposits) {
+      if ((iChannel == channels.end()) || (iChannel->first != deposit.channel)) {
+        iChannel = channels.lower_bound(deposit.channel);
+        if ((iChannel == channels.end()) || (iChannel->first != deposit.channel))
+          iChannel = channels.emplace_hint(iChannel, deposit.channel, deposit.channel);
+      }
+      iChannel->second.AddIonizationElectrons(
+        deposit.trackID, deposit.tdc, deposit.electrons, deposit.xyz, deposit.energy);
+    } // for deposits
+    deposits.clear();
+  } // LArVoxelReadout::FoldStagedDeposits()
 
   const LArVoxelReadout::ChannelMap_t&
   LArVoxelReadout::GetSimChannelMap() const
@@ -175,12 +244,14 @@ namespace larg4 {
   const LArVoxelReadout::ChannelMap_t&
   LArVoxelReadout::GetSimChannelMap(unsigned short cryo, unsigned short tpc) const
   {
+    FoldStagedDeposits(cryo, tpc);
     return fChannelMaps.at(cryo).at(tpc);
   }
 
   LArVoxelReadout::ChannelMap_t&
   LArVoxelReadout::GetSimChannelMap(unsigned short cryo, unsigned short tpc)
   {
+    FoldStagedDeposits(cryo, tpc);
     return fChannelMaps.at(cryo).at(tpc);
   }
 
@@ -195,18 +266,33 @@ namespace larg4 {
   LArVoxelReadout::GetSimChannels(unsigned short cryo, unsigned short tpc) const
   {
     std::vector<sim::SimChannel> channels;
-    const ChannelMap_t& chmap = fChannelMaps.at(cryo).at(tpc);
+    const ChannelMap_t& chmap = GetSimChannelMap(cryo, tpc);
     channels.reserve(chmap.size());
     for (const auto& chpair : chmap)
       channels.push_back(chpair.second);
     return channels;
   }
 
+  std::vector<sim::SimChannel>
+  LArVoxelReadout::YieldSimChannels(unsigned short cryo, unsigned short tpc)
+  {
+    std::vector<sim::SimChannel> channels;
+    ChannelMap_t& chmap = GetSimChannelMap(cryo, tpc);
+    channels.reserve(chmap.size());
+    for (auto& chpair : chmap)
+      channels.push_back(std::move(chpair.second));
+    chmap.clear();
+    return channels;
+  }
+
   //---------------------------------------------------------------------------------------
   // Called for each step.
   G4bool
   LArVoxelReadout::ProcessHits(G4Step* step, G4TouchableHistory* pHistory)
   {
+    SimulationProfile::Scope const timer{SimulationProfile::VoxelReadout};
+    LARSIM_TRACE_ZONE("LArVoxelReadout::ProcessHits");
+
     // All work done for the "parallel world" "box of voxels" in
     // LArVoxelReadoutGeometry makes this a fairly simple routine.
     // First, the usual check for non-zero energy:
@@ -225,23 +311,33 @@ namespace larg4 {
 
       // Make sure we have the IonizationAndScintillation singleton
       // reset to this step
-      larg4::IonizationAndScintillation::Instance()->Reset(step);
+      auto const& ionAndScint = larg4::IonizationAndScintillation::Instance()->Reset(step);
       fNSteps++;
       if (!fDontDriftThem) {
 
-        G4ThreeVector midPoint =
+        G4ThreeVector const midPoint =
           0.5 * (step->GetPreStepPoint()->GetPosition() + step->GetPostStepPoint()->GetPosition());
-        double g4time = step->GetPreStepPoint()->GetGlobalTime();
+
+        // Save what is needed from the step, since the drift may be deferred
+        // after Geant4 has moved on to other steps
+        BufferedStep_t bufferedStep{};
+        bufferedStep.xyz[0] = midPoint.x() / CLHEP::cm;
+        bufferedStep.xyz[1] = midPoint.y() / CLHEP::cm;
+        bufferedStep.xyz[2] = midPoint.z() / CLHEP::cm;
+        bufferedStep.time = step->GetPreStepPoint()->GetGlobalTime();
+        bufferedStep.energy = ionAndScint.energyDeposit;
+        bufferedStep.nElectrons = ionAndScint.numIonElectrons;
 
         // Find the Geant4 track ID for the particle responsible for depositing the
         // energy.  if we are only storing primary EM shower particles, and this energy
         // is from a secondary etc EM shower particle, the ID returned is the primary
-        const int trackID = ParticleListAction::GetCurrentTrackID();
+        bufferedStep.trackID = ParticleListAction::GetCurrentTrackID();
 
         // Find out which TPC we are in.
         // If this readout object covers just one, we already know it.
         // Otherwise, we have to ask Geant where we are.
-        unsigned short int cryostat = 0, tpc = 0;
+        unsigned short int& cryostat = bufferedStep.cryostat;
+        unsigned short int& tpc = bufferedStep.tpc;
         if (bSingleTPC) {
           cryostat = fCstat;
           tpc = fTPC;
@@ -278,13 +374,90 @@ namespace larg4 {
         // Note that if there is no particle ID for this energy deposit, the
         // trackID will be sim::NoParticleId.
 
-        DriftIonizationElectrons(*fClockData, midPoint, g4time, trackID, cryostat, tpc);
+        HandleStep(bufferedStep);
       } // end we are drifting
     }   // end there is non-zero energy deposition
 
     return true;
   }
 
+  //----------------------------------------------------------------------------
+  void
+  LArVoxelReadout::AddEnergyDeposit(geo::Point_t const& location,
+                                    double time,
+                                    double energy,
+                                    int nElectrons)
+  {
+    SimulationProfile::Scope const timer{SimulationProfile::VoxelReadout};
+
+    if (energy <= 0.) return;
+    fNSteps++;
+    if (fDontDriftThem) return;
+
+    BufferedStep_t bufferedStep{};
+    bufferedStep.xyz[0] = location.X();
+    bufferedStep.xyz[1] = location.Y();
+    bufferedStep.xyz[2] = location.Z();
+    bufferedStep.time = time;
+    bufferedStep.energy = energy;
+    bufferedStep.nElectrons = nElectrons;
+    bufferedStep.trackID = ParticleListAction::GetCurrentTrackID();
+
+    // without a touchable, the TPC is found from the geometry; deposits out
+    // of the active volume of all TPCs are lost, as they would be with steps
+    geo::TPCGeo const* tpcg = nullptr;
+    if (bSingleTPC) {
+      bufferedStep.cryostat = fCstat;
+      bufferedStep.tpc = fTPC;
+      tpcg = &fGeoHandle->TPC(fTPC, fCstat);
+    }
+    else {
+      unsigned int tpc = 0, cryostat = 0;
+      try {
+        tpcg = &fGeoHandle->PositionToTPC(bufferedStep.xyz, tpc, cryostat);
+      }
+      catch (cet::exception const&) {
+        MF_LOG_DEBUG("LArVoxelReadout")
+          << "Energy deposit at " << location << " cm is not in any TPC: dropped";
+        return;
+      }
+      if (Has(fSkipWireSignalInTPCs, tpc)) return;
+      bufferedStep.cryostat = cryostat;
+      bufferedStep.tpc = tpc;
+    }
+    if (!tpcg->ActiveBoundingBox().ContainsPosition(location)) return;
+
+    HandleStep(bufferedStep);
+  } // LArVoxelReadout::AddEnergyDeposit()
+
+  //----------------------------------------------------------------------------
+  void
+  LArVoxelReadout::HandleStep(BufferedStep_t const& step)
+  {
+    if (fStepBatchSize == 0) {
+      DriftIonizationElectrons(*fClockData, step);
+    }
+    else {
+      fBufferedSteps.push_back(step);
+      if (fBufferedSteps.size() >= fStepBatchSize) DriftBufferedSteps();
+    }
+  } // LArVoxelReadout::HandleStep()
+
+  //----------------------------------------------------------------------------
+  void
+  LArVoxelReadout::DriftBufferedSteps()
+  {
+    if (fBufferedSteps.empty()) return;
+    assert(fClockData != nullptr);
+
+    // steps are drifted in the order they were produced, so that the random
+    // sequence, and therefore the result, is the same as without buffering
+    for (BufferedStep_t const& step : fBufferedSteps)
+      DriftIonizationElectrons(*fClockData, step);
+    MF_LOG_DEBUG("LArVoxelReadout") << "Drifted a batch of " << fBufferedSteps.size() << " steps";
+    fBufferedSteps.clear();
+  } // LArVoxelReadout::DriftBufferedSteps()
+
   //----------------------------------------------------------------------------
   void
   LArVoxelReadout::SetRandomEngines(CLHEP::HepRandomEngine* pPropGen)
@@ -333,12 +506,13 @@ namespace larg4 {
   // energy is passed in with units of MeV, dx has units of cm
   void
   LArVoxelReadout::DriftIonizationElectrons(detinfo::DetectorClocksData const& clockData,
-                                            G4ThreeVector stepMidPoint,
-                                            const double simTime,
-                                            int trackID,
-                                            unsigned short int cryostat,
-                                            unsigned short int tpc)
+                                            BufferedStep_t const& step)
   {
+    const double simTime = step.time;
+    const int trackID = step.trackID;
+    const unsigned short int cryostat = step.cryostat;
+    const unsigned short int tpc = step.tpc;
+
     auto const tpcClock = clockData.TPCClock();
 
     // this must be always true, unless caller has been sloppy
@@ -350,47 +524,35 @@ namespace larg4 {
     // traveling through every voxel. Use whatever tricks we can to
     // increase its execution speed.
 
-    static double LifetimeCorr_const = -1000. * fElectronLifetime;
-    static double LDiff_const = std::sqrt(2. * fLongitudinalDiffusion);
-    static double TDiff_const = std::sqrt(2. * fTransverseDiffusion);
     static double RecipDriftVel[3] = {
       1. / fDriftVelocity[0], 1. / fDriftVelocity[1], 1. / fDriftVelocity[2]};
 
-    struct Deposit_t {
-      double energy = 0.;
-      double electrons = 0.;
-
-      void
-      add(double more_energy, double more_electrons)
-      {
-        energy += more_energy;
-        electrons += more_electrons;
-      }
-    }; // Deposit_t
-
-    // Map of electrons to store - catalogued by map[channel][tdc]
-    std::map<raw::ChannelID_t, std::map<unsigned int, Deposit_t>> DepositsToStore;
+    // Electrons to store are staged, and added to the SimChannels in bulk
+    // (see `FoldStagedDeposits()`); the ones of this step start here
+    std::vector<StagedDeposit_t>& StagedDeposits = fStagedDeposits[cryostat][tpc];
+    std::size_t const firstStepDeposit = StagedDeposits.size();
 
     double xyz1[3] = {0.};
 
-    double const xyz[3] = {
-      stepMidPoint.x() / CLHEP::cm, stepMidPoint.y() / CLHEP::cm, stepMidPoint.z() / CLHEP::cm};
+    double const* xyz = step.xyz;
 
     // Already know which TPC we're in because we have been told
 
     try {
       const geo::TPCGeo& tpcg = fGeoHandle->TPC(tpc, cryostat);
+      std::vector<larsim::Utils::PlaneChannelLookup> const& planeChannels =
+        fChannelLookup.TPCPlanes(tpc, cryostat);
 
       // X drift distance - the drift direction can be either in
       // the positive or negative direction, so use std::abs
 
       /// \todo think about effects of drift between planes
-      double XDrift = std::abs(stepMidPoint.x() / CLHEP::cm - tpcg.PlaneLocation(0)[0]);
+      double XDrift = std::abs(xyz[0] - tpcg.PlaneLocation(0)[0]);
       //std::cout<<tpcg.DriftDirection()<<std::endl;
       if (tpcg.DriftDirection() == geo::kNegX)
-        XDrift = stepMidPoint.x() / CLHEP::cm - tpcg.PlaneLocation(0)[0];
+        XDrift = xyz[0] - tpcg.PlaneLocation(0)[0];
       else if (tpcg.DriftDirection() == geo::kPosX)
-        XDrift = tpcg.PlaneLocation(0)[0] - stepMidPoint.x() / CLHEP::cm;
+        XDrift = tpcg.PlaneLocation(0)[0] - xyz[0];
 
       if (XDrift < 0.) return;
 
@@ -421,10 +583,9 @@ namespace larg4 {
                   tpcg.PlanePitch(0, 1) * RecipDriftVel[1]);
       }
 
-      const double lifetimecorrection = TMath::Exp(TDrift / LifetimeCorr_const);
-      const int nIonizedElectrons =
-        larg4::IonizationAndScintillation::Instance()->NumberIonizationElectrons();
-      const double energy = larg4::IonizationAndScintillation::Instance()->EnergyDeposit();
+      const double lifetimecorrection = fDriftPhysics.attenuation(TDrift);
+      const int nIonizedElectrons = step.nElectrons;
+      const double energy = step.energy;
 
       // if we have no electrons (too small energy or too large recombination)
       // we are done already here
@@ -437,53 +598,23 @@ namespace larg4 {
       const double nElectrons = nIonizedElectrons * lifetimecorrection;
 
       // Longitudinal & transverse diffusion sigma (cm)
-      double SqrtT = std::sqrt(TDrift);
-      double LDiffSig = SqrtT * LDiff_const;
-      double TDiffSig = SqrtT * TDiff_const;
-      double electronclsize = fElectronClusterSize;
-
-      int nClus = (int)std::ceil(nElectrons / electronclsize);
-      if (nClus < fMinNumberOfElCluster) {
-        electronclsize = nElectrons / fMinNumberOfElCluster;
-        if (electronclsize < 1.0) { electronclsize = 1.0; }
-        nClus = (int)std::ceil(nElectrons / electronclsize);
-      }
-
-      // Compute arrays of values as quickly as possible.
-      std::vector<double> XDiff(nClus);
-      std::vector<double> YDiff(nClus);
-      std::vector<double> ZDiff(nClus);
-      std::vector<double> nElDiff(nClus, electronclsize);
-      std::vector<double> nEnDiff(nClus);
-
-      // fix the number of electrons in the last cluster, that has smaller size
-      nElDiff.back() = nElectrons - (nClus - 1) * electronclsize;
-
-      for (size_t xx = 0; xx < nElDiff.size(); ++xx) {
-        if (nElectrons > 0)
-          nEnDiff[xx] = energy / nElectrons * nElDiff[xx];
-        else
-          nEnDiff[xx] = 0.;
-      }
-
-      double const avegageYtransversePos = (stepMidPoint.y() / CLHEP::cm) + posOffsets.Y();
-      double const avegageZtransversePos = (stepMidPoint.z() / CLHEP::cm) + posOffsets.Z();
-
-      // Smear drift times by x position and drift time
-      if (LDiffSig > 0.0)
-        PropRand.fireArray(nClus, &XDiff[0], 0., LDiffSig);
-      else
-        XDiff.assign(nClus, 0.0);
-
-      if (TDiffSig > 0.0) {
-        // Smear the Y,Z position by the transverse diffusion
-        PropRand.fireArray(nClus, &YDiff[0], avegageYtransversePos, TDiffSig);
-        PropRand.fireArray(nClus, &ZDiff[0], avegageZtransversePos, TDiffSig);
-      }
-      else {
-        YDiff.assign(nClus, avegageYtransversePos);
-        ZDiff.assign(nClus, avegageZtransversePos);
-      }
+      double LDiffSig = fDriftPhysics.longitudinalSigma(TDrift);
+      double TDiffSig = fDriftPhysics.transverseSigma(TDrift);
+
+      double const avegageYtransversePos = xyz[1] + posOffsets.Y();
+      double const avegageZtransversePos = xyz[2] + posOffsets.Z();
+
+      // Split in electron clusters, and smear their drift time by the x
+      // position and their Y,Z position by the transverse diffusion
+      larsim::Utils::ElectronClusters& clusters = fElectronClusters;
+      int const nClus = fClusterDrift.split(nElectrons, energy, clusters);
+      fClusterDrift.diffuse(
+        PropRand, LDiffSig, TDiffSig, avegageYtransversePos, avegageZtransversePos, clusters);
+      std::vector<double> const& XDiff = clusters.longDiff;
+      std::vector<double> const& YDiff = clusters.trans1;
+      std::vector<double> const& ZDiff = clusters.trans2;
+      std::vector<double> const& nElDiff = clusters.nElectrons;
+      std::vector<double> const& nEnDiff = clusters.energy;
 
       // make a collection of electrons for each plane
       for (size_t p = 0; p < tpcg.Nplanes(); ++p) {
@@ -526,15 +657,22 @@ namespace larg4 {
               xyz1[2] = landingPos.Z();
 
             } // if charge lands off plane
-            uint32_t channel = fGeoHandle->NearestChannel(xyz1, p, tpc, cryostat);
+            raw::ChannelID_t const channel = planeChannels[p].nearestChannel(xyz1);
+            if (!raw::isValidChannelID(channel)) {
+              MF_LOG_DEBUG("LArVoxelReadout")
+                << "electrons from point (" << xyz[0] << "," << xyz[1] << "," << xyz[2]
+                << ") drifted outside plane " << p;
+              continue;
+            }
 
             /// \todo check on what happens if we allow the tdc value to be
             /// \todo beyond the end of the expected number of ticks
             // Add potential decay/capture/etc delay effect, simTime.
             unsigned int tdc = tpcClock.Ticks(clockData.G4ToElecTime(TDiff + simTime));
 
-            // Add electrons produced by each cluster to the map
-            DepositsToStore[channel][tdc].add(nEnDiff[k], nElDiff[k]);
+            // Add electrons produced by each cluster to the staged ones
+            StagedDeposits.push_back(
+              {channel, tdc, trackID, nElDiff[k], nEnDiff[k], {xyz[0], xyz[1], xyz[2]}});
           }
           catch (cet::exception& e) {
             MF_LOG_DEBUG("LArVoxelReadout")
@@ -544,39 +682,27 @@ namespace larg4 {
         } // end loop over clusters
       }   // end loop over planes
 
-      // Now store them in SimChannels
-      ChannelMap_t& ChannelDataMap = fChannelMaps[cryostat][tpc];
-
-      // browse deposited data on each channel: (channel; deposit data in time)
-      for (auto const& deposit_per_channel : DepositsToStore) {
-
-        raw::ChannelID_t channel = deposit_per_channel.first;
-
-        // find whether we already have this channel
-        auto iChannelData = ChannelDataMap.find(channel);
-
-        // channelData is the SimChannel these deposits are going to be added to
-        // If there is such a channel already, use it (first beanch).
-        // If it's a new channel, the inner assignment creates a new SimChannel
-        // in the map, and we save its reference in channelData
-        sim::SimChannel& channelData = (iChannelData == ChannelDataMap.end()) ?
-                                         (ChannelDataMap[channel] = sim::SimChannel(channel)) :
-                                         iChannelData->second;
-
-        // go through all deposits, one for each TDC: (TDC, deposit data)
-        for (auto const& deposit_per_tdc : deposit_per_channel.second) {
-          channelData.AddIonizationElectrons(trackID,
-                                             deposit_per_tdc.first,
-                                             deposit_per_tdc.second.electrons,
-                                             xyz,
-                                             deposit_per_tdc.second.energy);
-
-        } // for deposit on TDCs
-      }   // for deposit on channels
+      // Merge the clusters of this step landing on the same channel and TDC;
+      // the stable sort preserves the order the cluster energies are summed in
+      auto const stepBegin = StagedDeposits.begin() + firstStepDeposit;
+      if (stepBegin != StagedDeposits.end()) {
+        std::stable_sort(stepBegin, StagedDeposits.end());
+        auto iLast = stepBegin;
+        for (auto iDeposit = std::next(stepBegin); iDeposit != StagedDeposits.end(); ++iDeposit) {
+          if ((iDeposit->channel == iLast->channel) && (iDeposit->tdc == iLast->tdc)) {
+            iLast->electrons += iDeposit->electrons;
+            iLast->energy += iDeposit->energy;
+          }
+          else
+            *++iLast = *iDeposit;
+        } // for deposits of this step
+        StagedDeposits.erase(std::next(iLast), StagedDeposits.end());
+      }
 
     } // end try intended to catch points where TPC can't be found
     catch (cet::exception& e) {
       MF_LOG_DEBUG("LArVoxelReadout") << "step cannot be found in a TPC\n" << e;
+      StagedDeposits.resize(firstStepDeposit); // drop the partial step
     }
 
     return;
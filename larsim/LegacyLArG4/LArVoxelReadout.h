@@ -61,9 +61,13 @@
 
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "larcore/Geometry/Geometry.h"
+#include "larcoreobj/SimpleTypesAndConstants/RawTypes.h" // raw::ChannelID_t
 #include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h"
 #include "lardataobj/Simulation/SimChannel.h"
 #include "larsim/Simulation/LArG4Parameters.h"
+#include "larsim/Utils/DriftPhysicsTable.h"
+#include "larsim/Utils/ElectronClusterDrift.h"
+#include "larsim/Utils/PlaneChannelLookup.h"
 namespace detinfo {
   class DetectorClocksData;
   class DetectorPropertiesData;
@@ -165,6 +169,15 @@ namespace larg4 {
    *   is actually off it by less than the chosen margin, it's accounted for by
    *   that plane; by default the margin is 0 and all the charge off the plane
    *   is lost (with a warning)
+   * * batch the drift of the steps: regulated by `SetStepBatchSize()`, the
+   *   steps are only recorded while Geant4 is tracking, and their charge is
+   *   drifted in batches of the chosen size and at the end of each Geant4
+   *   event; by default (size 0) each step is drifted as soon as it happens.
+   *   The result does not depend on the batch size
+   * * tabulated attenuation: regulated by `SetAttenuationTableStep()`, the
+   *   electron lifetime attenuation is interpolated from a table of drift
+   *   times (see `larsim::Utils::DriftPhysicsTable`); by default it is
+   *   computed exactly for each step
    *
    */
   class LArVoxelReadout : public G4VSensitiveDetector {
@@ -180,6 +193,12 @@ namespace larg4 {
 
       /// Margin for charge recovery (see `LArVoxelReadout`).
       double offPlaneMargin = 0.0;
+
+      /// Number of steps drifted together (see `SetStepBatchSize()`).
+      unsigned int stepBatchSize = 0U;
+
+      /// Drift time step of the attenuation table [ns] (see `SetAttenuationTableStep()`).
+      double attenuationTableStep = 0.0;
     }; // struct Setup_t
 
     /// Constructor. Can detect which TPC to cover by the name
@@ -211,6 +230,24 @@ namespace larg4 {
     // in the G4Step in the LArVoxelList.
     virtual G4bool ProcessHits(G4Step*, G4TouchableHistory*);
 
+    /**
+     * @brief Adds an energy deposit which does not come from a Geant4 step.
+     * @param location position of the deposit [cm]
+     * @param time global time of the deposit [ns]
+     * @param energy deposited energy [MeV]
+     * @param nElectrons number of ionization electrons, before drift
+     *
+     * This is the entry point of parameterised simulations (e.g. the fast
+     * simulation of electromagnetic showers, `larg4::EMShowerFastModel`): the
+     * deposit is attributed to the track currently tracked by Geant4, and
+     * drifted like the ones from `ProcessHits()`. The TPC is found from the
+     * geometry, and deposits out of the active volume of the TPCs are lost.
+     */
+    void AddEnergyDeposit(geo::Point_t const& location,
+                          double time,
+                          double energy,
+                          int nElectrons);
+
     // Empty methods; they have to be defined, but they're rarely
     // used in Geant4 applications.
     virtual void DrawAll();
@@ -229,6 +266,10 @@ namespace larg4 {
     /// Creates a list with the accumulated information for specified TPC
     std::vector<sim::SimChannel> GetSimChannels(unsigned short cryo, unsigned short tpc) const;
 
+    /// Moves the accumulated information for the specified TPC out, sorted by
+    /// channel; the SimChannels of that TPC are left empty.
+    std::vector<sim::SimChannel> YieldSimChannels(unsigned short cryo, unsigned short tpc);
+
     //@{
     /// Returns the accumulated channel -> SimChannel map for the single TPC
     const ChannelMap_t& GetSimChannelMap() const;
@@ -242,6 +283,41 @@ namespace larg4 {
     //@}
 
   private:
+    /// Information from a Geant4 step needed to drift its ionization.
+    struct BufferedStep_t {
+      double xyz[3];               ///< Middle point of the step [cm]
+      double time;                 ///< Global time of the start of the step [ns]
+      double energy;               ///< Deposited energy [MeV]
+      int nElectrons;              ///< Number of ionization electrons
+      int trackID;                 ///< Geant4 track the step belongs to
+      unsigned short int cryostat; ///< Cryostat the step is in
+      unsigned short int tpc;      ///< TPC the step is in
+    };                             // BufferedStep_t
+
+    /// Ionization from a step reaching a channel at a TDC tick, not yet
+    /// added to its SimChannel.
+    struct StagedDeposit_t {
+      raw::ChannelID_t channel;
+      unsigned int tdc;
+      int trackID;
+      double electrons;
+      double energy;
+      double xyz[3]; ///< Position of the step [cm]
+
+      /// Order by channel, then TDC tick.
+      bool
+      operator<(StagedDeposit_t const& other) const
+      {
+        return (channel != other.channel) ? (channel < other.channel) : (tdc < other.tdc);
+      }
+    }; // StagedDeposit_t
+
+    /// Adds the staged deposits of all TPCs to their SimChannels.
+    void FoldStagedDeposits() const;
+
+    /// Adds the staged deposits of the specified TPC to its SimChannels.
+    void FoldStagedDeposits(unsigned short cryo, unsigned short tpc) const;
+
     // N.B. This code is not thread-safe, as it presupposes that there
     // is a "current" clock-data object.  Such a pattern should be
     // avoided for the users of larg4.
@@ -274,6 +350,37 @@ namespace larg4 {
       fOffPlaneMargin = std::max(margin, 0.0);
     }
 
+    /**
+     * @brief Sets how many steps to collect before drifting their charge.
+     * @param nSteps number of steps per batch (`0` drifts each step at once)
+     *
+     * The buffered steps are also drifted at the end of each Geant4 event.
+     * Steps are drifted in the order they were produced, so the result does
+     * not depend on `nSteps`.
+     *
+     * This method is used by `LArVoxelReadout::Setup()`.
+     */
+    void
+    SetStepBatchSize(unsigned int nSteps)
+    {
+      fStepBatchSize = nSteps;
+    }
+
+    /**
+     * @brief Sets the drift time step of the electron attenuation table.
+     * @param step drift time between table entries [ns] (`0`: no table)
+     *
+     * The table is built at the first event, covering the longest drift of
+     * the detector; the attenuation of longer drifts is computed exactly.
+     *
+     * This method is used by `LArVoxelReadout::Setup()`.
+     */
+    void
+    SetAttenuationTableStep(double step)
+    {
+      fAttenuationTableStep = step;
+    }
+
     /// Sets the random generators to be used.
     void SetRandomEngines(CLHEP::HepRandomEngine* pPropGen);
 
@@ -318,11 +425,13 @@ namespace larg4 {
     geo::Point_t RecoverOffPlaneDeposit(geo::Point_t const& pos, geo::PlaneGeo const& plane) const;
 
     void DriftIonizationElectrons(detinfo::DetectorClocksData const& clockData,
-                                  G4ThreeVector stepMidPoint,
-                                  const double simTime,
-                                  int trackID,
-                                  unsigned short int cryostat,
-                                  unsigned short int tpc);
+                                  BufferedStep_t const& step);
+
+    /// Drifts the ionization of `step` right away, or buffers it.
+    void HandleStep(BufferedStep_t const& step);
+
+    /// Drifts the ionization of all the buffered steps, and clears them.
+    void DriftBufferedSteps();
 
     bool
     Has(std::vector<unsigned short int> v, unsigned short int tpc) const
@@ -345,9 +454,25 @@ namespace larg4 {
     std::vector<unsigned short int> fSkipWireSignalInTPCs;
     /// Charge deposited within this many [cm] from the plane is lead onto it.
     double fOffPlaneMargin = 0.0;
-
-    std::vector<std::vector<ChannelMap_t>> fChannelMaps; ///< Maps of cryostat, tpc to channel data
+    double fAttenuationTableStep = 0.0; ///< Attenuation table step [ns] (`0`: none)
+    /// Attenuation and diffusion by drift time, set up at the first event.
+    larsim::Utils::DriftPhysicsTable fDriftPhysics;
+    /// Splitting of the charge in clusters and their diffusion, set up with `fDriftPhysics`.
+    larsim::Utils::ElectronClusterDrift fClusterDrift;
+    bool fDriftPhysicsReady = false;
+    larsim::Utils::ElectronClusters fElectronClusters; ///< Clusters of the current step.
+
+    /// Maps of cryostat, tpc to channel data; they are filled from
+    /// `fStagedDeposits` on demand.
+    mutable std::vector<std::vector<ChannelMap_t>> fChannelMaps;
+    unsigned int fStepBatchSize = 0U;          ///< Steps drifted together (`0`: one by one)
+    std::vector<BufferedStep_t> fBufferedSteps; ///< Steps not drifted yet
+
+    /// Deposits of cryostat, tpc not yet in the channel maps, in step order.
+    mutable std::vector<std::vector<std::vector<StagedDeposit_t>>> fStagedDeposits;
     art::ServiceHandle<geo::Geometry const> fGeoHandle;  ///< Handle to the Geometry service
+    /// Channel of the positions on each plane, sampled on first use of each TPC.
+    larsim::Utils::ChannelLookup fChannelLookup{*fGeoHandle.get()};
     art::ServiceHandle<sim::LArG4Parameters const>
       fLgpHandle;        ///< Handle to the LArG4 parameters service
     unsigned int fTPC;   ///< which TPC this LArVoxelReadout corresponds to
@@ -192,21 +192,42 @@ namespace larg4 {
     using VoxelCache_t = std::map<VoxelSpecs_t, VoxelVolumes_t>;
     VoxelCache_t VoxelCache;
 
+    // Get some constants from the LAr voxel information object.
+    // Remember, ROOT uses cm.
+    art::ServiceHandle<sim::LArVoxelCalculator const> lvc;
+    G4double const voxelSizeX = lvc->VoxelSizeX() * CLHEP::cm;
+    G4double const voxelSizeY = lvc->VoxelSizeY() * CLHEP::cm;
+    G4double const voxelSizeZ = lvc->VoxelSizeZ() * CLHEP::cm;
+    G4double const voxelOffsetX = lvc->VoxelOffsetX() * CLHEP::cm;
+    G4double const voxelOffsetY = lvc->VoxelOffsetY() * CLHEP::cm;
+    G4double const voxelOffsetZ = lvc->VoxelOffsetZ() * CLHEP::cm;
+
+    MF_LOG_DEBUG("LArVoxelReadoutGeometry")
+      << ": voxelSizeX=" << voxelSizeX << ", voxelSizeY=" << voxelSizeY
+      << ", voxelSizeZ=" << voxelSizeZ;
+
+    MF_LOG_DEBUG("LArVoxelReadoutGeometry")
+      << ": voxelOffsetX=" << voxelOffsetX << ", voxelOffsetY=" << voxelOffsetY
+      << ", voxelOffsetZ=" << voxelOffsetZ;
+
+    // next get the cryostats, all at once
+    auto const cryostats = this->FindNestedVolumes(
+      detEnclosureVolume, detEnclosureTransform, "volCryostat", fGeo->Ncryostats());
+
     for (unsigned int c = 0; c < fGeo->Ncryostats(); ++c) {
 
-      // next get the cryostat
-      daughterName = "volCryostat";
-      G4Transform3D cryostatTransform;
-      G4VPhysicalVolume* cryostatVolume = this->FindNestedVolume(
-        detEnclosureVolume, detEnclosureTransform, cryostatTransform, daughterName, c);
+      G4VPhysicalVolume* cryostatVolume = cryostats[c].first;
+      G4Transform3D const& cryostatTransform = cryostats[c].second;
+
+      // now for the TPCs: finding each of them in turn would scan all the
+      // cryostat volumes each time
+      auto const tpcs = this->FindNestedVolumes(
+        cryostatVolume, cryostatTransform, "volTPC", fGeo->Cryostat(c).NTPC());
 
       for (unsigned int t = 0; t < fGeo->Cryostat(c).NTPC(); ++t) {
 
-        // now for the TPC
-        daughterName = "volTPC";
-        G4Transform3D tpcTransform;
-        G4VPhysicalVolume* tpcVolume =
-          this->FindNestedVolume(cryostatVolume, cryostatTransform, tpcTransform, daughterName, t);
+        G4VPhysicalVolume* tpcVolume = tpcs[t].first;
+        G4Transform3D tpcTransform = tpcs[t].second;
 
         daughterName = "volTPCActive";
         G4Transform3D transform;
@@ -258,24 +279,6 @@ namespace larg4 {
                                                 << ": larTPCHalfYLength=" << larTPCHalfYLength
                                                 << ": larTPCHalfZLength=" << larTPCHalfZLength;
 
-        // Get some constants from the LAr voxel information object.
-        // Remember, ROOT uses cm.
-        art::ServiceHandle<sim::LArVoxelCalculator const> lvc;
-        G4double voxelSizeX = lvc->VoxelSizeX() * CLHEP::cm;
-        G4double voxelSizeY = lvc->VoxelSizeY() * CLHEP::cm;
-        G4double voxelSizeZ = lvc->VoxelSizeZ() * CLHEP::cm;
-        G4double voxelOffsetX = lvc->VoxelOffsetX() * CLHEP::cm;
-        G4double voxelOffsetY = lvc->VoxelOffsetY() * CLHEP::cm;
-        G4double voxelOffsetZ = lvc->VoxelOffsetZ() * CLHEP::cm;
-
-        MF_LOG_DEBUG("LArVoxelReadoutGeometry")
-          << ": voxelSizeX=" << voxelSizeX << ", voxelSizeY=" << voxelSizeY
-          << ", voxelSizeZ=" << voxelSizeZ;
-
-        MF_LOG_DEBUG("LArVoxelReadoutGeometry")
-          << ": voxelOffsetX=" << voxelOffsetX << ", voxelOffsetY=" << voxelOffsetY
-          << ", voxelOffsetZ=" << voxelOffsetZ;
-
         // We want our voxelization region to be an integer multiple of
         // the voxel sizes in all directions; if we didn't do this, we
         // might get into trouble when we start playing with replicas.
@@ -498,4 +501,56 @@ namespace larg4 {
     return 0;
   }
 
+  //---------------------------------------------------------------
+  // Same as FindNestedVolume() for volumes numbered 0 to nExpected - 1,
+  // with a single pass on the daughters of the mother volume; for each
+  // number, the first daughter with that number is chosen, as there.
+  std::vector<std::pair<G4VPhysicalVolume*, G4Transform3D>>
+  LArVoxelReadoutGeometry::FindNestedVolumes(G4VPhysicalVolume* mother,
+                                             G4Transform3D const& motherTransform,
+                                             std::string const& daughterName,
+                                             unsigned int nExpected)
+  {
+    std::vector<std::pair<G4VPhysicalVolume*, G4Transform3D>> daughters(nExpected);
+    unsigned int nFound = 0;
+
+    G4LogicalVolume* logicalVolume = mother->GetLogicalVolume();
+    G4int numberDaughters = logicalVolume->GetNoDaughters();
+    for (G4int i = 0; i != numberDaughters && nFound < nExpected; ++i) {
+      G4VPhysicalVolume* d = logicalVolume->GetDaughter(i);
+
+      if (!d->GetName().contains(daughterName)) continue;
+
+      G4Transform3D const daughterTransform =
+        motherTransform * G4Transform3D(d->GetObjectRotationValue(), d->GetObjectTranslation());
+
+      // take the origin of the volume and transform it to world coordinates
+      // (G4 uses mm, we want cm)
+      G4Point3D world = daughterTransform * G4Point3D(0., 0., 0.);
+      double worldPos[3] = {world.x() / CLHEP::cm, world.y() / CLHEP::cm, world.z() / CLHEP::cm};
+      unsigned int daughterNum = 0;
+      unsigned int extra = 0;
+      if (daughterName.compare("volCryostat") == 0)
+        fGeo->PositionToCryostat(worldPos, daughterNum);
+      else
+        fGeo->PositionToTPC(worldPos, daughterNum, extra);
+
+      if (daughterNum >= nExpected || daughters[daughterNum].first) continue;
+
+      MF_LOG_DEBUG("LArVoxelReadoutGeometry")
+        << "found the desired " << daughterName << " #" << daughterNum << " at ("
+        << worldPos[0] << "," << worldPos[1] << "," << worldPos[2] << ")";
+      daughters[daughterNum] = {d, daughterTransform};
+      ++nFound;
+    } // end loop over volumes
+
+    if (nFound < nExpected) {
+      throw cet::exception("LArVoxelReadoutGeometry")
+        << "could not find all the " << nExpected << " desired " << daughterName
+        << " (only " << nFound << ") to make LArVoxelReadoutGeometry\n";
+    }
+
+    return daughters;
+  }
+
 } // namespace larg4
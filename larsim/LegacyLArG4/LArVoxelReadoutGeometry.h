@@ -33,6 +33,11 @@
 #include "larcore/Geometry/Geometry.h"
 #include "larsim/LegacyLArG4/LArVoxelReadout.h"
 
+// C/C++ standard libraries
+#include <string>
+#include <utility> // std::pair
+#include <vector>
+
 // Forward declarations
 class G4PhysicalVolume;
 
@@ -68,6 +73,14 @@ namespace larg4 {
                                         std::string& daughterName,
                                         unsigned int expectedNum);
 
+    /// Returns the daughters of `mother` named like `daughterName` with
+    /// numbers `0` to `nExpected - 1`, and their total transforms.
+    std::vector<std::pair<G4VPhysicalVolume*, G4Transform3D>> FindNestedVolumes(
+      G4VPhysicalVolume* mother,
+      G4Transform3D const& motherTransform,
+      std::string const& daughterName,
+      unsigned int nExpected);
+
     art::ServiceHandle<geo::Geometry const> fGeo; ///< Handle to the geometry
     std::unique_ptr<G4UserLimits> fStepLimit;     ///< G4 doesn't handle memory management,
                                                   ///< so we have to
@@ -23,22 +23,26 @@
 
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
+#include <utility> // std::move()
+
 namespace larg4 {
 
   //----------------------------------------------
   void
-  MaterialPropertyLoader::SetMaterialProperty(std::string Material,
-                                              std::string Property,
-                                              std::map<double, double> PropertyVector,
+  MaterialPropertyLoader::SetMaterialProperty(std::string const& Material,
+                                              std::string const& Property,
+                                              std::map<double, double> const& PropertyVector,
                                               double Unit)
   {
+    // energies keep their order: each point is appended at the end
     std::map<double, double> PropVectorWithUnit;
     for (std::map<double, double>::const_iterator it = PropertyVector.begin();
          it != PropertyVector.end();
          it++) {
-      PropVectorWithUnit[it->first * CLHEP::eV] = it->second * Unit;
+      PropVectorWithUnit.emplace_hint(
+        PropVectorWithUnit.end(), it->first * CLHEP::eV, it->second * Unit);
     }
-    fPropertyList[Material][Property] = PropVectorWithUnit;
+    fPropertyList[Material][Property] = std::move(PropVectorWithUnit);
     // replace with MF_LOGDEBUG()
     mf::LogInfo("MaterialPropertyLoader") << "Added property " << Material << "  " << Property;
   }
@@ -113,6 +117,8 @@ namespace larg4 {
         std::string Property = j->first;
         std::vector<G4double> g4MomentumVector;
         std::vector<G4double> g4PropertyVector;
+        g4MomentumVector.reserve(j->second.size());
+        g4PropertyVector.reserve(j->second.size());
 
         for (std::map<double, double>::const_iterator k = j->second.begin(); k != j->second.end();
              k++) {
@@ -158,9 +164,13 @@ namespace larg4 {
       //
 
       //--------------------------> FIXME <-----------------(parameters from fcl files(?))
+      // materials without a table of their own get their table reset
+      G4MaterialPropertiesTable* MaterialTable = nullptr;
+      auto const iTable = MaterialTables.find(Material);
+      if (iTable != MaterialTables.end()) MaterialTable = iTable->second;
+
       G4MaterialPropertyVector* PropertyPointer = 0;
-      if (MaterialTables[Material])
-        PropertyPointer = MaterialTables[Material]->GetProperty("REFLECTIVITY");
+      if (MaterialTable) PropertyPointer = MaterialTable->GetProperty("REFLECTIVITY");
 
       if (Material == "Copper") {
         std::cout << "copper foil surface set " << volume->GetName() << std::endl;
@@ -168,7 +178,7 @@ namespace larg4 {
           std::cout << "defining Copper optical boundary " << std::endl;
           G4OpticalSurface* refl_opsurfc =
             new G4OpticalSurface("Surface copper", glisur, ground, dielectric_metal);
-          refl_opsurfc->SetMaterialPropertiesTable(MaterialTables[Material]);
+          refl_opsurfc->SetMaterialPropertiesTable(MaterialTable);
           refl_opsurfc->SetPolish(0.2);
           new G4LogicalSkinSurface("refl_surfacec", volume, refl_opsurfc);
         }
@@ -183,7 +193,7 @@ namespace larg4 {
           std::cout << "defining G10 optical boundary " << std::endl;
           G4OpticalSurface* refl_opsurfg =
             new G4OpticalSurface("g10 Surface", glisur, ground, dielectric_metal);
-          refl_opsurfg->SetMaterialPropertiesTable(MaterialTables[Material]);
+          refl_opsurfg->SetMaterialPropertiesTable(MaterialTable);
           refl_opsurfg->SetPolish(0.1);
           new G4LogicalSkinSurface("refl_surfaceg", volume, refl_opsurfg);
         }
@@ -198,7 +208,7 @@ namespace larg4 {
           std::cout << "defining vm2000 optical boundary " << std::endl;
           G4OpticalSurface* refl_opsurf = new G4OpticalSurface(
             "Reflector Surface", unified, groundfrontpainted, dielectric_dielectric);
-          refl_opsurf->SetMaterialPropertiesTable(MaterialTables[Material]);
+          refl_opsurf->SetMaterialPropertiesTable(MaterialTable);
           G4double sigma_alpha = 0.8;
           refl_opsurf->SetSigmaAlpha(sigma_alpha);
           new G4LogicalSkinSurface("refl_surface", volume, refl_opsurf);
@@ -213,7 +223,7 @@ namespace larg4 {
           std::cout << "defining ALUMINUM_Al optical boundary " << std::endl;
           G4OpticalSurface* refl_opsurfs =
             new G4OpticalSurface("Surface Aluminum", glisur, ground, dielectric_metal);
-          refl_opsurfs->SetMaterialPropertiesTable(MaterialTables[Material]);
+          refl_opsurfs->SetMaterialPropertiesTable(MaterialTable);
           refl_opsurfs->SetPolish(0.5);
           new G4LogicalSkinSurface("refl_surfaces", volume, refl_opsurfs);
         }
@@ -227,7 +237,7 @@ namespace larg4 {
           std::cout << "defining STEEL_STAINLESS_Fe7Cr2Ni optical boundary " << std::endl;
           G4OpticalSurface* refl_opsurfs =
             new G4OpticalSurface("Surface Steel", glisur, ground, dielectric_metal);
-          refl_opsurfs->SetMaterialPropertiesTable(MaterialTables[Material]);
+          refl_opsurfs->SetMaterialPropertiesTable(MaterialTable);
           refl_opsurfs->SetPolish(0.5);
           new G4LogicalSkinSurface("refl_surfaces", volume, refl_opsurfs);
         }
@@ -241,42 +251,27 @@ namespace larg4 {
       //
       // apply the remaining material properties
       //
-      for (std::map<std::string, G4MaterialPropertiesTable*>::const_iterator j =
-             MaterialTables.begin();
-           j != MaterialTables.end();
-           j++) {
-        if (Material == j->first) {
-          TheMaterial->SetMaterialPropertiesTable(j->second);
-          //Birks Constant, for some reason, must be set separately
-          if (fBirksConstants[Material] != 0)
-            TheMaterial->GetIonisation()->SetBirksConstant(fBirksConstants[Material]);
-          volume->SetMaterial(TheMaterial);
-        }
-      }
+      TheMaterial->SetMaterialPropertiesTable(MaterialTable);
+      //Birks Constant, for some reason, must be set separately
+      auto const iBirks = fBirksConstants.find(Material);
+      if (iBirks != fBirksConstants.end() && iBirks->second != 0)
+        TheMaterial->GetIonisation()->SetBirksConstant(iBirks->second);
+      volume->SetMaterial(TheMaterial);
     }
   }
 
   void
   MaterialPropertyLoader::SetReflectances(
-    std::string /*Material*/,
-    std::map<std::string, std::map<double, double>> Reflectances,
-    std::map<std::string, std::map<double, double>> DiffuseFractions)
+    std::string const& /*Material*/,
+    std::map<std::string, std::map<double, double>> const& Reflectances,
+    std::map<std::string, std::map<double, double>> const& DiffuseFractions)
   {
-    std::map<double, double> ReflectanceToStore;
-    std::map<double, double> DiffuseToStore;
-
     for (std::map<std::string, std::map<double, double>>::const_iterator itMat =
            Reflectances.begin();
          itMat != Reflectances.end();
          ++itMat) {
       std::string ReflectancePropName = std::string("REFLECTANCE_") + itMat->first;
-      ReflectanceToStore.clear();
-      for (std::map<double, double>::const_iterator itEn = itMat->second.begin();
-           itEn != itMat->second.end();
-           ++itEn) {
-        ReflectanceToStore[itEn->first] = itEn->second;
-      }
-      SetMaterialProperty("LAr", ReflectancePropName, ReflectanceToStore, 1);
+      SetMaterialProperty("LAr", ReflectancePropName, itMat->second, 1);
     }
 
     for (std::map<std::string, std::map<double, double>>::const_iterator itMat =
@@ -284,33 +279,19 @@ namespace larg4 {
          itMat != DiffuseFractions.end();
          ++itMat) {
       std::string DiffusePropName = std::string("DIFFUSE_REFLECTANCE_FRACTION_") + itMat->first;
-      DiffuseToStore.clear();
-      for (std::map<double, double>::const_iterator itEn = itMat->second.begin();
-           itEn != itMat->second.end();
-           ++itEn) {
-        DiffuseToStore[itEn->first] = itEn->second;
-      }
-      SetMaterialProperty("LAr", DiffusePropName, DiffuseToStore, 1);
+      SetMaterialProperty("LAr", DiffusePropName, itMat->second, 1);
     }
   }
 
   void
   MaterialPropertyLoader::SetReflectances(
-    std::map<std::string, std::map<double, double>> Reflectances)
+    std::map<std::string, std::map<double, double>> const& Reflectances)
   {
-    std::map<double, double> ReflectanceToStore;
-
     for (std::map<std::string, std::map<double, double>>::const_iterator itMat =
            Reflectances.begin();
          itMat != Reflectances.end();
          ++itMat) {
-      ReflectanceToStore.clear();
-      for (std::map<double, double>::const_iterator itEn = itMat->second.begin();
-           itEn != itMat->second.end();
-           ++itEn) {
-        ReflectanceToStore[itEn->first] = itEn->second;
-      }
-      SetMaterialProperty(itMat->first, "REFLECTIVITY", ReflectanceToStore, 1);
+      SetMaterialProperty(itMat->first, "REFLECTIVITY", itMat->second, 1);
     }
   }
 
@@ -97,10 +97,9 @@ namespace larg4 {
      * The table of values is in form of (`energy`, `value`) pairs, where
      * `value` is measured in `Units` and `energy` is measured in electronvolt.
      */
-    // TODO turn arguments into constant references
-    void SetMaterialProperty(std::string Material,
-                             std::string Property,
-                             std::map<double, double> Values,
+    void SetMaterialProperty(std::string const& Material,
+                             std::string const& Property,
+                             std::map<double, double> const& Values,
                              double Unit);
 
     /**
@@ -134,12 +133,10 @@ namespace larg4 {
     /**
      * @brief
      */
-    // TODO turn the arguments into constant references (using type aliases)
-    void SetReflectances(std::string,
-                         std::map<std::string, std::map<double, double>>,
-                         std::map<std::string, std::map<double, double>>);
-    // TODO turn the argument into constant reference (using type aliases)
-    void SetReflectances(std::map<std::string, std::map<double, double>>);
+    void SetReflectances(std::string const&,
+                         std::map<std::string, std::map<double, double>> const&,
+                         std::map<std::string, std::map<double, double>> const&);
+    void SetReflectances(std::map<std::string, std::map<double, double>> const&);
 
     /// @}
     // --- END Setting of specific properties ----------------------------------
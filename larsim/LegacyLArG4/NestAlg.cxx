@@ -34,8 +34,6 @@
 #include "larsim/LegacyLArG4/NestAlg.h"
 #include "larsim/LegacyLArG4/G4ThermalElectron.hh"
 
-#include "CLHEP/Random/RandGauss.h"
-#include "CLHEP/Random/RandFlat.h"
 
 G4bool diffusion = true;
 
@@ -52,13 +50,11 @@ NestAlg::NestAlg(CLHEP::HepRandomEngine& engine)
   , fNumScintPhotons(0)
   , fNumIonElectrons(0)
   , fEnergyDep(0.)
+  , fElementPropInit{} // no noble element material property initialized
   , fEngine(engine)
+  , fGaussGen(engine)
+  , fUniformGen(engine)
 {
-  fElementPropInit[2] = false;
-  fElementPropInit[10] = false;
-  fElementPropInit[18] = false;
-  fElementPropInit[36] = false;
-  fElementPropInit[54] = false;
 }
 
 //----------------------------------------------------------------------------
@@ -68,21 +64,21 @@ NestAlg::NestAlg(double yieldFactor, CLHEP::HepRandomEngine& engine)
   , fNumScintPhotons(0)
   , fNumIonElectrons(0)
   , fEnergyDep(0.)
+  , fElementPropInit{} // no noble element material property initialized
   , fEngine(engine)
+  , fGaussGen(engine)
+  , fUniformGen(engine)
 {
-  fElementPropInit[2] = false;
-  fElementPropInit[10] = false;
-  fElementPropInit[18] = false;
-  fElementPropInit[36] = false;
-  fElementPropInit[54] = false;
 }
 
 //----------------------------------------------------------------------------
 const G4VParticleChange& NestAlg::CalculateIonizationAndScintillation(G4Track const& aTrack,
 								      G4Step  const& aStep)
 {
-  CLHEP::RandGauss GaussGen(fEngine);
-  CLHEP::RandFlat  UniformGen(fEngine);
+  // the distributions live as long as the algorithm: constructing them on
+  // each step was a measurable part of its cost
+  CLHEP::RandGauss& GaussGen   = fGaussGen;
+  CLHEP::RandFlat&  UniformGen = fUniformGen;
 
 
   // reset the variables accessed by other objects
@@ -112,7 +108,7 @@ const G4VParticleChange& NestAlg::CalculateIonizationAndScintillation(G4Track co
 
   const G4DynamicParticle* aParticle = aTrack.GetDynamicParticle();
   G4ParticleDefinition *pDef = aParticle->GetDefinition();
-  G4String particleName = pDef->GetParticleName();
+  G4String const& particleName = pDef->GetParticleName();
   const G4Material* aMaterial = aStep.GetPreStepPoint()->GetMaterial();
   const G4Material* bMaterial = aStep.GetPostStepPoint()->GetMaterial();
 
@@ -1187,8 +1183,8 @@ G4double NestAlg::CalculateElectronLET ( G4double E, G4int Z ) {
 
 //----------------------------------------------------------------------------
 G4int NestAlg::BinomFluct ( G4int N0, G4double prob ) {
-  CLHEP::RandGauss GaussGen(fEngine);
-  CLHEP::RandFlat  UniformGen(fEngine);
+  CLHEP::RandGauss& GaussGen   = fGaussGen;
+  CLHEP::RandFlat&  UniformGen = fUniformGen;
 
   G4double mean = N0*prob;
   G4double sigma = sqrt(N0*prob*(1-prob));
@@ -3,14 +3,14 @@
 
 #include "Geant4/G4Types.hh"
 #include "Geant4/G4VParticleChange.hh"
-#include <map>
+#include "CLHEP/Random/RandGauss.h"
+#include "CLHEP/Random/RandFlat.h"
+#include <array>
 
 class G4MaterialPropertiesTable;
 class G4Step;
 class G4Track;
 
-namespace CLHEP { class HepRandomEngine; }
-
 class NestAlg {
 
  public :
@@ -43,10 +43,12 @@ class NestAlg {
   int    	     fNumIonElectrons; ///< number of ionization electrons produced by step
   double 	     fEnergyDep;       ///< energy deposited by the step
   G4VParticleChange  fParticleChange;  ///< pointer to G4VParticleChange
-  std::map<int,bool> fElementPropInit; ///< map of noble element z to flag
+  std::array<bool, 55> fElementPropInit; ///< flag by noble element z
                                        ///< for whether that element's material
                                        ///< properties table has been initialized
   CLHEP::HepRandomEngine& fEngine;     ///< random engine
+  CLHEP::RandGauss   fGaussGen;        ///< Gaussian distribution, kept for all steps
+  CLHEP::RandFlat    fUniformGen;      ///< uniform distribution, kept for all steps
 };
 
 #endif //NESTALG_H
@@ -47,8 +47,14 @@ namespace larg4 {
   //--------------------------------------------------
   int OpDetLookup::GetOpDet(G4VPhysicalVolume* TheVolume)
   {
+    auto const iOpDet = fTheVolumeOpDetMap.find(TheVolume);
+    if (iOpDet != fTheVolumeOpDetMap.end()) return iOpDet->second;
+
+    // not a volume we placed: look it up by name, once
     std::string TheName = TheVolume->GetName();
-    return GetOpDet(TheName);
+    int const OpDet = GetOpDet(TheName);
+    fTheVolumeOpDetMap[TheVolume] = OpDet;
+    return OpDet;
   }
 
 
@@ -108,6 +114,7 @@ namespace larg4 {
     volume->SetName(VolName.str().c_str());
 
     fTheOpDetMap[VolName.str()] = NearestOpDet;
+    fTheVolumeOpDetMap[volume] = NearestOpDet;
 
     // mf::LogInfo("Optical") << "Found closest volume: " << VolName.str().c_str() << " OpDet : " << fTheOpDetMap[VolName.str()]<<"  distance : " <<Distance<<std::endl;
 
@@ -26,7 +26,9 @@
 //
 // It is then renamed accordingly and the link between the two objects
 // is stored in a map<string, int> which relates the new G4 name
-// to a detector number in the geometry.
+// to a detector number in the geometry. The volume itself is also
+// stored in a hash map to its detector number, so that the lookup of
+// each hit does not need to build and compare names.
 //
 //
 // Ben Jones, MIT, 06/04/2010
@@ -37,6 +39,7 @@
 
 #include <map>
 #include <string>
+#include <unordered_map>
 
 class G4VPhysicalVolume;
 
@@ -58,6 +61,7 @@ namespace larg4 {
 
     private:
       std::map<std::string, int> fTheOpDetMap;
+      std::unordered_map<G4VPhysicalVolume const*, int> fTheVolumeOpDetMap;
       int fTheTopOpDet;
 
     };
@@ -16,8 +16,27 @@
 
 #include "lardataobj/Simulation/SimEnergyDeposit.h"
 
+#include <atomic>
+#include <iterator>  // std::move_iterator
+#include <memory>
+#include <mutex>
+
+namespace {
+
+  /// All the tables, one per thread, and the lock protecting their list.
+  std::mutex gOpDetPhotonTablesMutex;
+  std::vector<std::unique_ptr<larg4::OpDetPhotonTable>> gOpDetPhotonTables;
+
+  /// Number of channels of the tables (from the last `ClearThreadTables()`).
+  std::size_t gOpDetPhotonTablesChannels = 0;
+
+  /// Light source of the interaction being tracked, shared by all threads.
+  std::atomic<int> gCurrentLightSource{-1};
+
+} // local namespace
+
 namespace larg4 {
-  OpDetPhotonTable * TheOpDetPhotonTable;
+  thread_local OpDetPhotonTable * TheOpDetPhotonTable = nullptr;
 
   //--------------------------------------------------
   OpDetPhotonTable::OpDetPhotonTable()
@@ -32,11 +51,75 @@ namespace larg4 {
   OpDetPhotonTable * OpDetPhotonTable::Instance(bool /*LitePhotons*/ )
   {
     if(!TheOpDetPhotonTable){
-      TheOpDetPhotonTable = new OpDetPhotonTable;
+      std::lock_guard<std::mutex> lock(gOpDetPhotonTablesMutex);
+      gOpDetPhotonTables.emplace_back(new OpDetPhotonTable);
+      TheOpDetPhotonTable = gOpDetPhotonTables.back().get();
+      // a thread joining in the middle of an event gets a ready table
+      TheOpDetPhotonTable->ClearTable(gOpDetPhotonTablesChannels);
     }
     return TheOpDetPhotonTable;
   }
 
+  //--------------------------------------------------
+  void OpDetPhotonTable::ClearThreadTables(size_t nch)
+  {
+    std::lock_guard<std::mutex> lock(gOpDetPhotonTablesMutex);
+    gOpDetPhotonTablesChannels = nch;
+    for(auto& table: gOpDetPhotonTables) table->ClearTable(nch);
+  }
+
+  //--------------------------------------------------
+  void OpDetPhotonTable::ClearThreadEnergyDeposits()
+  {
+    std::lock_guard<std::mutex> lock(gOpDetPhotonTablesMutex);
+    for(auto& table: gOpDetPhotonTables) table->ClearEnergyDeposits();
+  }
+
+  //--------------------------------------------------
+  void OpDetPhotonTable::Merge(OpDetPhotonTable& other)
+  {
+    if (&other == this) return;
+    for (bool const Reflected: { false, true }) {
+      std::vector<sim::SimPhotons>& photons = Reflected ? fReflectedDetectedPhotons : fDetectedPhotons;
+      std::vector<sim::SimPhotons>& otherPhotons = Reflected ? other.fReflectedDetectedPhotons : other.fDetectedPhotons;
+      if (photons.size() < otherPhotons.size()) {
+        size_t const n = photons.size();
+        photons.resize(otherPhotons.size());
+        for(size_t i = n; i < photons.size(); ++i) photons[i].SetChannel(i);
+      }
+      for(size_t i = 0; i < otherPhotons.size(); ++i) {
+        photons[i].insert(photons[i].end(),
+          std::move_iterator{otherPhotons[i].begin()}, std::move_iterator{otherPhotons[i].end()});
+      }
+
+      LiteTable(Reflected).merge(other.LiteTable(Reflected));
+
+      BTRs(Reflected).merge(other.BTRs(Reflected));
+
+      auto& counts = fLightSourceCounts[Reflected];
+      auto& otherCounts = other.fLightSourceCounts[Reflected];
+      if (counts.size() < otherCounts.size()) counts.resize(otherCounts.size());
+      for(size_t s = 0; s < otherCounts.size(); ++s) {
+        if (counts[s].size() < otherCounts[s].size()) counts[s].resize(otherCounts[s].size(), 0U);
+        for(size_t i = 0; i < otherCounts[s].size(); ++i) counts[s][i] += otherCounts[s][i];
+      }
+    } // for direct and reflected
+
+    for (auto& [ volumeName, edeps ]: other.YieldSimEnergyDeposits()) {
+      auto& destColl = fSimEDepCol[volumeName];
+      destColl.insert(destColl.end(), std::move_iterator{edeps.begin()}, std::move_iterator{edeps.end()});
+    }
+
+    other.ClearTable(other.fDetectedPhotons.size());
+  }
+
+  //--------------------------------------------------
+  void OpDetPhotonTable::MergeThreadTables()
+  {
+    std::lock_guard<std::mutex> lock(gOpDetPhotonTablesMutex);
+    for(auto& table: gOpDetPhotonTables) Merge(*table);
+  }
+
 
 
   //--------------------------------------------------
@@ -60,10 +143,7 @@ namespace larg4 {
   //--------------------------------------------------
   void OpDetPhotonTable::AddLitePhoton( int opchannel, int time, int nphotons, bool Reflected)
   {
-    if (!Reflected)
-      fLitePhotons[opchannel][time] += nphotons;
-    else
-      fReflectedLitePhotons[opchannel][time] += nphotons;
+    LiteTable(Reflected).add(opchannel, time, nphotons);
   }
 
   //--------------------------------------------------
@@ -72,82 +152,61 @@ namespace larg4 {
     for(auto it = StepPhotonTable->begin(); it!=StepPhotonTable->end(); it++)
     {
       for(auto in_it = it->second.begin(); in_it!=it->second.end(); in_it++)
-      {
-        if (!Reflected)
-          fLitePhotons[it->first][in_it->first]+= in_it->second;
-        else
-          fReflectedLitePhotons[it->first][in_it->first]+= in_it->second;
-      }
+        AddLitePhoton(it->first, in_it->first, in_it->second, Reflected);
     }
   }
 
+  //--------------------------------------------------
+  void OpDetPhotonTable::SetCurrentLightSource(int source)
+  {
+    gCurrentLightSource = source;
+  }
+
+  //--------------------------------------------------
+  void OpDetPhotonTable::AddLightSourcePhoton(size_t opchannel, bool Reflected)
+  {
+    int const source = gCurrentLightSource;
+    if (source < 0) return;
+    auto& counts = fLightSourceCounts[Reflected];
+    if (counts.size() <= size_t(source)) counts.resize(source + 1);
+    auto& sourceCounts = counts[source];
+    if (sourceCounts.size() <= opchannel) sourceCounts.resize(opchannel + 1, 0U);
+    ++sourceCounts[opchannel];
+  }
+
+  //--------------------------------------------------
+  std::vector<std::vector<unsigned int>> OpDetPhotonTable::YieldLightSourceCounts(bool Reflected)
+  {
+    auto counts { std::move(fLightSourceCounts[Reflected]) };
+    fLightSourceCounts[Reflected].clear();
+    return counts;
+  }
+
   //--------------------------------------------------- cOpDetBacktrackerRecord population
   //J Stock. 11 Oct 2016
   void OpDetPhotonTable::AddOpDetBacktrackerRecord(sim::OpDetBacktrackerRecord soc, bool Reflected){
-//    std::cout << "DEBUG: Adding to " << (Reflected?"Reflected":"Direct") << " cOpDetBTR" << std::endl;
-    if (!Reflected)
-      AddOpDetBacktrackerRecord(cOpDetBacktrackerRecordsCol, cOpChannelToSOCMap, soc);
-    else
-      AddOpDetBacktrackerRecord(cReflectedOpDetBacktrackerRecordsCol, cReflectedOpChannelToSOCMap, soc);
+    BTRs(Reflected).addRecord(soc);
   }
 
   //--------------------------------------------------- cOpDetBacktrackerRecord population
-  void OpDetPhotonTable::AddOpDetBacktrackerRecord(std::vector< sim::OpDetBacktrackerRecord > & RecordsCol,
-                                                   std::map<int, int> & ChannelMap,
-                                                   sim::OpDetBacktrackerRecord soc) {
-    int iChan = soc.OpDetNum();
-    std::map<int, int>::iterator channelPosition = ChannelMap.find(iChan);
-    if (channelPosition == ChannelMap.end() ){
-      ChannelMap[iChan] = RecordsCol.size();
-      RecordsCol.emplace_back(std::move(soc));
-    }else{
-      unsigned int idtest = channelPosition->second;
-      auto const& timePDclockSDPsMap = soc.timePDclockSDPsMap();
-      for(auto const& timePDclockSDP : timePDclockSDPsMap){
-        for(auto const& sdp : timePDclockSDP.second){
-          double xyz[3] = {sdp.x, sdp.y, sdp.z};
-          RecordsCol.at(idtest).AddScintillationPhotons(
-              sdp.trackID,
-              timePDclockSDP.first,
-              sdp.numPhotons,
-              xyz,
-              sdp.energy);
-        }//end sdp : timesdp.second
-      }//end const timesdp : timeSDPMap
-    }// if chanPos == cOpChan else
-
-
-//    std::cout << "DEBUG: Add to " << iChan << " to cOpDetBTR. Now " << RecordsCol.size() << " in size " << std::endl;
-  }//END void OpDetPhotonTable::AdOpDetBacktrackerRecords
+  void OpDetPhotonTable::AddOpDetBacktrackerPhotons(int opchannel, int trackID, double time, double nphotons,
+                                                    double const* xyz, double energy, bool Reflected){
+    BTRs(Reflected).addPhotons(opchannel, trackID, time, nphotons, xyz, energy);
+  }
 
 
   //--------------------------------------------------
   // cOpDetBacktrackerRecord return.
   std::vector<sim::OpDetBacktrackerRecord> OpDetPhotonTable::YieldOpDetBacktrackerRecords() {
     // we give the result to the caller, and don't retain it
-    std::vector<sim::OpDetBacktrackerRecord> result;
-//    std::cout << "DEBUG: result.size()       = " << result.size() << std::endl;
-//    std::cout << "DEBUG: cOpDetBTRCol.size() = " << cOpDetBacktrackerRecordsCol.size() << std::endl;
-    std::swap(result, cOpDetBacktrackerRecordsCol);
-//    std::cout << "DEBUG: std::swap(result, cOpDetBacktrackerRecordsCol);" << std::endl;
-//    std::cout << "DEBUG: result.size()       = " << result.size() << std::endl;
-//    std::cout << "DEBUG: cOpDetBTRCol.size() = " << cOpDetBacktrackerRecordsCol.size() << std::endl;
-    cOpChannelToSOCMap.clear();
-    return result;
+    return fBTRs.yield();
   } // OpDetPhotonTable::YieldOpDetBacktrackerRecords()
 
   //--------------------------------------------------
   // cReflectedOpDetBacktrackerRecord return.
   std::vector<sim::OpDetBacktrackerRecord> OpDetPhotonTable::YieldReflectedOpDetBacktrackerRecords() {
     // we give the result to the caller, and don't retain it
-    std::vector<sim::OpDetBacktrackerRecord> result;
-//    std::cout << "DEBUG: result.size()           = " << result.size() << std::endl;
-//    std::cout << "DEBUG: cReflOpDetBTRCol.size() = " << cReflectedOpDetBacktrackerRecordsCol.size() << std::endl;
-    std::swap(result, cReflectedOpDetBacktrackerRecordsCol);
-//    std::cout << "DEBUG: result.size()           = " << result.size() << std::endl;
-//    std::cout << "DEBUG: cReflOpDetBTRCol.size() = " << cReflectedOpDetBacktrackerRecordsCol.size() << std::endl;
-    cReflectedOpChannelToSOCMap.clear();
-    return result;
+    return fReflectedBTRs.yield();
   } // OpDetPhotonTable::YieldOpDetBacktrackerRecords()
 
 
@@ -167,12 +226,38 @@ namespace larg4 {
       //fDetectedPhotons.at(i).reserve(10000); // Just a guess on minimum # photons
     }
 
-    for(auto it=fLitePhotons.begin(); it!=fLitePhotons.end(); ++it)
-      (it->second).clear();
-    for(auto it=fReflectedLitePhotons.begin(); it!=fReflectedLitePhotons.end(); ++it)
-      (it->second).clear();
-    fLitePhotons.clear();
-    fReflectedLitePhotons.clear();
+    // the channel histograms are kept with their memory for the next event
+    for (bool const Reflected: { false, true }) {
+      LiteTable(Reflected).clear();
+      fLightSourceCounts[Reflected].clear();
+    }
+  }
+
+  //--------------------------------------------------
+  std::map<int, std::map<int, int> > OpDetPhotonTable::GetLitePhotons(bool Reflected) const
+  {
+    return LiteTable(Reflected).toMaps();
+  }
+
+  //--------------------------------------------------
+  std::map<int, int> OpDetPhotonTable::LitePhotonsForOpChannel(int opchannel, bool Reflected) const
+  {
+    return LiteTable(Reflected).counts(opchannel);
+  }
+
+  //--------------------------------------------------
+  std::map<int, int> OpDetPhotonTable::GetLitePhotonsForOpChannel(int opchannel) const
+  { return LitePhotonsForOpChannel(opchannel, false); }
+
+  //--------------------------------------------------
+  std::map<int, int> OpDetPhotonTable::GetReflectedLitePhotonsForOpChannel(int opchannel) const
+  { return LitePhotonsForOpChannel(opchannel, true); }
+
+  //--------------------------------------------------
+  std::vector<sim::SimPhotonsLite> OpDetPhotonTable::YieldLitePhotons(bool Reflected)
+  {
+    // channels are returned sorted, as GetLitePhotons() would
+    return LiteTable(Reflected).yield();
   }
 
   //--------------------------------------------------
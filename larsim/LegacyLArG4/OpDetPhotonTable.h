@@ -27,6 +27,25 @@
 // The two sources can be distinguished by looking at the
 // SetInSD flag of the OnePhoton object.
 //
+// "Lite" photons (counts by channel and time) are accumulated in one
+// histogram per optical channel (see sim::SimPhotonsLiteBuilder). The
+// histograms are kept between events, and their content is moved out by
+// YieldLitePhotons().
+//
+// There is one table per thread: Instance() returns the one of the
+// calling thread, so that Geant4 worker threads fill their own tables
+// without locking; callers look the table up on each use rather than
+// keeping the pointer. ClearThreadTables() prepares the tables of all the
+// threads for a new event (and the ones created later are sized alike),
+// and the thread writing the event collects the content of all the others
+// with MergeThreadTables().
+//
+// Library build jobs shooting light from many voxels in the same event
+// (batched LightSource) also count the detected photons by light source:
+// LArG4 sets the source of the interaction being tracked with
+// SetCurrentLightSource(), and the photons reaching an optical detector are
+// counted under it by AddLightSourcePhoton().
+//
 // Ben Jones, MIT, 11/10/12
 //
 //
@@ -42,17 +61,36 @@
 #include "lardataobj/Simulation/OpDetBacktrackerRecord.h"
 #include "lardataobj/Simulation/SimEnergyDeposit.h"
 #include "lardataobj/Simulation/SimPhotons.h"
+#include "larsim/Simulation/OpDetBacktrackerRecordAccumulator.h"
+#include "larsim/Simulation/SimPhotonsLiteBuilder.h"
 
 namespace larg4 {
   class OpDetPhotonTable
     {
     public:
       ~OpDetPhotonTable();
+      /// Returns the table of the calling thread (created at the first call).
       static OpDetPhotonTable * Instance(bool LitePhotons = false);
 
+      /// Moves the content of `other` into this table, leaving `other` empty.
+      void Merge(OpDetPhotonTable& other);
+      /// Moves the content of the tables of all the other threads into this one.
+      void MergeThreadTables();
+      /// Clears the tables of all the threads, sized for `nch` optical channels.
+      static void ClearThreadTables(size_t nch);
+      /// Clears the energy deposits of the tables of all the threads.
+      static void ClearThreadEnergyDeposits();
+
       void AddPhoton( size_t opchannel, sim::OnePhoton&& photon, bool Reflected=false);
       void AddLitePhoton( int opchannel, int time, int nphotons, bool Reflected=false);
       void AddPhoton(std::map<int, std::map<int, int>>* StepPhotonTable, bool Reflected=false);
+
+      /// Sets the light source of the photons being tracked (`-1`: none).
+      static void SetCurrentLightSource(int source);
+      /// Counts a photon in `opchannel` under the current light source, if any.
+      void AddLightSourcePhoton(size_t opchannel, bool Reflected=false);
+      /// Returns the photon counts by light source and channel, and clears them from the table.
+      std::vector<std::vector<unsigned int>> YieldLightSourceCounts(bool Reflected=false);
       void AddLitePhotons(std::map<int, std::map<int, int>>* StepPhotonTable, bool Reflected=false) { AddPhoton(StepPhotonTable, Reflected); }
 
       std::vector<sim::SimPhotons >& GetPhotons(bool Reflected=false) { return (Reflected ? fReflectedDetectedPhotons : fDetectedPhotons); }
@@ -60,13 +98,20 @@ namespace larg4 {
       sim::SimPhotons&               GetPhotonsForOpChannel(size_t opchannel);
       sim::SimPhotons&               GetReflectedPhotonsForOpChannel(size_t opchannel);
 
-      std::map<int, std::map<int, int> >    GetLitePhotons(bool Reflected=false) { return (Reflected ? fReflectedLitePhotons : fLitePhotons ); }
-      std::map<int, std::map<int, int> >    GetReflectedLitePhotons()            { return GetLitePhotons(true); }
-      std::map<int, int>&                   GetLitePhotonsForOpChannel(int opchannel)          { return fLitePhotons[opchannel]; }
-      std::map<int, int>&                   GetReflectedLitePhotonsForOpChannel(int opchannel) { return fReflectedLitePhotons[opchannel]; }
+      /// Returns a copy of the lite photons, by channel and time.
+      std::map<int, std::map<int, int> >    GetLitePhotons(bool Reflected=false) const;
+      std::map<int, std::map<int, int> >    GetReflectedLitePhotons() const        { return GetLitePhotons(true); }
+      std::map<int, int>                    GetLitePhotonsForOpChannel(int opchannel) const;
+      std::map<int, int>                    GetReflectedLitePhotonsForOpChannel(int opchannel) const;
+      /// Returns the lite photons of all channels with photons, and clears them from the table.
+      std::vector<sim::SimPhotonsLite>      YieldLitePhotons(bool Reflected=false);
+      /// Clears the table, sized for `nch` optical channels.
       void ClearTable(size_t nch=0);
 
       void AddOpDetBacktrackerRecord(sim::OpDetBacktrackerRecord soc, bool Reflected=false);
+      /// Adds `nphotons` photons from `trackID` at `time` to the record of `opchannel`.
+      void AddOpDetBacktrackerPhotons(int opchannel, int trackID, double time, double nphotons,
+                                      double const* xyz, double energy, bool Reflected=false);
     //  std::vector<sim::OpDetBacktrackerRecord>& GetOpDetBacktrackerRecords(); //Replaced by YieldOpDetBacktrackerRecords()
       std::vector<sim::OpDetBacktrackerRecord> YieldOpDetBacktrackerRecords();
       std::vector<sim::OpDetBacktrackerRecord> YieldReflectedOpDetBacktrackerRecords();
@@ -91,19 +136,21 @@ namespace larg4 {
 
     private:
 
-      void AddOpDetBacktrackerRecord(std::vector< sim::OpDetBacktrackerRecord > & RecordsCol,
-                                     std::map<int, int> &ChannelMap,
-                                     sim::OpDetBacktrackerRecord soc);
+      sim::SimPhotonsLiteBuilder& LiteTable(bool Reflected) { return (Reflected ? fReflectedLitePhotons : fLitePhotons); }
+      sim::SimPhotonsLiteBuilder const& LiteTable(bool Reflected) const { return (Reflected ? fReflectedLitePhotons : fLitePhotons); }
+      std::map<int, int> LitePhotonsForOpChannel(int opchannel, bool Reflected) const;
+
+      sim::OpDetBacktrackerRecordAccumulator& BTRs(bool Reflected) { return (Reflected ? fReflectedBTRs : fBTRs); }
 
 
-      std::map<int, std::map<int,int> >     fLitePhotons;
-      std::map<int, std::map<int,int> >     fReflectedLitePhotons;
-      std::vector< sim::OpDetBacktrackerRecord >      cOpDetBacktrackerRecordsCol; //analogous to scCol for electrons
-      std::vector< sim::OpDetBacktrackerRecord >      cReflectedOpDetBacktrackerRecordsCol; //analogous to scCol for electrons
-      std::map<int, int>  cOpChannelToSOCMap; //Where each OpChan is.
-      std::map<int, int>  cReflectedOpChannelToSOCMap; //Where each OpChan is.
+      sim::SimPhotonsLiteBuilder            fLitePhotons;
+      sim::SimPhotonsLiteBuilder            fReflectedLitePhotons;
+      sim::OpDetBacktrackerRecordAccumulator fBTRs; //analogous to scCol for electrons
+      sim::OpDetBacktrackerRecordAccumulator fReflectedBTRs;
       std::vector<sim::SimPhotons> fDetectedPhotons;
       std::vector<sim::SimPhotons> fReflectedDetectedPhotons;
+      /// Detected photons by light source and channel (direct, reflected).
+      std::vector<std::vector<unsigned int>> fLightSourceCounts[2];
 
 
       std::unordered_map<std::string, std::vector<sim::SimEnergyDeposit> > fSimEDepCol;
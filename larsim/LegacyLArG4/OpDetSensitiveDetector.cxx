@@ -33,8 +33,8 @@ namespace larg4 {
     G4SDManager::GetSDMpointer()->AddNewDetector(this);
 
     // Get instances of singleton classes
+    // (the photon table is per thread, and it is looked up at each photon)
     fTheOpDetLookup = OpDetLookup::Instance();
-    fThePhotonTable = OpDetPhotonTable::Instance();
   }
 
   //--------------------------------------------------------
@@ -50,7 +50,9 @@ namespace larg4 {
     bool const reflected = Wavelength(energy) > 200.0; // nm
 
     // Add this photon to the detected photons table
-    fThePhotonTable->AddLitePhoton(OpDet, static_cast<int>(time), 1, reflected);
+    OpDetPhotonTable* const photonTable = OpDetPhotonTable::Instance();
+    photonTable->AddLitePhoton(OpDet, static_cast<int>(time), 1, reflected);
+    photonTable->AddLightSourcePhoton(OpDet, reflected);
 
   } // OpDetSensitiveDetector::AddLitePhoton()
 
@@ -86,7 +88,9 @@ namespace larg4 {
       localPosition.x() / CLHEP::cm, localPosition.y() / CLHEP::cm, localPosition.z() / CLHEP::cm};
 
     // Add this photon to the detected photons table
-    fThePhotonTable->AddPhoton(OpDet, std::move(ThePhoton));
+    OpDetPhotonTable* const photonTable = OpDetPhotonTable::Instance();
+    photonTable->AddPhoton(OpDet, std::move(ThePhoton));
+    photonTable->AddLightSourcePhoton(OpDet);
 
   } // OpDetSensitiveDetector::AddPhoton()
 
@@ -31,7 +31,6 @@ class G4TouchableHistory;
 namespace larg4 {
 
   class OpDetLookup;
-  class OpDetPhotonTable;
 
   class OpDetSensitiveDetector : public G4VSensitiveDetector {
 
@@ -66,7 +65,6 @@ namespace larg4 {
     bool const fUseLitePhotons;
 
     OpDetLookup* fTheOpDetLookup;
-    OpDetPhotonTable* fThePhotonTable;
 
     //double                     fGlobalTimeOffset;
 
@@ -130,8 +130,10 @@
 #include "larsim/LegacyLArG4/OpDetPhotonTable.h"
 #include "larsim/LegacyLArG4/OpFastScintillation.hh"
 #include "larsim/LegacyLArG4/ParticleListAction.h"
+#include "larsim/LegacyLArG4/SimulationProfile.h"
 #include "larsim/PhotonPropagation/PhotonVisibilityService.h"
 #include "larsim/Simulation/LArG4Parameters.h"
+#include "larsim/Utils/TraceZones.h"
 
 #include "larcorealg/CoreUtils/counter.h"
 #include "larcorealg/Geometry/geo_vectors_utils.h"         // geo::vect::fillCoords()
@@ -146,6 +148,7 @@
 #include "TRandom3.h"
 #include "TGeoSphere.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <limits>
@@ -181,6 +184,9 @@ namespace larg4 {
     : G4VRestDiscreteProcess(processName, type)
     , fActiveVolumes{extractActiveVolumes(*(lar::providerFrom<geo::Geometry>()))}
     , bPropagate(!(art::ServiceHandle<sim::LArG4Parameters const>()->NoPhotonPropagation()))
+    , fFillSimEnergyDeposits(
+        art::ServiceHandle<sim::LArG4Parameters const>()->FillSimEnergyDeposits())
+    , fUseLitePhotons(art::ServiceHandle<sim::LArG4Parameters const>()->UseLitePhotons())
     , fPVS(bPropagate ? art::ServiceHandle<phot::PhotonVisibilityService const>().get() : nullptr)
     , fUseNhitsModel(fPVS && fPVS->UseNhitsModel())
     // for now, limit to the active volume only if semi-analytic model is used
@@ -285,16 +291,12 @@ namespace larg4 {
                                    finflexion_point_distance,
                                    fangle_bin_timing_vuv);
 
-        // create vector of empty TF1s that will be replaces with the parameterisations that are generated as they are required
-        // default TF1() constructor gives function with 0 dimensions, can then check numDim to qucikly see if a parameterisation has been generated
+        // create the table of empty distributions that will be filled with the
+        // parameterisations as they are required
         const size_t num_params = (fmax_d - fmin_d) / fstep_size; // for d < fmin_d, no parameterisaton, a delta function is used instead
         size_t num_angles = std::round(90/fangle_bin_timing_vuv);
-        VUV_timing = std::vector(num_angles, std::vector(num_params, TF1()));
-
-        // initialise vectors to contain range parameterisations sampled to in each case
-        // when using TF1->GetRandom(xmin,xmax), must be in same range otherwise sampling is regenerated, this is the slow part!
-        VUV_max = std::vector(num_angles, std::vector(num_params, 0.0));
-        VUV_min = std::vector(num_angles, std::vector(num_params, 0.0));
+        fNumVUVTimingDistances = num_params;
+        fVUVTimingTable = phot::InverseCDFTable(num_angles * num_params, 1024); // quantiles per distribution, as PDFastSimPAR default
 
         // VIS time parameterisation
         if (fPVS->StoreReflected()) {
@@ -506,9 +508,8 @@ namespace larg4 {
 
     // get the number of photons produced from the IonizationAndScintillation
     // singleton
-    larg4::IonizationAndScintillation::Instance()->Reset(&aStep);
     double MeanNumberOfPhotons =
-      larg4::IonizationAndScintillation::Instance()->NumberScintillationPhotons();
+      larg4::IonizationAndScintillation::Instance()->Reset(&aStep).numScintPhotons;
     // double stepEnergy          = larg4::IonizationAndScintillation::Instance()->VisibleEnergyDeposit()/CLHEP::MeV;
     RecordPhotonsProduced(aStep, MeanNumberOfPhotons); //, stepEnergy);
     if (verboseLevel > 0) {
@@ -545,9 +546,11 @@ namespace larg4 {
   bool OpFastScintillation::RecordPhotonsProduced(const G4Step& aStep,
                                                   double MeanNumberOfPhotons) //, double stepEnergy)
   {
+    SimulationProfile::Scope const timer{SimulationProfile::FastScintillation};
+    LARSIM_TRACE_ZONE("OpFastScintillation::RecordPhotonsProduced");
+
     // make sure that whatever happens afterwards, the energy deposition is stored
-    art::ServiceHandle<sim::LArG4Parameters const> lgp;
-    if (lgp->FillSimEnergyDeposits()) ProcessStep(aStep);
+    if (fFillSimEnergyDeposits) ProcessStep(aStep);
 
     // Get the pointer to the fast scintillation table
     OpDetPhotonTable* fst = OpDetPhotonTable::Instance();
@@ -570,10 +573,18 @@ namespace larg4 {
 
     G4MaterialPropertiesTable* aMaterialPropertiesTable = aMaterial->GetMaterialPropertiesTable();
 
-    G4MaterialPropertyVector* Fast_Intensity =
-      aMaterialPropertiesTable->GetProperty("FASTCOMPONENT");
-    G4MaterialPropertyVector* Slow_Intensity =
-      aMaterialPropertiesTable->GetProperty("SLOWCOMPONENT");
+    // materials may have been added since the cache was filled
+    if (static_cast<std::size_t>(materialIndex) >= fMaterialScintillation.size())
+      CacheMaterialScintillation();
+    MaterialScintillation_t const& scint = fMaterialScintillation[materialIndex];
+
+    // cached constant `value`, or the one from the table if not cached
+    auto constant = [aMaterialPropertiesTable](G4double value, const char* key) {
+      return std::isnan(value) ? aMaterialPropertiesTable->GetConstProperty(key) : value;
+    };
+
+    bool const Fast_Intensity = scint.hasFast;
+    bool const Slow_Intensity = scint.hasSlow;
 
     if (!Fast_Intensity && !Slow_Intensity) return 1;
 
@@ -591,51 +602,24 @@ namespace larg4 {
     if (scintillationByParticleType) {
       // The scintillation response is a function of the energy
       // deposited by particle types.
+      static constexpr std::array<const char*, NScintParticleTypes> YieldRatioKeys{{
+        "PROTONYIELDRATIO",
+        "MUONYIELDRATIO",
+        "PIONYIELDRATIO",
+        "KAONYIELDRATIO",
+        "ALPHAYIELDRATIO",
+        "ELECTRONYIELDRATIO",
+      }};
+
+      ScintParticleType_t const type = ScintParticleType(aParticle->GetDefinition());
+      YieldRatio = constant(scint.particleYieldRatio[type], YieldRatioKeys[type]);
 
-      // Get the definition of the current particle
-      G4ParticleDefinition* pDef = aParticle->GetDefinition();
-
-      // Obtain the G4MaterialPropertyVectory containing the
-      // scintillation light yield as a function of the deposited
-      // energy for the current particle type
-
-      // Protons
-      if (pDef == G4Proton::ProtonDefinition()) {
-        YieldRatio = aMaterialPropertiesTable->GetConstProperty("PROTONYIELDRATIO");
-      }
-      // Muons
-      else if (pDef == G4MuonPlus::MuonPlusDefinition() ||
-               pDef == G4MuonMinus::MuonMinusDefinition()) {
-        YieldRatio = aMaterialPropertiesTable->GetConstProperty("MUONYIELDRATIO");
-      }
-      // Pions
-      else if (pDef == G4PionPlus::PionPlusDefinition() ||
-               pDef == G4PionMinus::PionMinusDefinition()) {
-        YieldRatio = aMaterialPropertiesTable->GetConstProperty("PIONYIELDRATIO");
-      }
-      // Kaons
-      else if (pDef == G4KaonPlus::KaonPlusDefinition() ||
-               pDef == G4KaonMinus::KaonMinusDefinition()) {
-        YieldRatio = aMaterialPropertiesTable->GetConstProperty("KAONYIELDRATIO");
-      }
-      // Alphas
-      else if (pDef == G4Alpha::AlphaDefinition()) {
-        YieldRatio = aMaterialPropertiesTable->GetConstProperty("ALPHAYIELDRATIO");
-      }
-      // Electrons (must also account for shell-binding energy
-      // attributed to gamma from standard PhotoElectricEffect)
-      else if (pDef == G4Electron::ElectronDefinition() || pDef == G4Gamma::GammaDefinition()) {
-        YieldRatio = aMaterialPropertiesTable->GetConstProperty("ELECTRONYIELDRATIO");
-      }
-      // Default for particles not enumerated/listed above
-      else {
-        YieldRatio = aMaterialPropertiesTable->GetConstProperty("ELECTRONYIELDRATIO");
-      }
       // If the user has not specified yields for (p,d,t,a,carbon)
       // then these unspecified particles will default to the
       // electron's scintillation yield
       if (YieldRatio == 0) {
-        YieldRatio = aMaterialPropertiesTable->GetConstProperty("ELECTRONYIELDRATIO");
+        YieldRatio =
+          constant(scint.particleYieldRatio[kElectronYield], YieldRatioKeys[kElectronYield]);
       }
     }
 
@@ -650,7 +634,12 @@ namespace larg4 {
       ReflVisibilities = fPVS->GetAllVisibilities(ScintPoint, true);
       if (fPVS->StoreReflT0()) ReflT0s = fPVS->GetReflT0s(ScintPoint);
     }
-    if (fPVS->IncludeParPropTime()) { ParPropTimeTF1 = fPVS->GetTimingTF1(ScintPoint); }
+    if (fPVS->UseTimingHistograms()) {
+      ParPropTimeHistograms = fPVS->GetTimingHistograms(ScintPoint);
+    }
+    else if (fPVS->IncludeParPropTime()) {
+      ParPropTimeTF1 = fPVS->GetTimingTF1(ScintPoint);
+    }
 
     /*
     // For Kazu to debug # photons generated using csv file, by default should be commented out
@@ -685,19 +674,19 @@ namespace larg4 {
       if (scnt == 1) {
         if (nscnt == 1) {
           if (Fast_Intensity) {
-            ScintillationTime = aMaterialPropertiesTable->GetConstProperty("FASTTIMECONSTANT");
+            ScintillationTime = constant(scint.fastTime, "FASTTIMECONSTANT");
             if (fFiniteRiseTime) {
               ScintillationRiseTime =
-                aMaterialPropertiesTable->GetConstProperty("FASTSCINTILLATIONRISETIME");
+                constant(scint.fastRiseTime, "FASTSCINTILLATIONRISETIME");
             }
             ScintillationIntegral =
               (G4PhysicsOrderedFreeVector*)((*theFastIntegralTable)(materialIndex));
           }
           if (Slow_Intensity) {
-            ScintillationTime = aMaterialPropertiesTable->GetConstProperty("SLOWTIMECONSTANT");
+            ScintillationTime = constant(scint.slowTime, "SLOWTIMECONSTANT");
             if (fFiniteRiseTime) {
               ScintillationRiseTime =
-                aMaterialPropertiesTable->GetConstProperty("SLOWSCINTILLATIONRISETIME");
+                constant(scint.slowRiseTime, "SLOWSCINTILLATIONRISETIME");
             }
             ScintillationIntegral =
               (G4PhysicsOrderedFreeVector*)((*theSlowIntegralTable)(materialIndex));
@@ -705,16 +694,16 @@ namespace larg4 {
         } //endif nscnt=1
         else {
           if (YieldRatio == 0)
-            YieldRatio = aMaterialPropertiesTable->GetConstProperty("YIELDRATIO");
+            YieldRatio = constant(scint.yieldRatio, "YIELDRATIO");
 
           if (ExcitationRatio == 1.0) { Num = std::min(YieldRatio, 1.0) * MeanNumberOfPhotons; }
           else {
             Num = std::min(ExcitationRatio, 1.0) * MeanNumberOfPhotons;
           }
-          ScintillationTime = aMaterialPropertiesTable->GetConstProperty("FASTTIMECONSTANT");
+          ScintillationTime = constant(scint.fastTime, "FASTTIMECONSTANT");
           if (fFiniteRiseTime) {
             ScintillationRiseTime =
-              aMaterialPropertiesTable->GetConstProperty("FASTSCINTILLATIONRISETIME");
+              constant(scint.fastRiseTime, "FASTSCINTILLATIONRISETIME");
           }
           ScintillationIntegral =
             (G4PhysicsOrderedFreeVector*)((*theFastIntegralTable)(materialIndex));
@@ -723,10 +712,10 @@ namespace larg4 {
 
       else {
         Num = MeanNumberOfPhotons - Num;
-        ScintillationTime = aMaterialPropertiesTable->GetConstProperty("SLOWTIMECONSTANT");
+        ScintillationTime = constant(scint.slowTime, "SLOWTIMECONSTANT");
         if (fFiniteRiseTime) {
           ScintillationRiseTime =
-            aMaterialPropertiesTable->GetConstProperty("SLOWSCINTILLATIONRISETIME");
+            constant(scint.slowRiseTime, "SLOWSCINTILLATIONRISETIME");
         }
         ScintillationIntegral =
           (G4PhysicsOrderedFreeVector*)((*theSlowIntegralTable)(materialIndex));
@@ -747,12 +736,13 @@ namespace larg4 {
       if (!Visibilities && !usesSemiAnalyticModel()) continue;
 
       // detected photons from direct light
-      std::map<size_t, int> DetectedNum;
+      DetectedCounts_t& DetectedNum = fDetectedNum;
+      DetectedNum.clear();
       if (Visibilities && !usesSemiAnalyticModel()) {
         for (size_t const OpDet : util::counter(fPVS->NOpChannels())) {
           if (fOpaqueCathode && !isOpDetInSameTPC(ScintPoint, fOpDetCenter.at(OpDet))) continue;
           int const DetThis = std::round(G4Poisson(Visibilities[OpDet] * Num));
-          if (DetThis > 0) DetectedNum[OpDet] = DetThis;
+          if (DetThis > 0) DetectedNum.emplace_back(OpDet, DetThis);
         }
       }
       else {
@@ -760,13 +750,14 @@ namespace larg4 {
       }
 
       // detected photons from reflected light
-      std::map<size_t, int> ReflDetectedNum;
+      DetectedCounts_t& ReflDetectedNum = fReflDetectedNum;
+      ReflDetectedNum.clear();
       if (fPVS->StoreReflected()) {
         if (!usesSemiAnalyticModel()) {
           for (size_t const OpDet : util::counter(fPVS->NOpChannels())) {
             if (fOpaqueCathode && !isOpDetInSameTPC(ScintPoint, fOpDetCenter.at(OpDet))) continue;
             int const ReflDetThis = std::round(G4Poisson(ReflVisibilities[OpDet] * Num));
-            if (ReflDetThis > 0) ReflDetectedNum[OpDet] = ReflDetThis;
+            if (ReflDetThis > 0) ReflDetectedNum.emplace_back(OpDet, ReflDetThis);
           }
         }
         else {
@@ -774,88 +765,99 @@ namespace larg4 {
         }
       }
 
+      if (DetectedNum.empty() && ReflDetectedNum.empty()) continue;
+
+      // the information for the OpDetBTR is the same for all the channels
+      int const thisG4TrackID = ParticleListAction::GetCurrentTrackID();
+      double xyzPos[3];
+      average_position(aStep, xyzPos);
+      double StepEdeposited = 0;
+      if (scintillationByParticleType) {
+        //We use this when it is the only sensical information. It may be of limited use to end users.
+        StepEdeposited = aStep.GetTotalEnergyDeposit();
+      }
+      else if (emSaturation) {
+        //If Birk Coefficient used, log VisibleEnergies.
+        StepEdeposited =
+          larg4::IonizationAndScintillation::Instance()->CurrentStep().visibleEnergyDeposit /
+          CLHEP::MeV;
+      }
+      else {
+        //We use this when it is the only sensical information. It may be of limited use to end users.
+        StepEdeposited = aStep.GetTotalEnergyDeposit();
+      }
+      G4double const transitTime = transit_time(aStep);
+
       std::vector<double> arrival_time_dist;
       // Now we run through each PMT figuring out num of detected photons
       for (size_t Reflected = 0; Reflected <= 1; ++Reflected) {
         // Only do the reflected loop if we have reflected visibilities
         if (Reflected && !fPVS->StoreReflected()) continue;
 
-        std::map<size_t, int>::const_iterator itstart;
-        std::map<size_t, int>::const_iterator itend;
-        if (Reflected) {
-          itstart = ReflDetectedNum.begin();
-          itend = ReflDetectedNum.end();
-        }
-        else {
-          itstart = DetectedNum.begin();
-          itend = DetectedNum.end();
-        }
-        for (auto itdetphot = itstart; itdetphot != itend; ++itdetphot) {
-          const size_t OpChannel = itdetphot->first;
-          const int NPhotons = itdetphot->second;
-
-          // Set up the OpDetBTR information
-          sim::OpDetBacktrackerRecord tmpOpDetBTRecord(OpChannel);
-          int thisG4TrackID = ParticleListAction::GetCurrentTrackID();
-          double xyzPos[3];
-          average_position(aStep, xyzPos);
-          double Edeposited = 0;
-          if (scintillationByParticleType) {
-            //We use this when it is the only sensical information. It may be of limited use to end users.
-            Edeposited = aStep.GetTotalEnergyDeposit();
-          }
-          else if (emSaturation) {
-            //If Birk Coefficient used, log VisibleEnergies.
-            Edeposited =
-              larg4::IonizationAndScintillation::Instance()->VisibleEnergyDeposit() / CLHEP::MeV;
-          }
-          else {
-            //We use this when it is the only sensical information. It may be of limited use to end users.
-            Edeposited = aStep.GetTotalEnergyDeposit();
-          }
+        // reemitted photons have a random energy, drawn after each one's time
+        bool const reemission = Reflected && !fUseLitePhotons;
+
+        for (auto const& [OpChannel, NPhotons] : Reflected ? ReflDetectedNum : DetectedNum) {
 
           // Get the transport time distribution
           arrival_time_dist.resize(NPhotons);
           propagationTime(arrival_time_dist, x0, OpChannel, Reflected);
 
           //We need to split the energy up by the number of photons so that we never try to write a 0 energy.
-          Edeposited = Edeposited / double(NPhotons);
+          double const Edeposited = StepEdeposited / double(NPhotons);
 
-          // Loop through the photons
+          // Times (and energies) of all the photons, drawing the random
+          // numbers in the same sequence as photon by photon
+          fPhotonTimes.resize(NPhotons);
+          fPhotonEnergies.resize(reemission ? NPhotons : 0);
           for (G4int i = 0; i < NPhotons; ++i) {
             //std::cout<<"VUV time correction: "<<arrival_time_dist[i]<<std::endl;
-            G4double Time = t0 + scint_time(aStep, ScintillationTime, ScintillationRiseTime) +
-                            arrival_time_dist[i] * CLHEP::ns;
-
-            // Always store the BTR
-            tmpOpDetBTRecord.AddScintillationPhotons(thisG4TrackID, Time, 1, xyzPos, Edeposited);
-
-            // Store as lite photon or as OnePhoton
-            if (lgp->UseLitePhotons()) {
-              fst->AddLitePhoton(OpChannel, static_cast<int>(Time), 1, Reflected);
-            }
-            else {
-              // The sim photon in this case stores its production point and time
-              TVector3 PhotonPosition(x0[0], x0[1], x0[2]);
-
-              float PhotonEnergy = 0;
-              if (Reflected)
-                PhotonEnergy = reemission_energy() * CLHEP::eV;
-              else
-                PhotonEnergy = 9.7 * CLHEP::eV; // 9.7 eV peak of VUV emission spectrum
+            fPhotonTimes[i] = t0 + scint_time(transitTime, ScintillationTime, ScintillationRiseTime) +
+                              arrival_time_dist[i] * CLHEP::ns;
+            if (reemission) fPhotonEnergies[i] = reemission_energy() * CLHEP::eV;
+          }
 
+          // Store as lite photon or as OnePhoton
+          if (!fUseLitePhotons) {
+            // The sim photon in this case stores its production point and time
+            TVector3 const PhotonPosition(x0[0], x0[1], x0[2]);
+            for (G4int i = 0; i < NPhotons; ++i) {
               // Make a photon object for the collection
               sim::OnePhoton PhotToAdd;
               PhotToAdd.InitialPosition = PhotonPosition;
-              PhotToAdd.Energy = PhotonEnergy;
-              PhotToAdd.Time = Time;
+              // 9.7 eV peak of VUV emission spectrum
+              PhotToAdd.Energy = reemission ? fPhotonEnergies[i] : 9.7 * CLHEP::eV;
+              PhotToAdd.Time = fPhotonTimes[i];
               PhotToAdd.SetInSD = false;
               PhotToAdd.MotherTrackID = tracknumber;
 
               fst->AddPhoton(OpChannel, std::move(PhotToAdd), Reflected);
             }
           }
-          fst->AddOpDetBacktrackerRecord(tmpOpDetBTRecord, Reflected);
+
+          // the records and the lite photons do not depend on the photon order:
+          // in time order, the BTR entries are appended and tick counts merged
+          std::sort(fPhotonTimes.begin(), fPhotonTimes.end());
+
+          // Always store the BTR, one entry per distinct time
+          for (auto it = fPhotonTimes.cbegin(); it != fPhotonTimes.cend();) {
+            double const Time = *it;
+            int n = 0;
+            for (; (it != fPhotonTimes.cend()) && (*it == Time); ++it)
+              ++n;
+            fst->AddOpDetBacktrackerPhotons(OpChannel, thisG4TrackID, Time, n, xyzPos,
+                                            n * Edeposited, Reflected);
+          }
+
+          if (fUseLitePhotons) {
+            for (auto it = fPhotonTimes.cbegin(); it != fPhotonTimes.cend();) {
+              int const tick = static_cast<int>(*it);
+              int n = 0;
+              for (; (it != fPhotonTimes.cend()) && (static_cast<int>(*it) == tick); ++it)
+                ++n;
+              fst->AddLitePhoton(OpChannel, tick, n, Reflected);
+            }
+          }
         }
       }
     }
@@ -869,6 +871,8 @@ namespace larg4 {
   void
   OpFastScintillation::BuildThePhysicsTable()
   {
+    CacheMaterialScintillation();
+
     if (theFastIntegralTable && theSlowIntegralTable) return;
 
     const G4MaterialTable* theMaterialTable = G4Material::GetMaterialTable();
@@ -978,6 +982,74 @@ namespace larg4 {
     }
   }
 
+  // Reads the constants used while stepping from the material properties
+  // --------------------------------------------------------------------
+  //
+  void
+  OpFastScintillation::CacheMaterialScintillation()
+  {
+    const G4MaterialTable* theMaterialTable = G4Material::GetMaterialTable();
+    G4int const numOfMaterials = G4Material::GetNumberOfMaterials();
+
+    G4double const NaN = std::numeric_limits<G4double>::quiet_NaN();
+
+    fMaterialScintillation.clear();
+    fMaterialScintillation.reserve(numOfMaterials);
+    for (G4int i = 0; i < numOfMaterials; i++) {
+      MaterialScintillation_t scint;
+      G4MaterialPropertiesTable* table = (*theMaterialTable)[i]->GetMaterialPropertiesTable();
+
+      auto constant = [table, NaN](const char* key) {
+        return table->ConstPropertyExists(key) ? table->GetConstProperty(key) : NaN;
+      };
+
+      scint.hasProperties = (table != nullptr);
+      if (table) {
+        scint.hasFast = (table->GetProperty("FASTCOMPONENT") != nullptr);
+        scint.hasSlow = (table->GetProperty("SLOWCOMPONENT") != nullptr);
+        scint.fastTime = constant("FASTTIMECONSTANT");
+        scint.slowTime = constant("SLOWTIMECONSTANT");
+        scint.fastRiseTime = constant("FASTSCINTILLATIONRISETIME");
+        scint.slowRiseTime = constant("SLOWSCINTILLATIONRISETIME");
+        scint.yieldRatio = constant("YIELDRATIO");
+        scint.particleYieldRatio[kProtonYield] = constant("PROTONYIELDRATIO");
+        scint.particleYieldRatio[kMuonYield] = constant("MUONYIELDRATIO");
+        scint.particleYieldRatio[kPionYield] = constant("PIONYIELDRATIO");
+        scint.particleYieldRatio[kKaonYield] = constant("KAONYIELDRATIO");
+        scint.particleYieldRatio[kAlphaYield] = constant("ALPHAYIELDRATIO");
+        scint.particleYieldRatio[kElectronYield] = constant("ELECTRONYIELDRATIO");
+      }
+      else {
+        scint.fastTime = scint.slowTime = scint.fastRiseTime = scint.slowRiseTime = NaN;
+        scint.yieldRatio = NaN;
+        scint.particleYieldRatio.fill(NaN);
+      }
+      fMaterialScintillation.push_back(scint);
+    } // for materials
+  }
+
+  OpFastScintillation::ScintParticleType_t
+  OpFastScintillation::ScintParticleType(G4ParticleDefinition const* pDef)
+  {
+    // Protons
+    if (pDef == G4Proton::ProtonDefinition()) return kProtonYield;
+    // Muons
+    if (pDef == G4MuonPlus::MuonPlusDefinition() || pDef == G4MuonMinus::MuonMinusDefinition())
+      return kMuonYield;
+    // Pions
+    if (pDef == G4PionPlus::PionPlusDefinition() || pDef == G4PionMinus::PionMinusDefinition())
+      return kPionYield;
+    // Kaons
+    if (pDef == G4KaonPlus::KaonPlusDefinition() || pDef == G4KaonMinus::KaonMinusDefinition())
+      return kKaonYield;
+    // Alphas
+    if (pDef == G4Alpha::AlphaDefinition()) return kAlphaYield;
+    // Electrons (must also account for shell-binding energy
+    // attributed to gamma from standard PhotoElectricEffect),
+    // and default for particles not enumerated/listed above
+    return kElectronYield;
+  }
+
   // Called by the user to set the scintillation yield as a function
   // of energy deposited by particle type
   void
@@ -1011,11 +1083,25 @@ namespace larg4 {
   OpFastScintillation::scint_time(const G4Step& aStep,
                                   G4double ScintillationTime,
                                   G4double ScintillationRiseTime) const
+  {
+    return scint_time(transit_time(aStep), ScintillationTime, ScintillationRiseTime);
+  }
+
+  G4double
+  OpFastScintillation::transit_time(const G4Step& aStep)
   {
     G4StepPoint const* pPreStepPoint = aStep.GetPreStepPoint();
     G4StepPoint const* pPostStepPoint = aStep.GetPostStepPoint();
     G4double avgVelocity = (pPreStepPoint->GetVelocity() + pPostStepPoint->GetVelocity()) / 2.;
-    G4double deltaTime = aStep.GetStepLength() / avgVelocity;
+    return aStep.GetStepLength() / avgVelocity;
+  }
+
+  G4double
+  OpFastScintillation::scint_time(G4double transitTime,
+                                  G4double ScintillationTime,
+                                  G4double ScintillationRiseTime) const
+  {
+    G4double deltaTime = transitTime;
     if (ScintillationRiseTime == 0.0) {
       deltaTime = deltaTime - ScintillationTime * std::log(G4UniformRand());
     }
@@ -1035,9 +1121,21 @@ namespace larg4 {
       throw cet::exception("OpFastScintillation")
         << "Cannot have both propagation time models simultaneously.";
     }
+    else if (fPVS->UseTimingHistograms() &&
+             (ParPropTimeHistograms && ParPropTimeHistograms[OpChannel].isValid())) {
+      if (Reflected)
+        throw cet::exception("OpFastScintillation")
+          << "No parameterized propagation time for reflected light";
+      // direct inversion of the cumulative content of the histogram
+      auto const histogram = ParPropTimeHistograms[OpChannel];
+      for (size_t i = 0; i < arrival_time_dist.size(); ++i) {
+        arrival_time_dist[i] = histogram.sample(gRandom->Rndm());
+      }
+    }
     else if (fPVS->IncludeParPropTime() &&
-             !(ParPropTimeTF1 && (ParPropTimeTF1[OpChannel].GetNdim() == 1))) {
-      //Warning: TF1::GetNdim()==1 will tell us if the TF1 is really defined or it is the default one.
+             (fPVS->UseTimingHistograms() ||
+              !(ParPropTimeTF1 && ParPropTimeTF1[OpChannel].isValid()))) {
+      //Warning: isValid() will tell us if the distribution is really defined or it is the default one.
       //This will fix a segfault when using timing and interpolation.
       G4cout << "WARNING: Requested parameterized timing, but no function found. Not applying "
                 "propagation time."
@@ -1047,8 +1145,10 @@ namespace larg4 {
       if (Reflected)
         throw cet::exception("OpFastScintillation")
           << "No parameterized propagation time for reflected light";
+      // tabulated on first use; sampled with gRandom like TF1::GetRandom()
+      auto const distribution = ParPropTimeTF1[OpChannel].distribution();
       for (size_t i = 0; i < arrival_time_dist.size(); ++i) {
-        arrival_time_dist[i] = ParPropTimeTF1[OpChannel].GetRandom();
+        arrival_time_dist[i] = distribution->sample(0, gRandom->Rndm());
       }
     }
     else if (fPVS->IncludePropTime()) {
@@ -1338,12 +1438,12 @@ namespace larg4 {
     // min
     double min = t_direct_min;
 
-    // store TF1 and min/max, this allows identical TF1 to be used every time sampling
-    // the first call of GetRandom generates the timing sampling and stores it in the TF1 object, this is the slow part
-    // all subsequent calls check if it has been generated previously and are ~100+ times quicker
-    VUV_timing[angle_bin][index] = fVUVTiming;
-    VUV_max[angle_bin][index] = max;
-    VUV_min[angle_bin][index] = min;
+    // tabulate the inverse cumulative distribution in [min, max], sampling the
+    // parameterisation with the same granularity TF1::GetRandom() would use;
+    // the TF1 is not kept, and all subsequent samplings are a table lookup
+    fVUVTimingTable.fill(VUVTimingTableIndex(index, angle_bin),
+                         [&fVUVTiming](double t) { return fVUVTiming.Eval(t); },
+                         min, max, fsampling);
   }
 
   // VUV arrival times calculation function
@@ -1360,11 +1460,12 @@ namespace larg4 {
     else { // distance >= fmin_d
       // determine nearest parameterisation in discretisation
       int index = std::round((distance - fmin_d) / fstep_size);
+      const size_t iTable = VUVTimingTableIndex(index, angle_bin);
       // check whether required parameterisation has been generated, generating if not
-      if (VUV_timing[angle_bin][index].GetNdim() == 0) { generateParam(index, angle_bin); }
+      if (!fVUVTimingTable.isFilled(iTable)) { generateParam(index, angle_bin); }
       // randomly sample parameterisation for each photon
       for (size_t i = 0; i < arrivalTimes.size(); ++i) {
-        arrivalTimes[i] = VUV_timing[angle_bin][index].GetRandom(VUV_min[angle_bin][index], VUV_max[angle_bin][index]);
+        arrivalTimes[i] = fVUVTimingTable.sample(iTable, gRandom->Rndm());
       }
     }
   }
@@ -1417,7 +1518,7 @@ namespace larg4 {
       // find index of required parameterisation
       const size_t index = std::round((VUVdist - fmin_d) / fstep_size);
       // find shortest time
-      vuv_time = VUV_min[angle_bin_vuv][index];
+      vuv_time = fVUVTimingTable.lower(VUVTimingTableIndex(index, angle_bin_vuv));
     }
     // sum
     double fastest_time = vis_time + vuv_time;
@@ -1496,7 +1597,7 @@ namespace larg4 {
 
   // ---------------------------------------------------------------------------
   void
-  OpFastScintillation::detectedDirectHits(std::map<size_t, int>& DetectedNum,
+  OpFastScintillation::detectedDirectHits(DetectedCounts_t& DetectedNum,
                                           const double Num,
                                           geo::Point_t const& ScintPoint) const
   {
@@ -1509,7 +1610,7 @@ namespace larg4 {
         fOpDetCenter.at(OpDet), fOpDetType.at(OpDet)};
       const int DetThis = VUVHits(Num, ScintPoint, op);
       if (DetThis > 0) {
-        DetectedNum[OpDet] = DetThis;
+        DetectedNum.emplace_back(OpDet, DetThis);
         //   mf::LogInfo("OpFastScintillation") << "FastScint: " <<
         //   //   it->second<<" " << Num << " " << DetThisPMT;
         //det_photon_ctr += DetThisPMT; // CASE-DEBUG DO NOT REMOVE THIS COMMENT
@@ -1518,7 +1619,7 @@ namespace larg4 {
   }
 
   void
-  OpFastScintillation::detectedReflecHits(std::map<size_t, int>& ReflDetectedNum,
+  OpFastScintillation::detectedReflecHits(DetectedCounts_t& ReflDetectedNum,
                                           const double Num,
                                           geo::Point_t const& ScintPoint) const
   {
@@ -1586,7 +1687,7 @@ namespace larg4 {
 
       int const ReflDetThis =
         VISHits(ScintPoint, op, cathode_hits_rec, hotspot);
-      if (ReflDetThis > 0) { ReflDetectedNum[OpDet] = ReflDetThis; }
+      if (ReflDetThis > 0) { ReflDetectedNum.emplace_back(OpDet, ReflDetThis); }
     }
   }
 
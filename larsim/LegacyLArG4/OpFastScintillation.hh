@@ -97,10 +97,15 @@
 #include "Geant4/G4Types.hh"
 #include "Geant4/G4VRestDiscreteProcess.hh"
 
+#include "larsim/PhotonPropagation/InverseCDFTable.h"
+
 #include "TF1.h"
 #include "TVector3.h"
 
+#include <array>
 #include <memory> // std::unique_ptr
+#include <utility> // std::pair
+#include <vector>
 
 class G4EmSaturation;
 class G4Step;
@@ -259,10 +264,13 @@ namespace larg4 {
     void getVISTimes(std::vector<double>& arrivalTimes, const TVector3 &ScintPoint, const TVector3 &OpDetPoint);
     // Visible component timing parameterisation
 
-    void detectedDirectHits(std::map<size_t, int>& DetectedNum,
+    /// Detected photons: pairs (channel, number of photons), sorted by channel.
+    using DetectedCounts_t = std::vector<std::pair<size_t, int>>;
+
+    void detectedDirectHits(DetectedCounts_t& DetectedNum,
                             const double Num,
                             geo::Point_t const& ScintPoint) const;
-    void detectedReflecHits(std::map<size_t, int>& ReflDetectedNum,
+    void detectedReflecHits(DetectedCounts_t& ReflDetectedNum,
                             const double Num,
                             geo::Point_t const& ScintPoint) const;
 
@@ -282,6 +290,42 @@ namespace larg4 {
     std::unique_ptr<G4PhysicsTable> theSlowIntegralTable;
     std::unique_ptr<G4PhysicsTable> theFastIntegralTable;
 
+    /// Particle types with their own scintillation yield ratio.
+    enum ScintParticleType_t : std::size_t {
+      kProtonYield,
+      kMuonYield,
+      kPionYield,
+      kKaonYield,
+      kAlphaYield,
+      kElectronYield, ///< Also for all the other particles.
+      NScintParticleTypes
+    };
+
+    /// Scintillation constants of a material, read once from its properties
+    /// table so that stepping does not look them up by name; constants not in
+    /// the table are NaN, and when needed they are asked to the table again.
+    struct MaterialScintillation_t {
+      bool hasProperties = false; ///< Whether there is a properties table.
+      bool hasFast = false;       ///< Whether there is a fast component.
+      bool hasSlow = false;       ///< Whether there is a slow component.
+      G4double fastTime;          ///< `FASTTIMECONSTANT`
+      G4double slowTime;          ///< `SLOWTIMECONSTANT`
+      G4double fastRiseTime;      ///< `FASTSCINTILLATIONRISETIME`
+      G4double slowRiseTime;      ///< `SLOWSCINTILLATIONRISETIME`
+      G4double yieldRatio;        ///< `YIELDRATIO`
+      /// `PROTONYIELDRATIO`, `MUONYIELDRATIO`... (see `ScintParticleType_t`).
+      std::array<G4double, NScintParticleTypes> particleYieldRatio;
+    };
+
+    /// Cached scintillation constants, by material index.
+    std::vector<MaterialScintillation_t> fMaterialScintillation;
+
+    /// Fills `fMaterialScintillation` for all the materials in the table.
+    void CacheMaterialScintillation();
+
+    /// Returns the yield ratio category of the particle `pDef`.
+    static ScintParticleType_t ScintParticleType(G4ParticleDefinition const* pDef);
+
     G4bool fTrackSecondariesFirst;
     G4bool fFiniteRiseTime;
 
@@ -320,6 +364,12 @@ namespace larg4 {
     G4double scint_time(const G4Step& aStep,
                         G4double ScintillationTime,
                         G4double ScintillationRiseTime) const;
+    // same as scint_time(), with the transit time of the step (transit_time())
+    // already computed
+    G4double scint_time(G4double transitTime,
+                        G4double ScintillationTime,
+                        G4double ScintillationRiseTime) const;
+    static G4double transit_time(const G4Step& aStep);
     void propagationTime(std::vector<double>& arrival_time_dist,
                          G4ThreeVector x0,
                          const size_t OpChannel,
@@ -338,6 +388,7 @@ namespace larg4 {
     G4EmSaturation* emSaturation;
     // functions and parameters for the propagation time parametrization
     phot::MappedFunctions_t ParPropTimeTF1;
+    phot::MappedTimeHistograms_t ParPropTimeHistograms; ///< Used instead of the functions if set.
     phot::MappedT0s_t ReflT0s;
 
     /*TF1 const* functions_vuv[8];
@@ -350,11 +401,12 @@ namespace larg4 {
     //For new VUV time parametrization
     double fstep_size, fmin_d, fmax_d, fvuv_vgroup_mean, fvuv_vgroup_max, finflexion_point_distance, fangle_bin_timing_vuv;
     std::vector<std::vector<double>> fparameters[7];
-    // vector containing generated VUV timing parameterisations
-    std::vector<std::vector<TF1>> VUV_timing;
-    // vector containing min and max range VUV timing parameterisations are sampled to
-    std::vector<std::vector<double>> VUV_max;
-    std::vector<std::vector<double>> VUV_min;
+    // inverse cumulative distributions of the VUV timing parameterisations,
+    // one per (angle bin, distance), each tabulated when first required
+    phot::InverseCDFTable fVUVTimingTable;
+    size_t fNumVUVTimingDistances = 0;
+    size_t VUVTimingTableIndex(const size_t index, const size_t angle_bin) const
+      { return angle_bin * fNumVUVTimingDistances + index; }
 
     // For new VIS time parameterisation
     double fvis_vmean, fangle_bin_timing_vis;
@@ -424,6 +476,18 @@ namespace larg4 {
 
     bool const bPropagate; ///< Whether propagation of photons is enabled.
 
+    /// Whether to record the energy deposition of each step.
+    bool const fFillSimEnergyDeposits;
+
+    /// Whether detected photons are stored as "lite" photons.
+    bool const fUseLitePhotons;
+
+    // buffers reused at each step
+    DetectedCounts_t fDetectedNum;     ///< Direct light photons detected per channel.
+    DetectedCounts_t fReflDetectedNum; ///< Reflected light photons detected per channel.
+    std::vector<double> fPhotonTimes;  ///< Arrival times of the photons on a channel.
+    std::vector<float> fPhotonEnergies; ///< Energies of the photons on a channel.
+
     /// Photon visibility service instance.
     phot::PhotonVisibilityService const* const fPVS;
 
@@ -5,8 +5,40 @@
 
 #include "cetlib_except/exception.h"
 
+#include <algorithm>
 #include <cmath>
 
+namespace
+{
+
+  double SignOf(double x) { return (x < 0.)? -1.: 1.; }
+
+  // Octahedral projection of a direction onto (u, v) in [-1,1]x[-1,1]
+  void DirectionToOctahedral(G4ThreeVector const& dir, double& u, double& v)
+  {
+    double const norm = std::abs(dir.x()) + std::abs(dir.y()) + std::abs(dir.z());
+    u = dir.x() / norm;
+    v = dir.y() / norm;
+    if(dir.z() < 0.)
+      {
+	double const u0 = u;
+	u = (1. - std::abs(v)) * SignOf(u0);
+	v = (1. - std::abs(u0)) * SignOf(v);
+      }
+  }
+
+  // Direction (unit vector) at the point (u, v) of the octahedral projection
+  G4ThreeVector OctahedralToDirection(double u, double v)
+  {
+    double const z = 1. - std::abs(u) - std::abs(v);
+    G4ThreeVector const dir = (z < 0.)
+      ? G4ThreeVector((1. - std::abs(v)) * SignOf(u), (1. - std::abs(u)) * SignOf(v), z)
+      : G4ThreeVector(u, v, z);
+    return dir.unit();
+  }
+
+}
+
 namespace larg4
 {
 
@@ -149,6 +181,55 @@ namespace larg4
 
 
 
+  //-----------------------------------------------
+  //  OpParamActionTable Methods
+  //-----------------------------------------------
+
+
+  OpParamActionTable::OpParamActionTable(OpParamAction& Action, std::size_t NNodes)
+    : fNNodes(NNodes)
+    , fNodesPerUnit((NNodes - 1) / 2.)
+    , fTable(NNodes * NNodes)
+  {
+    if(Action.DependsOnPosition())
+      {
+	throw cet::exception("OpParamAction") << "Position dependent optical parameterizations can't be tabulated by direction\n";
+      }
+    if(NNodes < 2)
+      {
+	throw cet::exception("OpParamAction") << "Attenuation table needs at least 2 nodes per side, " << NNodes << " requested\n";
+      }
+    for(size_t iu=0; iu!=fNNodes; ++iu)
+      {
+	double const u = -1. + iu / fNodesPerUnit;
+	for(size_t iv=0; iv!=fNNodes; ++iv)
+	  {
+	    double const v = -1. + iv / fNodesPerUnit;
+	    fTable[iu * fNNodes + iv] = Action.GetAttenuationFraction(OctahedralToDirection(u, v), G4ThreeVector());
+	  }
+      }
+  }
+
+
+  //-----------------------------------------------
+
+  double OpParamActionTable::GetAttenuationFraction(G4ThreeVector const& PhotonDirection) const
+  {
+    double u, v;
+    DirectionToOctahedral(PhotonDirection, u, v);
+
+    // cell and position in the cell
+    double const su = (u + 1.) * fNodesPerUnit, sv = (v + 1.) * fNodesPerUnit;
+    std::size_t const iu = std::min(static_cast<std::size_t>(std::max(su, 0.)), fNNodes - 2);
+    std::size_t const iv = std::min(static_cast<std::size_t>(std::max(sv, 0.)), fNNodes - 2);
+    double const fu = su - iu, fv = sv - iv;
+
+    return (1. - fu) * ((1. - fv) * Node(iu, iv) + fv * Node(iu, iv + 1))
+      + fu * ((1. - fv) * Node(iu + 1, iv) + fv * Node(iu + 1, iv + 1));
+  }
+
+
+
 
 
 }
@@ -22,6 +22,10 @@
 //    of multiple overlaid wireplanes in 3D.  This is the implementation used
 //    to model the optical transmission of wireplanes in MicroBooNE.
 //
+// Actions which do not depend on the photon position can be tabulated as a
+// function of the photon direction only (OpParamActionTable), so that the
+// attenuation of each photon is a table lookup.
+//
 
 #ifndef OPPARAMACTION_H
 #define OPPARAMACTION_H
@@ -29,6 +33,7 @@
 #include "TVector3.h"
 #include "Geant4/G4ThreeVector.hh"
 
+#include <cstddef>
 #include <vector>
 
 namespace larg4
@@ -47,6 +52,10 @@ namespace larg4
     virtual ~OpParamAction();
     virtual double GetAttenuationFraction(G4ThreeVector PhotonDirection, G4ThreeVector PhotonPosition);
 
+    // Whether the attenuation depends on the photon position
+    // (if not, the action can be tabulated in OpParamActionTable)
+    virtual bool DependsOnPosition() const { return true; }
+
   private:
 
   };
@@ -62,6 +71,7 @@ namespace larg4
     TransparentPlaneAction() {};
     ~TransparentPlaneAction() {};
     double GetAttenuationFraction(G4ThreeVector /*PhotonDirection*/, G4ThreeVector /*PhotonPosition*/) {return 1;}
+    bool DependsOnPosition() const {return false;}
 
   private:
 
@@ -80,6 +90,7 @@ namespace larg4
     ~SimpleWireplaneAction() ;
 
     double GetAttenuationFraction(G4ThreeVector PhotonDirection, G4ThreeVector PhotonPosition);
+    bool DependsOnPosition() const {return false;}
 
   private:
     G4ThreeVector fWireDirection;
@@ -99,6 +110,7 @@ namespace larg4
     ~OverlaidWireplanesAction() ;
 
     double GetAttenuationFraction(G4ThreeVector PhotonDirection, G4ThreeVector PhotonPosition);
+    bool DependsOnPosition() const {return false;}
 
   private:
 
@@ -108,6 +120,36 @@ namespace larg4
   };
 
 
+  //---------------------------------------------------
+  // OpParamActionTable class
+  //---------------------------------------------------
+  //
+  // Attenuation fraction of a position-independent action, tabulated on a
+  // grid of photon directions at construction and bilinearly interpolated.
+  // Directions are mapped onto the grid with the octahedral projection
+  // (the unit sphere folded onto the square [-1,1]x[-1,1]), which takes no
+  // trigonometric functions and keeps the grid cells of similar size.
+  // The attenuation of the wireplane actions is continuous in the direction,
+  // so the interpolation error shrinks with the size of the cells.
+
+  class OpParamActionTable
+  {
+  public:
+    OpParamActionTable(OpParamAction& Action, std::size_t NNodes = DefaultNNodes);
+
+    double GetAttenuationFraction(G4ThreeVector const& PhotonDirection) const;
+
+    static constexpr std::size_t DefaultNNodes = 257; // per side of the grid
+
+  private:
+    std::size_t         fNNodes;
+    double              fNodesPerUnit; // (NNodes - 1) / 2
+    std::vector<double> fTable;        // fTable[iu * NNodes + iv]
+
+    double Node(std::size_t iu, std::size_t iv) const { return fTable[iu * fNNodes + iv]; }
+  };
+
+
 }
 
 #endif
@@ -22,6 +22,28 @@
 #include "Geant4/G4Track.hh"
 #include "Geant4/G4TrackStatus.hh"
 
+#include <mutex>
+#include <tuple>
+
+namespace {
+
+  // Attenuation tables, by model, orientation and parameters
+  using TableKey_t = std::tuple<std::string, int, std::vector<std::vector<double> > >;
+
+  std::shared_ptr<larg4::OpParamActionTable const> GetTable
+    (TableKey_t const& key, larg4::OpParamAction& action)
+  {
+    static std::mutex tablesMutex;
+    static std::map<TableKey_t, std::shared_ptr<larg4::OpParamActionTable const> > tables;
+
+    std::lock_guard<std::mutex> const lock(tablesMutex);
+    auto& table = tables[key];
+    if(!table) table = std::make_shared<larg4::OpParamActionTable const>(action);
+    return table;
+  }
+
+}
+
 namespace larg4{
 
 
@@ -48,6 +70,9 @@ namespace larg4{
         throw cet::exception("OpParamSD")<<"Error: Optical parameterization model " << ModelName <<" not found.\n";
       }
 
+    if(!fOpa->DependsOnPosition())
+      fTable = GetTable(TableKey_t(ModelName, Orientation, ModelParameters), *fOpa);
+
   }
 
 
@@ -64,7 +89,9 @@ namespace larg4{
     G4ThreeVector pos = aStep->GetPostStepPoint()->GetPosition();
     if(!fPhotonAlreadyCrossed[aTrack->GetTrackID()])
       {
-	if(G4BooleanRand(fOpa->GetAttenuationFraction(mom,pos)))
+	double const AttenFraction
+	  = fTable? fTable->GetAttenuationFraction(mom): fOpa->GetAttenuationFraction(mom,pos);
+	if(G4BooleanRand(AttenFraction))
 	  {
 	    // photon survives - let it carry on
 	    fPhotonAlreadyCrossed[aTrack->GetTrackID()]=true;
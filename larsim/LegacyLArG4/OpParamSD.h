@@ -18,6 +18,10 @@
 // transmission probability.  A fraction of all photons are killed
 // accordingly.
 //
+// Models which depend only on the photon direction are tabulated when the
+// detector is constructed (OpParamActionTable), and the table is read instead.
+// Tables are shared by all the detectors with the same model and parameters.
+//
 // This sensitive detector object is attached to physical volumes by the
 // OpDetReadoutGeometry class.
 //
@@ -34,6 +38,7 @@
 #include "Geant4/Randomize.hh"
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -44,6 +49,7 @@ class G4TouchableHistory;
 namespace larg4 {
 
   class OpParamAction;
+  class OpParamActionTable;
 
   class OpParamSD : public G4VSensitiveDetector
   {
@@ -74,6 +80,7 @@ namespace larg4 {
     G4bool G4BooleanRand(const G4double prob) const;
 
     OpParamAction *        fOpa;
+    std::shared_ptr<OpParamActionTable const> fTable; // null if not tabulated
     std::map<G4int, bool>  fPhotonAlreadyCrossed;
 
   };
@@ -6,6 +6,7 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include "larsim/LegacyLArG4/ParticleListAction.h"
+#include "larsim/LegacyLArG4/SimulationProfile.h"
 #include "lardataobj/Simulation/sim.h" // sim::NoParticleId
 #include "nug4/G4Base/PrimaryParticleInformation.h"
 #include "nug4/ParticleNavigation/ParticleList.h"
@@ -18,6 +19,7 @@
 #include "Geant4/G4PrimaryParticle.hh"
 #include "Geant4/G4Step.hh"
 #include "Geant4/G4StepPoint.hh"
+#include "Geant4/G4StepStatus.hh"
 #include "Geant4/G4String.hh"
 #include "Geant4/G4ThreeVector.hh"
 #include "Geant4/G4Track.hh"
@@ -28,6 +30,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath> // std::sqrt()
 
 //const G4bool debug = false; // unused
 
@@ -38,10 +41,10 @@ bool entra = true;
 
 namespace larg4 {
 
-  // Initialize static members.
-  int ParticleListAction::fCurrentTrackID = sim::NoParticleId;
-  int ParticleListAction::fCurrentPdgCode = 0;
-  int ParticleListAction::fTrackIDOffset = 0;
+  // Initialize static members (one copy per thread).
+  thread_local int ParticleListAction::fCurrentTrackID = sim::NoParticleId;
+  thread_local int ParticleListAction::fCurrentPdgCode = 0;
+  thread_local int ParticleListAction::fTrackIDOffset = 0;
 
   //----------------------------------------------------------------------------
   // Dropped particle test
@@ -72,34 +75,64 @@ namespace larg4 {
   {
     // Clear any previous particle information.
     fCurrentParticle.clear();
+    fThinningWindow.clear();
     if (fparticleList) fparticleList->clear();
-    fParentIDMap.clear();
+    fParentIDs.clear(); // keeps the capacity for the next event
+    fParentIDBase = fTrackIDOffset;
     fCurrentTrackID = sim::NoParticleId;
     fCurrentPdgCode = 0;
   }
 
+  //-------------------------------------------------------------
+  int*
+  ParticleListAction::ParentIDEntry(int trackID)
+  {
+    // track IDs are dense within a Geant4 event, starting after the offset
+    int const index = trackID - fParentIDBase;
+    if ((index < 0) || (static_cast<std::size_t>(index) >= fParentIDs.size())) return nullptr;
+    int& entry = fParentIDs[index];
+    return (entry == NoParentEntry) ? nullptr : &entry;
+  }
+
+  //-------------------------------------------------------------
+  void
+  ParticleListAction::SetParentID(int trackID, int parentID)
+  {
+    int const index = trackID - fParentIDBase;
+    assert(index >= 0);
+    if (static_cast<std::size_t>(index) >= fParentIDs.size())
+      fParentIDs.resize(index + 1, NoParentEntry);
+    fParentIDs[index] = parentID;
+  }
+
   //-------------------------------------------------------------
   // figure out the ultimate parentage of the particle with track ID
   // trackid
   // assume that the current track id has already been added to
-  // the fParentIDMap
+  // the fParentIDs
   int
-  ParticleListAction::GetParentage(int trackid) const
+  ParticleListAction::GetParentage(int trackid)
   {
     int parentid = sim::NoParticleId;
 
-    // search the fParentIDMap recursively until we have the parent id
+    // search the fParentIDs recursively until we have the parent id
     // of the first EM particle that led to this one
-    std::map<int, int>::const_iterator itr = fParentIDMap.find(trackid);
-    while (itr != fParentIDMap.end()) {
-      MF_LOG_DEBUG("ParticleListAction") << "parentage for " << trackid << " " << (*itr).second;
-
+    for (int const* entry = ParentIDEntry(trackid); entry; entry = ParentIDEntry(parentid)) {
       // set the parentid to the current parent ID, when the loop ends
       // this id will be the first EM particle
-      parentid = (*itr).second;
-      itr = fParentIDMap.find(parentid);
+      parentid = *entry;
+    }
+    MF_LOG_DEBUG("ParticleListAction") << "final parent ID for " << trackid << ": " << parentid;
+
+    // the ultimate parent was tracked before its descendents and it is not
+    // dropped, so it is safe to have all the walked chain point straight to it
+    if (parentid != sim::NoParticleId) {
+      for (int* entry = ParentIDEntry(trackid); entry && (*entry != parentid);) {
+        int const next = *entry;
+        *entry = parentid;
+        entry = ParentIDEntry(next);
+      }
     }
-    MF_LOG_DEBUG("ParticleListAction") << "final parent ID " << parentid;
 
     return parentid;
   }
@@ -109,6 +142,8 @@ namespace larg4 {
   void
   ParticleListAction::PreTrackingAction(const G4Track* track)
   {
+    SimulationProfile::Scope const timer{SimulationProfile::ParticleList};
+
     // Particle type.
     G4ParticleDefinition* particleDefinition = track->GetDefinition();
     G4int pdgCode = particleDefinition->GetPDGEncoding();
@@ -174,8 +209,8 @@ namespace larg4 {
                                       process_name.find("annihil") != std::string::npos)) {
 
         // figure out the ultimate parentage of this particle
-        // first add this track id and its parent to the fParentIDMap
-        fParentIDMap[trackID] = parentID;
+        // first add this track id and its parent to the fParentIDs
+        SetParentID(trackID, parentID);
 
         fCurrentTrackID = -1 * this->GetParentage(trackID);
 
@@ -203,7 +238,7 @@ namespace larg4 {
 
         // do add the particle to the parent id map though
         // and set the current track id to be it's ultimate parent
-        fParentIDMap[trackID] = parentID;
+        SetParentID(trackID, parentID);
 
         fCurrentTrackID = -1 * this->GetParentage(trackID);
 
@@ -211,20 +246,20 @@ namespace larg4 {
       }
 
       // check to see if the parent particle has been stored in the particle navigator
-      // if not, then see if it is possible to walk up the fParentIDMap to find the
+      // if not, then see if it is possible to walk up the fParentIDs to find the
       // ultimate parent of this particle.  Use that ID as the parent ID for this
       // particle
       if (!fparticleList->KnownParticle(parentID)) {
         // do add the particle to the parent id map
         // just in case it makes a daughter that we have to track as well
-        fParentIDMap[trackID] = parentID;
+        SetParentID(trackID, parentID);
         int pid = this->GetParentage(parentID);
 
         // if we still can't find the parent in the particle navigator,
         // we have to give up
         if (!fparticleList->KnownParticle(pid)) {
           MF_LOG_WARNING("ParticleListAction")
-            << "can't find parent id: " << parentID << " in the particle list, or fParentIDMap."
+            << "can't find parent id: " << parentID << " in the particle list, or fParentIDs."
             << " Make " << parentID << " the mother ID for"
             << " track ID " << fCurrentTrackID << " in the hope that it will aid debugging.";
         }
@@ -259,9 +294,14 @@ namespace larg4 {
   void
   ParticleListAction::PostTrackingAction(const G4Track* aTrack)
   {
+    SimulationProfile::Scope const timer{SimulationProfile::ParticleList};
+
     if (!fCurrentParticle.hasParticle()) return;
     assert(fparticleList);
 
+    // the end of the track is always stored
+    FlushThinningWindow();
+
     // if we have found no reason to keep it, drop it!
     // (we might still need parentage information though)
     if (!fCurrentParticle.keep) {
@@ -280,7 +320,10 @@ namespace larg4 {
 
     // store truth record pointer, only if it is available
     if (fCurrentParticle.isPrimary()) {
-      fPrimaryTruthMap[fCurrentParticle.particle->TrackId()] = fCurrentParticle.truthInfoIndex();
+      std::size_t const trackID = fCurrentParticle.particle->TrackId();
+      if (trackID >= fPrimaryTruthIndices.size())
+        fPrimaryTruthIndices.resize(trackID + 1, simb::NoGeneratedParticleIndex);
+      fPrimaryTruthIndices[trackID] = fCurrentParticle.truthInfoIndex();
     }
 
     return;
@@ -291,6 +334,8 @@ namespace larg4 {
   void
   ParticleListAction::SteppingAction(const G4Step* step)
   {
+    SimulationProfile::Scope const timer{SimulationProfile::ParticleList};
+    SimulationProfile::CountStep(step->GetPreStepPoint()->GetPhysicalVolume());
 
     if (!fCurrentParticle.hasParticle()) { return; }
 
@@ -375,8 +420,12 @@ namespace larg4 {
                              momentum.z() / CLHEP::GeV,
                              energy / CLHEP::GeV);
 
-      // Add another point in the trajectory.
-      AddPointToCurrentParticle(fourPos, fourMom, std::string(process));
+      // Add another point in the trajectory; boundary and interaction
+      // points can't be thinned away
+      bool const mustStore = (postStepPoint->GetStepStatus() == fGeomBoundary) ||
+                             (postStepPoint->GetStepStatus() == fWorldBoundary) ||
+                             !step->GetSecondaryInCurrentStep()->empty();
+      AddPointToCurrentParticle(fourPos, fourMom, std::string(process), mustStore);
     }
   }
 
@@ -439,6 +488,8 @@ namespace larg4 {
   void
   ParticleListAction::EndOfEventAction(const G4Event*)
   {
+    SimulationProfile::Scope const timer{SimulationProfile::ParticleList};
+
     if (!fparticleList) return;
 
     // Set up the utility class for the "for_each" algorithm.  (We only
@@ -477,10 +528,23 @@ namespace larg4 {
   simb::GeneratedParticleIndex_t
   ParticleListAction::GetPrimaryTruthIndex(int trackId) const
   {
-    auto const iInfo = GetPrimaryTruthMap().find(trackId);
-    return (iInfo == GetPrimaryTruthMap().end()) ? simb::NoGeneratedParticleIndex : iInfo->second;
+    return ((trackId < 0) || (static_cast<std::size_t>(trackId) >= fPrimaryTruthIndices.size())) ?
+             simb::NoGeneratedParticleIndex :
+             fPrimaryTruthIndices[trackId];
   } // ParticleListAction::GetPrimaryTruthIndex()
 
+  //----------------------------------------------------------------------------
+  std::map<int, simb::GeneratedParticleIndex_t>
+  ParticleListAction::GetPrimaryTruthMap() const
+  {
+    std::map<int, GeneratedParticleIndex_t> truthMap;
+    for (std::size_t trackID = 0; trackID < fPrimaryTruthIndices.size(); ++trackID) {
+      if (simb::isGeneratedParticleIndex(fPrimaryTruthIndices[trackID]))
+        truthMap.emplace(trackID, fPrimaryTruthIndices[trackID]);
+    }
+    return truthMap;
+  } // ParticleListAction::GetPrimaryTruthMap()
+
   //----------------------------------------------------------------------------
   // Yields the ParticleList accumulated during the current event.
   sim::ParticleList&&
@@ -504,15 +568,57 @@ namespace larg4 {
     return std::move(*fparticleList);
   } // ParticleList&& ParticleListAction::YieldList()
 
+  //----------------------------------------------------------------------------
+  namespace {
+
+    /// Returns the square of the distance of `p` from the segment `a`-`b`.
+    double
+    distance2FromSegment(TLorentzVector const& p, TLorentzVector const& a, TLorentzVector const& b)
+    {
+      TVector3 const ab = b.Vect() - a.Vect();
+      TVector3 const ap = p.Vect() - a.Vect();
+      double const ab2 = ab.Mag2();
+      double const t = (ab2 > 0.0) ? std::clamp(ap.Dot(ab) / ab2, 0.0, 1.0) : 0.0;
+      return (ap - t * ab).Mag2();
+    }
+
+  } // local namespace
+
   //----------------------------------------------------------------------------
   void
   ParticleListAction::AddPointToCurrentParticle(TLorentzVector const& pos,
                                                 TLorentzVector const& mom,
-                                                std::string const& process)
+                                                std::string const& process,
+                                                bool mustStore /* = true */)
   {
+    simb::MCParticle& particle = *fCurrentParticle.particle;
 
-    // Add the first point in the trajectory.
-    fCurrentParticle.particle->AddTrajectoryPoint(pos, mom, process);
+    if ((fTrajectoryTolerance <= 0.0) || (particle.NumberTrajectoryPoints() == 0)) {
+      // Add the point in the trajectory.
+      particle.AddTrajectoryPoint(pos, mom, process);
+    }
+    else {
+      // if the straight line from the last stored point to this one misses
+      // any of the points in between, the last of those is needed
+      if (!fThinningWindow.empty()) {
+        TLorentzVector const& last = particle.Position(particle.NumberTrajectoryPoints() - 1);
+        double const tolerance2 = fTrajectoryTolerance * fTrajectoryTolerance;
+        bool const covered =
+          std::all_of(fThinningWindow.begin(), fThinningWindow.end(), [&](PendingPoint_t const& p) {
+            return distance2FromSegment(p.pos, last, pos) <= tolerance2;
+          });
+        if (!covered) FlushThinningWindow();
+      }
+      if (mustStore) {
+        // whatever is still waiting is covered by the segment to this point
+        fThinningWindow.clear();
+        particle.AddTrajectoryPoint(pos, mom, process);
+      }
+      else {
+        fThinningWindow.push_back({pos, mom, process});
+        if (fThinningWindow.size() >= MaxThinningWindow) FlushThinningWindow();
+      }
+    }
 
     // also see if we can decide to keep the particle
     if (!fCurrentParticle.keep) fCurrentParticle.keep = fFilter->mustKeep(pos);
@@ -520,5 +626,15 @@ namespace larg4 {
   } // ParticleListAction::AddPointToCurrentParticle()
 
   //----------------------------------------------------------------------------
+  void
+  ParticleListAction::FlushThinningWindow()
+  {
+    if (fThinningWindow.empty()) return;
+    PendingPoint_t const& point = fThinningWindow.back();
+    fCurrentParticle.particle->AddTrajectoryPoint(point.pos, point.mom, point.process);
+    fThinningWindow.clear();
+  } // ParticleListAction::FlushThinningWindow()
+
+  //----------------------------------------------------------------------------
 
 } // namespace LArG4
@@ -26,6 +26,7 @@
 
 #include <map>
 #include <memory>
+#include <vector>
 
 // Forward declarations.
 class G4Event;
@@ -106,6 +107,25 @@ namespace larg4 {
     virtual void PostTrackingAction(const G4Track*);
     virtual void SteppingAction(const G4Step*);
 
+    /**
+     * @brief Sets the tolerance of the online trajectory thinning.
+     * @param tolerance maximum distance of a dropped point from the stored
+     *                  trajectory [cm]; `0` disables the thinning
+     *
+     * With a positive tolerance, a trajectory point is stored only when the
+     * straight segment from the previous stored point to the next one would
+     * pass farther than `tolerance` from an intermediate point (an "opening
+     * window" version of Douglas-Peucker simplification). The first and last
+     * points, the points on a volume boundary and the ones of steps
+     * producing secondaries are always stored. Only the points after the
+     * last stored one are buffered.
+     */
+    void
+    SetTrajectoryTolerance(double tolerance)
+    {
+      fTrajectoryTolerance = tolerance;
+    }
+
     /// Grabs a particle filter
     void
     ParticleFilter(std::unique_ptr<util::PositionInVolumeFilter>&& filter)
@@ -125,10 +145,12 @@ namespace larg4 {
       return fCurrentPdgCode;
     }
 
+    /// Prepares for a new collection of interactions (a new _art_ event).
     void
     ResetTrackIDOffset()
     {
       fTrackIDOffset = 0;
+      fPrimaryTruthIndices.clear(); // track IDs start over
     }
 
     // Returns the ParticleList accumulated during the current event.
@@ -136,11 +158,7 @@ namespace larg4 {
 
     /// Returns a map of truth record information index for each of the primary
     /// particles (by track ID).
-    std::map<int, GeneratedParticleIndex_t> const&
-    GetPrimaryTruthMap() const
-    {
-      return fPrimaryTruthMap;
-    }
+    std::map<int, GeneratedParticleIndex_t> GetPrimaryTruthMap() const;
 
     /// Returns whether a particle list is being kept.
     bool
@@ -159,9 +177,18 @@ namespace larg4 {
     static bool isDropped(simb::MCParticle const* p);
 
   private:
-    // this method will loop over the fParentIDMap to get the
-    // parentage of the provided trackid
-    int GetParentage(int trackid) const;
+    /// Value in `fParentIDs` of the tracks not in the parentage chains.
+    static constexpr int NoParentEntry = -1;
+
+    // this method will walk the fParentIDs to get the
+    // parentage of the provided trackid, shortening the chains it walks
+    int GetParentage(int trackid);
+
+    /// Records `parentID` as the parent of the dropped track `trackID`.
+    void SetParentID(int trackID, int parentID);
+
+    /// Returns the `fParentIDs` entry of `trackID`, `nullptr` if none.
+    int* ParentIDEntry(int trackID);
 
     G4double fenergyCut;             ///< The minimum energy for a particle to
                                      ///< be included in the list.
@@ -170,23 +197,51 @@ namespace larg4 {
     std::unique_ptr<sim::ParticleList> fparticleList; ///< The accumulated particle information for
                                                       ///< all particles in the event.
     G4bool fstoreTrajectories;       ///< Whether to store particle trajectories with each particle.
-    std::map<int, int> fParentIDMap; ///< key is current track ID, value is parent ID
-    static int fCurrentTrackID;      ///< track ID of the current particle, set to eve ID
-                                     ///< for EM shower particles
-    static int fCurrentPdgCode;      ///< pdg code of current particle
-    static int fTrackIDOffset;       ///< offset added to track ids when running over
-                                     ///< multiple MCTruth objects.
+    /// Parent ID of each dropped track of the current Geant4 event, indexed by
+    /// track ID minus `fParentIDBase` (`NoParentEntry` for the other tracks);
+    /// entries may point directly to an older ancestor, which is the same for
+    /// the purpose of `GetParentage()`.
+    std::vector<int> fParentIDs;
+    int fParentIDBase = 0; ///< Track ID offset of the current Geant4 event.
+    // the current particle is the one tracked by the calling thread
+    static thread_local int fCurrentTrackID; ///< track ID of the current particle, set to eve ID
+                                             ///< for EM shower particles
+    static thread_local int fCurrentPdgCode; ///< pdg code of current particle
+    static thread_local int fTrackIDOffset;  ///< offset added to track ids when running over
+                                             ///< multiple MCTruth objects.
     bool fKeepEMShowerDaughters;     ///< whether to keep EM shower secondaries, tertiaries, etc
 
     std::unique_ptr<util::PositionInVolumeFilter> fFilter; ///< filter for particles to be kept
 
-    /// Map: particle track ID -> index of primary information in MC truth.
-    std::map<int, GeneratedParticleIndex_t> fPrimaryTruthMap;
+    /// Index of primary information in MC truth, by particle track ID
+    /// (`simb::NoGeneratedParticleIndex` for non-primary particles).
+    std::vector<GeneratedParticleIndex_t> fPrimaryTruthIndices;
+
+    /// A trajectory point not stored yet.
+    struct PendingPoint_t {
+      TLorentzVector pos;
+      TLorentzVector mom;
+      std::string process;
+    };
+
+    /// Largest number of points waiting for the thinning decision.
+    static constexpr std::size_t MaxThinningWindow = 256U;
 
-    /// Adds a trajectory point to the current particle, and runs the filter
+    double fTrajectoryTolerance = 0.0; ///< Trajectory thinning tolerance [cm].
+
+    /// Points of the current particle after its last stored one; all are
+    /// within tolerance from the segment joining that one to the last of them.
+    std::vector<PendingPoint_t> fThinningWindow;
+
+    /// Adds a trajectory point to the current particle, and runs the filter;
+    /// unless `mustStore`, the point may be dropped by the thinning.
     void AddPointToCurrentParticle(TLorentzVector const& pos,
                                    TLorentzVector const& mom,
-                                   std::string const& process);
+                                   std::string const& process,
+                                   bool mustStore = true);
+
+    /// Stores the last point waiting for the thinning decision, if any.
+    void FlushThinningWindow();
   };
 
 } // namespace LArG4
@@ -0,0 +1,194 @@
+/**
+ * @file   larsim/LegacyLArG4/SimulationProfile.cxx
+ * @brief  Time and step counters of the stages of `LArG4` simulation.
+ * @see    larsim/LegacyLArG4/SimulationProfile.h
+ */
+
+#include "larsim/LegacyLArG4/SimulationProfile.h"
+
+#include "Geant4/G4LogicalVolume.hh"
+#include "Geant4/G4Region.hh"
+#include "Geant4/G4VPhysicalVolume.hh"
+
+// C/C++ standard libraries
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+  /// All the profiles, one per thread, and the lock protecting their list.
+  std::mutex gSimulationProfilesMutex;
+  std::vector<std::unique_ptr<larg4::SimulationProfile>> gSimulationProfiles;
+
+  /// Writes `s` as a JSON string.
+  void
+  writeJSONstring(std::ostream& out, std::string const& s)
+  {
+    out << '"';
+    for (char c : s) {
+      if ((c == '"') || (c == '\\'))
+        out << '\\' << c;
+      else if (static_cast<unsigned char>(c) < 0x20)
+        out << ' ';
+      else
+        out << c;
+    }
+    out << '"';
+  }
+
+  double
+  toSeconds(larg4::SimulationProfile::Clock_t::duration d)
+  {
+    return std::chrono::duration<double>(d).count();
+  }
+
+} // local namespace
+
+namespace larg4 {
+
+  std::atomic<bool> SimulationProfile::fEnabled{false};
+
+  thread_local SimulationProfile* TheSimulationProfile = nullptr;
+
+  //--------------------------------------------------
+  SimulationProfile*
+  SimulationProfile::Instance()
+  {
+    if (!TheSimulationProfile) {
+      std::lock_guard<std::mutex> lock(gSimulationProfilesMutex);
+      gSimulationProfiles.emplace_back(new SimulationProfile);
+      TheSimulationProfile = gSimulationProfiles.back().get();
+    }
+    return TheSimulationProfile;
+  }
+
+  //--------------------------------------------------
+  SimulationProfile
+  SimulationProfile::YieldThreadProfiles()
+  {
+    SimulationProfile total;
+    std::lock_guard<std::mutex> lock(gSimulationProfilesMutex);
+    for (auto& profile : gSimulationProfiles) {
+      total.Merge(*profile);
+      profile->Clear();
+    }
+    return total;
+  }
+
+  //--------------------------------------------------
+  void
+  SimulationProfile::Merge(SimulationProfile const& other)
+  {
+    for (std::size_t i = 0; i < NStages; ++i) {
+      fStages[i].calls += other.fStages[i].calls;
+      fStages[i].time += other.fStages[i].time;
+    }
+    for (auto const& [volume, n] : other.fStepsByVolume)
+      fStepsByVolume[volume] += n;
+    fEvents += other.fEvents;
+  }
+
+  //--------------------------------------------------
+  void
+  SimulationProfile::Clear()
+  {
+    fStages.fill(StageStats_t{});
+    fStepsByVolume.clear();
+    fEvents = 0U;
+  }
+
+  //--------------------------------------------------
+  std::map<std::string, unsigned long long>
+  SimulationProfile::StepsByVolumeName() const
+  {
+    // different placements of the same volume share the name
+    std::map<std::string, unsigned long long> steps;
+    for (auto const& [volume, n] : fStepsByVolume)
+      steps[volume ? std::string(volume->GetName()) : std::string("<none>")] += n;
+    return steps;
+  }
+
+  //--------------------------------------------------
+  std::map<std::string, unsigned long long>
+  SimulationProfile::StepsByRegionName() const
+  {
+    std::map<std::string, unsigned long long> steps;
+    for (auto const& [volume, n] : fStepsByVolume) {
+      G4LogicalVolume const* logical = volume ? volume->GetLogicalVolume() : nullptr;
+      G4Region const* region = logical ? logical->GetRegion() : nullptr;
+      steps[region ? std::string(region->GetName()) : std::string("<none>")] += n;
+    }
+    return steps;
+  }
+
+  //--------------------------------------------------
+  void
+  SimulationProfile::Dump(std::ostream& out, std::string const& indent) const
+  {
+    out << indent << "Simulation profile of " << fEvents << " events:";
+    for (std::size_t i = 0; i < NStages; ++i) {
+      StageStats_t const& stats = fStages[i];
+      out << "\n"
+          << indent << "  " << std::setw(18) << std::left << StageName(Stage_t(i)) << std::right
+          << std::setw(12) << stats.calls << " calls " << std::setw(12) << toSeconds(stats.time)
+          << " s";
+    }
+    auto const steps = StepsByVolumeName();
+    if (steps.empty()) return;
+    out << "\n" << indent << "Steps per volume:";
+    for (auto const& [name, n] : steps)
+      out << "\n" << indent << "  " << name << ": " << n;
+    out << "\n" << indent << "Steps per region:";
+    for (auto const& [name, n] : StepsByRegionName())
+      out << "\n" << indent << "  " << name << ": " << n;
+  }
+
+  //--------------------------------------------------
+  void
+  SimulationProfile::WriteJSON(std::ostream& out) const
+  {
+    out << "{\n  \"events\": " << fEvents << ",\n  \"stages\": {";
+    for (std::size_t i = 0; i < NStages; ++i) {
+      StageStats_t const& stats = fStages[i];
+      out << (i ? ",\n    " : "\n    ");
+      writeJSONstring(out, StageName(Stage_t(i)));
+      out << ": { \"calls\": " << stats.calls << ", \"seconds\": " << std::setprecision(9)
+          << toSeconds(stats.time) << " }";
+    }
+    out << "\n  },\n  \"stepsPerVolume\": {";
+    bool first = true;
+    for (auto const& [name, n] : StepsByVolumeName()) {
+      out << (first ? "\n    " : ",\n    ");
+      writeJSONstring(out, name);
+      out << ": " << n;
+      first = false;
+    }
+    out << "\n  },\n  \"stepsPerRegion\": {";
+    first = true;
+    for (auto const& [name, n] : StepsByRegionName()) {
+      out << (first ? "\n    " : ",\n    ");
+      writeJSONstring(out, name);
+      out << ": " << n;
+      first = false;
+    }
+    out << "\n  }\n}\n";
+  }
+
+  //--------------------------------------------------
+  char const*
+  SimulationProfile::StageName(Stage_t stage)
+  {
+    switch (stage) {
+    case G4Tracking: return "G4Tracking";
+    case ParticleList: return "ParticleList";
+    case VoxelReadout: return "VoxelReadout";
+    case FastScintillation: return "FastScintillation";
+    case ProductConversion: return "ProductConversion";
+    case NStages: break;
+    }
+    return "<unknown>";
+  }
+
+} // namespace larg4
@@ -0,0 +1,186 @@
+/**
+ * @file   larsim/LegacyLArG4/SimulationProfile.h
+ * @brief  Time and step counters of the stages of `LArG4` simulation.
+ * @see    larsim/LegacyLArG4/SimulationProfile.cxx
+ *
+ * The counters are collected only after `SimulationProfile::Enable()` is
+ * called; otherwise the instrumentation costs one flag check per call.
+ *
+ * Like `OpDetPhotonTable`, there is one profile per thread: `Instance()`
+ * returns the one of the calling thread, and `YieldThreadProfiles()` collects
+ * (and resets) the content of all of them.
+ */
+
+#ifndef LARSIM_LEGACYLARG4_SIMULATIONPROFILE_H
+#define LARSIM_LEGACYLARG4_SIMULATIONPROFILE_H
+
+// C/C++ standard libraries
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+class G4VPhysicalVolume;
+
+namespace larg4 {
+
+  /**
+   * @brief Accumulates time and number of calls per simulation stage.
+   *
+   * The stages are timed including everything they call, so the time of
+   * `G4Tracking` includes the time of `ParticleList`, `VoxelReadout` and
+   * `FastScintillation`, which happen while Geant4 is tracking.
+   *
+   * The number of Geant4 steps is also counted for each physical volume
+   * (per the pre-step point).
+   */
+  class SimulationProfile {
+  public:
+    using Clock_t = std::chrono::steady_clock;
+
+    /// The stages being timed.
+    enum Stage_t : std::size_t {
+      G4Tracking,        ///< Geant4 run of one interaction (`G4Helper::G4Run()`)
+      ParticleList,      ///< `ParticleListAction` bookkeeping
+      VoxelReadout,      ///< `LArVoxelReadout::ProcessHits()`
+      FastScintillation, ///< `OpFastScintillation::RecordPhotonsProduced()`
+      ProductConversion, ///< conversion of the simulation output into data products
+      NStages
+    };
+
+    /// Counters of a single stage.
+    struct StageStats_t {
+      unsigned long long calls = 0;
+      Clock_t::duration time{0};
+    };
+
+    /// Times a stage from construction to destruction (or `Stop()`).
+    class Scope {
+    public:
+      explicit Scope(Stage_t stage)
+        : fStage(stage), fProfile(isEnabled() ? Instance() : nullptr)
+      {
+        if (fProfile) fStart = Clock_t::now();
+      }
+
+      Scope(Scope const&) = delete;
+      Scope& operator=(Scope const&) = delete;
+
+      ~Scope() { Stop(); }
+
+      /// Records the time elapsed so far; later calls have no effect.
+      void
+      Stop()
+      {
+        if (!fProfile) return;
+        fProfile->AddTime(fStage, Clock_t::now() - fStart);
+        fProfile = nullptr;
+      }
+
+    private:
+      Stage_t fStage;
+      SimulationProfile* fProfile;
+      Clock_t::time_point fStart;
+    }; // Scope
+
+    /// Returns the profile of the calling thread.
+    static SimulationProfile* Instance();
+
+    /// Starts (or stops) collecting the counters in all threads.
+    static void
+    Enable(bool enable = true)
+    {
+      fEnabled.store(enable, std::memory_order_relaxed);
+    }
+
+    /// Returns whether the counters are being collected.
+    static bool
+    isEnabled()
+    {
+      return fEnabled.load(std::memory_order_relaxed);
+    }
+
+    /// Counts a step in `volume` in the profile of the calling thread.
+    static void
+    CountStep(G4VPhysicalVolume const* volume)
+    {
+      if (isEnabled()) Instance()->AddStep(volume);
+    }
+
+    /// Returns the sum of the profiles of all threads, and resets them.
+    static SimulationProfile YieldThreadProfiles();
+
+    /// Adds one call of `stage` lasting `time`.
+    void
+    AddTime(Stage_t stage, Clock_t::duration time)
+    {
+      StageStats_t& stats = fStages[stage];
+      ++stats.calls;
+      stats.time += time;
+    }
+
+    /// Adds one step in `volume`.
+    void
+    AddStep(G4VPhysicalVolume const* volume)
+    {
+      ++fStepsByVolume[volume];
+    }
+
+    /// Adds the counters and the events of `other`.
+    void Merge(SimulationProfile const& other);
+
+    /// Adds `n` to the number of processed events.
+    void
+    AddEvents(unsigned int n = 1U)
+    {
+      fEvents += n;
+    }
+
+    /// Resets all the counters.
+    void Clear();
+
+    /// Returns the counters of `stage`.
+    StageStats_t const&
+    Stage(Stage_t stage) const
+    {
+      return fStages[stage];
+    }
+
+    /// Returns the number of steps, by physical volume name.
+    std::map<std::string, unsigned long long> StepsByVolumeName() const;
+
+    /// Returns the number of steps, by name of the Geant4 region of the volume.
+    std::map<std::string, unsigned long long> StepsByRegionName() const;
+
+    /// Returns the number of processed events.
+    unsigned int
+    Events() const
+    {
+      return fEvents;
+    }
+
+    /// Prints a summary, one line per stage, per volume and per region.
+    void Dump(std::ostream& out, std::string const& indent = "") const;
+
+    /// Writes the counters as a JSON object.
+    void WriteJSON(std::ostream& out) const;
+
+    /// Returns the name of the specified stage.
+    static char const* StageName(Stage_t stage);
+
+  private:
+    static std::atomic<bool> fEnabled;
+
+    std::array<StageStats_t, NStages> fStages;
+    std::unordered_map<G4VPhysicalVolume const*, unsigned long long> fStepsByVolume;
+    unsigned int fEvents = 0U;
+
+  }; // class SimulationProfile
+
+} // namespace larg4
+
+#endif // LARSIM_LEGACYLARG4_SIMULATIONPROFILE_H
@@ -18,6 +18,10 @@
 #include "larcorealg/Geometry/GeometryCore.h"
 #include "larcoreobj/SimpleTypesAndConstants/geo_types.h"
 #include "lardataalg/DetectorInfo/DetectorClocks.h"
+#include "larsim/Utils/TraceZones.h"
+
+#include <algorithm>
+#include <cstdlib>
 
 namespace cheat {
 
@@ -29,6 +33,7 @@ namespace cheat {
     , fGeom(geom)
     , fG4ModuleLabel(config.G4ModuleLabel())
     , fSimChannelModuleLabel(config.SimChannelModuleLabel())
+    , fCompactSimChannelModuleLabel(config.CompactSimChannelModuleLabel())
     , fHitLabel(config.DefaultHitModuleLabel())
     , fMinHitEnergyFraction(config.MinHitEnergyFraction())
     , fOverrideRealData(config.OverrideRealData())
@@ -44,7 +49,8 @@ namespace cheat {
     , fG4ModuleLabel(pSet.get<art::InputTag>("G4ModuleLabel", "largeant"))
     , fSimChannelModuleLabel(pSet.get<art::InputTag>("SimChannelModuleLabel", fG4ModuleLabel))
     , // -- D.R. if not provided, default behavior is to use the G4ModuleLabel
-    fHitLabel(pSet.get<art::InputTag>("DefaultHitModuleLabel", "hitfd"))
+    fCompactSimChannelModuleLabel(pSet.get<art::InputTag>("CompactSimChannelModuleLabel", {}))
+    , fHitLabel(pSet.get<art::InputTag>("DefaultHitModuleLabel", "hitfd"))
     , fMinHitEnergyFraction(pSet.get<double>("MinHitEnergyFraction", 0.010))
     , fOverrideRealData(pSet.get<bool>("OverrideRealData", false))
     , fHitTimeRMS(pSet.get<double>("HitTimeRMS", 1.0))
@@ -55,30 +61,88 @@ namespace cheat {
   BackTracker::ClearEvent()
   {
     fSimChannels.clear();
+    fExpandedSimChannels.clear();
+    ClearSimChannelIndex();
+    fTrackIDECache.clear();
+    fEveIDECache.clear();
+    fSimIDECache.clear();
+    fSpacePointHits.clear();
+    fSpacePointHitsReady = false;
+    fHitSimIDEs.clear();
+    fHitSimIDERanges.clear();
     //    fAllHitList.clear();
   }
 
+  //-----------------------------------------------------------------------
+  BackTracker::TDCWindow_t
+  BackTracker::TDCWindow(detinfo::DetectorClocksData const& clockData,
+                         raw::ChannelID_t channel,
+                         double start_time,
+                         double end_time) const
+  {
+    int start_tdc = clockData.TPCTick2TDC(start_time);
+    int end_tdc = clockData.TPCTick2TDC(end_time);
+    if (start_tdc < 0) start_tdc = 0;
+    if (end_tdc < 0) end_tdc = 0;
+    return {channel, start_tdc, end_tdc};
+  }
+
+  //-----------------------------------------------------------------------
+  void
+  BackTracker::ClearSimChannelIndex()
+  {
+    fChannelToSimChannel.clear();
+    fSortedTDCIDEs.clear();
+    fTrackIDEs.clear();
+  }
+
+  //-----------------------------------------------------------------------
+  void
+  BackTracker::BuildSimChannelIndex()
+  {
+    LARSIM_TRACE_ZONE("BackTracker::BuildSimChannelIndex");
+    // fSimChannels is sorted by channel; the tables follow the same order,
+    // so that the queries return their results in the order a scan would
+    ClearSimChannelIndex();
+    if (fSimChannels.empty()) return;
+
+    // a direct channel lookup table is used when channel IDs are not too sparse,
+    // otherwise FindSimChannelPtr() falls back to a binary search
+    raw::ChannelID_t const maxChannel = fSimChannels.back()->Channel();
+    if (maxChannel / 8 < fSimChannels.size()) {
+      fChannelToSimChannel.assign(std::size_t(maxChannel) + 1, NoSimChannel);
+      for (std::size_t sc = 0; sc < fSimChannels.size(); ++sc)
+        fChannelToSimChannel[fSimChannels[sc]->Channel()] = sc;
+    }
+
+    auto pairSort = [](const sim::TDCIDE* a, const sim::TDCIDE* b) { return a->first < b->first; };
+    fSortedTDCIDEs.resize(fSimChannels.size());
+    for (std::size_t sc = 0; sc < fSimChannels.size(); ++sc) {
+      raw::ChannelID_t const channel = fSimChannels[sc]->Channel();
+      const auto& tdcidemap = fSimChannels[sc]->TDCIDEMap();
+      std::vector<const sim::TDCIDE*>& sorted = fSortedTDCIDEs[sc];
+      sorted.reserve(tdcidemap.size());
+      for (const sim::TDCIDE& item : tdcidemap) {
+        sorted.push_back(&item);
+        for (const sim::IDE& ide : item.second)
+          fTrackIDEs[std::abs(ide.trackID)].push_back({channel, item.first, &ide});
+      }
+      // the track lists keep the original TDCIDEMap order, as the scan did
+      if (!std::is_sorted(sorted.begin(), sorted.end(), pairSort))
+        std::stable_sort(sorted.begin(), sorted.end(), pairSort);
+    }
+  }
+
   //-----------------------------------------------------------------------
   std::vector<const sim::IDE*>
   BackTracker::TrackIdToSimIDEs_Ps(int const& id) const
   {
     std::vector<const sim::IDE*> ideps;
-    for (size_t sc = 0; sc < fSimChannels.size(); ++sc) {
-      const auto& tdcidemap = fSimChannels[sc]->TDCIDEMap(); // This returns a reference.
-      // loop over the IDEMAP
-      for (auto mapitr = tdcidemap.begin(); mapitr != tdcidemap.end(); mapitr++) {
-        // loop over the vector of IDE objects.
-        const std::vector<sim::IDE>& idevec =
-          (*mapitr).second; // note, mapitr.second returns the actual data from
-                            // the map, not a copy
-        for (size_t iv = 0; iv < idevec.size(); ++iv) {
-          // const sim::IDE* const idep = &idevec[iv];
-          // if( abs(idevec[iv].trackID) == id) continue;
-          // ideps.push_back(idep);
-          if (abs(idevec[iv].trackID) == id) ideps.push_back(&(idevec[iv]));
-        } // end for index in idevec
-      }   // end loop over map from sim::SimChannel
-    }     // end loop over sim::SimChannels
+    auto const itrack = fTrackIDEs.find(id);
+    if (itrack == fTrackIDEs.end()) return ideps;
+    ideps.reserve(itrack->second.size());
+    for (const TrackIDERef_t& ref : itrack->second)
+      ideps.push_back(ref.ide);
     return ideps;
   }
 
@@ -87,26 +151,31 @@ namespace cheat {
   BackTracker::TrackIdToSimIDEs_Ps(int const& id, const geo::View_t view) const
   {
     std::vector<const sim::IDE*> ide_Ps;
-    for (const art::Ptr<sim::SimChannel> sc : fSimChannels) {
-      if (fGeom->View(sc->Channel()) != view) continue;
-
-      // loop over the IDEMAP
-      for (const auto& item : sc->TDCIDEMap()) {
-
-        // loop over the vector of IDE objects.
-        for (const sim::IDE& ide : item.second) {
-          if (abs(ide.trackID) == id) ide_Ps.push_back(&ide);
-        }
-      } // end loop over map from sim::SimChannel
-    }   // end loop over sim::SimChannels
+    auto const itrack = fTrackIDEs.find(id);
+    if (itrack == fTrackIDEs.end()) return ide_Ps;
+
+    // the IDEs are grouped by channel: the view is asked once per channel
+    raw::ChannelID_t lastChannel = raw::InvalidChannelID;
+    bool inView = false;
+    for (const TrackIDERef_t& ref : itrack->second) {
+      if (ref.channel != lastChannel) {
+        lastChannel = ref.channel;
+        inView = (fGeom->View(ref.channel) == view);
+      }
+      if (inView) ide_Ps.push_back(ref.ide);
+    } // end loop over the IDEs of the track
 
     return ide_Ps;
   }
 
   //-----------------------------------------------------------------------
-  art::Ptr<sim::SimChannel>
-  BackTracker::FindSimChannelPtr(raw::ChannelID_t channel) const
+  std::size_t
+  BackTracker::SimChannelIndex(raw::ChannelID_t channel) const
   {
+    if (!fChannelToSimChannel.empty()) {
+      return (channel < fChannelToSimChannel.size()) ? fChannelToSimChannel[channel] :
+                                                       NoSimChannel;
+    }
     auto ilb = std::lower_bound(fSimChannels.begin(),
                                 fSimChannels.end(),
                                 channel,
@@ -114,7 +183,15 @@ namespace cheat {
                                   return (a->Channel() < channel);
                                 });
     return ((ilb != fSimChannels.end()) && ((*ilb)->Channel() == channel))
-      ? *ilb: art::Ptr<sim::SimChannel>{};
+      ? std::size_t(ilb - fSimChannels.begin()): NoSimChannel;
+  }
+
+  //-----------------------------------------------------------------------
+  art::Ptr<sim::SimChannel>
+  BackTracker::FindSimChannelPtr(raw::ChannelID_t channel) const
+  {
+    std::size_t const sc = SimChannelIndex(channel);
+    return (sc == NoSimChannel) ? art::Ptr<sim::SimChannel>{} : fSimChannels[sc];
   }
 
   //-----------------------------------------------------------------------
@@ -133,19 +210,28 @@ namespace cheat {
                                   const double hit_start_time,
                                   const double hit_end_time) const
   {
-    art::Ptr<sim::SimChannel> schannel = this->FindSimChannelPtr(channel);
-    if (!schannel) return {};
+    LARSIM_TRACE_ZONE("BackTracker::ChannelToTrackIDEs");
+    TDCWindow_t const window = TDCWindow(clockData, channel, hit_start_time, hit_end_time);
+    {
+      std::lock_guard<std::mutex> const lock{fQueryCacheMutex};
+      auto const cached = fTrackIDECache.find(window);
+      if (cached != fTrackIDECache.end()) return cached->second;
+    }
 
     std::vector<sim::TrackIDE> trackIDEs;
+    art::Ptr<sim::SimChannel> schannel = this->FindSimChannelPtr(channel);
+    if (!schannel) {
+      std::lock_guard<std::mutex> const lock{fQueryCacheMutex};
+      fTrackIDECache.emplace(window, trackIDEs);
+      return trackIDEs;
+    }
+
     double totalE = 0.;
-    
+
     // loop over the electrons in the channel and grab those that are in time
     // with the identified hit start and stop times
-    int start_tdc = clockData.TPCTick2TDC(hit_start_time);
-    int end_tdc = clockData.TPCTick2TDC(hit_end_time);
-    if (start_tdc < 0) start_tdc = 0;
-    if (end_tdc < 0) end_tdc = 0;
-    std::vector<sim::IDE> simides = schannel->TrackIDsAndEnergies(start_tdc, end_tdc);
+    std::vector<sim::IDE> simides =
+      schannel->TrackIDsAndEnergies(window.startTDC, window.endTDC);
 
     // first get the total energy represented by all track ids for
     // this channel and range of tdc values
@@ -170,6 +256,8 @@ namespace cheat {
       trackIDEs.push_back(info);
     }
 
+    std::lock_guard<std::mutex> const lock{fQueryCacheMutex};
+    fTrackIDECache.emplace(window, trackIDEs);
     return trackIDEs;
   }
 
@@ -201,6 +289,13 @@ namespace cheat {
   BackTracker::HitToEveTrackIDEs(detinfo::DetectorClocksData const& clockData,
                                  recob::Hit const& hit) const
   {
+    TDCWindow_t const window = HitTDCWindow(clockData, hit);
+    {
+      std::lock_guard<std::mutex> const lock{fQueryCacheMutex};
+      auto const cached = fEveIDECache.find(window);
+      if (cached != fEveIDECache.end()) return cached->second;
+    }
+
     std::vector<sim::TrackIDE> eveIDEs;
     std::vector<sim::TrackIDE> trackIDEs = this->HitToTrackIDEs(clockData, hit);
     std::map<int, std::pair<double, double>> eveToEMap;
@@ -227,6 +322,8 @@ namespace cheat {
 
       eveIDEs.push_back(eveTrackIDE_tmp);
     } // END eveToEMap loop
+    std::lock_guard<std::mutex> const lock{fQueryCacheMutex};
+    fEveIDECache.emplace(window, eveIDEs);
     return eveIDEs;
   }
 
@@ -236,6 +333,7 @@ namespace cheat {
                                 const int tkId,
                                 std::vector<art::Ptr<recob::Hit>> const& hitsIn) const
   {
+    LARSIM_TRACE_ZONE("BackTracker::TrackIdToHits_Ps");
     // returns a subset of the hits in the hitsIn collection that are matched
     // to the given track
 
@@ -263,6 +361,7 @@ namespace cheat {
                                  std::vector<int> const& tkIds,
                                  std::vector<art::Ptr<recob::Hit>> const& hitsIn) const
   {
+    LARSIM_TRACE_ZONE("BackTracker::TrackIdsToHits_Ps");
     // returns a subset of the hits in the hitsIn collection that are matched
     // to MC particles listed in tkIds
 
@@ -320,34 +419,42 @@ namespace cheat {
   BackTracker::HitToSimIDEs_Ps(detinfo::DetectorClocksData const& clockData,
                                recob::Hit const& hit) const
   {
-    std::vector<const sim::IDE*> retVec;
-    int start_tdc = clockData.TPCTick2TDC(hit.PeakTimeMinusRMS(fHitTimeRMS));
-    int end_tdc = clockData.TPCTick2TDC(hit.PeakTimePlusRMS(fHitTimeRMS));
-    if (start_tdc < 0) start_tdc = 0;
-    if (end_tdc < 0) end_tdc = 0;
+    LARSIM_TRACE_ZONE("BackTracker::HitToSimIDEs_Ps");
+    TDCWindow_t const window = HitTDCWindow(clockData, hit);
+    int const start_tdc = window.startTDC;
+    int const end_tdc = window.endTDC;
 
     if (start_tdc > end_tdc) { throw; }
 
-    const std::vector<std::pair<unsigned short, std::vector<sim::IDE>>>& tdcIDEMap =
-      (this->FindSimChannel(hit.Channel()))
-        ->TDCIDEMap(); // This in fact does not return a std::map. It returns a
-                       // vector... with no guarantee that it is sorted...
-    std::vector<const std::pair<unsigned short, std::vector<sim::IDE>>*> tdcIDEMap_SortedPointers;
-    for (auto& pair : tdcIDEMap) {
-      tdcIDEMap_SortedPointers.push_back(&pair);
+    {
+      std::lock_guard<std::mutex> const lock{fQueryCacheMutex};
+      auto const cached = fSimIDECache.find(window);
+      if (cached != fSimIDECache.end()) return cached->second;
     }
 
-    // This is a bunch of extra steps, due to needing a vector we can sort, and
-    // needing those items in the sorted vector to be the items from the sim
-    // channels (so a pointer to the IDEs inside the sim channels can be made).
-    // The work around is to make a vector of pointers to IDEs inside the
-    // TDCIDEMap (which is a constant reference to the fTDCIDEs in the
-    // SimChannel.)
-    auto pairSort = [](auto& a, auto& b) { return a->first < b->first; };
-    if (!std::is_sorted(
-          tdcIDEMap_SortedPointers.begin(), tdcIDEMap_SortedPointers.end(), pairSort)) {
-      std::sort(tdcIDEMap_SortedPointers.begin(), tdcIDEMap_SortedPointers.end(), pairSort);
+    std::vector<const sim::IDE*> retVec;
+    CollectSimIDEs(window, retVec);
+    std::lock_guard<std::mutex> const lock{fQueryCacheMutex};
+    fSimIDECache.emplace(window, retVec);
+    return retVec;
+  }
+
+  //------------------------------------------------------------------------------
+  void
+  BackTracker::CollectSimIDEs(TDCWindow_t const& window, std::vector<const sim::IDE*>& ides) const
+  {
+    int const start_tdc = window.startTDC;
+    int const end_tdc = window.endTDC;
+
+    // the TDCIDEMap is a vector with no guarantee that it is sorted; the
+    // index keeps pointers to its entries sorted by tick for each channel
+    std::size_t const sc = SimChannelIndex(window.channel);
+    if (sc == NoSimChannel) {
+      throw cet::exception("BackTracker") << "No sim::SimChannel corresponding "
+                                          << "to channel: " << window.channel << "\n";
     }
+    const std::vector<const sim::TDCIDE*>& tdcIDEMap_SortedPointers = fSortedTDCIDEs[sc];
+    auto pairSort = [](auto& a, auto& b) { return a->first < b->first; };
 
     std::vector<sim::IDE> dummyVec; // I need something to stick in a pair to compare pair<tdcVal,
                                     // IDE>. This is an otherwise useless "hack".
@@ -365,10 +472,37 @@ namespace cheat {
       tdcIDEMap_SortedPointers.begin(), tdcIDEMap_SortedPointers.end(), end_tdcPair_P, pairSort);
     for (auto& mapitr = mapFirst; mapitr != mapLast; ++mapitr) {
       for (auto& ide : (*mapitr)->second) {
-        retVec.push_back(&ide);
-      } // Add all interesting IDEs to the retVec
+        ides.push_back(&ide);
+      } // Add all interesting IDEs to the list
     }
-    return retVec;
+  }
+
+  //------------------------------------------------------------------------------
+  std::pair<std::size_t, std::size_t>
+  BackTracker::HitSimIDERange(detinfo::DetectorClocksData const& clockData,
+                              art::Ptr<recob::Hit> const& hit) const
+  {
+    TDCWindow_t const window = HitTDCWindow(clockData, *hit);
+    if (window.startTDC > window.endTDC) {
+      throw cet::exception("BackTracker")
+        << "Hit on channel " << window.channel << " has an empty TDC window [ "
+        << window.startTDC << " ; " << window.endTDC << " ]\n";
+    }
+
+    // hits without a data product (from transient pointers) are not indexed;
+    // an indexed hit is queried again if its clocks changed
+    HitSimIDERange_t* range = nullptr;
+    if (hit.id().isValid()) {
+      std::vector<HitSimIDERange_t>& ranges = fHitSimIDERanges[hit.id()];
+      if (ranges.size() <= hit.key()) ranges.resize(hit.key() + 1);
+      range = &ranges[hit.key()];
+      if (range->indexed && (range->window == window)) return {range->begin, range->end};
+    }
+
+    std::size_t const begin = fHitSimIDEs.size();
+    CollectSimIDEs(window, fHitSimIDEs);
+    if (range) *range = {window, begin, fHitSimIDEs.size(), true};
+    return {begin, fHitSimIDEs.size()};
   }
 
   //------------------------------------------------------------------------------
@@ -397,11 +531,29 @@ namespace cheat {
   std::vector<double>
   BackTracker::SimIDEsToXYZ(std::vector<const sim::IDE*> const& ide_Ps) const
   {
-    std::vector<sim::IDE> ides;
-    for (auto ide_P : ide_Ps) {
-      ides.push_back(*ide_P);
+    return this->SimIDERangeToXYZ(ide_Ps.data(), ide_Ps.data() + ide_Ps.size());
+  }
+
+  //-------------------------------------------------------------------------------
+  std::vector<double>
+  BackTracker::SimIDERangeToXYZ(const sim::IDE* const* begin, const sim::IDE* const* end) const
+  {
+    std::vector<double> xyz(3, 0.0);
+    double w = 0.0;
+    for (auto ide_P = begin; ide_P != end; ++ide_P) {
+      double weight = (*ide_P)->numElectrons;
+      w += weight;
+      xyz[0] += (weight * (*ide_P)->x);
+      xyz[1] += (weight * (*ide_P)->y);
+      xyz[2] += (weight * (*ide_P)->z);
     }
-    return this->SimIDEsToXYZ(ides);
+    if (w < 1.e-5)
+      throw cet::exception("BackTracker") << "No sim::IDEs providing non-zero number of electrons"
+                                          << " can't determine originating location from truth\n";
+    xyz[0] = xyz[0] / w;
+    xyz[1] = xyz[1] / w;
+    xyz[2] = xyz[2] / w;
+    return xyz;
   }
 
   //--------------------------------------------------------------------------------
@@ -528,6 +680,83 @@ namespace cheat {
     return 0.;
   }
 
+  //-----------------------------------------------------------------------------------
+  std::vector<std::vector<BackTracker::HitCollectionMatch>>
+  BackTracker::HitCollectionsMatches(
+    detinfo::DetectorClocksData const& clockData,
+    std::vector<std::vector<art::Ptr<recob::Hit>>> const& hitCollections,
+    std::vector<art::Ptr<recob::Hit>> const& allhits,
+    geo::View_t view) const
+  {
+    // hits and charge of each particle, for each particle counted once per hit;
+    // the energy fraction requirement applies to efficiencies only
+    struct HitCount_t {
+      unsigned int hits = 0U;
+      double charge = 0.;
+      unsigned int effHits = 0U;
+      double effCharge = 0.;
+    };
+
+    // a hit can have more than one entry for the same particle
+    auto const countHit = [this](std::vector<sim::TrackIDE> const& hitTrackIDEs,
+                                 double integral,
+                                 std::map<int, HitCount_t>& counts) {
+      std::vector<int> seen, seenEff;
+      for (const auto& trackIDE : hitTrackIDEs) {
+        if (std::find(seen.begin(), seen.end(), trackIDE.trackID) == seen.end()) {
+          seen.push_back(trackIDE.trackID);
+          HitCount_t& count = counts[trackIDE.trackID];
+          ++count.hits;
+          count.charge += integral;
+        }
+        if (trackIDE.energyFrac < fMinHitEnergyFraction) continue;
+        if (std::find(seenEff.begin(), seenEff.end(), trackIDE.trackID) != seenEff.end())
+          continue;
+        seenEff.push_back(trackIDE.trackID);
+        HitCount_t& count = counts[trackIDE.trackID];
+        ++count.effHits;
+        count.effCharge += integral;
+      }
+    };
+
+    // one pass over all the hits for the denominators of the efficiencies
+    std::map<int, HitCount_t> totals;
+    for (const auto& hit : allhits) {
+      if (hit->View() != view && view != geo::k3D) continue;
+      countHit(this->HitToTrackIDEs(clockData, hit), hit->Integral(), totals);
+    }
+
+    std::vector<std::vector<HitCollectionMatch>> matches;
+    matches.reserve(hitCollections.size());
+    std::map<int, HitCount_t> counts;
+    for (const auto& hits : hitCollections) {
+      counts.clear();
+      double totalCharge = 0.;
+      for (const auto& hit : hits) {
+        totalCharge += hit->Integral();
+        countHit(this->HitToTrackIDEs(clockData, hit), hit->Integral(), counts);
+      }
+
+      std::vector<HitCollectionMatch>& collMatches = matches.emplace_back();
+      collMatches.reserve(counts.size());
+      for (const auto& [trackID, count] : counts) {
+        HitCollectionMatch match;
+        match.trackID = trackID;
+        match.purity = double(count.hits) / double(hits.size());
+        if (totalCharge > 0.) match.chargePurity = count.charge / totalCharge;
+        auto const itotal = totals.find(trackID);
+        if (itotal != totals.end()) {
+          if (itotal->second.effHits > 0U)
+            match.efficiency = double(count.effHits) / double(itotal->second.effHits);
+          if (itotal->second.effCharge > 0.)
+            match.chargeEfficiency = count.effCharge / itotal->second.effCharge;
+        }
+        collMatches.push_back(match);
+      }
+    } // for hit collections
+    return matches;
+  }
+
   //-----------------------------------------------------------------------------------
   std::set<int>
   BackTracker::GetSetOfTrackIds(detinfo::DetectorClocksData const& clockData,
@@ -587,9 +816,15 @@ namespace cheat {
 
       const recob::Hit& hit = **ihit;
 
-      // use the HitToXYZ and Geometry::PositionToTPC
-      // to figure out which drift volume the hit originates from
-      std::vector<double> hitOrigin = this->HitToXYZ(clockData, *ihit);
+      // use the IDEs of the hit and Geometry::PositionToTPC
+      // to figure out which drift volume the hit originates from;
+      // the IDEs of each hit are looked up once in the event
+      std::vector<double> hitOrigin;
+      {
+        std::lock_guard<std::mutex> const lock{fQueryCacheMutex};
+        auto const [begin, end] = this->HitSimIDERange(clockData, *ihit);
+        hitOrigin = this->SimIDERangeToXYZ(fHitSimIDEs.data() + begin, fHitSimIDEs.data() + end);
+      }
       unsigned int cstat = 0;
       unsigned int tpc = 0;
       const double worldLoc[3] = {hitOrigin[0], hitOrigin[1], hitOrigin[2]};
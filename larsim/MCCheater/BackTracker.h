@@ -11,6 +11,12 @@
 #ifndef CHEAT_BACKTRACKER_H
 #define CHEAT_BACKTRACKER_H
 
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "fhiclcpp/types/Atom.h"
@@ -19,7 +25,9 @@
 #include "larcoreobj/SimpleTypesAndConstants/geo_types.h"
 #include "lardataobj/RecoBase/Hit.h"
 #include "lardataobj/Simulation/SimChannel.h"
+#include "lardataobj/Simulation/sim.h"
 #include "larsim/MCCheater/ParticleInventory.h"
+#include "larsim/Simulation/CompactSimChannels.h"
 
 namespace fhicl {
   class ParameterSet;
@@ -50,6 +58,11 @@ namespace cheat {
         fhicl::Comment("The label of the module containing the sim::SimChannel product."),
         G4ModuleLabel()}; // -- D.R. label not required, if not provided
                           // defaults to the value of G4ModuleLabel
+      fhicl::Atom<art::InputTag> CompactSimChannelModuleLabel{
+        fhicl::Name("CompactSimChannelModuleLabel"),
+        fhicl::Comment("If not empty, the label of the sim::CompactSimChannels product to "
+                       "read the channels from, instead of the sim::SimChannel one."),
+        art::InputTag{}};
       fhicl::Atom<art::InputTag> DefaultHitModuleLabel{
         fhicl::Name("DefaultHitModuleLabel"),
         fhicl::Comment("The label  of the module used to produce the hits in the art file "
@@ -72,6 +85,22 @@ namespace cheat {
         1.0};
     };
 
+    /**
+     * @brief Matching of a hit collection with one MC particle.
+     *
+     * The values are the ones `HitCollectionPurity()`,
+     * `HitChargeCollectionPurity()`, `HitCollectionEfficiency()` and
+     * `HitChargeCollectionEfficiency()` return for a set with just `trackID`,
+     * except that efficiencies are `0` when the particle has no hit at all.
+     */
+    struct HitCollectionMatch {
+      int trackID = sim::NoParticleId; ///< Track ID of the MC particle.
+      double purity = 0.;              ///< Fraction of the hits with the particle.
+      double chargePurity = 0.;        ///< Fraction of the hit charge with the particle.
+      double efficiency = 0.;          ///< Fraction of the particle hits in the collection.
+      double chargeEfficiency = 0.;    ///< Fraction of the particle hit charge in the collection.
+    };
+
     BackTracker(const fhiclConfig& config,
                 const cheat::ParticleInventory* partInv,
                 const geo::GeometryCore* geom);
@@ -97,6 +126,8 @@ namespace cheat {
     }
 
     //-----------------------------------------------------
+    /// Returns the hits associated to `spt` (`DefaultHitModuleLabel`); the
+    /// associations are indexed by space point on the first call in the event.
     template <typename Evt>
     std::vector<art::Ptr<recob::Hit>> SpacePointToHits_Ps(art::Ptr<recob::SpacePoint> const& spt,
                                                           const Evt& evt) const;
@@ -238,6 +269,26 @@ namespace cheat {
                                          std::vector<art::Ptr<recob::Hit>> const& allhits,
                                          geo::View_t const& view) const;
 
+    /**
+     * @brief Matches many hit collections with all the MC particles at once.
+     * @param clockData detector clocks for the conversion of hit times
+     * @param hitCollections the hit collections (clusters, tracks...) to match
+     * @param allhits all the hits, for the denominator of the efficiencies
+     * @param view only hits on this view in `allhits` count (`geo::k3D`: all)
+     * @return for each collection, its matching with each MC particle in it
+     *
+     * This is equivalent to calling the purity and efficiency functions for
+     * each collection and each particle, but each of the hits is backtracked
+     * only once. Only the particles contributing to at least one of the hits
+     * of a collection are listed for it, sorted by track ID; the purity and
+     * efficiency with all the other particles are `0`.
+     */
+    std::vector<std::vector<HitCollectionMatch>> HitCollectionsMatches(
+      detinfo::DetectorClocksData const& clockData,
+      std::vector<std::vector<art::Ptr<recob::Hit>>> const& hitCollections,
+      std::vector<art::Ptr<recob::Hit>> const& allhits,
+      geo::View_t view = geo::k3D) const;
+
     std::set<int>
     GetSetOfTrackIds() const
     {
@@ -249,6 +300,13 @@ namespace cheat {
       return fPartInv->GetSetOfEveIds();
     }
 
+    /// Minimum energy fraction of a particle in a hit, for hit efficiencies.
+    double
+    GetMinHitEnergyFraction() const
+    {
+      return fMinHitEnergyFraction;
+    }
+
     std::set<int> GetSetOfTrackIds(detinfo::DetectorClocksData const& clockData,
                                    std::vector<art::Ptr<recob::Hit>> const& hits) const;
     std::set<int> GetSetOfEveIds(detinfo::DetectorClocksData const& clockData,
@@ -263,12 +321,137 @@ namespace cheat {
     const geo::GeometryCore* fGeom;
     const art::InputTag fG4ModuleLabel;
     const art::InputTag fSimChannelModuleLabel;
+    const art::InputTag fCompactSimChannelModuleLabel;
     const art::InputTag fHitLabel;
     const double fMinHitEnergyFraction;
     const bool fOverrideRealData;
     const double fHitTimeRMS;
 
     mutable std::vector<art::Ptr<sim::SimChannel>> fSimChannels;
+    /// Channels expanded from `sim::CompactSimChannels`, which `fSimChannels` points to.
+    mutable std::vector<sim::SimChannel> fExpandedSimChannels;
+
+    /// An IDE of a track, with the channel and tick it was collected at.
+    struct TrackIDERef_t {
+      raw::ChannelID_t channel;
+      unsigned int tdc;
+      const sim::IDE* ide;
+    };
+
+    /// Value in `fChannelToSimChannel` for channels without `sim::SimChannel`.
+    static constexpr std::size_t NoSimChannel = static_cast<std::size_t>(-1);
+
+    // The index of `fSimChannels` is built with them, when the event is
+    // prepared, and only read by the queries.
+
+    /// Position in `fSimChannels` of each channel ID (empty if not dense enough).
+    std::vector<std::size_t> fChannelToSimChannel;
+    /// For each entry of `fSimChannels`, its TDC entries sorted by tick.
+    std::vector<std::vector<const sim::TDCIDE*>> fSortedTDCIDEs;
+    /// All the IDEs of each track ID (absolute value), in channel and tick order.
+    std::unordered_map<int, std::vector<TrackIDERef_t>> fTrackIDEs;
+
+    /// TDC window of a hit on a channel; key of the per-event query caches.
+    struct TDCWindow_t {
+      raw::ChannelID_t channel;
+      int startTDC;
+      int endTDC;
+
+      bool
+      operator==(TDCWindow_t const& other) const
+      {
+        return (channel == other.channel) && (startTDC == other.startTDC) &&
+               (endTDC == other.endTDC);
+      }
+    };
+
+    struct TDCWindowHash_t {
+      std::size_t
+      operator()(TDCWindow_t const& window) const
+      {
+        std::size_t h = std::hash<raw::ChannelID_t>{}(window.channel);
+        h = h * 1000003U ^ std::hash<int>{}(window.startTDC);
+        return h * 1000003U ^ std::hash<int>{}(window.endTDC);
+      }
+    };
+
+    template <typename T>
+    using TDCWindowCache_t = std::unordered_map<TDCWindow_t, T, TDCWindowHash_t>;
+
+    /// Protects the query caches below, which the (`const`) queries fill as
+    /// they go, so that the queries of an event can run concurrently.
+    mutable std::mutex fQueryCacheMutex;
+
+    /// Results of the hit queries in this event, so that each hit is scanned once.
+    mutable TDCWindowCache_t<std::vector<sim::TrackIDE>> fTrackIDECache;
+    mutable TDCWindowCache_t<std::vector<sim::TrackIDE>> fEveIDECache;
+    mutable TDCWindowCache_t<std::vector<const sim::IDE*>> fSimIDECache;
+
+    /// Hits of the space points of a data product, in CSR layout: the hits of
+    /// the space point with key `k` are from `offsets[k]` to `offsets[k + 1]`.
+    struct SpacePointHits_t {
+      std::vector<std::size_t> offsets;
+      std::vector<art::Ptr<recob::Hit>> hits;
+    };
+
+    /// Hits of all the space points in this event, by space point data product.
+    mutable std::map<art::ProductID, SpacePointHits_t> fSpacePointHits;
+    mutable bool fSpacePointHitsReady = false;
+
+    /// Range of the IDEs of a hit in `fHitSimIDEs`, and the window they are from.
+    struct HitSimIDERange_t {
+      TDCWindow_t window;
+      std::size_t begin = 0;
+      std::size_t end = 0;
+      bool indexed = false;
+    };
+
+    /// IDEs of the hits queried by the space point functions in this event,
+    /// one hit after the other (CSR layout).
+    mutable std::vector<const sim::IDE*> fHitSimIDEs;
+    /// Range in `fHitSimIDEs` of each of those hits, by hit data product and key.
+    mutable std::map<art::ProductID, std::vector<HitSimIDERange_t>> fHitSimIDERanges;
+
+    /// Returns the TDC range from `start_time` to `end_time` [ticks] on `channel`.
+    TDCWindow_t TDCWindow(detinfo::DetectorClocksData const& clockData,
+                          raw::ChannelID_t channel,
+                          double start_time,
+                          double end_time) const;
+
+    /// TDC window of `hit`, as used by all the hit queries.
+    TDCWindow_t
+    HitTDCWindow(detinfo::DetectorClocksData const& clockData, recob::Hit const& hit) const
+    {
+      return TDCWindow(clockData,
+                       hit.Channel(),
+                       hit.PeakTimeMinusRMS(fHitTimeRMS),
+                       hit.PeakTimePlusRMS(fHitTimeRMS));
+    }
+
+    /// Indexes the space point to hit associations of `evt`, if not done yet.
+    template <typename Evt>
+    void PrepSpacePointHits(const Evt& evt) const;
+
+    /// Appends to `ides` the IDEs in `window`; throws if its channel has no
+    /// `sim::SimChannel`.
+    void CollectSimIDEs(TDCWindow_t const& window, std::vector<const sim::IDE*>& ides) const;
+
+    /// Returns the range of the IDEs of `hit` in `fHitSimIDEs`, adding them if
+    /// not there yet; `fQueryCacheMutex` must be held until the range is used.
+    std::pair<std::size_t, std::size_t> HitSimIDERange(
+      detinfo::DetectorClocksData const& clockData,
+      art::Ptr<recob::Hit> const& hit) const;
+
+    /// Average position of the IDEs from `begin` to `end`, weighted by their electrons.
+    std::vector<double> SimIDERangeToXYZ(const sim::IDE* const* begin,
+                                         const sim::IDE* const* end) const;
+
+    /// Position of `channel` in `fSimChannels` (`NoSimChannel` if not present).
+    std::size_t SimChannelIndex(raw::ChannelID_t channel) const;
+    /// Builds the lookup tables of `fSimChannels` content.
+    void BuildSimChannelIndex();
+    /// Removes all the lookup tables.
+    void ClearSimChannelIndex();
 
   }; // end class BackTracker
 
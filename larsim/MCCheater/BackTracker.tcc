@@ -5,9 +5,12 @@
 //
 ////////////////////////////////////////////////////////////////////////////
 
+#include "canvas/Persistency/Common/Assns.h"
 #include "canvas/Persistency/Common/FindManyP.h"
 #include "lardataobj/RecoBase/SpacePoint.h"
 
+#include <numeric> // std::partial_sum()
+
 namespace cheat {
 
   //--------------------------------------------------------------------
@@ -22,7 +25,7 @@ namespace cheat {
       throw cet::exception("BackTracker") << "BackTracker cannot function. "
                                           << "Is this file real data?";
     }
-    fSimChannels.clear();
+    this->ClearEvent();
     this->PrepSimChannels(evt);
     //this->PrepAllHitList ( evt ); //This line temporarily commented out until I figure out how I want PrepAllHitList to work.
   }
@@ -34,16 +37,30 @@ namespace cheat {
   {
     if (this->SimChannelsReady()) { return; }
     // The SimChannels list needs to be built.
-    const auto& simChannelsHandle =
-      evt.template getValidHandle<std::vector<sim::SimChannel>>(fSimChannelModuleLabel);
+    if (fCompactSimChannelModuleLabel.empty()) {
+      const auto& simChannelsHandle =
+        evt.template getValidHandle<std::vector<sim::SimChannel>>(fSimChannelModuleLabel);
 
-    art::fill_ptr_vector(fSimChannels, simChannelsHandle);
+      art::fill_ptr_vector(fSimChannels, simChannelsHandle);
+    }
+    else {
+      // the channels are expanded and kept here; the pointers to them are
+      // transient, and not valid outside of this object
+      const auto& compactHandle =
+        evt.template getValidHandle<sim::CompactSimChannels>(fCompactSimChannelModuleLabel);
+      fExpandedSimChannels = sim::expandSimChannels(*compactHandle);
+      fSimChannels.reserve(fExpandedSimChannels.size());
+      for (std::size_t sc = 0; sc < fExpandedSimChannels.size(); ++sc)
+        fSimChannels.emplace_back(art::ProductID{}, &fExpandedSimChannels[sc], sc);
+    }
 
     auto comparesclambda = [](art::Ptr<sim::SimChannel> a, art::Ptr<sim::SimChannel> b) {
       return (a->Channel() < b->Channel());
     };
     if (!std::is_sorted(fSimChannels.begin(), fSimChannels.end(), comparesclambda))
       std::sort(fSimChannels.begin(), fSimChannels.end(), comparesclambda);
+
+    this->BuildSimChannelIndex();
   }
 
   //--------------------------------------------------------------------
@@ -60,13 +77,43 @@ namespace cheat {
   std::vector<art::Ptr<recob::Hit>>
   BackTracker::SpacePointToHits_Ps(art::Ptr<recob::SpacePoint> const& spt, const Evt& evt) const
   {
-    std::vector<art::Ptr<recob::SpacePoint>>
-      spv; // This method needs to be rethought. For now I am directly
-           // implimenting it as found in the previous backtracker.
-    spv.push_back(spt);
-    art::FindManyP<recob::Hit> fmh(spv, evt, fHitLabel);
-    std::vector<art::Ptr<recob::Hit>> hitv = fmh.at(0);
-    return hitv;
+    this->PrepSpacePointHits(evt);
+    auto const iProduct = fSpacePointHits.find(spt.id());
+    if (iProduct == fSpacePointHits.end()) return {};
+    SpacePointHits_t const& index = iProduct->second;
+    if (spt.key() + 1 >= index.offsets.size()) return {};
+    return {index.hits.begin() + index.offsets[spt.key()],
+            index.hits.begin() + index.offsets[spt.key() + 1]};
+  }
+
+  //--------------------------------------------------------------------
+  template <typename Evt>
+  void
+  BackTracker::PrepSpacePointHits(const Evt& evt) const
+  {
+    // after this, the index is only read until the end of the event
+    std::lock_guard<std::mutex> const lock{fQueryCacheMutex};
+    if (fSpacePointHitsReady) return;
+    auto const& assns =
+      *evt.template getValidHandle<art::Assns<recob::SpacePoint, recob::Hit>>(fHitLabel);
+
+    // count the hits of each space point, then place them in association order
+    fSpacePointHits.clear();
+    for (auto const& [spt, hit] : assns) {
+      std::vector<std::size_t>& offsets = fSpacePointHits[spt.id()].offsets;
+      if (offsets.size() < spt.key() + 2) offsets.resize(spt.key() + 2, 0);
+      ++offsets[spt.key() + 1];
+    }
+    std::map<art::ProductID, std::vector<std::size_t>> next;
+    for (auto& [id, index] : fSpacePointHits) {
+      std::partial_sum(index.offsets.begin(), index.offsets.end(), index.offsets.begin());
+      index.hits.resize(index.offsets.back());
+      next[id].assign(index.offsets.begin(), index.offsets.end() - 1);
+    }
+    for (auto const& [spt, hit] : assns)
+      fSpacePointHits[spt.id()].hits[next[spt.id()][spt.key()]++] = hit;
+
+    fSpacePointHitsReady = true;
   }
 
   //--------------------------------------------------------------------
@@ -38,7 +38,9 @@ cheat::BackTrackerLoader::BackTrackerLoader(fhicl::ParameterSet const& p) : EDPr
 // BackTracker service.  It should be put after all simulation data producing
 // modules have run in the job, and only in jobs that create the simulation and
 // then make use of the BackTracker in either cheating reconstruction modules
-// or analyzers
+// or analyzers. With the services configured not to prepare each event as
+// it starts (`PrepareAtEventStart: false`), placing this module after the
+// event filters saves reading the truth of the events they reject.
 void
 cheat::BackTrackerLoader::produce(art::Event& e)
 {
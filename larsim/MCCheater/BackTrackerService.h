@@ -17,34 +17,64 @@
 #include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
 #include "art/Persistency/Provenance/ScheduleContext.h"
 #include "fhiclcpp/ParameterSet.h"
+#include "fhiclcpp/types/Atom.h"
 #include "larsim/MCCheater/BackTracker.h"
 
 // Included Services
 #include "larcore/Geometry/Geometry.h"
 #include "larcorealg/Geometry/GeometryCore.h"
 #include "larsim/MCCheater/ParticleInventory.h"
+#include "larsim/MCCheater/ScheduleProviders.h"
 
 namespace cheat {
-  class BackTrackerService : private BackTracker {
+  /// The event state is kept separately for each art schedule
+  /// (see `ScheduleProviders.h`), so that schedules can share the service.
+  class BackTrackerService {
   public:
     struct fhiclConfig {
       fhicl::Table<BackTracker::fhiclConfig> BackTrackerTable{
         fhicl::Name("BackTracker"),
         fhicl::Comment("This is the fhicl configuration of the BackTracker service provider.")};
+      fhicl::Atom<bool> PrepareAtEventStart{
+        fhicl::Name("PrepareAtEventStart"),
+        fhicl::Comment("prepare the SimChannels as each event starts; if false, only on Rebuild()"),
+        true};
     };
 
     using provider_type = BackTracker;
+    using HitCollectionMatch = BackTracker::HitCollectionMatch;
+
+    /// Provider of the schedule running the calling module.
     const provider_type*
     provider() const
     {
-      return static_cast<provider_type const*>(this);
+      return &fProviders.current();
+    }
+
+    /// Provider of the schedule `sid`.
+    const provider_type*
+    provider(art::ScheduleID sid) const
+    {
+      return &fProviders.at(sid);
+    }
+
+    double
+    GetMinHitEnergyFraction() const
+    {
+      return fProviders.current().GetMinHitEnergyFraction();
     }
 
     BackTrackerService(const fhicl::ParameterSet& pSet, art::ActivityRegistry& reg);
     BackTrackerService(const fhiclConfig& config, art::ActivityRegistry& reg);
 
-    //Temporrary rebuild function (until I can make this lazy again.
-
+    /**
+     * @brief Prepares the provider of the calling module schedule for `evt`.
+     *
+     * With `PrepareAtEventStart` disabled, the SimChannels are read and
+     * indexed only when a module (e.g. `BackTrackerLoader`, placed after the
+     * event filters) calls this function: events which are rejected before
+     * never pay for it. Queries on an event not prepared find no SimChannel.
+     */
     void Rebuild(const art::Event& evt);
 
     const std::vector<art::Ptr<sim::SimChannel>>& SimChannels() const;
@@ -120,6 +150,12 @@ namespace cheat {
                                          std::vector<art::Ptr<recob::Hit>> const& allhits,
                                          geo::View_t const& view) const;
 
+    std::vector<std::vector<HitCollectionMatch>> HitCollectionsMatches(
+      detinfo::DetectorClocksData const& clockData,
+      std::vector<std::vector<art::Ptr<recob::Hit>>> const& hitCollections,
+      std::vector<art::Ptr<recob::Hit>> const& allhits,
+      geo::View_t view = geo::k3D) const;
+
     std::set<int> GetSetOfTrackIds() const;
     std::set<int> GetSetOfEveIds() const;
 
@@ -137,20 +173,26 @@ namespace cheat {
                                         art::Ptr<recob::SpacePoint> const& spt) const;
 
   private:
+    ScheduleProviders<BackTracker> fProviders; ///< Event state of each schedule.
+
+    // never set until the backtracker can be lazy (see `SpacePointToHits_Ps()`)
     const art::Event* fEvt = nullptr;
 
+    bool fPrepareAtEventStart = true; ///< Whether to prepare as each event starts.
+
     // Prep functions go here.
-    void priv_PrepEvent(const art::Event& evt, art::ScheduleContext);
-    void priv_PrepSimChannels(const art::Event& evt);
+    void priv_StartEvent(const art::Event& evt, art::ScheduleContext sc);
+    void priv_PrepEvent(const art::Event& evt, art::ScheduleContext sc);
+    void priv_PrepSimChannels(BackTracker& bt, const art::Event& evt);
     //      void priv_PrepAllHitList ();
     void priv_PrepFailed();
 
-    bool priv_CanRun(const art::Event& evt);
+    bool priv_CanRun(BackTracker& bt, const art::Event& evt);
 
     bool
-    priv_SimChannelsReady()
+    priv_SimChannelsReady(BackTracker const& bt)
     {
-      return BackTracker::SimChannelsReady();
+      return bt.SimChannelsReady();
     }
     //      bool priv_AllHitListReady() { return
     //      BackTracker::AllHitListReady();}
@@ -158,6 +200,6 @@ namespace cheat {
   }; // class BackTrackerService
 
 } // end namespace cheat
-DECLARE_ART_SERVICE(cheat::BackTrackerService, LEGACY)
+DECLARE_ART_SERVICE(cheat::BackTrackerService, SHARED)
 
 #endif // CHEAT_BACKTRACKERSERVICESERVICE_H
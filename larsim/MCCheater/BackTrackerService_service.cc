@@ -9,6 +9,7 @@
 //
 ////////////////////////////////////////////////////////////////////////////////////////
 
+#include <memory>
 #include <vector>
 
 #include "larsim/MCCheater/BackTrackerService.h"
@@ -26,22 +27,28 @@ namespace cheat {
   //---------------------------------------------------------------------
   BackTrackerService::BackTrackerService(const fhicl::ParameterSet& pSet,
                                          art::ActivityRegistry& reg)
-    : BackTracker(pSet.get<fhicl::ParameterSet>("BackTracker"),
-                  lar::providerFrom<cheat::ParticleInventoryService>(),
-                  lar::providerFrom<geo::Geometry>())
+    : fProviders(reg, [&pSet](art::ScheduleID sid) {
+      return std::make_unique<BackTracker>(
+        pSet.get<fhicl::ParameterSet>("BackTracker"),
+        art::ServiceHandle<cheat::ParticleInventoryService const>()->provider(sid),
+        lar::providerFrom<geo::Geometry>());
+    })
+    , fPrepareAtEventStart(pSet.get<bool>("PrepareAtEventStart", true))
   {
-    reg.sPreProcessEvent.watch(this, &BackTrackerService::priv_PrepEvent);
+    reg.sPreProcessEvent.watch(this, &BackTrackerService::priv_StartEvent);
   }
 
   //---------------------------------------------------------------------
   BackTrackerService::BackTrackerService(const fhiclConfig& config, art::ActivityRegistry& reg)
-    : BackTracker(config.BackTrackerTable(),
-                  lar::providerFrom<cheat::ParticleInventoryService>(),
-                  lar::providerFrom<geo::Geometry>())
+    : fProviders(reg, [&config](art::ScheduleID sid) {
+      return std::make_unique<BackTracker>(
+        config.BackTrackerTable(),
+        art::ServiceHandle<cheat::ParticleInventoryService const>()->provider(sid),
+        lar::providerFrom<geo::Geometry>());
+    })
+    , fPrepareAtEventStart(config.PrepareAtEventStart())
   {
-    // This line is only to be included until art/LArSoft discussion about lazy
-    // rebuild can be completed.
-    reg.sPreProcessEvent.watch(this, &BackTrackerService::priv_PrepEvent);
+    reg.sPreProcessEvent.watch(this, &BackTrackerService::priv_StartEvent);
   }
 
   ////////////////////////////////////////////////
@@ -51,7 +58,7 @@ namespace cheat {
   /// provider.                                ///
   ////////////////////////////////////////////////
 
-  //-----Temp rebuild function.
+  //---------------------------------------------------------------------
   void
   BackTrackerService::Rebuild(const art::Event& evt)
   {
@@ -60,21 +67,35 @@ namespace cheat {
 
   //---------------------------------------------------------------------
   void
-  BackTrackerService::priv_PrepEvent(const art::Event& evt, art::ScheduleContext)
+  BackTrackerService::priv_StartEvent(const art::Event& evt, art::ScheduleContext sc)
+  {
+    if (fPrepareAtEventStart) {
+      this->priv_PrepEvent(evt, sc);
+      return;
+    }
+    // the SimChannels of the previous event must not be used for this one;
+    // the new ones are read only on Rebuild()
+    fProviders.at(sc).ClearEvent();
+  }
+
+  //---------------------------------------------------------------------
+  void
+  BackTrackerService::priv_PrepEvent(const art::Event& evt, art::ScheduleContext sc)
   {
-    fEvt = &evt;
-    BackTracker::ClearEvent();
-    if (!this->priv_CanRun(evt)) { return; }
-    this->priv_PrepSimChannels(evt);
-    fEvt = nullptr; // don't save the pointer because it will be useless after this
-                    // anyways. I want to make sure calls at the wrong time crash.
+    // the pointer to the event is not saved: it is useless after this (and
+    // would be shared by all schedules). I want to make sure calls at the
+    // wrong time crash.
+    BackTracker& bt = fProviders.at(sc);
+    bt.ClearEvent();
+    if (!this->priv_CanRun(bt, evt)) { return; }
+    this->priv_PrepSimChannels(bt, evt);
   }
 
   //---------------------------------------------------------------------
   bool
-  BackTrackerService::priv_CanRun(const art::Event& evt)
+  BackTrackerService::priv_CanRun(BackTracker& bt, const art::Event& evt)
   {
-    return BackTracker::CanRun(evt);
+    return bt.CanRun(evt);
   }
 
   //---------------------------------------------------------------------
@@ -88,12 +109,12 @@ namespace cheat {
 
   //---------------------------------------------------------------------
   void
-  BackTrackerService::priv_PrepSimChannels(const art::Event& evt)
+  BackTrackerService::priv_PrepSimChannels(BackTracker& bt, const art::Event& evt)
   {
-    if (!this->priv_CanRun(evt)) { this->priv_PrepFailed(); }
-    if (this->priv_SimChannelsReady()) { return; }
+    if (!this->priv_CanRun(bt, evt)) { this->priv_PrepFailed(); }
+    if (this->priv_SimChannelsReady(bt)) { return; }
     try {
-      BackTracker::PrepSimChannels(evt);
+      bt.PrepSimChannels(evt);
     }
     catch (...) {
       mf::LogWarning("BackTrackerService")
@@ -126,7 +147,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::SimChannels();
+    return fProviders.current().SimChannels();
   }
 
   //---------------------------------------------------------------------
@@ -135,7 +156,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::TrackIdToSimIDEs_Ps(id);
+    return fProviders.current().TrackIdToSimIDEs_Ps(id);
   }
 
   //---------------------------------------------------------------------
@@ -144,7 +165,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::TrackIdToSimIDEs_Ps(id, view);
+    return fProviders.current().TrackIdToSimIDEs_Ps(id, view);
   }
 
   //---------------------------------------------------------------------
@@ -153,7 +174,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::FindSimChannel(channel);
+    return fProviders.current().FindSimChannel(channel);
   }
 
   //---------------------------------------------------------------------
@@ -165,7 +186,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::ChannelToTrackIDEs(clockData, channel, hit_start_time, hit_end_time);
+    return fProviders.current().ChannelToTrackIDEs(clockData, channel, hit_start_time, hit_end_time);
   }
 
   //---------------------------------------------------------------------
@@ -175,7 +196,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::HitToTrackIDEs(clockData, hit);
+    return fProviders.current().HitToTrackIDEs(clockData, hit);
   }
 
   //---------------------------------------------------------------------
@@ -185,7 +206,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::HitToTrackIDEs(clockData, hit);
+    return fProviders.current().HitToTrackIDEs(clockData, hit);
   }
 
   //---------------------------------------------------------------------
@@ -195,7 +216,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::HitToTrackIds(clockData, hit);
+    return fProviders.current().HitToTrackIds(clockData, hit);
   }
 
   //---------------------------------------------------------------------
@@ -205,7 +226,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::HitToEveTrackIDEs(clockData, hit);
+    return fProviders.current().HitToEveTrackIDEs(clockData, hit);
   }
 
   //---------------------------------------------------------------------
@@ -215,7 +236,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::HitToEveTrackIDEs(clockData, hit);
+    return fProviders.current().HitToEveTrackIDEs(clockData, hit);
   }
 
   //---------------------------------------------------------------------
@@ -226,7 +247,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::TrackIdToHits_Ps(clockData, tkId, hitsIn);
+    return fProviders.current().TrackIdToHits_Ps(clockData, tkId, hitsIn);
   }
 
   //---------------------------------------------------------------------
@@ -246,7 +267,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::TrackIdsToHits_Ps(clockData, tkIds, hitsIn);
+    return fProviders.current().TrackIdsToHits_Ps(clockData, tkIds, hitsIn);
   }
 
   //---------------------------------------------------------------------
@@ -256,7 +277,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::HitToAvgSimIDEs(clockData, hit);
+    return fProviders.current().HitToAvgSimIDEs(clockData, hit);
   }
 
   //---------------------------------------------------------------------
@@ -266,7 +287,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::HitToAvgSimIDEs(clockData, hit);
+    return fProviders.current().HitToAvgSimIDEs(clockData, hit);
   }
 
   //---------------------------------------------------------------------
@@ -276,7 +297,7 @@ namespace cheat {
   {
     //Removed until Lazy Rebuild works
     //if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::HitToSimIDEs_Ps(clockData, hit);
+    return fProviders.current().HitToSimIDEs_Ps(clockData, hit);
   }
 
   //---------------------------------------------------------------------
@@ -286,7 +307,7 @@ namespace cheat {
   {
     //Removed until Lazy Rebuild works
     //if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::HitToSimIDEs_Ps(clockData, hit);
+    return fProviders.current().HitToSimIDEs_Ps(clockData, hit);
   }
 
   //---------------------------------------------------------------------
@@ -295,7 +316,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::SimIDEsToXYZ(ides);
+    return fProviders.current().SimIDEsToXYZ(ides);
   }
 
   //---------------------------------------------------------------------
@@ -304,7 +325,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::SimIDEsToXYZ(ide_Ps);
+    return fProviders.current().SimIDEsToXYZ(ide_Ps);
   }
 
   //---------------------------------------------------------------------
@@ -314,7 +335,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::HitToXYZ(clockData, hit);
+    return fProviders.current().HitToXYZ(clockData, hit);
   }
 
   //---------------------------------------------------------------------
@@ -335,7 +356,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::HitCollectionPurity(clockData, trackIds, hits);
+    return fProviders.current().HitCollectionPurity(clockData, trackIds, hits);
   }
 
   //---------------------------------------------------------------------
@@ -346,7 +367,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::HitChargeCollectionPurity(clockData, trackIds, hits);
+    return fProviders.current().HitChargeCollectionPurity(clockData, trackIds, hits);
   }
 
   //---------------------------------------------------------------------
@@ -359,7 +380,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::HitCollectionEfficiency(clockData, trackIds, hits, allhits, view);
+    return fProviders.current().HitCollectionEfficiency(clockData, trackIds, hits, allhits, view);
   }
 
   //---------------------------------------------------------------------
@@ -373,7 +394,18 @@ namespace cheat {
   {
     //Removed until Lazy Rebuild works
     //if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::HitChargeCollectionEfficiency(clockData, trackIds, hits, allhits, view);
+    return fProviders.current().HitChargeCollectionEfficiency(clockData, trackIds, hits, allhits, view);
+  }
+
+  //---------------------------------------------------------------------
+  std::vector<std::vector<BackTracker::HitCollectionMatch>>
+  BackTrackerService::HitCollectionsMatches(
+    detinfo::DetectorClocksData const& clockData,
+    std::vector<std::vector<art::Ptr<recob::Hit>>> const& hitCollections,
+    std::vector<art::Ptr<recob::Hit>> const& allhits,
+    geo::View_t view) const
+  {
+    return fProviders.current().HitCollectionsMatches(clockData, hitCollections, allhits, view);
   }
 
   //---------------------------------------------------------------------
@@ -382,7 +414,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::GetSetOfTrackIds();
+    return fProviders.current().GetSetOfTrackIds();
   }
 
   //---------------------------------------------------------------------
@@ -391,7 +423,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::GetSetOfEveIds();
+    return fProviders.current().GetSetOfEveIds();
   }
 
   //---------------------------------------------------------------------
@@ -401,7 +433,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::GetSetOfTrackIds(clockData, hits);
+    return fProviders.current().GetSetOfTrackIds(clockData, hits);
   }
 
   //---------------------------------------------------------------------
@@ -411,7 +443,7 @@ namespace cheat {
   {
     // Removed until Lazy Rebuild works
     // if(!this->priv_SimChannelsReady()){this->priv_PrepSimChannels();}
-    return BackTracker::GetSetOfEveIds(clockData, hits);
+    return fProviders.current().GetSetOfEveIds(clockData, hits);
   }
 
   //---------------------------------------------------------------------
@@ -421,7 +453,7 @@ namespace cheat {
     std::vector<art::Ptr<recob::Hit>> const& hits) const
   {
     // if( !this->priv_CanRun(*fEvt)) { this->priv_PrepFailed(); }
-    return BackTracker::SpacePointHitsToWeightedXYZ(clockData, hits);
+    return fProviders.current().SpacePointHitsToWeightedXYZ(clockData, hits);
   }
 
   //---------------------------------------------------------------------
@@ -436,7 +468,7 @@ namespace cheat {
         << "This function is not yet implimented pending the implimentation of "
            "backtracker lazy loading.";
     }
-    return BackTracker::SpacePointToHits_Ps(spt, *fEvt);
+    return fProviders.current().SpacePointToHits_Ps(spt, *fEvt);
   }
 
   //---------------------------------------------------------------------
@@ -450,7 +482,7 @@ namespace cheat {
         << "This function is not yet implimented pending the implimentation of "
            "backtracker lazy loading.";
     }
-    return BackTracker::SpacePointToXYZ(clockData, spt, *fEvt);
+    return fProviders.current().SpacePointToXYZ(clockData, spt, *fEvt);
   }
 
   DEFINE_ART_SERVICE(BackTrackerService)
@@ -8,6 +8,7 @@
 ////////////////////////////////////////////////////////////////////////
 
 //STL includes
+#include <iterator>
 //ROOT includes
 //Framework includes
 #include "fhiclcpp/ParameterSet.h"
@@ -39,6 +40,48 @@ namespace cheat{
     fParticleList.clear();
     fMCTObj.fMCTruthList.clear();
     fMCTObj.fTrackIdToMCTruthIndex.clear();
+    fEveIdTable.clear();
+    fMCTruthIndexTable.clear();
+  }
+
+  //-----------------------------------------------------------------------
+  bool ParticleInventory::TrackIdTable::reset(int maxId, std::size_t n){
+    values.clear();
+    sparse.clear();
+    // track IDs too sparse are left to the maps
+    if((maxId < 0) || (std::size_t(maxId) / 8 > n + 1024)) return false;
+    values.assign(std::size_t(maxId) + 1, NoValue);
+    return true;
+  }
+
+  //-----------------------------------------------------------------------
+  void ParticleInventory::BuildEveIdTable() const{
+    // the eve ID of each particle is resolved once here; the calculator
+    // walks the mother chain and caches the result, which is then read
+    // from the table by TrackIdToEveTrackId(), also for the other particles
+    // of the same shower; after this, queries on the particles of the list
+    // only read the table
+    if(fParticleList.empty()){ fEveIdTable.clear(); return; }
+    if(!fEveIdTable.reset(std::prev(fParticleList.end())->first, fParticleList.size())){
+      fEveIdTable.sparse.reserve(fParticleList.size());
+      for(const sim::ParticleList::value_type& TrackIdpair: fParticleList)
+        fEveIdTable.sparse.emplace(TrackIdpair.first, fParticleList.EveId(TrackIdpair.first));
+      return;
+    }
+    for(const sim::ParticleList::value_type& TrackIdpair: fParticleList){
+      if(TrackIdpair.first < 0) continue;
+      fEveIdTable.values[TrackIdpair.first] = fParticleList.EveId(TrackIdpair.first);
+    }
+  }
+
+  //-----------------------------------------------------------------------
+  void ParticleInventory::BuildMCTruthIndexTable() const{
+    auto const& index = fMCTObj.fTrackIdToMCTruthIndex;
+    if(index.empty()){ fMCTruthIndexTable.clear(); return; }
+    if(!fMCTruthIndexTable.reset(index.rbegin()->first, index.size())) return;
+    for(auto const& [ trackId, mctIndex ]: index){
+      if(trackId >= 0) fMCTruthIndexTable.values[trackId] = mctIndex;
+    }
   }
 
   //deliverables
@@ -57,16 +100,28 @@ namespace cheat{
   }//End TrackIdToParticle
 
 
+  //-----------------------------------------------------------------------
+  int ParticleInventory::TrackIdToEveTrackId(const int& tid) const
+  {
+    int const eveId = fEveIdTable.get(tid);
+    if(eveId != TrackIdTable::NoValue) return eveId;
+    // not a particle of the list: the calculator updates its cache
+    std::lock_guard<std::mutex> const lock{ fEveIdMutex };
+    return fParticleList.EveId(tid);
+  }
+
   //-----------------------------------------------------------------------
   const simb::MCParticle* ParticleInventory::TrackIdToMotherParticle_P(int const& id) const
   {
-    return this->TrackIdToParticle_P(fParticleList.EveId(abs(id)));
+    return this->TrackIdToParticle_P(this->TrackIdToEveTrackId(abs(id)));
   }
 
   //-----------------------------------------------------------------------
   const art::Ptr<simb::MCTruth>& ParticleInventory::TrackIdToMCTruth_P(int const& id) const
   {
     // find the entry in the MCTruth collection for this track id
+    int const mctIndex = fMCTruthIndexTable.get(abs(id));
+    if(mctIndex != TrackIdTable::NoValue) return fMCTObj.fMCTruthList.at(mctIndex);
     auto mctItr = fMCTObj.fTrackIdToMCTruthIndex.find(abs(id));
     if(mctItr!=fMCTObj.fTrackIdToMCTruthIndex.end()){
       int partIndex = mctItr->second;
@@ -114,7 +169,7 @@ namespace cheat{
     std::set<int> ret;
     std::set<int> tIds=this->GetSetOfTrackIds();
     for(auto tId : tIds){
-      ret.emplace(fParticleList.EveId(tId));
+      ret.emplace(this->TrackIdToEveTrackId(tId));
     }
     return ret;
   }
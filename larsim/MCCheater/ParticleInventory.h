@@ -129,8 +129,10 @@
  *  Return a copy of an MCTruth object in the event that caused a given Track. Users are encouraged
  *  to instead use TrackIdToMCTruth_P
  */
-/** \fn int TrackIdToEveTrackId(const int& tid) const { return fParticleList.EveId(tid)
+/** \fn int TrackIdToEveTrackId(const int& tid) const
  *  \brief Return the TrackId of the primary that ultimately created the particle that made the given TrackId.
+ *  The eve IDs of all the particles are computed once per event, when the particle list is prepared,
+ *  so that this is a plain table lookup.
  */
 /** \fn const art::Ptr<simb::MCTruth>& ParticleToMCTruth_P(const simb::MCParticle* p) const
  *  \brief Return an art::Ptr to the simb::MCTruth object that ultimately made the given particle
@@ -154,6 +156,9 @@
 #ifndef CHEAT_PARTICLEINVENTORY_H
 #define CHEAT_PARTICLEINVENTORY_H
 
+#include <limits>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "canvas/Persistency/Common/Ptr.h"
@@ -214,7 +219,8 @@ namespace cheat{
         bool CanRun(const Evt& evt) const;
 
       const sim::ParticleList& ParticleList() const { return fParticleList; }
-      void SetEveIdCalculator(sim::EveIdCalculator *ec) { fParticleList.AdoptEveIdCalculator(ec); }
+      void SetEveIdCalculator(sim::EveIdCalculator *ec)
+      { fParticleList.AdoptEveIdCalculator(ec); this->BuildEveIdTable(); }
 
       const std::vector< art::Ptr<simb::MCTruth> >& MCTruthList() const { return fMCTObj.fMCTruthList;}
 
@@ -236,7 +242,7 @@ namespace cheat{
 
       //New Functions go here.
       //TrackIdToEveId.
-      int TrackIdToEveTrackId(const int& tid) const { return fParticleList.EveId(tid);}
+      int TrackIdToEveTrackId(const int& tid) const;
 
       const art::Ptr<simb::MCTruth>& ParticleToMCTruth_P(const simb::MCParticle* p) const; //Users are encouraged to use ParticleToMCTruthP
       simb::MCTruth                  ParticleToMCTruth (const simb::MCParticle* p) const
@@ -257,6 +263,33 @@ namespace cheat{
         std::map< int,  int > fTrackIdToMCTruthIndex;
       };
       mutable MCTObjects fMCTObj;
+
+      /// Values for the track IDs of the particle list, in a dense table.
+      struct TrackIdTable{
+        static constexpr int NoValue = std::numeric_limits<int>::min();
+        std::vector<int> values; ///< Value for each track ID (`NoValue` if none).
+        std::unordered_map<int, int> sparse; ///< Values, if the IDs are too sparse for `values`.
+
+        int get(int tid) const
+        {
+          if((tid >= 0) && (std::size_t(tid) < values.size())) return values[tid];
+          if(sparse.empty()) return NoValue;
+          auto const it = sparse.find(tid);
+          return (it != sparse.end())? it->second: NoValue;
+        }
+        void clear() { values.clear(); sparse.clear(); }
+        /// Sizes the table for IDs up to `maxId`, unless they are too sparse for `n` entries.
+        bool reset(int maxId, std::size_t n);
+      };
+      mutable TrackIdTable fEveIdTable;          ///< Eve ID of each track ID.
+      mutable TrackIdTable fMCTruthIndexTable;   ///< Index in `fMCTruthList` of each track ID.
+      /// Serialises the eve ID calculator, which caches, for IDs not in the tables.
+      mutable std::mutex fEveIdMutex;
+
+      /// Computes the eve ID of all the particles in the list (once per event).
+      void BuildEveIdTable() const;
+      /// Copies `fTrackIdToMCTruthIndex` into a dense table.
+      void BuildMCTruthIndexTable() const;
       //For fhicl validation, makea config struct
       art::InputTag fG4ModuleLabel;
       //std::string fEveIdCalculatorName;
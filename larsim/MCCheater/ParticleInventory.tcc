@@ -17,6 +17,8 @@ namespace cheat{
       fParticleList.clear();
       fMCTObj.fMCTruthList.clear();
       fMCTObj.fTrackIdToMCTruthIndex.clear();
+      fEveIdTable.clear();
+      fMCTruthIndexTable.clear();
       this->PrepParticleList(evt);
       this->PrepMCTruthList(evt);
       this->PrepTrackIdToMCTruthIndex(evt);
@@ -54,6 +56,7 @@ namespace cheat{
           << "Particle Inventory cannot initialize the particle list.\n "
           << fEveIdCalculator <<" is not a known EveIdCalculator.\n";
       }
+      this->BuildEveIdTable();
     }
 
   //--------------------------------------------------------------------
@@ -111,6 +114,7 @@ namespace cheat{
             << "Could not get valid MCTruth, MCParticle Assciations!"; 
         }
       }
+      this->BuildMCTruthIndexTable();
     }
 
   //--------------------------------------------------------------------
@@ -14,7 +14,9 @@
 
 
 #include "larsim/MCCheater/ParticleInventory.h"
+#include "larsim/MCCheater/ScheduleProviders.h"
 #include "fhiclcpp/ParameterSet.h"
+#include "fhiclcpp/types/Atom.h"
 #include "fhiclcpp/types/Table.h"
 #include "art/Framework/Principal/Run.h"
 #include "art/Framework/Services/Registry/ActivityRegistry.h"
@@ -30,7 +32,9 @@
 
 
 namespace cheat{
-  class ParticleInventoryService: private ParticleInventory
+  /// The event state is kept separately for each art schedule
+  /// (see `ScheduleProviders.h`), so that schedules can share the service.
+  class ParticleInventoryService
   {
     public:
 
@@ -38,12 +42,20 @@ namespace cheat{
         fhicl::Table<ParticleInventory::ParticleInventoryConfig> ParticleInventoryTable{
           fhicl::Name("ParticleInventory"),
           fhicl::Comment("This is the fhicl configuration for the ParticleInventory Service Provider") };
+        fhicl::Atom<bool> PrepareAtEventStart{
+          fhicl::Name("PrepareAtEventStart"),
+          fhicl::Comment("prepare the particle list and the truth as each event starts; if false, only on Rebuild()"),
+          true };
       };
 
       //attempting to be compliant with ServiceUtil.h. Should ask LArSoft expert to review.
       using provider_type = ParticleInventory;
+      /// Provider of the schedule running the calling module.
       const provider_type* provider() const
-      { return static_cast<const provider_type*>(this); }
+      { return &fProviders.current(); }
+      /// Provider of the schedule `sid`.
+      const provider_type* provider(art::ScheduleID sid) const
+      { return &fProviders.at(sid); }
 
 
       ParticleInventoryService(const ParticleInventoryServiceConfig& config, art::ActivityRegistry& reg);
@@ -52,9 +64,14 @@ namespace cheat{
       //Move this function into the ParticleInventory.cpp file, and give it an appropriate CheckReady and Prep before the return.
       const sim::ParticleList& ParticleList() const;
 
+      /// Prepares the provider of the calling module schedule for `evt`: with
+      /// `PrepareAtEventStart` disabled, this is the only time the particles
+      /// and their truth are read (e.g. by `BackTrackerLoader`, placed after
+      /// the event filters), and queries on an event not prepared find none.
       void Rebuild( const art::Event& evt );
 
-      void SetEveIdCalculator(sim::EveIdCalculator *ec) { ParticleInventory::SetEveIdCalculator(ec); }
+      /// Adopts `ec` in the provider of the schedule running the calling module.
+      void SetEveIdCalculator(sim::EveIdCalculator *ec) { fProviders.current().SetEveIdCalculator(ec); }
 
       //Does this make sense? A track Id to a single particle? This is not a one to one relationship.
       const simb::MCParticle* TrackIdToParticle_P(int id) const;
@@ -86,20 +103,24 @@ namespace cheat{
 
     private:
 
-      void priv_PrepEvent        ( const art::Event& evt, art::ScheduleContext);
-      void priv_PrepParticleList            ( const art::Event& evt);
-      void priv_PrepMCTruthList             ( const art::Event& evt);
-      void priv_PrepTrackIdToMCTruthIndex   ( const art::Event& evt);
-      bool priv_CanRun(const art::Event& evt) const;
+      ScheduleProviders<ParticleInventory> fProviders; ///< Event state of each schedule.
+      bool fPrepareAtEventStart = true; ///< Whether to prepare as each event starts.
 
-      bool priv_ParticleListReady()     { return  ParticleInventory::ParticleListReady(); }
-      bool priv_MCTruthListReady()      { return  ParticleInventory::MCTruthListReady(); }
-      bool priv_TrackIdToMCTruthReady() { return  ParticleInventory::TrackIdToMCTruthReady();}
+      void priv_StartEvent       ( const art::Event& evt, art::ScheduleContext sc);
+      void priv_PrepEvent        ( const art::Event& evt, art::ScheduleContext sc);
+      void priv_PrepParticleList            (ParticleInventory& inv, const art::Event& evt);
+      void priv_PrepMCTruthList             (ParticleInventory& inv, const art::Event& evt);
+      void priv_PrepTrackIdToMCTruthIndex   (ParticleInventory& inv, const art::Event& evt);
+      bool priv_CanRun(ParticleInventory const& inv, const art::Event& evt) const;
+
+      bool priv_ParticleListReady(ParticleInventory const& inv)     { return  inv.ParticleListReady(); }
+      bool priv_MCTruthListReady(ParticleInventory const& inv)      { return  inv.MCTruthListReady(); }
+      bool priv_TrackIdToMCTruthReady(ParticleInventory const& inv) { return  inv.TrackIdToMCTruthReady();}
   };//class ParticleInventoryService
 
 }//namespace
 
-DECLARE_ART_SERVICE(cheat::ParticleInventoryService, LEGACY)
+DECLARE_ART_SERVICE(cheat::ParticleInventoryService, SHARED)
 
 
 #endif //CHEAT_PARTICLEINVENTORYSERVICESERVICE_H
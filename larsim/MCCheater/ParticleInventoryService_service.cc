@@ -25,6 +25,7 @@
 ////////////////////////////////////////////////////////////////////////////
 
 //STL includes
+#include <memory>
 //ROOT includes
 //Framework includes
 #include "messagefacility/MessageLogger/MessageLogger.h"
@@ -39,67 +40,81 @@ namespace cheat{
 
   //----------------------------------------------------------------------
   ParticleInventoryService::ParticleInventoryService(const ParticleInventoryServiceConfig& config, art::ActivityRegistry& reg)
-  :ParticleInventory(config.ParticleInventoryTable())
+  :fProviders(reg, [&config](art::ScheduleID)
+    { return std::make_unique<ParticleInventory>(config.ParticleInventoryTable()); })
+  ,fPrepareAtEventStart(config.PrepareAtEventStart())
   {
 //    std::cout<<"Config Dump from ParticleInventoryService using fhicl Table\n";
 //    config.ParticleInventoryTable.print_allowed_configuration(std::cout);
-    reg.sPreProcessEvent.watch(this, &ParticleInventoryService::priv_PrepEvent);
+    reg.sPreProcessEvent.watch(this, &ParticleInventoryService::priv_StartEvent);
   }
 
   //----------------------------------------------------------------------
   ParticleInventoryService::ParticleInventoryService(const fhicl::ParameterSet& pSet, art::ActivityRegistry& reg)
-  :ParticleInventory(pSet.get<fhicl::ParameterSet>("ParticleInventory"))
+  :fProviders(reg, [&pSet](art::ScheduleID)
+    { return std::make_unique<ParticleInventory>(pSet.get<fhicl::ParameterSet>("ParticleInventory")); })
+  ,fPrepareAtEventStart(pSet.get<bool>("PrepareAtEventStart", true))
   {
 //    std::cout<<"\n\n\n\nConfigDump from ParticleInventoryService using ParameterSet.\n"<<pSet.to_string()<<"\n\n\n\n";
-    reg.sPreProcessEvent.watch(this, &ParticleInventoryService::priv_PrepEvent);
+    reg.sPreProcessEvent.watch(this, &ParticleInventoryService::priv_StartEvent);
   }
 
-  //_--Temporary Rebuild function (until the service can be lazy again).
+  //----------------------------------------------------------------------
   void ParticleInventoryService::Rebuild( const art::Event& evt){
     this->priv_PrepEvent(evt, art::ScheduleContext::invalid());
   }
 
   //----------------------------------------------------------------------
-  void ParticleInventoryService::priv_PrepEvent(const art::Event& evt, art::ScheduleContext){
+  void ParticleInventoryService::priv_StartEvent(const art::Event& evt, art::ScheduleContext sc){
+    if(fPrepareAtEventStart){
+      this->priv_PrepEvent(evt, sc);
+      return;
+    }
+    fProviders.at(sc).ClearEvent(); //Forget the previous event; this one is prepared only on Rebuild().
+  }
+
+  //----------------------------------------------------------------------
+  void ParticleInventoryService::priv_PrepEvent(const art::Event& evt, art::ScheduleContext sc){
     //fEvt=&evt;
-    ParticleInventory::ClearEvent();
-    if( ! this->priv_CanRun(evt) ) { return; }
-    this->priv_PrepParticleList(evt);
-    this->priv_PrepMCTruthList(evt);
-    this->priv_PrepTrackIdToMCTruthIndex(evt);
+    ParticleInventory& inv = fProviders.at(sc);
+    inv.ClearEvent();
+    if( ! this->priv_CanRun(inv, evt) ) { return; }
+    this->priv_PrepParticleList(inv, evt);
+    this->priv_PrepMCTruthList(inv, evt);
+    this->priv_PrepTrackIdToMCTruthIndex(inv, evt);
     //fEvt=nullptr; //dont keep the cached pointer since it will expire right after this, and I want to make sure bad calls to prep functions fail.
   }
 
   //----------------------------------------------------------------------
-  bool ParticleInventoryService::priv_CanRun(const art::Event& evt) const{
-    return ParticleInventory::CanRun(evt);
+  bool ParticleInventoryService::priv_CanRun(ParticleInventory const& inv, const art::Event& evt) const{
+    return inv.CanRun(evt);
   }
 
   //----------------------------------------------------------------------
-  void ParticleInventoryService::priv_PrepParticleList(const art::Event& evt){
-    if(!this->priv_CanRun(evt)) {throw;}
+  void ParticleInventoryService::priv_PrepParticleList(ParticleInventory& inv, const art::Event& evt){
+    if(!this->priv_CanRun(inv, evt)) {throw;}
     //if(!this->priv_CanRun(*fEvt)) {throw;}
-    if(this->priv_ParticleListReady()){ return; }
+    if(this->priv_ParticleListReady(inv)){ return; }
     //try{ParticleInventory::PrepParticleList(*fEvt);}
-    try{ParticleInventory::PrepParticleList(evt);}
+    try{inv.PrepParticleList(evt);}
     catch(...){ mf::LogWarning("ParticleInventory") << "Rebuild failed to get the MCParticles. This is expected when running on a generation or simulation step.";}
   }
 
 
-  void ParticleInventoryService::priv_PrepTrackIdToMCTruthIndex(const art::Event& evt ){
-    if(!this->priv_CanRun(evt)){throw;}
+  void ParticleInventoryService::priv_PrepTrackIdToMCTruthIndex(ParticleInventory& inv, const art::Event& evt ){
+    if(!this->priv_CanRun(inv, evt)){throw;}
     //if(!this->priv_CanRun(*fEvt)){throw;}
-    if( this->priv_TrackIdToMCTruthReady()){ return; }
+    if( this->priv_TrackIdToMCTruthReady(inv)){ return; }
     //try{ParticleInventory::PrepTrackIdToMCTruthIndex(*fEvt);}
-    try{ParticleInventory::PrepTrackIdToMCTruthIndex(evt);}
+    try{inv.PrepTrackIdToMCTruthIndex(evt);}
     catch(...){ mf::LogWarning("ParticleInventory") << "Rebuild failed to get the MCParticles. This is expected when running on a generation or simulation step.";}
   }//End priv_PrepTrackIdToMCTruthIndexList
 
-  void ParticleInventoryService::priv_PrepMCTruthList(const art::Event& evt ){
+  void ParticleInventoryService::priv_PrepMCTruthList(ParticleInventory& inv, const art::Event& evt ){
 //    if(!this->priv_CanRun(*fEvt)){throw;}
-    if(!this->priv_CanRun(evt)){throw;}
-    if(this->priv_MCTruthListReady( ) ){ return;} //If the event is data or if the truth list is already built there is nothing for us to do.
-    try{    ParticleInventory::PrepMCTruthList(evt); }
+    if(!this->priv_CanRun(inv, evt)){throw;}
+    if(this->priv_MCTruthListReady(inv) ){ return;} //If the event is data or if the truth list is already built there is nothing for us to do.
+    try{    inv.PrepMCTruthList(evt); }
     //try{    ParticleInventory::PrepMCTruthList(*fEvt); }
     catch(...){ mf::LogWarning("ParticleInventory") << "Rebuild failed to get the MCParticles. This is expected when running on a generation or simulation step.";}
     //ToDo. Find out exactly which exception is thrown and catch only that.
@@ -114,13 +129,13 @@ namespace cheat{
   const sim::ParticleList& ParticleInventoryService::ParticleList() const {
 //    if(!this->priv_ParticleListReady()){this->priv_PrepParticleList();}
 //    Not used for non lazy functions
-    return ParticleInventory::ParticleList();
+    return fProviders.current().ParticleList();
   } //This should be replaced with a public struct so we can get away from the nutools dependency.
 
   const std::vector< art::Ptr<simb::MCTruth> >& ParticleInventoryService::MCTruthVector_Ps() const {
     //if(!this->priv_MCTruthListReady()){priv_PrepMCTruthList();}
     // Not used for non-lazy mode
-    return ParticleInventory::MCTruthVector_Ps();
+    return fProviders.current().MCTruthVector_Ps();
   }
 
   //TrackIdToParticleP
@@ -128,7 +143,7 @@ namespace cheat{
   const simb::MCParticle* ParticleInventoryService::TrackIdToParticle_P(int const id) const {
 //    if(!this->priv_ParticleListReady()){this->priv_PrepParticleList();}
 //    Not used for non-lazy mode
-    return ParticleInventory::TrackIdToParticle_P(id);
+    return fProviders.current().TrackIdToParticle_P(id);
   }//End TrackIdToParticle
 
 
@@ -136,19 +151,19 @@ namespace cheat{
   {
 //    if(!this->priv_ParticleListReady()){this->priv_PrepParticleList();}
 //    Not used for non-lazy mode
-    return ParticleInventory::TrackIdToMotherParticle_P(id);
+    return fProviders.current().TrackIdToMotherParticle_P(id);
   }
 
   const art::Ptr<simb::MCTruth>& ParticleInventoryService::TrackIdToMCTruth_P(int const id) const
   {
 //    if(!this->priv_TrackIdToMCTruthReady()){this->priv_PrepTrackIdToMCTruthIndex();}
 //    Not used for non-lazy mode
-    return ParticleInventory::TrackIdToMCTruth_P(id);
+    return fProviders.current().TrackIdToMCTruth_P(id);
   }
 
   int ParticleInventoryService::TrackIdToEveTrackId(const int tid) const
   {
-    return ParticleInventory::TrackIdToEveTrackId(tid);
+    return fProviders.current().TrackIdToEveTrackId(tid);
   }
 
   const art::Ptr<simb::MCTruth>& ParticleInventoryService::ParticleToMCTruth_P(const simb::MCParticle* p) const
@@ -163,19 +178,19 @@ namespace cheat{
 //    if(!this->priv_ParticleListReady()){this->priv_PrepParticleList();}
 //    if(!this->priv_MCTruthListReady()){this->priv_PrepMCTruthList();}
 //    Not used for non-lazy mode
-    return ParticleInventory::MCTruthToParticles_Ps(mct);
+    return fProviders.current().MCTruthToParticles_Ps(mct);
   }
 
   std::set<int> ParticleInventoryService::GetSetOfTrackIds() const {
 //    if(!this->priv_ParticleListReady()){this->priv_PrepParticleList();}
 //    Not used for non-lazy mode
-    return ParticleInventory::GetSetOfTrackIds();
+    return fProviders.current().GetSetOfTrackIds();
   }
 
   std::set<int> ParticleInventoryService::GetSetOfEveIds() const {
 //    if(!this->priv_ParticleListReady()){this->priv_PrepParticleList();}
 //    Not used for non-lazy mode
-    return ParticleInventory::GetSetOfEveIds();
+    return fProviders.current().GetSetOfEveIds();
   }
 
   DEFINE_ART_SERVICE(ParticleInventoryService)
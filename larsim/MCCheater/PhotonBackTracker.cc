@@ -21,6 +21,9 @@
 #include "larsim/MCCheater/PhotonBackTracker.h"
 
 //CPP
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
 #include <map>
 
 //Framework
@@ -71,6 +74,63 @@ namespace cheat{
   void PhotonBackTracker::ClearEvent(){
     priv_OpDetBTRs.clear();
     priv_OpFlashToOpHits.clear();
+    priv_OpFlashToOpHitsReady = false;
+    priv_OpHitSDPs.clear();
+    priv_OpHitSDPSummaries.clear();
+    priv_OpDetToBTR.clear();
+    priv_SortedTimeSDPs.clear();
+    priv_TrackSDPs.clear();
+  }
+
+  //----------------------------------------------------------------
+  void PhotonBackTracker::BuildBTRIndex()
+  {
+    priv_OpDetToBTR.clear();
+    priv_SortedTimeSDPs.clear();
+    priv_TrackSDPs.clear();
+    if(priv_OpDetBTRs.empty()) return;
+
+    // priv_OpDetBTRs is sorted by detector number; in the (unexpected) case
+    // of duplicate records the last one wins, as in the former linear search
+    int const maxOpDet = priv_OpDetBTRs.back()->OpDetNum();
+    if((maxOpDet >= 0) && (std::size_t(maxOpDet) / 8 <= priv_OpDetBTRs.size())){
+      priv_OpDetToBTR.assign(std::size_t(maxOpDet) + 1, NoBTR);
+      for(size_t btr = 0; btr < priv_OpDetBTRs.size(); ++btr){
+        int const opDet = priv_OpDetBTRs[btr]->OpDetNum();
+        if(opDet >= 0) priv_OpDetToBTR[opDet] = btr;
+      }
+    }
+
+    auto pairSort = [](const TimeSDPs_t* a, const TimeSDPs_t* b) { return a->first < b->first ; } ;
+    priv_SortedTimeSDPs.resize(priv_OpDetBTRs.size());
+    for(size_t btr = 0; btr < priv_OpDetBTRs.size(); ++btr){
+      int const opDet = priv_OpDetBTRs[btr]->OpDetNum();
+      const auto & pdTimeSDPmap = priv_OpDetBTRs[btr]->timePDclockSDPsMap();
+      std::vector<const TimeSDPs_t*>& sorted = priv_SortedTimeSDPs[btr];
+      sorted.reserve(pdTimeSDPmap.size());
+      for(const TimeSDPs_t& item : pdTimeSDPmap){
+        sorted.push_back(&item);
+        for(const sim::SDP& sdp : item.second)
+          priv_TrackSDPs[std::abs(sdp.trackID)].push_back({opDet, item.first, &sdp});
+      }
+      if(!std::is_sorted(sorted.begin(), sorted.end(), pairSort))
+        std::stable_sort(sorted.begin(), sorted.end(), pairSort);
+    }
+  }
+
+  //----------------------------------------------------------------
+  std::size_t PhotonBackTracker::BTRIndex(int opDetNum) const
+  {
+    if(!priv_OpDetToBTR.empty()){
+      return ((opDetNum >= 0) && (std::size_t(opDetNum) < priv_OpDetToBTR.size()))
+        ? priv_OpDetToBTR[opDetNum]: NoBTR;
+    }
+    auto iub = std::upper_bound(priv_OpDetBTRs.begin(), priv_OpDetBTRs.end(), opDetNum,
+      [](int opDetNum, art::Ptr<sim::OpDetBacktrackerRecord> const& btr)
+        { return opDetNum < btr->OpDetNum(); });
+    if((iub == priv_OpDetBTRs.begin()) || ((*std::prev(iub))->OpDetNum() != opDetNum))
+      return NoBTR;
+    return std::size_t(std::prev(iub) - priv_OpDetBTRs.begin());
   }
 
   //----------------------------------------------------------------
@@ -82,7 +142,7 @@ namespace cheat{
   //----------------------------------------------------------------
   const bool PhotonBackTracker::OpFlashToOpHitsReady()
   {
-    return !( priv_OpFlashToOpHits.empty() ) ;
+    return priv_OpFlashToOpHitsReady;
   }
 
   //----------------------------------------------------------------
@@ -95,18 +155,10 @@ namespace cheat{
   const std::vector< const sim::SDP* > PhotonBackTracker::TrackIdToSimSDPs_Ps(int const& id)
   {
     std::vector< const sim::SDP* > sdp_Ps;
-    for(size_t odet=0; odet<priv_OpDetBTRs.size(); ++odet){
-      const auto & pdTimeSDPmap = priv_OpDetBTRs[odet]->timePDclockSDPsMap();
-      for(auto mapitr = pdTimeSDPmap.begin(); mapitr != pdTimeSDPmap. end(); mapitr++){
-        std::vector<sim::SDP> const& sdpvec = (*mapitr).second;
-        for(size_t iv = 0; iv < sdpvec.size(); ++iv){
-      //    const sim::SDP* const sdp_P = &sdpvec[iv];
-          if( abs(sdpvec[iv].trackID) == id) sdp_Ps.push_back(&(sdpvec[iv]));
-        }
-      } // end loop over map from sim::OpDetBacktrackerRecord
-
-
-    }// end loop over sim::OpDetBacktrackerRecords
+    auto const itrack = priv_TrackSDPs.find(id);
+    if(itrack == priv_TrackSDPs.end()) return sdp_Ps;
+    sdp_Ps.reserve(itrack->second.size());
+    for(const TrackSDPRef_t& ref : itrack->second) sdp_Ps.push_back(ref.sdp);
     return sdp_Ps;
   }
 
@@ -121,10 +173,8 @@ namespace cheat{
   const art::Ptr< sim::OpDetBacktrackerRecord > PhotonBackTracker::FindOpDetBTR(int const& opDetNum) const
   {
     art::Ptr< sim::OpDetBacktrackerRecord > opDet;
-    for(size_t sc = 0; sc < priv_OpDetBTRs.size(); ++sc){
-      //This could become a bug. What if it occurs twice (shouldn't happen in correct records, but still, no error handeling included for the situation
-      if(priv_OpDetBTRs.at(sc)->OpDetNum() == opDetNum) opDet = priv_OpDetBTRs.at(sc);
-    }
+    std::size_t const btr = this->BTRIndex(opDetNum);
+    if(btr != NoBTR) opDet = priv_OpDetBTRs[btr];
     if(!opDet)
     {
       throw cet::exception("PhotonBackTracker2") << "No sim:: OpDetBacktrackerRecord corresponding "
@@ -248,7 +298,7 @@ namespace cheat{
 
     double totalE = 0.;
     for(size_t t = 0; t < trackSDPs.size(); ++t){
-      eveIDtoEfrac[(fPartInv->ParticleList()).EveId( trackSDPs[t].trackID )] += trackSDPs[t].energy;
+      eveIDtoEfrac[fPartInv->TrackIdToEveTrackId( trackSDPs[t].trackID )] += trackSDPs[t].energy;
       totalE += trackSDPs[t].energy;
     }
 
@@ -315,6 +365,13 @@ namespace cheat{
   const std::vector< const sim::SDP* > PhotonBackTracker::OpHitToSimSDPs_Ps(recob::OpHit const& opHit) const
   {
     std::vector<const sim::SDP*> retVec;
+    this->CollectOpHitSDPs(opHit, retVec);
+    return retVec;
+  }
+
+  //----------------------------------------------------------------
+  void PhotonBackTracker::CollectOpHitSDPs(recob::OpHit const& opHit, std::vector<const sim::SDP*>& retVec) const
+  {
     double fPeakTime = opHit.PeakTime();
     double fWidth = opHit.Width();
     sim::OpDetBacktrackerRecord::timePDclock_t start_time = ((fPeakTime- fWidth)*1000.0)-fDelay;
@@ -322,16 +379,15 @@ namespace cheat{
     if(start_time > end_time){throw;}
 
     //BUG!!!fGeom->OpDetFromOpChannel(channel)
-    const std::vector<std::pair<double, std::vector<sim::SDP>> >& timeSDPMap
-      = (this->FindOpDetBTR(fGeom->OpDetFromOpChannel(opHit.OpChannel()) ))->timePDclockSDPsMap(); //Not guranteed to be sorted.
-    //const std::vector<std::pair<double, std::vector<sim::SDP>> >& timeSDPMap = (this->FindOpDetBTR(opHit.OpChannel()))->timePDclockSDPsMap(); //Not guranteed to be sorted.
-
-    std::vector<const std::pair<double, std::vector<sim::SDP>>*> timePDclockSDPMap_SortedPointers;
-    for ( auto& pair : timeSDPMap ){ timePDclockSDPMap_SortedPointers.push_back(&pair); }
-    auto pairSort = [](auto& a, auto& b) { return a->first < b->first ; } ;
-    if( !std::is_sorted( timePDclockSDPMap_SortedPointers.begin(), timePDclockSDPMap_SortedPointers.end(), pairSort)){
-      std::sort(timePDclockSDPMap_SortedPointers.begin(), timePDclockSDPMap_SortedPointers.end(), pairSort);
+    int const opDetNum = fGeom->OpDetFromOpChannel(opHit.OpChannel());
+    std::size_t const btr = this->BTRIndex(opDetNum);
+    if(btr == NoBTR){
+      throw cet::exception("PhotonBackTracker2") << "No sim:: OpDetBacktrackerRecord corresponding "
+        << "to opDetNum: " << opDetNum << "\n";
     }
+    //The time map is not guaranteed to be sorted: the index has its entries sorted by time.
+    const std::vector<const TimeSDPs_t*>& timePDclockSDPMap_SortedPointers = priv_SortedTimeSDPs[btr];
+    auto pairSort = [](auto& a, auto& b) { return a->first < b->first ; } ;
 
     //This section is a hack to make comparisons work right.
     std::vector<sim::SDP> dummyVec;
@@ -348,8 +404,6 @@ namespace cheat{
       for( auto& sdp : (*mapitr)->second)
         retVec.push_back(&sdp);
 
-    return retVec;
-
     //sdps = FindOpDetBTR( geom->OpDetFromOpChannel(opHit. OpChannel()) )->TrackIDsAndEnergies(start_time, end_time);
     // return (this->FindOpDetBTR( fGeom->OpDetFromOpChannel(opHit.OpChannel()) ))->TrackIDsAndEnergies(start_time, end_time);
 
@@ -359,7 +413,49 @@ namespace cheat{
   //----------------------------------------------------------------
   const std::vector< const sim::SDP* > PhotonBackTracker::OpHitToSimSDPs_Ps(art::Ptr<recob::OpHit> const& opHit_P) const
   {
-    return this->OpHitToSimSDPs_Ps(*opHit_P);
+    std::vector<const sim::SDP*> sdps_Ps;
+    this->OpHitSDPSummary(opHit_P, &sdps_Ps);
+    return sdps_Ps;
+  }
+
+  //----------------------------------------------------------------
+  auto PhotonBackTracker::OpHitSDPSummary(art::Ptr<recob::OpHit> const& opHit_P,
+                                          std::vector<const sim::SDP*>* sdps) const -> OpHitSDPs_t
+  {
+    std::lock_guard<std::mutex> const lock{priv_QueryCacheMutex};
+    auto const copySDPs = [this, sdps](OpHitSDPs_t const& summary) {
+      if (sdps) sdps->insert(sdps->end(), priv_OpHitSDPs.begin() + summary.begin,
+                             priv_OpHitSDPs.begin() + summary.end);
+    };
+
+    // hits without a data product (from transient pointers) are not memoised
+    OpHitSDPs_t* memo = nullptr;
+    if (opHit_P.id().isValid()) {
+      std::vector<OpHitSDPs_t>& summaries = priv_OpHitSDPSummaries[opHit_P.id()];
+      if (summaries.size() <= opHit_P.key()) summaries.resize(opHit_P.key() + 1);
+      memo = &summaries[opHit_P.key()];
+      if (memo->filled) {
+        copySDPs(*memo);
+        return *memo;
+      }
+    }
+
+    OpHitSDPs_t summary;
+    summary.begin = priv_OpHitSDPs.size();
+    this->CollectOpHitSDPs(*opHit_P, priv_OpHitSDPs);
+    summary.end = priv_OpHitSDPs.size();
+    for (std::size_t i = summary.begin; i < summary.end; ++i) {
+      sim::SDP const& sdp = *priv_OpHitSDPs[i];
+      double const weight = sdp.numPhotons;
+      summary.w += weight;
+      summary.x += weight * sdp.x;
+      summary.y += weight * sdp.y;
+      summary.z += weight * sdp.z;
+    }
+    summary.filled = true;
+    if (memo) *memo = summary;
+    copySDPs(summary);
+    return summary;
   }
 
   //----------------------------------------------------------------
@@ -426,7 +522,7 @@ namespace cheat{
   //----------------------------------------------------------------
   const std::vector< double> PhotonBackTracker::OpHitToXYZ(art::Ptr<recob::OpHit> const& opHit)
   {
-    return SimSDPsToXYZ(this->OpHitToSimSDPs_Ps(*opHit));
+    return OpHitRangeToXYZ(&opHit, &opHit + 1);
   }
 
   //----------------------------------------------------------------
@@ -435,18 +531,41 @@ namespace cheat{
   const std::vector< const sim::SDP* > PhotonBackTracker::OpHitsToSimSDPs_Ps( std::vector< art::Ptr < recob::OpHit > > const& opHits_Ps) const
   {
     std::vector < const sim::SDP* > sdps_Ps;
-    for ( auto opHit_P : opHits_Ps ){
-      std::vector < const sim::SDP* > to_add_sdps_Ps = this->OpHitToSimSDPs_Ps(opHit_P);
-      sdps_Ps.insert( sdps_Ps.end(), to_add_sdps_Ps.begin(), to_add_sdps_Ps.end() );
-    }
+    for ( auto const& opHit_P : opHits_Ps )
+      this->OpHitSDPSummary(opHit_P, &sdps_Ps);
     return sdps_Ps;
   }
 
   //----------------------------------------------------------------
   const std::vector< double > PhotonBackTracker::OpHitsToXYZ( std::vector < art::Ptr < recob::OpHit > > const& opHits_Ps) const
   {
-    const std::vector<const sim::SDP*> SDPs_Ps = OpHitsToSimSDPs_Ps(opHits_Ps);
-    return this->SimSDPsToXYZ(SDPs_Ps);
+    return this->OpHitRangeToXYZ(opHits_Ps.data(), opHits_Ps.data() + opHits_Ps.size());
+  }
+
+  //----------------------------------------------------------------
+  std::vector<double> PhotonBackTracker::OpHitRangeToXYZ(art::Ptr<recob::OpHit> const* begin,
+                                                         art::Ptr<recob::OpHit> const* end) const
+  {
+    // the same weighted average as SimSDPsToXYZ(), from the sums of each hit
+    std::vector<double> xyz(3, -999.);
+    double x = 0.;
+    double y = 0.;
+    double z = 0.;
+    double w = 0.;
+    for (auto opHit_P = begin; opHit_P != end; ++opHit_P) {
+      OpHitSDPs_t const summary = this->OpHitSDPSummary(*opHit_P);
+      w += summary.w;
+      x += summary.x;
+      y += summary.y;
+      z += summary.z;
+    }
+    if(w < 1.e-5)
+      throw cet::exception("PhotonBackTracker") << "No sim::SDPs providing non-zero number of photons"
+        << " can't determine originating location from truth\n";
+    xyz[0] = x/w;
+    xyz[1] = y/w;
+    xyz[2] = z/w;
+    return xyz;
   }
 
   //----------------------------------------------------------------
@@ -705,26 +824,40 @@ namespace cheat{
     // const std::vector<art::Ptr<recob::OpHit>> PhotonBackTracker::OpFlashToOpHits_Ps(art::Ptr<recob::OpFlash>& flash_P, Evt const& evt) const
   {//There is not "non-pointer" version of this because the art::Ptr is needed to look up the assn. One could loop the Ptrs and dereference them, but I will not encourage the behavior by building the tool to do it.
     //
-    std::vector<art::Ptr<recob::OpHit>> const& hits_Ps = priv_OpFlashToOpHits.at(flash_P);
-    return hits_Ps;
+    auto const [begin, end] = this->FlashOpHitRange(flash_P);
+    return { begin, end };
+  }
+
+  //--------------------------------------------------
+  std::pair<art::Ptr<recob::OpHit> const*, art::Ptr<recob::OpHit> const*>
+    PhotonBackTracker::FlashOpHitRange(art::Ptr<recob::OpFlash> const& flash_P) const
+  {
+    auto const iProduct = priv_OpFlashToOpHits.find(flash_P.id());
+    if ((iProduct == priv_OpFlashToOpHits.end())
+      || (flash_P.key() + 1 >= iProduct->second.offsets.size()))
+    {
+      throw cet::exception("PhotonBackTracker") << "Flash " << flash_P.id() << ":"
+        << flash_P.key() << " not found among the flashes of the event.\n";
+    }
+    FlashOpHits_t const& index = iProduct->second;
+    return { index.hits.data() + index.offsets[flash_P.key()],
+             index.hits.data() + index.offsets[flash_P.key() + 1] };
   }
 
   //--------------------------------------------------
   const std::vector<double> PhotonBackTracker::OpFlashToXYZ(art::Ptr<recob::OpFlash>& flash_P) const
   {
-    const std::vector< art::Ptr< recob::OpHit > > opHits_Ps = this->OpFlashToOpHits_Ps(flash_P);
-    const std::vector<double> retVec = this->OpHitsToXYZ(opHits_Ps);
-    //const std::vector<double> retVec(0.0,3);
-    return retVec;
+    auto const [begin, end] = this->FlashOpHitRange(flash_P);
+    return this->OpHitRangeToXYZ(begin, end);
   }
 
   //--------------------------------------------------
   const std::set<int> PhotonBackTracker::OpFlashToTrackIds(art::Ptr<recob::OpFlash>& flash_P) const
   {
-    std::vector<art::Ptr<recob::OpHit> > opHits_Ps = this->OpFlashToOpHits_Ps(flash_P);
+    auto const [begin, end] = this->FlashOpHitRange(flash_P);
     std::set<int> ids;
-    for( auto& opHit_P : opHits_Ps){
-      for( const int& id : this->OpHitToTrackIds(opHit_P) ){
+    for( auto opHit_P = begin; opHit_P != end; ++opHit_P){
+      for( const int& id : this->OpHitToTrackIds(*opHit_P) ){
         ids.insert( id) ;
       } // end for ids
     }// end for opHits
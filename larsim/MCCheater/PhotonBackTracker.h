@@ -15,8 +15,12 @@
 #define CHEAT_PHOTONBACKTRACKER_H
 
 //CPP
+#include <cstddef>
 #include <map>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 //Framework
@@ -248,7 +252,73 @@ namespace cheat{
       const art::InputTag fOpFlashLabel;
       const double fMinOpHitEnergyFraction;
       mutable std::vector<art::Ptr<sim::OpDetBacktrackerRecord> > priv_OpDetBTRs;
-      std::map< art::Ptr < recob::OpFlash >, std::vector < art::Ptr < recob::OpHit > > > priv_OpFlashToOpHits;
+
+      /// Optical hits of the flashes of a data product, in CSR layout: the hits
+      /// of the flash with key `k` are from `offsets[k]` to `offsets[k + 1]`.
+      struct FlashOpHits_t{
+        std::vector<std::size_t> offsets;
+        std::vector<art::Ptr<recob::OpHit>> hits;
+      };
+
+      /// Optical hits of all the flashes in this event, by flash data product.
+      std::map<art::ProductID, FlashOpHits_t> priv_OpFlashToOpHits;
+      bool priv_OpFlashToOpHitsReady = false;
+
+      /// SDPs of an optical hit, and the sums for their photon-weighted position.
+      struct OpHitSDPs_t{
+        std::size_t begin = 0; ///< First SDP of the hit in `priv_OpHitSDPs`.
+        std::size_t end = 0;   ///< After the last SDP of the hit in `priv_OpHitSDPs`.
+        double w = 0.;         ///< Photons of all the SDPs.
+        double x = 0., y = 0., z = 0.; ///< Photon-weighted sums of the coordinates.
+        bool filled = false;
+      };
+
+      /// Protects `priv_OpHitSDPs` and `priv_OpHitSDPSummaries`, which the
+      /// (`const`) queries fill as they go, so that they can run concurrently.
+      mutable std::mutex priv_QueryCacheMutex;
+      /// SDPs of the hits queried in this event, one hit after the other (CSR layout).
+      mutable std::vector<const sim::SDP*> priv_OpHitSDPs;
+      /// Summary of each of those hits, by hit data product and key.
+      mutable std::map<art::ProductID, std::vector<OpHitSDPs_t>> priv_OpHitSDPSummaries;
+
+      using TimeSDPs_t = std::pair<double, std::vector<sim::SDP>>;
+
+      /// An SDP of a track, with the optical detector and time it was recorded at.
+      struct TrackSDPRef_t{
+        int opDetNum;
+        double time;
+        const sim::SDP* sdp;
+      };
+
+      static constexpr std::size_t NoBTR = static_cast<std::size_t>(-1);
+
+      // The index of `priv_OpDetBTRs` is built with them, when the event is
+      // prepared, and only read by the queries.
+
+      /// Position in `priv_OpDetBTRs` of each optical detector number.
+      std::vector<std::size_t> priv_OpDetToBTR;
+      /// For each entry of `priv_OpDetBTRs`, its time entries sorted by time.
+      std::vector<std::vector<const TimeSDPs_t*>> priv_SortedTimeSDPs;
+      /// All the SDPs of each track ID (absolute value), in detector and record order.
+      std::unordered_map<int, std::vector<TrackSDPRef_t>> priv_TrackSDPs;
+
+      /// Builds the lookup tables of `priv_OpDetBTRs` content.
+      void BuildBTRIndex();
+      /// Position of `opDetNum` in `priv_OpDetBTRs` (`NoBTR` if not present).
+      std::size_t BTRIndex(int opDetNum) const;
+
+      /// Appends the SDPs contributing to `opHit` to `sdps`.
+      void CollectOpHitSDPs(recob::OpHit const& opHit, std::vector<const sim::SDP*>& sdps) const;
+      /// Summary of the SDPs of `opHit_P`, collected the first time it is
+      /// queried; the SDPs are also appended to `sdps`, if specified.
+      OpHitSDPs_t OpHitSDPSummary(art::Ptr<recob::OpHit> const& opHit_P,
+                                  std::vector<const sim::SDP*>* sdps = nullptr) const;
+      /// Photon-weighted position of the SDPs of the hits from `begin` to `end`.
+      std::vector<double> OpHitRangeToXYZ(art::Ptr<recob::OpHit> const* begin,
+                                          art::Ptr<recob::OpHit> const* end) const;
+      /// Range of the optical hits of `flash_P`; throws if the flash is unknown.
+      std::pair<art::Ptr<recob::OpHit> const*, art::Ptr<recob::OpHit> const*>
+        FlashOpHitRange(art::Ptr<recob::OpFlash> const& flash_P) const;
 
 
   };//Class
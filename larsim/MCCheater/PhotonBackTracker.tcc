@@ -34,6 +34,7 @@ namespace cheat{
       auto compareBTRlambda = [](art::Ptr<sim::OpDetBacktrackerRecord> a, art::Ptr<sim::OpDetBacktrackerRecord> b) {return(a->OpDetNum()<b->OpDetNum());};
       if (!std::is_sorted(priv_OpDetBTRs.begin(),priv_OpDetBTRs.end(),compareBTRlambda)) 
         std::sort(priv_OpDetBTRs.begin(),priv_OpDetBTRs.end(),compareBTRlambda);
+      this->BuildBTRIndex();
       //auto compareDivReclambda = [](art::Ptr<sim::OpDetDivRec> a, art::Ptr<sim::OpDetDivRec> b) {return(a->OpDetNum() < b->OpDetNum());};
       /*if (!std::is_sorted(priv_DivRecs.begin(), priv_DivRecs.end(), compareDivReclambda)) 
         std::sort(priv_DivRecs.begin(), priv_DivRecs.end(), compareDivReclambda);*/
@@ -77,25 +78,22 @@ namespace cheat{
             return;
           }
           art::fill_ptr_vector(flash_vec, handle);
+          if (flash_vec.empty()) continue;
           auto tag = art::InputTag( handle.provenance()->moduleLabel() );
           art::FindManyP<recob::OpHit>  flash_hit_assn(flash_vec, evt, tag);
           //          std::cout<<"flash_hit_assn.size: "<<flash_hit_assn.size()<<"\n";
+          // the hits of all the flashes of the product, one flash after the other
+          FlashOpHits_t& index = priv_OpFlashToOpHits[flash_vec.front().id()];
+          index.offsets.assign(1, 0);
+          index.offsets.reserve(flash_vec.size() + 1);
           for ( size_t i = 0; i < flash_vec.size(); ++i)
           {
-            art::Ptr< recob::OpFlash > flashp = flash_vec.at(i);
-            std::vector< art::Ptr< recob::OpHit > > ophits = flash_hit_assn.at(i);
-            auto check = priv_OpFlashToOpHits.emplace(flashp, ophits);
-            if ( check.second == false )
-            {
-              // loop ophit_ps
-              // push_back to vector.
-              for ( auto& ophitp : ophits )
-              {
-                check.first->second.push_back(ophitp);
-              }
-            }
+            std::vector< art::Ptr< recob::OpHit > > const& ophits = flash_hit_assn.at(i);
+            index.hits.insert(index.hits.end(), ophits.begin(), ophits.end());
+            index.offsets.push_back(index.hits.size());
           }
         }
+        priv_OpFlashToOpHitsReady = true;
       }
 
     //----------------------------------------------------------------
@@ -107,7 +105,7 @@ namespace cheat{
             <<"PhotonBackTracker cannot function."
             <<"Is this file real data?";
         }
-        priv_OpDetBTRs.clear();
+        this->ClearEvent();
         this->PrepOpDetBTRs(evt);
         this->PrepOpFlashToOpHits(evt);
       } 
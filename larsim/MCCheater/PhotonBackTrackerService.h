@@ -14,6 +14,7 @@
 
 // Framework includes
 #include "fhiclcpp/ParameterSet.h"
+#include "fhiclcpp/types/Atom.h"
 #include "art/Framework/Services/Registry/ActivityRegistry.h"
 #include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
 #include "art/Framework/Principal/Event.h"
@@ -25,6 +26,7 @@
 #include "larcorealg/Geometry/GeometryCore.h"
 #include "larsim/Simulation/SimListUtils.h"
 #include "larsim/MCCheater/PhotonBackTracker.h"
+#include "larsim/MCCheater/ScheduleProviders.h"
 #include "lardataobj/RecoBase/OpHit.h"
 
 //Larsoft Services
@@ -33,7 +35,9 @@
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
 
 namespace cheat{
-  class PhotonBackTrackerService: private PhotonBackTracker
+  /// The event state is kept separately for each art schedule
+  /// (see `ScheduleProviders.h`), so that schedules can share the service.
+  class PhotonBackTrackerService
   {
     public:
       struct fhiclConfig{
@@ -41,17 +45,29 @@ namespace cheat{
           fhicl::Name("PhotonBackTracker"),
             fhicl::Comment("This if the fhicl configuration of the PhotonBackTracker service provider.")
         };
+        fhicl::Atom<bool> PrepareAtEventStart{
+          fhicl::Name("PrepareAtEventStart"),
+          fhicl::Comment("prepare the OpDetBTRs and flashes as each event starts; if false, only on Rebuild()"),
+          true
+        };
       };
 
       using provider_type = PhotonBackTracker;
+      /// Provider of the schedule running the calling module.
       const provider_type* provider() const
-      {return static_cast<provider_type const*>(this);}
+      {return &fProviders.current();}
+      /// Provider of the schedule `sid`.
+      const provider_type* provider(art::ScheduleID sid) const
+      {return &fProviders.at(sid);}
 
       PhotonBackTrackerService(fhicl::ParameterSet const& pSet, art::ActivityRegistry& reg);
       PhotonBackTrackerService(fhiclConfig const& config, art::ActivityRegistry& reg);
 
-      //Temporarily include a rebuild function until the lazy rebuild works.
-
+      /// Prepares the provider of the calling module schedule for `evt`: with
+      /// `PrepareAtEventStart` disabled, this is the only time the OpDetBTRs
+      /// and the flashes are read (e.g. by `PhotonBackTrackerLoader`, placed
+      /// after the event filters), and queries on an event not prepared find
+      /// none.
       void Rebuild( art::Event const& evt);
 
       ///////////////////////////////////////////////
@@ -115,7 +131,7 @@ namespace cheat{
           std::vector< art::Ptr<recob::OpHit> > const& opHitsIn_Ps);
       const double OpHitChargeCollectionEfficiency(std::set<int> const& tkIds,
           std::vector< art::Ptr<recob::OpHit> > const& opHits_Ps,
-          std::vector< art::Ptr<recob::OpHit> > const& opHitsIn_Ps) { return PhotonBackTracker::OpHitLightCollectionEfficiency(tkIds, opHits_Ps, opHitsIn_Ps); }//Exists only temporarily. Is deprecated.
+          std::vector< art::Ptr<recob::OpHit> > const& opHitsIn_Ps) { return fProviders.current().OpHitLightCollectionEfficiency(tkIds, opHits_Ps, opHitsIn_Ps); }//Exists only temporarily. Is deprecated.
       const std::set<int> OpFlashToTrackIds(art::Ptr<recob::OpFlash>& flash_P) const;
       const std::vector < art::Ptr< recob::OpHit> > OpFlashToOpHits_Ps ( art::Ptr < recob::OpFlash > & flash_P );
       const std::vector < double > OpFlashToXYZ ( art::Ptr < recob::OpFlash > & flash_P );
@@ -123,16 +139,18 @@ namespace cheat{
 
 
     private:
-      //The PhotonBackTrackerService has no parameters.
+      ScheduleProviders<PhotonBackTracker> fProviders; ///< Event state of each schedule.
+      bool fPrepareAtEventStart = true; ///< Whether to prepare as each event starts.
 
-    void priv_PrepEvent(art::Event const& evt, art::ScheduleContext) ;
+      void priv_StartEvent(art::Event const& evt, art::ScheduleContext sc);
+      void priv_PrepEvent(art::Event const& evt, art::ScheduleContext sc) ;
       void priv_PrepFailed();
-      void priv_PrepOpDetBTRs(art::Event const& evt);
-      void priv_PrepOpFlashToOpHits(art::Event const& evt);
+      void priv_PrepOpDetBTRs(PhotonBackTracker& pbt, art::Event const& evt);
+      void priv_PrepOpFlashToOpHits(PhotonBackTracker& pbt, art::Event const& evt);
 
-      bool priv_CanRun(art::Event const& evt);
-      bool priv_OpDetBTRsReady() {return PhotonBackTracker::BTRsReady();}
-      bool priv_OpFlashToOpHitsReady() {return PhotonBackTracker::OpFlashToOpHitsReady();}
+      bool priv_CanRun(PhotonBackTracker& pbt, art::Event const& evt);
+      bool priv_OpDetBTRsReady(PhotonBackTracker& pbt) {return pbt.BTRsReady();}
+      bool priv_OpFlashToOpHitsReady(PhotonBackTracker& pbt) {return pbt.OpFlashToOpHitsReady();}
 
   }; //Class PhotonBackTrackerService
 
@@ -140,6 +158,6 @@ namespace cheat{
 
   //----------------------------------------------------------------------
 } // namespace
-DECLARE_ART_SERVICE(cheat::PhotonBackTrackerService, LEGACY)
+DECLARE_ART_SERVICE(cheat::PhotonBackTrackerService, SHARED)
 
 #endif //CHEAT_PHOTONBACKTRACKERSERVICESERVICE_H
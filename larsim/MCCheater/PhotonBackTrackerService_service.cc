@@ -9,6 +9,8 @@
 
 #include "larsim/MCCheater/PhotonBackTrackerService.h"
 
+#include <memory>
+
 // Framework includes
 #include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
@@ -25,26 +27,32 @@ namespace cheat{
 
   //----------------------------------------------------------------------
   PhotonBackTrackerService::PhotonBackTrackerService(fhicl::ParameterSet const& pSet, art::ActivityRegistry& reg)
-    :PhotonBackTracker(
+    :fProviders(reg, [&pSet](art::ScheduleID sid) {
+      return std::make_unique<PhotonBackTracker>(
         pSet.get<fhicl::ParameterSet>("PhotonBackTracker"),
-        lar::providerFrom<cheat::ParticleInventoryService>(),
+        art::ServiceHandle<cheat::ParticleInventoryService const>()->provider(sid),
         lar::providerFrom<geo::Geometry>()//,
 //        lar::providerFrom<detinfo::DetectorClocksService>()
-        )
+        );
+    })
+    ,fPrepareAtEventStart(pSet.get<bool>("PrepareAtEventStart", true))
   {
-    reg.sPreProcessEvent.watch(this, &PhotonBackTrackerService::priv_PrepEvent);
+    reg.sPreProcessEvent.watch(this, &PhotonBackTrackerService::priv_StartEvent);
   }
 
   //----------------------------------------------------------------------
   PhotonBackTrackerService::PhotonBackTrackerService(fhiclConfig const& config, art::ActivityRegistry& reg)
-    :PhotonBackTracker(
+    :fProviders(reg, [&config](art::ScheduleID sid) {
+      return std::make_unique<PhotonBackTracker>(
         config.PhotonBackTrackerTable(),
-        lar::providerFrom<cheat::ParticleInventoryService>(),
+        art::ServiceHandle<cheat::ParticleInventoryService const>()->provider(sid),
         lar::providerFrom<geo::Geometry>()//,
 //        lar::providerFrom<detinfo::DetectorClocksService>()
-        )
+        );
+    })
+    ,fPrepareAtEventStart(config.PrepareAtEventStart())
   {
-    reg.sPreProcessEvent.watch(this, &PhotonBackTrackerService::priv_PrepEvent);
+    reg.sPreProcessEvent.watch(this, &PhotonBackTrackerService::priv_StartEvent);
   }
 
   ////////////////////////////////////////////////
@@ -62,17 +70,28 @@ namespace cheat{
   }
 
   //----------------------------------------------------------------------
-  void PhotonBackTrackerService::priv_PrepEvent( art::Event const& evt, art::ScheduleContext)
+  void PhotonBackTrackerService::priv_StartEvent( art::Event const& evt, art::ScheduleContext sc)
+  {
+    if(fPrepareAtEventStart){
+      this->priv_PrepEvent(evt, sc);
+      return;
+    }
+    fProviders.at(sc).ClearEvent(); //this event is prepared only on Rebuild()
+  }
+
+  //----------------------------------------------------------------------
+  void PhotonBackTrackerService::priv_PrepEvent( art::Event const& evt, art::ScheduleContext sc)
   {
-    PhotonBackTracker::ClearEvent();
-    if( ! this->priv_CanRun(evt) ){ return; }
-    this->priv_PrepOpDetBTRs(evt);
-    this->priv_PrepOpFlashToOpHits(evt);
+    PhotonBackTracker& pbt = fProviders.at(sc);
+    pbt.ClearEvent();
+    if( ! this->priv_CanRun(pbt, evt) ){ return; }
+    this->priv_PrepOpDetBTRs(pbt, evt);
+    this->priv_PrepOpFlashToOpHits(pbt, evt);
   }
 
   //----------------------------------------------------------------------
-  bool PhotonBackTrackerService::priv_CanRun(art::Event const& evt){
-    return PhotonBackTracker::CanRun(evt);
+  bool PhotonBackTrackerService::priv_CanRun(PhotonBackTracker& pbt, art::Event const& evt){
+    return pbt.CanRun(evt);
   }
 
   //----------------------------------------------------------------------
@@ -84,10 +103,10 @@ namespace cheat{
   }
 
   //----------------------------------------------------------------------
-  void PhotonBackTrackerService::priv_PrepOpDetBTRs(art::Event const& evt){
-    if( !this->priv_CanRun(evt) ) {this->priv_PrepFailed(); }
-    if( this->priv_OpDetBTRsReady()){ return; }
-    try{PhotonBackTracker::PrepOpDetBTRs(evt);}
+  void PhotonBackTrackerService::priv_PrepOpDetBTRs(PhotonBackTracker& pbt, art::Event const& evt){
+    if( !this->priv_CanRun(pbt, evt) ) {this->priv_PrepFailed(); }
+    if( this->priv_OpDetBTRsReady(pbt)){ return; }
+    try{pbt.PrepOpDetBTRs(evt);}
     //catch(...){ mf::LogWarning("PhotonBackTrackerService")//This needs to go. Catch all should not be used.
     catch(cet::exception const&){//This needs to go. Make it specific if there is a really an exception we would like to catch.
       mf::LogWarning("PhotonBackTrackerService")
@@ -95,10 +114,10 @@ namespace cheat{
         <<"running on a generation or simulation step.";}
   }
 
-  void PhotonBackTrackerService::priv_PrepOpFlashToOpHits(art::Event const& evt){
-    if( !this->priv_CanRun(evt) ) {this->priv_PrepFailed();}
-    if( this->priv_OpFlashToOpHitsReady()){ return; }
-    try{PhotonBackTracker::PrepOpFlashToOpHits(evt);}
+  void PhotonBackTrackerService::priv_PrepOpFlashToOpHits(PhotonBackTracker& pbt, art::Event const& evt){
+    if( !this->priv_CanRun(pbt, evt) ) {this->priv_PrepFailed();}
+    if( this->priv_OpFlashToOpHitsReady(pbt)){ return; }
+    try{pbt.PrepOpFlashToOpHits(evt);}
     //catch(...){ //This needs to go. Catch all should not be used.
     catch(cet::exception const&){//This needs to go. Make it specific if there is a really an exception we would like to catch.
       mf::LogWarning("PhotonBackTrackerService")
@@ -122,28 +141,28 @@ namespace cheat{
   //----------------------------------------------------------------------
   const std::vector< art::Ptr< sim::OpDetBacktrackerRecord >>& PhotonBackTrackerService::OpDetBTRs()
   {
-    return PhotonBackTracker::OpDetBTRs();
+    return fProviders.current().OpDetBTRs();
   }
 
   //----------------------------------------------------------------------
-  const double PhotonBackTrackerService::GetDelay(){ return PhotonBackTracker::GetDelay();}
+  const double PhotonBackTrackerService::GetDelay(){ return fProviders.current().GetDelay();}
 
   //----------------------------------------------------------------------
   const std::vector< const sim::SDP* > PhotonBackTrackerService::TrackIdToSimSDPs_Ps(int const& id)
   {
-    return PhotonBackTracker::TrackIdToSimSDPs_Ps(id);
+    return fProviders.current().TrackIdToSimSDPs_Ps(id);
   }
 
   //----------------------------------------------------------------------
   const std::vector< const sim::SDP* > PhotonBackTrackerService::TrackIdToSimSDPs_Ps(int const& id,  geo::View_t const& view )
   {
-    return PhotonBackTracker::TrackIdToSimSDPs_Ps(id, view);
+    return fProviders.current().TrackIdToSimSDPs_Ps(id, view);
   }
 
   //----------------------------------------------------------------------
   art::Ptr< sim::OpDetBacktrackerRecord > PhotonBackTrackerService::FindOpDetBTR(int const& opDetNum)
   {
-    return PhotonBackTracker::FindOpDetBTR(opDetNum);
+    return fProviders.current().FindOpDetBTR(opDetNum);
   }
 
   //----------------------------------------------------------------------
@@ -151,76 +170,76 @@ namespace cheat{
       double const& opHit_start_time,
       double const& opHit_end_time)
   {
-    return PhotonBackTracker::OpDetToTrackSDPs(OpDetNum, opHit_start_time, opHit_end_time);
+    return fProviders.current().OpDetToTrackSDPs(OpDetNum, opHit_start_time, opHit_end_time);
   }
 
   //----------------------------------------------------------------------
   std::vector<sim::TrackSDP> PhotonBackTrackerService::OpHitToTrackSDPs(art::Ptr<recob::OpHit> const& opHit_P )
   {
-    return PhotonBackTracker::OpHitToTrackSDPs(opHit_P );
+    return fProviders.current().OpHitToTrackSDPs(opHit_P );
   }
 
   //----------------------------------------------------------------------
   std::vector<sim::TrackSDP> PhotonBackTrackerService::OpHitToTrackSDPs(recob::OpHit const& opHit)
   {
-    return PhotonBackTracker::OpHitToTrackSDPs(opHit);
+    return fProviders.current().OpHitToTrackSDPs(opHit);
   }
 
   //----------------------------------------------------------------------
   const std::vector < int > PhotonBackTrackerService::OpHitToTrackIds(recob::OpHit const& opHit) {
-    return PhotonBackTracker::OpHitToTrackIds(opHit);
+    return fProviders.current().OpHitToTrackIds(opHit);
   }
 
   //----------------------------------------------------------------------
   const std::vector < int > PhotonBackTrackerService::OpHitToTrackIds(art::Ptr<recob::OpHit> const& opHit_P) {
-    return PhotonBackTracker::OpHitToTrackIds(opHit_P);
+    return fProviders.current().OpHitToTrackIds(opHit_P);
   }
 
   //----------------------------------------------------------------------
   //----------------------------------------------------------------------
   const std::vector < int > PhotonBackTrackerService::OpHitToEveTrackIds(recob::OpHit const& opHit) {
-    return PhotonBackTracker::OpHitToEveTrackIds(opHit);
+    return fProviders.current().OpHitToEveTrackIds(opHit);
   }
 
   //----------------------------------------------------------------------
   const std::vector < int > PhotonBackTrackerService::OpHitToEveTrackIds(art::Ptr<recob::OpHit> const& opHit_P) {
-    return PhotonBackTracker::OpHitToEveTrackIds(opHit_P);
+    return fProviders.current().OpHitToEveTrackIds(opHit_P);
   }
 
   //----------------------------------------------------------------------
   std::vector<sim::TrackSDP> PhotonBackTrackerService::OpHitToEveTrackSDPs(art::Ptr<recob::OpHit> const& opHit_P )
   {
-    return PhotonBackTracker::OpHitToEveTrackSDPs(opHit_P);
+    return fProviders.current().OpHitToEveTrackSDPs(opHit_P);
   }
 
   //----------------------------------------------------------------------
   std::vector<sim::TrackSDP> PhotonBackTrackerService::OpHitToEveTrackSDPs(recob::OpHit const& opHit)
   {
-    return PhotonBackTracker::OpHitToEveTrackSDPs(opHit);
+    return fProviders.current().OpHitToEveTrackSDPs(opHit);
   }
 
   //----------------------------------------------------------------------
   const std::vector<art::Ptr<recob::OpHit>> PhotonBackTrackerService::TrackIdToOpHits_Ps(int const& tkId, std::vector<art::Ptr<recob::OpHit>> const& hitsIn)
   {
-    return PhotonBackTracker::TrackIdToOpHits_Ps(tkId, hitsIn);
+    return fProviders.current().TrackIdToOpHits_Ps(tkId, hitsIn);
   }
 
   //----------------------------------------------------------------------
   const std::vector<std::vector<art::Ptr<recob::OpHit>>> PhotonBackTrackerService::TrackIdsToOpHits_Ps(std::vector<int> const& tkIds, std::vector<art::Ptr<recob::OpHit>> const& hitsIn)
   {
-    return PhotonBackTracker::TrackIdsToOpHits_Ps(tkIds, hitsIn);
+    return fProviders.current().TrackIdsToOpHits_Ps(tkIds, hitsIn);
   }
 
   //----------------------------------------------------------------------
   const std::vector< const sim::SDP* > PhotonBackTrackerService::OpHitToSimSDPs_Ps(recob::OpHit const& opHit)
   {
-    return PhotonBackTracker::OpHitToSimSDPs_Ps(opHit);
+    return fProviders.current().OpHitToSimSDPs_Ps(opHit);
   }
 
   //----------------------------------------------------------------------
   const std::vector< const sim::SDP* > PhotonBackTrackerService::OpHitToSimSDPs_Ps(art::Ptr<recob::OpHit> const& opHit_P)
   {
-    return PhotonBackTracker::OpHitToSimSDPs_Ps(opHit_P);
+    return fProviders.current().OpHitToSimSDPs_Ps(opHit_P);
   }
 
   //----------------------------------------------------------------------
@@ -233,85 +252,85 @@ namespace cheat{
   //----------------------------------------------------------------------
   const std::unordered_set< const sim::SDP* > PhotonBackTrackerService::OpHitToEveSimSDPs_Ps(recob::OpHit const& opHit)
   {
-    return PhotonBackTracker::OpHitToEveSimSDPs_Ps(opHit);
+    return fProviders.current().OpHitToEveSimSDPs_Ps(opHit);
   }
 
   //----------------------------------------------------------------------
   const std::unordered_set< const sim::SDP* > PhotonBackTrackerService::OpHitToEveSimSDPs_Ps(art::Ptr<recob::OpHit> & opHit_P)
   {
-    return PhotonBackTracker::OpHitToEveSimSDPs_Ps(opHit_P);
+    return fProviders.current().OpHitToEveSimSDPs_Ps(opHit_P);
   }
 
   //----------------------------------------------------------------------
   const std::vector< double> PhotonBackTrackerService::SimSDPsToXYZ(std::vector<sim::SDP> const& sdps) const&
   {
-    return PhotonBackTracker::SimSDPsToXYZ(sdps);
+    return fProviders.current().SimSDPsToXYZ(sdps);
   }
 
   //----------------------------------------------------------------------
   const std::vector< double> PhotonBackTrackerService::SimSDPsToXYZ(std::vector<const sim::SDP*> const& sdps_Ps )
   {
-    return PhotonBackTracker::SimSDPsToXYZ(sdps_Ps);
+    return fProviders.current().SimSDPsToXYZ(sdps_Ps);
   }
 
   //----------------------------------------------------------------------
   const std::vector< double> PhotonBackTrackerService::OpHitToXYZ(recob::OpHit const& opHit)
   {
-    return PhotonBackTracker::OpHitToXYZ(opHit);
+    return fProviders.current().OpHitToXYZ(opHit);
   }
 
   //----------------------------------------------------------------------
   const std::vector< double> PhotonBackTrackerService::OpHitToXYZ(art::Ptr<recob::OpHit> const& opHit_P)
   {
-    return PhotonBackTracker::OpHitToXYZ(opHit_P);
+    return fProviders.current().OpHitToXYZ(opHit_P);
   }
 
   //----------------------------------------------------------------------
   const std::set< int> PhotonBackTrackerService::GetSetOfEveIds()
   {
-    return PhotonBackTracker::GetSetOfEveIds();
+    return fProviders.current().GetSetOfEveIds();
   }
 
   //----------------------------------------------------------------------
   const std::set< int> PhotonBackTrackerService::GetSetOfTrackIds()
   {
-    return PhotonBackTracker::GetSetOfTrackIds();
+    return fProviders.current().GetSetOfTrackIds();
   }
 
   //----------------------------------------------------------------------
   const std::set< int> PhotonBackTrackerService::GetSetOfEveIds(std::vector< art::Ptr<recob::OpHit> > const& opHits_Ps)
   {
-    return PhotonBackTracker::GetSetOfEveIds(opHits_Ps);
+    return fProviders.current().GetSetOfEveIds(opHits_Ps);
   }
   //----------------------------------------------------------------------
   const std::set< int> PhotonBackTrackerService::GetSetOfEveIds(std::vector< recob::OpHit > const& opHits)
   {
-    return PhotonBackTracker::GetSetOfEveIds(opHits);
+    return fProviders.current().GetSetOfEveIds(opHits);
   }
 
   //----------------------------------------------------------------------
   const std::set< int> PhotonBackTrackerService::GetSetOfTrackIds(std::vector< art::Ptr<recob::OpHit> > const& opHits_Ps)
   {
-    return PhotonBackTracker::GetSetOfTrackIds(opHits_Ps);
+    return fProviders.current().GetSetOfTrackIds(opHits_Ps);
   }
   //----------------------------------------------------------------------
   const std::set< int> PhotonBackTrackerService::GetSetOfTrackIds(std::vector< recob::OpHit > const& opHits)
   {
-    return PhotonBackTracker::GetSetOfTrackIds(opHits);
+    return fProviders.current().GetSetOfTrackIds(opHits);
   }
 
   //----------------------------------------------------------------------
   const double PhotonBackTrackerService::OpHitCollectionPurity(std::set<int> const& tkIds,
       std::vector< art::Ptr<recob::OpHit> > const& opHits_Ps)
   {
-    return PhotonBackTracker::OpHitCollectionPurity(tkIds, opHits_Ps);
+    return fProviders.current().OpHitCollectionPurity(tkIds, opHits_Ps);
   }
 
   //----------------------------------------------------------------------
   const double PhotonBackTrackerService::OpHitLightCollectionPurity(std::set<int> const& tkIds,
       std::vector< art::Ptr<recob::OpHit> > const& opHits_Ps)
   {
-    return PhotonBackTracker::OpHitLightCollectionPurity(tkIds, opHits_Ps);
+    return fProviders.current().OpHitLightCollectionPurity(tkIds, opHits_Ps);
   }
 
 
@@ -329,7 +348,7 @@ namespace cheat{
       std::vector< art::Ptr<recob::OpHit> > const& opHits_Ps,
       std::vector< art::Ptr<recob::OpHit> > const& opHitsIn_Ps)
   {
-    return PhotonBackTracker::OpHitCollectionEfficiency(tkIds, opHits_Ps, opHitsIn_Ps);
+    return fProviders.current().OpHitCollectionEfficiency(tkIds, opHits_Ps, opHitsIn_Ps);
   }
 
   //----------------------------------------------------------------------
@@ -346,22 +365,22 @@ namespace cheat{
       std::vector< art::Ptr<recob::OpHit> > const& opHits_Ps,
       std::vector< art::Ptr<recob::OpHit> > const& opHitsIn_Ps)
   {
-    return PhotonBackTracker::OpHitLightCollectionEfficiency(tkIds, opHits_Ps, opHitsIn_Ps);
+    return fProviders.current().OpHitLightCollectionEfficiency(tkIds, opHits_Ps, opHitsIn_Ps);
   }
 
   //----------------------------------------------------------------------
   const std::set<int> PhotonBackTrackerService::OpFlashToTrackIds(art::Ptr<recob::OpFlash>& flash_P ) const{
-    return PhotonBackTracker::OpFlashToTrackIds( flash_P);
+    return fProviders.current().OpFlashToTrackIds( flash_P);
   }
 
   //----------------------------------------------------------------------
   const std::vector < art::Ptr< recob::OpHit > > PhotonBackTrackerService::OpFlashToOpHits_Ps ( art::Ptr < recob::OpFlash > & flash_P ){
-    return PhotonBackTracker::OpFlashToOpHits_Ps( flash_P);
+    return fProviders.current().OpFlashToOpHits_Ps( flash_P);
   }
 
   //----------------------------------------------------------------------
   const std::vector < double > PhotonBackTrackerService::OpFlashToXYZ ( art::Ptr < recob::OpFlash > & flash_P ){
-    return PhotonBackTracker::OpFlashToXYZ( flash_P );
+    return fProviders.current().OpFlashToXYZ( flash_P );
   }
 
 
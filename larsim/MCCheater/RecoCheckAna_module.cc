@@ -7,7 +7,9 @@
 // from art v0_07_04.
 ////////////////////////////////////////////////////////////////////////
 
+#include <algorithm> // std::find()
 #include <map>
+#include <unordered_map>
 #include <utility> // std::move()
 
 #include "TH1.h"
@@ -24,6 +26,7 @@
 #include "canvas/Persistency/Common/FindManyP.h"
 #include "canvas/Persistency/Common/Ptr.h"
 #include "canvas/Persistency/Provenance/EventID.h"
+#include "canvas/Persistency/Provenance/ProductID.h"
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
@@ -53,35 +56,45 @@ private:
   void analyze(art::Event const& e) override;
   void beginRun(art::Run const& r) override;
 
+  // backtracks all the hits of the event into the hit-particle incidence table
+  void BuildHitIncidence(detinfo::DetectorClocksData const& clockData,
+                         std::vector<art::Ptr<recob::Hit>> const& allhits);
+  // row of the incidence table for the hit, backtracking it if not yet there
+  std::size_t HitRow(detinfo::DetectorClocksData const& clockData,
+                     art::Ptr<recob::Hit> const& hit);
+  void AppendHitRow(detinfo::DetectorClocksData const& clockData,
+                    art::Ptr<recob::Hit> const& hit);
+  // number of hits of the rows with at least one of the particles
+  // (with at least the minimum energy fraction, if `efficientOnly`)
+  unsigned int CountHitsWithParticles(std::vector<std::size_t> const& rows,
+                                      std::set<int> const& trackIDs,
+                                      bool efficientOnly) const;
+  // number of hits of the event on `view` with at least the minimum energy fraction
+  // from each particle
+  std::unordered_map<int, unsigned int> const& EfficientHitsPerParticle(geo::View_t view);
+
   void CheckReco(
     detinfo::DetectorClocksData const& clockData,
     int const& colID,
-    std::vector<art::Ptr<recob::Hit>> const& allhits,
     std::vector<art::Ptr<recob::Hit>> const& colHits,
     std::map<std::pair<int, int>, std::pair<double, double>>& g4RecoBaseIDToPurityEfficiency);
   void CheckRecoClusters(art::Event const& evt,
                          std::string const& label,
-                         art::Handle<std::vector<recob::Cluster>> const& clscol,
-                         std::vector<art::Ptr<recob::Hit>> const& allhits);
+                         art::Handle<std::vector<recob::Cluster>> const& clscol);
   void CheckRecoTracks(art::Event const& evt,
                        std::string const& label,
-                       art::Handle<std::vector<recob::Track>> const& tcol,
-                       std::vector<art::Ptr<recob::Hit>> const& allhits);
+                       art::Handle<std::vector<recob::Track>> const& tcol);
   void CheckRecoShowers(art::Event const& evt,
                         std::string const& label,
-                        art::Handle<std::vector<recob::Shower>> const& scol,
-                        std::vector<art::Ptr<recob::Hit>> const& allhits);
+                        art::Handle<std::vector<recob::Shower>> const& scol);
   void CheckRecoVertices(art::Event const& evt,
                          std::string const& label,
-                         art::Handle<std::vector<recob::Vertex>> const& vtxcol,
-                         std::vector<art::Ptr<recob::Hit>> const& allhits);
+                         art::Handle<std::vector<recob::Vertex>> const& vtxcol);
   void CheckRecoEvents(art::Event const& evt,
                        std::string const& label,
-                       art::Handle<std::vector<recob::Event>> const& evtcol,
-                       std::vector<art::Ptr<recob::Hit>> const& allhits);
+                       art::Handle<std::vector<recob::Event>> const& evtcol);
   // method to fill the histograms and TTree
-  void FillResults(detinfo::DetectorClocksData const& clockData,
-                   std::vector<art::Ptr<recob::Hit>> const& allhits);
+  void FillResults();
 
   // helper method to the above for clusters, showers and tracks
   void FlattenMap(
@@ -135,6 +148,23 @@ private:
   std::map<std::pair<int, int>, std::pair<double, double>> fG4ShowerIDToPurityEfficiency;
   std::map<std::pair<int, int>, std::pair<double, double>> fG4TrackIDToPurityEfficiency;
 
+  // Hit-particle incidence table of the event: each row is a hit, with the
+  // particles contributing to it (the entries of its sim::TrackIDE), so that
+  // each hit is backtracked once and all the purities and efficiencies are
+  // sums over rows. The hits of the event come first, in their order.
+  struct HitParticle_t {
+    int trackID;    ///< G4 track ID of the particle
+    double energy;  ///< energy of the particle in the hit
+    bool efficient; ///< whether the particle passes the minimum energy fraction
+  };
+  std::vector<HitParticle_t> fHitParticles;     ///< entries of all the rows, row after row
+  std::vector<std::size_t> fHitRowBegin;        ///< first entry of each row, and the end
+  std::vector<geo::View_t> fHitRowView;         ///< view of the hit of each row
+  std::size_t fNEventHits = 0;                  ///< rows of the hits of the event
+  art::ProductID fEventHitsID;                  ///< product with the hits of the event
+  std::map<std::pair<art::ProductID, std::size_t>, std::size_t> fOtherHitRows;
+  std::map<geo::View_t, std::unordered_map<int, unsigned int>> fEfficientHitsPerView;
+
   TTree* fTree;                ///< TTree to save efficiencies
   int frun;                    ///< run number
   int fevent;                  ///< event number
@@ -196,32 +226,34 @@ cheat::RecoCheckAna::analyze(art::Event const& e)
   art::Handle<std::vector<recob::Vertex>> vtxcol;
   art::Handle<std::vector<recob::Event>> evtcol;
 
+  auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(e);
+  this->BuildHitIncidence(clockData, allhits);
+
   if (fCheckClusters) {
     e.getByLabel(fClusterModuleLabel, clscol);
-    if (!clscol.failedToGet()) this->CheckRecoClusters(e, fClusterModuleLabel, clscol, allhits);
+    if (!clscol.failedToGet()) this->CheckRecoClusters(e, fClusterModuleLabel, clscol);
   }
   if (fCheckTracks) {
     e.getByLabel(fTrackModuleLabel, trkcol);
-    if (!trkcol.failedToGet()) this->CheckRecoTracks(e, fTrackModuleLabel, trkcol, allhits);
+    if (!trkcol.failedToGet()) this->CheckRecoTracks(e, fTrackModuleLabel, trkcol);
   }
   if (fCheckShowers) {
     e.getByLabel(fShowerModuleLabel, shwcol);
-    if (!shwcol.failedToGet()) this->CheckRecoShowers(e, fShowerModuleLabel, shwcol, allhits);
+    if (!shwcol.failedToGet()) this->CheckRecoShowers(e, fShowerModuleLabel, shwcol);
   }
   if (fCheckVertices) {
     e.getByLabel(fVertexModuleLabel, vtxcol);
-    if (!vtxcol.failedToGet()) this->CheckRecoVertices(e, fVertexModuleLabel, vtxcol, allhits);
+    if (!vtxcol.failedToGet()) this->CheckRecoVertices(e, fVertexModuleLabel, vtxcol);
   }
   if (fCheckEvents) {
     e.getByLabel(fEventModuleLabel, evtcol);
-    if (!evtcol.failedToGet()) this->CheckRecoEvents(e, fEventModuleLabel, evtcol, allhits);
+    if (!evtcol.failedToGet()) this->CheckRecoEvents(e, fEventModuleLabel, evtcol);
   }
 
   frun = e.run();
   fevent = e.id().event();
 
-  auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(e);
-  this->FillResults(clockData, allhits);
+  this->FillResults();
 
   return;
 }
@@ -292,6 +324,101 @@ cheat::RecoCheckAna::beginRun(art::Run const& /*r*/)
   return;
 }
 
+//-------------------------------------------------------------------
+void
+cheat::RecoCheckAna::BuildHitIncidence(detinfo::DetectorClocksData const& clockData,
+                                       std::vector<art::Ptr<recob::Hit>> const& allhits)
+{
+  fHitParticles.clear();
+  fHitRowBegin.assign(1, 0);
+  fHitRowView.clear();
+  fOtherHitRows.clear();
+  fEfficientHitsPerView.clear();
+  fNEventHits = 0;
+  fEventHitsID = allhits.empty() ? art::ProductID{} : allhits.front().id();
+
+  // the hits of the event come from fill_ptr_vector(), so the row of each
+  // is its key; any other hit gets a row when first seen
+  for (auto const& hit : allhits)
+    this->AppendHitRow(clockData, hit);
+  fNEventHits = fHitRowView.size();
+
+  return;
+}
+
+//-------------------------------------------------------------------
+std::size_t
+cheat::RecoCheckAna::HitRow(detinfo::DetectorClocksData const& clockData,
+                            art::Ptr<recob::Hit> const& hit)
+{
+  if ((hit.id() == fEventHitsID) && (hit.key() < fNEventHits)) return hit.key();
+
+  auto const [itRow, isNew] =
+    fOtherHitRows.try_emplace(std::make_pair(hit.id(), hit.key()), fHitRowView.size());
+  if (isNew) this->AppendHitRow(clockData, hit);
+
+  return itRow->second;
+}
+
+//-------------------------------------------------------------------
+void
+cheat::RecoCheckAna::AppendHitRow(detinfo::DetectorClocksData const& clockData,
+                                  art::Ptr<recob::Hit> const& hit)
+{
+  double const minEnergyFraction = fBT->GetMinHitEnergyFraction();
+  for (auto const& trackIDE : fBT->HitToTrackIDEs(clockData, hit)) {
+    fHitParticles.push_back(
+      {trackIDE.trackID, trackIDE.energy, trackIDE.energyFrac >= minEnergyFraction});
+  }
+  fHitRowBegin.push_back(fHitParticles.size());
+  fHitRowView.push_back(hit->View());
+
+  return;
+}
+
+//-------------------------------------------------------------------
+unsigned int
+cheat::RecoCheckAna::CountHitsWithParticles(std::vector<std::size_t> const& rows,
+                                            std::set<int> const& trackIDs,
+                                            bool efficientOnly) const
+{
+  unsigned int count = 0;
+  for (std::size_t const row : rows) {
+    for (std::size_t i = fHitRowBegin[row]; i < fHitRowBegin[row + 1]; ++i) {
+      HitParticle_t const& particle = fHitParticles[i];
+      if ((particle.efficient || !efficientOnly) && (trackIDs.count(particle.trackID) > 0)) {
+        ++count;
+        break;
+      }
+    }
+  }
+  return count;
+}
+
+//-------------------------------------------------------------------
+std::unordered_map<int, unsigned int> const&
+cheat::RecoCheckAna::EfficientHitsPerParticle(geo::View_t view)
+{
+  auto const [itView, isNew] = fEfficientHitsPerView.try_emplace(view);
+  std::unordered_map<int, unsigned int>& counts = itView->second;
+  if (!isNew) return counts;
+
+  // a hit can have more than one entry for the same particle
+  std::vector<int> seen;
+  for (std::size_t row = 0; row < fNEventHits; ++row) {
+    if (fHitRowView[row] != view && view != geo::k3D) continue;
+    seen.clear();
+    for (std::size_t i = fHitRowBegin[row]; i < fHitRowBegin[row + 1]; ++i) {
+      HitParticle_t const& particle = fHitParticles[i];
+      if (!particle.efficient) continue;
+      if (std::find(seen.begin(), seen.end(), particle.trackID) != seen.end()) continue;
+      seen.push_back(particle.trackID);
+      ++counts[particle.trackID];
+    }
+  }
+  return counts;
+}
+
 //-------------------------------------------------------------------
 // colID is the ID of the RecoBase object and colHits are the recob::Hits
 // associated with it
@@ -299,39 +426,49 @@ void
 cheat::RecoCheckAna::CheckReco(
   detinfo::DetectorClocksData const& clockData,
   int const& colID,
-  std::vector<art::Ptr<recob::Hit>> const& allhits,
   std::vector<art::Ptr<recob::Hit>> const& colHits,
   std::map<std::pair<int, int>, std::pair<double, double>>& g4RecoBaseIDToPurityEfficiency)
 {
-
-  // grab the set of track IDs for these hits
-  std::set<int> trackIDs = fBT->GetSetOfTrackIds(clockData, colHits);
-
   geo::View_t view = colHits[0]->View();
 
-  std::set<int>::iterator itr = trackIDs.begin();
-  while (itr != trackIDs.end()) {
-
-    std::set<int> id;
-    id.insert(*itr);
-
-    // use the cheat::BackTrackerService to find purity and efficiency for these
-    // hits
-    double purity = fBT->HitCollectionPurity(clockData, id, colHits);
-    double efficiency = fBT->HitCollectionEfficiency(clockData, id, colHits, allhits, view);
-
-    // make the purity and efficiency pair
-    std::pair<double, double> pe(purity, efficiency);
+  // count, for each track ID in the hits, the hits it contributes to (for the
+  // purity) and the ones it contributes enough energy to (for the efficiency)
+  std::map<int, std::pair<unsigned int, unsigned int>> trackIDToHits;
+  std::vector<int> seen, seenEfficient;
+  for (auto const& hit : colHits) {
+    std::size_t const row = this->HitRow(clockData, hit);
+    seen.clear();
+    seenEfficient.clear();
+    for (std::size_t i = fHitRowBegin[row]; i < fHitRowBegin[row + 1]; ++i) {
+      HitParticle_t const& particle = fHitParticles[i];
+      auto& hits = trackIDToHits[particle.trackID];
+      if (std::find(seen.begin(), seen.end(), particle.trackID) == seen.end()) {
+        seen.push_back(particle.trackID);
+        ++hits.first;
+      }
+      if (!particle.efficient) continue;
+      if (std::find(seenEfficient.begin(), seenEfficient.end(), particle.trackID) !=
+          seenEfficient.end())
+        continue;
+      seenEfficient.push_back(particle.trackID);
+      ++hits.second;
+    }
+  }
 
-    // make the pair of the RecoBase object id to the pair of purity/efficiency
-    std::pair<int, int> g4reco(*itr, colID);
+  std::unordered_map<int, unsigned int> const& totals = this->EfficientHitsPerParticle(view);
+  for (auto const& [trackID, hits] : trackIDToHits) {
+    auto const itTotal = totals.find(trackID);
+    unsigned int const total = (itTotal == totals.end()) ? 0 : itTotal->second;
 
-    // insert idpe into the map
-    g4RecoBaseIDToPurityEfficiency[g4reco] = pe;
+    // same as the cheat::BackTrackerService purity and efficiency for these hits
+    double purity = double(hits.first) / double(colHits.size());
+    double efficiency = double(hits.second) / double(total);
 
-    itr++;
+    // insert the purity/efficiency pair for the particle and the RecoBase object
+    g4RecoBaseIDToPurityEfficiency[std::make_pair(trackID, colID)] =
+      std::make_pair(purity, efficiency);
 
-  } // end loop over eveIDs
+  } // end loop over track IDs
 
   return;
 }
@@ -340,8 +477,7 @@ cheat::RecoCheckAna::CheckReco(
 void
 cheat::RecoCheckAna::CheckRecoClusters(art::Event const& evt,
                                        std::string const& label,
-                                       art::Handle<std::vector<recob::Cluster>> const& clscol,
-                                       std::vector<art::Ptr<recob::Hit>> const& allhits)
+                                       art::Handle<std::vector<recob::Cluster>> const& clscol)
 {
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
   art::FindManyP<recob::Hit> fmh(clscol, evt, label);
@@ -351,7 +487,7 @@ cheat::RecoCheckAna::CheckRecoClusters(art::Event const& evt,
     // get the hits associated with this event
     std::vector<art::Ptr<recob::Hit>> hits = fmh.at(c);
 
-    this->CheckReco(clockData, clscol->at(c).ID(), allhits, hits, fG4ClusterIDToPurityEfficiency);
+    this->CheckReco(clockData, clscol->at(c).ID(), hits, fG4ClusterIDToPurityEfficiency);
 
   } // end loop over clusters
 
@@ -362,8 +498,7 @@ cheat::RecoCheckAna::CheckRecoClusters(art::Event const& evt,
 void
 cheat::RecoCheckAna::CheckRecoTracks(art::Event const& evt,
                                      std::string const& label,
-                                     art::Handle<std::vector<recob::Track>> const& tcol,
-                                     std::vector<art::Ptr<recob::Hit>> const& allhits)
+                                     art::Handle<std::vector<recob::Track>> const& tcol)
 {
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
   art::FindManyP<recob::Hit> fmh(tcol, evt, label);
@@ -373,7 +508,7 @@ cheat::RecoCheckAna::CheckRecoTracks(art::Event const& evt,
     // get the hits associated with this event
     std::vector<art::Ptr<recob::Hit>> hits = fmh.at(p);
 
-    this->CheckReco(clockData, tcol->at(p).ID(), allhits, hits, fG4TrackIDToPurityEfficiency);
+    this->CheckReco(clockData, tcol->at(p).ID(), hits, fG4TrackIDToPurityEfficiency);
 
   } // end loop over tracks
 
@@ -384,8 +519,7 @@ cheat::RecoCheckAna::CheckRecoTracks(art::Event const& evt,
 void
 cheat::RecoCheckAna::CheckRecoShowers(art::Event const& evt,
                                       std::string const& label,
-                                      art::Handle<std::vector<recob::Shower>> const& scol,
-                                      std::vector<art::Ptr<recob::Hit>> const& allhits)
+                                      art::Handle<std::vector<recob::Shower>> const& scol)
 {
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
   art::FindManyP<recob::Hit> fmh(scol, evt, label);
@@ -395,7 +529,7 @@ cheat::RecoCheckAna::CheckRecoShowers(art::Event const& evt,
     // get the hits associated with this event
     std::vector<art::Ptr<recob::Hit>> hits = fmh.at(p);
 
-    this->CheckReco(clockData, scol->at(p).ID(), allhits, hits, fG4ShowerIDToPurityEfficiency);
+    this->CheckReco(clockData, scol->at(p).ID(), hits, fG4ShowerIDToPurityEfficiency);
 
   } // end loop over events
 
@@ -408,8 +542,7 @@ cheat::RecoCheckAna::CheckRecoShowers(art::Event const& evt,
 void
 cheat::RecoCheckAna::CheckRecoVertices(art::Event const& evt,
                                        std::string const& label,
-                                       art::Handle<std::vector<recob::Vertex>> const& vtxcol,
-                                       std::vector<art::Ptr<recob::Hit>> const& allhits)
+                                       art::Handle<std::vector<recob::Vertex>> const& vtxcol)
 {
   const sim::ParticleList& plist = fPI->ParticleList();
 
@@ -435,20 +568,35 @@ cheat::RecoCheckAna::CheckRecoVertices(art::Event const& evt,
 
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
 
+  // the denominators of the efficiencies do not depend on the vertex
+  std::vector<std::size_t> allRows(fNEventHits);
+  for (std::size_t row = 0; row < fNEventHits; ++row)
+    allRows[row] = row;
+  std::vector<unsigned int> totals;
+  for (auto const& tv : ids)
+    totals.push_back(this->CountHitsWithParticles(allRows, tv, true));
+
+  std::vector<std::size_t> rows;
   for (size_t v = 0; v < vtxcol->size(); ++v) {
 
     // get the hits associated with this event
     std::vector<art::Ptr<recob::Hit>> hits = fmh.at(v);
+    rows.clear();
+    for (auto const& hit : hits)
+      rows.push_back(this->HitRow(clockData, hit));
 
     double maxPurity = -1.;
     double maxEfficiency = -1.;
 
     for (size_t tv = 0; tv < ids.size(); ++tv) {
 
-      // use the cheat::BackTrackerService to find purity and efficiency for
+      // same as the cheat::BackTrackerService purity and efficiency for
       // these hits
-      double purity = fBT->HitCollectionPurity(clockData, ids[tv], hits);
-      double efficiency = fBT->HitCollectionEfficiency(clockData, ids[tv], hits, allhits, geo::k3D);
+      double purity = hits.empty() ?
+                        0. :
+                        double(this->CountHitsWithParticles(rows, ids[tv], false)) / hits.size();
+      double efficiency =
+        double(this->CountHitsWithParticles(rows, ids[tv], true)) / double(totals[tv]);
 
       if (purity > maxPurity) maxPurity = purity;
       if (efficiency > maxEfficiency) maxEfficiency = efficiency;
@@ -470,8 +618,7 @@ cheat::RecoCheckAna::CheckRecoVertices(art::Event const& evt,
 void
 cheat::RecoCheckAna::CheckRecoEvents(art::Event const& evt,
                                      std::string const& label,
-                                     art::Handle<std::vector<recob::Event>> const& evtcol,
-                                     std::vector<art::Ptr<recob::Hit>> const& allhits)
+                                     art::Handle<std::vector<recob::Event>> const& evtcol)
 {
   const sim::ParticleList& plist = fPI->ParticleList();
 
@@ -490,15 +637,28 @@ cheat::RecoCheckAna::CheckRecoEvents(art::Event const& evt,
   art::FindManyP<recob::Hit> fmh(evtcol, evt, label);
 
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
+
+  // the denominator of the efficiencies does not depend on the event
+  std::vector<std::size_t> allRows(fNEventHits);
+  for (std::size_t row = 0; row < fNEventHits; ++row)
+    allRows[row] = row;
+  unsigned int const total = this->CountHitsWithParticles(allRows, ids, true);
+
+  std::vector<std::size_t> rows;
   for (size_t ev = 0; ev < evtcol->size(); ++ev) {
 
     // get the hits associated with this event
     std::vector<art::Ptr<recob::Hit>> hits = fmh.at(ev);
+    rows.clear();
+    for (auto const& hit : hits)
+      rows.push_back(this->HitRow(clockData, hit));
 
-    // use the cheat::BackTrackerService to find purity and efficiency for these
+    // same as the cheat::BackTrackerService purity and efficiency for these
     // hits
-    double purity = fBT->HitCollectionPurity(clockData, ids, hits);
-    double efficiency = fBT->HitCollectionEfficiency(clockData, ids, hits, allhits, geo::k3D);
+    double purity = hits.empty() ?
+                      0. :
+                      double(this->CountHitsWithParticles(rows, ids, false)) / hits.size();
+    double efficiency = double(this->CountHitsWithParticles(rows, ids, true)) / double(total);
 
     fEventPurity->Fill(purity);
     fEventEfficiency->Fill(efficiency);
@@ -571,16 +731,12 @@ cheat::RecoCheckAna::FlattenMap(
 
 //-------------------------------------------------------------------
 void
-cheat::RecoCheckAna::FillResults(detinfo::DetectorClocksData const& clockData,
-                                 std::vector<art::Ptr<recob::Hit>> const& allhits)
+cheat::RecoCheckAna::FillResults()
 {
   // map the g4 track id to energy deposited in a hit
   std::map<int, double> g4IDToHitEnergy;
-  for (size_t h = 0; h < allhits.size(); ++h) {
-    const std::vector<sim::TrackIDE> hitTrackIDs = fBT->HitToTrackIDEs(clockData, allhits[h]);
-    for (size_t e = 0; e < hitTrackIDs.size(); ++e) {
-      g4IDToHitEnergy[hitTrackIDs[e].trackID] += hitTrackIDs[e].energy;
-    }
+  for (std::size_t i = 0; i < fHitRowBegin[fNEventHits]; ++i) {
+    g4IDToHitEnergy[fHitParticles[i].trackID] += fHitParticles[i].energy;
   } // end loop over hits to fill map
 
   // flatten the G4RecoBaseIDToPurityEfficiency maps to have just the g4ID as
@@ -0,0 +1,149 @@
+////////////////////////////////////////////////////////////////////////
+// \file ScheduleProviders.h
+// \brief Service providers of the cheater services, one per art schedule.
+//
+// The cheater services (ParticleInventoryService, BackTrackerService,
+// PhotonBackTrackerService) are rebuilt at the start of each event from its
+// content. With more than one art schedule, events are processed
+// concurrently, and each schedule needs its own copy of the event state: the
+// services keep one provider per schedule, rebuilt by the schedule at the
+// start of its events, while the configuration and the geometry are shared
+// by all of them and never change.
+//
+// The services keep their usual interface: a query is answered by the
+// provider of the schedule whose module is running on the calling thread.
+// The schedule is recorded when art starts running the module and dropped
+// when the module is done; the record is a stack, so that a module which
+// TBB runs on a thread while another module waits there (work stealing) is
+// attributed to its own schedule, and the waiting module finds its own again
+// when it resumes. Work spawned by a module into other threads (e.g. with
+// TBB) does not carry that information: with more than one schedule it must
+// use the providers the module obtains explicitly, with `provider(sid)` and
+// the schedule ID of the module (e.g. `art::ProcessingFrame::scheduleID()`).
+//
+// The providers build the index of the event content when it is prepared,
+// and only read it afterwards; the results they memoise while answering are
+// protected by a lock. So the provider of a schedule can be queried by many
+// threads at the same time.
+////////////////////////////////////////////////////////////////////////
+#ifndef CHEAT_SCHEDULEPROVIDERS_H
+#define CHEAT_SCHEDULEPROVIDERS_H
+
+#include "art/Framework/Services/Registry/ActivityRegistry.h"
+#include "art/Persistency/Provenance/ModuleContext.h"
+#include "art/Persistency/Provenance/ScheduleContext.h"
+#include "art/Utilities/Globals.h"
+#include "art/Utilities/ScheduleID.h"
+#include "cetlib_except/exception.h"
+
+#include <cstddef> // std::size_t
+#include <memory>  // std::unique_ptr
+#include <vector>
+
+namespace cheat {
+
+  namespace details {
+
+    /// Schedules of the modules being run by art in this thread, innermost last.
+    inline std::vector<art::ScheduleID>&
+    scheduleStack()
+    {
+      thread_local std::vector<art::ScheduleID> scheduleIDs;
+      return scheduleIDs;
+    }
+
+    /// Schedule of the module being run by art in this thread (invalid if none).
+    inline art::ScheduleID
+    currentScheduleID()
+    {
+      std::vector<art::ScheduleID> const& scheduleIDs = scheduleStack();
+      return scheduleIDs.empty() ? art::ScheduleID{} : scheduleIDs.back();
+    }
+
+  } // namespace details
+
+  /**
+   * @brief One provider per art schedule, selected by the running module.
+   * @tparam Provider type of service provider
+   *
+   * The providers are created at construction, one for each of the schedules
+   * of the job, and the schedule of the modules run by art is tracked on
+   * each thread, from the start to the end of each module. `current()`
+   * returns the provider of the schedule of the module running on the
+   * calling thread; with a single schedule that is always the only provider.
+   */
+  template <typename Provider>
+  class ScheduleProviders {
+  public:
+    /**
+     * @brief Creates the providers, calling `makeProvider(scheduleID)`.
+     * @param reg registry of the service to receive the module signals from
+     * @param makeProvider returns a `std::unique_ptr<Provider>` for a schedule
+     */
+    template <typename MakeProvider>
+    ScheduleProviders(art::ActivityRegistry& reg, MakeProvider makeProvider)
+    {
+      std::size_t const nSchedules = art::Globals::instance()->nschedules();
+      fProviders.reserve(nSchedules);
+      for (std::size_t iSchedule = 0; iSchedule < nSchedules; ++iSchedule)
+        fProviders.push_back(makeProvider(art::ScheduleID(iSchedule)));
+      if (fProviders.empty()) fProviders.push_back(makeProvider(art::ScheduleID::first()));
+
+      reg.sPreModule.watch([](art::ModuleContext const& mc) {
+        details::scheduleStack().push_back(mc.scheduleID());
+      });
+      reg.sPostModule.watch([](art::ModuleContext const&) {
+        std::vector<art::ScheduleID>& scheduleIDs = details::scheduleStack();
+        if (!scheduleIDs.empty()) scheduleIDs.pop_back();
+      });
+    }
+
+    /// Returns the number of providers (schedules).
+    std::size_t
+    size() const
+    {
+      return fProviders.size();
+    }
+
+    /// Returns the provider of the schedule `sid`.
+    Provider&
+    at(art::ScheduleID sid) const
+    {
+      if (!sid.isValid() || (sid.id() >= fProviders.size())) {
+        throw cet::exception("ScheduleProviders")
+          << "No service provider for schedule " << sid << " (" << fProviders.size()
+          << " schedules configured).\n";
+      }
+      return *(fProviders[sid.id()]);
+    }
+
+    /// Returns the provider of the schedule `sc`, or the current one if invalid.
+    Provider&
+    at(art::ScheduleContext const& sc) const
+    {
+      return sc.id().isValid() ? at(sc.id()) : current();
+    }
+
+    /// Returns the provider of the schedule running the module on this thread.
+    Provider&
+    current() const
+    {
+      if (fProviders.size() == 1) return *(fProviders.front());
+      art::ScheduleID const sid = details::currentScheduleID();
+      if (!sid.isValid()) {
+        throw cet::exception("ScheduleProviders")
+          << "The art schedule of this thread is unknown: with " << fProviders.size()
+          << " schedules, cheater services can be queried only by art modules"
+             " and from their own thread (or use `provider(scheduleID)`).\n";
+      }
+      return at(sid);
+    }
+
+  private:
+    std::vector<std::unique_ptr<Provider>> fProviders; ///< Providers, by schedule.
+
+  }; // class ScheduleProviders
+
+} // namespace cheat
+
+#endif // CHEAT_SCHEDULEPROVIDERS_H
@@ -1,6 +1,6 @@
 /**
  * @file   DumpMCParticles_module.cc
- * @brief  Module dumping MCarticle information on screen
+ * @brief  Module dumping MCarticle information on screen or in a tree
  * @date   December 3rd, 2015
  * @author Gianluca Petrillo (petrillo@fnal.gov)
  *
@@ -19,6 +19,8 @@
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileService.h"
 #include "canvas/Persistency/Provenance/ProductID.h"
 #include "canvas/Persistency/Common/FindOneP.h"
 #include "canvas/Utilities/InputTag.h"
@@ -26,6 +28,9 @@
 #include "fhiclcpp/types/OptionalAtom.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
+// ROOT libraries
+#include "TTree.h"
+
 // C/C++ standard libraries
 #include <memory> // std::unique_ptr<>
 #include <string>
@@ -65,6 +70,15 @@ namespace {
       2 /* default value */
       };
 
+    fhicl::Atom<bool> OutputTree {
+      Name("OutputTree"),
+      Comment(
+        "write flat trees via TFileService instead of text: one entry per"
+        " particle, and one per trajectory point unless PointsPerLine is 0"
+        ),
+      false /* default value */
+      };
+
   }; // struct Config
 
 
@@ -122,6 +136,30 @@ class sim::DumpMCParticles: public art::EDAnalyzer {
 
     private:
 
+  /// Content of a particle entry of the `OutputTree` output.
+  struct ParticleEntry_t {
+    UInt_t run, subRun, event;
+    UInt_t index; ///< Index of the particle in the data product.
+    Int_t trackID, statusCode, pdgCode, mother, nDaughters;
+    Int_t generatorIndex; ///< Index in the truth record (-1 if unknown).
+    std::string process, endProcess;
+    Double_t mass, weight;
+    Double_t startX, startY, startZ, startT;
+    Double_t startPx, startPy, startPz, startE;
+    Double_t endX, endY, endZ, endT;
+    Double_t endPx, endPy, endPz, endE;
+    UInt_t nPoints;
+  }; // ParticleEntry_t
+
+  /// Content of a trajectory point entry of the `OutputTree` output.
+  struct PointEntry_t {
+    UInt_t run, subRun, event;
+    UInt_t index; ///< Index of the particle in the data product.
+    UInt_t point; ///< Index of the point in the trajectory.
+    Double_t x, y, z, t;
+    Double_t px, py, pz, E;
+  }; // PointEntry_t
+
   art::InputTag fInputParticles; ///< name of MCParticle's data product
   art::InputTag fParticleTruthInfo; ///< name of MCParticle assns data product
   std::string fOutputCategory; ///< name of the stream for output
@@ -133,6 +171,21 @@ class sim::DumpMCParticles: public art::EDAnalyzer {
   /// Count of events without truth index.
   unsigned int fNMissingTruthIndex = 0U;
 
+  TTree* fParticleTree = nullptr; ///< Particle tree (only with `OutputTree`).
+  TTree* fPointTree = nullptr; ///< Trajectory point tree (if any).
+  ParticleEntry_t fParticleEntry; ///< Buffer of the particle tree branches.
+  PointEntry_t fPointEntry; ///< Buffer of the trajectory point tree branches.
+
+  /// Creates the output trees and their branches.
+  void makeTrees();
+
+  /// Fills the output trees with the content of the particle.
+  void fillTrees(
+    art::Event const& event, unsigned int iParticle,
+    simb::MCParticle const& particle,
+    sim::GeneratedParticleInfo const& truthInfo
+    );
+
 }; // class sim::DumpMCParticles
 
 
@@ -212,6 +265,8 @@ sim::DumpMCParticles::DumpMCParticles(Parameters const& config)
   if (!config().ParticleTruthInfo(fParticleTruthInfo))
     fParticleTruthInfo = fInputParticles;
 
+  if (config().OutputTree()) makeTrees();
+
 }
 
 //------------------------------------------------------------------------------
@@ -271,12 +326,24 @@ void sim::DumpMCParticles::analyze(art::Event const& event) {
     if (!particleToTruthLight) ++fNMissingTruth;
   }
 
-  mf::LogVerbatim(fOutputCategory) << "Event " << event.id()
-    << ": data product '" << fInputParticles.encode() << "' contains "
-    << Particles.size() << " MCParticle's";
+  if (!fParticleTree) {
+    mf::LogVerbatim(fOutputCategory) << "Event " << event.id()
+      << ": data product '" << fInputParticles.encode() << "' contains "
+      << Particles.size() << " MCParticle's";
+  }
 
   unsigned int iParticle = 0;
   for (simb::MCParticle const& particle: Particles) {
+
+    if (fParticleTree) {
+      sim::GeneratedParticleInfo const truthInfo = particleToTruth
+        ? particleToTruth->data(iParticle).ref()
+        : sim::GeneratedParticleInfo::NoGeneratedParticleIndex
+        ;
+      fillTrees(event, iParticle++, particle, truthInfo);
+      continue;
+    }
+
     // flush on every particle,
     // since the output buffer might grow too large otherwise
     mf::LogVerbatim log(fOutputCategory);
@@ -302,11 +369,140 @@ void sim::DumpMCParticles::analyze(art::Event const& event) {
     DumpMCParticle(log, particle, truthTag, truthInfo, "  ", false);
   } // for
 
-  mf::LogVerbatim(fOutputCategory) << "\n";
+  if (!fParticleTree) mf::LogVerbatim(fOutputCategory) << "\n";
 
 } // sim::DumpMCParticles::analyze()
 
 
+//------------------------------------------------------------------------------
+void sim::DumpMCParticles::makeTrees() {
+
+  art::ServiceHandle<art::TFileService> tfs;
+
+  auto& p = fParticleEntry;
+  fParticleTree = tfs->make<TTree>
+    ("MCParticles", ("particles of " + fInputParticles.encode()).c_str());
+  fParticleTree->Branch("run", &p.run);
+  fParticleTree->Branch("subRun", &p.subRun);
+  fParticleTree->Branch("event", &p.event);
+  fParticleTree->Branch("index", &p.index);
+  fParticleTree->Branch("trackID", &p.trackID);
+  fParticleTree->Branch("statusCode", &p.statusCode);
+  fParticleTree->Branch("pdgCode", &p.pdgCode);
+  fParticleTree->Branch("mother", &p.mother);
+  fParticleTree->Branch("nDaughters", &p.nDaughters);
+  fParticleTree->Branch("generatorIndex", &p.generatorIndex);
+  fParticleTree->Branch("process", &p.process);
+  fParticleTree->Branch("endProcess", &p.endProcess);
+  fParticleTree->Branch("mass", &p.mass);
+  fParticleTree->Branch("weight", &p.weight);
+  fParticleTree->Branch("startX", &p.startX);
+  fParticleTree->Branch("startY", &p.startY);
+  fParticleTree->Branch("startZ", &p.startZ);
+  fParticleTree->Branch("startT", &p.startT);
+  fParticleTree->Branch("startPx", &p.startPx);
+  fParticleTree->Branch("startPy", &p.startPy);
+  fParticleTree->Branch("startPz", &p.startPz);
+  fParticleTree->Branch("startE", &p.startE);
+  fParticleTree->Branch("endX", &p.endX);
+  fParticleTree->Branch("endY", &p.endY);
+  fParticleTree->Branch("endZ", &p.endZ);
+  fParticleTree->Branch("endT", &p.endT);
+  fParticleTree->Branch("endPx", &p.endPx);
+  fParticleTree->Branch("endPy", &p.endPy);
+  fParticleTree->Branch("endPz", &p.endPz);
+  fParticleTree->Branch("endE", &p.endE);
+  fParticleTree->Branch("nPoints", &p.nPoints);
+
+  if (fPointsPerLine == 0) return;
+
+  auto& t = fPointEntry;
+  fPointTree = tfs->make<TTree>("MCTrajectoryPoints",
+    ("trajectory points of " + fInputParticles.encode()).c_str());
+  fPointTree->Branch("run", &t.run);
+  fPointTree->Branch("subRun", &t.subRun);
+  fPointTree->Branch("event", &t.event);
+  fPointTree->Branch("index", &t.index);
+  fPointTree->Branch("point", &t.point);
+  fPointTree->Branch("x", &t.x);
+  fPointTree->Branch("y", &t.y);
+  fPointTree->Branch("z", &t.z);
+  fPointTree->Branch("t", &t.t);
+  fPointTree->Branch("px", &t.px);
+  fPointTree->Branch("py", &t.py);
+  fPointTree->Branch("pz", &t.pz);
+  fPointTree->Branch("E", &t.E);
+
+} // sim::DumpMCParticles::makeTrees()
+
+
+//------------------------------------------------------------------------------
+void sim::DumpMCParticles::fillTrees(
+  art::Event const& event, unsigned int iParticle,
+  simb::MCParticle const& particle,
+  sim::GeneratedParticleInfo const& truthInfo
+) {
+
+  auto& p = fParticleEntry;
+  p.run = event.run();
+  p.subRun = event.subRun();
+  p.event = event.event();
+  p.index = iParticle;
+  p.trackID = particle.TrackId();
+  p.statusCode = particle.StatusCode();
+  p.pdgCode = particle.PdgCode();
+  p.mother = particle.Mother();
+  p.nDaughters = particle.NumberDaughters();
+  p.generatorIndex = truthInfo.hasGeneratedParticleIndex()
+    ? static_cast<Int_t>(truthInfo.generatedParticleIndex()): -1;
+  p.process = particle.Process();
+  p.endProcess = particle.EndProcess();
+  p.mass = particle.Mass();
+  p.weight = particle.Weight();
+
+  unsigned int const nPoints = particle.NumberTrajectoryPoints();
+  p.nPoints = nPoints;
+  if (nPoints > 0) {
+    TLorentzVector const& start = particle.Position();
+    TLorentzVector const& startMom = particle.Momentum();
+    TLorentzVector const& end = particle.EndPosition();
+    TLorentzVector const& endMom = particle.EndMomentum();
+    p.startX = start.X(); p.startY = start.Y();
+    p.startZ = start.Z(); p.startT = start.T();
+    p.startPx = startMom.Px(); p.startPy = startMom.Py();
+    p.startPz = startMom.Pz(); p.startE = startMom.E();
+    p.endX = end.X(); p.endY = end.Y(); p.endZ = end.Z(); p.endT = end.T();
+    p.endPx = endMom.Px(); p.endPy = endMom.Py();
+    p.endPz = endMom.Pz(); p.endE = endMom.E();
+  }
+  else {
+    p.startX = p.startY = p.startZ = p.startT = 0.0;
+    p.startPx = p.startPy = p.startPz = p.startE = 0.0;
+    p.endX = p.endY = p.endZ = p.endT = 0.0;
+    p.endPx = p.endPy = p.endPz = p.endE = 0.0;
+  }
+  fParticleTree->Fill();
+
+  if (!fPointTree) return;
+
+  auto& t = fPointEntry;
+  t.run = p.run;
+  t.subRun = p.subRun;
+  t.event = p.event;
+  t.index = iParticle;
+  simb::MCTrajectory const& trajectory = particle.Trajectory();
+  for (unsigned int iPoint = 0; iPoint < nPoints; ++iPoint) {
+    TLorentzVector const& pos = trajectory.Position(iPoint);
+    TLorentzVector const& mom = trajectory.Momentum(iPoint);
+    t.point = iPoint;
+    t.x = pos.X(); t.y = pos.Y(); t.z = pos.Z(); t.t = pos.T();
+    t.px = mom.Px(); t.py = mom.Py(); t.pz = mom.Pz(); t.E = mom.E();
+    fPointTree->Fill();
+  } // for points
+
+} // sim::DumpMCParticles::fillTrees()
+
+
 //------------------------------------------------------------------------------
 void sim::DumpMCParticles::endJob() {
 
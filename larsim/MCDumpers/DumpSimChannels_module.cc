@@ -1,6 +1,6 @@
 /**
  * @file   DumpSimChannels_module.cc
- * @brief  Module dumping SimChannels information on screen
+ * @brief  Module dumping SimChannels information on screen or in a tree
  * @date   March 30, 2016
  * @author Gianluca Petrillo (petrillo@fnal.gov)
  *
@@ -9,16 +9,37 @@
 
 // lardataobj libraries
 #include "lardataobj/Simulation/SimChannel.h"
+#include "larcoreobj/SimpleTypesAndConstants/RawTypes.h" // raw::ChannelID_t
 
 // framework libraries
 #include "art/Framework/Core/EDAnalyzer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileService.h"
 #include "canvas/Utilities/InputTag.h"
 #include "fhiclcpp/types/Atom.h"
+#include "fhiclcpp/types/OptionalSequence.h"
+#include "fhiclcpp/types/Sequence.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
+// ROOT libraries
+#include "TTree.h"
+
+// TBB libraries
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
+// C/C++ standard libraries
+#include <algorithm> // std::lower_bound(), std::upper_bound()
+#include <array>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
 
 namespace sim {
   class DumpSimChannels;
@@ -43,6 +64,35 @@ namespace {
       "DumpSimChannels" /* default value */
       };
 
+    fhicl::Atom<bool> OutputTree {
+      Name("OutputTree"),
+      Comment
+        ("write a flat tree (one entry per IDE) via TFileService instead of text"),
+      false /* default value */
+      };
+
+    fhicl::OptionalSequence<raw::ChannelID_t, 2U> ChannelRange {
+      Name("ChannelRange"),
+      Comment("dump only the channels in [ first, last ] (default: all)")
+      };
+
+    fhicl::OptionalSequence<unsigned int, 2U> TDCRange {
+      Name("TDCRange"),
+      Comment("dump only the TDC ticks in [ first, last ] (default: all)")
+      };
+
+    fhicl::Sequence<int> TrackIDs {
+      Name("TrackIDs"),
+      Comment("dump only the IDEs from these track IDs (default: all)"),
+      std::vector<int>{}
+      };
+
+    fhicl::Atom<bool> ParallelFormatting {
+      Name("ParallelFormatting"),
+      Comment("format the channels in parallel, then print them in order"),
+      false /* default value */
+      };
+
   }; // struct Config
 
 
@@ -87,12 +137,68 @@ class sim::DumpSimChannels: public art::EDAnalyzer {
     std::string indent = "", bool bIndentFirst = true
     ) const;
 
+  /**
+   * @brief Dumps the selected TDC ticks and IDEs of the specified SimChannel
+   * @see DumpSimChannel()
+   *
+   * The layout is the same as `sim::SimChannel::Dump()`, but only the IDEs
+   * passing the TDC and track ID selection appear, and the totals include
+   * only them. Ticks with no selected IDE are omitted.
+   */
+  template <typename Stream>
+  void DumpSelectedSimChannel(
+    Stream&& out, sim::SimChannel const& simchannel,
+    std::string indent = "", bool bIndentFirst = true
+    ) const;
+
 
     private:
 
+  /// Content of a `OutputTree` entry: one ionization deposit on a channel.
+  struct TreeEntry_t {
+    UInt_t run, subRun, event;
+    UInt_t channel;
+    UInt_t tdc;
+    Int_t trackID, origTrackID;
+    Float_t numElectrons, energy;
+    Float_t x, y, z;
+  }; // TreeEntry_t
+
   art::InputTag fInputChannels; ///< name of SimChannel's data product
   std::string fOutputCategory; ///< name of the stream for output
 
+  TTree* fTree = nullptr; ///< Output tree (only with `OutputTree`).
+  TreeEntry_t fEntry; ///< Buffer of the output tree branches.
+
+  /// Range of channels to be dumped (both included).
+  std::array<raw::ChannelID_t, 2U> fChannelRange
+    {{ 0U, std::numeric_limits<raw::ChannelID_t>::max() }};
+  /// Range of TDC ticks to be dumped (both included).
+  std::array<unsigned int, 2U> fTDCRange
+    {{ 0U, std::numeric_limits<unsigned int>::max() }};
+  std::set<int> fTrackIDs; ///< Tracks whose IDEs are dumped (empty: all).
+  bool fSelectIDEs = false; ///< Whether a TDC or track selection is set.
+  bool fParallelFormatting; ///< Format channels in parallel.
+
+  /// Returns whether the channel is in the selected range.
+  bool isSelected(sim::SimChannel const& channel) const
+    {
+      return (channel.Channel() >= fChannelRange[0])
+        && (channel.Channel() <= fChannelRange[1]);
+    }
+
+  /// Returns whether the IDE is from one of the selected tracks.
+  bool isSelected(sim::IDE const& ide) const
+    { return fTrackIDs.empty() || (fTrackIDs.count(ide.trackID) > 0); }
+
+  /// Dumps the channel with the selection (if any).
+  template <typename Stream>
+  void DumpChannel(Stream&& out, sim::SimChannel const& channel) const;
+
+  /// Fills the output tree with the content of the channels.
+  void fillTree
+    (art::Event const& event, std::vector<sim::SimChannel> const& channels);
+
 }; // class sim::DumpSimChannels
 
 
@@ -104,7 +210,30 @@ sim::DumpSimChannels::DumpSimChannels(Parameters const& config)
   : EDAnalyzer(config)
   , fInputChannels(config().InputSimChannels())
   , fOutputCategory(config().OutputCategory())
-{}
+  , fParallelFormatting(config().ParallelFormatting())
+{
+  config().ChannelRange(fChannelRange);
+  bool const hasTDCRange = config().TDCRange(fTDCRange);
+  for (int trackID: config().TrackIDs()) fTrackIDs.insert(trackID);
+  fSelectIDEs = hasTDCRange || !fTrackIDs.empty();
+
+  if (config().OutputTree()) {
+    fTree = art::ServiceHandle<art::TFileService>()->make<TTree>
+      ("SimChannels", ("IDEs of " + fInputChannels.encode()).c_str());
+    fTree->Branch("run", &fEntry.run);
+    fTree->Branch("subRun", &fEntry.subRun);
+    fTree->Branch("event", &fEntry.event);
+    fTree->Branch("channel", &fEntry.channel);
+    fTree->Branch("tdc", &fEntry.tdc);
+    fTree->Branch("trackID", &fEntry.trackID);
+    fTree->Branch("origTrackID", &fEntry.origTrackID);
+    fTree->Branch("numElectrons", &fEntry.numElectrons);
+    fTree->Branch("energy", &fEntry.energy);
+    fTree->Branch("x", &fEntry.x);
+    fTree->Branch("y", &fEntry.y);
+    fTree->Branch("z", &fEntry.z);
+  }
+}
 
 
 //------------------------------------------------------------------------------
@@ -118,6 +247,65 @@ void sim::DumpSimChannels::DumpSimChannel(
 } // sim::DumpSimChannels::DumpSimChannels()
 
 
+//------------------------------------------------------------------------------
+template <typename Stream>
+void sim::DumpSimChannels::DumpSelectedSimChannel(
+  Stream&& out, sim::SimChannel const& channel,
+  std::string indent /* = "" */, bool bIndentFirst /* = true */
+) const {
+  auto const& TDCIDEs = channel.TDCIDEMap(); // sorted by TDC
+  auto const tdcLess = [](auto const& TDCinfo, unsigned int tdc)
+    { return TDCinfo.first < tdc; };
+  auto const tdcGreater = [](unsigned int tdc, auto const& TDCinfo)
+    { return tdc < TDCinfo.first; };
+  auto const begin = std::lower_bound
+    (TDCIDEs.begin(), TDCIDEs.end(), fTDCRange[0], tdcLess);
+  auto const end = std::upper_bound(begin, TDCIDEs.end(), fTDCRange[1], tdcGreater);
+
+  std::ostringstream ticks;
+  unsigned int nTDCs = 0U;
+  double channel_energy = 0., channel_charge = 0.;
+  for (auto iTDC = begin; iTDC != end; ++iTDC) {
+    std::ostringstream ides;
+    unsigned int nIDEs = 0U;
+    double tdc_energy = 0., tdc_charge = 0.;
+    for (sim::IDE const& ide: iTDC->second) {
+      if (!isSelected(ide)) continue;
+      ides << "\n" << indent << "     (" << ide.x << ", " << ide.y << ", "
+        << ide.z << ") " << ide.numElectrons << " electrons, " << ide.energy
+        << " MeV (trkID=" << ide.trackID << ")";
+      tdc_energy += ide.energy;
+      tdc_charge += ide.numElectrons;
+      ++nIDEs;
+    } // for IDEs
+    if (nIDEs == 0U) continue;
+    ticks << "\n" << indent << "  TDC #" << iTDC->first << " with " << nIDEs
+      << " IDEs" << ides.str()
+      << "\n" << indent << "    => energy: " << tdc_energy << " MeV, charge: "
+      << tdc_charge << " electrons";
+    channel_energy += tdc_energy;
+    channel_charge += tdc_charge;
+    ++nTDCs;
+  } // for TDCs
+
+  if (bIndentFirst) out << indent;
+  out << "channel #" << channel.Channel() << " read " << nTDCs
+    << " selected TDCs:" << ticks.str()
+    << "\n" << indent << "  => channel " << channel.Channel() << " collected "
+    << channel_charge << " electrons from " << channel_energy << " MeV";
+} // sim::DumpSimChannels::DumpSelectedSimChannel()
+
+
+//------------------------------------------------------------------------------
+template <typename Stream>
+void sim::DumpSimChannels::DumpChannel
+  (Stream&& out, sim::SimChannel const& channel) const
+{
+  if (fSelectIDEs) DumpSelectedSimChannel(out, channel, "  ", false);
+  else             DumpSimChannel(out, channel, "  ", false);
+} // sim::DumpSimChannels::DumpChannel()
+
+
 //------------------------------------------------------------------------------
 void sim::DumpSimChannels::analyze(art::Event const& event) {
 
@@ -125,24 +313,79 @@ void sim::DumpSimChannels::analyze(art::Event const& event) {
   auto const& SimChannels
     = *(event.getValidHandle<std::vector<sim::SimChannel>>(fInputChannels));
 
+  if (fTree) {
+    fillTree(event, SimChannels);
+    return;
+  }
+
   mf::LogVerbatim(fOutputCategory) << "Event " << event.id()
     << " : data product '" << fInputChannels.encode() << "' contains "
     << SimChannels.size() << " SimChannels";
 
-  unsigned int iSimChannel = 0;
-  for (sim::SimChannel const& simChannel: SimChannels) {
-
-    // a bit of a header
-    mf::LogVerbatim log(fOutputCategory);
-    log << "[#" << (iSimChannel++) << "] ";
-    DumpSimChannel(log, simChannel, "  ", false);
-
-  } // for
+  // the selection is applied before any formatting
+  std::vector<std::size_t> selected;
+  for (std::size_t iSimChannel = 0; iSimChannel < SimChannels.size(); ++iSimChannel)
+    if (isSelected(SimChannels[iSimChannel])) selected.push_back(iSimChannel);
+
+  if (fParallelFormatting) {
+    std::vector<std::string> buffers(selected.size());
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, selected.size()),
+      [&](tbb::blocked_range<std::size_t> const& range) {
+        for (std::size_t i = range.begin(); i != range.end(); ++i) {
+          std::ostringstream sstr;
+          sstr << "[#" << selected[i] << "] ";
+          DumpChannel(sstr, SimChannels[selected[i]]);
+          buffers[i] = sstr.str();
+        }
+      });
+    for (std::string const& buffer: buffers)
+      mf::LogVerbatim(fOutputCategory) << buffer;
+  }
+  else {
+    for (std::size_t const iSimChannel: selected) {
+
+      // a bit of a header
+      mf::LogVerbatim log(fOutputCategory);
+      log << "[#" << iSimChannel << "] ";
+      DumpChannel(log, SimChannels[iSimChannel]);
+
+    } // for
+  }
   mf::LogVerbatim(fOutputCategory) << "\n";
 
 } // sim::DumpSimChannels::analyze()
 
 
+//------------------------------------------------------------------------------
+void sim::DumpSimChannels::fillTree
+  (art::Event const& event, std::vector<sim::SimChannel> const& channels)
+{
+  fEntry.run = event.run();
+  fEntry.subRun = event.subRun();
+  fEntry.event = event.event();
+  for (sim::SimChannel const& channel: channels) {
+    if (!isSelected(channel)) continue;
+    fEntry.channel = channel.Channel();
+    for (auto const& TDCinfo: channel.TDCIDEMap()) {
+      if ((TDCinfo.first < fTDCRange[0]) || (TDCinfo.first > fTDCRange[1]))
+        continue;
+      fEntry.tdc = TDCinfo.first;
+      for (sim::IDE const& ide: TDCinfo.second) {
+        if (!isSelected(ide)) continue;
+        fEntry.trackID = ide.trackID;
+        fEntry.origTrackID = ide.origTrackID;
+        fEntry.numElectrons = ide.numElectrons;
+        fEntry.energy = ide.energy;
+        fEntry.x = ide.x;
+        fEntry.y = ide.y;
+        fEntry.z = ide.z;
+        fTree->Fill();
+      } // for IDEs
+    } // for TDCs
+  } // for channels
+} // sim::DumpSimChannels::fillTree()
+
+
 //------------------------------------------------------------------------------
 DEFINE_ART_MODULE(sim::DumpSimChannels)
 
@@ -1,6 +1,6 @@
 /**
  * @file   DumpSimPhotons_module.cc
- * @brief  Module dumping SimPhotons information on screen
+ * @brief  Module dumping SimPhotons information on screen or in a tree
  * @date   March 30, 2016
  * @author Gianluca Petrillo (petrillo@fnal.gov)
  *
@@ -16,10 +16,15 @@
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileService.h"
 #include "canvas/Utilities/InputTag.h"
 #include "fhiclcpp/types/Atom.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
+// ROOT libraries
+#include "TTree.h"
+
 
 
 namespace sim {
@@ -45,6 +50,13 @@ namespace {
       "DumpSimPhotons" /* default value */
       };
 
+    fhicl::Atom<bool> OutputTree {
+      Name("OutputTree"),
+      Comment
+        ("write a flat tree (one entry per photon) via TFileService instead of text"),
+      false /* default value */
+      };
+
   }; // struct Config
 
 
@@ -157,9 +169,27 @@ class sim::DumpSimPhotons: public art::EDAnalyzer {
 
     private:
 
+  /// Content of a `OutputTree` entry: one photon on an optical channel.
+  struct TreeEntry_t {
+    UInt_t run, subRun, event;
+    Int_t opChannel;
+    Float_t time, energy;
+    Int_t motherTrackID;
+    Bool_t inSD;
+    Float_t x, y, z; ///< Initial position [cm]
+    Float_t finalX, finalY, finalZ; ///< Final local position [cm]
+  }; // TreeEntry_t
+
   art::InputTag fInputPhotons; ///< name of SimPhotons's data product
   std::string fOutputCategory; ///< name of the stream for output
 
+  TTree* fTree = nullptr; ///< Output tree (only with `OutputTree`).
+  TreeEntry_t fEntry; ///< Buffer of the output tree branches.
+
+  /// Fills the output tree with the content of the photon collections.
+  void fillTree
+    (art::Event const& event, std::vector<sim::SimPhotons> const& photons);
+
 }; // class sim::DumpSimPhotons
 
 
@@ -171,7 +201,26 @@ sim::DumpSimPhotons::DumpSimPhotons(Parameters const& config)
   : EDAnalyzer(config)
   , fInputPhotons(config().InputPhotons())
   , fOutputCategory(config().OutputCategory())
-{}
+{
+  if (config().OutputTree()) {
+    fTree = art::ServiceHandle<art::TFileService>()->make<TTree>
+      ("SimPhotons", ("photons of " + fInputPhotons.encode()).c_str());
+    fTree->Branch("run", &fEntry.run);
+    fTree->Branch("subRun", &fEntry.subRun);
+    fTree->Branch("event", &fEntry.event);
+    fTree->Branch("opChannel", &fEntry.opChannel);
+    fTree->Branch("time", &fEntry.time);
+    fTree->Branch("energy", &fEntry.energy);
+    fTree->Branch("motherTrackID", &fEntry.motherTrackID);
+    fTree->Branch("inSD", &fEntry.inSD);
+    fTree->Branch("x", &fEntry.x);
+    fTree->Branch("y", &fEntry.y);
+    fTree->Branch("z", &fEntry.z);
+    fTree->Branch("finalX", &fEntry.finalX);
+    fTree->Branch("finalY", &fEntry.finalY);
+    fTree->Branch("finalZ", &fEntry.finalZ);
+  }
+}
 
 //------------------------------------------------------------------------------
 template <typename Stream>
@@ -222,6 +271,11 @@ void sim::DumpSimPhotons::analyze(art::Event const& event) {
   auto const& SimPhotons
     = *(event.getValidHandle<std::vector<sim::SimPhotons>>(fInputPhotons));
 
+  if (fTree) {
+    fillTree(event, SimPhotons);
+    return;
+  }
+
   mf::LogVerbatim(fOutputCategory) << "Event " << event.id()
     << " : data product '" << fInputPhotons.encode() << "' contains "
     << SimPhotons.size() << " SimPhotons";
@@ -240,6 +294,33 @@ void sim::DumpSimPhotons::analyze(art::Event const& event) {
 } // sim::DumpSimPhotons::analyze()
 
 
+//------------------------------------------------------------------------------
+void sim::DumpSimPhotons::fillTree
+  (art::Event const& event, std::vector<sim::SimPhotons> const& photons)
+{
+  // photons are stored as they are, without the sorting of the text dump
+  fEntry.run = event.run();
+  fEntry.subRun = event.subRun();
+  fEntry.event = event.event();
+  for (sim::SimPhotons const& channelPhotons: photons) {
+    fEntry.opChannel = channelPhotons.OpChannel();
+    for (sim::OnePhoton const& photon: channelPhotons) {
+      fEntry.time = photon.Time;
+      fEntry.energy = photon.Energy;
+      fEntry.motherTrackID = photon.MotherTrackID;
+      fEntry.inSD = photon.SetInSD;
+      fEntry.x = photon.InitialPosition.X();
+      fEntry.y = photon.InitialPosition.Y();
+      fEntry.z = photon.InitialPosition.Z();
+      fEntry.finalX = photon.FinalLocalPosition.X();
+      fEntry.finalY = photon.FinalLocalPosition.Y();
+      fEntry.finalZ = photon.FinalLocalPosition.Z();
+      fTree->Fill();
+    } // for photons
+  } // for channels
+} // sim::DumpSimPhotons::fillTree()
+
+
 //------------------------------------------------------------------------------
 DEFINE_ART_MODULE(sim::DumpSimPhotons)
 
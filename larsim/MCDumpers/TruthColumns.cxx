@@ -0,0 +1,194 @@
+/**
+ * @file   TruthColumns.cxx
+ * @brief  Simulation truth flattened into columns, one per data member.
+ * @see    TruthColumns.h
+ */
+
+#include "larsim/MCDumpers/TruthColumns.h"
+
+// LArSoft and nutools libraries
+#include "lardataobj/Simulation/OpDetBacktrackerRecord.h"
+#include "lardataobj/Simulation/SimChannel.h"
+#include "lardataobj/Simulation/SimEnergyDeposit.h"
+#include "nusimdata/SimulationBase/MCParticle.h"
+
+// TBB libraries
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
+namespace {
+
+  /// Calls `f(i)` for all `i` in `[ 0, n [`, on many tasks if `parallel`.
+  template <typename F>
+  void
+  forEachIndex(std::size_t n, bool parallel, F const& f)
+  {
+    if (!parallel) {
+      for (std::size_t i = 0; i < n; ++i)
+        f(i);
+      return;
+    }
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, n),
+                      [&f](tbb::blocked_range<std::size_t> const& range) {
+                        for (std::size_t i = range.begin(); i != range.end(); ++i)
+                          f(i);
+                      });
+  }
+
+  /// Sets all the columns to `n` rows.
+  template <typename Columns>
+  void
+  resizeColumns(Columns& columns, std::size_t n)
+  {
+    columns.forEachColumn([n](char const*, auto& column) {
+      column.clear(); // no stale content
+      column.resize(n);
+    });
+  }
+
+  /// Returns the first row of each element (and the total at the end).
+  template <typename Coll, typename Count>
+  std::vector<std::size_t>
+  rowOffsets(Coll const& coll, Count count)
+  {
+    std::vector<std::size_t> offsets;
+    offsets.reserve(coll.size() + 1);
+    std::size_t n = 0;
+    for (auto const& element : coll) {
+      offsets.push_back(n);
+      n += count(element);
+    }
+    offsets.push_back(n);
+    return offsets;
+  }
+
+} // local namespace
+
+//------------------------------------------------------------------------------
+void
+sim::ParticleColumns::fill(std::vector<simb::MCParticle> const& particles, bool parallel)
+{
+  resizeColumns(*this, particles.size());
+  forEachIndex(particles.size(), parallel, [this, &particles](std::size_t i) {
+    simb::MCParticle const& particle = particles[i];
+    index[i] = i;
+    trackID[i] = particle.TrackId();
+    statusCode[i] = particle.StatusCode();
+    pdgCode[i] = particle.PdgCode();
+    mother[i] = particle.Mother();
+    nDaughters[i] = particle.NumberDaughters();
+    process[i] = particle.Process();
+    endProcess[i] = particle.EndProcess();
+    mass[i] = particle.Mass();
+    weight[i] = particle.Weight();
+    nPoints[i] = particle.NumberTrajectoryPoints();
+    if (nPoints[i] == 0) return; // all kinematics stay 0
+    TLorentzVector const& start = particle.Position();
+    TLorentzVector const& startMom = particle.Momentum();
+    TLorentzVector const& end = particle.EndPosition();
+    TLorentzVector const& endMom = particle.EndMomentum();
+    startX[i] = start.X();
+    startY[i] = start.Y();
+    startZ[i] = start.Z();
+    startT[i] = start.T();
+    startPx[i] = startMom.Px();
+    startPy[i] = startMom.Py();
+    startPz[i] = startMom.Pz();
+    startE[i] = startMom.E();
+    endX[i] = end.X();
+    endY[i] = end.Y();
+    endZ[i] = end.Z();
+    endT[i] = end.T();
+    endPx[i] = endMom.Px();
+    endPy[i] = endMom.Py();
+    endPz[i] = endMom.Pz();
+    endE[i] = endMom.E();
+  });
+}
+
+//------------------------------------------------------------------------------
+void
+sim::SimChannelColumns::fill(std::vector<sim::SimChannel> const& channels, bool parallel)
+{
+  std::vector<std::size_t> const offsets = rowOffsets(channels, [](sim::SimChannel const& sc) {
+    std::size_t n = 0;
+    for (auto const& TDCinfo : sc.TDCIDEMap())
+      n += TDCinfo.second.size();
+    return n;
+  });
+  resizeColumns(*this, offsets.back());
+  forEachIndex(channels.size(), parallel, [this, &channels, &offsets](std::size_t iChannel) {
+    sim::SimChannel const& sc = channels[iChannel];
+    std::size_t row = offsets[iChannel];
+    for (auto const& TDCinfo : sc.TDCIDEMap()) {
+      for (sim::IDE const& ide : TDCinfo.second) {
+        channel[row] = sc.Channel();
+        tdc[row] = TDCinfo.first;
+        trackID[row] = ide.trackID;
+        origTrackID[row] = ide.origTrackID;
+        numElectrons[row] = ide.numElectrons;
+        energy[row] = ide.energy;
+        x[row] = ide.x;
+        y[row] = ide.y;
+        z[row] = ide.z;
+        ++row;
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+void
+sim::EnergyDepositColumns::fill(std::vector<sim::SimEnergyDeposit> const& deposits, bool parallel)
+{
+  resizeColumns(*this, deposits.size());
+  forEachIndex(deposits.size(), parallel, [this, &deposits](std::size_t i) {
+    sim::SimEnergyDeposit const& edep = deposits[i];
+    trackID[i] = edep.TrackID();
+    pdgCode[i] = edep.PdgCode();
+    numPhotons[i] = edep.NumPhotons();
+    numElectrons[i] = edep.NumElectrons();
+    scintYieldRatio[i] = edep.ScintYieldRatio();
+    energy[i] = edep.Energy();
+    startX[i] = edep.StartX();
+    startY[i] = edep.StartY();
+    startZ[i] = edep.StartZ();
+    endX[i] = edep.EndX();
+    endY[i] = edep.EndY();
+    endZ[i] = edep.EndZ();
+    startT[i] = edep.T0();
+    endT[i] = edep.T1();
+  });
+}
+
+//------------------------------------------------------------------------------
+void
+sim::BacktrackerRecordColumns::fill(std::vector<sim::OpDetBacktrackerRecord> const& records,
+                                    bool parallel)
+{
+  std::vector<std::size_t> const offsets =
+    rowOffsets(records, [](sim::OpDetBacktrackerRecord const& btr) {
+      std::size_t n = 0;
+      for (auto const& timeInfo : btr.timePDclockSDPsMap())
+        n += timeInfo.second.size();
+      return n;
+    });
+  resizeColumns(*this, offsets.back());
+  forEachIndex(records.size(), parallel, [this, &records, &offsets](std::size_t iRecord) {
+    sim::OpDetBacktrackerRecord const& btr = records[iRecord];
+    std::size_t row = offsets[iRecord];
+    for (auto const& timeInfo : btr.timePDclockSDPsMap()) {
+      for (sim::SDP const& sdp : timeInfo.second) {
+        opDet[row] = btr.OpDetNum();
+        timePDclock[row] = timeInfo.first;
+        trackID[row] = sdp.trackID;
+        numPhotons[row] = sdp.numPhotons;
+        energy[row] = sdp.energy;
+        x[row] = sdp.x;
+        y[row] = sdp.y;
+        z[row] = sdp.z;
+        ++row;
+      }
+    }
+  });
+}
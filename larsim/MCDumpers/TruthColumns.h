@@ -0,0 +1,201 @@
+/**
+ * @file   TruthColumns.h
+ * @brief  Simulation truth flattened into columns, one per data member.
+ * @see    TruthColumns.cxx
+ *
+ * Each table holds one collection of an event, "structure of arrays" style:
+ * one row per particle (`sim::ParticleColumns`), per ionization deposit on a
+ * channel (`sim::SimChannelColumns`), per energy deposition step
+ * (`sim::EnergyDepositColumns`) or per scintillation deposit on an optical
+ * detector (`sim::BacktrackerRecordColumns`). The columns have the names and
+ * types of the branches of the `OutputTree` mode of `DumpMCParticles` and
+ * `DumpSimChannels`, so the same analysis code can run on either output.
+ *
+ * The rows are always in the order of the input collection; with `parallel`
+ * filling, the rows are written by many tasks, into their final place.
+ */
+
+#ifndef LARSIM_MCDUMPERS_TRUTHCOLUMNS_H
+#define LARSIM_MCDUMPERS_TRUTHCOLUMNS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace simb {
+  class MCParticle;
+}
+namespace sim {
+  class SimChannel;
+  class SimEnergyDeposit;
+  class OpDetBacktrackerRecord;
+}
+
+namespace sim {
+
+  /// Content of `simb::MCParticle`, one row per particle.
+  struct ParticleColumns {
+    std::vector<unsigned int> index; ///< Index of the particle in the data product.
+    std::vector<int> trackID, statusCode, pdgCode, mother, nDaughters;
+    std::vector<std::string> process, endProcess;
+    std::vector<double> mass, weight;
+    std::vector<double> startX, startY, startZ, startT;
+    std::vector<double> startPx, startPy, startPz, startE;
+    std::vector<double> endX, endY, endZ, endT;
+    std::vector<double> endPx, endPy, endPz, endE;
+    std::vector<unsigned int> nPoints;
+
+    /// Replaces the content with the one of `particles`.
+    void fill(std::vector<simb::MCParticle> const& particles, bool parallel = false);
+
+    std::size_t
+    size() const
+    {
+      return trackID.size();
+    }
+
+    /// Calls `f(name, column)` for each column.
+    template <typename F>
+    void
+    forEachColumn(F&& f)
+    {
+      f("index", index);
+      f("trackID", trackID);
+      f("statusCode", statusCode);
+      f("pdgCode", pdgCode);
+      f("mother", mother);
+      f("nDaughters", nDaughters);
+      f("process", process);
+      f("endProcess", endProcess);
+      f("mass", mass);
+      f("weight", weight);
+      f("startX", startX);
+      f("startY", startY);
+      f("startZ", startZ);
+      f("startT", startT);
+      f("startPx", startPx);
+      f("startPy", startPy);
+      f("startPz", startPz);
+      f("startE", startE);
+      f("endX", endX);
+      f("endY", endY);
+      f("endZ", endZ);
+      f("endT", endT);
+      f("endPx", endPx);
+      f("endPy", endPy);
+      f("endPz", endPz);
+      f("endE", endE);
+      f("nPoints", nPoints);
+    }
+  }; // ParticleColumns
+
+  /// Content of `sim::SimChannel`, one row per `sim::IDE`.
+  struct SimChannelColumns {
+    std::vector<unsigned int> channel;
+    std::vector<unsigned int> tdc;
+    std::vector<int> trackID, origTrackID;
+    std::vector<float> numElectrons, energy;
+    std::vector<float> x, y, z;
+
+    /// Replaces the content with the one of `channels`.
+    void fill(std::vector<sim::SimChannel> const& channels, bool parallel = false);
+
+    std::size_t
+    size() const
+    {
+      return trackID.size();
+    }
+
+    /// Calls `f(name, column)` for each column.
+    template <typename F>
+    void
+    forEachColumn(F&& f)
+    {
+      f("channel", channel);
+      f("tdc", tdc);
+      f("trackID", trackID);
+      f("origTrackID", origTrackID);
+      f("numElectrons", numElectrons);
+      f("energy", energy);
+      f("x", x);
+      f("y", y);
+      f("z", z);
+    }
+  }; // SimChannelColumns
+
+  /// Content of `sim::SimEnergyDeposit`, one row per deposit.
+  struct EnergyDepositColumns {
+    std::vector<int> trackID, pdgCode;
+    std::vector<int> numPhotons, numElectrons;
+    std::vector<float> scintYieldRatio, energy;
+    std::vector<float> startX, startY, startZ;
+    std::vector<float> endX, endY, endZ;
+    std::vector<double> startT, endT;
+
+    /// Replaces the content with the one of `deposits`.
+    void fill(std::vector<sim::SimEnergyDeposit> const& deposits, bool parallel = false);
+
+    std::size_t
+    size() const
+    {
+      return trackID.size();
+    }
+
+    /// Calls `f(name, column)` for each column.
+    template <typename F>
+    void
+    forEachColumn(F&& f)
+    {
+      f("trackID", trackID);
+      f("pdgCode", pdgCode);
+      f("numPhotons", numPhotons);
+      f("numElectrons", numElectrons);
+      f("scintYieldRatio", scintYieldRatio);
+      f("energy", energy);
+      f("startX", startX);
+      f("startY", startY);
+      f("startZ", startZ);
+      f("endX", endX);
+      f("endY", endY);
+      f("endZ", endZ);
+      f("startT", startT);
+      f("endT", endT);
+    }
+  }; // EnergyDepositColumns
+
+  /// Content of `sim::OpDetBacktrackerRecord`, one row per `sim::SDP`.
+  struct BacktrackerRecordColumns {
+    std::vector<int> opDet;
+    std::vector<double> timePDclock;
+    std::vector<int> trackID;
+    std::vector<float> numPhotons, energy;
+    std::vector<float> x, y, z;
+
+    /// Replaces the content with the one of `records`.
+    void fill(std::vector<sim::OpDetBacktrackerRecord> const& records, bool parallel = false);
+
+    std::size_t
+    size() const
+    {
+      return trackID.size();
+    }
+
+    /// Calls `f(name, column)` for each column.
+    template <typename F>
+    void
+    forEachColumn(F&& f)
+    {
+      f("opDet", opDet);
+      f("timePDclock", timePDclock);
+      f("trackID", trackID);
+      f("numPhotons", numPhotons);
+      f("energy", energy);
+      f("x", x);
+      f("y", y);
+      f("z", z);
+    }
+  }; // BacktrackerRecordColumns
+
+} // namespace sim
+
+#endif // LARSIM_MCDUMPERS_TRUTHCOLUMNS_H
@@ -0,0 +1,236 @@
+/**
+ * @file   WriteTruthTables_module.cc
+ * @brief  Module writing the simulation truth into columnar trees.
+ * @see    TruthColumns.h
+ *
+ * In a single pass on each event, the particles, the ionization on the
+ * channels, the energy depositions and the scintillation on the optical
+ * detectors are flattened into columns (`sim::ParticleColumns` and the
+ * others), and each table is written as one entry per event of a tree,
+ * with one `std::vector` branch per column. Only the tables with an input
+ * data product configured are written.
+ */
+
+// LArSoft libraries
+#include "larsim/MCDumpers/TruthColumns.h"
+#include "lardataobj/Simulation/OpDetBacktrackerRecord.h"
+#include "lardataobj/Simulation/SimChannel.h"
+#include "lardataobj/Simulation/SimEnergyDeposit.h"
+#include "nusimdata/SimulationBase/MCParticle.h"
+
+// framework libraries
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileService.h"
+#include "canvas/Utilities/InputTag.h"
+#include "fhiclcpp/types/Atom.h"
+#include "fhiclcpp/types/OptionalAtom.h"
+
+// ROOT libraries
+#include "TTree.h"
+
+// TBB libraries
+#include "tbb/task_group.h"
+
+// C/C++ standard libraries
+#include <optional>
+#include <string>
+#include <vector>
+
+
+namespace sim {
+  class WriteTruthTables;
+} // namespace sim
+
+namespace {
+  using namespace fhicl;
+
+  /// Collection of configuration parameters for the module
+  struct Config {
+    using Name = fhicl::Name;
+    using Comment = fhicl::Comment;
+
+    fhicl::OptionalAtom<art::InputTag> InputParticles {
+      Name("InputParticles"),
+      Comment("data product with the simb::MCParticle to be written")
+      };
+
+    fhicl::OptionalAtom<art::InputTag> InputSimChannels {
+      Name("InputSimChannels"),
+      Comment("data product with the sim::SimChannel to be written")
+      };
+
+    fhicl::OptionalAtom<art::InputTag> InputEnergyDeposits {
+      Name("InputEnergyDeposits"),
+      Comment("data product with the sim::SimEnergyDeposit to be written")
+      };
+
+    fhicl::OptionalAtom<art::InputTag> InputOpDetBacktrackerRecords {
+      Name("InputOpDetBacktrackerRecords"),
+      Comment("data product with the sim::OpDetBacktrackerRecord to be written")
+      };
+
+    fhicl::Atom<bool> ParallelFill {
+      Name("ParallelFill"),
+      Comment("fill the tables, and the rows of each table, on multiple threads"),
+      false
+      };
+
+  }; // struct Config
+
+
+  /// A table, its input and its output tree.
+  template <typename Columns>
+  struct TruthTable {
+    std::optional<art::InputTag> input;
+    Columns columns;
+    TTree* tree = nullptr;
+  }; // TruthTable
+
+  /// Returns the value of the parameter, if set.
+  std::optional<art::InputTag> optionalTag
+    (fhicl::OptionalAtom<art::InputTag> const& param)
+  {
+    art::InputTag tag;
+    return param(tag)? std::optional<art::InputTag>{ tag }: std::nullopt;
+  }
+
+} // local namespace
+
+
+class sim::WriteTruthTables: public art::EDAnalyzer {
+    public:
+  // type to enable module parameters description by art
+  using Parameters = art::EDAnalyzer::Table<Config>;
+
+  /// Configuration-checking constructor
+  explicit WriteTruthTables(Parameters const& config);
+
+  // Plugins should not be copied or assigned.
+  WriteTruthTables(WriteTruthTables const&) = delete;
+  WriteTruthTables(WriteTruthTables &&) = delete;
+  WriteTruthTables& operator = (WriteTruthTables const&) = delete;
+  WriteTruthTables& operator = (WriteTruthTables &&) = delete;
+
+
+  // Operates on the event
+  void analyze(art::Event const& event) override;
+
+
+    private:
+
+  UInt_t fRun = 0, fSubRun = 0, fEvent = 0; ///< Buffer of the event ID branches.
+
+  TruthTable<sim::ParticleColumns> fParticles;
+  TruthTable<sim::SimChannelColumns> fSimChannels;
+  TruthTable<sim::EnergyDepositColumns> fEnergyDeposits;
+  TruthTable<sim::BacktrackerRecordColumns> fBacktrackerRecords;
+
+  bool fParallelFill; ///< Fill tables and rows in parallel.
+
+  /// Creates the tree of the table, if it has an input.
+  template <typename Columns>
+  void makeTree
+    (TruthTable<Columns>& table, std::string const& name, std::string const& what);
+
+}; // class sim::WriteTruthTables
+
+
+//------------------------------------------------------------------------------
+//---  module implementation
+//---
+//------------------------------------------------------------------------------
+sim::WriteTruthTables::WriteTruthTables(Parameters const& config)
+  : EDAnalyzer(config)
+  , fParticles{ optionalTag(config().InputParticles) }
+  , fSimChannels{ optionalTag(config().InputSimChannels) }
+  , fEnergyDeposits{ optionalTag(config().InputEnergyDeposits) }
+  , fBacktrackerRecords{ optionalTag(config().InputOpDetBacktrackerRecords) }
+  , fParallelFill(config().ParallelFill())
+{
+  makeTree(fParticles, "MCParticles", "particles");
+  makeTree(fSimChannels, "SimChannels", "IDEs");
+  makeTree(fEnergyDeposits, "SimEnergyDeposits", "energy deposits");
+  makeTree(fBacktrackerRecords, "OpDetBacktrackerRecords", "SDPs");
+
+  if (fParticles.input) consumes<std::vector<simb::MCParticle>>(*fParticles.input);
+  if (fSimChannels.input) consumes<std::vector<sim::SimChannel>>(*fSimChannels.input);
+  if (fEnergyDeposits.input)
+    consumes<std::vector<sim::SimEnergyDeposit>>(*fEnergyDeposits.input);
+  if (fBacktrackerRecords.input)
+    consumes<std::vector<sim::OpDetBacktrackerRecord>>(*fBacktrackerRecords.input);
+}
+
+
+//------------------------------------------------------------------------------
+template <typename Columns>
+void sim::WriteTruthTables::makeTree
+  (TruthTable<Columns>& table, std::string const& name, std::string const& what)
+{
+  if (!table.input) return;
+  table.tree = art::ServiceHandle<art::TFileService>()->make<TTree>
+    (name.c_str(), (what + " of " + table.input->encode()).c_str());
+  table.tree->Branch("run", &fRun);
+  table.tree->Branch("subRun", &fSubRun);
+  table.tree->Branch("event", &fEvent);
+  table.columns.forEachColumn([tree=table.tree](char const* name, auto& column)
+    { tree->Branch(name, &column); });
+}
+
+
+//------------------------------------------------------------------------------
+void sim::WriteTruthTables::analyze(art::Event const& event) {
+
+  // all the products are read before any table is filled
+  std::vector<simb::MCParticle> const* particles = fParticles.input
+    ? &event.getProduct<std::vector<simb::MCParticle>>(*fParticles.input): nullptr;
+  std::vector<sim::SimChannel> const* channels = fSimChannels.input
+    ? &event.getProduct<std::vector<sim::SimChannel>>(*fSimChannels.input): nullptr;
+  std::vector<sim::SimEnergyDeposit> const* deposits = fEnergyDeposits.input
+    ? &event.getProduct<std::vector<sim::SimEnergyDeposit>>(*fEnergyDeposits.input)
+    : nullptr;
+  std::vector<sim::OpDetBacktrackerRecord> const* records = fBacktrackerRecords.input
+    ? &event.getProduct<std::vector<sim::OpDetBacktrackerRecord>>
+        (*fBacktrackerRecords.input)
+    : nullptr;
+
+  bool const parallel = fParallelFill;
+  auto fillParticles = [&]{ fParticles.columns.fill(*particles, parallel); };
+  auto fillChannels = [&]{ fSimChannels.columns.fill(*channels, parallel); };
+  auto fillDeposits = [&]{ fEnergyDeposits.columns.fill(*deposits, parallel); };
+  auto fillRecords = [&]{ fBacktrackerRecords.columns.fill(*records, parallel); };
+
+  if (fParallelFill) {
+    tbb::task_group tasks;
+    if (particles) tasks.run(fillParticles);
+    if (channels) tasks.run(fillChannels);
+    if (deposits) tasks.run(fillDeposits);
+    if (records) tasks.run(fillRecords);
+    tasks.wait();
+  }
+  else {
+    if (particles) fillParticles();
+    if (channels) fillChannels();
+    if (deposits) fillDeposits();
+    if (records) fillRecords();
+  }
+
+  // ROOT trees are written from this thread only
+  fRun = event.run();
+  fSubRun = event.subRun();
+  fEvent = event.event();
+  for (TTree* tree: { fParticles.tree, fSimChannels.tree,
+                      fEnergyDeposits.tree, fBacktrackerRecords.tree })
+  {
+    if (tree) tree->Fill();
+  }
+
+} // sim::WriteTruthTables::analyze()
+
+
+//------------------------------------------------------------------------------
+DEFINE_ART_MODULE(sim::WriteTruthTables)
+
+//------------------------------------------------------------------------------
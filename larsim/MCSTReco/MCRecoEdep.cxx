@@ -16,6 +16,44 @@
 
 #include "MCRecoEdep.h"
 
+#include <algorithm>
+#include <functional>
+#include <memory_resource>
+#include <unordered_map>
+
+namespace {
+
+  // Key to identify a unique particle energy deposition point;
+  // positions are compared exactly, as with UniquePosition::operator<
+  struct EdepKey {
+    double x, y, z;
+    unsigned int track_id;
+
+    bool operator==(EdepKey const& rhs) const
+    { return x == rhs.x && y == rhs.y && z == rhs.z && track_id == rhs.track_id; }
+  };
+
+  struct EdepKeyHash {
+    size_t operator()(EdepKey const& key) const
+    {
+      std::hash<double> h;
+      size_t seed = std::hash<unsigned int>()(key.track_id);
+      for (double v : { key.x, key.y, key.z })
+        seed ^= h(v) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+      return seed;
+    }
+  };
+
+  // Location of an energy deposition point in MCRecoEdep::_mc_edeps
+  struct EdepLocation {
+    size_t edep_index; // index of the track array
+    size_t hit_index;  // index in the track array
+  };
+
+  using EdepIndexMap_t = std::pmr::unordered_map<EdepKey, EdepLocation, EdepKeyHash>;
+
+} // local namespace
+
 namespace sim {
 
   namespace details {
@@ -29,6 +67,25 @@ namespace sim {
       }
       return m;
     }
+
+    PlaneIndex::PlaneIndex(){
+      art::ServiceHandle<geo::Geometry const> geom;
+      for(auto const& pid : geom->IteratePlaneIDs()){
+        if(fFirstPlane.size() <= pid.Cryostat) {
+          fFirstPlane.resize(pid.Cryostat + 1);
+          fNTPCPlanes.resize(pid.Cryostat + 1);
+        }
+        auto& tpcs = fFirstPlane[pid.Cryostat];
+        auto& nplanes = fNTPCPlanes[pid.Cryostat];
+        if(tpcs.size() <= pid.TPC) {
+          tpcs.resize(pid.TPC + 1, fNPlanes);
+          nplanes.resize(pid.TPC + 1, 0);
+        }
+        if(pid.Plane == 0) tpcs[pid.TPC] = fNPlanes;
+        nplanes[pid.TPC] = std::max(nplanes[pid.TPC], size_t(pid.Plane) + 1);
+        fNPlanes++;
+      }
+    }
   }
   //const unsigned short MCEdepHit::kINVALID_USHORT = std::numeric_limits<unsigned short>::max();
 
@@ -49,6 +106,43 @@ namespace sim {
     return _mc_edeps.at(edep_index);
   }
 
+  const sim::MCEdepColumns& MCRecoEdep::GetEdepColumnsAt(size_t edep_index) const
+  {
+    if(edep_index >= _mc_edep_columns.size())
+      throw cet::exception(__FUNCTION__) << Form("Track ID %zu not found!",edep_index);
+    return _mc_edep_columns[edep_index];
+  }
+
+  void MCRecoEdep::__BuildEdepColumns__(details::PlaneIndex const& pindex)
+  {
+    _mc_edep_columns.clear();
+    _mc_edep_columns.resize(_mc_edeps.size());
+    for(size_t i=0; i<_mc_edeps.size(); ++i) {
+      auto const& edeps = _mc_edeps[i];
+      auto& columns = _mc_edep_columns[i];
+      size_t const n = edeps.size();
+      columns.x.resize(n);
+      columns.y.resize(n);
+      columns.z.resize(n);
+      columns.energy.resize(n);
+      columns.charge.resize(n);
+      columns.plane.resize(n);
+      for(size_t j=0; j<n; ++j) {
+        auto const& edep = edeps[j];
+        columns.x[j] = edep.pos._x;
+        columns.y[j] = edep.pos._y;
+        columns.z[j] = edep.pos._z;
+        // same sum, in the same order, as the algorithms used to do
+        double energy = 0;
+        for(auto const& dep : edep.deps) energy += dep.energy;
+        columns.energy[j] = edep.deps.empty() ? 0. : energy / edep.deps.size();
+        bool const inDetector = pindex.hasPlane(edep.pid);
+        columns.charge[j] = inDetector ? (double)(edep.deps[pindex(edep.pid)].charge) : 0.;
+        columns.plane[j] = inDetector ? edep.pid.Plane : MCEdepColumns::NoPlane;
+      }
+    }
+  }
+
   std::vector<sim::MCEdep>& MCRecoEdep::__GetEdepArray__(unsigned int track_id)
   {
     if(ExistTrack(track_id)) return _mc_edeps.at((*_track_index.find(track_id)).second);
@@ -66,9 +160,16 @@ namespace sim {
 //    const detinfo::DetectorProperties* detp = lar::providerFrom<detinfo::DetectorPropertiesService>();
 
     // Key map to identify a unique particle energy deposition point
-    std::map<std::pair<UniquePosition, unsigned int>, int> hit_index_m;
+    // (its nodes are served by the arena, released when leaving this function)
+    larsim::Utils::EventArena::Scope const arenaScope{ _arena };
+    EdepIndexMap_t hit_index_m{ _arena.resource() };
+
+    details::PlaneIndex const pindex;
 
-    auto pindex = details::createPlaneIndexMap();
+    size_t n_ides = 0;
+    for(auto const& sch : schArray)
+      for(auto const& tdc_ides : sch.TDCIDEMap()) n_ides += tdc_ides.second.size();
+    hit_index_m.reserve(n_ides);
 
     if(_debug_mode) std::cout<<"Processing "<<schArray.size()<<" channels..."<<std::endl;
     // Loop over channels
@@ -79,6 +180,9 @@ namespace sim {
       const auto &sch_map(sch.TDCIDEMap());
       // Channel
       UInt_t ch = sch.Channel();
+      if(sch_map.empty()) continue;
+      auto const pid = geom->ChannelToWire(ch)[0].planeID();
+      auto const channel_id = pindex(pid);
       // Loop over ticks
       for(auto tdc_iter = sch_map.begin(); tdc_iter!=sch_map.end(); ++tdc_iter) {
         // for c2: hit_time is unused
@@ -92,27 +196,20 @@ namespace sim {
 
           UniquePosition pos(ide.x, ide.y, ide.z);
 
-          int hit_index = -1;
-          auto key = std::make_pair(pos, real_track_id);
-          auto hit_index_track_iter = hit_index_m.find(key);
-          if(hit_index_track_iter == hit_index_m.end()) {
-            int new_hit_index = this->__GetEdepArray__(real_track_id).size();
-            hit_index_m[key]= new_hit_index;
-          }
-          else {
-            hit_index = (*hit_index_track_iter).second;
-          }
-          auto const pid = geom->ChannelToWire(ch)[0].planeID();
-          auto const channel_id = pindex[pid];
           double charge = ide.numElectrons;
-          if(hit_index < 0) {
+          auto hit_index_track_iter = hit_index_m.find({ pos._x, pos._y, pos._z, real_track_id });
+          if(hit_index_track_iter == hit_index_m.end()) {
             // This particle energy deposition is never recorded so far. Create a new Edep
             //float charge = ide.numElectrons * detp->ElectronsToADC();
-            this->__GetEdepArray__(real_track_id).emplace_back(pos, pid, pindex.size(), ide.energy, charge, channel_id);
+            auto& edeps = this->__GetEdepArray__(real_track_id);
+            hit_index_m.emplace(EdepKey{ pos._x, pos._y, pos._z, real_track_id },
+                                EdepLocation{ _track_index.find(real_track_id)->second, edeps.size() });
+            edeps.emplace_back(pos, pid, pindex.size(), ide.energy, charge, channel_id);
           } else {
             // Append charge to the relevant edep (@ hit_index)
             //float charge = ide.numElectrons * detp->ElectronsToADC();
-            MCEdep &edep = this->__GetEdepArray__(real_track_id).at(hit_index);
+            EdepLocation const& loc = hit_index_track_iter->second;
+            MCEdep &edep = _mc_edeps[loc.edep_index][loc.hit_index];
             edep.deps[channel_id].charge += charge;
             edep.deps[channel_id].energy += ide.energy;
           }
@@ -120,6 +217,8 @@ namespace sim {
       } // end looping over ticks in this channel
     }// end looping over channels
 
+    __BuildEdepColumns__(pindex);
+
     if(_debug_mode) {
       std::cout<< Form("  Collected %zu particles' energy depositions...",_mc_edeps.size()) << std::endl;
       // for c2: disable the entire loop instead of just the print statement
@@ -141,9 +240,12 @@ namespace sim {
 //    const detinfo::DetectorProperties* detp = lar::providerFrom<detinfo::DetectorPropertiesService>();
 
     // Key map to identify a unique particle energy deposition point
-    std::map<std::pair<UniquePosition, unsigned int>, int> hit_index_m;
+    // (its nodes are served by the arena, released when leaving this function)
+    larsim::Utils::EventArena::Scope const arenaScope{ _arena };
+    EdepIndexMap_t hit_index_m{ _arena.resource() };
+    hit_index_m.reserve(sedArray.size());
 
-    auto pindex = details::createPlaneIndexMap();
+    details::PlaneIndex const pindex;
 
     if(_debug_mode) std::cout<<"Processing "<<sedArray.size()<<" energy deposits..."<<std::endl;
     // Loop over channels
@@ -216,33 +318,30 @@ namespace sim {
 
         UniquePosition pos(xyz[0], xyz[1], xyz[2]);
 
-        int hit_index = -1;
-        auto key = std::make_pair(pos, real_track_id);
-        auto hit_index_track_iter = hit_index_m.find(key);
-        if(hit_index_track_iter == hit_index_m.end()) {
-          int new_hit_index = this->__GetEdepArray__(real_track_id).size();
-          hit_index_m[key]= new_hit_index;
-        }
-        else {
-          hit_index = (*hit_index_track_iter).second;
-        }
         auto const pid = geom->ChannelToWire(ch)[0].planeID();
-        auto const channel_id = pindex[pid];
+        auto const channel_id = pindex(pid);
         double charge = sed.NumElectrons();
-        if(hit_index < 0) {
+        auto hit_index_track_iter = hit_index_m.find({ pos._x, pos._y, pos._z, real_track_id });
+        if(hit_index_track_iter == hit_index_m.end()) {
           // This particle energy deposition is never recorded so far. Create a new Edep
           //float charge = ide.numElectrons * detp->ElectronsToADC();
-          this->__GetEdepArray__(real_track_id).emplace_back(pos, pid, pindex.size(), sed.Energy(), charge, channel_id);
+          auto& edeps = this->__GetEdepArray__(real_track_id);
+          hit_index_m.emplace(EdepKey{ pos._x, pos._y, pos._z, real_track_id },
+                              EdepLocation{ _track_index.find(real_track_id)->second, edeps.size() });
+          edeps.emplace_back(pos, pid, pindex.size(), sed.Energy(), charge, channel_id);
         } else {
           // Append charge to the relevant edep (@ hit_index)
           //float charge = ide.numElectrons * detp->ElectronsToADC();
-          MCEdep &edep = this->__GetEdepArray__(real_track_id).at(hit_index);
+          EdepLocation const& loc = hit_index_track_iter->second;
+          MCEdep &edep = _mc_edeps[loc.edep_index][loc.hit_index];
           edep.deps[channel_id].charge += charge;
           edep.deps[channel_id].energy += sed.Energy();
         }
       } // end looping over planes
     }// end looping over SimEnergyDeposits
 
+    __BuildEdepColumns__(pindex);
+
     if(_debug_mode) {
       std::cout<< Form("  Collected %zu particles' energy depositions...",_mc_edeps.size()) << std::endl;
       // for c2: disable the entire loop instead of just the print statement
@@ -3,6 +3,7 @@
 
 // LArSoft
 #include "larcoreobj/SimpleTypesAndConstants/geo_types.h"
+#include "larsim/Utils/EventArena.h"
 namespace sim {
   class SimChannel;
   class SimEnergyDeposit;
@@ -12,6 +13,7 @@ namespace sim {
 namespace fhicl { class ParameterSet; }
 
 // STL
+#include <limits>
 #include <map>
 #include <vector>
 
@@ -22,6 +24,31 @@ namespace sim
     // Returns a map with all available plane IDs,
     //  each mapped into an index from a compact range.
     std::map<geo::PlaneID, size_t> createPlaneIndexMap();
+
+    // Same indices as createPlaneIndexMap(), from a table indexed by
+    //  cryostat and TPC number instead of a map lookup.
+    class PlaneIndex {
+    public:
+      PlaneIndex();
+
+      size_t operator()(geo::PlaneID const& pid) const
+      { return fFirstPlane[pid.Cryostat][pid.TPC] + pid.Plane; }
+
+      bool hasPlane(geo::PlaneID const& pid) const
+      {
+        return pid.isValid && (pid.Cryostat < fNTPCPlanes.size())
+          && (pid.TPC < fNTPCPlanes[pid.Cryostat].size())
+          && (pid.Plane < fNTPCPlanes[pid.Cryostat][pid.TPC]);
+      }
+
+      // Number of planes in the detector
+      size_t size() const { return fNPlanes; }
+
+    private:
+      std::vector<std::vector<size_t> > fFirstPlane;
+      std::vector<std::vector<size_t> > fNTPCPlanes;
+      size_t fNPlanes = 0;
+    };
   } // namespace details
 
 
@@ -93,6 +120,21 @@ namespace sim
            pos(p), pid(pi), deps(num_planes) { deps[id].energy=e; deps[id].charge=c;}
   };
 
+  // The quantities of the MCEdep of a track used by the shower and track
+  //  reconstruction, one contiguous column each, in the order of its MCEdep
+  //  array: the algorithms sum them over a track without visiting the
+  //  per-plane deposits of each MCEdep.
+  struct MCEdepColumns {
+    static constexpr unsigned int NoPlane = std::numeric_limits<unsigned int>::max();
+
+    std::vector<double> x, y, z;      // position of each MCEdep
+    std::vector<double> energy;       // energy averaged over all the entries of deps
+    std::vector<double> charge;       // charge on the plane of pid (0 if not in the detector)
+    std::vector<unsigned int> plane;  // plane number of pid (NoPlane if not in the detector)
+
+    size_t size() const { return x.size(); }
+  };
+
   class MCRecoEdep {
 
   public:
@@ -118,6 +160,9 @@ namespace sim
     /// Returns a vector of MCEdep object at the given index
     const std::vector<sim::MCEdep>& GetEdepArrayAt(size_t edep_index) const;
 
+    /// Returns the columns of the MCEdep array at the given index
+    const sim::MCEdepColumns& GetEdepColumnsAt(size_t edep_index) const;
+
     /// Returns a map of track id <-> MCEdep vector index
     const std::map<unsigned int,size_t> TrackIndexMap() const
     { return _track_index; }
@@ -126,16 +171,21 @@ namespace sim
       _mc_edeps.clear();
       _track_index.clear();
       std::vector<std::vector<sim::MCEdep>>().swap(_mc_edeps);
+      std::vector<sim::MCEdepColumns>().swap(_mc_edep_columns);
       std::map<unsigned int,size_t>().swap(_track_index);
   }
   protected:
 
     std::vector<sim::MCEdep>& __GetEdepArray__(unsigned int track_id);
 
+    void __BuildEdepColumns__(details::PlaneIndex const& pindex);
+
     bool _debug_mode;
     bool _save_mchit;
     std::map<unsigned int,size_t>      _track_index;
     std::vector<std::vector<sim::MCEdep> > _mc_edeps;
+    std::vector<sim::MCEdepColumns>        _mc_edep_columns; ///< Columns of each of _mc_edeps
+    larsim::Utils::EventArena _arena; ///< Memory for the transient index maps
 
   }; // class MCRecoEdep
 
@@ -13,6 +13,8 @@
 
 #include "MCRecoPart.h"
 
+#include <unordered_map>
+
 namespace sim {
 
   //--------------------------------------------------------------------------------------------
@@ -44,6 +46,8 @@ namespace sim {
   {
     if(this->size() <= part_index) return ::sim::kINVALID_UINT;
 
+    if(part_index < _mother_v.size()) return _mother_v[part_index];
+
     unsigned int result = this->at(part_index)._mother;
 
     if(!result) return this->at(part_index)._track_id;
@@ -70,6 +74,8 @@ namespace sim {
   {
     if(part_index >= this->size()) return kINVALID_UINT;
 
+    if(part_index < _ancestor_v.size()) return _ancestor_v[part_index];
+
     if((*this)[part_index]._ancestor != kINVALID_UINT) return (*this)[part_index]._ancestor;
 
     unsigned int result = MotherTrackID(part_index);
@@ -133,6 +139,9 @@ namespace sim {
 
     this->clear();
     _track_index.clear();
+    _mother_v.clear();
+    _ancestor_v.clear();
+    _shower_mother_v.clear();
 
     for(size_t i=0; i < mcp_v.size(); ++i) {
 
@@ -204,5 +213,100 @@ namespace sim {
 	}
       }
     }
+
+    ResolveAncestry();
+  }
+
+  //--------------------------------------------------------------------------------------------
+  void MCRecoPart::ResolveAncestry()
+  //--------------------------------------------------------------------------------------------
+  {
+    // Same results as the chain walks of MotherTrackID(), AncestorTrackID() and
+    // MCShowerRecoPart::ConstructShower(), computed for all the particles at once:
+    // each particle is visited once, and the results of its mothers are reused.
+    size_t const n = this->size();
+    _mother_v.assign(n, kINVALID_UINT);
+    _ancestor_v.assign(n, kINVALID_UINT);
+    _shower_mother_v.assign(n, -1);
+
+    // first particle (in list order) having each track among its daughters
+    std::unordered_map<unsigned int, unsigned int> parent_index;
+    for(size_t i=0; i<n; ++i)
+      for(auto const& daughter : (*this)[i]._daughters)
+        parent_index.emplace(daughter, i);
+
+    for(size_t i=0; i<n; ++i) {
+      auto const& part = (*this)[i];
+      unsigned int result = part._mother;
+      if(!result) result = part._track_id;
+      else if(TrackToParticleIndex(result) == kINVALID_UINT) {
+        auto const parent = parent_index.find(part._track_id);
+        if(parent != parent_index.end()) result = (*this)[(*parent).second]._track_id;
+      }
+      _mother_v[i] = result;
+    }
+
+    enum : char { kNew, kVisiting, kDone };
+    std::vector<char> state(n, kNew);
+    std::vector<unsigned int> path;
+
+    // Ancestor: the mother of each particle is followed until a particle is its own
+    // mother, or until a track which is not in the list and is nobody's daughter.
+    // climb[i] is the end of the chain starting from the particle i.
+    std::vector<unsigned int> climb(n, kINVALID_UINT);
+    for(size_t i=0; i<n; ++i) {
+      path.clear();
+      unsigned int cur = i;
+      unsigned int result = kINVALID_UINT;
+      while(true) {
+        if(state[cur] == kDone) { result = climb[cur]; break; }
+        // a loop in the mother chain: stop where it closes
+        if(state[cur] == kVisiting) { result = (*this)[cur]._track_id; break; }
+        state[cur] = kVisiting;
+        path.push_back(cur);
+
+        unsigned int const track_id = (*this)[cur]._track_id;
+        result = _mother_v[cur];
+        if(result == track_id) break;
+
+        unsigned int next = TrackToParticleIndex(result);
+        if(next == kINVALID_UINT) {
+          auto const parent = parent_index.find(result);
+          if(parent == parent_index.end()) break;
+          result = (*this)[(*parent).second]._track_id;
+          next = TrackToParticleIndex(result);
+          // the mother of the found particle ends the chain if it is itself
+          if(_mother_v[next] == result) break;
+        }
+        cur = next;
+      }
+      for(auto const index : path) {
+        climb[index] = result;
+        state[index] = kDone;
+      }
+    }
+    for(size_t i=0; i<n; ++i)
+      _ancestor_v[i] = _mother_v[i] ? climb[i] : (*this)[i]._track_id;
+
+    // Shower mother: the oldest photon or electron following the mothers in the list
+    state.assign(n, kNew);
+    for(size_t i=0; i<n; ++i) {
+      path.clear();
+      unsigned int cur = i;
+      int result = -1;
+      while(cur != kINVALID_UINT) {
+        if(state[cur] == kDone) { result = _shower_mother_v[cur]; break; }
+        if(state[cur] == kVisiting) break;
+        state[cur] = kVisiting;
+        path.push_back(cur);
+        cur = TrackToParticleIndex((*this)[cur]._mother);
+      }
+      for(auto it = path.rbegin(); it != path.rend(); ++it) {
+        int const pdg = (*this)[*it]._pdgcode;
+        if(result < 0 && (pdg == 22 || pdg == 11 || pdg == -11)) result = *it;
+        _shower_mother_v[*it] = result;
+        state[*it] = kDone;
+      }
+    }
   }
 }
@@ -75,6 +75,17 @@ namespace sim
 
     unsigned int MotherTrackID(const unsigned int part_index) const;
 
+    /*
+      Take particle index number and returns the index of the particle starting
+      its shower (the oldest photon or electron in its chain of mothers, or itself).
+      Returns -1 if the particle does not belong to a shower.
+    */
+    int ShowerMotherIndex(const unsigned int part_index) const
+    {
+      if(part_index >= _shower_mother_v.size()) return -1;
+      return _shower_mother_v[part_index];
+    }
+
     /*
       Take TrackID and returns the corresponding particle unique index number (MCParticle array index)
       Returns kINVALID_UINT if nothing found.
@@ -101,6 +112,16 @@ namespace sim
 
   protected:
 
+    /// Computes mother, ancestor and shower mother of all the particles
+    void ResolveAncestry();
+
+    //
+    // Particle-indexed results of ResolveAncestry()
+    //
+    std::vector<unsigned int> _mother_v;        ///< Result of MotherTrackID()
+    std::vector<unsigned int> _ancestor_v;      ///< Result of AncestorTrackID()
+    std::vector<int>          _shower_mother_v; ///< Result of ShowerMotherIndex()
+
     double _x_max; //!< x-max of volume box used to determine whether to save track information
     double _x_min; //!< x-min of volume box used to determine whether to save track information
     double _y_max; //!< y-max of volume box used to determine whether to save track information
@@ -22,6 +22,8 @@
 #include "MCTrackRecoAlg.h"
 #include "lardataobj/MCBase/MCTrack.h"
 
+#include "tbb/parallel_invoke.h"
+
 #include <memory>
 
 class MCReco : public art::EDProducer {
@@ -118,9 +120,17 @@ void MCReco::produce(art::Event & evt)
     fEdep.MakeMCEdep(sch_array);
   }
 
+  // The two algorithms only read the particles and energy deposits, and
+  // run concurrently.
+  std::unique_ptr<std::vector<sim::MCShower>> mcshowers;
+  std::unique_ptr<std::vector<sim::MCTrack>> mctracks;
+  tbb::parallel_invoke(
+    [&]{ mcshowers = fMCSAlg.Reconstruct(fPart,fEdep); },
+    [&]{ mctracks = fMCTAlg.Reconstruct(fPart,fEdep); });
+
   //Add MCShowers and MCTracks to the event
-  evt.put(fMCSAlg.Reconstruct(fPart,fEdep));
-  evt.put(fMCTAlg.Reconstruct(fPart,fEdep));
+  evt.put(std::move(mcshowers));
+  evt.put(std::move(mctracks));
 
   fEdep.Clear();
   fPart.clear();
@@ -25,6 +25,9 @@
 #include "larsim/MCSTReco/MCRecoPart.h"
 #include "larsim/MCSTReco/MCShowerRecoPart.h"
 
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
 namespace sim {
 
   //##################################################################
@@ -44,8 +47,6 @@ namespace sim {
 
     art::ServiceHandle<geo::Geometry const> geo;
 
-    auto pindex = details::createPlaneIndexMap();
-
     fPartAlg.ConstructShower(part_v);
     auto result = std::make_unique<std::vector<sim::MCShower>>();
     auto& mcshower = *result;
@@ -165,7 +166,10 @@ namespace sim {
     std::vector<double>         mcs_daughter_dedxRAD_v  ( mcshower.size(), 0                );
     std::vector<TVector3>       mcs_daughter_dir_v      ( mcshower.size(), TVector3()       );
 
-    for(size_t mcs_index=0; mcs_index<mcshower.size(); ++mcs_index) {
+    // Each shower only fills its own elements of the vectors above
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, mcshower.size()),
+                      [&](tbb::blocked_range<size_t> const& range) {
+    for(size_t mcs_index=range.begin(); mcs_index<range.end(); ++mcs_index) {
 
       auto& mcs_daughter_vtx       = mcs_daughter_vtx_v[mcs_index];
       auto& mcs_daughter_mom       = mcs_daughter_mom_v[mcs_index];
@@ -185,23 +189,28 @@ namespace sim {
 
 	if(daughter_edep_index<0) continue;
 
-	auto const& daughter_edep = edep_v.GetEdepArrayAt(daughter_edep_index);
+	auto const& daughter_edep = edep_v.GetEdepColumnsAt(daughter_edep_index);
 
 	if(!(daughter_edep.size())) continue;
 
+	double const* const ex = daughter_edep.x.data();
+	double const* const ey = daughter_edep.y.data();
+	double const* const ez = daughter_edep.z.data();
+	size_t const n_edeps = daughter_edep.size();
+
 	// Record first daughter's vtx point
 	double min_dist = sim::kINVALID_DOUBLE;
-	for(auto const& edep : daughter_edep) {
+	for(size_t i=0; i<n_edeps; ++i) {
 
-	  double dist = sqrt( pow(edep.pos._x - daughter_part._start_vtx[0],2) +
-			      pow(edep.pos._y - daughter_part._start_vtx[1],2) +
-			      pow(edep.pos._z - daughter_part._start_vtx[2],2) );
+	  double dist = sqrt( pow(ex[i] - daughter_part._start_vtx[0],2) +
+			      pow(ey[i] - daughter_part._start_vtx[1],2) +
+			      pow(ez[i] - daughter_part._start_vtx[2],2) );
 
 	  if(dist < min_dist) {
 	    min_dist = dist;
-	    mcs_daughter_vtx[0] = edep.pos._x;
-	    mcs_daughter_vtx[1] = edep.pos._y;
-	    mcs_daughter_vtx[2] = edep.pos._z;
+	    mcs_daughter_vtx[0] = ex[i];
+	    mcs_daughter_vtx[1] = ey[i];
+	    mcs_daughter_vtx[2] = ez[i];
 	    mcs_daughter_vtx[3] = (dist/100. / 2.998e8)*1.e9 + daughter_part._start_vtx[3];
 	  }
 
@@ -224,11 +233,14 @@ namespace sim {
 
 	    for(auto& v : shower_dir) v /= magnitude;
 
-	    for(auto const& edep : daughter_edep) {
-	      std::vector<double> shower_dep_dir(3,0);
-	      shower_dep_dir[0] = edep.pos._x - mcshower[mcs_index].Start().X();
-	      shower_dep_dir[1] = edep.pos._y - mcshower[mcs_index].Start().Y();
-	      shower_dep_dir[2] = edep.pos._z - mcshower[mcs_index].Start().Z();
+	    double const start_x = mcshower[mcs_index].Start().X();
+	    double const start_y = mcshower[mcs_index].Start().Y();
+	    double const start_z = mcshower[mcs_index].Start().Z();
+	    double shower_dep_dir[3];
+	    for(size_t i=0; i<n_edeps; ++i) {
+	      shower_dep_dir[0] = ex[i] - start_x;
+	      shower_dep_dir[1] = ey[i] - start_y;
+	      shower_dep_dir[2] = ez[i] - start_z;
 
 	      double dist = sqrt( pow(shower_dep_dir[0],2) + pow(shower_dep_dir[1],2) + pow(shower_dep_dir[2],2) );
 	      for(auto& v : shower_dep_dir) v /= dist;
@@ -240,9 +252,9 @@ namespace sim {
 	      if(dist < min_dist && angle < 10) {
 
 		min_dist = dist;
-		mcs_daughter_vtx[0] = edep.pos._x;
-		mcs_daughter_vtx[1] = edep.pos._y;
-		mcs_daughter_vtx[2] = edep.pos._z;
+		mcs_daughter_vtx[0] = ex[i];
+		mcs_daughter_vtx[1] = ey[i];
+		mcs_daughter_vtx[2] = ez[i];
 		mcs_daughter_vtx[3] = (dist/100. / 2.998e8)*1.e9 + mcshower[mcs_index].Start().T();
 	      }
 	    }
@@ -264,29 +276,27 @@ namespace sim {
 
 	if(daughter_edep_index<0) continue;
 
-	auto const& daughter_edep = edep_v.GetEdepArrayAt(daughter_edep_index);
+	auto const& daughter_edep = edep_v.GetEdepColumnsAt(daughter_edep_index);
 
 	if(!(daughter_edep.size())) continue;
 
-	//bool first=true;  // unused
-	for(auto const& edep : daughter_edep) {
+	// vertex, energy (averaged over the plane entries) and charge of each
+	// deposition are read from contiguous columns
+	double const vtx_x = mcs_daughter_vtx[0];
+	double const vtx_y = mcs_daughter_vtx[1];
+	double const vtx_z = mcs_daughter_vtx[2];
+	size_t const n_edeps = daughter_edep.size();
+	for(size_t i=0; i<n_edeps; ++i) {
 
 	  // Compute unit vector to this energy deposition
-	  mom[0] = edep.pos._x - mcs_daughter_vtx[0];
-	  mom[1] = edep.pos._y - mcs_daughter_vtx[1];
-	  mom[2] = edep.pos._z - mcs_daughter_vtx[2];
+	  mom[0] = daughter_edep.x[i] - vtx_x;
+	  mom[1] = daughter_edep.y[i] - vtx_y;
+	  mom[2] = daughter_edep.z[i] - vtx_z;
 
 	  // Weight by energy (momentum)
-	  double magnitude = sqrt(pow(mom.at(0),2) + pow(mom.at(1),2) + pow(mom.at(2),2));
+	  double magnitude = sqrt(pow(mom[0],2) + pow(mom[1],2) + pow(mom[2],2));
 
-	  double energy = 0;
-	  double npid = 0;
-	  for(auto const& pid_energy : edep.deps) {
-	    npid++;
-	    energy += pid_energy.energy;
-
-	  }
-	  energy /= npid;
+	  double const energy = daughter_edep.energy[i];
 	  if(magnitude>1.e-10) {
 	    mom.at(0) = mom.at(0) * energy / magnitude;
 	    mom.at(1) = mom.at(1) * energy / magnitude;
@@ -298,9 +308,7 @@ namespace sim {
 	  //Determine the direction of the shower right at the start point
 	  double E = 0;
 	  double N = 0;
-	  if(sqrt( pow( edep.pos._x - mcs_daughter_vtx[0],2) +
-		   pow( edep.pos._y - mcs_daughter_vtx[1],2) +
-		   pow( edep.pos._z - mcs_daughter_vtx[2],2)) < 2.4 && magnitude>1.e-10){
+	  if(magnitude < 2.4 && magnitude>1.e-10){
 
 	    mcs_daughter_dir[0] += mom.at(0);
 	    mcs_daughter_dir[1] += mom.at(1);
@@ -315,16 +323,25 @@ namespace sim {
 	  mcs_daughter_mom[3] += energy;
 
 	  // Charge
-	  auto const pid = edep.pid;
-          auto q_i = pindex.find(pid);
-          if(q_i != pindex.end())
-            plane_charge[pid.Plane] += (double)(edep.deps[pindex[pid]].charge);
+	  if(daughter_edep.plane[i] != MCEdepColumns::NoPlane)
+	    plane_charge[daughter_edep.plane[i]] += daughter_edep.charge[i];
 
 	}///Looping through the MCShower daughter's energy depositions
 
       }///Looping through MCShower daughters
       mcs_daughter_dedxRAD /= 2.4;
 
+      // plane through the shower start point, normal to its direction
+      double const p_mag = sqrt( pow(mcs_daughter_dir[0],2) + pow(mcs_daughter_dir[1],2) + pow(mcs_daughter_dir[2],2) );
+      double a = 0, b = 0, c = 0, d = 0;
+      if(p_mag > 1.e-10){
+	a = mcs_daughter_dir[0]/p_mag;
+	b = mcs_daughter_dir[1]/p_mag;
+	c = mcs_daughter_dir[2]/p_mag;
+	d = -1*(a*mcs_daughter_vtx[0] + b*mcs_daughter_vtx[1] + c*mcs_daughter_vtx[2]);
+      }
+      double const norm = sqrt( pow(a,2) + pow(b,2) + pow(c,2));
+
       for(auto const& daughter_trk_id : mcshower[mcs_index].DaughterTrackID()) {
 
 	//auto const daughter_part_index = part_v.TrackToParticleIndex(daughter_trk_id);
@@ -336,55 +353,32 @@ namespace sim {
 
 	if(daughter_edep_index<0) continue;
 
-	auto const& daughter_edep = edep_v.GetEdepArrayAt(daughter_edep_index);
+	auto const& daughter_edep = edep_v.GetEdepColumnsAt(daughter_edep_index);
 
 	if(!(daughter_edep.size())) continue;
 
-	for(auto const& edep : daughter_edep) {
+	//Defining dEdx
+	//Need to define a plane through the shower start point (x_0, y_0, z_0) with a normal along the momentum vector of the shower
+	//The plane will be defined in the typical way:
+	// a*x + b*y + c*z + d = 0
+	// where, a = dir_x, b = dir_y, c = dir_z, d = - (a*x_0+b*y_0+c*z_0)
+	// then the *signed* distance of any point (x_1, y_1, z_1) from this plane is:
+	// D = (a*x_1 + b*y_1 + c*z_1 + d )/sqrt( pow(a,2) + pow(b,2) + pow(c,2))
+	// The plane is the same for all the energy depositions of the daughters.
+	if(!(p_mag > 1.e-10)) continue;
 
-	  //Defining dEdx
-	  //Need to define a plane through the shower start point (x_0, y_0, z_0) with a normal along the momentum vector of the shower
-	  //The plane will be defined in the typical way:
-	  // a*x + b*y + c*z + d = 0
-	  // where, a = dir_x, b = dir_y, c = dir_z, d = - (a*x_0+b*y_0+c*z_0)
-	  // then the *signed* distance of any point (x_1, y_1, z_1) from this plane is:
-	  // D = (a*x_1 + b*y_1 + c*z_1 + d )/sqrt( pow(a,2) + pow(b,2) + pow(c,2))
+	size_t const n_edeps = daughter_edep.size();
+	for(size_t i=0; i<n_edeps; ++i) {
 
-
-
-	  double p_mag = sqrt( pow(mcs_daughter_dir[0],2) + pow(mcs_daughter_dir[1],2) + pow(mcs_daughter_dir[2],2) );
-	  double a = 0, b = 0, c = 0, d = 0;
-	  if(p_mag > 1.e-10){
-	    a = mcs_daughter_dir[0]/p_mag;
-	    b = mcs_daughter_dir[1]/p_mag;
-	    c = mcs_daughter_dir[2]/p_mag;
-	    d = -1*(a*mcs_daughter_vtx[0] + b*mcs_daughter_vtx[1] + c*mcs_daughter_vtx[2]);
-	  }
-	  else{mcs_daughter_dedx += 0; continue;}
 	  //Radial Distance
-	  if( (a*edep.pos._x + b*edep.pos._y + c*edep.pos._z + d)/sqrt( pow(a,2) + pow(b,2) + pow(c,2)) < 2.4 &&
-	      (a*edep.pos._x + b*edep.pos._y + c*edep.pos._z + d)/sqrt( pow(a,2) + pow(b,2) + pow(c,2)) > 0){
-
-	    double E = 0;
-	    double N = 0;
-
-	    for(auto const& pid_energy : edep.deps) {
-	      N += 1;
-	      E += pid_energy.energy;
-	    }
-
-	    if(N > 0){
-	      E /= N;
-	    }
-	    else{ E = 0;}
+	  double const D = (a*daughter_edep.x[i] + b*daughter_edep.y[i] + c*daughter_edep.z[i] + d)/norm;
+	  if( D < 2.4 && D > 0){
 
-	    mcs_daughter_dedx += E;
+	    mcs_daughter_dedx += daughter_edep.energy[i];
 
 	    // Charge
-	    auto const pid = edep.pid;
-	    auto q_i = pindex.find(pid);
-            if(q_i != pindex.end())
-              plane_dqdx[pid.Plane] += (double)(edep.deps[pindex[pid]].charge);
+	    if(daughter_edep.plane[i] != MCEdepColumns::NoPlane)
+	      plane_dqdx[daughter_edep.plane[i]] += daughter_edep.charge[i];
 	  }
 	}
       }
@@ -395,6 +389,7 @@ namespace sim {
 
 
     }///Looping through MCShowers
+    });
 
     if(fDebugMode)
       std::cout << " Found " << mcshower.size() << " MCShowers. Now storing..." << std::endl;
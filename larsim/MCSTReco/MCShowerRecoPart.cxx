@@ -38,25 +38,8 @@ namespace sim {
 
       auto const& mcp = part_v[i];
 
-      int candidate_mom_index=-1;
-      if( mcp._pdgcode == 22 ||
-          mcp._pdgcode == 11 ||
-          mcp._pdgcode == -11 )
-	candidate_mom_index = i;
-
-      unsigned int mom_track = mcp._mother;
-      auto mom_iter = part_v._track_index.find(mom_track);
-      while(mom_iter != part_v._track_index.end()) {
-
-        unsigned int mom_index = (*mom_iter).second;
-
-        if( part_v.at(mom_index)._pdgcode == 22 || part_v.at(mom_index)._pdgcode == 11 || part_v.at(mom_index)._pdgcode == -11 )
-
-          candidate_mom_index = mom_index;
-
-        mom_iter = part_v._track_index.find(part_v.at(mom_index)._mother);
-
-      }
+      // the oldest photon/electron among the mothers (or this particle)
+      int candidate_mom_index = part_v.ShowerMotherIndex(i);
 
       if(candidate_mom_index >= 0) {
 
@@ -18,6 +18,9 @@
 #include "larsim/MCSTReco/MCRecoEdep.h"                    // for MCEdep
 #include "larsim/MCSTReco/MCRecoPart.h"                    // for MCMiniPart
 
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
 namespace sim {
 
   //##################################################################
@@ -32,13 +35,15 @@ namespace sim {
   {
     auto result = std::make_unique<std::vector<sim::MCTrack>>();
     auto& mctracks = *result;
-    auto pindex = details::createPlaneIndexMap();
 
-    for(size_t i=0; i<part_v.size(); ++i) {
-      auto const& mini_part = part_v[i];
-      if( part_v._pdg_list.find(mini_part._pdgcode) == part_v._pdg_list.end() ) continue;
+    // Each particle is independent of the others: tracks are made in
+    // parallel, and then stored in the order of the particles
+    std::vector<::sim::MCTrack> tracks(part_v.size());
+    std::vector<char> made(part_v.size(), 0);
 
-      ::sim::MCTrack mini_track;
+    auto makeTrack = [&](size_t i, ::sim::MCTrack& mini_track) -> bool {
+      auto const& mini_part = part_v[i];
+      if( part_v._pdg_list.find(mini_part._pdgcode) == part_v._pdg_list.end() ) return false;
 
       std::vector<double> dEdx;
       std::vector<std::vector<double> > dQdx;
@@ -92,14 +97,12 @@ namespace sim {
       // No calorimetry for zero length tracks...
       // JZ : I think we should remove zero length MCTracks because I do not see their utility
       // JZ : Someone could make this a fcl parameter, I did not
-      if(mini_track.size() == 0){
-	mctracks.push_back(mini_track);
-	continue;
-      }
+      if(mini_track.size() == 0) return true;
 
       auto const& edep_index = edep_v.TrackToEdepIndex(mini_part._track_id);
-      if(edep_index < 0 ) continue;
-      auto const& edeps = edep_v.GetEdepArrayAt(edep_index);
+      if(edep_index < 0 ) return false;
+      auto const& edeps = edep_v.GetEdepColumnsAt(edep_index);
+      size_t const n_edeps = edeps.size();
 
       //int n = 0; // unused
 
@@ -155,49 +158,48 @@ namespace sim {
 	std::vector<double> step_dqdx;
 	step_dqdx.resize(3);
 
+	// quantities of this step shared by all the energy depositions
+	double const x_1 = step_trk.Position().X();
+	double const y_1 = step_trk.Position().Y();
+	double const z_1 = step_trk.Position().Z();
+	double const B2 = B.Mag2();
+	double const norm = sqrt( pow(a,2) + pow(b,2) + pow(c,2));
+
 	//Iterate through all the energy deposition points
-	for(auto const& edep : edeps){
+	for(size_t j=0; j<n_edeps; ++j){
 	  // 'x_0' definition
-	  TVector3 x_0(edep.pos._x, edep.pos._y, edep.pos._z);
+	  double const x_0 = edeps.x[j];
+	  double const y_0 = edeps.y[j];
+	  double const z_0 = edeps.z[j];
+
+	  //Planar Distance
+	  // Add in a voxel before and after to account for MCSteps
+	  double const D = (a*x_0 + b*y_0 + c*z_0 + d)/norm;
+	  if( !(D <= dist + 0.03 && D >= 0 - 0.03) ) continue;
+
 	  // 'A' definition
-	  TVector3 A(step_trk.Position().X() - x_0.X(),
-		     step_trk.Position().Y() - x_0.Y(),
-		     step_trk.Position().Z() - x_0.Z());
+	  double const A_x = x_1 - x_0;
+	  double const A_y = y_1 - y_0;
+	  double const A_z = z_1 - z_0;
 
 	  // Distance from the line connecting x_1 and x_2
 	  double LineDist = 0;
 
-	  if(B.Mag2() != 0){
-	    LineDist = sqrt(A.Mag2() - 2*pow(A*B,2)/B.Mag2() + pow(A*B,2)/B.Mag2());
+	  if(B2 != 0){
+	    double const AB = A_x*B.X() + A_y*B.Y() + A_z*B.Z();
+	    LineDist = sqrt((A_x*A_x + A_y*A_y + A_z*A_z) - 2*pow(AB,2)/B2 + pow(AB,2)/B2);
 	  }
 	  else{LineDist = 0;}
 
-	  //Planar Distance and Radial Line Distance Cuts
-	  // Add in a voxel before and after to account for MCSteps
+	  //Radial Line Distance Cut
 	  // the line distance allows for 1mm GEANT multiple columb scattering correction,
 	  // small compared to average MCStep-to-MCStep distance
-	  if( (a*edep.pos._x + b*edep.pos._y + c*edep.pos._z + d)/sqrt( pow(a,2) + pow(b,2) + pow(c,2)) <= dist + 0.03 &&
-	      (a*edep.pos._x + b*edep.pos._y + c*edep.pos._z + d)/sqrt( pow(a,2) + pow(b,2) + pow(c,2)) >=    0 - 0.03 &&
-	      LineDist < 0.1){
+	  if( LineDist < 0.1){
 
 	    //dEdx Calculation
-	    int npid = 0;
-	    double engy = 0;
-
-	    for(auto const& pid_energy : edep.deps){
-	      engy += pid_energy.energy;
-	      npid++;
-	    }
-
-	    if(npid != 0){
-	      engy /= npid;}
-	    else{engy = 0;}
-
-	    step_dedx += engy;
-	  auto const pid = edep.pid;
-          auto q_i = pindex.find(pid);
-          if(q_i != pindex.end())
-            step_dqdx[pid.Plane] += (double)(edep.deps[pindex[pid]].charge);
+	    step_dedx += edeps.energy[j];
+	    if(edeps.plane[j] != MCEdepColumns::NoPlane)
+	      step_dqdx[edeps.plane[j]] += edeps.charge[j];
 	  }
 	}
 
@@ -232,11 +234,17 @@ namespace sim {
       mini_track.dQdx(dQdx);
 
 
-      mctracks.push_back(mini_track);
+      return true;
+    };
 
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, part_v.size()),
+      [&](tbb::blocked_range<size_t> const& range) {
+        for(size_t i = range.begin(); i < range.end(); ++i)
+          made[i] = makeTrack(i, tracks[i]);
+      });
 
-
-    }
+    for(size_t i=0; i<part_v.size(); ++i)
+      if(made[i]) mctracks.push_back(std::move(tracks[i]));
 
     if(fDebugMode) {
 
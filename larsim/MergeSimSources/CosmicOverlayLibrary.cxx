@@ -0,0 +1,62 @@
+#include "CosmicOverlayLibrary.h"
+
+#include "TVector3.h"
+
+#include <string>
+
+namespace {
+
+  /// Shifts a track ID; negative IDs (the parent of a dropped particle) stay negative.
+  int offsetID(int trackID, int offset)
+  { return (trackID < 0)? (trackID - offset): (trackID + offset); }
+
+} // local namespace
+
+
+simb::MCParticle sim::CosmicOverlayTransform::apply
+  (simb::MCParticle const& particle, int offset) const
+{
+  simb::MCParticle moved(
+    particle.TrackId() + offset,
+    particle.PdgCode(),
+    particle.Process(),
+    (particle.Mother() == 0)? 0: (particle.Mother() + offset),
+    particle.Mass(),
+    particle.StatusCode()
+    );
+
+  for(unsigned int i=0; i<particle.NumberTrajectoryPoints(); i++)
+    moved.AddTrajectoryPoint(position(particle.Position(i)), momentum(particle.Momentum(i)));
+
+  for(int i=0; i<particle.NumberDaughters(); i++)
+    moved.AddDaughter(particle.Daughter(i) + offset);
+
+  moved.SetEndProcess(particle.EndProcess());
+  moved.SetWeight(particle.Weight());
+  moved.SetRescatter(particle.Rescatter());
+
+  TVector3 polarization = particle.Polarization();
+  if(mirrorX) polarization.SetX(-polarization.X());
+  if(mirrorZ) polarization.SetZ(-polarization.Z());
+  moved.SetPolarization(polarization);
+
+  return moved;
+} // sim::CosmicOverlayTransform::apply(MCParticle)
+
+
+sim::SimEnergyDeposit sim::CosmicOverlayTransform::apply
+  (sim::SimEnergyDeposit const& edep, int offset) const
+{
+  return sim::SimEnergyDeposit{
+    edep.NumPhotons(),               // np
+    edep.NumElectrons(),             // ne
+    edep.ScintYieldRatio(),          // sy
+    edep.Energy(),                   // e
+    point(edep.Start()),             // start
+    point(edep.End()),               // end
+    edep.T0() + shiftT,              // t0
+    edep.T1() + shiftT,              // t1
+    offsetID(edep.TrackID(), offset), // id
+    edep.PdgCode()                   // pdg
+    };
+} // sim::CosmicOverlayTransform::apply(SimEnergyDeposit)
@@ -0,0 +1,92 @@
+#ifndef COSMICOVERLAYLIBRARY_H
+#define COSMICOVERLAYLIBRARY_H
+
+/*!
+ * Title:   Cosmic overlay library utilities
+ *
+ * Description:
+ * Format of the library of simulated cosmic rays written by
+ * `CosmicOverlayLibraryMaker` and read by `CosmicOverlay`, and the rigid
+ * transformation the latter applies to each library record before adding it
+ * to an event.
+ *
+ * The library is a ROOT tree with one entry ("record") per primary cosmic
+ * particle, holding all the simulated particles descending from it
+ * (`particles` branch, `std::vector<simb::MCParticle>`, the primary first)
+ * and their energy deposits (`deposits` branch,
+ * `std::vector<sim::SimEnergyDeposit>`). Positions are in the detector frame,
+ * while times are relative to the start of the primary particle. Next to the
+ * tree, a `TParameter<double>` (`<tree name>_LiveTime`) holds the simulated
+ * exposure in nanoseconds, i.e. the number of events times their time window.
+ */
+
+#include "nusimdata/SimulationBase/MCParticle.h"
+
+#include "lardataobj/Simulation/SimEnergyDeposit.h"
+#include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h"
+
+#include "TLorentzVector.h"
+
+#include <string>
+
+namespace sim{
+
+  /// Names of the objects in the cosmic overlay library.
+  struct CosmicOverlayLibraryNames{
+    static constexpr char const* Particles = "particles";
+    static constexpr char const* Deposits = "deposits";
+
+    /// Name of the exposure parameter of the library tree `treeName`.
+    static std::string LiveTime(std::string const& treeName)
+    { return treeName + "_LiveTime"; }
+  };
+
+  /**
+   * @brief Rigid motion of a cosmic record, in the horizontal plane and time.
+   *
+   * The vertical direction is `y`. The record is first mirrored (optionally)
+   * on the vertical planes `x = centerX` and `z = centerZ`, then shifted by
+   * `shiftX` and `shiftZ`, and delayed by `shiftT`. Mirroring also flips the
+   * momentum components, so that the particles still move along their tracks.
+   */
+  struct CosmicOverlayTransform{
+
+    bool   mirrorX = false; ///< Whether to mirror on the `x = centerX` plane.
+    bool   mirrorZ = false; ///< Whether to mirror on the `z = centerZ` plane.
+    double centerX = 0.0;   ///< Position of the `x` mirror plane [cm]
+    double centerZ = 0.0;   ///< Position of the `z` mirror plane [cm]
+    double shiftX  = 0.0;   ///< Shift along `x` [cm]
+    double shiftZ  = 0.0;   ///< Shift along `z` [cm]
+    double shiftT  = 0.0;   ///< Delay [ns]
+
+    double x(double x) const
+    { return (mirrorX? (2.0*centerX - x): x) + shiftX; }
+    double z(double z) const
+    { return (mirrorZ? (2.0*centerZ - z): z) + shiftZ; }
+
+    /// Returns the transformed position and time.
+    TLorentzVector position(TLorentzVector const& pos) const
+    { return { x(pos.X()), pos.Y(), z(pos.Z()), pos.T() + shiftT }; }
+
+    /// Returns the transformed position.
+    geo::Point_t point(geo::Point_t const& pos) const
+    { return { x(pos.X()), pos.Y(), z(pos.Z()) }; }
+
+    /// Returns the transformed momentum.
+    TLorentzVector momentum(TLorentzVector const& mom) const
+    {
+      return { mirrorX? -mom.Px(): mom.Px(), mom.Py(),
+               mirrorZ? -mom.Pz(): mom.Pz(), mom.E() };
+    }
+
+    /// Returns a copy of `particle` moved and with track IDs shifted by `offset`.
+    simb::MCParticle apply(simb::MCParticle const& particle, int offset) const;
+
+    /// Returns a copy of `edep` moved and with track ID shifted by `offset`.
+    sim::SimEnergyDeposit apply(sim::SimEnergyDeposit const& edep, int offset) const;
+
+  }; //end CosmicOverlayTransform struct
+
+} //end namespace sim
+
+#endif
@@ -0,0 +1,214 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       CosmicOverlayLibraryMaker
+// Module Type: analyzer
+// File:        CosmicOverlayLibraryMaker_module.cc
+//
+// Writes the simulated cosmic rays of the input events, one record per
+// primary particle, into the library read by `CosmicOverlay`.
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileService.h"
+#include "canvas/Utilities/InputTag.h"
+#include "canvas/Utilities/Exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+#include "fhiclcpp/types/Sequence.h"
+#include "fhiclcpp/types/Atom.h"
+
+#include "TParameter.h"
+#include "TTree.h"
+
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "lardataobj/Simulation/SimEnergyDeposit.h"
+#include "nusimdata/SimulationBase/MCParticle.h"
+#include "CosmicOverlayLibrary.h"
+
+namespace sim {
+  class CosmicOverlayLibraryMaker;
+}
+
+/**
+ * @brief Writes the cosmic ray library for `CosmicOverlay`.
+ *
+ * Each primary particle of the input (typically from `CORSIKAGen` or
+ * `CosmicsGen` and LArG4) is written as a record of the library, together
+ * with all the particles descending from it and their energy deposits (see
+ * `CosmicOverlayLibrary.h` for the format). Deposits whose track can't be
+ * followed back to a saved particle are dropped.
+ *
+ * The rate of the cosmic rays in the library is given by the number of
+ * records and the total simulated time, which is the number of events times
+ * the time window of the generator (`GeneratedTimeWindow`); the records are
+ * written at the end of the job, so the library needs to be made in a
+ * single job.
+ */
+class sim::CosmicOverlayLibraryMaker : public art::EDAnalyzer {
+public:
+
+  struct Config {
+
+    fhicl::Atom<art::InputTag> ParticleLabel {
+      fhicl::Name{ "ParticleLabel" },
+      fhicl::Comment{ "simulated particles (simb::MCParticle) of the cosmic rays" },
+      art::InputTag{ "largeant" } // default
+      };
+
+    fhicl::Sequence<art::InputTag> EnergyDepositLabels {
+      fhicl::Name{ "EnergyDepositLabels" },
+      fhicl::Comment{ "sim::SimEnergyDeposit collections of the cosmic rays" },
+      std::vector<art::InputTag>{ "largeant:TPCActive", "largeant:Other" } // default
+      };
+
+    fhicl::Atom<double> GeneratedTimeWindow {
+      fhicl::Name{ "GeneratedTimeWindow" },
+      fhicl::Comment{ "length of the time window of the cosmic rays in each event [ns]" }
+      };
+
+    fhicl::Atom<std::string> TreeName {
+      fhicl::Name{ "TreeName" },
+      fhicl::Comment{ "name of the library tree" },
+      "cosmics" // default
+      };
+
+  }; // struct Config
+
+  using Parameters = art::EDAnalyzer::Table<Config>;
+
+  explicit CosmicOverlayLibraryMaker(Parameters const & config);
+
+  void analyze(art::Event const& e) override;
+  void endJob() override;
+
+private:
+
+  art::InputTag              const fParticleLabel;
+  std::vector<art::InputTag> const fEnergyDepositLabels;
+  double                     const fGeneratedTimeWindow;
+  std::string                const fTreeName;
+
+  TTree*                     fTree = nullptr;
+  std::vector<simb::MCParticle>      fRecordParticles; ///< Tree buffer.
+  std::vector<sim::SimEnergyDeposit> fRecordDeposits;  ///< Tree buffer.
+
+  unsigned int  fNEvents = 0;
+  unsigned long fNDropped = 0;
+
+};
+
+
+sim::CosmicOverlayLibraryMaker::CosmicOverlayLibraryMaker(Parameters const & params)
+  : EDAnalyzer{params}
+  , fParticleLabel(params().ParticleLabel())
+  , fEnergyDepositLabels(params().EnergyDepositLabels())
+  , fGeneratedTimeWindow(params().GeneratedTimeWindow())
+  , fTreeName(params().TreeName())
+{
+  if (!(fGeneratedTimeWindow > 0.0)) {
+    throw art::Exception(art::errors::Configuration)
+      << "GeneratedTimeWindow must be positive (" << fGeneratedTimeWindow << " ns).\n";
+  }
+
+  consumes<std::vector<simb::MCParticle>>(fParticleLabel);
+  for (art::InputTag const& tag: fEnergyDepositLabels)
+    consumes<std::vector<sim::SimEnergyDeposit>>(tag);
+
+  fTree = art::ServiceHandle<art::TFileService>()->make<TTree>
+    (fTreeName.c_str(), "cosmic ray overlay library");
+  fTree->Branch(CosmicOverlayLibraryNames::Particles, &fRecordParticles);
+  fTree->Branch(CosmicOverlayLibraryNames::Deposits, &fRecordDeposits);
+}
+
+
+void sim::CosmicOverlayLibraryMaker::analyze(art::Event const& e)
+{
+  ++fNEvents;
+
+  auto const& particles = e.getProduct<std::vector<simb::MCParticle>>(fParticleLabel);
+
+  std::map<int, simb::MCParticle const*> particleByID;
+  for (simb::MCParticle const& particle: particles)
+    particleByID[particle.TrackId()] = &particle;
+
+  // the primary particle each particle descends from
+  auto const primaryOf = [&particleByID](int trackID) -> simb::MCParticle const*
+    {
+      auto iParticle = particleByID.find(std::abs(trackID));
+      while ((iParticle != particleByID.end()) && (iParticle->second->Mother() != 0))
+        iParticle = particleByID.find(iParticle->second->Mother());
+      return (iParticle == particleByID.end())? nullptr: iParticle->second;
+    };
+
+  // the records, in the order of their primaries
+  std::map<int, std::size_t> recordOf;
+  std::vector<simb::MCParticle const*> primaries;
+  for (simb::MCParticle const& particle: particles) {
+    if (particle.Mother() != 0) continue;
+    recordOf[particle.TrackId()] = primaries.size();
+    primaries.push_back(&particle);
+  }
+  std::vector<std::vector<simb::MCParticle>> recordParticles(primaries.size());
+  std::vector<std::vector<sim::SimEnergyDeposit>> recordDeposits(primaries.size());
+
+  // times relative to the start of each primary
+  auto const delayOf = [&primaries](std::size_t iRecord)
+    {
+      CosmicOverlayTransform transform;
+      transform.shiftT = -primaries[iRecord]->T();
+      return transform;
+    };
+
+  for (simb::MCParticle const& particle: particles) {
+    simb::MCParticle const* primary = primaryOf(particle.TrackId());
+    if (!primary) continue; // its ancestry was not saved
+    std::size_t const iRecord = recordOf.at(primary->TrackId());
+    if (&particle == primary)
+      recordParticles[iRecord].insert(recordParticles[iRecord].begin(), delayOf(iRecord).apply(particle, 0));
+    else
+      recordParticles[iRecord].push_back(delayOf(iRecord).apply(particle, 0));
+  }
+
+  for (art::InputTag const& tag: fEnergyDepositLabels) {
+    for (sim::SimEnergyDeposit const& edep: e.getProduct<std::vector<sim::SimEnergyDeposit>>(tag)) {
+      simb::MCParticle const* primary = primaryOf(edep.TrackID());
+      if (!primary) {
+        ++fNDropped;
+        continue;
+      }
+      std::size_t const iRecord = recordOf.at(primary->TrackId());
+      recordDeposits[iRecord].push_back(delayOf(iRecord).apply(edep, 0));
+    }
+  }
+
+  for (std::size_t iRecord = 0; iRecord < primaries.size(); ++iRecord) {
+    fRecordParticles = std::move(recordParticles[iRecord]);
+    fRecordDeposits = std::move(recordDeposits[iRecord]);
+    fTree->Fill();
+  }
+
+  MF_LOG_DEBUG("CosmicOverlayLibraryMaker")
+    << e.id() << ": " << primaries.size() << " cosmic rays added to the library";
+}
+
+
+void sim::CosmicOverlayLibraryMaker::endJob()
+{
+  double const liveTime = fNEvents * fGeneratedTimeWindow;
+  art::ServiceHandle<art::TFileService>()->make<TParameter<double>>
+    (CosmicOverlayLibraryNames::LiveTime(fTreeName).c_str(), liveTime);
+
+  mf::LogInfo log("CosmicOverlayLibraryMaker");
+  log << "Library '" << fTreeName << "': " << fTree->GetEntries() << " cosmic rays from "
+    << fNEvents << " events (" << liveTime << " ns)";
+  if (fNDropped > 0)
+    log << "; " << fNDropped << " energy deposits with no saved ancestor were dropped";
+}
+
+
+DEFINE_ART_MODULE(sim::CosmicOverlayLibraryMaker)
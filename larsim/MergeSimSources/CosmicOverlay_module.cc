@@ -0,0 +1,410 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       CosmicOverlay
+// Module Type: producer
+// File:        CosmicOverlay_module.cc
+//
+// Builds the simulated cosmic rays of each event from a library of cosmic
+// rays simulated in advance (see CosmicOverlayLibraryMaker).
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "canvas/Utilities/Exception.h"
+#include "cetlib/search_path.h"
+#include "cetlib_except/exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+#include "fhiclcpp/types/Sequence.h"
+#include "fhiclcpp/types/Atom.h"
+#include "fhiclcpp/types/OptionalAtom.h"
+#include "fhiclcpp/types/OptionalSequence.h"
+#include "nurandom/RandomUtils/NuRandomService.h"
+
+#include "art/Persistency/Common/PtrMaker.h"
+#include "canvas/Persistency/Common/Assns.h"
+
+#include "CLHEP/Random/RandFlat.h"
+#include "CLHEP/Random/RandPoisson.h"
+
+#include "TFile.h"
+#include "TParameter.h"
+#include "TTree.h"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "lardataobj/Simulation/AuxDetSimChannel.h"
+#include "lardataobj/Simulation/GeneratedParticleInfo.h"
+#include "lardataobj/Simulation/SimChannel.h"
+#include "lardataobj/Simulation/SimEnergyDeposit.h"
+#include "lardataobj/Simulation/SimPhotons.h"
+#include "nusimdata/SimulationBase/MCParticle.h"
+#include "nusimdata/SimulationBase/MCTruth.h"
+#include "nusimdata/SimulationBase/simb.h" // simb::GeneratedParticleIndex_t
+#include "larcore/CoreUtils/ServiceUtil.h" // lar::providerFrom()
+#include "larcore/Geometry/Geometry.h"
+#include "larcorealg/Geometry/BoxBoundedGeo.h"
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "larcorealg/Geometry/TPCGeo.h"
+#include "larsim/Simulation/LArG4Parameters.h"
+#include "CosmicOverlayLibrary.h"
+
+namespace sim {
+  class CosmicOverlay;
+}
+
+/**
+ * @brief Produces the LArG4 output of cosmic rays from a library.
+ *
+ * Instead of generating and tracking the cosmic rays of each event, this
+ * module samples records from a library of cosmic rays simulated in advance
+ * (written by `CosmicOverlayLibraryMaker`), each record being a primary
+ * cosmic particle with all its simulated descendants and their energy
+ * deposits. The number of cosmic rays in the event is drawn from a Poisson
+ * distribution with the mean given by the library rate and the time window
+ * (`TimeWindow`); each record is started at a random time in that window,
+ * and it may be mirrored on the vertical planes through `MirrorCenter`
+ * (`MirrorX`, `MirrorZ`, each with probability 50%) and shifted in the
+ * horizontal plane by a random amount (`ShiftX`, `ShiftZ`); the vertical
+ * direction is `y`. These motions are only sensible within the area where
+ * the library cosmic rays were generated with uniform flux, and if the
+ * detector is symmetric under them: it is up to the configuration to keep
+ * within those limits.
+ *
+ * The output is the same set of data products as the one of LArG4, which can
+ * then be merged with the simulation of other sources by `MergeSimSources`:
+ * the particles (`simb::MCParticle`), with a single `simb::MCTruth` record of
+ * the primaries and their association, and the energy deposits
+ * (`sim::SimEnergyDeposit`), split between the ones starting in a TPC active
+ * volume (`TPCActive`) and the others (`Other`) after the motion. The
+ * electrons and photons reaching the readout depend on where the deposits
+ * are, and they are not in the library: the channel (`sim::SimChannel`),
+ * auxiliary detector (`sim::AuxDetSimChannel`) and photon collections are
+ * produced empty, and the charge and light need to be simulated from the
+ * energy deposits. The trajectory points of the particles do not keep the
+ * name of the process at each point.
+ */
+class sim::CosmicOverlay : public art::EDProducer {
+public:
+
+  struct Config {
+
+    fhicl::Atom<std::string> LibraryFile {
+      fhicl::Name{ "LibraryFile" },
+      fhicl::Comment{ "ROOT file with the library (searched for in FW_SEARCH_PATH)" }
+      };
+
+    fhicl::Atom<std::string> LibraryTree {
+      fhicl::Name{ "LibraryTree" },
+      fhicl::Comment{ "path of the library tree in the file" },
+      "cosmicoverlaylibrary/cosmics" // default
+      };
+
+    fhicl::Sequence<double, 2U> TimeWindow {
+      fhicl::Name{ "TimeWindow" },
+      fhicl::Comment{ "start and end time of the cosmic rays [ns]" }
+      };
+
+    fhicl::Atom<bool> MirrorX {
+      fhicl::Name{ "MirrorX" },
+      fhicl::Comment{ "mirror half of the cosmic rays on the x plane of MirrorCenter" },
+      false // default
+      };
+
+    fhicl::Atom<bool> MirrorZ {
+      fhicl::Name{ "MirrorZ" },
+      fhicl::Comment{ "mirror half of the cosmic rays on the z plane of MirrorCenter" },
+      false // default
+      };
+
+    fhicl::OptionalSequence<double, 2U> MirrorCenter {
+      fhicl::Name{ "MirrorCenter" },
+      fhicl::Comment{ "x and z of the mirror planes [cm] (default: center of the TPCs)" }
+      };
+
+    fhicl::Sequence<double, 2U> ShiftX {
+      fhicl::Name{ "ShiftX" },
+      fhicl::Comment{ "range of the random shift along x [cm]" },
+      std::array<double, 2U>{{ 0.0, 0.0 }} // default
+      };
+
+    fhicl::Sequence<double, 2U> ShiftZ {
+      fhicl::Name{ "ShiftZ" },
+      fhicl::Comment{ "range of the random shift along z [cm]" },
+      std::array<double, 2U>{{ 0.0, 0.0 }} // default
+      };
+
+    fhicl::Atom<bool> StoreReflected {
+      fhicl::Name{ "StoreReflected" },
+      fhicl::Comment{ "whether to produce also the (empty) reflected photons" },
+      false // default
+      };
+
+    fhicl::OptionalAtom<rndm::NuRandomService::seed_t> Seed {
+      fhicl::Name{ "Seed" },
+      fhicl::Comment{ "random seed (default: from NuRandomService)" }
+      };
+
+  }; // struct Config
+
+  using Parameters = art::EDProducer::Table<Config>;
+
+  explicit CosmicOverlay(Parameters const & config);
+
+  void produce(art::Event & e) override;
+
+private:
+
+  std::unique_ptr<TFile>      fLibraryFile;
+  TTree*                      fLibraryTree = nullptr;
+  std::vector<simb::MCParticle>*      fRecordParticles = nullptr; ///< Tree buffer.
+  std::vector<sim::SimEnergyDeposit>* fRecordDeposits = nullptr;  ///< Tree buffer.
+  double                      fRate = 0.0; ///< Cosmic rays per nanosecond.
+
+  double                const fT0;
+  double                const fT1;
+  bool                  const fMirrorX;
+  bool                  const fMirrorZ;
+  double                      fCenterX = 0.0;
+  double                      fCenterZ = 0.0;
+  std::array<double, 2U> const fShiftX;
+  std::array<double, 2U> const fShiftZ;
+  bool                  const fUseLitePhotons;
+  bool                  const fStoreReflected;
+
+  std::vector<geo::BoxBoundedGeo> fActiveVolumes; ///< TPC active volumes.
+
+  CLHEP::HepRandomEngine& fEngine;
+
+  static std::string const ReflectedLabel;
+
+  /// Returns whether `point` is in any TPC active volume.
+  bool isInActiveVolume(geo::Point_t const& point) const;
+
+  void dumpConfiguration() const;
+
+};
+
+
+std::string const sim::CosmicOverlay::ReflectedLabel { "Reflected" };
+
+
+sim::CosmicOverlay::CosmicOverlay(Parameters const & params)
+  : EDProducer{params}
+  , fT0(params().TimeWindow()[0])
+  , fT1(params().TimeWindow()[1])
+  , fMirrorX(params().MirrorX())
+  , fMirrorZ(params().MirrorZ())
+  , fShiftX(params().ShiftX())
+  , fShiftZ(params().ShiftZ())
+  , fUseLitePhotons(art::ServiceHandle<sim::LArG4Parameters const>()->UseLitePhotons())
+  , fStoreReflected(params().StoreReflected())
+  // the random seed is from NuRandomService, unless overridden with "Seed"
+  , fEngine(art::ServiceHandle<rndm::NuRandomService>()->createEngine(*this,
+                                                                        "HepJamesRandom",
+                                                                        "CosmicOverlay",
+                                                                        params.get_PSet(),
+                                                                        "Seed"))
+{
+  if (!(fT1 > fT0)) {
+    throw art::Exception(art::errors::Configuration)
+      << "TimeWindow must end after its start (now [ " << fT0 << " ; " << fT1 << " ] ns).\n";
+  }
+
+  //
+  // the library
+  //
+  std::string const libraryName = params().LibraryFile();
+  std::string const treePath = params().LibraryTree();
+  cet::search_path sp("FW_SEARCH_PATH");
+  std::string libraryPath;
+  if (!sp.find_file(libraryName, libraryPath)) {
+    throw art::Exception(art::errors::Configuration)
+      << "Cosmic ray library file '" << libraryName << "' not found in FW_SEARCH_PATH!\n";
+  }
+  fLibraryFile.reset(TFile::Open(libraryPath.c_str(), "READ"));
+  if (!fLibraryFile || fLibraryFile->IsZombie()) {
+    throw cet::exception("CosmicOverlay")
+      << "Cosmic ray library file '" << libraryPath << "' could not be opened.\n";
+  }
+  fLibraryFile->GetObject(treePath.c_str(), fLibraryTree);
+  if (!fLibraryTree || (fLibraryTree->GetEntries() == 0)) {
+    throw cet::exception("CosmicOverlay")
+      << "No cosmic rays in '" << treePath << "' of library file '" << libraryPath << "'.\n";
+  }
+  std::string const treeDir = treePath.substr(0, treePath.rfind('/') + 1);
+  std::string const liveTimePath
+    = treeDir + CosmicOverlayLibraryNames::LiveTime(fLibraryTree->GetName());
+  TParameter<double>* liveTime = nullptr;
+  fLibraryFile->GetObject(liveTimePath.c_str(), liveTime);
+  if (!liveTime || !(liveTime->GetVal() > 0.0)) {
+    throw cet::exception("CosmicOverlay")
+      << "No valid simulated time ('" << liveTimePath << "') in library file '"
+      << libraryPath << "'.\n";
+  }
+  fRate = fLibraryTree->GetEntries() / liveTime->GetVal();
+  fLibraryTree->SetBranchAddress(CosmicOverlayLibraryNames::Particles, &fRecordParticles);
+  fLibraryTree->SetBranchAddress(CosmicOverlayLibraryNames::Deposits, &fRecordDeposits);
+
+  //
+  // the geometry
+  //
+  auto const& geom = *(lar::providerFrom<geo::Geometry>());
+  for (geo::TPCGeo const& TPC: geom.IterateTPCs())
+    fActiveVolumes.push_back(TPC.ActiveBoundingBox());
+  std::array<double, 2U> center;
+  if (params().MirrorCenter(center)) {
+    fCenterX = center[0];
+    fCenterZ = center[1];
+  }
+  else {
+    geo::BoxBoundedGeo box { fActiveVolumes.front() };
+    for (geo::BoxBoundedGeo const& activeBox: fActiveVolumes)
+      box.ExtendToInclude(activeBox);
+    fCenterX = box.CenterX();
+    fCenterZ = box.CenterZ();
+  }
+
+  produces< std::vector<simb::MCTruth> >();
+  produces< std::vector<simb::MCParticle> >();
+  produces< std::vector<sim::SimChannel>  >();
+  produces< std::vector<sim::AuxDetSimChannel> >();
+  produces< art::Assns<simb::MCTruth, simb::MCParticle, sim::GeneratedParticleInfo> >();
+
+  if(!fUseLitePhotons) produces< std::vector<sim::SimPhotons>     >();
+  else                 produces< std::vector<sim::SimPhotonsLite> >();
+
+  if (fStoreReflected) {
+    if(!fUseLitePhotons) produces< std::vector<sim::SimPhotons>     >(ReflectedLabel);
+    else                 produces< std::vector<sim::SimPhotonsLite> >(ReflectedLabel);
+  }
+
+  produces< std::vector<sim::SimEnergyDeposit> >("TPCActive");
+  produces< std::vector<sim::SimEnergyDeposit> >("Other");
+
+  dumpConfiguration();
+
+}
+
+
+void sim::CosmicOverlay::produce(art::Event & e)
+{
+
+  auto truthCol = std::make_unique<std::vector<simb::MCTruth>>(1U);
+  auto partCol = std::make_unique<std::vector<simb::MCParticle>>();
+  auto tpassn = std::make_unique<art::Assns<simb::MCTruth, simb::MCParticle, sim::GeneratedParticleInfo>>();
+  auto edepActiveCol = std::make_unique<std::vector<sim::SimEnergyDeposit>>();
+  auto edepOtherCol = std::make_unique<std::vector<sim::SimEnergyDeposit>>();
+
+  simb::MCTruth& truth = truthCol->front();
+  truth.SetOrigin(simb::kCosmicRay);
+
+  art::PtrMaker<simb::MCTruth> const makeTruthPtr { e };
+  art::PtrMaker<simb::MCParticle> const makePartPtr { e };
+  art::Ptr<simb::MCTruth> const truthPtr = makeTruthPtr(0);
+
+  CLHEP::RandFlat flat(fEngine);
+  CLHEP::RandPoisson poisson(fEngine);
+
+  long const nCosmics = poisson.fire(fRate * (fT1 - fT0));
+  Long64_t const nRecords = fLibraryTree->GetEntries();
+
+  int trackIDoffset = 0;
+  for (long iCosmic = 0; iCosmic < nCosmics; ++iCosmic) {
+
+    Long64_t const entry
+      = std::min(static_cast<Long64_t>(flat.fire() * nRecords), nRecords - 1);
+    fLibraryTree->GetEntry(entry);
+
+    CosmicOverlayTransform transform;
+    transform.mirrorX = fMirrorX && (flat.fire() < 0.5);
+    transform.mirrorZ = fMirrorZ && (flat.fire() < 0.5);
+    transform.centerX = fCenterX;
+    transform.centerZ = fCenterZ;
+    transform.shiftX = fShiftX[0] + flat.fire() * (fShiftX[1] - fShiftX[0]);
+    transform.shiftZ = fShiftZ[0] + flat.fire() * (fShiftZ[1] - fShiftZ[0]);
+    transform.shiftT = fT0 + flat.fire() * (fT1 - fT0);
+
+    int maxTrackID = 0;
+    for (simb::MCParticle const& particle: *fRecordParticles) {
+      partCol->push_back(transform.apply(particle, trackIDoffset));
+      simb::MCParticle const& moved = partCol->back();
+      maxTrackID = std::max(maxTrackID, particle.TrackId());
+
+      sim::GeneratedParticleInfo truthInfo;
+      if (moved.Mother() == 0) {
+        truthInfo = sim::GeneratedParticleInfo
+          { static_cast<simb::GeneratedParticleIndex_t>(truth.NParticles()) };
+        simb::MCParticle primary
+          (moved.TrackId(), moved.PdgCode(), "primary", -1, moved.Mass(), 1);
+        primary.AddTrajectoryPoint(moved.Position(0), moved.Momentum(0));
+        truth.Add(primary);
+      }
+      tpassn->addSingle(truthPtr, makePartPtr(partCol->size() - 1), truthInfo);
+    } // for particles
+
+    for (sim::SimEnergyDeposit const& edep: *fRecordDeposits) {
+      sim::SimEnergyDeposit moved = transform.apply(edep, trackIDoffset);
+      if (isInActiveVolume(moved.Start())) edepActiveCol->push_back(std::move(moved));
+      else                                 edepOtherCol->push_back(std::move(moved));
+    } // for deposits
+
+    trackIDoffset += maxTrackID;
+  } // for cosmics
+
+  MF_LOG_DEBUG("CosmicOverlay") << nCosmics << " cosmic rays with " << partCol->size()
+    << " particles, " << edepActiveCol->size() << " active and " << edepOtherCol->size()
+    << " other energy deposits";
+
+  e.put(std::move(truthCol));
+  e.put(std::move(partCol));
+  e.put(std::make_unique<std::vector<sim::SimChannel>>());
+  e.put(std::make_unique<std::vector<sim::AuxDetSimChannel>>());
+  if(!fUseLitePhotons) e.put(std::make_unique<std::vector<sim::SimPhotons>>());
+  else                 e.put(std::make_unique<std::vector<sim::SimPhotonsLite>>());
+  if(fStoreReflected) {
+    if(!fUseLitePhotons) e.put(std::make_unique<std::vector<sim::SimPhotons>>(), ReflectedLabel);
+    else                 e.put(std::make_unique<std::vector<sim::SimPhotonsLite>>(), ReflectedLabel);
+  }
+  e.put(std::move(tpassn));
+  e.put(std::move(edepActiveCol), "TPCActive");
+  e.put(std::move(edepOtherCol), "Other");
+
+}
+
+
+bool sim::CosmicOverlay::isInActiveVolume(geo::Point_t const& point) const
+{
+  return std::any_of(fActiveVolumes.begin(), fActiveVolumes.end(),
+    [&point](geo::BoxBoundedGeo const& box){ return box.ContainsPosition(point); });
+}
+
+
+void sim::CosmicOverlay::dumpConfiguration() const {
+
+  mf::LogInfo log("CosmicOverlay");
+  log << "Configuration:"
+    << "\n - library: " << fLibraryTree->GetEntries() << " cosmic rays, "
+    << (fRate * 1e9) << " per second"
+    << "\n - time window: [ " << fT0 << " ; " << fT1 << " ] ns, "
+    << (fRate * (fT1 - fT0)) << " cosmic rays per event";
+  if (fMirrorX) log << "\n - mirror on x = " << fCenterX << " cm";
+  if (fMirrorZ) log << "\n - mirror on z = " << fCenterZ << " cm";
+  if (fShiftX[0] != fShiftX[1])
+    log << "\n - shift x from " << fShiftX[0] << " to " << fShiftX[1] << " cm";
+  if (fShiftZ[0] != fShiftZ[1])
+    log << "\n - shift z from " << fShiftZ[0] << " to " << fShiftZ[1] << " cm";
+
+  if (fUseLitePhotons) log << "\n - empty photon summary (`SimPhotonsLite`)";
+  else                 log << "\n - empty detailed photons (`SimPhotons`)";
+  if (fStoreReflected) log << "\n - also empty reflected light";
+
+} // sim::CosmicOverlay::dumpConfiguration()
+
+
+DEFINE_ART_MODULE(sim::CosmicOverlay)
@@ -10,10 +10,81 @@
 */
 
 #include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <stdexcept>
 #include <sstream>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 
 #include "MergeSimSources.h"
+#include "larsim/Simulation/SimPhotonsLiteBuilder.h" // sim::addDetectedPhotons()
+
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
+namespace {
+
+  /// Merges each element of `input` into the element of `merged` with the
+  /// same `key`; when there is none, the result of `adopt` (the element as
+  /// it would be merged into an empty one) is added at the end instead.
+  /// The index of `merged` is rebuilt at each call, so that merging costs
+  /// linear time in the size of both vectors.
+  template <typename T, typename Key, typename Adopt, typename Merge>
+  void mergeByKey(std::vector<T>& merged, std::vector<T> const& input,
+                  Key key, Adopt adopt, Merge merge)
+  {
+    using key_t = decltype(key(std::declval<T const&>()));
+    std::unordered_map<key_t, std::size_t> index;
+    index.reserve(merged.size() + input.size());
+    for(std::size_t i = 0; i < merged.size(); ++i)
+      index.emplace(key(merged[i]), i); // the first match, like std::find()
+
+    for(auto const& element : input){
+      auto const inserted = index.emplace(key(element), merged.size());
+      if(inserted.second) merged.push_back(adopt(element));
+      else                merge(merged[inserted.first->second], element);
+    }
+  }
+
+  /// Extends `range` to include `other`.
+  void extendRange(std::pair<int,int>& range, std::pair<int,int> const& other)
+  {
+    if(other.first < range.first) range.first = other.first;
+    if(other.second > range.second) range.second = other.second;
+  }
+
+  /// Merges `simchannel` into `dest`, with the track IDs shifted by `offset`.
+  void mergeSimChannel(sim::SimChannel& dest, sim::SimChannel const& simchannel,
+                       int offset, std::pair<int,int>& range_trackID)
+  {
+    extendRange(range_trackID, dest.MergeSimChannel(simchannel,offset));
+  }
+
+  /// Returns `simchannel` as merged into an empty channel.
+  sim::SimChannel adoptSimChannel(sim::SimChannel const& simchannel,
+                                  int offset, std::pair<int,int>& range_trackID)
+  {
+    // a channel with no track ID to shift is just copied
+    if(offset != 0){
+      sim::SimChannel dest(simchannel.Channel());
+      mergeSimChannel(dest, simchannel, offset, range_trackID);
+      return dest;
+    }
+    for(auto const& tdcide : simchannel.TDCIDEMap()){
+      for(auto const& ide : tdcide.second){
+        if(ide.trackID < range_trackID.first) range_trackID.first = ide.trackID;
+        if(ide.trackID > range_trackID.second) range_trackID.second = ide.trackID;
+      }
+    }
+    return simchannel;
+  }
+
+  constexpr std::pair<int,int> EmptyRange
+    { std::numeric_limits<int>::max(), std::numeric_limits<int>::min() };
+
+} // local namespace
 
 sim::MergeSimSourcesUtility::MergeSimSourcesUtility(const std::vector<int>& offsets)
   : fG4TrackIDOffsets(offsets)
@@ -64,54 +135,128 @@ void sim::MergeSimSourcesUtility::MergeMCParticles( std::vector<simb::MCParticle
 void sim::MergeSimSourcesUtility::MergeSimChannels(std::vector<sim::SimChannel>& merged_vector,
 						   const std::vector<sim::SimChannel>& input_vector,
 						   size_t source_index)
+{
+  std::pair<int,int> range_trackID = EmptyRange;
+  MergeSimChannels(merged_vector, input_vector, source_index, range_trackID);
+  UpdateG4TrackIDRange(range_trackID,source_index);
+}
+
+void sim::MergeSimSourcesUtility::MergeSimChannels(std::vector<sim::SimChannel>& merged_vector,
+						   const std::vector<sim::SimChannel>& input_vector,
+						   size_t source_index,
+						   std::pair<int,int>& range_trackID) const
 {
   if(source_index >= fG4TrackIDOffsets.size())
     std::runtime_error("ERROR in MergeSimSourcesUtility: Source index out of range!");
 
   merged_vector.reserve( merged_vector.size() + input_vector.size() );
 
-  std::pair<int,int> range_trackID(std::numeric_limits<int>::max(),
-				   std::numeric_limits<int>::min());
+  int const offset = fG4TrackIDOffsets[source_index];
+  mergeByKey(merged_vector, input_vector,
+             [](sim::SimChannel const& sc){ return sc.Channel(); },
+             [offset,&range_trackID](sim::SimChannel const& simchannel)
+               { return adoptSimChannel(simchannel, offset, range_trackID); },
+             [offset,&range_trackID](sim::SimChannel& dest, sim::SimChannel const& simchannel)
+               { mergeSimChannel(dest, simchannel, offset, range_trackID); });
+}
 
-  for(auto const& simchannel : input_vector){
-    std::vector<sim::SimChannel>::iterator it = std::find(merged_vector.begin(),merged_vector.end(),simchannel);
+void sim::MergeSimSourcesUtility::MergeSimChannels(std::vector<sim::SimChannel>& merged_vector,
+						   const std::vector<const std::vector<sim::SimChannel>*>& input_vectors,
+						   std::vector< std::pair<int,int> >& ranges_trackID,
+						   std::size_t chunkSize) const
+{
+  if(!merged_vector.empty())
+    throw std::logic_error("ERROR in MergeSimSourcesUtility: chunked merge into a non-empty vector!");
 
-    if(it==merged_vector.end()){
-      merged_vector.emplace_back(simchannel.Channel());
-      it = merged_vector.end() - 1;
-    }
+  std::size_t nChannels = 0;
+  for(auto const* input_vector : input_vectors) nChannels += input_vector->size();
+  std::size_t const nChunks = std::max<std::size_t>((nChannels + chunkSize - 1) / std::max<std::size_t>(chunkSize, 1), 1);
 
-    std::pair<int,int> thisrange = it->MergeSimChannel(simchannel,fG4TrackIDOffsets[source_index]);
-    if(thisrange.first < range_trackID.first) range_trackID.first = thisrange.first;
-    if(thisrange.second > range_trackID.second) range_trackID.second = thisrange.second;
+  if(nChunks == 1){
+    for(std::size_t source_index = 0; source_index < input_vectors.size(); ++source_index)
+      MergeSimChannels(merged_vector, *input_vectors[source_index], source_index, ranges_trackID[source_index]);
+    return;
   }
 
-  UpdateG4TrackIDRange(range_trackID,source_index);
+  // (source, index) of the input channels of each chunk, in merge order;
+  // all the channels with the same ID are in the same chunk
+  using Origin_t = std::pair<std::size_t, std::size_t>;
+  std::vector< std::vector<Origin_t> > chunkInputs(nChunks);
+  for(auto& inputs : chunkInputs) inputs.reserve(nChannels / nChunks + 1);
+  for(std::size_t source_index = 0; source_index < input_vectors.size(); ++source_index){
+    auto const& input_vector = *input_vectors[source_index];
+    for(std::size_t i = 0; i < input_vector.size(); ++i)
+      chunkInputs[input_vector[i].Channel() % nChunks].emplace_back(source_index, i);
+  }
+
+  struct Chunk {
+    std::vector<sim::SimChannel> channels;
+    std::vector<Origin_t> origin; // input channel each merged one started from
+    std::vector< std::pair<int,int> > ranges;
+  };
+  std::vector<Chunk> chunks(nChunks);
+  tbb::parallel_for(tbb::blocked_range<std::size_t>(0, nChunks, 1),
+    [&](tbb::blocked_range<std::size_t> const& range){
+      for(std::size_t iChunk = range.begin(); iChunk != range.end(); ++iChunk){
+        Chunk& chunk = chunks[iChunk];
+        chunk.ranges.assign(input_vectors.size(), EmptyRange);
+        std::unordered_map<raw::ChannelID_t, std::size_t> index;
+        index.reserve(chunkInputs[iChunk].size());
+        for(auto const& [ source_index, i ] : chunkInputs[iChunk]){
+          sim::SimChannel const& simchannel = (*input_vectors[source_index])[i];
+          int const offset = fG4TrackIDOffsets[source_index];
+          auto const inserted = index.emplace(simchannel.Channel(), chunk.channels.size());
+          if(inserted.second){
+            chunk.channels.push_back(adoptSimChannel(simchannel, offset, chunk.ranges[source_index]));
+            chunk.origin.emplace_back(source_index, i);
+          }
+          else{
+            mergeSimChannel(chunk.channels[inserted.first->second], simchannel, offset,
+                            chunk.ranges[source_index]);
+          }
+        }
+      }
+    });
+
+  // merging source by source, the channels are in the order they first appear
+  std::vector< std::tuple<Origin_t, std::size_t, std::size_t> > order;
+  for(std::size_t iChunk = 0; iChunk < nChunks; ++iChunk){
+    for(std::size_t i = 0; i < chunks[iChunk].channels.size(); ++i)
+      order.emplace_back(chunks[iChunk].origin[i], iChunk, i);
+    for(std::size_t source_index = 0; source_index < input_vectors.size(); ++source_index)
+      extendRange(ranges_trackID[source_index], chunks[iChunk].ranges[source_index]);
+  }
+  std::sort(order.begin(), order.end());
+  merged_vector.reserve(order.size());
+  for(auto const& [ origin, iChunk, i ] : order)
+    merged_vector.push_back(std::move(chunks[iChunk].channels[i]));
 }
 
 void sim::MergeSimSourcesUtility::MergeAuxDetSimChannels(std::vector<sim::AuxDetSimChannel>& merged_vector,
 							 const std::vector<sim::AuxDetSimChannel>& input_vector,
 							 size_t source_index)
+{
+  std::pair<int,int> range_trackID = EmptyRange;
+  MergeAuxDetSimChannels(merged_vector, input_vector, source_index, range_trackID);
+  UpdateG4TrackIDRange(range_trackID,source_index);
+}
+
+void sim::MergeSimSourcesUtility::MergeAuxDetSimChannels(std::vector<sim::AuxDetSimChannel>& merged_vector,
+							 const std::vector<sim::AuxDetSimChannel>& input_vector,
+							 size_t source_index,
+							 std::pair<int,int>& range_trackID) const
 {
   if(source_index >= fG4TrackIDOffsets.size())
     std::runtime_error("ERROR in MergeSimSourcesUtility: Source index out of range!");
 
   merged_vector.reserve( merged_vector.size() + input_vector.size() );
 
-  std::pair<int,int> range_trackID(std::numeric_limits<int>::max(),
-				   std::numeric_limits<int>::min());
-
-  for(auto const& simchannel : input_vector){
-    std::vector<sim::AuxDetSimChannel>::iterator it = std::find(merged_vector.begin(),merged_vector.end(),simchannel);
-
-    if(it==merged_vector.end()){
-      merged_vector.emplace_back(simchannel.AuxDetID(), simchannel.AuxDetSensitiveID());
-      it = merged_vector.end() - 1;
-    }
-
-    // re-make the AuxDetSimChannel with both pairs of AuxDetIDEs 
-    int offset = fG4TrackIDOffsets[source_index];
-    std::vector<sim::AuxDetIDE> all_ides = it->AuxDetIDEs(); 
+  int const offset = fG4TrackIDOffsets[source_index];
+  auto const merge = [offset,&range_trackID](sim::AuxDetSimChannel& dest, sim::AuxDetSimChannel const& simchannel){
+    // re-make the AuxDetSimChannel with both pairs of AuxDetIDEs
+    std::vector<sim::AuxDetIDE> all_ides;
+    all_ides.reserve(dest.AuxDetIDEs().size() + simchannel.AuxDetIDEs().size());
+    all_ides.insert(all_ides.end(), dest.AuxDetIDEs().begin(), dest.AuxDetIDEs().end());
     for (const sim::AuxDetIDE &ide: simchannel.AuxDetIDEs()) {
       all_ides.emplace_back(ide, offset);
 
@@ -120,48 +265,51 @@ void sim::MergeSimSourcesUtility::MergeAuxDetSimChannels(std::vector<sim::AuxDet
       if( ide.trackID+offset > range_trackID.second )
         range_trackID.second = ide.trackID+offset;
     }
-    
 
-    *it = sim::AuxDetSimChannel(simchannel.AuxDetID(), std::move(all_ides), simchannel.AuxDetSensitiveID());
-  }
-
-  UpdateG4TrackIDRange(range_trackID,source_index);
+    dest = sim::AuxDetSimChannel(simchannel.AuxDetID(), std::move(all_ides), simchannel.AuxDetSensitiveID());
+  };
+  auto const adopt = [offset,&range_trackID,&merge](sim::AuxDetSimChannel const& simchannel){
+    if(offset != 0){
+      sim::AuxDetSimChannel dest(simchannel.AuxDetID(), simchannel.AuxDetSensitiveID());
+      merge(dest, simchannel);
+      return dest;
+    }
+    for (const sim::AuxDetIDE &ide: simchannel.AuxDetIDEs()) {
+      if( ide.trackID < range_trackID.first  ) range_trackID.first = ide.trackID;
+      if( ide.trackID > range_trackID.second ) range_trackID.second = ide.trackID;
+    }
+    return simchannel;
+  };
+  mergeByKey(merged_vector, input_vector,
+             [](sim::AuxDetSimChannel const& ad){
+               return (std::uint64_t(ad.AuxDetID()) << 32) | ad.AuxDetSensitiveID();
+             },
+             adopt, merge);
 }
 
 void sim::MergeSimSourcesUtility::MergeSimPhotons( std::vector<sim::SimPhotons>& merged_vector,
-						   const std::vector<sim::SimPhotons>& input_vector)
+						   const std::vector<sim::SimPhotons>& input_vector) const
 {
 
   merged_vector.reserve( merged_vector.size() + input_vector.size() );
 
-  for(auto const& simphotons : input_vector){
-    std::vector<sim::SimPhotons>::iterator it = std::find(merged_vector.begin(),merged_vector.end(),simphotons);
-
-    if(it==merged_vector.end()){
-      merged_vector.emplace_back(simphotons.OpChannel());
-      it = merged_vector.end() - 1;
-    }
-
-    *it += simphotons;
-  }
+  mergeByKey(merged_vector, input_vector,
+             [](sim::SimPhotons const& ph){ return ph.OpChannel(); },
+             [](sim::SimPhotons const& ph){ return ph; },
+             [](sim::SimPhotons& dest, sim::SimPhotons const& ph){ dest += ph; });
 }
 
 void sim::MergeSimSourcesUtility::MergeSimPhotonsLite( std::vector<sim::SimPhotonsLite>& merged_vector,
-						       const std::vector<sim::SimPhotonsLite>& input_vector)
+						       const std::vector<sim::SimPhotonsLite>& input_vector) const
 {
 
   merged_vector.reserve( merged_vector.size() + input_vector.size() );
 
-  for(auto const& simphotons : input_vector){
-    std::vector<sim::SimPhotonsLite>::iterator it = std::find(merged_vector.begin(),merged_vector.end(),simphotons);
-
-    if(it==merged_vector.end()){
-      merged_vector.emplace_back(simphotons.OpChannel);
-      it = merged_vector.end() - 1;
-    }
-
-    *it += simphotons;
-  }
+  mergeByKey(merged_vector, input_vector,
+             [](sim::SimPhotonsLite const& ph){ return ph.OpChannel; },
+             [](sim::SimPhotonsLite const& ph){ return ph; },
+             [](sim::SimPhotonsLite& dest, sim::SimPhotonsLite const& ph)
+               { sim::addDetectedPhotons(dest.DetectedPhotons, ph.DetectedPhotons); });
 }
 
 
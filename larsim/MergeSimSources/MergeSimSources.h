@@ -10,6 +10,12 @@
  * Typically just merges vectors/maps/etc together. But, if anything as a G4 trackID, applies
  * a user-defined offset to those IDs.
  *
+ * The merges of the different product types do not share anything but the
+ * bookkeeping of the track ID ranges of the sources: the overloads taking a
+ * range extend it instead of recording it, so that they can run concurrently
+ * (on different merged vectors), and the ranges are recorded afterwards with
+ * `UpdateG4TrackIDRange()`.
+ *
 */
 
 #include "nusimdata/SimulationBase/MCParticle.h"
@@ -19,6 +25,10 @@
 #include "lardataobj/Simulation/SimEnergyDeposit.h"
 #include "lardataobj/Simulation/AuxDetSimChannel.h"
 
+#include <cstddef>
+#include <utility>
+#include <vector>
+
 namespace sim{
 
   class MergeSimSourcesUtility{
@@ -37,21 +47,53 @@ namespace sim{
 			   const std::vector<sim::SimChannel>&,
 			   size_t);
 
+    /// Merges like above, extending the range with the merged track IDs.
+    void MergeSimChannels( std::vector<sim::SimChannel>&,
+			   const std::vector<sim::SimChannel>&,
+			   size_t,
+			   std::pair<int,int>&) const;
+
+    /**
+     * @brief Merges the channels of all the sources, in parallel chunks.
+     * @param merged_vector the merged channels (must be empty)
+     * @param input_vectors the channels of each source
+     * @param ranges_trackID the range to extend with the IDs of each source
+     * @param chunkSize input channels per chunk (approximately)
+     *
+     * The channels are partitioned by ID, and each partition merged in its
+     * own task; the result is the same, and in the same order, as merging
+     * the sources one after the other.
+     */
+    void MergeSimChannels( std::vector<sim::SimChannel>& merged_vector,
+			   const std::vector<const std::vector<sim::SimChannel>*>& input_vectors,
+			   std::vector< std::pair<int,int> >& ranges_trackID,
+			   std::size_t chunkSize) const;
+
     void MergeAuxDetSimChannels( std::vector<sim::AuxDetSimChannel>&,
 				 const std::vector<sim::AuxDetSimChannel>&,
 				 size_t);
 
+    /// Merges like above, extending the range with the merged track IDs.
+    void MergeAuxDetSimChannels( std::vector<sim::AuxDetSimChannel>&,
+				 const std::vector<sim::AuxDetSimChannel>&,
+				 size_t,
+				 std::pair<int,int>&) const;
+
     void MergeSimPhotons( std::vector<sim::SimPhotons>&,
-			  const std::vector<sim::SimPhotons>&);
+			  const std::vector<sim::SimPhotons>&) const;
 
     void MergeSimPhotonsLite( std::vector<sim::SimPhotonsLite>&,
-			      const std::vector<sim::SimPhotonsLite>&);
+			      const std::vector<sim::SimPhotonsLite>&) const;
 
     void MergeSimEnergyDeposits( std::vector<sim::SimEnergyDeposit>&,
 			      const std::vector<sim::SimEnergyDeposit>&, size_t) const;
 
     const std::vector< std::vector<size_t> >& GetMCParticleListMap() { return fMCParticleListMap; }
 
+    /// Records the track IDs of a source, checking that they do not overlap
+    /// the ones of the other sources.
+    void UpdateG4TrackIDRange(std::pair<int,int>,size_t);
+
   private:
 
     std::vector<int>                   fG4TrackIDOffsets;
@@ -59,8 +101,6 @@ namespace sim{
 
     std::vector< std::vector<size_t> > fMCParticleListMap;
 
-    void UpdateG4TrackIDRange(std::pair<int,int>,size_t);
-
     static sim::SimEnergyDeposit offsetTrackID
       (sim::SimEnergyDeposit const& edep, int offset);
 
@@ -5,6 +5,12 @@
 //
 // Generated at Tue Feb 17 12:16:35 2015 by Wesley Ketchum using artmod
 // from cetpkgsupport v1_08_02.
+//
+// With ParallelMerge, the particles of all the sources are merged first;
+// then each product type is merged in its own task (the simulated channels
+// in chunks of about SimChannelMergeChunkSize input channels, partitioned by
+// channel ID), and the track ID ranges they cover are checked at the end.
+// The merged products are the same as in the serial merge.
 ////////////////////////////////////////////////////////////////////////
 
 #include "art/Framework/Core/EDProducer.h"
@@ -24,6 +30,9 @@
 #include "canvas/Persistency/Common/Assns.h"
 #include "canvas/Persistency/Common/FindOneP.h"
 
+#include "tbb/task_group.h"
+
+#include <limits>
 #include <memory>
 #include <optional>
 #include <vector>
@@ -40,6 +49,7 @@
 #include "larcorealg/CoreUtils/zip.h"
 #include "larcorealg/CoreUtils/counter.h"
 #include "larsim/Simulation/LArG4Parameters.h"
+#include "larsim/Simulation/ProductFootprint.h"
 #include "MergeSimSources.h"
 
 namespace sim {
@@ -79,6 +89,24 @@ public:
       std::vector<std::string>{ "TPCActive", "Other" } // default
       };
 
+    fhicl::Atom<bool> StoreProductFootprints {
+      fhicl::Name{ "StoreProductFootprints" },
+      fhicl::Comment{ "whether to store the sizes of the merged collections" },
+      false // default
+      };
+
+    fhicl::Atom<bool> ParallelMerge {
+      fhicl::Name{ "ParallelMerge" },
+      fhicl::Comment{ "whether to merge the different products in parallel tasks" },
+      false // default
+      };
+
+    fhicl::Atom<unsigned int> SimChannelMergeChunkSize {
+      fhicl::Name{ "SimChannelMergeChunkSize" },
+      fhicl::Comment{ "input channels merged in one parallel task (with ParallelMerge)" },
+      4096U // default
+      };
+
   }; // struct Config
 
   using Parameters = art::EDProducer::Table<Config>;
@@ -96,11 +124,26 @@ private:
   bool                       const fStoreReflected;
   bool                       const fFillSimEnergyDeposits;
   std::vector<std::string>   const fEnergyDepositionInstances;
+  bool                       const fStoreProductFootprints;
+  bool                       const fParallelMerge;
+  unsigned int               const fSimChannelMergeChunkSize;
 
   static std::string const ReflectedLabel;
   
   void dumpConfiguration() const;
 
+  /// Merges the products other than particles of all the sources, each
+  /// product type in its own task.
+  void mergeInParallel(art::Event const& e,
+                       MergeSimSourcesUtility& MergeUtility,
+                       std::vector<sim::SimChannel>& scCol,
+                       std::vector<sim::AuxDetSimChannel>& adCol,
+                       std::vector<sim::SimPhotons>& PhotonCol,
+                       std::vector<sim::SimPhotonsLite>& LitePhotonCol,
+                       std::vector<sim::SimPhotons>& ReflPhotonCol,
+                       std::vector<sim::SimPhotonsLite>& ReflLitePhotonCol,
+                       std::vector<std::unique_ptr<std::vector<sim::SimEnergyDeposit>>>& edepCols) const;
+
 };
 
 
@@ -137,12 +180,19 @@ sim::MergeSimSources::MergeSimSources(Parameters const & params)
         (art::ServiceHandle<sim::LArG4Parameters const>()->FillSimEnergyDeposits())
       )
   , fEnergyDepositionInstances(params().EnergyDepositInstanceLabels())
+  , fStoreProductFootprints(params().StoreProductFootprints())
+  , fParallelMerge(params().ParallelMerge())
+  , fSimChannelMergeChunkSize(params().SimChannelMergeChunkSize())
 {
 
   if(fInputSourcesLabels.size() != fTrackIDOffsets.size()) {
     throw art::Exception(art::errors::Configuration)
       << "Unequal input vector sizes: InputSourcesLabels and TrackIDOffsets.\n";
   }
+  if(fParallelMerge && (fSimChannelMergeChunkSize == 0)) {
+    throw art::Exception(art::errors::Configuration)
+      << "SimChannelMergeChunkSize must be positive.\n";
+  }
 
 
   for (art::InputTag const& tag: fInputSourcesLabels) {
@@ -192,6 +242,9 @@ sim::MergeSimSources::MergeSimSources(Parameters const & params)
       produces< std::vector<sim::SimEnergyDeposit> >(edep_inst);
   } // if
 
+  if (fStoreProductFootprints)
+    produces< std::vector<sim::ProductFootprint> >();
+
   
   dumpConfiguration();
 
@@ -231,6 +284,8 @@ void sim::MergeSimSources::produce(art::Event & e)
     for(auto const i_p: util::counter(mctAssn.size()))
       tpassn->addSingle(mctAssn.at(i_p), makePartPtr(assocVectorPrimitive[i_p]), mctAssn.data(i_p).ref());
 
+    if (fParallelMerge) continue; // the rest is merged below
+
 
     auto const& input_scCol
        = e.getProduct<std::vector<sim::SimChannel>>(input_label);
@@ -279,6 +334,37 @@ void sim::MergeSimSources::produce(art::Event & e)
 
   }
 
+  if (fParallelMerge) {
+    mergeInParallel(e, MergeUtility, *scCol, *adCol, *PhotonCol, *LitePhotonCol,
+                    *ReflPhotonCol, *ReflLitePhotonCol, edepCols);
+  }
+
+  sim::ProductFootprints footprints {
+    sim::makeFootprint("simb::MCParticle", *partCol),
+    sim::makeFootprint("sim::SimChannel", *scCol),
+    sim::makeFootprint("sim::AuxDetSimChannel", *adCol)
+    };
+  if(!fUseLitePhotons) {
+    footprints.push_back(sim::makeFootprint("sim::SimPhotons", *PhotonCol));
+    if(fStoreReflected)
+      footprints.push_back(sim::makeFootprint("sim::SimPhotons", *ReflPhotonCol, ReflectedLabel));
+  }
+  else {
+    footprints.push_back(sim::makeFootprint("sim::SimPhotonsLite", *LitePhotonCol));
+    if(fStoreReflected) {
+      footprints.push_back
+        (sim::makeFootprint("sim::SimPhotonsLite", *ReflLitePhotonCol, ReflectedLabel));
+    }
+  }
+  if(fFillSimEnergyDeposits) {
+    for (auto const& [ edep_inst, edepCol ]
+      : util::zip(fEnergyDepositionInstances, edepCols))
+    {
+      footprints.push_back
+        (sim::makeFootprint("sim::SimEnergyDeposit", *edepCol, edep_inst));
+    } // for
+  } // if fill energy deposits
+
   e.put(std::move(partCol));
   e.put(std::move(scCol));
   e.put(std::move(adCol));
@@ -298,9 +384,102 @@ void sim::MergeSimSources::produce(art::Event & e)
     } // for
   } // if fill energy deposits
 
+  sim::reportFootprints
+    (e, moduleDescription().moduleLabel(), std::move(footprints), fStoreProductFootprints);
+
 }
 
 
+void sim::MergeSimSources::mergeInParallel(
+  art::Event const& e,
+  MergeSimSourcesUtility& MergeUtility,
+  std::vector<sim::SimChannel>& scCol,
+  std::vector<sim::AuxDetSimChannel>& adCol,
+  std::vector<sim::SimPhotons>& PhotonCol,
+  std::vector<sim::SimPhotonsLite>& LitePhotonCol,
+  std::vector<sim::SimPhotons>& ReflPhotonCol,
+  std::vector<sim::SimPhotonsLite>& ReflLitePhotonCol,
+  std::vector<std::unique_ptr<std::vector<sim::SimEnergyDeposit>>>& edepCols
+) const {
+  
+  // the products are all read from the event before the tasks start
+  std::size_t const nSources = fInputSourcesLabels.size();
+  std::vector<std::vector<sim::SimChannel> const*> input_scCols;
+  std::vector<std::vector<sim::AuxDetSimChannel> const*> input_adCols;
+  std::vector<std::vector<sim::SimPhotons> const*> input_PhotonCols, input_ReflPhotonCols;
+  std::vector<std::vector<sim::SimPhotonsLite> const*> input_LitePhotonCols, input_ReflLitePhotonCols;
+  // [instance][source]
+  std::vector<std::vector<std::vector<sim::SimEnergyDeposit> const*>> input_EDeps
+    (edepCols.size());
+  for (art::InputTag const& input_label: fInputSourcesLabels) {
+    input_scCols.push_back(&e.getProduct<std::vector<sim::SimChannel>>(input_label));
+    input_adCols.push_back(&e.getProduct<std::vector<sim::AuxDetSimChannel>>(input_label));
+    art::InputTag const input_reflected_label { input_label.label(), ReflectedLabel };
+    if(!fUseLitePhotons) {
+      input_PhotonCols.push_back(&e.getProduct<std::vector<sim::SimPhotons>>(input_label));
+      if (fStoreReflected) {
+        input_ReflPhotonCols.push_back
+          (&e.getProduct<std::vector<sim::SimPhotons>>(input_reflected_label));
+      }
+    }
+    else {
+      input_LitePhotonCols.push_back
+        (&e.getProduct<std::vector<sim::SimPhotonsLite>>(input_label));
+      if (fStoreReflected) {
+        input_ReflLitePhotonCols.push_back
+          (&e.getProduct<std::vector<sim::SimPhotonsLite>>(input_reflected_label));
+      }
+    }
+    for (auto const& [ edep_inst, input_EDep ]: util::zip(fEnergyDepositionInstances, input_EDeps)) {
+      art::InputTag const edep_tag { input_label.label(), edep_inst };
+      input_EDep.push_back(&e.getProduct<std::vector<sim::SimEnergyDeposit>>(edep_tag));
+    }
+  } // for sources
+  
+  std::pair<int,int> const emptyRange
+    { std::numeric_limits<int>::max(), std::numeric_limits<int>::min() };
+  std::vector<std::pair<int,int>> scRanges(nSources, emptyRange);
+  std::vector<std::pair<int,int>> adRanges(nSources, emptyRange);
+  
+  tbb::task_group tasks;
+  tasks.run([&]{
+    MergeUtility.MergeSimChannels(scCol, input_scCols, scRanges, fSimChannelMergeChunkSize);
+  });
+  tasks.run([&]{
+    for (auto const i_source: util::counter(nSources))
+      MergeUtility.MergeAuxDetSimChannels(adCol, *input_adCols[i_source], i_source, adRanges[i_source]);
+  });
+  tasks.run([&]{
+    for (auto const* input: input_PhotonCols) MergeUtility.MergeSimPhotons(PhotonCol, *input);
+    for (auto const* input: input_LitePhotonCols)
+      MergeUtility.MergeSimPhotonsLite(LitePhotonCol, *input);
+  });
+  if (fStoreReflected) {
+    tasks.run([&]{
+      for (auto const* input: input_ReflPhotonCols)
+        MergeUtility.MergeSimPhotons(ReflPhotonCol, *input);
+      for (auto const* input: input_ReflLitePhotonCols)
+        MergeUtility.MergeSimPhotonsLite(ReflLitePhotonCol, *input);
+    });
+  }
+  for (auto const i_inst: util::counter(edepCols.size())) {
+    tasks.run([&, i_inst]{
+      for (auto const i_source: util::counter(nSources)) {
+        MergeUtility.MergeSimEnergyDeposits
+          (*edepCols[i_inst], *input_EDeps[i_inst][i_source], i_source);
+      }
+    });
+  }
+  tasks.wait();
+  
+  for (auto const i_source: util::counter(nSources))
+    MergeUtility.UpdateG4TrackIDRange(scRanges[i_source], i_source);
+  for (auto const i_source: util::counter(nSources))
+    MergeUtility.UpdateG4TrackIDRange(adRanges[i_source], i_source);
+  
+} // sim::MergeSimSources::mergeInParallel()
+
+
 void sim::MergeSimSources::dumpConfiguration() const {
   
   mf::LogInfo log("MergeSimSources");
@@ -327,6 +506,13 @@ void sim::MergeSimSources::dumpConfiguration() const {
   }
   else log << "\n - do not merge simulated energy deposits";
   
+  if (fStoreProductFootprints) log << "\n - store the sizes of the merged collections";
+  
+  if (fParallelMerge) {
+    log << "\n - merge the products in parallel (" << fSimChannelMergeChunkSize
+      << " input channels per task)";
+  }
+  
 } // sim::MergeSimSources::dumpConfiguration()
 
 
@@ -0,0 +1,206 @@
+/**
+ * @file   larsim/PhotonPropagation/AdaptiveVoxelGrid.cxx
+ * @brief  Hierarchical cells on top of a photon library voxelization.
+ * @see    larsim/PhotonPropagation/AdaptiveVoxelGrid.h
+ */
+
+#include "larsim/PhotonPropagation/AdaptiveVoxelGrid.h"
+
+#include "cetlib_except/exception.h"
+
+// C/C++ standard libraries
+#include <algorithm> // std::min()
+#include <fstream>
+#include <sstream>
+
+namespace phot {
+
+  //------------------------------------------------------------
+  AdaptiveVoxelGrid::AdaptiveVoxelGrid(sim::PhotonVoxelDef const& voxelDef,
+                                       unsigned int maxLevel)
+    : fVoxelDef(voxelDef), fMaxLevel(maxLevel), fSteps(voxelDef.GetSteps())
+  {
+    if (fMaxLevel > MaxSupportedLevel) {
+      throw cet::exception("AdaptiveVoxelGrid")
+        << "Refinement level " << fMaxLevel << " requested, at most " << MaxSupportedLevel
+        << " is supported.\n";
+    }
+  }
+
+  //------------------------------------------------------------
+  std::array<unsigned int, 3U>
+  AdaptiveVoxelGrid::NCells(unsigned int level) const
+  {
+    unsigned int const side = CellSide(level);
+    std::array<unsigned int, 3U> n;
+    for (std::size_t i = 0; i < 3U; ++i)
+      n[i] = (fSteps[i] + side - 1) / side;
+    return n;
+  }
+
+  //------------------------------------------------------------
+  std::vector<AdaptiveVoxelGrid::Cell_t>
+  AdaptiveVoxelGrid::RootCells() const
+  {
+    auto const n = NCells(0U);
+    std::vector<Cell_t> cells;
+    cells.reserve(std::size_t(n[0]) * n[1] * n[2]);
+    Cell_t cell;
+    for (cell.index[2] = 0; cell.index[2] < n[2]; ++cell.index[2])
+      for (cell.index[1] = 0; cell.index[1] < n[1]; ++cell.index[1])
+        for (cell.index[0] = 0; cell.index[0] < n[0]; ++cell.index[0])
+          cells.push_back(cell);
+    return cells;
+  }
+
+  //------------------------------------------------------------
+  std::vector<AdaptiveVoxelGrid::Cell_t>
+  AdaptiveVoxelGrid::Children(Cell_t const& cell) const
+  {
+    std::vector<Cell_t> children;
+    if (cell.level >= fMaxLevel) return children;
+    for (unsigned int octant = 0; octant < 8U; ++octant) {
+      Cell_t child;
+      child.level = cell.level + 1;
+      for (unsigned int i = 0; i < 3U; ++i)
+        child.index[i] = 2 * cell.index[i] + ((octant >> i) & 1U);
+      if (isValid(child)) children.push_back(child);
+    }
+    return children;
+  }
+
+  //------------------------------------------------------------
+  AdaptiveVoxelGrid::Cell_t
+  AdaptiveVoxelGrid::CellOf(std::size_t voxel, unsigned int level) const
+  {
+    auto const coords = fVoxelDef.GetVoxelCoords(voxel);
+    unsigned int const shift = fMaxLevel - level;
+    Cell_t cell;
+    cell.level = level;
+    for (std::size_t i = 0; i < 3U; ++i)
+      cell.index[i] = static_cast<unsigned int>(coords[i]) >> shift;
+    return cell;
+  }
+
+  //------------------------------------------------------------
+  bool
+  AdaptiveVoxelGrid::isValid(Cell_t const& cell) const
+  {
+    if (cell.level > fMaxLevel) return false;
+    unsigned int const side = CellSide(cell.level);
+    for (std::size_t i = 0; i < 3U; ++i) {
+      // the cell's start on the voxel grid must be inside it
+      if (std::size_t(cell.index[i]) * side >= fSteps[i]) return false;
+    }
+    return true;
+  }
+
+  //------------------------------------------------------------
+  std::size_t
+  AdaptiveVoxelGrid::FirstVoxel(Cell_t const& cell) const
+  {
+    std::size_t const side = CellSide(cell.level);
+    return cell.index[0] * side +
+           fSteps[0] * (cell.index[1] * side + fSteps[1] * cell.index[2] * side);
+  }
+
+  //------------------------------------------------------------
+  std::size_t
+  AdaptiveVoxelGrid::NVoxels(Cell_t const& cell) const
+  {
+    std::size_t n = 1U;
+    for (unsigned int i = 0; i < 3U; ++i) {
+      auto const range = stepRange(cell, i);
+      n *= range[1] - range[0];
+    }
+    return n;
+  }
+
+  //------------------------------------------------------------
+  sim::PhotonVoxel
+  AdaptiveVoxelGrid::GetCellVolume(Cell_t const& cell) const
+  {
+    geo::Point_t const& lower = fVoxelDef.GetRegionLowerCorner();
+    geo::Vector_t const size = fVoxelDef.GetVoxelSize();
+    auto const x = stepRange(cell, 0U);
+    auto const y = stepRange(cell, 1U);
+    auto const z = stepRange(cell, 2U);
+    return {lower.X() + size.X() * x[0],
+            lower.X() + size.X() * x[1],
+            lower.Y() + size.Y() * y[0],
+            lower.Y() + size.Y() * y[1],
+            lower.Z() + size.Z() * z[0],
+            lower.Z() + size.Z() * z[1]};
+  }
+
+  //------------------------------------------------------------
+  AdaptiveVoxelGrid::Cell_t
+  AdaptiveVoxelGrid::Neighbour(Cell_t const& cell, unsigned int axis, int side) const
+  {
+    Cell_t neighbour = cell;
+    // on the lower side of the region, the index wraps into an invalid cell
+    neighbour.index[axis] += (side > 0) ? 1U : -1U;
+    return neighbour;
+  }
+
+  //------------------------------------------------------------
+  std::array<unsigned int, 2U>
+  AdaptiveVoxelGrid::stepRange(Cell_t const& cell, unsigned int axis) const
+  {
+    unsigned int const side = CellSide(cell.level);
+    unsigned int const first = cell.index[axis] * side;
+    return {{first, std::min(first + side, fSteps[axis])}};
+  }
+
+  //------------------------------------------------------------
+  std::vector<AdaptiveVoxelGrid::Cell_t>
+  AdaptiveVoxelGrid::readCells(std::string const& fileName) const
+  {
+    std::ifstream in(fileName);
+    if (!in) {
+      throw cet::exception("AdaptiveVoxelGrid") << "Can't open cell list '" << fileName << "'.\n";
+    }
+
+    std::vector<Cell_t> cells;
+    std::string line;
+    unsigned int iLine = 0;
+    while (std::getline(in, line)) {
+      ++iLine;
+      auto const start = line.find_first_not_of(" \t");
+      if ((start == std::string::npos) || (line[start] == '#')) continue;
+
+      std::istringstream sstr(line);
+      Cell_t cell;
+      if (!(sstr >> cell.level >> cell.index[0] >> cell.index[1] >> cell.index[2])) {
+        throw cet::exception("AdaptiveVoxelGrid")
+          << "Format error in cell list '" << fileName << "' line " << iLine << ": '" << line
+          << "'\n";
+      }
+      if (!isValid(cell)) {
+        throw cet::exception("AdaptiveVoxelGrid")
+          << "Cell list '" << fileName << "' line " << iLine << ": cell '" << line
+          << "' is not in the voxelization (finest level: " << fMaxLevel << ").\n";
+      }
+      cells.push_back(cell);
+    }
+    return cells;
+  }
+
+  //------------------------------------------------------------
+  void
+  AdaptiveVoxelGrid::writeCells(std::string const& fileName, std::vector<Cell_t> const& cells)
+  {
+    std::ofstream out(fileName);
+    out << "# level  ix  iy  iz\n";
+    for (Cell_t const& cell : cells) {
+      out << cell.level << " " << cell.index[0] << " " << cell.index[1] << " " << cell.index[2]
+          << "\n";
+    }
+    out.close();
+    if (!out) {
+      throw cet::exception("AdaptiveVoxelGrid")
+        << "Error while writing the cell list '" << fileName << "'.\n";
+    }
+  }
+
+} // namespace phot
@@ -0,0 +1,142 @@
+/**
+ * @file   larsim/PhotonPropagation/AdaptiveVoxelGrid.h
+ * @brief  Hierarchical cells on top of a photon library voxelization.
+ * @see    larsim/PhotonPropagation/AdaptiveVoxelGrid.cxx
+ *
+ * An adaptive photon library is built on the same `sim::PhotonVoxelDef` as
+ * a regular one (the "fine" voxels), but its values are stored per _cell_:
+ * a cell of level `l` is a cube of `2^(L-l)` fine voxels per side, where `L`
+ * is the maximum refinement level. Level `0` cells are the coarsest, with
+ * `2^L` fine voxels per side; a cell of level `l < L` is refined into up to
+ * eight cells of level `l + 1`. The cells on the upper boundaries of the
+ * region may be cut short by it.
+ *
+ * Cell lists are text files with one cell per line, `level ix iy iz`, where
+ * the indices are in units of the size of the cells of that level; empty
+ * lines and lines starting with `#` are ignored.
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_ADAPTIVEVOXELGRID_H
+#define LARSIM_PHOTONPROPAGATION_ADAPTIVEVOXELGRID_H
+
+#include "larsim/Simulation/PhotonVoxels.h"
+
+// C/C++ standard libraries
+#include <array>
+#include <cstddef> // std::size_t
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace phot {
+
+  /// Cells of an adaptive refinement of a voxel definition.
+  class AdaptiveVoxelGrid {
+  public:
+    /// A cell: its refinement level and its indices on that level.
+    struct Cell_t {
+      unsigned int level = 0U;
+      std::array<unsigned int, 3U> index = {{0U, 0U, 0U}};
+
+      bool
+      operator<(Cell_t const& other) const
+      {
+        return std::tie(level, index) < std::tie(other.level, other.index);
+      }
+      bool
+      operator==(Cell_t const& other) const
+      {
+        return (level == other.level) && (index == other.index);
+      }
+    }; // Cell_t
+
+    /// Largest supported refinement level.
+    static constexpr unsigned int MaxSupportedLevel = 10U;
+
+    /**
+     * @brief Constructor: cells on the voxels of `voxelDef`.
+     * @param voxelDef the definition of the fine voxels
+     * @param maxLevel the finest level, where cells are single voxels
+     * @throw cet::exception (category: `"AdaptiveVoxelGrid"`) if `maxLevel`
+     *        is larger than `MaxSupportedLevel`
+     */
+    AdaptiveVoxelGrid(sim::PhotonVoxelDef const& voxelDef, unsigned int maxLevel);
+
+    /// Returns the definition of the fine voxels.
+    sim::PhotonVoxelDef const&
+    GetVoxelDef() const
+    {
+      return fVoxelDef;
+    }
+
+    /// Returns the finest level.
+    unsigned int
+    MaxLevel() const
+    {
+      return fMaxLevel;
+    }
+
+    /// Returns the number of fine voxels per side of a cell of `level`.
+    unsigned int
+    CellSide(unsigned int level) const
+    {
+      return 1U << (fMaxLevel - level);
+    }
+
+    /// Returns the number of cells of `level` on each direction.
+    std::array<unsigned int, 3U> NCells(unsigned int level) const;
+
+    /// Returns all the cells of level `0`.
+    std::vector<Cell_t> RootCells() const;
+
+    /// Returns the cells of the next level inside `cell` (none on `MaxLevel()`)
+    std::vector<Cell_t> Children(Cell_t const& cell) const;
+
+    /// Returns the cell of `level` containing the fine voxel `voxel`.
+    Cell_t CellOf(std::size_t voxel, unsigned int level) const;
+
+    /// Returns whether `cell` lies (at least partially) in the region.
+    bool isValid(Cell_t const& cell) const;
+
+    /// Returns the fine voxel of the cell with the lowest coordinates.
+    std::size_t FirstVoxel(Cell_t const& cell) const;
+
+    /// Returns the number of fine voxels in the cell.
+    std::size_t NVoxels(Cell_t const& cell) const;
+
+    /// Returns the volume of the cell in space (clipped to the region).
+    sim::PhotonVoxel GetCellVolume(Cell_t const& cell) const;
+
+    /// Returns the cell sharing the specified face (`axis`, `+1`/`-1` side)
+    /// with `cell`; the result is not necessarily valid.
+    Cell_t Neighbour(Cell_t const& cell, unsigned int axis, int side) const;
+
+    /// @{
+    /// @name Cell lists
+
+    /**
+     * @brief Reads a cell list.
+     * @throw cet::exception (category: `"AdaptiveVoxelGrid"`) on format error
+     *        or if any cell is not valid in this grid
+     */
+    std::vector<Cell_t> readCells(std::string const& fileName) const;
+
+    /// Writes a cell list.
+    /// @throw cet::exception (category: `"AdaptiveVoxelGrid"`) on error
+    static void writeCells(std::string const& fileName, std::vector<Cell_t> const& cells);
+
+    /// @}
+
+  private:
+    sim::PhotonVoxelDef fVoxelDef;        ///< Definition of the fine voxels.
+    unsigned int fMaxLevel;               ///< The finest level.
+    std::array<unsigned int, 3U> fSteps;  ///< Fine voxels on each direction.
+
+    /// Returns the range of fine voxel steps on `axis` covered by the cell.
+    std::array<unsigned int, 2U> stepRange(Cell_t const& cell, unsigned int axis) const;
+
+  }; // class AdaptiveVoxelGrid
+
+} // namespace phot
+
+#endif // LARSIM_PHOTONPROPAGATION_ADAPTIVEVOXELGRID_H
@@ -0,0 +1,340 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       BuildAdaptivePhotonLibrary
+// Plugin Type: analyzer (art v3_05_00)
+// File:        BuildAdaptivePhotonLibrary_module.cc
+//
+// Drives an adaptive photon library build (see `PhotonLibraryAdaptive.h`).
+// The build proceeds in passes. Each pass simulates the cells of a list with
+// the library build job (`LightSource` with `CellList`), and this module then
+// decides which of the cells simulated so far need to be refined and writes
+// the list of their children, to be simulated in the next pass. The first
+// list holds all the cells of level `0`. When no cell needs refinement (or
+// at any time), the module assembles the adaptive library from the finest
+// cells simulated.
+//
+// A cell is refined when the visibility of any channel differs from the one
+// in any neighbouring cell by more than `MaxRelativeDifference` of the
+// largest of the two, and the difference is also statistically significant.
+// Channels where both visibilities are below `MinVisibility` are ignored, so
+// that regions with negligible visibility stay coarse. Since all the cells
+// are simulated with the same number of photons, refining a cell does not
+// reduce its own statistical error: that is rather used to tell actual
+// gradients from fluctuations.
+//
+// The voxelization is taken from `PhotonVisibilityService`, which should be
+// configured with `DoNotLoadLibrary: true`, and the number of channels from
+// the geometry. The work happens at the beginning of the job; no event is
+// needed.
+//
+// Configuration:
+//  * `MaxLevel` (integer): finest level; cells of level `0` are cubes of
+//     `2^MaxLevel` voxels per side
+//  * `Passes` (list of tables, default: empty): the passes simulated so far,
+//     each with `Cells` (path of the cell list) and `Libraries` (list of the
+//     ROOT library files produced by the build jobs of that list)
+//  * `NextCells` (string, default: none): path of the list of the cells to
+//     be simulated next (all the level `0` ones if there is no pass yet)
+//  * `OutputLibrary` (string, default: none): path of the adaptive library
+//     to be written
+//  * `PhotonsPerCell` (real): photons simulated in each cell (`N` parameter
+//     of `LightSource`)
+//  * `MaxRelativeDifference` (real, default: `0.2`)
+//  * `MinSignificance` (real, default: `3.0`): minimum difference in units of
+//     its statistical error
+//  * `MinVisibility` (real, default: `1e-5`)
+//  * `StoreReflected`, `StoreReflT0` (booleans, default: `false`): also reads
+//     and stores reflected light visibilities and arrival times
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "larcore/Geometry/Geometry.h"
+#include "larsim/PhotonPropagation/AdaptiveVoxelGrid.h"
+#include "larsim/PhotonPropagation/PhotonLibraryAdaptive.h"
+#include "larsim/PhotonPropagation/PhotonVisibilityService.h"
+
+#include "TFile.h"
+#include "TKey.h"
+#include "TTree.h"
+
+#include <algorithm> // std::max()
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace phot {
+
+  class BuildAdaptivePhotonLibrary : public art::EDAnalyzer {
+  public:
+    explicit BuildAdaptivePhotonLibrary(fhicl::ParameterSet const& p);
+
+    // Plugins should not be copied or assigned.
+    BuildAdaptivePhotonLibrary(BuildAdaptivePhotonLibrary const&) = delete;
+    BuildAdaptivePhotonLibrary(BuildAdaptivePhotonLibrary&&) = delete;
+    BuildAdaptivePhotonLibrary& operator=(BuildAdaptivePhotonLibrary const&) = delete;
+    BuildAdaptivePhotonLibrary& operator=(BuildAdaptivePhotonLibrary&&) = delete;
+
+    void beginJob() override;
+    void analyze(art::Event const&) override {}
+
+  private:
+    using Cell_t = AdaptiveVoxelGrid::Cell_t;
+
+    /// Simulated values of a cell.
+    struct CellData_t {
+      std::vector<float> counts, reflCounts, reflT0s;
+    };
+    using CellMap_t = std::map<Cell_t, CellData_t>;
+
+    /// A simulation pass.
+    struct Pass_t {
+      std::string cells;
+      std::vector<std::string> libraries;
+    };
+
+    unsigned int fMaxLevel;
+    std::vector<Pass_t> fPasses;
+    std::string fNextCells;
+    std::string fOutputLibrary;
+    double fPhotonsPerCell;
+    double fMaxRelativeDifference;
+    double fMinSignificance;
+    double fMinVisibility;
+    bool fStoreReflected;
+    bool fStoreReflT0;
+
+    /// Reads the values of the cells of `pass` into `data`.
+    void readPass(Pass_t const& pass,
+                  AdaptiveVoxelGrid const& grid,
+                  std::size_t nChannels,
+                  CellMap_t& data) const;
+
+    /// Returns the cells of `data` which have no child in `data`.
+    std::vector<Cell_t> findLeaves(AdaptiveVoxelGrid const& grid, CellMap_t& data) const;
+
+    /// Returns whether the visibilities `a` and `b` differ enough to refine.
+    bool differ(std::vector<float> const& a, std::vector<float> const& b) const;
+  };
+
+  //--------------------------------------------------------------------
+  BuildAdaptivePhotonLibrary::BuildAdaptivePhotonLibrary(fhicl::ParameterSet const& p)
+    : EDAnalyzer(p)
+    , fMaxLevel(p.get<unsigned int>("MaxLevel"))
+    , fNextCells(p.get<std::string>("NextCells", ""))
+    , fOutputLibrary(p.get<std::string>("OutputLibrary", ""))
+    , fPhotonsPerCell(p.get<double>("PhotonsPerCell"))
+    , fMaxRelativeDifference(p.get<double>("MaxRelativeDifference", 0.2))
+    , fMinSignificance(p.get<double>("MinSignificance", 3.0))
+    , fMinVisibility(p.get<double>("MinVisibility", 1e-5))
+    , fStoreReflected(p.get<bool>("StoreReflected", false))
+    , fStoreReflT0(p.get<bool>("StoreReflT0", false))
+  {
+    for (auto const& pass : p.get<std::vector<fhicl::ParameterSet>>("Passes", {})) {
+      fPasses.push_back(
+        {pass.get<std::string>("Cells"), pass.get<std::vector<std::string>>("Libraries")});
+    }
+    if (fPhotonsPerCell <= 0.0) {
+      throw cet::exception("BuildAdaptivePhotonLibrary")
+        << "`PhotonsPerCell` must be positive (" << fPhotonsPerCell << " specified).\n";
+    }
+  }
+
+  //--------------------------------------------------------------------
+  void
+  BuildAdaptivePhotonLibrary::beginJob()
+  {
+    AdaptiveVoxelGrid const grid(
+      art::ServiceHandle<phot::PhotonVisibilityService const>()->GetVoxelDef(), fMaxLevel);
+    std::size_t const nChannels = art::ServiceHandle<geo::Geometry const>()->NOpDets();
+
+    if (fPasses.empty()) {
+      if (!fNextCells.empty()) {
+        std::vector<Cell_t> const cells = grid.RootCells();
+        AdaptiveVoxelGrid::writeCells(fNextCells, cells);
+        mf::LogInfo("BuildAdaptivePhotonLibrary")
+          << "First pass: " << cells.size() << " cells written into '" << fNextCells << "'";
+      }
+      return;
+    }
+
+    // later passes override the values of the cells they simulated again
+    CellMap_t data;
+    for (Pass_t const& pass : fPasses)
+      readPass(pass, grid, nChannels, data);
+
+    std::vector<Cell_t> const leaves = findLeaves(grid, data);
+
+    PhotonLibraryAdaptive lib(
+      grid.GetVoxelDef(), fMaxLevel, nChannels, fStoreReflected, fStoreReflT0);
+    for (Cell_t const& leaf : leaves) {
+      CellData_t const& values = data.at(leaf);
+      lib.SetLeaf(leaf,
+                  values.counts.data(),
+                  values.reflCounts.empty() ? nullptr : values.reflCounts.data(),
+                  values.reflT0s.empty() ? nullptr : values.reflT0s.data());
+    }
+
+    if (!fNextCells.empty()) {
+      std::vector<Cell_t> next;
+      std::size_t nRefined = 0U;
+      for (Cell_t const& leaf : leaves) {
+        if (leaf.level >= fMaxLevel) continue;
+        std::vector<float> const& counts = data.at(leaf).counts;
+        bool refine = false;
+        for (unsigned int axis = 0; (axis < 3U) && !refine; ++axis) {
+          for (int side : {-1, +1}) {
+            Cell_t const neighbour = grid.Neighbour(leaf, axis, side);
+            if (!grid.isValid(neighbour)) continue;
+            auto const iNeighbour = data.find(lib.LeafOf(grid.FirstVoxel(neighbour)));
+            if (iNeighbour == data.end()) continue; // not simulated
+            if (differ(counts, iNeighbour->second.counts)) {
+              refine = true;
+              break;
+            }
+          } // for sides
+        }   // for axes
+        if (!refine) continue;
+        ++nRefined;
+        for (Cell_t const& child : grid.Children(leaf))
+          next.push_back(child);
+      } // for leaves
+      AdaptiveVoxelGrid::writeCells(fNextCells, next);
+      mf::LogInfo("BuildAdaptivePhotonLibrary")
+        << nRefined << " of " << leaves.size() << " cells need refinement: " << next.size()
+        << " cells written into '" << fNextCells << "'";
+    }
+
+    if (!fOutputLibrary.empty()) {
+      lib.WriteLibrary(fOutputLibrary);
+      mf::LogInfo("BuildAdaptivePhotonLibrary")
+        << "Adaptive photon library written into '" << fOutputLibrary << "': " << lib.NRows()
+        << " cells for " << lib.NVoxels() << " voxels (" << lib.NNodes() << " octree nodes)";
+    }
+  }
+
+  //--------------------------------------------------------------------
+  void
+  BuildAdaptivePhotonLibrary::readPass(Pass_t const& pass,
+                                       AdaptiveVoxelGrid const& grid,
+                                       std::size_t nChannels,
+                                       CellMap_t& data) const
+  {
+    // the cells of a pass are disjoint: each has its own first voxel,
+    // which is the one the build job records its light production under
+    std::map<std::size_t, Cell_t> cellAt;
+    for (Cell_t const& cell : grid.readCells(pass.cells)) {
+      cellAt[grid.FirstVoxel(cell)] = cell;
+      CellData_t& values = data[cell];
+      values.counts.assign(nChannels, 0.0f);
+      if (fStoreReflected) values.reflCounts.assign(nChannels, 0.0f);
+      if (fStoreReflT0) values.reflT0s.assign(nChannels, 0.0f);
+    }
+
+    for (std::string const& libraryFile : pass.libraries) {
+      std::unique_ptr<TFile> f{TFile::Open(libraryFile.c_str())};
+      if (!f || f->IsZombie()) {
+        throw cet::exception("BuildAdaptivePhotonLibrary")
+          << "Can't open photon library '" << libraryFile << "'.\n";
+      }
+      TTree* tt = dynamic_cast<TTree*>(f->Get("PhotonLibraryData"));
+      if (!tt) { // library not in the top directory
+        TKey* key = f->FindKeyAny("PhotonLibraryData");
+        if (key) tt = dynamic_cast<TTree*>(key->ReadObj());
+      }
+      if (!tt) {
+        throw cet::exception("BuildAdaptivePhotonLibrary")
+          << "PhotonLibraryData not found in file '" << libraryFile << "'.\n";
+      }
+
+      Int_t Voxel;
+      Int_t OpChannel;
+      Float_t Visibility;
+      Float_t ReflVisibility = 0;
+      Float_t ReflTfirst = 0;
+      tt->SetBranchAddress("Voxel", &Voxel);
+      tt->SetBranchAddress("OpChannel", &OpChannel);
+      tt->SetBranchAddress("Visibility", &Visibility);
+      if (fStoreReflected) tt->SetBranchAddress("ReflVisibility", &ReflVisibility);
+      if (fStoreReflT0) tt->SetBranchAddress("ReflTfirst", &ReflTfirst);
+
+      std::size_t nUnknown = 0U;
+      Long64_t const nEntries = tt->GetEntries();
+      for (Long64_t i = 0; i < nEntries; ++i) {
+        tt->GetEntry(i);
+        auto const iCell = cellAt.find(Voxel);
+        if ((iCell == cellAt.end()) || (OpChannel < 0) || (std::size_t(OpChannel) >= nChannels)) {
+          ++nUnknown;
+          continue;
+        }
+        CellData_t& values = data[iCell->second];
+        values.counts[OpChannel] = Visibility;
+        if (fStoreReflected) values.reflCounts[OpChannel] = ReflVisibility;
+        if (fStoreReflT0) values.reflT0s[OpChannel] = ReflTfirst;
+      } // for entries
+      if (nUnknown > 0) {
+        mf::LogWarning("BuildAdaptivePhotonLibrary")
+          << nUnknown << " entries of '" << libraryFile << "' are not from the cells of '"
+          << pass.cells << "' and were ignored.";
+      }
+    } // for libraries
+  }
+
+  //--------------------------------------------------------------------
+  std::vector<BuildAdaptivePhotonLibrary::Cell_t>
+  BuildAdaptivePhotonLibrary::findLeaves(AdaptiveVoxelGrid const& grid, CellMap_t& data) const
+  {
+    std::vector<Cell_t> leaves;
+    std::size_t nPartial = 0U;
+    // the map is sorted by level: children added here are visited later
+    for (auto iCell = data.begin(); iCell != data.end(); ++iCell) {
+      std::vector<Cell_t> const children = grid.Children(iCell->first);
+      std::size_t nSimulated = 0U;
+      for (Cell_t const& child : children)
+        nSimulated += data.count(child);
+      if (nSimulated == 0U) {
+        leaves.push_back(iCell->first);
+        continue;
+      }
+      if (nSimulated == children.size()) continue;
+
+      // children not simulated (e.g. failed jobs) inherit the values of the parent
+      ++nPartial;
+      for (Cell_t const& child : children)
+        data.emplace(child, iCell->second);
+    }
+    if (nPartial > 0) {
+      mf::LogWarning("BuildAdaptivePhotonLibrary")
+        << nPartial << " cells were only partially refined; their missing children take"
+                       " the values of the parent.";
+    }
+    return leaves;
+  }
+
+  //--------------------------------------------------------------------
+  bool
+  BuildAdaptivePhotonLibrary::differ(std::vector<float> const& a,
+                                     std::vector<float> const& b) const
+  {
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      double const va = a[i], vb = b[i];
+      double const vmax = std::max(va, vb);
+      if (vmax < fMinVisibility) continue;
+      double const diff = std::abs(va - vb);
+      if (diff <= fMaxRelativeDifference * vmax) continue;
+      // binomial errors of the two visibilities are close to Poisson ones
+      double const sigma = std::sqrt((va + vb) / fPhotonsPerCell);
+      if (diff > fMinSignificance * sigma) return true;
+    }
+    return false;
+  }
+
+  DEFINE_ART_MODULE(BuildAdaptivePhotonLibrary)
+
+} // namespace phot
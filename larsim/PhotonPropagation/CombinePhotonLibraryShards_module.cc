@@ -0,0 +1,237 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       CombinePhotonLibraryShards
+// Plugin Type: analyzer (art v3_05_00)
+// File:        CombinePhotonLibraryShards_module.cc
+//
+// Validates the shards of a distributed photon library build and combines
+// them into a library in the memory-mappable binary format read by
+// `phot::PhotonLibraryBinary` (see `PhotonLibraryShard.h` for the shard
+// manifest and file formats).
+// The voxelization is taken from `PhotonVisibilityService`, which should be
+// configured with `DoNotLoadLibrary: true`, and the number of channels from
+// the geometry. The work happens at the beginning of the job; no event is
+// needed.
+//
+// All the shards are checked (in parallel) before anything is written, and
+// the shards which are missing, incomplete or invalid are listed, so that
+// only those need to be run again. The output file is then sized, mapped in
+// memory and each shard is read directly into its place, again in parallel;
+// the library header is written last, so that an interrupted combination
+// never leaves a file that looks like a valid library.
+//
+// Configuration:
+//  * `Manifest` (string): path of the shard manifest
+//  * `OutputLibrary` (string): path of the binary library to be written
+//  * `StoreReflected` (boolean, default: `false`): also combines reflected
+//     light visibilities
+//  * `StoreReflT0` (boolean, default: `false`): also combines reflected light
+//     first arrival times
+//  * `CheckOnly` (boolean, default: `false`): only checks the shards and
+//     reports the ones to be run again, without writing the library
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "larcore/Geometry/Geometry.h"
+#include "larsim/PhotonPropagation/PhotonLibraryBinary.h"
+#include "larsim/PhotonPropagation/PhotonLibraryShard.h"
+#include "larsim/PhotonPropagation/PhotonVisibilityService.h"
+
+#include "tbb/parallel_for.h"
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring> // std::strerror()
+#include <string>
+#include <vector>
+
+namespace phot {
+
+  class CombinePhotonLibraryShards : public art::EDAnalyzer {
+  public:
+    explicit CombinePhotonLibraryShards(fhicl::ParameterSet const& p);
+
+    // Plugins should not be copied or assigned.
+    CombinePhotonLibraryShards(CombinePhotonLibraryShards const&) = delete;
+    CombinePhotonLibraryShards(CombinePhotonLibraryShards&&) = delete;
+    CombinePhotonLibraryShards& operator=(CombinePhotonLibraryShards const&) = delete;
+    CombinePhotonLibraryShards& operator=(CombinePhotonLibraryShards&&) = delete;
+
+    void beginJob() override;
+    void analyze(art::Event const&) override {}
+
+  private:
+    std::string fManifest;
+    std::string fOutputLibrary;
+    bool fStoreReflected;
+    bool fStoreReflT0;
+    bool fCheckOnly;
+
+    /// Returns the number of shards which can't be used, after reporting them.
+    std::size_t checkShards(std::vector<PhotonLibraryShard::ShardInfo_t> const& shards,
+                            std::size_t nVoxels,
+                            std::size_t nChannels) const;
+
+    /// Writes the library from the (valid) shards.
+    void writeLibrary(std::vector<PhotonLibraryShard::ShardInfo_t> const& shards,
+                      sim::PhotonVoxelDef const& voxelDef,
+                      std::size_t nChannels) const;
+  };
+
+  //--------------------------------------------------------------------
+  CombinePhotonLibraryShards::CombinePhotonLibraryShards(fhicl::ParameterSet const& p)
+    : EDAnalyzer(p)
+    , fManifest(p.get<std::string>("Manifest"))
+    , fOutputLibrary(p.get<std::string>("OutputLibrary"))
+    , fStoreReflected(p.get<bool>("StoreReflected", false))
+    , fStoreReflT0(p.get<bool>("StoreReflT0", false))
+    , fCheckOnly(p.get<bool>("CheckOnly", false))
+  {}
+
+  //--------------------------------------------------------------------
+  void
+  CombinePhotonLibraryShards::beginJob()
+  {
+    sim::PhotonVoxelDef const& voxelDef =
+      art::ServiceHandle<phot::PhotonVisibilityService const>()->GetVoxelDef();
+    std::size_t const nVoxels = voxelDef.GetNVoxels();
+    std::size_t const nChannels = art::ServiceHandle<geo::Geometry const>()->NOpDets();
+
+    auto const shards = PhotonLibraryShard::readManifest(fManifest);
+    std::size_t const nBad = checkShards(shards, nVoxels, nChannels);
+    if (fCheckOnly) return;
+    if (nBad > 0) {
+      throw cet::exception("CombinePhotonLibraryShards")
+        << nBad << " of the " << shards.size() << " shards in '" << fManifest
+        << "' can't be used (see the messages above): run them again and repeat the"
+           " combination.\n";
+    }
+
+    writeLibrary(shards, voxelDef, nChannels);
+    mf::LogInfo("CombinePhotonLibraryShards")
+      << shards.size() << " shards from '" << fManifest << "' combined into '" << fOutputLibrary
+      << "'";
+  }
+
+  //--------------------------------------------------------------------
+  std::size_t
+  CombinePhotonLibraryShards::checkShards(
+    std::vector<PhotonLibraryShard::ShardInfo_t> const& shards,
+    std::size_t nVoxels,
+    std::size_t nChannels) const
+  {
+    // the shards (sorted) must cover all the voxels, each exactly once
+    std::size_t nextVoxel = 0U;
+    std::size_t nCoverageErrors = 0U;
+    for (auto const& shard : shards) {
+      if (shard.firstVoxel != nextVoxel) {
+        mf::LogError("CombinePhotonLibraryShards")
+          << "Shard '" << shard.fileName << "' starts at voxel " << shard.firstVoxel
+          << ", but the previous one ends at voxel " << nextVoxel << " (excluded).";
+        ++nCoverageErrors;
+      }
+      nextVoxel = shard.firstVoxel + shard.nVoxels;
+    }
+    if (nextVoxel != nVoxels) {
+      mf::LogError("CombinePhotonLibraryShards")
+        << "The shards cover up to voxel " << nextVoxel << " (excluded), the library has "
+        << nVoxels << " voxels.";
+      ++nCoverageErrors;
+    }
+
+    std::uint32_t flags = 0U;
+    if (fStoreReflected) flags |= PhotonLibraryShard::FlagReflected;
+    if (fStoreReflT0) flags |= PhotonLibraryShard::FlagReflectedT0;
+
+    std::vector<std::string> problems(shards.size());
+    tbb::parallel_for(std::size_t(0), shards.size(), [&](std::size_t iShard) {
+      problems[iShard] = PhotonLibraryShard::checkShard(shards[iShard], nChannels, flags);
+    });
+
+    std::size_t nBad = 0U;
+    for (std::size_t iShard = 0; iShard < shards.size(); ++iShard) {
+      if (problems[iShard].empty()) continue;
+      auto const& shard = shards[iShard];
+      mf::LogError("CombinePhotonLibraryShards")
+        << "Shard of voxels " << shard.firstVoxel << " - "
+        << (shard.firstVoxel + shard.nVoxels - 1) << " ('" << shard.fileName
+        << "'): " << problems[iShard];
+      ++nBad;
+    }
+    mf::LogInfo("CombinePhotonLibraryShards")
+      << (shards.size() - nBad) << " of " << shards.size() << " shards in '" << fManifest
+      << "' are complete and valid.";
+    return nBad + nCoverageErrors;
+  }
+
+  //--------------------------------------------------------------------
+  void
+  CombinePhotonLibraryShards::writeLibrary(
+    std::vector<PhotonLibraryShard::ShardInfo_t> const& shards,
+    sim::PhotonVoxelDef const& voxelDef,
+    std::size_t nChannels) const
+  {
+    PhotonLibraryBinary::FileHeader_t const header = PhotonLibraryBinary::makeHeader(
+      voxelDef.GetNVoxels(), nChannels, &voxelDef, fStoreReflected, fStoreReflT0);
+    std::uint64_t const size = PhotonLibraryBinary::fileSize(header);
+
+    int const fd = ::open(fOutputLibrary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      throw cet::exception("CombinePhotonLibraryShards")
+        << "Can't open '" << fOutputLibrary << "' for writing the photon library: "
+        << std::strerror(errno) << "\n";
+    }
+    auto fail = [fd, this](char const* what) {
+      int const error = errno;
+      ::close(fd);
+      throw cet::exception("CombinePhotonLibraryShards")
+        << "Error while " << what << " the photon library '" << fOutputLibrary
+        << "': " << std::strerror(error) << "\n";
+    };
+
+    // the file starts all zeroes, header included
+    if (::ftruncate(fd, size) != 0) fail("sizing");
+    void* const addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) fail("mapping");
+
+    float* tables[3];
+    for (std::size_t i = 0; i < 3U; ++i) {
+      tables[i] = header.offsets[i] ?
+                    reinterpret_cast<float*>(static_cast<char*>(addr) + header.offsets[i]) :
+                    nullptr;
+    }
+    try {
+      tbb::parallel_for(std::size_t(0), shards.size(), [&](std::size_t iShard) {
+        PhotonLibraryShard::copyShard(shards[iShard], nChannels, tables);
+      });
+    }
+    catch (...) {
+      ::munmap(addr, size);
+      ::close(fd);
+      throw;
+    }
+    if (::msync(addr, size, MS_SYNC) != 0) fail("synchronising");
+    ::munmap(addr, size);
+
+    // the header goes last, when all the data is in place
+    if (::pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) fail("writing to");
+    if (::fsync(fd) != 0) fail("synchronising");
+    if (::close(fd) != 0) {
+      throw cet::exception("CombinePhotonLibraryShards")
+        << "Error while closing the photon library '" << fOutputLibrary
+        << "': " << std::strerror(errno) << "\n";
+    }
+  }
+
+  DEFINE_ART_MODULE(CombinePhotonLibraryShards)
+
+} // namespace phot
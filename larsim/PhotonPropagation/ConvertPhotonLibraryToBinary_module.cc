@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       ConvertPhotonLibraryToBinary
+// Plugin Type: analyzer (art v3_05_00)
+// File:        ConvertPhotonLibraryToBinary_module.cc
+//
+// Converts a photon library from the ROOT `PhotonLibraryData` tree format
+// into the memory-mappable binary format read by `phot::PhotonLibraryBinary`.
+// The voxelization is taken from `PhotonVisibilityService`, which should be
+// configured with `DoNotLoadLibrary: true`.
+// The conversion happens at the beginning of the job; no event is needed.
+//
+// Configuration:
+//  * `InputLibrary` (string): ROOT photon library, looked up in
+//     `FW_SEARCH_PATH`
+//  * `OutputLibrary` (string): path of the binary library to be written
+//  * `StoreReflected` (boolean, default: `false`): also converts reflected
+//     light visibilities
+//  * `StoreReflT0` (boolean, default: `false`): also converts reflected light
+//     first arrival times
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "cetlib/search_path.h"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "larsim/PhotonPropagation/PhotonLibrary.h"
+#include "larsim/PhotonPropagation/PhotonLibraryBinary.h"
+#include "larsim/PhotonPropagation/PhotonVisibilityService.h"
+
+#include <string>
+
+namespace phot {
+
+  class ConvertPhotonLibraryToBinary : public art::EDAnalyzer {
+  public:
+    explicit ConvertPhotonLibraryToBinary(fhicl::ParameterSet const& p);
+
+    // Plugins should not be copied or assigned.
+    ConvertPhotonLibraryToBinary(ConvertPhotonLibraryToBinary const&) = delete;
+    ConvertPhotonLibraryToBinary(ConvertPhotonLibraryToBinary&&) = delete;
+    ConvertPhotonLibraryToBinary& operator=(ConvertPhotonLibraryToBinary const&) = delete;
+    ConvertPhotonLibraryToBinary& operator=(ConvertPhotonLibraryToBinary&&) = delete;
+
+    void beginJob() override;
+    void analyze(art::Event const&) override {}
+
+  private:
+    std::string fInputLibrary;
+    std::string fOutputLibrary;
+    bool fStoreReflected;
+    bool fStoreReflT0;
+  };
+
+  //--------------------------------------------------------------------
+  ConvertPhotonLibraryToBinary::ConvertPhotonLibraryToBinary(fhicl::ParameterSet const& p)
+    : EDAnalyzer(p)
+    , fInputLibrary(p.get<std::string>("InputLibrary"))
+    , fOutputLibrary(p.get<std::string>("OutputLibrary"))
+    , fStoreReflected(p.get<bool>("StoreReflected", false))
+    , fStoreReflT0(p.get<bool>("StoreReflT0", false))
+  {}
+
+  //--------------------------------------------------------------------
+  void
+  ConvertPhotonLibraryToBinary::beginJob()
+  {
+    cet::search_path sp("FW_SEARCH_PATH");
+    std::string inputPath;
+    if (!sp.find_file(fInputLibrary, inputPath))
+      throw cet::exception("ConvertPhotonLibraryToBinary")
+        << "Unable to find photon library '" << fInputLibrary << "' in " << sp.to_string() << "\n";
+
+    sim::PhotonVoxelDef const& voxelDef =
+      art::ServiceHandle<phot::PhotonVisibilityService const>()->GetVoxelDef();
+
+    PhotonLibrary lib;
+    lib.LoadLibraryFromFile(inputPath, voxelDef.GetNVoxels(), fStoreReflected, fStoreReflT0);
+    if (!lib.hasVoxelDef()) lib.SetVoxelDef(voxelDef);
+
+    PhotonLibraryBinary::WriteLibrary(
+      fOutputLibrary, lib, &lib.GetVoxelDef(), fStoreReflected, fStoreReflT0);
+
+    mf::LogInfo("ConvertPhotonLibraryToBinary")
+      << "Photon library '" << inputPath << "' converted into '" << fOutputLibrary << "'";
+  }
+
+  DEFINE_ART_MODULE(ConvertPhotonLibraryToBinary)
+
+} // namespace phot
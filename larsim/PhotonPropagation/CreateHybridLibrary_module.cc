@@ -1,14 +1,41 @@
 ////////////////////////////////////////////////////////////////////////
 // Chris Backhouse, UCL, Nov 2017
+//
+// Creates a hybrid photon library (see `PhotonLibraryHybrid.h`) from the
+// photon library of `PhotonVisibilityService`: for each op. det. the
+// visibility times the squared distance is fit with an exponential of the
+// distance, and the voxels poorly described by the fit are kept as
+// exceptions.
+//
+// The op. det.s are processed in parallel, in batches of `OpDetBatchSize`;
+// the (not thread-safe) ROOT output of each batch is written afterwards.
+//
+// Configuration:
+//  * `OutputLibrary` (string, default: `"hybrid.bin"`): binary hybrid
+//     library to be written (empty: none)
+//  * `FitFile` (string, default: `"fit.root"`): hybrid library in ROOT
+//     format, with the exceptions (empty: none)
+//  * `FullFile` (string, default: `"full.root"`): ROOT trees with all the
+//     voxels (empty: none)
+//  * `PlotDirectory` (string, default: `"plots"`): directory where the plots
+//     of the fits are saved (empty: no plots)
+//  * `OpDetBatchSize` (integer, default: `64`): op. det.s held in memory
 ////////////////////////////////////////////////////////////////////////
 
 #include "art/Framework/Core/EDAnalyzer.h"
 #include "art/Framework/Core/ModuleMacros.h"
+#include "fhiclcpp/ParameterSet.h"
 #include "larcore/Geometry/Geometry.h"
 #include "larcorealg/Geometry/OpDetGeo.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
 
+#include "larsim/PhotonPropagation/PhotonLibraryHybrid.h"
 #include "larsim/PhotonPropagation/PhotonVisibilityService.h"
 
 #include "TF1.h"
@@ -20,9 +47,104 @@
 #include "TStyle.h"
 #include "TVectorD.h"
 
+#include "tbb/parallel_for.h"
+
 #define PI 3.14159265
 
-namespace fhicl { class ParameterSet; }
+namespace {
+
+  /// Parameters of `exp(norm + decay * x)`.
+  struct ExpoFit_t {
+    double norm = 0.0;
+    double decay = 0.0;
+  };
+
+  /**
+   * @brief Least squares fit of `y = exp(norm + decay * x)`.
+   *
+   * All points have the same weight, as in `TGraph::Fit("expo")`. The
+   * starting point is the linear fit of `log(y)` on the positive points,
+   * weighted with `y^2` to approximate the absolute residuals; it is then
+   * refined with Gauss-Newton iterations, each one being the closed form
+   * solution of a weighted 2x2 linear least squares problem (the step is
+   * halved while it does not lower the sum of squared residuals).
+   */
+  ExpoFit_t
+  fitExpo(std::vector<double> const& x, std::vector<double> const& y)
+  {
+    ExpoFit_t fit;
+
+    // weighted linear regression of log(y)
+    double sw = 0.0, swx = 0.0, swxx = 0.0, swl = 0.0, swxl = 0.0;
+    double ymax = 0.0;
+    std::size_t nPositive = 0;
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      if (!(y[i] > 0.0)) continue;
+      double const w = y[i] * y[i], l = std::log(y[i]);
+      sw += w;
+      swx += w * x[i];
+      swxx += w * x[i] * x[i];
+      swl += w * l;
+      swxl += w * x[i] * l;
+      ymax = std::max(ymax, y[i]);
+      ++nPositive;
+    }
+    double const det = sw * swxx - swx * swx;
+    if ((nPositive < 2) || !(det > 0.0)) {
+      // no shape to fit: a flat function at the largest value
+      fit.norm = (ymax > 0.0) ? std::log(ymax) : -std::numeric_limits<float>::max();
+      return fit;
+    }
+    fit.norm = (swxx * swl - swx * swxl) / det;
+    fit.decay = (sw * swxl - swx * swl) / det;
+
+    auto sumSq = [&x, &y](double norm, double decay) {
+      double s = 0.0;
+      for (std::size_t i = 0; i < x.size(); ++i) {
+        double const r = y[i] - std::exp(norm + decay * x[i]);
+        s += r * r;
+      }
+      return s;
+    };
+
+    double chi2 = sumSq(fit.norm, fit.decay);
+    for (unsigned int iter = 0; iter < 100; ++iter) {
+      // normal equations of the linearised problem
+      double jj00 = 0.0, jj01 = 0.0, jj11 = 0.0, jr0 = 0.0, jr1 = 0.0;
+      for (std::size_t i = 0; i < x.size(); ++i) {
+        double const f = std::exp(fit.norm + fit.decay * x[i]);
+        double const r = y[i] - f;
+        double const fx = f * x[i];
+        jj00 += f * f;
+        jj01 += f * fx;
+        jj11 += fx * fx;
+        jr0 += f * r;
+        jr1 += fx * r;
+      }
+      double const d = jj00 * jj11 - jj01 * jj01;
+      if (!(d > 0.0)) break;
+      double dNorm = (jj11 * jr0 - jj01 * jr1) / d;
+      double dDecay = (jj00 * jr1 - jj01 * jr0) / d;
+
+      double newChi2 = sumSq(fit.norm + dNorm, fit.decay + dDecay);
+      for (unsigned int halving = 0; !(newChi2 <= chi2) && (halving < 30); ++halving) {
+        dNorm /= 2.0;
+        dDecay /= 2.0;
+        newChi2 = sumSq(fit.norm + dNorm, fit.decay + dDecay);
+      }
+      if (!(newChi2 <= chi2)) break; // no progress possible
+      fit.norm += dNorm;
+      fit.decay += dDecay;
+      bool const converged = (chi2 - newChi2 <= 1e-12 * chi2) ||
+                             ((std::abs(dNorm) <= 1e-10 * (1.0 + std::abs(fit.norm))) &&
+                              (std::abs(dDecay) <= 1e-10 * (1.0 + std::abs(fit.decay))));
+      chi2 = newChi2;
+      if (converged) break;
+    } // for iterations
+    return fit;
+  }
+
+} // local namespace
 
 namespace phot
 {
@@ -38,219 +160,279 @@ namespace phot
 			CreateHybridLibrary& operator=(CreateHybridLibrary&&) = delete;
 
 			void analyze(const art::Event& e) override;
+
+		private:
+			struct Visibility{
+			  int vox;
+			  int taken;
+			  float dist;
+			  float vis;
+			  float psi;
+			  float theta;
+			  float xpos;
+			};
+
+			/// Everything computed for one op. det.
+			struct OpDetResult{
+			  std::vector<Visibility> viss;
+			  ExpoFit_t fit;
+			  std::vector<float> chisqTaken; ///< Chi square of the voxels taken for the fit.
+			  std::vector<std::size_t> exceptions; ///< Indices in `viss` of the exceptions.
+			};
+
+			/// Reads the visibilities of `opdetIdx`, fits them and finds the exceptions.
+			static void processOpDet(unsigned int opdetIdx, OpDetResult& res);
 	};
 
 	//--------------------------------------------------------------------
 	CreateHybridLibrary::CreateHybridLibrary(const fhicl::ParameterSet& p)
 		: EDAnalyzer(p)
 	{
+		const std::string outputLibrary = p.get<std::string>("OutputLibrary", "hybrid.bin");
+		const std::string fitFile = p.get<std::string>("FitFile", "fit.root");
+		const std::string fullFile = p.get<std::string>("FullFile", "full.root");
+		const std::string plotDir = p.get<std::string>("PlotDirectory", "plots");
+		const unsigned int batchSize = std::max(1U, p.get<unsigned int>("OpDetBatchSize", 64));
 
 		art::ServiceHandle<geo::Geometry const> geom;
 
 		art::ServiceHandle<phot::PhotonVisibilityService const> pvs;
 		sim::PhotonVoxelDef voxdef = pvs->GetVoxelDef();
+		const unsigned int nOpDets = geom->NOpDets();
 
-		TFile* fout_full = new TFile("full.root", "RECREATE");
-		TFile* fout_fit = new TFile("fit.root", "RECREATE");
+		TFile* fout_full = fullFile.empty()? nullptr: new TFile(fullFile.c_str(), "RECREATE");
+		TFile* fout_fit = fitFile.empty()? nullptr: new TFile(fitFile.c_str(), "RECREATE");
 
-		std::cout << voxdef.GetNVoxels() << " voxels for each of " << geom->NOpDets() << " OpDets" << std::endl;
+		std::cout << voxdef.GetNVoxels() << " voxels for each of " << nOpDets << " OpDets" << std::endl;
 		std::cout << std::endl;
 
+		// the library is loaded on the first request: do it before the threads start
+		pvs->GetVisibility(voxdef.GetPhotonVoxel(0).GetCenter(), 0);
+
 		//EP = Exception points: the parameterization is not a good description of the visibility and the value of the Photon Library is kept.
 		long totExceptions = 0;
 		long totPts = 0;
 
-		for(unsigned int opdetIdx =0; opdetIdx < geom->NOpDets(); ++opdetIdx){
-		  std::cout << opdetIdx << " / " << geom->NOpDets() << std::endl;
-
-			TDirectory* d_full = fout_full->mkdir(TString::Format("opdet_%d", opdetIdx).Data());
-			TDirectory* d_fit = fout_fit->mkdir(TString::Format("opdet_%d", opdetIdx).Data());
+		std::vector<PhotonLibraryHybrid::OpDetRecord> records(nOpDets);
+		std::vector<OpDetResult> results;
+
+		for(unsigned int firstOpDet = 0; firstOpDet < nOpDets; firstOpDet += batchSize){
+		  const unsigned int endOpDet = std::min(nOpDets, firstOpDet + batchSize);
+
+		  results.clear();
+		  results.resize(endOpDet - firstOpDet);
+		  tbb::parallel_for(firstOpDet, endOpDet, [&results, firstOpDet](unsigned int opdetIdx){
+		    processOpDet(opdetIdx, results[opdetIdx - firstOpDet]);
+		  });
+
+		  for(unsigned int opdetIdx = firstOpDet; opdetIdx < endOpDet; ++opdetIdx){
+		    std::cout << opdetIdx << " / " << nOpDets << std::endl;
+		    const OpDetResult& res = results[opdetIdx - firstOpDet];
+
+		    PhotonLibraryHybrid::OpDetRecord& rec = records[opdetIdx];
+		    rec.fit = PhotonLibraryHybrid::FitFunc(res.fit.norm, res.fit.decay);
+		    rec.exceptions.reserve(res.exceptions.size());
+		    for(std::size_t i: res.exceptions){
+		      // same rounding as the ROOT file
+		      const double obs = res.viss[i].vis / 2e-5;
+		      rec.exceptions.emplace_back(res.viss[i].vox, float(obs *2e-5));
+		    }
+
+		    int vox, taken;
+		    float dist, vis, psi, theta, xpos;
+		    auto setBranches = [&](TTree* tr){
+		      tr->Branch("vox", &vox);
+		      tr->Branch("dist", &dist);
+		      tr->Branch("vis", &vis);
+		      tr->Branch("taken", &taken);
+		      tr->Branch("psi", &psi); //not needed to parameterize the visibilities, useful for tests in SP
+		      tr->Branch("theta", &theta); //not needed to parameterize the visibilities, useful for tests in SP
+		      tr->Branch("xpos", &xpos); //not needed to parameterize the visibilities, useful for tests in SP
+		    };
+		    auto setValues = [&](const Visibility& v){
+		      vox = v.vox;
+		      taken = v.taken;
+		      dist = v.dist;
+		      vis = v.vis;
+		      psi = v.psi;
+		      theta = v.theta;
+		      xpos = v.xpos;
+		    };
+
+		    if(fout_full){
+		      TDirectory* d_full = fout_full->mkdir(TString::Format("opdet_%d", opdetIdx).Data());
+		      d_full->cd();
+		      TTree* tr_full = new TTree("tr", "tr");
+		      setBranches(tr_full);
+		      for(const Visibility& v: res.viss){
+		        setValues(v);
+		        tr_full->Fill();
+		      }
+		      tr_full->Write();
+		      delete tr_full;
+		    }
+
+		    if(fout_fit){
+		      TDirectory* d_fit = fout_fit->mkdir(TString::Format("opdet_%d", opdetIdx).Data());
+		      d_fit->cd();
+		      TVectorD fitres(2);
+		      fitres[0] = res.fit.norm;
+		      fitres[1] = res.fit.decay;
+		      fitres.Write("fit");
+
+		      TTree* tr_fit = new TTree("tr", "tr");
+		      setBranches(tr_fit);
+		      for(std::size_t i: res.exceptions){
+		        setValues(res.viss[i]);
+		        const double obs = res.viss[i].vis / 2e-5;
+		        vis = obs *2e-5;
+		        //DP vis = obs *1e-7;
+		        tr_fit->Fill();
+		      }
+		      tr_fit->Write();
+		      delete tr_fit;
+		    }
+
+		    TH1F h("", "", 200, 0, 20);
+		    for(float chisq: res.chisqTaken) h.Fill(chisq);
+
+		    if(!plotDir.empty()){
+		      TCanvas *c1=new TCanvas("c1", "c1");
+		      c1->SetWindowSize(600, 600);
+		      TGraph g;
+		      for(const Visibility& v: res.viss){
+		        if(v.taken == 1) g.SetPoint(g.GetN(), v.dist, v.vis*v.dist*v.dist);
+		      }
+		      TGraph g2;
+		      for(std::size_t i: res.exceptions){
+		        const Visibility& v = res.viss[i];
+		        g2.SetPoint(g2.GetN(), v.dist, v.vis*v.dist*v.dist);
+		      }
+		      g.SetMarkerStyle(7);
+		      c1->cd();
+		      g.Draw("ap");
+		      g.GetXaxis()->SetTitle("Distance (cm)");
+		      g.GetYaxis()->SetTitle("Visibility #times r^{2}");
+		      TF1 fit("fit", "expo", g.GetXaxis()->GetXmin(), g.GetXaxis()->GetXmax());
+		      fit.SetParameters(res.fit.norm, res.fit.decay);
+		      fit.Draw("same");
+		      gPad->SetLogy();
+
+		      g2.SetMarkerSize(1);
+		      g2.SetLineWidth(3);
+		      g2.SetMarkerStyle(7);
+		      g2.SetMarkerColor(kRed);
+		      gStyle->SetLabelSize(.04, "XY");
+		      gStyle->SetTitleSize(.04,"XY");
+		      c1->cd();
+		      if(g2.GetN() > 0) g2.Draw("p same");
+		      c1->SaveAs(TString::Format("%s/Chris_vis_vs_dist_%d.png", plotDir.c_str(), opdetIdx).Data());
+
+		      h.GetXaxis()->SetTitle("#chi^{2}");
+		      h.GetYaxis()->SetTitle("Counts");
+		      h.Draw("hist");
+		      gPad->Print(TString::Format("%s/chisq_opdet_%d.eps", plotDir.c_str(), opdetIdx).Data());
+		      delete c1;
+		    }
+
+		    std::cout <<"Integral(90,-1)/Integral(all) = "<< h.Integral(90, -1) / h.Integral(0, -1) << std::endl;
+		    std::cout <<"*****************************" << std::endl;
+		    totExceptions += h.Integral(90, -1);
+		    totPts += h.Integral(0, -1);
+		  } // end for opdetIdx
+		} // end for batches
+
+		std::cout << totExceptions << " exceptions from " << totPts << " points = " << (100.*totExceptions)/totPts << "%" << std::endl;
+
+		if(!outputLibrary.empty()){
+		  PhotonLibraryHybrid::WriteBinary(outputLibrary, voxdef.GetNVoxels(), records);
+		  std::cout << "Hybrid library written into " << outputLibrary << std::endl;
+		}
+
+		delete fout_full;
+		delete fout_fit;
+		exit(0); // We're done :)
+	}
 
-			d_full->cd();
-			TTree* tr_full = new TTree("tr", "tr");
-			int vox, taken;
-			float dist, vis, psi, theta, xpos;
-			tr_full->Branch("vox", &vox);
-			tr_full->Branch("dist", &dist);
-			tr_full->Branch("vis", &vis);
-			tr_full->Branch("taken", &taken);
-			tr_full->Branch("psi", &psi); //not needed to parameterize the visibilities, useful for tests in SP
-			tr_full->Branch("theta", &theta); //not needed to parameterize the visibilities, useful for tests in SP
-			tr_full->Branch("xpos", &xpos); //not needed to parameterize the visibilities, useful for tests in SP
+	//--------------------------------------------------------------------
+	void CreateHybridLibrary::processOpDet(unsigned int opdetIdx, OpDetResult& res)
+	{
+		art::ServiceHandle<geo::Geometry const> geom;
+		art::ServiceHandle<phot::PhotonVisibilityService const> pvs;
+		sim::PhotonVoxelDef const& voxdef = pvs->GetVoxelDef();
+
+		const geo::OpDetGeo& opdet = geom->OpDetGeoFromOpDet(opdetIdx);
+		auto const opdetCenter = opdet.GetCenter();
+
+		res.viss.reserve(voxdef.GetNVoxels());
+		std::vector<double> gx, gy; // points for the fit
+
+		for(unsigned int voxIdx = 0U; voxIdx < voxdef.GetNVoxels(); ++voxIdx){
+
+			const auto voxvec = voxdef.GetPhotonVoxel(voxIdx).GetCenter();
+			const double fc_y = 600; //624cm is below the center of the first voxel outside the Field Cage
+			const double fc_z = 1394;
+			const double fc_x = 350;
+			int taken = 0;
+			//DP does not need variable "taken" because all voxels are inside the Field Cage for the Photon Library created in LightSim.
+			//DP taken = 1;
+			const float dist = opdet.DistanceToPoint(voxvec);
+			const float vis = pvs->GetVisibility(voxvec, opdetIdx);
+			// all voxels outside the Field Cage would be assigned these values of psi and theta
+			float psi = 100;
+			float theta = 200;
+			const float xpos = voxvec.X();
+
+			if((voxvec.X() - opdetCenter.X())<0){
+			  psi = atan((voxvec.Y() - opdetCenter.Y())/(-voxvec.X() +opdetCenter.X()));
+			}
 
-			const geo::OpDetGeo& opdet = geom->OpDetGeoFromOpDet(opdetIdx);
-			auto const opdetCenter = opdet.GetCenter();
-			//std::cout << "OpDet position " << opdetIdx << ": " << opdetCenter << std::endl;
+			if(voxvec.X()<fc_x && voxvec.X()>-fc_x && voxvec.Y()<fc_y && voxvec.Y()>-fc_y && voxvec.Z()> -9 && voxvec.Z()<fc_z){
+			  gx.push_back(dist);
+			  gy.push_back(vis*dist*dist);
+			  taken = 1;
+			  psi = atan((voxvec.Y() - opdetCenter.Y())/(voxvec.X() - opdetCenter.X()))* 180.0/PI ; // psi takes values within (-PI/2, PI/2)
+			  theta = acos((voxvec.Z() - opdetCenter.Z())/dist) * 180.0/PI;  // theta takes values within (0 (beam direction, z), PI (-beam direction, -z))
 
-			struct Visibility{
-			  Visibility(int vx, int t, float d, float v, float p, float th, float xp) : vox(vx), taken(t), dist(d), vis(v), psi(p), theta(th), xpos(xp) {}
-				int vox;
-				int taken;
-			        float dist;
-				float vis;
-			        float psi;
-			        float theta;
-			        float xpos;
-			};
-			TCanvas *c1=new TCanvas("c1", "c1");
-			//c1->SetCanvasSize(1500, 1500);
-			c1->SetWindowSize(600, 600);
-			//c1->Divide(1,2);
-			TGraph g;
-			TGraph g2;
-
-			std::vector<Visibility> viss;
-			viss.reserve(voxdef.GetNVoxels());
-
-			for(unsigned int voxIdx = 0U; voxIdx < voxdef.GetNVoxels(); ++voxIdx){
-
-       				const auto voxvec = voxdef.GetPhotonVoxel(voxIdx).GetCenter();
-				const double xyzvox[] = {voxvec.X(), voxvec.Y(), voxvec.Z()};
-				const double fc_y = 600; //624cm is below the center of the first voxel outside the Field Cage
-				const double fc_z = 1394;
-				const double fc_x = 350;
-				taken = 0;
-				//DP does not need variable "taken" because all voxels are inside the Field Cage for the Photon Library created in LightSim.
-				//DP taken = 1;
-				dist = opdet.DistanceToPoint(voxvec);
-				vis = pvs->GetVisibility(xyzvox, opdetIdx); // TODO use Point_t when available
-				// all voxels outside the Field Cage would be assigned these values of psi and theta
-				psi = 100;
-				theta = 200;
-      				xpos = voxvec.X();
-
-				if((voxvec.X() - opdetCenter.X())<0){
-				  psi = atan((voxvec.Y() - opdetCenter.Y())/(-voxvec.X() +opdetCenter.X()));
-				}
-
-				if(voxvec.X()<fc_x && voxvec.X()>-fc_x && voxvec.Y()<fc_y && voxvec.Y()>-fc_y && voxvec.Z()> -9 && voxvec.Z()<fc_z){
-				  g.SetPoint(g.GetN(), dist, vis*dist*dist);
-				  taken = 1;
-				  psi = atan((voxvec.Y() - opdetCenter.Y())/(voxvec.X() - opdetCenter.X()))* 180.0/PI ; // psi takes values within (-PI/2, PI/2)
-				  theta = acos((voxvec.Z() - opdetCenter.Z())/dist) * 180.0/PI;  // theta takes values within (0 (beam direction, z), PI (-beam direction, -z))
-
-				  if((voxvec.X() - opdetCenter.X())<0){
-				  psi = atan((voxvec.Y() - opdetCenter.Y())/(-voxvec.X() +opdetCenter.X()));
-				  }
-
-				}
-      				tr_full->Fill();
-				viss.emplace_back(voxIdx, taken, dist, vis, psi, theta, xpos);
-			} // end for voxIdx
-
-			d_full->cd();
-			tr_full->Write();
-			delete tr_full;
-
-			g.SetMarkerStyle(7);
-			c1->cd();
-			g.Draw("ap");
-			g.GetXaxis()->SetTitle("Distance (cm)");
-			g.GetYaxis()->SetTitle("Visibility #times r^{2}");
-			g.Fit("expo");
-			TF1* fit = g.GetFunction("expo");
-
-			d_fit->cd();
-			TVectorD fitres(2);
-			fitres[0] = fit->GetParameter(0);
-			fitres[1] = fit->GetParameter(1);
-			fitres.Write("fit");
-
-			gPad->SetLogy();
-
-			TH1F h("", "", 200, 0, 20);
-
-			d_fit->cd();
-			TTree* tr_fit = new TTree("tr", "tr");
-			tr_fit->Branch("vox", &vox);
-			tr_fit->Branch("dist", &dist);
-			tr_fit->Branch("vis", &vis);
-			tr_fit->Branch("taken", &taken);
-			tr_fit->Branch("psi", &psi);
-			tr_fit->Branch("theta", &theta);
-			tr_fit->Branch("xpos", &xpos);
-
-
-			for(const Visibility& v: viss){
-				// 2e-5 is the magic scaling factor to get back to integer photon
-				// counts. TODO this will differ for new libraries, should work out a
-				// way to communicate it or derive it.
-			        const double obs = v.vis / 2e-5; //taken from the Photon Library
-				const double pred = fit->Eval(v.dist) / (v.dist*v.dist) / 2e-5; //calculated with parameterization
-
-				//DP const double obs = v.vis / 1e-7; //magic scaling factor for DP library created in LightSim
-				//Minimal amount of detected photons is 50, bc of Landau dustribution
-				//Those voxels with detected photons < 50 were set to 0
-				//DP const double pred = fit->Eval(v.dist) / (v.dist*v.dist) / 1e-7; //calculated with parametrisation
-				//std::cout << "observed = "<<obs<<" predicted (by parametrization) = "<<pred <<std::endl;
-
-
-				// Log-likelihood ratio for poisson statistics
-				double chisq = 2*(pred-obs);
-				if(obs) chisq += 2*obs*log(obs/pred);
-
-				vox = v.vox;
-				dist = v.dist;
-				vis = pred *2e-5;
-				psi = v.psi;
-				theta = v.theta;
-				xpos = v.xpos;
-				//DP vis = pred *1e-7;
-
-
-				if (v.taken==1){
-				  h.Fill(chisq);
-				}
-
-
-				if(chisq > 9){ //equivalent to more than 9 chisquare = 3 sigma    //maybe play around with this cutoff
-					g2.SetPoint(g2.GetN(), v.dist, v.vis*v.dist*v.dist);
-					vis = obs *2e-5;
-					//DP vis = obs *1e-7;
-    					tr_fit->Fill();
-      				}
+			  if((voxvec.X() - opdetCenter.X())<0){
+			  psi = atan((voxvec.Y() - opdetCenter.Y())/(-voxvec.X() +opdetCenter.X()));
+			  }
 
 			}
+			res.viss.push_back({int(voxIdx), taken, dist, vis, psi, theta, xpos});
+		} // end for voxIdx
 
-			d_fit->cd();
-			tr_fit->Write();
-			delete tr_fit;
-			g2.SetMarkerSize(1);
-			g2.SetLineWidth(3);
-			g2.SetMarkerStyle(7);
-			g2.SetMarkerColor(kRed);
-			gStyle->SetLabelSize(.04, "XY");
-			gStyle->SetTitleSize(.04,"XY");
-			c1->cd();
-			g2.Draw("p same");
-			c1->SaveAs(TString::Format("plots/Chris_vis_vs_dist_%d.png", opdetIdx).Data());
-
-
-			h.GetXaxis()->SetTitle("#chi^{2}");
-			h.GetYaxis()->SetTitle("Counts");
-			gStyle->SetLabelSize(.04, "XY");
-			gStyle->SetTitleSize(.04,"XY");
-			h.Draw("hist");
-			std::cout <<"Integral(90,-1)/Integral(all) = "<< h.Integral(90, -1) / h.Integral(0, -1) << std::endl;
-			std::cout <<"*****************************" << std::endl;
-			totExceptions += h.Integral(90, -1);
-			totPts += h.Integral(0, -1);
-			gPad->Print(TString::Format("plots/chisq_opdet_%d.eps", opdetIdx).Data());
-
-			delete c1;
-      			} // end for opdetIdx
-
-			std::cout << totExceptions << " exceptions from " << totPts << " points = " << (100.*totExceptions)/totPts << "%" << std::endl;
-
-			delete fout_full;
-			delete fout_fit;
-			exit(0); // We're done :)
-			}
+		res.fit = fitExpo(gx, gy);
+
+		for(std::size_t i = 0; i < res.viss.size(); ++i){
+			const Visibility& v = res.viss[i];
+			// 2e-5 is the magic scaling factor to get back to integer photon
+			// counts. TODO this will differ for new libraries, should work out a
+			// way to communicate it or derive it.
+			const double obs = v.vis / 2e-5; //taken from the Photon Library
+			const double pred = std::exp(res.fit.norm + res.fit.decay*v.dist) / (v.dist*v.dist) / 2e-5; //calculated with parameterization
 
-			//--------------------------------------------------------------------
-			void CreateHybridLibrary::analyze(const art::Event&)
-			{
+			//DP const double obs = v.vis / 1e-7; //magic scaling factor for DP library created in LightSim
+			//Minimal amount of detected photons is 50, bc of Landau dustribution
+			//Those voxels with detected photons < 50 were set to 0
+			//DP const double pred = fit->Eval(v.dist) / (v.dist*v.dist) / 1e-7; //calculated with parametrisation
+
+			// Log-likelihood ratio for poisson statistics
+			double chisq = 2*(pred-obs);
+			if(obs) chisq += 2*obs*log(obs/pred);
+
+			if (v.taken==1) res.chisqTaken.push_back(chisq);
+
+			if(chisq > 9){ //equivalent to more than 9 chisquare = 3 sigma    //maybe play around with this cutoff
+				res.exceptions.push_back(i);
 			}
+		}
+	}
+
+	//--------------------------------------------------------------------
+	void CreateHybridLibrary::analyze(const art::Event&)
+	{
+	}
 
-			DEFINE_ART_MODULE(CreateHybridLibrary)
-		} // namespace
+	DEFINE_ART_MODULE(CreateHybridLibrary)
+} // namespace
@@ -0,0 +1,302 @@
+/**
+ * @file   larsim/PhotonPropagation/FastOpticalEngine.cxx
+ * @brief  Common event loop and output stage of the fast optical simulations.
+ * @see    larsim/PhotonPropagation/FastOpticalEngine.h
+ */
+
+#include "larsim/PhotonPropagation/FastOpticalEngine.h"
+#include "larsim/Simulation/ProductFootprint.h"
+#include "larsim/Utils/CounterBasedRandomEngine.h"
+#include "larsim/Utils/TraceZones.h"
+
+// framework libraries
+#include "art/Framework/Principal/Event.h"
+
+// CLHEP
+#include "CLHEP/Random/RandPoissonQ.h"
+
+// TBB
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
+// C/C++ standard libraries
+#include <algorithm> // std::minmax_element(), std::sort(), std::fill_n()
+#include <iterator>  // std::next()
+#include <memory>
+#include <utility>
+
+namespace phot {
+
+  //----------------------------------------------------------------------------
+  FastOpticalEngine::FastOpticalEngine(Config_t const& config, PhotonTimeTrigger trigger)
+    : fConfig(config)
+    , fTrigger(std::move(trigger))
+    , fDirectLitePhotons(config.nOpChannels)
+    , fReflectedLitePhotons(config.nOpChannels)
+  {
+    resetCollections();
+  }
+
+  //----------------------------------------------------------------------------
+  void
+  FastOpticalEngine::simulate(std::size_t nSources,
+                              FastOpticalModel& model,
+                              CLHEP::HepRandomEngine& photonEngine,
+                              CLHEP::HepRandomEngine& scintTimeEngine)
+  {
+    LARSIM_TRACE_ZONE("FastOpticalEngine::simulate");
+    fStats = {};
+    fStats.sources = nSources;
+    fKept.clear();
+
+    // with the trigger, only the sources which may still add photons to a
+    // window are simulated, and their photons are kept until the decision
+    std::size_t nSimulated = nSources;
+    if (fTrigger.enabled()) {
+      fTrigger.reset();
+      nSimulated = 0;
+      for (std::size_t iSource = 0; iSource < nSources; ++iSource)
+        if (fTrigger.mayCount(model.sourceStartTime(iSource))) nSimulated = iSource + 1;
+    }
+
+    if (!fConfig.parallel) {
+      CLHEP::RandPoissonQ poisson{photonEngine};
+      FastOpticalRandom rng{poisson, scintTimeEngine};
+      std::size_t const batchSize = std::max(fConfig.prepareBatchSize, std::size_t(1));
+      fSources.resize(1);
+      for (std::size_t iSource = 0; iSource < nSimulated; ++iSource) {
+        if (iSource % batchSize == 0)
+          model.prepareSources(iSource, std::min(iSource + batchSize, nSimulated));
+        FastOpticalPhotons& photons = fSources.front();
+        photons.clear();
+        model.simulateSource(iSource, rng, photons);
+        finishSource(photons, fTickCounts);
+        if (processSource(photons)) break;
+      }
+    }
+    else {
+      // a batch of blocks is prepared at once in this thread; then each block
+      // of sources is simulated in a task of its own, with its own random
+      // stream identified by the event seed and the block index, so that the
+      // result does not depend on the number of threads
+      std::uint32_t const eventSeed = static_cast<unsigned int>(photonEngine);
+      std::size_t const blockSize = std::max(fConfig.parallelBlockSize, std::size_t(1));
+      std::size_t const nBlocks = (nSimulated + blockSize - 1) / blockSize;
+      constexpr std::size_t BlocksPerBatch = 64;
+
+      for (std::size_t firstBlock = 0; firstBlock < nBlocks; firstBlock += BlocksPerBatch) {
+        std::size_t const endBlock = std::min(firstBlock + BlocksPerBatch, nBlocks);
+        std::size_t const firstSource = firstBlock * blockSize;
+        std::size_t const endSource = std::min(endBlock * blockSize, nSimulated);
+        fSources.resize(endSource - firstSource);
+        model.prepareSources(firstSource, endSource);
+
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(firstBlock, endBlock, 1),
+                          [&](tbb::blocked_range<std::size_t> const& blocks) {
+                            std::vector<int> tickCounts;
+                            larsim::Utils::PhiloxRandomEngine engine{
+                              eventSeed, fConfig.streamKey, blocks.begin()};
+                            CLHEP::RandPoissonQ poisson{engine};
+                            FastOpticalRandom rng{poisson, engine};
+                            for (std::size_t iBlock = blocks.begin(); iBlock != blocks.end();
+                                 ++iBlock) {
+                              engine.setStream(eventSeed, fConfig.streamKey, iBlock);
+                              std::size_t const end =
+                                std::min((iBlock + 1) * blockSize, nSimulated);
+                              for (std::size_t iSource = iBlock * blockSize; iSource < end;
+                                   ++iSource) {
+                                FastOpticalPhotons& photons = fSources[iSource - firstSource];
+                                photons.clear();
+                                model.simulateSource(iSource, rng, photons);
+                                finishSource(photons, tickCounts);
+                              }
+                            }
+                          });
+
+        // deterministic reduction, in source order
+        bool stop = false;
+        for (std::size_t iSource = firstSource; iSource < endSource && !stop; ++iSource)
+          stop = processSource(fSources[iSource - firstSource]);
+        if (stop) break;
+      }
+    }
+
+    if (fTrigger.enabled()) {
+      bool const withBTRs = fConfig.makeBTRs && fTrigger.accepted();
+      for (FastOpticalPhotons const& photons : fKept)
+        storeSource(photons, withBTRs);
+      fKept.clear();
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void
+  FastOpticalEngine::put(art::Event& event, std::string const& moduleLabel)
+  {
+    LARSIM_TRACE_ZONE("FastOpticalEngine::put");
+    sim::ProductFootprints footprints;
+    // records the footprint of a collection and puts it into the event
+    auto putProduct = [&event, &footprints](
+                        char const* name, auto product, std::string const& instance) {
+      footprints.push_back(sim::makeFootprint(name, *product, instance));
+      event.put(std::move(product), instance);
+    };
+
+    if (fConfig.useLitePhotons) {
+      auto makeLitePhotons = [this](sim::SimPhotonsLiteBuilder& builder) {
+        auto photons = std::make_unique<std::vector<sim::SimPhotonsLite>>(fConfig.nOpChannels);
+        for (unsigned int channel = 0; channel < fConfig.nOpChannels; ++channel)
+          (*photons)[channel].OpChannel = channel;
+        builder.addTo(*photons);
+        return photons;
+      };
+      putProduct("sim::SimPhotonsLite", makeLitePhotons(fDirectLitePhotons), "");
+      if (fConfig.makeBTRs) {
+        putProduct("sim::OpDetBacktrackerRecord",
+                   std::make_unique<std::vector<sim::OpDetBacktrackerRecord>>(fDirectBTRs.yield()),
+                   "");
+      }
+      if (fConfig.storeReflected) {
+        putProduct("sim::SimPhotonsLite", makeLitePhotons(fReflectedLitePhotons), "Reflected");
+        if (fConfig.makeBTRs) {
+          putProduct(
+            "sim::OpDetBacktrackerRecord",
+            std::make_unique<std::vector<sim::OpDetBacktrackerRecord>>(fReflectedBTRs.yield()),
+            "Reflected");
+        }
+      }
+    }
+    else {
+      putProduct("sim::SimPhotons",
+                 std::make_unique<std::vector<sim::SimPhotons>>(std::move(fDirectPhotons)),
+                 "");
+      if (fConfig.storeReflected) {
+        putProduct("sim::SimPhotons",
+                   std::make_unique<std::vector<sim::SimPhotons>>(std::move(fReflectedPhotons)),
+                   "Reflected");
+      }
+    }
+    sim::reportFootprints(event, moduleLabel, std::move(footprints), fConfig.storeProductFootprints);
+    resetCollections();
+  }
+
+  //----------------------------------------------------------------------------
+  void
+  FastOpticalEngine::resetCollections()
+  {
+    fDirectLitePhotons.clear();
+    fReflectedLitePhotons.clear();
+    fDirectBTRs.clear();
+    fReflectedBTRs.clear();
+    fDirectPhotons.clear();
+    fReflectedPhotons.clear();
+    if (fConfig.useLitePhotons) return;
+    fDirectPhotons.resize(fConfig.nOpChannels);
+    fReflectedPhotons.resize(fConfig.nOpChannels);
+    for (unsigned int channel = 0; channel < fConfig.nOpChannels; ++channel) {
+      fDirectPhotons[channel].fOpChannel = channel;
+      fReflectedPhotons[channel].fOpChannel = channel;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void
+  FastOpticalEngine::finishSource(FastOpticalPhotons& photons, std::vector<int>& tickCounts) const
+  {
+    if (!fConfig.useLitePhotons || !fConfig.aggregateLitePhotons) return;
+    for (auto const& ch : photons.channels)
+      sortTimes(photons.times, ch.begin, ch.end, tickCounts);
+  }
+
+  //----------------------------------------------------------------------------
+  bool
+  FastOpticalEngine::processSource(FastOpticalPhotons& photons)
+  {
+    ++fStats.simulated;
+    if (!photons.simulated) ++fStats.skipped;
+    for (auto const& ch : photons.channels)
+      (ch.reflected ? fStats.reflectedPhotons : fStats.directPhotons) += ch.end - ch.begin;
+
+    if (!fTrigger.enabled()) {
+      storeSource(photons, fConfig.makeBTRs);
+      return false;
+    }
+    fKept.push_back(std::move(photons));
+    return fTrigger.addDeposit(fKept.back());
+  }
+
+  //----------------------------------------------------------------------------
+  void
+  FastOpticalEngine::storeSource(FastOpticalPhotons const& photons, bool withBTRs)
+  {
+    if (!photons.simulated) return;
+
+    double const pos[3] = {photons.origin.X(), photons.origin.Y(), photons.origin.Z()};
+
+    for (auto const& ch : photons.channels) {
+      auto const timesBegin = photons.times.begin() + ch.begin;
+      auto const timesEnd = photons.times.begin() + ch.end;
+
+      if (!fConfig.useLitePhotons) {
+        sim::OnePhoton photon;
+        photon.SetInSD = false;
+        photon.InitialPosition = photons.photonOrigin;
+        photon.Energy = ch.reflected ? fConfig.reflectedPhotonEnergy : fConfig.directPhotonEnergy;
+        auto& photcol = (ch.reflected ? fReflectedPhotons : fDirectPhotons)[ch.channel];
+        for (auto it = timesBegin; it != timesEnd; ++it) {
+          photon.Time = *it;
+          photcol.push_back(photon);
+        }
+        continue;
+      }
+
+      auto& litePhotons = ch.reflected ? fReflectedLitePhotons : fDirectLitePhotons;
+      auto& btrs = ch.reflected ? fReflectedBTRs : fDirectBTRs;
+      if (withBTRs) btrs.addRecord(ch.channel);
+
+      // aggregated photons are sorted: each tick is stored at once
+      for (auto it = timesBegin; it != timesEnd;) {
+        int const time = *it;
+        auto next = std::next(it);
+        if (fConfig.aggregateLitePhotons) {
+          while ((next != timesEnd) && (*next == time))
+            ++next;
+        }
+        int const n = next - it;
+        litePhotons.add(ch.channel, time, n);
+        if (withBTRs)
+          btrs.addPhotons(ch.channel, photons.trackID, time, n, pos, n * photons.energyPerPhoton);
+        it = next;
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void
+  FastOpticalEngine::sortTimes(std::vector<int>& times,
+                               std::size_t begin,
+                               std::size_t end,
+                               std::vector<int>& tickCounts)
+  {
+    if (end - begin < 2) return;
+    auto const first = times.begin() + begin;
+    auto const last = times.begin() + end;
+
+    auto const [minTime, maxTime] = std::minmax_element(first, last);
+    int const firstTick = *minTime;
+    std::int64_t const nTicks = std::int64_t(*maxTime) - firstTick + 1;
+
+    // a counting sort, unless photons are too sparse in time for it to pay
+    if (nTicks > std::int64_t(4 * (end - begin) + 1024)) {
+      std::sort(first, last);
+      return;
+    }
+    tickCounts.assign(nTicks, 0);
+    for (auto it = first; it != last; ++it)
+      ++tickCounts[*it - firstTick];
+    auto out = first;
+    for (std::int64_t iTick = 0; iTick < nTicks; ++iTick)
+      out = std::fill_n(out, tickCounts[iTick], static_cast<int>(firstTick + iTick));
+  }
+
+} // namespace phot
@@ -0,0 +1,222 @@
+/**
+ * @file   larsim/PhotonPropagation/FastOpticalEngine.h
+ * @brief  Common event loop and output stage of the fast optical simulations.
+ * @see    larsim/PhotonPropagation/FastOpticalEngine.cxx
+ *
+ * The fast optical simulations (`PDFastSimPVS`, `PDFastSimPAR`,
+ * `PhotonLibraryPropagation`) differ in how they compute the photons
+ * detected from a light source (photon library visibilities, semi-analytic
+ * model...), and share everything else: the loop on the sources, serial or
+ * in parallel blocks with their own random streams, the early trigger
+ * decision, and the filling of `sim::SimPhotonsLite`, `sim::SimPhotons` and
+ * `sim::OpDetBacktrackerRecord`. `phot::FastOpticalEngine` does the shared
+ * part, and a `phot::FastOpticalModel` plugged into it the rest.
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_FASTOPTICALENGINE_H
+#define LARSIM_PHOTONPROPAGATION_FASTOPTICALENGINE_H
+
+// LArSoft libraries
+#include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h" // geo::Point_t
+#include "lardataobj/Simulation/OpDetBacktrackerRecord.h"
+#include "lardataobj/Simulation/SimPhotons.h"
+#include "larsim/PhotonPropagation/PhotonTimeTrigger.h"
+#include "larsim/Simulation/OpDetBacktrackerRecordAccumulator.h"
+#include "larsim/Simulation/SimPhotonsLiteBuilder.h"
+
+// C/C++ standard libraries
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// forward declarations
+namespace art {
+  class Event;
+}
+namespace CLHEP {
+  class HepRandomEngine;
+  class RandPoissonQ;
+}
+
+namespace phot {
+
+  /// Photons detected from one light source, not yet stored.
+  struct FastOpticalPhotons {
+    struct Channel {
+      unsigned int channel;
+      bool reflected;
+      std::size_t begin, end; ///< Range of the photons in `times`.
+    };
+    bool simulated = false;    ///< Whether the source was simulated at all.
+    int trackID = 0;           ///< Track the backtracking records are assigned to.
+    geo::Point_t origin;       ///< Position for the backtracking records [cm].
+    geo::Point_t photonOrigin; ///< Initial position of `sim::OnePhoton` [cm].
+    double energyPerPhoton = 0.; ///< Deposited energy per photon, for backtracking [MeV].
+    /// Channels considered for the source (each gets a backtracking record,
+    /// even without photons), in the order their records are made.
+    std::vector<Channel> channels;
+    std::vector<int> times; ///< Arrival tick of each photon, channel by channel.
+
+    void
+    clear()
+    {
+      simulated = false;
+      channels.clear();
+      times.clear();
+    }
+  };
+
+  /// Random numbers for the simulation of light sources.
+  struct FastOpticalRandom {
+    CLHEP::RandPoissonQ& poisson;      ///< Number of detected photons.
+    CLHEP::HepRandomEngine& scintTime; ///< Emission and propagation times.
+  };
+
+  /**
+   * @brief Interface of the simulation of the photons detected from a source.
+   *
+   * The sources are indexed from `0` to the number of sources of the event.
+   * With parallel simulation, `simulateSource()` is called concurrently from
+   * different threads (with different sources and random streams), while
+   * `prepareSources()` is always called from the thread of the event.
+   */
+  class FastOpticalModel {
+  public:
+    virtual ~FastOpticalModel() = default;
+
+    /// Called before the sources from `first` to `end` (excluded) are
+    /// simulated, e.g. to look up their visibilities in bulk.
+    virtual void
+    prepareSources(std::size_t /* first */, std::size_t /* end */)
+    {}
+
+    /// Time the light of source `iSource` starts [ns] (for the trigger).
+    virtual double sourceStartTime(std::size_t iSource) const = 0;
+
+    /// Simulates the photons detected from source `iSource` (`photons` is
+    /// cleared first).
+    virtual void simulateSource(std::size_t iSource,
+                                FastOpticalRandom& rng,
+                                FastOpticalPhotons& photons) = 0;
+  }; // class FastOpticalModel
+
+  /**
+   * @brief Simulates the sources of an event with a model and stores the photons.
+   *
+   * In the serial mode, the photons are drawn from the random engines of the
+   * module. With `parallel`, the sources are simulated in blocks of
+   * `parallelBlockSize` in parallel threads, each block from its own random
+   * stream identified by the event seed (drawn from the photon engine) and by
+   * the block index, and the photons are stored in source order: the result
+   * does not depend on the number of threads (but differs from the serial
+   * one).
+   *
+   * With `aggregateLitePhotons`, the photons of each channel from each source
+   * are counted by tick (in the simulation threads) and each tick is stored
+   * with one addition to the lite photons and to the backtracking records,
+   * instead of one per photon.
+   *
+   * The sizes of the products are reported with `sim::reportFootprints()`,
+   * and with `storeProductFootprints` also put into the event (the module
+   * must declare that it produces `std::vector<sim::ProductFootprint>`).
+   *
+   * With an enabled trigger (`phot::PhotonTimeTrigger`), only the sources
+   * which may still add photons to a trigger window are simulated, and the
+   * simulation stops when the decision is known; the photons simulated until
+   * then are stored, and the backtracking records are made only for accepted
+   * events.
+   */
+  class FastOpticalEngine {
+  public:
+    struct Config_t {
+      unsigned int nOpChannels = 0U;
+      bool useLitePhotons = true;        ///< `sim::SimPhotonsLite` instead of `sim::SimPhotons`.
+      bool storeReflected = false;       ///< Whether reflected light is stored ("Reflected").
+      bool makeBTRs = true;              ///< Whether backtracking records are stored (lite only).
+      bool aggregateLitePhotons = false; ///< Whether to store lite photons by tick.
+      double directPhotonEnergy = 9.7e-6;    ///< Energy of direct `sim::OnePhoton` [MeV].
+      double reflectedPhotonEnergy = 2.9e-6; ///< Energy of reflected `sim::OnePhoton` [MeV].
+      std::size_t prepareBatchSize = 1024U; ///< Sources prepared at once (serial mode).
+      bool parallel = false;                ///< Whether to simulate in parallel.
+      std::size_t parallelBlockSize = 256U; ///< Sources sharing a random stream.
+      std::uint32_t streamKey = 0U;         ///< Key of the parallel random streams.
+      bool storeProductFootprints = false;  ///< Whether to put the product sizes in the event.
+    };
+
+    /// Counts of the last event.
+    struct Stats_t {
+      std::size_t sources = 0U;   ///< Sources in the event.
+      std::size_t simulated = 0U; ///< Sources actually simulated.
+      std::size_t skipped = 0U;   ///< Simulated sources returned with `simulated` unset.
+      unsigned long long directPhotons = 0U;
+      unsigned long long reflectedPhotons = 0U;
+    };
+
+    explicit FastOpticalEngine(Config_t const& config, PhotonTimeTrigger trigger = {});
+
+    /**
+     * @brief Simulates `nSources` sources with `model`, collecting the photons.
+     * @param photonEngine engine of the number of photons (and parallel seeds)
+     * @param scintTimeEngine engine of the photon times (serial mode)
+     */
+    void simulate(std::size_t nSources,
+                  FastOpticalModel& model,
+                  CLHEP::HepRandomEngine& photonEngine,
+                  CLHEP::HepRandomEngine& scintTimeEngine);
+
+    /// Puts the products of the event collected so far (reporting their size
+    /// as from `moduleLabel`), and clears them.
+    void put(art::Event& event, std::string const& moduleLabel);
+
+    PhotonTimeTrigger const&
+    trigger() const
+    {
+      return fTrigger;
+    }
+
+    Stats_t const&
+    stats() const
+    {
+      return fStats;
+    }
+
+  private:
+    Config_t const fConfig;
+    PhotonTimeTrigger fTrigger;
+    Stats_t fStats;
+
+    sim::SimPhotonsLiteBuilder fDirectLitePhotons;
+    sim::SimPhotonsLiteBuilder fReflectedLitePhotons;
+    sim::OpDetBacktrackerRecordAccumulator fDirectBTRs;
+    sim::OpDetBacktrackerRecordAccumulator fReflectedBTRs;
+    std::vector<sim::SimPhotons> fDirectPhotons;
+    std::vector<sim::SimPhotons> fReflectedPhotons;
+
+    std::vector<FastOpticalPhotons> fSources;     ///< Photons of a batch of sources.
+    std::vector<FastOpticalPhotons> fKept;        ///< Photons kept until the trigger decision.
+    std::vector<int> fTickCounts;                 ///< Scratch histogram of the serial mode.
+
+    /// Resets the photon collections for a new event.
+    void resetCollections();
+
+    /// Post-processes the photons of a source in its simulation thread.
+    void finishSource(FastOpticalPhotons& photons, std::vector<int>& tickCounts) const;
+
+    /// Handles the photons of a simulated source; returns whether to stop.
+    bool processSource(FastOpticalPhotons& photons);
+
+    /// Moves the photons of a source into the event collections.
+    void storeSource(FastOpticalPhotons const& photons, bool withBTRs);
+
+    /// Sorts `times` from `begin` to `end` (counting by tick if they are dense).
+    static void sortTimes(std::vector<int>& times,
+                          std::size_t begin,
+                          std::size_t end,
+                          std::vector<int>& tickCounts);
+
+  }; // class FastOpticalEngine
+
+} // namespace phot
+
+#endif // LARSIM_PHOTONPROPAGATION_FASTOPTICALENGINE_H
@@ -4,13 +4,15 @@
 #ifndef IPHOTONLIBRARY_H
 #define IPHOTONLIBRARY_H
 
+#include <algorithm> // std::copy_n()
 #include <vector>
 #include <cstddef> // size_t
 
-class TF1; // forward declaration
-
 namespace phot
 {
+  class PropagationTimeFunctions; // forward declaration
+  class PropagationTimeHistogramVoxel; // forward declaration
+
   /// Interface shared by all PhotonLibrary-like classes
   class IPhotonLibrary
   {
@@ -27,7 +29,11 @@ namespace phot
 
     /// Type for parametrization function
     /// (which is not part of this interface yet).
-    using Functions_t = TF1*;
+    using Functions_t = PropagationTimeFunctions const&;
+
+    /// Type for propagation time histograms
+    /// (which are not part of this interface yet).
+    using TimeHistograms_t = PropagationTimeHistogramVoxel const&;
 
 
     virtual ~IPhotonLibrary() = default;
@@ -36,11 +42,27 @@ namespace phot
     virtual float GetReflCount(size_t Voxel, size_t OpChannel) const = 0;
     virtual float GetReflT0(size_t Voxel, size_t OpChannel) const = 0;
 
-    /// Returns a pointer to NOpChannels() visibility values, one per channel
+    /**
+     * @brief Returns a pointer to NOpChannels() visibility values, one per channel
+     *
+     * Libraries which do not store the rows as they are (e.g.
+     * `PhotonLibraryQuantized`, `PhotonLibraryHybrid`) return a buffer private
+     * to the calling thread, which the next call of the same kind (direct,
+     * reflected, reflected timing) from that thread overwrites.
+     * Callers needing more than one row at a time copy them with
+     * `CopyCounts()` and `CopyReflCounts()`.
+     */
     virtual Counts_t GetCounts(size_t Voxel) const = 0;
     virtual Counts_t GetReflCounts(size_t Voxel) const = 0;
     virtual T0s_t    GetReflT0s(size_t Voxel) const = 0;
 
+    /// Writes the NOpChannels() visibilities of `Voxel` into `dest`;
+    /// returns `false` (and leaves `dest` alone) if there is no such row.
+    virtual bool CopyCounts(size_t Voxel, float* dest) const
+      { return copyRow(GetCounts(Voxel), dest); }
+    virtual bool CopyReflCounts(size_t Voxel, float* dest) const
+      { return copyRow(GetReflCounts(Voxel), dest); }
+
     /// Returns whether the current library deals with reflected light count.
     virtual bool hasReflected() const = 0;
 
@@ -55,6 +77,17 @@ namespace phot
 
     /// Returns the number of elements in the library
     size_t LibrarySize() const { return NVoxels() * NOpChannels(); }
+
+    /// Returns an estimate of the memory taken by the library data [bytes]
+    virtual size_t MemoryFootprint() const { return 0U; }
+
+  private:
+    bool copyRow(Counts_t row, float* dest) const
+      {
+        if (!row) return false;
+        std::copy_n(row, NOpChannels(), dest);
+        return true;
+      }
   };
 } // namespace
 
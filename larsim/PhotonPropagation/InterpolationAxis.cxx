@@ -0,0 +1,72 @@
+/**
+ * @file   larsim/PhotonPropagation/InterpolationAxis.cxx
+ * @brief  Nodes of a tabulated parameterisation, with fast interval lookup.
+ * @see    larsim/PhotonPropagation/InterpolationAxis.h
+ */
+
+#include "larsim/PhotonPropagation/InterpolationAxis.h"
+
+#include "cetlib_except/exception.h"
+
+// C/C++ standard libraries
+#include <algorithm> // std::lower_bound(), std::min()
+#include <cmath>     // std::abs(), std::ceil()
+#include <utility>   // std::move()
+
+namespace phot {
+
+  //------------------------------------------------------------
+  InterpolationAxis::InterpolationAxis(std::vector<double> nodes) : fNodes(std::move(nodes))
+  {
+    if (fNodes.size() < 2) {
+      throw cet::exception("InterpolationAxis")
+        << "At least two interpolation nodes are required (" << fNodes.size() << " given).\n";
+    }
+    for (std::size_t i = 1; i < fNodes.size(); ++i) {
+      if (fNodes[i] > fNodes[i - 1]) continue;
+      throw cet::exception("InterpolationAxis")
+        << "Interpolation nodes are not strictly increasing: node #" << i << " (" << fNodes[i]
+        << ") follows " << fNodes[i - 1] << ".\n";
+    }
+
+    // equally spaced nodes, within rounding
+    double const step = (fNodes.back() - fNodes.front()) / (fNodes.size() - 1);
+    double const tolerance = 1e-9 * step;
+    fUniform = true;
+    for (std::size_t i = 1; i < fNodes.size() - 1; ++i) {
+      if (std::abs(fNodes[i] - (fNodes.front() + i * step)) <= tolerance) continue;
+      fUniform = false;
+      break;
+    }
+    fInvStep = 1.0 / step;
+  } // InterpolationAxis::InterpolationAxis()
+
+  //------------------------------------------------------------
+  std::size_t
+  InterpolationAxis::uniformInterval(double x) const
+  {
+    double const pos = (x - fNodes.front()) * fInvStep;
+    if (!(pos > 0.0)) return 0; // below the first node
+
+    // the first interval whose upper node is not below `x`; the nodes are
+    // only equally spaced within rounding, so the guess is checked on them
+    std::size_t const last = fNodes.size() - 2;
+    std::size_t i = std::min(static_cast<std::size_t>(std::ceil(pos)) - 1, last);
+    while ((i > 0) && (x <= fNodes[i]))
+      --i;
+    while (x > fNodes[i + 1])
+      ++i;
+    return i;
+  } // InterpolationAxis::uniformInterval()
+
+  //------------------------------------------------------------
+  std::size_t
+  InterpolationAxis::searchInterval(double x) const
+  {
+    // upper node of the interval: the first node from #1 on not below `x`
+    auto const first = fNodes.begin() + 1;
+    auto const last = fNodes.end() - 1; // the last upper node is before this
+    return static_cast<std::size_t>(std::lower_bound(first, last, x) - first);
+  } // InterpolationAxis::searchInterval()
+
+} // namespace phot
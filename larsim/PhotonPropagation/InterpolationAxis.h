@@ -0,0 +1,143 @@
+/**
+ * @file   larsim/PhotonPropagation/InterpolationAxis.h
+ * @brief  Nodes of a tabulated parameterisation, with fast interval lookup.
+ * @see    larsim/PhotonPropagation/InterpolationAxis.cxx
+ *
+ * The semi-analytic light simulation describes its corrections with values
+ * tabulated on sorted sets of nodes (distances, angles...), linearly
+ * interpolated at the point of interest. An axis holds the nodes, finds the
+ * interval a point belongs to (directly when the nodes are equally spaced,
+ * with a binary search otherwise) and interpolates values stored with any
+ * stride, so that different parameters can share a single contiguous buffer.
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_INTERPOLATIONAXIS_H
+#define LARSIM_PHOTONPROPAGATION_INTERPOLATIONAXIS_H
+
+// C/C++ standard libraries
+#include <cstddef> // std::size_t
+#include <vector>
+
+namespace phot {
+
+  /**
+   * @brief Sorted nodes of a linear interpolation.
+   *
+   * The axis needs at least two strictly increasing nodes. The interval of a
+   * point `x` is the index `i` of the node starting it (`[ node(i), node(i+1) ]`)
+   * and is chosen as the historical `PDFastSimPAR` interpolation did: the
+   * first interval whose upper node is not smaller than `x`, the first one
+   * for points below the axis and the last one for points above its
+   * second-to-last node.
+   */
+  class InterpolationAxis {
+  public:
+    InterpolationAxis() = default;
+
+    /**
+     * @brief Creates an axis with the specified nodes.
+     * @throw cet::exception (category: `"InterpolationAxis"`) if there are
+     *        fewer than two nodes or they are not strictly increasing
+     */
+    explicit InterpolationAxis(std::vector<double> nodes);
+
+    /// Number of nodes.
+    std::size_t
+    size() const
+    {
+      return fNodes.size();
+    }
+
+    /// Returns whether the axis has no node.
+    bool
+    empty() const
+    {
+      return fNodes.empty();
+    }
+
+    /// Returns whether the nodes are equally spaced.
+    bool
+    isUniform() const
+    {
+      return fUniform;
+    }
+
+    /// Returns the node `i`.
+    double
+    operator[](std::size_t i) const
+    {
+      return fNodes[i];
+    }
+
+    /// Returns all the nodes.
+    std::vector<double> const&
+    nodes() const
+    {
+      return fNodes;
+    }
+
+    /// Returns the index of the interval used to interpolate at `x`.
+    std::size_t
+    interval(double x) const
+    {
+      std::size_t const last = fNodes.size() - 2;
+      if (x >= fNodes[last]) return last; // beyond right end
+      return fUniform ? uniformInterval(x) : searchInterval(x);
+    }
+
+    /**
+     * @brief Interpolates values tabulated on the nodes, in a given interval.
+     * @param i interval of `x` (see `interval()`)
+     * @param y value at the first node; the one at node `k` is `y[k * stride]`
+     * @param x point to interpolate at
+     * @param extrapolate whether to extrapolate beyond the interval
+     * @param stride distance between the values of consecutive nodes
+     *
+     * Without extrapolation, points outside the interval take the value at its
+     * lower node (on both sides, as the original implementation did).
+     * Finding the interval once allows interpolating many parameters at `x`.
+     */
+    double
+    interpolateInInterval(std::size_t i,
+                          double const* y,
+                          double x,
+                          bool extrapolate,
+                          std::size_t stride = 1U) const
+    {
+      return interpolateBetween(i, y[i * stride], y[(i + 1) * stride], x, extrapolate);
+    }
+
+    /// Interpolates at `x` in the interval `i`, given the values at its nodes.
+    double
+    interpolateBetween(std::size_t i, double yL, double yR, double x, bool extrapolate) const
+    {
+      double const xL = fNodes[i];
+      double const xR = fNodes[i + 1];
+      if (!extrapolate && ((x < xL) || (x > xR))) return yL;
+      double const dydx = (yR - yL) / (xR - xL); // gradient
+      return yL + dydx * (x - xL);
+    }
+
+    /// Interpolates at `x` values tabulated on the nodes (see above).
+    double
+    interpolate(double const* y, double x, bool extrapolate, std::size_t stride = 1U) const
+    {
+      return interpolateInInterval(interval(x), y, x, extrapolate, stride);
+    }
+
+  private:
+    std::vector<double> fNodes; ///< Interpolation nodes.
+    bool fUniform = false;      ///< Whether the nodes are equally spaced.
+    double fInvStep = 0.0;      ///< Inverse of the node spacing, if uniform.
+
+    /// Interval of `x` (below the second-to-last node) for uniform nodes.
+    std::size_t uniformInterval(double x) const;
+
+    /// Interval of `x` (below the second-to-last node) by binary search.
+    std::size_t searchInterval(double x) const;
+
+  }; // class InterpolationAxis
+
+} // namespace phot
+
+#endif // LARSIM_PHOTONPROPAGATION_INTERPOLATIONAXIS_H
@@ -0,0 +1,182 @@
+/**
+ * @file   larsim/PhotonPropagation/InverseCDFTable.cxx
+ * @brief  Tabulated inverse cumulative distributions for fast sampling.
+ * @see    larsim/PhotonPropagation/InverseCDFTable.h
+ */
+
+#include "larsim/PhotonPropagation/InverseCDFTable.h"
+
+#include "cetlib_except/exception.h"
+
+// C/C++ standard libraries
+#include <algorithm> // std::min(), std::max()
+#include <cstring>   // std::memcmp()
+#include <fstream>
+#include <utility> // std::move()
+
+namespace {
+
+  /// Identifier at the beginning of each table file.
+  constexpr char Magic[8] = {'L', 'A', 'R', 'I', 'C', 'D', 'F', '\0'};
+
+  /// Version of the table file format.
+  constexpr std::uint32_t FormatVersion = 1U;
+
+  template <typename T>
+  void
+  writeValue(std::ostream& out, T const& value)
+  {
+    out.write(reinterpret_cast<char const*>(&value), sizeof(T));
+  }
+
+  template <typename T>
+  void
+  writeVector(std::ostream& out, std::vector<T> const& data)
+  {
+    out.write(reinterpret_cast<char const*>(data.data()), data.size() * sizeof(T));
+  }
+
+  template <typename T>
+  bool
+  readValue(std::istream& in, T& value)
+  {
+    return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+  }
+
+  template <typename T>
+  bool
+  readVector(std::istream& in, std::vector<T>& data)
+  {
+    return bool(in.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(T)));
+  }
+
+} // local namespace
+
+namespace phot {
+
+  //------------------------------------------------------------
+  InverseCDFTable::InverseCDFTable(std::size_t nTables, std::size_t nQuantiles)
+    : fNQuantiles(nQuantiles)
+    , fFilled(nTables, 0)
+    , fLower(nTables, 0.0)
+    , fUpper(nTables, 0.0)
+    , fQuantiles(nTables * (nQuantiles + 1), 0.0f)
+  {
+    if (nQuantiles == 0) {
+      throw cet::exception("InverseCDFTable") << "At least one quantile interval is required.\n";
+    }
+  }
+
+  //------------------------------------------------------------
+  void
+  InverseCDFTable::fillFromCDF(std::size_t iTable,
+                               std::vector<double> const& cdf,
+                               double min,
+                               double max)
+  {
+    std::size_t const nSamples = cdf.size() - 1;
+    double const total = cdf.back();
+    float* q = fQuantiles.data() + iTable * (fNQuantiles + 1);
+
+    if (!(total > 0.0)) {
+      // no information: uniform distribution
+      for (std::size_t k = 0; k <= fNQuantiles; ++k)
+        q[k] = float(double(k) / fNQuantiles);
+    }
+    else {
+      // walk the cumulative function once, since the quantiles are sorted
+      std::size_t j = 0;
+      for (std::size_t k = 0; k <= fNQuantiles; ++k) {
+        double const target = total * k / fNQuantiles;
+        while ((j < nSamples - 1) && (cdf[j + 1] < target))
+          ++j;
+        double const binContent = cdf[j + 1] - cdf[j];
+        double const inBin = (binContent > 0.0) ? (target - cdf[j]) / binContent : 0.0;
+        double const frac = (j + std::min(std::max(inBin, 0.0), 1.0)) / nSamples;
+        q[k] = float(frac);
+      }
+      q[0] = 0.0f;
+      q[fNQuantiles] = 1.0f;
+    }
+
+    fLower[iTable] = min;
+    fUpper[iTable] = max;
+    fFilled[iTable] = 1;
+  }
+
+  //------------------------------------------------------------
+  void
+  InverseCDFTable::writeFile(std::string const& fileName, std::string const& key) const
+  {
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      throw cet::exception("InverseCDFTable")
+        << "Can't open '" << fileName << "' for writing.\n";
+    }
+
+    out.write(Magic, sizeof(Magic));
+    writeValue(out, FormatVersion);
+    writeValue(out, std::uint64_t(key.size()));
+    out.write(key.data(), key.size());
+    write(out);
+
+    if (!out) {
+      throw cet::exception("InverseCDFTable") << "Error while writing '" << fileName << "'.\n";
+    }
+  }
+
+  //------------------------------------------------------------
+  bool
+  InverseCDFTable::readFile(std::string const& fileName, std::string const& key)
+  {
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in) return false;
+
+    char magic[sizeof(Magic)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)) != 0)
+      return false;
+
+    std::uint32_t version = 0;
+    if (!readValue(in, version) || (version != FormatVersion)) return false;
+
+    std::uint64_t keySize = 0;
+    if (!readValue(in, keySize) || (keySize != key.size())) return false;
+    std::string fileKey(keySize, '\0');
+    if (!in.read(fileKey.data(), keySize) || (fileKey != key)) return false;
+
+    return read(in);
+  }
+
+  //------------------------------------------------------------
+  void
+  InverseCDFTable::write(std::ostream& out) const
+  {
+    writeValue(out, std::uint64_t(nTables()));
+    writeValue(out, std::uint64_t(fNQuantiles));
+    writeVector(out, fFilled);
+    writeVector(out, fLower);
+    writeVector(out, fUpper);
+    writeVector(out, fQuantiles);
+  }
+
+  //------------------------------------------------------------
+  bool
+  InverseCDFTable::read(std::istream& in)
+  {
+    std::uint64_t nTablesInFile = 0, nQuantilesInFile = 0;
+    if (!readValue(in, nTablesInFile) || (nTablesInFile != nTables())) return false;
+    if (!readValue(in, nQuantilesInFile) || (nQuantilesInFile != fNQuantiles)) return false;
+
+    // read into a copy, so that this table is untouched on failure
+    // (an empty default table has no quantile)
+    InverseCDFTable table =
+      (fNQuantiles > 0) ? InverseCDFTable(nTables(), fNQuantiles) : InverseCDFTable();
+    if (!readVector(in, table.fFilled) || !readVector(in, table.fLower) ||
+        !readVector(in, table.fUpper) || !readVector(in, table.fQuantiles))
+      return false;
+
+    *this = std::move(table);
+    return true;
+  }
+
+} // namespace phot
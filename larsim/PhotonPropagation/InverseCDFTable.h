@@ -0,0 +1,185 @@
+/**
+ * @file   larsim/PhotonPropagation/InverseCDFTable.h
+ * @brief  Tabulated inverse cumulative distributions for fast sampling.
+ * @see    larsim/PhotonPropagation/InverseCDFTable.cxx
+ *
+ * A set of one-dimensional distributions is stored as their inverse
+ * cumulative distribution functions, evaluated at equally spaced quantiles.
+ * Sampling a distribution then takes a single uniform random number, one
+ * table lookup and a linear interpolation, replacing e.g. `TF1::GetRandom()`.
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_INVERSECDFTABLE_H
+#define LARSIM_PHOTONPROPAGATION_INVERSECDFTABLE_H
+
+// C/C++ standard libraries
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace phot {
+
+  /**
+   * @brief Collection of distributions tabulated for inverse CDF sampling.
+   *
+   * The table holds `nTables()` distributions, each defined in its own range
+   * `[ lower(i), upper(i) ]`. Each distribution is described by the
+   * `nQuantiles() + 1` values of its inverse cumulative function at the
+   * quantiles `0, 1/nQuantiles(), ..., 1`, stored relative to its range in a
+   * single contiguous buffer.
+   *
+   * Distributions are filled individually (`fill()`), so that they can be
+   * created on demand; the whole table can be saved to and restored from a
+   * file, tagged with a key describing the configuration it was built from.
+   */
+  class InverseCDFTable {
+  public:
+    InverseCDFTable() = default;
+
+    /// Creates a table for `nTables` distributions, all still empty.
+    InverseCDFTable(std::size_t nTables, std::size_t nQuantiles);
+
+    /// Number of distributions in the table.
+    std::size_t
+    nTables() const
+    {
+      return fLower.size();
+    }
+
+    /// Number of quantile intervals describing each distribution.
+    std::size_t
+    nQuantiles() const
+    {
+      return fNQuantiles;
+    }
+
+    /// Returns whether the distribution `iTable` has been filled.
+    bool
+    isFilled(std::size_t iTable) const
+    {
+      return fFilled[iTable] != 0;
+    }
+
+    /// Lower limit of the distribution `iTable`.
+    double
+    lower(std::size_t iTable) const
+    {
+      return fLower[iTable];
+    }
+
+    /// Upper limit of the distribution `iTable`.
+    double
+    upper(std::size_t iTable) const
+    {
+      return fUpper[iTable];
+    }
+
+    /**
+     * @brief Tabulates the distribution `iTable` from its density.
+     * @param iTable index of the distribution to be filled
+     * @param pdf callable returning the (unnormalised) density at a point
+     * @param min lower limit of the distribution
+     * @param max upper limit of the distribution
+     * @param nSamples number of intervals the density is integrated in
+     *
+     * The density is sampled in `nSamples + 1` equally spaced points and
+     * integrated with the trapezoidal rule; the resulting cumulative function
+     * is linearly interpolated to find the tabulated quantiles.
+     * Negative densities are treated as zero; a null density yields a
+     * uniform distribution.
+     */
+    template <typename PDF>
+    void fill(std::size_t iTable, PDF&& pdf, double min, double max, std::size_t nSamples);
+
+    /// Returns the value of distribution `iTable` at quantile `u` (`[ 0, 1 ]`).
+    double
+    sample(std::size_t iTable, double u) const
+    {
+      double const pos = u * fNQuantiles;
+      std::size_t i = static_cast<std::size_t>(pos);
+      if (i >= fNQuantiles) i = fNQuantiles - 1;
+      float const* q = fQuantiles.data() + iTable * (fNQuantiles + 1);
+      double const frac = q[i] + (pos - i) * (q[i + 1] - q[i]);
+      return fLower[iTable] + frac * (fUpper[iTable] - fLower[iTable]);
+    }
+
+    /**
+     * @brief Writes the table into the specified file.
+     * @param fileName path of the file to be (over)written
+     * @param key string describing the configuration the table comes from
+     * @throw cet::exception (category: `"InverseCDFTable"`) on error
+     */
+    void writeFile(std::string const& fileName, std::string const& key) const;
+
+    /**
+     * @brief Replaces the content of the table with the one from a file.
+     * @param fileName path of the file to be read
+     * @param key expected configuration key
+     * @return whether the table was read
+     *
+     * The table is read only if the file exists, is valid, was created with
+     * the same `key` and has the same number of tables and quantiles as this
+     * one; otherwise, `false` is returned and the table is left unchanged.
+     */
+    bool readFile(std::string const& fileName, std::string const& key);
+
+    /// Writes the table (without file header) into a binary stream.
+    void write(std::ostream& out) const;
+
+    /**
+     * @brief Replaces the table with the one from `in` (as from `write()`).
+     * @return whether the table was read
+     *
+     * The table is read only if it has the same number of tables and
+     * quantiles as this one; otherwise, or on error, `false` is returned and
+     * the table is left unchanged.
+     */
+    bool read(std::istream& in);
+
+  private:
+    std::size_t fNQuantiles = 0U;       ///< Quantile intervals per distribution.
+    std::vector<std::uint8_t> fFilled;  ///< Whether each distribution is filled.
+    std::vector<double> fLower;         ///< Lower limit of each distribution.
+    std::vector<double> fUpper;         ///< Upper limit of each distribution.
+    std::vector<float> fQuantiles;      ///< Relative quantiles, table by table.
+
+    /// Stores the quantiles from `cdf`, sampled at equally spaced points.
+    void fillFromCDF(std::size_t iTable,
+                     std::vector<double> const& cdf,
+                     double min,
+                     double max);
+
+  }; // class InverseCDFTable
+
+} // namespace phot
+
+//------------------------------------------------------------------------------
+template <typename PDF>
+void
+phot::InverseCDFTable::fill(std::size_t iTable,
+                            PDF&& pdf,
+                            double min,
+                            double max,
+                            std::size_t nSamples)
+{
+  if (nSamples == 0) nSamples = 1;
+  double const dx = (max - min) / nSamples;
+
+  std::vector<double> cdf(nSamples + 1, 0.0);
+  double prev = pdf(min);
+  if (!(prev > 0.0)) prev = 0.0;
+  for (std::size_t i = 1; i <= nSamples; ++i) {
+    double f = pdf(min + i * dx);
+    if (!(f > 0.0)) f = 0.0;
+    cdf[i] = cdf[i - 1] + 0.5 * (prev + f) * dx;
+    prev = f;
+  }
+
+  fillFromCDF(iTable, cdf, min, max);
+}
+
+//------------------------------------------------------------------------------
+
+#endif // LARSIM_PHOTONPROPAGATION_INVERSECDFTABLE_H
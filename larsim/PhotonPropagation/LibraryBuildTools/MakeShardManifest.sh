@@ -0,0 +1,38 @@
+#!/bin/bash
+#
+# Writes the manifest of a distributed optical library build:
+# one line per shard with its first voxel, its number of voxels and the
+# name of its shard file (see larsim/PhotonPropagation/PhotonLibraryShard.h).
+#
+# Usage:
+#
+#   MakeShardManifest.sh NVoxels NVoxelsPerShard [FilePrefix] > shards.manifest
+#
+# The shard of grid process number N is the one on line N (counting from 0)
+# of the non-comment lines of the manifest.
+#
+
+if [ $# -lt 2 ]; then
+  echo "Usage: $0 NVoxels NVoxelsPerShard [FilePrefix]" 1>&2
+  exit 1
+fi
+
+NVoxels=$1
+NVoxelsPerShard=$2
+prefix=${3:-shard_}
+
+if [ "$NVoxelsPerShard" -le 0 ]; then
+  echo "ERROR: the number of voxels per shard must be positive." 1>&2
+  exit 1
+fi
+
+echo "# first voxel   number of voxels   shard file"
+shard=0
+first=0
+while [ $first -lt $NVoxels ]; do
+  n=$NVoxelsPerShard
+  [ $(( first + n )) -gt $NVoxels ] && n=$(( NVoxels - first ))
+  printf "%d %d %s%05d.bin\n" $first $n "$prefix" $shard
+  first=$(( first + n ))
+  shard=$(( shard + 1 ))
+done
@@ -0,0 +1,81 @@
+#!/bin/bash
+#
+# Runs one shard of a distributed optical library build.
+#
+# Usage (the shard is the one of the grid process, ${PROCESS}):
+#
+#   OpticalLibraryShard_Grid.sh Manifest BuildConfig OutputDir [NPhotonsPerVoxel]
+#
+# Manifest:    shard manifest, as written by MakeShardManifest.sh
+# BuildConfig: FHiCL configuration of the library building job
+#              (e.g. prodsingle_buildopticallibrary.fcl)
+# OutputDir:   directory where the shard files are collected
+#
+# The shard file is copied to the output directory under a temporary name
+# and then renamed, so that it is there only when complete. A shard whose
+# file is already present is not run again: to resume an interrupted build,
+# just submit again the same jobs (or only the missing ones, as listed by the
+# CombinePhotonLibraryShards module with `CheckOnly: true`).
+# When all the shards are present, they are combined into a binary library
+# by the CombinePhotonLibraryShards module.
+#
+
+umask 0002
+
+if [ $# -lt 3 ]; then
+  echo "Usage: $0 Manifest BuildConfig OutputDir [NPhotonsPerVoxel]" 1>&2
+  exit 1
+fi
+
+manifest=$1
+buildconfig=`readlink -f "$2"`
+outstage=`readlink -f "$3"`
+NPhotonsPerVoxel=${4:-30000}
+process=${PROCESS:?"the grid process number (PROCESS) is not set"}
+
+# The shard of this process is the line number ${process} of the manifest
+# (comments and empty lines excluded).
+shardline=`grep -v -e '^[[:space:]]*#' -e '^[[:space:]]*$' "$manifest" | sed -n "$(( process + 1 ))p"`
+if [ -z "$shardline" ]; then
+  echo "No shard for process $process in '$manifest': nothing to do."
+  exit 0
+fi
+read FirstVoxel NVoxels ShardFile <<< "$shardline"
+LastVoxel=$(( FirstVoxel + NVoxels - 1 ))
+ShardName=`basename "$ShardFile"`
+
+if [ -e "${outstage}/${ShardName}" ]; then
+  echo "Shard '${ShardName}' (voxels $FirstVoxel to $LastVoxel) is already done."
+  exit 0
+fi
+
+echo "This job will run from voxel $FirstVoxel to $LastVoxel, generating $NPhotonsPerVoxel in each"
+
+TMP=`mktemp -d ${_CONDOR_SCRATCH_DIR:-/var/tmp}/working_dir.XXXXXXXXXX`
+{ [[ -n "$TMP" ]] && [[ -d "$TMP" ]]; } || \
+  { echo "ERROR: unable to create temporary directory!" 1>&2; exit 1; }
+trap "[[ -n \"$TMP\" ]] && { cd ; rm -rf \"$TMP\"; }" 0
+cd $TMP
+
+cp "$buildconfig" thisjob.fcl || exit 1
+echo "physics.producers.generator.FirstVoxel: $FirstVoxel" >> thisjob.fcl
+echo "physics.producers.generator.LastVoxel: $LastVoxel" >> thisjob.fcl
+echo "physics.producers.generator.N: $NPhotonsPerVoxel" >> thisjob.fcl
+echo "services.PhotonVisibilityService.LibraryShardFile: \"${ShardName}\"" >> thisjob.fcl
+
+echo "Starting job"
+lar -c thisjob.fcl -n $NVoxels >& thisjob.log
+status=$?
+echo "Job completed with exit code $status"
+if [ $status -ne 0 ] || [ ! -e "$ShardName" ]; then
+  echo "ERROR: shard '${ShardName}' was not produced (see thisjob.log)." 1>&2
+  mkdir -p "${outstage}/logs" && cp thisjob.log "${outstage}/logs/${ShardName}.log"
+  exit 1
+fi
+
+mkdir -p "$outstage" || { echo "ERROR: can't create '$outstage'." 1>&2; exit 1; }
+cp "$ShardName" "${outstage}/${ShardName}.partial" \
+  && mv "${outstage}/${ShardName}.partial" "${outstage}/${ShardName}" \
+  || { echo "ERROR: failed to copy the shard to '$outstage'." 1>&2; exit 1; }
+
+exit 0
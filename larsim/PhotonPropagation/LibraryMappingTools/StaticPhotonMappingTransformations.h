@@ -0,0 +1,135 @@
+/**
+ * @file   larsim/PhotonPropagation/LibraryMappingTools/StaticPhotonMappingTransformations.h
+ * @brief  Statically dispatched access to photon mapping transformations.
+ * @see    `larsim/PhotonPropagation/LibraryMappingTools/IPhotonMappingTransformations.h`
+ *
+ * This is a header-only library.
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_LIBRARYMAPPINGTOOLS_STATICPHOTONMAPPINGTRANSFORMATIONS_H
+#define LARSIM_PHOTONPROPAGATION_LIBRARYMAPPINGTOOLS_STATICPHOTONMAPPINGTRANSFORMATIONS_H
+
+// LArSoft libraries
+#include "larsim/PhotonPropagation/LibraryMappingTools/IPhotonMappingTransformations.h"
+#include "larsim/PhotonPropagation/LibraryMappingTools/PhotonMappingIdentityTransformations.h"
+#include "larsim/PhotonPropagation/LibraryMappingTools/PhotonMappingXMirrorTransformations.h"
+
+// C++ standard libraries
+#include <cmath> // std::abs()
+#include <cstddef> // std::size_t
+#include <typeinfo>
+
+namespace phot {
+
+  /**
+   * @brief Access to the transformations of a mapping of known type.
+   * @tparam Mapping the type of the mapping transformation object
+   *
+   * The transformations used in the hot paths of the visibility queries are
+   * exposed as static functions taking the mapping object.
+   * In the general case they are plain (virtual) calls of the
+   * `phot::IPhotonMappingTransformations` interface; specializations for the
+   * mappings provided by LArSoft implement them without virtual calls, so
+   * that the compiler can inline them.
+   *
+   * The specializations must be used only with objects of exactly that type
+   * (not of a derived one, which might override the transformations):
+   * `phot::staticMappingTypeOf()` returns which one applies.
+   */
+  template <typename Mapping>
+  struct StaticPhotonMappingTransformations {
+
+    static geo::Point_t
+    detectorToLibrary(Mapping const& mapping, geo::Point_t const& location)
+    {
+      return mapping.detectorToLibrary(location);
+    }
+
+    static IPhotonMappingTransformations::LibraryIndex_t
+    opDetToLibraryIndex(Mapping const& mapping,
+                        geo::Point_t const& location,
+                        IPhotonMappingTransformations::OpDetID_t opDetID)
+    {
+      return mapping.opDetToLibraryIndex(location, opDetID);
+    }
+
+    static IPhotonMappingTransformations::OpDetToLibraryIndexMap const&
+    opDetsToLibraryIndices(Mapping const& mapping, geo::Point_t const& location)
+    {
+      return mapping.opDetsToLibraryIndices(location);
+    }
+
+    static std::size_t
+    libraryMappingSize(Mapping const& mapping, geo::Point_t const& location)
+    {
+      return mapping.libraryMappingSize(location);
+    }
+
+  }; // StaticPhotonMappingTransformations<>
+
+  /// Identity mapping: the library space is the detector space.
+  template <>
+  struct StaticPhotonMappingTransformations<PhotonMappingIdentityTransformations> {
+    using Mapping_t = PhotonMappingIdentityTransformations;
+
+    static geo::Point_t
+    detectorToLibrary(Mapping_t const&, geo::Point_t const& location)
+    {
+      return location;
+    }
+
+    static IPhotonMappingTransformations::LibraryIndex_t
+    opDetToLibraryIndex(Mapping_t const&,
+                        geo::Point_t const&,
+                        IPhotonMappingTransformations::OpDetID_t opDetID)
+    {
+      return IPhotonMappingTransformations::LibraryIndex_t{opDetID};
+    }
+
+    static IPhotonMappingTransformations::OpDetToLibraryIndexMap const&
+    opDetsToLibraryIndices(Mapping_t const& mapping, geo::Point_t const& location)
+    {
+      return mapping.Mapping_t::opDetsToLibraryIndices(location); // not virtual
+    }
+
+    static std::size_t
+    libraryMappingSize(Mapping_t const& mapping, geo::Point_t const& location)
+    {
+      return mapping.Mapping_t::libraryMappingSize(location); // not virtual
+    }
+
+  }; // StaticPhotonMappingTransformations<PhotonMappingIdentityTransformations>
+
+  /// Mirror at _x = 0_: same optical detector mapping as the identity.
+  template <>
+  struct StaticPhotonMappingTransformations<PhotonMappingXMirrorTransformations>
+    : StaticPhotonMappingTransformations<PhotonMappingIdentityTransformations> {
+
+    static geo::Point_t
+    detectorToLibrary(PhotonMappingXMirrorTransformations const&, geo::Point_t const& location)
+    {
+      return {std::abs(location.X()), location.Y(), location.Z()};
+    }
+
+  }; // StaticPhotonMappingTransformations<PhotonMappingXMirrorTransformations>
+
+  /// Mapping types with a `phot::StaticPhotonMappingTransformations` specialization.
+  enum class StaticMappingType_t {
+    Generic,  ///< Any other mapping (uses the virtual interface).
+    Identity, ///< `phot::PhotonMappingIdentityTransformations`
+    XMirror   ///< `phot::PhotonMappingXMirrorTransformations`
+  };
+
+  /// Returns which specialization applies to `mapping`.
+  inline StaticMappingType_t
+  staticMappingTypeOf(IPhotonMappingTransformations const& mapping)
+  {
+    std::type_info const& type = typeid(mapping);
+    if (type == typeid(PhotonMappingIdentityTransformations)) return StaticMappingType_t::Identity;
+    if (type == typeid(PhotonMappingXMirrorTransformations)) return StaticMappingType_t::XMirror;
+    return StaticMappingType_t::Generic;
+  }
+
+} // namespace phot
+
+#endif // LARSIM_PHOTONPROPAGATION_LIBRARYMAPPINGTOOLS_STATICPHOTONMAPPINGTRANSFORMATIONS_H
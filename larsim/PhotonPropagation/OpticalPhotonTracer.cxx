@@ -0,0 +1,287 @@
+/**
+ * @file   larsim/PhotonPropagation/OpticalPhotonTracer.cxx
+ * @brief  Optical photon tracing through the ROOT geometry, without Geant4.
+ * @see    larsim/PhotonPropagation/OpticalPhotonTracer.h
+ */
+
+#include "larsim/PhotonPropagation/OpticalPhotonTracer.h"
+
+// framework libraries
+#include "cetlib_except/exception.h"
+
+// ROOT
+#include "TGeoManager.h"
+#include "TGeoMaterial.h"
+#include "TGeoNavigator.h"
+#include "TGeoNode.h"
+#include "TGeoShape.h"
+#include "TGeoVolume.h"
+#include "TList.h"
+
+// CLHEP
+#include "CLHEP/Random/RandFlat.h"
+
+// C/C++ standard libraries
+#include <algorithm> // std::upper_bound()
+#include <cmath>
+#include <iterator> // std::prev()
+#include <utility>  // std::move()
+
+namespace {
+
+  /// Converts a photon `energy` [eV] into its wavelength [nm].
+  constexpr double
+  Wavelength(double energy)
+  {
+    return 1239.84193 / energy;
+  }
+
+  /// Distance a reflected photon is moved back from the boundary [cm].
+  constexpr double ReflectionBackStep = 1e-5;
+
+  /// A unit vector.
+  struct Direction_t {
+    double x, y, z;
+  };
+
+  /// Sets the direction of `nav` to `dir`.
+  void
+  setDirection(TGeoNavigator& nav, Direction_t const& dir)
+  {
+    double const d[3] = {dir.x, dir.y, dir.z};
+    nav.SetCurrentDirection(d);
+  }
+
+  /// Starts tracking from `point` (`double[3]`) in direction `dir`.
+  void
+  initTrack(TGeoNavigator& nav, double const* point, Direction_t const& dir)
+  {
+    double const d[3] = {dir.x, dir.y, dir.z};
+    nav.InitTrack(point, d);
+  }
+
+  /// Returns an isotropic direction.
+  Direction_t
+  isotropic(CLHEP::RandFlat& flat)
+  {
+    double const cosTheta = 2.0 * flat.fire() - 1.0;
+    double const sinTheta = std::sqrt(1.0 - cosTheta * cosTheta);
+    double const phi = 2.0 * M_PI * flat.fire();
+    return {sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta};
+  }
+
+  /// Returns the direction at polar angle `cosTheta` and random azimuth around `axis`.
+  Direction_t
+  rotated(Direction_t const& axis, double cosTheta, CLHEP::RandFlat& flat)
+  {
+    // an orthonormal basis (u, v, axis)
+    Direction_t u = (std::abs(axis.x) < 0.9) ? Direction_t{0.0, -axis.z, axis.y} :
+                                                 Direction_t{axis.z, 0.0, -axis.x};
+    double const uNorm = std::sqrt(u.x * u.x + u.y * u.y + u.z * u.z);
+    u = {u.x / uNorm, u.y / uNorm, u.z / uNorm};
+    Direction_t const v{
+      axis.y * u.z - axis.z * u.y, axis.z * u.x - axis.x * u.z, axis.x * u.y - axis.y * u.x};
+
+    double const sinTheta = std::sqrt(std::max(0.0, 1.0 - cosTheta * cosTheta));
+    double const phi = 2.0 * M_PI * flat.fire();
+    double const a = sinTheta * std::cos(phi), b = sinTheta * std::sin(phi);
+    return {a * u.x + b * v.x + cosTheta * axis.x,
+            a * u.y + b * v.y + cosTheta * axis.y,
+            a * u.z + b * v.z + cosTheta * axis.z};
+  }
+
+  /// Returns the direction after Rayleigh scattering (`1 + cos^2` distribution).
+  Direction_t
+  rayleighScattered(Direction_t const& dir, CLHEP::RandFlat& flat)
+  {
+    double cosTheta;
+    do {
+      cosTheta = 2.0 * flat.fire() - 1.0;
+    } while (2.0 * flat.fire() > 1.0 + cosTheta * cosTheta);
+    return rotated(dir, cosTheta, flat);
+  }
+
+} // local namespace
+
+namespace phot {
+
+  //----------------------------------------------------------------------------
+  OpticalPhotonTracer::Navigator::Navigator(TGeoManager& manager)
+    : fManager(manager), fNavigator(manager.AddNavigator())
+  {
+    if (!fNavigator) {
+      throw cet::exception("OpticalPhotonTracer")
+        << "Can't create a geometry navigator (is multithreaded navigation enabled?)\n";
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  OpticalPhotonTracer::Navigator::~Navigator()
+  {
+    fManager.RemoveNavigator(fNavigator); // this deletes the navigator
+  }
+
+  //----------------------------------------------------------------------------
+  OpticalPhotonTracer::OpticalPhotonTracer(TGeoManager& manager,
+                                           Config_t config,
+                                           OpDetFinder_t findOpDet)
+    : fManager(manager), fConfig(std::move(config)), fFindOpDet(std::move(findOpDet))
+  {
+    bool hasWLS = false;
+    for (TObject const* obj : *(fManager.GetListOfMaterials())) {
+      auto const material = dynamic_cast<TGeoMaterial const*>(obj);
+      if (!material) continue;
+      MaterialProperties_t props;
+      if (auto const iMedium = fConfig.media.find(material->GetName());
+          iMedium != fConfig.media.end()) {
+        props.medium = &(iMedium->second);
+        if (!props.medium->wlsAbsorptionLength.empty()) hasWLS = true;
+      }
+      if (auto const iSurface = fConfig.surfaces.find(material->GetName());
+          iSurface != fConfig.surfaces.end())
+        props.surface = &(iSurface->second);
+      if (props.medium || props.surface) fMaterials.emplace(material, props);
+    }
+
+    if (hasWLS && fConfig.wlsEmission.empty()) {
+      throw cet::exception("OpticalPhotonTracer")
+        << "Wavelength shifting media are configured without an emission spectrum.\n";
+    }
+
+    // cumulative of the emission spectrum, by trapezoids
+    double sum = 0.0, lastWeight = 0.0;
+    for (auto const& [energy, weight] : fConfig.wlsEmission) {
+      if (!fWLSEnergies.empty())
+        sum += (energy - fWLSEnergies.back()) * (weight + lastWeight) / 2.0;
+      fWLSEnergies.push_back(energy);
+      fWLSCumulative.push_back(sum);
+      lastWeight = weight;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  OpticalPhotonTracer::Detection_t
+  OpticalPhotonTracer::trace(Navigator& navigator,
+                             geo::Point_t const& start,
+                             geo::Vector_t const& startDir,
+                             double energy,
+                             CLHEP::HepRandomEngine& engine) const
+  {
+    CLHEP::RandFlat flat(engine);
+    TGeoNavigator& nav = navigator.get();
+
+    Direction_t dir{startDir.X(), startDir.Y(), startDir.Z()};
+    double const point[3] = {start.X(), start.Y(), start.Z()};
+    initTrack(nav, point, dir);
+
+    enum class Interaction_t { none, absorption, scattering, shifting };
+
+    for (unsigned int iStep = 0; iStep < fConfig.maxSteps; ++iStep) {
+      TGeoNode const* node = nav.GetCurrentNode();
+      if (!node || nav.IsOutside()) return {};
+      MaterialProperties_t const props = properties(node->GetVolume()->GetMaterial());
+      if (!props.medium) return {}; // photons don't travel here
+
+      // distance to the next interaction in the medium, and which one it is
+      Interaction_t interaction = Interaction_t::none;
+      double distance = TGeoShape::Big();
+      auto const sampleDistance = [&](Spectrum_t const& lengths, Interaction_t which) {
+        if (lengths.empty()) return;
+        double const d = -interpolate(lengths, energy) * std::log(flat.fire());
+        if (d >= distance) return;
+        distance = d;
+        interaction = which;
+      };
+      sampleDistance(props.medium->absorptionLength, Interaction_t::absorption);
+      sampleDistance(props.medium->rayleighLength, Interaction_t::scattering);
+      sampleDistance(props.medium->wlsAbsorptionLength, Interaction_t::shifting);
+
+      TGeoNode const* next = nav.FindNextBoundaryAndStep(distance);
+
+      if (!nav.IsOnBoundary()) {
+        // interaction before reaching the boundary
+        switch (interaction) {
+        case Interaction_t::scattering: dir = rayleighScattered(dir, flat); break;
+        case Interaction_t::shifting:
+          energy = sampleWLSEnergy(engine);
+          dir = isotropic(flat);
+          break;
+        case Interaction_t::absorption:
+        case Interaction_t::none: return {};
+        } // switch
+        setDirection(nav, dir);
+        continue;
+      }
+
+      if (!next || nav.IsOutside()) return {}; // left the world
+
+      double const* boundary = nav.GetCurrentPoint();
+      int const opDet = fFindOpDet(geo::Point_t{boundary[0], boundary[1], boundary[2]}, *next);
+      if (opDet >= 0) return {opDet, Wavelength(energy) > 200.0};
+
+      MaterialProperties_t const nextProps = properties(next->GetVolume()->GetMaterial());
+      if (nextProps.medium) continue; // no refraction between media
+
+      if (!nextProps.surface) return {};
+      Surface_t const& surface = *nextProps.surface;
+      if (flat.fire() >= interpolate(surface.reflectance, energy)) return {}; // absorbed
+
+      // normal of the surface just crossed, pointing back into the medium
+      double const* normal = nav.FindNormal(false);
+      if (!normal) return {};
+      Direction_t n{normal[0], normal[1], normal[2]};
+      double const dirDotN = dir.x * n.x + dir.y * n.y + dir.z * n.z;
+      if (dirDotN > 0.0) n = {-n.x, -n.y, -n.z};
+
+      double const backPoint[3] = {boundary[0] - ReflectionBackStep * dir.x,
+                                   boundary[1] - ReflectionBackStep * dir.y,
+                                   boundary[2] - ReflectionBackStep * dir.z};
+      if (!surface.diffuseFraction.empty() &&
+          (flat.fire() < interpolate(surface.diffuseFraction, energy))) {
+        // Lambertian reflection
+        dir = rotated(n, std::sqrt(flat.fire()), flat);
+      }
+      else {
+        double const dn = std::abs(dirDotN);
+        dir = {dir.x + 2.0 * dn * n.x, dir.y + 2.0 * dn * n.y, dir.z + 2.0 * dn * n.z};
+      }
+      initTrack(nav, backPoint, dir);
+    } // for steps
+
+    return {}; // too many steps: photon dropped
+  }
+
+  //----------------------------------------------------------------------------
+  OpticalPhotonTracer::MaterialProperties_t
+  OpticalPhotonTracer::properties(TGeoMaterial const* material) const
+  {
+    auto const iMaterial = fMaterials.find(material);
+    return (iMaterial == fMaterials.end()) ? MaterialProperties_t{} : iMaterial->second;
+  }
+
+  //----------------------------------------------------------------------------
+  double
+  OpticalPhotonTracer::sampleWLSEnergy(CLHEP::HepRandomEngine& engine) const
+  {
+    if (fWLSEnergies.size() == 1 || fWLSCumulative.back() <= 0.0) return fWLSEnergies.front();
+    double const u = CLHEP::RandFlat::shoot(&engine, fWLSCumulative.back());
+    auto const iUpper = std::upper_bound(fWLSCumulative.begin(), fWLSCumulative.end(), u);
+    if (iUpper == fWLSCumulative.end()) return fWLSEnergies.back();
+    std::size_t const i = iUpper - fWLSCumulative.begin();
+    double const f = (u - fWLSCumulative[i - 1]) / (fWLSCumulative[i] - fWLSCumulative[i - 1]);
+    return fWLSEnergies[i - 1] + f * (fWLSEnergies[i] - fWLSEnergies[i - 1]);
+  }
+
+  //----------------------------------------------------------------------------
+  double
+  OpticalPhotonTracer::interpolate(Spectrum_t const& spectrum, double energy)
+  {
+    auto const iUpper = spectrum.upper_bound(energy);
+    if (iUpper == spectrum.begin()) return iUpper->second;
+    auto const iLower = std::prev(iUpper);
+    if (iUpper == spectrum.end()) return iLower->second;
+    double const f = (energy - iLower->first) / (iUpper->first - iLower->first);
+    return iLower->second + f * (iUpper->second - iLower->second);
+  }
+
+} // namespace phot
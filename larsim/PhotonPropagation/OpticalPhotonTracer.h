@@ -0,0 +1,171 @@
+/**
+ * @file   larsim/PhotonPropagation/OpticalPhotonTracer.h
+ * @brief  Optical photon tracing through the ROOT geometry, without Geant4.
+ * @see    larsim/PhotonPropagation/OpticalPhotonTracer.cxx
+ *
+ * The tracer is used to build photon libraries (`TracePhotonLibrary` module)
+ * following only the optical photons, which is what a library build with
+ * `LightSource` and `LArG4` spends almost all of its time on.
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_OPTICALPHOTONTRACER_H
+#define LARSIM_PHOTONPROPAGATION_OPTICALPHOTONTRACER_H
+
+// LArSoft libraries
+#include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h" // geo::Point_t, geo::Vector_t
+
+// C/C++ standard libraries
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// forward declarations
+class TGeoManager;
+class TGeoMaterial;
+class TGeoNavigator;
+class TGeoNode;
+namespace CLHEP {
+  class HepRandomEngine;
+}
+
+namespace phot {
+
+  /**
+   * @brief Traces optical photons through the detector geometry.
+   *
+   * Photons are followed through the ROOT geometry (the one the geometry
+   * service reads from the GDML description, e.g. after `simplifyGDML`) with
+   * a simplified model of the optical physics of `LArG4`:
+   *
+   * * in the _optical media_ (the materials with optical properties) photons
+   *   can be absorbed, scattered (Rayleigh) or absorbed and re-emitted by a
+   *   wavelength shifter, each process with its own energy-dependent
+   *   attenuation length; shifted photons are emitted isotropically, with an
+   *   energy sampled from the emission spectrum of the shifter;
+   * * moving into another optical medium, photons go on undisturbed (there
+   *   is no refraction);
+   * * entering an optical detector, photons are detected;
+   * * entering any other volume, photons are reflected with the reflectance
+   *   of that material, diffusely or specularly according to its diffuse
+   *   fraction, or absorbed (like in `larg4::OpBoundaryProcessSimple`).
+   *
+   * Detected photons with wavelength longer than 200 nm are reported as
+   * reflected (visible) light, with the same criterion as
+   * `larg4::OpDetSensitiveDetector`.
+   *
+   * Tracing is thread-safe, as long as each thread uses its own navigator
+   * (`Navigator` class) and random engine; for that, the ROOT geometry
+   * manager must have been set up for multithreaded navigation
+   * (`TGeoManager::SetMaxThreads()`).
+   */
+  class OpticalPhotonTracer {
+  public:
+    /// Energy-dependent property: (photon energy [eV], value).
+    using Spectrum_t = std::map<double, double>;
+
+    /// Optical properties of a medium.
+    struct Medium_t {
+      Spectrum_t absorptionLength;    ///< Absorption length [cm] (none: no absorption).
+      Spectrum_t rayleighLength;      ///< Rayleigh scattering length [cm] (none: no scattering).
+      Spectrum_t wlsAbsorptionLength; ///< Wavelength shifting length [cm] (none: no shifting).
+    };
+
+    /// Optical properties of the surface of a (non-medium) material.
+    struct Surface_t {
+      Spectrum_t reflectance;     ///< Fraction of reflected photons.
+      Spectrum_t diffuseFraction; ///< Fraction of the reflections which are diffuse.
+    };
+
+    struct Config_t {
+      std::map<std::string, Medium_t> media;     ///< Optical media, by material name.
+      std::map<std::string, Surface_t> surfaces; ///< Reflecting surfaces, by material name.
+      Spectrum_t wlsEmission; ///< Emission spectrum of the wavelength shifter (relative).
+      /// Photons are dropped after this many steps (interactions and crossings).
+      unsigned int maxSteps = 1000U;
+    };
+
+    /// Returns the optical detector including `point` in the volume of `node` (`-1`: none).
+    using OpDetFinder_t = std::function<int(geo::Point_t const& point, TGeoNode const& node)>;
+
+    /// Outcome of the tracing of a photon.
+    struct Detection_t {
+      int opDet = -1;         ///< Optical detector that detected the photon (`-1`: none).
+      bool reflected = false; ///< Whether the photon was detected as visible light.
+    };
+
+    /// A ROOT navigator for the calling thread, removed on destruction.
+    class Navigator {
+    public:
+      explicit Navigator(TGeoManager& manager);
+      ~Navigator();
+      Navigator(Navigator const&) = delete;
+      Navigator& operator=(Navigator const&) = delete;
+
+      TGeoNavigator&
+      get() const
+      {
+        return *fNavigator;
+      }
+
+    private:
+      TGeoManager& fManager;
+      TGeoNavigator* fNavigator = nullptr;
+    };
+
+    /// Sets up the tracer on the geometry of `manager`.
+    OpticalPhotonTracer(TGeoManager& manager, Config_t config, OpDetFinder_t findOpDet);
+
+    /**
+     * @brief Traces a single photon.
+     * @param navigator the navigator of the calling thread
+     * @param start starting point of the photon [cm]
+     * @param dir starting direction of the photon (unit vector)
+     * @param energy energy of the photon [eV]
+     * @param engine random engine
+     * @return where the photon was detected, if it was
+     */
+    Detection_t trace(Navigator& navigator,
+                      geo::Point_t const& start,
+                      geo::Vector_t const& dir,
+                      double energy,
+                      CLHEP::HepRandomEngine& engine) const;
+
+    /// Returns the geometry manager the photons are traced through.
+    TGeoManager&
+    manager() const
+    {
+      return fManager;
+    }
+
+  private:
+    /// Optical properties of a material of the geometry.
+    struct MaterialProperties_t {
+      Medium_t const* medium = nullptr;   ///< Properties as a medium (if it is one).
+      Surface_t const* surface = nullptr; ///< Properties as a surface (if it is one).
+    };
+
+    TGeoManager& fManager;
+    Config_t const fConfig;
+    OpDetFinder_t const fFindOpDet;
+
+    /// Properties of each geometry material with optical properties.
+    std::map<TGeoMaterial const*, MaterialProperties_t> fMaterials;
+
+    /// Energies and cumulative distribution of `wlsEmission`, for sampling it.
+    std::vector<double> fWLSEnergies, fWLSCumulative;
+
+    /// Returns the properties of `material` (all null if it has none).
+    MaterialProperties_t properties(TGeoMaterial const* material) const;
+
+    /// Samples the energy of a photon emitted by the wavelength shifter [eV].
+    double sampleWLSEnergy(CLHEP::HepRandomEngine& engine) const;
+
+    /// Returns the value of `spectrum` at `energy` (linear interpolation).
+    static double interpolate(Spectrum_t const& spectrum, double energy);
+
+  }; // class OpticalPhotonTracer
+
+} // namespace phot
+
+#endif // LARSIM_PHOTONPROPAGATION_OPTICALPHOTONTRACER_H
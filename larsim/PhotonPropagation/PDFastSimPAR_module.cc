@@ -24,6 +24,17 @@
 //  of the Geant4 step for a given optical channel.
 //  - other photon information is got from 'sim::SimEnergyDeposits'
 //  - add 'sim::OpDetBacktrackerRecord' to event
+// With a `TimeTrigger` configuration (the parameters of
+// `FilterSimPhotonLiteTime`), only the trigger decision is sought: the photons
+// in the trigger windows are counted as the deposits are simulated, and the
+// simulation stops when a window collects enough photons, or when no remaining
+// deposit can be detected within a window. The photons simulated until then
+// are stored, so that the filter takes the same decision, and the backtracking
+// records are made only for the accepted events.
+// The event loop, the trigger and the output are the ones of
+// `phot::FastOpticalEngine`, this module providing the photons of each deposit.
+// With `CompactEnergyDeposits`, `SimulationLabel` is read as a
+// `sim::CompactSimEnergyDeposits` (see `IonAndScint`).
 // Aug. 19 by Mu Wei
 ////////////////////////////////////////////////////////////////////////
 
@@ -49,15 +60,23 @@
 #include "larcorealg/Geometry/CryostatGeo.h"
 #include "larcorealg/Geometry/OpDetGeo.h"
 #include "larcorealg/Geometry/geo_vectors_utils.h"         // geo::vect::fillCoords()
-#include "larcorealg/Geometry/geo_vectors_utils_TVector.h" // geo::vect::toTVector3()
 #include "lardata/DetectorInfoServices/LArPropertiesService.h"
 #include "lardataobj/Simulation/OpDetBacktrackerRecord.h"
 #include "lardataobj/Simulation/SimEnergyDeposit.h"
 #include "lardataobj/Simulation/SimPhotons.h"
+#include "larsim/PhotonPropagation/FastOpticalEngine.h"
+#include "larsim/PhotonPropagation/InterpolationAxis.h"
+#include "larsim/PhotonPropagation/InverseCDFTable.h"
+#include "larsim/PhotonPropagation/PhotonTimeTrigger.h"
 #include "larsim/PhotonPropagation/PhotonVisibilityTypes.h" // phot::MappedT0s_t
 #include "larsim/PhotonPropagation/ScintTimeTools/ScintTime.h"
+#include "larsim/PhotonPropagation/SolidAngleGrid.h"
 
 #include "larsim/IonizationScintillation/ISTPC.h"
+#include "larsim/Simulation/ProductFootprint.h"
+#include "larsim/Simulation/ReadSimEnergyDeposits.h"
+#include "larsim/Utils/CounterBasedRandomEngine.h"
+#include "larsim/Utils/TraceZones.h"
 
 // Random numbers
 #include "CLHEP/Random/RandFlat.h"
@@ -90,10 +109,20 @@
 #include "TVector3.h"
 #include "TF1.h"
 
+#include "tbb/enumerable_thread_specific.h"
+
+#include <algorithm> // std::sort()
+#include <array>
 #include <cassert>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstring> // std::memcmp(), std::memcpy()
 #include <ctime>
+#include <fstream>
+#include <iterator> // std::distance()
+#include <numeric>  // std::iota()
+#include <sstream>
 
 #include "boost/math/special_functions/ellint_1.hpp"
 #include "boost/math/special_functions/ellint_3.hpp"
@@ -250,10 +279,70 @@ namespace {
     return false;
   }
 
+  //......................................................................
+  // returns `table[i][j]` of the configuration parameter `name`, which
+  // must be large enough for the parameterisation it describes
+  double
+  parameterAt(std::vector<std::vector<double>> const& table, size_t i, size_t j, std::string const& name)
+  {
+    if (i >= table.size() || j >= table[i].size()) {
+      throw cet::exception("PDFastSimPAR")
+        << "Parameter '" << name << "' has no element [" << i << "][" << j << "].\n";
+    }
+    return table[i][j];
+  }
+
+  double
+  parameterAt(std::vector<std::vector<std::vector<double>>> const& table,
+              size_t i, size_t j, size_t k, std::string const& name)
+  {
+    if (i >= table.size() || j >= table[i].size() || k >= table[i][j].size()) {
+      throw cet::exception("PDFastSimPAR")
+        << "Parameter '" << name << "' has no element [" << i << "][" << j << "][" << k << "].\n";
+    }
+    return table[i][j][k];
+  }
+
+  //......................................................................
+  // flattens `nPars` parameters tabulated on `nBins` bins and `nNodes`
+  // interpolation nodes into a contiguous buffer, with the parameters of one
+  // node adjacent: `[bin][node][parameter]`; `value(bin, node, parameter)`
+  // returns each of them
+  template <typename Value>
+  std::vector<double>
+  flattenParameters(size_t nBins, size_t nNodes, size_t nPars, Value value)
+  {
+    std::vector<double> flat;
+    flat.reserve(nBins * nNodes * nPars);
+    for (size_t bin = 0; bin < nBins; ++bin)
+      for (size_t node = 0; node < nNodes; ++node)
+        for (size_t par = 0; par < nPars; ++par)
+          flat.push_back(value(bin, node, par));
+    return flat;
+  }
+
+  //......................................................................
+  // file of the initialisation snapshot: header, then the VUV timing tables
+  // and the solid angle grids, in the order they are prepared
+  constexpr char SnapshotMagic[8] = {'L', 'A', 'R', 'P', 'A', 'R', 'S', '\0'};
+  constexpr std::uint32_t SnapshotVersion = 1U;
+
+  // FNV-1a digest of the bytes of a sequence of values
+  struct Digest {
+    std::uint64_t value = 14695981039346656037ULL;
+    template <typename T>
+    void add(T const& data)
+    {
+      unsigned char bytes[sizeof(T)];
+      std::memcpy(bytes, &data, sizeof(T));
+      for (unsigned char const byte : bytes) value = (value ^ byte) * 1099511628211ULL;
+    }
+  };
+
 } // namespace
 
 namespace phot {
-  class PDFastSimPAR : public art::EDProducer {
+  class PDFastSimPAR : public art::EDProducer, private FastOpticalModel {
   public:
 
   // Define the fhicl configuration 
@@ -264,6 +353,7 @@ namespace phot {
       using ODP = fhicl::OptionalDelegatedParameter;
 
       fhicl::Atom<art::InputTag> SimulationLabel  { Name("SimulationLabel"),  Comment("SimEnergyDeposit label.") };
+      fhicl::Atom<bool>          CompactEnergyDeposits { Name("CompactEnergyDeposits"), Comment("SimulationLabel is a sim::CompactSimEnergyDeposits, default false"), false };
       fhicl::Atom<bool>          DoFastComponent  { Name("DoFastComponent"),  Comment("Simulate slow scintillation light, default true"), true };
       fhicl::Atom<bool>          DoSlowComponent  { Name("DoSlowComponent"),  Comment("Simulate slow scintillation light") };
       fhicl::Atom<bool>          DoReflectedLight { Name("DoReflectedLight"), Comment("Simulate reflected visible light") };
@@ -271,6 +361,8 @@ namespace phot {
       fhicl::Atom<bool>          IncludePropTime  { Name("IncludePropTime"),  Comment("Simulate light propagation time") };
       fhicl::Atom<bool>          GeoPropTimeOnly  { Name("GeoPropTimeOnly"),  Comment("Simulate light propagation time geometric approximation, default false"), false };
       fhicl::Atom<bool>          UseLitePhotons   { Name("UseLitePhotons"),   Comment("Store SimPhotonsLite/OpDetBTRs instead of SimPhotons") };
+      fhicl::Atom<bool>          AggregateLitePhotons { Name("AggregateLitePhotons"), Comment("Histogram SimPhotonsLite/OpDetBTR photons by tick before storing them, default false"), false };
+      fhicl::Atom<bool>          StoreProductFootprints { Name("StoreProductFootprints"), Comment("Put the sizes of the output products into the event, default false"), false };
       fhicl::Atom<bool>          OpaqueCathode    { Name("OpaqueCathode"),    Comment("Photons cannot cross the cathode") };
       fhicl::Atom<bool>          OnlyActiveVolume { Name("OnlyActiveVolume"), Comment("PAR fast sim usually only for active volume, default true"), true };
       fhicl::Atom<bool>          OnlyOneCryostat  { Name("OnlyOneCryostat"),  Comment("Set to true if light is only supported in C:1") };
@@ -278,7 +370,19 @@ namespace phot {
       ODP                        VUVTiming        { Name("VUVTiming"),        Comment("Configuration for UV timing parameterization")}; 
       ODP                        VISTiming        { Name("VISTiming"),        Comment("Configuration for visible timing parameterization")}; 
       DP                         VUVHits          { Name("VUVHits"),          Comment("Configuration for UV visibility parameterization")}; 
+      fhicl::Atom<unsigned int>  VUVTimingTableSize  { Name("VUVTimingTableSize"),  Comment("Quantiles tabulated for each VUV timing parameterization, default 1024"), 1024 };
+      fhicl::Atom<bool>          PrecomputeVUVTiming { Name("PrecomputeVUVTiming"), Comment("Tabulate all VUV timing parameterizations at beginJob, default false"), false };
+      fhicl::Atom<bool>          ParallelDeposits    { Name("ParallelDeposits"),    Comment("Simulate energy deposits in parallel threads, default false"), false };
+      fhicl::Atom<unsigned int>  ParallelBlockSize   { Name("ParallelBlockSize"),   Comment("Deposits sharing a random stream in parallel mode, default 256"), 256 };
+      fhicl::Atom<std::string>   VUVTimingCache      { Name("VUVTimingCache"),      Comment("File caching the VUV timing tables (created if missing), default none"), "" };
+      fhicl::Atom<bool>          UseSolidAngleGrid       { Name("UseSolidAngleGrid"),       Comment("Interpolate optical detector solid angles from precomputed grids, default false"), false };
+      fhicl::Atom<unsigned int>  SolidAngleGridPoints    { Name("SolidAngleGridPoints"),    Comment("Nodes on each axis of the solid angle grids, default 128"), 128 };
+      fhicl::Atom<double>        SolidAngleGridTolerance { Name("SolidAngleGridTolerance"), Comment("Largest relative interpolation error of the solid angle grids, default 1e-3"), 1e-3 };
+      fhicl::Atom<std::string>   SolidAngleGridCache     { Name("SolidAngleGridCache"),     Comment("File caching the solid angle grids (created if missing), default none"), "" };
+      fhicl::Atom<std::string>   InitializationSnapshot  { Name("InitializationSnapshot"),  Comment("File with the VUV timing tables and solid angle grids of this configuration and geometry (created if missing or stale), default none"), "" };
+      fhicl::Atom<double>        ExpectedPhotonThreshold { Name("ExpectedPhotonThreshold"), Comment("Skip optical detectors whose approximate bound on the direct photons (solid angle and largest Gaisser-Hillas correction) is below this number; culled detectors skip their random draws, default 0 (none)"), 0. };
       ODP                        VISHits          { Name("VISHits"),          Comment("Configuration for visibile visibility parameterization")}; 
+      ODP                        TimeTrigger      { Name("TimeTrigger"),      Comment("Stop at the decision of FilterSimPhotonLiteTime with this configuration, default none")}; 
 
       
 
@@ -286,6 +390,7 @@ namespace phot {
     using Parameters = art::EDProducer::Table<Config>;
 
     explicit PDFastSimPAR(Parameters const & config);
+    void beginJob() override;
     void produce(art::Event&) override;
 
   private:
@@ -301,63 +406,125 @@ namespace phot {
       geo::Point_t OpDetPoint;
       int type;
       int orientation;
+      SolidAngleGrid const* solidAngleGrid; // tabulated solid angle (if any)
+    };
+
+    // random number generators used in the simulation of a deposit
+    using RandomEngines = FastOpticalRandom;
+
+    // number of photons detected by each channel from one deposit;
+    // buffers are reused from one deposit to the next
+    struct DetectedHits {
+      std::vector<int> fast, slow;             // direct light
+      std::vector<int> anodeFast, anodeSlow;   // direct light reflected by the anode
+      std::vector<int> reflFast, reflSlow;     // reflected (visible) light
+      std::vector<size_t> direct, reflected;   // channels with detected photons
+      std::vector<double> transport_time;      // propagation times of one channel
+      std::vector<double> emission_time;       // scintillation times of one channel
+      std::vector<size_t> candidates;          // detectors possibly seeing direct light
+      std::vector<double> visCorrections;      // VIS correction of each table and angle bin
+      std::vector<double> visSmearing;         // VIS timing cut-off and tau of each angle bin
+
+      void reset(size_t nOpDets)
+      {
+        for (auto* v: { &fast, &slow, &anodeFast, &anodeSlow, &reflFast, &reflSlow })
+          v->assign(nOpDets, 0);
+        direct.clear();
+        reflected.clear();
+      }
     };
 
     void Initialization();
 
-    void getVUVTimes(std::vector<double>& arrivalTimes, const double distance_in_cm, const size_t angle_bin);
+    // creates or loads the VUV timing tables and the solid angle grids;
+    // they are read from `snapshot` if not null, and return whether they were
+    bool prepareVUVTimingTables(std::istream* snapshot);
+    bool prepareSolidAngleGrids(std::istream* snapshot);
+
+    // initialisation snapshot (`InitializationSnapshot`): the key describes
+    // the configuration and the geometry the generated state depends on;
+    // opening checks the header and leaves `in` at the first section
+    std::string initSnapshotKey() const;
+    bool openInitSnapshot(std::ifstream& in) const;
+    void writeInitSnapshot() const;
+
+    // detector description for the solid angle functions
+    OpticalDetector opticalDetector(size_t OpDet) const;
+
+    // fills the grid of optical detector centres used to skip far detectors
+    void buildOpDetGrid();
+    // largest Gaisser-Hillas correction (with border and transparency) in the detector
+    double maxGHCorrection() const;
+    // puts into `OpDets` (sorted) the detectors which may see direct light
+    // from `NumPhotons` photons emitted at `ScintPoint`
+    void selectOpDets(geo::Point_t const& ScintPoint, double NumPhotons, std::vector<size_t>& OpDets) const;
+
+    // FastOpticalModel interface: the sources are the energy deposits
+    double sourceStartTime(size_t iDep) const override { return (*fEdeps)[iDep].StartT(); }
+    // simulates the photons detected from deposit `iDep`
+    void simulateSource(size_t iDep, FastOpticalRandom& rng, FastOpticalPhotons& dep) override;
+
+    // returns the scintillation time tool of the calling thread
+    ScintTime& scintTimeTool();
+
+    void getVUVTimes(std::vector<double>& arrivalTimes, const double distance_in_cm, const size_t angle_bin, RandomEngines& rng);
     void getVUVTimesGeo(std::vector<double>& arrivalTimes, const double distance_in_cm);
-    void getVISTimes(std::vector<double>& arrivalTimes, const TVector3 &ScintPoint, const TVector3 &OpDetPoint);
+    void getVISTimes(std::vector<double>& arrivalTimes, geo::Point_t const& ScintPoint, geo::Point_t const& OpDetPoint,
+                     double const* smearing, RandomEngines& rng);
+    // fills `smearing` with the VIS timing cut-off and tau of each angle bin
+    // for light emitted at `ScintPoint`: [angle bin][cut-off, tau]
+    void VISTimingSmearing(geo::Point_t const& ScintPoint, std::vector<double>& smearing) const;
 
     void generateParam(const size_t index, const size_t angle_bin);
+    size_t VUVTimingTableIndex(const size_t index, const size_t angle_bin) const
+      { return angle_bin * fNumVUVTimingDistances + index; }
 
-    void AddOpDetBTR(std::vector<sim::OpDetBacktrackerRecord>& opbtr,
-                     std::map<size_t, int>& ChannelMap,
-                     sim::OpDetBacktrackerRecord btr);
-
-    void detectedDirectHits(std::map<size_t, int>& DetectedNumFast,
-                            std::map<size_t, int>& DetectedNumSlow,
+    void detectedDirectHits(std::vector<int>& DetectedNumFast,
+                            std::vector<int>& DetectedNumSlow,
                             const double NumFast,
                             const double NumSlow,
-                            geo::Point_t const& ScintPoint);
-    void detectedReflecHits(std::map<size_t, int>& ReflDetectedNumFast,
-                            std::map<size_t, int>& ReflDetectedNumSlow,
+                            geo::Point_t const& ScintPoint,
+                            RandomEngines& rng,
+                            std::vector<size_t>& OpDets);
+    void detectedReflecHits(std::vector<int>& ReflDetectedNumFast,
+                            std::vector<int>& ReflDetectedNumSlow,
                             const double NumFast,
                             const double NumSlow,
                             geo::Point_t const& ScintPoint,
+                            std::vector<double>& visCorrections,
+                            RandomEngines& rng,
                             bool AnodeMode = false);
     
     void VUVHits(const double NumFast,
                 const double NumSlow,
                 geo::Point_t const& ScintPoint,
                 OpticalDetector const& opDet,
-                std::vector<int> &DetThis);
+                std::array<int, 2> &DetThis,
+                RandomEngines& rng);
 
-    void VISHits(geo::Point_t const& ScintPoint,
-                OpticalDetector const& opDet,
+    struct ReflectionTarget;
+    void VISHits(ReflectionTarget const& target,
+                double const* visCorrections,
                 const double cathode_hits_rec_fast,
                 const double cathode_hits_rec_slow,
                 geo::Point_t const& hotspot,
-                std::vector<int> &ReflDetThis,
+                std::array<int, 2> &ReflDetThis,
+                RandomEngines& rng,
                 bool AnodeMode = false);
 
     void propagationTime(std::vector<double>& arrival_time_dist,
                          geo::Point_t const& x0,
                          const size_t OpChannel,
-                         bool Reflected = false); // const;
+                         RandomEngines& rng,
+                         bool Reflected = false,
+                         double const* visSmearing = nullptr); // const;
 
-    double interpolate(const std::vector<double>& xData,
-                       const std::vector<double>& yData,
-                       double x,
-                       bool extrapolate,
-                       size_t i = 0);
+    // interpolates at `x` the three parameters of each node `yData[node][3]`
     void interpolate3(std::array<double, 3>& inter,
-                      const std::vector<double>& xData,
-                      const std::vector<double>& yData1,
-                      const std::vector<double>& yData2,
-                      const std::vector<double>& yData3,
+                      InterpolationAxis const& xData,
+                      double const* yData,
                       double x,
-                      bool extrapolate);
+                      bool extrapolate) const;
 
     // solid angle of rectangular aperture calculation functions
     double Rectangle_SolidAngle(const double a, const double b, const double d);
@@ -366,18 +533,17 @@ namespace phot {
     double Disk_SolidAngle(const double d, const double h, const double b);
      // solid angle of a dome aperture calculation functions
     double Omega_Dome_Model(const double distance, const double theta) const;
+    // solid angle of `opDet` seen from a point at `relative` (absolute values)
+    // from its centre, from the grid if available
+    double SolidAngle(OpticalDetector const& opDet, geo::Vector_t const& abs_relative);
+    double Analytic_SolidAngle(OpticalDetector const& opDet, geo::Vector_t const& abs_relative);
 
 
     CLHEP::HepRandomEngine& fPhotonEngine;
-    std::unique_ptr<CLHEP::RandPoissonQ> fRandPoissPhot;
     CLHEP::HepRandomEngine& fScintTimeEngine;
 
     size_t nOpDets; // Pulled from geom during Initialization()
 
-    std::map<size_t, int> PDChannelToSOCMapDirect; // Where each OpChan is.
-    std::map<size_t, int> PDChannelToSOCMapReflect; // Where each OpChan is.
-
-
     // geometry properties
     double fplane_depth, fcathode_zdimension, fcathode_ydimension;
     double fanode_plane_depth, fanode_ydimension, fanode_zdimension;
@@ -395,6 +561,23 @@ namespace phot {
     std::vector<int> fOpDetOrientation;
     std::vector<double> fOpDetLength;
     std::vector<double> fOpDetHeight;
+    // solid angle grids, one per distinct optical detector shape
+    bool fUseSolidAngleGrid;
+    unsigned int fSolidAngleGridPoints;
+    double fSolidAngleGridTolerance;
+    std::string fSolidAngleGridCache;
+    std::string fInitSnapshot;
+    std::vector<SolidAngleGrid> fSolidAngleGrids;
+    std::vector<size_t> fOpDetSolidAngleGrid; // grid of each optical detector
+    // uniform grid of optical detector centres, to skip far detectors
+    double fExpectedPhotonThreshold;
+    std::vector<double> fOpDetRadius; // radius of a sphere enclosing each detector
+    double fMaxOpDetRadius = 0.;
+    double fMaxGHCorrection = 1.; // largest correction to the geometric acceptance
+    geo::Point_t fOpDetGridMin;
+    double fOpDetGridCellSize = 0.;
+    std::array<size_t, 3> fOpDetGridCells{{0, 0, 0}};
+    std::vector<std::vector<size_t>> fOpDetGrid; // detectors in each cell
 
 
     bool isOpDetInSameTPC(geo::Point_t const& ScintPoint, geo::Point_t const& OpDetPoint) const;
@@ -406,6 +589,7 @@ namespace phot {
 
     // Module behavior
     art::InputTag simTag;
+    bool fCompactEdeps;
     bool fDoFastComponent;
     bool fDoSlowComponent;
     bool fDoReflectedLight;
@@ -413,10 +597,22 @@ namespace phot {
     bool fIncludePropTime;
     bool fGeoPropTimeOnly;
     bool fUseLitePhotons;
+    bool fAggregateLitePhotons;
+    bool fStoreProductFootprints;
     bool fOpaqueCathode;
     bool fOnlyActiveVolume;
     bool fOnlyOneCryostat;
-    std::unique_ptr<ScintTime> fScintTime; // Tool to retrive timinig of scintillation
+    fhicl::ParameterSet fScintTimeToolPSet;
+    bool fParallelDeposits;
+    size_t fParallelBlockSize;
+    // scintillation time tools of the threads (they are not thread-safe)
+    tbb::enumerable_thread_specific<std::unique_ptr<ScintTime>> fThreadScintTime;
+    // hit buffers of the threads, reused from one deposit to the next
+    tbb::enumerable_thread_specific<DetectedHits> fThreadHits;
+    // event loop, trigger and output (created when the detectors are known)
+    std::unique_ptr<FastOpticalEngine> fEngine;
+    std::vector<sim::SimEnergyDeposit> const* fEdeps = nullptr; // deposits of the event
+    std::vector<sim::SimEnergyDeposit> fEdepBuffer; // expanded compact deposits
 
     // Parameterized Simulation
     fhicl::ParameterSet fVUVTimingParams;
@@ -426,36 +622,65 @@ namespace phot {
 
     // For VUV transport time parametrization
     double fstep_size, fmax_d, fmin_d, fvuv_vgroup_mean, fvuv_vgroup_max, finflexion_point_distance, fangle_bin_timing_vuv;
-    std::vector<std::vector<double>> fparameters[7];
-    // vector containing generated VUV timing parameterisations
-    std::vector<std::vector<TF1>> VUV_timing;
-    // vector containing min and max range VUV timing parameterisations are sampled to
-    std::vector<std::vector<double>> VUV_max;
-    std::vector<std::vector<double>> VUV_min;
+    // Landau (most probable value, width, normalisation) and exponential
+    // (slope, normalisation relative to Landau) parameters of each angle bin:
+    // [angle bin][distance][parameter]
+    InterpolationAxis fVUVTimingLandauDistances;
+    std::vector<double> fVUVTimingLandauPars;
+    InterpolationAxis fVUVTimingExpoDistances;
+    std::vector<double> fVUVTimingExpoPars;
+    // inverse CDF tables of the VUV timing parameterisations, generated on demand,
+    // one per (angle bin, distance index); the range of each table is the range
+    // the parameterisation is sampled in
+    unsigned int fVUVTimingTableSize;
+    bool fPrecomputeVUVTiming;
+    std::string fVUVTimingCache;
+    size_t fNumVUVTimingDistances = 0;
+    InverseCDFTable fVUVTimingTable;
 
     // For VIS transport time parameterisation
     double fvis_vmean, fangle_bin_timing_vis;
-    std::vector<double> fdistances_refl;
-    std::vector<double> fradial_distances_refl;
-    std::vector<std::vector<std::vector<double>>> fcut_off_pars;
-    std::vector<std::vector<std::vector<double>>> ftau_pars;
+    // smearing cut-off and tau of each angle bin, interpolated in the distance
+    // from the cathode plane and in the radial distance from its centre:
+    // [angle bin][radial distance][distance][cut-off, tau]
+    InterpolationAxis fdistances_refl;
+    InterpolationAxis fradial_distances_refl;
+    std::vector<double> fVISTimingPars;
 
     // For VUV semi-analytic hits
     double fdelta_angulo_vuv;
+    // Gaisser-Hillas correction of one type of optical detectors: parameters
+    // of each offset angle bin (interpolated in the distance from the anode
+    // for laterals), and slopes of their correction with the distance from
+    // the centre of the cathode, interpolated in the offset angle
+    struct GHCorrection {
+      static constexpr size_t NPars = 4;       // Gaisser-Hillas parameters
+      static constexpr size_t NBorderPars = 3; // parameters with border correction
+      InterpolationAxis distances;       // distances from the anode (laterals only)
+      std::vector<double> pars;          // [angle bin][distance][parameter]
+      InterpolationAxis borderAngles;    // offset angles of the border slopes
+      std::vector<double> borderSlopes;  // [border angle][parameter]
+
+      size_t nDistances() const { return distances.empty() ? 1 : distances.size(); }
+      // parameters of the angle bin `j` (and of its first distance)
+      double const* binPars(size_t j) const { return pars.data() + j * nDistances() * NPars; }
+      // writes into `s` the border slopes at offset angle `theta`
+      void borderSlopesAt(double theta, double* s) const
+      {
+        const size_t i = borderAngles.interval(theta);
+        for (size_t p = 0; p < NBorderPars; ++p)
+          s[p] = borderAngles.interpolateInInterval(i, borderSlopes.data() + p, theta, true, NBorderPars);
+      }
+    };
     // flat PDs
     bool fIsFlatPDCorr;
-    std::vector<std::vector<double>> fGHvuvpars_flat;
-    std::vector<double> fborder_corr_angulo_flat;
-    std::vector<std::vector<double>> fborder_corr_flat;
+    GHCorrection fGHCorrFlat;
     // lateral PDs
     bool fIsFlatPDCorrLat;
-    std::vector<double> fGH_distances_anode;
-    std::vector<std::vector<std::vector<double>>> fGHvuvpars_flat_lateral;    
+    GHCorrection fGHCorrLateral;
     // dome PDs
     bool fIsDomePDCorr;
-    std::vector<std::vector<double>> fGHvuvpars_dome;
-    std::vector<double> fborder_corr_angulo_dome;
-    std::vector<std::vector<double>> fborder_corr_dome;
+    GHCorrection fGHCorrDome;
     // Field cage scaling
     bool fApplyFieldCageTransparency;
     double fFieldCageTransparencyLateral;
@@ -465,18 +690,56 @@ namespace phot {
     // correction parameters for VIS Nhits estimation
     double fdelta_angulo_vis;
     double fAnodeReflectivity;
+    // correction of one type of optical detectors for each offset angle bin,
+    // interpolated in the distance from the cathode (x) and in the radial
+    // distance from its centre (r)
+    struct VISCorrection {
+      InterpolationAxis distancesX;
+      InterpolationAxis distancesR;
+      std::vector<double> pars;          // [angle bin][r][x]
+
+      size_t nBins() const { return pars.empty() ? 0 : pars.size() / (distancesR.size() * distancesX.size()); }
+      // writes into `corr` the correction of each angle bin at (d_c, r)
+      void corrections(double d_c, double r, double* corr) const
+      {
+        const size_t nX = distancesX.size();
+        const size_t nBinPars = distancesR.size() * nX;
+        // interpolate in d_c for the two r nodes around r, then in r
+        const size_t ix = distancesX.interval(d_c);
+        const size_t ir = distancesR.interval(r);
+        for (size_t k = 0; k < nBins(); ++k) {
+          double const* binPars = pars.data() + k * nBinPars;
+          const double yL = distancesX.interpolateInInterval(ix, binPars + ir * nX, d_c, false);
+          const double yR = distancesX.interpolateInInterval(ix, binPars + (ir + 1) * nX, d_c, false);
+          corr[k] = distancesR.interpolateBetween(ir, yL, yR, r, false);
+        }
+      }
+    };
     // flat PDs
-    std::vector<double> fvis_distances_x_flat;
-    std::vector<double> fvis_distances_r_flat;
-    std::vector<std::vector<std::vector<double>>> fvispars_flat;
+    VISCorrection fVISCorrFlat;
     // lateral PDs
-    std::vector<double> fvis_distances_x_flat_lateral;
-    std::vector<double> fvis_distances_r_flat_lateral;
-    std::vector<std::vector<std::vector<double>>> fvispars_flat_lateral;
+    VISCorrection fVISCorrLateral;
     // dome PDs
-    std::vector<double> fvis_distances_x_dome;
-    std::vector<double> fvis_distances_r_dome;
-    std::vector<std::vector<std::vector<double>>> fvispars_dome;
+    VISCorrection fVISCorrDome;
+
+    // reads the correction tables from the configuration
+    GHCorrection readGHCorrection(std::string const& type, bool lateral) const;
+    VISCorrection readVISCorrection(std::string const& type) const;
+
+    // an optical detector seeing the light reflected by a plane, with the
+    // factors of its VIS hits which do not depend on the scintillation point
+    struct ReflectionTarget {
+      size_t OpDet;
+      OpticalDetector opDet;
+      VISCorrection const* correction; // VIS correction table (nullptr if none)
+      size_t firstBin;                 // its first angle bin in the deposit corrections
+      double transparency;             // field cage transparency factor
+    };
+    // detectors in the same TPC as the light reflected by the cathode and by
+    // the anode, for scintillation at negative and non-negative x
+    std::array<std::array<std::vector<ReflectionTarget>, 2>, 2> fReflectionTargets;
+    size_t fNVISCorrectionBins = 0; // angle bins of all the VIS correction tables
+    void prepareReflectionTargets();
     
 
   };
@@ -495,7 +758,14 @@ namespace phot {
                                                                                  "scinttime",
                                                                                  config.get_PSet(),
                                                                                  "SeedScintTime"))
+    , fUseSolidAngleGrid(config().UseSolidAngleGrid())
+    , fSolidAngleGridPoints(config().SolidAngleGridPoints())
+    , fSolidAngleGridTolerance(config().SolidAngleGridTolerance())
+    , fSolidAngleGridCache(config().SolidAngleGridCache())
+    , fInitSnapshot(config().InitializationSnapshot())
+    , fExpectedPhotonThreshold(config().ExpectedPhotonThreshold())
     , simTag(config().SimulationLabel())
+    , fCompactEdeps(config().CompactEnergyDeposits())
     , fDoFastComponent(config().DoFastComponent())
     , fDoSlowComponent(config().DoSlowComponent())
     , fDoReflectedLight(config().DoReflectedLight())
@@ -503,11 +773,18 @@ namespace phot {
     , fIncludePropTime(config().IncludePropTime())
     , fGeoPropTimeOnly(config().GeoPropTimeOnly())
     , fUseLitePhotons(config().UseLitePhotons())
+    , fAggregateLitePhotons(config().AggregateLitePhotons())
+    , fStoreProductFootprints(config().StoreProductFootprints())
     , fOpaqueCathode(config().OpaqueCathode())
     , fOnlyActiveVolume(config().OnlyActiveVolume())
     , fOnlyOneCryostat(config().OnlyOneCryostat())
-    , fScintTime{art::make_tool<ScintTime>(config().ScintTimeTool.get<fhicl::ParameterSet>())}
+    , fScintTimeToolPSet(config().ScintTimeTool.get<fhicl::ParameterSet>())
+    , fParallelDeposits(config().ParallelDeposits())
+    , fParallelBlockSize(std::max(config().ParallelBlockSize(), 1U))
     , fVUVHitsParams(config().VUVHits.get<fhicl::ParameterSet>())
+    , fVUVTimingTableSize(config().VUVTimingTableSize())
+    , fPrecomputeVUVTiming(config().PrecomputeVUVTiming())
+    , fVUVTimingCache(config().VUVTimingCache())
   {
 
     // Validate configuration options
@@ -531,8 +808,37 @@ namespace phot {
           << "Anode reflections light simulation requested, but VisHits not specified." << "\n";
     }   
 
+    scintTimeTool(); // checks the tool configuration
+
+    PhotonTimeTrigger trigger;
+    fhicl::ParameterSet triggerParams;
+    if (config().TimeTrigger.get_if_present<fhicl::ParameterSet>(triggerParams)) {
+      if (!fUseLitePhotons) {
+        throw art::Exception(art::errors::Configuration)
+          << "TimeTrigger requires lite photons (UseLitePhotons)." << "\n";
+      }
+      trigger = PhotonTimeTrigger{triggerParams};
+    }
+
+    // timing tables can't be generated on demand by concurrent threads
+    if (fParallelDeposits && fIncludePropTime && !fGeoPropTimeOnly) fPrecomputeVUVTiming = true;
+
 
     Initialization();
+    if (fExpectedPhotonThreshold > 0.) buildOpDetGrid();
+
+    FastOpticalEngine::Config_t engineConfig;
+    engineConfig.nOpChannels = nOpDets;
+    engineConfig.useLitePhotons = fUseLitePhotons;
+    engineConfig.storeReflected = fDoReflectedLight;
+    engineConfig.aggregateLitePhotons = fAggregateLitePhotons;
+    engineConfig.directPhotonEnergy = 9.7 * CLHEP::eV;    // 128 nm
+    engineConfig.reflectedPhotonEnergy = 2.9 * CLHEP::eV; // 430 nm
+    engineConfig.parallel = fParallelDeposits;
+    engineConfig.parallelBlockSize = fParallelBlockSize;
+    engineConfig.streamKey = larsim::Utils::randomStreamKey("PDFastSimPAR");
+    engineConfig.storeProductFootprints = fStoreProductFootprints;
+    fEngine = std::make_unique<FastOpticalEngine>(engineConfig, std::move(trigger));
     if (fUseLitePhotons)
     {
         mf::LogInfo("PDFastSimPAR") << "Using Lite Photons";
@@ -556,243 +862,521 @@ namespace phot {
             produces< std::vector<sim::SimPhotons> >("Reflected");
         }
     }
+    if (fStoreProductFootprints) produces< std::vector<sim::ProductFootprint> >();
   }
 
   //......................................................................
   void
-  PDFastSimPAR::produce(art::Event& event)
+  PDFastSimPAR::beginJob()
   {
-    mf::LogTrace("PDFastSimPAR") << "PDFastSimPAR Module Producer"
-                                 << "EventID: " << event.event();
+    // a warm start reads the generated state from the snapshot, in order;
+    // after a failure the rest is generated, and the snapshot rewritten
+    std::ifstream snapshot;
+    bool const warmStart = !fInitSnapshot.empty() && openInitSnapshot(snapshot);
+    bool loaded = prepareVUVTimingTables(warmStart ? &snapshot : nullptr);
+    loaded = prepareSolidAngleGrids((warmStart && loaded) ? &snapshot : nullptr) && loaded;
+    if (warmStart && loaded)
+      mf::LogInfo("PDFastSimPAR") << "Initialization snapshot loaded from '" << fInitSnapshot << "'";
+    else if (!fInitSnapshot.empty())
+      writeInitSnapshot();
+
+    // after the solid angle grids, which the reflection targets refer to
+    if (fDoReflectedLight || fIncludeAnodeReflections) prepareReflectionTargets();
+  }
 
-    auto phot = std::make_unique<std::vector<sim::SimPhotons>>();
-    auto phlit = std::make_unique<std::vector<sim::SimPhotonsLite>>();
-    auto opbtr = std::make_unique<std::vector<sim::OpDetBacktrackerRecord>>();
-
-    auto phot_ref = std::make_unique<std::vector<sim::SimPhotons>>();
-    auto phlit_ref = std::make_unique<std::vector<sim::SimPhotonsLite>>();
-    auto opbtr_ref = std::make_unique<std::vector<sim::OpDetBacktrackerRecord>>();
-
-    auto& dir_photcol(*phot);
-    auto& ref_photcol(*phot_ref);
-    auto& dir_phlitcol(*phlit);
-    auto& ref_phlitcol(*phlit_ref);
-    dir_photcol.resize(nOpDets);
-    ref_photcol.resize(nOpDets);
-    dir_phlitcol.resize(nOpDets);
-    ref_phlitcol.resize(nOpDets);
-    for (unsigned int i = 0; i < nOpDets; i ++)
-    {
-        dir_photcol[i].fOpChannel  = i;
-        ref_photcol[i].fOpChannel  = i;
-        dir_phlitcol[i].OpChannel  = i;
-        ref_phlitcol[i].OpChannel  = i;
-    }
+  //......................................................................
+  std::string
+  PDFastSimPAR::initSnapshotKey() const
+  {
+    // the optical detectors and active volumes the tables and grids are for
+    Digest geometry;
+    for (size_t const OpDet : util::counter(nOpDets)) {
+      geometry.add(fOpDetCenter[OpDet].X());
+      geometry.add(fOpDetCenter[OpDet].Y());
+      geometry.add(fOpDetCenter[OpDet].Z());
+      geometry.add(fOpDetType[OpDet]);
+      geometry.add(fOpDetOrientation[OpDet]);
+      geometry.add(fOpDetLength[OpDet]);
+      geometry.add(fOpDetHeight[OpDet]);
+    }
+    for (geo::BoxBoundedGeo const& box : fActiveVolumes) {
+      for (double const coord : {box.MinX(), box.MinY(), box.MinZ(), box.MaxX(), box.MaxY(), box.MaxZ()})
+        geometry.add(coord);
+    }
+
+    std::ostringstream key;
+    key << "VUVTiming:";
+    if (fIncludePropTime && !fGeoPropTimeOnly)
+      key << fVUVTimingParams.id().to_string() << "/" << fVUVTimingTableSize;
+    else
+      key << "none";
+    key << " SolidAngleGrid:";
+    if (fUseSolidAngleGrid)
+      key << fSolidAngleGridPoints << "/" << fSolidAngleGridTolerance << "/" << fradius;
+    else
+      key << "none";
+    key << " geometry:" << nOpDets << "/" << std::hex << geometry.value;
+    return key.str();
+  }
 
-    art::Handle<std::vector<sim::SimEnergyDeposit>> edepHandle;
-    if (!event.getByLabel(simTag, edepHandle)) {
-      mf::LogError("PDFastSimPAR") << "PDFastSimPAR Module Cannot getByLabel: " << simTag;
-      return;
-    }
+  //......................................................................
+  bool
+  PDFastSimPAR::openInitSnapshot(std::ifstream& in) const
+  {
+    in.open(fInitSnapshot, std::ios::binary);
+    if (!in) return false;
 
+    char magic[sizeof(SnapshotMagic)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, SnapshotMagic, sizeof(magic)) != 0)
+      return false;
+    std::uint32_t version = 0;
+    if (!in.read(reinterpret_cast<char*>(&version), sizeof(version)) || (version != SnapshotVersion))
+      return false;
 
-    auto const& edeps = edepHandle;
+    std::string const key = initSnapshotKey();
+    std::uint64_t keySize = 0;
+    if (!in.read(reinterpret_cast<char*>(&keySize), sizeof(keySize)) || (keySize != key.size()))
+      return false;
+    std::string fileKey(keySize, '\0');
+    return in.read(fileKey.data(), keySize) && (fileKey == key);
+  }
 
-    int num_points = 0;
-    int num_fastph = 0;
-    int num_slowph = 0;
-    int num_fastdp = 0;
-    int num_slowdp = 0;
+  //......................................................................
+  void
+  PDFastSimPAR::writeInitSnapshot() const
+  {
+    std::ofstream out(fInitSnapshot, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      throw cet::exception("PDFastSimPAR") << "Can't open '" << fInitSnapshot << "' for writing.\n";
+    }
+    std::string const key = initSnapshotKey();
+    std::uint64_t const keySize = key.size();
+    out.write(SnapshotMagic, sizeof(SnapshotMagic));
+    out.write(reinterpret_cast<char const*>(&SnapshotVersion), sizeof(SnapshotVersion));
+    out.write(reinterpret_cast<char const*>(&keySize), sizeof(keySize));
+    out.write(key.data(), key.size());
+    fVUVTimingTable.write(out);
+    writeSolidAngleGrids(out, fSolidAngleGrids);
+    if (!out) {
+      throw cet::exception("PDFastSimPAR") << "Error while writing '" << fInitSnapshot << "'.\n";
+    }
+    mf::LogInfo("PDFastSimPAR") << "Initialization snapshot saved into '" << fInitSnapshot << "'";
+  }
 
-    for (auto const& edepi : *edeps) {
-      num_points++;
+  //......................................................................
+  bool
+  PDFastSimPAR::prepareVUVTimingTables(std::istream* snapshot)
+  {
+    // with no timing tables, the snapshot holds an empty table
+    if (snapshot && fVUVTimingTable.read(*snapshot)) return true;
+    if (!fIncludePropTime || fGeoPropTimeOnly) return false;
+    // the snapshot holds all the tables
+    if (!fPrecomputeVUVTiming && fVUVTimingCache.empty() && fInitSnapshot.empty()) return false;
+
+    // the tables depend only on the VUV timing configuration and their size
+    const std::string key = fVUVTimingParams.id().to_string() + "/" + std::to_string(fVUVTimingTableSize);
+    if (!fVUVTimingCache.empty() && fVUVTimingTable.readFile(fVUVTimingCache, key)) {
+      mf::LogInfo("PDFastSimPAR") << "VUV timing tables loaded from '" << fVUVTimingCache << "'";
+      return false;
+    }
 
-      int trackID = edepi.TrackID();
-      double nphot = edepi.NumPhotons();
-      double edeposit = edepi.Energy() / nphot;
-      double pos[3] = {edepi.MidPointX(), edepi.MidPointY(), edepi.MidPointZ()};
-      geo::Point_t const ScintPoint = {pos[0], pos[1], pos[2]};
+    const size_t num_angles = fVUVTimingTable.nTables() / fNumVUVTimingDistances;
+    for (size_t angle_bin = 0; angle_bin < num_angles; ++angle_bin) {
+      for (size_t index = 0; index < fNumVUVTimingDistances; ++index) {
+        if (!fVUVTimingTable.isFilled(VUVTimingTableIndex(index, angle_bin)))
+          generateParam(index, angle_bin);
+      }
+    }
+    mf::LogInfo("PDFastSimPAR") << "Generated " << fVUVTimingTable.nTables() << " VUV timing tables";
 
-      if (fOnlyActiveVolume && !fISTPC.isScintInActiveVolume(ScintPoint)) continue;
+    if (!fVUVTimingCache.empty()) {
+      fVUVTimingTable.writeFile(fVUVTimingCache, key);
+      mf::LogInfo("PDFastSimPAR") << "VUV timing tables saved into '" << fVUVTimingCache << "'";
+    }
+    return false;
+  }
 
-      double nphot_fast = edepi.NumFPhotons();
-      double nphot_slow = edepi.NumSPhotons();
+  //......................................................................
+  bool
+  PDFastSimPAR::prepareSolidAngleGrids(std::istream* snapshot)
+  {
+    // with no grids, the snapshot holds an empty set
+    if (!fUseSolidAngleGrid) return snapshot && readSolidAngleGrids(*snapshot, fSolidAngleGrids);
 
-      num_fastph += nphot_fast;
-      num_slowph += nphot_slow;
+    // distinct detector shapes; the solid angle depends only on them
+    std::vector<OpticalDetector> shapes;
+    std::vector<SolidAngleGrid::Coords_t> ranges;
+    fOpDetSolidAngleGrid.clear();
+    for (size_t const OpDet : util::counter(nOpDets)) {
+      auto const sameShape = [this, OpDet](OpticalDetector const& shape) {
+        return shape.type == fOpDetType[OpDet] && shape.orientation == fOpDetOrientation[OpDet] &&
+               shape.h == fOpDetHeight[OpDet] && shape.w == fOpDetLength[OpDet];
+      };
+      auto const iShape = std::find_if(shapes.cbegin(), shapes.cend(), sameShape);
+      size_t const shapeIndex = std::distance(shapes.cbegin(), iShape);
+      if (iShape == shapes.cend()) {
+        shapes.push_back(opticalDetector(OpDet));
+        ranges.push_back({{0., 0., 0.}});
+      }
+      fOpDetSolidAngleGrid.push_back(shapeIndex);
+
+      // the grid must cover the distance to any point of the active volumes
+      geo::Point_t const& center = fOpDetCenter[OpDet];
+      auto& range = ranges[shapeIndex];
+      for (geo::BoxBoundedGeo const& box : fActiveVolumes) {
+        range[0] = std::max({range[0], std::abs(box.MinX() - center.X()), std::abs(box.MaxX() - center.X())});
+        range[1] = std::max({range[1], std::abs(box.MinY() - center.Y()), std::abs(box.MaxY() - center.Y())});
+        range[2] = std::max({range[2], std::abs(box.MinZ() - center.Z()), std::abs(box.MaxZ() - center.Z())});
+      }
+    }
 
-      // direct light
-      std::map<size_t, int> DetectedNumFast;
-      std::map<size_t, int> DetectedNumSlow;
+    // the grids depend on the shapes, their ranges and the grid parameters
+    std::string key = std::to_string(fSolidAngleGridPoints) + "/" + std::to_string(fSolidAngleGridTolerance) +
+      "/" + std::to_string(fradius);
+    for (size_t const i : util::counter(shapes.size())) {
+      key += "/" + std::to_string(shapes[i].type) + ":" + std::to_string(shapes[i].orientation) + ":" +
+        std::to_string(shapes[i].h) + ":" + std::to_string(shapes[i].w);
+      for (double const r : ranges[i]) key += ":" + std::to_string(r);
+    }
 
-      bool needHits = (nphot_fast > 0 && fDoFastComponent) || (nphot_slow > 0 && fDoSlowComponent);
-      if ( needHits ) {
-        detectedDirectHits(DetectedNumFast, DetectedNumSlow, nphot_fast, nphot_slow, ScintPoint);
-        if ( fIncludeAnodeReflections ) {
-          std::map<size_t, int> AnodeDetectedNumFast;
-          std::map<size_t, int> AnodeDetectedNumSlow;
-          detectedReflecHits(AnodeDetectedNumFast, AnodeDetectedNumSlow, nphot_fast, nphot_slow, ScintPoint, true);
-          // add to exiting count
-          for (size_t const OpDet : util::counter(nOpDets)){
-            DetectedNumFast[OpDet] += AnodeDetectedNumFast[OpDet];
-            DetectedNumSlow[OpDet] += AnodeDetectedNumSlow[OpDet];
-          }
-        }
-      }
+    fSolidAngleGrids.clear();
+    for (size_t const i : util::counter(shapes.size()))
+      fSolidAngleGrids.emplace_back(ranges[i], fSolidAngleGridPoints);
 
-      // reflected light, if enabled
-      std::map<size_t, int> ReflDetectedNumFast;
-      std::map<size_t, int> ReflDetectedNumSlow;
-      if (fDoReflectedLight && needHits)
-        detectedReflecHits(ReflDetectedNumFast, ReflDetectedNumSlow, nphot_fast, nphot_slow, ScintPoint);
+    if (snapshot && readSolidAngleGrids(*snapshot, fSolidAngleGrids)) return true;
+    if (!fSolidAngleGridCache.empty() && readSolidAngleGrids(fSolidAngleGridCache, key, fSolidAngleGrids)) {
+      mf::LogInfo("PDFastSimPAR") << "Solid angle grids loaded from '" << fSolidAngleGridCache << "'";
+      return false;
+    }
 
-      // propagation time
-      std::vector<double> transport_time;
+    for (size_t const i : util::counter(shapes.size())) {
+      OpticalDetector const& shape = shapes[i];
+      fSolidAngleGrids[i].fill(
+        [this, &shape](SolidAngleGrid::Coords_t const& v) {
+          return Analytic_SolidAngle(shape, geo::Vector_t{v[0], v[1], v[2]});
+        },
+        fSolidAngleGridTolerance);
+      mf::LogInfo("PDFastSimPAR") << "Solid angle grid for optical detector shape #" << i << " (type "
+        << shape.type << "): " << (100. * fSolidAngleGrids[i].exactCellFraction())
+        << "% of the cells are computed analytically";
+    }
 
-      // loop through direct photons then reflected photons cases
-      for (size_t Reflected = 0; Reflected <= 1; ++Reflected) {
+    if (!fSolidAngleGridCache.empty()) {
+      writeSolidAngleGrids(fSolidAngleGridCache, key, fSolidAngleGrids);
+      mf::LogInfo("PDFastSimPAR") << "Solid angle grids saved into '" << fSolidAngleGridCache << "'";
+    }
+    return false;
+  }
 
-        // only do the reflected loop if including reflected light
-        if (Reflected && !fDoReflectedLight) continue;
+  //......................................................................
+  void
+  PDFastSimPAR::buildOpDetGrid()
+  {
+    if (nOpDets == 0) return;
 
-        for (size_t channel = 0; channel < nOpDets; channel++) {
+    // a sphere enclosing each detector bounds its solid angle
+    fOpDetRadius.clear();
+    for (size_t const OpDet : util::counter(nOpDets)) {
+      if (fOpDetType[OpDet] == 0)
+        fOpDetRadius.push_back(0.5 * std::hypot(fOpDetHeight[OpDet], fOpDetLength[OpDet]));
+      else
+        fOpDetRadius.push_back(fradius);
+    }
+    fMaxOpDetRadius = *std::max_element(fOpDetRadius.begin(), fOpDetRadius.end());
+    fMaxGHCorrection = maxGHCorrection();
+
+    // cells are sized for about one detector each, if uniformly spread
+    geo::Point_t max = fOpDetCenter.front();
+    fOpDetGridMin = fOpDetCenter.front();
+    for (geo::Point_t const& center : fOpDetCenter) {
+      fOpDetGridMin.SetXYZ(std::min(fOpDetGridMin.X(), center.X()),
+                           std::min(fOpDetGridMin.Y(), center.Y()),
+                           std::min(fOpDetGridMin.Z(), center.Z()));
+      max.SetXYZ(std::max(max.X(), center.X()),
+                 std::max(max.Y(), center.Y()),
+                 std::max(max.Z(), center.Z()));
+    }
+    geo::Vector_t const size = max - fOpDetGridMin;
+    double const maxSize = std::max({size.X(), size.Y(), size.Z(), 1.});
+    fOpDetGridCellSize = maxSize / std::max(std::cbrt(double(nOpDets)), 1.);
+    fOpDetGridCells = {{size_t(size.X() / fOpDetGridCellSize) + 1,
+                        size_t(size.Y() / fOpDetGridCellSize) + 1,
+                        size_t(size.Z() / fOpDetGridCellSize) + 1}};
+
+    fOpDetGrid.assign(fOpDetGridCells[0] * fOpDetGridCells[1] * fOpDetGridCells[2], {});
+    for (size_t const OpDet : util::counter(nOpDets)) {
+      geo::Vector_t const pos = (fOpDetCenter[OpDet] - fOpDetGridMin) / fOpDetGridCellSize;
+      size_t const ix = std::min(size_t(pos.X()), fOpDetGridCells[0] - 1);
+      size_t const iy = std::min(size_t(pos.Y()), fOpDetGridCells[1] - 1);
+      size_t const iz = std::min(size_t(pos.Z()), fOpDetGridCells[2] - 1);
+      fOpDetGrid[(iz * fOpDetGridCells[1] + iy) * fOpDetGridCells[0] + ix].push_back(OpDet);
+    }
 
-          if (fOpaqueCathode && !isOpDetInSameTPC(ScintPoint, fOpDetCenter[channel])) continue;
+    mf::LogInfo("PDFastSimPAR") << "Optical detectors expecting less than " << fExpectedPhotonThreshold
+      << " direct photons will be skipped; grid of " << fOpDetGridCells[0] << "x" << fOpDetGridCells[1]
+      << "x" << fOpDetGridCells[2] << " cells of " << fOpDetGridCellSize << " cm"
+      << " (largest Gaisser-Hillas correction: " << fMaxGHCorrection << ")";
+  }
 
-          int ndetected_fast = DetectedNumFast[channel];
-          int ndetected_slow = DetectedNumSlow[channel];
-          if (Reflected) {
-            ndetected_fast = ReflDetectedNumFast[channel];
-            ndetected_slow = ReflDetectedNumSlow[channel];
-          }
+  //......................................................................
+  double
+  PDFastSimPAR::maxGHCorrection() const
+  {
+    // distances up to the largest one between a detector and the active volume,
+    // and radial distances from the cathode centre up to the largest one
+    geo::Point_t low = fOpDetCenter.front(), high = fOpDetCenter.front();
+    for (geo::BoxBoundedGeo const& box : fActiveVolumes) {
+      low.SetXYZ(std::min(low.X(), box.MinX()), std::min(low.Y(), box.MinY()), std::min(low.Z(), box.MinZ()));
+      high.SetXYZ(std::max(high.X(), box.MaxX()), std::max(high.Y(), box.MaxY()), std::max(high.Z(), box.MaxZ()));
+    }
+    for (geo::Point_t const& center : fOpDetCenter) {
+      low.SetXYZ(std::min(low.X(), center.X()), std::min(low.Y(), center.Y()), std::min(low.Z(), center.Z()));
+      high.SetXYZ(std::max(high.X(), center.X()), std::max(high.Y(), center.Y()), std::max(high.Z(), center.Z()));
+    }
+    double const maxDistance = (high - low).R();
+    double const maxR = std::hypot(std::max(high.Y() - fcathode_centre[1], fcathode_centre[1] - low.Y()),
+                                   std::max(high.Z() - fcathode_centre[2], fcathode_centre[2] - low.Z()));
+    constexpr double DistanceStep = 1.;   // [cm]
+    constexpr unsigned int NRadialSteps = 16;
+
+    // the correction is sampled on each node of the tables (angle bins,
+    // distances from the anode) and on the border slopes of each node angle
+    double maxCorr = 0.;
+    auto const sample = [&](double const* pars, double const* slopes) {
+      for (unsigned int iR = 0; iR <= (slopes ? NRadialSteps : 0); ++iR) {
+        double const r = maxR * iR / NRadialSteps;
+        double p[GHCorrection::NPars];
+        std::copy_n(pars, GHCorrection::NPars, p);
+        if (slopes) for (size_t k = 0; k < GHCorrection::NBorderPars; ++k) p[k] += slopes[k] * r;
+        for (double d = DistanceStep; d <= maxDistance + DistanceStep; d += DistanceStep) {
+          double const corr = Gaisser_Hillas(d, p);
+          if (std::isfinite(corr)) maxCorr = std::max(maxCorr, corr);
+        }
+      }
+    };
+    for (GHCorrection const* table : {&fGHCorrFlat, &fGHCorrLateral, &fGHCorrDome}) {
+      size_t const nNodes = table->pars.size() / GHCorrection::NPars;
+      size_t const nAngles = nNodes / table->nDistances();
+      for (size_t node = 0; node < nNodes; ++node) {
+        double const* pars = table->pars.data() + node * GHCorrection::NPars;
+        if (table->borderSlopes.empty()) { sample(pars, nullptr); continue; }
+        for (double const offset : {0., 0.5, 1.}) {
+          double slopes[GHCorrection::NBorderPars];
+          table->borderSlopesAt((node % nAngles + offset) * fdelta_angulo_vuv, slopes);
+          sample(pars, slopes);
+        }
+      }
+    }
 
-          // calculate propagation time, does not matter whether fast or slow photon
-          transport_time.resize(ndetected_fast + ndetected_slow);
-          if (fIncludePropTime && needHits)
-            propagationTime(transport_time, ScintPoint, channel, Reflected);
-
-          // SimPhotonsLite case
-          if (fUseLitePhotons) {
-
-            sim::OpDetBacktrackerRecord tmpbtr(channel);
-
-            if (ndetected_fast > 0 && fDoFastComponent) {
-              int n = ndetected_fast;
-              num_fastdp += n;
-              for (long i = 0; i < n; ++i) {
-                // calculates the time at which the photon was produced
-                fScintTime->GenScintTime(true, fScintTimeEngine);
-                auto time = static_cast<int>(edepi.StartT() + fScintTime->GetScintTime() + transport_time[i]);
-                if (Reflected) ++ref_phlitcol[channel].DetectedPhotons[time];
-                else ++dir_phlitcol[channel].DetectedPhotons[time];
-                tmpbtr.AddScintillationPhotons(trackID, time, 1, pos, edeposit);
-              }
-            }
-
-            if (ndetected_slow > 0 && fDoSlowComponent) {
-              int n = ndetected_slow;
-              num_slowdp += n;
-              for (long i = 0; i < n; ++i) {
-                fScintTime->GenScintTime(false, fScintTimeEngine);
-                auto time = static_cast<int>(edepi.StartT() + fScintTime->GetScintTime() + transport_time[ndetected_fast + i]);
-                if (Reflected) ++ref_phlitcol[channel].DetectedPhotons[time];
-                else ++dir_phlitcol[channel].DetectedPhotons[time];
-                tmpbtr.AddScintillationPhotons(trackID, time, 1, pos, edeposit);
-              }
-            }
-
-            if (Reflected) AddOpDetBTR(*opbtr_ref, PDChannelToSOCMapReflect, tmpbtr);
-            else AddOpDetBTR(*opbtr, PDChannelToSOCMapDirect, tmpbtr);
-          }
-          // SimPhotons case
-          else {
+    if (fApplyFieldCageTransparency)
+      maxCorr *= std::max({1., fFieldCageTransparencyLateral, fFieldCageTransparencyCathode});
+    return (maxCorr > 0.) ? maxCorr : 1.;
+  }
 
-            sim::OnePhoton photon;
-            photon.SetInSD         = false;
-            photon.InitialPosition = edepi.End();
-            if (Reflected) photon.Energy = 2.9 * CLHEP::eV; // 430 nm
-            else photon.Energy = 9.7 * CLHEP::eV; // 128 nm
-
-            if (ndetected_fast > 0 && fDoFastComponent) {
-              int n = ndetected_fast;
-              num_fastdp += n;
-              for (long i = 0; i < n; ++i) {
-                // calculates the time at which the photon was produced
-                fScintTime->GenScintTime(true, fScintTimeEngine);
-                auto time = static_cast<int>(edepi.StartT() + fScintTime->GetScintTime() + transport_time[i]);
-                photon.Time = time;
-                if(Reflected) ref_photcol[channel].insert(ref_photcol[channel].end(), 1, photon);
-                else dir_photcol[channel].insert(dir_photcol[channel].end(), 1, photon);
-              }
-            }
-
-            if (ndetected_slow > 0 && fDoSlowComponent) {
-              int n = ndetected_slow;
-              num_slowdp += n;
-              for (long i = 0; i < n; ++i) {
-                fScintTime->GenScintTime(false, fScintTimeEngine);
-                auto time = static_cast<int>(edepi.StartT() + fScintTime->GetScintTime() + transport_time[ndetected_fast + i]);
-                photon.Time = time;
-                if(Reflected) ref_photcol[channel].insert(ref_photcol[channel].end(), 1, photon);
-                else dir_photcol[channel].insert(dir_photcol[channel].end(), 1, photon);
-              }
-            }
+  //......................................................................
+  void
+  PDFastSimPAR::selectOpDets(geo::Point_t const& ScintPoint,
+                             double NumPhotons,
+                             std::vector<size_t>& OpDets) const
+  {
+    // the solid angle of a detector enclosed in a sphere of radius rho,
+    // seen from a distance d > rho, is smaller than 2 pi rho^2 / d^2, and
+    // the Gaisser-Hillas correction is at most fMaxGHCorrection (absorption
+    // only lowers the count); this is an approximation, not a strict bound,
+    // since VUVHits() also divides by the cosine of the incidence angle,
+    // which is not bounded for light grazing a detector
+    double const scale2 =
+      std::max(0.5 * NumPhotons * fMaxGHCorrection / fExpectedPhotonThreshold, 1.);
+    double const maxDistance = fMaxOpDetRadius * std::sqrt(scale2);
+
+    OpDets.clear();
+    if (fOpDetGrid.empty()) return;
+    std::array<size_t, 3> first, last;
+    double const start[3] = {ScintPoint.X() - fOpDetGridMin.X(),
+                             ScintPoint.Y() - fOpDetGridMin.Y(),
+                             ScintPoint.Z() - fOpDetGridMin.Z()};
+    for (size_t axis = 0; axis < 3; ++axis) {
+      double const low = std::floor((start[axis] - maxDistance) / fOpDetGridCellSize);
+      double const high = std::floor((start[axis] + maxDistance) / fOpDetGridCellSize);
+      if (high < 0. || low >= double(fOpDetGridCells[axis])) return;
+      first[axis] = size_t(std::max(low, 0.));
+      last[axis] = std::min(size_t(high), fOpDetGridCells[axis] - 1);
+    }
+
+    for (size_t iz = first[2]; iz <= last[2]; ++iz) {
+      for (size_t iy = first[1]; iy <= last[1]; ++iy) {
+        for (size_t ix = first[0]; ix <= last[0]; ++ix) {
+          for (size_t const OpDet : fOpDetGrid[(iz * fOpDetGridCells[1] + iy) * fOpDetGridCells[0] + ix]) {
+            double const radius2 = fOpDetRadius[OpDet] * fOpDetRadius[OpDet] * scale2;
+            if ((fOpDetCenter[OpDet] - ScintPoint).Mag2() <= radius2) OpDets.push_back(OpDet);
           }
         }
       }
     }
+    // keep the detector order (and the random number sequence) of the full loop
+    std::sort(OpDets.begin(), OpDets.end());
+  }
 
-    mf::LogTrace("PDFastSimPAR") << "Total points: " << num_points
-                                 << ", total fast photons: " << num_fastph
-                                 << ", total slow photons: " << num_slowph
-                                 << "\ndetected fast photons: " << num_fastdp
-                                 << ", detected slow photons: " << num_slowdp;
+  //......................................................................
+  PDFastSimPAR::OpticalDetector
+  PDFastSimPAR::opticalDetector(size_t OpDet) const
+  {
+    return {fOpDetHeight[OpDet], fOpDetLength[OpDet],
+            fOpDetCenter[OpDet], fOpDetType[OpDet], fOpDetOrientation[OpDet],
+            fSolidAngleGrids.empty() ? nullptr : &fSolidAngleGrids[fOpDetSolidAngleGrid[OpDet]]};
+  }
 
-    PDChannelToSOCMapDirect.clear();
-    PDChannelToSOCMapReflect.clear();
+  //......................................................................
+  void
+  PDFastSimPAR::produce(art::Event& event)
+  {
+    LARSIM_TRACE_ZONE("PDFastSimPAR::produce");
+    mf::LogTrace("PDFastSimPAR") << "PDFastSimPAR Module Producer"
+                                 << "EventID: " << event.event();
 
-    if (fUseLitePhotons) {
-        event.put(move(phlit));
-        event.put(move(opbtr));
-        if (fDoReflectedLight) {
-            event.put(move(phlit_ref), "Reflected");
-            event.put(move(opbtr_ref), "Reflected");
-        }
+    fEdeps = sim::readSimEnergyDeposits(event, simTag, fCompactEdeps, fEdepBuffer);
+    if (!fEdeps) {
+      mf::LogError("PDFastSimPAR") << "PDFastSimPAR Module Cannot getByLabel: " << simTag;
+      return;
     }
-    else {
-        event.put(move(phot));
-        if (fDoReflectedLight) {
-            event.put(move(phot_ref), "Reflected");
-        }
+
+    fEngine->simulate(fEdeps->size(), *this, fPhotonEngine, fScintTimeEngine);
+    fEdeps = nullptr;
+
+    auto const& stats = fEngine->stats();
+    if (fEngine->trigger().enabled()) {
+      mf::LogDebug("PDFastSimPAR") << "Trigger: event " << (fEngine->trigger().accepted() ? "accepted" : "rejected")
+                                   << " after " << stats.simulated << " of " << stats.sources << " deposits";
     }
 
-    return;
+    mf::LogTrace("PDFastSimPAR") << "Total points: " << stats.simulated
+                                 << ", outside the simulated volume: " << stats.skipped
+                                 << "\ndetected direct photons: " << stats.directPhotons
+                                 << ", detected reflected photons: " << stats.reflectedPhotons;
+    LARSIM_TRACE_COUNTER("PDFastSimPAR deposits", stats.simulated);
+    LARSIM_TRACE_COUNTER("PDFastSimPAR photons", stats.directPhotons + stats.reflectedPhotons);
+
+    fEngine->put(event, moduleDescription().moduleLabel());
+  }
+
+  //......................................................................
+  ScintTime&
+  PDFastSimPAR::scintTimeTool()
+  {
+    auto& scintTime = fThreadScintTime.local();
+    if (!scintTime) scintTime = art::make_tool<ScintTime>(fScintTimeToolPSet);
+    return *scintTime;
   }
 
   //......................................................................
   void
-  PDFastSimPAR::AddOpDetBTR(std::vector<sim::OpDetBacktrackerRecord>& opbtr,
-                            std::map<size_t, int>& ChannelMap,
-                            sim::OpDetBacktrackerRecord btr
-                            )
+  PDFastSimPAR::simulateSource(size_t iDep, FastOpticalRandom& rng, FastOpticalPhotons& dep)
   {
-    size_t iChan = btr.OpDetNum();
-    auto channelPosition = ChannelMap.find(iChan);
+    sim::SimEnergyDeposit const& edepi = (*fEdeps)[iDep];
+    double pos[3] = {edepi.MidPointX(), edepi.MidPointY(), edepi.MidPointZ()};
+    geo::Point_t const ScintPoint = {pos[0], pos[1], pos[2]};
+
+    if (fOnlyActiveVolume && !fISTPC.isScintInActiveVolume(ScintPoint)) return;
+    dep.simulated = true;
+    dep.trackID = edepi.TrackID();
+    dep.origin = ScintPoint;
+    dep.photonOrigin = edepi.End();
+    dep.energyPerPhoton = edepi.Energy() / double(edepi.NumPhotons());
+
+    ScintTime& scintTime = scintTimeTool();
+    DetectedHits& hits = fThreadHits.local();
+
+    double nphot_fast = edepi.NumFPhotons();
+    double nphot_slow = edepi.NumSPhotons();
+
+    hits.reset(nOpDets);
+
+    // direct light
+    std::vector<int>& DetectedNumFast = hits.fast;
+    std::vector<int>& DetectedNumSlow = hits.slow;
+
+    bool needHits = (nphot_fast > 0 && fDoFastComponent) || (nphot_slow > 0 && fDoSlowComponent);
+    if ( needHits ) {
+      detectedDirectHits(DetectedNumFast, DetectedNumSlow, nphot_fast, nphot_slow, ScintPoint, rng, hits.candidates);
+      if ( fIncludeAnodeReflections ) {
+        detectedReflecHits(hits.anodeFast, hits.anodeSlow, nphot_fast, nphot_slow, ScintPoint, hits.visCorrections, rng, true);
+        // add to exiting count
+        for (size_t const OpDet : util::counter(nOpDets)){
+          DetectedNumFast[OpDet] += hits.anodeFast[OpDet];
+          DetectedNumSlow[OpDet] += hits.anodeSlow[OpDet];
+        }
+      }
+    }
+
+    // reflected light, if enabled
+    std::vector<int>& ReflDetectedNumFast = hits.reflFast;
+    std::vector<int>& ReflDetectedNumSlow = hits.reflSlow;
+    if (fDoReflectedLight && needHits)
+      detectedReflecHits(ReflDetectedNumFast, ReflDetectedNumSlow, nphot_fast, nphot_slow, ScintPoint, hits.visCorrections, rng);
 
-    if (channelPosition == ChannelMap.end()) {
-      ChannelMap[iChan] = opbtr.size();
-      opbtr.emplace_back(std::move(btr));
+    // list the channels with any photon: the others produce no photon and
+    // draw no random number, and need no further processing
+    for (size_t const OpDet : util::counter(nOpDets)) {
+      if (DetectedNumFast[OpDet] + DetectedNumSlow[OpDet] > 0) hits.direct.push_back(OpDet);
+      if (ReflDetectedNumFast[OpDet] + ReflDetectedNumSlow[OpDet] > 0) hits.reflected.push_back(OpDet);
     }
-    else {
-      unsigned int idtest = channelPosition->second;
-      auto const& timePDclockSDPsMap = btr.timePDclockSDPsMap();
-
-      for (auto const& timePDclockSDP : timePDclockSDPsMap) {
-        for (auto const& sdp : timePDclockSDP.second) {
-          double xyz[3] = {sdp.x, sdp.y, sdp.z};
-          opbtr.at(idtest).AddScintillationPhotons(
-            sdp.trackID, timePDclockSDP.first, sdp.numPhotons, xyz, sdp.energy);
+
+    // propagation time
+    std::vector<double>& transport_time = hits.transport_time;
+    std::vector<double>& emission_time = hits.emission_time;
+
+    // VIS timing smearing, shared by all the detectors seeing reflected light
+    if (fDoReflectedLight && fIncludePropTime && !fGeoPropTimeOnly && needHits && !hits.reflected.empty())
+      VISTimingSmearing(ScintPoint, hits.visSmearing);
+
+    // loop through direct photons then reflected photons cases
+    for (size_t Reflected = 0; Reflected <= 1; ++Reflected) {
+
+      // only do the reflected loop if including reflected light
+      if (Reflected && !fDoReflectedLight) continue;
+
+      // every channel gets a backtracking record, even without photons
+      std::vector<size_t> const& withHits = Reflected ? hits.reflected : hits.direct;
+      auto iWithHits = withHits.cbegin();
+      for (size_t channel = 0; channel < nOpDets; ++channel) {
+
+        bool const hasHits = (iWithHits != withHits.cend()) && (*iWithHits == channel);
+        if (hasHits) ++iWithHits;
+
+        if (fOpaqueCathode && !isOpDetInSameTPC(ScintPoint, fOpDetCenter[channel])) continue;
+
+        size_t const begin = dep.times.size();
+        dep.channels.push_back({static_cast<unsigned int>(channel), bool(Reflected), begin, begin});
+        if (!hasHits) continue;
+
+        int ndetected_fast = DetectedNumFast[channel];
+        int ndetected_slow = DetectedNumSlow[channel];
+        if (Reflected) {
+          ndetected_fast = ReflDetectedNumFast[channel];
+          ndetected_slow = ReflDetectedNumSlow[channel];
         }
+
+        // calculate propagation time, does not matter whether fast or slow photon
+        transport_time.resize(ndetected_fast + ndetected_slow);
+        if (fIncludePropTime && needHits)
+          propagationTime(transport_time, ScintPoint, channel, rng, Reflected, hits.visSmearing.data());
+
+        if (ndetected_fast > 0 && fDoFastComponent) {
+          // calculates the times at which the photons were produced
+          emission_time.resize(ndetected_fast);
+          scintTime.GenScintTimes(true, emission_time.data(), ndetected_fast, rng.scintTime);
+          for (long i = 0; i < ndetected_fast; ++i)
+            dep.times.push_back(static_cast<int>(edepi.StartT() + emission_time[i] + transport_time[i]));
+        }
+
+        if (ndetected_slow > 0 && fDoSlowComponent) {
+          emission_time.resize(ndetected_slow);
+          scintTime.GenScintTimes(false, emission_time.data(), ndetected_slow, rng.scintTime);
+          for (long i = 0; i < ndetected_slow; ++i)
+            dep.times.push_back(static_cast<int>(edepi.StartT() + emission_time[i] + transport_time[ndetected_fast + i]));
+        }
+
+        dep.channels.back().end = dep.times.size();
       }
     }
   }
@@ -805,7 +1389,6 @@ namespace phot {
     std::cout << "Initializing the geometry of the detector." << std::endl;
     std::cout << "Simulate using semi-analytic model for number of hits." << std::endl;
 
-    fRandPoissPhot = std::make_unique<CLHEP::RandPoissonQ>(fPhotonEngine);
     geo::GeometryCore const& geom = *(lar::providerFrom<geo::Geometry>());
 
     // Store info from the Geometry service
@@ -883,13 +1466,24 @@ namespace phot {
     if (fIncludePropTime && !fGeoPropTimeOnly) {
       mf::LogInfo("PDFastSimPAR") << "Using VUV timing parameterization";
 
-      fparameters[0] = std::vector(1, fVUVTimingParams.get<std::vector<double>>("Distances_landau"));
-      fparameters[1] = fVUVTimingParams.get<std::vector<std::vector<double>>>("Norm_over_entries");
-      fparameters[2] = fVUVTimingParams.get<std::vector<std::vector<double>>>("Mpv");
-      fparameters[3] = fVUVTimingParams.get<std::vector<std::vector<double>>>("Width");
-      fparameters[4] = std::vector(1, fVUVTimingParams.get<std::vector<double>>("Distances_exp"));
-      fparameters[5] = fVUVTimingParams.get<std::vector<std::vector<double>>>("Slope");
-      fparameters[6] = fVUVTimingParams.get<std::vector<std::vector<double>>>("Expo_over_Landau_norm");
+      fVUVTimingLandauDistances = InterpolationAxis(fVUVTimingParams.get<std::vector<double>>("Distances_landau"));
+      {
+        std::array<std::string, 3> const names{{"Mpv", "Width", "Norm_over_entries"}};
+        std::array<std::vector<std::vector<double>>, 3> pars;
+        for (size_t p = 0; p < pars.size(); ++p)
+          pars[p] = fVUVTimingParams.get<std::vector<std::vector<double>>>(names[p]);
+        fVUVTimingLandauPars = flattenParameters(pars[0].size(), fVUVTimingLandauDistances.size(), pars.size(),
+          [&](size_t bin, size_t node, size_t p) { return parameterAt(pars[p], bin, node, names[p]); });
+      }
+      fVUVTimingExpoDistances = InterpolationAxis(fVUVTimingParams.get<std::vector<double>>("Distances_exp"));
+      {
+        std::array<std::string, 2> const names{{"Slope", "Expo_over_Landau_norm"}};
+        std::array<std::vector<std::vector<double>>, 2> pars;
+        for (size_t p = 0; p < pars.size(); ++p)
+          pars[p] = fVUVTimingParams.get<std::vector<std::vector<double>>>(names[p]);
+        fVUVTimingExpoPars = flattenParameters(pars[0].size(), fVUVTimingExpoDistances.size(), pars.size(),
+          [&](size_t bin, size_t node, size_t p) { return parameterAt(pars[p], bin, node, names[p]); });
+      }
 
       fstep_size                = fVUVTimingParams.get<double>("step_size");
       fmax_d                    = fVUVTimingParams.get<double>("max_d");
@@ -899,29 +1493,28 @@ namespace phot {
       finflexion_point_distance = fVUVTimingParams.get<double>("inflexion_point_distance");
       fangle_bin_timing_vuv     = fVUVTimingParams.get<double>("angle_bin_timing_vuv");
 
-      // create vector of empty TF1s that will be replaces with the parameterisations
-      // that are generated as they are required
-      // default TF1() constructor gives function with 0 dimensions, can then check
-      // numDim to qucikly see if a parameterisation has been generated
+      // create the table of empty distributions that will be filled with the
+      // parameterisations as they are required
       const size_t num_params = (fmax_d - fmin_d) / fstep_size; // for d < fmin_d, no parameterisaton, a delta function is used instead
       size_t num_angles = std::round(90/fangle_bin_timing_vuv);
-      VUV_timing = std::vector(num_angles, std::vector(num_params, TF1()));
-
-      // initialise vectors to contain range parameterisations sampled to in each case
-      // when using TF1->GetRandom(xmin,xmax), must be in same range otherwise sampling
-      // is regenerated, this is the slow part!
-      VUV_max = std::vector(num_angles, std::vector(num_params, 0.0));
-      VUV_min = std::vector(num_angles, std::vector(num_params, 0.0));
+      fNumVUVTimingDistances = num_params;
+      fVUVTimingTable = InverseCDFTable(num_angles * num_params, fVUVTimingTableSize);
 
       // VIS time parameterisation
       if (fDoReflectedLight) {
         mf::LogInfo("PDFastSimPAR") << "Using VIS (reflected) timing parameterization";
 
         // load parameters
-        fdistances_refl        = fVISTimingParams.get<std::vector<double>>("Distances_refl");
-        fradial_distances_refl = fVISTimingParams.get<std::vector<double>>("Distances_radial_refl");
-        fcut_off_pars          = fVISTimingParams.get<std::vector<std::vector<std::vector<double>>>>("Cut_off");
-        ftau_pars              = fVISTimingParams.get<std::vector<std::vector<std::vector<double>>>>("Tau");
+        fdistances_refl        = InterpolationAxis(fVISTimingParams.get<std::vector<double>>("Distances_refl"));
+        fradial_distances_refl = InterpolationAxis(fVISTimingParams.get<std::vector<double>>("Distances_radial_refl"));
+        auto const cut_off_pars = fVISTimingParams.get<std::vector<std::vector<std::vector<double>>>>("Cut_off");
+        auto const tau_pars     = fVISTimingParams.get<std::vector<std::vector<std::vector<double>>>>("Tau");
+        const size_t nDistances = fdistances_refl.size();
+        fVISTimingPars = flattenParameters(cut_off_pars.size(), fradial_distances_refl.size() * nDistances, 2,
+          [&](size_t bin, size_t node, size_t p) {
+            return parameterAt((p == 0) ? cut_off_pars : tau_pars, bin, node / nDistances, node % nDistances,
+                               (p == 0) ? "Cut_off" : "Tau");
+          });
         fvis_vmean             = fVISTimingParams.get<double>("vis_vmean");
         fangle_bin_timing_vis  = fVISTimingParams.get<double>("angle_bin_timing_vis");
       }
@@ -938,7 +1531,7 @@ namespace phot {
       x_v.push_back(elem.first);
       y_v.push_back(elem.second);
     }
-    fL_abs_vuv = std::round(interpolate(x_v, y_v, 9.7, false)); // 9.7 eV: peak of VUV emission spectrum
+    fL_abs_vuv = std::round(InterpolationAxis(x_v).interpolate(y_v.data(), 9.7, false)); // 9.7 eV: peak of VUV emission spectrum
 
     // Load Gaisser-Hillas corrections for VUV semi-analytic hits
     mf::LogInfo("PDFastSimPAR") << "Using VUV visibility parameterization";
@@ -957,36 +1550,17 @@ namespace phot {
       throw cet::exception("PDFastSimPAR")
           << "Both isFlatPDCorr/isFlatPDCorrLat and isDomePDCorr parameters are false, at least one type of parameterisation is required for the semi-analytic light simulation." << "\n";
     }
-    if (fIsFlatPDCorr) {
-        fGHvuvpars_flat          = fVUVHitsParams.get<std::vector<std::vector<double>>>("GH_PARS_flat");
-        fborder_corr_angulo_flat = fVUVHitsParams.get<std::vector<double>>("GH_border_angulo_flat");
-        fborder_corr_flat        = fVUVHitsParams.get<std::vector<std::vector<double>>>("GH_border_flat");
-    }
-    if (fIsFlatPDCorrLat) {
-        fGHvuvpars_flat_lateral  = fVUVHitsParams.get<std::vector<std::vector<std::vector<double>>>>("GH_PARS_flat_lateral");
-        fGH_distances_anode      = fVUVHitsParams.get<std::vector<double>>("GH_distances_anode");
-    }
-    if (fIsDomePDCorr) {
-        fGHvuvpars_dome          = fVUVHitsParams.get<std::vector<std::vector<double>>>("GH_PARS_dome");
-        fborder_corr_angulo_dome = fVUVHitsParams.get<std::vector<double>>("GH_border_angulo_dome");
-        fborder_corr_dome        = fVUVHitsParams.get<std::vector<std::vector<double>>>("GH_border_dome");
-    }
+    if (fIsFlatPDCorr)    fGHCorrFlat    = readGHCorrection("flat", false);
+    if (fIsFlatPDCorrLat) fGHCorrLateral = readGHCorrection("flat", true);
+    if (fIsDomePDCorr)    fGHCorrDome    = readGHCorrection("dome", false);
 
     // Load corrections for VIS semi-analytic hits
     if (fDoReflectedLight) {
       mf::LogInfo("PDFastSimPAR") << "Using VIS (reflected) visibility parameterization";
       fdelta_angulo_vis = fVISHitsParams.get<double>("delta_angulo_vis");
 
-      if (fIsFlatPDCorr) {
-        fvis_distances_x_flat = fVISHitsParams.get<std::vector<double>>("VIS_distances_x_flat");
-        fvis_distances_r_flat = fVISHitsParams.get<std::vector<double>>("VIS_distances_r_flat");
-        fvispars_flat         = fVISHitsParams.get<std::vector<std::vector<std::vector<double>>>>("VIS_correction_flat");
-      }
-      if (fIsDomePDCorr) {
-        fvis_distances_x_dome = fVISHitsParams.get<std::vector<double>>("VIS_distances_x_dome");
-        fvis_distances_r_dome = fVISHitsParams.get<std::vector<double>>("VIS_distances_r_dome");
-        fvispars_dome         = fVISHitsParams.get<std::vector<std::vector<std::vector<double>>>>("VIS_correction_dome");
-      }
+      if (fIsFlatPDCorr) fVISCorrFlat = readVISCorrection("flat");
+      if (fIsDomePDCorr) fVISCorrDome = readVISCorrection("dome");
 
       // cathode dimensions
       fcathode_ydimension = fActiveVolumes[0].SizeY();
@@ -1004,17 +1578,9 @@ namespace phot {
       fdelta_angulo_vis = fVISHitsParams.get<double>("delta_angulo_vis");
       fAnodeReflectivity = fVISHitsParams.get<double>("AnodeReflectivity");
 
-      if (fIsFlatPDCorr) {
-        fvis_distances_x_flat = fVISHitsParams.get<std::vector<double>>("VIS_distances_x_flat");
-        fvis_distances_r_flat = fVISHitsParams.get<std::vector<double>>("VIS_distances_r_flat");
-        fvispars_flat         = fVISHitsParams.get<std::vector<std::vector<std::vector<double>>>>("VIS_correction_flat");
-      }
+      if (fIsFlatPDCorr) fVISCorrFlat = readVISCorrection("flat");
 
-      if (fIsFlatPDCorrLat) {
-        fvis_distances_x_flat_lateral = fVISHitsParams.get<std::vector<double>>("VIS_distances_x_flat_lateral");
-        fvis_distances_r_flat_lateral = fVISHitsParams.get<std::vector<double>>("VIS_distances_r_flat_lateral");
-        fvispars_flat_lateral         = fVISHitsParams.get<std::vector<std::vector<std::vector<double>>>>("VIS_correction_flat_lateral");
-      }
+      if (fIsFlatPDCorrLat) fVISCorrLateral = readVISCorrection("flat_lateral");
 
       // anode dimensions
       fanode_ydimension = fActiveVolumes[0].SizeY();
@@ -1027,25 +1593,131 @@ namespace phot {
     }
   }
 
+  //......................................................................
+  // sorts out, for each reflecting plane and TPC, the optical detectors seeing
+  // its light and the corrections and factors applying to each of them
+  void
+  PDFastSimPAR::prepareReflectionTargets()
+  {
+    // angle bins of each VIS correction table in the corrections of a deposit
+    std::array<VISCorrection const*, 3> const tables{{&fVISCorrFlat, &fVISCorrLateral, &fVISCorrDome}};
+    std::array<size_t, 3> firstBins;
+    fNVISCorrectionBins = 0;
+    for (size_t i = 0; i < tables.size(); ++i) {
+      firstBins[i] = fNVISCorrectionBins;
+      fNVISCorrectionBins += tables[i]->nBins();
+    }
+
+    for (auto& targets : fReflectionTargets)
+      for (auto& sideTargets : targets) sideTargets.clear();
+
+    for (size_t const OpDet : util::counter(fOpDetCenter.size())) {
+      const OpticalDetector opDet = opticalDetector(OpDet);
+
+      // correction table depending on PD type and orientation
+      size_t table = tables.size();
+      if ((opDet.type == 0 || opDet.type == 2) && (fIsFlatPDCorr || fIsFlatPDCorrLat)) {
+        if (opDet.orientation == 1 && fIsFlatPDCorrLat) table = 1; // laterals
+        else if (opDet.orientation == 0 && fIsFlatPDCorr) table = 0; // cathode/anode
+        else mf::LogWarning("PDFastSimPAR") << "Corrections for the type of optical detector " << OpDet << " missing.";
+      }
+      else if (opDet.type == 1 && fIsDomePDCorr) table = 2; // dome PDs
+      else {
+        mf::LogWarning("PDFastSimPAR") << "Invalid optical detector type of " << OpDet
+          << ". 0 = rectangular, 1 = dome, 2 = disk. Or corrections for chosen optical detector type missing.";
+      }
+
+      // field cage transparency factor
+      double transparency = 1.;
+      if (fApplyFieldCageTransparency) {
+        if (opDet.orientation == 1) transparency = fFieldCageTransparencyLateral;
+        else if (opDet.orientation == 0) transparency = fFieldCageTransparencyCathode;
+      }
+
+      ReflectionTarget const target{OpDet, opDet,
+                                    (table < tables.size()) ? tables[table] : nullptr,
+                                    (table < tables.size()) ? firstBins[table] : 0,
+                                    transparency};
+      for (size_t const side : {0, 1}) {
+        geo::Point_t const sidePoint{side == 0 ? -1. : 1., 0., 0.};
+        if (!isOpDetInSameTPC(sidePoint, fOpDetCenter[OpDet])) continue;
+        for (auto& targets : fReflectionTargets) targets[side].push_back(target);
+      }
+    }
+  }
+
+  //......................................................................
+  // Gaisser-Hillas corrections of `type` PDs (`GH_PARS_<type>` and their border
+  // corrections, or `GH_PARS_<type>_lateral` for laterals), flattened
+  PDFastSimPAR::GHCorrection
+  PDFastSimPAR::readGHCorrection(std::string const& type, bool lateral) const
+  {
+    GHCorrection corr;
+    if (lateral) {
+      std::string const name = "GH_PARS_" + type + "_lateral";
+      auto const pars = fVUVHitsParams.get<std::vector<std::vector<std::vector<double>>>>(name);
+      corr.distances = InterpolationAxis(fVUVHitsParams.get<std::vector<double>>("GH_distances_anode"));
+      const size_t nAngles = (pars.empty() || pars[0].empty()) ? 0 : pars[0][0].size();
+      corr.pars = flattenParameters(nAngles, corr.distances.size(), GHCorrection::NPars,
+        [&](size_t j, size_t i, size_t p) { return parameterAt(pars, p, i, j, name); });
+    }
+    else {
+      std::string const name = "GH_PARS_" + type;
+      auto const pars = fVUVHitsParams.get<std::vector<std::vector<double>>>(name);
+      const size_t nAngles = pars.empty() ? 0 : pars[0].size();
+      corr.pars = flattenParameters(nAngles, 1, GHCorrection::NPars,
+        [&](size_t j, size_t, size_t p) { return parameterAt(pars, p, j, name); });
+
+      std::string const borderName = "GH_border_" + type;
+      auto const slopes = fVUVHitsParams.get<std::vector<std::vector<double>>>(borderName);
+      corr.borderAngles = InterpolationAxis(fVUVHitsParams.get<std::vector<double>>("GH_border_angulo_" + type));
+      corr.borderSlopes = flattenParameters(1, corr.borderAngles.size(), GHCorrection::NBorderPars,
+        [&](size_t, size_t i, size_t p) { return parameterAt(slopes, p, i, borderName); });
+    }
+    return corr;
+  }
+
+  //......................................................................
+  // VIS corrections of `type` PDs (`VIS_correction_<type>`), flattened
+  PDFastSimPAR::VISCorrection
+  PDFastSimPAR::readVISCorrection(std::string const& type) const
+  {
+    VISCorrection corr;
+    std::string const name = "VIS_correction_" + type;
+    auto const pars = fVISHitsParams.get<std::vector<std::vector<std::vector<double>>>>(name);
+    corr.distancesX = InterpolationAxis(fVISHitsParams.get<std::vector<double>>("VIS_distances_x_" + type));
+    corr.distancesR = InterpolationAxis(fVISHitsParams.get<std::vector<double>>("VIS_distances_r_" + type));
+    const size_t nX = corr.distancesX.size();
+    corr.pars = flattenParameters(pars.size(), corr.distancesR.size() * nX, 1,
+      [&](size_t k, size_t node, size_t) { return parameterAt(pars, k, node / nX, node % nX, name); });
+    return corr;
+  }
+
   //......................................................................
   // VUV semi-analytic hits calculation
   void
-  PDFastSimPAR::detectedDirectHits(std::map<size_t, int>& DetectedNumFast,
-                                   std::map<size_t, int>& DetectedNumSlow,
+  PDFastSimPAR::detectedDirectHits(std::vector<int>& DetectedNumFast,
+                                   std::vector<int>& DetectedNumSlow,
                                    const double NumFast,
                                    const double NumSlow,
-                                   geo::Point_t const& ScintPoint)
+                                   geo::Point_t const& ScintPoint,
+                                   RandomEngines& rng,
+                                   std::vector<size_t>& OpDets)
   {
-    for (size_t const OpDet : util::counter(nOpDets)) {
+    if (fExpectedPhotonThreshold > 0.) selectOpDets(ScintPoint, NumFast + NumSlow, OpDets);
+    else {
+      OpDets.resize(nOpDets);
+      std::iota(OpDets.begin(), OpDets.end(), 0);
+    }
+
+    for (size_t const OpDet : OpDets) {
       if (!isOpDetInSameTPC(ScintPoint, fOpDetCenter[OpDet])) continue;
 
       // set detector struct for solid angle function
-      const PDFastSimPAR::OpticalDetector op{
-        fOpDetHeight[OpDet], fOpDetLength[OpDet],
-        fOpDetCenter[OpDet], fOpDetType[OpDet], fOpDetOrientation[OpDet]};
+      const PDFastSimPAR::OpticalDetector op = opticalDetector(OpDet);
 
-      std::vector<int> DetThis(2, 0);
-      VUVHits(NumFast, NumSlow, ScintPoint, op, DetThis);
+      std::array<int, 2> DetThis{0, 0};
+      VUVHits(NumFast, NumSlow, ScintPoint, op, DetThis, rng);
 
       DetectedNumFast[OpDet] = DetThis[0];
       DetectedNumSlow[OpDet] = DetThis[1];
@@ -1061,8 +1733,10 @@ namespace phot {
                         const double NumSlow,
                         geo::Point_t const& ScintPoint,
                         OpticalDetector const& opDet,
-                        std::vector<int>& DetThis)
+                        std::array<int, 2>& DetThis,
+                        RandomEngines& rng)
   {
+    LARSIM_TRACE_ZONE("PDFastSimPAR::VUVHits");
     // distance and angle between ScintPoint and OpDetPoint
     geo::Vector_t const relative = ScintPoint - opDet.OpDetPoint;
     const double distance = relative.R();
@@ -1072,27 +1746,10 @@ namespace phot {
     // const double theta = std::acos(cosine) * 180. / CLHEP::pi;
     const double theta = fast_acos(cosine) * 180. / CLHEP::pi;
 
-    double solid_angle = 0.;
-    // ARAPUCAS/Bars (rectangle)
-    if (opDet.type == 0) {
-      // get scintillation point coordinates relative to arapuca window centre
-      geo::Vector_t const abs_relative{
-        std::abs(relative.X()), std::abs(relative.Y()), std::abs(relative.Z())};
-      solid_angle = Rectangle_SolidAngle(Dims{opDet.h, opDet.w}, abs_relative, opDet.orientation);
-    }
-    // PMTs (dome)
-    else if (opDet.type == 1) {
-      solid_angle = Omega_Dome_Model(distance, theta);
-    }
-    // PMTs (disk)
-    else if (opDet.type == 2) {
-      const double zy_offset = std::sqrt(relative.Y() * relative.Y() + relative.Z() * relative.Z());
-      const double x_distance = std::abs(relative.X());
-      solid_angle = Disk_SolidAngle(zy_offset, x_distance, fradius);
-    }
-    else {
-      std::cout << "Error: Invalid optical detector type. 0 = rectangular, 1 = dome, 2 = disk" << std::endl;
-    }
+    // get scintillation point coordinates relative to optical detector centre
+    geo::Vector_t const abs_relative{
+      std::abs(relative.X()), std::abs(relative.Y()), std::abs(relative.Z())};
+    const double solid_angle = SolidAngle(opDet, abs_relative);
 
     // calculate number of photons hits by geometric acceptance for fast and slow components
     // accounting for solid angle and LAr absorbtion length
@@ -1109,60 +1766,38 @@ namespace phot {
     // radial distance from centre of detector (Y-Z)
     double r = std::hypot(ScintPoint.Y() - fcathode_centre[1], ScintPoint.Z() - fcathode_centre[2]);
 
-    double pars_ini[4] = {0, 0, 0, 0};
-    double s1 = 0; double s2 = 0; double s3 = 0;
+    double pars_ini[GHCorrection::NPars] = {0, 0, 0, 0};
+    double s[GHCorrection::NBorderPars] = {0, 0, 0};
     // flat PDs
     if ((opDet.type == 0 || opDet.type == 2) && (fIsFlatPDCorr || fIsFlatPDCorrLat)){
       if (opDet.orientation == 1 && fIsFlatPDCorrLat) { // laterals, alternate parameterisation method
         // distance to anode plane
         double d_anode = std::abs(fanode_centre[0] - ScintPoint.X()); 
         
-        // build arrays for interpolation
-        int n_distances = fGH_distances_anode.size();
-        std::vector<double> p1, p2, p3, p4;
-        p1.reserve(n_distances); p2.reserve(n_distances); p3.reserve(n_distances); p4.reserve(n_distances);
-        for (int i = 0; i < n_distances; i++) {
-          p1.push_back(fGHvuvpars_flat_lateral[0][i][j]);
-          p2.push_back(fGHvuvpars_flat_lateral[1][i][j]);
-          p3.push_back(fGHvuvpars_flat_lateral[2][i][j]);
-          p4.push_back(fGHvuvpars_flat_lateral[3][i][j]);
-        }
-
         // interpolate in distance to anode
-        pars_ini[0] = interpolate(fGH_distances_anode, p1, d_anode, false);
-        pars_ini[1] = interpolate(fGH_distances_anode, p2, d_anode, false);
-        pars_ini[2] = interpolate(fGH_distances_anode, p3, d_anode, false);
-        pars_ini[3] = interpolate(fGH_distances_anode, p4, d_anode, false);
-      
+        InterpolationAxis const& distances = fGHCorrLateral.distances;
+        double const* pars = fGHCorrLateral.binPars(j);
+        const size_t i = distances.interval(d_anode);
+        for (size_t p = 0; p < GHCorrection::NPars; ++p)
+          pars_ini[p] = distances.interpolateInInterval(i, pars + p, d_anode, false, GHCorrection::NPars);
       }
       else if (opDet.orientation == 0 && fIsFlatPDCorr) { // cathode/anode, default parameterisation method
-        pars_ini[0] = fGHvuvpars_flat[0][j];
-        pars_ini[1] = fGHvuvpars_flat[1][j];
-        pars_ini[2] = fGHvuvpars_flat[2][j];
-        pars_ini[3] = fGHvuvpars_flat[3][j];
-        s1 = interpolate( fborder_corr_angulo_flat, fborder_corr_flat[0], theta, true);
-        s2 = interpolate( fborder_corr_angulo_flat, fborder_corr_flat[1], theta, true);
-        s3 = interpolate( fborder_corr_angulo_flat, fborder_corr_flat[2], theta, true);
+        std::copy_n(fGHCorrFlat.binPars(j), GHCorrection::NPars, pars_ini);
+        fGHCorrFlat.borderSlopesAt(theta, s);
       }
       else std::cout << "Error: corrections for chosen optical detector type missing." << std::endl;
     }
     // dome PDs
     else if (opDet.type == 1 && fIsDomePDCorr) {
-      pars_ini[0] = fGHvuvpars_dome[0][j];
-      pars_ini[1] = fGHvuvpars_dome[1][j];
-      pars_ini[2] = fGHvuvpars_dome[2][j];
-      pars_ini[3] = fGHvuvpars_dome[3][j];
-      s1 = interpolate( fborder_corr_angulo_dome, fborder_corr_dome[0], theta, true);
-      s2 = interpolate( fborder_corr_angulo_dome, fborder_corr_dome[1], theta, true);
-      s3 = interpolate( fborder_corr_angulo_dome, fborder_corr_dome[2], theta, true);
+      std::copy_n(fGHCorrDome.binPars(j), GHCorrection::NPars, pars_ini);
+      fGHCorrDome.borderSlopesAt(theta, s);
     }
     else std::cout << "Error: Invalid optical detector type. 0 = rectangular, 1 = dome, 2 = disk. Or corrections for chosen optical detector type missing." << std::endl;
 
     // add border correction to parameters
-    pars_ini[0] = pars_ini[0] + s1 * r;
-    pars_ini[1] = pars_ini[1] + s2 * r;
-    pars_ini[2] = pars_ini[2] + s3 * r;
-    pars_ini[3] = pars_ini[3];
+    pars_ini[0] = pars_ini[0] + s[0] * r;
+    pars_ini[1] = pars_ini[1] + s[1] * r;
+    pars_ini[2] = pars_ini[2] + s[2] * r;
 
     // calculate correction
     double GH_correction = Gaisser_Hillas(distance, pars_ini);
@@ -1174,19 +1809,21 @@ namespace phot {
     }
 
     // calculate number photons for fast and slow componenets
-    DetThis[0] = fRandPoissPhot->fire(GH_correction * hits_geo_fast / cosine);
-    DetThis[1] = fRandPoissPhot->fire(GH_correction * hits_geo_slow / cosine);
+    DetThis[0] = rng.poisson.fire(GH_correction * hits_geo_fast / cosine);
+    DetThis[1] = rng.poisson.fire(GH_correction * hits_geo_slow / cosine);
 
   }
 
   //......................................................................
   // VIS hits semi-analytic model calculation
   void
-  PDFastSimPAR::detectedReflecHits(std::map<size_t, int>& ReflDetectedNumFast,
-                                   std::map<size_t, int>& ReflDetectedNumSlow,
+  PDFastSimPAR::detectedReflecHits(std::vector<int>& ReflDetectedNumFast,
+                                   std::vector<int>& ReflDetectedNumSlow,
                                    const double NumFast,
                                    const double NumSlow,
                                    geo::Point_t const& ScintPoint,
+                                   std::vector<double>& visCorrections,
+                                   RandomEngines& rng,
                                    bool AnodeMode)
   {
     // 1). calculate total number of hits of VUV photons on
@@ -1224,24 +1861,18 @@ namespace phot {
     // determine Gaisser-Hillas correction including border effects
     // use flat correction
     double r = std::hypot(ScintPoint.Y() - fcathode_centre[1], ScintPoint.Z() - fcathode_centre[2]);
-    double pars_ini[4] = {0, 0, 0, 0};
-    double s1 = 0; double s2 = 0; double s3 = 0;
+    double pars_ini[GHCorrection::NPars] = {0, 0, 0, 0};
+    double s[GHCorrection::NBorderPars] = {0, 0, 0};
     if(fIsFlatPDCorr) {
-      pars_ini[0] = fGHvuvpars_flat[0][0];
-      pars_ini[1] = fGHvuvpars_flat[1][0];
-      pars_ini[2] = fGHvuvpars_flat[2][0];
-      pars_ini[3] = fGHvuvpars_flat[3][0];
-      s1 = interpolate( fborder_corr_angulo_flat, fborder_corr_flat[0], 0, true);
-      s2 = interpolate( fborder_corr_angulo_flat, fborder_corr_flat[1], 0, true);
-      s3 = interpolate( fborder_corr_angulo_flat, fborder_corr_flat[2], 0, true);
+      std::copy_n(fGHCorrFlat.binPars(0), GHCorrection::NPars, pars_ini);
+      fGHCorrFlat.borderSlopesAt(0, s);
     }
     else std::cout << "Error: flat optical detector VUV correction required for reflected semi-analytic hits." << std::endl;
 
     // add border correction
-    pars_ini[0] = pars_ini[0] + s1 * r;
-    pars_ini[1] = pars_ini[1] + s2 * r;
-    pars_ini[2] = pars_ini[2] + s3 * r;
-    pars_ini[3] = pars_ini[3];
+    pars_ini[0] = pars_ini[0] + s[0] * r;
+    pars_ini[1] = pars_ini[1] + s[1] * r;
+    pars_ini[2] = pars_ini[2] + s[2] * r;
 
 
     // calculate corrected number of hits
@@ -1249,38 +1880,39 @@ namespace phot {
     const double cathode_hits_rec_fast = GH_correction * cathode_hits_geo_fast;
     const double cathode_hits_rec_slow = GH_correction * cathode_hits_geo_slow;
 
+    // VIS corrections of each table and angle bin: they only depend on the
+    // distance from the plane and on the radial distance, and are shared by
+    // all the detectors
+    double d_c = std::abs(ScintPoint.X() - plane_depth);
+    visCorrections.resize(fNVISCorrectionBins);
+    size_t firstBin = 0;
+    for (VISCorrection const* table : {&fVISCorrFlat, &fVISCorrLateral, &fVISCorrDome}) {
+      table->corrections(d_c, r, visCorrections.data() + firstBin);
+      firstBin += table->nBins();
+    }
+
     // detemine hits on each PD
     const geo::Point_t hotspot = {plane_depth, ScintPoint.Y(), ScintPoint.Z()};
-    for (size_t const OpDet : util::counter(nOpDets)) {
-      if (!isOpDetInSameTPC(ScintPoint, fOpDetCenter[OpDet])) continue;
-
-      // set detector struct for solid angle function
-      const  PDFastSimPAR::OpticalDetector op{
-        fOpDetHeight[OpDet], fOpDetLength[OpDet],
-        fOpDetCenter[OpDet], fOpDetType[OpDet], fOpDetOrientation[OpDet]};
+    for (ReflectionTarget const& target : fReflectionTargets[AnodeMode][ScintPoint.X() < 0. ? 0 : 1]) {
+      std::array<int, 2> ReflDetThis{0, 0};
+      VISHits(target, visCorrections.data(), cathode_hits_rec_fast, cathode_hits_rec_slow, hotspot, ReflDetThis, rng, AnodeMode);
 
-      std::vector<int> ReflDetThis(2, 0);
-      VISHits(ScintPoint, op, cathode_hits_rec_fast, cathode_hits_rec_slow, hotspot, ReflDetThis, AnodeMode);
-
-      ReflDetectedNumFast[OpDet] = ReflDetThis[0];
-      ReflDetectedNumSlow[OpDet] = ReflDetThis[1];
+      ReflDetectedNumFast[target.OpDet] = ReflDetThis[0];
+      ReflDetectedNumSlow[target.OpDet] = ReflDetThis[1];
     }
   }
 
   void
-  PDFastSimPAR::VISHits(geo::Point_t const& ScintPoint,
-                        OpticalDetector const& opDet,
+  PDFastSimPAR::VISHits(ReflectionTarget const& target,
+                        double const* visCorrections,
                         const double cathode_hits_rec_fast,
                         const double cathode_hits_rec_slow,
                         geo::Point_t const& hotspot,
-                        std::vector<int> &ReflDetThis,
+                        std::array<int, 2> &ReflDetThis,
+                        RandomEngines& rng,
                         bool AnodeMode)
   {
-
-    // set correct plane_depth
-    double plane_depth;
-    if (AnodeMode) plane_depth = fanode_plane_depth;
-    else plane_depth = ScintPoint.X() < 0. ? -fplane_depth : fplane_depth;
+    OpticalDetector const& opDet = target.opDet;
 
     // calculate number of these hits which reach the optical
     // detector from the hotspot using solid angle:
@@ -1302,29 +1934,11 @@ namespace phot {
     const double theta_vis = fast_acos(cosine_vis) * 180. / CLHEP::pi;
 
     // calculate solid angle of optical channel
-    double solid_angle_detector = 0.;
-    // ARAPUCAS/Bars (rectangle)
-    if (opDet.type == 0) {
-      // get hotspot coordinates relative to opDet
-      geo::Vector_t const abs_emission_relative{std::abs(emission_relative.X()),
-                                                std::abs(emission_relative.Y()),
-                                                std::abs(emission_relative.Z())};
-      solid_angle_detector = Rectangle_SolidAngle(Dims{opDet.h, opDet.w}, abs_emission_relative, opDet.orientation);
-    }
-    // PMTS (dome)
-    else if (opDet.type == 1) {
-      solid_angle_detector = Omega_Dome_Model(distance_vis, theta_vis);
-    }
-    // PMTs (disk)
-    else if (opDet.type == 2) {
-      const double zy_offset = std::sqrt(emission_relative.Y() * emission_relative.Y() +
-                                         emission_relative.Z() * emission_relative.Z());
-      const double x_distance = std::abs(emission_relative.X());
-      solid_angle_detector = Disk_SolidAngle(zy_offset, x_distance, fradius);
-    }
-    else {
-      std::cout << "Error: Invalid optical detector type. 0 = rectangular, 1 = dome, 2 = disk" << std::endl;
-    }
+    // get hotspot coordinates relative to opDet
+    geo::Vector_t const abs_emission_relative{std::abs(emission_relative.X()),
+                                              std::abs(emission_relative.Y()),
+                                              std::abs(emission_relative.Z())};
+    const double solid_angle_detector = SolidAngle(opDet, abs_emission_relative);
 
     // calculate number of hits via geometeric acceptance
     double hits_geo_fast = (solid_angle_detector / (2. * CLHEP::pi)) *
@@ -1332,93 +1946,21 @@ namespace phot {
     double hits_geo_slow = (solid_angle_detector / (2. * CLHEP::pi)) *
                       cathode_hits_rec_slow; // 2*pi due to presence of reflective foils
 
-    // determine correction factor, depending on PD type
+    // determine correction factor, depending on PD type,
+    // from the corrections of this deposit
     const size_t k = (theta_vis / fdelta_angulo_vis);         // off-set angle bin
-    double r = std::hypot(ScintPoint.Y() - fcathode_centre[1], ScintPoint.Z() - fcathode_centre[2]);
-    double d_c = std::abs(ScintPoint.X() - plane_depth);       // distance to cathode
     double border_correction = 0;
-    // flat PDs
-    if ((opDet.type == 0 || opDet.type == 2) && (fIsFlatPDCorr || fIsFlatPDCorrLat)){
-
-      // select correct parameter set depending on PD orientation
-      std::vector<double> vis_distances_x;
-      std::vector<double> vis_distances_r;
-      std::vector<std::vector<std::vector<double>>> vispars;
-      if (opDet.orientation == 1 && fIsFlatPDCorrLat) { // laterals
-        vis_distances_x = fvis_distances_x_flat_lateral;
-        vis_distances_r = fvis_distances_r_flat_lateral;
-        vispars = fvispars_flat_lateral;
-      }
-      else if (opDet.orientation == 0 && fIsFlatPDCorr) { // cathode/anode
-        vis_distances_x = fvis_distances_x_flat;
-        vis_distances_r = fvis_distances_r_flat;
-        vispars = fvispars_flat;
-      }
-      else std::cout << "Error: corrections for chosen optical detector type missing." << std::endl;
-      
-      // interpolate in d_c for each r bin
-      const size_t nbins_r = vispars[k].size();
-      std::vector<double> interp_vals(nbins_r, 0.0);
-      {
-        size_t idx = 0;
-        size_t size = vis_distances_x.size();
-        if (d_c >= vis_distances_x[size - 2])
-          idx = size - 2;
-        else {
-          while (d_c > vis_distances_x[idx + 1])
-            idx++;
-        }
-        for (size_t i = 0; i < nbins_r; ++i) {
-          interp_vals[i] = interpolate(vis_distances_x,
-                                       vispars[k][i],
-                                       d_c,
-                                       false,
-                                       idx);
-        }
-      }
-      // interpolate in r
-      border_correction = interpolate(vis_distances_r, interp_vals, r, false); 
-    }
-    // dome PDs
-    else if (opDet.type == 1 && fIsDomePDCorr) {
-      // interpolate in d_c for each r bin
-      const size_t nbins_r = fvispars_dome[k].size();
-      std::vector<double> interp_vals(nbins_r, 0.0);
-      {
-        size_t idx = 0;
-        size_t size = fvis_distances_x_dome.size();
-        if (d_c >= fvis_distances_x_dome[size - 2])
-          idx = size - 2;
-        else {
-          while (d_c > fvis_distances_x_dome[idx + 1])
-            idx++;
-        }
-        for (size_t i = 0; i < nbins_r; ++i) {
-          interp_vals[i] = interpolate(fvis_distances_x_dome,
-                                       fvispars_dome[k][i],
-                                       d_c,
-                                       false,
-                                       idx);
-        }
-      }
-      // interpolate in r
-      border_correction = interpolate(fvis_distances_r_dome, interp_vals, r, false);
-    }
-    else {
-     std::cout << "Error: Invalid optical detector type. 0 = rectangular, 1 = dome, 2 = disk. Or corrections for chosen optical detector type missing." << std::endl;
-    }
+    if (target.correction && k < target.correction->nBins())
+      border_correction = visCorrections[target.firstBin + k];
 
     // apply anode reflectivity factor
     if (AnodeMode) border_correction = border_correction * fAnodeReflectivity;
 
     // apply field cage transparency factor 
-    if (fApplyFieldCageTransparency) {
-      if (opDet.orientation == 1) border_correction = border_correction * fFieldCageTransparencyLateral;
-      else if (opDet.orientation == 0) border_correction = border_correction * fFieldCageTransparencyCathode;
-    }
+    border_correction = border_correction * target.transparency;
 
-    ReflDetThis[0] = fRandPoissPhot->fire(border_correction * hits_geo_fast / cosine_vis);
-    ReflDetThis[1] = fRandPoissPhot->fire(border_correction * hits_geo_slow / cosine_vis);
+    ReflDetThis[0] = rng.poisson.fire(border_correction * hits_geo_fast / cosine_vis);
+    ReflDetThis[1] = rng.poisson.fire(border_correction * hits_geo_slow / cosine_vis);
   }
 
 
@@ -1441,8 +1983,11 @@ namespace phot {
   PDFastSimPAR::propagationTime(std::vector<double>& arrival_time_dist,
                                 geo::Point_t const& x0,
                                 const size_t OpChannel,
-                                bool Reflected)
+                                RandomEngines& rng,
+                                bool Reflected,
+                                double const* visSmearing)
   {
+    LARSIM_TRACE_ZONE("PDFastSimPAR::propagationTime");
     if (fIncludePropTime && !fGeoPropTimeOnly) {
       // Get VUV photons arrival time distribution from the parametrization
       geo::Point_t const& opDetCenter = fOpDetCenter[OpChannel];
@@ -1454,11 +1999,10 @@ namespace phot {
       
         double theta = fast_acos(cosine)*180./CLHEP::pi;
         int angle_bin = theta/fangle_bin_timing_vuv;
-        getVUVTimes(arrival_time_dist, distance, angle_bin); // in ns
+        getVUVTimes(arrival_time_dist, distance, angle_bin, rng); // in ns
       }
       else {
-        getVISTimes(arrival_time_dist, geo::vect::toTVector3(x0),
-                    geo::vect::toTVector3(opDetCenter)); // in ns
+        getVISTimes(arrival_time_dist, x0, opDetCenter, visSmearing, rng); // in ns
       }
     }
     else if (fIncludePropTime && fGeoPropTimeOnly && !Reflected) {
@@ -1476,7 +2020,7 @@ namespace phot {
   //......................................................................
   // VUV arrival times calculation function
   void
-  PDFastSimPAR::getVUVTimes(std::vector<double>& arrivalTimes, const double distance, const size_t angle_bin)
+  PDFastSimPAR::getVUVTimes(std::vector<double>& arrivalTimes, const double distance, const size_t angle_bin, RandomEngines& rng)
   {
     if (distance < fmin_d) {
       // times are fixed shift i.e. direct path only
@@ -1488,11 +2032,12 @@ namespace phot {
     else { // distance >= 25cm
       // determine nearest parameterisation in discretisation
       int index = std::round((distance - fmin_d) / fstep_size);
+      const size_t iTable = VUVTimingTableIndex(index, angle_bin);
       // check whether required parameterisation has been generated, generating if not
-       if (VUV_timing[angle_bin][index].GetNdim() == 0) { generateParam(index, angle_bin); }
+      if (!fVUVTimingTable.isFilled(iTable)) { generateParam(index, angle_bin); }
       // randomly sample parameterisation for each photon
       for (size_t i = 0; i < arrivalTimes.size(); ++i) {
-        arrivalTimes[i] = VUV_timing[angle_bin][index].GetRandom(VUV_min[angle_bin][index], VUV_max[angle_bin][index]);
+        arrivalTimes[i] = fVUVTimingTable.sample(iTable, CLHEP::RandFlat::shoot(&rng.scintTime));
       }
     }
   }
@@ -1509,12 +2054,49 @@ namespace phot {
     }
   }
 
+  //......................................................................
+  // VIS timing smearing parameters of all the angular bins, for light emitted
+  // at `ScintPoint`: they depend on the angle with each optical detector only
+  // through the bin, so the deposit interpolates them once for all of them
+  void
+  PDFastSimPAR::VISTimingSmearing(geo::Point_t const& ScintPoint, std::vector<double>& smearing) const
+  {
+    // set plane_depth for correct TPC:
+    const double plane_depth = (ScintPoint.X() < 0) ? -fplane_depth : fplane_depth;
+    const double distance_cathode_plane = std::abs(plane_depth - ScintPoint.X());
+    // radial distance from centre of TPC (y,z plane)
+    const double r = std::sqrt(std::pow(ScintPoint.Y() - fcathode_centre[1], 2) + std::pow(ScintPoint.Z() - fcathode_centre[2], 2));
+
+    // cut-off and tau
+    // interpolate in d_c for the two r nodes around r, then in r
+    const size_t nDistances = fdistances_refl.size();
+    const size_t nRadii = fradial_distances_refl.size();
+    const size_t nTheta = fVISTimingPars.size() / (nRadii * nDistances * 2);
+    const size_t id = fdistances_refl.interval(distance_cathode_plane);
+    const size_t ir = fradial_distances_refl.interval(r);
+    smearing.resize(2 * nTheta);
+    for (size_t theta_bin = 0; theta_bin < nTheta; ++theta_bin) {
+      double const* pars = fVISTimingPars.data() + theta_bin * nRadii * nDistances * 2;
+      double interp_vals[2][2]; // [r node][cut-off, tau]
+      for (size_t n = 0; n < 2; ++n) {
+        for (size_t p = 0; p < 2; ++p) {
+          interp_vals[n][p] = fdistances_refl.interpolateInInterval(
+            id, pars + (ir + n) * nDistances * 2 + p, distance_cathode_plane, true, 2);
+        }
+      }
+      smearing[2 * theta_bin] = fradial_distances_refl.interpolateBetween(ir, interp_vals[0][0], interp_vals[1][0], r, true);
+      smearing[2 * theta_bin + 1] = fradial_distances_refl.interpolateBetween(ir, interp_vals[0][1], interp_vals[1][1], r, true);
+    }
+  }
+
   //......................................................................
   // VIS arrival times calculation functions
   void
   PDFastSimPAR::getVISTimes(std::vector<double>& arrivalTimes,
-                            const TVector3 &ScintPoint,
-                            const TVector3 &OpDetPoint)
+                            geo::Point_t const& ScintPoint,
+                            geo::Point_t const& OpDetPoint,
+                            double const* smearing,
+                            RandomEngines& rng)
   {
     // *************************************************************************************************
     //     Calculation of earliest arrival times and corresponding unsmeared
@@ -1523,33 +2105,32 @@ namespace phot {
 
     // set plane_depth for correct TPC:
     double plane_depth;
-    if (ScintPoint[0] < 0) { plane_depth = -fplane_depth; }
+    if (ScintPoint.X() < 0) { plane_depth = -fplane_depth; }
     else {
       plane_depth = fplane_depth;
     }
 
     // calculate point of reflection for shortest path
-    TVector3 bounce_point(plane_depth,ScintPoint[1],ScintPoint[2]);
+    geo::Point_t const bounce_point{plane_depth, ScintPoint.Y(), ScintPoint.Z()};
 
     // calculate distance travelled by VUV light and by vis light
-    double VUVdist = (bounce_point - ScintPoint).Mag();
-    double Visdist = (OpDetPoint - bounce_point).Mag();
+    double VUVdist = (bounce_point - ScintPoint).R();
+    double Visdist = (OpDetPoint - bounce_point).R();
 
     // calculate times taken by VUV part of path
     int angle_bin_vuv = 0; // on-axis by definition
-    getVUVTimes(arrivalTimes, VUVdist, angle_bin_vuv);
+    getVUVTimes(arrivalTimes, VUVdist, angle_bin_vuv, rng);
 
     // sum parts to get total transport times times
+    double const vis_time = Visdist / fvis_vmean;
     for (size_t i = 0; i < arrivalTimes.size(); ++i) {
-      arrivalTimes[i] += Visdist / fvis_vmean;
+      arrivalTimes[i] += vis_time;
     }
 
     // *************************************************************************************************
     //      Smearing of arrival time distribution
     // *************************************************************************************************
     // calculate fastest time possible
-    // vis part
-    double vis_time = Visdist / fvis_vmean;
     // vuv part
     double vuv_time;
     if (VUVdist < fmin_d) {
@@ -1559,43 +2140,24 @@ namespace phot {
       // find index of required parameterisation
       const size_t index = std::round((VUVdist - fmin_d) / fstep_size);
       // find shortest time
-      vuv_time = VUV_min[angle_bin_vuv][index];
+      vuv_time = fVUVTimingTable.lower(VUVTimingTableIndex(index, angle_bin_vuv));
     }
     // sum
     double fastest_time = vis_time + vuv_time;
 
     // calculate angle theta between bound_point and optical detector
-    double cosine_theta = std::abs(OpDetPoint[0] - bounce_point[0]) / Visdist;
+    double cosine_theta = std::abs(OpDetPoint.X() - bounce_point.X()) / Visdist;
     double theta = fast_acos(cosine_theta) * 180. / CLHEP::pi;
 
-    // determine smearing parameters using interpolation of generated points:
+    // smearing parameters of the angular bin, from the table of the deposit
+    // (see `VISTimingSmearing()`):
     // 1). tau = exponential smearing factor, varies with distance and angle
     // 2). cutoff = largest smeared time allowed, preventing excessively large
     //     times caused by exponential distance to cathode
-    double distance_cathode_plane = std::abs(plane_depth - ScintPoint[0]);
-    // angular bin
-    size_t theta_bin = theta / fangle_bin_timing_vis;
-    // radial distance from centre of TPC (y,z plane)
-    double r = std::sqrt(std::pow(ScintPoint[1] - fcathode_centre[1], 2) + std::pow(ScintPoint[2] - fcathode_centre[2], 2));
-
-    // cut-off and tau
-    // cut-off
-    // interpolate in d_c for each r bin
-    std::vector<double> interp_vals(fcut_off_pars[theta_bin].size(), 0.0);
-    for (size_t i = 0; i < fcut_off_pars[theta_bin].size(); i++){
-        interp_vals[i] = interpolate(fdistances_refl, fcut_off_pars[theta_bin][i], distance_cathode_plane, true);
-    }
-    // interpolate in r
-    double cutoff = interpolate(fradial_distances_refl, interp_vals, r, true);
-
-    // tau
-    // interpolate in x for each r bin
-    std::vector<double> interp_vals_tau(ftau_pars[theta_bin].size(), 0.0);
-    for (size_t i = 0; i < ftau_pars[theta_bin].size(); i++){
-        interp_vals_tau[i] = interpolate(fdistances_refl, ftau_pars[theta_bin][i], distance_cathode_plane, true);
-    }
-    // interpolate in r
-    double tau = interpolate(fradial_distances_refl, interp_vals_tau, r, true);
+    const size_t nTheta = fVISTimingPars.size() / (fradial_distances_refl.size() * fdistances_refl.size() * 2);
+    const size_t theta_bin = std::min(static_cast<size_t>(theta / fangle_bin_timing_vis), nTheta - 1);
+    double const cutoff = smearing[2 * theta_bin];
+    double const tau = smearing[2 * theta_bin + 1];
 
     // apply smearing:
     for (size_t i = 0; i < arrivalTimes.size(); ++i) {
@@ -1615,7 +2177,7 @@ namespace phot {
           }
           else {
             // generate random number in appropriate range
-            double x = CLHEP::RandFlat::shoot(&fScintTimeEngine, 0.5, 1.0);
+            double x = CLHEP::RandFlat::shoot(&rng.scintTime, 0.5, 1.0);
             // apply the exponential smearing
             arrival_time_smeared =
               arrivalTimes[i] + (arrivalTimes[i] - fastest_time) * (std::pow(x, -tau) - 1);
@@ -1648,10 +2210,8 @@ namespace phot {
     // Getting the landau parameters from the time parametrization
     std::array<double, 3> pars_landau;
     interpolate3(pars_landau,
-                 fparameters[0][0],
-                 fparameters[2][angle_bin],
-                 fparameters[3][angle_bin],
-                 fparameters[1][angle_bin],
+                 fVUVTimingLandauDistances,
+                 fVUVTimingLandauPars.data() + angle_bin * fVUVTimingLandauDistances.size() * 3,
                  distance_in_cm,
                  true);
     // Deciding which time model to use (depends on the distance)
@@ -1668,8 +2228,10 @@ namespace phot {
       // Exponential parameters
       double pars_expo[2];
       // Getting the exponential parameters from the time parametrization
-      pars_expo[1] = interpolate(fparameters[4][0], fparameters[5][angle_bin], distance_in_cm, true);
-      pars_expo[0] = interpolate(fparameters[4][0], fparameters[6][angle_bin], distance_in_cm, true);
+      double const* expo = fVUVTimingExpoPars.data() + angle_bin * fVUVTimingExpoDistances.size() * 2;
+      const size_t i = fVUVTimingExpoDistances.interval(distance_in_cm);
+      pars_expo[1] = fVUVTimingExpoDistances.interpolateInInterval(i, expo, distance_in_cm, true, 2);
+      pars_expo[0] = fVUVTimingExpoDistances.interpolateInInterval(i, expo + 1, distance_in_cm, true, 2);
       pars_expo[0] *= pars_landau[2];
       pars_expo[0] = std::log(pars_expo[0]);
       // this is to find the intersection point between the two functions:
@@ -1718,93 +2280,38 @@ namespace phot {
     // min
     double min = t_direct_min;
 
-    // store TF1 and min/max, this allows identical TF1 to be used every time sampling
-    // the first call of GetRandom generates the timing sampling and stores it in the TF1 object, this is the slow part
-    // all subsequent calls check if it has been generated previously and are ~100+ times quicker
-    VUV_timing[angle_bin][index] = fVUVTiming;
-    VUV_max[angle_bin][index] = max;
-    VUV_min[angle_bin][index] = min;
+    // tabulate the inverse cumulative distribution in [min, max], sampling the
+    // parameterisation with the same granularity TF1::GetRandom() would use;
+    // all subsequent samplings are a table lookup
+    fVUVTimingTable.fill(VUVTimingTableIndex(index, angle_bin),
+                         [&fVUVTiming](double t) { return fVUVTiming.Eval(t); },
+                         min, max, fsampling);
   }
 
   //======================================================================
-  //   Returns interpolated value at x from parallel arrays ( xData, yData )
-  //   Assumes that xData has at least two elements, is sorted and is strictly
-  //   monotonic increasing boolean argument extrapolate determines behaviour
-  //   beyond ends of array (if needed)
-  double
-  PDFastSimPAR::interpolate(const std::vector<double>& xData,
-                            const std::vector<double>& yData,
-                            double x,
-                            bool extrapolate,
-                            size_t i)
-  {
-    if (i == 0) {
-      size_t size = xData.size();
-      if (x >= xData[size - 2]) { // special case: beyond right end
-        i = size - 2;
-      }
-      else {
-        while (x > xData[i + 1])
-          i++;
-      }
-    }
-    double xL = xData[i];
-    double xR = xData[i + 1];
-    double yL = yData[i];
-    double yR = yData[i + 1]; // points on either side (unless beyond ends)
-    if (!extrapolate) {       // if beyond ends of array and not extrapolating
-      if (x < xL) return yL;
-      if (x > xR) return yL;
-    }
-    const double dydx = (yR - yL) / (xR - xL); // gradient
-    return yL + dydx * (x - xL);               // linear interpolation
-  }
-
+  //   Interpolates at x the three parameters tabulated on each node of xData,
+  //   stored as yData[node][parameter]; boolean argument extrapolate
+  //   determines behaviour beyond ends of array (if needed)
   void
   PDFastSimPAR::interpolate3(std::array<double, 3>& inter,
-                             const std::vector<double>& xData,
-                             const std::vector<double>& yData1,
-                             const std::vector<double>& yData2,
-                             const std::vector<double>& yData3,
+                             InterpolationAxis const& xData,
+                             double const* yData,
                              double x,
-                             bool extrapolate)
+                             bool extrapolate) const
   {
-    size_t size = xData.size();
-    size_t i = 0;               // find left end of interval for interpolation
-    if (x >= xData[size - 2]) { // special case: beyond right end
-      i = size - 2;
-    }
-    else {
-      while (x > xData[i + 1])
-        i++;
-    }
+    const size_t i = xData.interval(x); // left end of interval for interpolation
     double xL = xData[i];
     double xR = xData[i + 1]; // points on either side (unless beyond ends)
-    double yL1 = yData1[i];
-    double yR1 = yData1[i + 1];
-    double yL2 = yData2[i];
-    double yR2 = yData2[i + 1];
-    double yL3 = yData3[i];
-    double yR3 = yData3[i + 1];
-
-    if (!extrapolate) { // if beyond ends of array and not extrapolating
-      if (x < xL) {
-        inter[0] = yL1;
-        inter[1] = yL2;
-        inter[2] = yL3;
-        return;
-      }
-      if (x > xR) {
-        inter[0] = yL1;
-        inter[1] = yL2;
-        inter[2] = yL3;
-        return;
-      }
+    double const* yL = yData + 3 * i;
+    double const* yR = yL + 3;
+
+    if (!extrapolate && (x < xL || x > xR)) { // if beyond ends of array and not extrapolating
+      std::copy_n(yL, 3, inter.begin());
+      return;
     }
     const double m = (x - xL) / (xR - xL);
-    inter[0] = m * (yR1 - yL1) + yL1;
-    inter[1] = m * (yR2 - yL2) + yL2;
-    inter[2] = m * (yR3 - yL3) + yL3;
+    for (size_t p = 0; p < 3; ++p)
+      inter[p] = m * (yR[p] - yL[p]) + yL[p];
   }
 
   //......................................................................
@@ -1954,6 +2461,44 @@ namespace phot {
     return 0.;
   }
 
+  //......................................................................
+  // solid angle of an optical detector, from the grid if available
+  double
+  PDFastSimPAR::SolidAngle(OpticalDetector const& opDet, geo::Vector_t const& abs_relative)
+  {
+    if (!opDet.solidAngleGrid) return Analytic_SolidAngle(opDet, abs_relative);
+    return opDet.solidAngleGrid->value(
+      {{abs_relative.X(), abs_relative.Y(), abs_relative.Z()}},
+      [this, &opDet](SolidAngleGrid::Coords_t const& v) {
+        return Analytic_SolidAngle(opDet, geo::Vector_t{v[0], v[1], v[2]});
+      });
+  }
+
+  double
+  PDFastSimPAR::Analytic_SolidAngle(OpticalDetector const& opDet, geo::Vector_t const& abs_relative)
+  {
+    // ARAPUCAS/Bars (rectangle)
+    if (opDet.type == 0) {
+      return Rectangle_SolidAngle(Dims{opDet.h, opDet.w}, abs_relative, opDet.orientation);
+    }
+    // PMTs (dome)
+    else if (opDet.type == 1) {
+      const double distance = abs_relative.R();
+      double cosine;
+      if (opDet.orientation == 1) cosine = abs_relative.Y() / distance;
+      else cosine = abs_relative.X() / distance;
+      const double theta = fast_acos(cosine) * 180. / CLHEP::pi;
+      return Omega_Dome_Model(distance, theta);
+    }
+    // PMTs (disk)
+    else if (opDet.type == 2) {
+      const double zy_offset = std::sqrt(abs_relative.Y() * abs_relative.Y() + abs_relative.Z() * abs_relative.Z());
+      return Disk_SolidAngle(zy_offset, abs_relative.X(), fradius);
+    }
+    std::cout << "Error: Invalid optical detector type. 0 = rectangular, 1 = dome, 2 = disk" << std::endl;
+    return 0.;
+  }
+
   //......................................................................
   // solid angle of dome aperture
   double
@@ -21,6 +21,18 @@
 //  - visible photons: the number of photons times the visibility at the middle of the Geant4 step for a given optical channel.
 //  - other photon information is got from 'sim::SimEnergyDeposits'
 //  - add 'sim::OpDetBacktrackerRecord' to event
+//With `CompactEnergyDeposits`, `SimulationLabel` is read as a `sim::CompactSimEnergyDeposits`.
+//With `ParallelDeposits`, blocks of deposits are simulated in parallel threads, each block
+//with its own random stream, and the photons are stored in deposit order: the result does
+//not depend on the number of threads (but differs from the serial one).
+//With a `TimeTrigger` configuration (the parameters of `FilterSimPhotonLiteTime`), only the
+//trigger decision is sought: the photons in the trigger windows are counted as the deposits
+//are simulated, and the simulation stops when a window collects enough photons, or when no
+//remaining deposit can be detected within a window. The photons simulated until then are
+//stored, so that the filter takes the same decision, and the backtracking records are made
+//only for the accepted events (rejected events get empty collections).
+//The event loop, the trigger and the output are the ones of `phot::FastOpticalEngine`,
+//this module providing the photons of each deposit.
 // Aug. 19 by Mu Wei
 ////////////////////////////////////////////////////////////////////////
 
@@ -36,6 +48,7 @@
 #include "canvas/Utilities/InputTag.h"
 #include "nurandom/RandomUtils/NuRandomService.h"
 #include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
 
 // LArSoft libraries
 #include "larcore/Geometry/Geometry.h"
@@ -43,55 +56,115 @@
 #include "lardataobj/Simulation/SimPhotons.h"
 #include "lardataobj/Simulation/OpDetBacktrackerRecord.h"
 #include "lardata/DetectorInfoServices/LArPropertiesService.h"
+#include "larsim/PhotonPropagation/FastOpticalEngine.h"
+#include "larsim/PhotonPropagation/PhotonTimeTrigger.h"
 #include "larsim/PhotonPropagation/PhotonVisibilityService.h"
 #include "larsim/PhotonPropagation/ScintTimeTools/ScintTime.h"
 #include "larsim/Simulation/LArG4Parameters.h"
+#include "larsim/Simulation/ProductFootprint.h"
+#include "larsim/Simulation/ReadSimEnergyDeposits.h"
+#include "larsim/Utils/CounterBasedRandomEngine.h"
+#include "larsim/Utils/TraceZones.h"
 
 // Random number engine
 #include "CLHEP/Random/RandFlat.h"
 #include "CLHEP/Random/RandPoissonQ.h"
 
+// TBB
+#include "tbb/enumerable_thread_specific.h"
+
+// C/C++ standard libraries
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
 namespace phot
 {
-  class PDFastSimPVS : public art::EDProducer
+  class PDFastSimPVS : public art::EDProducer, private FastOpticalModel
   {
   public:
     explicit PDFastSimPVS(fhicl::ParameterSet const&);
     void produce(art::Event&) override;
-    void AddOpDetBTR(std::vector< sim::OpDetBacktrackerRecord > & opbtr,
-		     std::map<int, int> & ChannelMap,
-		     sim::OpDetBacktrackerRecord btr);
                              
   private:
+
+    // FastOpticalModel interface: the sources are the energy deposits
+    void prepareSources(std::size_t first, std::size_t end) override;
+    double sourceStartTime(std::size_t iEdep) const override { return (*fEdeps)[iEdep].StartT(); }
+    void simulateSource(std::size_t iEdep, FastOpticalRandom& rng, FastOpticalPhotons& dep) override;
+
+    /// Returns the scintillation time tool of the calling thread.
+    ScintTime& scintTimeTool();
+
+    /// Returns the configuration of the engine, from the module one.
+    FastOpticalEngine::Config_t engineConfig() const;
+
     bool                          fDoSlowComponent;
+    std::size_t                   fVisibilityBatchSize; // Deposits per visibility query
+    double                        fExpectedPhotonThreshold; // Channels expecting fewer photons are skipped
+    bool                          fUseLitePhotons;
+    bool                          fStoreReflected;
+    unsigned int                  fNOpChannels;
     art::InputTag                 simTag;
-    std::unique_ptr<ScintTime>    fScintTime;        // Tool to retrive timinig of scintillation        
+    bool                          fCompactEdeps; // simTag is a sim::CompactSimEnergyDeposits
+    fhicl::ParameterSet           fScintTimeToolPSet;
+    bool                          fParallelDeposits; // Simulate blocks of deposits in parallel
+    std::size_t                   fParallelBlockSize; // Deposits sharing a random stream
+    bool                          fStoreProductFootprints; // Put the product sizes into the event
+    // scintillation time tools of the threads (they are not thread-safe)
+    tbb::enumerable_thread_specific<std::unique_ptr<ScintTime>> fThreadScintTime;
+    FastOpticalEngine             fEngine;           // Event loop, trigger and output
     CLHEP::HepRandomEngine&       fPhotonEngine;
     CLHEP::HepRandomEngine&       fScintTimeEngine;
-    std::map<int, int>            PDChannelToSOCMapDirect; // Where each OpChan is.
-    std::map<int, int>            PDChannelToSOCMapReflect; // Where each OpChan is.
+
+    // visibilities of the deposits being simulated, queried in batches
+    std::vector<sim::SimEnergyDeposit> const* fEdeps = nullptr;
+    std::vector<sim::SimEnergyDeposit> fEdepBuffer;  // expanded compact deposits
+    std::size_t                   fBatchFirst = 0;   // first deposit of the batch
+    std::vector<geo::Point_t>     fBatchPoints;
+    std::vector<float>            fBatchVis, fBatchVis_Ref;
+    std::vector<bool>             fBatchValid, fBatchValid_Ref;
   };
     
   //......................................................................    
   PDFastSimPVS::PDFastSimPVS(fhicl::ParameterSet const& pset)
     : art::EDProducer{pset}
     , fDoSlowComponent{pset.get<bool>("DoSlowComponent")}
+    , fVisibilityBatchSize{std::max(pset.get<std::size_t>("VisibilityBatchSize", 1024U), std::size_t(1))}
+    , fExpectedPhotonThreshold{pset.get<double>("ExpectedPhotonThreshold", 0.0)}
+    , fUseLitePhotons{art::ServiceHandle<sim::LArG4Parameters const>()->UseLitePhotons()}
+    , fStoreReflected{art::ServiceHandle<PhotonVisibilityService const>()->StoreReflected()}
+    , fNOpChannels{static_cast<unsigned int>(art::ServiceHandle<PhotonVisibilityService const>()->NOpChannels())}
     , simTag{pset.get<art::InputTag>("SimulationLabel")}
-    , fScintTime{art::make_tool<ScintTime>(pset.get<fhicl::ParameterSet>("ScintTimeTool"))}
+    , fCompactEdeps{pset.get<bool>("CompactEnergyDeposits", false)}
+    , fScintTimeToolPSet{pset.get<fhicl::ParameterSet>("ScintTimeTool")}
+    , fParallelDeposits{pset.get<bool>("ParallelDeposits", false)}
+    , fParallelBlockSize{std::max(pset.get<std::size_t>("ParallelBlockSize", 256U), std::size_t(1))}
+    , fStoreProductFootprints{pset.get<bool>("StoreProductFootprints", false)}
+    , fEngine{engineConfig(),
+              pset.has_key("TimeTrigger")? PhotonTimeTrigger{pset.get<fhicl::ParameterSet>("TimeTrigger")}: PhotonTimeTrigger{}}
     , fPhotonEngine(art::ServiceHandle<rndm::NuRandomService>{}->createEngine(*this, "HepJamesRandom", "photon", pset, "SeedPhoton"))
     , fScintTimeEngine(art::ServiceHandle<rndm::NuRandomService>()->createEngine(*this, "HepJamesRandom", "scinttime", pset, "SeedScintTime"))
     {
       std::cout << "PDFastSimPVS Module Construct" << std::endl;
+
+      scintTimeTool(); // checks the tool configuration
+
+      if (fEngine.trigger().enabled() && !fUseLitePhotons)
+        {
+	  throw art::Exception(art::errors::Configuration)
+	    << "PDFastSimPVS: TimeTrigger requires lite photons (LArG4Parameters.UseLitePhotons).\n";
+        }
         
-      art::ServiceHandle<PhotonVisibilityService const> pvs;
-      art::ServiceHandle<sim::LArG4Parameters const> lgp;        
-      if (lgp->UseLitePhotons())
+      if (fUseLitePhotons)
         {
 	  std::cout << "Use Lite Photon." << std::endl;
 	  produces< std::vector<sim::SimPhotonsLite> >();
 	  produces< std::vector<sim::OpDetBacktrackerRecord> >();
             
-	  if(pvs->StoreReflected())
+	  if(fStoreReflected)
             {
 	      std::cout << "Store Reflected Photons" << std::endl;
 	      produces< std::vector<sim::SimPhotonsLite> >("Reflected");
@@ -102,51 +175,23 @@ namespace phot
         {
 	  std::cout << "Use Sim Photon." << std::endl;
 	  produces< std::vector<sim::SimPhotons> >();
-	  if(pvs->StoreReflected())
+	  if(fStoreReflected)
             {
 	      std::cout << "Store Reflected Photons" << std::endl;            
 	      produces< std::vector<sim::SimPhotons> >("Reflected");     
             }            
         }        
+      if (fStoreProductFootprints) produces< std::vector<sim::ProductFootprint> >();
     }
     
   //......................................................................    
   void PDFastSimPVS::produce(art::Event& event)
   {
+    LARSIM_TRACE_ZONE("PDFastSimPVS::produce");
     std::cout << "PDFastSimPVS Module Producer" << std::endl;
         
-    art::ServiceHandle<PhotonVisibilityService const> pvs;
-    art::ServiceHandle<sim::LArG4Parameters const> lgp;
-    auto const nOpChannels = pvs->NOpChannels();
-        
-    CLHEP::RandPoissonQ randpoisphot{fPhotonEngine};
-        
-    std::unique_ptr< std::vector< sim::SimPhotons > >             phot   (new std::vector<sim::SimPhotons>);
-    std::unique_ptr< std::vector< sim::SimPhotonsLite > >         phlit  (new std::vector<sim::SimPhotonsLite>);
-    std::unique_ptr< std::vector< sim::OpDetBacktrackerRecord > > opbtr  (new std::vector<sim::OpDetBacktrackerRecord>);
-        
-    std::unique_ptr< std::vector< sim::SimPhotons > >             phot_ref   (new std::vector<sim::SimPhotons>);
-    std::unique_ptr< std::vector< sim::SimPhotonsLite > >         phlit_ref  (new std::vector<sim::SimPhotonsLite>);
-    std::unique_ptr< std::vector< sim::OpDetBacktrackerRecord > > opbtr_ref  (new std::vector<sim::OpDetBacktrackerRecord>);
-        
-    auto& dir_photcol(*phot);
-    auto& ref_photcol(*phot_ref);
-    auto& dir_phlitcol(*phlit);
-    auto& ref_phlitcol(*phlit_ref);
-    dir_photcol.resize(nOpChannels);
-    ref_photcol.resize(nOpChannels);
-    dir_phlitcol.resize(nOpChannels);
-    ref_phlitcol.resize(nOpChannels);
-    for (unsigned int i = 0; i < nOpChannels; i ++)
-      {
-	dir_photcol[i].fOpChannel  = i;
-	ref_photcol[i].fOpChannel  = i;
-	dir_phlitcol[i].OpChannel  = i;
-	ref_phlitcol[i].OpChannel  = i;
-      }
-        
-    art::Handle< std::vector<sim::SimEnergyDeposit> > edepHandle;
-    if (!event.getByLabel(simTag, edepHandle))
+    fEdeps = sim::readSimEnergyDeposits(event, simTag, fCompactEdeps, fEdepBuffer);
+    if (!fEdeps)
       {
 	std::cout << "PDFastSimPVS Module Cannot getByLabel: " << simTag << std::endl;
 	return;
@@ -156,247 +201,164 @@ namespace phot
 	std::cout << "PDFastSimPVS Module getByLabel: " << simTag << std::endl;
       }
         
-    auto const& edeps = edepHandle;
-        
-    int num_points    = 0;
-        
-    for (auto const& edepi: *edeps)
-      {
-	num_points ++;
-            
-	MappedCounts_t Visibilities;
-	MappedCounts_t Visibilities_Ref;
-            
-	auto const& prt  = edepi.MidPoint();
-	Visibilities     = pvs->GetAllVisibilities(prt);
-	if(pvs->StoreReflected())
-	  {
-	    Visibilities_Ref = pvs->GetAllVisibilities(prt, true);
-	    if(!Visibilities_Ref)
-	      {
-		std::cout << "Fail to get visibilities for reflected photons." << std::endl;
-	      }
-	  }
-            
-	if(!Visibilities)
-	  {
-	    //throw cet::exception("PDFastSimPVS")
-	    std::cout << "There is no entry in the PhotonLibrary for this position in space. Position: " << edepi.MidPoint();
-	    std::cout << "\n Move to next point" << std::endl;
-	    continue;
-	  }
-	int trackID       = edepi.TrackID();
-	int nphot         = edepi.NumPhotons();
-	double edeposit   = edepi.Energy()/nphot;
-	double pos[3]     = {edepi.MidPointX(), edepi.MidPointY(), edepi.MidPointZ()};
-	int nphot_fast    = edepi.NumFPhotons();
-	int nphot_slow    = edepi.NumSPhotons();
-                        
-	for (unsigned int channel = 0; channel < nOpChannels; ++ channel)
-	  {
-	    auto visibleFraction     = Visibilities[channel];                
-	    if (visibleFraction == 0.0)
-	      {
-		continue; //voxel is not visible at this optical channel.
-	      }
-                
-	    if (lgp->UseLitePhotons())
-	      {
-		sim::OpDetBacktrackerRecord tmpbtr(channel);
-		if (nphot_fast > 0)
-		  {
-		    //random number, poisson distribution, mean: the amount of photons visible at this channel
-		    auto n = static_cast<int>(randpoisphot.fire(nphot_fast * visibleFraction));
-		    for (long i = 0; i < n; ++i) 
-		      {
-			//calculates the time at which the photon was produced
-			fScintTime->GenScintTime(true, fScintTimeEngine);
-			auto time = static_cast<int>(edepi.StartT() + fScintTime->GetScintTime());
-			++ dir_phlitcol[channel].DetectedPhotons[time];
-			tmpbtr.AddScintillationPhotons(trackID, time, 1, pos, edeposit);                        
-		      }
-		  }
-                    
-		if ((nphot_slow > 0) && fDoSlowComponent) 
-		  {
-		    auto n = static_cast<int>(randpoisphot.fire(nphot_slow * visibleFraction));
-		    for (long i = 0; i < n; ++i) 
-		      {
-			fScintTime->GenScintTime(false, fScintTimeEngine);
-			auto time = static_cast<int>(edepi.StartT()+ fScintTime->GetScintTime());
-			++ dir_phlitcol[channel].DetectedPhotons[time];
-			tmpbtr.AddScintillationPhotons(trackID, time, 1, pos, edeposit);                    }
-		  }
-                    
-		AddOpDetBTR(*opbtr, PDChannelToSOCMapDirect, tmpbtr);
-                                        
-		if (pvs->StoreReflected() && Visibilities_Ref)
-		  {
-		    sim::OpDetBacktrackerRecord tmpbtr_ref(channel); 
-		    auto visibleFraction_Ref = Visibilities_Ref [channel];                        
-		    if (visibleFraction_Ref == 0.0)
-		      {
-			continue; //voxel is not visible at this optical channel.
-		      }
-		    if (nphot_fast > 0)
-		      {
-			auto n = static_cast<int>(randpoisphot.fire(nphot_fast * visibleFraction_Ref));
-			for (long i = 0; i < n; ++i)
-			  {
-			    //calculates the time at which the photon was produced
-			    fScintTime->GenScintTime(true, fScintTimeEngine);
-			    auto time = static_cast<int>(edepi.StartT() + fScintTime->GetScintTime());
-			    ++ ref_phlitcol[channel].DetectedPhotons[time];
-			    tmpbtr_ref.AddScintillationPhotons(trackID, time, 1, pos, edeposit);
-			  }
-		      }
-                        
-		    if ((nphot_slow > 0) && fDoSlowComponent)
-		      {
-			auto n = static_cast<int>(randpoisphot.fire(nphot_slow * visibleFraction_Ref));
-			for (long i = 0; i < n; ++i)
-			  {
-			    fScintTime->GenScintTime(false, fScintTimeEngine);
-			    auto time = static_cast<int>(edepi.StartT() + fScintTime->GetScintTime());
-			    ++ ref_phlitcol[channel].DetectedPhotons[time];
-			    tmpbtr_ref.AddScintillationPhotons(trackID, time, 1, pos, edeposit);
-			  }
-		      }
-                        
-		    AddOpDetBTR(*opbtr_ref, PDChannelToSOCMapReflect, tmpbtr_ref);
-		  }
-	      }
-	    else
-	      {
-		sim::OnePhoton photon;
-		photon.SetInSD         = false;
-		photon.InitialPosition = {edepi.MidPointX(), edepi.MidPointY(), edepi.MidPointZ()};
-		photon.Energy          = 9.7e-6;
+    fEngine.simulate(fEdeps->size(), *this, fPhotonEngine, fScintTimeEngine);
+    fEdeps = nullptr;
 
-		if (nphot_fast > 0)
-		  {
-		    //random number, poisson distribution, mean: the amount of photons visible at this channel
-		    auto n = static_cast<int>(randpoisphot.fire(nphot_fast * visibleFraction));
-		    if (n > 0)
-		      {
-			fScintTime->GenScintTime(true, fScintTimeEngine);
-			auto time   = static_cast<int>(edepi.StartT() + fScintTime->GetScintTime());
-			photon.Time = time;
-			// add n copies of sim::OnePhoton photon to the photon collection for a given OpChannel
-			dir_photcol[channel].insert(dir_photcol[channel].end(), n, photon);
-		      }
-		  }
-		if ((nphot_slow > 0) && fDoSlowComponent)
-		  {
-		    //random number, poisson distribution, mean: the amount of photons visible at this channel
-		    auto n = static_cast<int>(randpoisphot.fire(nphot_slow * visibleFraction));
-		    if (n > 0)
-		      {
-			fScintTime->GenScintTime(false, fScintTimeEngine);
-			auto time   = static_cast<int>(edepi.StartT() + fScintTime->GetScintTime());
-			photon.Time = time;
-			// add n copies of sim::OnePhoton photon to the photon collection for a given OpChannel
-			dir_photcol[channel].insert(dir_photcol[channel].end(), n, photon);
-		      }
-		  }
-                                        
-		if (pvs->StoreReflected() && Visibilities_Ref)
-		  {
-		    auto visibleFraction_Ref = Visibilities_Ref [channel];
-		    if (visibleFraction_Ref == 0.0)
-		      {
-			continue; //voxel is not visible at this optical channel.
-		      }
-		    sim::OnePhoton photon;
-		    photon.SetInSD         = false;
-		    photon.InitialPosition = {edepi.MidPointX(), edepi.MidPointY(), edepi.MidPointZ()};
-		    photon.Energy          = 2.7e-6;
-                        
-		    if (nphot_fast > 0)
-		      {
-			auto n = static_cast<int>(randpoisphot.fire(nphot_fast * visibleFraction_Ref));
-			for (long i = 0; i < n; ++i)
-			  {
-			    fScintTime->GenScintTime(true, fScintTimeEngine);
-			    auto time   = static_cast<int>(edepi.StartT() + fScintTime->GetScintTime());
-			    photon.Time = time;
-			    ref_photcol[channel].insert(ref_photcol[channel].end(), 1, photon);
-			  }
-		      }
-                        
-		    if ((nphot_slow > 0) && fDoSlowComponent)
-		      {
-			auto n = static_cast<int>(randpoisphot.fire(nphot_slow * visibleFraction_Ref));
-			for (long i = 0; i < n; ++i)
-			  {
-			    fScintTime->GenScintTime(false, fScintTimeEngine);
-			    auto time   = static_cast<int>(edepi.StartT() + fScintTime->GetScintTime());
-			    photon.Time = time;
-			    ref_photcol[channel].insert(ref_photcol[channel].end(), 1, photon);
-			  }
-		      }
-		  }
-	      }
-	  }
-      }
-        
-    PDChannelToSOCMapDirect.clear();
-    PDChannelToSOCMapReflect.clear();
-        
-    if (lgp->UseLitePhotons())
+    auto const& stats = fEngine.stats();
+    if (stats.skipped > 0)
       {
-	event.put(move(phlit));
-	event.put(move(opbtr));
-	if (pvs->StoreReflected())
-	  {
-	    event.put(move(phlit_ref), "Reflected");
-	    event.put(move(opbtr_ref), "Reflected");
-	  }
+	mf::LogWarning("PDFastSimPVS") << "There is no entry in the PhotonLibrary for the position of " << stats.skipped
+				       << " of the " << stats.simulated << " deposits: they were skipped.";
       }
-    else
+    if (fEngine.trigger().enabled())
       {
-	event.put(move(phot));
-	if (pvs->StoreReflected())
-	  {
-	    event.put(move(phot_ref), "Reflected");
-	  }
+	mf::LogDebug("PDFastSimPVS") << "Trigger: event " << (fEngine.trigger().accepted()? "accepted": "rejected")
+				     << " after " << stats.simulated << " of " << stats.sources << " deposits";
       }
-        
-    return;
+
+    fEngine.put(event, moduleDescription().moduleLabel());
   }
-    
+
   //......................................................................    
-  void PDFastSimPVS::AddOpDetBTR(std::vector< sim::OpDetBacktrackerRecord > & opbtr,
-				 std::map<int, int> & ChannelMap,
-				 sim::OpDetBacktrackerRecord btr) 
+  FastOpticalEngine::Config_t PDFastSimPVS::engineConfig() const
   {
-    int iChan = btr.OpDetNum();
-    std::map<int, int>::iterator channelPosition = ChannelMap.find(iChan);
-        
-    if (channelPosition == ChannelMap.end() )
+    FastOpticalEngine::Config_t config;
+    config.nOpChannels           = fNOpChannels;
+    config.useLitePhotons        = fUseLitePhotons;
+    config.storeReflected        = fStoreReflected;
+    config.directPhotonEnergy    = 9.7e-6;
+    config.reflectedPhotonEnergy = 2.7e-6;
+    config.prepareBatchSize      = fVisibilityBatchSize;
+    config.parallel              = fParallelDeposits;
+    config.parallelBlockSize     = fParallelBlockSize;
+    config.streamKey             = larsim::Utils::randomStreamKey("PDFastSimPVS");
+    config.storeProductFootprints = fStoreProductFootprints;
+    return config;
+  }
+
+  //......................................................................    
+  ScintTime& PDFastSimPVS::scintTimeTool()
+  {
+    auto& scintTime = fThreadScintTime.local();
+    if (!scintTime) scintTime = art::make_tool<ScintTime>(fScintTimeToolPSet);
+    return *scintTime;
+  }
+
+  //......................................................................    
+  void PDFastSimPVS::prepareSources(std::size_t first, std::size_t end)
+  {
+    // visibilities are queried in batches of deposits, to amortize the lookup
+    art::ServiceHandle<PhotonVisibilityService const> pvs;
+    fBatchFirst = first;
+    fBatchPoints.clear();
+    for (std::size_t j = first; j < end; ++j)
+      fBatchPoints.push_back((*fEdeps)[j].MidPoint());
+    fBatchValid = pvs->GetAllVisibilitiesBatch(fBatchPoints, fBatchVis);
+    if(fStoreReflected)
+      fBatchValid_Ref = pvs->GetAllVisibilitiesBatch(fBatchPoints, fBatchVis_Ref, true);
+  }
+
+  //......................................................................    
+  void PDFastSimPVS::simulateSource(std::size_t iEdep,
+				    FastOpticalRandom& rng,
+				    FastOpticalPhotons& dep)
+  {
+    sim::SimEnergyDeposit const& edepi = (*fEdeps)[iEdep];
+    std::size_t const iInBatch = iEdep - fBatchFirst;
+    float const* Visibilities = nullptr;
+    float const* Visibilities_Ref = nullptr;
+    if (fBatchValid[iInBatch])
+      Visibilities = fBatchVis.data() + iInBatch * fNOpChannels;
+    if(fStoreReflected && fBatchValid_Ref[iInBatch])
+      Visibilities_Ref = fBatchVis_Ref.data() + iInBatch * fNOpChannels;
+    if(fStoreReflected && !Visibilities_Ref && !fParallelDeposits)
       {
-	ChannelMap[iChan] = opbtr.size();
-	opbtr.emplace_back(std::move(btr));
+	std::cout << "Fail to get visibilities for reflected photons." << std::endl;
       }
-    else
+
+    if(!Visibilities) return;
+    dep.simulated = true;
+    dep.trackID = edepi.TrackID();
+    dep.origin = edepi.MidPoint();
+    dep.photonOrigin = edepi.MidPoint();
+    dep.energyPerPhoton = edepi.Energy()/edepi.NumPhotons();
+
+    ScintTime& scintTime = scintTimeTool();
+    CLHEP::RandPoissonQ& randpoisphot = rng.poisson;
+
+    int nphot_fast    = edepi.NumFPhotons();
+    int nphot_slow    = edepi.NumSPhotons();
+    // photons which may reach a channel; channels expecting less than
+    // fExpectedPhotonThreshold of them are skipped
+    double const nphot_emitted = nphot_fast + (fDoSlowComponent? nphot_slow: 0);
+
+    // adds `n` photons arriving each at its own scintillation time
+    std::vector<double> scintTimes;
+    auto addPhotons = [&](bool is_fast, int n)
       {
-	unsigned int idtest = channelPosition->second;
-	auto const& timePDclockSDPsMap = btr.timePDclockSDPsMap();
-            
-	for(auto const& timePDclockSDP : timePDclockSDPsMap)
+	scintTimes.resize(n);
+	scintTime.GenScintTimes(is_fast, scintTimes.data(), n, rng.scintTime);
+	for (double const t : scintTimes)
+	  dep.times.push_back(static_cast<int>(edepi.StartT() + t));
+      };
+
+    for (unsigned int channel = 0; channel < fNOpChannels; ++ channel)
+      {
+	auto visibleFraction     = Visibilities[channel];                
+	if (visibleFraction == 0.0 || nphot_emitted * visibleFraction < fExpectedPhotonThreshold)
+	  {
+	    continue; //voxel is not visible at this optical channel.
+	  }
+
+	// direct light
+	dep.channels.push_back({ channel, false, dep.times.size(), 0U });
+	if (fUseLitePhotons)
 	  {
-	    for(auto const& sdp : timePDclockSDP.second)
+	    if (nphot_fast > 0)
 	      {
-		double xyz[3] = {sdp.x, sdp.y, sdp.z};
-		opbtr.at(idtest).AddScintillationPhotons(sdp.trackID,
-							 timePDclockSDP.first,
-							 sdp.numPhotons,
-							 xyz,
-							 sdp.energy);
+		//random number, poisson distribution, mean: the amount of photons visible at this channel
+		addPhotons(true, static_cast<int>(randpoisphot.fire(nphot_fast * visibleFraction)));
 	      }
+	    if ((nphot_slow > 0) && fDoSlowComponent)
+	      addPhotons(false, static_cast<int>(randpoisphot.fire(nphot_slow * visibleFraction)));
 	  }
-      }    
-  }  
+	else
+	  {
+	    // all the photons of a component share the same time
+	    for (bool const is_fast : { true, false })
+	      {
+		int const nphot = is_fast? nphot_fast: nphot_slow;
+		if ((nphot <= 0) || (!is_fast && !fDoSlowComponent)) continue;
+		//random number, poisson distribution, mean: the amount of photons visible at this channel
+		auto n = static_cast<int>(randpoisphot.fire(nphot * visibleFraction));
+		if (n > 0)
+		  {
+		    scintTime.GenScintTime(is_fast, rng.scintTime);
+		    dep.times.insert(dep.times.end(), n,
+				     static_cast<int>(edepi.StartT() + scintTime.GetScintTime()));
+		  }
+	      }
+	  }
+	dep.channels.back().end = dep.times.size();
+
+	// reflected light
+	if (fStoreReflected && Visibilities_Ref)
+	  {
+	    auto visibleFraction_Ref = Visibilities_Ref [channel];
+	    if (visibleFraction_Ref == 0.0 || nphot_emitted * visibleFraction_Ref < fExpectedPhotonThreshold)
+	      {
+		continue; //voxel is not visible at this optical channel.
+	      }
+	    dep.channels.push_back({ channel, true, dep.times.size(), 0U });
+	    if (nphot_fast > 0)
+	      addPhotons(true, static_cast<int>(randpoisphot.fire(nphot_fast * visibleFraction_Ref)));
+	    if ((nphot_slow > 0) && fDoSlowComponent)
+	      addPhotons(false, static_cast<int>(randpoisphot.fire(nphot_slow * visibleFraction_Ref)));
+	    dep.channels.back().end = dep.times.size();
+	  }
+      }
+  } // PDFastSimPVS::simulateSource()
+    
 } // namespace
 
 DEFINE_ART_MODULE(phot::PDFastSimPVS)
@@ -3,6 +3,7 @@
 
 #include "cetlib_except/exception.h"
 #include "larsim/PhotonPropagation/PhotonLibrary.h"
+#include "larsim/Utils/TraceZones.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
 #include "RooDouble.h"
@@ -18,7 +19,14 @@
 
 #include "TVector.h"
 
+#include <algorithm> // std::min(), std::find()
 #include <cassert>
+#include <cstdint> // std::uint64_t
+#include <cstdio>  // std::snprintf()
+#include <cstring> // std::memcpy()
+#include <iterator> // std::distance()
+#include <string>
+#include <vector>
 
 namespace {
 
@@ -37,6 +45,42 @@ namespace {
     }
   }; // RooReader
 
+  /// 64-bit FNV-1a hash of the library entries, in the order they are stored.
+  class EntryChecksum {
+    std::uint64_t fHash = 14695981039346656037ULL;
+
+    template <typename T>
+    void
+    add(T value)
+    {
+      unsigned char bytes[sizeof(T)];
+      std::memcpy(bytes, &value, sizeof(T));
+      for (unsigned char byte : bytes) {
+        fHash ^= byte;
+        fHash *= 1099511628211ULL;
+      }
+    }
+
+  public:
+    /// Adds an entry (voxel, channel and direct light visibility).
+    void
+    add(Int_t Voxel, Int_t OpChannel, Float_t Visibility)
+    {
+      add(Voxel);
+      add(OpChannel);
+      add(Visibility);
+    }
+
+    /// Returns the checksum as a string of 16 hexadecimal digits.
+    std::string
+    str() const
+    {
+      char buffer[17];
+      std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(fHash));
+      return buffer;
+    }
+  }; // EntryChecksum
+
 } // local namespace
 
 namespace phot {
@@ -108,6 +152,7 @@ namespace phot {
       }
       tt->Branch("ReflTfirst", &ReflTfirst, "ReflTfirst/F");
     }
+    EntryChecksum checksum;
     for (size_t ivox = 0; ivox != fNVoxels; ++ivox) {
       for (size_t ichan = 0; ichan != fNOpChannels; ++ichan) {
         Visibility = uncheckedAccess(ivox, ichan);
@@ -122,11 +167,12 @@ namespace phot {
           OpChannel = ichan;
           // visibility(ies) is(are) already set
           tt->Fill();
+          checksum.add(Voxel, OpChannel, Visibility);
         }
       }
     }
 
-    StoreMetadata();
+    StoreMetadata(checksum.str());
   }
 
   //------------------------------------------------------------
@@ -143,7 +189,9 @@ namespace phot {
     fReflLookupTable.clear();
     fReflTLookupTable.clear();
     fTimingParLookupTable.clear();
-    fTimingParTF1LookupTable.clear();
+    fTimingParametrization.reset();
+    fTimingHistograms.reset();
+    fLoadedVoxels.clear();
 
     fNVoxels = NVoxels;
     fNOpChannels = NOpChannels;
@@ -156,7 +204,9 @@ namespace phot {
     fHasTiming = storeTiming;
     if (storeTiming != 0) {
       fTimingParLookupTable.resize(LibrarySize());
-      fTimingParTF1LookupTable.resize(LibrarySize());
+      fTimingParNParameters = storeTiming;
+      fTimingParametrization = std::make_unique<PropagationTimeParametrization>(
+        fTimingParFormula, fTimingParNParameters, 0.0, fNVoxels, fNOpChannels);
     }
   }
 
@@ -168,13 +218,17 @@ namespace phot {
                                      bool getReflected,
                                      bool getReflT0,
                                      size_t getTiming,
-                                     int fTimingMaxRange)
+                                     int fTimingMaxRange,
+                                     LoadSelection const& selection /* = {} */)
   {
+    LARSIM_TRACE_ZONE("PhotonLibrary::LoadLibraryFromFile");
     fLookupTable.clear();
     fReflLookupTable.clear();
     fReflTLookupTable.clear();
     fTimingParLookupTable.clear();
-    fTimingParTF1LookupTable.clear();
+    fTimingParametrization.reset();
+    fTimingHistograms.reset();
+    fLoadedVoxels.clear();
 
     mf::LogInfo("PhotonLibrary") << "Reading photon library from input file: "
                                  << LibraryFile.c_str() << std::endl;
@@ -222,7 +276,37 @@ namespace phot {
     if (getReflT0) tt->SetBranchAddress("ReflTfirst", &ReflTfirst);
 
     fNVoxels = NVoxels;
-    fNOpChannels = PhotonLibrary::ExtractNOpChannels(tt); // EXPENSIVE!!!
+
+    // the number of channels is in the metadata of all but legacy libraries
+    ContentMetadata const content = LoadMetadata(*pSrcDir);
+    if (content.NOpChannels)
+      fNOpChannels = *content.NOpChannels;
+    else
+      fNOpChannels = PhotonLibrary::ExtractNOpChannels(tt); // EXPENSIVE!!!
+    if (content.NVoxels && (*content.NVoxels != fNVoxels)) {
+      mf::LogWarning("PhotonLibrary")
+        << "Photon library '" << LibraryFile << "' reports " << *content.NVoxels
+        << " voxels, while " << fNVoxels << " are expected.";
+    }
+
+    // range of the selected voxels, the only one to be allocated
+    size_t firstVoxel = 0;
+    size_t endVoxel = fNVoxels;
+    if (!selection.voxels.empty()) {
+      if (selection.voxels.size() != fNVoxels) {
+        throw cet::exception("PhotonLibrary")
+          << "LoadLibraryFromFile(): voxel selection for " << selection.voxels.size()
+          << " voxels, but the library has " << fNVoxels << ".\n";
+      }
+      fLoadedVoxels = selection.voxels;
+      auto const iFirst = std::find(fLoadedVoxels.cbegin(), fLoadedVoxels.cend(), true);
+      firstVoxel = std::distance(fLoadedVoxels.cbegin(), iFirst);
+      endVoxel = firstVoxel;
+      for (size_t v = firstVoxel; v < fNVoxels; ++v)
+        if (fLoadedVoxels[v]) endVoxel = v + 1;
+    }
+    size_t const firstData = uncheckedIndex(firstVoxel, 0);
+    size_t const endData = uncheckedIndex(endVoxel, 0);
 
     // with STL vectors, where `resize()` directly controls the allocation of
     // memory, reserving the space is redundant; not so with `util::LazyVector`,
@@ -230,7 +314,7 @@ namespace phot {
     // all the storage we need at once, effectively suppressing the laziness
     // of the vector (by design, that was only relevant in `CreateEmptyLibrary()`)
     fLookupTable.resize(LibrarySize());
-    fLookupTable.data_init(LibrarySize());
+    fLookupTable.data_init(firstData, endData);
 
     if (fHasTiming != 0) {
       timing_par.resize(getTiming);
@@ -243,26 +327,52 @@ namespace phot {
           << "Error reading the photon propagation formula. Please check the photon library."
           << std::endl;
       fTimingParFormula = n->GetTitle();
-      fTimingParTF1LookupTable.resize(LibrarySize());
-      fTimingParTF1LookupTable.data_init(LibrarySize());
+      // one flat array of parameters; distributions are tabulated on demand
+      fTimingParametrization = std::make_unique<PropagationTimeParametrization>(
+        fTimingParFormula, fTimingParNParameters, fTimingMaxRange, fNVoxels, fNOpChannels);
       mf::LogInfo("PhotonLibrary")
         << "Time parametrization is activated. Using the formula: " << fTimingParFormula << " with "
         << fTimingParNParameters << " parameters." << std::endl;
     }
     if (fHasReflected) {
       fReflLookupTable.resize(LibrarySize());
-      fReflLookupTable.data_init(LibrarySize());
+      fReflLookupTable.data_init(firstData, endData);
     }
     if (fHasReflectedT0) {
       fReflTLookupTable.resize(LibrarySize());
-      fReflTLookupTable.data_init(LibrarySize());
+      fReflTLookupTable.data_init(firstData, endData);
     }
 
+    // with a selection, the voxel and channel of each entry are read first,
+    // and the rest of the entry only if it is selected
+    TBranch* voxelBranch = tt->GetBranch("Voxel");
+    TBranch* channelBranch = tt->GetBranch(OpChannelBranchName.c_str());
+    auto const isSelected = [](std::vector<bool> const& sel, Int_t index) {
+      return sel.empty() || ((index >= 0) && (size_t(index) < sel.size()) && sel[index]);
+    };
+
     size_t NEntries = tt->GetEntries();
+    size_t NLoaded = 0;
+    // only a full load can be verified
+    bool const verify = !content.checksum.empty() && selection.all();
+    EntryChecksum checksum;
 
     for (size_t i = 0; i != NEntries; ++i) {
 
+      if (!selection.all()) {
+        voxelBranch->GetEntry(i);
+        if (!isSelected(selection.voxels, Voxel)) continue;
+        channelBranch->GetEntry(i);
+        if (!isSelected(selection.channels, OpChannel)) continue;
+      }
       tt->GetEntry(i);
+      ++NLoaded;
+      if (verify) checksum.add(Voxel, OpChannel, Visibility);
+      if ((OpChannel < 0) || (size_t(OpChannel) >= fNOpChannels)) {
+        throw cet::exception("PhotonLibrary")
+          << "Photon library '" << LibraryFile << "' has an entry for channel " << OpChannel
+          << ", but its metadata reports " << fNOpChannels << " channels.\n";
+      }
 
       // Set the visibility at this optical channel
       uncheckedAccess(Voxel, OpChannel) = Visibility;
@@ -270,23 +380,16 @@ namespace phot {
       if (fHasReflected) uncheckedAccessRefl(Voxel, OpChannel) = ReflVisibility;
       if (fHasReflectedT0) uncheckedAccessReflT(Voxel, OpChannel) = ReflTfirst;
       if (fHasTiming != 0) {
-        // TODO: use TF1::Copy
-        TF1 timingfunction(Form("timing_%i_%i", Voxel, OpChannel),
-                           fTimingParFormula.c_str(),
-                           timing_par[0],
-                           fTimingMaxRange);
-        timingfunction.SetParameter(
-          0,
-          0.0); //first parameter is now in the range. Let's do this to keep compatible with old libraries.
-        for (size_t k = 1; k < fTimingParNParameters; k++) {
-          timingfunction.SetParameter(k, timing_par[k]);
-        }
-
-        uncheckedAccessTimingTF1(Voxel, OpChannel) = timingfunction;
+        // first parameter is the lower limit of the range
+        fTimingParametrization->setParameters(uncheckedIndex(Voxel, OpChannel), timing_par.data());
       }
     } // for entries
 
-    LoadMetadata(*pSrcDir);
+    if (verify && (checksum.str() != content.checksum)) {
+      throw cet::exception("PhotonLibrary")
+        << "Photon library '" << LibraryFile << "' is corrupted: content checksum "
+        << checksum.str() << " instead of " << content.checksum << ".\n";
+    }
     {
       mf::LogInfo log("PhotonLibrary");
       log << "Photon lookup table size : " << NVoxels << " voxels,  " << fNOpChannels
@@ -295,6 +398,8 @@ namespace phot {
         log << "; " << GetVoxelDef();
       else
         log << " (no voxel geometry included)";
+      if (!selection.all())
+        log << "\nLoaded the " << NLoaded << " selected entries out of " << NEntries;
     }
 
     try {
@@ -310,7 +415,7 @@ namespace phot {
   float
   PhotonLibrary::GetCount(size_t Voxel, size_t OpChannel) const
   {
-    if ((Voxel >= fNVoxels) || (OpChannel >= fNOpChannels))
+    if (!isVoxelValidImpl(Voxel) || (OpChannel >= fNOpChannels))
       return 0;
     else
       return uncheckedAccess(Voxel, OpChannel);
@@ -320,7 +425,7 @@ namespace phot {
   float
   PhotonLibrary::GetTimingPar(size_t Voxel, size_t OpChannel, size_t parnum) const
   {
-    if ((Voxel >= fNVoxels) || (OpChannel >= fNOpChannels))
+    if (!isVoxelValidImpl(Voxel) || (OpChannel >= fNOpChannels))
       return 0;
     else
       return uncheckedAccessTimingPar(Voxel, OpChannel, parnum);
@@ -329,7 +434,7 @@ namespace phot {
   float
   PhotonLibrary::GetReflCount(size_t Voxel, size_t OpChannel) const
   {
-    if ((Voxel >= fNVoxels) || (OpChannel >= fNOpChannels))
+    if (!isVoxelValidImpl(Voxel) || (OpChannel >= fNOpChannels))
       return 0;
     else
       return uncheckedAccessRefl(Voxel, OpChannel);
@@ -339,7 +444,7 @@ namespace phot {
   float
   PhotonLibrary::GetReflT0(size_t Voxel, size_t OpChannel) const
   {
-    if ((Voxel >= fNVoxels) || (OpChannel >= fNOpChannels))
+    if (!isVoxelValidImpl(Voxel) || (OpChannel >= fNOpChannels))
       return 0;
     else
       return uncheckedAccessReflT(Voxel, OpChannel);
@@ -375,8 +480,17 @@ namespace phot {
     if ((Voxel >= fNVoxels) || (OpChannel >= fNOpChannels))
       mf::LogError("PhotonLibrary") << "Error - attempting to set a propagation function in voxel "
                                     << Voxel << " which is out of range";
-    else
-      uncheckedAccessTimingTF1(Voxel, OpChannel) = func;
+    else if (!fTimingParametrization)
+      mf::LogError("PhotonLibrary")
+        << "Error - attempting to set a propagation function in a library without timing";
+    else {
+      // first parameter is the lower limit of the range
+      std::vector<float> pars(fTimingParNParameters, 0.0f);
+      pars[0] = func.GetXmin();
+      for (size_t k = 1; k < std::min<size_t>(pars.size(), func.GetNpar()); ++k)
+        pars[k] = func.GetParameter(k);
+      fTimingParametrization->setParameters(uncheckedIndex(Voxel, OpChannel), pars.data());
+    }
   }
   //----------------------------------------------------
 
@@ -406,7 +520,7 @@ namespace phot {
   float const*
   PhotonLibrary::GetCounts(size_t Voxel) const
   {
-    if (Voxel >= fNVoxels)
+    if (!isVoxelValidImpl(Voxel))
       return nullptr;
     else
       return fLookupTable.data_address(uncheckedIndex(Voxel, 0));
@@ -417,7 +531,7 @@ namespace phot {
   const std::vector<float>*
   PhotonLibrary::GetTimingPars(size_t Voxel) const
   {
-    if (Voxel >= fNVoxels)
+    if (!isVoxelValidImpl(Voxel))
       return nullptr;
     else
       return fTimingParLookupTable.data_address(uncheckedIndex(Voxel, 0));
@@ -425,31 +539,61 @@ namespace phot {
 
   //----------------------------------------------------
 
-  TF1*
+  PropagationTimeFunctions const&
   PhotonLibrary::GetTimingTF1s(size_t Voxel) const
   {
-    if (Voxel >= fNVoxels) return nullptr;
-    /*
-     * Sorry, Universe, but we can't undergo ROOT's bad design hell.
-     * TF1::GetRandom() is non-const member, because it uses some internal
-     * integral information which can be produced on the spot instead than
-     * always be present. That's called caching, it's Good, but it must not
-     * interfere with constantness of the interface (in fact, this is one of
-     * the few acceptable uses of `mutable` members).
-     * Because of this, this method can't return a constant `TF1`, therefore
-     * it can't be constant, therefore the underlying access returning a
-     * constant object is not acceptable.
-     * So I do the Bad thing.
-     * Plus I opened JIRA ROOT-9549
-     * (https://sft.its.cern.ch/jira/browse/ROOT-9549).
-     * After that is solved, this method should become:
-     *
-     * TF1 const* PhotonLibrary::GetTimingTF1s(size_t Voxel) const
-     *
-     * and the users should update their code accordingly.
-     */
+    static PropagationTimeFunctions const NoFunctions;
+    if (!isVoxelValidImpl(Voxel) || !fTimingParametrization)
+      return NoFunctions;
+    else
+      return fTimingParametrization->voxel(Voxel);
+  }
+
+  //----------------------------------------------------
+
+  PropagationTimeHistogramVoxel const&
+  PhotonLibrary::GetTimingHistograms(size_t Voxel) const
+  {
+    static PropagationTimeHistogramVoxel const NoHistograms;
+    if (!isVoxelValidImpl(Voxel) || !fTimingHistograms)
+      return NoHistograms;
     else
-      return const_cast<TF1*>(fTimingParTF1LookupTable.data_address(uncheckedIndex(Voxel, 0)));
+      return fTimingHistograms->voxel(Voxel);
+  }
+
+  //----------------------------------------------------
+
+  void
+  PhotonLibrary::MakeTimingHistograms(size_t nBins,
+                                      size_t nClasses,
+                                      std::string const& cacheFile,
+                                      std::string const& key)
+  {
+    LARSIM_TRACE_ZONE("PhotonLibrary::MakeTimingHistograms");
+    auto histograms = std::make_unique<PropagationTimeHistograms>(
+      fNVoxels, fNOpChannels, nBins, std::vector<float>(nBins + 1, 0.0f));
+    if (!cacheFile.empty() && histograms->readFile(cacheFile, key)) {
+      mf::LogInfo("PhotonLibrary") << "Propagation time histograms loaded from '" << cacheFile
+                                   << "'";
+    }
+    else {
+      if (!fTimingParametrization) {
+        throw cet::exception("PhotonLibrary")
+          << "Propagation time histograms requested, but the library has no timing"
+             " parametrization.\n";
+      }
+      histograms = PropagationTimeHistograms::fromParametrization(
+        *fTimingParametrization, fNVoxels, fNOpChannels, nBins, nClasses);
+      mf::LogInfo("PhotonLibrary") << "Made propagation time histograms with " << nBins
+                                   << " bins in " << histograms->nClasses() << " distance classes";
+      if (!cacheFile.empty()) {
+        histograms->writeFile(cacheFile, key);
+        mf::LogInfo("PhotonLibrary")
+          << "Propagation time histograms saved into '" << cacheFile << "'";
+      }
+    }
+    fTimingHistograms = std::move(histograms);
+    fTimingParametrization.reset();
   }
 
   //----------------------------------------------------
@@ -457,7 +601,7 @@ namespace phot {
   float const*
   PhotonLibrary::GetReflCounts(size_t Voxel) const
   {
-    if (Voxel >= fNVoxels)
+    if (!isVoxelValidImpl(Voxel))
       return nullptr;
     else
       return fReflLookupTable.data_address(uncheckedIndex(Voxel, 0));
@@ -468,17 +612,34 @@ namespace phot {
   float const*
   PhotonLibrary::GetReflT0s(size_t Voxel) const
   {
-    if (Voxel >= fNVoxels)
+    if (!isVoxelValidImpl(Voxel))
       return nullptr;
     else
       return fReflTLookupTable.data_address(uncheckedIndex(Voxel, 0));
   }
 
   //------------------------------------------------------------
-  void
+  PhotonLibrary::ContentMetadata
   PhotonLibrary::LoadMetadata(TDirectory& srcDir)
   {
 
+    // content description: any of it may be missing in legacy libraries
+    ContentMetadata content;
+    {
+      std::vector<std::string> missingContentKeys;
+      RooReader<RooInt, Int_t> readContentInt{srcDir, missingContentKeys};
+      if (auto metaValue = readContentInt("NVoxels"); metaValue && (*metaValue >= 0))
+        content.NVoxels = *metaValue;
+      if (auto metaValue = readContentInt("NChannels"); metaValue && (*metaValue >= 0))
+        content.NOpChannels = *metaValue;
+      if (auto metaValue = readContentInt("FormatVersion")) content.formatVersion = *metaValue;
+      if (TNamed const* checksum = srcDir.Get<TNamed>("Checksum"))
+        content.checksum = checksum->GetTitle();
+      MF_LOG_DEBUG("PhotonLibrary")
+        << "Photon library at '" << srcDir.GetPath() << "' has format version "
+        << content.formatVersion << ", checksum '" << content.checksum << "'";
+    }
+
     constexpr std::size_t NExpectedKeys = 9U;
 
     std::vector<std::string> missingKeys;
@@ -516,20 +677,26 @@ namespace phot {
       else {
         mf::LogTrace("PhotonLibrary") << "No voxel metadata found in '" << srcDir.GetPath() << "'";
       }
-      return;
+      return content;
     } // if missing keys
 
     fVoxelDef.emplace(xMin, xMax, xN, yMin, yMax, yN, zMin, zMax, zN);
 
+    return content;
+
   } // PhotonLibrary::LoadMetadata()
 
   //------------------------------------------------------------
   void
-  PhotonLibrary::StoreMetadata() const
+  PhotonLibrary::StoreMetadata(std::string const& checksum) const
   {
 
     assert(fDir);
 
+    // format and content
+    fDir->makeAndRegister<RooInt>("FormatVersion", "Version of the photon library format", FormatVersion);
+    fDir->makeAndRegister<TNamed>("Checksum", checksum.c_str());
+
     // NVoxels
     fDir->makeAndRegister<RooInt>("NVoxels", "Total number of voxels in the library", fNVoxels);
 
@@ -607,4 +774,20 @@ namespace phot {
 
   //----------------------------------------------------
 
+  size_t
+  PhotonLibrary::MemoryFootprint() const
+  {
+    size_t size = (fLookupTable.data_size() + fReflLookupTable.data_size() +
+                   fReflTLookupTable.data_size()) *
+                  sizeof(float);
+    size += fTimingParLookupTable.data_size() *
+            (sizeof(std::vector<float>) + fTimingParNParameters * sizeof(float));
+    if (fTimingParametrization) size += fTimingParametrization->memoryFootprint();
+    if (fTimingHistograms) size += fTimingHistograms->memoryFootprint();
+    size += fLoadedVoxels.size() / 8U;
+    return size;
+  } // PhotonLibrary::MemoryFootprint()
+
+  //----------------------------------------------------
+
 }
@@ -5,6 +5,8 @@
 #define PHOTONLIBRARY_H
 
 #include "larsim/PhotonPropagation/IPhotonLibrary.h"
+#include "larsim/PhotonPropagation/PropagationTimeHistograms.h"
+#include "larsim/PhotonPropagation/PropagationTimeParametrization.h"
 
 #include "larsim/Simulation/PhotonVoxels.h"
 
@@ -14,7 +16,10 @@ class TTree;
 #include "lardataobj/Utilities/LazyVector.h"
 
 #include <limits> // std::numeric_limits
+#include <memory> // std::unique_ptr
 #include <optional>
+#include <string>
+#include <vector>
 
 namespace art {
   class TFileDirectory;
@@ -36,6 +41,8 @@ namespace phot {
     void SetTimingPar(size_t Voxel, size_t OpChannel, float Count, size_t parnum);
 
     //    TF1& GetTimingTF1(size_t Voxel, size_t OpChannel) const;
+    /// Copies range and parameters of `func`, which must have the functional
+    /// form of the library.
     void SetTimingTF1(size_t Voxel, size_t OpChannel, TF1 func);
 
     virtual float GetReflCount(size_t Voxel, size_t OpChannel) const override;
@@ -47,7 +54,29 @@ namespace phot {
     /// Returns a pointer to NOpChannels() visibility values, one per channel
     virtual float const* GetCounts(size_t Voxel) const override;
     const std::vector<float>* GetTimingPars(size_t Voxel) const;
-    TF1* GetTimingTF1s(size_t Voxel) const;
+    /// Returns the propagation time samplers of all channels (none if invalid).
+    PropagationTimeFunctions const& GetTimingTF1s(size_t Voxel) const;
+    /// Returns the propagation time histograms of all channels (none if invalid).
+    PropagationTimeHistogramVoxel const& GetTimingHistograms(size_t Voxel) const;
+
+    /**
+     * @brief Replaces the propagation time parametrization with histograms.
+     * @param nBins number of bins of each histogram
+     * @param nClasses number of distance classes
+     * @param cacheFile file the histograms are read from, if made with the same
+     *                  `key`, or written into otherwise (empty: none)
+     * @param key string identifying the library and its histograms
+     * @throw cet::exception (category: `"PhotonLibrary"`) if there is no
+     *        propagation time parametrization to make the histograms from
+     *
+     * See `phot::PropagationTimeHistograms`. The parametrization and its
+     * tabulated distributions are then released, and `GetTimingTF1s()`
+     * returns no function.
+     */
+    void MakeTimingHistograms(size_t nBins,
+                              size_t nClasses,
+                              std::string const& cacheFile,
+                              std::string const& key);
 
     virtual float const* GetReflCounts(size_t Voxel) const override;
     virtual float const* GetReflT0s(size_t Voxel) const override;
@@ -59,6 +88,13 @@ namespace phot {
       return fHasTiming;
     }
 
+    /// Returns whether propagation times are described by histograms.
+    bool
+    hasTimingHistograms() const
+    {
+      return bool(fTimingHistograms);
+    }
+
     /// Returns whether the current library deals with reflected light count.
     virtual bool
     hasReflected() const override
@@ -73,16 +109,42 @@ namespace phot {
       return fHasReflectedT0;
     }
 
+    /// Returns an estimate of the memory taken by the tables [bytes].
+    virtual size_t MemoryFootprint() const override;
+
     void StoreLibraryToFile(std::string LibraryFile,
                             bool storeReflected = false,
                             bool storeReflT0 = false,
                             size_t storeTiming = 0) const;
+    /// Part of a library to be loaded from file (by default, all of it).
+    struct LoadSelection {
+      std::vector<bool> voxels;   ///< Whether to load each voxel (empty: all).
+      std::vector<bool> channels; ///< Whether to load each channel (empty: all).
+
+      /// Returns whether the whole library is selected.
+      bool
+      all() const
+      {
+        return voxels.empty() && channels.empty();
+      }
+    };
+
+    /**
+     * @brief Reads the library from a ROOT file.
+     *
+     * Only the voxels and channels in `selection` are loaded: the others are
+     * reported as having no visibility, and voxels not selected are invalid.
+     * The memory is allocated only between the first and the last voxel
+     * selected, therefore regions contiguous in voxel number (e.g. a range in
+     * _z_) save the most.
+     */
     void LoadLibraryFromFile(std::string LibraryFile,
                              size_t NVoxels,
                              bool storeReflected = false,
                              bool storeReflT0 = false,
                              size_t storeTiming = 0,
-                             int maxrange = 200);
+                             int maxrange = 200,
+                             LoadSelection const& selection = {});
     void CreateEmptyLibrary(size_t NVoxels,
                             size_t NChannels,
                             bool storeReflected = false,
@@ -151,13 +213,20 @@ namespace phot {
     util::LazyVector<float> fReflLookupTable;
     util::LazyVector<float> fReflTLookupTable;
     util::LazyVector<std::vector<float>> fTimingParLookupTable;
-    util::LazyVector<TF1> fTimingParTF1LookupTable;
+    /// Propagation time distributions: parameters, shared functional form and
+    /// cache of the tabulated distributions.
+    std::unique_ptr<PropagationTimeParametrization> fTimingParametrization;
+    /// Propagation time distributions as histograms (replacing the parametrization).
+    std::unique_ptr<PropagationTimeHistograms> fTimingHistograms;
     std::string fTimingParFormula;
     size_t fTimingParNParameters;
 
     size_t fNOpChannels;
     size_t fNVoxels;
 
+    /// Voxels loaded from the library file (empty: all of them).
+    std::vector<bool> fLoadedVoxels;
+
     /// Voxel definition loaded from library metadata.
     std::optional<sim::PhotonVoxelDef> fVoxelDef;
 
@@ -167,7 +236,7 @@ namespace phot {
     bool
     isVoxelValidImpl(size_t Voxel) const
     {
-      return Voxel < fNVoxels;
+      return (Voxel < fNVoxels) && (fLoadedVoxels.empty() || fLoadedVoxels[Voxel]);
     }
 
     /// Returns the index of visibility of specified voxel and cell
@@ -233,26 +302,26 @@ namespace phot {
       return fTimingParLookupTable[uncheckedIndex(Voxel, OpChannel)][parnum];
     }
 
-    /// Unchecked access to a parameter of the time distribution
-    TF1&
-    uncheckedAccessTimingTF1(size_t Voxel, size_t OpChannel)
-    {
-      return fTimingParTF1LookupTable[uncheckedIndex(Voxel, OpChannel)];
-    }
-
-    /// Unchecked access to a parameter of the time distribution
-    const TF1&
-    uncheckedAccessTimingTF1(size_t Voxel, size_t OpChannel) const
-    {
-      // note that this will produce a segmentation fault if the formula is not there
-      return *(fTimingParTF1LookupTable.data_address(uncheckedIndex(Voxel, OpChannel)));
-    }
-
-    /// Reads the metadata from specified ROOT directory and sets it as current.
-    void LoadMetadata(TDirectory& srcDir);
-
-    /// Writes the current metadata (if any) into the ROOT output file.
-    void StoreMetadata() const;
+    /// Version of the library format written by `StoreLibraryToFile()`:
+    /// `1` (legacy) has no content metadata, `2` adds format version and
+    /// content checksum to the voxel and channel counts.
+    static constexpr int FormatVersion = 2;
+
+    /// Description of the library content, from the metadata.
+    struct ContentMetadata {
+      std::optional<size_t> NVoxels;     ///< Number of voxels (if stored).
+      std::optional<size_t> NOpChannels; ///< Number of channels (if stored).
+      int formatVersion = 1;             ///< Library format version.
+      std::string checksum;              ///< Checksum of the entries (empty if none).
+    };
+
+    /// Reads the metadata from specified ROOT directory and sets it as current;
+    /// returns the description of the library content found there.
+    ContentMetadata LoadMetadata(TDirectory& srcDir);
+
+    /// Writes the current metadata (if any) into the ROOT output file,
+    /// including the `checksum` of the library entries.
+    void StoreMetadata(std::string const& checksum) const;
 
     /// Name of the optical channel number in the input tree
     static std::string const OpChannelBranchName;
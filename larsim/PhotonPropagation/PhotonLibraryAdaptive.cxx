@@ -0,0 +1,386 @@
+/**
+ * @file   larsim/PhotonPropagation/PhotonLibraryAdaptive.cxx
+ * @brief  Photon library with adaptively refined voxels.
+ * @see    larsim/PhotonPropagation/PhotonLibraryAdaptive.h
+ */
+
+#include "larsim/PhotonPropagation/PhotonLibraryAdaptive.h"
+
+#include "cetlib_except/exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// C/C++ standard libraries
+#include <cstring> // std::memcmp(), std::memcpy(), std::memset()
+#include <fstream>
+
+namespace {
+
+  /// Reads and checks the header of an adaptive library file.
+  phot::PhotonLibraryAdaptive::FileHeader_t
+  readHeader(std::string const& fileName)
+  {
+    using phot::PhotonLibraryAdaptive;
+
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in) {
+      throw cet::exception("PhotonLibraryAdaptive")
+        << "Can't open photon library '" << fileName << "'.\n";
+    }
+    PhotonLibraryAdaptive::FileHeader_t header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        (std::memcmp(header.magic, PhotonLibraryAdaptive::Magic, sizeof(header.magic)) != 0)) {
+      throw cet::exception("PhotonLibraryAdaptive")
+        << "File '" << fileName << "' is not an adaptive photon library.\n";
+    }
+    if (header.version != PhotonLibraryAdaptive::FormatVersion) {
+      throw cet::exception("PhotonLibraryAdaptive")
+        << "Photon library '" << fileName << "' has format version " << header.version
+        << ", only version " << PhotonLibraryAdaptive::FormatVersion << " is supported.\n";
+    }
+    return header;
+  }
+
+  /// Returns the voxel definition described in `header`.
+  sim::PhotonVoxelDef
+  voxelDefFrom(phot::PhotonLibraryAdaptive::FileHeader_t const& header)
+  {
+    return {header.lower[0],
+            header.upper[0],
+            header.steps[0],
+            header.lower[1],
+            header.upper[1],
+            header.steps[1],
+            header.lower[2],
+            header.upper[2],
+            header.steps[2]};
+  }
+
+} // local namespace
+
+namespace phot {
+
+  //------------------------------------------------------------
+  PhotonLibraryAdaptive::PhotonLibraryAdaptive(sim::PhotonVoxelDef const& voxelDef,
+                                               unsigned int maxLevel,
+                                               std::size_t nOpChannels,
+                                               bool hasReflected /* = false */,
+                                               bool hasReflectedT0 /* = false */)
+    : fGrid(voxelDef, maxLevel)
+    , fNVoxels(voxelDef.GetNVoxels())
+    , fNOpChannels(nOpChannels)
+    , fHasReflected(hasReflected)
+    , fHasReflectedT0(hasReflectedT0)
+    , fNRootCells(fGrid.NCells(0U))
+    , fZeros(nOpChannels, 0.0f)
+  {
+    fRoots.assign(std::size_t(fNRootCells[0]) * fNRootCells[1] * fNRootCells[2], NoData);
+  }
+
+  //------------------------------------------------------------
+  PhotonLibraryAdaptive::PhotonLibraryAdaptive(std::string const& fileName)
+    : PhotonLibraryAdaptive(readHeader(fileName), fileName)
+  {}
+
+  //------------------------------------------------------------
+  PhotonLibraryAdaptive::PhotonLibraryAdaptive(FileHeader_t const& header,
+                                               std::string const& fileName)
+    : PhotonLibraryAdaptive(voxelDefFrom(header),
+                            header.maxLevel,
+                            header.nOpChannels,
+                            header.flags & FlagReflected,
+                            header.flags & FlagReflectedT0)
+  {
+    mf::LogInfo("PhotonLibraryAdaptive")
+      << "Reading adaptive photon library from binary file: " << fileName;
+
+    if (header.nRoots != fRoots.size()) {
+      throw cet::exception("PhotonLibraryAdaptive")
+        << "Photon library '" << fileName << "' has " << header.nRoots
+        << " root cells, its voxelization requires " << fRoots.size() << ".\n";
+    }
+
+    std::ifstream in(fileName, std::ios::binary);
+    in.seekg(sizeof(header));
+
+    auto readInto = [&in](auto& data, std::size_t n) {
+      data.resize(n);
+      in.read(reinterpret_cast<char*>(data.data()), n * sizeof(data[0]));
+    };
+    fNRows = header.nRows;
+    std::size_t const tableSize = fNRows * fNOpChannels;
+    readInto(fRoots, header.nRoots);
+    readInto(fNodes, header.nNodes);
+    readInto(fCounts, tableSize);
+    if (fHasReflected) readInto(fReflCounts, tableSize);
+    if (fHasReflectedT0) readInto(fReflT0s, tableSize);
+    if (!in) {
+      throw cet::exception("PhotonLibraryAdaptive")
+        << "Photon library '" << fileName << "' is truncated.\n";
+    }
+
+    // nodes are followed in lookups without checks: check them all here
+    auto const badNode = [this](std::int32_t node) {
+      if (node >= 0) return (std::size_t(node) + 8U > fNodes.size());
+      if (node == NoData) return false;
+      return (std::size_t(-(node + 2)) >= fNRows);
+    };
+    for (std::int32_t node : fRoots) {
+      if (badNode(node)) {
+        throw cet::exception("PhotonLibraryAdaptive")
+          << "Photon library '" << fileName << "' has an invalid root node (" << node << ").\n";
+      }
+    }
+    for (std::int32_t node : fNodes) {
+      if (badNode(node)) {
+        throw cet::exception("PhotonLibraryAdaptive")
+          << "Photon library '" << fileName << "' has an invalid node (" << node << ").\n";
+      }
+    }
+
+    mf::LogInfo("PhotonLibraryAdaptive")
+      << "Photon lookup table size : " << fNVoxels << " voxels,  " << fNOpChannels
+      << " channels, stored in " << fNRows << " cells (" << fNodes.size()
+      << " octree nodes, finest level " << MaxLevel() << "); " << GetVoxelDef();
+  }
+
+  //------------------------------------------------------------
+  float
+  PhotonLibraryAdaptive::GetCount(size_t Voxel, size_t OpChannel) const
+  {
+    if (OpChannel >= fNOpChannels) return 0;
+    float const* values = row(fCounts, Voxel);
+    return values ? values[OpChannel] : 0;
+  }
+
+  //------------------------------------------------------------
+  float
+  PhotonLibraryAdaptive::GetReflCount(size_t Voxel, size_t OpChannel) const
+  {
+    if (!fHasReflected || (OpChannel >= fNOpChannels)) return 0;
+    float const* values = row(fReflCounts, Voxel);
+    return values ? values[OpChannel] : 0;
+  }
+
+  //------------------------------------------------------------
+  float
+  PhotonLibraryAdaptive::GetReflT0(size_t Voxel, size_t OpChannel) const
+  {
+    if (!fHasReflectedT0 || (OpChannel >= fNOpChannels)) return 0;
+    float const* values = row(fReflT0s, Voxel);
+    return values ? values[OpChannel] : 0;
+  }
+
+  //------------------------------------------------------------
+  size_t
+  PhotonLibraryAdaptive::MemoryFootprint() const
+  {
+    return (fRoots.size() + fNodes.size()) * sizeof(std::int32_t) +
+           (fCounts.size() + fReflCounts.size() + fReflT0s.size() + fZeros.size()) *
+             sizeof(float);
+  }
+
+  //------------------------------------------------------------
+  IPhotonLibrary::Counts_t
+  PhotonLibraryAdaptive::GetCounts(size_t Voxel) const
+  {
+    return row(fCounts, Voxel);
+  }
+
+  //------------------------------------------------------------
+  IPhotonLibrary::Counts_t
+  PhotonLibraryAdaptive::GetReflCounts(size_t Voxel) const
+  {
+    return fHasReflected ? row(fReflCounts, Voxel) : nullptr;
+  }
+
+  //------------------------------------------------------------
+  IPhotonLibrary::T0s_t
+  PhotonLibraryAdaptive::GetReflT0s(size_t Voxel) const
+  {
+    return fHasReflectedT0 ? row(fReflT0s, Voxel) : nullptr;
+  }
+
+  //------------------------------------------------------------
+  PhotonLibraryAdaptive::Cell_t
+  PhotonLibraryAdaptive::LeafOf(std::size_t voxel) const
+  {
+    auto const coords = GetVoxelDef().GetVoxelCoords(voxel);
+    unsigned int const maxLevel = MaxLevel();
+
+    Cell_t cell = fGrid.CellOf(voxel, 0U);
+    std::int32_t node = fRoots[rootIndex(cell.index)];
+    while ((node >= 0) && (cell.level < maxLevel)) {
+      ++cell.level;
+      unsigned int const shift = maxLevel - cell.level;
+      unsigned int octant = 0U;
+      for (unsigned int i = 0; i < 3U; ++i) {
+        cell.index[i] = static_cast<unsigned int>(coords[i]) >> shift;
+        octant |= (cell.index[i] & 1U) << i;
+      }
+      node = fNodes[node + octant];
+    }
+    return cell;
+  }
+
+  //------------------------------------------------------------
+  void
+  PhotonLibraryAdaptive::SetLeaf(Cell_t const& cell,
+                                 float const* counts,
+                                 float const* reflCounts /* = nullptr */,
+                                 float const* reflT0s /* = nullptr */)
+  {
+    if (!fGrid.isValid(cell)) {
+      throw cet::exception("PhotonLibraryAdaptive")
+        << "SetLeaf(): cell " << cell.level << " [ " << cell.index[0] << " " << cell.index[1]
+        << " " << cell.index[2] << " ] is not in the voxelization.\n";
+    }
+    auto overlapError = [&cell]() {
+      return cet::exception("PhotonLibraryAdaptive")
+             << "SetLeaf(): cell " << cell.level << " [ " << cell.index[0] << " "
+             << cell.index[1] << " " << cell.index[2] << " ] overlaps cells already stored.\n";
+    };
+
+    // the slot holding the current node is either a root or a node
+    std::array<unsigned int, 3U> rootCell;
+    for (unsigned int i = 0; i < 3U; ++i)
+      rootCell[i] = cell.index[i] >> cell.level;
+    std::int32_t* slot = &fRoots[rootIndex(rootCell)];
+
+    for (unsigned int level = 1; level <= cell.level; ++level) {
+      if (*slot == NoData) { // refine
+        std::int32_t const firstChild = fNodes.size();
+        *slot = firstChild;
+        fNodes.resize(fNodes.size() + 8U, NoData);
+        slot = &fNodes[firstChild];
+      }
+      else if (*slot < 0)
+        throw overlapError();
+      else
+        slot = &fNodes[*slot];
+
+      unsigned int const shift = cell.level - level;
+      unsigned int octant = 0U;
+      for (unsigned int i = 0; i < 3U; ++i)
+        octant |= ((cell.index[i] >> shift) & 1U) << i;
+      slot += octant;
+    }
+    if (*slot != NoData) throw overlapError();
+
+    *slot = -std::int32_t(fNRows + 2);
+    ++fNRows;
+    fCounts.insert(fCounts.end(), counts, counts + fNOpChannels);
+    if (fHasReflected) {
+      if (reflCounts)
+        fReflCounts.insert(fReflCounts.end(), reflCounts, reflCounts + fNOpChannels);
+      else
+        fReflCounts.insert(fReflCounts.end(), fNOpChannels, 0.0f);
+    }
+    if (fHasReflectedT0) {
+      if (reflT0s)
+        fReflT0s.insert(fReflT0s.end(), reflT0s, reflT0s + fNOpChannels);
+      else
+        fReflT0s.insert(fReflT0s.end(), fNOpChannels, 0.0f);
+    }
+  }
+
+  //------------------------------------------------------------
+  void
+  PhotonLibraryAdaptive::WriteLibrary(std::string const& fileName) const
+  {
+    FileHeader_t header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = FormatVersion;
+    if (fHasReflected) header.flags |= FlagReflected;
+    if (fHasReflectedT0) header.flags |= FlagReflectedT0;
+    header.maxLevel = MaxLevel();
+
+    sim::PhotonVoxelDef const& voxelDef = GetVoxelDef();
+    auto const& steps = voxelDef.GetSteps();
+    geo::Point_t const& lower = voxelDef.GetRegionLowerCorner();
+    geo::Point_t const& upper = voxelDef.GetRegionUpperCorner();
+    for (std::size_t i = 0; i < 3; ++i)
+      header.steps[i] = steps[i];
+    header.lower[0] = lower.X();
+    header.lower[1] = lower.Y();
+    header.lower[2] = lower.Z();
+    header.upper[0] = upper.X();
+    header.upper[1] = upper.Y();
+    header.upper[2] = upper.Z();
+
+    header.nOpChannels = fNOpChannels;
+    header.nRoots = fRoots.size();
+    header.nNodes = fNodes.size();
+    header.nRows = fNRows;
+
+    mf::LogInfo("PhotonLibraryAdaptive")
+      << "Writing adaptive photon library (" << fNRows << " cells, " << fNOpChannels
+      << " channels) to binary file: " << fileName;
+
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    auto write = [&out](auto const& data) {
+      out.write(reinterpret_cast<char const*>(data.data()), data.size() * sizeof(data[0]));
+    };
+    out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    write(fRoots);
+    write(fNodes);
+    write(fCounts);
+    if (fHasReflected) write(fReflCounts);
+    if (fHasReflectedT0) write(fReflT0s);
+    out.close();
+    if (!out) {
+      throw cet::exception("PhotonLibraryAdaptive")
+        << "Error while writing the photon library into '" << fileName << "'.\n";
+    }
+  }
+
+  //------------------------------------------------------------
+  bool
+  PhotonLibraryAdaptive::isAdaptiveLibraryFile(std::string const& fileName)
+  {
+    std::ifstream in(fileName, std::ios::binary);
+    char magic[sizeof(Magic)];
+    if (!in.read(magic, sizeof(magic))) return false;
+    return std::memcmp(magic, Magic, sizeof(Magic)) == 0;
+  }
+
+  //------------------------------------------------------------
+  std::int32_t
+  PhotonLibraryAdaptive::leafNode(std::size_t Voxel) const
+  {
+    auto const coords = GetVoxelDef().GetVoxelCoords(Voxel);
+    unsigned int const maxLevel = MaxLevel();
+
+    std::array<unsigned int, 3U> index;
+    for (unsigned int i = 0; i < 3U; ++i)
+      index[i] = static_cast<unsigned int>(coords[i]) >> maxLevel;
+    std::int32_t node = fRoots[rootIndex(index)];
+
+    for (unsigned int shift = maxLevel; (node >= 0) && (shift > 0);) {
+      --shift;
+      unsigned int const octant = ((static_cast<unsigned int>(coords[0]) >> shift) & 1U) |
+                                  (((static_cast<unsigned int>(coords[1]) >> shift) & 1U) << 1) |
+                                  (((static_cast<unsigned int>(coords[2]) >> shift) & 1U) << 2);
+      node = fNodes[node + octant];
+    }
+    return (node >= 0) ? NoData : node; // inner nodes can't be on the finest level
+  }
+
+  //------------------------------------------------------------
+  float const*
+  PhotonLibraryAdaptive::row(std::vector<float> const& table, std::size_t Voxel) const
+  {
+    if (Voxel >= fNVoxels) return nullptr;
+    std::int32_t const node = leafNode(Voxel);
+    if (node == NoData) return fZeros.data();
+    return table.data() + std::size_t(-(node + 2)) * fNOpChannels;
+  }
+
+  //------------------------------------------------------------
+  std::size_t
+  PhotonLibraryAdaptive::rootIndex(std::array<unsigned int, 3U> const& index) const
+  {
+    return index[0] + fNRootCells[0] * (index[1] + std::size_t(fNRootCells[1]) * index[2]);
+  }
+
+} // namespace phot
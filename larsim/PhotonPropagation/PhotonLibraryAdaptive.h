@@ -0,0 +1,232 @@
+/**
+ * @file   larsim/PhotonPropagation/PhotonLibraryAdaptive.h
+ * @brief  Photon library with adaptively refined voxels.
+ * @see    larsim/PhotonPropagation/PhotonLibraryAdaptive.cxx
+ *
+ * The library answers for the fine voxels of a `sim::PhotonVoxelDef`, like
+ * any other library, but stores one set of values per _leaf cell_ of an
+ * octree refinement (see `phot::AdaptiveVoxelGrid`): all the fine voxels in
+ * a leaf share the same values. Regions where visibility is smooth or
+ * negligible are covered by few large cells, saving both the simulation of
+ * their voxels and the storage of their values.
+ *
+ * Each cell of level `0` is the root of an octree. A node is either a leaf,
+ * with the index of its row of values, or an inner node with eight children
+ * (one per octant, `x` being the lowest bit of the octant number). Lookups
+ * descend at most `MaxLevel()` nodes.
+ *
+ * Layout of the binary file:
+ *  * a header (`FileHeader_t`);
+ *  * the node index of each root cell (`nRoots` `std::int32_t`);
+ *  * the nodes (`nNodes` `std::int32_t`);
+ *  * the direct visibility table (`nRows x NOpChannels()` `float`);
+ *  * optionally, the reflected visibility table (same size);
+ *  * optionally, the reflected light first arrival time table (same size).
+ *
+ * `BuildAdaptivePhotonLibrary` module writes such a file from the results of
+ * adaptive library build jobs.
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_PHOTONLIBRARYADAPTIVE_H
+#define LARSIM_PHOTONPROPAGATION_PHOTONLIBRARYADAPTIVE_H
+
+#include "larsim/PhotonPropagation/AdaptiveVoxelGrid.h"
+#include "larsim/PhotonPropagation/IPhotonLibrary.h"
+#include "larsim/Simulation/PhotonVoxels.h"
+
+// C/C++ standard libraries
+#include <array>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace phot {
+
+  /// Photon library storing values per leaf of an adaptive octree of voxels.
+  class PhotonLibraryAdaptive : public IPhotonLibrary {
+  public:
+    using Cell_t = AdaptiveVoxelGrid::Cell_t;
+
+    /// Version of the binary format written by this class.
+    static constexpr std::uint32_t FormatVersion = 1U;
+
+    /// Identifier at the beginning of each adaptive library file.
+    static constexpr char Magic[8] = {'L', 'A', 'R', 'P', 'L', 'A', 'D', '\0'};
+
+    /// Flag: the file includes the reflected visibility table.
+    static constexpr std::uint32_t FlagReflected = 0x1;
+    /// Flag: the file includes the reflected light arrival time table.
+    static constexpr std::uint32_t FlagReflectedT0 = 0x2;
+
+    /// Header of the binary file.
+    struct FileHeader_t {
+      char magic[8];             ///< Identifier of the format (`Magic`).
+      std::uint32_t version;     ///< Version of the format.
+      std::uint32_t flags;       ///< Content flags (`FlagReflected`, ...).
+      std::uint32_t maxLevel;    ///< Finest refinement level.
+      std::int32_t steps[3];     ///< Voxel definition: divisions on x, y and z.
+      double lower[3];           ///< Voxel definition: lower corner [cm]
+      double upper[3];           ///< Voxel definition: upper corner [cm]
+      std::uint64_t nOpChannels; ///< Number of channels per row.
+      std::uint64_t nRoots;      ///< Number of level `0` cells.
+      std::uint64_t nNodes;      ///< Number of octree nodes.
+      std::uint64_t nRows;       ///< Number of rows of values (leaves with data).
+    }; // FileHeader_t
+
+    /**
+     * @brief Creates an empty library, to be filled with `SetLeaf()`.
+     * @param voxelDef the definition of the fine voxels
+     * @param maxLevel the finest refinement level
+     * @param nOpChannels number of channels
+     * @param hasReflected whether to store reflected light visibilities
+     * @param hasReflectedT0 whether to store reflected light arrival times
+     */
+    PhotonLibraryAdaptive(sim::PhotonVoxelDef const& voxelDef,
+                          unsigned int maxLevel,
+                          std::size_t nOpChannels,
+                          bool hasReflected = false,
+                          bool hasReflectedT0 = false);
+
+    /// Reads the library from the specified binary file.
+    /// @throw cet::exception (category: `"PhotonLibraryAdaptive"`) on error
+    PhotonLibraryAdaptive(std::string const& fileName);
+
+    virtual float GetCount(size_t Voxel, size_t OpChannel) const override;
+    virtual float GetReflCount(size_t Voxel, size_t OpChannel) const override;
+    virtual float GetReflT0(size_t Voxel, size_t OpChannel) const override;
+
+    /// Returns the `NOpChannels()` values of the leaf including `Voxel`.
+    virtual Counts_t GetCounts(size_t Voxel) const override;
+    virtual Counts_t GetReflCounts(size_t Voxel) const override;
+    virtual T0s_t GetReflT0s(size_t Voxel) const override;
+
+    virtual bool
+    hasReflected() const override
+    {
+      return fHasReflected;
+    }
+
+    virtual bool
+    hasReflectedT0() const override
+    {
+      return fHasReflectedT0;
+    }
+
+    virtual int
+    NOpChannels() const override
+    {
+      return fNOpChannels;
+    }
+    virtual int
+    NVoxels() const override
+    {
+      return fNVoxels;
+    }
+
+    /// Returns an estimate of the memory taken by the octree and its rows [bytes].
+    virtual size_t MemoryFootprint() const override;
+
+    /// Returns the geometry of the cells.
+    AdaptiveVoxelGrid const&
+    GetGrid() const
+    {
+      return fGrid;
+    }
+
+    /// Returns the definition of the fine voxels.
+    sim::PhotonVoxelDef const&
+    GetVoxelDef() const
+    {
+      return fGrid.GetVoxelDef();
+    }
+
+    /// Returns the finest refinement level.
+    unsigned int
+    MaxLevel() const
+    {
+      return fGrid.MaxLevel();
+    }
+
+    /// Returns the number of rows of values stored.
+    std::size_t
+    NRows() const
+    {
+      return fNRows;
+    }
+
+    /// Returns the number of octree nodes.
+    std::size_t
+    NNodes() const
+    {
+      return fNodes.size();
+    }
+
+    /// Returns the leaf cell including the fine voxel `voxel`.
+    Cell_t LeafOf(std::size_t voxel) const;
+
+    /**
+     * @brief Stores the values of a leaf cell.
+     * @param cell the leaf cell
+     * @param counts `NOpChannels()` direct visibilities
+     * @param reflCounts `NOpChannels()` reflected visibilities (if stored)
+     * @param reflT0s `NOpChannels()` reflected arrival times (if stored)
+     * @throw cet::exception (category: `"PhotonLibraryAdaptive"`) if the cell
+     *        is invalid, or it overlaps a leaf already stored
+     *
+     * The octree is refined as needed to reach `cell`.
+     */
+    void SetLeaf(Cell_t const& cell,
+                 float const* counts,
+                 float const* reflCounts = nullptr,
+                 float const* reflT0s = nullptr);
+
+    /// Writes the library into a binary file.
+    /// @throw cet::exception (category: `"PhotonLibraryAdaptive"`) on error
+    void WriteLibrary(std::string const& fileName) const;
+
+    /// Returns whether the specified file starts with the adaptive format magic.
+    static bool isAdaptiveLibraryFile(std::string const& fileName);
+
+  private:
+    /// Node value of a leaf without values (all zero).
+    static constexpr std::int32_t NoData = -1;
+
+    AdaptiveVoxelGrid fGrid;
+    std::size_t fNVoxels = 0U;
+    std::size_t fNOpChannels = 0U;
+    bool fHasReflected = false;
+    bool fHasReflectedT0 = false;
+
+    std::array<unsigned int, 3U> fNRootCells; ///< Level `0` cells on each direction.
+
+    /// Node of each level `0` cell.
+    std::vector<std::int32_t> fRoots;
+
+    /// Octree nodes: first child of inner nodes (`>= 0`), `NoData`, or row
+    /// `r` of a leaf, as `-(r + 2)`.
+    std::vector<std::int32_t> fNodes;
+
+    std::size_t fNRows = 0U;
+    std::vector<float> fCounts;
+    std::vector<float> fReflCounts;
+    std::vector<float> fReflT0s;
+    std::vector<float> fZeros; ///< Values of voxels without data.
+
+    /// Reads the data from `fileName`, whose header is `header`.
+    PhotonLibraryAdaptive(FileHeader_t const& header, std::string const& fileName);
+
+    /// Returns the node value of the leaf including `Voxel`.
+    std::int32_t leafNode(std::size_t Voxel) const;
+
+    /// Returns the row of `table` for `Voxel` (`nullptr` if invalid voxel).
+    float const* row(std::vector<float> const& table, std::size_t Voxel) const;
+
+    /// Returns the index of the root of the level `0` cell with indices `index`.
+    std::size_t rootIndex(std::array<unsigned int, 3U> const& index) const;
+
+  }; // class PhotonLibraryAdaptive
+
+} // namespace phot
+
+#endif // LARSIM_PHOTONPROPAGATION_PHOTONLIBRARYADAPTIVE_H
@@ -5,7 +5,11 @@
 // Ben Jones, MIT, April 2012
 //   bjpjones@mit.edu
 //
+#include <array>
+#include <cstdint>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "art/Framework/Principal/fwd.h"
@@ -13,15 +17,77 @@
 #include "art_root_io/TFileService.h"
 #include "art/Framework/Core/EDAnalyzer.h"
 #include "art/Framework/Core/ModuleMacros.h"
+#include "cetlib_except/exception.h"
 
 #include "larcore/Geometry/Geometry.h"
 #include "larsim/PhotonPropagation/PhotonVisibilityService.h"
 #include "larsim/Simulation/PhotonVoxels.h"
 #include "larcorealg/CoreUtils/DumpUtils.h" // lar::dump::vector3D()
 
+#include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
+
 #include "TH1D.h"
 #include "TH2D.h"
 #include "TH3D.h"
+#include "TTree.h"
+
+namespace {
+
+  /// Content of a projection of the voxel grid, with one bin per voxel
+  /// coordinate on each of two axes.
+  struct VoxelProjection {
+    unsigned int axisA = 0; ///< Voxel coordinate on the first axis.
+    unsigned int axisB = 0; ///< Voxel coordinate on the second axis.
+    unsigned int nA = 0;
+    unsigned int nB = 0;
+    std::vector<double> content; ///< `[a * nB + b]`
+
+    VoxelProjection() = default;
+    VoxelProjection(unsigned int axisA, unsigned int axisB, std::array<unsigned int, 3U> const& steps)
+      : axisA(axisA), axisB(axisB), nA(steps[axisA]), nB(steps[axisB]), content(nA * nB, 0.)
+    {}
+
+    void add(std::array<int, 3U> const& coords, double w)
+    { content[coords[axisA] * nB + coords[axisB]] += w; }
+
+    void add(VoxelProjection const& other)
+    {
+      for (std::size_t i = 0; i < content.size(); ++i) content[i] += other.content[i];
+    }
+
+    /// Fills `hist` so that it has the same content as if each voxel had been
+    /// filled at its coordinates, and `entries` entries.
+    void fill(TH2D& hist, double entries) const
+    {
+      for (unsigned int a = 0; a < nA; ++a) {
+        for (unsigned int b = 0; b < nB; ++b) {
+          if (double const w = content[a * nB + b]; w != 0.) hist.Fill(a, b, w);
+        }
+      }
+      hist.SetEntries(entries);
+    }
+  };
+
+  /// Per-detector projections (the only ones summing over many voxels per channel).
+  struct DetectorProjections {
+    std::vector<VoxelProjection> x, y, z;
+  };
+
+  /// Whether the voxel is analysed when sampling one voxel every `sampling`.
+  bool isSampled(unsigned int voxel, unsigned int sampling)
+  {
+    if (sampling <= 1) return true;
+    // a hash rather than a stride, so that the sample does not follow the grid
+    std::uint64_t h = voxel + 0x9e3779b97f4a7c15ULL;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h ^= (h >> 31);
+    return (h % sampling) == 0;
+  }
+
+} // local namespace
 
 namespace phot {
 
@@ -43,6 +109,10 @@ namespace phot {
     int         fOpDet;
     bool        fEachSlice;
     bool        fEachDetector;
+    bool        fParallel;        ///< Analyse voxel ranges in parallel.
+    unsigned int fVoxelSampling;  ///< Analyse one voxel every this many.
+    bool        fWriteHistograms; ///< Write the projections as ROOT histograms.
+    bool        fWriteArrays;     ///< Write the projections as arrays in a tree.
   };
 
 }
@@ -56,7 +126,15 @@ namespace phot {
     , fOpDet{pset.get<int>("opdet")}
     , fEachSlice{pset.get<bool>("each_slice")}
     , fEachDetector{pset.get<bool>("each_detector")}
+    , fParallel{pset.get<bool>("parallel", false)}
+    , fVoxelSampling{pset.get<unsigned int>("voxel_sampling", 1U)}
+    , fWriteHistograms{pset.get<bool>("write_histograms", true)}
+    , fWriteArrays{pset.get<bool>("write_arrays", false)}
   {
+    if (fVoxelSampling == 0) {
+      throw cet::exception("PhotonLibraryAnalyzer")
+        << "voxel_sampling must be at least 1 (1 = all voxels).\n";
+    }
     std::cout<<"Photon library analyzer constructor "<<std::endl;
   }
 
@@ -80,19 +158,22 @@ namespace phot {
     mf::LogInfo("PhotonLibraryAnalyzer") << "UpperCorner: " << lar::dump::vector3D(UpperCorner) << "\n"
                                          << "LowerCorner: " << lar::dump::vector3D(LowerCorner);
 
-    auto const [ XSteps, YSteps, ZSteps ] = TheVoxelDef.GetSteps(); // unsigned int
+    auto const Steps = TheVoxelDef.GetSteps();
+    auto const [ XSteps, YSteps, ZSteps ] = Steps; // unsigned int
 
-    // for c2: FullVolume is unused, just call tfs->make
-    // TH3D *FullVolume = tfs->make<TH3D>("FullVolume","FullVolume",
-    tfs->make<TH3D>("FullVolume","FullVolume",
-                    XSteps,LowerCorner.X(),UpperCorner.X(),
-                    YSteps,LowerCorner.Y(),UpperCorner.Y(),
-                    ZSteps,LowerCorner.Z(),UpperCorner.Z());
+    if (fWriteHistograms) {
+      // for c2: FullVolume is unused, just call tfs->make
+      // TH3D *FullVolume = tfs->make<TH3D>("FullVolume","FullVolume",
+      tfs->make<TH3D>("FullVolume","FullVolume",
+                      XSteps,LowerCorner.X(),UpperCorner.X(),
+                      YSteps,LowerCorner.Y(),UpperCorner.Y(),
+                      ZSteps,LowerCorner.Z(),UpperCorner.Z());
+    }
 
 
     int reportnum=10000;
 
-    int newX, newY;
+    unsigned int newX, newY;
     if (fAltXAxis == "Z") {
       newX = 2; // Z
       newY = 1; // Y
@@ -102,147 +183,232 @@ namespace phot {
       newY = 2; // Z
     }
 
+    // the library must be loaded before the (possibly concurrent) access
+    pvs->LoadLibrary();
 
+    unsigned int const NVoxels = TheVoxelDef.GetNVoxels();
+    size_t NOpChannels = pvs->NOpChannels();
+    if (fOpDet >= 0 && static_cast<size_t>(fOpDet) >= NOpChannels) {
+      throw cet::exception("PhotonLibraryAnalyzer")
+        << "opdet " << fOpDet << " is not in the library (" << NOpChannels << " channels).\n";
+    }
 
-    mf::LogInfo("PhotonLibraryAnalyzer")<<"Analyzing photon library - making historams"<< std::endl;
+    // each sampled voxel stands for this many voxels in the sums
+    double const weight = fVoxelSampling;
 
-    TH2D* XProjection;
-    if (fAltXAxis == "Z") XProjection = tfs->make<TH2D>("XProjection","XProjection",ZSteps,0,ZSteps,YSteps,0,YSteps);
-    else                  XProjection = tfs->make<TH2D>("XProjection","XProjection",YSteps,0,YSteps,ZSteps,0,ZSteps);
-    TH2D* YProjection = tfs->make<TH2D>("YProjection","YProjection",XSteps,0,XSteps,ZSteps,0,ZSteps);
-    TH2D* ZProjection = tfs->make<TH2D>("ZProjection","ZProjection",XSteps,0,XSteps,YSteps,0,YSteps);
 
-    //    TH1D * PMTsNoVisibility = tfs->make<TH1D>("PMTsNoVisibility","PMTsNoVisibility", NOpDet,0,NOpDet);
+    mf::LogInfo("PhotonLibraryAnalyzer")<<"Analyzing photon library - running through voxels "<< std::endl;
 
-    TH1D* VisByN = tfs->make<TH1D>("VisByN","VisByN", NOpDet, 0, NOpDet);
+    // the total visibility of each voxel is written by the only task processing
+    // it; the per-detector projections are summed in each thread, then merged
+    std::vector<float> TotalVisibilities(NVoxels, 0.f);
+    auto const makeDetectorProjections = [&]() {
+      DetectorProjections proj;
+      if (fEachDetector) {
+        proj.x.assign(NOpChannels, VoxelProjection{newX, newY, Steps});
+        proj.y.assign(NOpChannels, VoxelProjection{0, 2, Steps});
+        proj.z.assign(NOpChannels, VoxelProjection{0, 1, Steps});
+      }
+      return proj;
+    };
+    tbb::enumerable_thread_specific<DetectorProjections> ThreadDetectorProjections{
+      makeDetectorProjections};
+
+    auto const analyzeVoxels = [&](unsigned int first, unsigned int last, bool report) {
+      DetectorProjections& detProj = ThreadDetectorProjections.local();
+      for(unsigned int i=first; i!=last; ++i)
+      {
+        if(report && i%reportnum==0) std::cout<<"Photon library analyzer at voxel " << i<<std::endl;
+        if (!isSampled(i, fVoxelSampling)) continue;
 
-    TH2D* XInvisibles;
-    if (fAltXAxis == "Z") XInvisibles = tfs->make<TH2D>("XInvisibles","XInvisibles",ZSteps,0,ZSteps,YSteps,0,YSteps);
-    else                  XInvisibles = tfs->make<TH2D>("XInvisibles","XInvisibles",YSteps,0,YSteps,ZSteps,0,ZSteps);
-    TH2D* YInvisibles = tfs->make<TH2D>("YInvisibles","YInvisibles",XSteps,0,XSteps,ZSteps,0,ZSteps);
-    TH2D* ZInvisibles = tfs->make<TH2D>("ZInvisibles","ZInvisibles",XSteps,0,XSteps,YSteps,0,YSteps);
+        const float* Visibilities = pvs->GetLibraryEntries(i);
 
+        float TotalVis=0;
+        if (fOpDet < 0) {
+          for(size_t ichan=0; ichan!=NOpChannels; ++ichan)
+          {
+            TotalVis+=Visibilities[ichan];
+          }
+        }
+        else {
+          TotalVis = Visibilities[fOpDet];
+        }
+        TotalVisibilities[i] = TotalVis;
+
+        if (fEachDetector) {
+          auto const Coords = TheVoxelDef.GetVoxelCoords(i);
+          for(size_t ichan=0; ichan!=NOpChannels; ++ichan) {
+            detProj.x[ichan].add(Coords, weight * Visibilities[ichan]);
+            detProj.y[ichan].add(Coords, weight * Visibilities[ichan]);
+            detProj.z[ichan].add(Coords, weight * Visibilities[ichan]);
+          }
+        }
+      }
+    };
 
+    if (fParallel) {
+      tbb::parallel_for(tbb::blocked_range<unsigned int>(0, NVoxels, 1024),
+                        [&](tbb::blocked_range<unsigned int> const& range) {
+                          analyzeVoxels(range.begin(), range.end(), false);
+                        });
+    }
+    else {
+      analyzeVoxels(0, NVoxels, true);
+    }
 
+    DetectorProjections detProj = makeDetectorProjections();
+    if (fEachDetector) {
+      ThreadDetectorProjections.combine_each([&detProj, NOpChannels](DetectorProjections const& local) {
+        for(size_t ichan=0; ichan!=NOpChannels; ++ichan) {
+          detProj.x[ichan].add(local.x[ichan]);
+          detProj.y[ichan].add(local.y[ichan]);
+          detProj.z[ichan].add(local.z[ichan]);
+        }
+      });
+    }
+    ThreadDetectorProjections.clear();
 
 
-    std::vector<TH2D*> TheXCrossSections;
-    std::vector<TH2D*> TheYCrossSections;
-    std::vector<TH2D*> TheZCrossSections;
-    if (fEachSlice) {
+    mf::LogInfo("PhotonLibraryAnalyzer")<<"Analyzing photon library - making projections"<< std::endl;
 
+    VoxelProjection XProjection{newX, newY, Steps};
+    VoxelProjection YProjection{0, 2, Steps};
+    VoxelProjection ZProjection{0, 1, Steps};
+    VoxelProjection XInvisibles{newX, newY, Steps};
+    VoxelProjection YInvisibles{0, 2, Steps};
+    VoxelProjection ZInvisibles{0, 1, Steps};
+    double nSampled = 0., nInvisibles = 0.;
 
-      for(unsigned int i=0; i!=XSteps; ++i)
-      {
-        std::stringstream ss("");
-        ss.flush();
-        ss<<"projX"<<i;
-        if (fAltXAxis == "Z")
-          TheXCrossSections.push_back(tfs->make<TH2D>(ss.str().c_str(),ss.str().c_str(), ZSteps, 0,ZSteps, YSteps, 0,YSteps));
-        else
-          TheXCrossSections.push_back(tfs->make<TH2D>(ss.str().c_str(),ss.str().c_str(), YSteps, 0,YSteps, ZSteps, 0,ZSteps));
+    std::vector<VoxelProjection> TheXCrossSections;
+    std::vector<VoxelProjection> TheYCrossSections;
+    std::vector<VoxelProjection> TheZCrossSections;
+    std::array<std::vector<double>, 3U> CrossSectionEntries;
+    if (fEachSlice) {
+      TheXCrossSections.assign(XSteps, VoxelProjection{newX, newY, Steps});
+      TheYCrossSections.assign(YSteps, VoxelProjection{0, 2, Steps});
+      TheZCrossSections.assign(ZSteps, VoxelProjection{0, 1, Steps});
+      for (unsigned int axis = 0; axis < 3; ++axis) CrossSectionEntries[axis].assign(Steps[axis], 0.);
+    }
 
+    for(unsigned int i=0; i!=NVoxels; ++i)
+    {
+      if (!isSampled(i, fVoxelSampling)) continue;
 
-      }
+      auto const Coords = TheVoxelDef.GetVoxelCoords(i);
+      float const TotalVis = TotalVisibilities[i];
+      ++nSampled;
 
-      for(unsigned int i=0; i!=YSteps; ++i)
+      if(TotalVis==0)
       {
-        std::stringstream ss("");
-        ss.flush();
-        ss<<"projY"<<i;
-        TheYCrossSections.push_back(tfs->make<TH2D>(ss.str().c_str(),ss.str().c_str(), XSteps, 0,XSteps, ZSteps, 0, ZSteps));
-
+        XInvisibles.add(Coords, weight);
+        YInvisibles.add(Coords, weight);
+        ZInvisibles.add(Coords, weight);
+        ++nInvisibles;
       }
 
-      for(unsigned int i=0; i!=ZSteps; ++i)
-      {
-        std::stringstream ss("");
-        ss.flush();
-        ss<<"projZ"<<i;
-        TheZCrossSections.push_back(tfs->make<TH2D>(ss.str().c_str(),ss.str().c_str(), XSteps, 0,XSteps, YSteps, 0,YSteps));
-
+      // each bin of a cross section is a single voxel: no weight
+      if (fEachSlice) {
+        TheXCrossSections.at(Coords.at(0)).add(Coords, TotalVis);
+        TheYCrossSections.at(Coords.at(1)).add(Coords, TotalVis);
+        TheZCrossSections.at(Coords.at(2)).add(Coords, TotalVis);
+        for (unsigned int axis = 0; axis < 3; ++axis) ++CrossSectionEntries[axis][Coords[axis]];
       }
+
+      // Always make the summed projections
+      XProjection.add(Coords, weight * TotalVis);
+      YProjection.add(Coords, weight * TotalVis);
+      ZProjection.add(Coords, weight * TotalVis);
     }
 
 
-    std::vector<TH2D*> TheXProjections;
-    std::vector<TH2D*> TheYProjections;
-    std::vector<TH2D*> TheZProjections;
+    if (fWriteHistograms) {
+      mf::LogInfo("PhotonLibraryAnalyzer")<<"Analyzing photon library - making historams"<< std::endl;
 
-    if (fEachDetector) {
+      auto const makeHist = [&tfs](std::string const& name, VoxelProjection const& proj, double entries) {
+        TH2D* hist = tfs->make<TH2D>(name.c_str(), name.c_str(), proj.nA, 0, proj.nA, proj.nB, 0, proj.nB);
+        proj.fill(*hist, entries);
+      };
 
-      mf::LogInfo("PhotonLibraryAnalyzer")<<"Making projections for each of " << NOpDet << " photon detectors" << std::endl;
+      makeHist("XProjection", XProjection, nSampled);
+      makeHist("YProjection", YProjection, nSampled);
+      makeHist("ZProjection", ZProjection, nSampled);
 
-      for(int i=0; i<NOpDet; ++i)
-      {
-        char ss[99];
+      //    TH1D * PMTsNoVisibility = tfs->make<TH1D>("PMTsNoVisibility","PMTsNoVisibility", NOpDet,0,NOpDet);
 
-        sprintf(ss, "ProjXOpDet%d", i);
-        if (fAltXAxis == "Z")
-          TheXProjections.push_back(tfs->make<TH2D>(ss, ss, ZSteps, 0,ZSteps, YSteps, 0,YSteps));
-        else
-          TheXProjections.push_back(tfs->make<TH2D>(ss, ss, YSteps, 0,YSteps, ZSteps, 0,ZSteps));
+      TH1D* VisByN = tfs->make<TH1D>("VisByN","VisByN", NOpDet, 0, NOpDet);
+      VisByN->Fill(NOpChannels, weight * nSampled);
+      VisByN->SetEntries(nSampled);
 
-        sprintf(ss, "ProjYOpDet%d", i);
-        TheYProjections.push_back(tfs->make<TH2D>(ss, ss, XSteps, 0,XSteps, ZSteps, 0, ZSteps));
+      makeHist("XInvisibles", XInvisibles, nInvisibles);
+      makeHist("YInvisibles", YInvisibles, nInvisibles);
+      makeHist("ZInvisibles", ZInvisibles, nInvisibles);
 
-        sprintf(ss, "ProjZOpDet%d", i);
-        TheZProjections.push_back(tfs->make<TH2D>(ss, ss, XSteps, 0,XSteps, YSteps, 0,YSteps));
+      if (fEachSlice) {
+        for(unsigned int i=0; i!=XSteps; ++i)
+          makeHist("projX" + std::to_string(i), TheXCrossSections[i], CrossSectionEntries[0][i]);
+        for(unsigned int i=0; i!=YSteps; ++i)
+          makeHist("projY" + std::to_string(i), TheYCrossSections[i], CrossSectionEntries[1][i]);
+        for(unsigned int i=0; i!=ZSteps; ++i)
+          makeHist("projZ" + std::to_string(i), TheZCrossSections[i], CrossSectionEntries[2][i]);
       }
-    }
-
-
-    mf::LogInfo("PhotonLibraryAnalyzer")<<"Analyzing photon library - running through voxels "<< std::endl;
-
 
-    for(unsigned int i=0; i!=TheVoxelDef.GetNVoxels(); ++i)
-    {
-      if(i%reportnum==0) std::cout<<"Photon library analyzer at voxel " << i<<std::endl;
-
-      auto const Coords = TheVoxelDef.GetVoxelCoords(i);
+      if (fEachDetector) {
 
-      const float* Visibilities = pvs->GetLibraryEntries(i);
-      size_t NOpChannels = pvs->NOpChannels();
+        mf::LogInfo("PhotonLibraryAnalyzer")<<"Making projections for each of " << NOpDet << " photon detectors" << std::endl;
 
-      float TotalVis=0;
-      if (fOpDet < 0) {
-        for(size_t ichan=0; ichan!=NOpChannels; ++ichan)
+        for(int i=0; i<NOpDet; ++i)
         {
-          TotalVis+=Visibilities[ichan];
+          makeHist("ProjXOpDet" + std::to_string(i), detProj.x[i], nSampled);
+          makeHist("ProjYOpDet" + std::to_string(i), detProj.y[i], nSampled);
+          makeHist("ProjZOpDet" + std::to_string(i), detProj.z[i], nSampled);
         }
       }
-      else {
-        TotalVis = Visibilities[fOpDet];
-      }
-
-      VisByN->Fill(NOpChannels);
-
-      if(TotalVis==0)
-      {
-        XInvisibles->Fill(Coords[newX],Coords[newY]);
-        YInvisibles->Fill(Coords[0],Coords[2]);
-        ZInvisibles->Fill(Coords[0],Coords[1]);
-      }
+    }
 
+    if (fWriteArrays) {
+      // one entry per projection, with its content as a flat array
+      // (`content[a * nb + b]` is the bin at coordinates `a` and `b`)
+      TTree* arrays = tfs->make<TTree>("ProjectionArrays", "photon library projections");
+      std::string name;
+      int na = 0, nb = 0;
+      double entries = 0.;
+      std::vector<float> content;
+      arrays->Branch("name", &name);
+      arrays->Branch("na", &na, "na/I");
+      arrays->Branch("nb", &nb, "nb/I");
+      arrays->Branch("entries", &entries, "entries/D");
+      arrays->Branch("content", &content);
+      auto const write = [&](std::string const& projName, VoxelProjection const& proj, double projEntries) {
+        name = projName;
+        na = proj.nA;
+        nb = proj.nB;
+        entries = projEntries;
+        content.assign(proj.content.begin(), proj.content.end());
+        arrays->Fill();
+      };
+
+      write("XProjection", XProjection, nSampled);
+      write("YProjection", YProjection, nSampled);
+      write("ZProjection", ZProjection, nSampled);
+      write("XInvisibles", XInvisibles, nInvisibles);
+      write("YInvisibles", YInvisibles, nInvisibles);
+      write("ZInvisibles", ZInvisibles, nInvisibles);
       if (fEachSlice) {
-        TheXCrossSections.at(Coords.at(0))->Fill(Coords[newX],Coords[newY],TotalVis);
-        TheYCrossSections.at(Coords.at(1))->Fill(Coords[0],Coords[2],TotalVis);
-        TheZCrossSections.at(Coords.at(2))->Fill(Coords[0],Coords[1],TotalVis);
+        for(unsigned int i=0; i!=XSteps; ++i)
+          write("projX" + std::to_string(i), TheXCrossSections[i], CrossSectionEntries[0][i]);
+        for(unsigned int i=0; i!=YSteps; ++i)
+          write("projY" + std::to_string(i), TheYCrossSections[i], CrossSectionEntries[1][i]);
+        for(unsigned int i=0; i!=ZSteps; ++i)
+          write("projZ" + std::to_string(i), TheZCrossSections[i], CrossSectionEntries[2][i]);
       }
-
       if (fEachDetector) {
-        for(size_t ichan=0; ichan!=NOpChannels; ++ichan) {
-          TheXProjections.at(ichan)->Fill(Coords[newX],Coords[newY],Visibilities[ichan]);
-          TheYProjections.at(ichan)->Fill(Coords[0],Coords[2],Visibilities[ichan]);
-          TheZProjections.at(ichan)->Fill(Coords[0],Coords[1],Visibilities[ichan]);
+        for(int i=0; i<NOpDet; ++i)
+        {
+          write("ProjXOpDet" + std::to_string(i), detProj.x[i], nSampled);
+          write("ProjYOpDet" + std::to_string(i), detProj.y[i], nSampled);
+          write("ProjZOpDet" + std::to_string(i), detProj.z[i], nSampled);
         }
       }
-
-      // Always make the summed projections
-      XProjection->Fill(Coords[newX], Coords[newY], TotalVis);
-      YProjection->Fill(Coords[0], Coords[2], TotalVis);
-      ZProjection->Fill(Coords[0], Coords[1], TotalVis);
-
     }
 
     mf::LogInfo("PhotonLibraryAnalyzer")<<"Analyzing photon library - end"<< std::endl;
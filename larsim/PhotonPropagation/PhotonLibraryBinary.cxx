@@ -0,0 +1,387 @@
+/**
+ * @file   larsim/PhotonPropagation/PhotonLibraryBinary.cxx
+ * @brief  Photon library backed by a memory-mapped binary file.
+ * @see    larsim/PhotonPropagation/PhotonLibraryBinary.h
+ */
+
+#include "larsim/PhotonPropagation/PhotonLibraryBinary.h"
+
+#include "cetlib_except/exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// C/C++ standard libraries
+#include <algorithm> // std::min(), std::max()
+#include <cerrno>
+#include <cstring> // std::memcmp(), std::memcpy(), std::strerror()
+#include <fstream>
+#include <vector>
+
+namespace {
+
+  /// Rounds `offset` up to the next multiple of `align`.
+  std::uint64_t
+  alignUp(std::uint64_t offset, std::uint64_t align)
+  {
+    return ((offset + align - 1) / align) * align;
+  }
+
+  /// Writes `n` bytes from `data` into the descriptor `fd`.
+  void
+  writeAll(int fd, void const* data, std::uint64_t n, std::string const& destName)
+  {
+    char const* ptr = static_cast<char const*>(data);
+    while (n > 0) {
+      ssize_t const written = ::write(fd, ptr, n);
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        throw cet::exception("PhotonLibraryBinary")
+          << "Error while writing the photon library into '" << destName
+          << "': " << std::strerror(errno) << "\n";
+      }
+      ptr += written;
+      n -= written;
+    }
+  }
+
+  /// Writes `n` zero bytes into the descriptor `fd`.
+  void
+  writePadding(int fd, std::uint64_t n, std::string const& destName)
+  {
+    static std::vector<char> const zeros(phot::PhotonLibraryBinary::HeaderSize, 0);
+    while (n > 0) {
+      std::uint64_t const chunk = std::min<std::uint64_t>(n, zeros.size());
+      writeAll(fd, zeros.data(), chunk, destName);
+      n -= chunk;
+    }
+  }
+
+} // local namespace
+
+namespace phot {
+
+  static_assert(sizeof(PhotonLibraryBinary::FileHeader_t) <= PhotonLibraryBinary::HeaderSize);
+
+  //------------------------------------------------------------
+  PhotonLibraryBinary::PhotonLibraryBinary(std::string const& fileName)
+  {
+    mf::LogInfo("PhotonLibraryBinary") << "Mapping photon library from binary file: " << fileName;
+
+    int const fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw cet::exception("PhotonLibraryBinary")
+        << "Can't open photon library '" << fileName << "': " << std::strerror(errno) << "\n";
+    }
+    try {
+      mapDescriptor(fd, fileName);
+    }
+    catch (...) {
+      ::close(fd);
+      throw;
+    }
+    ::close(fd); // the mapping keeps its own reference to the file
+  }
+
+  //------------------------------------------------------------
+  PhotonLibraryBinary::PhotonLibraryBinary(int fd, std::string const& sourceName)
+  {
+    mapDescriptor(fd, sourceName);
+  }
+
+  //------------------------------------------------------------
+  void
+  PhotonLibraryBinary::mapDescriptor(int fd, std::string const& fileName)
+  {
+    struct stat fileStat;
+    if (::fstat(fd, &fileStat) != 0) {
+      throw cet::exception("PhotonLibraryBinary")
+        << "Can't stat photon library '" << fileName << "': " << std::strerror(errno) << "\n";
+    }
+    fMapSize = fileStat.st_size;
+    if (fMapSize < HeaderSize) {
+      throw cet::exception("PhotonLibraryBinary")
+        << "Photon library '" << fileName << "' is too short (" << fMapSize << " bytes)\n";
+    }
+
+    void* const addr = ::mmap(nullptr, fMapSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+      throw cet::exception("PhotonLibraryBinary")
+        << "Can't map photon library '" << fileName << "': " << std::strerror(errno) << "\n";
+    }
+    fMapAddress = addr;
+
+    FileHeader_t header;
+    std::memcpy(&header, fMapAddress, sizeof(header));
+
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+      ::munmap(fMapAddress, fMapSize);
+      fMapAddress = nullptr;
+      throw cet::exception("PhotonLibraryBinary")
+        << "File '" << fileName << "' is not a binary photon library.\n";
+    }
+    if (header.version != FormatVersion) {
+      ::munmap(fMapAddress, fMapSize);
+      fMapAddress = nullptr;
+      throw cet::exception("PhotonLibraryBinary")
+        << "Photon library '" << fileName << "' has format version " << header.version
+        << ", only version " << FormatVersion << " is supported.\n";
+    }
+
+    fNVoxels = header.nVoxels;
+    fNOpChannels = header.nOpChannels;
+
+    std::uint64_t const tableSize = LibrarySize() * sizeof(float);
+    for (std::uint64_t offset : header.offsets) {
+      if (offset == 0) continue;
+      if (offset + tableSize > fMapSize) {
+        ::munmap(fMapAddress, fMapSize);
+        fMapAddress = nullptr;
+        throw cet::exception("PhotonLibraryBinary")
+          << "Photon library '" << fileName << "' is truncated: table at offset " << offset
+          << " needs " << tableSize << " bytes, file size is " << fMapSize << ".\n";
+      }
+    }
+
+    fCounts = tableAt(header.offsets[0]);
+    if (header.flags & FlagReflected) fReflCounts = tableAt(header.offsets[1]);
+    if (header.flags & FlagReflectedT0) fReflT0s = tableAt(header.offsets[2]);
+
+    if (header.hasVoxelDef) {
+      fVoxelDef.emplace(header.lower[0],
+                        header.upper[0],
+                        header.steps[0],
+                        header.lower[1],
+                        header.upper[1],
+                        header.steps[1],
+                        header.lower[2],
+                        header.upper[2],
+                        header.steps[2]);
+    }
+
+    // lookups are at random voxels; do not let the kernel read ahead
+    ::madvise(fMapAddress, fMapSize, MADV_RANDOM);
+
+    mf::LogInfo log("PhotonLibraryBinary");
+    log << "Photon lookup table size : " << fNVoxels << " voxels,  " << fNOpChannels
+        << " channels";
+    if (hasVoxelDef())
+      log << "; " << GetVoxelDef();
+    else
+      log << " (no voxel geometry included)";
+  }
+
+  //------------------------------------------------------------
+  PhotonLibraryBinary::~PhotonLibraryBinary()
+  {
+    if (fMapAddress) ::munmap(fMapAddress, fMapSize);
+  }
+
+  //------------------------------------------------------------
+  float
+  PhotonLibraryBinary::GetCount(size_t Voxel, size_t OpChannel) const
+  {
+    return isValid(Voxel, OpChannel) ? fCounts[uncheckedIndex(Voxel, OpChannel)] : 0;
+  }
+
+  //------------------------------------------------------------
+  float
+  PhotonLibraryBinary::GetReflCount(size_t Voxel, size_t OpChannel) const
+  {
+    if (!fReflCounts || !isValid(Voxel, OpChannel)) return 0;
+    return fReflCounts[uncheckedIndex(Voxel, OpChannel)];
+  }
+
+  //------------------------------------------------------------
+  float
+  PhotonLibraryBinary::GetReflT0(size_t Voxel, size_t OpChannel) const
+  {
+    if (!fReflT0s || !isValid(Voxel, OpChannel)) return 0;
+    return fReflT0s[uncheckedIndex(Voxel, OpChannel)];
+  }
+
+  //------------------------------------------------------------
+  float const*
+  PhotonLibraryBinary::GetCounts(size_t Voxel) const
+  {
+    return (Voxel < fNVoxels) ? fCounts + uncheckedIndex(Voxel, 0) : nullptr;
+  }
+
+  //------------------------------------------------------------
+  float const*
+  PhotonLibraryBinary::GetReflCounts(size_t Voxel) const
+  {
+    return (fReflCounts && (Voxel < fNVoxels)) ? fReflCounts + uncheckedIndex(Voxel, 0) : nullptr;
+  }
+
+  //------------------------------------------------------------
+  float const*
+  PhotonLibraryBinary::GetReflT0s(size_t Voxel) const
+  {
+    return (fReflT0s && (Voxel < fNVoxels)) ? fReflT0s + uncheckedIndex(Voxel, 0) : nullptr;
+  }
+
+  //------------------------------------------------------------
+  float const*
+  PhotonLibraryBinary::tableAt(std::uint64_t offset) const
+  {
+    if (offset == 0) return nullptr;
+    return reinterpret_cast<float const*>(static_cast<char const*>(fMapAddress) + offset);
+  }
+
+  //------------------------------------------------------------
+  void
+  PhotonLibraryBinary::WriteLibrary(std::string const& fileName,
+                                    IPhotonLibrary const& library,
+                                    sim::PhotonVoxelDef const* voxelDef /* = nullptr */,
+                                    bool storeReflected /* = false */,
+                                    bool storeReflT0 /* = false */)
+  {
+    int const fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      throw cet::exception("PhotonLibraryBinary")
+        << "Can't open '" << fileName << "' for writing the photon library: "
+        << std::strerror(errno) << "\n";
+    }
+    try {
+      WriteLibrary(fd, fileName, library, voxelDef, storeReflected, storeReflT0);
+    }
+    catch (...) {
+      ::close(fd);
+      throw;
+    }
+    if (::close(fd) != 0) {
+      throw cet::exception("PhotonLibraryBinary")
+        << "Error while closing the photon library '" << fileName << "': " << std::strerror(errno)
+        << "\n";
+    }
+  }
+
+  //------------------------------------------------------------
+  void
+  PhotonLibraryBinary::WriteLibrary(int fd,
+                                    std::string const& destName,
+                                    IPhotonLibrary const& library,
+                                    sim::PhotonVoxelDef const* voxelDef /* = nullptr */,
+                                    bool storeReflected /* = false */,
+                                    bool storeReflT0 /* = false */)
+  {
+    if (storeReflected && !library.hasReflected()) {
+      throw cet::exception("PhotonLibraryBinary")
+        << "WriteLibrary() requested to store reflected light, which the library does not have.\n";
+    }
+    if (storeReflT0 && !library.hasReflectedT0()) {
+      throw cet::exception("PhotonLibraryBinary")
+        << "WriteLibrary() requested to store reflected light timing,"
+           " which the library does not have.\n";
+    }
+
+    std::size_t const nVoxels = library.NVoxels();
+    std::size_t const nChannels = library.NOpChannels();
+    std::uint64_t const tableSize = library.LibrarySize() * sizeof(float);
+
+    FileHeader_t const header =
+      makeHeader(nVoxels, nChannels, voxelDef, storeReflected, storeReflT0);
+
+    mf::LogInfo("PhotonLibraryBinary")
+      << "Writing photon library (" << nVoxels << " voxels, " << nChannels
+      << " channels) to binary file: " << destName;
+
+    // the header is first left blank and written only after all the data:
+    // a reader will not recognise an incomplete library as valid
+    writePadding(fd, HeaderSize, destName);
+
+    // tables are written one voxel at a time, since the libraries do not
+    // necessarily offer contiguous access to all their data
+    auto writeTable = [fd, &destName, nVoxels, nChannels, tableSize](auto getRow) {
+      std::vector<float> const zeros(nChannels, 0.0f);
+      for (std::size_t iVoxel = 0; iVoxel < nVoxels; ++iVoxel) {
+        float const* row = getRow(iVoxel);
+        writeAll(fd, row ? row : zeros.data(), nChannels * sizeof(float), destName);
+      }
+      writePadding(fd, alignUp(tableSize, HeaderSize) - tableSize, destName);
+    };
+
+    writeTable([&library](std::size_t v) { return library.GetCounts(v); });
+    if (storeReflected) writeTable([&library](std::size_t v) { return library.GetReflCounts(v); });
+    if (storeReflT0) writeTable([&library](std::size_t v) { return library.GetReflT0s(v); });
+
+    if (::pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+      throw cet::exception("PhotonLibraryBinary")
+        << "Error while writing the header of the photon library into '" << destName
+        << "': " << std::strerror(errno) << "\n";
+    }
+  }
+
+  //------------------------------------------------------------
+  PhotonLibraryBinary::FileHeader_t
+  PhotonLibraryBinary::makeHeader(std::size_t nVoxels,
+                                  std::size_t nOpChannels,
+                                  sim::PhotonVoxelDef const* voxelDef /* = nullptr */,
+                                  bool storeReflected /* = false */,
+                                  bool storeReflT0 /* = false */)
+  {
+    std::uint64_t const tableSize = std::uint64_t(nVoxels) * nOpChannels * sizeof(float);
+
+    FileHeader_t header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = FormatVersion;
+    header.nVoxels = nVoxels;
+    header.nOpChannels = nOpChannels;
+
+    std::uint64_t offset = HeaderSize;
+    header.offsets[0] = offset;
+    offset = alignUp(offset + tableSize, HeaderSize);
+    if (storeReflected) {
+      header.flags |= FlagReflected;
+      header.offsets[1] = offset;
+      offset = alignUp(offset + tableSize, HeaderSize);
+    }
+    if (storeReflT0) {
+      header.flags |= FlagReflectedT0;
+      header.offsets[2] = offset;
+    }
+
+    if (voxelDef) {
+      header.hasVoxelDef = 1;
+      auto const& steps = voxelDef->GetSteps();
+      geo::Point_t const& lower = voxelDef->GetRegionLowerCorner();
+      geo::Point_t const& upper = voxelDef->GetRegionUpperCorner();
+      for (std::size_t i = 0; i < 3; ++i)
+        header.steps[i] = steps[i];
+      header.lower[0] = lower.X();
+      header.lower[1] = lower.Y();
+      header.lower[2] = lower.Z();
+      header.upper[0] = upper.X();
+      header.upper[1] = upper.Y();
+      header.upper[2] = upper.Z();
+    }
+    return header;
+  }
+
+  //------------------------------------------------------------
+  std::uint64_t
+  PhotonLibraryBinary::fileSize(FileHeader_t const& header)
+  {
+    std::uint64_t const tableSize = header.nVoxels * header.nOpChannels * sizeof(float);
+    std::uint64_t const lastOffset =
+      std::max({header.offsets[0], header.offsets[1], header.offsets[2]});
+    return lastOffset + alignUp(tableSize, HeaderSize);
+  }
+
+  //------------------------------------------------------------
+  bool
+  PhotonLibraryBinary::isBinaryLibraryFile(std::string const& fileName)
+  {
+    std::ifstream in(fileName, std::ios::binary);
+    char magic[sizeof(Magic)];
+    if (!in.read(magic, sizeof(magic))) return false;
+    return std::memcmp(magic, Magic, sizeof(Magic)) == 0;
+  }
+
+} // namespace phot
@@ -0,0 +1,236 @@
+/**
+ * @file   larsim/PhotonPropagation/PhotonLibraryBinary.h
+ * @brief  Photon library backed by a memory-mapped binary file.
+ * @see    larsim/PhotonPropagation/PhotonLibraryBinary.cxx
+ *
+ * The binary format is voxel-major: for each voxel, the visibilities of all
+ * the `NOpChannels()` channels are stored contiguously, exactly as in the
+ * in-memory tables of `phot::PhotonLibrary`. Each table begins on a page
+ * boundary, so that the file can be mapped read-only and `GetCounts()` can
+ * hand out pointers directly into the mapping. All the processes on a node
+ * reading the same file share the same page cache.
+ *
+ * Layout of the file:
+ *  * a header of `PhotonLibraryBinary::HeaderSize` bytes (`FileHeader_t`);
+ *  * the direct visibility table (`NVoxels() x NOpChannels()` `float`);
+ *  * optionally, the reflected visibility table (same size);
+ *  * optionally, the reflected light first arrival time table (same size).
+ *
+ * Timing parametrization functions are not supported by this format.
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_PHOTONLIBRARYBINARY_H
+#define LARSIM_PHOTONPROPAGATION_PHOTONLIBRARYBINARY_H
+
+#include "larsim/PhotonPropagation/IPhotonLibrary.h"
+#include "larsim/Simulation/PhotonVoxels.h"
+
+// C/C++ standard libraries
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace phot {
+
+  /**
+   * @brief Read-only photon library memory-mapped from a binary file.
+   *
+   * The library is created from a file in the binary format described in
+   * `larsim/PhotonPropagation/PhotonLibraryBinary.h`; such a file can be
+   * produced from any other library with `WriteLibrary()`, e.g. from a ROOT
+   * `PhotonLibraryData` tree loaded by `phot::PhotonLibrary`
+   * (see `ConvertPhotonLibraryToBinary` module).
+   *
+   * The file is mapped in memory at construction and unmapped on destruction.
+   * No copy of the data is ever made.
+   */
+  class PhotonLibraryBinary : public IPhotonLibrary {
+  public:
+    /// Size of the file header; data tables start at multiples of this.
+    static constexpr std::size_t HeaderSize = 4096U;
+
+    /// Version of the binary format written by this class.
+    static constexpr std::uint32_t FormatVersion = 1U;
+
+    /// Header of the binary file.
+    struct FileHeader_t {
+      char magic[8];             ///< Identifier of the format (`Magic`).
+      std::uint32_t version;     ///< Version of the format.
+      std::uint32_t flags;       ///< Content flags (`FlagReflected`, ...).
+      std::uint64_t nVoxels;     ///< Number of voxels in each table.
+      std::uint64_t nOpChannels; ///< Number of channels per voxel.
+      std::uint64_t offsets[3];  ///< Offset of each table in bytes (`0` if absent).
+      std::uint32_t hasVoxelDef; ///< Whether the voxel definition is valid.
+      std::int32_t steps[3];     ///< Voxel definition: divisions on x, y and z.
+      double lower[3];           ///< Voxel definition: lower corner [cm]
+      double upper[3];           ///< Voxel definition: upper corner [cm]
+    }; // FileHeader_t
+
+    /// Identifier at the beginning of each binary library file.
+    static constexpr char Magic[8] = {'L', 'A', 'R', 'P', 'L', 'I', 'B', '\0'};
+
+    /// Flag: the file includes the reflected visibility table.
+    static constexpr std::uint32_t FlagReflected = 0x1;
+    /// Flag: the file includes the reflected light arrival time table.
+    static constexpr std::uint32_t FlagReflectedT0 = 0x2;
+
+    /// Maps the library from the specified binary file.
+    PhotonLibraryBinary(std::string const& fileName);
+
+    /// Maps the library from an open descriptor (e.g. shared memory object).
+    /// The descriptor is not closed. `sourceName` is used only for messages.
+    PhotonLibraryBinary(int fd, std::string const& sourceName);
+
+    virtual ~PhotonLibraryBinary();
+
+    PhotonLibraryBinary(PhotonLibraryBinary const&) = delete;
+    PhotonLibraryBinary& operator=(PhotonLibraryBinary const&) = delete;
+
+    virtual float GetCount(size_t Voxel, size_t OpChannel) const override;
+    virtual float GetReflCount(size_t Voxel, size_t OpChannel) const override;
+    virtual float GetReflT0(size_t Voxel, size_t OpChannel) const override;
+
+    /// Returns a pointer into the mapped file with `NOpChannels()` values.
+    virtual float const* GetCounts(size_t Voxel) const override;
+    virtual float const* GetReflCounts(size_t Voxel) const override;
+    virtual float const* GetReflT0s(size_t Voxel) const override;
+
+    virtual bool
+    hasReflected() const override
+    {
+      return fReflCounts != nullptr;
+    }
+
+    virtual bool
+    hasReflectedT0() const override
+    {
+      return fReflT0s != nullptr;
+    }
+
+    virtual int
+    NOpChannels() const override
+    {
+      return fNOpChannels;
+    }
+    virtual int
+    NVoxels() const override
+    {
+      return fNVoxels;
+    }
+
+    /// Returns the size of the mapped file (pages are loaded on demand) [bytes].
+    virtual size_t
+    MemoryFootprint() const override
+    {
+      return fMapSize;
+    }
+
+    /// Returns whether voxel metadata is available.
+    bool
+    hasVoxelDef() const
+    {
+      return fVoxelDef.has_value();
+    }
+
+    /// Returns the voxel metadata stored in the file (undefined if none).
+    sim::PhotonVoxelDef const&
+    GetVoxelDef() const
+    {
+      return *fVoxelDef;
+    }
+
+    /**
+     * @brief Writes the content of a library into a binary file.
+     * @param fileName path of the file to be (over)written
+     * @param library the library to be written
+     * @param voxelDef voxel metadata to be stored (none if `nullptr`)
+     * @param storeReflected whether to write reflected visibilities
+     * @param storeReflT0 whether to write reflected light arrival times
+     * @throw cet::exception (category: `"PhotonLibraryBinary"`) on error
+     */
+    static void WriteLibrary(std::string const& fileName,
+                             IPhotonLibrary const& library,
+                             sim::PhotonVoxelDef const* voxelDef = nullptr,
+                             bool storeReflected = false,
+                             bool storeReflT0 = false);
+
+    /**
+     * @brief Writes the content of a library into an open descriptor.
+     * @param fd descriptor to write into, positioned at its beginning
+     * @param destName name of the destination, used only for messages
+     * @see `WriteLibrary(std::string const&, IPhotonLibrary const&, sim::PhotonVoxelDef const*, bool, bool)`
+     *
+     * The header is written last, so that a reader never mistakes a partially
+     * written library for a complete one.
+     */
+    static void WriteLibrary(int fd,
+                             std::string const& destName,
+                             IPhotonLibrary const& library,
+                             sim::PhotonVoxelDef const* voxelDef = nullptr,
+                             bool storeReflected = false,
+                             bool storeReflT0 = false);
+
+    /// Returns whether the specified file starts with the binary format magic.
+    static bool isBinaryLibraryFile(std::string const& fileName);
+
+    /**
+     * @brief Returns the header of a library file with the specified content.
+     * @param nVoxels number of voxels in the library
+     * @param nOpChannels number of channels per voxel
+     * @param voxelDef voxel metadata to be stored (none if `nullptr`)
+     * @param storeReflected whether the file has the reflected visibilities
+     * @param storeReflT0 whether the file has the reflected light arrival times
+     *
+     * The header includes the offsets of all the tables. It can be used to
+     * write a library file without going through an `IPhotonLibrary`, e.g. by
+     * filling its tables directly in a writable mapping of the file.
+     */
+    static FileHeader_t makeHeader(std::size_t nVoxels,
+                                   std::size_t nOpChannels,
+                                   sim::PhotonVoxelDef const* voxelDef = nullptr,
+                                   bool storeReflected = false,
+                                   bool storeReflT0 = false);
+
+    /// Returns the size in bytes of the file described by `header`.
+    static std::uint64_t fileSize(FileHeader_t const& header);
+
+  private:
+    void* fMapAddress = nullptr; ///< Start of the mapped memory.
+    std::size_t fMapSize = 0U;   ///< Size of the mapped memory.
+
+    float const* fCounts = nullptr;     ///< Direct visibility table.
+    float const* fReflCounts = nullptr; ///< Reflected visibility table.
+    float const* fReflT0s = nullptr;    ///< Reflected arrival time table.
+
+    std::size_t fNOpChannels = 0U;
+    std::size_t fNVoxels = 0U;
+
+    /// Voxel definition loaded from library metadata.
+    std::optional<sim::PhotonVoxelDef> fVoxelDef;
+
+    /// Maps the content of `fd` and sets up the tables from its header.
+    void mapDescriptor(int fd, std::string const& fileName);
+
+    /// Returns the start of the table at `offset` bytes from the file start.
+    float const* tableAt(std::uint64_t offset) const;
+
+    /// Returns the index of visibility of specified voxel and cell
+    size_t
+    uncheckedIndex(size_t Voxel, size_t OpChannel) const
+    {
+      return Voxel * fNOpChannels + OpChannel;
+    }
+
+    /// Returns whether the voxel and channel are in range.
+    bool
+    isValid(size_t Voxel, size_t OpChannel) const
+    {
+      return (Voxel < fNVoxels) && (OpChannel < fNOpChannels);
+    }
+
+  }; // class PhotonLibraryBinary
+
+} // namespace phot
+
+#endif // LARSIM_PHOTONPROPAGATION_PHOTONLIBRARYBINARY_H
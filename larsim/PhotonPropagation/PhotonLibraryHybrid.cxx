@@ -10,6 +10,9 @@
 #include "TTree.h"
 #include "TVectorD.h"
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 
 namespace
@@ -27,6 +30,63 @@ namespace phot
   PhotonLibraryHybrid::PhotonLibraryHybrid(const std::string& fname,
                                            const sim::PhotonVoxelDef& voxdef)
     : fVoxDef(voxdef)
+  {
+    if(isBinaryFile(fname)) LoadBinary(fname);
+    else LoadROOT(fname);
+
+    !fRecords.empty() || fatal("No opdet_*/ directories in "+fname);
+
+    art::ServiceHandle<geo::Geometry const> geom;
+    geom->NOpDets() == fRecords.size() || fatal("Number of opdets mismatch");
+
+    fRecords.shrink_to_fit(); // save memory
+
+    BuildIndex();
+  }
+
+  //--------------------------------------------------------------------
+  void PhotonLibraryHybrid::BuildIndex()
+  {
+    art::ServiceHandle<geo::Geometry const> geom;
+
+    const size_t nOpDets = fRecords.size();
+    fNorm.resize(nOpDets);
+    fDecay.resize(nOpDets);
+    fCenterX.resize(nOpDets);
+    fCenterY.resize(nOpDets);
+    fCenterZ.resize(nOpDets);
+    for(size_t od = 0; od < nOpDets; ++od){
+      fNorm[od] = fRecords[od].fit.norm;
+      fDecay[od] = fRecords[od].fit.decay;
+      const auto center = geom->OpDetGeoFromOpDet(od).GetCenter();
+      fCenterX[od] = center.X();
+      fCenterY[od] = center.Y();
+      fCenterZ[od] = center.Z();
+    }
+
+    // transpose the per-op. det. exception lists into per-voxel ones;
+    // filling op. det. by op. det. keeps each voxel row sorted by op. det.
+    fExcOffsets.assign(NVoxels() + 1, 0);
+    for(const OpDetRecord& rec: fRecords)
+      for(const Exception& e: rec.exceptions) ++fExcOffsets[e.vox + 1];
+    for(size_t v = 0; v < size_t(NVoxels()); ++v) fExcOffsets[v + 1] += fExcOffsets[v];
+
+    fExcOpDets.resize(fExcOffsets.back());
+    fExcVis.resize(fExcOffsets.back());
+    std::vector<size_t> next(fExcOffsets.begin(), fExcOffsets.end() - 1);
+    for(size_t od = 0; od < nOpDets; ++od){
+      for(const Exception& e: fRecords[od].exceptions){
+        const size_t i = next[e.vox]++;
+        fExcOpDets[i] = od;
+        fExcVis[i] = e.vis;
+      }
+      // the index holds them now
+      std::vector<Exception>().swap(fRecords[od].exceptions);
+    }
+  }
+
+  //--------------------------------------------------------------------
+  void PhotonLibraryHybrid::LoadROOT(const std::string& fname)
   {
     TFile f(fname.c_str());
     !f.IsZombie() || fatal("Could not open PhotonLibrary "+fname);
@@ -62,13 +122,102 @@ namespace phot
 
       fRecords.push_back(rec);
     } // end for opdetIdx
+  }
 
-    !fRecords.empty() || fatal("No opdet_*/ directories in "+fname);
+  //--------------------------------------------------------------------
+  void PhotonLibraryHybrid::LoadBinary(const std::string& fname)
+  {
+    // the whole file is read at once, then split into the records
+    std::ifstream in(fname, std::ios::binary | std::ios::ate);
+    in || fatal("Could not open PhotonLibrary "+fname);
+    std::vector<char> buffer(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(buffer.data(), buffer.size()) || fatal("Could not read PhotonLibrary "+fname);
 
-    art::ServiceHandle<geo::Geometry const> geom;
-    geom->NOpDets() == fRecords.size() || fatal("Number of opdets mismatch");
+    BinaryHeader_t header;
+    buffer.size() >= sizeof(header) || fatal("Truncated binary PhotonLibrary "+fname);
+    std::memcpy(&header, buffer.data(), sizeof(header));
+    header.version == FormatVersion || fatal("Unsupported format version in "+fname);
+    header.nVoxels == size_t(NVoxels()) || fatal("Number of voxels mismatch in "+fname);
 
-    fRecords.shrink_to_fit(); // save memory
+    const size_t nOpDets = header.nOpDets;
+    const size_t size = sizeof(header) + nOpDets * (2*sizeof(float) + sizeof(std::uint64_t))
+      + header.nExceptions * sizeof(BinaryException_t);
+    buffer.size() == size || fatal("Wrong size of binary PhotonLibrary "+fname);
+
+    const char* ptr = buffer.data() + sizeof(header);
+    std::vector<float> fits(2*nOpDets);
+    std::memcpy(fits.data(), ptr, fits.size()*sizeof(float));
+    ptr += fits.size()*sizeof(float);
+    std::vector<std::uint64_t> nExceptions(nOpDets);
+    std::memcpy(nExceptions.data(), ptr, nExceptions.size()*sizeof(std::uint64_t));
+    ptr += nExceptions.size()*sizeof(std::uint64_t);
+
+    size_t nLeft = header.nExceptions;
+    fRecords.resize(nOpDets);
+    for(size_t opdetIdx = 0; opdetIdx < nOpDets; ++opdetIdx){
+      OpDetRecord& rec = fRecords[opdetIdx];
+      rec.fit = FitFunc(fits[2*opdetIdx], fits[2*opdetIdx+1]);
+
+      nExceptions[opdetIdx] <= nLeft || fatal("Inconsistent exception counts in "+fname);
+      nLeft -= nExceptions[opdetIdx];
+      rec.exceptions.reserve(nExceptions[opdetIdx]);
+      for(size_t i = 0; i < nExceptions[opdetIdx]; ++i){
+        BinaryException_t e;
+        std::memcpy(&e, ptr, sizeof(e));
+        ptr += sizeof(e);
+        e.vox < header.nVoxels || fatal("Voxel out of range");
+        rec.exceptions.emplace_back(e.vox, e.vis);
+      }
+      // the writer sorts them, but we don't trust the file
+      std::is_sorted(rec.exceptions.begin(), rec.exceptions.end())
+        || fatal("Unsorted exceptions in "+fname);
+    } // end for opdetIdx
+  }
+
+  //--------------------------------------------------------------------
+  void PhotonLibraryHybrid::WriteBinary(const std::string& fname,
+                                        size_t nVoxels,
+                                        const std::vector<OpDetRecord>& records)
+  {
+    BinaryHeader_t header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = FormatVersion;
+    header.nOpDets = records.size();
+    header.nVoxels = nVoxels;
+
+    std::vector<float> fits;
+    std::vector<std::uint64_t> nExceptions;
+    std::vector<BinaryException_t> exceptions;
+    for(const OpDetRecord& rec: records){
+      fits.push_back(rec.fit.norm);
+      fits.push_back(rec.fit.decay);
+      nExceptions.push_back(rec.exceptions.size());
+      std::vector<Exception> sorted(rec.exceptions);
+      std::sort(sorted.begin(), sorted.end());
+      for(const Exception& e: sorted) exceptions.push_back({std::uint32_t(e.vox), e.vis});
+    }
+    header.nExceptions = exceptions.size();
+
+    std::ofstream out(fname, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(fits.data()), fits.size()*sizeof(float));
+    out.write(reinterpret_cast<const char*>(nExceptions.data()),
+              nExceptions.size()*sizeof(std::uint64_t));
+    out.write(reinterpret_cast<const char*>(exceptions.data()),
+              exceptions.size()*sizeof(BinaryException_t));
+    out.close();
+    out || fatal("Error while writing PhotonLibrary "+fname);
+  }
+
+  //--------------------------------------------------------------------
+  bool PhotonLibraryHybrid::isBinaryFile(const std::string& fname)
+  {
+    std::ifstream in(fname, std::ios::binary);
+    char magic[sizeof(Magic)];
+    if(!in.read(magic, sizeof(magic))) return false;
+    return std::memcmp(magic, Magic, sizeof(Magic)) == 0;
   }
 
   //--------------------------------------------------------------------
@@ -82,16 +231,61 @@ namespace phot
     return fVoxDef.GetNVoxels();
   }
 
+  //--------------------------------------------------------------------
+  size_t PhotonLibraryHybrid::MemoryFootprint() const
+  {
+    size_t size = fRecords.size() * sizeof(OpDetRecord);
+    for(const OpDetRecord& rec: fRecords)
+      size += rec.exceptions.size() * sizeof(Exception);
+    size += (fNorm.size() + fDecay.size() + fExcVis.size()) * sizeof(float);
+    size += (fCenterX.size() + fCenterY.size() + fCenterZ.size()) * sizeof(double);
+    size += fExcOffsets.size() * sizeof(size_t);
+    size += fExcOpDets.size() * sizeof(std::uint32_t);
+    return size;
+  }
+
   //--------------------------------------------------------------------
   const float* PhotonLibraryHybrid::GetCounts(size_t vox) const
   {
-    // The concept of GetCounts() conflicts fairly badly with how this library
-    // works. This is probably the best we can do.
+    int(vox) < NVoxels() || fatal("GetCounts(): Voxel out of range");
 
-    static float* counts = 0;
-    if(!counts) counts = new float[NOpChannels()];
-    for(int od = 0; od < NOpChannels(); ++od) counts[od] = GetCount(vox, od);
-    return counts;
+    static thread_local std::vector<float> counts;
+    counts.resize(fNorm.size());
+    FillCounts(vox, counts.data());
+    return counts.data();
+  }
+
+  //--------------------------------------------------------------------
+  bool PhotonLibraryHybrid::CopyCounts(size_t vox, float* dest) const
+  {
+    int(vox) < NVoxels() || fatal("CopyCounts(): Voxel out of range");
+
+    FillCounts(vox, dest);
+    return true;
+  }
+
+  //--------------------------------------------------------------------
+  void PhotonLibraryHybrid::FillCounts(size_t vox, float* counts) const
+  {
+    const auto voxvec = fVoxDef.GetPhotonVoxel(vox).GetCenter();
+    const double x = voxvec.X(), y = voxvec.Y(), z = voxvec.Z();
+
+    // evaluate the fit for all the op. det.s (a branchless loop the compiler
+    // can vectorise), then overwrite the exceptions of this voxel
+    const size_t nOpDets = fNorm.size();
+    const float* norm = fNorm.data();
+    const float* decay = fDecay.data();
+    const double* cx = fCenterX.data();
+    const double* cy = fCenterY.data();
+    const double* cz = fCenterZ.data();
+    for(size_t od = 0; od < nOpDets; ++od){
+      const double dx = x - cx[od], dy = y - cy[od], dz = z - cz[od];
+      const double dist = std::sqrt(dx*dx + dy*dy + dz*dz);
+      counts[od] = std::exp(norm[od] + decay[od]*dist)/(dist*dist);
+    }
+
+    for(size_t i = fExcOffsets[vox]; i < fExcOffsets[vox+1]; ++i)
+      counts[fExcOpDets[i]] = fExcVis[i];
   }
 
   //--------------------------------------------------------------------
@@ -100,22 +294,19 @@ namespace phot
     int(vox) < NVoxels() || fatal("GetCount(): Voxel out of range");
     int(opchan) < NOpChannels() || fatal("GetCount(): OpChan out of range");
 
-    const OpDetRecord& rec = fRecords[opchan];
-
-    auto it2 = std::lower_bound(rec.exceptions.begin(),
-                                rec.exceptions.end(),
-                                vox);
-    if(it2->vox == vox) return it2->vis;
+    const auto begin = fExcOpDets.begin() + fExcOffsets[vox];
+    const auto end = fExcOpDets.begin() + fExcOffsets[vox+1];
+    const auto it = std::lower_bound(begin, end, opchan);
+    if(it != end && *it == opchan) return fExcVis[it - fExcOpDets.begin()];
 
     // Otherwise, we use the interpolation, which requires a distance
 
-    static art::ServiceHandle<geo::Geometry const> geom;
-    const geo::OpDetGeo& opdet = geom->OpDetGeoFromOpDet(opchan);
-
     const auto voxvec = fVoxDef.GetPhotonVoxel(vox).GetCenter();
+    const double dx = voxvec.X() - fCenterX[opchan];
+    const double dy = voxvec.Y() - fCenterY[opchan];
+    const double dz = voxvec.Z() - fCenterZ[opchan];
+    const double dist = std::sqrt(dx*dx + dy*dy + dz*dz);
 
-    const double dist = opdet.DistanceToPoint(voxvec);
-
-    return rec.fit.Eval(dist);
+    return fRecords[opchan].fit.Eval(dist);
   }
 }
@@ -7,6 +7,7 @@
 #include "larsim/PhotonPropagation/IPhotonLibrary.h"
 
 #include <cmath>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -14,19 +15,60 @@ namespace sim{class PhotonVoxelDef;}
 
 namespace phot
 {
-  /// TODO doc
+  /**
+   * Library storing, for each op. det., a fit of the visibility as function of
+   * the distance, and the visibility of the voxels badly described by it
+   * ("exceptions"). It is created by `CreateHybridLibrary` module, as a ROOT
+   * file with a `opdet_N` directory per op. det., or as a binary file
+   * (`WriteBinary()`), which is loaded with a single read.
+   *
+   * Layout of the binary file (all the op. det. in order):
+   *  * a header (`BinaryHeader_t`);
+   *  * the fit normalisation and decay of each op. det. (`2 x nOpDets` `float`);
+   *  * the number of exceptions of each op. det. (`nOpDets` `std::uint64_t`);
+   *  * all the exceptions, sorted by voxel within each op. det.
+   *    (`nExceptions` `BinaryException_t`).
+   */
   class PhotonLibraryHybrid: public IPhotonLibrary
   {
   public:
+    /// Identifier at the beginning of each binary hybrid library file.
+    static constexpr char Magic[8] = {'L', 'A', 'R', 'P', 'L', 'H', 'Y', '\0'};
+
+    /// Version of the binary format written by this class.
+    static constexpr std::uint32_t FormatVersion = 1U;
+
+    /// Header of the binary file.
+    struct BinaryHeader_t
+    {
+      char magic[8];             ///< Identifier of the format (`Magic`).
+      std::uint32_t version;     ///< Version of the format.
+      std::uint32_t reserved;    ///< Unused (padding).
+      std::uint64_t nOpDets;     ///< Number of op. det. records.
+      std::uint64_t nVoxels;     ///< Number of voxels of the library.
+      std::uint64_t nExceptions; ///< Total number of exceptions.
+    };
+
+    /// An exception in the binary file.
+    struct BinaryException_t
+    {
+      std::uint32_t vox;
+      float vis;
+    };
+
     PhotonLibraryHybrid(const std::string& fname,
                         const sim::PhotonVoxelDef& voxdef);
     virtual ~PhotonLibraryHybrid();
 
     virtual float GetCount(size_t Voxel, size_t OpChannel) const override;
 
-    // This one is unimplemented
+    /// Returns the visibilities of all the op. det.s from `Voxel`.
+    /// The row is held in a buffer of the calling thread, reused by its next call.
     virtual const float* GetCounts(size_t Voxel) const override;
 
+    /// Writes the visibilities of all the op. det.s from `Voxel` into `dest`.
+    virtual bool CopyCounts(size_t Voxel, float* dest) const override;
+
     /// Don't implement reflected light
     virtual bool hasReflected() const override {return false;}
     virtual const float* GetReflCounts(size_t Voxel) const override {return 0;}
@@ -40,8 +82,7 @@ namespace phot
     virtual int NOpChannels() const override {return fRecords.size();}
     virtual int NVoxels() const override;
 
-  protected:
-    const sim::PhotonVoxelDef& fVoxDef;
+    virtual size_t MemoryFootprint() const override;
 
     struct FitFunc
     {
@@ -71,7 +112,47 @@ namespace phot
       std::vector<Exception> exceptions;
     };
 
+    /// Writes the records of all the op. det.s into a binary file.
+    /// Aborts on error, like the rest of this class.
+    static void WriteBinary(const std::string& fname,
+                            size_t nVoxels,
+                            const std::vector<OpDetRecord>& records);
+
+    /// Returns whether the specified file starts with the binary format magic.
+    static bool isBinaryFile(const std::string& fname);
+
+  protected:
+    const sim::PhotonVoxelDef& fVoxDef;
+
     std::vector<OpDetRecord> fRecords;
+
+    /// @{
+    /// @name Lookup tables (filled at construction from `fRecords`)
+
+    /// Fit parameters of each op. det.
+    std::vector<float> fNorm, fDecay;
+
+    /// Coordinates of the center of each op. det. [cm]
+    std::vector<double> fCenterX, fCenterY, fCenterZ;
+
+    /// Exceptions of voxel `v` are `fExcOpDets` (sorted) and `fExcVis` entries
+    /// from `fExcOffsets[v]` to `fExcOffsets[v+1]`.
+    std::vector<size_t> fExcOffsets;
+    std::vector<std::uint32_t> fExcOpDets;
+    std::vector<float> fExcVis;
+    /// @}
+
+    /// Evaluates the visibilities of all the op. det.s from `vox` into `counts`.
+    void FillCounts(size_t vox, float* counts) const;
+
+    /// Fills the lookup tables; drops the exceptions from `fRecords`.
+    void BuildIndex();
+
+    /// Reads the records from a ROOT file.
+    void LoadROOT(const std::string& fname);
+
+    /// Reads the records from a binary file.
+    void LoadBinary(const std::string& fname);
   };
 } // namespace
 
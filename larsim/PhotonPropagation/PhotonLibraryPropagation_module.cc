@@ -20,12 +20,20 @@
 #include "lardataobj/Simulation/SimPhotons.h"
 #include "larevt/SpaceChargeServices/SpaceChargeService.h"
 #include "larsim/IonizationScintillation/ISCalcSeparate.h"
+#include "larsim/PhotonPropagation/FastOpticalEngine.h"
 #include "larsim/PhotonPropagation/PhotonVisibilityService.h"
 #include "larsim/Simulation/LArG4Parameters.h"
+#include "larsim/Simulation/ProductFootprint.h"
+#include "larsim/Utils/TraceZones.h"
 #include "nurandom/RandomUtils/NuRandomService.h"
 
 #include <cmath>
+#include <cstddef>
+#include <functional>
 #include <memory>
+#include <tuple> // std::tie()
+#include <unordered_map>
+#include <utility>
 
 using namespace std;
 
@@ -101,9 +109,11 @@ namespace phot {
  * Keep in mind that at this stage the LArG4 main module is not capable of running the full optical simulation,
  * because the necessary code has not yet been written.
  *
- * In the future when the PhotonLibrary has the propagation time included,
- * it could be possible to enhance `sim::SimPhotons` and `sim::SimPhotonsLite` to contain the propagation time.
- * At this point the time recorded for the photon is the creation time of the photon.
+ * By default, the time recorded for the photon is the creation time of the photon.
+ * With `IncludePropagationTime`, the propagation time to the optical channel is added,
+ * sampled from the propagation time histograms of the library (`PhotonVisibilityService`
+ * must be configured with `ParametrisedTimePropagation` and `TimingHistogramBins`);
+ * channels without a histogram get no propagation time.
  *
  * The steps this module takes are:
  *   - to take `sim::SimEnergyDeposits` produced by larg4Main,
@@ -139,19 +149,90 @@ namespace phot {
  * Since the amount of `sim::SimPhotons` produced even at low energies and in small geometries quickly exceeds the memory capacity of the job,
  * right now it is actually impossible to produce `sim::SimPhotons` for any realistic geometry.
  * A possible way around the problem is to implement a scaling of the produced `sim::SimPhotons`, to only produce a fraction of them.
+ *
+ * With `BatchByVoxel` enabled, the energy deposits of the event are first grouped
+ * by library voxel and by time bin (`BatchTimeBinWidth` [ns] wide):
+ * the fast and slow photon yields of the deposits of each group are summed, and a single
+ * Poisson number of photons is thrown for each group and for each channel with nonzero
+ * visibility in the voxel, instead of one for each deposit.
+ * Since the sum of Poisson variables is Poisson distributed, the number of photons is
+ * statistically the same; the approximations are that all the photons of a group start
+ * at the average time of its deposits, weighted by their photons (off by less than the
+ * bin width), and that the visibilities (and the position of `sim::OnePhoton`) are the
+ * ones of the first deposit of the group (different only if the visibility service
+ * interpolates within the voxels). The random sequence differs from the one of the
+ * default mode, which visits the deposits one by one.
+ *
+ * The photons of each deposit (or group) are stored by `phot::FastOpticalEngine`,
+ * the output stage shared with `PDFastSimPAR` and `PDFastSimPVS`.
  */
-  class PhotonLibraryPropagation : public art::EDProducer {
+  class PhotonLibraryPropagation : public art::EDProducer, private FastOpticalModel {
   private:
     double fRiseTimeFast;
     double fRiseTimeSlow;
     bool fDoSlowComponent;
+    bool fUseLitePhotons;
     vector<art::InputTag> fEDepTags;
     larg4::ISCalcSeparate fISAlg;
     CLHEP::HepRandomEngine& fPhotonEngine;
     CLHEP::HepRandomEngine& fScintTimeEngine;
+    bool fBatchByVoxel;
+    double fBatchTimeBinWidth;
+    bool fStoreProductFootprints; ///< Whether to put the product sizes into the event.
+    bool fIncludePropagationTime; ///< Whether to add the propagation time to the photons.
+    FastOpticalEngine fEngine; ///< Event loop and output.
+
+    /// Energy deposits of one voxel and time bin, processed together.
+    struct DepositGroup {
+      geo::Point_t midPoint; ///< Position of the first deposit, for the visibilities.
+      geo::Point_t end;      ///< End of the first deposit, for `sim::OnePhoton`.
+      double nphotFast = 0.;
+      double nphotSlow = 0.;
+      double firstT0 = 0.;
+      double weightedT0 = 0.; ///< Sum of the start times weighted by their photons.
+    };
+
+    struct GroupKeyHash {
+      std::size_t
+      operator()(std::pair<int, long long> const& key) const
+      {
+        return std::hash<long long>{}(key.second) * 31U + std::hash<int>{}(key.first);
+      }
+    };
+
+    std::vector<DepositGroup> fGroups; ///< Groups of the event, in order of first deposit.
+    std::unordered_map<std::pair<int, long long>, std::size_t, GroupKeyHash> fGroupIndex;
+
+    // the sources of the event: the deposits, or their groups with `BatchByVoxel`
+    std::vector<sim::SimEnergyDeposit const*> fEDeps; ///< Deposits of all the modules.
+    detinfo::DetectorPropertiesData const* fDetProp = nullptr;
+    detinfo::LArProperties const* fLArProp = nullptr;
 
     void produce(art::Event&) override;
 
+    /// Returns the configuration of the engine.
+    FastOpticalEngine::Config_t engineConfig() const;
+
+    // FastOpticalModel interface
+    double sourceStartTime(std::size_t iSource) const override;
+    void simulateSource(std::size_t iSource,
+                        FastOpticalRandom& rng,
+                        FastOpticalPhotons& photons) override;
+
+    /// Returns the fast and slow photons of a deposit.
+    std::pair<double, double> scintPhotons(sim::SimEnergyDeposit const& edep);
+
+    /// Propagates the photons of a deposit (or group) to `channel`.
+    void emitPhotons(unsigned int channel,
+                     double visibleFraction,
+                     double nphot_fast,
+                     double nphot_slow,
+                     double t0,
+                     PropagationTimeHistogram const& propTime,
+                     CLHEP::RandPoissonQ& randpoisphot,
+                     CLHEP::RandFlat& randflatscinttime,
+                     FastOpticalPhotons& photons) const;
+
   public:
     explicit PhotonLibraryPropagation(fhicl::ParameterSet const&);
     PhotonLibraryPropagation(PhotonLibraryPropagation const&) = delete;
@@ -165,134 +246,240 @@ namespace phot {
     , fRiseTimeFast{p.get<double>("RiseTimeFast", 0.0)}
     , fRiseTimeSlow{p.get<double>("RiseTimeSlow", 0.0)}
     , fDoSlowComponent{p.get<bool>("DoSlowComponent")}
+    , fUseLitePhotons{art::ServiceHandle<sim::LArG4Parameters const> {}->UseLitePhotons()}
     , fEDepTags{p.get<vector<art::InputTag>>("EDepModuleLabels")}
     , fPhotonEngine(art::ServiceHandle<rndm::NuRandomService> {}
                       ->createEngine(*this, "HepJamesRandom", "photon", p, "SeedPhoton"))
     , fScintTimeEngine(art::ServiceHandle<rndm::NuRandomService>()
                          ->createEngine(*this, "HepJamesRandom", "scinttime", p, "SeedScintTime"))
+    , fBatchByVoxel{p.get<bool>("BatchByVoxel", false)}
+    , fBatchTimeBinWidth{p.get<double>("BatchTimeBinWidth", 1.0)}
+    , fStoreProductFootprints{p.get<bool>("StoreProductFootprints", false)}
+    , fIncludePropagationTime{p.get<bool>("IncludePropagationTime", false)}
+    , fEngine{engineConfig()}
   {
-    if (art::ServiceHandle<sim::LArG4Parameters const> {}->UseLitePhotons()) {
+    if (fBatchByVoxel && !(fBatchTimeBinWidth > 0.0)) {
+      throw cet::exception("PhotonLibraryPropagation")
+        << "BatchTimeBinWidth must be positive (it is " << fBatchTimeBinWidth << " ns).\n";
+    }
+    if (fIncludePropagationTime &&
+        !art::ServiceHandle<PhotonVisibilityService const> {}->UseTimingHistograms()) {
+      throw cet::exception("PhotonLibraryPropagation")
+        << "IncludePropagationTime requires PhotonVisibilityService to provide propagation"
+           " time histograms (ParametrisedTimePropagation and TimingHistogramBins).\n";
+    }
+    if (fUseLitePhotons) {
       produces<vector<sim::SimPhotonsLite>>();
     }
     else {
       produces<vector<sim::SimPhotons>>();
     }
+    if (fStoreProductFootprints) produces<vector<sim::ProductFootprint>>();
+  }
+
+  FastOpticalEngine::Config_t
+  PhotonLibraryPropagation::engineConfig() const
+  {
+    FastOpticalEngine::Config_t config;
+    config.nOpChannels = art::ServiceHandle<PhotonVisibilityService const> {}->NOpChannels();
+    config.useLitePhotons = art::ServiceHandle<sim::LArG4Parameters const> {}->UseLitePhotons();
+    config.makeBTRs = false;
+    config.directPhotonEnergy = 9.7e-6;
+    config.storeProductFootprints = fStoreProductFootprints;
+    return config;
   }
 
   void
   PhotonLibraryPropagation::produce(art::Event& e)
   {
+    LARSIM_TRACE_ZONE("PhotonLibraryPropagation::produce");
     art::ServiceHandle<PhotonVisibilityService const> pvs;
-    art::ServiceHandle<sim::LArG4Parameters const> lgp;
-    auto const* larp = lar::providerFrom<detinfo::LArPropertiesService>();
     auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(e);
-    CLHEP::RandPoissonQ randpoisphot{fPhotonEngine};
-    CLHEP::RandFlat randflatscinttime{fScintTimeEngine};
-    auto const nOpChannels = pvs->NOpChannels();
-    unique_ptr<vector<sim::SimPhotons>> photCol{new vector<sim::SimPhotons>{}};
-    auto& photonCollection{*photCol};
-    photonCollection.resize(nOpChannels);
-    unique_ptr<vector<sim::SimPhotonsLite>> photLiteCol{new vector<sim::SimPhotonsLite>{}};
-    auto& photonLiteCollection{*photLiteCol};
-    photonLiteCollection.resize(nOpChannels);
-    for (unsigned int i = 0; i < nOpChannels; ++i) {
-      photonLiteCollection[i].OpChannel = i;
-      photonCollection[i].SetChannel(i);
-    }
-    vector<vector<sim::SimEnergyDeposit> const*> edep_vecs;
+    fDetProp = &detProp;
+    fLArProp = lar::providerFrom<detinfo::LArPropertiesService>();
+
+    fEDeps.clear();
     for (auto label : fEDepTags) {
       auto const& edep_handle = e.getValidHandle<vector<sim::SimEnergyDeposit>>(label);
-      edep_vecs.push_back(edep_handle);
+      for (auto const& edep : *edep_handle) //loop over energy deposits: one per step
+        fEDeps.push_back(&edep);
     }
-    for (auto const& edeps : edep_vecs) { //loop over modules
-      for (auto const& edep : *edeps) {   //loop over energy deposits: one per step
-        //int count_onePhot =0; // unused
-        auto const& p = edep.MidPoint();
-        auto const& Visibilities = pvs->GetAllVisibilities(p);
-        if (!Visibilities) {
-          throw cet::exception("PhotonLibraryPropagation")
-            << "There is no entry in the PhotonLibrary for this position in space. "
-               "Position: "
-            << edep.MidPoint();
-        }
-        auto const isCalcData = fISAlg.CalcIonAndScint(detProp, edep);
-        //total amount of scintillation photons
-        double nphot = static_cast<int>(isCalcData.numPhotons);
-        //amount of scintillated photons created via the fast scintillation process
-        double nphot_fast = static_cast<int>(GetScintYield(edep, *larp) * nphot);
-        //amount of scintillated photons created via the slow scintillation process
-        double nphot_slow = nphot - nphot_fast;
-        for (unsigned int channel = 0; channel < nOpChannels; ++channel) {
-          auto visibleFraction = Visibilities[channel];
-          if (visibleFraction == 0.0) {
-            // Voxel is not visible at this optical channel, skip doing anything for this channel.
-            continue;
-          }
-          if (lgp->UseLitePhotons()) {
-            if (nphot_fast > 0) {
-              //throwing a random number from a poisson distribution with a mean of the amount of photons visible at this channel
-              auto n = static_cast<int>(randpoisphot.fire(nphot_fast * visibleFraction));
-              for (long i = 0; i < n; ++i) {
-                //calculates the time at which the photon was produced
-                auto time = static_cast<int>(edep.T0() + GetScintTime(fRiseTimeFast,
-                                                                      larp->ScintFastTimeConst(),
-                                                                      randflatscinttime));
-                ++photonLiteCollection[channel].DetectedPhotons[time];
-              }
-            }
-            if ((nphot_slow > 0) && fDoSlowComponent) {
-              //throwing a random number from a poisson distribution with a mean of the amount of photons visible at this channel
-              auto n = randpoisphot.fire(nphot_slow * visibleFraction);
-              for (long i = 0; i < n; ++i) {
-                //calculates the time at which the photon was produced
-                auto time = static_cast<int>(edep.T0() + GetScintTime(fRiseTimeSlow,
-                                                                      larp->ScintSlowTimeConst(),
-                                                                      randflatscinttime));
-                ++photonLiteCollection[channel].DetectedPhotons[time];
-              }
-            }
-          }
-          else {
-            sim::OnePhoton photon;
-            photon.SetInSD = false;
-            photon.InitialPosition = edep.End();
-            photon.Energy = 9.7e-6;
-            if (nphot_fast > 0) {
-              //throwing a random number from a poisson distribution with a mean of the amount of photons visible at this channel
-              auto n = randpoisphot.fire(nphot_fast * visibleFraction);
-              if (n > 0) {
-                //calculates the time at which the photon was produced
-                photon.Time =
-                  edep.T0() +
-                  GetScintTime(fRiseTimeFast, larp->ScintFastTimeConst(), randflatscinttime);
-                // add n copies of sim::OnePhoton photon to the photon collection for a given OpChannel
-                photonCollection[channel].insert(photonCollection[channel].end(), n, photon);
-              }
-            }
-            if ((nphot_slow > 0) && fDoSlowComponent) {
-              //throwing a random number from a poisson distribution with a mean of the amount of photons visible at this channel
-              auto n = randpoisphot.fire(nphot_slow * visibleFraction);
-              if (n > 0) {
-                //calculates the time at which the photon was produced
-                photon.Time =
-                  edep.T0() +
-                  GetScintTime(fRiseTimeSlow, larp->ScintSlowTimeConst(), randflatscinttime);
-                // add n copies of sim::OnePhoton photon to the photon collection for a given OpChannel
-                photonCollection[channel].insert(photonCollection[channel].end(), n, photon);
-              }
-            }
-          }
+
+    if (fBatchByVoxel) {
+      for (sim::SimEnergyDeposit const* edep : fEDeps) {
+        auto const [nphot_fast, nphot_slow] = scintPhotons(*edep);
+        // collect the yield in the group of the voxel and time bin of the deposit
+        std::pair<int, long long> const key{
+          pvs->LibraryVoxelID(edep->MidPoint()),
+          static_cast<long long>(std::floor(edep->T0() / fBatchTimeBinWidth))};
+        auto const [itGroup, isNew] = fGroupIndex.try_emplace(key, fGroups.size());
+        if (isNew) {
+          DepositGroup& group = fGroups.emplace_back();
+          group.midPoint = edep->MidPoint();
+          group.end = edep->End();
+          group.firstT0 = edep->T0();
         }
+        DepositGroup& group = fGroups[itGroup->second];
+        group.nphotFast += nphot_fast;
+        group.nphotSlow += nphot_slow;
+        group.weightedT0 += edep->T0() * (nphot_fast + nphot_slow);
+      }
+    }
+
+    fEngine.simulate(fBatchByVoxel ? fGroups.size() : fEDeps.size(),
+                     *this,
+                     fPhotonEngine,
+                     fScintTimeEngine);
+
+    fGroups.clear();
+    fGroupIndex.clear();
+    fEDeps.clear();
+    fDetProp = nullptr;
+
+    // put the photon collection of LitePhotons or SimPhotons into the art event
+    fEngine.put(e, moduleDescription().moduleLabel());
+  }
+
+  std::pair<double, double>
+  PhotonLibraryPropagation::scintPhotons(sim::SimEnergyDeposit const& edep)
+  {
+    auto const isCalcData = fISAlg.CalcIonAndScint(*fDetProp, edep);
+    //total amount of scintillation photons
+    double nphot = static_cast<int>(isCalcData.numPhotons);
+    //amount of scintillated photons created via the fast scintillation process
+    double nphot_fast = static_cast<int>(GetScintYield(edep, *fLArProp) * nphot);
+    //amount of scintillated photons created via the slow scintillation process
+    double nphot_slow = nphot - nphot_fast;
+    return {nphot_fast, nphot_slow};
+  }
+
+  double
+  PhotonLibraryPropagation::sourceStartTime(std::size_t iSource) const
+  {
+    return fBatchByVoxel ? fGroups[iSource].firstT0 : fEDeps[iSource]->T0();
+  }
+
+  void
+  PhotonLibraryPropagation::simulateSource(std::size_t iSource,
+                                           FastOpticalRandom& rng,
+                                           FastOpticalPhotons& photons)
+  {
+    geo::Point_t midPoint, end;
+    double nphot_fast = 0., nphot_slow = 0., t0 = 0.;
+    if (fBatchByVoxel) {
+      DepositGroup const& group = fGroups[iSource];
+      midPoint = group.midPoint;
+      end = group.end;
+      nphot_fast = group.nphotFast;
+      nphot_slow = group.nphotSlow;
+      double const nphot = nphot_fast + nphot_slow;
+      t0 = (nphot > 0.) ? group.weightedT0 / nphot : group.firstT0;
+    }
+    else {
+      sim::SimEnergyDeposit const& edep = *fEDeps[iSource];
+      std::tie(nphot_fast, nphot_slow) = scintPhotons(edep);
+      midPoint = edep.MidPoint();
+      end = edep.End();
+      t0 = edep.T0();
+    }
+
+    art::ServiceHandle<PhotonVisibilityService const> pvs;
+    auto const& Visibilities = pvs->GetAllVisibilities(midPoint);
+    if (!Visibilities) {
+      throw cet::exception("PhotonLibraryPropagation")
+        << "There is no entry in the PhotonLibrary for this position in space. "
+           "Position: "
+        << midPoint;
+    }
+    photons.simulated = true;
+    photons.origin = midPoint;
+    photons.photonOrigin = end;
+
+    MappedTimeHistograms_t propTimes;
+    if (fIncludePropagationTime) propTimes = pvs->GetTimingHistograms(midPoint);
+
+    CLHEP::RandFlat randflatscinttime{rng.scintTime};
+    unsigned int const nOpChannels = pvs->NOpChannels();
+    for (unsigned int channel = 0; channel < nOpChannels; ++channel) {
+      auto visibleFraction = Visibilities[channel];
+      if (visibleFraction == 0.0) {
+        // Voxel is not visible at this optical channel, skip doing anything for this channel.
+        continue;
       }
+      PropagationTimeHistogram const propTime =
+        propTimes ? propTimes[channel] : PropagationTimeHistogram{};
+      emitPhotons(channel, visibleFraction, nphot_fast, nphot_slow, t0, propTime,
+                  rng.poisson, randflatscinttime, photons);
     }
-    if (lgp->UseLitePhotons()) {
-      // put the photon collection of LitePhotons into the art event
-      e.put(move(photLiteCol));
+  }
+
+  void
+  PhotonLibraryPropagation::emitPhotons(unsigned int channel,
+                                        double visibleFraction,
+                                        double nphot_fast,
+                                        double nphot_slow,
+                                        double t0,
+                                        PropagationTimeHistogram const& propTime,
+                                        CLHEP::RandPoissonQ& randpoisphot,
+                                        CLHEP::RandFlat& randflatscinttime,
+                                        FastOpticalPhotons& photons) const
+  {
+    // propagation time of a photon to this channel (none without histogram)
+    auto propagationTime = [&propTime, &randflatscinttime]() {
+      return propTime.isValid() ? propTime.sample(randflatscinttime()) : 0.0;
+    };
+    photons.channels.push_back({channel, false, photons.times.size(), 0U});
+    auto& times = photons.times;
+    if (fUseLitePhotons) {
+      if (nphot_fast > 0) {
+        //throwing a random number from a poisson distribution with a mean of the amount of photons visible at this channel
+        auto n = static_cast<int>(randpoisphot.fire(nphot_fast * visibleFraction));
+        for (long i = 0; i < n; ++i) {
+          //calculates the time at which the photon was produced
+          times.push_back(static_cast<int>(
+            t0 + GetScintTime(fRiseTimeFast, fLArProp->ScintFastTimeConst(), randflatscinttime) +
+            propagationTime()));
+        }
+      }
+      if ((nphot_slow > 0) && fDoSlowComponent) {
+        //throwing a random number from a poisson distribution with a mean of the amount of photons visible at this channel
+        auto n = randpoisphot.fire(nphot_slow * visibleFraction);
+        for (long i = 0; i < n; ++i) {
+          //calculates the time at which the photon was produced
+          times.push_back(static_cast<int>(
+            t0 + GetScintTime(fRiseTimeSlow, fLArProp->ScintSlowTimeConst(), randflatscinttime) +
+            propagationTime()));
+        }
+      }
     }
     else {
-      //put the photon collection of SimPhotons into the art event
-      e.put(move(photCol));
+      // each photon is just a copy containing the same information
+      if (nphot_fast > 0) {
+        //throwing a random number from a poisson distribution with a mean of the amount of photons visible at this channel
+        auto n = randpoisphot.fire(nphot_fast * visibleFraction);
+        if (n > 0) {
+          //calculates the time at which the photon was produced
+          auto const time = static_cast<int>(
+            t0 + GetScintTime(fRiseTimeFast, fLArProp->ScintFastTimeConst(), randflatscinttime) +
+            propagationTime());
+          // add n copies of the photon to the photons of this OpChannel
+          times.insert(times.end(), n, time);
+        }
+      }
+      if ((nphot_slow > 0) && fDoSlowComponent) {
+        //throwing a random number from a poisson distribution with a mean of the amount of photons visible at this channel
+        auto n = randpoisphot.fire(nphot_slow * visibleFraction);
+        if (n > 0) {
+          //calculates the time at which the photon was produced
+          auto const time = static_cast<int>(
+            t0 + GetScintTime(fRiseTimeSlow, fLArProp->ScintSlowTimeConst(), randflatscinttime) +
+            propagationTime());
+          // add n copies of the photon to the photons of this OpChannel
+          times.insert(times.end(), n, time);
+        }
+      }
     }
+    photons.channels.back().end = times.size();
   }
 
 } // namespace phot
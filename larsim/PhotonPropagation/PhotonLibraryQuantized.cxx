@@ -0,0 +1,329 @@
+/**
+ * @file   larsim/PhotonPropagation/PhotonLibraryQuantized.cxx
+ * @brief  Photon library holding visibilities in compressed, quantized form.
+ * @see    larsim/PhotonPropagation/PhotonLibraryQuantized.h
+ */
+
+#include "larsim/PhotonPropagation/PhotonLibraryQuantized.h"
+
+#include "cetlib_except/exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// C/C++ standard libraries
+#include <algorithm> // std::fill(), std::max_element(), std::clamp()
+#include <cmath>
+#include <limits>
+
+namespace {
+
+  /// Step of the `Log8` logarithmic scale.
+  double const Log8Step = std::log(phot::PhotonLibraryQuantized::Log8DynamicRange) / 254.0;
+
+  /// Zero values shorter than this are stored within runs rather than split.
+  constexpr std::size_t MinZeroGap = 4U;
+
+} // local namespace
+
+namespace phot {
+
+  std::array<float, 256U> const PhotonLibraryQuantized::Decode8 =
+    PhotonLibraryQuantized::makeDecode8();
+
+  //------------------------------------------------------------
+  PhotonLibraryQuantized::PhotonLibraryQuantized(IPhotonLibrary const& library, Encoding encoding)
+    : fEncoding(encoding)
+    , fNOpChannels(library.NOpChannels())
+    , fNVoxels(library.NVoxels())
+    , fHasReflected(library.hasReflected())
+    , fHasReflectedT0(library.hasReflectedT0())
+  {
+    fillTable(fTables[kDirect], [&library](size_t v) { return library.GetCounts(v); });
+    if (fHasReflected)
+      fillTable(fTables[kReflected], [&library](size_t v) { return library.GetReflCounts(v); });
+    if (fHasReflectedT0)
+      fillTable(fTables[kReflectedT0], [&library](size_t v) { return library.GetReflT0s(v); });
+
+    mf::LogInfo("PhotonLibraryQuantized")
+      << "Photon library compressed with " << ((fEncoding == Encoding::Log16) ? "16" : "8")
+      << "-bit logarithmic encoding: " << memoryUsage() << " bytes instead of "
+      << (LibrarySize() * sizeof(float) * (1 + fHasReflected + fHasReflectedT0))
+      << "; maximum relative error: " << maxRelativeError();
+  }
+
+  //------------------------------------------------------------
+  template <typename GetRow>
+  void
+  PhotonLibraryQuantized::fillTable(Table_t& table, GetRow getRow)
+  {
+    // --- BEGIN -- range of the table (for Log16 encoding) --------------------
+    double minValue = std::numeric_limits<double>::max();
+    double maxValue = 0.0;
+    if (fEncoding == Encoding::Log16) {
+      for (size_t iVoxel = 0; iVoxel < fNVoxels; ++iVoxel) {
+        float const* row = getRow(iVoxel);
+        if (!row) continue;
+        for (size_t iCh = 0; iCh < fNOpChannels; ++iCh) {
+          if (row[iCh] <= 0.0f) continue;
+          minValue = std::min<double>(minValue, row[iCh]);
+          maxValue = std::max<double>(maxValue, row[iCh]);
+        }
+      } // for voxels
+      if (maxValue == 0.0) minValue = maxValue = 1.0; // all zero: any range will do
+    }
+    double const logMin = std::log(minValue);
+    double const log16Step = (maxValue > minValue) ? (std::log(maxValue) - logMin) / 65534.0 : 0.0;
+    if (fEncoding == Encoding::Log16) {
+      table.logStep16 = log16Step;
+      table.decode16.resize(65536U);
+      table.decode16[0] = 0.0f;
+      for (std::size_t code = 1; code < table.decode16.size(); ++code)
+        table.decode16[code] = std::exp(logMin + (code - 1) * log16Step);
+    }
+    // --- END -- range of the table (for Log16 encoding) ----------------------
+
+    table.voxelFirstRun.reserve(fNVoxels + 1);
+    table.voxelFirstCode.reserve(fNVoxels + 1);
+    if (fEncoding == Encoding::Log8) table.voxelScale.reserve(fNVoxels);
+
+    for (size_t iVoxel = 0; iVoxel < fNVoxels; ++iVoxel) {
+      table.voxelFirstRun.push_back(table.runs.size());
+      table.voxelFirstCode.push_back(
+        (fEncoding == Encoding::Log16) ? table.codes16.size() : table.codes8.size());
+
+      float const* row = getRow(iVoxel);
+
+      float scale = 0.0f;
+      if (row && (fEncoding == Encoding::Log8)) scale = *std::max_element(row, row + fNOpChannels);
+      if (fEncoding == Encoding::Log8) table.voxelScale.push_back(scale);
+      if (!row) continue;
+
+      auto encode = [&](float value) {
+        if (fEncoding == Encoding::Log16) {
+          std::uint16_t code = 0;
+          if (value > 0.0f) {
+            long int const c =
+              (log16Step > 0.0) ? std::lround((std::log(double(value)) - logMin) / log16Step) + 1 : 1;
+            code = static_cast<std::uint16_t>(std::clamp(c, 1L, 65535L));
+          }
+          table.codes16.push_back(code);
+        }
+        else {
+          std::uint8_t code = 0;
+          if ((value > 0.0f) && (scale > 0.0f)) {
+            // code 255 represents `scale`, code 1 represents `scale / range`
+            long int const c = 255 + std::lround(std::log(double(value) / scale) / Log8Step);
+            if (c >= 1) code = static_cast<std::uint8_t>(std::min(c, 255L));
+          }
+          table.codes8.push_back(code);
+        }
+      }; // encode()
+
+      // find the runs of non-zero values, merging the ones separated by
+      // short gaps of zeroes
+      size_t iCh = 0;
+      while (iCh < fNOpChannels) {
+        while ((iCh < fNOpChannels) && (row[iCh] == 0.0f))
+          ++iCh;
+        if (iCh == fNOpChannels) break;
+        size_t const runStart = iCh;
+        size_t runEnd = iCh; // one past the last non-zero value of the run
+        size_t zeroes = 0;
+        for (; iCh < fNOpChannels; ++iCh) {
+          if (row[iCh] != 0.0f) {
+            runEnd = iCh + 1;
+            zeroes = 0;
+          }
+          else if (++zeroes >= MinZeroGap)
+            break;
+        } // for channels in run
+        table.runs.push_back({static_cast<std::uint32_t>(runStart),
+                              static_cast<std::uint32_t>(runEnd - runStart)});
+        for (size_t i = runStart; i < runEnd; ++i)
+          encode(row[i]);
+        iCh = runEnd;
+      } // while channels
+    }   // for voxels
+
+    table.voxelFirstRun.push_back(table.runs.size());
+    table.voxelFirstCode.push_back((fEncoding == Encoding::Log16) ? table.codes16.size() :
+                                                                   table.codes8.size());
+
+    table.runs.shrink_to_fit();
+    table.codes16.shrink_to_fit();
+    table.codes8.shrink_to_fit();
+  } // PhotonLibraryQuantized::fillTable()
+
+  //------------------------------------------------------------
+  float
+  PhotonLibraryQuantized::decodeValue(Table_t const& table, size_t Voxel, size_t OpChannel) const
+  {
+    if ((Voxel >= fNVoxels) || (OpChannel >= fNOpChannels)) return 0;
+
+    auto const runBegin = table.runs.begin() + table.voxelFirstRun[Voxel];
+    auto const runEnd = table.runs.begin() + table.voxelFirstRun[Voxel + 1];
+    std::uint64_t codeIndex = table.voxelFirstCode[Voxel];
+    for (auto iRun = runBegin; iRun != runEnd; ++iRun) {
+      if (OpChannel < iRun->firstChannel) return 0;
+      if (OpChannel < iRun->firstChannel + iRun->nChannels) {
+        codeIndex += OpChannel - iRun->firstChannel;
+        return (fEncoding == Encoding::Log16) ?
+                 table.decode16[table.codes16[codeIndex]] :
+                 table.voxelScale[Voxel] * Decode8[table.codes8[codeIndex]];
+      }
+      codeIndex += iRun->nChannels;
+    } // for
+    return 0;
+  } // PhotonLibraryQuantized::decodeValue()
+
+  //------------------------------------------------------------
+  float const*
+  PhotonLibraryQuantized::decodeVoxel(TableKind_t kind, size_t Voxel) const
+  {
+    if (Voxel >= fNVoxels) return nullptr;
+
+    static thread_local std::array<std::vector<float>, NTableKinds> Buffers;
+
+    std::vector<float>& buffer = Buffers[kind];
+    buffer.resize(fNOpChannels);
+    decodeVoxelInto(kind, Voxel, buffer.data());
+    return buffer.data();
+  } // PhotonLibraryQuantized::decodeVoxel()
+
+  //------------------------------------------------------------
+  void
+  PhotonLibraryQuantized::decodeVoxelInto(TableKind_t kind, size_t Voxel, float* dest) const
+  {
+    Table_t const& table = fTables[kind];
+    std::fill(dest, dest + fNOpChannels, 0.0f);
+
+    auto const runBegin = table.runs.begin() + table.voxelFirstRun[Voxel];
+    auto const runEnd = table.runs.begin() + table.voxelFirstRun[Voxel + 1];
+    std::uint64_t codeIndex = table.voxelFirstCode[Voxel];
+    for (auto iRun = runBegin; iRun != runEnd; ++iRun) {
+      float* runDest = dest + iRun->firstChannel;
+      if (fEncoding == Encoding::Log16) {
+        std::uint16_t const* code = table.codes16.data() + codeIndex;
+        for (std::uint32_t i = 0; i < iRun->nChannels; ++i)
+          runDest[i] = table.decode16[code[i]];
+      }
+      else {
+        float const scale = table.voxelScale[Voxel];
+        std::uint8_t const* code = table.codes8.data() + codeIndex;
+        for (std::uint32_t i = 0; i < iRun->nChannels; ++i)
+          runDest[i] = scale * Decode8[code[i]];
+      }
+      codeIndex += iRun->nChannels;
+    } // for runs
+  } // PhotonLibraryQuantized::decodeVoxelInto()
+
+  //------------------------------------------------------------
+  float
+  PhotonLibraryQuantized::GetCount(size_t Voxel, size_t OpChannel) const
+  {
+    return decodeValue(fTables[kDirect], Voxel, OpChannel);
+  }
+
+  //------------------------------------------------------------
+  float
+  PhotonLibraryQuantized::GetReflCount(size_t Voxel, size_t OpChannel) const
+  {
+    return fHasReflected ? decodeValue(fTables[kReflected], Voxel, OpChannel) : 0;
+  }
+
+  //------------------------------------------------------------
+  float
+  PhotonLibraryQuantized::GetReflT0(size_t Voxel, size_t OpChannel) const
+  {
+    return fHasReflectedT0 ? decodeValue(fTables[kReflectedT0], Voxel, OpChannel) : 0;
+  }
+
+  //------------------------------------------------------------
+  float const*
+  PhotonLibraryQuantized::GetCounts(size_t Voxel) const
+  {
+    return decodeVoxel(kDirect, Voxel);
+  }
+
+  //------------------------------------------------------------
+  float const*
+  PhotonLibraryQuantized::GetReflCounts(size_t Voxel) const
+  {
+    return fHasReflected ? decodeVoxel(kReflected, Voxel) : nullptr;
+  }
+
+  //------------------------------------------------------------
+  float const*
+  PhotonLibraryQuantized::GetReflT0s(size_t Voxel) const
+  {
+    return fHasReflectedT0 ? decodeVoxel(kReflectedT0, Voxel) : nullptr;
+  }
+
+  //------------------------------------------------------------
+  bool
+  PhotonLibraryQuantized::CopyCounts(size_t Voxel, float* dest) const
+  {
+    if (Voxel >= fNVoxels) return false;
+    decodeVoxelInto(kDirect, Voxel, dest);
+    return true;
+  }
+
+  //------------------------------------------------------------
+  bool
+  PhotonLibraryQuantized::CopyReflCounts(size_t Voxel, float* dest) const
+  {
+    if (!fHasReflected || (Voxel >= fNVoxels)) return false;
+    decodeVoxelInto(kReflected, Voxel, dest);
+    return true;
+  }
+
+  //------------------------------------------------------------
+  std::size_t
+  PhotonLibraryQuantized::memoryUsage() const
+  {
+    std::size_t size = 0U;
+    for (Table_t const& table : fTables) {
+      size += table.voxelFirstRun.size() * sizeof(std::uint64_t);
+      size += table.voxelFirstCode.size() * sizeof(std::uint64_t);
+      size += table.runs.size() * sizeof(Run_t);
+      size += table.codes16.size() * sizeof(std::uint16_t);
+      size += table.codes8.size() * sizeof(std::uint8_t);
+      size += table.voxelScale.size() * sizeof(float);
+      size += table.decode16.size() * sizeof(float);
+    }
+    return size;
+  }
+
+  //------------------------------------------------------------
+  double
+  PhotonLibraryQuantized::maxRelativeError() const
+  {
+    if (fEncoding == Encoding::Log8) return std::expm1(Log8Step / 2.0);
+
+    double maxStep = 0.0;
+    for (Table_t const& table : fTables)
+      maxStep = std::max(maxStep, table.logStep16);
+    return std::expm1(maxStep / 2.0);
+  }
+
+  //------------------------------------------------------------
+  auto
+  PhotonLibraryQuantized::parseEncoding(std::string const& name) -> Encoding
+  {
+    if (name == "log16") return Encoding::Log16;
+    if (name == "log8") return Encoding::Log8;
+    throw cet::exception("PhotonLibraryQuantized")
+      << "Unsupported photon library encoding: '" << name << "' (use 'log16' or 'log8').\n";
+  }
+
+  //------------------------------------------------------------
+  std::array<float, 256U>
+  PhotonLibraryQuantized::makeDecode8()
+  {
+    std::array<float, 256U> table;
+    table[0] = 0.0f;
+    for (std::size_t code = 1; code < table.size(); ++code)
+      table[code] = std::exp(-Log8Step * (255.0 - code));
+    return table;
+  }
+
+} // namespace phot
@@ -0,0 +1,177 @@
+/**
+ * @file   larsim/PhotonPropagation/PhotonLibraryQuantized.h
+ * @brief  Photon library holding visibilities in compressed, quantized form.
+ * @see    larsim/PhotonPropagation/PhotonLibraryQuantized.cxx
+ *
+ * Visibilities span many orders of magnitude and are often exactly zero.
+ * This library stores them with a logarithmic quantization, so that the
+ * relative error is bounded, and skips runs of zero values.
+ *
+ * Two encodings are supported:
+ *  * `Encoding::Log16`: 16-bit codes spanning logarithmically the range
+ *    between the smallest and the largest non-zero value of the whole table;
+ *    the relative error is at most `exp(step / 2) - 1`, with
+ *    `step = ln(max / min) / 65534`: for example, a table spanning twelve
+ *    orders of magnitude yields a relative error smaller than `2.2e-4`;
+ *  * `Encoding::Log8`: 8-bit codes spanning logarithmically the range
+ *    `[ m / Log8DynamicRange, m ]`, where `m` is the largest value of the voxel
+ *    (stored as a per-voxel `float` scale); the relative error is at most
+ *    `exp(step / 2) - 1` with `step = ln(Log8DynamicRange) / 254`, that is
+ *    `2.8%`; values smaller than `m / Log8DynamicRange` are stored as zero.
+ *
+ * Zero values are always represented exactly.
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_PHOTONLIBRARYQUANTIZED_H
+#define LARSIM_PHOTONPROPAGATION_PHOTONLIBRARYQUANTIZED_H
+
+#include "larsim/PhotonPropagation/IPhotonLibrary.h"
+
+// C/C++ standard libraries
+#include <array>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace phot {
+
+  /**
+   * @brief Read-only photon library with quantized and sparse storage.
+   *
+   * The library is built as a compressed copy of another library (typically
+   * a `phot::PhotonLibrary` just loaded from file, which can be released
+   * afterwards).
+   *
+   * For each voxel, only the runs of non-zero values are stored (short
+   * sequences of zeroes between non-zero values are kept in the run).
+   *
+   * `GetCount()` decodes a single value. `GetCounts()` (and the other
+   * per-voxel accessors) decode the whole voxel into a buffer which is
+   * private to the calling thread and to the table being accessed: the
+   * returned pointer stays valid until the same thread asks for another voxel
+   * from the same kind of table (direct, reflected or reflected timing) of any
+   * `PhotonLibraryQuantized` object. `CopyCounts()` and `CopyReflCounts()`
+   * decode directly into the storage of the caller.
+   */
+  class PhotonLibraryQuantized : public IPhotonLibrary {
+  public:
+    /// Supported encodings.
+    enum class Encoding {
+      Log16, ///< 16-bit logarithmic codes, library-wide range.
+      Log8   ///< 8-bit logarithmic codes, per-voxel range.
+    };
+
+    /// Ratio between largest and smallest value represented with `Log8`.
+    static constexpr double Log8DynamicRange = 1e6;
+
+    /// Creates a quantized copy of all the tables available in `library`.
+    PhotonLibraryQuantized(IPhotonLibrary const& library, Encoding encoding);
+
+    virtual float GetCount(size_t Voxel, size_t OpChannel) const override;
+    virtual float GetReflCount(size_t Voxel, size_t OpChannel) const override;
+    virtual float GetReflT0(size_t Voxel, size_t OpChannel) const override;
+
+    /// Returns a thread-local buffer with `NOpChannels()` decoded values.
+    virtual float const* GetCounts(size_t Voxel) const override;
+    virtual float const* GetReflCounts(size_t Voxel) const override;
+    virtual float const* GetReflT0s(size_t Voxel) const override;
+
+    /// Decodes `NOpChannels()` values into `dest`.
+    virtual bool CopyCounts(size_t Voxel, float* dest) const override;
+    virtual bool CopyReflCounts(size_t Voxel, float* dest) const override;
+
+    virtual bool
+    hasReflected() const override
+    {
+      return fHasReflected;
+    }
+
+    virtual bool
+    hasReflectedT0() const override
+    {
+      return fHasReflectedT0;
+    }
+
+    virtual int
+    NOpChannels() const override
+    {
+      return fNOpChannels;
+    }
+    virtual int
+    NVoxels() const override
+    {
+      return fNVoxels;
+    }
+
+    /// Returns the size of the compressed data [bytes]
+    std::size_t memoryUsage() const;
+
+    virtual size_t
+    MemoryFootprint() const override
+    {
+      return memoryUsage();
+    }
+
+    /// Returns the largest relative error introduced by the quantization.
+    double maxRelativeError() const;
+
+    /// Converts an encoding name (`"log16"`, `"log8"`) into an `Encoding`.
+    /// @throw cet::exception if the name is not supported
+    static Encoding parseEncoding(std::string const& name);
+
+  private:
+    /// A sequence of non-zero values.
+    struct Run_t {
+      std::uint32_t firstChannel; ///< First channel of the run.
+      std::uint32_t nChannels;    ///< Number of channels in the run.
+    };
+
+    /// Quantized data of a whole table (e.g. direct visibilities).
+    struct Table_t {
+      std::vector<std::uint64_t> voxelFirstRun;  ///< Index of the first run of each voxel (+ end).
+      std::vector<std::uint64_t> voxelFirstCode; ///< Index of the first code of each voxel.
+      std::vector<Run_t> runs;                   ///< All runs, voxel by voxel.
+      std::vector<std::uint16_t> codes16;        ///< Codes (`Log16` encoding).
+      std::vector<std::uint8_t> codes8;          ///< Codes (`Log8` encoding).
+      std::vector<float> voxelScale;             ///< Largest value in voxel (`Log8`).
+      std::vector<float> decode16;               ///< Value of each `Log16` code.
+      double logStep16 = 0.0;                    ///< Logarithmic step of `Log16` codes.
+    };
+
+    /// Identifiers of the table kinds (also index of the decoding buffers).
+    enum TableKind_t : std::size_t { kDirect, kReflected, kReflectedT0, NTableKinds };
+
+    Encoding fEncoding;
+    std::size_t fNOpChannels = 0U;
+    std::size_t fNVoxels = 0U;
+
+    bool fHasReflected = false;
+    bool fHasReflectedT0 = false;
+
+    std::array<Table_t, NTableKinds> fTables;
+
+    /// Decoding table of `Log8` codes, relative to the voxel scale.
+    static std::array<float, 256U> const Decode8;
+
+    /// Fills `table` with the data from `getRow(voxel)` rows.
+    template <typename GetRow>
+    void fillTable(Table_t& table, GetRow getRow);
+
+    /// Returns the decoded value from `table`.
+    float decodeValue(Table_t const& table, size_t Voxel, size_t OpChannel) const;
+
+    /// Decodes a full voxel from `table` into a thread-local buffer.
+    float const* decodeVoxel(TableKind_t kind, size_t Voxel) const;
+
+    /// Decodes a full voxel from `table` into `dest` (`NOpChannels()` values).
+    void decodeVoxelInto(TableKind_t kind, size_t Voxel, float* dest) const;
+
+    /// Returns the `Log8` decoding table.
+    static std::array<float, 256U> makeDecode8();
+
+  }; // class PhotonLibraryQuantized
+
+} // namespace phot
+
+#endif // LARSIM_PHOTONPROPAGATION_PHOTONLIBRARYQUANTIZED_H
@@ -0,0 +1,302 @@
+/**
+ * @file   larsim/PhotonPropagation/PhotonLibraryShard.cxx
+ * @brief  Partial photon libraries produced by distributed library builds.
+ * @see    larsim/PhotonPropagation/PhotonLibraryShard.h
+ */
+
+#include "larsim/PhotonPropagation/PhotonLibraryShard.h"
+
+#include "cetlib_except/exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// POSIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// C/C++ standard libraries
+#include <algorithm> // std::sort(), std::min()
+#include <cerrno>
+#include <cmath>   // std::isfinite()
+#include <cstring> // std::memcmp(), std::memcpy(), std::memset(), std::strerror()
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+  /// Writes `n` bytes from `data` into the descriptor `fd`.
+  void
+  writeAll(int fd, void const* data, std::uint64_t n, std::string const& destName)
+  {
+    char const* ptr = static_cast<char const*>(data);
+    while (n > 0) {
+      ssize_t const written = ::write(fd, ptr, n);
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        throw cet::exception("PhotonLibraryShard")
+          << "Error while writing the photon library shard into '" << destName
+          << "': " << std::strerror(errno) << "\n";
+      }
+      ptr += written;
+      n -= written;
+    }
+  }
+
+  /// Reads `n` bytes at `offset` of `fd` into `data`; returns whether all were read.
+  bool
+  readAll(int fd, void* data, std::uint64_t n, std::uint64_t offset)
+  {
+    char* ptr = static_cast<char*>(data);
+    while (n > 0) {
+      ssize_t const nRead = ::pread(fd, ptr, n, offset);
+      if (nRead < 0) {
+        if (errno == EINTR) continue;
+        return false;
+      }
+      if (nRead == 0) return false; // unexpected end of file
+      ptr += nRead;
+      n -= nRead;
+      offset += nRead;
+    }
+    return true;
+  }
+
+  /// Closes the descriptor when going out of scope.
+  struct FileCloser {
+    int fd;
+    ~FileCloser()
+    {
+      if (fd >= 0) ::close(fd);
+    }
+  };
+
+} // local namespace
+
+namespace phot {
+
+  static_assert(sizeof(PhotonLibraryShard::ShardHeader_t) <= PhotonLibraryShard::HeaderSize);
+
+  //------------------------------------------------------------
+  std::vector<PhotonLibraryShard::ShardInfo_t>
+  PhotonLibraryShard::readManifest(std::string const& manifestName)
+  {
+    std::ifstream in(manifestName);
+    if (!in) {
+      throw cet::exception("PhotonLibraryShard")
+        << "Can't open the shard manifest '" << manifestName << "'\n";
+    }
+    std::string const baseDir = (manifestName.find('/') == std::string::npos) ?
+                                  std::string{} :
+                                  manifestName.substr(0, manifestName.rfind('/') + 1);
+
+    std::vector<ShardInfo_t> shards;
+    std::string line;
+    unsigned int iLine = 0;
+    while (std::getline(in, line)) {
+      ++iLine;
+      std::istringstream sline(line);
+      std::string first;
+      if (!(sline >> first) || (first[0] == '#')) continue;
+
+      ShardInfo_t shard;
+      std::istringstream sfirst(first);
+      if (!(sfirst >> shard.firstVoxel) || !(sline >> shard.nVoxels >> shard.fileName) ||
+          (shard.nVoxels == 0U)) {
+        throw cet::exception("PhotonLibraryShard")
+          << "Shard manifest '" << manifestName << "' line " << iLine << ": expected"
+          << " <first voxel> <number of voxels> <file name>, found: '" << line << "'\n";
+      }
+      if (shard.fileName[0] != '/') shard.fileName = baseDir + shard.fileName;
+      shards.push_back(std::move(shard));
+    }
+
+    std::sort(shards.begin(), shards.end(), [](ShardInfo_t const& a, ShardInfo_t const& b) {
+      return a.firstVoxel < b.firstVoxel;
+    });
+    return shards;
+  }
+
+  //------------------------------------------------------------
+  void
+  PhotonLibraryShard::writeShard(std::string const& fileName,
+                                 IPhotonLibrary const& library,
+                                 std::size_t firstVoxel,
+                                 std::size_t nVoxels,
+                                 bool storeReflected /* = false */,
+                                 bool storeReflT0 /* = false */)
+  {
+    std::size_t const nChannels = library.NOpChannels();
+    if (firstVoxel + nVoxels > std::size_t(library.NVoxels())) {
+      throw cet::exception("PhotonLibraryShard")
+        << "Shard of voxels " << firstVoxel << " to " << (firstVoxel + nVoxels - 1)
+        << " requested from a library with only " << library.NVoxels() << " voxels.\n";
+    }
+    if ((storeReflected && !library.hasReflected()) ||
+        (storeReflT0 && !library.hasReflectedT0())) {
+      throw cet::exception("PhotonLibraryShard")
+        << "writeShard() requested to store reflected light information,"
+           " which the library does not have.\n";
+    }
+
+    ShardHeader_t header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = FormatVersion;
+    if (storeReflected) header.flags |= FlagReflected;
+    if (storeReflT0) header.flags |= FlagReflectedT0;
+    header.firstVoxel = firstVoxel;
+    header.nVoxels = nVoxels;
+    header.nOpChannels = nChannels;
+
+    mf::LogInfo("PhotonLibraryShard")
+      << "Writing voxels " << firstVoxel << " to " << (firstVoxel + nVoxels - 1) << " ("
+      << nChannels << " channels) into photon library shard: " << fileName;
+
+    std::string const tempName = fileName + ".partial";
+    int const fd = ::open(tempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      throw cet::exception("PhotonLibraryShard")
+        << "Can't open '" << tempName << "' for writing the photon library shard: "
+        << std::strerror(errno) << "\n";
+    }
+    {
+      FileCloser closer{fd};
+
+      std::vector<char> headerBlock(HeaderSize, 0);
+      std::memcpy(headerBlock.data(), &header, sizeof(header));
+      writeAll(fd, headerBlock.data(), headerBlock.size(), tempName);
+
+      auto writeTable = [fd, &tempName, firstVoxel, nVoxels, nChannels](auto getRow) {
+        std::vector<float> const zeros(nChannels, 0.0f);
+        for (std::size_t iVoxel = firstVoxel; iVoxel < firstVoxel + nVoxels; ++iVoxel) {
+          float const* row = getRow(iVoxel);
+          writeAll(fd, row ? row : zeros.data(), nChannels * sizeof(float), tempName);
+        }
+      };
+      writeTable([&library](std::size_t v) { return library.GetCounts(v); });
+      if (storeReflected)
+        writeTable([&library](std::size_t v) { return library.GetReflCounts(v); });
+      if (storeReflT0) writeTable([&library](std::size_t v) { return library.GetReflT0s(v); });
+
+      if (::fsync(fd) != 0) {
+        throw cet::exception("PhotonLibraryShard")
+          << "Error while synchronising the photon library shard '" << tempName
+          << "': " << std::strerror(errno) << "\n";
+      }
+      closer.fd = -1;
+      if (::close(fd) != 0) {
+        throw cet::exception("PhotonLibraryShard")
+          << "Error while closing the photon library shard '" << tempName
+          << "': " << std::strerror(errno) << "\n";
+      }
+    }
+
+    // the shard appears under its final name only when complete
+    if (::rename(tempName.c_str(), fileName.c_str()) != 0) {
+      throw cet::exception("PhotonLibraryShard")
+        << "Can't rename the photon library shard '" << tempName << "' into '" << fileName
+        << "': " << std::strerror(errno) << "\n";
+    }
+  }
+
+  //------------------------------------------------------------
+  std::string
+  PhotonLibraryShard::checkShard(ShardInfo_t const& shard,
+                                 std::size_t nOpChannels,
+                                 std::uint32_t flags)
+  {
+    int const fd = ::open(shard.fileName.c_str(), O_RDONLY);
+    if (fd < 0) return std::string{"can't open: "} + std::strerror(errno);
+    FileCloser closer{fd};
+
+    ShardHeader_t header;
+    if (!readAll(fd, &header, sizeof(header), 0)) return "can't read the header";
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) return "not a photon library shard";
+    if (header.version != FormatVersion) {
+      return "format version " + std::to_string(header.version) + " (expected " +
+             std::to_string(FormatVersion) + ")";
+    }
+    if ((header.firstVoxel != shard.firstVoxel) || (header.nVoxels != shard.nVoxels)) {
+      return "has voxels " + std::to_string(header.firstVoxel) + " to " +
+             std::to_string(header.firstVoxel + header.nVoxels - 1) + ", manifest expects " +
+             std::to_string(shard.firstVoxel) + " to " +
+             std::to_string(shard.firstVoxel + shard.nVoxels - 1);
+    }
+    if (header.nOpChannels != nOpChannels) {
+      return "has " + std::to_string(header.nOpChannels) + " channels (expected " +
+             std::to_string(nOpChannels) + ")";
+    }
+    if ((header.flags & flags) != flags) return "lacks the requested reflected light tables";
+
+    std::uint64_t const tableSize = header.nVoxels * header.nOpChannels * sizeof(float);
+    unsigned int const nTables =
+      1U + ((header.flags & FlagReflected) ? 1U : 0U) + ((header.flags & FlagReflectedT0) ? 1U : 0U);
+    struct stat fileStat;
+    if (::fstat(fd, &fileStat) != 0) return std::string{"can't stat: "} + std::strerror(errno);
+    if (std::uint64_t(fileStat.st_size) != HeaderSize + nTables * tableSize) {
+      return "size is " + std::to_string(fileStat.st_size) + " bytes (expected " +
+             std::to_string(HeaderSize + nTables * tableSize) + ")";
+    }
+
+    // content: table after table, in chunks of whole voxels
+    std::size_t const chunkVoxels = std::max<std::size_t>(1U, (1U << 20) / nOpChannels);
+    std::vector<float> buffer(chunkVoxels * nOpChannels);
+    std::uint64_t offset = HeaderSize;
+    for (unsigned int iTable = 0; iTable < nTables; ++iTable) {
+      bool const isTime = (iTable == 2U) || ((iTable == 1U) && !(header.flags & FlagReflected));
+      for (std::size_t voxel = 0; voxel < header.nVoxels; voxel += chunkVoxels) {
+        std::size_t const n = std::min<std::size_t>(chunkVoxels, header.nVoxels - voxel) *
+                              nOpChannels;
+        if (!readAll(fd, buffer.data(), n * sizeof(float), offset)) return "can't read the data";
+        offset += n * sizeof(float);
+        for (std::size_t i = 0; i < n; ++i) {
+          float const value = buffer[i];
+          if (std::isfinite(value) && (isTime || (value >= 0.0f))) continue;
+          std::size_t const badVoxel = header.firstVoxel + voxel + i / nOpChannels;
+          return "invalid value " + std::to_string(value) + " in table " +
+                 std::to_string(iTable) + " at voxel " + std::to_string(badVoxel) +
+                 ", channel " + std::to_string(i % nOpChannels);
+        }
+      }
+    }
+    return {};
+  }
+
+  //------------------------------------------------------------
+  void
+  PhotonLibraryShard::copyShard(ShardInfo_t const& shard,
+                                std::size_t nOpChannels,
+                                float* const tables[3])
+  {
+    int const fd = ::open(shard.fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw cet::exception("PhotonLibraryShard")
+        << "Can't open the photon library shard '" << shard.fileName
+        << "': " << std::strerror(errno) << "\n";
+    }
+    FileCloser closer{fd};
+
+    ShardHeader_t header;
+    if (!readAll(fd, &header, sizeof(header), 0)) {
+      throw cet::exception("PhotonLibraryShard")
+        << "Can't read the header of the photon library shard '" << shard.fileName << "'\n";
+    }
+
+    std::uint64_t const tableSize = std::uint64_t(shard.nVoxels) * nOpChannels * sizeof(float);
+    std::uint32_t const tableFlags[3] = {0U, FlagReflected, FlagReflectedT0};
+    std::uint64_t offset = HeaderSize;
+    for (std::size_t iTable = 0; iTable < 3U; ++iTable) {
+      if (tableFlags[iTable] && !(header.flags & tableFlags[iTable])) continue; // not in shard
+      if (tables[iTable]) {
+        float* const dest = tables[iTable] + shard.firstVoxel * nOpChannels;
+        if (!readAll(fd, dest, tableSize, offset)) {
+          throw cet::exception("PhotonLibraryShard")
+            << "Can't read the table " << iTable << " of the photon library shard '"
+            << shard.fileName << "'\n";
+        }
+      }
+      offset += tableSize;
+    }
+  }
+
+} // namespace phot
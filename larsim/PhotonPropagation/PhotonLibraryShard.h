@@ -0,0 +1,138 @@
+/**
+ * @file   larsim/PhotonPropagation/PhotonLibraryShard.h
+ * @brief  Partial photon libraries produced by distributed library builds.
+ * @see    larsim/PhotonPropagation/PhotonLibraryShard.cxx
+ *
+ * A photon library build is split into shards, each simulating a contiguous
+ * range of voxels. The list of the shards is kept in a manifest, a text file
+ * with one line per shard:
+ *
+ *     # first voxel   number of voxels   shard file
+ *     0               240                shard_00000.bin
+ *     240             240                shard_00001.bin
+ *
+ * (empty lines and lines starting with `#` are ignored; relative file names
+ * are relative to the directory of the manifest). The script
+ * `LibraryBuildTools/MakeShardManifest.sh` writes such a manifest.
+ *
+ * Each shard job writes its part of the library into a binary shard file:
+ * a header of `PhotonLibraryShard::HeaderSize` bytes (`ShardHeader_t`),
+ * followed by the direct visibility table of the shard voxels and optionally
+ * the reflected visibility and arrival time tables, all voxel-major as in
+ * `phot::PhotonLibraryBinary`. The file is written under a temporary name
+ * and renamed at the end, so that a shard file exists only when complete:
+ * a build can be resumed by rerunning the shards whose file does not exist
+ * or does not pass `PhotonLibraryShard::checkShard()`.
+ *
+ * The shards are combined into a binary library with the
+ * `CombinePhotonLibraryShards` module.
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_PHOTONLIBRARYSHARD_H
+#define LARSIM_PHOTONPROPAGATION_PHOTONLIBRARYSHARD_H
+
+#include "larsim/PhotonPropagation/IPhotonLibrary.h"
+
+// C/C++ standard libraries
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace phot {
+
+  /// Utilities to write, check and read photon library shards.
+  class PhotonLibraryShard {
+  public:
+    /// Size of the shard file header.
+    static constexpr std::size_t HeaderSize = 4096U;
+
+    /// Version of the shard format written by this class.
+    static constexpr std::uint32_t FormatVersion = 1U;
+
+    /// Identifier at the beginning of each shard file.
+    static constexpr char Magic[8] = {'L', 'A', 'R', 'P', 'L', 'S', 'H', '\0'};
+
+    /// Flag: the shard includes the reflected visibility table.
+    static constexpr std::uint32_t FlagReflected = 0x1;
+    /// Flag: the shard includes the reflected light arrival time table.
+    static constexpr std::uint32_t FlagReflectedT0 = 0x2;
+
+    /// Header of a shard file.
+    struct ShardHeader_t {
+      char magic[8];             ///< Identifier of the format (`Magic`).
+      std::uint32_t version;     ///< Version of the format.
+      std::uint32_t flags;       ///< Content flags (`FlagReflected`, ...).
+      std::uint64_t firstVoxel;  ///< First voxel of the shard.
+      std::uint64_t nVoxels;     ///< Number of voxels in the shard.
+      std::uint64_t nOpChannels; ///< Number of channels per voxel.
+    }; // ShardHeader_t
+
+    /// One entry of the manifest.
+    struct ShardInfo_t {
+      std::size_t firstVoxel = 0U; ///< First voxel of the shard.
+      std::size_t nVoxels = 0U;    ///< Number of voxels in the shard.
+      std::string fileName;        ///< Path of the shard file.
+    };
+
+    /**
+     * @brief Reads a shard manifest.
+     * @param manifestName path of the manifest file
+     * @return the shards, sorted by first voxel
+     * @throw cet::exception (category: `"PhotonLibraryShard"`) on format error
+     */
+    static std::vector<ShardInfo_t> readManifest(std::string const& manifestName);
+
+    /**
+     * @brief Writes a range of voxels of a library into a shard file.
+     * @param fileName path of the shard file to be (over)written
+     * @param library the library to take the data from
+     * @param firstVoxel first voxel to be written
+     * @param nVoxels number of voxels to be written
+     * @param storeReflected whether to write reflected visibilities
+     * @param storeReflT0 whether to write reflected light arrival times
+     * @throw cet::exception (category: `"PhotonLibraryShard"`) on error
+     *
+     * The data is written into `fileName` with a `.partial` suffix, which is
+     * renamed into `fileName` only after it is complete and synchronised.
+     */
+    static void writeShard(std::string const& fileName,
+                           IPhotonLibrary const& library,
+                           std::size_t firstVoxel,
+                           std::size_t nVoxels,
+                           bool storeReflected = false,
+                           bool storeReflT0 = false);
+
+    /**
+     * @brief Checks a shard file against its manifest entry.
+     * @param shard the manifest entry of the shard
+     * @param nOpChannels expected number of channels per voxel
+     * @param flags expected content flags (`FlagReflected`, ...)
+     * @return an empty string if the shard is valid, the problem otherwise
+     *
+     * Beside the header, the size of the file is checked, and all the
+     * visibilities are required to be finite and not negative, and the
+     * arrival times to be finite.
+     */
+    static std::string checkShard(ShardInfo_t const& shard,
+                                  std::size_t nOpChannels,
+                                  std::uint32_t flags);
+
+    /**
+     * @brief Copies the tables of a shard into the tables of a whole library.
+     * @param shard the manifest entry of the (valid) shard
+     * @param nOpChannels number of channels per voxel
+     * @param tables the three library tables (`nullptr` if not wanted)
+     * @throw cet::exception (category: `"PhotonLibraryShard"`) on read error
+     *
+     * The data of each table is read directly into the destination at the
+     * position of the first voxel of the shard; `tables` can point into a
+     * writable mapping of a `phot::PhotonLibraryBinary` file.
+     */
+    static void copyShard(ShardInfo_t const& shard, std::size_t nOpChannels, float* const tables[3]);
+
+  }; // class PhotonLibraryShard
+
+} // namespace phot
+
+#endif // LARSIM_PHOTONPROPAGATION_PHOTONLIBRARYSHARD_H
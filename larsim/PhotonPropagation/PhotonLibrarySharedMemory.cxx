@@ -0,0 +1,108 @@
+/**
+ * @file   larsim/PhotonPropagation/PhotonLibrarySharedMemory.cxx
+ * @brief  Sharing of a photon library among processes via POSIX shared memory.
+ * @see    larsim/PhotonPropagation/PhotonLibrarySharedMemory.h
+ */
+
+#include "larsim/PhotonPropagation/PhotonLibrarySharedMemory.h"
+#include "larsim/Simulation/PhotonVoxels.h"
+
+#include "cetlib_except/exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// C/C++ standard libraries
+#include <cerrno>
+#include <chrono>
+#include <cstring> // std::memcmp(), std::strerror()
+#include <thread>
+
+namespace {
+
+  /// Returns whether the segment in `fd` holds a completely written library.
+  bool
+  isLibraryComplete(int fd)
+  {
+    // the header (with the magic) is the last thing written
+    char magic[sizeof(phot::PhotonLibraryBinary::Magic)];
+    if (::pread(fd, magic, sizeof(magic), 0) != (ssize_t)sizeof(magic)) return false;
+    return std::memcmp(magic, phot::PhotonLibraryBinary::Magic, sizeof(magic)) == 0;
+  }
+
+} // local namespace
+
+namespace phot {
+
+  std::unique_ptr<PhotonLibraryBinary>
+  AttachSharedPhotonLibrary(std::string const& segmentName,
+                            std::function<std::unique_ptr<IPhotonLibrary>()> const& loadLibrary,
+                            sim::PhotonVoxelDef const& voxelDef,
+                            bool storeReflected,
+                            bool storeReflT0,
+                            unsigned int timeout /* = 600U */)
+  {
+    // POSIX wants shared memory object names to start with a slash
+    std::string const name = (segmentName.front() == '/') ? segmentName : "/" + segmentName;
+    std::string const desc = "shared memory segment '" + name + "'";
+
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd >= 0) {
+      // we are the first ones: load and publish
+      mf::LogInfo("PhotonLibrarySharedMemory")
+        << "Publishing photon library into " << desc << " for the other processes on this node";
+      try {
+        std::unique_ptr<IPhotonLibrary> lib = loadLibrary();
+        PhotonLibraryBinary::WriteLibrary(fd, desc, *lib, &voxelDef, storeReflected, storeReflT0);
+      }
+      catch (...) {
+        // do not leave behind a segment which will never be completed
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        throw;
+      }
+    }
+    else if (errno == EEXIST) {
+      fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+      if (fd < 0) {
+        throw cet::exception("PhotonLibrarySharedMemory")
+          << "Can't attach to " << desc << ": " << std::strerror(errno) << "\n";
+      }
+
+      // another process may still be writing the library
+      auto const start = std::chrono::steady_clock::now();
+      while (!isLibraryComplete(fd)) {
+        if (std::chrono::steady_clock::now() - start > std::chrono::seconds(timeout)) {
+          ::close(fd);
+          throw cet::exception("PhotonLibrarySharedMemory")
+            << "The photon library in " << desc << " was not completed within " << timeout
+            << " seconds. If the publishing process died, remove the stale segment"
+               " (e.g. `rm /dev/shm"
+            << name << "`).\n";
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+      }
+      mf::LogInfo("PhotonLibrarySharedMemory")
+        << "Attaching to the photon library published in " << desc;
+    }
+    else {
+      throw cet::exception("PhotonLibrarySharedMemory")
+        << "Can't create " << desc << ": " << std::strerror(errno) << "\n";
+    }
+
+    std::unique_ptr<PhotonLibraryBinary> sharedLib;
+    try {
+      sharedLib = std::make_unique<PhotonLibraryBinary>(fd, desc);
+    }
+    catch (...) {
+      ::close(fd);
+      throw;
+    }
+    ::close(fd); // the mapping keeps its own reference to the segment
+    return sharedLib;
+  } // AttachSharedPhotonLibrary()
+
+} // namespace phot
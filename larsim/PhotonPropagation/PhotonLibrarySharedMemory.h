@@ -0,0 +1,57 @@
+/**
+ * @file   larsim/PhotonPropagation/PhotonLibrarySharedMemory.h
+ * @brief  Sharing of a photon library among processes via POSIX shared memory.
+ * @see    larsim/PhotonPropagation/PhotonLibrarySharedMemory.cxx
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_PHOTONLIBRARYSHAREDMEMORY_H
+#define LARSIM_PHOTONPROPAGATION_PHOTONLIBRARYSHAREDMEMORY_H
+
+#include "larsim/PhotonPropagation/IPhotonLibrary.h"
+#include "larsim/PhotonPropagation/PhotonLibraryBinary.h"
+
+// C/C++ standard libraries
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace sim {
+  class PhotonVoxelDef;
+}
+
+namespace phot {
+
+  /**
+   * @brief Returns a library from the named POSIX shared memory segment.
+   * @param segmentName name of the shared memory object (e.g. `"dune_lib_v3"`)
+   * @param loadLibrary function loading the library, if it's not shared yet
+   * @param voxelDef voxel metadata to be published with the library
+   * @param storeReflected whether to publish reflected visibilities
+   * @param storeReflT0 whether to publish reflected light arrival times
+   * @param timeout how long to wait for another process to publish [s]
+   * @return a library mapped read-only from the shared memory segment
+   * @throw cet::exception (category: `"PhotonLibrarySharedMemory"`) on error
+   *
+   * The first process asking for `segmentName` creates the segment, loads the
+   * library with `loadLibrary()`, copies its tables into the segment (in the
+   * `PhotonLibraryBinary` format) and then releases its own copy.
+   * Every other process finding the segment already present waits for it to
+   * be complete and maps it read-only, so that on each node the library is
+   * held in memory only once.
+   *
+   * The segment outlives the processes (it lives on until the node is
+   * rebooted or the segment is removed, e.g. `rm /dev/shm/<segmentName>`),
+   * so that following jobs on the same node do not need to load the library
+   * again. Different libraries must be given different segment names.
+   */
+  std::unique_ptr<PhotonLibraryBinary> AttachSharedPhotonLibrary(
+    std::string const& segmentName,
+    std::function<std::unique_ptr<IPhotonLibrary>()> const& loadLibrary,
+    sim::PhotonVoxelDef const& voxelDef,
+    bool storeReflected,
+    bool storeReflT0,
+    unsigned int timeout = 600U);
+
+} // namespace phot
+
+#endif // LARSIM_PHOTONPROPAGATION_PHOTONLIBRARYSHAREDMEMORY_H
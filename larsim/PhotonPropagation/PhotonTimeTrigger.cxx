@@ -0,0 +1,59 @@
+/**
+ * @file   larsim/PhotonPropagation/PhotonTimeTrigger.cxx
+ * @brief  Running photon count in time windows, for an early trigger decision.
+ * @see    larsim/PhotonPropagation/PhotonTimeTrigger.h
+ */
+
+#include "larsim/PhotonPropagation/PhotonTimeTrigger.h"
+
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+
+// C/C++ standard libraries
+#include <algorithm> // std::max()
+#include <cstddef>   // std::size_t
+
+namespace phot {
+
+  //------------------------------------------------------------
+  PhotonTimeTrigger::PhotonTimeTrigger(fhicl::ParameterSet const& pset)
+    : fWindows(pset.get<std::vector<std::pair<int, int>>>("TimeWindows"))
+    , fMinTotalPhotons(pset.get<int>("MinTotalPhotons"))
+    , fUseReflected(pset.get<bool>("UseReflectedPhotons", false))
+    , fCounts(fWindows.size(), 0)
+  {
+    if (fWindows.empty()) {
+      throw cet::exception("PhotonTimeTrigger") << "No trigger time window configured.\n";
+    }
+    fLatestTime = fWindows.front().second;
+    for (auto const& [start, end] : fWindows) {
+      if (start > end) {
+        throw cet::exception("PhotonTimeTrigger")
+          << "Bad time window [" << start << "," << end << "]: it ends before it starts.\n";
+      }
+      fLatestTime = std::max(fLatestTime, end);
+    }
+  }
+
+  //------------------------------------------------------------
+  void
+  PhotonTimeTrigger::reset()
+  {
+    fCounts.assign(fWindows.size(), 0);
+    fAccepted = false;
+  }
+
+  //------------------------------------------------------------
+  bool
+  PhotonTimeTrigger::add(int time, int nPhotons /* = 1 */)
+  {
+    if (fAccepted) return true;
+    for (std::size_t i = 0; i < fWindows.size(); ++i) {
+      if ((time < fWindows[i].first) || (time > fWindows[i].second)) continue;
+      fCounts[i] += nPhotons;
+      if (fCounts[i] >= fMinTotalPhotons) return fAccepted = true;
+    }
+    return false;
+  }
+
+} // namespace phot
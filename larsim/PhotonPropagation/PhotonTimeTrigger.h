@@ -0,0 +1,129 @@
+/**
+ * @file   larsim/PhotonPropagation/PhotonTimeTrigger.h
+ * @brief  Running photon count in time windows, for an early trigger decision.
+ * @see    larsim/PhotonPropagation/PhotonTimeTrigger.cxx
+ *
+ * The fast optical simulations (`PDFastSimPAR`, `PDFastSimPVS`) are often
+ * followed by `FilterSimPhotonLiteTime`, which accepts the events with at
+ * least a minimum number of detected photons in any of a set of time windows.
+ * When only that decision matters, the producers can count the photons as
+ * they simulate the deposits and stop as soon as the decision is known: the
+ * trigger keeps the count, with the same configuration and the same logic as
+ * the filter, so that the filter takes the same decision on the photons
+ * stored by the producer.
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_PHOTONTIMETRIGGER_H
+#define LARSIM_PHOTONPROPAGATION_PHOTONTIMETRIGGER_H
+
+// C/C++ standard libraries
+#include <utility> // std::pair
+#include <vector>
+
+namespace fhicl {
+  class ParameterSet;
+}
+
+namespace phot {
+
+  /**
+   * @brief Counts photons in time windows, until one reaches a threshold.
+   *
+   * Configuration (the parameters of `FilterSimPhotonLiteTime`):
+   * * `TimeWindows`: list of `[ start, end ]` windows (inclusive) [tick]
+   * * `MinTotalPhotons`: photons an event needs in a window to be accepted
+   * * `UseReflectedPhotons` (default: `false`): whether the reflected photons
+   *   count
+   *
+   * A photon arriving in a window with the number of photons already in it
+   * reaching `MinTotalPhotons` makes the event accepted.
+   */
+  class PhotonTimeTrigger {
+  public:
+    /// Creates a trigger which never decides (`enabled()` is false).
+    PhotonTimeTrigger() = default;
+
+    /**
+     * @brief Creates a trigger with the specified configuration.
+     * @throw cet::exception (category: `"PhotonTimeTrigger"`) if a window ends
+     *        before it starts
+     */
+    explicit PhotonTimeTrigger(fhicl::ParameterSet const& pset);
+
+    /// Returns whether the trigger is configured.
+    bool
+    enabled() const
+    {
+      return !fWindows.empty();
+    }
+
+    /// Returns whether the reflected photons are counted.
+    bool
+    useReflected() const
+    {
+      return fUseReflected;
+    }
+
+    /// Returns the end of the latest window [tick].
+    int
+    latestTime() const
+    {
+      return fLatestTime;
+    }
+
+    /// Returns whether photons emitted from time `startTime` [tick] on may
+    /// still arrive in a window (arrival ticks are truncated times).
+    bool
+    mayCount(double startTime) const
+    {
+      return startTime < fLatestTime + 1.;
+    }
+
+    /// Returns whether the event has been accepted.
+    bool
+    accepted() const
+    {
+      return fAccepted;
+    }
+
+    /// Forgets all the photons, for a new event.
+    void reset();
+
+    /// Counts `nPhotons` photons arriving at `time`; returns `accepted()`.
+    bool add(int time, int nPhotons = 1);
+
+    /**
+     * @brief Counts the photons of a simulated deposit; returns `accepted()`.
+     * @tparam Deposit type with the arrival `times` of the photons and their
+     *         `channels` (with `reflected` flag and `begin`/`end` in `times`)
+     */
+    template <typename Deposit>
+    bool addDeposit(Deposit const& dep);
+
+  private:
+    std::vector<std::pair<int, int>> fWindows; ///< Time windows [tick].
+    int fMinTotalPhotons = 0;                  ///< Photons needed in a window.
+    bool fUseReflected = false;                ///< Whether reflected photons count.
+    int fLatestTime = 0;                       ///< End of the latest window.
+
+    std::vector<long long> fCounts; ///< Photons in each window.
+    bool fAccepted = false;         ///< Whether a window reached the threshold.
+
+  }; // class PhotonTimeTrigger
+
+  //----------------------------------------------------------------------------
+  template <typename Deposit>
+  bool
+  PhotonTimeTrigger::addDeposit(Deposit const& dep)
+  {
+    for (auto const& ch : dep.channels) {
+      if (ch.reflected && !fUseReflected) continue;
+      for (auto i = ch.begin; i != ch.end; ++i)
+        if (add(dep.times[i])) return true;
+    }
+    return fAccepted;
+  }
+
+} // namespace phot
+
+#endif // LARSIM_PHOTONPROPAGATION_PHOTONTIMETRIGGER_H
@@ -24,17 +24,29 @@
 #include "TF1.h"
 
 // C/C++ standard libraries
+#include <future>
+#include <iterator> // std::size()
 #include <memory> // std::unique_ptr<>
+#include <vector>
 
 ///General LArSoft Utilities
 namespace phot {
 
+  class PhotonLibraryBinary;
+  enum class StaticMappingType_t; // StaticPhotonMappingTransformations.h
+
   class PhotonVisibilityService {
 
     /// Type of optical library index.
     using LibraryIndex_t = phot::IPhotonMappingTransformations::LibraryIndex_t;
 
   public:
+    /// Light production in a voxel, recorded by library build jobs.
+    struct LightProd_t {
+      int voxel; ///< Library voxel the light was produced in.
+      double N;  ///< Number of produced photons.
+    };
+
     ~PhotonVisibilityService();
     PhotonVisibilityService(fhicl::ParameterSet const& pset);
 
@@ -55,6 +67,14 @@ namespace phot {
       return SolidAngleFactorImpl(geo::vect::toPoint(p), OpDet);
     }
 
+    /// Returns the ID of the library voxel including `p` (`-1` if none).
+    template <typename Point>
+    int
+    LibraryVoxelID(Point const& p) const
+    {
+      return VoxelAt(geo::vect::toPoint(p));
+    }
+
     template <typename Point>
     bool
     HasVisibility(Point const& p, bool wantReflected = false) const
@@ -76,12 +96,54 @@ namespace phot {
       return doGetAllVisibilities(geo::vect::toPoint(p), wantReflected);
     }
 
+    /**
+     * @brief Returns the visibilities of many points at once.
+     * @tparam Points a sequence of points (e.g. `std::vector<geo::Point_t>`)
+     * @param points the points to query
+     * @param visibilities (output) visibilities of all points, point-major
+     * @param wantReflected whether to return reflected light visibilities
+     * @return for each point, whether its visibilities are available
+     *
+     * The visibility of the point `i` from channel `c` is stored in
+     * `visibilities[i * NOpChannels() + c]`; the rows of points with no
+     * visibility are filled with zeroes.
+     * The points are internally visited by voxel, so that each library entry
+     * is retrieved only once per call.
+     */
+    template <typename Points>
+    std::vector<bool>
+    GetAllVisibilitiesBatch(Points const& points,
+                            std::vector<float>& visibilities,
+                            bool wantReflected = false) const
+    {
+      std::vector<geo::Point_t> locations;
+      locations.reserve(std::size(points));
+      for (auto const& p : points)
+        locations.push_back(geo::vect::toPoint(p));
+      return doGetAllVisibilitiesBatch(locations, visibilities, wantReflected);
+    }
+
     void LoadLibrary() const;
     void StoreLibrary();
 
     void StoreLightProd(int VoxID, double N);
     void RetrieveLightProd(int& VoxID, double& N) const;
 
+    /**
+     * @brief Stores the light production of many voxels in the same event.
+     *
+     * Batched light sources shoot from each voxel in its own `simb::MCTruth`,
+     * in the order of `prods`. The single production of `RetrieveLightProd()`
+     * is then not available.
+     */
+    void StoreLightProd(std::vector<LightProd_t> const& prods);
+    /// Returns the light production in the current event, one entry per voxel.
+    std::vector<LightProd_t> const&
+    GetLightProds() const
+    {
+      return fLightProds;
+    }
+
     void SetLibraryEntry(int VoxID, OpDetID_t libOpChannel, float N, bool wantReflected = false);
     float GetLibraryEntry(int VoxID, OpDetID_t libOpChannel, bool wantReflected = false) const;
     bool HasLibraryEntries(int VoxID, bool wantReflected = false) const;
@@ -116,6 +178,16 @@ namespace phot {
     void SetLibraryTimingTF1Entry(int VoxID, int OpChannel, TF1 const& func);
     phot::IPhotonLibrary::Functions_t GetLibraryTimingTF1Entries(int VoxID) const;
 
+    /// Returns the propagation time histograms of all optical detectors from
+    /// `p` (see `UseTimingHistograms()`).
+    template <typename Point>
+    MappedTimeHistograms_t
+    GetTimingHistograms(Point const& p) const
+    {
+      return doGetTimingHistograms(geo::vect::toPoint(p));
+    }
+    phot::IPhotonLibrary::TimeHistograms_t GetLibraryTimingHistogramEntries(int VoxID) const;
+
     void SetDirectLightPropFunctions(TF1 const* functions[8],
                                      double& d_break,
                                      double& d_max,
@@ -191,6 +263,13 @@ namespace phot {
     {
       return fParPropTime_formula;
     }
+    /// Returns whether the parametrized propagation times are sampled from
+    /// histograms (`TimingHistogramBins`) instead of functions.
+    bool
+    UseTimingHistograms() const
+    {
+      return fParPropTime && (fTimingHistogramBins > 0U);
+    }
 
     bool
     IncludePropTime() const
@@ -223,6 +302,9 @@ namespace phot {
   private:
     int fCurrentVoxel;
     double fCurrentValue;
+    std::vector<LightProd_t> fLightProds; ///< Light production of the current event.
+    int fFirstProducedVoxel = -1; ///< Lowest voxel light was produced in (`-1`: none).
+    int fLastProducedVoxel = -1;  ///< Highest voxel light was produced in.
     // for c2: fCurrentReflValue is unused
     //double fCurrentReflValue;
 
@@ -237,6 +319,19 @@ namespace phot {
     bool fDoNotLoadLibrary;
     bool fParameterization;
     bool fHybrid;
+    bool fBinaryLibrary;
+    bool fAdaptiveLibrary; ///< Whether the library file holds an adaptive library.
+    std::string fSharedMemoryName; ///< Name of the shared library segment (empty: not shared).
+    std::string fLibraryShardFile; ///< Shard file written by a library build job (empty: none).
+    std::string fLibraryEncoding;  ///< Storage of library values (`float`, `log16`, `log8`).
+    /// Library region to be loaded (`LoadRegionMin`, `LoadRegionMax`, in
+    /// library coordinates; empty: all); the other voxels have no visibility.
+    std::vector<double> fLoadRegionMin, fLoadRegionMax;
+    /// Library channels to be loaded (`LoadChannels`; empty: all).
+    std::vector<unsigned int> fLoadChannels;
+    /// Whether to read the library in a separate thread while the job is set
+    /// up (ROOT thread safety, enabled by _art_, is required).
+    bool fLoadInBackground;
     bool fStoreReflected;
     bool fStoreReflT0;
     bool fIncludePropTime;
@@ -248,9 +343,18 @@ namespace phot {
     size_t fParPropTime_npar;
     std::string fParPropTime_formula;
     int fParPropTime_MaxRange;
+    /// Bins of the propagation time histograms (`0`: the functions are used).
+    std::size_t fTimingHistogramBins = 0U;
+    std::size_t fTimingHistogramClasses = 16U; ///< Distance classes of the histograms.
+    std::string fTimingHistogramCache; ///< File caching the histograms (empty: none).
     bool fInterpolate;
     bool fReflectOverZeroX;
 
+    /// Mapped visibility rows cached per thread (`VisibilityRowCacheSize`,
+    /// `0`: no cache); a row returned by `GetAllVisibilities()` stays valid
+    /// until this many other rows are requested in the same thread.
+    std::size_t fVisibilityRowCacheSize = 0U;
+
     TF1* fparslogNorm = nullptr;
     TF1* fparslogNorm_far = nullptr;
     TF1* fparsMPV = nullptr;
@@ -312,25 +416,50 @@ namespace phot {
 
     std::string fLibraryFile;
     mutable IPhotonLibrary* fTheLibrary;
+    /// Library being read in the background (`LoadLibraryInBackground`).
+    mutable std::future<std::unique_ptr<IPhotonLibrary>> fPendingLibrary;
     sim::PhotonVoxelDef fVoxelDef;
 
+    /// Unique identifier of the loaded library, for the visibility row cache.
+    mutable unsigned long long fLibraryGeneration = 0ULL;
+
     /// Mapping of detector space into library space.
     std::unique_ptr<phot::IPhotonMappingTransformations> fMapping;
 
+    /// Trivial mapping, for visibility rows already in optical detector space.
+    IPhotonMappingTransformations::OpDetToLibraryIndexMap fIdentityOpDetMap;
+
+    /// Concrete type of `fMapping`, for calls without virtual dispatch.
+    StaticMappingType_t fMappingType{};
+
+    /// Calls `f(mapping)` with `*fMapping` cast to its concrete type if known.
+    template <typename F>
+    decltype(auto) withStaticMapping(F&& f) const;
+
     geo::Point_t LibLocation(geo::Point_t const& p) const;
 
+    /// Returns the full path of the library file (throws if not found).
+    std::string FindLibraryFile() const;
+
+    /// Starts reading the library file in a separate thread.
+    void StartLibraryLoad();
+
+    /// Loads the library in the specified file, in ROOT, binary or adaptive format.
+    std::unique_ptr<IPhotonLibrary> LoadLibraryFile(std::string const& LibraryFileWithPath) const;
+
+    /// Reports the memory of the library and of the timing tables to
+    /// `sim::ProductFootprintService`, if configured.
+    void ReportFootprints() const;
+
+    /// Throws an exception if `lib` is not compatible with the configuration.
+    void CheckBinaryLibrary(PhotonLibraryBinary const& lib, std::string const& source) const;
+
     int
     VoxelAt(geo::Point_t const& p) const
     {
       return fVoxelDef.GetVoxelID(LibLocation(p));
     }
 
-    // same as `doGetVisibility()` but the channel number refers to the library
-    // ID rather than to the actual optical detector ID.
-    float doGetVisibilityOfOpLib(geo::Point_t const& p,
-                                 LibraryIndex_t libIndex,
-                                 bool wantReflected = false) const;
-
     // --- BEGIN Implementation functions --------------------------------------
     /// @name Implementation functions
     /// @{
@@ -345,14 +474,40 @@ namespace phot {
                           unsigned int OpChannel,
                           bool wantReflected = false) const;
 
+    /// `doGetVisibility()` with the transformations of `mapping`: only the
+    /// requested channel is mapped, and only its library entries are read.
+    template <typename Mapping>
+    float doGetVisibilityWith(Mapping const& mapping,
+                              geo::Point_t const& p,
+                              unsigned int OpChannel,
+                              bool wantReflected) const;
+
     MappedCounts_t doGetAllVisibilities(geo::Point_t const& p, bool wantReflected = false) const;
 
+    /// `doGetAllVisibilities()` with the transformations of `mapping`.
+    template <typename Mapping>
+    MappedCounts_t doGetAllVisibilitiesWith(Mapping const& mapping,
+                                            geo::Point_t const& p,
+                                            bool wantReflected) const;
+
+    /// `doGetAllVisibilities()` for voxel `VoxID`, through the row cache.
+    MappedCounts_t doGetCachedVisibilities(
+      IPhotonMappingTransformations::OpDetToLibraryIndexMap const& libIndices,
+      int VoxID,
+      bool wantReflected) const;
+
+    std::vector<bool> doGetAllVisibilitiesBatch(std::vector<geo::Point_t> const& points,
+                                                std::vector<float>& visibilities,
+                                                bool wantReflected = false) const;
+
     MappedT0s_t doGetReflT0s(geo::Point_t const& p) const;
 
     MappedParams_t doGetTimingPar(geo::Point_t const& p) const;
 
     MappedFunctions_t doGetTimingTF1(geo::Point_t const& p) const;
 
+    MappedTimeHistograms_t doGetTimingHistograms(geo::Point_t const& p) const;
+
     /// @}
     // --- END Implementation functions ----------------------------------------
 
@@ -26,14 +26,23 @@
 #include "larcore/Geometry/Geometry.h"
 #include "larcorealg/Geometry/OpDetGeo.h"
 #include "larsim/PhotonPropagation/PhotonLibrary.h"
+#include "larsim/PhotonPropagation/PhotonLibraryAdaptive.h"
 #include "larsim/PhotonPropagation/PhotonVisibilityService.h"
 #include "larsim/Simulation/PhotonVoxels.h"
 
+#include "larsim/PhotonPropagation/PhotonLibraryBinary.h"
 #include "larsim/PhotonPropagation/PhotonLibraryHybrid.h"
+#include "larsim/PhotonPropagation/PhotonLibraryShard.h"
+#include "larsim/PhotonPropagation/PhotonLibraryQuantized.h"
+#include "larsim/PhotonPropagation/PhotonLibrarySharedMemory.h"
+#include "larsim/PhotonPropagation/VisibilityInterpolation.h"
+#include "larsim/PhotonPropagation/LibraryMappingTools/StaticPhotonMappingTransformations.h"
+#include "larsim/Simulation/ProductFootprintService.h"
 
 // framework libraries
 #include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art/Framework/Services/Registry/ServiceRegistry.h"
 #include "art/Utilities/make_tool.h"
 #include "art_root_io/TFileService.h"
 #include "canvas/Utilities/Exception.h"
@@ -43,6 +52,74 @@
 #include "TF1.h"
 
 // C/C++ standard libraries
+#include <algorithm> // std::sort(), std::fill()
+#include <array>
+#include <atomic>
+#include <future> // std::async()
+#include <numeric>   // std::iota()
+#include <type_traits> // std::decay_t<>
+#include <utility>   // std::pair<>
+
+namespace {
+
+  /// Memory taken by a (possibly nested) table of parameters [bytes].
+  std::size_t
+  tableBytes(std::vector<double> const& table)
+  {
+    return table.size() * sizeof(double);
+  }
+
+  template <typename T>
+  std::size_t
+  tableBytes(std::vector<std::vector<T>> const& table)
+  {
+    std::size_t bytes = table.size() * sizeof(std::vector<T>);
+    for (auto const& row : table)
+      bytes += tableBytes(row);
+    return bytes;
+  }
+
+  /// Source of the unique identifiers of the loaded libraries.
+  std::atomic<unsigned long long> gLibraryGeneration{0ULL};
+
+  /// Visibility rows recently requested in this thread, already mapped into
+  /// optical detector space.
+  struct VisibilityRowCache {
+    struct Row {
+      unsigned long long generation = 0ULL; ///< Library the row comes from.
+      int voxel = -1;
+      bool reflected = false;
+      /// Mapping the row was built with (it may depend on the location).
+      phot::IPhotonMappingTransformations::OpDetToLibraryIndexMap const* mapping = nullptr;
+      bool valid = false;        ///< Whether the library has data for the voxel.
+      std::vector<float> values; ///< Visibility for each optical detector.
+      unsigned long long lastUse = 0ULL;
+    };
+
+    std::vector<Row> rows;
+    unsigned long long clock = 0ULL;
+  };
+
+  thread_local VisibilityRowCache gVisibilityRowCache;
+
+  /// Returns which voxels of `voxelDef` overlap the box `lower` to `upper`.
+  std::vector<bool>
+  voxelsInRegion(sim::PhotonVoxelDef const& voxelDef,
+                 std::vector<double> const& lower,
+                 std::vector<double> const& upper)
+  {
+    std::vector<bool> selected(voxelDef.GetNVoxels(), false);
+    for (unsigned int ID = 0; ID < voxelDef.GetNVoxels(); ++ID) {
+      sim::PhotonVoxel const voxel = voxelDef.GetPhotonVoxel(ID);
+      geo::Point_t const& low = voxel.GetLowerCorner();
+      geo::Point_t const& high = voxel.GetUpperCorner();
+      selected[ID] = (low.X() < upper[0]) && (high.X() > lower[0]) && (low.Y() < upper[1]) &&
+                     (high.Y() > lower[1]) && (low.Z() < upper[2]) && (high.Z() > lower[2]);
+    }
+    return selected;
+  }
+
+} // local namespace
 
 namespace phot {
 
@@ -61,6 +138,8 @@ namespace phot {
     delete fparsWidth_refl;
     delete fparsCte_refl;
     delete fparsSlope_refl;
+    // the background load uses this service: it must be over before destruction
+    if (fPendingLibrary.valid()) fPendingLibrary.wait();
     delete fTheLibrary;
   }
 
@@ -84,6 +163,9 @@ namespace phot {
     , fDoNotLoadLibrary(false)
     , fParameterization(false)
     , fHybrid(false)
+    , fBinaryLibrary(false)
+    , fAdaptiveLibrary(false)
+    , fLoadInBackground(false)
     , fStoreReflected(false)
     , fStoreReflT0(false)
     , fIncludePropTime(false)
@@ -139,7 +221,45 @@ namespace phot {
     fMapping = art::make_tool<phot::IPhotonMappingTransformations>(
       pset.get<fhicl::ParameterSet>("Mapping", mapDefaultSet));
 
+    fMappingType = staticMappingTypeOf(*fMapping);
+
+    fIdentityOpDetMap.resize(fMapping->opDetMappingSize());
+    std::iota(fIdentityOpDetMap.begin(), fIdentityOpDetMap.end(), LibraryIndex_t{0});
+
     mf::LogInfo("PhotonVisibilityService") << "PhotonVisbilityService initializing" << std::endl;
+
+    // the library is read while the rest of the job (geometry, Geant4...) is set up
+    if (fLoadInBackground && !fLibraryBuildJob && !fDoNotLoadLibrary && !fParameterization)
+      StartLibraryLoad();
+  }
+
+  //--------------------------------------------------------------------
+  std::string
+  PhotonVisibilityService::FindLibraryFile() const
+  {
+    std::string LibraryFileWithPath;
+    cet::search_path sp("FW_SEARCH_PATH");
+
+    if (!sp.find_file(fLibraryFile, LibraryFileWithPath))
+      throw cet::exception("PhotonVisibilityService")
+        << "Unable to find photon library in " << sp.to_string() << "\n";
+    return LibraryFileWithPath;
+  }
+
+  //--------------------------------------------------------------------
+  void
+  PhotonVisibilityService::StartLibraryLoad()
+  {
+    std::string const LibraryFileWithPath = FindLibraryFile();
+
+    mf::LogInfo("PhotonVisibilityService")
+      << "PhotonVisibilityService loading photon library from file " << LibraryFileWithPath
+      << " for " << GetVoxelDef().GetNVoxels() << " voxels in the background.";
+
+    // any exception is rethrown by `LoadLibrary()`, on the first use
+    fPendingLibrary = std::async(std::launch::async, [this, LibraryFileWithPath]() {
+      return LoadLibraryFile(LibraryFileWithPath);
+    });
   }
 
   //--------------------------------------------------------------------
@@ -150,13 +270,13 @@ namespace phot {
 
     if (fTheLibrary == 0) {
 
-      if ((!fLibraryBuildJob) && (!fDoNotLoadLibrary)) {
-        std::string LibraryFileWithPath;
-        cet::search_path sp("FW_SEARCH_PATH");
-
-        if (!sp.find_file(fLibraryFile, LibraryFileWithPath))
-          throw cet::exception("PhotonVisibilityService")
-            << "Unable to find photon library in " << sp.to_string() << "\n";
+      if (fPendingLibrary.valid()) {
+        // started at construction: waits for it to be complete
+        fTheLibrary = fPendingLibrary.get().release();
+        mf::LogInfo("PhotonVisibilityService") << "Photon library loaded in the background.";
+      }
+      else if ((!fLibraryBuildJob) && (!fDoNotLoadLibrary)) {
+        std::string const LibraryFileWithPath = FindLibraryFile();
 
         if (!fParameterization) {
           art::ServiceHandle<geo::Geometry const> geom;
@@ -169,34 +289,19 @@ namespace phot {
           if (fHybrid) {
             fTheLibrary = new PhotonLibraryHybrid(LibraryFileWithPath, GetVoxelDef());
           }
+          else if (!fSharedMemoryName.empty()) {
+            // the first process on the node loads the library and publishes it
+            auto lib = AttachSharedPhotonLibrary(
+              fSharedMemoryName,
+              [this, &LibraryFileWithPath]() { return LoadLibraryFile(LibraryFileWithPath); },
+              GetVoxelDef(),
+              fStoreReflected,
+              fStoreReflT0);
+            CheckBinaryLibrary(*lib, "shared memory segment '" + fSharedMemoryName + "'");
+            fTheLibrary = lib.release();
+          }
           else {
-            PhotonLibrary* lib = new PhotonLibrary;
-            fTheLibrary = lib;
-
-            size_t NVoxels = GetVoxelDef().GetNVoxels();
-            lib->LoadLibraryFromFile(LibraryFileWithPath,
-                                     NVoxels,
-                                     fStoreReflected,
-                                     fStoreReflT0,
-                                     fParPropTime_npar,
-                                     fParPropTime_MaxRange);
-
-            // if the library does not have metadata, we supply some;
-            // otherwise we check that it's compatible with the configured one
-            // (and shrug if it's not); overriding configured metadata
-            // from the one in the library is currently not supported
-            if (!lib->hasVoxelDef())
-              lib->SetVoxelDef(GetVoxelDef());
-            else if (GetVoxelDef() != lib->GetVoxelDef()) {
-              // this might become a fatal error in the future if some protocol
-              // is imposed... it may also be possible to check only the size
-              // rather than the coordinates, which may allow for translations
-              // of the geometry volumes in world space.
-              mf::LogWarning("PhotonVisbilityService")
-                << "Photon library reports the geometry:\n"
-                << lib->GetVoxelDef() << "while PhotonVisbilityService is configured with:\n"
-                << GetVoxelDef();
-            } // if metadata
+            fTheLibrary = LoadLibraryFile(LibraryFileWithPath).release();
           }
         }
       }
@@ -230,6 +335,141 @@ namespace phot {
         lib->CreateEmptyLibrary(NVoxels, NOpDets, fStoreReflected, fStoreReflT0, fParPropTime_npar);
         lib->SetVoxelDef(GetVoxelDef());
       }
+
+      // rows cached from any previous library are now stale
+      fLibraryGeneration = ++gLibraryGeneration;
+      ReportFootprints();
+    }
+  }
+
+  //--------------------------------------------------------------------
+  void
+  PhotonVisibilityService::ReportFootprints() const
+  {
+    if (!art::ServiceRegistry::isAvailable<sim::ProductFootprintService>()) return;
+    art::ServiceHandle<sim::ProductFootprintService> footprints;
+    if (fTheLibrary)
+      footprints->recordServiceFootprint(
+        "PhotonVisibilityService", "library", fTheLibrary->MemoryFootprint());
+    if (fIncludePropTime) {
+      std::size_t const timing =
+        tableBytes(fDistances_landau) + tableBytes(fNorm_over_entries) + tableBytes(fMpv) +
+        tableBytes(fWidth) + tableBytes(fDistances_exp) + tableBytes(fSlope) +
+        tableBytes(fExpo_over_Landau_norm) + tableBytes(fDistances_refl) +
+        tableBytes(fDistances_radial_refl) + tableBytes(fCut_off) + tableBytes(fTau);
+      footprints->recordServiceFootprint("PhotonVisibilityService", "timing tables", timing);
+    }
+  }
+
+  //--------------------------------------------------------------------
+  std::unique_ptr<IPhotonLibrary>
+  PhotonVisibilityService::LoadLibraryFile(std::string const& LibraryFileWithPath) const
+  {
+    if (fBinaryLibrary) {
+      auto lib = std::make_unique<PhotonLibraryBinary>(LibraryFileWithPath);
+      CheckBinaryLibrary(*lib, "'" + LibraryFileWithPath + "'");
+      return lib;
+    }
+
+    if (fAdaptiveLibrary) {
+      auto lib = std::make_unique<PhotonLibraryAdaptive>(LibraryFileWithPath);
+      // the adaptive library answers for the fine voxels of its own definition
+      if (lib->NVoxels() != (int)GetVoxelDef().GetNVoxels()) {
+        throw cet::exception("PhotonVisibilityService")
+          << "Adaptive photon library '" << LibraryFileWithPath << "' has " << lib->NVoxels()
+          << " voxels, while PhotonVisibilityService is configured with "
+          << GetVoxelDef().GetNVoxels() << ".\n";
+      }
+      if ((fStoreReflected && !lib->hasReflected()) ||
+          (fStoreReflT0 && !lib->hasReflectedT0())) {
+        throw cet::exception("PhotonVisibilityService")
+          << "Adaptive photon library '" << LibraryFileWithPath
+          << "' lacks the reflected light information requested in the configuration.\n";
+      }
+      if (GetVoxelDef() != lib->GetVoxelDef()) {
+        mf::LogWarning("PhotonVisbilityService")
+          << "Photon library reports the geometry:\n"
+          << lib->GetVoxelDef() << "while PhotonVisbilityService is configured with:\n"
+          << GetVoxelDef();
+      }
+      return lib;
+    }
+
+    auto lib = std::make_unique<PhotonLibrary>();
+
+    size_t NVoxels = GetVoxelDef().GetNVoxels();
+
+    // only the requested part of the library is read
+    PhotonLibrary::LoadSelection selection;
+    if (!fLoadRegionMin.empty())
+      selection.voxels = voxelsInRegion(GetVoxelDef(), fLoadRegionMin, fLoadRegionMax);
+    for (unsigned int channel : fLoadChannels) {
+      if (channel >= selection.channels.size()) selection.channels.resize(channel + 1, false);
+      selection.channels[channel] = true;
+    }
+
+    lib->LoadLibraryFromFile(LibraryFileWithPath,
+                             NVoxels,
+                             fStoreReflected,
+                             fStoreReflT0,
+                             fParPropTime_npar,
+                             fParPropTime_MaxRange,
+                             selection);
+
+    // if the library does not have metadata, we supply some;
+    // otherwise we check that it's compatible with the configured one
+    // (and shrug if it's not); overriding configured metadata
+    // from the one in the library is currently not supported
+    if (!lib->hasVoxelDef())
+      lib->SetVoxelDef(GetVoxelDef());
+    else if (GetVoxelDef() != lib->GetVoxelDef()) {
+      // this might become a fatal error in the future if some protocol
+      // is imposed... it may also be possible to check only the size
+      // rather than the coordinates, which may allow for translations
+      // of the geometry volumes in world space.
+      mf::LogWarning("PhotonVisbilityService")
+        << "Photon library reports the geometry:\n"
+        << lib->GetVoxelDef() << "while PhotonVisbilityService is configured with:\n"
+        << GetVoxelDef();
+    } // if metadata
+
+    if (fTimingHistogramBins > 0U) {
+      // the histograms depend only on the library and on their binning
+      std::string const key = LibraryFileWithPath + "/" + std::to_string(fTimingHistogramBins) +
+                              "/" + std::to_string(fTimingHistogramClasses);
+      lib->MakeTimingHistograms(
+        fTimingHistogramBins, fTimingHistogramClasses, fTimingHistogramCache, key);
+    }
+
+    // the full precision library is released after compression
+    if (fLibraryEncoding != "float") {
+      return std::make_unique<PhotonLibraryQuantized>(
+        *lib, PhotonLibraryQuantized::parseEncoding(fLibraryEncoding));
+    }
+    return lib;
+  }
+
+  //--------------------------------------------------------------------
+  void
+  PhotonVisibilityService::CheckBinaryLibrary(PhotonLibraryBinary const& lib,
+                                              std::string const& source) const
+  {
+    if (lib.NVoxels() != (int)GetVoxelDef().GetNVoxels()) {
+      throw cet::exception("PhotonVisibilityService")
+        << "Binary photon library " << source << " has " << lib.NVoxels()
+        << " voxels, while PhotonVisibilityService is configured with "
+        << GetVoxelDef().GetNVoxels() << ".\n";
+    }
+    if ((fStoreReflected && !lib.hasReflected()) || (fStoreReflT0 && !lib.hasReflectedT0())) {
+      throw cet::exception("PhotonVisibilityService")
+        << "Binary photon library " << source
+        << " lacks the reflected light information requested in the configuration.\n";
+    }
+    if (lib.hasVoxelDef() && (GetVoxelDef() != lib.GetVoxelDef())) {
+      mf::LogWarning("PhotonVisbilityService")
+        << "Photon library reports the geometry:\n"
+        << lib.GetVoxelDef() << "while PhotonVisbilityService is configured with:\n"
+        << GetVoxelDef();
     }
   }
 
@@ -248,6 +488,21 @@ namespace phot {
                                              << " Storing Library entries to file..." << std::endl;
       PhotonLibrary* lib = dynamic_cast<PhotonLibrary*>(fTheLibrary);
       lib->StoreLibraryToFile(fLibraryFile, fStoreReflected, fStoreReflT0, fParPropTime_npar);
+
+      // the shard holds the voxels the light source went through in this job
+      if (!fLibraryShardFile.empty()) {
+        if (fFirstProducedVoxel < 0) {
+          throw cet::exception("PhotonVisibilityService")
+            << "No light production was recorded: can't write the library shard '"
+            << fLibraryShardFile << "'.\n";
+        }
+        PhotonLibraryShard::writeShard(fLibraryShardFile,
+                                       *lib,
+                                       fFirstProducedVoxel,
+                                       fLastProducedVoxel - fFirstProducedVoxel + 1,
+                                       fStoreReflected,
+                                       fStoreReflT0);
+      }
     }
   }
 
@@ -262,7 +517,16 @@ namespace phot {
     fLibraryBuildJob = p.get<bool>("LibraryBuildJob", false);
     fParameterization = p.get<bool>("DUNE10ktParameterization", false);
     fHybrid = p.get<bool>("HybridLibrary", false);
+    fBinaryLibrary = p.get<bool>("BinaryLibrary", false);
+    fAdaptiveLibrary = p.get<bool>("AdaptiveLibrary", false);
+    fSharedMemoryName = p.get<std::string>("SharedMemoryName", "");
+    fLibraryShardFile = p.get<std::string>("LibraryShardFile", "");
+    fLibraryEncoding = p.get<std::string>("LibraryEncoding", "float");
     fLibraryFile = p.get<std::string>("LibraryFile", "");
+    fLoadRegionMin = p.get<std::vector<double>>("LoadRegionMin", {});
+    fLoadRegionMax = p.get<std::vector<double>>("LoadRegionMax", {});
+    fLoadChannels = p.get<std::vector<unsigned int>>("LoadChannels", {});
+    fLoadInBackground = p.get<bool>("LoadLibraryInBackground", false);
     fDoNotLoadLibrary = p.get<bool>("DoNotLoadLibrary");
     fStoreReflected = p.get<bool>("StoreReflected", false);
     fStoreReflT0 = p.get<bool>("StoreReflT0", false);
@@ -276,14 +540,90 @@ namespace phot {
     fUseCryoBoundary = p.get<bool>("UseCryoBoundary", false);
     fInterpolate = p.get<bool>("Interpolate", false);
     fReflectOverZeroX = p.get<bool>("ReflectOverZeroX", false);
+    fVisibilityRowCacheSize = p.get<std::size_t>("VisibilityRowCacheSize", 0U);
+    // a library being built changes, its rows can't be cached
+    if (fLibraryBuildJob) fVisibilityRowCacheSize = 0U;
 
     fParPropTime = p.get<bool>("ParametrisedTimePropagation", false);
     fParPropTime_npar = p.get<size_t>("ParametrisedTimePropagationNParameters", 0);
     fParPropTime_formula = p.get<std::string>("ParametrisedTimePropagationFittedFormula", "");
     fParPropTime_MaxRange = p.get<int>("ParametrisedTimePropagationMaxRange", 200);
+    fTimingHistogramBins = p.get<std::size_t>("TimingHistogramBins", 0U);
+    fTimingHistogramClasses = p.get<std::size_t>("TimingHistogramDistanceClasses", 16U);
+    fTimingHistogramCache = p.get<std::string>("TimingHistogramCache", "");
 
     if (!fParPropTime) { fParPropTime_npar = 0; }
 
+    // histograms are made from the parametrization of a library being read
+    if (fTimingHistogramBins > 0U) {
+      if ((fParPropTime_npar == 0) || fLibraryBuildJob) {
+        throw art::Exception(art::errors::Configuration)
+          << "PhotonVisibilityService: `TimingHistogramBins` requires"
+             " `ParametrisedTimePropagation` and a library which is not being built.\n";
+      }
+      if ((fTimingHistogramBins > PropagationTimeHistogram::Full) ||
+          (fTimingHistogramClasses == 0U) ||
+          (fTimingHistogramClasses >= PropagationTimeHistograms::NoClass)) {
+        throw art::Exception(art::errors::Configuration)
+          << "PhotonVisibilityService: `TimingHistogramBins` (" << fTimingHistogramBins
+          << ") must not exceed " << PropagationTimeHistogram::Full
+          << ", and `TimingHistogramDistanceClasses` (" << fTimingHistogramClasses
+          << ") must be between 1 and " << (PropagationTimeHistograms::NoClass - 1) << ".\n";
+      }
+    }
+
+    // binary and shared libraries hold plain tables, no timing functions
+    if ((fBinaryLibrary || !fSharedMemoryName.empty()) && (fParPropTime_npar != 0)) {
+      throw art::Exception(art::errors::Configuration)
+        << "PhotonVisibilityService: `ParametrisedTimePropagation` is not supported"
+           " together with `BinaryLibrary` or `SharedMemoryName`.\n";
+    }
+    if (fLibraryEncoding != "float") {
+      PhotonLibraryQuantized::parseEncoding(fLibraryEncoding); // throws if invalid
+      if (fBinaryLibrary || fHybrid || (fParPropTime_npar != 0)) {
+        throw art::Exception(art::errors::Configuration)
+          << "PhotonVisibilityService: `LibraryEncoding: \"" << fLibraryEncoding
+          << "\"` is supported only for ROOT photon libraries without parametrised timing.\n";
+      }
+    }
+    if (fAdaptiveLibrary && (fBinaryLibrary || fHybrid || (fLibraryEncoding != "float") ||
+                             (fParPropTime_npar != 0))) {
+      throw art::Exception(art::errors::Configuration)
+        << "PhotonVisibilityService: `AdaptiveLibrary` can't be combined with `BinaryLibrary`,"
+           " `HybridLibrary`, `LibraryEncoding` or `ParametrisedTimePropagation`.\n";
+    }
+    if (fHybrid && !fSharedMemoryName.empty()) {
+      throw art::Exception(art::errors::Configuration)
+        << "PhotonVisibilityService: `HybridLibrary` can't be shared via `SharedMemoryName`.\n";
+    }
+    bool const partialLoad = !fLoadRegionMin.empty() || !fLoadRegionMax.empty() ||
+                             !fLoadChannels.empty();
+    if (!fLoadRegionMin.empty() || !fLoadRegionMax.empty()) {
+      if ((fLoadRegionMin.size() != 3) || (fLoadRegionMax.size() != 3)) {
+        throw art::Exception(art::errors::Configuration)
+          << "PhotonVisibilityService: `LoadRegionMin` and `LoadRegionMax` must both be"
+             " specified, with three coordinates each.\n";
+      }
+    }
+    // a partial library must not be published to other processes either
+    if (partialLoad && (fBinaryLibrary || fAdaptiveLibrary || fHybrid ||
+                        !fSharedMemoryName.empty() || fLibraryBuildJob)) {
+      throw art::Exception(art::errors::Configuration)
+        << "PhotonVisibilityService: `LoadRegionMin`, `LoadRegionMax` and `LoadChannels`"
+           " are supported only when reading ROOT photon libraries, not shared.\n";
+    }
+    // the cached histograms describe the whole library
+    if (partialLoad && !fTimingHistogramCache.empty()) {
+      throw art::Exception(art::errors::Configuration)
+        << "PhotonVisibilityService: `TimingHistogramCache` can't be used when loading only"
+           " part of the library.\n";
+    }
+    if (fLoadInBackground && (fHybrid || !fSharedMemoryName.empty())) {
+      throw art::Exception(art::errors::Configuration)
+        << "PhotonVisibilityService: `LoadLibraryInBackground` can't be combined with"
+           " `HybridLibrary` or `SharedMemoryName`.\n";
+    }
+
     if (!fUseNhitsModel) {
 
       if (fUseCryoBoundary) {
@@ -396,10 +736,44 @@ namespace phot {
   // Get a vector of the relative visibilities of each OpDet
   //  in the event to a point p
 
+  template <typename F>
+  decltype(auto)
+  PhotonVisibilityService::withStaticMapping(F&& f) const
+  {
+    switch (fMappingType) {
+    case StaticMappingType_t::Identity:
+      return f(static_cast<PhotonMappingIdentityTransformations const&>(*fMapping));
+    case StaticMappingType_t::XMirror:
+      return f(static_cast<PhotonMappingXMirrorTransformations const&>(*fMapping));
+    case StaticMappingType_t::Generic: break;
+    } // switch
+    return f(*fMapping);
+  }
+
+  //------------------------------------------------------
+
   auto
   PhotonVisibilityService::doGetAllVisibilities(geo::Point_t const& p, bool wantReflected) const
     -> MappedCounts_t
   {
+    return withStaticMapping([this, &p, wantReflected](auto const& mapping) {
+      return doGetAllVisibilitiesWith(mapping, p, wantReflected);
+    });
+  }
+
+  //------------------------------------------------------
+
+  template <typename Mapping>
+  auto
+  PhotonVisibilityService::doGetAllVisibilitiesWith(Mapping const& mapping,
+                                                    geo::Point_t const& p,
+                                                    bool wantReflected) const -> MappedCounts_t
+  {
+    using Transformations_t = StaticPhotonMappingTransformations<Mapping>;
+
+    auto const& libIndices = Transformations_t::opDetsToLibraryIndices(mapping, p);
+    geo::Point_t const libLocation = Transformations_t::detectorToLibrary(mapping, p);
+
     phot::IPhotonLibrary::Counts_t data{};
 
     // first we fill a container of visibilities in the library index space
@@ -408,17 +782,163 @@ namespace phot {
     if (fInterpolate) {
       // this is a punch into multithreading face:
       static std::vector<float> ret;
-      ret.resize(fMapping->libraryMappingSize(p));
-      for (std::size_t libIndex = 0; libIndex < ret.size(); ++libIndex) {
-        ret[libIndex] = doGetVisibilityOfOpLib(p, LibraryIndex_t(libIndex), wantReflected);
+      ret.resize(Transformations_t::libraryMappingSize(mapping, p));
+
+      // In case we're outside the bounding box we'll get no neighbours.
+      std::array<sim::PhotonVoxelDef::NeiInfo, NInterpolationNeighbours> neis;
+      if (!GetVoxelDef().GetNeighboringVoxelIDs(libLocation, neis)) {
+        std::fill(ret.begin(), ret.end(), 0.0f);
+      }
+      else {
+        // blend the whole library rows of all the neighbours at once;
+        // the rows are copied, since the library may reuse a single buffer
+        if (fTheLibrary == 0) LoadLibrary();
+        static thread_local std::vector<float> rowBuffer;
+        std::array<int, NInterpolationNeighbours> voxels;
+        std::array<float, NInterpolationNeighbours> weights;
+        for (std::size_t k = 0; k < NInterpolationNeighbours; ++k) {
+          voxels[k] = neis[k].id;
+          weights[k] = static_cast<float>(neis[k].weight);
+        }
+        phot::IPhotonLibrary const& library = *fTheLibrary;
+        auto copyRow = [&library, wantReflected](int voxel, float* dest) {
+          return wantReflected ? library.CopyReflCounts(voxel, dest) :
+                                 library.CopyCounts(voxel, dest);
+        };
+        blendLibraryRows(
+          ret.data(), voxels, weights, ret.size(), library.NOpChannels(), copyRow, rowBuffer);
       }
       data = &ret.front();
     }
     else {
-      auto const VoxID = VoxelAt(p);
+      auto const VoxID = fVoxelDef.GetVoxelID(libLocation);
+      if (fVisibilityRowCacheSize > 0U)
+        return doGetCachedVisibilities(libIndices, VoxID, wantReflected);
       data = GetLibraryEntries(VoxID, wantReflected);
     }
-    return fMapping->applyOpDetMapping(p, data);
+    return mapping.applyOpDetMapping(libIndices, data);
+  }
+
+  //------------------------------------------------------
+
+  auto
+  PhotonVisibilityService::doGetCachedVisibilities(
+    IPhotonMappingTransformations::OpDetToLibraryIndexMap const& libIndices,
+    int VoxID,
+    bool wantReflected) const -> MappedCounts_t
+  {
+    if (fTheLibrary == 0) LoadLibrary();
+
+    VisibilityRowCache& cache = gVisibilityRowCache;
+    ++cache.clock;
+
+    // look for the row, keeping track of the least recently used one
+    VisibilityRowCache::Row* row = nullptr;
+    VisibilityRowCache::Row* oldest = nullptr;
+    for (VisibilityRowCache::Row& cached : cache.rows) {
+      if ((cached.generation == fLibraryGeneration) && (cached.voxel == VoxID) &&
+          (cached.reflected == wantReflected) && (cached.mapping == &libIndices)) {
+        row = &cached;
+        break;
+      }
+      if (!oldest || (cached.lastUse < oldest->lastUse)) oldest = &cached;
+    }
+
+    if (!row) {
+      // moving the rows does not move their values, which callers may hold
+      if (cache.rows.size() < fVisibilityRowCacheSize)
+        row = &cache.rows.emplace_back();
+      else
+        row = oldest;
+
+      phot::IPhotonLibrary::Counts_t const data = GetLibraryEntries(VoxID, wantReflected);
+      row->generation = fLibraryGeneration;
+      row->voxel = VoxID;
+      row->reflected = wantReflected;
+      row->mapping = &libIndices;
+      row->valid = (data != nullptr);
+      row->values.assign(libIndices.size(), 0.0f);
+      if (data) {
+        for (std::size_t opDet = 0; opDet < libIndices.size(); ++opDet) {
+          LibraryIndex_t const libIndex = libIndices[opDet];
+          if (libIndex != IPhotonMappingTransformations::InvalidLibraryIndex)
+            row->values[opDet] = data[libIndex];
+        }
+      }
+    }
+    row->lastUse = cache.clock;
+
+    if (!row->valid)
+      return fMapping->applyOpDetMapping(libIndices, phot::IPhotonLibrary::Counts_t{});
+    return fMapping->applyOpDetMapping(
+      fIdentityOpDetMap, phot::IPhotonLibrary::Counts_t{row->values.data()});
+  }
+
+  //------------------------------------------------------
+
+  auto
+  PhotonVisibilityService::doGetAllVisibilitiesBatch(std::vector<geo::Point_t> const& points,
+                                                     std::vector<float>& visibilities,
+                                                     bool wantReflected) const
+    -> std::vector<bool>
+  {
+    std::size_t const nPoints = points.size();
+    std::size_t const nChannels = NOpChannels();
+
+    visibilities.assign(nPoints * nChannels, 0.0f);
+    std::vector<bool> valid(nPoints, false);
+    if (nPoints == 0) return valid;
+
+    if (fTheLibrary == 0) LoadLibrary();
+
+    if (fInterpolate) {
+      // interpolation needs the neighbouring voxels of each point anyway
+      for (std::size_t iPoint = 0; iPoint < nPoints; ++iPoint) {
+        auto const vis = doGetAllVisibilities(points[iPoint], wantReflected);
+        if (!vis) continue;
+        float* row = visibilities.data() + iPoint * nChannels;
+        for (std::size_t channel = 0; channel < nChannels; ++channel)
+          row[channel] = vis[channel];
+        valid[iPoint] = true;
+      }
+      return valid;
+    }
+
+    // visit the points voxel by voxel, fetching each library entry only once
+    std::vector<geo::Point_t> libLocations;
+    libLocations.reserve(nPoints);
+    for (geo::Point_t const& p : points)
+      libLocations.push_back(LibLocation(p));
+    std::vector<int> voxels;
+    fVoxelDef.GetVoxelIDs(libLocations, voxels);
+
+    std::vector<std::pair<int, std::size_t>> order;
+    order.reserve(nPoints);
+    for (std::size_t iPoint = 0; iPoint < nPoints; ++iPoint)
+      order.emplace_back(voxels[iPoint], iPoint);
+    std::sort(order.begin(), order.end());
+
+    int currentVoxel = order.front().first;
+    phot::IPhotonLibrary::Counts_t data = GetLibraryEntries(currentVoxel, wantReflected);
+
+    for (auto const& [VoxID, iPoint] : order) {
+      if (VoxID != currentVoxel) {
+        currentVoxel = VoxID;
+        data = GetLibraryEntries(currentVoxel, wantReflected);
+      }
+      if (!data) continue;
+
+      // the mapping may still depend on the point (e.g. mirrored detectors)
+      auto const& libIndices = fMapping->opDetsToLibraryIndices(points[iPoint]);
+      float* row = visibilities.data() + iPoint * nChannels;
+      for (std::size_t channel = 0; channel < nChannels; ++channel) {
+        LibraryIndex_t const libIndex = libIndices[channel];
+        if (libIndex != IPhotonMappingTransformations::InvalidLibraryIndex)
+          row[channel] = data[libIndex];
+      }
+      valid[iPoint] = true;
+    }
+    return valid;
   }
 
   //------------------------------------------------------
@@ -443,28 +963,6 @@ namespace phot {
 
   //------------------------------------------------------
 
-  float
-  PhotonVisibilityService::doGetVisibilityOfOpLib(geo::Point_t const& p,
-                                                  LibraryIndex_t libIndex,
-                                                  bool wantReflected /* = false */) const
-  {
-    if (!fInterpolate) { return GetLibraryEntry(VoxelAt(p), libIndex, wantReflected); }
-
-    // In case we're outside the bounding box we'll get a empty optional list.
-    auto const neis = GetVoxelDef().GetNeighboringVoxelIDs(LibLocation(p));
-    if (!neis) return 0.0;
-
-    // Sum up all the weighted neighbours to get interpolation behaviour
-    float vis = 0.0;
-    for (const sim::PhotonVoxelDef::NeiInfo& n : neis.value()) {
-      if (n.id < 0) continue;
-      vis += n.weight * GetLibraryEntry(n.id, libIndex, wantReflected);
-    }
-    return vis;
-  }
-
-  //------------------------------------------------------
-
   bool
   PhotonVisibilityService::doHasVisibility(geo::Point_t const& p,
                                            bool wantReflected /* = false */) const
@@ -479,9 +977,49 @@ namespace phot {
                                            unsigned int OpChannel,
                                            bool wantReflected) const
   {
+    return withStaticMapping([this, &p, OpChannel, wantReflected](auto const& mapping) {
+      return doGetVisibilityWith(mapping, p, OpChannel, wantReflected);
+    });
+  }
+
+  //------------------------------------------------------
+
+  template <typename Mapping>
+  float
+  PhotonVisibilityService::doGetVisibilityWith(Mapping const& mapping,
+                                               geo::Point_t const& p,
+                                               unsigned int OpChannel,
+                                               bool wantReflected) const
+  {
+    using Transformations_t = StaticPhotonMappingTransformations<Mapping>;
+
     // here we quietly confuse op. det. channel (interface) and op. det. (library)
-    LibraryIndex_t const libIndex = fMapping->opDetToLibraryIndex(p, OpChannel);
-    return doGetVisibilityOfOpLib(p, libIndex, wantReflected);
+    LibraryIndex_t const libIndex = Transformations_t::opDetToLibraryIndex(mapping, p, OpChannel);
+    if (libIndex == IPhotonMappingTransformations::InvalidLibraryIndex) return 0.0;
+
+    geo::Point_t const libLocation = Transformations_t::detectorToLibrary(mapping, p);
+
+    if (!fTheLibrary) LoadLibrary();
+    IPhotonLibrary const& library = *fTheLibrary;
+
+    if (!fInterpolate) {
+      int const VoxID = fVoxelDef.GetVoxelID(libLocation);
+      return wantReflected ? library.GetReflCount(VoxID, libIndex) :
+                             library.GetCount(VoxID, libIndex);
+    }
+
+    // In case we're outside the bounding box we'll get no neighbours.
+    std::array<sim::PhotonVoxelDef::NeiInfo, NInterpolationNeighbours> neis;
+    if (!GetVoxelDef().GetNeighboringVoxelIDs(libLocation, neis)) return 0.0;
+
+    // Sum up all the weighted neighbours to get interpolation behaviour
+    float vis = 0.0;
+    for (const sim::PhotonVoxelDef::NeiInfo& n : neis) {
+      if (n.id < 0) continue;
+      vis += n.weight * (wantReflected ? library.GetReflCount(n.id, libIndex) :
+                                         library.GetCount(n.id, libIndex));
+    }
+    return vis;
   }
 
   //------------------------------------------------------
@@ -489,10 +1027,36 @@ namespace phot {
   void
   PhotonVisibilityService::StoreLightProd(int VoxID, double N)
   {
-    fCurrentVoxel = VoxID;
-    fCurrentValue = N;
-    mf::LogInfo("PhotonVisibilityService")
-      << " PVS notes production of " << N << " photons at Vox " << VoxID << std::endl;
+    StoreLightProd(std::vector<LightProd_t>{{VoxID, N}});
+  }
+
+  //------------------------------------------------------
+
+  void
+  PhotonVisibilityService::StoreLightProd(std::vector<LightProd_t> const& prods)
+  {
+    fLightProds = prods;
+    if (!fLightProds.empty()) {
+      fCurrentVoxel = fLightProds.front().voxel;
+      fCurrentValue = fLightProds.front().N;
+    }
+    double totalN = 0.0;
+    for (LightProd_t const& prod : fLightProds) {
+      if ((fFirstProducedVoxel < 0) || (prod.voxel < fFirstProducedVoxel))
+        fFirstProducedVoxel = prod.voxel;
+      if (prod.voxel > fLastProducedVoxel) fLastProducedVoxel = prod.voxel;
+      totalN += prod.N;
+    }
+    if (fLightProds.size() == 1) {
+      mf::LogInfo("PhotonVisibilityService")
+        << " PVS notes production of " << fCurrentValue << " photons at Vox " << fCurrentVoxel
+        << std::endl;
+    }
+    else if (!fLightProds.empty()) {
+      mf::LogInfo("PhotonVisibilityService")
+        << " PVS notes production of " << totalN << " photons in " << fLightProds.size()
+        << " voxels" << std::endl;
+    }
   }
 
   //------------------------------------------------------
@@ -500,6 +1064,11 @@ namespace phot {
   void
   PhotonVisibilityService::RetrieveLightProd(int& VoxID, double& N) const
   {
+    if (fLightProds.size() > 1) {
+      throw cet::exception("PhotonVisibilityService")
+        << "Light was produced in " << fLightProds.size()
+        << " voxels in this event: use GetLightProds() to retrieve it.\n";
+    }
     N = fCurrentValue;
     VoxID = fCurrentVoxel;
   }
@@ -630,6 +1199,15 @@ namespace phot {
     return fMapping->applyOpDetMapping(p, functions);
   }
 
+  auto
+  PhotonVisibilityService::doGetTimingHistograms(geo::Point_t const& p) const
+    -> MappedTimeHistograms_t
+  {
+    int const VoxID = VoxelAt(p);
+    phot::IPhotonLibrary::TimeHistograms_t histograms = GetLibraryTimingHistogramEntries(VoxID);
+    return fMapping->applyOpDetMapping(p, histograms);
+  }
+
   //------------------------------------------------------
 
   phot::IPhotonLibrary::Params_t
@@ -654,6 +1232,17 @@ namespace phot {
 
   //------------------------------------------------------
 
+  phot::IPhotonLibrary::TimeHistograms_t
+  PhotonVisibilityService::GetLibraryTimingHistogramEntries(int VoxID) const
+  {
+    if (fTheLibrary == 0) LoadLibrary();
+    PhotonLibrary* lib = dynamic_cast<PhotonLibrary*>(fTheLibrary);
+
+    return lib->GetTimingHistograms(VoxID);
+  }
+
+  //------------------------------------------------------
+
   void
   PhotonVisibilityService::SetLibraryTimingParEntry(int VoxID,
                                                     int OpChannel,
@@ -849,7 +1438,10 @@ namespace phot {
   geo::Point_t
   PhotonVisibilityService::LibLocation(geo::Point_t const& p) const
   {
-    return fMapping->detectorToLibrary(p);
+    return withStaticMapping([&p](auto const& mapping) {
+      using Transformations_t = StaticPhotonMappingTransformations<std::decay_t<decltype(mapping)>>;
+      return Transformations_t::detectorToLibrary(mapping, p);
+    });
   }
 
 } // namespace
@@ -18,6 +18,8 @@
 
 // LArSoft libraries
 #include "larsim/PhotonPropagation/IPhotonLibrary.h"
+#include "larsim/PhotonPropagation/PropagationTimeHistograms.h"
+#include "larsim/PhotonPropagation/PropagationTimeParametrization.h"
 #include "larsim/PhotonPropagation/LibraryMappingTools/IPhotonMappingTransformations.h"
 
 
@@ -74,14 +76,29 @@ namespace phot{
    * No data storage is provided.
    *
    * This is the type returned by `phot::PhotonVisibilityService` when asked
-   * about any parameter directlyt described by functions (glorious ROOT `TF1`),
-   * from a point to _all_ the optical detectors.
+   * about any parameter directlyt described by functions (samplers of the
+   * distributions, `phot::PropagationTimeSampler`), from a point to _all_ the
+   * optical detectors.
    */
   using MappedFunctions_t
     = phot::IPhotonMappingTransformations::MappedOpDetData_t
       <phot::IPhotonLibrary::Functions_t>
     ;
 
+  /**
+   * @brief Type of mapped propagation time histograms.
+   *
+   * No data storage is provided.
+   *
+   * This is the type returned by `phot::PhotonVisibilityService` when asked
+   * about the propagation time histograms (`phot::PropagationTimeHistogram`),
+   * from a point to _all_ the optical detectors.
+   */
+  using MappedTimeHistograms_t
+    = phot::IPhotonMappingTransformations::MappedOpDetData_t
+      <phot::IPhotonLibrary::TimeHistograms_t>
+    ;
+
 } // namespace phot
 
 
@@ -0,0 +1,320 @@
+/**
+ * @file   larsim/PhotonPropagation/PropagationTimeHistograms.cxx
+ * @brief  Photon propagation time distributions of a library as small histograms.
+ * @see    larsim/PhotonPropagation/PropagationTimeHistograms.h
+ */
+
+#include "larsim/PhotonPropagation/PropagationTimeHistograms.h"
+#include "larsim/PhotonPropagation/PropagationTimeParametrization.h"
+
+#include "cetlib_except/exception.h"
+
+// C/C++ standard libraries
+#include <cmath>   // std::round()
+#include <cstring> // std::memcmp()
+#include <fstream>
+#include <limits>
+#include <utility> // std::pair<>
+
+namespace {
+
+  /// Identifier at the beginning of each histogram file.
+  constexpr char Magic[8] = {'L', 'A', 'R', 'P', 'T', 'H', 'S', '\0'};
+
+  /// Version of the histogram file format.
+  constexpr std::uint32_t FormatVersion = 1U;
+
+  template <typename T>
+  void
+  writeValue(std::ostream& out, T const& value)
+  {
+    out.write(reinterpret_cast<char const*>(&value), sizeof(T));
+  }
+
+  template <typename T>
+  void
+  writeVector(std::ostream& out, std::vector<T> const& data)
+  {
+    out.write(reinterpret_cast<char const*>(data.data()), data.size() * sizeof(T));
+  }
+
+  template <typename T>
+  bool
+  readValue(std::istream& in, T& value)
+  {
+    return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+  }
+
+  template <typename T>
+  bool
+  readVector(std::istream& in, std::vector<T>& data)
+  {
+    return bool(in.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(T)));
+  }
+
+  /**
+   * Probability below the edge `k` of `nBins` bins: bins get smaller towards
+   * the tail, where a uniform filling of a wide bin would bias late photons.
+   */
+  double
+  edgeLevel(std::size_t k, std::size_t nBins)
+  {
+    double const r = 1. - double(k) / nBins;
+    return 1. - r * r;
+  }
+
+  /**
+   * Fills `cdf` with the cumulative function of a tabulated distribution at
+   * the (sorted) `edges`, walking its quantiles once.
+   */
+  void
+  cumulativeAt(phot::InverseCDFTable const& table,
+               float const* edges,
+               std::size_t nEdges,
+               std::vector<double>& cdf)
+  {
+    std::size_t const nQuantiles = table.nQuantiles();
+    cdf.resize(nEdges);
+    std::size_t j = 0;
+    double qLow = table.sample(0, 0.);
+    double qHigh = table.sample(0, 1. / nQuantiles);
+    for (std::size_t k = 0; k < nEdges; ++k) {
+      double const t = edges[k];
+      while ((j + 1 < nQuantiles) && (qHigh < t)) {
+        ++j;
+        qLow = qHigh;
+        qHigh = table.sample(0, double(j + 1) / nQuantiles);
+      }
+      double frac = 0.;
+      if (t >= qHigh)
+        frac = 1.;
+      else if (t > qLow)
+        frac = (t - qLow) / (qHigh - qLow);
+      cdf[k] = (j + frac) / nQuantiles;
+    }
+  }
+
+} // local namespace
+
+namespace phot {
+
+  //------------------------------------------------------------------------------
+  PropagationTimeHistograms::PropagationTimeHistograms(std::size_t nVoxels,
+                                                       std::size_t nChannels,
+                                                       std::size_t nBins,
+                                                       std::vector<float> edges)
+    : fNBins(nBins)
+    , fNChannels(nChannels)
+    , fEdges(std::move(edges))
+    , fClasses(nVoxels * nChannels, NoClass)
+    , fCumulative(nVoxels * nChannels * nBins, 0)
+  {
+    if ((nBins == 0) || (nBins > PropagationTimeHistogram::Full)) {
+      throw cet::exception("PropagationTimeHistograms")
+        << "The number of bins (" << nBins << ") must be between 1 and "
+        << PropagationTimeHistogram::Full << ".\n";
+    }
+    if ((fEdges.size() % (nBins + 1) != 0) || (nClasses() >= NoClass)) {
+      throw cet::exception("PropagationTimeHistograms")
+        << fEdges.size() << " bin edges are not a valid number of classes of " << nBins
+        << " bins.\n";
+    }
+    makeVoxels(nVoxels);
+  }
+
+  //------------------------------------------------------------------------------
+  void
+  PropagationTimeHistograms::makeVoxels(std::size_t nVoxels)
+  {
+    fVoxels.clear();
+    fVoxels.reserve(nVoxels);
+    for (std::size_t voxel = 0; voxel < nVoxels; ++voxel)
+      fVoxels.emplace_back(*this, voxel * fNChannels, fNChannels);
+  }
+
+  //------------------------------------------------------------------------------
+  auto
+  PropagationTimeHistograms::fromParametrization(PropagationTimeParametrization const& param,
+                                                 std::size_t nVoxels,
+                                                 std::size_t nChannels,
+                                                 std::size_t nBins,
+                                                 std::size_t nClasses)
+    -> std::unique_ptr<PropagationTimeHistograms>
+  {
+    std::size_t const nEntries = nVoxels * nChannels;
+
+    // defined entries, sorted by the lower limit of their distribution
+    std::vector<std::pair<float, std::size_t>> lowers;
+    for (std::size_t entry = 0; entry < nEntries; ++entry)
+      if (param.isDefined(entry)) lowers.emplace_back(param.parameter(entry, 0), entry);
+    std::sort(lowers.begin(), lowers.end());
+
+    nClasses = std::min({nClasses, lowers.size(), std::size_t(NoClass - 1)});
+    if (nClasses == 0) {
+      return std::make_unique<PropagationTimeHistograms>(
+        nVoxels, nChannels, nBins, std::vector<float>(nBins + 1, 0.f));
+    }
+    auto const classBegin = [&lowers, nClasses](std::size_t c) {
+      return c * lowers.size() / nClasses;
+    };
+
+    // first pass: the edges of each class, from the average quantiles
+    std::vector<float> edges(nClasses * (nBins + 1));
+    std::vector<double> sums(nBins + 1);
+    for (std::size_t c = 0; c < nClasses; ++c) {
+      std::fill(sums.begin(), sums.end(), 0.);
+      double lower = std::numeric_limits<double>::max();
+      double upper = std::numeric_limits<double>::lowest();
+      std::size_t const begin = classBegin(c), end = classBegin(c + 1);
+      for (std::size_t i = begin; i < end; ++i) {
+        auto const distr = param.distribution(lowers[i].second);
+        lower = std::min(lower, distr->sample(0, 0.));
+        upper = std::max(upper, distr->sample(0, 1.));
+        for (std::size_t k = 1; k < nBins; ++k)
+          sums[k] += distr->sample(0, edgeLevel(k, nBins));
+      }
+      float* classEdges = edges.data() + c * (nBins + 1);
+      classEdges[0] = lower;
+      for (std::size_t k = 1; k < nBins; ++k)
+        classEdges[k] = std::min(std::max(sums[k] / (end - begin), lower), upper);
+      classEdges[nBins] = upper;
+    }
+
+    auto histograms =
+      std::make_unique<PropagationTimeHistograms>(nVoxels, nChannels, nBins, std::move(edges));
+
+    // second pass: the content of each entry in the bins of its class
+    std::vector<double> cdf, content(nBins);
+    for (std::size_t c = 0; c < nClasses; ++c) {
+      float const* classEdges = histograms->fEdges.data() + c * (nBins + 1);
+      for (std::size_t i = classBegin(c); i < classBegin(c + 1); ++i) {
+        std::size_t const entry = lowers[i].second;
+        cumulativeAt(*param.distribution(entry), classEdges, nBins + 1, cdf);
+        for (std::size_t k = 0; k < nBins; ++k)
+          content[k] = cdf[k + 1] - cdf[k];
+        histograms->setEntry(entry, c, content.data());
+      }
+    }
+    return histograms;
+  }
+
+  //------------------------------------------------------------------------------
+  void
+  PropagationTimeHistograms::setEntry(std::size_t entry,
+                                      std::size_t distanceClass,
+                                      double const* content)
+  {
+    double total = 0.;
+    for (std::size_t k = 0; k < fNBins; ++k)
+      if (content[k] > 0.) total += content[k];
+
+    std::uint8_t* cumulative = fCumulative.data() + entry * fNBins;
+    unsigned int const full = PropagationTimeHistogram::Full;
+    if (!(total > 0.)) {
+      // no information: uniform distribution
+      for (std::size_t k = 0; k < fNBins; ++k)
+        cumulative[k] = static_cast<std::uint8_t>(std::round(full * double(k + 1) / fNBins));
+    }
+    else {
+      // quantise, keeping at least one step for each non-empty bin, and
+      // room for the non-empty bins after it
+      std::size_t nLeft = 0; // non-empty bins after the current one
+      for (std::size_t k = 0; k < fNBins; ++k)
+        if (content[k] > 0.) ++nLeft;
+      double sum = 0.;
+      unsigned int prev = 0;
+      for (std::size_t k = 0; k < fNBins; ++k) {
+        bool const filled = content[k] > 0.;
+        if (filled) {
+          sum += content[k];
+          --nLeft;
+        }
+        auto value = static_cast<unsigned int>(std::round(full * sum / total));
+        if (filled) value = std::max(value, prev + 1);
+        value = std::min(value, full - static_cast<unsigned int>(nLeft));
+        cumulative[k] = static_cast<std::uint8_t>(std::max(value, prev));
+        prev = cumulative[k];
+      }
+    }
+    cumulative[fNBins - 1] = full;
+    fClasses[entry] = static_cast<std::uint8_t>(distanceClass);
+  }
+
+  //------------------------------------------------------------------------------
+  std::size_t
+  PropagationTimeHistograms::memoryFootprint() const
+  {
+    return fEdges.capacity() * sizeof(float) + fClasses.capacity() + fCumulative.capacity() +
+           fVoxels.capacity() * sizeof(PropagationTimeHistogramVoxel);
+  }
+
+  //------------------------------------------------------------------------------
+  void
+  PropagationTimeHistograms::writeFile(std::string const& fileName, std::string const& key) const
+  {
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      throw cet::exception("PropagationTimeHistograms")
+        << "Can't open '" << fileName << "' for writing.\n";
+    }
+
+    out.write(Magic, sizeof(Magic));
+    writeValue(out, FormatVersion);
+    writeValue(out, std::uint64_t(key.size()));
+    out.write(key.data(), key.size());
+    writeValue(out, std::uint64_t(nEntries()));
+    writeValue(out, std::uint64_t(fNBins));
+    writeValue(out, std::uint64_t(nClasses()));
+    writeVector(out, fEdges);
+    writeVector(out, fClasses);
+    writeVector(out, fCumulative);
+
+    if (!out) {
+      throw cet::exception("PropagationTimeHistograms")
+        << "Error while writing '" << fileName << "'.\n";
+    }
+  }
+
+  //------------------------------------------------------------------------------
+  bool
+  PropagationTimeHistograms::readFile(std::string const& fileName, std::string const& key)
+  {
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in) return false;
+
+    char magic[sizeof(Magic)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)) != 0)
+      return false;
+
+    std::uint32_t version = 0;
+    if (!readValue(in, version) || (version != FormatVersion)) return false;
+
+    std::uint64_t keySize = 0;
+    if (!readValue(in, keySize) || (keySize != key.size())) return false;
+    std::string fileKey(keySize, '\0');
+    if (!in.read(fileKey.data(), keySize) || (fileKey != key)) return false;
+
+    std::uint64_t nEntriesInFile = 0, nBinsInFile = 0, nClassesInFile = 0;
+    if (!readValue(in, nEntriesInFile) || (nEntriesInFile != nEntries())) return false;
+    if (!readValue(in, nBinsInFile) || (nBinsInFile != fNBins)) return false;
+    if (!readValue(in, nClassesInFile) || (nClassesInFile >= NoClass)) return false;
+
+    // read into copies, so that the histograms are untouched on failure
+    std::vector<float> edges(nClassesInFile * (fNBins + 1));
+    std::vector<std::uint8_t> classes(fClasses.size());
+    std::vector<std::uint8_t> cumulative(fCumulative.size());
+    if (!readVector(in, edges) || !readVector(in, classes) || !readVector(in, cumulative))
+      return false;
+    for (std::uint8_t const c : classes)
+      if ((c != NoClass) && (c >= nClassesInFile)) return false;
+
+    // the views of the voxels are still valid, since the entries are the same
+    fEdges = std::move(edges);
+    fClasses = std::move(classes);
+    fCumulative = std::move(cumulative);
+    return true;
+  }
+
+  //------------------------------------------------------------------------------
+
+} // namespace phot
@@ -0,0 +1,271 @@
+/**
+ * @file   larsim/PhotonPropagation/PropagationTimeHistograms.h
+ * @brief  Photon propagation time distributions of a library as small histograms.
+ * @see    larsim/PhotonPropagation/PropagationTimeHistograms.cxx
+ *
+ * The propagation time distribution from each voxel to each optical channel
+ * is described by the cumulative content of a few bins, quantised on one
+ * byte each. The bin edges are shared by all the entries of the same
+ * distance class (the lower limits of their distributions, the arrival time
+ * of the earliest photons, are similar), and each entry records its class.
+ * A 16 bin histogram takes 17 bytes per entry, and sampling it is a direct
+ * inversion of its piecewise linear cumulative function: no ROOT function is
+ * evaluated and no table is built or cached while simulating.
+ *
+ * The histograms are made once from a `phot::PropagationTimeParametrization`
+ * (which takes some time on a large library) and can be saved into a file, to
+ * be read back by the following jobs.
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_PROPAGATIONTIMEHISTOGRAMS_H
+#define LARSIM_PHOTONPROPAGATION_PROPAGATIONTIMEHISTOGRAMS_H
+
+// C/C++ standard libraries
+#include <algorithm> // std::min(), std::max()
+#include <cstddef>   // std::size_t
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace phot {
+
+  class PropagationTimeHistograms;
+  class PropagationTimeParametrization;
+
+  /// Sampler of the propagation time histogram of one library entry.
+  class PropagationTimeHistogram {
+  public:
+    /// Constructor: a histogram with no distribution.
+    PropagationTimeHistogram() = default;
+
+    PropagationTimeHistogram(float const* edges, std::uint8_t const* cumulative, std::size_t nBins)
+      : fEdges(edges), fCumulative(cumulative), fNBins(nBins)
+    {}
+
+    /// Returns whether there is a distribution for this entry.
+    bool
+    isValid() const
+    {
+      return fCumulative != nullptr;
+    }
+
+    /// Returns the time [ns] at quantile `u` (`[ 0, 1 ]`) of the distribution.
+    double
+    sample(double u) const
+    {
+      // cumulative content at the upper edge of each bin, the last one is full
+      double const target = u * Full;
+      std::size_t bin = 0;
+      while ((bin + 1 < fNBins) && (fCumulative[bin] <= target))
+        ++bin;
+      double const low = (bin == 0) ? 0. : fCumulative[bin - 1];
+      double const content = fCumulative[bin] - low;
+      double const frac = (content > 0.) ? (target - low) / content : 0.5;
+      return fEdges[bin] + std::min(std::max(frac, 0.), 1.) * (fEdges[bin + 1] - fEdges[bin]);
+    }
+
+    /// Value of the full cumulative content (the last bin).
+    static constexpr unsigned int Full = 255U;
+
+  private:
+    float const* fEdges = nullptr;                ///< `fNBins + 1` bin edges [ns].
+    std::uint8_t const* fCumulative = nullptr;    ///< Cumulative content of each bin.
+    std::size_t fNBins = 0U;
+  }; // PropagationTimeHistogram
+
+  /// Histograms of all the optical channels of a voxel.
+  class PropagationTimeHistogramVoxel {
+  public:
+    using value_type = PropagationTimeHistogram;
+    using size_type = std::size_t;
+
+    /// Constructor: no channel.
+    PropagationTimeHistogramVoxel() = default;
+
+    PropagationTimeHistogramVoxel(PropagationTimeHistograms const& histograms,
+                                  std::size_t firstEntry,
+                                  std::size_t nChannels)
+      : fHistograms(&histograms), fFirstEntry(firstEntry), fNChannels(nChannels)
+    {}
+
+    size_type
+    size() const
+    {
+      return fNChannels;
+    }
+
+    bool
+    empty() const
+    {
+      return fNChannels == 0U;
+    }
+
+    value_type operator[](size_type channel) const;
+
+  private:
+    PropagationTimeHistograms const* fHistograms = nullptr;
+    std::size_t fFirstEntry = 0U;
+    std::size_t fNChannels = 0U;
+  }; // PropagationTimeHistogramVoxel
+
+  /**
+   * @brief Propagation time histograms of all the entries of a library.
+   *
+   * Each entry (voxel and channel, in the same layout as the library) has a
+   * distance class and `nBins()` cumulative bin contents, from `0` to
+   * `PropagationTimeHistogram::Full` (the content of the last bin).
+   * Class `c` has `nBins() + 1` bin edges. Entries without a class have no
+   * distribution.
+   *
+   * The views of the voxels refer to this object, which can't be copied.
+   */
+  class PropagationTimeHistograms {
+  public:
+    /// Class of the entries without distribution.
+    static constexpr std::uint8_t NoClass = 0xFF;
+
+    PropagationTimeHistograms() = default;
+
+    /**
+     * @brief Constructor: entries have no distribution yet.
+     * @param nVoxels number of voxels in the library
+     * @param nChannels number of optical channels in the library
+     * @param nBins number of bins of each histogram
+     * @param edges bin edges [ns], `nBins + 1` for each distance class
+     * @throw cet::exception (category: `"PropagationTimeHistograms"`) if the
+     *        edges are not a whole number of classes, or too many
+     */
+    PropagationTimeHistograms(std::size_t nVoxels,
+                              std::size_t nChannels,
+                              std::size_t nBins,
+                              std::vector<float> edges);
+
+    PropagationTimeHistograms(PropagationTimeHistograms const&) = delete;
+    PropagationTimeHistograms& operator=(PropagationTimeHistograms const&) = delete;
+
+    /**
+     * @brief Makes the histograms of all the entries of a parametrization.
+     * @param param the parametrized distributions
+     * @param nVoxels number of voxels in the library
+     * @param nChannels number of optical channels in the library
+     * @param nBins number of bins of each histogram
+     * @param nClasses number of distance classes
+     *
+     * The entries are split in `nClasses` classes of about the same size by
+     * the lower limit of their distribution; the bin edges of each class are
+     * the average quantiles of the distributions in the class, at levels
+     * closer to each other towards the tail of the distributions.
+     */
+    static std::unique_ptr<PropagationTimeHistograms> fromParametrization(
+      PropagationTimeParametrization const& param,
+      std::size_t nVoxels,
+      std::size_t nChannels,
+      std::size_t nBins,
+      std::size_t nClasses);
+
+    /// Number of bins of each histogram.
+    std::size_t
+    nBins() const
+    {
+      return fNBins;
+    }
+
+    /// Number of distance classes.
+    std::size_t
+    nClasses() const
+    {
+      return (fNBins > 0U) ? fEdges.size() / (fNBins + 1) : 0U;
+    }
+
+    /// Number of library entries.
+    std::size_t
+    nEntries() const
+    {
+      return fClasses.size();
+    }
+
+    /// Returns whether `entry` has a distribution.
+    bool
+    isDefined(std::size_t entry) const
+    {
+      return (entry < fClasses.size()) && (fClasses[entry] != NoClass);
+    }
+
+    /**
+     * @brief Sets the distribution of `entry`.
+     * @param entry the library entry
+     * @param distanceClass class of the bin edges of the entry
+     * @param content the (unnormalised) content of each bin
+     *
+     * Bins with a non-null content are never quantised to empty. An entry with
+     * no content at all gets the same probability in each bin.
+     */
+    void setEntry(std::size_t entry, std::size_t distanceClass, double const* content);
+
+    /// Returns the sampler of `entry` (invalid if not defined).
+    PropagationTimeHistogram
+    histogram(std::size_t entry) const
+    {
+      if (!isDefined(entry)) return {};
+      return {
+        fEdges.data() + fClasses[entry] * (fNBins + 1), fCumulative.data() + entry * fNBins, fNBins};
+    }
+
+    /// Returns the histograms of all the channels in `voxel`.
+    PropagationTimeHistogramVoxel const&
+    voxel(std::size_t voxel) const
+    {
+      return fVoxels[voxel];
+    }
+
+    /// Returns the memory of the histograms [bytes].
+    std::size_t memoryFootprint() const;
+
+    /**
+     * @brief Writes the histograms into the specified file.
+     * @param fileName path of the file to be (over)written
+     * @param key string describing the library the histograms come from
+     * @throw cet::exception (category: `"PropagationTimeHistograms"`) on error
+     */
+    void writeFile(std::string const& fileName, std::string const& key) const;
+
+    /**
+     * @brief Replaces the histograms with the ones from a file.
+     * @param fileName path of the file to be read
+     * @param key expected library key
+     * @return whether the histograms were read
+     *
+     * The histograms are read only if the file exists, is valid, was created
+     * with the same `key` and has the same number of entries and bins;
+     * otherwise, `false` is returned and the histograms are left unchanged.
+     */
+    bool readFile(std::string const& fileName, std::string const& key);
+
+  private:
+    std::size_t fNBins = 0U;
+    std::size_t fNChannels = 0U;
+    std::vector<float> fEdges;              ///< Bin edges, class by class.
+    std::vector<std::uint8_t> fClasses;     ///< Class of each entry.
+    std::vector<std::uint8_t> fCumulative;  ///< Cumulative contents, entry by entry.
+
+    /// One view per voxel.
+    std::vector<PropagationTimeHistogramVoxel> fVoxels;
+
+    /// Creates the views of the voxels.
+    void makeVoxels(std::size_t nVoxels);
+
+  }; // class PropagationTimeHistograms
+
+} // namespace phot
+
+//------------------------------------------------------------------------------
+inline auto
+phot::PropagationTimeHistogramVoxel::operator[](size_type channel) const -> value_type
+{
+  return fHistograms ? fHistograms->histogram(fFirstEntry + channel) : value_type{};
+}
+
+//------------------------------------------------------------------------------
+
+#endif // LARSIM_PHOTONPROPAGATION_PROPAGATIONTIMEHISTOGRAMS_H
@@ -0,0 +1,120 @@
+/**
+ * @file   larsim/PhotonPropagation/PropagationTimeParametrization.cxx
+ * @brief  Parametrized photon propagation time distributions of a library.
+ * @see    larsim/PhotonPropagation/PropagationTimeParametrization.h
+ */
+
+#include "larsim/PhotonPropagation/PropagationTimeParametrization.h"
+
+#include "TF1.h"
+
+// C/C++ standard libraries
+#include <algorithm> // std::copy_n()
+#include <cmath>     // std::isnan()
+#include <limits>
+#include <utility>   // std::move()
+
+namespace phot {
+
+  //------------------------------------------------------------------------------
+  PropagationTimeParametrization::PropagationTimeParametrization(std::string formula,
+                                                                 std::size_t nParameters,
+                                                                 double maxRange,
+                                                                 std::size_t nVoxels,
+                                                                 std::size_t nChannels,
+                                                                 std::size_t nSamples,
+                                                                 std::size_t nQuantiles,
+                                                                 std::size_t cacheSize)
+    : fFormula(std::move(formula))
+    , fNParameters(nParameters)
+    , fMaxRange(maxRange)
+    , fNSamples(nSamples)
+    , fNQuantiles(nQuantiles)
+    , fCacheSize(cacheSize)
+    // the lower limit of the entries not set is NaN, marking them undefined
+    , fParameters(nVoxels * nChannels * nParameters, std::numeric_limits<float>::quiet_NaN())
+  {
+    fVoxels.reserve(nVoxels);
+    for (std::size_t voxel = 0; voxel < nVoxels; ++voxel)
+      fVoxels.emplace_back(*this, voxel * nChannels, nChannels);
+  }
+
+  //------------------------------------------------------------------------------
+  PropagationTimeParametrization::~PropagationTimeParametrization() = default;
+
+  //------------------------------------------------------------------------------
+  bool
+  PropagationTimeParametrization::isDefined(std::size_t entry) const
+  {
+    std::size_t const index = entry * fNParameters;
+    return (fNParameters > 0U) && (index < fParameters.size()) && !std::isnan(fParameters[index]);
+  }
+
+  //------------------------------------------------------------------------------
+  void
+  PropagationTimeParametrization::setParameters(std::size_t entry, float const* pars)
+  {
+    std::copy_n(pars, fNParameters, fParameters.begin() + entry * fNParameters);
+
+    // a distribution already tabulated is now obsolete
+    std::lock_guard<std::mutex> lock(fMutex);
+    fCache.erase(entry);
+  }
+
+  //------------------------------------------------------------------------------
+  auto
+  PropagationTimeParametrization::distribution(std::size_t entry) const
+    -> PropagationTimeSampler::Distribution_t
+  {
+    if (!isDefined(entry)) return nullptr;
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto const iCached = fCache.find(entry);
+    if (iCached != fCache.end()) return iCached->second;
+
+    // holders of the distributions being dropped keep them alive
+    if (fCache.size() >= fCacheSize) fCache.clear();
+
+    auto distr = makeDistribution(entry);
+    fCache.emplace(entry, distr);
+    return distr;
+  }
+
+  //------------------------------------------------------------------------------
+  std::size_t
+  PropagationTimeParametrization::memoryFootprint() const
+  {
+    std::size_t bytes = fParameters.capacity() * sizeof(float) +
+                        fVoxels.capacity() * sizeof(PropagationTimeFunctions);
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    // each table has one distribution, with its limits and its quantiles
+    bytes += fCache.size() * (sizeof(InverseCDFTable) + 2 * sizeof(double) +
+                              fNQuantiles * sizeof(float));
+    if (fShape) bytes += sizeof(TF1) + fShape->GetNpar() * sizeof(double);
+    return bytes;
+  }
+
+  //------------------------------------------------------------------------------
+  auto
+  PropagationTimeParametrization::makeDistribution(std::size_t entry) const
+    -> PropagationTimeSampler::Distribution_t
+  {
+    if (!fShape) {
+      fShape = std::make_unique<TF1>("PhotonLibraryTiming", fFormula.c_str(), 0.0, fMaxRange);
+      fShape->SetParameter(0, 0.0); // kept as is for backward compatibility
+    }
+
+    float const* pars = fParameters.data() + entry * fNParameters;
+    for (std::size_t k = 1; k < fNParameters; ++k)
+      fShape->SetParameter(k, pars[k]);
+
+    auto table = std::make_shared<InverseCDFTable>(1U, fNQuantiles);
+    table->fill(
+      0U, [this](double t) { return fShape->Eval(t); }, pars[0], fMaxRange, fNSamples);
+    return table;
+  }
+
+  //------------------------------------------------------------------------------
+
+} // namespace phot
@@ -0,0 +1,222 @@
+/**
+ * @file   larsim/PhotonPropagation/PropagationTimeParametrization.h
+ * @brief  Parametrized photon propagation time distributions of a library.
+ * @see    larsim/PhotonPropagation/PropagationTimeParametrization.cxx
+ *
+ * A photon library may describe the distribution of the propagation time from
+ * each voxel to each optical channel with a functional form shared by all the
+ * entries, each one with its own parameters.
+ * Instead of one ROOT `TF1` per entry, the parameters are stored in a single
+ * flat array, a single `TF1` holds the functional form, and each distribution
+ * is tabulated for sampling (`phot::InverseCDFTable`) the first time it is
+ * needed.
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_PROPAGATIONTIMEPARAMETRIZATION_H
+#define LARSIM_PHOTONPROPAGATION_PROPAGATIONTIMEPARAMETRIZATION_H
+
+// LArSoft libraries
+#include "larsim/PhotonPropagation/InverseCDFTable.h"
+
+// C/C++ standard libraries
+#include <cstddef> // std::size_t
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TF1;
+
+namespace phot {
+
+  class PropagationTimeParametrization;
+
+  /// Access to the propagation time distribution of one library entry.
+  class PropagationTimeSampler {
+  public:
+    /// Type of the tabulated distribution (use with `InverseCDFTable::sample(0, u)`).
+    using Distribution_t = std::shared_ptr<InverseCDFTable const>;
+
+    /// Constructor: a sampler with no distribution.
+    PropagationTimeSampler() = default;
+
+    PropagationTimeSampler(PropagationTimeParametrization const& param, std::size_t entry)
+      : fParam(&param), fEntry(entry)
+    {}
+
+    /// Returns whether there is a distribution for this entry.
+    bool isValid() const;
+
+    /**
+     * @brief Returns the tabulated distribution, creating it if needed.
+     * @return the distribution, or a null pointer if `!isValid()`
+     *
+     * The returned object stays valid as long as it is held.
+     */
+    Distribution_t distribution() const;
+
+  private:
+    PropagationTimeParametrization const* fParam = nullptr;
+    std::size_t fEntry = 0U;
+  }; // PropagationTimeSampler
+
+  /// Samplers of all the optical channels of a voxel.
+  class PropagationTimeFunctions {
+  public:
+    using value_type = PropagationTimeSampler;
+    using size_type = std::size_t;
+
+    /// Constructor: no channel.
+    PropagationTimeFunctions() = default;
+
+    PropagationTimeFunctions(PropagationTimeParametrization const& param,
+                             std::size_t firstEntry,
+                             std::size_t nChannels)
+      : fParam(&param), fFirstEntry(firstEntry), fNChannels(nChannels)
+    {}
+
+    size_type
+    size() const
+    {
+      return fNChannels;
+    }
+
+    bool
+    empty() const
+    {
+      return fNChannels == 0U;
+    }
+
+    value_type
+    operator[](size_type channel) const
+    {
+      return {*fParam, fFirstEntry + channel};
+    }
+
+  private:
+    PropagationTimeParametrization const* fParam = nullptr;
+    std::size_t fFirstEntry = 0U;
+    std::size_t fNChannels = 0U;
+  }; // PropagationTimeFunctions
+
+  /**
+   * @brief Propagation time distributions sharing the same functional form.
+   *
+   * Each entry (voxel and channel, in the same layout as the library) has
+   * `nParameters()` parameters: the first one is the lower limit of the
+   * distribution, which extends up to `maxRange()`; the others are the
+   * parameters `1` to `nParameters() - 1` of the formula, whose parameter `0`
+   * is always set to `0` (for compatibility with older libraries).
+   * Entries whose parameters are never set have no distribution.
+   *
+   * The tabulated distributions are kept in a cache of limited size, which is
+   * emptied when full; the cache is thread-safe.
+   */
+  class PropagationTimeParametrization {
+  public:
+    PropagationTimeParametrization() = default;
+
+    /**
+     * @brief Constructor: entries have no distribution yet.
+     * @param formula the functional form of the distributions (ROOT syntax)
+     * @param nParameters number of parameters stored per entry
+     * @param maxRange upper limit of all distributions
+     * @param nVoxels number of voxels in the library
+     * @param nChannels number of optical channels in the library
+     * @param nSamples `TF1::GetRandom()`-like sampling points of each distribution
+     * @param nQuantiles quantiles tabulated for each distribution
+     * @param cacheSize maximum number of distributions held at the same time
+     */
+    PropagationTimeParametrization(std::string formula,
+                                   std::size_t nParameters,
+                                   double maxRange,
+                                   std::size_t nVoxels,
+                                   std::size_t nChannels,
+                                   std::size_t nSamples = 100U,
+                                   std::size_t nQuantiles = 256U,
+                                   std::size_t cacheSize = 65536U);
+
+    ~PropagationTimeParametrization();
+
+    /// Number of parameters per entry (the first is the lower limit).
+    std::size_t
+    nParameters() const
+    {
+      return fNParameters;
+    }
+
+    /// Upper limit of all distributions.
+    double
+    maxRange() const
+    {
+      return fMaxRange;
+    }
+
+    /// Returns whether `entry` has a distribution.
+    bool isDefined(std::size_t entry) const;
+
+    /// Returns the parameter `par` of `entry`.
+    float
+    parameter(std::size_t entry, std::size_t par) const
+    {
+      return fParameters[entry * fNParameters + par];
+    }
+
+    /// Sets all the `nParameters()` parameters of `entry` from `pars`.
+    void setParameters(std::size_t entry, float const* pars);
+
+    /// Returns the samplers for all the channels in `voxel`.
+    PropagationTimeFunctions const&
+    voxel(std::size_t voxel) const
+    {
+      return fVoxels[voxel];
+    }
+
+    /// Returns the distribution of `entry` (null if not defined).
+    PropagationTimeSampler::Distribution_t distribution(std::size_t entry) const;
+
+    /// Returns the estimated memory of parameters and tabulated distributions [bytes].
+    std::size_t memoryFootprint() const;
+
+  private:
+    std::string fFormula;
+    std::size_t fNParameters = 0U;
+    double fMaxRange = 0.;
+    std::size_t fNSamples = 100U;
+    std::size_t fNQuantiles = 256U;
+    std::size_t fCacheSize = 65536U;
+
+    /// Parameters, `fNParameters` per entry.
+    std::vector<float> fParameters;
+
+    /// One view per voxel.
+    std::vector<PropagationTimeFunctions> fVoxels;
+
+    mutable std::mutex fMutex;           ///< Protects the members below.
+    mutable std::unique_ptr<TF1> fShape; ///< Shared functional form.
+    mutable std::unordered_map<std::size_t, PropagationTimeSampler::Distribution_t> fCache;
+
+    /// Tabulates the distribution of `entry` (`fMutex` must be held).
+    PropagationTimeSampler::Distribution_t makeDistribution(std::size_t entry) const;
+
+  }; // class PropagationTimeParametrization
+
+} // namespace phot
+
+//------------------------------------------------------------------------------
+inline bool
+phot::PropagationTimeSampler::isValid() const
+{
+  return fParam && fParam->isDefined(fEntry);
+}
+
+inline auto
+phot::PropagationTimeSampler::distribution() const -> Distribution_t
+{
+  return fParam ? fParam->distribution(fEntry) : nullptr;
+}
+
+//------------------------------------------------------------------------------
+
+#endif // LARSIM_PHOTONPROPAGATION_PROPAGATIONTIMEPARAMETRIZATION_H
@@ -16,5 +16,15 @@ namespace phot
     ScintTime::ScintTime()
     {
     }
+
+    //----------------------------------------------------------------------
+    void ScintTime::GenScintTimes(bool is_fast, double* times, std::size_t n, CLHEP::HepRandomEngine& engine)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            GenScintTime(is_fast, engine);
+            times[i] = timing;
+        }
+    }
 }
 
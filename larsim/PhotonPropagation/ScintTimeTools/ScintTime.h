@@ -16,6 +16,7 @@
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
 //#include <string>
+#include <cstddef> // std::size_t
 
 namespace phot
 {
@@ -27,6 +28,10 @@ namespace phot
 
         virtual void GenScintTime(bool is_fast, CLHEP::HepRandomEngine& engine)      = 0;
         double GetScintTime() const        {return timing;}
+
+        /// Fills `times[0]` to `times[n - 1]` with the emission times of `n` photons;
+        /// by default, calls `GenScintTime()` once per photon.
+        virtual void GenScintTimes(bool is_fast, double* times, std::size_t n, CLHEP::HepRandomEngine& engine);
         
     protected:
         double timing;
@@ -21,6 +21,7 @@
 // Random number engine
 #include "CLHEP/Random/RandFlat.h"
 #include <string>
+#include <vector>
 
 namespace phot
 {
@@ -29,6 +30,7 @@ namespace phot
     public:
         explicit ScintTimeLAr(fhicl::ParameterSet const& pset);
         void GenScintTime(bool is_fast, CLHEP::HepRandomEngine& engine)  ;
+        void GenScintTimes(bool is_fast, double* times, std::size_t n, CLHEP::HepRandomEngine& engine) override;
         
     private:
         int           LogLevel;
@@ -38,6 +40,8 @@ namespace phot
         double         SDTime;                        // PureLAr: decay time of slow LAr scintillation;
         double         FRTime;                        // PureLAr: rising time of fast LAr scinitllation;
         double         FDTime;                        // PureLAr: decay time of fast LAr scintillation;
+
+        std::vector<double> RandomBuffer;             // uniform random numbers for GenScintTimes()
         
         // general functions
         double single_exp(double t, double tau2);
@@ -85,6 +85,32 @@ namespace phot
             }
         }
     }
+
+    //......................................................................
+    // Bulk version of GenScintTime(), without rejection sampling: the distribution with rise time
+    // tau1 and decay time tau2 is the one of the sum of two exponential times, with decay constants
+    // tau2 and tau1 * tau2 / (tau1 + tau2), so each time is drawn by inverse transform from two
+    // random numbers. The numbers drawn differ from the ones of GenScintTime(), the distribution
+    // is the same.
+    void ScintTimeLAr::GenScintTimes(bool is_fast, double* times, std::size_t n, CLHEP::HepRandomEngine& engine)
+    {
+        if (n == 0) return;
+
+        double const tau1 = is_fast? FRTime: SRTime;
+        double const tau2 = is_fast? FDTime: SDTime;
+
+        CLHEP::RandFlat::shootArray(&engine, static_cast<int>(n), times);
+        for (std::size_t i = 0; i < n; ++i)
+            times[i] = -tau2 * std::log(times[i]);
+
+        if ((tau1 == 0.0) || (tau1 == -1.0)) return;
+
+        double const tauRise = tau1 * tau2 / (tau1 + tau2);
+        RandomBuffer.resize(n);
+        CLHEP::RandFlat::shootArray(&engine, static_cast<int>(n), RandomBuffer.data());
+        for (std::size_t i = 0; i < n; ++i)
+            times[i] -= tauRise * std::log(RandomBuffer[i]);
+    }
 }
     
 DEFINE_ART_CLASS_TOOL(phot::ScintTimeLAr)
@@ -0,0 +1,192 @@
+/**
+ * @file   larsim/PhotonPropagation/SolidAngleGrid.cxx
+ * @brief  Tabulated solid angle of an optical detector, for fast lookup.
+ * @see    larsim/PhotonPropagation/SolidAngleGrid.h
+ */
+
+#include "larsim/PhotonPropagation/SolidAngleGrid.h"
+
+#include "cetlib_except/exception.h"
+
+// C/C++ standard libraries
+#include <algorithm> // std::count()
+#include <cstring>   // std::memcmp()
+#include <fstream>
+#include <utility> // std::move()
+
+namespace {
+
+  /// Identifier at the beginning of each grid file.
+  constexpr char Magic[8] = {'L', 'A', 'R', 'S', 'O', 'L', 'A', '\0'};
+
+  /// Version of the grid file format.
+  constexpr std::uint32_t FormatVersion = 1U;
+
+  template <typename T>
+  void
+  writeValue(std::ostream& out, T const& value)
+  {
+    out.write(reinterpret_cast<char const*>(&value), sizeof(T));
+  }
+
+  template <typename T>
+  void
+  writeVector(std::ostream& out, std::vector<T> const& data)
+  {
+    out.write(reinterpret_cast<char const*>(data.data()), data.size() * sizeof(T));
+  }
+
+  template <typename T>
+  bool
+  readValue(std::istream& in, T& value)
+  {
+    return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+  }
+
+  template <typename T>
+  bool
+  readVector(std::istream& in, std::vector<T>& data)
+  {
+    return bool(in.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(T)));
+  }
+
+} // local namespace
+
+namespace phot {
+
+  //------------------------------------------------------------
+  SolidAngleGrid::SolidAngleGrid(Coords_t const& range, std::size_t nPoints)
+    : fNPoints(nPoints), fRange(range)
+  {
+    if (nPoints < 2) {
+      throw cet::exception("SolidAngleGrid") << "At least two nodes per axis are required.\n";
+    }
+    for (std::size_t axis = 0; axis < 3U; ++axis) {
+      if (!(range[axis] > 0.0)) {
+        throw cet::exception("SolidAngleGrid")
+          << "Invalid range " << range[axis] << " on axis " << axis << ".\n";
+      }
+      fInvRange[axis] = 1.0 / range[axis];
+    }
+  }
+
+  //------------------------------------------------------------
+  double
+  SolidAngleGrid::exactCellFraction() const
+  {
+    if (fExactCells.empty()) return 0.0;
+    return double(std::count(fExactCells.begin(), fExactCells.end(), 1)) / fExactCells.size();
+  }
+
+  //------------------------------------------------------------
+  void
+  SolidAngleGrid::write(std::ostream& out) const
+  {
+    writeValue(out, std::uint64_t(fNPoints));
+    writeValue(out, fRange);
+    writeValue(out, std::uint8_t(isFilled()));
+    if (!isFilled()) return;
+    writeVector(out, fValues);
+    writeVector(out, fExactCells);
+  }
+
+  //------------------------------------------------------------
+  bool
+  SolidAngleGrid::read(std::istream& in)
+  {
+    std::uint64_t nPoints = 0;
+    Coords_t range;
+    std::uint8_t filled = 0;
+    if (!readValue(in, nPoints) || (nPoints < 2) || !readValue(in, range) ||
+        !readValue(in, filled))
+      return false;
+
+    SolidAngleGrid grid;
+    try {
+      grid = SolidAngleGrid(range, nPoints);
+    }
+    catch (cet::exception const&) {
+      return false;
+    }
+    if (filled) {
+      grid.fValues.resize(nPoints * nPoints * nPoints);
+      grid.fExactCells.resize((nPoints - 1) * (nPoints - 1) * (nPoints - 1));
+      if (!readVector(in, grid.fValues) || !readVector(in, grid.fExactCells)) return false;
+    }
+
+    *this = std::move(grid);
+    return true;
+  }
+
+  //------------------------------------------------------------
+  void
+  writeSolidAngleGrids(std::string const& fileName,
+                       std::string const& key,
+                       std::vector<SolidAngleGrid> const& grids)
+  {
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      throw cet::exception("SolidAngleGrid") << "Can't open '" << fileName << "' for writing.\n";
+    }
+
+    out.write(Magic, sizeof(Magic));
+    writeValue(out, FormatVersion);
+    writeValue(out, std::uint64_t(key.size()));
+    out.write(key.data(), key.size());
+    writeSolidAngleGrids(out, grids);
+
+    if (!out) {
+      throw cet::exception("SolidAngleGrid") << "Error while writing '" << fileName << "'.\n";
+    }
+  }
+
+  //------------------------------------------------------------
+  bool
+  readSolidAngleGrids(std::string const& fileName,
+                      std::string const& key,
+                      std::vector<SolidAngleGrid>& grids)
+  {
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in) return false;
+
+    char magic[sizeof(Magic)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)) != 0)
+      return false;
+
+    std::uint32_t version = 0;
+    if (!readValue(in, version) || (version != FormatVersion)) return false;
+
+    std::uint64_t keySize = 0;
+    if (!readValue(in, keySize) || (keySize != key.size())) return false;
+    std::string fileKey(keySize, '\0');
+    if (!in.read(fileKey.data(), keySize) || (fileKey != key)) return false;
+
+    return readSolidAngleGrids(in, grids);
+  }
+
+  //------------------------------------------------------------
+  void
+  writeSolidAngleGrids(std::ostream& out, std::vector<SolidAngleGrid> const& grids)
+  {
+    writeValue(out, std::uint64_t(grids.size()));
+    for (SolidAngleGrid const& grid : grids)
+      grid.write(out);
+  }
+
+  //------------------------------------------------------------
+  bool
+  readSolidAngleGrids(std::istream& in, std::vector<SolidAngleGrid>& grids)
+  {
+    std::uint64_t nGrids = 0;
+    if (!readValue(in, nGrids) || (nGrids != grids.size())) return false;
+
+    // read into a copy, so that the grids are untouched on failure
+    std::vector<SolidAngleGrid> fileGrids(nGrids);
+    for (SolidAngleGrid& grid : fileGrids)
+      if (!grid.read(in)) return false;
+
+    grids = std::move(fileGrids);
+    return true;
+  }
+
+} // namespace phot
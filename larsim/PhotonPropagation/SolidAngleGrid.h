@@ -0,0 +1,257 @@
+/**
+ * @file   larsim/PhotonPropagation/SolidAngleGrid.h
+ * @brief  Tabulated solid angle of an optical detector, for fast lookup.
+ * @see    larsim/PhotonPropagation/SolidAngleGrid.cxx
+ *
+ * The solid angle subtended by an optical detector, as used in the
+ * semi-analytic models, is a function of the absolute value of the three
+ * coordinates of the emission point relative to the detector centre.
+ * This library tabulates such a function on a grid and evaluates it by
+ * trilinear interpolation, falling back to the exact function where the
+ * interpolation is not accurate enough.
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_SOLIDANGLEGRID_H
+#define LARSIM_PHOTONPROPAGATION_SOLIDANGLEGRID_H
+
+// C/C++ standard libraries
+#include <array>
+#include <cmath>   // std::sqrt()
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace phot {
+
+  /**
+   * @brief Function of three non-negative coordinates tabulated on a grid.
+   *
+   * Each axis spans `[ 0, range ]` with `nPoints()` nodes. The nodes are
+   * denser close to the detector, where the solid angle changes faster:
+   * the node `i` of an axis is at `range * (i / (nPoints() - 1))^2`, so that
+   * the spacing is proportional to the square root of the distance.
+   *
+   * After the function is tabulated (`fill()`), every grid cell is checked by
+   * comparing the interpolated value in its centre with the exact one; cells
+   * where the relative difference exceeds the tolerance are marked, and the
+   * exact function is used inside them. The exact function is also used for
+   * points outside the grid.
+   */
+  class SolidAngleGrid {
+  public:
+    using Coords_t = std::array<double, 3U>;
+
+    SolidAngleGrid() = default;
+
+    /// Creates an empty grid with `nPoints` nodes on each axis.
+    SolidAngleGrid(Coords_t const& range, std::size_t nPoints);
+
+    /// Number of nodes on each axis.
+    std::size_t
+    nPoints() const
+    {
+      return fNPoints;
+    }
+
+    /// Returns whether the grid has been filled.
+    bool
+    isFilled() const
+    {
+      return !fValues.empty();
+    }
+
+    /// Fraction of the cells where the exact function is used.
+    double exactCellFraction() const;
+
+    /**
+     * @brief Tabulates the function `f`.
+     * @param f callable returning the value at `Coords_t` coordinates
+     * @param tolerance maximum relative error of the interpolation
+     */
+    template <typename Func>
+    void fill(Func&& f, double tolerance);
+
+    /**
+     * @brief Returns the value at `coords`, evaluating `exact` if needed.
+     * @param coords (non-negative) coordinates of the point
+     * @param exact callable returning the exact value at `Coords_t` coordinates
+     */
+    template <typename Func>
+    double value(Coords_t const& coords, Func&& exact) const;
+
+    /// Writes the grid into a binary stream.
+    void write(std::ostream& out) const;
+
+    /// Replaces the grid with the one from `in`; returns `false` on failure.
+    bool read(std::istream& in);
+
+  private:
+    std::size_t fNPoints = 0U;
+    Coords_t fRange{{0.0, 0.0, 0.0}};
+    Coords_t fInvRange{{0.0, 0.0, 0.0}}; ///< Inverse of `fRange`.
+
+    std::vector<float> fValues;            ///< Function at the nodes (x fastest).
+    std::vector<std::uint8_t> fExactCells; ///< Whether each cell needs `exact`.
+
+    std::size_t
+    nodeIndex(std::size_t ix, std::size_t iy, std::size_t iz) const
+    {
+      return (iz * fNPoints + iy) * fNPoints + ix;
+    }
+
+    std::size_t
+    cellIndex(std::size_t ix, std::size_t iy, std::size_t iz) const
+    {
+      return (iz * (fNPoints - 1) + iy) * (fNPoints - 1) + ix;
+    }
+
+    /// Coordinate of the node `i` on the axis `axis`.
+    double
+    nodePosition(std::size_t axis, double i) const
+    {
+      double const u = i / (fNPoints - 1);
+      return fRange[axis] * u * u;
+    }
+
+    /// Finds the cell containing `coords` and the position within it;
+    /// returns `false` if the point is outside the grid.
+    bool locate(Coords_t const& coords,
+                std::array<std::size_t, 3U>& cell,
+                Coords_t& frac) const;
+
+    /// Interpolated value in the cell `cell`.
+    double interpolate(std::array<std::size_t, 3U> const& cell, Coords_t const& frac) const;
+
+  }; // class SolidAngleGrid
+
+  /**
+   * @brief Writes a set of grids into the specified file.
+   * @param fileName path of the file to be (over)written
+   * @param key string describing the configuration the grids come from
+   * @param grids the grids to be written
+   * @throw cet::exception (category: `"SolidAngleGrid"`) on error
+   */
+  void writeSolidAngleGrids(std::string const& fileName,
+                            std::string const& key,
+                            std::vector<SolidAngleGrid> const& grids);
+
+  /**
+   * @brief Reads a set of grids from the specified file.
+   * @param fileName path of the file to be read
+   * @param key expected configuration key
+   * @param grids (output) the grids read; they are as many as already there
+   * @return whether the grids were read
+   *
+   * The grids are read only if the file exists, is valid, was created with
+   * the same `key` and contains as many grids as `grids`; otherwise, `false`
+   * is returned and `grids` is left unchanged.
+   */
+  bool readSolidAngleGrids(std::string const& fileName,
+                           std::string const& key,
+                           std::vector<SolidAngleGrid>& grids);
+
+  /// Writes a set of grids (without file header) into a binary stream.
+  void writeSolidAngleGrids(std::ostream& out, std::vector<SolidAngleGrid> const& grids);
+
+  /**
+   * @brief Reads a set of grids written by `writeSolidAngleGrids(std::ostream&, ...)`.
+   * @param in the stream to read from
+   * @param grids (output) the grids read; they are as many as already there
+   * @return whether the grids were read (if not, `grids` is left unchanged)
+   */
+  bool readSolidAngleGrids(std::istream& in, std::vector<SolidAngleGrid>& grids);
+
+} // namespace phot
+
+//------------------------------------------------------------------------------
+inline bool
+phot::SolidAngleGrid::locate(Coords_t const& coords,
+                             std::array<std::size_t, 3U>& cell,
+                             Coords_t& frac) const
+{
+  double const nCells = double(fNPoints - 1);
+  for (std::size_t axis = 0; axis < 3U; ++axis) {
+    double const x = coords[axis] * fInvRange[axis];
+    if (!(x >= 0.0) || (x > 1.0)) return false;
+    double const pos = std::sqrt(x) * nCells;
+    std::size_t i = static_cast<std::size_t>(pos);
+    if (i >= fNPoints - 1) i = fNPoints - 2;
+    // interpolation is linear in the coordinate, not in the node index
+    double const low = nodePosition(axis, double(i));
+    double const high = nodePosition(axis, double(i + 1));
+    cell[axis] = i;
+    frac[axis] = (coords[axis] - low) / (high - low);
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+inline double
+phot::SolidAngleGrid::interpolate(std::array<std::size_t, 3U> const& cell,
+                                  Coords_t const& frac) const
+{
+  auto const [ix, iy, iz] = cell;
+  std::size_t const dy = fNPoints, dz = fNPoints * fNPoints;
+  float const* v = fValues.data() + nodeIndex(ix, iy, iz);
+  double const fx = frac[0], fy = frac[1], fz = frac[2];
+  double const c00 = v[0] + fx * (v[1] - v[0]);
+  double const c10 = v[dy] + fx * (v[dy + 1] - v[dy]);
+  double const c01 = v[dz] + fx * (v[dz + 1] - v[dz]);
+  double const c11 = v[dz + dy] + fx * (v[dz + dy + 1] - v[dz + dy]);
+  double const c0 = c00 + fy * (c10 - c00);
+  double const c1 = c01 + fy * (c11 - c01);
+  return c0 + fz * (c1 - c0);
+}
+
+//------------------------------------------------------------------------------
+template <typename Func>
+void
+phot::SolidAngleGrid::fill(Func&& f, double tolerance)
+{
+  std::size_t const n = fNPoints;
+  fValues.resize(n * n * n);
+  for (std::size_t iz = 0; iz < n; ++iz) {
+    for (std::size_t iy = 0; iy < n; ++iy) {
+      for (std::size_t ix = 0; ix < n; ++ix) {
+        Coords_t const p{
+          {nodePosition(0, double(ix)), nodePosition(1, double(iy)), nodePosition(2, double(iz))}};
+        fValues[nodeIndex(ix, iy, iz)] = float(f(p));
+      }
+    }
+  }
+
+  // check each cell in its centre; non-finite values fail the check
+  fExactCells.assign((n - 1) * (n - 1) * (n - 1), 0);
+  Coords_t const half{{0.5, 0.5, 0.5}};
+  for (std::size_t iz = 0; iz < n - 1; ++iz) {
+    for (std::size_t iy = 0; iy < n - 1; ++iy) {
+      for (std::size_t ix = 0; ix < n - 1; ++ix) {
+        Coords_t const p{{0.5 * (nodePosition(0, double(ix)) + nodePosition(0, double(ix + 1))),
+                          0.5 * (nodePosition(1, double(iy)) + nodePosition(1, double(iy + 1))),
+                          0.5 * (nodePosition(2, double(iz)) + nodePosition(2, double(iz + 1)))}};
+        double const exact = f(p);
+        double const interpolated = interpolate({{ix, iy, iz}}, half);
+        if (!(std::abs(interpolated - exact) <= tolerance * std::abs(exact)))
+          fExactCells[cellIndex(ix, iy, iz)] = 1;
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+template <typename Func>
+double
+phot::SolidAngleGrid::value(Coords_t const& coords, Func&& exact) const
+{
+  std::array<std::size_t, 3U> cell;
+  Coords_t frac;
+  if (!locate(coords, cell, frac) || fExactCells[cellIndex(cell[0], cell[1], cell[2])])
+    return exact(coords);
+  return interpolate(cell, frac);
+}
+
+//------------------------------------------------------------------------------
+
+#endif // LARSIM_PHOTONPROPAGATION_SOLIDANGLEGRID_H
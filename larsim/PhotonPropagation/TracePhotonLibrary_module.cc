@@ -0,0 +1,287 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       TracePhotonLibrary
+// Plugin Type: analyzer (art v3_05_00)
+// File:        TracePhotonLibrary_module.cc
+//
+// Builds a photon library tracing only the optical photons, with
+// `phot::OpticalPhotonTracer`, instead of simulating them in full Geant4
+// (`LightSource`, `LArG4` and a photon counter). Each voxel is filled with
+// `PhotonsPerVoxel` photons uniformly distributed in its volume, isotropic,
+// with energy from a gaussian distribution (like `LightSource` in scan mode).
+//
+// The geometry is the one of the geometry service. The optical properties are
+// the ones `LArG4` gives to Geant4, collected by
+// `larg4::MaterialPropertyLoader`: absorption and Rayleigh scattering in
+// liquid argon, the reflectances of the surfaces (with their diffuse
+// fractions in the simple boundary model) and the wavelength shifting in the
+// `TPB` material, if its properties are enabled. Optical detectors are the
+// volumes whose name includes the one of the optical detector volumes of the
+// geometry (`OpDetGeoName()`).
+//
+// The library is filled and written by `PhotonVisibilityService`, which must
+// be configured as for a library build job (`LibraryBuildJob: true`), shard
+// file included. The voxels are traced in parallel, each with its own random
+// engine seeded from the one of this module, so that the result does not
+// depend on the number of threads. The work happens at the beginning of the
+// job; no event is needed.
+//
+// Configuration:
+//  * `FirstVoxel` (integer, default: `0`), `LastVoxel` (integer, default:
+//    `-1`, the last one): range of voxels to be filled
+//  * `PhotonsPerVoxel` (integer): photons traced from each voxel
+//  * `P`, `SigmaP` (real, default: `9.7` and `0.25`): mean and width of the
+//    photon energy [eV]
+//  * `MaxSteps` (integer, default: `1000`): photons are dropped after this
+//    many interactions or boundary crossings
+//  * `NThreads` (integer, default: `0`, all available): threads tracing
+//  * `Seed` (integer, optional): random seed (default from `NuRandomService`)
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "canvas/Utilities/Exception.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+#include "nurandom/RandomUtils/NuRandomService.h"
+
+#include "larcore/CoreUtils/ServiceUtil.h"
+#include "larcore/Geometry/Geometry.h"
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+#include "lardata/DetectorInfoServices/LArPropertiesService.h"
+#include "larsim/LegacyLArG4/MaterialPropertyLoader.h"
+#include "larsim/PhotonPropagation/OpticalPhotonTracer.h"
+#include "larsim/PhotonPropagation/PhotonVisibilityService.h"
+#include "larsim/Simulation/PhotonVoxels.h"
+
+#include "TGeoManager.h"
+#include "TGeoNode.h"
+#include "TGeoVolume.h"
+
+#include "CLHEP/Random/MixMaxRng.h"
+#include "CLHEP/Random/RandFlat.h"
+#include "CLHEP/Random/RandGaussQ.h"
+#include "CLHEP/Units/SystemOfUnits.h"
+
+#include "tbb/parallel_for.h"
+#include "tbb/task_arena.h"
+
+#include <algorithm> // std::min()
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+  /// Converts a property from `larg4::MaterialPropertyLoader` (CLHEP units).
+  phot::OpticalPhotonTracer::Spectrum_t
+  toSpectrum(std::map<double, double> const& property, double unit)
+  {
+    phot::OpticalPhotonTracer::Spectrum_t spectrum;
+    for (auto const& [energy, value] : property)
+      spectrum.emplace_hint(spectrum.end(), energy / CLHEP::eV, value / unit);
+    return spectrum;
+  }
+
+} // local namespace
+
+namespace phot {
+
+  class TracePhotonLibrary : public art::EDAnalyzer {
+  public:
+    explicit TracePhotonLibrary(fhicl::ParameterSet const& p);
+
+    // Plugins should not be copied or assigned.
+    TracePhotonLibrary(TracePhotonLibrary const&) = delete;
+    TracePhotonLibrary(TracePhotonLibrary&&) = delete;
+    TracePhotonLibrary& operator=(TracePhotonLibrary const&) = delete;
+    TracePhotonLibrary& operator=(TracePhotonLibrary&&) = delete;
+
+    void beginJob() override;
+    void analyze(art::Event const&) override {}
+
+  private:
+    int fFirstVoxel;
+    int fLastVoxel;
+    unsigned int fPhotonsPerVoxel;
+    double fP;
+    double fSigmaP;
+    unsigned int fMaxSteps;
+    unsigned int fNThreads;
+
+    CLHEP::HepRandomEngine& fEngine;
+
+    /// Collects the optical properties from the services.
+    OpticalPhotonTracer::Config_t makeTracerConfig() const;
+  };
+
+  //--------------------------------------------------------------------
+  TracePhotonLibrary::TracePhotonLibrary(fhicl::ParameterSet const& p)
+    : EDAnalyzer(p)
+    , fFirstVoxel(p.get<int>("FirstVoxel", 0))
+    , fLastVoxel(p.get<int>("LastVoxel", -1))
+    , fPhotonsPerVoxel(p.get<unsigned int>("PhotonsPerVoxel"))
+    , fP(p.get<double>("P", 9.7))
+    , fSigmaP(p.get<double>("SigmaP", 0.25))
+    , fMaxSteps(p.get<unsigned int>("MaxSteps", 1000U))
+    , fNThreads(p.get<unsigned int>("NThreads", 0U))
+    , fEngine(art::ServiceHandle<rndm::NuRandomService>()->createEngine(*this, p, "Seed"))
+  {
+    if (fPhotonsPerVoxel == 0U) {
+      throw art::Exception(art::errors::Configuration)
+        << "TracePhotonLibrary: `PhotonsPerVoxel` must be positive.\n";
+    }
+  }
+
+  //--------------------------------------------------------------------
+  void
+  TracePhotonLibrary::beginJob()
+  {
+    art::ServiceHandle<PhotonVisibilityService> vis;
+    if (!vis->IsBuildJob()) {
+      throw art::Exception(art::errors::Configuration)
+        << "TracePhotonLibrary needs PhotonVisibilityService configured for a library build"
+           " (`LibraryBuildJob: true`).\n";
+    }
+    PhotonVisibilityService* const pvs = vis.get();
+
+    geo::GeometryCore const& geom = *lar::providerFrom<geo::Geometry>();
+    sim::PhotonVoxelDef const& voxelDef = vis->GetVoxelDef();
+    int const nVoxels = voxelDef.GetNVoxels();
+    int const lastVoxel = (fLastVoxel < 0) ? (nVoxels - 1) : std::min(fLastVoxel, nVoxels - 1);
+    if ((fFirstVoxel < 0) || (fFirstVoxel > lastVoxel)) {
+      throw art::Exception(art::errors::Configuration)
+        << "TracePhotonLibrary: invalid voxel range " << fFirstVoxel << " -- " << fLastVoxel
+        << " (" << nVoxels << " voxels).\n";
+    }
+
+    unsigned int const nOpDets = geom.NOpDets();
+    std::string const opDetName = geom.OpDetGeoName();
+    OpticalPhotonTracer const tracer{
+      *geom.ROOTGeoManager(),
+      makeTracerConfig(),
+      [&geom, opDetName, nOpDets](geo::Point_t const& point, TGeoNode const& node) -> int {
+        if (std::string(node.GetVolume()->GetName()).find(opDetName) == std::string::npos)
+          return -1;
+        unsigned int const opDet = geom.GetClosestOpDet(point);
+        return (opDet < nOpDets) ? static_cast<int>(opDet) : -1;
+      }};
+
+    vis->LoadLibrary(); // the empty library to be filled
+    bool const storeReflected = vis->StoreReflected();
+
+    // each voxel has its own random sequence
+    long const baseSeed = CLHEP::RandFlat::shootInt(&fEngine, 1L, 1L << 30);
+
+    mf::LogInfo("TracePhotonLibrary")
+      << "Tracing " << fPhotonsPerVoxel << " photons from each of the voxels " << fFirstVoxel
+      << " -- " << lastVoxel;
+
+    std::atomic<unsigned long long> nDetected{0ULL};
+    tbb::task_arena arena{(fNThreads > 0U) ? static_cast<int>(fNThreads) :
+                                             tbb::task_arena::automatic};
+    TGeoManager& manager = tracer.manager();
+    if ((arena.max_concurrency() > 1) && !manager.IsMultiThread())
+      manager.SetMaxThreads(arena.max_concurrency());
+
+    arena.execute([&] {
+      tbb::parallel_for(fFirstVoxel, lastVoxel + 1, [&](int voxel) {
+        OpticalPhotonTracer::Navigator navigator{manager};
+        CLHEP::MixMaxRng engine{baseSeed + voxel};
+        CLHEP::RandFlat flat(engine);
+        CLHEP::RandGaussQ gauss(engine);
+
+        sim::PhotonVoxel const box = voxelDef.GetPhotonVoxel(voxel);
+        geo::Point_t const& lower = box.GetLowerCorner();
+        geo::Point_t const& upper = box.GetUpperCorner();
+
+        std::vector<unsigned int> counts(nOpDets, 0U), reflCounts(nOpDets, 0U);
+        for (unsigned int i = 0; i < fPhotonsPerVoxel; ++i) {
+          geo::Point_t const start{flat.fire(lower.X(), upper.X()),
+                                   flat.fire(lower.Y(), upper.Y()),
+                                   flat.fire(lower.Z(), upper.Z())};
+          double const cosTheta = flat.fire(-1.0, 1.0);
+          double const sinTheta = std::sqrt(1.0 - cosTheta * cosTheta);
+          double const phi = flat.fire(0.0, 2.0 * M_PI);
+          geo::Vector_t const dir{sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta};
+
+          auto const [opDet, reflected] =
+            tracer.trace(navigator, start, dir, gauss.fire(fP, fSigmaP), engine);
+          if (opDet < 0) continue;
+          ++(reflected ? reflCounts : counts)[opDet];
+        }
+
+        unsigned long long nVoxelDetected = 0ULL;
+        for (unsigned int opDet = 0; opDet < nOpDets; ++opDet) {
+          pvs->SetLibraryEntry(voxel, opDet, double(counts[opDet]) / fPhotonsPerVoxel);
+          if (storeReflected) {
+            pvs->SetLibraryEntry(
+              voxel, opDet, double(reflCounts[opDet]) / fPhotonsPerVoxel, true);
+          }
+          nVoxelDetected += counts[opDet] + reflCounts[opDet];
+        }
+        nDetected += nVoxelDetected;
+      });
+    });
+
+    std::vector<PhotonVisibilityService::LightProd_t> lightProds;
+    lightProds.reserve(lastVoxel - fFirstVoxel + 1);
+    for (int voxel = fFirstVoxel; voxel <= lastVoxel; ++voxel)
+      lightProds.push_back({voxel, double(fPhotonsPerVoxel)});
+    vis->StoreLightProd(lightProds);
+
+    mf::LogInfo("TracePhotonLibrary")
+      << nDetected << " photons detected out of "
+      << (static_cast<unsigned long long>(fPhotonsPerVoxel) * lightProds.size());
+
+    vis->StoreLibrary();
+  }
+
+  //--------------------------------------------------------------------
+  OpticalPhotonTracer::Config_t
+  TracePhotonLibrary::makeTracerConfig() const
+  {
+    larg4::MaterialPropertyLoader loader;
+    loader.GetPropertiesFromServices(
+      art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataForJob());
+
+    OpticalPhotonTracer::Config_t config;
+    config.maxSteps = fMaxSteps;
+
+    auto const& LArProps = loader.GetMaterialProperties("LAr");
+    auto const LArProperty = [&LArProps](std::string const& name) {
+      auto const iProp = LArProps.find(name);
+      return (iProp == LArProps.end()) ? std::map<double, double>{} : iProp->second;
+    };
+    OpticalPhotonTracer::Medium_t& LAr = config.media["LAr"];
+    LAr.absorptionLength = toSpectrum(LArProperty("ABSLENGTH"), CLHEP::cm);
+    LAr.rayleighLength = toSpectrum(LArProperty("RAYLEIGH"), CLHEP::cm);
+
+    // the loader stores the reflectances as LAr properties (simple boundaries)
+    // or as properties of the reflecting materials
+    detinfo::LArProperties const* larp = lar::providerFrom<detinfo::LArPropertiesService>();
+    for (auto const& reflectances : larp->SurfaceReflectances()) {
+      std::string const& material = reflectances.first;
+      OpticalPhotonTracer::Surface_t& surface = config.surfaces[material];
+      surface.reflectance = toSpectrum(LArProperty("REFLECTANCE_" + material), 1.0);
+      if (surface.reflectance.empty())
+        surface.reflectance = toSpectrum(loader.GetMaterialProperty(material, "REFLECTIVITY"), 1.0);
+      surface.diffuseFraction =
+        toSpectrum(LArProperty("DIFFUSE_REFLECTANCE_FRACTION_" + material), 1.0);
+    }
+
+    if (larp->ExtraMatProperties()) {
+      config.media["TPB"].wlsAbsorptionLength =
+        toSpectrum(loader.GetMaterialProperty("TPB", "WLSABSLENGTH"), CLHEP::cm);
+      config.wlsEmission = toSpectrum(loader.GetMaterialProperty("TPB", "WLSCOMPONENT"), 1.0);
+    }
+
+    return config;
+  }
+
+} // namespace phot
+
+DEFINE_ART_MODULE(phot::TracePhotonLibrary)
@@ -0,0 +1,129 @@
+/**
+ * @file   larsim/PhotonPropagation/VisibilityInterpolation.h
+ * @brief  Kernel blending visibility rows of neighbouring voxels.
+ *
+ * This is a header-only library.
+ *
+ * The kernel computes, for all the channels at once, the weighted sum of the
+ * (up to) eight library rows of the voxels around a point, as required by the
+ * trilinear interpolation of `phot::PhotonVisibilityService`.
+ * A vectorized implementation is used when the compiler targets AVX-512 or
+ * AVX2 with FMA (e.g. `-march=native`); a plain loop is used otherwise,
+ * which compilers usually vectorize with the baseline instruction set.
+ */
+
+#ifndef LARSIM_PHOTONPROPAGATION_VISIBILITYINTERPOLATION_H
+#define LARSIM_PHOTONPROPAGATION_VISIBILITYINTERPOLATION_H
+
+// C/C++ standard libraries
+#include <algorithm> // std::max()
+#include <array>
+#include <cstddef> // std::size_t
+#include <vector>
+
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#endif
+
+namespace phot {
+
+  /// Number of voxels contributing to a trilinear interpolation.
+  constexpr std::size_t NInterpolationNeighbours = 8U;
+
+  /**
+   * @brief Writes into `out` the weighted sum of the specified rows.
+   * @param out (output) buffer of `n` values
+   * @param rows start of each of the rows to be blended, `nullptr` if unused
+   * @param weights weight of each row
+   * @param n number of values in each row
+   *
+   * Rows which are `nullptr` or have a weight of zero are skipped.
+   * The result is `out[i] = sum_k weights[k] * rows[k][i]`
+   * (accumulated in `float`, in increasing `k` order).
+   */
+  inline void
+  blendVisibilityRows(float* out,
+                      std::array<float const*, NInterpolationNeighbours> const& rows,
+                      std::array<float, NInterpolationNeighbours> const& weights,
+                      std::size_t n)
+  {
+    // compact the contributing rows first, so that the inner loops are dense
+    std::array<float const*, NInterpolationNeighbours> used;
+    std::array<float, NInterpolationNeighbours> w;
+    std::size_t nUsed = 0U;
+    for (std::size_t k = 0; k < NInterpolationNeighbours; ++k) {
+      if (!rows[k] || (weights[k] == 0.0f)) continue;
+      used[nUsed] = rows[k];
+      w[nUsed] = weights[k];
+      ++nUsed;
+    }
+
+    std::size_t i = 0U;
+
+#if defined(__AVX512F__)
+    for (; i + 16U <= n; i += 16U) {
+      __m512 acc = _mm512_setzero_ps();
+      for (std::size_t k = 0; k < nUsed; ++k)
+        acc = _mm512_fmadd_ps(_mm512_set1_ps(w[k]), _mm512_loadu_ps(used[k] + i), acc);
+      _mm512_storeu_ps(out + i, acc);
+    }
+#elif defined(__AVX2__) && defined(__FMA__)
+    for (; i + 8U <= n; i += 8U) {
+      __m256 acc = _mm256_setzero_ps();
+      for (std::size_t k = 0; k < nUsed; ++k)
+        acc = _mm256_fmadd_ps(_mm256_set1_ps(w[k]), _mm256_loadu_ps(used[k] + i), acc);
+      _mm256_storeu_ps(out + i, acc);
+    }
+#endif
+
+    // scalar remainder (or the whole row, if no vector instructions are used)
+    for (std::size_t j = i; j < n; ++j)
+      out[j] = 0.0f;
+    for (std::size_t k = 0; k < nUsed; ++k) {
+      float const* row = used[k];
+      float const weight = w[k];
+      for (std::size_t j = i; j < n; ++j)
+        out[j] += weight * row[j];
+    }
+
+  } // blendVisibilityRows()
+
+  /**
+   * @brief Writes into `out` the weighted sum of the library rows of voxels.
+   * @param out (output) buffer of `n` values
+   * @param voxels voxel of each row to be blended, negative if unused
+   * @param weights weight of each row
+   * @param n number of values to be blended
+   * @param rowSize number of values `copyRow` writes (at least `n` are used)
+   * @param copyRow `bool copyRow(int voxel, float* dest)` copies a row
+   * @param buffer storage for the copies of the rows
+   *
+   * Each row is copied into `buffer` as soon as it is fetched, because a
+   * library may return all the rows in the same buffer (see
+   * `phot::IPhotonLibrary::GetCounts()`). Rows with a weight of zero are not
+   * fetched, and rows that `copyRow` can't provide are skipped.
+   */
+  template <typename CopyRow>
+  void
+  blendLibraryRows(float* out,
+                   std::array<int, NInterpolationNeighbours> const& voxels,
+                   std::array<float, NInterpolationNeighbours> const& weights,
+                   std::size_t n,
+                   std::size_t rowSize,
+                   CopyRow&& copyRow,
+                   std::vector<float>& buffer)
+  {
+    std::size_t const stride = std::max(n, rowSize);
+    buffer.resize(NInterpolationNeighbours * stride);
+    std::array<float const*, NInterpolationNeighbours> rows;
+    for (std::size_t k = 0; k < NInterpolationNeighbours; ++k) {
+      float* const dest = buffer.data() + k * stride;
+      bool const used = (voxels[k] >= 0) && (weights[k] != 0.0f) && copyRow(voxels[k], dest);
+      rows[k] = used ? dest : nullptr;
+    }
+    blendVisibilityRows(out, rows, weights, n);
+  } // blendLibraryRows()
+
+} // namespace phot
+
+#endif // LARSIM_PHOTONPROPAGATION_VISIBILITYINTERPOLATION_H
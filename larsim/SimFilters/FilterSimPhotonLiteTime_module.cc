@@ -17,6 +17,7 @@
 #include "art/Framework/Principal/Handle.h"
 #include "fhiclcpp/ParameterSet.h"
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -53,6 +54,11 @@ private:
   std::string const fReflectedLabel; //!< Label for the reflected photons -- "Reflected" by default.
 
   void CheckTimeWindows() const;
+
+  /// Returns whether any time window collects at least `fMinTotalPhotons`, using
+  /// the cumulative photon count of all the channels sorted by time.
+  bool AnyWindowAboveThreshold(std::vector<sim::SimPhotonsLite> const& photons,
+                               std::vector<sim::SimPhotonsLite> const& reflected) const;
 };
 
 simfilter::FilterSimPhotonLiteTime::FilterSimPhotonLiteTime(fhicl::ParameterSet const& p,
@@ -110,6 +116,10 @@ simfilter::FilterSimPhotonLiteTime::filter(art::Event& e, art::ProcessingFrame c
                              {fSimPhotonsLiteCollectionLabel, fReflectedLabel}) :
                            std::vector<sim::SimPhotonsLite>();
 
+  // the photon-by-photon loop is kept only for the debug printouts
+  if (!fDebug)
+    return AnyWindowAboveThreshold(simPhotonsLiteCollection, simPhotonsLiteCollectionReflected);
+
   size_t n_sim_photons = simPhotonsLiteCollection.size() + simPhotonsLiteCollectionReflected.size();
 
   if (fDebug) {
@@ -163,4 +173,48 @@ simfilter::FilterSimPhotonLiteTime::filter(art::Event& e, art::ProcessingFrame c
   return false;
 }
 
+bool
+simfilter::FilterSimPhotonLiteTime::AnyWindowAboveThreshold(
+  std::vector<sim::SimPhotonsLite> const& photons,
+  std::vector<sim::SimPhotonsLite> const& reflected) const
+{
+  // all (time, number of photons) entries of all the channels
+  std::vector<std::pair<int, int>> timeCounts;
+  std::size_t nEntries = 0;
+  for (auto const* collection : {&photons, &reflected})
+    for (sim::SimPhotonsLite const& simphotonslite : *collection)
+      nEntries += simphotonslite.DetectedPhotons.size();
+  timeCounts.reserve(nEntries);
+  for (auto const* collection : {&photons, &reflected})
+    for (sim::SimPhotonsLite const& simphotonslite : *collection)
+      timeCounts.insert(timeCounts.end(),
+                        simphotonslite.DetectedPhotons.begin(),
+                        simphotonslite.DetectedPhotons.end());
+  if (timeCounts.empty()) return false;
+
+  std::sort(timeCounts.begin(), timeCounts.end(), [](auto const& a, auto const& b) {
+    return a.first < b.first;
+  });
+
+  // times[i] is the time of the i-th entry, and cumulative[i] the photons before it
+  std::vector<int> times;
+  std::vector<long long> cumulative;
+  times.reserve(timeCounts.size());
+  cumulative.reserve(timeCounts.size() + 1);
+  cumulative.push_back(0);
+  for (auto const& [time, count] : timeCounts) {
+    times.push_back(time);
+    cumulative.push_back(cumulative.back() + count);
+  }
+  if (cumulative.back() < fMinTotalPhotons) return false; // not even with all the photons
+
+  for (auto const& tw : fTimeWindows) {
+    std::size_t const first = std::lower_bound(times.begin(), times.end(), tw.first) - times.begin();
+    std::size_t const last = std::upper_bound(times.begin(), times.end(), tw.second) - times.begin();
+    // a window must contain at least one entry, as in the photon-by-photon loop
+    if (last > first && cumulative[last] - cumulative[first] >= fMinTotalPhotons) return true;
+  }
+  return false;
+}
+
 DEFINE_ART_MODULE(simfilter::FilterSimPhotonLiteTime)
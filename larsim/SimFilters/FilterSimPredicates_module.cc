@@ -0,0 +1,583 @@
+////////////////////////////////////////////////////////////////////////
+/// \file  FilterSimPredicates_module.cc
+/// \brief EDFilter combining several simulation selections in one module
+///
+/// The selections of `FilterCryostatNus`, `FilterNoDirtNeutrinos`,
+/// `FilterPrimaryPDG`, `FilterStoppingMuon` and `FilterSimPhotonTime` are
+/// available as predicates; the event is kept if all of them (or any of them,
+/// with `RequireAll: false`) pass. Each data product is read only once per
+/// event and shared by all the predicates using it, and the evaluation stops
+/// as soon as the result is known. Predicates are evaluated in order of
+/// estimated cost (generator level first, then Geant4 particles, then
+/// photons), and the number of evaluations, rejections and the time spent in
+/// each predicate are reported at the end of the job.
+///
+/// Example of configuration:
+///
+///     filter: {
+///       module_type: "FilterSimPredicates"
+///       RequireAll:  true
+///       Predicates: [
+///         { Type: "StoppingMuon" ParticleLabel: "largeant" },
+///         { Type: "CryostatNus"  KeepNusInCryostat: true },
+///         { Type: "SimPhotonTime" SimPhotonsLabel: "largeant"
+///           TimeWindows: [ [ 0, 2000 ] ] MinTotalEnergy: 10 }
+///       ]
+///     }
+///
+/// Each predicate table accepts `Invert` (default: `false`) to negate its
+/// result. The parameters of each type and their defaults are the same as in
+/// the corresponding filter module, except that the `MCParticle` label is
+/// always `ParticleLabel` (default: `largeant`), and `PrimaryPDG` reads the
+/// primary particles (`PrimaryParticles` PDG codes) directly from that
+/// collection rather than from the `ParticleInventoryService`.
+////////////////////////////////////////////////////////////////////////
+
+/// Framework includes
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Core/SharedFilter.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Principal/Run.h"
+#include "canvas/Persistency/Common/FindOneP.h"
+#include "canvas/Persistency/Common/Ptr.h"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// LArSoft Includes
+#include "larcore/Geometry/Geometry.h"
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "lardataobj/Simulation/SimPhotons.h"
+#include "nusimdata/SimulationBase/MCParticle.h"
+#include "nusimdata/SimulationBase/MCTruth.h"
+
+// C++ Includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath> // std::abs()
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace simfilter {
+
+  namespace {
+
+    //--------------------------------------------------------------------------
+    /// Data products of one event, read on first request.
+    class EventProducts {
+    public:
+      explicit EventProducts(art::Event const& evt) : fEvent(evt) {}
+
+      art::Event const&
+      event() const
+      {
+        return fEvent;
+      }
+
+      /// All the `simb::MCTruth` collections in the event.
+      std::vector<art::Handle<std::vector<simb::MCTruth>>> const&
+      allMCTruths()
+      {
+        if (!fAllMCTruths) {
+          fAllMCTruths = std::make_unique<std::vector<art::Handle<std::vector<simb::MCTruth>>>>(
+            fEvent.getMany<std::vector<simb::MCTruth>>());
+        }
+        return *fAllMCTruths;
+      }
+
+      /// Handle to the `simb::MCTruth` collection with the specified label.
+      art::Handle<std::vector<simb::MCTruth>> const&
+      mcTruths(std::string const& label)
+      {
+        return fetch(fMCTruths, label);
+      }
+
+      /// Handle to the `simb::MCParticle` collection with the specified label.
+      art::Handle<std::vector<simb::MCParticle>> const&
+      particles(std::string const& label)
+      {
+        return fetch(fParticles, label);
+      }
+
+      /// Handle to the `sim::SimPhotons` collection with the specified tag.
+      art::Handle<std::vector<sim::SimPhotons>> const&
+      photons(art::InputTag const& tag)
+      {
+        return fetch(fPhotons, tag);
+      }
+
+    private:
+      art::Event const& fEvent;
+
+      std::unique_ptr<std::vector<art::Handle<std::vector<simb::MCTruth>>>> fAllMCTruths;
+      std::map<std::string, art::Handle<std::vector<simb::MCTruth>>> fMCTruths;
+      std::map<std::string, art::Handle<std::vector<simb::MCParticle>>> fParticles;
+      std::map<std::string, art::Handle<std::vector<sim::SimPhotons>>> fPhotons;
+
+      template <typename T>
+      art::Handle<std::vector<T>> const&
+      fetch(std::map<std::string, art::Handle<std::vector<T>>>& cache,
+            art::InputTag const& tag)
+      {
+        std::string key = tag.encode();
+        auto it = cache.find(key);
+        if (it == cache.end()) {
+          art::Handle<std::vector<T>> handle;
+          fEvent.getByLabel(tag, handle);
+          it = cache.emplace(std::move(key), std::move(handle)).first;
+        }
+        return it->second;
+      }
+
+    }; // class EventProducts
+
+    //--------------------------------------------------------------------------
+    /// A selection on the simulated event.
+    class SimPredicate {
+    public:
+      /// Estimated cost of the predicates, from the cheapest.
+      enum Cost_t { kGenerator, kParticles, kParticleTruth, kPhotons };
+
+      SimPredicate(std::string name, Cost_t cost, fhicl::ParameterSet const& pset)
+        : fName(std::move(name)), fCost(cost), fInvert(pset.get<bool>("Invert", false))
+      {}
+
+      virtual ~SimPredicate() = default;
+
+      std::string const&
+      name() const
+      {
+        return fName;
+      }
+
+      Cost_t
+      cost() const
+      {
+        return fCost;
+      }
+
+      bool
+      invert() const
+      {
+        return fInvert;
+      }
+
+      /// Updates the geometry information (called at each new run).
+      virtual void
+      beginRun(geo::GeometryCore const&)
+      {}
+
+      /// Returns whether the event passes (before inversion).
+      virtual bool pass(EventProducts& products) const = 0;
+
+      /// Returns whether the event passes, and collects the statistics.
+      bool
+      operator()(EventProducts& products)
+      {
+        auto const start = std::chrono::steady_clock::now();
+        bool const result = pass(products) != fInvert;
+        fNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+        ++fEvaluated;
+        if (!result) ++fRejected;
+        return result;
+      }
+
+      unsigned long long
+      evaluated() const
+      {
+        return fEvaluated;
+      }
+
+      unsigned long long
+      rejected() const
+      {
+        return fRejected;
+      }
+
+      double
+      seconds() const
+      {
+        return fNanoseconds * 1e-9;
+      }
+
+    private:
+      std::string const fName;
+      Cost_t const fCost;
+      bool const fInvert;
+
+      std::atomic<unsigned long long> fEvaluated{0};
+      std::atomic<unsigned long long> fRejected{0};
+      std::atomic<long long> fNanoseconds{0};
+
+    }; // class SimPredicate
+
+    //--------------------------------------------------------------------------
+    /// Fiducial volume of the detector, as used by the filter modules.
+    struct DetectorBox {
+      double xmin = 0., xmax = 0., ymin = 0., ymax = 0., zmin = 0., zmax = 0.;
+
+      static DetectorBox
+      TPC(geo::GeometryCore const& geom)
+      {
+        return {0.,
+                2. * geom.DetHalfWidth(),
+                -geom.DetHalfHeight(),
+                geom.DetHalfHeight(),
+                0.,
+                geom.DetLength()};
+      }
+
+      static DetectorBox
+      cryostat(geo::GeometryCore const& geom)
+      {
+        return {geom.DetHalfWidth() - geom.CryostatHalfWidth(),
+                geom.DetHalfWidth() + geom.CryostatHalfWidth(),
+                -geom.CryostatHalfHeight(),
+                geom.CryostatHalfHeight(),
+                geom.DetLength() / 2. - geom.DetLength() / 2.,
+                geom.DetLength() / 2. + geom.DetLength() / 2.};
+      }
+
+      /// Whether the point is in the box, borders included.
+      bool
+      contains(double x, double y, double z) const
+      {
+        return x >= xmin && x <= xmax && y >= ymin && y <= ymax && z >= zmin && z <= zmax;
+      }
+
+      /// Whether the point is in the box, borders excluded.
+      bool
+      containsStrictly(double x, double y, double z) const
+      {
+        return xmin < x && x < xmax && ymin < y && y < ymax && zmin < z && z < zmax;
+      }
+    };
+
+    //--------------------------------------------------------------------------
+    /// Same selection as `FilterCryostatNus`.
+    class CryostatNusPredicate : public SimPredicate {
+    public:
+      explicit CryostatNusPredicate(fhicl::ParameterSet const& pset)
+        : SimPredicate{"CryostatNus", kGenerator, pset}
+        , fKeepNusInCryostat{pset.get<bool>("KeepNusInCryostat", false)}
+      {}
+
+      void
+      beginRun(geo::GeometryCore const& geom) override
+      {
+        fGeom = &geom;
+      }
+
+      bool
+      pass(EventProducts& products) const override
+      {
+        bool const inCryostatNu = hasCryostatNu(products);
+        return fKeepNusInCryostat ^ (!inCryostatNu);
+      }
+
+    private:
+      bool const fKeepNusInCryostat;
+      geo::GeometryCore const* fGeom = nullptr;
+
+      bool
+      hasCryostatNu(EventProducts& products) const
+      {
+        for (auto const& mclistHandle : products.allMCTruths()) {
+          for (simb::MCTruth const& mct : *mclistHandle) {
+            for (int ipart = 0; ipart < mct.NParticles(); ipart++) {
+              auto const& part = mct.GetParticle(ipart);
+              auto const absPDGID = std::abs(part.PdgCode());
+              if (absPDGID != 12 && absPDGID != 14 && absPDGID != 16) continue;
+              TLorentzVector const& end4 = part.EndPosition();
+              if (fGeom->PositionToCryostatPtr({end4.X(), end4.Y(), end4.Z()}) != nullptr)
+                return true;
+            } // for particles
+          }   // for truth records
+        }     // for truth collections
+        return false;
+      }
+
+    }; // class CryostatNusPredicate
+
+    //--------------------------------------------------------------------------
+    /// Same selection as `FilterStoppingMuon`.
+    class StoppingMuonPredicate : public SimPredicate {
+    public:
+      explicit StoppingMuonPredicate(fhicl::ParameterSet const& pset)
+        : SimPredicate{"StoppingMuon", kParticles, pset}
+        , fParticleLabel{pset.get<std::string>("ParticleLabel", "largeant")}
+      {}
+
+      void
+      beginRun(geo::GeometryCore const& geom) override
+      {
+        fBox = DetectorBox::TPC(geom);
+      }
+
+      bool
+      pass(EventProducts& products) const override
+      {
+        auto const& mcps = products.particles(fParticleLabel);
+        if (!mcps.isValid()) throwMissing(fParticleLabel);
+        for (auto const& part : *mcps) {
+          if (std::abs(part.PdgCode()) != 13) continue;
+          if (fBox.containsStrictly(part.EndX(), part.EndY(), part.EndZ())) return true;
+        }
+        return false;
+      }
+
+    private:
+      std::string const fParticleLabel;
+      DetectorBox fBox;
+
+      [[noreturn]] static void
+      throwMissing(std::string const& label)
+      {
+        throw cet::exception("FilterSimPredicates")
+          << "StoppingMuon: no simb::MCParticle collection with label '" << label << "'\n";
+      }
+
+    }; // class StoppingMuonPredicate
+
+    //--------------------------------------------------------------------------
+    /// Selection of `FilterPrimaryPDG`, on the primary particles of Geant4.
+    class PrimaryPDGPredicate : public SimPredicate {
+    public:
+      explicit PrimaryPDGPredicate(fhicl::ParameterSet const& pset)
+        : SimPredicate{"PrimaryPDG", kParticles, pset}
+        , fParticleLabel{pset.get<std::string>("ParticleLabel", "largeant")}
+        , fPDGs{pset.get<std::vector<int>>("PrimaryParticles")}
+      {
+        std::sort(fPDGs.begin(), fPDGs.end());
+      }
+
+      bool
+      pass(EventProducts& products) const override
+      {
+        auto const& mcps = products.particles(fParticleLabel);
+        if (!mcps.isValid()) return false;
+        for (auto const& part : *mcps) {
+          if (part.Process() != "primary") continue;
+          if (std::binary_search(fPDGs.begin(), fPDGs.end(), part.PdgCode())) return true;
+        }
+        return false;
+      }
+
+    private:
+      std::string const fParticleLabel;
+      std::vector<int> fPDGs; ///< Sorted.
+
+    }; // class PrimaryPDGPredicate
+
+    //--------------------------------------------------------------------------
+    /// Same selection as `FilterNoDirtNeutrinos`.
+    class NoDirtNeutrinosPredicate : public SimPredicate {
+    public:
+      explicit NoDirtNeutrinosPredicate(fhicl::ParameterSet const& pset)
+        : SimPredicate{"NoDirtNeutrinos", kParticleTruth, pset}
+        , fParticleLabel{pset.get<std::string>("ParticleLabel", "largeant")}
+        , fGenModuleLabel{pset.get<std::string>("GenModuleLabel", "NoLabel")}
+        , fKeepCryostatNeutrinos{pset.get<bool>("KeepCryostatNeutrinos", false)}
+      {}
+
+      void
+      beginRun(geo::GeometryCore const& geom) override
+      {
+        fBox = fKeepCryostatNeutrinos ? DetectorBox::cryostat(geom) : DetectorBox::TPC(geom);
+      }
+
+      bool
+      pass(EventProducts& products) const override
+      {
+        auto const& mctruths = products.mcTruths(fGenModuleLabel);
+        auto const& mcps = products.particles(fParticleLabel);
+        if (!mctruths.isValid() || !mcps.isValid()) return false;
+
+        std::set<art::Ptr<simb::MCTruth>> mctSetGENIE;
+        for (std::size_t i = 0; i < mctruths->size(); ++i)
+          mctSetGENIE.emplace(mctruths, i);
+
+        art::FindOneP<simb::MCTruth> assMCT(mcps, products.event(), fParticleLabel);
+        for (std::size_t i = 0; i < mcps->size(); ++i) {
+          if (mctSetGENIE.count(assMCT.at(i)) == 0) continue; // not from this generator
+          simb::MCParticle const& part = (*mcps)[i];
+          unsigned int const n = part.NumberTrajectoryPoints();
+          for (unsigned int j = 0; j < n; ++j) {
+            TLorentzVector const& pos = part.Position(j);
+            if (fBox.contains(pos.X(), pos.Y(), pos.Z())) return true;
+          }
+        }
+        return false;
+      }
+
+    private:
+      std::string const fParticleLabel;
+      std::string const fGenModuleLabel;
+      bool const fKeepCryostatNeutrinos;
+      DetectorBox fBox;
+
+    }; // class NoDirtNeutrinosPredicate
+
+    //--------------------------------------------------------------------------
+    /// Same selection as `FilterSimPhotonTime`.
+    class SimPhotonTimePredicate : public SimPredicate {
+    public:
+      explicit SimPhotonTimePredicate(fhicl::ParameterSet const& pset)
+        : SimPredicate{"SimPhotonTime", kPhotons, pset}
+        , fSimPhotonsLabel{pset.get<std::string>("SimPhotonsLabel")}
+        , fTimeWindows{pset.get<std::vector<std::pair<float, float>>>("TimeWindows")}
+        , fMinTotalEnergy{pset.get<float>("MinTotalEnergy", 0.0)}
+        , fMinPhotonEnergy{pset.get<float>("MinPhotonEnergy", -1)}
+        , fUseReflectedPhotons{pset.get<bool>("UseReflectedPhotons", false)}
+        , fReflectedLabel{pset.get<std::string>("ReflectedLabel", "Reflected")}
+      {
+        for (auto const& tw : fTimeWindows) {
+          if (tw.first > tw.second)
+            throw cet::exception("FilterSimPredicates")
+              << "SimPhotonTime: bad time window initialization: [" << tw.first << ","
+              << tw.second << "]. Reverse the order!\n";
+        }
+      }
+
+      bool
+      pass(EventProducts& products) const override
+      {
+        std::vector<double> sumEnergyArray(fTimeWindows.size(), 0.0);
+        if (addPhotons(products, fSimPhotonsLabel, sumEnergyArray)) return true;
+        if (!fUseReflectedPhotons) return false;
+        return addPhotons(products, {fSimPhotonsLabel, fReflectedLabel}, sumEnergyArray);
+      }
+
+    private:
+      std::string const fSimPhotonsLabel;
+      std::vector<std::pair<float, float>> const fTimeWindows;
+      float const fMinTotalEnergy;
+      float const fMinPhotonEnergy;
+      bool const fUseReflectedPhotons;
+      std::string const fReflectedLabel;
+
+      /// Adds the photons to the window energies; returns whether one is over threshold.
+      bool
+      addPhotons(EventProducts& products,
+                 art::InputTag const& tag,
+                 std::vector<double>& sumEnergyArray) const
+      {
+        auto const& photons = products.photons(tag);
+        if (!photons.isValid()) {
+          throw cet::exception("FilterSimPredicates")
+            << "SimPhotonTime: no sim::SimPhotons collection '" << tag.encode() << "'\n";
+        }
+        for (sim::SimPhotons const& simphotons : *photons) {
+          for (auto const& photon : simphotons) {
+            if (!(photon.Energy > fMinPhotonEnergy)) continue;
+            for (std::size_t i_tw = 0; i_tw < fTimeWindows.size(); ++i_tw) {
+              auto const& tw = fTimeWindows[i_tw];
+              if (photon.Time < tw.first || photon.Time > tw.second) continue;
+              sumEnergyArray[i_tw] += photon.Energy;
+              if (sumEnergyArray[i_tw] > fMinTotalEnergy) return true;
+            }
+          }
+        }
+        return false;
+      }
+
+    }; // class SimPhotonTimePredicate
+
+    //--------------------------------------------------------------------------
+    std::unique_ptr<SimPredicate>
+    makePredicate(fhicl::ParameterSet const& pset)
+    {
+      std::string const type = pset.get<std::string>("Type");
+      if (type == "CryostatNus") return std::make_unique<CryostatNusPredicate>(pset);
+      if (type == "StoppingMuon") return std::make_unique<StoppingMuonPredicate>(pset);
+      if (type == "PrimaryPDG") return std::make_unique<PrimaryPDGPredicate>(pset);
+      if (type == "NoDirtNeutrinos") return std::make_unique<NoDirtNeutrinosPredicate>(pset);
+      if (type == "SimPhotonTime") return std::make_unique<SimPhotonTimePredicate>(pset);
+      throw cet::exception("FilterSimPredicates")
+        << "Unknown predicate type '" << type
+        << "' (supported: CryostatNus, StoppingMuon, PrimaryPDG, NoDirtNeutrinos,"
+           " SimPhotonTime)\n";
+    }
+
+  } // local namespace
+
+  //----------------------------------------------------------------------------
+  class FilterSimPredicates : public art::SharedFilter {
+  public:
+    explicit FilterSimPredicates(fhicl::ParameterSet const& pset, art::ProcessingFrame const&);
+
+  private:
+    void beginRun(art::Run&, art::ProcessingFrame const&) override;
+    bool filter(art::Event&, art::ProcessingFrame const&) override;
+    void endJob(art::ProcessingFrame const&) override;
+
+    bool const fRequireAll; ///< Whether all predicates must pass, or just one.
+    std::vector<std::unique_ptr<SimPredicate>> fPredicates; ///< In evaluation order.
+  };
+
+  //----------------------------------------------------------------------------
+  FilterSimPredicates::FilterSimPredicates(fhicl::ParameterSet const& pset,
+                                           art::ProcessingFrame const&)
+    : SharedFilter{pset}, fRequireAll{pset.get<bool>("RequireAll", true)}
+  {
+    for (auto const& predConfig : pset.get<std::vector<fhicl::ParameterSet>>("Predicates"))
+      fPredicates.push_back(makePredicate(predConfig));
+    if (fPredicates.empty()) {
+      throw cet::exception("FilterSimPredicates") << "No predicate configured in 'Predicates'.\n";
+    }
+
+    // cheapest first; the configuration order is kept among predicates of the same cost
+    if (pset.get<bool>("SortByCost", true)) {
+      std::stable_sort(fPredicates.begin(),
+                       fPredicates.end(),
+                       [](auto const& a, auto const& b) { return a->cost() < b->cost(); });
+    }
+
+    async<art::InEvent>();
+  }
+
+  //----------------------------------------------------------------------------
+  void
+  FilterSimPredicates::beginRun(art::Run&, art::ProcessingFrame const&)
+  {
+    // Detector geometries are allowed to change on run boundaries.
+    auto const& geom = *(lar::providerFrom<geo::Geometry>());
+    for (auto& predicate : fPredicates)
+      predicate->beginRun(geom);
+  }
+
+  //----------------------------------------------------------------------------
+  bool
+  FilterSimPredicates::filter(art::Event& evt, art::ProcessingFrame const&)
+  {
+    EventProducts products{evt};
+    for (auto& predicate : fPredicates) {
+      if ((*predicate)(products) != fRequireAll) return !fRequireAll;
+    }
+    return fRequireAll;
+  }
+
+  //----------------------------------------------------------------------------
+  void
+  FilterSimPredicates::endJob(art::ProcessingFrame const&)
+  {
+    mf::LogInfo log("FilterSimPredicates");
+    log << "Predicates (" << (fRequireAll ? "all" : "any") << " required), in evaluation order:";
+    for (auto const& predicate : fPredicates) {
+      log << "\n  " << (predicate->invert() ? "not " : "") << predicate->name() << ": "
+          << predicate->evaluated() << " evaluations, " << predicate->rejected()
+          << " rejections, " << predicate->seconds() << " s";
+    }
+  }
+
+} // namespace simfilter
+
+DEFINE_ART_MODULE(simfilter::FilterSimPredicates)
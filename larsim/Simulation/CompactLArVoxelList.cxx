@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////
+/// \file  CompactLArVoxelList.cxx
+/// \brief Hash-based accumulator of LAr voxel energies
+////////////////////////////////////////////////////////////////////////
+
+#include "larsim/Simulation/CompactLArVoxelList.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace sim {
+
+  //----------------------------------------------------------------------------
+  void CompactLArVoxelList::reserve( const size_type nVoxels )
+  {
+    fBins.reserve(nVoxels);
+    fUnassigned.reserve(nVoxels);
+    fLastContribution.reserve(nVoxels);
+    fContributions.reserve(nVoxels);
+
+    // keep the table at most half full
+    std::size_t nSlots = 16;
+    while ( nSlots < 2 * nVoxels ) nSlots *= 2;
+    if ( nSlots > fSlots.size() ) Rehash(nSlots);
+  }
+
+  //----------------------------------------------------------------------------
+  void CompactLArVoxelList::clear()
+  {
+    fBins.clear();
+    fUnassigned.clear();
+    fLastContribution.clear();
+    fContributions.clear();
+    std::fill(fSlots.begin(), fSlots.end(), kNone);
+  }
+
+  //----------------------------------------------------------------------------
+  CompactLArVoxelList::size_type CompactLArVoxelList::Add( const bins_type& bins, const double energy )
+  {
+    std::uint32_t const voxel = VoxelIndex(bins);
+    fUnassigned[voxel] += energy;
+    return voxel;
+  }
+
+  //----------------------------------------------------------------------------
+  CompactLArVoxelList::size_type CompactLArVoxelList::Add( const bins_type& bins, const double energy, const int id )
+  {
+    std::uint32_t const voxel = VoxelIndex(bins);
+
+    // a voxel is usually crossed by few tracks: a linear search is enough
+    for ( std::uint32_t c = fLastContribution[voxel]; c != kNone; c = fContributions[c].next ){
+      if ( fContributions[c].trackID == id ) {
+        fContributions[c].energy += energy;
+        return voxel;
+      }
+    }
+    fContributions.push_back({ id, 0.0, fLastContribution[voxel] });
+    fContributions.back().energy += energy;
+    fLastContribution[voxel] = fContributions.size() - 1;
+    return voxel;
+  }
+
+  //----------------------------------------------------------------------------
+  CompactLArVoxelList::size_type CompactLArVoxelList::NumberParticles( const size_type voxel ) const
+  {
+    size_type n = 0;
+    for ( std::uint32_t c = fLastContribution[voxel]; c != kNone; c = fContributions[c].next ) ++n;
+    return n;
+  }
+
+  //----------------------------------------------------------------------------
+  LArVoxelList CompactLArVoxelList::ToLArVoxelList( std::vector<size_type>* listIndex ) const
+  {
+    // sort the voxels in the order of the list, so that each one is
+    // inserted at its end and the map is built in linear time
+    std::vector<LArVoxelID> voxelIDs;
+    voxelIDs.reserve(size());
+    for ( bins_type const& bins : fBins )
+      voxelIDs.emplace_back(bins[0], bins[1], bins[2], bins[3]);
+    std::vector<std::uint32_t> order(size());
+    for ( std::uint32_t voxel = 0; voxel < order.size(); ++voxel ) order[voxel] = voxel;
+
+    // packed keys sort as the voxel IDs do, as long as all the bins fit
+    bool const packed = std::all_of(fBins.begin(), fBins.end(), [](bins_type const& bins)
+      { return LArVoxelKey::IsRepresentable(bins[0], bins[1], bins[2], bins[3]); });
+    if ( packed ) {
+      std::vector<LArVoxelKey> keys;
+      keys.reserve(size());
+      for ( bins_type const& bins : fBins ) keys.push_back(KeyOf(bins));
+      std::sort(order.begin(), order.end(),
+                [&keys](std::uint32_t a, std::uint32_t b){ return keys[a] < keys[b]; });
+    }
+    else {
+      std::sort(order.begin(), order.end(),
+                [&voxelIDs](std::uint32_t a, std::uint32_t b){ return voxelIDs[a] < voxelIDs[b]; });
+    }
+
+    if ( listIndex ) {
+      listIndex->resize(size());
+      for ( size_type position = 0; position < order.size(); ++position )
+        (*listIndex)[order[position]] = position;
+    }
+
+    LArVoxelList list;
+    std::vector<std::pair<int, double>> tracks;
+    for ( std::uint32_t const voxel : order ){
+      LArVoxelID const& voxelID = voxelIDs[voxel];
+
+      LArVoxelData data;
+      data.Add(fUnassigned[voxel]);
+
+      // insert the tracks in order, so that the VectorMap needs no sorting
+      tracks.clear();
+      for ( std::uint32_t c = fLastContribution[voxel]; c != kNone; c = fContributions[c].next )
+        tracks.emplace_back(fContributions[c].trackID, fContributions[c].energy);
+      std::sort(tracks.begin(), tracks.end());
+      for ( auto const& [trackID, energy] : tracks ) data.insert(trackID, energy);
+
+      data.SetVoxelID(voxelID);
+      list.insert(list.end(), voxelID, data);
+    }
+    return list;
+  }
+
+  //----------------------------------------------------------------------------
+  std::size_t CompactLArVoxelList::Hash( const bins_type& bins )
+  {
+    // bins out of the key ranges wrap around, which only costs collisions:
+    // voxels are still told apart by their bins
+    return KeyOf(bins).Hash();
+  }
+
+  //----------------------------------------------------------------------------
+  std::uint32_t CompactLArVoxelList::VoxelIndex( const bins_type& bins )
+  {
+    if ( 2 * (fBins.size() + 1) > fSlots.size() )
+      Rehash(fSlots.empty()? 16: 2 * fSlots.size());
+
+    // linear probing
+    std::size_t const mask = fSlots.size() - 1;
+    for ( std::size_t slot = Hash(bins) & mask; ; slot = (slot + 1) & mask ){
+      std::uint32_t const voxel = fSlots[slot];
+      if ( voxel == kNone ) {
+        fSlots[slot] = fBins.size();
+        fBins.push_back(bins);
+        fUnassigned.push_back(0.0);
+        fLastContribution.push_back(kNone);
+        return fSlots[slot];
+      }
+      if ( fBins[voxel] == bins ) return voxel;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void CompactLArVoxelList::Rehash( const std::size_t nSlots )
+  {
+    fSlots.assign(nSlots, kNone);
+    std::size_t const mask = nSlots - 1;
+    for ( std::uint32_t voxel = 0; voxel < fBins.size(); ++voxel ){
+      std::size_t slot = Hash(fBins[voxel]) & mask;
+      while ( fSlots[slot] != kNone ) slot = (slot + 1) & mask;
+      fSlots[slot] = voxel;
+    }
+  }
+
+} // namespace sim
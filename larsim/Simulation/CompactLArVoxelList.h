@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////
+/// \file  CompactLArVoxelList.h
+/// \brief Hash-based accumulator of LAr voxel energies
+///
+/// A fast alternative to `sim::LArVoxelList` for filling voxels one
+/// energy deposit at a time: voxels are kept in a flat open addressing
+/// hash table keyed on their (x,y,z,t) bins, and the energy of each
+/// particle track in a voxel is stored in an arena shared by all the
+/// voxels, so that adding a deposit allocates no tree node.
+///
+/// When the filling is done, the content can be converted into a
+/// `sim::LArVoxelList`:
+///
+///      sim::CompactLArVoxelList voxels;
+///      voxels.reserve(expectedVoxels);
+///      for ( ... ) voxels.Add(voxelID, energy, trackID);
+///      sim::LArVoxelList voxelList = voxels.ToLArVoxelList();
+///
+/// The resulting list is the same as the one obtained by calling
+/// `LArVoxelList::Add()` with the same deposits in the same order.
+/// `Add()` returns the index of the voxel the energy went to, and
+/// `ToLArVoxelList()` can report where each voxel ended up in the list,
+/// so that the voxel of each deposit can be found again without
+/// recomputing its bins.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef COMPACTLARVOXELLIST_H
+#define COMPACTLARVOXELLIST_H
+
+#include "larsim/Simulation/LArVoxelID.h"
+#include "larsim/Simulation/LArVoxelKey.h"
+#include "larsim/Simulation/LArVoxelList.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sim {
+
+  class CompactLArVoxelList
+  {
+  public:
+    /// The (x,y,z,t) bins of a voxel.
+    typedef std::array<int, 4U> bins_type;
+    typedef std::size_t         size_type;
+
+    /// Prepares the list to hold `nVoxels` voxels without rehashing.
+    void reserve( size_type nVoxels );
+
+    // Add the energy to the voxel; if the voxel doesn't exist, create it.
+    // As in LArVoxelList, energy can be added with or without a
+    // particle's track ID.  The index of the voxel is returned.
+    size_type Add( const bins_type& bins, const double energy );
+    size_type Add( const bins_type& bins, const double energy, const int id );
+    size_type Add( const LArVoxelID& key, const double energy )               { return Add(BinsOf(key), energy); }
+    size_type Add( const LArVoxelID& key, const double energy, const int id ) { return Add(BinsOf(key), energy, id); }
+
+    /// Number of voxels; voxels are indexed in order of creation.
+    size_type size()  const { return fBins.size(); }
+    bool      empty() const { return fBins.empty(); }
+    void      clear();
+
+    const bins_type& Bins( const size_type voxel )             const { return fBins[voxel]; }
+    double           UnassignedEnergy( const size_type voxel ) const { return fUnassigned[voxel]; }
+    size_type        NumberParticles( const size_type voxel )  const;
+
+    /// Returns the content as a LArVoxelList (each LArVoxelData has its voxel ID set).
+    /// If `listIndex` is given, it is filled with the position in the list
+    /// (in iteration order) of each voxel.
+    LArVoxelList ToLArVoxelList( std::vector<size_type>* listIndex = nullptr ) const;
+
+  private:
+    static constexpr std::uint32_t kNone = 0xFFFFFFFFU; ///< No voxel or contribution.
+
+    /// Energy of one track in one voxel; contributions of a voxel are chained.
+    struct Contribution {
+      int           trackID;
+      double        energy;
+      std::uint32_t next;
+    };
+
+    std::vector<bins_type>     fBins;             ///< Bins of each voxel.
+    std::vector<double>        fUnassigned;       ///< Unassigned energy of each voxel.
+    std::vector<std::uint32_t> fLastContribution; ///< Newest contribution of each voxel.
+    std::vector<Contribution>  fContributions;    ///< The arena of all track contributions.
+    std::vector<std::uint32_t> fSlots;            ///< Hash table of voxel indices.
+
+    static bins_type BinsOf( const LArVoxelID& key )
+    { return {{ key.XBin(), key.YBin(), key.ZBin(), key.TBin() }}; }
+
+    static LArVoxelKey KeyOf( const bins_type& bins )
+    { return LArVoxelKey( bins[0], bins[1], bins[2], bins[3] ); }
+
+    static std::size_t Hash( const bins_type& bins );
+
+    /// Returns the index of the voxel with these bins, creating it if needed.
+    std::uint32_t VoxelIndex( const bins_type& bins );
+
+    /// Resizes the hash table to `nSlots` (a power of 2) slots.
+    void Rehash( std::size_t nSlots );
+
+  };
+
+} // namespace sim
+
+#endif // COMPACTLARVOXELLIST_H
@@ -0,0 +1,151 @@
+/**
+ * @file larsim/Simulation/CompactSimChannels.cxx
+ * @brief Compact storage of the `sim::SimChannel` collection of an event.
+ * @see larsim/Simulation/CompactSimChannels.h
+ */
+
+#include "larsim/Simulation/CompactSimChannels.h"
+
+#include "lardataobj/Simulation/SimChannel.h"
+
+#include "cetlib_except/exception.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <utility>
+
+namespace {
+
+  constexpr double MaxSteps = std::numeric_limits<std::int16_t>::max();
+
+  /// Steps of `value` from `mean`, rounded.
+  std::int16_t
+  quantise(double value, double mean, double step)
+  {
+    double const steps = std::round((value - mean) / step);
+    return static_cast<std::int16_t>(std::clamp(steps, -MaxSteps, MaxSteps));
+  }
+
+} // local namespace
+
+//------------------------------------------------------------------------------
+sim::CompactSimChannels
+sim::makeCompactSimChannels(std::vector<sim::SimChannel> const& channels,
+                            double positionResolution)
+{
+  CompactSimChannels compact;
+  compact.firstTDC.push_back(0);
+  compact.firstTrack.push_back(0);
+  compact.firstIDE.push_back(0);
+
+  std::map<std::pair<int, int>, std::uint16_t> dictionary;
+  for (sim::SimChannel const& sc : channels) {
+    auto const& tdcides = sc.TDCIDEMap();
+
+    // the reference position of the channel, and the step fitting all its IDEs
+    double sumN = 0.0, sumX = 0.0, sumY = 0.0, sumZ = 0.0;
+    std::size_t nIDEs = 0;
+    for (auto const& [tdc, ides] : tdcides) {
+      for (sim::IDE const& ide : ides) {
+        sumN += ide.numElectrons;
+        sumX += ide.numElectrons * ide.x;
+        sumY += ide.numElectrons * ide.y;
+        sumZ += ide.numElectrons * ide.z;
+        ++nIDEs;
+      }
+    }
+    float meanX = 0.0, meanY = 0.0, meanZ = 0.0;
+    if (sumN > 0.0) {
+      meanX = sumX / sumN;
+      meanY = sumY / sumN;
+      meanZ = sumZ / sumN;
+    }
+    else if (nIDEs > 0) {
+      sim::IDE const& ide = tdcides.front().second.front();
+      meanX = ide.x;
+      meanY = ide.y;
+      meanZ = ide.z;
+    }
+    double maxOffset = 0.0;
+    for (auto const& [tdc, ides] : tdcides) {
+      for (sim::IDE const& ide : ides) {
+        maxOffset = std::max<double>({maxOffset,
+                                      std::abs(ide.x - meanX),
+                                      std::abs(ide.y - meanY),
+                                      std::abs(ide.z - meanZ)});
+      }
+    }
+    // (in the precision it is stored with, the one the positions are expanded with)
+    double const step = static_cast<float>(std::max(positionResolution, maxOffset / MaxSteps));
+
+    compact.channel.push_back(sc.Channel());
+    compact.meanX.push_back(meanX);
+    compact.meanY.push_back(meanY);
+    compact.meanZ.push_back(meanZ);
+    compact.positionStep.push_back(step);
+
+    dictionary.clear();
+    unsigned int lastTDC = 0;
+    for (auto const& [tdc, ides] : tdcides) {
+      compact.tdcDelta.push_back(tdc - lastTDC);
+      lastTDC = tdc;
+      for (sim::IDE const& ide : ides) {
+        auto const [iTrack, isNew] =
+          dictionary.emplace(std::make_pair(ide.trackID, ide.origTrackID), dictionary.size());
+        if (isNew) {
+          if (dictionary.size() > std::numeric_limits<std::uint16_t>::max() + 1U) {
+            throw cet::exception("CompactSimChannels")
+              << "Channel " << sc.Channel() << " has more than "
+              << (std::numeric_limits<std::uint16_t>::max() + 1U) << " tracks.\n";
+          }
+          compact.trackID.push_back(ide.trackID);
+          compact.origTrackID.push_back(ide.origTrackID);
+        }
+        compact.track.push_back(iTrack->second);
+        compact.nElectrons.push_back(ide.numElectrons);
+        compact.energy.push_back(ide.energy);
+        compact.dX.push_back(quantise(ide.x, meanX, step));
+        compact.dY.push_back(quantise(ide.y, meanY, step));
+        compact.dZ.push_back(quantise(ide.z, meanZ, step));
+      }
+      compact.firstIDE.push_back(compact.nIDEs());
+    }
+    compact.firstTDC.push_back(compact.tdcDelta.size());
+    compact.firstTrack.push_back(compact.trackID.size());
+  }
+
+  return compact;
+}
+
+//------------------------------------------------------------------------------
+std::vector<sim::SimChannel>
+sim::expandSimChannels(CompactSimChannels const& compact)
+{
+  std::vector<sim::SimChannel> channels;
+  channels.reserve(compact.nChannels());
+  for (std::size_t c = 0; c < compact.nChannels(); ++c) {
+    sim::SimChannel& sc = channels.emplace_back(compact.channel[c]);
+    double const step = compact.positionStep[c];
+    std::size_t const firstTrack = compact.firstTrack[c];
+
+    unsigned int tdc = 0;
+    for (std::size_t t = compact.firstTDC[c]; t < compact.firstTDC[c + 1]; ++t) {
+      tdc += compact.tdcDelta[t];
+      for (std::size_t i = compact.firstIDE[t]; i < compact.firstIDE[t + 1]; ++i) {
+        double const xyz[3] = {compact.meanX[c] + step * compact.dX[i],
+                               compact.meanY[c] + step * compact.dY[i],
+                               compact.meanZ[c] + step * compact.dZ[i]};
+        std::size_t const track = firstTrack + compact.track[i];
+        sc.AddIonizationElectrons(compact.trackID[track],
+                                  tdc,
+                                  compact.nElectrons[i],
+                                  xyz,
+                                  compact.energy[i],
+                                  compact.origTrackID[track]);
+      }
+    }
+  }
+  return channels;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file larsim/Simulation/CompactSimChannels.h
+ * @brief Compact storage of the `sim::SimChannel` collection of an event.
+ * @see larsim/Simulation/CompactSimChannels.cxx
+ *
+ * This is a lighter alternative to a `std::vector<sim::SimChannel>`, produced
+ * by `detsim::SimDriftElectrons` and `larg4::LArG4` with
+ * `StoreCompactSimChannels`, and read back by `cheat::BackTracker` with
+ * `CompactSimChannelModuleLabel`. The full collection is still produced for
+ * the downstream modules of the same job, and can be dropped from the output.
+ */
+
+#ifndef LARSIM_SIMULATION_COMPACTSIMCHANNELS_H
+#define LARSIM_SIMULATION_COMPACTSIMCHANNELS_H
+
+#include "larcoreobj/SimpleTypesAndConstants/RawTypes.h" // raw::ChannelID_t
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sim {
+
+  class SimChannel;
+
+  /**
+   * @brief The `sim::SimChannel` of an event, in "structure of arrays" layout.
+   *
+   * Three levels of information are stored, each in its own set of vectors:
+   *
+   * * per channel (`channel`, `meanX`...): the channel `c` has the TDC
+   *   entries from `firstTDC[c]` to `firstTDC[c + 1]` (excluded), and the
+   *   tracks of its dictionary from `firstTrack[c]` to `firstTrack[c + 1]`;
+   * * per TDC entry (`tdcDelta`, `firstIDE`): the TDC entries of a channel are
+   *   in increasing tick order, each stored as the difference from the
+   *   previous one of the channel (the first one from `0`); the entry `t` has
+   *   the IDEs from `firstIDE[t]` to `firstIDE[t + 1]`;
+   * * per IDE (`track`, `nElectrons`...): the track of the IDE is the index in
+   *   the dictionary of its channel, and its position is quantised relative
+   *   to the (electron-weighted) mean position of the channel IDEs, in units
+   *   of `positionStep` of the channel.
+   *
+   * The `first...` vectors have one more element than the entries they point
+   * into. The step is the configured resolution, made larger on the channels
+   * whose IDEs would not fit the 16 bit range otherwise. Expanding returns
+   * channels equal to the original ones but for the IDE positions, which are
+   * within half a step of the originals, and the single precision of the
+   * other values.
+   */
+  struct CompactSimChannels {
+
+    /// @name Per-channel information
+    /// @{
+    std::vector<raw::ChannelID_t> channel;   ///< Channel number.
+    std::vector<float> meanX;                ///< Mean x of the channel IDEs [cm].
+    std::vector<float> meanY;                ///< Mean y of the channel IDEs [cm].
+    std::vector<float> meanZ;                ///< Mean z of the channel IDEs [cm].
+    std::vector<float> positionStep;         ///< Quantum of the IDE positions [cm].
+    std::vector<std::uint32_t> firstTDC;     ///< First TDC entry of each channel (and end).
+    std::vector<std::uint32_t> firstTrack;   ///< First dictionary track of each channel (and end).
+    /// @}
+
+    /// @name Track dictionaries of all the channels
+    /// @{
+    std::vector<int> trackID;     ///< Geant4 track ID.
+    std::vector<int> origTrackID; ///< Original Geant4 track ID.
+    /// @}
+
+    /// @name Per-TDC information
+    /// @{
+    std::vector<std::uint32_t> tdcDelta; ///< Tick from the previous entry of the channel.
+    std::vector<std::uint32_t> firstIDE; ///< First IDE of each TDC entry (and end).
+    /// @}
+
+    /// @name Per-IDE information
+    /// @{
+    std::vector<std::uint16_t> track;   ///< Index of the track in the channel dictionary.
+    std::vector<float> nElectrons;      ///< Number of electrons.
+    std::vector<float> energy;          ///< Deposited energy [MeV].
+    std::vector<std::int16_t> dX;       ///< x from the channel mean, in steps.
+    std::vector<std::int16_t> dY;       ///< y from the channel mean, in steps.
+    std::vector<std::int16_t> dZ;       ///< z from the channel mean, in steps.
+    /// @}
+
+    /// Number of stored channels.
+    std::size_t
+    nChannels() const
+    {
+      return channel.size();
+    }
+
+    /// Number of stored IDEs.
+    std::size_t
+    nIDEs() const
+    {
+      return nElectrons.size();
+    }
+
+  }; // struct CompactSimChannels
+
+  /**
+   * @brief Encodes `channels` into the compact format.
+   * @param positionResolution the step of the quantised positions [cm]
+   * @throw cet::exception (category: `"CompactSimChannels"`) if a channel has
+   *        more tracks than the dictionary can index
+   *
+   * The channels are stored in the same order as in `channels`.
+   */
+  CompactSimChannels makeCompactSimChannels(std::vector<sim::SimChannel> const& channels,
+                                            double positionResolution);
+
+  /// Returns the `sim::SimChannel` encoded in `compact`, in the same order.
+  std::vector<sim::SimChannel> expandSimChannels(CompactSimChannels const& compact);
+
+} // namespace sim
+
+#endif // LARSIM_SIMULATION_COMPACTSIMCHANNELS_H
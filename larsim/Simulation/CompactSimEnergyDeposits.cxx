@@ -0,0 +1,121 @@
+/**
+ * @file larsim/Simulation/CompactSimEnergyDeposits.cxx
+ * @brief Compact storage of a `sim::SimEnergyDeposit` collection.
+ * @see larsim/Simulation/CompactSimEnergyDeposits.h
+ */
+
+#include "larsim/Simulation/CompactSimEnergyDeposits.h"
+
+#include "lardataobj/Simulation/SimEnergyDeposit.h"
+
+#include "cetlib_except/exception.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <utility>
+
+namespace {
+
+  constexpr double MaxSteps = std::numeric_limits<std::int32_t>::max();
+
+} // local namespace
+
+//------------------------------------------------------------------------------
+sim::CompactSimEnergyDeposits
+sim::makeCompactSimEnergyDeposits(std::vector<sim::SimEnergyDeposit> const& deposits,
+                                  double timeResolution)
+{
+  if (!(timeResolution > 0.0)) {
+    throw cet::exception("CompactSimEnergyDeposits")
+      << "Time resolution must be positive (" << timeResolution << " ns requested).\n";
+  }
+
+  CompactSimEnergyDeposits compact;
+  std::size_t const n = deposits.size();
+  if (n == 0) return compact;
+
+  // the reference time, and the step fitting all the start times
+  auto const [minEdep, maxEdep] = std::minmax_element(
+    deposits.begin(), deposits.end(), [](auto const& a, auto const& b) { return a.T0() < b.T0(); });
+  compact.timeReference = minEdep->T0();
+  compact.timeStep = std::max(timeResolution, (maxEdep->T0() - minEdep->T0()) / MaxSteps);
+
+  compact.track.reserve(n);
+  compact.midX.reserve(n);
+  compact.midY.reserve(n);
+  compact.midZ.reserve(n);
+  compact.halfX.reserve(n);
+  compact.halfY.reserve(n);
+  compact.halfZ.reserve(n);
+  compact.startTime.reserve(n);
+  compact.duration.reserve(n);
+  compact.energy.reserve(n);
+  compact.numPhotons.reserve(n);
+  compact.numElectrons.reserve(n);
+  compact.scintYieldRatio.reserve(n);
+
+  // consecutive deposits are mostly from the same track: skip the lookup then
+  std::map<std::pair<int, int>, std::uint32_t> dictionary;
+  std::pair<int, int> lastKey{0, 0};
+  std::uint32_t lastTrack = 0;
+  for (sim::SimEnergyDeposit const& edep : deposits) {
+    std::pair<int, int> const key{edep.TrackID(), edep.PdgCode()};
+    if (dictionary.empty() || (key != lastKey)) {
+      auto const [iTrack, isNew] = dictionary.emplace(key, compact.trackID.size());
+      if (isNew) {
+        compact.trackID.push_back(key.first);
+        compact.pdgCode.push_back(key.second);
+      }
+      lastKey = key;
+      lastTrack = iTrack->second;
+    }
+    compact.track.push_back(lastTrack);
+
+    auto const start = edep.Start();
+    auto const end = edep.End();
+    compact.midX.push_back((start.X() + end.X()) / 2.0);
+    compact.midY.push_back((start.Y() + end.Y()) / 2.0);
+    compact.midZ.push_back((start.Z() + end.Z()) / 2.0);
+    compact.halfX.push_back((end.X() - start.X()) / 2.0);
+    compact.halfY.push_back((end.Y() - start.Y()) / 2.0);
+    compact.halfZ.push_back((end.Z() - start.Z()) / 2.0);
+
+    compact.startTime.push_back(
+      static_cast<std::int32_t>(std::round((edep.T0() - compact.timeReference) / compact.timeStep)));
+    compact.duration.push_back(edep.T1() - edep.T0());
+
+    compact.energy.push_back(edep.Energy());
+    compact.numPhotons.push_back(edep.NumPhotons());
+    compact.numElectrons.push_back(edep.NumElectrons());
+    compact.scintYieldRatio.push_back(edep.ScintYieldRatio());
+  }
+
+  return compact;
+}
+
+//------------------------------------------------------------------------------
+std::vector<sim::SimEnergyDeposit>
+sim::expandSimEnergyDeposits(CompactSimEnergyDeposits const& compact)
+{
+  std::vector<sim::SimEnergyDeposit> deposits;
+  deposits.reserve(compact.nDeposits());
+  for (std::size_t i = 0; i < compact.nDeposits(); ++i) {
+    double const midX = compact.midX[i], midY = compact.midY[i], midZ = compact.midZ[i];
+    double const halfX = compact.halfX[i], halfY = compact.halfY[i], halfZ = compact.halfZ[i];
+    double const t0 = compact.timeReference + compact.timeStep * compact.startTime[i];
+    std::uint32_t const track = compact.track[i];
+    deposits.emplace_back(compact.numPhotons[i],
+                          compact.numElectrons[i],
+                          compact.scintYieldRatio[i],
+                          compact.energy[i],
+                          geo::Point_t{midX - halfX, midY - halfY, midZ - halfZ},
+                          geo::Point_t{midX + halfX, midY + halfY, midZ + halfZ},
+                          t0,
+                          t0 + compact.duration[i],
+                          compact.trackID[track],
+                          compact.pdgCode[track]);
+  }
+  return deposits;
+}
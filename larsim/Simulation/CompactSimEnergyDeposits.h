@@ -0,0 +1,94 @@
+/**
+ * @file larsim/Simulation/CompactSimEnergyDeposits.h
+ * @brief Compact storage of a `sim::SimEnergyDeposit` collection.
+ * @see larsim/Simulation/CompactSimEnergyDeposits.cxx
+ *
+ * This is a lighter alternative to a `std::vector<sim::SimEnergyDeposit>`,
+ * produced by `larg4::IonAndScint` with `StoreCompactEnergyDeposits`, and read
+ * back by `detsim::SimDriftElectrons`, `phot::PDFastSimPAR`,
+ * `phot::PDFastSimPVS` and `ShiftEdepSCE` with `CompactEnergyDeposits`
+ * (see `larsim/Simulation/ReadSimEnergyDeposits.h`). The full collection is
+ * still produced for the downstream modules of the same job, and can be
+ * dropped from the output.
+ */
+
+#ifndef LARSIM_SIMULATION_COMPACTSIMENERGYDEPOSITS_H
+#define LARSIM_SIMULATION_COMPACTSIMENERGYDEPOSITS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sim {
+
+  class SimEnergyDeposit;
+
+  /**
+   * @brief A `sim::SimEnergyDeposit` collection, in "structure of arrays" layout.
+   *
+   * Each deposit is stored as the middle point of its step and half of the
+   * step vector, in single precision. Its start time is quantised in steps of
+   * `timeStep` from `timeReference`, and its duration is in single precision.
+   * Its track is the index of the pair of track ID and PDG code in the
+   * dictionary (`trackID`, `pdgCode`).
+   *
+   * The time step is the configured resolution, made larger when the start
+   * times of the collection would not fit the 32 bit range otherwise.
+   * Expanding returns deposits equal to the original ones but for the start
+   * time, which is within half a step of the original, and the single
+   * precision of the positions and of the duration.
+   */
+  struct CompactSimEnergyDeposits {
+
+    /// @name Track dictionary
+    /// @{
+    std::vector<int> trackID; ///< Geant4 track ID.
+    std::vector<int> pdgCode; ///< PDG code of the particle of the track.
+    /// @}
+
+    double timeReference = 0.0; ///< Time of the start time step `0` [ns].
+    double timeStep = 1.0;      ///< Quantum of the start times [ns].
+
+    /// @name Per-deposit information
+    /// @{
+    std::vector<std::uint32_t> track;     ///< Index of the track in the dictionary.
+    std::vector<float> midX;              ///< x of the middle of the step [cm].
+    std::vector<float> midY;              ///< y of the middle of the step [cm].
+    std::vector<float> midZ;              ///< z of the middle of the step [cm].
+    std::vector<float> halfX;             ///< Half of the x step, end minus start [cm].
+    std::vector<float> halfY;             ///< Half of the y step, end minus start [cm].
+    std::vector<float> halfZ;             ///< Half of the z step, end minus start [cm].
+    std::vector<std::int32_t> startTime;  ///< Start time, in steps from the reference.
+    std::vector<float> duration;          ///< End minus start time [ns].
+    std::vector<float> energy;            ///< Deposited energy [MeV].
+    std::vector<std::int32_t> numPhotons;   ///< Number of scintillation photons.
+    std::vector<std::int32_t> numElectrons; ///< Number of ionization electrons.
+    std::vector<float> scintYieldRatio;   ///< Fast scintillation fraction.
+    /// @}
+
+    /// Number of stored deposits.
+    std::size_t
+    nDeposits() const
+    {
+      return energy.size();
+    }
+
+  }; // struct CompactSimEnergyDeposits
+
+  /**
+   * @brief Encodes `deposits` into the compact format.
+   * @param timeResolution the step of the quantised start times [ns]
+   *
+   * The deposits are stored in the same order as in `deposits`.
+   */
+  CompactSimEnergyDeposits makeCompactSimEnergyDeposits(
+    std::vector<sim::SimEnergyDeposit> const& deposits,
+    double timeResolution);
+
+  /// Returns the `sim::SimEnergyDeposit` encoded in `compact`, in the same order.
+  std::vector<sim::SimEnergyDeposit> expandSimEnergyDeposits(
+    CompactSimEnergyDeposits const& compact);
+
+} // namespace sim
+
+#endif // LARSIM_SIMULATION_COMPACTSIMENERGYDEPOSITS_H
@@ -0,0 +1,351 @@
+/**
+ * @file larsim/Simulation/DerivedDataCache.cxx
+ * @brief Node-local cache of data derived from the configuration of a job.
+ * @see larsim/Simulation/DerivedDataCache.h
+ */
+
+#include "larsim/Simulation/DerivedDataCache.h"
+
+#include "cetlib_except/exception.h"
+
+// POSIX
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// C/C++ standard libraries
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+
+  constexpr char Magic[8] = {'L', 'A', 'R', 'C', 'A', 'C', 'H', 'E'};
+  constexpr std::uint32_t FormatVersion = 1U;
+  constexpr char EntrySuffix[] = ".bin";
+
+  /// Temporary files older than this are left over by a crashed build.
+  constexpr std::chrono::hours StaleTemporaryAge{1};
+
+  struct FileHeader_t {
+    char magic[sizeof(Magic)];
+    std::uint32_t version;
+    std::uint32_t alignment;
+    std::uint64_t keySize;
+    std::uint64_t payloadSize;
+  };
+
+  /// Offset of the payload in a file with a key of `keySize` characters.
+  std::uint64_t
+  payloadOffset(std::uint64_t keySize)
+  {
+    constexpr std::uint64_t align = sim::DerivedDataCache::PayloadAlignment;
+    return (sizeof(FileHeader_t) + keySize + align - 1) / align * align;
+  }
+
+  bool
+  isValidName(std::string const& name)
+  {
+    return !name.empty() && std::all_of(name.begin(), name.end(), [](char c) {
+      return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) ||
+             ((c >= '0') && (c <= '9')) || (c == '-') || (c == '_') || (c == '.');
+    });
+  }
+
+  bool
+  endsWith(std::string const& s, std::string_view suffix)
+  {
+    return (s.size() >= suffix.size()) &&
+           (s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0);
+  }
+
+  /// Exclusive `flock()` on a file, released on destruction.
+  class FileLock {
+  public:
+    explicit FileLock(std::string const& path)
+      : fFD{::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)}
+    {
+      if (fFD < 0) return;
+      int res;
+      do {
+        res = ::flock(fFD, LOCK_EX);
+      } while ((res != 0) && (errno == EINTR));
+      if (res != 0) {
+        ::close(fFD);
+        fFD = -1;
+      }
+    }
+    FileLock(FileLock const&) = delete;
+    FileLock& operator=(FileLock const&) = delete;
+    ~FileLock()
+    {
+      if (fFD >= 0) ::close(fFD); // releases the lock
+    }
+
+    bool
+    locked() const
+    {
+      return fFD >= 0;
+    }
+
+  private:
+    int fFD;
+  };
+
+} // local namespace
+
+//------------------------------------------------------------------------------
+std::string
+sim::Digest::hex() const
+{
+  char buffer[17];
+  std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(fValue));
+  return buffer;
+}
+
+//------------------------------------------------------------------------------
+sim::DerivedDataCache::View::View(View&& other) noexcept
+{
+  *this = std::move(other);
+}
+
+sim::DerivedDataCache::View&
+sim::DerivedDataCache::View::operator=(View&& other) noexcept
+{
+  if (this == &other) return *this;
+  release();
+  fMapAddress = std::exchange(other.fMapAddress, nullptr);
+  fMapSize = std::exchange(other.fMapSize, 0);
+  fPath = std::move(other.fPath);
+  std::size_t const size = std::exchange(other.fSize, 0);
+  char const* const data = std::exchange(other.fData, nullptr);
+  bool const inBuffer = (data != nullptr) && (data == other.fBuffer.data());
+  fBuffer = std::move(other.fBuffer);
+  fData = inBuffer ? fBuffer.data() : data;
+  fSize = size;
+  return *this;
+}
+
+sim::DerivedDataCache::View::~View()
+{
+  release();
+}
+
+void
+sim::DerivedDataCache::View::release()
+{
+  if (fMapAddress) ::munmap(fMapAddress, fMapSize);
+  fMapAddress = nullptr;
+  fMapSize = 0;
+  fBuffer.clear();
+  fData = nullptr;
+  fSize = 0;
+  fPath.clear();
+}
+
+//------------------------------------------------------------------------------
+sim::DerivedDataCache::DerivedDataCache(std::string directory, std::uint64_t maxBytes)
+  : fDirectory{std::move(directory)}, fMaxBytes{maxBytes}
+{
+  if (fDirectory.empty()) {
+    throw cet::exception("DerivedDataCache") << "The cache directory must be specified.\n";
+  }
+}
+
+//------------------------------------------------------------------------------
+std::string
+sim::DerivedDataCache::entryPath(std::string const& name, std::string const& key) const
+{
+  if (!isValidName(name)) {
+    throw cet::exception("DerivedDataCache")
+      << "Invalid cache entry name '" << name
+      << "' (only letters, digits, '-', '_' and '.' are allowed).\n";
+  }
+  return (std::filesystem::path{fDirectory} / (name + "_" + Digest{}.add(key).hex() + EntrySuffix))
+    .string();
+}
+
+//------------------------------------------------------------------------------
+sim::DerivedDataCache::View
+sim::DerivedDataCache::find(std::string const& name, std::string const& key) const
+{
+  std::string const path = entryPath(name, key);
+  View view = mapEntry(path, key);
+  if (view.isMapped()) {
+    // the modification time tells the eviction when the entry was last used
+    std::error_code ignored;
+    std::filesystem::last_write_time(
+      path, std::filesystem::file_time_type::clock::now(), ignored);
+  }
+  return view;
+}
+
+//------------------------------------------------------------------------------
+sim::DerivedDataCache::View
+sim::DerivedDataCache::getOrBuild(std::string const& name,
+                                  std::string const& key,
+                                  Builder_t const& builder) const
+{
+  std::string const path = entryPath(name, key);
+  if (View view = find(name, key); view.isMapped()) return view;
+
+  std::error_code error;
+  std::filesystem::create_directories(fDirectory, error);
+  bool published = false;
+  if (!error) {
+    FileLock const lock{path + ".lock"};
+    if (lock.locked()) {
+      // another process may have built the entry while we waited for the lock
+      if (View view = find(name, key); view.isMapped()) return view;
+      published = writeEntry(path, key, builder);
+    }
+  }
+
+  if (published) {
+    if (fMaxBytes > 0) evict(path);
+    if (View view = mapEntry(path, key); view.isMapped()) return view;
+  }
+
+  // the cache is not usable: own the data instead
+  std::ostringstream out;
+  builder(out);
+  View view;
+  view.fBuffer = out.str();
+  view.fData = view.fBuffer.data();
+  view.fSize = view.fBuffer.size();
+  return view;
+}
+
+//------------------------------------------------------------------------------
+void
+sim::DerivedDataCache::evict(std::string const& keep) const
+{
+  if (fMaxBytes == 0) return;
+
+  namespace fs = std::filesystem;
+  std::error_code error;
+  auto const now = fs::file_time_type::clock::now();
+  std::vector<std::tuple<fs::file_time_type, std::uint64_t, fs::path>> entries;
+  std::uint64_t totalBytes = 0;
+  for (fs::directory_iterator it{fDirectory, error}, end; !error && (it != end);
+       it.increment(error)) {
+    fs::path const& path = it->path();
+    std::string const fileName = path.filename().string();
+    std::error_code entryError;
+    auto const time = fs::last_write_time(path, entryError);
+    if (entryError) continue;
+    if (fileName.find(".tmp.") != std::string::npos) {
+      if (now - time > StaleTemporaryAge) fs::remove(path, entryError);
+      continue;
+    }
+    if (!endsWith(fileName, EntrySuffix)) continue;
+    std::uint64_t const size = fs::file_size(path, entryError);
+    if (entryError) continue;
+    totalBytes += size;
+    if (!keep.empty() && fs::equivalent(path, keep, entryError)) continue;
+    entries.emplace_back(time, size, path);
+  }
+
+  std::sort(entries.begin(), entries.end()); // least recently used first
+  for (auto const& [time, size, path] : entries) {
+    if (totalBytes <= fMaxBytes) break;
+    std::error_code removeError;
+    if (fs::remove(path, removeError)) totalBytes -= size;
+  }
+}
+
+//------------------------------------------------------------------------------
+sim::DerivedDataCache::View
+sim::DerivedDataCache::mapEntry(std::string const& path, std::string const& key)
+{
+  View view;
+  int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return view;
+
+  struct stat fileStat;
+  std::uint64_t const expectedSize = payloadOffset(key.size());
+  if ((::fstat(fd, &fileStat) != 0) ||
+      (static_cast<std::uint64_t>(fileStat.st_size) < expectedSize)) {
+    ::close(fd);
+    return view;
+  }
+  std::size_t const mapSize = fileStat.st_size;
+  void* const addr = ::mmap(nullptr, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd); // the mapping keeps its own reference to the file
+  if (addr == MAP_FAILED) return view;
+  view.fMapAddress = addr;
+  view.fMapSize = mapSize;
+
+  char const* const base = static_cast<char const*>(addr);
+  FileHeader_t header;
+  std::memcpy(&header, base, sizeof(header));
+  if ((std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) ||
+      (header.version != FormatVersion) || (header.alignment != PayloadAlignment) ||
+      (header.keySize != key.size()) ||
+      (std::memcmp(base + sizeof(header), key.data(), key.size()) != 0) ||
+      (expectedSize + header.payloadSize != mapSize)) {
+    view.release();
+    return view;
+  }
+
+  view.fData = base + expectedSize;
+  view.fSize = header.payloadSize;
+  view.fPath = path;
+  return view;
+}
+
+//------------------------------------------------------------------------------
+bool
+sim::DerivedDataCache::writeEntry(std::string const& path,
+                                  std::string const& key,
+                                  Builder_t const& builder)
+{
+  std::string const tempPath = path + ".tmp." + std::to_string(::getpid());
+  std::ofstream out{tempPath, std::ios::binary | std::ios::trunc};
+  if (!out) return false;
+
+  std::uint64_t const offset = payloadOffset(key.size());
+  FileHeader_t header{};
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = FormatVersion;
+  header.alignment = PayloadAlignment;
+  header.keySize = key.size();
+  header.payloadSize = 0; // written after the payload
+  out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+  out.write(key.data(), key.size());
+  std::string const padding(offset - sizeof(header) - key.size(), '\0');
+  out.write(padding.data(), padding.size());
+
+  std::error_code ignored;
+  try {
+    builder(out);
+  }
+  catch (...) {
+    out.close();
+    std::filesystem::remove(tempPath, ignored);
+    throw;
+  }
+
+  header.payloadSize = static_cast<std::uint64_t>(out.tellp()) - offset;
+  out.seekp(0);
+  out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+  out.close();
+
+  std::error_code error;
+  if (out) std::filesystem::rename(tempPath, path, error);
+  if (!out || error) {
+    std::filesystem::remove(tempPath, ignored);
+    return false;
+  }
+  return true;
+}
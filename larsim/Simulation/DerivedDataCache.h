@@ -0,0 +1,238 @@
+/**
+ * @file larsim/Simulation/DerivedDataCache.h
+ * @brief Node-local cache of data derived from the configuration of a job.
+ * @see larsim/Simulation/DerivedDataCache.cxx
+ *
+ * Many initialisations of larsim build large tables that depend only on the
+ * configuration and on the geometry (timing samplers, solid angle grids,
+ * sampling spectra, ...). `sim::DerivedDataCache` keeps the result of such a
+ * build in a file of a cache directory, so that the following jobs on the
+ * same node map the file instead of building the table again:
+ *
+ *     sim::DerivedDataCache cache{"/tmp/larsim_cache"};
+ *     sim::DerivedDataCache::View const table = cache.getOrBuild(
+ *       "VUVTiming", key, [&](std::ostream& out) { writeTables(out); });
+ *     readTables(table.data(), table.size());
+ *
+ * The service `sim::DerivedDataCacheService` (see
+ * `larsim/Simulation/DerivedDataCacheService.h`) holds the cache of a job.
+ */
+
+#ifndef LARSIM_SIMULATION_DERIVEDDATACACHE_H
+#define LARSIM_SIMULATION_DERIVEDDATACACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace sim {
+
+  /// FNV-1a digest of binary data, to summarise object content in cache keys.
+  class Digest {
+  public:
+    /// Adds the bytes of `data`.
+    template <typename T>
+    Digest&
+    add(T const& data)
+    {
+      static_assert(std::is_trivially_copyable_v<T>, "Only plain data can be digested");
+      unsigned char bytes[sizeof(T)];
+      std::memcpy(bytes, &data, sizeof(T));
+      for (unsigned char const byte : bytes)
+        fValue = (fValue ^ byte) * 1099511628211ULL;
+      return *this;
+    }
+
+    /// Adds the characters of `s`, and its length.
+    Digest&
+    add(std::string_view s)
+    {
+      add(s.size());
+      for (char const c : s)
+        fValue = (fValue ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+      return *this;
+    }
+
+    Digest&
+    add(std::string const& s)
+    {
+      return add(std::string_view{s});
+    }
+
+    Digest&
+    add(char const* s)
+    {
+      return add(std::string_view{s});
+    }
+
+    std::uint64_t
+    value() const
+    {
+      return fValue;
+    }
+
+    /// Returns the value as 16 hexadecimal digits.
+    std::string hex() const;
+
+  private:
+    std::uint64_t fValue = 14695981039346656037ULL;
+
+  }; // class Digest
+
+  /**
+   * @brief Cache of derived data, in files of a (node-local) directory.
+   *
+   * An entry is identified by a `name`, which tells the kind of data and is
+   * part of the file name, and by a `key`, the description of all that the
+   * data depends on (e.g. the configuration parameter set ID and a `Digest`
+   * of the geometry). The file name includes a digest of the key, and the
+   * full key is stored in the file and checked against the requested one;
+   * so a file which does not match, is incomplete or is corrupted is not
+   * used, and is replaced by a new build.
+   *
+   * Entries are written into a temporary file and published by renaming it,
+   * so that a reader never sees a partial file. The build is protected by a
+   * lock on a companion file (`flock()`): when many processes (or threads)
+   * ask for a missing entry at the same time, the first builds it and the
+   * others wait for it and map the result.
+   *
+   * With a size limit, after each publication the least recently used
+   * entries are removed until the total size of the entries is within the
+   * limit (an entry is "used" each time it is found). Entries mapped by
+   * other processes stay available to them until they are unmapped.
+   *
+   * When the directory can't be written, the data is built in memory and
+   * returned as well, just not cached (`View::isMapped()` is `false`).
+   *
+   * The cache has no mutable state, and all its methods can be called
+   * concurrently.
+   */
+  class DerivedDataCache {
+  public:
+    /// Writes the payload of an entry.
+    using Builder_t = std::function<void(std::ostream&)>;
+
+    /**
+     * @brief The payload of an entry, read only.
+     *
+     * The payload starts at an address aligned to `PayloadAlignment` bytes.
+     * A view is valid until destroyed, even if the entry is removed from the
+     * cache in the meanwhile.
+     */
+    class View {
+    public:
+      View() = default;
+      View(View const&) = delete;
+      View& operator=(View const&) = delete;
+      View(View&& other) noexcept;
+      View& operator=(View&& other) noexcept;
+      ~View();
+
+      char const*
+      data() const
+      {
+        return fData;
+      }
+
+      std::size_t
+      size() const
+      {
+        return fSize;
+      }
+
+      std::string_view
+      bytes() const
+      {
+        return {fData, fSize};
+      }
+
+      /// Whether the payload is mapped from a cache file (not built in memory).
+      bool
+      isMapped() const
+      {
+        return fMapAddress != nullptr;
+      }
+
+      /// Path of the cache file (empty if not mapped).
+      std::string const&
+      path() const
+      {
+        return fPath;
+      }
+
+    private:
+      friend class DerivedDataCache;
+
+      void* fMapAddress = nullptr; ///< Mapping of the whole file.
+      std::size_t fMapSize = 0;
+      std::string fBuffer;         ///< Payload built in memory.
+      char const* fData = nullptr;
+      std::size_t fSize = 0;
+      std::string fPath;
+
+      void release();
+
+    }; // class View
+
+    /// Alignment of the payload in the cache files [bytes].
+    static constexpr std::size_t PayloadAlignment = 64;
+
+    /**
+     * @brief Constructor.
+     * @param directory the cache directory (created on the first build)
+     * @param maxBytes limit to the total size of the entries (`0`: no limit)
+     */
+    explicit DerivedDataCache(std::string directory, std::uint64_t maxBytes = 0);
+
+    std::string const&
+    directory() const
+    {
+      return fDirectory;
+    }
+
+    std::uint64_t
+    maxBytes() const
+    {
+      return fMaxBytes;
+    }
+
+    /**
+     * @brief Returns the payload of the entry, calling `builder` if missing.
+     * @param name kind of data (letters, digits, `-`, `_` and `.` only)
+     * @param key description of all that the data depends on
+     * @param builder writes the payload, if the entry is not in the cache
+     * @throw cet::exception if `name` is not valid
+     *
+     * The exceptions from `builder` are propagated, and nothing is cached.
+     */
+    View getOrBuild(std::string const& name, std::string const& key, Builder_t const& builder) const;
+
+    /// Returns the payload of the entry if in the cache, an empty view if not.
+    View find(std::string const& name, std::string const& key) const;
+
+    /// Removes the least recently used entries but `keep` beyond the size limit.
+    void evict(std::string const& keep = "") const;
+
+    /// Returns the path of the file of the entry.
+    std::string entryPath(std::string const& name, std::string const& key) const;
+
+  private:
+    std::string fDirectory;
+    std::uint64_t fMaxBytes;
+
+    /// Maps the file at `path` if it is a complete entry with this `key`.
+    static View mapEntry(std::string const& path, std::string const& key);
+
+    /// Writes the entry into `path` (true on success).
+    static bool writeEntry(std::string const& path, std::string const& key, Builder_t const& builder);
+
+  }; // class DerivedDataCache
+
+} // namespace sim
+
+#endif // LARSIM_SIMULATION_DERIVEDDATACACHE_H
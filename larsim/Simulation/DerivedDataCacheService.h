@@ -0,0 +1,68 @@
+/**
+ * @file larsim/Simulation/DerivedDataCacheService.h
+ * @brief Job-wide cache of data derived from the configuration.
+ * @see larsim/Simulation/DerivedDataCacheService_service.cc
+ *
+ * Configuration:
+ *
+ * * `Directory` (default: `larsim_derived_data` in `$TMPDIR`, or in `/tmp`):
+ *   the cache directory; it should be local to the node, since the build of
+ *   an entry is serialised with `flock()`
+ * * `MaxSizeMiB` (default: `0`, no limit): limit to the total size of the
+ *   cache entries, beyond which the least recently used ones are removed
+ *
+ * The modules and services with an expensive initialisation use it through
+ * `getOrBuild()` (see `sim::DerivedDataCache` in
+ * `larsim/Simulation/DerivedDataCache.h`), when it is configured:
+ *
+ *     if (art::ServiceRegistry::isAvailable<sim::DerivedDataCacheService>()) {
+ *       auto const table = art::ServiceHandle<sim::DerivedDataCacheService>()
+ *         ->getOrBuild("MyTable", key, [&](std::ostream& out){ build(out); });
+ *       ...
+ *     }
+ */
+
+#ifndef LARSIM_SIMULATION_DERIVEDDATACACHESERVICE_H
+#define LARSIM_SIMULATION_DERIVEDDATACACHESERVICE_H
+
+#include "larsim/Simulation/DerivedDataCache.h"
+
+#include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
+#include "fhiclcpp/fwd.h"
+
+#include <string>
+
+namespace sim {
+
+  /**
+   * @brief Holds the `sim::DerivedDataCache` of the job.
+   *
+   * All the methods can be called concurrently.
+   */
+  class DerivedDataCacheService {
+  public:
+    using View = DerivedDataCache::View;
+    using Builder_t = DerivedDataCache::Builder_t;
+
+    explicit DerivedDataCacheService(fhicl::ParameterSet const& pset);
+
+    /// Returns the payload of the entry, calling `builder` if missing.
+    /// @see `sim::DerivedDataCache::getOrBuild()`
+    View getOrBuild(std::string const& name, std::string const& key, Builder_t const& builder) const;
+
+    DerivedDataCache const&
+    cache() const
+    {
+      return fCache;
+    }
+
+  private:
+    DerivedDataCache fCache;
+
+  }; // class DerivedDataCacheService
+
+} // namespace sim
+
+DECLARE_ART_SERVICE(sim::DerivedDataCacheService, SHARED)
+
+#endif // LARSIM_SIMULATION_DERIVEDDATACACHESERVICE_H
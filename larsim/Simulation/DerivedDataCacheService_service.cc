@@ -0,0 +1,70 @@
+/**
+ * @file larsim/Simulation/DerivedDataCacheService_service.cc
+ * @brief Job-wide cache of data derived from the configuration.
+ * @see larsim/Simulation/DerivedDataCacheService.h
+ */
+
+#include "larsim/Simulation/DerivedDataCacheService.h"
+
+// framework libraries
+#include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// C/C++ standard libraries
+#include <cstdint>
+#include <cstdlib> // std::getenv()
+
+namespace {
+
+  std::string
+  defaultDirectory()
+  {
+    char const* const tmpDir = std::getenv("TMPDIR");
+    std::string const base = (tmpDir && *tmpDir) ? tmpDir : "/tmp";
+    return base + "/larsim_derived_data";
+  }
+
+  std::uint64_t
+  maxBytes(fhicl::ParameterSet const& pset)
+  {
+    double const maxSizeMiB = pset.get<double>("MaxSizeMiB", 0.0);
+    if (maxSizeMiB < 0.0) {
+      throw cet::exception("DerivedDataCacheService")
+        << "MaxSizeMiB must not be negative (" << maxSizeMiB << " requested).\n";
+    }
+    return static_cast<std::uint64_t>(maxSizeMiB * 1024.0 * 1024.0);
+  }
+
+} // local namespace
+
+namespace sim {
+
+  //--------------------------------------------------------------------------
+  DerivedDataCacheService::DerivedDataCacheService(fhicl::ParameterSet const& pset)
+    : fCache{pset.get<std::string>("Directory", defaultDirectory()), maxBytes(pset)}
+  {
+    mf::LogInfo log("DerivedDataCacheService");
+    log << "Derived data cached in '" << fCache.directory() << "'";
+    if (fCache.maxBytes() > 0) log << " (up to " << fCache.maxBytes() << " bytes)";
+  }
+
+  //--------------------------------------------------------------------------
+  DerivedDataCacheService::View
+  DerivedDataCacheService::getOrBuild(std::string const& name,
+                                      std::string const& key,
+                                      Builder_t const& builder) const
+  {
+    View view = fCache.getOrBuild(name, key, builder);
+    if (!view.isMapped()) {
+      mf::LogWarning("DerivedDataCacheService")
+        << "Cache directory '" << fCache.directory() << "' not usable: '" << name
+        << "' built in memory.";
+    }
+    return view;
+  }
+
+} // namespace sim
+
+DEFINE_ART_SERVICE(sim::DerivedDataCacheService)
@@ -14,6 +14,7 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
 
 #ifndef LArG4Parameters_h
 #define LArG4Parameters_h 1
@@ -29,6 +30,15 @@ namespace sim {
 
   class LArG4Parameters {
   public:
+    /// Geant4 region settings, from an entry of the `Regions` list.
+    struct RegionSettings_t {
+      std::string name;                 ///< Name of the Geant4 region
+      std::vector<std::string> volumes; ///< Logical volumes in the region (and their daughters)
+      double productionCut = -1.;       ///< Production cut [cm]; negative: physics list default
+      double maxStepLength = 0.;        ///< Maximum step length [cm]; `0`: no limit
+      double minKineticEnergy = 0.;     ///< Tracks below this kinetic energy are killed [MeV]
+    };
+
     LArG4Parameters(fhicl::ParameterSet const& pset);
 
     int    OpVerbosity()                                      const { return fOpVerbosity;            }
@@ -69,6 +79,8 @@ namespace sim {
     const std::vector<int>&         OpticalParamOrientations() const { return fOpticalParamOrientations;}
     const std::vector<std::vector<std::vector<double>>>& OpticalParamParameters() const {return fOpticalParamParameters;  }
     bool UseLitePhotons()                                     const { return fLitePhotons;            }
+    const std::vector<RegionSettings_t>& Regions()            const { return fRegions;                }
+    double NeutronTrackingTimeLimit()                         const { return fNeutronTrackingTimeLimit; }
 
     bool FillSimEnergyDeposits()                            const { return fFillSimEnergyDeposits;  }
     bool NoElectronPropagation()                            const { return fNoElectronPropagation;  }
@@ -127,6 +139,8 @@ namespace sim {
                                                                                  ///< parameterized volumes
 
     bool const fLitePhotons;
+    std::vector<RegionSettings_t> const fRegions; ///< Geant4 regions with their own cuts and limits
+    double const fNeutronTrackingTimeLimit; ///< Time after which neutrons are killed [ns]; 0: Geant4 default
 
     bool const fFillSimEnergyDeposits;  ///< handle to fill SimEdeps or not
     bool const fNoElectronPropagation;  ///< specifically prevents electron propagation
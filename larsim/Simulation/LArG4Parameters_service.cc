@@ -16,6 +16,39 @@
 
 #include "larsim/Simulation/LArG4Parameters.h"
 
+#include "canvas/Utilities/Exception.h"
+
+#include <utility> // std::move()
+
+namespace {
+
+  std::vector<sim::LArG4Parameters::RegionSettings_t>
+  readRegions(std::vector<fhicl::ParameterSet> const& psets)
+  {
+    std::vector<sim::LArG4Parameters::RegionSettings_t> regions;
+    for (fhicl::ParameterSet const& pset : psets) {
+      sim::LArG4Parameters::RegionSettings_t region;
+      region.name             = pset.get<std::string>("Name");
+      region.volumes          = pset.get<std::vector<std::string>>("Volumes");
+      region.productionCut    = pset.get<double>("ProductionCut", region.productionCut);
+      region.maxStepLength    = pset.get<double>("MaxStepLength", region.maxStepLength);
+      region.minKineticEnergy = pset.get<double>("MinKineticEnergy", region.minKineticEnergy);
+      if (region.volumes.empty()) {
+        throw art::Exception(art::errors::Configuration)
+          << "LArG4Parameters: region '" << region.name << "' has no volume.\n";
+      }
+      if (region.maxStepLength < 0. || region.minKineticEnergy < 0.) {
+        throw art::Exception(art::errors::Configuration)
+          << "LArG4Parameters: region '" << region.name
+          << "' has a negative step or kinetic energy limit.\n";
+      }
+      regions.push_back(std::move(region));
+    }
+    return regions;
+  }
+
+} // local namespace
+
 namespace sim {
 
   //--------------------------------------------------------------------------
@@ -62,6 +95,8 @@ namespace sim {
     , fOpticalParamOrientations{pset.get< std::vector<int>         >("OpticalParamOrientations")}
     , fOpticalParamParameters  {pset.get< std::vector<std::vector<std::vector<double> > > >("OpticalParamParameters")}
     , fLitePhotons             {pset.get< bool                     >("UseLitePhotons"       )}
+    , fRegions                 {readRegions(pset.get< std::vector<fhicl::ParameterSet> >("Regions", {}))}
+    , fNeutronTrackingTimeLimit{pset.get< double                   >("NeutronTrackingTimeLimit", 0.0)}
     , fFillSimEnergyDeposits   {pset.get< bool                     >("FillSimEnergyDeposits",false)}
     , fNoElectronPropagation   {pset.get< bool                     >("NoElectronPropagation",false)}
     , fNoPhotonPropagation     {pset.get< bool                     >("NoPhotonPropagation",false)}
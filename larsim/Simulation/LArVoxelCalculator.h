@@ -22,6 +22,8 @@
 
 #include <vector>
 
+#include "larsim/Simulation/LArVoxelKey.h"
+
 #include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
 #include "fhiclcpp/ParameterSet.h"
 
@@ -62,6 +64,12 @@ namespace sim {
     int ZAxisToBin( const double value ) const { return AxisToBin(2,value); }
     int TAxisToBin( const double value ) const { return AxisToBin(3,value); }
 
+    /// The key of the voxel containing the given (x,y,z,t) point;
+    /// it has the same bins as sim::LArVoxelID(x,y,z,t).
+    LArVoxelKey PositionToKey( const double x, const double y,
+                               const double z, const double t ) const
+    { return LArVoxelKey( XAxisToBin(x), YAxisToBin(y), ZAxisToBin(z), TAxisToBin(t) ); }
+
     /// Get the value of an axis at the center of the given bin.  The
     /// first argument is the axis (x=0, y=1, z=2, t=3) and the second
     /// is the bin number on that axis.
@@ -26,6 +26,7 @@
 ///    double x = id.X();           // axis-by-axis
 ///    int xBinNumber = id.XBin();  // bin number; might be useful for debugging
 ///    TLorentzVector pos(id);      // convert to TLorentzVector
+///    sim::LArVoxelKey key = id.Key(); // all the bins in one integer
 ///
 /// Note that the first and third methods above both return the
 /// bin-center value(s).
@@ -42,6 +43,8 @@
 #ifndef sim_LArVoxelID_h
 #define sim_LArVoxelID_h
 
+#include "larsim/Simulation/LArVoxelKey.h"
+
 #include <TLorentzVector.h>
 #include <TVector3.h>
 
@@ -76,6 +79,10 @@ namespace sim {
     // and the Monte Carlo, but this class does not enforce that
     // consistency.
     explicit LArVoxelID( const TLorentzVector& v );
+
+    // The voxel with the bins packed in a LArVoxelKey.
+    explicit LArVoxelID( const LArVoxelKey& key )
+      : LArVoxelID( key.XBin(), key.YBin(), key.ZBin(), key.TBin() ) {}
     LArVoxelID( const double x,
 		const double y,
 		const double z,
@@ -98,6 +105,10 @@ namespace sim {
     int ZBin() const;
     int TBin() const;
 
+    // The bins packed in one integer, for hashing and fast comparison;
+    // the bins must be within LArVoxelKey::IsRepresentable() ranges.
+    LArVoxelKey Key() const;
+
     // The accessors I expect to be used: The values of the
     // co-ordinates at the bin centers.
     double X() const;
@@ -138,6 +149,8 @@ inline int sim::LArVoxelID::XBin() const { return fbins[0]; }
 inline int sim::LArVoxelID::YBin() const { return fbins[1]; }
 inline int sim::LArVoxelID::ZBin() const { return fbins[2]; }
 inline int sim::LArVoxelID::TBin() const { return fbins[3]; }
+inline sim::LArVoxelKey sim::LArVoxelID::Key() const
+{ return sim::LArVoxelKey( fbins[0], fbins[1], fbins[2], fbins[3] ); }
 
 // A potentially handy definition: At this stage, I'm not sure
 // whether I'm going to be keeping a list based on LArVoxelID or on
@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////
+/// \file  LArVoxelKey.h
+/// \brief The (x,y,z,t) bins of a LAr voxel packed into one integer
+////////////////////////////////////////////////////////////////////////
+///
+/// A LArVoxelKey holds the same bins as a sim::LArVoxelID in a single
+/// 64-bit word, so that it can be compared, copied and hashed as an
+/// integer: it is meant as the key of the transient voxel bookkeeping
+/// (hash tables, sorting), while LArVoxelID stays the persistent
+/// identifier.
+///
+/// The bins are stored with an offset, each on a fixed number of bits,
+/// from the most significant one: t (11 bits), z (19), x (17), y (17).
+/// With the default 0.3 mm voxels that is +/-19.6 m in x and y, +/-78 m
+/// in z, and with 5 us time slices +/-5 ms in t.  Within these ranges
+/// the packing is exact, and the order of the packed values is the
+/// order of sim::LArVoxelID (by t, z, x, then y); bins outside them
+/// wrap around, which IsRepresentable() can tell in advance.
+///
+///    sim::LArVoxelKey key(xBin, yBin, zBin, tBin);
+///    int const z = key.ZBin();
+///    std::unordered_set<sim::LArVoxelKey> voxels;
+///
+/// A key is obtained from a LArVoxelID with LArVoxelID::Key(), and from
+/// a position with LArVoxelCalculator::PositionToKey().
+
+#ifndef sim_LArVoxelKey_h
+#define sim_LArVoxelKey_h
+
+#include <cstddef>
+#include <cstdint>
+#include <functional> // so we can define hash<> below
+
+namespace sim {
+
+  class LArVoxelKey
+  {
+  public:
+    typedef std::uint64_t value_type;
+
+    /// Number of bits of each axis.
+    static constexpr unsigned int kXBits = 17;
+    static constexpr unsigned int kYBits = 17;
+    static constexpr unsigned int kZBits = 19;
+    static constexpr unsigned int kTBits = 11;
+
+    /// The key of bin 0 on all the axes.
+    constexpr LArVoxelKey(): LArVoxelKey(0, 0, 0, 0) {}
+
+    constexpr LArVoxelKey( const int x, const int y, const int z, const int t )
+      : fValue( Encode(t, kTBits, kTShift) | Encode(z, kZBits, kZShift)
+              | Encode(x, kXBits, kXShift) | Encode(y, kYBits, kYShift) )
+    {}
+
+    /// Returns the key with the given packed value.
+    static constexpr LArVoxelKey FromValue( const value_type value )
+    { LArVoxelKey key; key.fValue = value; return key; }
+
+    /// Returns whether these bins are packed exactly.
+    static constexpr bool IsRepresentable( const int x, const int y, const int z, const int t )
+    {
+      return InRange(x, kXBits) && InRange(y, kYBits) && InRange(z, kZBits) && InRange(t, kTBits);
+    }
+
+    constexpr int XBin() const { return Decode(kXBits, kXShift); }
+    constexpr int YBin() const { return Decode(kYBits, kYShift); }
+    constexpr int ZBin() const { return Decode(kZBits, kZShift); }
+    constexpr int TBin() const { return Decode(kTBits, kTShift); }
+
+    /// The packed value.
+    constexpr value_type Value() const { return fValue; }
+
+    /// Sort order of LArVoxelID (by t, z, x, then y), for representable bins.
+    constexpr bool operator< ( const LArVoxelKey& other ) const { return fValue <  other.fValue; }
+    constexpr bool operator==( const LArVoxelKey& other ) const { return fValue == other.fValue; }
+    constexpr bool operator!=( const LArVoxelKey& other ) const { return fValue != other.fValue; }
+
+    /// A well mixed hash of the key (splitmix64 finalizer).
+    constexpr std::size_t Hash() const
+    {
+      value_type h = fValue;
+      h ^= h >> 30;
+      h *= 0xBF58476D1CE4E5B9ULL;
+      h ^= h >> 27;
+      h *= 0x94D049BB133111EBULL;
+      h ^= h >> 31;
+      return static_cast<std::size_t>(h);
+    }
+
+  private:
+    static constexpr unsigned int kYShift = 0;
+    static constexpr unsigned int kXShift = kYShift + kYBits;
+    static constexpr unsigned int kZShift = kXShift + kXBits;
+    static constexpr unsigned int kTShift = kZShift + kZBits;
+    static_assert(kTShift + kTBits == 64, "LArVoxelKey bits do not fill 64 bits");
+
+    value_type fValue;
+
+    static constexpr value_type Mask( const unsigned int bits )
+    { return (value_type(1) << bits) - 1; }
+
+    static constexpr std::uint32_t Bias( const unsigned int bits )
+    { return std::uint32_t(1) << (bits - 1); }
+
+    static constexpr bool InRange( const int bin, const unsigned int bits )
+    { return (bin >= -int(Bias(bits))) && (bin < int(Bias(bits))); }
+
+    // the offset makes the packed bins unsigned, and their order that of the bins
+    static constexpr value_type Encode( const int bin, const unsigned int bits, const unsigned int shift )
+    { return (value_type(static_cast<std::uint32_t>(bin) + Bias(bits)) & Mask(bits)) << shift; }
+
+    constexpr int Decode( const unsigned int bits, const unsigned int shift ) const
+    { return static_cast<int>(static_cast<std::uint32_t>((fValue >> shift) & Mask(bits)) - Bias(bits)); }
+
+  };
+
+} // sim
+
+namespace std {
+  template <>
+  struct hash<sim::LArVoxelKey>
+  {
+    std::size_t operator()( const sim::LArVoxelKey& key ) const { return key.Hash(); }
+  };
+} // std
+
+#endif // sim_LArVoxelKey_h
@@ -160,6 +160,10 @@ namespace sim {
     // directly.  Note that, as with operator[], there's no check
     // against overwriting an existing item.
     void insert( const key_type& key, const mapped_type& value ) { m_voxelList[key] = value; }
+    // The same, with a hint of where the item goes (as for an STL map,
+    // inserting items in order at end() takes constant time).
+    iterator insert( const_iterator hint, const key_type& key, const mapped_type& value )
+    { return m_voxelList.insert_or_assign(hint, key, value); }
 
     size_type erase( const key_type& key ) { return m_voxelList.erase(key); }
 
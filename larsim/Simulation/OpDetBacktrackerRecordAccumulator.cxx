@@ -0,0 +1,130 @@
+////////////////////////////////////////////////////////////////////////
+/// \file OpDetBacktrackerRecordAccumulator.cxx
+///
+/// See comments in the OpDetBacktrackerRecordAccumulator.h file.
+////////////////////////////////////////////////////////////////////////
+
+#include "larsim/Simulation/OpDetBacktrackerRecordAccumulator.h"
+
+#include <algorithm> // std::stable_sort()
+#include <functional> // std::hash
+#include <numeric> // std::iota()
+#include <utility> // std::move()
+
+//------------------------------------------------------------------------------
+std::size_t sim::OpDetBacktrackerRecordAccumulator::KeyHash_t::operator()(Key_t const& key) const
+{
+  std::size_t seed = std::hash<double>{}(key.time);
+  for (std::size_t const v : { key.record, static_cast<std::size_t>(key.trackID) })
+    seed ^= v + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+  return seed;
+}
+
+//------------------------------------------------------------------------------
+void sim::OpDetBacktrackerRecordAccumulator::addRecord(sim::OpDetBacktrackerRecord const& record)
+{
+  std::size_t const iRecord = recordIndex(record.OpDetNum());
+  for (auto const& [time, sdps] : record.timePDclockSDPsMap()) {
+    for (auto const& sdp : sdps) {
+      Entry_t& e = entry(iRecord, sdp.trackID, time);
+      e.nPhotons += sdp.numPhotons;
+      e.energy += sdp.energy;
+      e.weightedPos[0] += sdp.x * sdp.numPhotons;
+      e.weightedPos[1] += sdp.y * sdp.numPhotons;
+      e.weightedPos[2] += sdp.z * sdp.numPhotons;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+void sim::OpDetBacktrackerRecordAccumulator::addPhotons(int opDet,
+                                                        int trackID,
+                                                        double time,
+                                                        double nPhotons,
+                                                        double const* xyz,
+                                                        double energy)
+{
+  Entry_t& e = entry(recordIndex(opDet), trackID, time);
+  e.nPhotons += nPhotons;
+  e.energy += energy;
+  for (std::size_t i = 0; i < 3; ++i)
+    e.weightedPos[i] += xyz[i] * nPhotons;
+}
+
+//------------------------------------------------------------------------------
+void sim::OpDetBacktrackerRecordAccumulator::merge(OpDetBacktrackerRecordAccumulator& other)
+{
+  if (&other == this) return;
+  for (int const opDet : other.fOpDets)
+    recordIndex(opDet);
+  for (Entry_t const& otherEntry : other.fEntries) {
+    Entry_t& e =
+      entry(fRecordIndex[other.fOpDets[otherEntry.key.record]], otherEntry.key.trackID,
+            otherEntry.key.time);
+    e.nPhotons += otherEntry.nPhotons;
+    e.energy += otherEntry.energy;
+    for (std::size_t i = 0; i < 3; ++i)
+      e.weightedPos[i] += otherEntry.weightedPos[i];
+  }
+  other.clear();
+}
+
+//------------------------------------------------------------------------------
+std::vector<sim::OpDetBacktrackerRecord> sim::OpDetBacktrackerRecordAccumulator::yield()
+{
+  std::vector<sim::OpDetBacktrackerRecord> records;
+  records.reserve(fOpDets.size());
+  for (int const opDet : fOpDets)
+    records.emplace_back(opDet);
+
+  // entries are added to each record in time order, so that each new time
+  // is appended; at the same time, tracks keep the order they were added in
+  std::vector<std::size_t> order(fEntries.size());
+  std::iota(order.begin(), order.end(), std::size_t{0});
+  std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+    Key_t const& ka = fEntries[a].key;
+    Key_t const& kb = fEntries[b].key;
+    return (ka.record != kb.record) ? (ka.record < kb.record) : (ka.time < kb.time);
+  });
+
+  for (std::size_t const iEntry : order) {
+    Entry_t const& e = fEntries[iEntry];
+    double xyz[3] = {0., 0., 0.};
+    if (e.nPhotons != 0.) {
+      for (std::size_t i = 0; i < 3; ++i)
+        xyz[i] = e.weightedPos[i] / e.nPhotons;
+    }
+    records[e.key.record].AddScintillationPhotons(e.key.trackID, e.key.time, e.nPhotons, xyz,
+                                                  e.energy);
+  }
+
+  clear();
+  return records;
+}
+
+//------------------------------------------------------------------------------
+void sim::OpDetBacktrackerRecordAccumulator::clear()
+{
+  fOpDets.clear();
+  fRecordIndex.clear();
+  fEntries.clear();
+  fEntryIndex.clear();
+}
+
+//------------------------------------------------------------------------------
+std::size_t sim::OpDetBacktrackerRecordAccumulator::recordIndex(int opDet)
+{
+  auto const [it, inserted] = fRecordIndex.try_emplace(opDet, fOpDets.size());
+  if (inserted) fOpDets.push_back(opDet);
+  return it->second;
+}
+
+//------------------------------------------------------------------------------
+auto sim::OpDetBacktrackerRecordAccumulator::entry(std::size_t record, int trackID, double time)
+  -> Entry_t&
+{
+  Key_t const key{record, trackID, time};
+  auto const [it, inserted] = fEntryIndex.try_emplace(key, fEntries.size());
+  if (inserted) fEntries.push_back(Entry_t{key});
+  return fEntries[it->second];
+}
@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////
+/// \file OpDetBacktrackerRecordAccumulator.h
+///
+/// Collection of the optical detector backtracking information of an
+/// event, before it is stored as `sim::OpDetBacktrackerRecord`.
+///
+/// Adding photons to a `sim::OpDetBacktrackerRecord` costs a search in
+/// its (sorted) time list and in the list of tracks at that time, and
+/// merging records repeats that for each entry. The accumulator keeps
+/// the photon count, energy and position of each optical detector, time
+/// and track in a hash table instead, and makes each record only once,
+/// when the records of the event are yielded.
+////////////////////////////////////////////////////////////////////////
+#ifndef OPDETBACKTRACKERRECORDACCUMULATOR_H
+#define OPDETBACKTRACKERRECORDACCUMULATOR_H
+
+#include "lardataobj/Simulation/OpDetBacktrackerRecord.h"
+
+#include <cstddef> // std::size_t
+#include <unordered_map>
+#include <vector>
+
+namespace sim {
+
+  /**
+   * @brief Accumulates photons by optical detector, time and track.
+   *
+   * Typical use in a producer:
+   *
+   *     fBTRs.addPhotons(opDet, trackID, time, 1, xyz, energy); // for each photon
+   *     fBTRs.addRecord(opDet); // for each detector considered for a deposit
+   *     // ...
+   *     *opbtr = fBTRs.yield(); // once per event
+   *
+   * The result is the same as adding the photons one by one to one record
+   * per optical detector with `sim::OpDetBacktrackerRecord::AddScintillationPhotons()`
+   * (which averages the positions weighted by the number of photons), up to
+   * the rounding of the sums. Records are yielded in the order their
+   * detectors were first seen, and the tracks at each time in the order they
+   * were first added.
+   */
+  class OpDetBacktrackerRecordAccumulator {
+  public:
+    /// Makes sure there is a record for `opDet`, even if without photons.
+    void addRecord(int opDet) { recordIndex(opDet); }
+
+    /// Adds the content of `record`.
+    void addRecord(sim::OpDetBacktrackerRecord const& record);
+
+    /// Adds `nPhotons` photons from track `trackID` on `opDet` at `time`.
+    void addPhotons(int opDet,
+                    int trackID,
+                    double time,
+                    double nPhotons,
+                    double const* xyz,
+                    double energy);
+
+    /// Moves all the content of `other` into this accumulator.
+    void merge(OpDetBacktrackerRecordAccumulator& other);
+
+    /// Returns whether there are no records.
+    bool empty() const { return fOpDets.empty(); }
+
+    /// Returns the records, and clears them from the accumulator.
+    std::vector<sim::OpDetBacktrackerRecord> yield();
+
+    /// Removes all the content.
+    void clear();
+
+  private:
+    struct Key_t {
+      std::size_t record; ///< Index of the record in `fOpDets`.
+      int trackID;
+      double time;
+      bool operator==(Key_t const& other) const
+      {
+        return (record == other.record) && (trackID == other.trackID) && (time == other.time);
+      }
+    };
+
+    struct KeyHash_t {
+      std::size_t operator()(Key_t const& key) const;
+    };
+
+    /// Photons of a detector, time and track (positions weighted by photons).
+    struct Entry_t {
+      Key_t key;
+      double nPhotons = 0.;
+      double energy = 0.;
+      double weightedPos[3] = {0., 0., 0.};
+    };
+
+    std::vector<int> fOpDets;                          ///< Detector of each record.
+    std::unordered_map<int, std::size_t> fRecordIndex; ///< Record of each detector.
+    std::vector<Entry_t> fEntries;                     ///< In order of addition.
+    std::unordered_map<Key_t, std::size_t, KeyHash_t> fEntryIndex;
+
+    std::size_t recordIndex(int opDet);
+
+    Entry_t& entry(std::size_t record, int trackID, double time);
+
+  }; // class OpDetBacktrackerRecordAccumulator
+
+} // namespace sim
+
+#endif // OPDETBACKTRACKERRECORDACCUMULATOR_H
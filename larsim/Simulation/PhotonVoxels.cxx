@@ -33,6 +33,7 @@ namespace sim {
     , fxSteps(xN)
     , fySteps(yN)
     , fzSteps(zN)
+    , fStepsPerLength{{xN / (xMax - xMin), yN / (yMax - yMin), zN / (zMax - zMin)}}
   {}
 
   //----------------------------------------------------------------------------
@@ -68,56 +69,77 @@ namespace sim {
   }
 
   //----------------------------------------------------------------------------
-  std::optional<std::array<sim::PhotonVoxelDef::NeiInfo, 8U>>
-  PhotonVoxelDef::GetNeighboringVoxelIDsImpl(geo::Point_t const& v) const
+  void
+  PhotonVoxelDef::GetVoxelIDs(std::vector<geo::Point_t> const& points,
+                              std::vector<int>& ids) const
   {
-    if (!isInside(v)) return {};
+    std::size_t const n = points.size();
+    ids.resize(n);
+    double const lower[3] = {fLowerCorner.X(), fLowerCorner.Y(), fLowerCorner.Z()};
+    double const upper[3] = {fUpperCorner.X(), fUpperCorner.Y(), fUpperCorner.Z()};
+    double const maxStep[3] = {fxSteps - 1.0, fySteps - 1.0, fzSteps - 1.0};
+    int const stride[3] = {1, int(fxSteps), int(fxSteps * fySteps)};
+    int* id = ids.data();
+    for (std::size_t i = 0; i < n; ++i) {
+      double const coords[3] = {points[i].X(), points[i].Y(), points[i].Z()};
+      bool inside = true;
+      int voxel = 0;
+      for (std::size_t d = 0; d < 3U; ++d) {
+        inside &= (coords[d] >= lower[d]) & (coords[d] < upper[d]);
+        // out-of-range (and NaN) steps are clamped before the conversion,
+        // and the result is discarded below
+        double const step = std::max(0.0, (coords[d] - lower[d]) * fStepsPerLength[d]);
+        voxel += static_cast<int>(std::min(step, maxStep[d])) * stride[d];
+      }
+      id[i] = inside ? voxel : -1;
+    }
+  }
 
-    std::array<sim::PhotonVoxelDef::NeiInfo, 8U> ret;
+  //----------------------------------------------------------------------------
+  bool
+  PhotonVoxelDef::GetNeighboringVoxelIDsImpl(geo::Point_t const& v,
+                                             std::array<NeiInfo, 8U>& neighbors) const
+  {
+    if (!isInside(v)) return false;
 
     // Position in voxel coordinates including floating point part
     auto const rStepD = GetVoxelStepCoordsUnchecked(v);
+    auto const steps = GetSteps();
+
+    // The neighbours are the 8 corners of a cube around this point;
+    // on each axis, the "lower left" corner and the weights of the two sides
+    // are the same for all of them
+    int rStepI[3];
+    double weight[3][2];
+    for (int d = 0; d < 3; ++d) {
+      // Round down to get the "lower left" corner, ensuring we'll stay in-bounds
+      rStepI[d] = std::min(std::max(0, int(rStepD[d])), int(steps[d]) - 2);
+      // These expressions will interpolate when between the 8 corners,
+      // and extrapolate in the half-voxel space around the edges.
+      weight[d][0] = 1 + rStepI[d] - rStepD[d];
+      weight[d][1] = 1 - (rStepI[d] + 1) + rStepD[d];
+    }
 
-    // The neighbours are the 8 corners of a cube around this point
     std::size_t iNeigh = 0U;
     for (int dx : {0, 1}) {
       for (int dy : {0, 1}) {
         for (int dz : {0, 1}) {
-          // The full 3D step
-          const int dr[3] = {dx, dy, dz};
-
-          // The integer-only position of the current corner
-          int rStepI[3];
-          for (int d = 0; d < 3; ++d) {
-            // Round down to get the "lower left" corner
-            rStepI[d] = int(rStepD[d]);
-            // Ensure we'll stay in-bounds
-            rStepI[d] = std::max(0, rStepI[d]);
-            rStepI[d] = std::min(rStepI[d], int(GetSteps()[d]) - 2);
-            // Adjust to the corner we're actually considering
-            rStepI[d] += dr[d];
-          }
-
           double w = 1;
-          for (int d = 0; d < 3; ++d) {
-            // These expressions will interpolate when between the 8 corners,
-            // and extrapolate in the half-voxel space around the edges.
-            if (dr[d] == 0)
-              w *= 1 + rStepI[d] - rStepD[d];
-            else
-              w *= 1 - rStepI[d] + rStepD[d];
-          }
-
-          const int id = (rStepI[0] + rStepI[1] * (fxSteps) + rStepI[2] * (fxSteps * fySteps));
-
-          ret[iNeigh++] = {id, w};
+          w *= weight[0][dx];
+          w *= weight[1][dy];
+          w *= weight[2][dz];
+
+          const int id = ((rStepI[0] + dx) + (rStepI[1] + dy) * (fxSteps) +
+                          (rStepI[2] + dz) * (fxSteps * fySteps));
+
+          neighbors[iNeigh++] = {id, w};
         }
       }
     }
 
     // Sanity check the weights sum to 1
     double wSum = 0;
-    for (const NeiInfo& n : ret)
+    for (const NeiInfo& n : neighbors)
       wSum += n.weight;
     if (std::abs(wSum - 1) > 1e-3) {
       std::string msg = "PhotonVoxelDef::GetNeighboringVoxelIDs():"
@@ -125,13 +147,13 @@ namespace sim {
                         std::to_string(wSum) +
                         " (should be 1)."
                         " Weights are:";
-      for (const NeiInfo& n : ret) {
+      for (const NeiInfo& n : neighbors) {
         msg += ' ';
         msg += std::to_string(n.weight);
       }
       throw std::runtime_error(msg);
     }
-    return {ret};
+    return true;
   }
 
   //----------------------------------------------------------------------------
@@ -180,14 +202,13 @@ namespace sim {
   PhotonVoxelDef::GetVoxelStepCoordsUnchecked(geo::Point_t const& p) const
   {
 
-    auto const span = fUpperCorner - fLowerCorner;
     auto const relPos = p - fLowerCorner;
 
     // BUG the double brace syntax is required to work around clang bug 21629
     // (https://bugs.llvm.org/show_bug.cgi?id=21629)
-    return {{(relPos.X() / span.X()) * fxSteps,
-             (relPos.Y() / span.Y()) * fySteps,
-             (relPos.Z() / span.Z()) * fzSteps}};
+    return {{relPos.X() * fStepsPerLength[0],
+             relPos.Y() * fStepsPerLength[1],
+             relPos.Z() * fStepsPerLength[2]}};
   } // PhotonVoxelDef::GetVoxelStepCoordsUnchecked()
 
   //----------------------------------------------------------------------------
@@ -199,10 +220,12 @@ namespace sim {
     auto const stepCoords = GetVoxelStepCoordsUnchecked(p);
 
     // figure out how many steps this point is in the x,y,z directions;
-    // `p` is guaranteed to be in the mapped volume by the previous check
-    int xStep = static_cast<int>(stepCoords[0]);
-    int yStep = static_cast<int>(stepCoords[1]);
-    int zStep = static_cast<int>(stepCoords[2]);
+    // `p` is guaranteed to be in the mapped volume by the previous check,
+    // but rounding may still bring a point just below the upper border
+    // to the next step
+    int xStep = std::min(static_cast<int>(stepCoords[0]), int(fxSteps) - 1);
+    int yStep = std::min(static_cast<int>(stepCoords[1]), int(fySteps) - 1);
+    int zStep = std::min(static_cast<int>(stepCoords[2]), int(fzSteps) - 1);
 
     // if within bounds, generate the voxel ID
     return (xStep + yStep * (fxSteps) + zStep * (fxSteps * fySteps));
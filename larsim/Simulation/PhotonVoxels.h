@@ -13,6 +13,7 @@
 // C/C++ standard libraries
 #include <array>
 #include <optional>
+#include <vector>
 
 namespace sim {
 
@@ -65,6 +66,9 @@ namespace sim {
     unsigned int fySteps = 1U;
     unsigned int fzSteps = 1U;
 
+    /// Number of steps per unit length on each axis (inverse of the voxel size).
+    std::array<double, 3U> fStepsPerLength{{0.0, 0.0, 0.0}};
+
   public:
     PhotonVoxelDef() = default;
     PhotonVoxelDef(double xMin,
@@ -110,6 +114,16 @@ namespace sim {
     int GetVoxelID(double const*) const;
     bool IsLegalVoxelID(int) const;
 
+    /**
+     * @brief Fills `ids` with the ID of the voxel containing each of `points`.
+     * @param points the locations to find the voxels of
+     * @param ids (output) voxel ID of each point (`-1` if outside the volume)
+     *
+     * The result is the same as `GetVoxelID()` on each point, but the loop has
+     * no branches, so that the compiler can vectorize it.
+     */
+    void GetVoxelIDs(std::vector<geo::Point_t> const& points, std::vector<int>& ids) const;
+
     struct NeiInfo {
       NeiInfo() = default;
       NeiInfo(int i, double w) : id(i), weight(w) {}
@@ -131,6 +145,19 @@ namespace sim {
     template <typename Point>
     std::optional<std::array<NeiInfo, 8U>> GetNeighboringVoxelIDs(Point const& v) const;
 
+    /**
+     * @brief Fills `neighbors` with the eight neighboring voxels around `v`.
+     * @param v location within the mapped volume
+     * @param neighbors (output) the neighboring voxels with their weights
+     * @return whether `v` is inside the mapped volume
+     *
+     * This is the same as the other `GetNeighboringVoxelIDs()`, but the result
+     * is written in a buffer provided by the caller, which can be reused across
+     * calls. If `v` is not inside the volume, `neighbors` is left untouched.
+     */
+    template <typename Point>
+    bool GetNeighboringVoxelIDs(Point const& v, std::array<NeiInfo, 8U>& neighbors) const;
+
     PhotonVoxel GetPhotonVoxel(int ID) const;
     std::array<int, 3U> GetVoxelCoords(int ID) const;
 
@@ -151,7 +178,8 @@ namespace sim {
   private:
     int GetVoxelIDImpl(geo::Point_t const& p) const;
 
-    std::optional<std::array<NeiInfo, 8U>> GetNeighboringVoxelIDsImpl(geo::Point_t const& v) const;
+    bool GetNeighboringVoxelIDsImpl(geo::Point_t const& v,
+                                    std::array<NeiInfo, 8U>& neighbors) const;
 
     /// Returns the coordinates of the cvoxel containing `p` in step units.
     std::array<double, 3U> GetVoxelStepCoordsUnchecked(geo::Point_t const& p) const;
@@ -241,7 +269,17 @@ template <typename Point>
 std::optional<std::array<sim::PhotonVoxelDef::NeiInfo, 8U>>
 sim::PhotonVoxelDef::GetNeighboringVoxelIDs(Point const& v) const
 {
-  return GetNeighboringVoxelIDsImpl(geo::vect::toPoint(v));
+  std::array<NeiInfo, 8U> neighbors;
+  if (!GetNeighboringVoxelIDsImpl(geo::vect::toPoint(v), neighbors)) return {};
+  return {neighbors};
+}
+
+template <typename Point>
+bool
+sim::PhotonVoxelDef::GetNeighboringVoxelIDs(Point const& v,
+                                            std::array<NeiInfo, 8U>& neighbors) const
+{
+  return GetNeighboringVoxelIDsImpl(geo::vect::toPoint(v), neighbors);
 }
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,112 @@
+/**
+ * @file larsim/Simulation/ProductFootprint.cxx
+ * @brief Element counts and estimated memory of the simulation data products.
+ * @see larsim/Simulation/ProductFootprint.h
+ */
+
+#include "larsim/Simulation/ProductFootprint.h"
+#include "larsim/Simulation/ProductFootprintService.h"
+
+// LArSoft libraries
+#include "lardataobj/RawData/RawDigit.h"
+#include "lardataobj/Simulation/AuxDetSimChannel.h"
+#include "lardataobj/Simulation/OpDetBacktrackerRecord.h"
+#include "lardataobj/Simulation/SimChannel.h"
+#include "lardataobj/Simulation/SimPhotons.h"
+#include "nusimdata/SimulationBase/MCParticle.h"
+
+// framework libraries
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art/Framework/Services/Registry/ServiceRegistry.h"
+
+// ROOT
+#include "TLorentzVector.h"
+
+// C/C++ standard libraries
+#include <memory> // std::make_unique()
+
+namespace {
+
+  /// Memory of a node of a `std::map` or `std::set` holding `T`.
+  template <typename T>
+  constexpr std::size_t
+  treeNodeBytes()
+  {
+    return sizeof(T) + 4 * sizeof(void*); // colour, parent and children
+  }
+
+} // local namespace
+
+//----------------------------------------------------------------------------
+std::size_t
+sim::ownedBytes(sim::SimChannel const& channel)
+{
+  auto const& tdcides = channel.TDCIDEMap();
+  std::size_t bytes = tdcides.capacity() * sizeof(tdcides.front());
+  for (auto const& tdcide : tdcides)
+    bytes += tdcide.second.capacity() * sizeof(sim::IDE);
+  return bytes;
+}
+
+//----------------------------------------------------------------------------
+std::size_t
+sim::ownedBytes(sim::SimPhotons const& photons)
+{
+  return photons.capacity() * sizeof(sim::OnePhoton);
+}
+
+//----------------------------------------------------------------------------
+std::size_t
+sim::ownedBytes(sim::SimPhotonsLite const& photons)
+{
+  return photons.DetectedPhotons.size() *
+         treeNodeBytes<decltype(photons.DetectedPhotons)::value_type>();
+}
+
+//----------------------------------------------------------------------------
+std::size_t
+sim::ownedBytes(sim::OpDetBacktrackerRecord const& record)
+{
+  auto const& timeSDPs = record.timePDclockSDPsMap();
+  std::size_t bytes = timeSDPs.capacity() * sizeof(timeSDPs.front());
+  for (auto const& timeSDP : timeSDPs)
+    bytes += timeSDP.second.capacity() * sizeof(sim::SDP);
+  return bytes;
+}
+
+//----------------------------------------------------------------------------
+std::size_t
+sim::ownedBytes(sim::AuxDetSimChannel const& channel)
+{
+  return channel.AuxDetIDEs().capacity() * sizeof(sim::AuxDetIDE);
+}
+
+//----------------------------------------------------------------------------
+std::size_t
+sim::ownedBytes(simb::MCParticle const& particle)
+{
+  // each trajectory point is a position and a momentum
+  return particle.NumberTrajectoryPoints() * 2 * sizeof(TLorentzVector) +
+         particle.NumberDaughters() * treeNodeBytes<int>() + particle.Process().capacity() +
+         particle.EndProcess().capacity();
+}
+
+//----------------------------------------------------------------------------
+std::size_t
+sim::ownedBytes(raw::RawDigit const& digit)
+{
+  return digit.ADCs().capacity() * sizeof(short);
+}
+
+//----------------------------------------------------------------------------
+void
+sim::reportFootprints(art::Event& event,
+                      std::string const& module,
+                      ProductFootprints footprints,
+                      bool storeProduct)
+{
+  if (art::ServiceRegistry::isAvailable<sim::ProductFootprintService>())
+    art::ServiceHandle<sim::ProductFootprintService>()->record(module, footprints);
+  if (storeProduct) event.put(std::make_unique<ProductFootprints>(std::move(footprints)));
+}
@@ -0,0 +1,100 @@
+/**
+ * @file larsim/Simulation/ProductFootprint.h
+ * @brief Element counts and estimated memory of the simulation data products.
+ * @see larsim/Simulation/ProductFootprint.cxx
+ *
+ * The simulation producers (`LArG4`, `SimDriftElectrons`, the fast optical
+ * simulations, `SimWire`, `MergeSimSources`) describe each collection they
+ * put into the event with a `sim::ProductFootprint`, and hand the list to
+ * `sim::reportFootprints()`: with `sim::ProductFootprintService` in the job
+ * the footprints are accumulated in its per-job summary, and with the
+ * `StoreProductFootprints` option of the module they are also put into the
+ * event as a `std::vector<sim::ProductFootprint>`.
+ *
+ * The sizes are estimates of the memory taken by the collection, including
+ * the content owned by its elements (IDEs of a channel, photons,
+ * trajectory points...), but not the allocator overhead.
+ */
+
+#ifndef LARSIM_SIMULATION_PRODUCTFOOTPRINT_H
+#define LARSIM_SIMULATION_PRODUCTFOOTPRINT_H
+
+#include <cstddef>
+#include <string>
+#include <utility> // std::move()
+#include <vector>
+
+namespace art {
+  class Event;
+}
+namespace raw {
+  class RawDigit;
+}
+namespace simb {
+  class MCParticle;
+}
+namespace sim {
+  class AuxDetSimChannel;
+  class OpDetBacktrackerRecord;
+  class SimChannel;
+  class SimPhotons;
+  class SimPhotonsLite;
+}
+
+namespace sim {
+
+  /// Size of a data product put into the event.
+  struct ProductFootprint {
+    std::string product;               ///< Element type (e.g. `"sim::SimChannel"`).
+    std::string instance;              ///< Instance name of the data product.
+    unsigned long long elements = 0ULL; ///< Number of elements in the collection.
+    unsigned long long bytes = 0ULL;    ///< Estimated memory of the collection.
+  };
+
+  using ProductFootprints = std::vector<ProductFootprint>;
+
+  /// @{
+  /// @name Memory owned by an element, beside `sizeof` of the element itself
+  template <typename T>
+  std::size_t
+  ownedBytes(T const&)
+  {
+    return 0U;
+  }
+  std::size_t ownedBytes(sim::SimChannel const& channel);
+  std::size_t ownedBytes(sim::SimPhotons const& photons);
+  std::size_t ownedBytes(sim::SimPhotonsLite const& photons);
+  std::size_t ownedBytes(sim::OpDetBacktrackerRecord const& record);
+  std::size_t ownedBytes(sim::AuxDetSimChannel const& channel);
+  std::size_t ownedBytes(simb::MCParticle const& particle);
+  std::size_t ownedBytes(raw::RawDigit const& digit);
+  /// @}
+
+  /// Returns the footprint of the collection `coll` of `product` elements.
+  template <typename T>
+  ProductFootprint
+  makeFootprint(std::string product, std::vector<T> const& coll, std::string instance = "")
+  {
+    ProductFootprint footprint{std::move(product), std::move(instance), coll.size(), 0ULL};
+    footprint.bytes = sizeof(coll) + coll.capacity() * sizeof(T);
+    for (T const& element : coll)
+      footprint.bytes += ownedBytes(element);
+    return footprint;
+  }
+
+  /**
+   * @brief Reports the footprints of the products of `module` in this event.
+   * @param storeProduct whether to put `footprints` into the event too
+   *
+   * The footprints go to `sim::ProductFootprintService` when the service is
+   * configured. With `storeProduct`, the module must have declared it
+   * `produces<std::vector<sim::ProductFootprint>>()`.
+   */
+  void reportFootprints(art::Event& event,
+                        std::string const& module,
+                        ProductFootprints footprints,
+                        bool storeProduct);
+
+} // namespace sim
+
+#endif // LARSIM_SIMULATION_PRODUCTFOOTPRINT_H
@@ -0,0 +1,89 @@
+/**
+ * @file larsim/Simulation/ProductFootprintService.h
+ * @brief Per-job summary of the size of the simulation products and services.
+ * @see larsim/Simulation/ProductFootprintService_service.cc
+ *
+ * Configuration:
+ *
+ * * `OutputFile` (default: empty): JSON file the summary is written into at
+ *   the end of the job; the summary is always printed in the log as well.
+ *
+ * The producers report through `sim::reportFootprints()` (see
+ * `larsim/Simulation/ProductFootprint.h`), the services with the memory of
+ * their tables through `recordServiceFootprint()`.
+ */
+
+#ifndef LARSIM_SIMULATION_PRODUCTFOOTPRINTSERVICE_H
+#define LARSIM_SIMULATION_PRODUCTFOOTPRINTSERVICE_H
+
+#include "larsim/Simulation/ProductFootprint.h"
+
+#include "art/Framework/Services/Registry/ActivityRegistry.h"
+#include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
+#include "fhiclcpp/fwd.h"
+
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <utility>
+
+namespace sim {
+
+  /**
+   * @brief Accumulates the footprints of the data products of the job.
+   *
+   * For each module, product type and instance name, the number of events,
+   * the total and the largest per-event number of elements and size are
+   * kept. All the methods can be called concurrently.
+   */
+  class ProductFootprintService {
+  public:
+    /// Accumulated footprint of one data product.
+    struct ProductStats_t {
+      unsigned long long events = 0ULL;
+      unsigned long long elements = 0ULL;
+      unsigned long long bytes = 0ULL;
+      unsigned long long maxElements = 0ULL;
+      unsigned long long maxBytes = 0ULL;
+    };
+
+    /// Module label, product type, instance name.
+    using ProductKey_t = std::tuple<std::string, std::string, std::string>;
+
+    ProductFootprintService(fhicl::ParameterSet const& pset, art::ActivityRegistry& reg);
+
+    /// Adds the `footprints` of the products of `module` in one event.
+    void record(std::string const& module, ProductFootprints const& footprints);
+
+    /// Sets the memory taken by `item` of `service` (e.g. a library table).
+    void recordServiceFootprint(std::string const& service,
+                                std::string const& item,
+                                unsigned long long bytes);
+
+    /// Returns a copy of the accumulated product footprints.
+    std::map<ProductKey_t, ProductStats_t> productStats() const;
+
+    /// Prints the summary, one line per product and per service item.
+    void dump(std::ostream& out, std::string const& indent = "") const;
+
+    /// Writes the summary as a JSON object.
+    void writeJSON(std::ostream& out) const;
+
+  private:
+    std::string fOutputFile;
+
+    mutable std::mutex fMutex; ///< Protects the members below.
+    std::map<ProductKey_t, ProductStats_t> fProducts;
+    std::map<std::pair<std::string, std::string>, unsigned long long> fServices;
+
+    void postEndJob();
+
+  }; // class ProductFootprintService
+
+} // namespace sim
+
+DECLARE_ART_SERVICE(sim::ProductFootprintService, SHARED)
+
+#endif // LARSIM_SIMULATION_PRODUCTFOOTPRINTSERVICE_H
@@ -0,0 +1,162 @@
+/**
+ * @file larsim/Simulation/ProductFootprintService_service.cc
+ * @brief Per-job summary of the size of the simulation products and services.
+ * @see larsim/Simulation/ProductFootprintService.h
+ */
+
+#include "larsim/Simulation/ProductFootprintService.h"
+
+// framework libraries
+#include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// C/C++ standard libraries
+#include <algorithm> // std::max()
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+  /// Writes `s` as a JSON string (control characters are replaced by spaces).
+  void
+  writeJSONstring(std::ostream& out, std::string const& s)
+  {
+    out << '"';
+    for (char c : s) {
+      if ((c == '"') || (c == '\\'))
+        out << '\\' << c;
+      else if (static_cast<unsigned char>(c) < 0x20)
+        out << ' ';
+      else
+        out << c;
+    }
+    out << '"';
+  }
+
+  /// Returns the product name with its instance, if any.
+  std::string
+  productName(std::string const& product, std::string const& instance)
+  {
+    return instance.empty() ? product : (product + " (" + instance + ")");
+  }
+
+} // local namespace
+
+namespace sim {
+
+  //--------------------------------------------------------------------------
+  ProductFootprintService::ProductFootprintService(fhicl::ParameterSet const& pset,
+                                                   art::ActivityRegistry& reg)
+    : fOutputFile{pset.get<std::string>("OutputFile", "")}
+  {
+    reg.sPostEndJob.watch(this, &ProductFootprintService::postEndJob);
+  }
+
+  //--------------------------------------------------------------------------
+  void
+  ProductFootprintService::record(std::string const& module, ProductFootprints const& footprints)
+  {
+    std::lock_guard const lock{fMutex};
+    for (ProductFootprint const& footprint : footprints) {
+      ProductStats_t& stats = fProducts[{module, footprint.product, footprint.instance}];
+      ++stats.events;
+      stats.elements += footprint.elements;
+      stats.bytes += footprint.bytes;
+      stats.maxElements = std::max(stats.maxElements, footprint.elements);
+      stats.maxBytes = std::max(stats.maxBytes, footprint.bytes);
+    }
+  }
+
+  //--------------------------------------------------------------------------
+  void
+  ProductFootprintService::recordServiceFootprint(std::string const& service,
+                                                  std::string const& item,
+                                                  unsigned long long bytes)
+  {
+    std::lock_guard const lock{fMutex};
+    fServices[{service, item}] = bytes;
+  }
+
+  //--------------------------------------------------------------------------
+  std::map<ProductFootprintService::ProductKey_t, ProductFootprintService::ProductStats_t>
+  ProductFootprintService::productStats() const
+  {
+    std::lock_guard const lock{fMutex};
+    return fProducts;
+  }
+
+  //--------------------------------------------------------------------------
+  void
+  ProductFootprintService::dump(std::ostream& out, std::string const& indent /* = "" */) const
+  {
+    std::lock_guard const lock{fMutex};
+    out << indent << "Data products (mean and largest per event):";
+    for (auto const& [key, stats] : fProducts) {
+      auto const& [module, product, instance] = key;
+      out << "\n"
+          << indent << "  " << module << ": " << productName(product, instance) << ": "
+          << (stats.elements / stats.events) << " elements, " << (stats.bytes / stats.events)
+          << " bytes (largest: " << stats.maxElements << " elements, " << stats.maxBytes
+          << " bytes) in " << stats.events << " events";
+    }
+    out << "\n" << indent << "Services:";
+    for (auto const& [key, bytes] : fServices)
+      out << "\n" << indent << "  " << key.first << ": " << key.second << ": " << bytes << " bytes";
+  }
+
+  //--------------------------------------------------------------------------
+  void
+  ProductFootprintService::writeJSON(std::ostream& out) const
+  {
+    std::lock_guard const lock{fMutex};
+    out << "{\n  \"products\": [";
+    bool first = true;
+    for (auto const& [key, stats] : fProducts) {
+      auto const& [module, product, instance] = key;
+      out << (first ? "\n    " : ",\n    ") << "{ \"module\": ";
+      writeJSONstring(out, module);
+      out << ", \"product\": ";
+      writeJSONstring(out, product);
+      out << ", \"instance\": ";
+      writeJSONstring(out, instance);
+      out << ", \"events\": " << stats.events << ", \"elements\": " << stats.elements
+          << ", \"bytes\": " << stats.bytes << ", \"maxElements\": " << stats.maxElements
+          << ", \"maxBytes\": " << stats.maxBytes << " }";
+      first = false;
+    }
+    out << "\n  ],\n  \"services\": [";
+    first = true;
+    for (auto const& [key, bytes] : fServices) {
+      out << (first ? "\n    " : ",\n    ") << "{ \"service\": ";
+      writeJSONstring(out, key.first);
+      out << ", \"item\": ";
+      writeJSONstring(out, key.second);
+      out << ", \"bytes\": " << bytes << " }";
+      first = false;
+    }
+    out << "\n  ]\n}\n";
+  }
+
+  //--------------------------------------------------------------------------
+  void
+  ProductFootprintService::postEndJob()
+  {
+    std::ostringstream sstr;
+    dump(sstr, "  ");
+    mf::LogInfo("ProductFootprintService") << "Memory footprint summary:\n" << sstr.str();
+
+    if (fOutputFile.empty()) return;
+    std::ofstream out(fOutputFile);
+    writeJSON(out);
+    out.close();
+    if (!out) {
+      throw cet::exception("ProductFootprintService")
+        << "Error writing the footprint summary into '" << fOutputFile << "'\n";
+    }
+  }
+
+} // namespace sim
+
+DEFINE_ART_SERVICE(sim::ProductFootprintService)
@@ -0,0 +1,59 @@
+/**
+ * @file larsim/Simulation/ReadSimEnergyDeposits.h
+ * @brief Reads energy deposits from either a full or a compact collection.
+ * @see larsim/Simulation/CompactSimEnergyDeposits.h
+ *
+ * The consumers of `sim::SimEnergyDeposit` reading the compact format
+ * (`CompactEnergyDeposits` option) get the same collection they would read
+ * from a `std::vector<sim::SimEnergyDeposit>`:
+ *
+ *     std::vector<sim::SimEnergyDeposit> const* edeps =
+ *       sim::readSimEnergyDeposits(event, fSimTag, fCompactEnergyDeposits, fEdepBuffer);
+ *     if (!edeps) return; // no deposits in the event
+ *
+ */
+
+#ifndef LARSIM_SIMULATION_READSIMENERGYDEPOSITS_H
+#define LARSIM_SIMULATION_READSIMENERGYDEPOSITS_H
+
+#include "larsim/Simulation/CompactSimEnergyDeposits.h"
+
+#include "lardataobj/Simulation/SimEnergyDeposit.h"
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Utilities/InputTag.h"
+
+#include <vector>
+
+namespace sim {
+
+  /**
+   * @brief Returns the energy deposits of `tag` in `event`.
+   * @param compact whether `tag` is a `sim::CompactSimEnergyDeposits`
+   * @param buffer where the expanded deposits are kept, if `compact`
+   * @return the deposits, or `nullptr` if `tag` is not in the event
+   *
+   * The deposits are valid for the processing of `event`, and as long as
+   * `buffer` is unchanged.
+   */
+  inline std::vector<sim::SimEnergyDeposit> const*
+  readSimEnergyDeposits(art::Event const& event,
+                        art::InputTag const& tag,
+                        bool compact,
+                        std::vector<sim::SimEnergyDeposit>& buffer)
+  {
+    if (compact) {
+      art::Handle<sim::CompactSimEnergyDeposits> compactHandle;
+      if (!event.getByLabel(tag, compactHandle)) return nullptr;
+      buffer = sim::expandSimEnergyDeposits(*compactHandle);
+      return &buffer;
+    }
+    art::Handle<std::vector<sim::SimEnergyDeposit>> edepHandle;
+    if (!event.getByLabel(tag, edepHandle)) return nullptr;
+    return edepHandle.product();
+  }
+
+} // namespace sim
+
+#endif // LARSIM_SIMULATION_READSIMENERGYDEPOSITS_H
@@ -10,7 +10,9 @@
 #include "larsim/Simulation/SimListUtils.h"
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
 #include "lardataobj/Simulation/SimChannel.h"
+#include "larsim/Simulation/CompactLArVoxelList.h"
 #include "larsim/Simulation/LArG4Parameters.h"
+#include "larsim/Simulation/LArVoxelCalculator.h"
 
 // Framework includes
 #include "art/Framework/Principal/Event.h"
@@ -23,6 +25,16 @@ namespace sim {
   // are putting into the list
   sim::LArVoxelList
   SimListUtils::GetLArVoxelList(const art::Event& evt, std::string moduleLabel)
+  {
+    std::vector<std::size_t> ideVoxels;
+    return GetLArVoxelList(evt, moduleLabel, ideVoxels);
+  }
+
+  //----------------------------------------------------------------------
+  sim::LArVoxelList
+  SimListUtils::GetLArVoxelList(const art::Event& evt,
+                                std::string moduleLabel,
+                                std::vector<std::size_t>& ideVoxels)
   {
     art::ServiceHandle<sim::LArG4Parameters const> lgp;
     auto const clocks = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
@@ -31,7 +43,17 @@ namespace sim {
     std::vector<const sim::SimChannel*> sccol;
     evt.getView(moduleLabel, sccol);
 
-    sim::LArVoxelList voxList;
+    art::ServiceHandle<sim::LArVoxelCalculator const> voxelCalc;
+
+    // accumulate in a hash table first, and make the sorted list only once
+    std::size_t nIDEs = 0;
+    for (const sim::SimChannel* sc : sccol)
+      for (auto const& tdcide : sc->TDCIDEMap())
+        nIDEs += tdcide.second.size();
+    sim::CompactLArVoxelList voxels;
+    voxels.reserve(nIDEs);
+    ideVoxels.clear();
+    ideVoxels.reserve(nIDEs);
 
     // loop over the voxels and put them into the list
     for (auto itr = sccol.begin(); itr != sccol.end(); ++itr) {
@@ -44,24 +66,33 @@ namespace sim {
 
         double time = (*mitr).first - trigger_offset(clocks);
         time *= sampling_rate(clocks);
+        int const tBin = voxelCalc->TAxisToBin(time);
 
         // loop over the sim::IDE objects
         const std::vector<sim::IDE>& ide = (*mitr).second;
         for (size_t i = 0; i < ide.size(); ++i) {
 
-          sim::LArVoxelID larVoxelID(ide[i].x, ide[i].y, ide[i].z, time);
+          // same bins as sim::LArVoxelID(ide[i].x, ide[i].y, ide[i].z, time)
+          sim::CompactLArVoxelList::bins_type const bins{{voxelCalc->XAxisToBin(ide[i].x),
+                                                          voxelCalc->YAxisToBin(ide[i].y),
+                                                          voxelCalc->ZAxisToBin(ide[i].z),
+                                                          tBin}};
 
           // if energy is unassigned the TrackId is sim::kNoParticleId
-          voxList.Add(larVoxelID, ide[i].numElectrons / lgp->GeVToElectrons(), ide[i].trackID);
-
-          // set the voxel id for the just added LArVoxelData
-          (*voxList.find(larVoxelID)).second.SetVoxelID(larVoxelID);
+          ideVoxels.push_back(
+            voxels.Add(bins, ide[i].numElectrons / lgp->GeVToElectrons(), ide[i].trackID));
 
         } // end loop over ide for this tdc
       }   // end loop over map
     }     // end loop over sim::SimChannels
 
-    return voxList;
+    // the voxel ID of each LArVoxelData is set by the conversion;
+    // translate the voxel of each IDE into its position in the list
+    std::vector<sim::CompactLArVoxelList::size_type> listIndex;
+    sim::LArVoxelList list = voxels.ToLArVoxelList(&listIndex);
+    for (std::size_t& voxel : ideVoxels)
+      voxel = listIndex[voxel];
+    return list;
   }
 
   //----------------------------------------------------------------------
@@ -9,7 +9,9 @@
 #ifndef SIMLISTUTILS_H
 #define SIMLISTUTILS_H
 
+#include <cstddef>
 #include <string>
+#include <vector>
 
 #include "art/Framework/Principal/fwd.h"
 #include "lardataobj/Simulation/SimPhotons.h"
@@ -19,6 +21,12 @@ namespace sim {
   class SimListUtils {
   public:
     static sim::LArVoxelList GetLArVoxelList(const art::Event& evt, std::string moduleLabel);
+    /// As above, and fills `ideVoxels` with the position in the list (in
+    /// iteration order) of the voxel of each sim::IDE, for all the sim::IDE
+    /// of all the sim::SimChannel in order of channel, TDC and IDE.
+    static sim::LArVoxelList GetLArVoxelList(const art::Event& evt,
+                                             std::string moduleLabel,
+                                             std::vector<std::size_t>& ideVoxels);
     static sim::SimPhotonsCollection GetSimPhotonsCollection(const art::Event& evt,
                                                              std::string moduleLabel);
 
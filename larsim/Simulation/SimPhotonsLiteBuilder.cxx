@@ -0,0 +1,245 @@
+////////////////////////////////////////////////////////////////////////
+/// \file SimPhotonsLiteBuilder.cxx
+///
+/// See comments in the SimPhotonsLiteBuilder.h file.
+////////////////////////////////////////////////////////////////////////
+
+#include "larsim/Simulation/SimPhotonsLiteBuilder.h"
+
+#include <algorithm> // std::fill(), std::copy(), std::find_if()
+#include <limits>
+#include <utility> // std::move()
+
+namespace {
+
+  /// Adds counts to a map, given in increasing time: each insertion starts
+  /// from the last one, so that adding to a map costs linear time.
+  class SortedCountAdder {
+  public:
+    explicit SortedCountAdder(std::map<int, int>& counts)
+      : fCounts(counts), fNext(counts.begin())
+    {}
+
+    void operator()(int time, int n)
+    {
+      while ((fNext != fCounts.end()) && (fNext->first < time)) ++fNext;
+      if ((fNext != fCounts.end()) && (fNext->first == time))
+        fNext->second += n;
+      else
+        fNext = fCounts.emplace_hint(fNext, time, n);
+      ++fNext;
+    }
+
+  private:
+    std::map<int, int>& fCounts;
+    std::map<int, int>::iterator fNext; ///< First element after the last insertion.
+  };
+
+} // local namespace
+
+//------------------------------------------------------------------------------
+void sim::addDetectedPhotons(std::map<int, int>& dest, std::map<int, int> const& src)
+{
+  SortedCountAdder add{dest};
+  for (auto const& [time, n] : src)
+    add(time, n);
+}
+
+//------------------------------------------------------------------------------
+//--- sim::LitePhotonHistogram
+//------------------------------------------------------------------------------
+void sim::LitePhotonHistogram::addOutOfWindow(int time, int nphotons)
+{
+  bool const used = (fMinBin <= fMaxBin);
+  long long const lowTime = used ? std::min<long long>(time, fOffset + fMinBin) : time;
+  long long const highTime = used ? std::max<long long>(time, fOffset + fMaxBin) : time;
+  if (!reframe(lowTime, highTime)) {
+    fSparse[time] += nphotons;
+    return;
+  }
+  long long const bin = time - fOffset;
+  fBins[bin] += nphotons;
+  if (!used || (bin < fMinBin)) fMinBin = bin;
+  if (!used || (bin > fMaxBin)) fMaxBin = bin;
+}
+
+//------------------------------------------------------------------------------
+bool sim::LitePhotonHistogram::reframe(long long lowTime, long long highTime)
+{
+  long long const span = highTime - lowTime + 1;
+  if (span > fMaxDenseTicks) return false;
+
+  long long const size = static_cast<long long>(fBins.size());
+  bool const used = (fMinBin <= fMaxBin);
+
+  // an unused window is just moved: the first photon is placed near its
+  // beginning, since most of the following ones come later
+  if (!used && (span <= size)) {
+    fOffset = lowTime - std::min<long long>(size - span, size / 8);
+    return true;
+  }
+
+  // the window grows geometrically, with the new room on the side it grows to
+  long long const newSize =
+    std::min<long long>(fMaxDenseTicks, std::max({ span, 2 * size, 1024LL }));
+  long long const spare = newSize - span;
+  long long newOffset = lowTime;
+  if (used && (lowTime < fOffset + fMinBin))
+    newOffset = std::max<long long>(lowTime - spare, std::numeric_limits<int>::min());
+  else if (!used)
+    newOffset = lowTime - std::min(spare, newSize / 8);
+
+  std::vector<int> bins(newSize, 0);
+  if (used) {
+    long long const shift = fOffset - newOffset;
+    std::copy(fBins.begin() + fMinBin, fBins.begin() + fMaxBin + 1,
+              bins.begin() + (fMinBin + shift));
+    fMinBin += shift;
+    fMaxBin += shift;
+  }
+  fBins = std::move(bins);
+  fOffset = newOffset;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+std::map<int, int> sim::LitePhotonHistogram::toMap() const
+{
+  std::map<int, int> counts;
+  forEach([&counts](int time, int n) { counts.emplace_hint(counts.end(), time, n); });
+  return counts;
+}
+
+//------------------------------------------------------------------------------
+void sim::LitePhotonHistogram::addTo(std::map<int, int>& counts) const
+{
+  if (counts.empty()) {
+    forEach([&counts](int time, int n) { counts.emplace_hint(counts.end(), time, n); });
+    return;
+  }
+  forEach(SortedCountAdder{counts});
+}
+
+//------------------------------------------------------------------------------
+void sim::LitePhotonHistogram::clear()
+{
+  if (fMinBin <= fMaxBin)
+    std::fill(fBins.begin() + fMinBin, fBins.begin() + fMaxBin + 1, 0);
+  fMinBin = 0;
+  fMaxBin = -1;
+  fSparse.clear();
+}
+
+//------------------------------------------------------------------------------
+//--- sim::SimPhotonsLiteBuilder
+//------------------------------------------------------------------------------
+template <typename F>
+void sim::SimPhotonsLiteBuilder::forEachChannel(F&& f)
+{
+  for (auto& [channel, counts] : fOtherChannels)
+    if (!counts.empty()) f(channel, counts);
+  for (std::size_t channel = 0; channel < fChannels.size(); ++channel)
+    if (!fChannels[channel].empty()) f(static_cast<int>(channel), fChannels[channel]);
+}
+
+//------------------------------------------------------------------------------
+sim::SimPhotonsLiteBuilder::SimPhotonsLiteBuilder(std::size_t nChannels, int maxDenseTicks)
+  : fMaxDenseTicks(maxDenseTicks), fChannels(nChannels, LitePhotonHistogram{maxDenseTicks})
+{}
+
+//------------------------------------------------------------------------------
+bool sim::SimPhotonsLiteBuilder::empty() const
+{
+  for (auto const& [channel, counts] : fOtherChannels)
+    if (!counts.empty()) return false;
+  for (auto const& counts : fChannels)
+    if (!counts.empty()) return false;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+std::map<int, int> sim::SimPhotonsLiteBuilder::counts(int channel) const
+{
+  if (channel < 0) {
+    auto const it = fOtherChannels.find(channel);
+    return (it == fOtherChannels.end()) ? std::map<int, int>{} : it->second.toMap();
+  }
+  return (static_cast<std::size_t>(channel) < fChannels.size()) ? fChannels[channel].toMap()
+                                                                 : std::map<int, int>{};
+}
+
+//------------------------------------------------------------------------------
+std::map<int, std::map<int, int>> sim::SimPhotonsLiteBuilder::toMaps() const
+{
+  std::map<int, std::map<int, int>> photons;
+  for (auto const& [channel, counts] : fOtherChannels)
+    if (!counts.empty()) photons.emplace_hint(photons.end(), channel, counts.toMap());
+  for (std::size_t channel = 0; channel < fChannels.size(); ++channel)
+    if (!fChannels[channel].empty())
+      photons.emplace_hint(photons.end(), channel, fChannels[channel].toMap());
+  return photons;
+}
+
+//------------------------------------------------------------------------------
+void sim::SimPhotonsLiteBuilder::addTo(std::vector<sim::SimPhotonsLite>& photons)
+{
+  forEachChannel([&photons](int channel, LitePhotonHistogram& counts) {
+    sim::SimPhotonsLite* dest = nullptr;
+    if ((channel >= 0) && (static_cast<std::size_t>(channel) < photons.size()) &&
+        (photons[channel].OpChannel == channel))
+      dest = &photons[channel];
+    else {
+      auto const it = std::find_if(photons.begin(), photons.end(),
+        [channel](sim::SimPhotonsLite const& ph) { return ph.OpChannel == channel; });
+      if (it != photons.end())
+        dest = &*it;
+      else {
+        dest = &photons.emplace_back();
+        dest->OpChannel = channel;
+      }
+    }
+    counts.addTo(dest->DetectedPhotons);
+    counts.clear();
+  });
+}
+
+//------------------------------------------------------------------------------
+std::vector<sim::SimPhotonsLite> sim::SimPhotonsLiteBuilder::yield()
+{
+  std::vector<sim::SimPhotonsLite> result;
+  forEachChannel([&result](int channel, LitePhotonHistogram& counts) {
+    sim::SimPhotonsLite& ph = result.emplace_back();
+    ph.OpChannel = channel;
+    counts.addTo(ph.DetectedPhotons);
+    counts.clear();
+  });
+  return result;
+}
+
+//------------------------------------------------------------------------------
+void sim::SimPhotonsLiteBuilder::merge(SimPhotonsLiteBuilder& other)
+{
+  if (&other == this) return;
+  other.forEachChannel([this](int channel, LitePhotonHistogram& counts) {
+    LitePhotonHistogram& dest = histogram(channel);
+    counts.forEach([&dest](int time, int n) { dest.add(time, n); });
+    counts.clear();
+  });
+}
+
+//------------------------------------------------------------------------------
+void sim::SimPhotonsLiteBuilder::clear()
+{
+  for (auto& counts : fChannels)
+    counts.clear();
+  fOtherChannels.clear();
+}
+
+//------------------------------------------------------------------------------
+sim::LitePhotonHistogram& sim::SimPhotonsLiteBuilder::histogram(int channel)
+{
+  if (channel < 0) return fOtherChannels.try_emplace(channel, fMaxDenseTicks).first->second;
+  if (static_cast<std::size_t>(channel) >= fChannels.size())
+    fChannels.resize(channel + 1, LitePhotonHistogram{fMaxDenseTicks});
+  return fChannels[channel];
+}
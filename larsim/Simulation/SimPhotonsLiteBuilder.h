@@ -0,0 +1,176 @@
+////////////////////////////////////////////////////////////////////////
+/// \file SimPhotonsLiteBuilder.h
+///
+/// Accumulation of "lite" photons (counts by optical channel and time)
+/// before they are stored as `sim::SimPhotonsLite`.
+///
+/// `sim::SimPhotonsLite::DetectedPhotons` is a map of counts by time:
+/// filling it with one insertion per photon costs a tree lookup (and
+/// often a node allocation) per photon. `sim::LitePhotonHistogram`
+/// collects the counts of one channel in a window of contiguous time
+/// bins instead, growing on either side as photons arrive; the content
+/// is converted into the map once per channel and event.
+/// `sim::SimPhotonsLiteBuilder` holds one such histogram per channel.
+////////////////////////////////////////////////////////////////////////
+#ifndef SIMPHOTONSLITEBUILDER_H
+#define SIMPHOTONSLITEBUILDER_H
+
+#include "lardataobj/Simulation/SimPhotons.h"
+
+#include <cstddef> // std::size_t
+#include <map>
+#include <vector>
+
+namespace sim {
+
+  /// Adds the counts of `src` to `dest` (time by time), in linear time.
+  void addDetectedPhotons(std::map<int, int>& dest, std::map<int, int> const& src);
+
+  /**
+   * @brief Photon counts by time [tick] on one optical channel.
+   *
+   * The counts are kept in a window of contiguous bins, placed at the
+   * first photon and extended (to either side) when a photon arrives out
+   * of it. The window is never wider than `maxDenseTicks`: the counts that
+   * would make it wider (for example isolated photons far in time from the
+   * bulk) are kept in a map instead.
+   *
+   * `clear()` keeps the memory of the window for the next event.
+   */
+  class LitePhotonHistogram {
+  public:
+    /// Default maximum width of the window of bins [ticks].
+    static constexpr int DefaultMaxDenseTicks = 16384;
+
+    explicit LitePhotonHistogram(int maxDenseTicks = DefaultMaxDenseTicks)
+      : fMaxDenseTicks(maxDenseTicks)
+    {}
+
+    /// Adds `nphotons` photons at `time`.
+    void add(int time, int nphotons = 1)
+    {
+      long long const bin = static_cast<long long>(time) - fOffset;
+      if ((fMinBin <= fMaxBin) && (bin >= 0) && (bin < static_cast<long long>(fBins.size()))) {
+        fBins[bin] += nphotons;
+        if (bin < fMinBin) fMinBin = bin;
+        if (bin > fMaxBin) fMaxBin = bin;
+      }
+      else
+        addOutOfWindow(time, nphotons);
+    }
+
+    /// Returns whether there are no photons.
+    bool empty() const { return (fMaxBin < fMinBin) && fSparse.empty(); }
+
+    /// Calls `f(time, count)` for each time with photons, in increasing time.
+    template <typename F>
+    void forEach(F&& f) const;
+
+    /// Returns the counts by time.
+    std::map<int, int> toMap() const;
+
+    /// Adds the counts to `counts` (time by time).
+    void addTo(std::map<int, int>& counts) const;
+
+    /// Removes all the counts, keeping the memory allocated.
+    void clear();
+
+  private:
+    int fMaxDenseTicks;      ///< Maximum width of the window.
+    std::vector<int> fBins;  ///< Counts in the window, from `fOffset`.
+    long long fOffset = 0;   ///< Time of the first bin of the window.
+    long long fMinBin = 0;   ///< First used bin of the window.
+    long long fMaxBin = -1;  ///< Last used bin of the window.
+    std::map<int, int> fSparse; ///< Counts out of the window (and of its reach).
+
+    void addOutOfWindow(int time, int nphotons);
+
+    /// Moves the window to cover `[lowTime, highTime]`; false if too wide.
+    bool reframe(long long lowTime, long long highTime);
+  }; // class LitePhotonHistogram
+
+  /**
+   * @brief Collects lite photons by channel, and yields `sim::SimPhotonsLite`.
+   *
+   * Typical use in a producer:
+   *
+   *     fDirectPhotons.add(channel, time); // for each detected photon
+   *     // ...
+   *     fDirectPhotons.addTo(*dir_phlitcol); // once per event
+   *
+   * Channels are expected to be small non-negative numbers (one histogram is
+   * allocated for each channel up to the largest one used); negative ones
+   * are also supported.
+   */
+  class SimPhotonsLiteBuilder {
+  public:
+    explicit SimPhotonsLiteBuilder(std::size_t nChannels = 0U,
+                                   int maxDenseTicks = LitePhotonHistogram::DefaultMaxDenseTicks);
+
+    /// Adds `nphotons` photons at `time` on `channel`.
+    void add(int channel, int time, int nphotons = 1)
+    {
+      if ((channel >= 0) && (static_cast<std::size_t>(channel) < fChannels.size()))
+        fChannels[channel].add(time, nphotons);
+      else
+        histogram(channel).add(time, nphotons);
+    }
+
+    /// Returns whether there are no photons on any channel.
+    bool empty() const;
+
+    /// Returns the counts by time on `channel`.
+    std::map<int, int> counts(int channel) const;
+
+    /// Returns the counts by channel and time (channels with photons only).
+    std::map<int, std::map<int, int>> toMaps() const;
+
+    /**
+     * @brief Adds the photons to `photons` and clears them from the builder.
+     *
+     * The counts of each channel are added to the element of `photons` with
+     * the same channel (which is expected, but not required, to be the one
+     * at the position of the channel number); a new element is added at the
+     * end for channels not in `photons`.
+     */
+    void addTo(std::vector<sim::SimPhotonsLite>& photons);
+
+    /// Returns the photons of the channels with photons (sorted by channel),
+    /// and clears them from the builder.
+    std::vector<sim::SimPhotonsLite> yield();
+
+    /// Moves all the photons of `other` into this builder.
+    void merge(SimPhotonsLiteBuilder& other);
+
+    /// Removes all the photons, keeping the memory allocated.
+    void clear();
+
+  private:
+    int fMaxDenseTicks;
+    std::vector<LitePhotonHistogram> fChannels;      ///< By channel number.
+    std::map<int, LitePhotonHistogram> fOtherChannels; ///< Channels with negative number.
+
+    LitePhotonHistogram& histogram(int channel);
+
+    template <typename F>
+    void forEachChannel(F&& f); ///< Calls `f(channel, histogram)`, by channel.
+  }; // class SimPhotonsLiteBuilder
+
+} // namespace sim
+
+//------------------------------------------------------------------------------
+template <typename F>
+void sim::LitePhotonHistogram::forEach(F&& f) const
+{
+  // sparse counts are never inside the used part of the window
+  auto itSparse = fSparse.begin();
+  for (; (itSparse != fSparse.end()) && (itSparse->first < fOffset + fMinBin); ++itSparse)
+    f(itSparse->first, itSparse->second);
+  for (long long bin = fMinBin; bin <= fMaxBin; ++bin) {
+    if (fBins[bin] != 0) f(static_cast<int>(fOffset + bin), fBins[bin]);
+  }
+  for (; itSparse != fSparse.end(); ++itSparse)
+    f(itSparse->first, itSparse->second);
+}
+
+#endif // SIMPHOTONSLITEBUILDER_H
@@ -0,0 +1,5 @@
+#include "canvas/Persistency/Common/Wrapper.h"
+
+#include "larsim/Simulation/CompactSimChannels.h"
+#include "larsim/Simulation/CompactSimEnergyDeposits.h"
+#include "larsim/Simulation/ProductFootprint.h"
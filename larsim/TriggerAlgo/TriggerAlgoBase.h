@@ -19,7 +19,9 @@
 #include "TriggerTypes.hh"
 
 // STL
+#include <map>
 #include <set>
+#include <vector>
 
 namespace trigger
 {
@@ -59,8 +61,16 @@ namespace trigger
      certainly have different data format from which readout trigger candidates'
      timestamp is extracted.
 
-     Note: IsTriggered(TS time) function performs a search of closest readout
-     window to "time", and hence could be expensive (though stl::upper_bound is pretty fast).
+     Note: IsTriggered(TS time) function performs a binary search of the closest
+     readout window to "time". To check many time stamps, AreTriggered() does it
+     for all of them at once: when they are sorted, the windows are walked only
+     once, in step with the input.
+
+     Time stamps may also be added after SimTrigger() was called, with
+     AddTimeStamp(). A time stamp later than all the previous ones updates the
+     readout windows in place, so that a stream of time stamps in time order
+     costs no more than filling them all at once. An earlier time stamp makes
+     SimTrigger() run again on all of them.
 
   */
   class TriggerAlgoBase {
@@ -81,6 +91,7 @@ namespace trigger
       _sim_done=false;
       _timestamps.clear();
       _time_windows.clear();
+      _last_trigger=0;
     };
 
     /// Getter for a boolean which "true" value indicates trigger simulation is run already
@@ -89,6 +100,12 @@ namespace trigger
     /// Function to check if "time" (input arg.) is within any of valid readout windows or not
     bool IsTriggered(trigdata::TrigTimeSlice_t time) const;
 
+    /// Function to check IsTriggered() on each of "times" (faster if they are sorted)
+    std::vector<bool> AreTriggered(std::vector<trigdata::TrigTimeSlice_t> const& times) const;
+
+    /// Function to add a candidate time stamp, also after the trigger simulation is run
+    void AddTimeStamp(trigdata::TrigTimeSlice_t time);
+
     /// Getter to a const pointer of _time_windows std::map variable
     const std::map<trigdata::TrigTimeSlice_t,trigdata::TrigTimeSlice_t>* GetTimeWindows() const {return &_time_windows;};
 
@@ -125,6 +142,12 @@ namespace trigger
     /// run utility boolean, set to true after trigger simulation is run
     bool _sim_done;
 
+    /// last time stamp which opened a readout window (0 if none)
+    trigdata::TrigTimeSlice_t _last_trigger;
+
+    /// Function to open a readout window at "time" if not in deadtime of the last one
+    void ApplyTimeStamp(trigdata::TrigTimeSlice_t time);
+
   }; // class TriggerAlgoBase
 
 } //namespace trigger
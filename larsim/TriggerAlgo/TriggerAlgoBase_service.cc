@@ -39,31 +39,57 @@ namespace trigger{
 
     _time_windows.clear();
 
-    trigdata::TrigTimeSlice_t last_timestamp=0;
-
-    trigdata::TrigTimeSlice_t window_begin=0;
-
-    trigdata::TrigTimeSlice_t window_end=0;
+    _last_trigger=0;
 
     for(std::set<trigdata::TrigTimeSlice_t>::const_iterator iter(_timestamps.begin());
 	iter != _timestamps.end();
-	++iter){
+	++iter)
+
+      ApplyTimeStamp(*iter);
+
+    _sim_done = true;
 
-      if(!(last_timestamp) || (*iter) > (last_timestamp + _deadtime)) {
+  }
 
-	window_begin = ((*iter) > _preceeding_slices) ? ((*iter) - _preceeding_slices) : 0;
+  //****************************************************************************
+  void TriggerAlgoBase::ApplyTimeStamp(trigdata::TrigTimeSlice_t time) {
+  //****************************************************************************
 
-	window_end   = (*iter) + _proceeding_slices;
+    if(!(_last_trigger) || time > (_last_trigger + _deadtime)) {
 
-	_time_windows.insert(std::make_pair(window_end,window_begin));
+      trigdata::TrigTimeSlice_t window_begin = (time > _preceeding_slices) ? (time - _preceeding_slices) : 0;
 
-	last_timestamp=(*iter);
+      trigdata::TrigTimeSlice_t window_end   = time + _proceeding_slices;
 
-      }
+      _time_windows.insert(_time_windows.end(),std::make_pair(window_end,window_begin));
+
+      _last_trigger=time;
 
     }
 
-    _sim_done = true;
+  }
+
+  //****************************************************************************
+  void TriggerAlgoBase::AddTimeStamp(trigdata::TrigTimeSlice_t time) {
+  //****************************************************************************
+
+    bool const latest = (_timestamps.empty() || time > *(_timestamps.rbegin()));
+
+    if(!_timestamps.insert(time).second) return; // already known
+
+    if(!_sim_done) return; // SimTrigger() will take care of it
+
+    // a time stamp later than all others only affects the windows after it;
+    // any other changes the deadtime of the ones following it
+    if(latest) ApplyTimeStamp(time);
+
+    else {
+
+      _sim_done = false;
+
+      SimTrigger();
+
+    }
 
   }
 
@@ -81,6 +107,30 @@ namespace trigger{
 
   }
 
+  //****************************************************************************
+  std::vector<bool> TriggerAlgoBase::AreTriggered(std::vector<trigdata::TrigTimeSlice_t> const& times) const {
+  //****************************************************************************
+
+    std::vector<bool> triggered(times.size(),false);
+
+    std::map<trigdata::TrigTimeSlice_t,trigdata::TrigTimeSlice_t>::const_iterator start_time(_time_windows.begin());
+
+    for(size_t i=0; i<times.size(); ++i) {
+
+      // same as IsTriggered(), but moving on from the window of the previous
+      // time stamp when they are in order
+      if(i && times[i] < times[i-1]) start_time = _time_windows.lower_bound(times[i]);
+
+      else while(start_time != _time_windows.end() && (*start_time).first < times[i]) ++start_time;
+
+      triggered[i] = (start_time != _time_windows.end()) && ((*start_time).second < times[i]);
+
+    }
+
+    return triggered;
+
+  }
+
 
   //DEFINE_ART_SERVICE(TriggerAlgoBase)
 
@@ -0,0 +1,284 @@
+/**
+ * @file larsim/Utils/CounterBasedRandomEngine.h
+ *
+ * @brief Counter-based random streams for reproducible parallel simulation
+ *
+ * A parallel algorithm is reproducible regardless of the number of threads
+ * only if each independent piece of work (a block of deposits, a TPC...)
+ * draws from its own random stream, identified by what it is rather than by
+ * which thread runs it. Counter-based generators make such streams cheap: the
+ * `n`-th number of a stream is a pure function of the stream identifier and
+ * of `n`, with no state to seed.
+ *
+ * `larsim::Utils::PhiloxRandomEngine` implements the Philox4x32-10 generator
+ * (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC11) as a
+ * `CLHEP::HepRandomEngine`, so that it can be used with `CLHEP::RandGauss`,
+ * `CLHEP::RandPoissonQ` and the other CLHEP distributions. A stream is keyed
+ * by an event seed (typically one number drawn from the module engine in
+ * each event), a key of the module or purpose (`randomStreamKey()`) and the
+ * index of the object being simulated.
+ *
+ * This is a header-only library.
+ */
+#ifndef LARSIMCOUNTERBASEDRANDOMENGINE_H_SEEN
+#define LARSIMCOUNTERBASEDRANDOMENGINE_H_SEEN
+
+// CLHEP
+#include "CLHEP/Random/RandomEngine.h"
+
+// C/C++ standard libraries
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace larsim
+{
+  namespace Utils
+  {
+    /**
+     * @brief Returns a 32-bit key identifying a module or a purpose.
+     *
+     * This is the FNV-1a hash of `name`, usable at compile time:
+     *
+     *     constexpr std::uint32_t StreamKey = larsim::Utils::randomStreamKey("IonAndScint");
+     */
+    constexpr std::uint32_t
+    randomStreamKey(std::string_view name)
+    {
+      std::uint32_t hash = 2166136261U;
+      for (char const c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619U;
+      }
+      return hash;
+    }
+
+    /**
+     * @brief `CLHEP::HepRandomEngine` with independent, directly addressable streams.
+     *
+     * The engine produces the stream identified by the 64-bit key
+     * (event seed and module key) and the 64-bit stream index:
+     *
+     *     larsim::Utils::PhiloxRandomEngine engine{ eventSeed, StreamKey, iBlock };
+     *     CLHEP::RandGauss gauss{ engine };
+     *
+     * Moving to another stream with `setStream()` costs nothing more than
+     * setting a few words, so a single engine can be reused for all the
+     * objects handled by a thread.
+     *
+     * Each call of the block function yields four 32-bit words, that is two
+     * `flat()` values with 53 bits of precision, in the open interval
+     * (0, 1) like the other CLHEP engines.
+     *
+     * `setSeeds()` follows the same convention, with `seeds[0]` the event
+     * seed, `seeds[1]` the module key and `seeds[2]` the stream index (the
+     * ones not specified are `0`); `setSeed(seed)` sets the event seed only.
+     */
+    class PhiloxRandomEngine : public CLHEP::HepRandomEngine {
+    public:
+      using CLHEP::HepRandomEngine::get;
+      using CLHEP::HepRandomEngine::getState;
+      using CLHEP::HepRandomEngine::put;
+
+      using Counter_t = std::array<std::uint32_t, 4U>;
+      using Key_t = std::array<std::uint32_t, 2U>;
+
+      /// The Philox4x32-10 block function.
+      static Counter_t
+      generate(Counter_t ctr, Key_t key)
+      {
+        constexpr std::uint32_t M0 = 0xD2511F53U;
+        constexpr std::uint32_t M1 = 0xCD9E8D57U;
+        constexpr std::uint32_t W0 = 0x9E3779B9U;
+        constexpr std::uint32_t W1 = 0xBB67AE85U;
+        for (unsigned int round = 0; round < 10U; ++round) {
+          if (round > 0U) {
+            key[0] += W0;
+            key[1] += W1;
+          }
+          std::uint64_t const p0 = std::uint64_t{M0} * ctr[0];
+          std::uint64_t const p1 = std::uint64_t{M1} * ctr[2];
+          ctr = {static_cast<std::uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0],
+                 static_cast<std::uint32_t>(p1),
+                 static_cast<std::uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1],
+                 static_cast<std::uint32_t>(p0)};
+        }
+        return ctr;
+      }
+
+      /// Constructor: stream `stream` of the specified event and module.
+      PhiloxRandomEngine(std::uint32_t eventSeed = 0U,
+                         std::uint32_t moduleKey = 0U,
+                         std::uint64_t stream = 0U)
+      {
+        setStream(eventSeed, moduleKey, stream);
+      }
+
+      /// Moves to the start of the specified stream.
+      void
+      setStream(std::uint32_t eventSeed, std::uint32_t moduleKey, std::uint64_t stream)
+      {
+        fKey = {eventSeed, moduleKey};
+        fStream = stream;
+        fPosition = 0U;
+        fNextWord = 4U;
+      }
+
+      /// Moves to the start of stream `stream`, with the same key.
+      void
+      setStream(std::uint64_t stream)
+      {
+        setStream(fKey[0], fKey[1], stream);
+      }
+
+      double
+      flat() override
+      {
+        std::uint64_t const hi = nextWord();
+        std::uint64_t const lo = nextWord();
+        std::uint64_t const bits = ((hi << 32) | lo) >> 11; // 53 bits
+        return (static_cast<double>(bits) + 0.5) * 0x1p-53;
+      }
+
+      void
+      flatArray(int const size, double* vect) override
+      {
+        for (int i = 0; i < size; ++i)
+          vect[i] = flat();
+      }
+
+      void
+      setSeed(long seed, int) override
+      {
+        setStream(static_cast<std::uint32_t>(seed), 0U, 0U);
+      }
+
+      void
+      setSeeds(long const* seeds, int n) override
+      {
+        // with no explicit size, the list is terminated by a 0 (CLHEP convention)
+        long values[3] = {0L, 0L, 0L};
+        for (int i = 0; i < 3; ++i) {
+          if ((n > 0) ? (i >= n) : (seeds[i] == 0L)) break;
+          values[i] = seeds[i];
+        }
+        setStream(static_cast<std::uint32_t>(values[0]),
+                  static_cast<std::uint32_t>(values[1]),
+                  static_cast<std::uint64_t>(values[2]));
+      }
+
+      void
+      saveStatus(char const filename[] = "Philox.conf") const override
+      {
+        std::ofstream out{filename};
+        put(out);
+      }
+
+      void
+      restoreStatus(char const filename[] = "Philox.conf") override
+      {
+        std::ifstream in{filename};
+        get(in);
+      }
+
+      void
+      showStatus() const override
+      {
+        std::cout << "--------- Philox engine status ---------\n"
+                  << " key:      " << fKey[0] << " " << fKey[1] << "\n"
+                  << " stream:   " << fStream << "\n"
+                  << " position: " << fPosition << " (word " << fNextWord << ")\n"
+                  << "----------------------------------------" << std::endl;
+      }
+
+      std::string
+      name() const override
+      {
+        return engineName();
+      }
+
+      static std::string
+      engineName()
+      {
+        return "PhiloxRandomEngine";
+      }
+
+      operator double() override { return flat(); }
+      operator float() override { return static_cast<float>(flat()); }
+
+      /// Returns 32 random bits.
+      operator unsigned int() override { return nextWord(); }
+
+      std::ostream&
+      put(std::ostream& os) const override
+      {
+        return os << engineName() << " " << fKey[0] << " " << fKey[1] << " " << fStream << " "
+                  << fPosition << " " << fNextWord << "\n";
+      }
+
+      std::istream&
+      get(std::istream& is) override
+      {
+        std::string tag;
+        is >> tag;
+        if (tag != engineName()) {
+          is.clear(std::ios::badbit | is.rdstate());
+          return is;
+        }
+        return getState(is);
+      }
+
+      std::istream&
+      getState(std::istream& is) override
+      {
+        Key_t key;
+        std::uint64_t stream, position;
+        unsigned int nextWord;
+        if (!(is >> key[0] >> key[1] >> stream >> position >> nextWord)) return is;
+        setStream(key[0], key[1], stream);
+        // regenerate the block in use
+        if (nextWord < 4U) {
+          fPosition = position - 1U;
+          refill();
+          fNextWord = nextWord;
+        }
+        else
+          fPosition = position;
+        return is;
+      }
+
+    private:
+      Key_t fKey{{0U, 0U}};
+      std::uint64_t fStream = 0U;   ///< Index of the stream.
+      std::uint64_t fPosition = 0U; ///< Index of the next block in the stream.
+      Counter_t fBlock{{0U, 0U, 0U, 0U}};
+      unsigned int fNextWord = 4U; ///< Next unused word of `fBlock`.
+
+      void
+      refill()
+      {
+        fBlock = generate({static_cast<std::uint32_t>(fPosition),
+                           static_cast<std::uint32_t>(fPosition >> 32),
+                           static_cast<std::uint32_t>(fStream),
+                           static_cast<std::uint32_t>(fStream >> 32)},
+                          fKey);
+        ++fPosition;
+        fNextWord = 0U;
+      }
+
+      std::uint32_t
+      nextWord()
+      {
+        if (fNextWord >= 4U) refill();
+        return fBlock[fNextWord++];
+      }
+
+    }; // PhiloxRandomEngine
+
+  } // namespace Utils
+} // namespace larsim
+
+#endif // LARSIMCOUNTERBASEDRANDOMENGINE_H_SEEN
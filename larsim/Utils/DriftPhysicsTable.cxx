@@ -0,0 +1,59 @@
+/**
+ * @file larsim/Utils/DriftPhysicsTable.cxx
+ *
+ * @brief Implementation of the drift attenuation and diffusion helper
+ *
+ * @see larsim/Utils/DriftPhysicsTable.h
+ */
+
+// LArSoft
+#include "larsim/Utils/DriftPhysicsTable.h"
+
+#include "cetlib_except/exception.h"
+
+// C/C++ standard libraries
+#include <cmath> // std::ceil()
+
+//------------------------------------------------------------
+larsim::Utils::DriftPhysicsTable::DriftPhysicsTable(double electronLifetime,
+                                                    double longitudinalDiffusion,
+                                                    double transverseDiffusion,
+                                                    double maxDriftTime,
+                                                    double tableStep)
+  : fLifetimeCorr(-1000. * electronLifetime)
+  , fLDiff(std::sqrt(2. * longitudinalDiffusion))
+  , fTDiff(std::sqrt(2. * transverseDiffusion))
+{
+  if (tableStep < 0.) {
+    throw cet::exception("DriftPhysicsTable")
+      << "Invalid drift time step " << tableStep << " ns.\n";
+  }
+  if (tableStep == 0. || !(maxDriftTime > 0.)) return;
+
+  std::size_t const nSteps = static_cast<std::size_t>(std::ceil(maxDriftTime / tableStep));
+  fAttenuation.resize(nSteps + 1);
+  for (std::size_t i = 0; i <= nSteps; ++i)
+    fAttenuation[i] = std::exp(i * tableStep / fLifetimeCorr);
+  fInvStep = 1. / tableStep;
+  fTableEnd = static_cast<double>(nSteps);
+}
+
+//------------------------------------------------------------
+void
+larsim::Utils::DriftPhysicsTable::evaluate(std::size_t n,
+                                           double const* tDrift,
+                                           double* attenuation,
+                                           double* longSigma,
+                                           double* transSigma) const
+{
+  // the square roots (the same for both widths) are computed in a loop of
+  // their own, which the compiler can vectorize
+  for (std::size_t i = 0; i < n; ++i)
+    longSigma[i] = std::sqrt(tDrift[i]);
+  for (std::size_t i = 0; i < n; ++i) {
+    transSigma[i] = longSigma[i] * fTDiff;
+    longSigma[i] *= fLDiff;
+  }
+  for (std::size_t i = 0; i < n; ++i)
+    attenuation[i] = this->attenuation(tDrift[i]);
+}
@@ -0,0 +1,124 @@
+/**
+ * @file larsim/Utils/DriftPhysicsTable.h
+ *
+ * @brief Attenuation and diffusion of drifting electrons, by drift time
+ *
+ * The charge drift code needs, for each energy deposit, the fraction of the
+ * ionization electrons surviving the attachment along the drift
+ * (`exp(-t/tau)`) and the longitudinal and transverse diffusion widths
+ * (`sqrt(2 D t)`), all functions of the drift time `t` only. This helper
+ * holds the constants for the whole job, and optionally tabulates the
+ * attenuation on a regular grid of drift times, so that it is evaluated by
+ * linear interpolation instead of an exponential. The diffusion widths are
+ * always computed exactly, since a square root is cheaper than a table
+ * lookup.
+ *
+ * @see larsim/Utils/DriftPhysicsTable.cxx
+ */
+#ifndef LARSIMDRIFTPHYSICSTABLE_H_SEEN
+#define LARSIMDRIFTPHYSICSTABLE_H_SEEN
+
+// C/C++ standard libraries
+#include <cmath> // std::exp(), std::sqrt()
+#include <cstddef> // std::size_t
+#include <vector>
+
+namespace larsim
+{
+  namespace Utils
+  {
+    /**
+     * @brief Attenuation and diffusion widths of the drifting charge.
+     *
+     * Without a table (`tableStep` 0) the results are the same as computing
+     * `exp(-t / (1000 * lifetime))` and `sqrt(t) * sqrt(2 D)` directly; with
+     * a table, the relative difference of the attenuation is about
+     * `(step / tau)^2 / 8`, e.g. 1e-8 with a 1 us step and a 3 ms lifetime.
+     * Drift times beyond the table are computed exactly.
+     *
+     * Typical use:
+     *
+     *     larsim::Utils::DriftPhysicsTable const drift{ lifetime, DL, DT, maxT, 1000. };
+     *     double const nElectrons = nIonized * drift.attenuation(TDrift);
+     *     double const LDiffSig = drift.longitudinalSigma(TDrift);
+     */
+    class DriftPhysicsTable {
+    public:
+      DriftPhysicsTable() = default;
+
+      /**
+       * @brief Sets the drift constants up.
+       * @param electronLifetime electron lifetime [us]
+       * @param longitudinalDiffusion longitudinal diffusion constant [cm^2/ns]
+       * @param transverseDiffusion transverse diffusion constant [cm^2/ns]
+       * @param maxDriftTime longest drift time tabulated [ns]
+       * @param tableStep drift time between table entries [ns] (`0`: no table)
+       */
+      DriftPhysicsTable(double electronLifetime,
+                        double longitudinalDiffusion,
+                        double transverseDiffusion,
+                        double maxDriftTime = 0.,
+                        double tableStep = 0.);
+
+      /// Returns whether the attenuation is interpolated from a table.
+      bool
+      isTabulated() const
+      {
+        return !fAttenuation.empty();
+      }
+
+      /// Fraction of the electrons surviving a drift of `tDrift` [ns].
+      double
+      attenuation(double tDrift) const
+      {
+        double const x = tDrift * fInvStep;
+        if (x >= 0. && x < fTableEnd) {
+          std::size_t const bin = static_cast<std::size_t>(x);
+          double const f = x - bin;
+          return fAttenuation[bin] + f * (fAttenuation[bin + 1] - fAttenuation[bin]);
+        }
+        return std::exp(tDrift / fLifetimeCorr);
+      }
+
+      /// Longitudinal diffusion width [cm] after a drift of `tDrift` [ns].
+      double
+      longitudinalSigma(double tDrift) const
+      {
+        return std::sqrt(tDrift) * fLDiff;
+      }
+
+      /// Transverse diffusion width [cm] after a drift of `tDrift` [ns].
+      double
+      transverseSigma(double tDrift) const
+      {
+        return std::sqrt(tDrift) * fTDiff;
+      }
+
+      /**
+       * @brief Evaluates `n` drift times at once.
+       * @param n number of drift times
+       * @param tDrift the drift times [ns]
+       * @param attenuation (output) surviving fraction for each drift time
+       * @param longSigma (output) longitudinal width [cm] for each drift time
+       * @param transSigma (output) transverse width [cm] for each drift time
+       *
+       * The results are the same as the ones of the single evaluations.
+       */
+      void evaluate(std::size_t n,
+                    double const* tDrift,
+                    double* attenuation,
+                    double* longSigma,
+                    double* transSigma) const;
+
+    private:
+      double fLifetimeCorr = -1.; ///< Opposite of the lifetime [ns].
+      double fLDiff = 0.;         ///< `sqrt(2 DL)` [cm/sqrt(ns)]
+      double fTDiff = 0.;         ///< `sqrt(2 DT)` [cm/sqrt(ns)]
+      double fInvStep = 0.;       ///< Table entries per nanosecond.
+      double fTableEnd = 0.;      ///< Entry of the last table point.
+      std::vector<double> fAttenuation; ///< Attenuation at each table point.
+    };
+  }
+}
+
+#endif // LARSIMDRIFTPHYSICSTABLE_H_SEEN
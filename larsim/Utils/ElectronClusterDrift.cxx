@@ -0,0 +1,137 @@
+/**
+ * @file larsim/Utils/ElectronClusterDrift.cxx
+ *
+ * @brief Implementation of the electron cluster drift helper
+ *
+ * @see larsim/Utils/ElectronClusterDrift.h
+ */
+
+// LArSoft
+#include "larsim/Utils/ElectronClusterDrift.h"
+
+#include "cetlib_except/exception.h"
+
+// C/C++ standard libraries
+#include <cmath> // std::abs(), std::ceil()
+
+//------------------------------------------------------------
+larsim::Utils::ElectronClusterDrift::ElectronClusterDrift(double const* recipDriftVel,
+                                                          double clusterSize,
+                                                          int minClusters)
+  : fRecipDriftVel{recipDriftVel[0], recipDriftVel[1], recipDriftVel[2]}
+  , fClusterSize(clusterSize)
+  , fMinClusters(minClusters)
+{
+  if (!(fClusterSize > 0.)) {
+    throw cet::exception("ElectronClusterDrift")
+      << "Invalid electron cluster size " << fClusterSize << ".\n";
+  }
+}
+
+//------------------------------------------------------------
+bool
+larsim::Utils::ElectronClusterDrift::driftAxes(geo::TPCGeo const& tpcGeo, Axes& axes)
+{
+  // The drift direction can be either in the positive or negative direction
+  // in any coordinate x, y or z: tpcGeo.DetectDriftDirection() is 1 for +x,
+  // -1 for -x, 2 for +y, -2 for -y, 3 for +z and -3 for -z
+  int const direction = tpcGeo.DetectDriftDirection();
+  axes.drift = std::abs(direction) - 1; // x:0, y:1, z:2
+  switch (axes.drift) {
+  case 0:
+    axes.trans1 = 1;
+    axes.trans2 = 2;
+    break;
+  case 1:
+    axes.trans1 = 0;
+    axes.trans2 = 2;
+    break;
+  case 2:
+    axes.trans1 = 0;
+    axes.trans2 = 1;
+    break;
+  default: return false;
+  }
+  axes.sign = (direction > 0) ? 1 : -1;
+  return true;
+}
+
+//------------------------------------------------------------
+bool
+larsim::Utils::ElectronClusterDrift::behindPlanes(geo::TPCGeo const& tpcGeo,
+                                                  Axes const& axes,
+                                                  double const* xyz)
+{
+  double const planePos = tpcGeo.PlaneLocation(0)[axes.drift];
+  return (axes.sign == 1) ? (planePos < xyz[axes.drift]) : (planePos > xyz[axes.drift]);
+}
+
+//------------------------------------------------------------
+double
+larsim::Utils::ElectronClusterDrift::driftTime(geo::TPCGeo const& tpcGeo,
+                                               Axes const& axes,
+                                               double const* xyz,
+                                               double const* offsets) const
+{
+  /// \todo think about effects of drift between planes.
+  // Center of plane is also returned in cm units
+  double driftDistance = std::abs(xyz[axes.drift] - tpcGeo.PlaneLocation(0)[axes.drift]);
+  driftDistance += -1. * offsets[axes.drift];
+
+  // Space charge distortion could push the energy deposit beyond the wire
+  // plane (see issue #15131). Given that we don't have any subtlety in the
+  // simulation of this region, bringing the deposit exactly on the plane
+  // should be enough for the time being.
+  if (driftDistance < 0.) driftDistance = 0.;
+
+  // special case for ArgoNeuT (Nplanes = 2 and drift direction = x):
+  // plane 0 is the second wire plane
+  if (tpcGeo.Nplanes() == 2 && axes.drift == 0) {
+    return (driftDistance - tpcGeo.PlanePitch(0, 1)) * fRecipDriftVel[0] +
+           tpcGeo.PlanePitch(0, 1) * fRecipDriftVel[1];
+  }
+  return driftDistance * fRecipDriftVel[0];
+}
+
+//------------------------------------------------------------
+std::size_t
+larsim::Utils::ElectronClusterDrift::split(double nElectrons,
+                                           double energy,
+                                           ElectronClusters& clusters,
+                                           bool single) const
+{
+  double clusterSize = fClusterSize;
+  int nClus = (int)std::ceil(nElectrons / clusterSize);
+  if (single) {
+    clusterSize = nElectrons;
+    nClus = 1;
+  }
+  else if (nClus < fMinClusters) {
+    clusterSize = nElectrons / fMinClusters;
+    if (clusterSize < 1.0) { clusterSize = 1.0; }
+    nClus = (int)std::ceil(nElectrons / clusterSize);
+  }
+  if (nClus <= 0) nClus = 0;
+  std::size_t const n = nClus;
+
+  clusters.longDiff.resize(n);
+  clusters.trans1.resize(n);
+  clusters.trans2.resize(n);
+  clusters.nElectrons.assign(n, clusterSize);
+  clusters.energy.resize(n);
+  if (n == 0) return 0;
+
+  // fix the number of electrons in the last cluster, that has a smaller size
+  clusters.nElectrons.back() = nElectrons - (nClus - 1) * clusterSize;
+
+  double* clusterEnergy = clusters.energy.data();
+  double const* clusterElectrons = clusters.nElectrons.data();
+  if (nElectrons > 0) {
+    for (std::size_t k = 0; k < n; ++k)
+      clusterEnergy[k] = energy / nElectrons * clusterElectrons[k];
+  }
+  else
+    clusters.energy.assign(n, 0.);
+
+  return n;
+}
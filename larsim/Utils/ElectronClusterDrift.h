@@ -0,0 +1,177 @@
+/**
+ * @file larsim/Utils/ElectronClusterDrift.h
+ *
+ * @brief Drift of the ionization electrons of a deposit, as electron clusters
+ *
+ * The charge drift code (`SimDriftElectrons`, `DriftElectronstoPlane`,
+ * `LArVoxelReadout`) follows the same steps for each energy deposit: it finds
+ * the drift direction of its TPC and the drift time to the first wire plane,
+ * splits the surviving electrons into clusters of configured size and smears
+ * the clusters by the longitudinal and transverse diffusion. Those steps live
+ * here, once, with the clusters of a deposit stored as parallel arrays so
+ * that the code assigning them to the channels can process them in batches;
+ * the attenuation and the diffusion widths come from `DriftPhysicsTable`.
+ *
+ * @see larsim/Utils/ElectronClusterDrift.cxx
+ */
+#ifndef LARSIMELECTRONCLUSTERDRIFT_H_SEEN
+#define LARSIMELECTRONCLUSTERDRIFT_H_SEEN
+
+//LArSoft
+#include "larcorealg/Geometry/TPCGeo.h"
+
+// C/C++ standard libraries
+#include <cstddef> // std::size_t
+#include <vector>
+
+namespace larsim
+{
+  namespace Utils
+  {
+    /// Electron clusters of a deposit: element `k` of each array is cluster `k`.
+    struct ElectronClusters {
+      std::vector<double> longDiff;   ///< Longitudinal displacement [cm]
+      std::vector<double> trans1;     ///< First transverse position [cm]
+      std::vector<double> trans2;     ///< Second transverse position [cm]
+      std::vector<double> nElectrons; ///< Number of electrons.
+      std::vector<double> energy;     ///< Deposited energy the cluster comes from [MeV]
+
+      /// Number of clusters.
+      std::size_t
+      size() const
+      {
+        return nElectrons.size();
+      }
+    };
+
+    /**
+     * @brief Drift of the electrons of single deposits, by electron clusters.
+     *
+     * The results (and the random numbers used) are the ones of the
+     * historical `SimDriftElectrons` code.
+     *
+     * Typical use:
+     *
+     *     larsim::Utils::ElectronClusterDrift::Axes axes;
+     *     if (!drift.driftAxes(tpcGeo, axes) || drift.behindPlanes(tpcGeo, axes, xyz)) continue;
+     *     double const TDrift = drift.driftTime(tpcGeo, axes, xyz, offsets);
+     *     drift.split(nElectrons, energy, clusters);
+     *     drift.diffuse(gauss, LDiffSig, TDiffSig, center1, center2, clusters);
+     */
+    class ElectronClusterDrift {
+    public:
+      /// Coordinates (0: x, 1: y, 2: z) of the drift in a TPC.
+      struct Axes {
+        int drift = 0;  ///< Drift coordinate.
+        int trans1 = 1; ///< First coordinate perpendicular to the drift.
+        int trans2 = 2; ///< Second coordinate perpendicular to the drift.
+        int sign = 1;   ///< `+1` if the electrons drift towards increasing `drift`, `-1` if not.
+      };
+
+      ElectronClusterDrift() = default;
+
+      /**
+       * @brief Sets the drift constants up.
+       * @param recipDriftVel inverse of the drift velocity in the three gaps [ns/cm]
+       * @param clusterSize electrons in a cluster
+       * @param minClusters smallest number of clusters of a deposit
+       */
+      ElectronClusterDrift(double const* recipDriftVel, double clusterSize, int minClusters);
+
+      /// Inverse of the drift velocity [ns/cm] in the gap `i` (`0`: drift volume).
+      double
+      recipDriftVelocity(std::size_t i) const
+      {
+        return fRecipDriftVel[i];
+      }
+
+      /// Sets `axes` for `tpcGeo`; returns false if it does not drift along an axis.
+      static bool driftAxes(geo::TPCGeo const& tpcGeo, Axes& axes);
+
+      /// Returns whether the position `xyz` is behind the readout planes.
+      static bool behindPlanes(geo::TPCGeo const& tpcGeo, Axes const& axes, double const* xyz);
+
+      /**
+       * @brief Drift time [ns] to the first plane of the charge deposited at `xyz`.
+       * @param offsets space charge displacement of the charge [cm]
+       *
+       * Charge displaced beyond the plane drifts for no time.
+       */
+      double driftTime(geo::TPCGeo const& tpcGeo,
+                       Axes const& axes,
+                       double const* xyz,
+                       double const* offsets) const;
+
+      /**
+       * @brief Splits `nElectrons` from a deposit of `energy` in clusters.
+       * @param single whether to keep all the electrons in a single cluster
+       * @return the number of clusters
+       *
+       * The clusters have the configured size, the last one taking the rest,
+       * unless they are fewer than the minimum number, in which case they are
+       * made smaller (down to one electron). The arrays of `clusters` are all
+       * resized to the number of clusters.
+       */
+      std::size_t split(double nElectrons,
+                        double energy,
+                        ElectronClusters& clusters,
+                        bool single = false) const;
+
+      /**
+       * @brief Smears the clusters by the diffusion.
+       * @tparam Gauss type of generator, with `fireArray(n, values, mean, sigma)`
+       * @param LDiffSig longitudinal diffusion width [cm]
+       * @param TDiffSig transverse diffusion width [cm]
+       * @param center1 first transverse position of the deposit [cm]
+       * @param center2 second transverse position of the deposit [cm]
+       *
+       * The longitudinal displacements are generated first, then the first and
+       * the second transverse positions; no number is generated for a width
+       * which is not positive.
+       */
+      template <typename Gauss>
+      static void diffuse(Gauss& gauss,
+                          double LDiffSig,
+                          double TDiffSig,
+                          double center1,
+                          double center2,
+                          ElectronClusters& clusters);
+
+    private:
+      double fRecipDriftVel[3] = {0., 0., 0.}; ///< Inverse drift velocities [ns/cm]
+      double fClusterSize = 1.;                ///< Electrons in a cluster.
+      int fMinClusters = 0;                    ///< Smallest number of clusters.
+    };
+
+    //--------------------------------------------------------------------------
+    template <typename Gauss>
+    void
+    ElectronClusterDrift::diffuse(Gauss& gauss,
+                                  double LDiffSig,
+                                  double TDiffSig,
+                                  double center1,
+                                  double center2,
+                                  ElectronClusters& clusters)
+    {
+      std::size_t const n = clusters.size();
+
+      // Smear drift times by longitudinal diffusion
+      if (LDiffSig > 0.0)
+        gauss.fireArray(static_cast<int>(n), clusters.longDiff.data(), 0., LDiffSig);
+      else
+        clusters.longDiff.assign(n, 0.0);
+
+      if (TDiffSig > 0.0) {
+        // Smear the coordinates in plane perpendicular to drift direction by the transverse diffusion
+        gauss.fireArray(static_cast<int>(n), clusters.trans1.data(), center1, TDiffSig);
+        gauss.fireArray(static_cast<int>(n), clusters.trans2.data(), center2, TDiffSig);
+      }
+      else {
+        clusters.trans1.assign(n, center1);
+        clusters.trans2.assign(n, center2);
+      }
+    }
+  }
+}
+
+#endif // LARSIMELECTRONCLUSTERDRIFT_H_SEEN
@@ -0,0 +1,162 @@
+/**
+ * @file larsim/Utils/EventArena.h
+ *
+ * @brief Memory arena for the transient buffers of the simulation of an event
+ *
+ * Many simulation modules build, in each event, maps and lists that live only
+ * until the event data products are put into the event. Allocating them from
+ * the general purpose heap costs one allocation (and one deallocation) per
+ * node or per growth, and scatters the nodes across memory.
+ *
+ * `larsim::Utils::EventArena` serves them from a monotonic buffer instead:
+ * allocations are a pointer bump, deallocations are no-ops, and all the
+ * memory is reclaimed at once by `release()` at the end of the event. The
+ * buffer grows to the largest need seen so far, so that after the first few
+ * events no further allocation from the heap happens.
+ *
+ * Containers using the arena must be `std::pmr` ones, and must be destroyed
+ * or cleared before the arena is released; data products can't use it.
+ *
+ * This is a header-only library.
+ */
+#ifndef LARSIMEVENTARENA_H_SEEN
+#define LARSIMEVENTARENA_H_SEEN
+
+// C/C++ standard libraries
+#include <cstddef> // std::size_t
+#include <memory>  // std::unique_ptr
+#include <memory_resource>
+#include <optional>
+
+namespace larsim
+{
+  namespace Utils
+  {
+    /**
+     * @brief Monotonic memory arena released at the end of each event.
+     *
+     * Example of use in a module:
+     *
+     *     larsim::Utils::EventArena fArena;
+     *
+     *     void produce(art::Event& event) {
+     *       larsim::Utils::EventArena::Scope const arenaScope{ fArena };
+     *       std::pmr::unordered_map<Key_t, Index_t> index{ fArena.resource() };
+     *       // ...
+     *     }
+     *
+     * The scope object must be declared before the containers using the
+     * arena, so that they are destroyed before the arena is released.
+     *
+     * The arena is not thread-safe: each thread needs its own.
+     */
+    class EventArena {
+    public:
+      /// Releases the arena when going out of scope.
+      class Scope {
+      public:
+        explicit Scope(EventArena& arena) : fArena{arena} {}
+        Scope(Scope const&) = delete;
+        Scope& operator=(Scope const&) = delete;
+        ~Scope() { fArena.release(); }
+
+      private:
+        EventArena& fArena;
+      }; // Scope
+
+      /// Constructor: an arena with the specified initial buffer size [bytes].
+      explicit EventArena(std::size_t initialSize = 64U * 1024U) { reset(initialSize); }
+
+      EventArena(EventArena const&) = delete;
+      EventArena& operator=(EventArena const&) = delete;
+
+      /// Returns the memory resource to be used by `std::pmr` containers.
+      std::pmr::memory_resource*
+      resource()
+      {
+        return &*fResource;
+      }
+
+      /// Size of the current buffer [bytes].
+      std::size_t
+      capacity() const
+      {
+        return fSize;
+      }
+
+      /**
+       * @brief Reclaims all the memory allocated from the arena.
+       *
+       * If the last event did not fit in the buffer, the buffer is replaced by
+       * one large enough for it.
+       */
+      void
+      release()
+      {
+        std::size_t const needed = fSize + fUpstream.overflow();
+        if (needed > fSize)
+          reset(needed + needed / 2U);
+        else
+          fResource->release();
+      }
+
+    private:
+      /// Upstream resource, keeping track of the memory not fitting the buffer.
+      class CountingResource : public std::pmr::memory_resource {
+      public:
+        std::size_t
+        overflow() const
+        {
+          return fOverflow;
+        }
+
+        void
+        clear()
+        {
+          fOverflow = 0U;
+        }
+
+      private:
+        std::size_t fOverflow = 0U;
+
+        void*
+        do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+          fOverflow += bytes;
+          return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void
+        do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+        {
+          std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool
+        do_is_equal(std::pmr::memory_resource const& other) const noexcept override
+        {
+          return this == &other;
+        }
+      }; // CountingResource
+
+      std::size_t fSize = 0U;
+      std::unique_ptr<std::byte[]> fBuffer;
+      CountingResource fUpstream;
+      std::optional<std::pmr::monotonic_buffer_resource> fResource;
+
+      void
+      reset(std::size_t size)
+      {
+        fResource.reset(); // returns the overflow blocks to the upstream resource
+        fUpstream.clear();
+        fBuffer = std::make_unique<std::byte[]>(size);
+        fSize = size;
+        fResource.emplace(fBuffer.get(), fSize, &fUpstream);
+      }
+
+    }; // EventArena
+
+  } // namespace Utils
+} // namespace larsim
+
+#endif // LARSIMEVENTARENA_H_SEEN
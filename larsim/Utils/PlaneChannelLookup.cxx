@@ -0,0 +1,93 @@
+/**
+ * @file larsim/Utils/PlaneChannelLookup.cxx
+ *
+ * @brief Implementation of the precomputed channel lookup of the wire planes
+ *
+ * @see larsim/Utils/PlaneChannelLookup.h
+ */
+
+// LArSoft
+#include "larsim/Utils/PlaneChannelLookup.h"
+#include "larcorealg/Geometry/PlaneGeo.h"
+#include "larcorealg/Geometry/TPCGeo.h"
+#include "larcorealg/Geometry/WireGeo.h"
+
+#include "cetlib_except/exception.h"
+
+#include <utility> // std::move()
+
+//------------------------------------------------------------
+larsim::Utils::PlaneChannelLookup::PlaneChannelLookup(geo::GeometryCore const& geom,
+                                                      geo::PlaneID const& planeID)
+  : fGeom(&geom), fPlaneID(planeID)
+{
+  // sample the wire coordinate around the plane centre
+  geo::Point_t const center = geom.Plane(planeID).GetCenter();
+  double const wc = geom.WireCoordinate(center, planeID);
+  fWireCoordSlope[0] = geom.WireCoordinate(center + geo::Vector_t{1., 0., 0.}, planeID) - wc;
+  fWireCoordSlope[1] = geom.WireCoordinate(center + geo::Vector_t{0., 1., 0.}, planeID) - wc;
+  fWireCoordSlope[2] = geom.WireCoordinate(center + geo::Vector_t{0., 0., 1.}, planeID) - wc;
+  fWireCoord0 = wc - fWireCoordSlope[0] * center.X() - fWireCoordSlope[1] * center.Y() -
+                fWireCoordSlope[2] * center.Z();
+
+  unsigned int const nWires = geom.Nwires(planeID);
+  fWireChannels.resize(nWires);
+  for (unsigned int w = 0; w < nWires; ++w)
+    fWireChannels[w] = geom.PlaneWireToChannel(geo::WireID(planeID, w));
+
+  // verify the model on the first, central and last wire
+  fAffine = (nWires > 0);
+  for (unsigned int const w : {0U, nWires / 2, nWires - 1}) {
+    if (!fAffine) break;
+    geo::Point_t const wireCenter = geom.Wire(geo::WireID(planeID, w)).GetCenter();
+    double const xyz[3] = {wireCenter.X(), wireCenter.Y(), wireCenter.Z()};
+    if (std::abs(wireCoordinate(xyz) - geom.WireCoordinate(wireCenter, planeID)) > 1e-3 ||
+        fWireChannels[w] != geom.NearestChannel(wireCenter, planeID))
+      fAffine = false;
+  }
+}
+
+//------------------------------------------------------------
+larsim::Utils::PlaneChannelLookup::PlaneChannelLookup(double wireCoord0,
+                                                      double const* wireCoordSlope,
+                                                      std::vector<raw::ChannelID_t> wireChannels)
+  : fAffine(!wireChannels.empty())
+  , fWireCoord0(wireCoord0)
+  , fWireCoordSlope{wireCoordSlope[0], wireCoordSlope[1], wireCoordSlope[2]}
+  , fWireChannels(std::move(wireChannels))
+{}
+
+//------------------------------------------------------------
+raw::ChannelID_t
+larsim::Utils::PlaneChannelLookup::geometryChannel(double const* xyz) const
+{
+  if (!fGeom) return raw::InvalidChannelID;
+  try {
+    return fGeom->NearestChannel(geo::Point_t{xyz[0], xyz[1], xyz[2]}, fPlaneID);
+  }
+  catch (cet::exception const&) {
+    return raw::InvalidChannelID;
+  }
+}
+
+//------------------------------------------------------------
+larsim::Utils::ChannelLookup::ChannelLookup(geo::GeometryCore const& geom) : fGeom(&geom)
+{
+  fPlanes.resize(geom.Ncryostats());
+  for (unsigned int cryo = 0; cryo < fPlanes.size(); ++cryo)
+    fPlanes[cryo].resize(geom.NTPC(cryo));
+}
+
+//------------------------------------------------------------
+std::vector<larsim::Utils::PlaneChannelLookup> const&
+larsim::Utils::ChannelLookup::TPCPlanes(unsigned int tpc, unsigned int cryostat)
+{
+  std::vector<PlaneChannelLookup>& planes = fPlanes.at(cryostat).at(tpc);
+  if (planes.empty()) {
+    unsigned int const nPlanes = fGeom->TPC(tpc, cryostat).Nplanes();
+    planes.reserve(nPlanes);
+    for (unsigned int p = 0; p < nPlanes; ++p)
+      planes.emplace_back(*fGeom, geo::PlaneID(cryostat, tpc, p));
+  }
+  return planes;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file larsim/Utils/PlaneChannelLookup.h
+ *
+ * @brief Readout channel of a position on a wire plane, from a precomputed table
+ *
+ * `geo::GeometryCore::NearestChannel()` finds the wire plane, the nearest wire
+ * and its channel for each call, and throws an exception when the position is
+ * out of the plane. Charge drift code asks for the channel of many electron
+ * clusters on the same plane: here the wire coordinate of each plane is
+ * sampled once as an affine function of the position (origin and slope on
+ * each axis), and the channel of each wire is kept in a table, so that the
+ * channel of a position is a dot product and an array lookup. Positions
+ * out of the plane yield `raw::InvalidChannelID` instead of an exception.
+ *
+ * @see larsim/Utils/PlaneChannelLookup.cxx
+ */
+#ifndef LARSIMPLANECHANNELLOOKUP_H_SEEN
+#define LARSIMPLANECHANNELLOOKUP_H_SEEN
+
+//LArSoft
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "larcoreobj/SimpleTypesAndConstants/RawTypes.h" // raw::ChannelID_t
+#include "larcoreobj/SimpleTypesAndConstants/geo_types.h"
+#include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h"
+
+// C/C++ standard libraries
+#include <cmath> // std::round()
+#include <cstddef> // std::size_t
+#include <vector>
+
+namespace larsim
+{
+  namespace Utils
+  {
+    /**
+     * @brief Channel lookup of the positions on one wire plane.
+     *
+     * The affine model of the wire coordinate is verified on the first,
+     * central and last wire of the plane; planes where it does not hold
+     * (`isAffine()` false) are delegated to the geometry, still without
+     * exceptions.
+     *
+     * Typical use:
+     *
+     *     larsim::Utils::PlaneChannelLookup const lookup{ geom, planeID };
+     *     raw::ChannelID_t const channel = lookup.nearestChannel(xyz);
+     *     if (!raw::isValidChannelID(channel)) continue; // off the plane
+     */
+    class PlaneChannelLookup {
+    public:
+      PlaneChannelLookup() = default;
+
+      /// Samples the readout of the plane `planeID` of `geom`.
+      PlaneChannelLookup(geo::GeometryCore const& geom, geo::PlaneID const& planeID);
+
+      /**
+       * @brief Sets up an affine plane without geometry (e.g. for tests).
+       * @param wireCoord0 wire coordinate of the world origin
+       * @param wireCoordSlope change of wire coordinate per cm on each axis
+       * @param wireChannels channel of each wire
+       *
+       * Positions off the wires yield `raw::InvalidChannelID`.
+       */
+      PlaneChannelLookup(double wireCoord0,
+                         double const* wireCoordSlope,
+                         std::vector<raw::ChannelID_t> wireChannels);
+
+      /// Returns whether the wire coordinate is an affine function of the position.
+      bool
+      isAffine() const
+      {
+        return fAffine;
+      }
+
+      /// Wire coordinate of the world origin.
+      double
+      wireCoordinateOrigin() const
+      {
+        return fWireCoord0;
+      }
+
+      /// Change of wire coordinate per centimetre along `axis` (`0` to `2`).
+      double
+      wireCoordinateSlope(unsigned int axis) const
+      {
+        return fWireCoordSlope[axis];
+      }
+
+      /// Number of wires in the plane.
+      std::size_t
+      nWires() const
+      {
+        return fWireChannels.size();
+      }
+
+      /// Wire coordinate of the position `xyz` [cm] (affine model).
+      double
+      wireCoordinate(double const* xyz) const
+      {
+        return fWireCoord0 + fWireCoordSlope[0] * xyz[0] + fWireCoordSlope[1] * xyz[1] +
+               fWireCoordSlope[2] * xyz[2];
+      }
+
+      /// Channel of the wire nearest to `wireCoord`; `raw::InvalidChannelID` if none.
+      raw::ChannelID_t
+      channelAtWireCoordinate(double wireCoord) const
+      {
+        double const wire = std::round(wireCoord);
+        return (wire >= 0. && wire < static_cast<double>(fWireChannels.size())) ?
+                 fWireChannels[static_cast<std::size_t>(wire)] :
+                 raw::InvalidChannelID;
+      }
+
+      /// Channel nearest to `xyz` [cm]; `raw::InvalidChannelID` if off the plane.
+      raw::ChannelID_t
+      nearestChannel(double const* xyz) const
+      {
+        return fAffine ? channelAtWireCoordinate(wireCoordinate(xyz)) : geometryChannel(xyz);
+      }
+
+      raw::ChannelID_t
+      nearestChannel(geo::Point_t const& point) const
+      {
+        double const xyz[3] = {point.X(), point.Y(), point.Z()};
+        return nearestChannel(xyz);
+      }
+
+      /// Channel of each wire of the plane.
+      std::vector<raw::ChannelID_t> const&
+      wireChannels() const
+      {
+        return fWireChannels;
+      }
+
+    private:
+      geo::GeometryCore const* fGeom = nullptr;
+      geo::PlaneID fPlaneID;
+      bool fAffine = false;
+      double fWireCoord0 = 0.;                   ///< Wire coordinate at the world origin.
+      double fWireCoordSlope[3] = {0., 0., 0.}; ///< Change of wire coordinate per cm.
+      std::vector<raw::ChannelID_t> fWireChannels; ///< Channel of each wire.
+
+      /// Asks the geometry; `raw::InvalidChannelID` if off the plane.
+      raw::ChannelID_t geometryChannel(double const* xyz) const;
+    };
+
+    /**
+     * @brief Channel lookups of the planes of a detector, by TPC.
+     *
+     * The planes of each TPC are sampled the first time the TPC is asked for,
+     * so that code covering a single TPC pays only for its own planes.
+     */
+    class ChannelLookup {
+    public:
+      ChannelLookup() = default;
+
+      /// Prepares the lookup of the TPCs of `geom` (none is sampled yet).
+      explicit ChannelLookup(geo::GeometryCore const& geom);
+
+      /// Returns the lookup of the planes of the TPC, sampling them if needed.
+      std::vector<PlaneChannelLookup> const& TPCPlanes(unsigned int tpc, unsigned int cryostat);
+
+    private:
+      geo::GeometryCore const* fGeom = nullptr;
+      /// Lookups indexed by [cryostat][tpc][plane]; empty for TPCs not sampled yet.
+      std::vector<std::vector<std::vector<PlaneChannelLookup>>> fPlanes;
+    };
+  }
+}
+
+#endif // LARSIMPLANECHANNELLOOKUP_H_SEEN
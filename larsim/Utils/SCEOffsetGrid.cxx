@@ -0,0 +1,130 @@
+/**
+ * @file larsim/Utils/SCEOffsetGrid.cxx
+ *
+ * @brief Implementation of the tabulated space charge position offsets
+ *
+ * @see larsim/Utils/SCEOffsetGrid.h
+ */
+
+// LArSoft
+#include "larsim/Utils/SCEOffsetGrid.h"
+
+#include "cetlib_except/exception.h"
+
+// C/C++ standard libraries
+#include <algorithm> // std::count()
+#include <cmath>     // std::ceil()
+
+//------------------------------------------------------------
+larsim::Utils::SCE::OffsetGrid::OffsetGrid(geo::Point_t const& lower,
+                                           geo::Point_t const& upper,
+                                           double spacing)
+{
+  if (!(spacing > 0.0)) {
+    throw cet::exception("OffsetGrid") << "Invalid grid spacing " << spacing << " cm.\n";
+  }
+  double const low[3] = {lower.X(), lower.Y(), lower.Z()};
+  double const high[3] = {upper.X(), upper.Y(), upper.Z()};
+  for (std::size_t axis = 0; axis < 3U; ++axis) {
+    double const length = high[axis] - low[axis];
+    if (!(length > 0.0)) {
+      throw cet::exception("OffsetGrid")
+        << "Invalid range [ " << low[axis] << " ; " << high[axis] << " ] on axis " << axis
+        << ".\n";
+    }
+    fNPoints[axis] = static_cast<std::size_t>(std::ceil(length / spacing)) + 1;
+    fLower[axis] = low[axis];
+    fSpacing[axis] = length / (fNPoints[axis] - 1);
+    fInvSpacing[axis] = 1.0 / fSpacing[axis];
+  }
+}
+
+//------------------------------------------------------------
+double
+larsim::Utils::SCE::OffsetGrid::exactCellFraction() const
+{
+  if (fExactCells.empty()) return 0.0;
+  return double(std::count(fExactCells.begin(), fExactCells.end(), 1)) / fExactCells.size();
+}
+
+//------------------------------------------------------------
+void
+larsim::Utils::SCE::OffsetGrid::markExactCells(std::vector<std::uint8_t> const& invalidNodes)
+{
+  std::size_t const dy = fNPoints[0], dz = fNPoints[0] * fNPoints[1];
+  fExactCells.assign((fNPoints[0] - 1) * (fNPoints[1] - 1) * (fNPoints[2] - 1), 0);
+  for (std::size_t iz = 0; iz < fNPoints[2] - 1; ++iz) {
+    for (std::size_t iy = 0; iy < fNPoints[1] - 1; ++iy) {
+      for (std::size_t ix = 0; ix < fNPoints[0] - 1; ++ix) {
+        std::uint8_t const* v = invalidNodes.data() + nodeIndex(ix, iy, iz);
+        fExactCells[cellIndex(ix, iy, iz)] = v[0] | v[1] | v[dy] | v[dy + 1] | v[dz] |
+                                             v[dz + 1] | v[dz + dy] | v[dz + dy + 1];
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------
+void
+larsim::Utils::SCE::OffsetGrid::interpolate(std::vector<geo::Point_t> const& points,
+                                            std::vector<geo::Vector_t>& offsets,
+                                            std::vector<std::size_t>& exactPoints) const
+{
+  std::size_t const n = points.size();
+  offsets.resize(n);
+  exactPoints.clear();
+
+  // first pass: find the cell of each point; points the grid can't be used
+  // for are interpolated in the first cell and overwritten by the caller
+  std::vector<std::size_t> nodes(n, 0);
+  std::array<std::vector<double>, 3U> frac;
+  for (auto& f : frac)
+    f.assign(n, 0.0);
+  for (std::size_t i = 0; i < n; ++i) {
+    std::array<double, 3U> f;
+    if (!locate(points[i], nodes[i], f)) {
+      nodes[i] = 0;
+      exactPoints.push_back(i);
+      continue;
+    }
+    frac[0][i] = f[0];
+    frac[1][i] = f[1];
+    frac[2][i] = f[2];
+  }
+  if (exactPoints.size() == n) return;
+
+  // second pass: the same trilinear interpolation on each component,
+  // without branches, so that the loop is vectorized
+  std::size_t const dy = fNPoints[0], dz = fNPoints[0] * fNPoints[1];
+  double const* fx = frac[0].data();
+  double const* fy = frac[1].data();
+  double const* fz = frac[2].data();
+  std::array<std::vector<double>, 3U> result;
+  for (std::size_t c = 0; c < 3U; ++c) {
+    float const* v = fOffsets[c].data();
+    result[c].resize(n);
+    double* r = result[c].data();
+    for (std::size_t i = 0; i < n; ++i) {
+      std::size_t const k = nodes[i];
+      double const c00 = v[k] + fx[i] * (v[k + 1] - v[k]);
+      double const c10 = v[k + dy] + fx[i] * (v[k + dy + 1] - v[k + dy]);
+      double const c01 = v[k + dz] + fx[i] * (v[k + dz + 1] - v[k + dz]);
+      double const c11 = v[k + dz + dy] + fx[i] * (v[k + dz + dy + 1] - v[k + dz + dy]);
+      double const c0 = c00 + fy[i] * (c10 - c00);
+      double const c1 = c01 + fy[i] * (c11 - c01);
+      r[i] = c0 + fz[i] * (c1 - c0);
+    }
+  }
+  for (std::size_t i = 0; i < n; ++i)
+    offsets[i] = geo::Vector_t{result[0][i], result[1][i], result[2][i]};
+}
+
+//------------------------------------------------------------
+larsim::Utils::SCE::OffsetGrid
+larsim::Utils::SCE::makeTPCOffsetGrid(geo::GeometryCore const& geom, double spacing)
+{
+  geo::BoxBoundedGeo box{geom.TPC(0, 0).BoundingBox()};
+  for (geo::TPCGeo const& TPC : geom.IterateTPCs())
+    box.ExtendToInclude(TPC.BoundingBox());
+  return {box.Min(), box.Max(), spacing};
+}
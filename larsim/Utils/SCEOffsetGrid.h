@@ -0,0 +1,231 @@
+/**
+ * @file larsim/Utils/SCEOffsetGrid.h
+ *
+ * @brief Space charge position offsets tabulated on a grid, for fast lookup
+ *
+ * The spatial offsets from the space charge provider are sampled once on a
+ * regular grid covering the TPCs, and then evaluated by trilinear
+ * interpolation. Cells where the provider reports offsets out of bounds
+ * (see `larsim::Utils::SCE::out_of_bounds()`) and points outside the grid
+ * are delegated to the provider itself.
+ *
+ * @see larsim/Utils/SCEOffsetGrid.cxx
+ */
+#ifndef LARSIMSCEOFFSETGRID_H_SEEN
+#define LARSIMSCEOFFSETGRID_H_SEEN
+
+//LArSoft
+#include "larcore/Geometry/Geometry.h"
+#include "larsim/Utils/SCEOffsetBounds.h"
+
+// C/C++ standard libraries
+#include <array>
+#include <cmath> // std::isfinite()
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <vector>
+
+namespace larsim
+{
+  namespace Utils
+  {
+    namespace SCE
+    {
+      /**
+       * @brief Position offsets of the space charge effect on a regular grid.
+       *
+       * The grid spans the box between the two corners given at construction
+       * with nodes spaced no more than the requested spacing on each axis.
+       * The offsets of the three components are stored separately, so that
+       * interpolating a batch of points is done with simple loops the
+       * compiler can vectorize.
+       *
+       * Typical use:
+       *
+       *     auto const exact = [sce](geo::Point_t const& p){ return sce->GetPosOffsets(p); };
+       *     larsim::Utils::SCE::OffsetGrid grid{ lower, upper, 5.0 };
+       *     grid.fill(exact);
+       *     geo::Vector_t const offset = grid.GetPosOffsets(point, exact);
+       */
+      class OffsetGrid {
+      public:
+        OffsetGrid() = default;
+
+        /// Creates an empty grid spanning from `lower` to `upper` [cm].
+        OffsetGrid(geo::Point_t const& lower, geo::Point_t const& upper, double spacing);
+
+        /// Total number of grid nodes.
+        std::size_t
+        nNodes() const
+        {
+          return fNPoints[0] * fNPoints[1] * fNPoints[2];
+        }
+
+        /// Returns whether the grid has been filled.
+        bool
+        isFilled() const
+        {
+          return !fOffsets[0].empty();
+        }
+
+        /// Fraction of the cells where the provider is used.
+        double exactCellFraction() const;
+
+        /// Samples `offsets` (callable returning `geo::Vector_t` from a `geo::Point_t`).
+        template <typename Func>
+        void fill(Func&& offsets);
+
+        /// Returns the offsets at `point`, evaluating `exact` if needed.
+        template <typename Func>
+        geo::Vector_t GetPosOffsets(geo::Point_t const& point, Func&& exact) const;
+
+        /**
+         * @brief Computes the offsets at all the `points`.
+         * @param points the points to evaluate the offsets at
+         * @param offsets (output) offsets of each point, in the same order
+         * @param exact callable returning the exact offsets at a point
+         */
+        template <typename Func>
+        void GetPosOffsets(std::vector<geo::Point_t> const& points,
+                           std::vector<geo::Vector_t>& offsets,
+                           Func&& exact) const;
+
+      private:
+        std::array<std::size_t, 3U> fNPoints{{0U, 0U, 0U}};
+        std::array<double, 3U> fLower{{0.0, 0.0, 0.0}};
+        std::array<double, 3U> fSpacing{{0.0, 0.0, 0.0}};
+        std::array<double, 3U> fInvSpacing{{0.0, 0.0, 0.0}}; ///< Inverse of `fSpacing`.
+
+        std::array<std::vector<float>, 3U> fOffsets; ///< Offsets at the nodes (x fastest).
+        std::vector<std::uint8_t> fExactCells;       ///< Whether each cell needs `exact`.
+
+        std::size_t
+        nodeIndex(std::size_t ix, std::size_t iy, std::size_t iz) const
+        {
+          return (iz * fNPoints[1] + iy) * fNPoints[0] + ix;
+        }
+
+        std::size_t
+        cellIndex(std::size_t ix, std::size_t iy, std::size_t iz) const
+        {
+          return (iz * (fNPoints[1] - 1) + iy) * (fNPoints[0] - 1) + ix;
+        }
+
+        /// Finds the first node of the cell containing `point` and the position
+        /// within the cell; returns `false` if the grid can't be used there.
+        bool locate(geo::Point_t const& point, std::size_t& node, std::array<double, 3U>& frac) const;
+
+        /// Marks the cells with a corner in `invalidNodes` as to be evaluated exactly.
+        void markExactCells(std::vector<std::uint8_t> const& invalidNodes);
+
+        /// Interpolates the offsets at `points`; the index of each point the grid
+        /// can't be used for is added to `exactPoints`.
+        void interpolate(std::vector<geo::Point_t> const& points,
+                         std::vector<geo::Vector_t>& offsets,
+                         std::vector<std::size_t>& exactPoints) const;
+
+      }; // class OffsetGrid
+
+      /// Returns an empty grid covering all the TPCs of `geom`, with nodes
+      /// no farther than `spacing` [cm] apart.
+      OffsetGrid makeTPCOffsetGrid(geo::GeometryCore const& geom, double spacing);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+inline bool
+larsim::Utils::SCE::OffsetGrid::locate(geo::Point_t const& point,
+                                       std::size_t& node,
+                                       std::array<double, 3U>& frac) const
+{
+  if (!isFilled()) return false;
+  double const coords[3] = {point.X(), point.Y(), point.Z()};
+  std::size_t cell[3];
+  for (std::size_t axis = 0; axis < 3U; ++axis) {
+    double const u = (coords[axis] - fLower[axis]) * fInvSpacing[axis];
+    if (!(u >= 0.0) || (u > double(fNPoints[axis] - 1))) return false;
+    std::size_t i = static_cast<std::size_t>(u);
+    if (i >= fNPoints[axis] - 1) i = fNPoints[axis] - 2;
+    cell[axis] = i;
+    frac[axis] = u - double(i);
+  }
+  if (fExactCells[cellIndex(cell[0], cell[1], cell[2])]) return false;
+  node = nodeIndex(cell[0], cell[1], cell[2]);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+template <typename Func>
+void
+larsim::Utils::SCE::OffsetGrid::fill(Func&& offsets)
+{
+  std::size_t const n = nNodes();
+  for (auto& component : fOffsets)
+    component.assign(n, 0.0f);
+
+  // nodes where the provider has no valid offsets are stored as zero,
+  // and the cells around them are left to the provider
+  std::vector<std::uint8_t> invalidNodes(n, 0);
+  for (std::size_t iz = 0; iz < fNPoints[2]; ++iz) {
+    for (std::size_t iy = 0; iy < fNPoints[1]; ++iy) {
+      for (std::size_t ix = 0; ix < fNPoints[0]; ++ix) {
+        geo::Point_t const p{fLower[0] + ix * fSpacing[0],
+                             fLower[1] + iy * fSpacing[1],
+                             fLower[2] + iz * fSpacing[2]};
+        geo::Vector_t const offset = offsets(p);
+        std::size_t const node = nodeIndex(ix, iy, iz);
+        if (out_of_bounds(offset) || !std::isfinite(offset.X()) || !std::isfinite(offset.Y()) ||
+            !std::isfinite(offset.Z())) {
+          invalidNodes[node] = 1;
+          continue;
+        }
+        fOffsets[0][node] = float(offset.X());
+        fOffsets[1][node] = float(offset.Y());
+        fOffsets[2][node] = float(offset.Z());
+      }
+    }
+  }
+  markExactCells(invalidNodes);
+}
+
+//------------------------------------------------------------------------------
+template <typename Func>
+geo::Vector_t
+larsim::Utils::SCE::OffsetGrid::GetPosOffsets(geo::Point_t const& point, Func&& exact) const
+{
+  std::size_t node = 0;
+  std::array<double, 3U> frac;
+  if (!locate(point, node, frac)) return exact(point);
+
+  std::size_t const dy = fNPoints[0], dz = fNPoints[0] * fNPoints[1];
+  double result[3];
+  for (std::size_t c = 0; c < 3U; ++c) {
+    float const* v = fOffsets[c].data() + node;
+    double const c00 = v[0] + frac[0] * (v[1] - v[0]);
+    double const c10 = v[dy] + frac[0] * (v[dy + 1] - v[dy]);
+    double const c01 = v[dz] + frac[0] * (v[dz + 1] - v[dz]);
+    double const c11 = v[dz + dy] + frac[0] * (v[dz + dy + 1] - v[dz + dy]);
+    double const c0 = c00 + frac[1] * (c10 - c00);
+    double const c1 = c01 + frac[1] * (c11 - c01);
+    result[c] = c0 + frac[2] * (c1 - c0);
+  }
+  return {result[0], result[1], result[2]};
+}
+
+//------------------------------------------------------------------------------
+template <typename Func>
+void
+larsim::Utils::SCE::OffsetGrid::GetPosOffsets(std::vector<geo::Point_t> const& points,
+                                              std::vector<geo::Vector_t>& offsets,
+                                              Func&& exact) const
+{
+  std::vector<std::size_t> exactPoints;
+  interpolate(points, offsets, exactPoints);
+  for (std::size_t const i : exactPoints)
+    offsets[i] = exact(points[i]);
+}
+
+//------------------------------------------------------------------------------
+
+#endif  // #ifndef LARSIMSCEOFFSETGRID_H_SEEN
@@ -0,0 +1,48 @@
+/**
+ * @file larsim/Utils/TraceZones.h
+ *
+ * @brief Profiler zones and counters for the hot paths of the simulation
+ *
+ * The macros in this header mark the code of the simulation which an
+ * instrumenting profiler should time:
+ *
+ *  * `LARSIM_TRACE_ZONE("name")` times the enclosing scope as zone `name`;
+ *  * `LARSIM_TRACE_COUNTER("name", value)` records the current `value` of a
+ *    counter (number of deposits, photons, electron clusters...), so that the
+ *    time spent in a zone can be related to the amount of work it did.
+ *
+ * Names must be string literals (profilers keep their address).
+ *
+ * By default the macros expand to nothing: their arguments are not even
+ * evaluated, and instrumented code has no cost at all. The zones are compiled
+ * in by defining `LARSIM_TRACY` (the CMake option `LARSIM_ENABLE_TRACY`), in
+ * which case they are
+ * [Tracy profiler](https://github.com/wolfpld/tracy) zones and plots; a
+ * different profiler needs only a new set of definitions in this header.
+ *
+ * Zones are meant for functions called at most a few thousand times per
+ * event (a `produce()`, a per-deposit routine of a fast simulation): even
+ * when enabled they cost tens of nanoseconds each, which is not negligible in
+ * per-photon or per-electron loops.
+ *
+ * This is a header-only library.
+ */
+#ifndef LARSIMTRACEZONES_H_SEEN
+#define LARSIMTRACEZONES_H_SEEN
+
+#if defined(LARSIM_TRACY)
+
+#include "tracy/Tracy.hpp"
+
+#define LARSIM_TRACE_ZONE(name) ZoneScopedN(name)
+#define LARSIM_TRACE_COUNTER(name, value) TracyPlot(name, static_cast<int64_t>(value))
+
+#else // no profiler
+
+// `sizeof` keeps the arguments "used" without evaluating them
+#define LARSIM_TRACE_ZONE(name) static_cast<void>(sizeof(name))
+#define LARSIM_TRACE_COUNTER(name, value) static_cast<void>(sizeof(name) + sizeof(value))
+
+#endif // LARSIM_TRACY
+
+#endif // LARSIMTRACEZONES_H_SEEN
@@ -9,6 +9,9 @@
  */
 
 //STL
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <utility>
 //ART
 #include "canvas/Utilities/Exception.h"
@@ -25,18 +28,21 @@ namespace {
   constexpr G4ID kInvalidG4ID =
     std::numeric_limits<G4ID>::lowest(); ///< The value used when no G4 ID has been found
 
+  /// Ordering of energy deposits where (almost) equal deposits compare as lower
+  bool
+  LowerEDep(const std::pair<G4ID, EDeposit>& a, const std::pair<G4ID, EDeposit>& b)
+  {
+    return std::nextafter(a.second, std::numeric_limits<EDeposit>::lowest()) <= b.second &&
+               std::nextafter(a.second, std::numeric_limits<EDeposit>::max()) >= b.second ?
+             1 :
+             a.second < b.second;
+  }
+
   IDToEDepositMap::const_iterator
   MaxEDepElementInMap(const IDToEDepositMap& idToEDepMap)
   {
-    IDToEDepositMap::const_iterator highestContribIt(std::max_element(
-      idToEDepMap.begin(),
-      idToEDepMap.end(),
-      [](const std::pair<G4ID, EDeposit>& a, const std::pair<G4ID, EDeposit>& b) -> bool {
-        return std::nextafter(a.second, std::numeric_limits<EDeposit>::lowest()) <= b.second &&
-                   std::nextafter(a.second, std::numeric_limits<EDeposit>::max()) >= b.second ?
-                 1 :
-                 a.second < b.second;
-      }));
+    IDToEDepositMap::const_iterator highestContribIt(
+      std::max_element(idToEDepMap.begin(), idToEDepMap.end(), LowerEDep));
 
     if (idToEDepMap.end() == highestContribIt) {
       throw art::Exception(art::errors::LogicError)
@@ -194,3 +200,183 @@ TruthMatchUtils::FillG4IDToEnergyDepositMap(IDToEDepositMap& idToEDepMap,
 
   return;
 }
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+std::size_t
+TruthMatchUtils::TruthMatchContext::HitKeyHash::operator()(
+  const std::pair<unsigned int, std::size_t>& key) const noexcept
+{
+  return std::hash<std::size_t>{}(key.second) ^ (std::hash<unsigned int>{}(key.first) << 1);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+TruthMatchUtils::TruthMatchContext::TruthMatchContext(const bool rollupUnsavedIDs)
+  : fRollupUnsavedIDs(rollupUnsavedIDs)
+{}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void
+TruthMatchUtils::TruthMatchContext::Reset(detinfo::DetectorClocksData const& clockData)
+{
+  fClockData = &clockData;
+  fContributions.clear();
+  fHitInfo.clear();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void
+TruthMatchUtils::TruthMatchContext::AddHits(const std::vector<art::Ptr<recob::Hit>>& pHits)
+{
+  for (const art::Ptr<recob::Hit>& pHit : pHits)
+    GetHitInfo(pHit);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+TruthMatchUtils::G4ID
+TruthMatchUtils::TruthMatchContext::TrueParticleID(const art::Ptr<recob::Hit>& pHit)
+{
+  return GetHitInfo(pHit).fTrueParticleID;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+TruthMatchUtils::G4ID
+TruthMatchUtils::TruthMatchContext::TrueParticleIDFromTotalTrueEnergy(
+  const std::vector<art::Ptr<recob::Hit>>& pHits)
+{
+  fEDepByID.clear();
+  for (const art::Ptr<recob::Hit>& pHit : pHits) {
+    const HitInfo& hitInfo(GetHitInfo(pHit));
+    for (std::size_t i = hitInfo.fBegin; i != hitInfo.fEnd; ++i)
+      fEDepByID[fContributions[i].first] += fContributions[i].second;
+  }
+
+  fSortedEDeps.assign(fEDepByID.begin(), fEDepByID.end());
+  return MaxEDepID();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+TruthMatchUtils::G4ID
+TruthMatchUtils::TruthMatchContext::TrueParticleIDFromTotalRecoCharge(
+  const std::vector<art::Ptr<recob::Hit>>& pHits)
+{
+  fEDepByID.clear();
+  for (const art::Ptr<recob::Hit>& pHit : pHits)
+    fEDepByID[GetHitInfo(pHit).fTrueParticleID] += static_cast<EDeposit>(pHit->Integral());
+
+  fSortedEDeps.assign(fEDepByID.begin(), fEDepByID.end());
+  return MaxEDepID();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+TruthMatchUtils::G4ID
+TruthMatchUtils::TruthMatchContext::TrueParticleIDFromTotalRecoHits(
+  const std::vector<art::Ptr<recob::Hit>>& pHits)
+{
+  fHitCountByID.clear();
+  for (const art::Ptr<recob::Hit>& pHit : pHits)
+    ++fHitCountByID[GetHitInfo(pHit).fTrueParticleID];
+
+  if (fHitCountByID.empty()) return kInvalidG4ID;
+
+  G4ID maxID(kInvalidG4ID);
+  unsigned int maxHitCount(0), nMaxContributingIDs(0);
+  for (auto const& [g4ID, hitCount] : fHitCountByID) {
+    if (hitCount > maxHitCount) {
+      maxID = g4ID;
+      maxHitCount = hitCount;
+      nMaxContributingIDs = 1;
+    }
+    else if (hitCount == maxHitCount)
+      ++nMaxContributingIDs;
+  }
+
+  if (1 < nMaxContributingIDs) {
+    mf::LogInfo("TruthMatchUtils::TrueParticleIDFromTotalRecoHits")
+      << "There are " << nMaxContributingIDs
+      << " particles which tie for highest number of contributing hits (" << maxHitCount
+      << " hits).  Using TruthMatchUtils::TrueParticleIDFromTotalTrueEnergy instead." << std::endl;
+    return TrueParticleIDFromTotalTrueEnergy(pHits);
+  }
+
+  return maxID;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void
+TruthMatchUtils::TruthMatchContext::FillG4IDToEnergyDepositMap(IDToEDepositMap& idToEDepMap,
+                                                               const art::Ptr<recob::Hit>& pHit)
+{
+  const HitInfo& hitInfo(GetHitInfo(pHit));
+  for (std::size_t i = hitInfo.fBegin; i != hitInfo.fEnd; ++i) {
+    auto [iterator, inserted] =
+      idToEDepMap.try_emplace(fContributions[i].first, fContributions[i].second);
+    if (!inserted) iterator->second += fContributions[i].second;
+  }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+const TruthMatchUtils::TruthMatchContext::HitInfo&
+TruthMatchUtils::TruthMatchContext::GetHitInfo(const art::Ptr<recob::Hit>& pHit)
+{
+  if (!fClockData) {
+    throw art::Exception(art::errors::LogicError)
+      << "TruthMatchUtils::TruthMatchContext used before Reset() was called with the clock data "
+         "of the event.";
+  }
+
+  auto [iterator, inserted] =
+    fHitInfo.try_emplace({pHit.id().value(), pHit.key()}, HitInfo{0, 0, kInvalidG4ID});
+  if (!inserted) return iterator->second;
+
+  HitInfo& hitInfo(iterator->second);
+  hitInfo.fBegin = fContributions.size();
+  const art::ServiceHandle<cheat::BackTrackerService> btServ;
+  for (const sim::TrackIDE& trackIDE : btServ->HitToTrackIDEs(*fClockData, pHit)) {
+    const G4ID g4ID(
+      static_cast<G4ID>(fRollupUnsavedIDs ? std::abs(trackIDE.trackID) : trackIDE.trackID));
+    fContributions.emplace_back(g4ID, static_cast<EDeposit>(trackIDE.energy));
+  }
+  hitInfo.fEnd = fContributions.size();
+
+  // the energy of each particle in the hit, summed in the same order as the other functions do
+  fSortedEDeps.clear();
+  for (std::size_t i = hitInfo.fBegin; i != hitInfo.fEnd; ++i) {
+    auto const it(std::find_if(fSortedEDeps.begin(),
+                               fSortedEDeps.end(),
+                               [g4ID = fContributions[i].first](const Contribution& c) -> bool {
+                                 return c.first == g4ID;
+                               }));
+    if (it == fSortedEDeps.end())
+      fSortedEDeps.push_back(fContributions[i]);
+    else
+      it->second += fContributions[i].second;
+  }
+  hitInfo.fTrueParticleID = MaxEDepID();
+
+  return hitInfo;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+TruthMatchUtils::G4ID
+TruthMatchUtils::TruthMatchContext::MaxEDepID()
+{
+  if (fSortedEDeps.empty()) return kInvalidG4ID;
+
+  // ties are resolved as in an ID-ordered map, i.e. in favour of the latest (largest) ID
+  std::sort(fSortedEDeps.begin(),
+            fSortedEDeps.end(),
+            [](const Contribution& a, const Contribution& b) -> bool { return a.first < b.first; });
+  return std::max_element(fSortedEDeps.begin(), fSortedEDeps.end(), LowerEDep)->first;
+}
@@ -14,8 +14,11 @@
 #include "lardataobj/RecoBase/Hit.h"
 
 // c++
+#include <cstddef>
 #include <limits>
 #include <map>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace detinfo {
@@ -97,6 +100,89 @@ namespace TruthMatchUtils {
                                   const art::Ptr<recob::Hit>& pHit,
                                   const bool rollupUnsavedIDs);
 
+  /**
+ *  @brief  Truth matching of the hits of an event, backtracking each hit only once
+ *
+ *  The functions above ask the BackTracker for the contributions of each hit at every call, and
+ *  (for vectors of hits) accumulate them in ordered maps.  A context keeps the list of
+ *  contributions (G4 ID and energy) of each hit it has seen, computed the first time the hit is
+ *  queried (or when it is added with AddHits), so that following queries only accumulate them.
+ *  The results are the same as the ones of the functions with the same name.
+ *
+ *  A context is meant to be a member of a module, reset at the beginning of each event with the
+ *  clock data of that event; the memory is kept from one event to the next.  It is not
+ *  thread-safe.
+ */
+  class TruthMatchContext {
+  public:
+    /**
+   *  @brief  Constructor
+   *
+   *  @param  rollupUnsavedIDs whether to squash energy deposits for non-saved G4 particles (e.g. shower secondaries) its saved ancestor particle
+   */
+    explicit TruthMatchContext(const bool rollupUnsavedIDs);
+
+    /**
+   *  @brief  Forget all the hits, and start matching the hits of a new event
+   *
+   *  @param  clockData the clock data of the event (must stay valid until the next reset)
+   */
+    void Reset(detinfo::DetectorClocksData const& clockData);
+
+    /**
+   *  @brief  Backtrack all the hits in a vector in advance
+   *
+   *  @param  pHits the recob::Hit vector to be backtracked
+   */
+    void AddHits(const std::vector<art::Ptr<recob::Hit>>& pHits);
+
+    /// @see TruthMatchUtils::TrueParticleID()
+    G4ID TrueParticleID(const art::Ptr<recob::Hit>& pHit);
+
+    /// @see TruthMatchUtils::TrueParticleIDFromTotalTrueEnergy()
+    G4ID TrueParticleIDFromTotalTrueEnergy(const std::vector<art::Ptr<recob::Hit>>& pHits);
+
+    /// @see TruthMatchUtils::TrueParticleIDFromTotalRecoCharge()
+    G4ID TrueParticleIDFromTotalRecoCharge(const std::vector<art::Ptr<recob::Hit>>& pHits);
+
+    /// @see TruthMatchUtils::TrueParticleIDFromTotalRecoHits()
+    G4ID TrueParticleIDFromTotalRecoHits(const std::vector<art::Ptr<recob::Hit>>& pHits);
+
+    /// @see TruthMatchUtils::FillG4IDToEnergyDepositMap()
+    void FillG4IDToEnergyDepositMap(IDToEDepositMap& idToEDepMap,
+                                    const art::Ptr<recob::Hit>& pHit);
+
+  private:
+    typedef std::pair<G4ID, EDeposit> Contribution;
+
+    /// Contributions of one hit, in fContributions
+    struct HitInfo {
+      std::size_t fBegin;
+      std::size_t fEnd;
+      G4ID fTrueParticleID; ///< the ID of the particle depositing the most energy in the hit
+    };
+
+    struct HitKeyHash {
+      std::size_t operator()(const std::pair<unsigned int, std::size_t>& key) const noexcept;
+    };
+
+    const bool fRollupUnsavedIDs;
+    detinfo::DetectorClocksData const* fClockData = nullptr;
+    std::vector<Contribution> fContributions; ///< the contributions of all hits, hit after hit
+    std::unordered_map<std::pair<unsigned int, std::size_t>, HitInfo, HitKeyHash> fHitInfo;
+
+    // scratch containers, kept to reuse their memory
+    std::unordered_map<G4ID, EDeposit> fEDepByID;
+    std::unordered_map<G4ID, unsigned int> fHitCountByID;
+    std::vector<Contribution> fSortedEDeps;
+
+    /// Returns the contributions of the hit, backtracking it if it is new
+    const HitInfo& GetHitInfo(const art::Ptr<recob::Hit>& pHit);
+
+    /// Returns the ID with the largest deposit in fSortedEDeps (invalid if empty)
+    G4ID MaxEDepID();
+  };
+
 } // namespace TruthMatchUtils
 
 #endif // #ifndef TRUTHMATCHUTILS_H_SEEN
@@ -0,0 +1,96 @@
+#!/bin/bash
+#
+# Runs the simulation chain benchmark on the canonical samples and collects,
+# for each one, a comparable summary:
+#
+#  * <sample>/module_times.csv: per module label, events and time [s]
+#    (from the `TimeTracker` database);
+#  * <sample>/peak_memory.csv: peak memory usage (from the `MemoryTracker`
+#    database);
+#  * <sample>/product_sizes.txt: size of each data product in the output file
+#    (from `product_sizes_dumper`);
+#  * summary.csv: events per second and peak resident memory of each sample.
+#
+# Usage:
+#
+#   run_simchain_benchmark.sh [-n NEvents] [-o OutputDir] [Sample ...]
+#
+# Samples are: muon (simchain_benchmark.fcl), nue, cosmics, radiologicals
+# (simchain_benchmark_<sample>.fcl); by default all of them are run.
+# `lar`, `sqlite3` and `product_sizes_dumper` must be in the path.
+#
+
+NEvents=10
+OutputDir="simchain_benchmark_results"
+
+while getopts "n:o:" opt; do
+  case "$opt" in
+    ( n ) NEvents="$OPTARG" ;;
+    ( o ) OutputDir="$OPTARG" ;;
+    ( * ) echo "Usage: $0 [-n NEvents] [-o OutputDir] [Sample ...]" 1>&2 ; exit 1 ;;
+  esac
+done
+shift $(( OPTIND - 1 ))
+
+Samples=( "$@" )
+[ ${#Samples[@]} -eq 0 ] && Samples=( muon nue cosmics radiologicals )
+
+for tool in lar sqlite3 product_sizes_dumper ; do
+  if ! type -P "$tool" > /dev/null ; then
+    echo "ERROR: '${tool}' not found in the path." 1>&2
+    exit 1
+  fi
+done
+
+# the configurations are found next to this script
+ScriptDir="$(cd "$(dirname "$0")" && pwd)"
+export FHICL_FILE_PATH="${ScriptDir}${FHICL_FILE_PATH:+:${FHICL_FILE_PATH}}"
+
+mkdir -p "$OutputDir" || exit $?
+Summary="${OutputDir}/summary.csv"
+echo "sample,events,events_per_second,mean_event_time_s,peak_rss,status" > "$Summary"
+
+for sample in "${Samples[@]}" ; do
+  if [ "$sample" == "muon" ]; then
+    config="simchain_benchmark.fcl"
+    stem="simchain_benchmark"
+  else
+    config="simchain_benchmark_${sample}.fcl"
+    stem="simchain_benchmark_${sample}"
+  fi
+
+  SampleDir="${OutputDir}/${sample}"
+  mkdir -p "$SampleDir" || exit $?
+
+  echo "Running sample '${sample}' (${NEvents} events)..."
+  ( cd "$SampleDir" && lar --rethrow-all -c "$config" -n "$NEvents" > lar.log 2>&1 )
+  status=$?
+  if [ $status -ne 0 ]; then
+    echo "  sample '${sample}' failed (exit code ${status}), see ${SampleDir}/lar.log" 1>&2
+    echo "${sample},0,,,,failed" >> "$Summary"
+    continue
+  fi
+
+  TimeDB="${SampleDir}/${stem}_time.db"
+  MemoryDB="${SampleDir}/${stem}_memory.db"
+
+  sqlite3 -header -csv "$TimeDB" \
+    "SELECT ModuleLabel AS module_label, ModuleType AS module_type, COUNT(*) AS events,
+            AVG(Time) AS mean_time_s, MAX(Time) AS max_time_s, SUM(Time) AS total_time_s
+       FROM TimeModule GROUP BY ModuleLabel, ModuleType ORDER BY total_time_s DESC;" \
+    > "${SampleDir}/module_times.csv"
+
+  sqlite3 -header -csv "$MemoryDB" "SELECT * FROM PeakUsage;" > "${SampleDir}/peak_memory.csv"
+
+  product_sizes_dumper -f 0 "${SampleDir}/${stem}.root" > "${SampleDir}/product_sizes.txt" 2>&1
+
+  read -r events meanTime < <(sqlite3 -separator ' ' "$TimeDB" \
+    "SELECT COUNT(*), AVG(Time) FROM TimeEvent;")
+  peakRSS="$(sqlite3 "$MemoryDB" "SELECT Value FROM PeakUsage WHERE Name = 'VmHWM';")"
+  rate="$(awk -v t="$meanTime" 'BEGIN { if (t > 0) printf "%.4g", 1.0 / t }')"
+
+  echo "${sample},${events},${rate},${meanTime},${peakRSS},ok" >> "$Summary"
+done
+
+echo "Summary in '${Summary}':"
+cat "$Summary"
@@ -0,0 +1,576 @@
+/**
+ * @file    SimDriftElectronsBenchmark.cc
+ * @brief   Timing of the charge drift of `SimDriftElectrons` on synthetic deposits.
+ *
+ * Usage: `larsim_bench_drift [--min-time=<seconds>] [--json=<file>]`
+ *
+ * Three synthetic streams of `sim::SimEnergyDeposit` are drifted:
+ *
+ *  * `mip`: straight minimum ionizing tracks, in 1 mm steps of 2.1 MeV/cm;
+ *  * `shower`: electromagnetic showers, as random walks of short steps of a few
+ *    tens of keV from a few vertices;
+ *  * `blips`: isolated point-like deposits of radiological decays, uniformly in
+ *    the volume.
+ *
+ * The detector is a mock of a single TPC (2.5 m drift along x towards three
+ * wire planes at -30, +30 and 0 degrees with 3 mm pitch, 4 m x 10 m) with a
+ * 500 ns TDC tick, so that no geometry nor detector properties service is
+ * needed. Each deposit goes through the per-deposit steps of the module:
+ * attenuation and diffusion widths (`larsim::Utils::DriftPhysicsTable`),
+ * splitting and diffusion of the electron clusters
+ * (`larsim::Utils::ElectronClusterDrift`), batched channel lookup on each
+ * plane (`larsim::Utils::PlaneChannelLookup`) and filling of the
+ * `sim::SimChannel` collection; the ionization is the one stored in the
+ * deposits.
+ *
+ * Each stream is drifted repeatedly, from the same random seed, for at least
+ * the requested time (default: 0.1 s). The JSON report (standard output, or
+ * the specified file) has for each stream the rates of deposits and electron
+ * clusters, a histogram of the time per deposit (in bins of powers of two
+ * nanoseconds; the clock itself costs a few tens of nanoseconds) and a
+ * summary of the output channels: number of channels and IDEs, total
+ * electrons and a digest of the whole collection. Comparing the digests from
+ * two builds tells whether a change of the drift code preserves the output
+ * exactly; the totals allow a comparison with a tolerance when it does not.
+ *
+ * Output equivalence is also checked within the run: the channels are
+ * computed a second time with a per-cluster channel lookup instead of the
+ * batched one, and the program fails if the two collections differ.
+ */
+
+// LArSoft libraries
+#include "larsim/Utils/DriftPhysicsTable.h"
+#include "larsim/Utils/ElectronClusterDrift.h"
+#include "larsim/Utils/PlaneChannelLookup.h"
+#include "lardataobj/Simulation/SimChannel.h"
+#include "lardataobj/Simulation/SimEnergyDeposit.h"
+#include "larcoreobj/SimpleTypesAndConstants/RawTypes.h" // raw::ChannelID_t
+#include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h" // geo::Point_t
+
+// CLHEP libraries
+#include "CLHEP/Random/MixMaxRng.h"
+#include "CLHEP/Random/RandFlat.h"
+#include "CLHEP/Random/RandGauss.h"
+
+// C/C++ standard libraries
+#include <algorithm> // std::min(), std::max()
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstring> // std::memcpy()
+#include <fstream>
+#include <iomanip> // std::setw(), std::setfill()
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility> // std::move()
+#include <vector>
+
+namespace {
+
+  //----------------------------------------------------------------------------
+  // mock detector
+
+  constexpr double DriftLength = 250.; // cm, from x = 0 (first plane) to x = 250 cm
+  constexpr double HalfHeight = 200.;  // cm, y from -200 to 200 cm
+  constexpr double Length = 1000.;     // cm, z from 0 to 1000 cm
+  constexpr double WirePitch = 0.3;    // cm
+  constexpr double PlanePitch = 0.3;   // cm, between consecutive planes
+  constexpr double TickPeriod = 500.;  // ns
+  constexpr double TriggerOffset = 1.6e6; // ns, electronics time of the simulation time 0
+  constexpr double RecipDriftVel[3] = {6250., 5000., 4000.}; // ns/cm, drift volume and gaps
+
+  // drift and diffusion constants, as in the standard configuration
+  constexpr double ElectronLifetime = 3.e3;     // us
+  constexpr double LongitudinalDiffusion = 6.2e-9; // cm^2/ns
+  constexpr double TransverseDiffusion = 16.3e-9;  // cm^2/ns
+  constexpr double ElectronClusterSize = 600.;
+  constexpr int MinNumberOfElCluster = 0;
+
+  // ionization: 23.6 eV per pair, with 70% surviving recombination
+  constexpr double ElectronsPerMeV = 0.7e6 / 23.6;
+
+  /// Readout of one wire plane of the mock TPC.
+  struct MockPlane {
+    double x;          ///< Position of the plane on the drift axis [cm].
+    double timeOffset; ///< Drift time from the first plane [ns].
+    larsim::Utils::PlaneChannelLookup channels;
+  };
+
+  /// Builds the three planes, with channels numbered plane after plane.
+  std::vector<MockPlane>
+  makePlanes()
+  {
+    std::vector<MockPlane> planes;
+    raw::ChannelID_t firstChannel = 0;
+    double timeOffset = 0.;
+    double const angles[3] = {-M_PI / 6., M_PI / 6., 0.};
+    for (unsigned int p = 0; p < 3; ++p) {
+      if (p > 0) timeOffset += PlanePitch * RecipDriftVel[p];
+
+      // wire coordinate: distance along the direction perpendicular to the
+      // wires, from the corner of the plane with the lowest one
+      double const cosA = std::cos(angles[p]) / WirePitch;
+      double const sinA = std::sin(angles[p]) / WirePitch;
+      double const corners[4] = {-HalfHeight * sinA,
+                                 HalfHeight * sinA,
+                                 Length * cosA - HalfHeight * sinA,
+                                 Length * cosA + HalfHeight * sinA};
+      double minCoord = corners[0], maxCoord = corners[0];
+      for (double const c : corners) {
+        minCoord = std::min(minCoord, c);
+        maxCoord = std::max(maxCoord, c);
+      }
+      double const slopes[3] = {0., sinA, cosA};
+      auto const nWires = static_cast<std::size_t>(maxCoord - minCoord) + 1U;
+      std::vector<raw::ChannelID_t> channels(nWires);
+      for (std::size_t w = 0; w < nWires; ++w)
+        channels[w] = firstChannel + w;
+      firstChannel += nWires;
+
+      planes.push_back({-PlanePitch * p,
+                        timeOffset,
+                        larsim::Utils::PlaneChannelLookup{-minCoord, slopes, std::move(channels)}});
+    }
+    return planes;
+  } // makePlanes()
+
+  //----------------------------------------------------------------------------
+  // synthetic deposits
+
+  sim::SimEnergyDeposit
+  makeDeposit(geo::Point_t const& start,
+              geo::Point_t const& end,
+              double energy,
+              double time,
+              int trackID,
+              int pdg)
+  {
+    return {0,
+            static_cast<int>(energy * ElectronsPerMeV),
+            0.f,
+            static_cast<float>(energy),
+            start,
+            end,
+            time,
+            time + 0.1,
+            trackID,
+            pdg};
+  }
+
+  geo::Vector_t
+  randomDirection(CLHEP::RandFlat& flat)
+  {
+    double const cosTheta = flat.fire(-1., 1.);
+    double const sinTheta = std::sqrt(1. - cosTheta * cosTheta);
+    double const phi = flat.fire(0., 2. * M_PI);
+    return {sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta};
+  }
+
+  bool
+  insideTPC(geo::Point_t const& p)
+  {
+    return (p.X() > 0.) && (p.X() < DriftLength) && (std::abs(p.Y()) < HalfHeight) &&
+           (p.Z() > 0.) && (p.Z() < Length);
+  }
+
+  /// A random point inside the TPC, `margin` cm away from its walls.
+  geo::Point_t
+  randomPoint(CLHEP::RandFlat& flat, double margin)
+  {
+    return {flat.fire(margin, DriftLength - margin),
+            flat.fire(-HalfHeight + margin, HalfHeight - margin),
+            flat.fire(margin, Length - margin)};
+  }
+
+  /// Straight minimum ionizing tracks through the TPC.
+  std::vector<sim::SimEnergyDeposit>
+  makeMIPs(CLHEP::RandFlat& flat, std::size_t nDeposits)
+  {
+    constexpr double Step = 0.1; // cm
+    std::vector<sim::SimEnergyDeposit> deposits;
+    int trackID = 0;
+    while (deposits.size() < nDeposits) {
+      ++trackID;
+      geo::Point_t pos = randomPoint(flat, 10.);
+      geo::Vector_t const dir = randomDirection(flat);
+      double const time = flat.fire(-1.e6, 1.e6);
+      for (int iStep = 0; iStep < 2000 && deposits.size() < nDeposits; ++iStep) {
+        geo::Point_t const next = pos + Step * dir;
+        if (!insideTPC(next)) break;
+        deposits.push_back(makeDeposit(pos, next, 0.21, time + iStep * 0.0033, trackID, 13));
+        pos = next;
+      }
+    }
+    return deposits;
+  } // makeMIPs()
+
+  /// Electromagnetic showers, as random walks of soft electrons.
+  std::vector<sim::SimEnergyDeposit>
+  makeShowers(CLHEP::RandFlat& flat, std::size_t nDeposits)
+  {
+    std::vector<sim::SimEnergyDeposit> deposits;
+    int trackID = 0;
+    while (deposits.size() < nDeposits) {
+      geo::Point_t const vertex = randomPoint(flat, 50.);
+      geo::Vector_t const axis = randomDirection(flat);
+      double const time = flat.fire(-1.e6, 1.e6);
+      for (int iParticle = 0; iParticle < 200 && deposits.size() < nDeposits; ++iParticle) {
+        ++trackID;
+        // each particle starts further along the shower axis
+        geo::Point_t pos = vertex + flat.fire(0., 40.) * axis;
+        geo::Vector_t dir = axis;
+        for (int iStep = 0; iStep < 30 && deposits.size() < nDeposits; ++iStep) {
+          dir = (dir + 0.5 * randomDirection(flat)).Unit();
+          geo::Point_t const next = pos + flat.fire(0.01, 0.05) * dir;
+          if (!insideTPC(next)) break;
+          deposits.push_back(makeDeposit(pos, next, flat.fire(0.005, 0.08), time, trackID, 11));
+          pos = next;
+        }
+      }
+    }
+    return deposits;
+  } // makeShowers()
+
+  /// Isolated point-like deposits (radiological decays).
+  std::vector<sim::SimEnergyDeposit>
+  makeBlips(CLHEP::RandFlat& flat, std::size_t nDeposits)
+  {
+    std::vector<sim::SimEnergyDeposit> deposits;
+    deposits.reserve(nDeposits);
+    for (std::size_t i = 0; i < nDeposits; ++i) {
+      geo::Point_t const pos = randomPoint(flat, 0.1);
+      double const time = flat.fire(-2.e6, 2.e6);
+      deposits.push_back(makeDeposit(pos, pos, flat.fire(0.05, 0.5), time, i + 1, 11));
+    }
+    return deposits;
+  } // makeBlips()
+
+  //----------------------------------------------------------------------------
+  // drift
+
+  /// Drift of deposits in the mock TPC, following `SimDriftElectrons`.
+  class MockDrift {
+  public:
+    /// Time per deposit histogram: bin `i` counts times below `2^i` ns.
+    static constexpr std::size_t NTimeBins = 24U;
+    using TimeHistogram_t = std::array<unsigned long long, NTimeBins>;
+
+    MockDrift()
+      : fPlanes(makePlanes())
+      , fDriftPhysics{ElectronLifetime,
+                      LongitudinalDiffusion,
+                      TransverseDiffusion,
+                      1.1 * DriftLength * RecipDriftVel[0],
+                      0.}
+      , fClusterDrift{RecipDriftVel, ElectronClusterSize, MinNumberOfElCluster}
+    {
+      raw::ChannelID_t nChannels = 0;
+      for (MockPlane const& plane : fPlanes)
+        nChannels += plane.channels.nWires();
+      fChannelIndex.assign(nChannels, NoChannel);
+    }
+
+    /**
+     * @brief Drifts all the `deposits`, from the random seed `seed`.
+     * @param batched whether to look the channels of the clusters up in batch
+     * @param timing if not null, filled with the time of each deposit
+     * @return the channels, in order of creation
+     */
+    std::vector<sim::SimChannel>
+    drift(std::vector<sim::SimEnergyDeposit> const& deposits,
+          long seed,
+          bool batched,
+          TimeHistogram_t* timing = nullptr)
+    {
+      using Clock_t = std::chrono::steady_clock;
+      CLHEP::MixMaxRng engine{seed};
+      CLHEP::RandGauss gauss{engine};
+      fChannels.clear();
+      fNClusters = 0ULL;
+      for (sim::SimEnergyDeposit const& deposit : deposits) {
+        if (!timing) {
+          driftDeposit(deposit, gauss, batched);
+          continue;
+        }
+        auto const start = Clock_t::now();
+        driftDeposit(deposit, gauss, batched);
+        double const ns = std::chrono::duration<double, std::nano>(Clock_t::now() - start).count();
+        std::size_t bin = 0;
+        while ((bin + 1 < NTimeBins) && (ns >= std::ldexp(1., bin)))
+          ++bin;
+        ++(*timing)[bin];
+      }
+      for (sim::SimChannel const& channel : fChannels)
+        fChannelIndex[channel.Channel()] = NoChannel;
+      return std::move(fChannels);
+    }
+
+    /// Electron clusters drifted in the last call to `drift()`.
+    unsigned long long
+    nClusters() const
+    {
+      return fNClusters;
+    }
+
+  private:
+    static constexpr std::size_t NoChannel = std::numeric_limits<std::size_t>::max();
+
+    std::vector<MockPlane> fPlanes;
+    larsim::Utils::DriftPhysicsTable fDriftPhysics;
+    larsim::Utils::ElectronClusterDrift fClusterDrift;
+
+    larsim::Utils::ElectronClusters fClusters;
+    std::vector<double> fClusterTime;
+    std::vector<double> fWireCoord;
+    std::vector<raw::ChannelID_t> fClusterChannel;
+
+    std::vector<sim::SimChannel> fChannels;
+    std::vector<std::size_t> fChannelIndex; ///< Index in `fChannels` of each channel.
+    unsigned long long fNClusters = 0ULL;
+
+    sim::SimChannel&
+    simChannel(raw::ChannelID_t channel)
+    {
+      std::size_t& index = fChannelIndex[channel];
+      if (index == NoChannel) {
+        index = fChannels.size();
+        fChannels.emplace_back(channel);
+      }
+      return fChannels[index];
+    }
+
+    void
+    driftDeposit(sim::SimEnergyDeposit const& deposit, CLHEP::RandGauss& gauss, bool batched)
+    {
+      auto const mp = deposit.MidPoint();
+      double const xyz[3] = {mp.X(), mp.Y(), mp.Z()};
+
+      // electrons drift towards decreasing x
+      double const TDrift = (xyz[0] - fPlanes.front().x) * RecipDriftVel[0];
+      if (TDrift < 0.) return;
+
+      int const nIonizedElectrons = deposit.NumElectrons();
+      if (nIonizedElectrons <= 0) return;
+      double const nElectrons = nIonizedElectrons * fDriftPhysics.attenuation(TDrift);
+      double const LDiffSig = fDriftPhysics.longitudinalSigma(TDrift);
+      double const TDiffSig = fDriftPhysics.transverseSigma(TDrift);
+
+      std::size_t const nClus = fClusterDrift.split(nElectrons, deposit.Energy(), fClusters);
+      fClusterDrift.diffuse(gauss, LDiffSig, TDiffSig, xyz[1], xyz[2], fClusters);
+      fNClusters += nClus;
+
+      fClusterTime.resize(nClus);
+      for (std::size_t k = 0; k < nClus; ++k)
+        fClusterTime[k] = TDrift + fClusters.longDiff[k] * RecipDriftVel[0];
+
+      double pos[3] = {0., 0., 0.};
+      for (MockPlane const& plane : fPlanes) {
+        larsim::Utils::PlaneChannelLookup const& lookup = plane.channels;
+        pos[0] = plane.x;
+        if (batched) {
+          double const coord0 = lookup.wireCoordinateOrigin() + lookup.wireCoordinateSlope(0) * pos[0];
+          double const slope1 = lookup.wireCoordinateSlope(1);
+          double const slope2 = lookup.wireCoordinateSlope(2);
+          fWireCoord.resize(nClus);
+          for (std::size_t k = 0; k < nClus; ++k)
+            fWireCoord[k] = coord0 + slope1 * fClusters.trans1[k] + slope2 * fClusters.trans2[k];
+          fClusterChannel.resize(nClus);
+          for (std::size_t k = 0; k < nClus; ++k)
+            fClusterChannel[k] = lookup.channelAtWireCoordinate(fWireCoord[k]);
+        }
+
+        for (std::size_t k = 0; k < nClus; ++k) {
+          pos[1] = fClusters.trans1[k];
+          pos[2] = fClusters.trans2[k];
+          raw::ChannelID_t const channel =
+            batched ? fClusterChannel[k] : lookup.nearestChannel(pos);
+          if (!raw::isValidChannelID(channel)) continue;
+
+          double const time = fClusterTime[k] + plane.timeOffset + deposit.Time();
+          auto const tdc = static_cast<unsigned int>((time + TriggerOffset) / TickPeriod);
+          simChannel(channel).AddIonizationElectrons(
+            deposit.TrackID(), tdc, fClusters.nElectrons[k], xyz, fClusters.energy[k]);
+        }
+      }
+    } // driftDeposit()
+  };  // class MockDrift
+
+  //----------------------------------------------------------------------------
+  // output summary
+
+  struct OutputSummary_t {
+    std::size_t channels = 0U;
+    unsigned long long ides = 0ULL;
+    double electrons = 0.;
+    std::uint64_t digest = 14695981039346656037ULL; ///< FNV-1a of the collection.
+
+    template <typename T>
+    void
+    hash(T value)
+    {
+      unsigned char bytes[sizeof(T)];
+      std::memcpy(bytes, &value, sizeof(T));
+      for (unsigned char const byte : bytes)
+        digest = (digest ^ byte) * 1099511628211ULL;
+    }
+  };
+
+  OutputSummary_t
+  summarize(std::vector<sim::SimChannel> const& channels)
+  {
+    OutputSummary_t summary;
+    summary.channels = channels.size();
+    for (sim::SimChannel const& channel : channels) {
+      summary.hash(channel.Channel());
+      for (auto const& [tdc, ides] : channel.TDCIDEMap()) {
+        summary.hash(tdc);
+        for (sim::IDE const& ide : ides) {
+          ++summary.ides;
+          summary.electrons += ide.numElectrons;
+          summary.hash(ide.trackID);
+          summary.hash(ide.numElectrons);
+          summary.hash(ide.energy);
+          summary.hash(ide.x);
+          summary.hash(ide.y);
+          summary.hash(ide.z);
+        }
+      }
+    }
+    return summary;
+  } // summarize()
+
+  //----------------------------------------------------------------------------
+  // benchmarks
+
+  /// Result of the benchmark of one stream.
+  struct BenchmarkResult_t {
+    std::string name;
+    std::size_t deposits = 0U;
+    unsigned long long clusters = 0ULL; ///< Per pass.
+    unsigned int passes = 0U;
+    double seconds = 0.; ///< Time of all the passes (without per-deposit timing).
+    MockDrift::TimeHistogram_t timeHistogram{};
+    OutputSummary_t output;
+    bool equivalent = false; ///< Whether the per-cluster lookup gives the same output.
+  };
+
+  BenchmarkResult_t
+  runBenchmark(std::string name,
+               std::vector<sim::SimEnergyDeposit> const& deposits,
+               MockDrift& drift,
+               double minTime)
+  {
+    constexpr long Seed = 24680L;
+    using Clock_t = std::chrono::steady_clock;
+    std::chrono::duration<double> const target{minTime};
+
+    BenchmarkResult_t result;
+    result.name = std::move(name);
+    result.deposits = deposits.size();
+
+    // reference output and equivalence check
+    std::vector<sim::SimChannel> const channels = drift.drift(deposits, Seed, true);
+    result.clusters = drift.nClusters();
+    result.output = summarize(channels);
+    result.equivalent =
+      (summarize(drift.drift(deposits, Seed, false)).digest == result.output.digest);
+
+    // throughput
+    auto const start = Clock_t::now();
+    Clock_t::duration elapsed{0};
+    do {
+      drift.drift(deposits, Seed, true);
+      ++result.passes;
+      elapsed = Clock_t::now() - start;
+    } while (elapsed < target);
+    result.seconds = std::chrono::duration<double>(elapsed).count();
+
+    // time per deposit, in a separate pass for the cost of the clock
+    drift.drift(deposits, Seed, true, &result.timeHistogram);
+
+    return result;
+  } // runBenchmark()
+
+  void
+  writeJSON(std::ostream& out, std::vector<BenchmarkResult_t> const& results)
+  {
+    out << "{\n  \"benchmarks\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      BenchmarkResult_t const& result = results[i];
+      double const perSecond = result.passes / result.seconds;
+      out << (i ? "," : "") << "\n    {\n      \"name\": \"" << result.name << "\""
+          << ",\n      \"deposits\": " << result.deposits
+          << ",\n      \"clusters\": " << result.clusters << ",\n      \"passes\": " << result.passes
+          << ",\n      \"deposits_per_second\": " << (result.deposits * perSecond)
+          << ",\n      \"clusters_per_second\": " << (result.clusters * perSecond)
+          << ",\n      \"deposit_time_histogram\": [";
+      bool first = true;
+      for (std::size_t bin = 0; bin < MockDrift::NTimeBins; ++bin) {
+        if (result.timeHistogram[bin] == 0) continue;
+        out << (first ? "" : ",") << " { \"below_ns\": " << std::ldexp(1., bin)
+            << ", \"deposits\": " << result.timeHistogram[bin] << " }";
+        first = false;
+      }
+      out << " ],\n      \"output\": { \"channels\": " << result.output.channels
+          << ", \"ides\": " << result.output.ides << ", \"electrons\": " << result.output.electrons
+          << ", \"digest\": \"" << std::hex << std::setw(16) << std::setfill('0')
+          << result.output.digest << std::dec << std::setfill(' ') << "\""
+          << ", \"equivalent\": " << (result.equivalent ? "true" : "false") << " }\n    }";
+    }
+    out << "\n  ]\n}\n";
+  } // writeJSON()
+
+} // local namespace
+
+//------------------------------------------------------------------------------
+int
+main(int argc, char** argv)
+{
+  double minTime = 0.1;
+  std::string jsonPath;
+  for (int iArg = 1; iArg < argc; ++iArg) {
+    std::string const arg = argv[iArg];
+    if (arg.rfind("--min-time=", 0) == 0)
+      minTime = std::stod(arg.substr(11));
+    else if (arg.rfind("--json=", 0) == 0)
+      jsonPath = arg.substr(7);
+    else {
+      std::cerr << "Unsupported argument: '" << arg << "'" << std::endl;
+      return 1;
+    }
+  } // for
+
+  constexpr std::size_t NDeposits = 20000U;
+  CLHEP::MixMaxRng engine{13579L};
+  CLHEP::RandFlat flat{engine};
+  MockDrift drift;
+
+  std::vector<BenchmarkResult_t> results;
+  results.push_back(runBenchmark("mip", makeMIPs(flat, NDeposits), drift, minTime));
+  results.push_back(runBenchmark("shower", makeShowers(flat, NDeposits), drift, minTime));
+  results.push_back(runBenchmark("blips", makeBlips(flat, NDeposits), drift, minTime));
+
+  if (jsonPath.empty())
+    writeJSON(std::cout, results);
+  else {
+    std::ofstream out{jsonPath};
+    writeJSON(out, results);
+    if (!out) {
+      std::cerr << "Failed to write '" << jsonPath << "'" << std::endl;
+      return 1;
+    }
+  }
+
+  int status = 0;
+  for (BenchmarkResult_t const& result : results) {
+    if (result.equivalent) continue;
+    std::cerr << "Stream '" << result.name
+              << "': the batched and per-cluster channel lookups give different channels"
+              << std::endl;
+    status = 1;
+  }
+  return status;
+} // main()
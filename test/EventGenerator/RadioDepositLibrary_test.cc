@@ -0,0 +1,83 @@
+/**
+ * @file    RadioDepositLibrary_test.cc
+ * @brief   Unit test for `evgen::RadioDepositLibrary`.
+ * @see     `larsim/EventGenerator/RadioDepositLibrary.h`
+ */
+
+// Boost libraries
+#define BOOST_TEST_MODULE ( RadioDepositLibrary_test )
+#include <cetlib/quiet_unit_test.hpp> // BOOST_AUTO_TEST_CASE()
+#include <boost/test/test_tools.hpp> // BOOST_CHECK()
+
+// LArSoft libraries
+#include "larsim/EventGenerator/RadioDepositLibrary.h"
+#include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h"
+
+// ROOT libraries
+#include "TTree.h"
+
+// C/C++ standard libraries
+#include <vector>
+
+//------------------------------------------------------------------------------
+sim::SimEnergyDeposit makeDeposit(int i) {
+  return {
+    10 * i, 20 * i, 0.5f, 0.1 * i,
+    geo::Point_t{ 1.0 * i, -2.0 * i, 0.5 * i },
+    geo::Point_t{ 1.5 * i, -2.5 * i, 1.0 * i },
+    2.0 * i, 2.5 * i, i + 1, 11
+    };
+} // makeDeposit()
+
+
+void checkSameDeposit
+  (sim::SimEnergyDeposit const& a, sim::SimEnergyDeposit const& b)
+{
+  BOOST_CHECK_EQUAL(a.NumPhotons(), b.NumPhotons());
+  BOOST_CHECK_EQUAL(a.NumElectrons(), b.NumElectrons());
+  BOOST_CHECK_CLOSE(a.ScintYieldRatio(), b.ScintYieldRatio(), 1e-4);
+  BOOST_CHECK_CLOSE(a.Energy(), b.Energy(), 1e-4);
+  BOOST_CHECK_CLOSE(a.StartX(), b.StartX(), 1e-4);
+  BOOST_CHECK_CLOSE(a.StartY(), b.StartY(), 1e-4);
+  BOOST_CHECK_CLOSE(a.StartZ(), b.StartZ(), 1e-4);
+  BOOST_CHECK_CLOSE(a.EndX(), b.EndX(), 1e-4);
+  BOOST_CHECK_CLOSE(a.EndY(), b.EndY(), 1e-4);
+  BOOST_CHECK_CLOSE(a.EndZ(), b.EndZ(), 1e-4);
+  BOOST_CHECK_CLOSE(a.StartT(), b.StartT(), 1e-4);
+  BOOST_CHECK_CLOSE(a.EndT(), b.EndT(), 1e-4);
+  BOOST_CHECK_EQUAL(a.TrackID(), b.TrackID());
+  BOOST_CHECK_EQUAL(a.PdgCode(), b.PdgCode());
+} // checkSameDeposit()
+
+
+//------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE(RoundTrip_test) {
+
+  evgen::RadioDepositLibrary library;
+  BOOST_CHECK(library.empty());
+
+  library.addCluster({ makeDeposit(1), makeDeposit(2), makeDeposit(3) });
+  library.addCluster({});
+  library.addCluster({ makeDeposit(4) });
+  BOOST_CHECK_EQUAL(library.size(), 3U);
+  BOOST_CHECK_EQUAL(library.nDeposits(), 4U);
+  BOOST_CHECK_EQUAL(library.end(0) - library.begin(0), 3);
+  BOOST_CHECK(library.begin(1) == library.end(1));
+
+  TTree tree("39Ar", "test library");
+  tree.SetDirectory(nullptr);
+  library.write(tree);
+  BOOST_CHECK_EQUAL(tree.GetEntries(), 3);
+
+  evgen::RadioDepositLibrary const readBack { tree };
+  BOOST_CHECK_EQUAL(readBack.size(), library.size());
+  BOOST_CHECK_EQUAL(readBack.nDeposits(), library.nDeposits());
+  for (std::size_t i = 0; i < library.size(); ++i) {
+    BOOST_CHECK_EQUAL
+      (readBack.end(i) - readBack.begin(i), library.end(i) - library.begin(i));
+    auto b = readBack.begin(i);
+    for (auto a = library.begin(i); a != library.end(i); ++a, ++b)
+      checkSameDeposit(*a, *b);
+  } // for
+
+} // BOOST_AUTO_TEST_CASE(RoundTrip_test)
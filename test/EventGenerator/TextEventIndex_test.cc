@@ -0,0 +1,97 @@
+/**
+ * @file    TextEventIndex_test.cc
+ * @brief   Unit test for `evgen::TextEventIndex`.
+ * @see     `larsim/EventGenerator/TextEventIndex.h`
+ */
+
+// Boost libraries
+#define BOOST_TEST_MODULE ( TextEventIndex_test )
+#include <cetlib/quiet_unit_test.hpp> // BOOST_AUTO_TEST_CASE()
+#include <boost/test/test_tools.hpp> // BOOST_CHECK()
+
+// LArSoft libraries
+#include "larsim/EventGenerator/TextEventIndex.h"
+
+// framework libraries
+#include "cetlib_except/exception.h"
+
+// C/C++ standard libraries
+#include <cstdio> // std::remove()
+#include <fstream>
+#include <sstream>
+#include <string>
+
+
+//------------------------------------------------------------------------------
+void TextEventIndex_test() {
+
+  // three HEPEVT events; the particle line of the second one looks like a header
+  std::string const text =
+    "0 1\n"
+    "1 13 0 0 0 0 0. 0. 1.0 5.0011 0.105 1.0 1.0 1.0 0.0\n"
+    "1 1\n"
+    "7 2\n"
+    "\n"
+    "2 2\n"
+    "1 13 0 0 0 0 0. 0. 1.0 5.0011 0.105 1.0 1.0 1.0 0.0\n"
+    "1 13 0 0 0 0 0. 0. 1.0 5.0011 0.105 1.0 1.0 1.0 0.0";
+
+  auto const format = evgen::TextEventIndex::hepevtFormat();
+  std::istringstream in { text };
+  evgen::TextEventIndex index;
+  index.build(in, format);
+  BOOST_CHECK_EQUAL(index.nEvents(), 3U);
+  BOOST_CHECK_EQUAL(index.offset(0U), 0U);
+  BOOST_CHECK_EQUAL(index.offset(1U), text.find("1 1\n"));
+  BOOST_CHECK_EQUAL(index.offset(2U), text.find("2 2\n"));
+  BOOST_CHECK_THROW(index.offset(3U), cet::exception);
+
+  // GENIE dumps: one event per "** Event:" line
+  std::string const dumpText =
+    "header\n"
+    "|  ** Event: 0 ...\n"
+    "| 1 particle\n"
+    "|  ** Event: 1 ...\n";
+  std::istringstream dump { dumpText };
+  evgen::TextEventIndex dumpIndex;
+  dumpIndex.build(dump, evgen::TextEventIndex::genieDumpFormat());
+  BOOST_CHECK_EQUAL(dumpIndex.nEvents(), 2U);
+  BOOST_CHECK_EQUAL(dumpIndex.offset(1U), dumpText.find("|  ** Event: 1"));
+
+  // sidecar file: built and saved the first time, then read back;
+  // it is not used after the input file changes
+  std::string const inputName = "TextEventIndex_test.txt";
+  std::string const indexName = evgen::TextEventIndex::defaultIndexFileName(inputName);
+  std::remove(indexName.c_str());
+  std::ofstream(inputName) << text << "\n";
+  evgen::TextEventIndex fromFile;
+  BOOST_CHECK(fromFile.prepare(inputName, "", format, true)
+              == evgen::TextEventIndex::Origin::Written);
+  BOOST_CHECK_EQUAL(fromFile.nEvents(), 3U);
+  evgen::TextEventIndex again;
+  BOOST_CHECK(again.prepare(inputName, "", format, true)
+              == evgen::TextEventIndex::Origin::Read);
+  BOOST_CHECK_EQUAL(again.nEvents(), 3U);
+  BOOST_CHECK_EQUAL(again.offset(2U), index.offset(2U));
+  BOOST_CHECK(!again.readFile(indexName, "other key"));
+  BOOST_CHECK_EQUAL(again.nEvents(), 3U);
+
+  std::ofstream(inputName) << "0 0\n" << text << "\n";
+  BOOST_CHECK(again.prepare(inputName, "", format, false)
+              == evgen::TextEventIndex::Origin::Built);
+  BOOST_CHECK_EQUAL(again.nEvents(), 4U);
+  std::remove(inputName.c_str());
+  std::remove(indexName.c_str());
+
+  BOOST_CHECK_THROW(again.prepare(inputName, "", format, false), cet::exception);
+
+} // TextEventIndex_test()
+
+
+//------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(TextEventIndex_TestCase) {
+  TextEventIndex_test();
+} // BOOST_AUTO_TEST_CASE(TextEventIndex_TestCase)
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,128 @@
+/**
+ * @file    TruthColumns_test.cc
+ * @brief   Unit test for the truth columns of `larsim/MCDumpers/TruthColumns.h`.
+ * @see     `larsim/MCDumpers/TruthColumns.h`
+ */
+
+// Boost libraries
+#define BOOST_TEST_MODULE ( TruthColumns_test )
+#include <cetlib/quiet_unit_test.hpp> // BOOST_AUTO_TEST_CASE()
+#include <boost/test/test_tools.hpp> // BOOST_CHECK()
+
+// LArSoft libraries
+#include "larsim/MCDumpers/TruthColumns.h"
+#include "lardataobj/Simulation/SimChannel.h"
+#include "lardataobj/Simulation/SimEnergyDeposit.h"
+
+// C/C++ standard libraries
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+void SimChannelColumns_test() {
+
+  std::vector<sim::SimChannel> channels;
+  for (unsigned int channel = 0; channel < 200; ++channel) {
+    sim::SimChannel sc { 3 * channel + 1 };
+    for (unsigned int i = 0; i < channel % 4; ++i) { // some channels empty
+      double const xyz[3] = { 0.5 * channel, -1.0 * i, 2.0 };
+      sc.AddIonizationElectrons(
+        int(channel % 7) + 1, 100 + 10 * (i % 2), 50.0 + i, xyz, 0.2 * i
+        );
+    }
+    channels.push_back(std::move(sc));
+  }
+
+  sim::SimChannelColumns serial, parallel;
+  serial.fill(channels);
+  parallel.fill(channels, true);
+
+  std::size_t nIDEs = 0;
+  for (sim::SimChannel const& sc: channels)
+    for (auto const& TDCinfo: sc.TDCIDEMap()) nIDEs += TDCinfo.second.size();
+  BOOST_CHECK_EQUAL(serial.size(), nIDEs);
+
+  // rows in the order of the channels, then of their TDCs
+  std::size_t row = 0;
+  for (sim::SimChannel const& sc: channels) {
+    for (auto const& TDCinfo: sc.TDCIDEMap()) {
+      for (sim::IDE const& ide: TDCinfo.second) {
+        BOOST_TEST_CONTEXT("row #" << row) {
+          BOOST_CHECK_EQUAL(serial.channel[row], sc.Channel());
+          BOOST_CHECK_EQUAL(serial.tdc[row], TDCinfo.first);
+          BOOST_CHECK_EQUAL(serial.trackID[row], ide.trackID);
+          BOOST_CHECK_EQUAL(serial.numElectrons[row], ide.numElectrons);
+          BOOST_CHECK_EQUAL(serial.x[row], ide.x);
+        }
+        ++row;
+      }
+    }
+  }
+
+  BOOST_CHECK(serial.channel == parallel.channel);
+  BOOST_CHECK(serial.tdc == parallel.tdc);
+  BOOST_CHECK(serial.trackID == parallel.trackID);
+  BOOST_CHECK(serial.origTrackID == parallel.origTrackID);
+  BOOST_CHECK(serial.numElectrons == parallel.numElectrons);
+  BOOST_CHECK(serial.energy == parallel.energy);
+  BOOST_CHECK(serial.x == parallel.x);
+  BOOST_CHECK(serial.y == parallel.y);
+  BOOST_CHECK(serial.z == parallel.z);
+
+  // refilling replaces the content
+  parallel.fill({}, true);
+  BOOST_CHECK_EQUAL(parallel.size(), 0U);
+  BOOST_CHECK(parallel.x.empty());
+
+} // SimChannelColumns_test()
+
+
+//------------------------------------------------------------------------------
+void EnergyDepositColumns_test() {
+
+  std::vector<sim::SimEnergyDeposit> deposits;
+  for (int deposit = 0; deposit < 1000; ++deposit) {
+    double const t0 = 10.0 + 0.5 * deposit;
+    deposits.emplace_back(
+      100 + deposit, 50 + deposit, 0.25, 0.01 * deposit,
+      geo::Point_t{ 0.1 * deposit, 1.0, -2.0 },
+      geo::Point_t{ 0.1 * deposit + 0.05, 1.0, -2.0 },
+      t0, t0 + 0.1, deposit % 13, (deposit % 2) ? 13 : 11
+      );
+  }
+
+  sim::EnergyDepositColumns serial, parallel;
+  serial.fill(deposits);
+  parallel.fill(deposits, true);
+
+  BOOST_CHECK_EQUAL(serial.size(), deposits.size());
+  for (std::size_t i = 0; i < deposits.size(); ++i) {
+    BOOST_TEST_CONTEXT("deposit #" << i) {
+      BOOST_CHECK_EQUAL(serial.trackID[i], deposits[i].TrackID());
+      BOOST_CHECK_EQUAL(serial.pdgCode[i], deposits[i].PdgCode());
+      BOOST_CHECK_EQUAL(serial.numPhotons[i], deposits[i].NumPhotons());
+      BOOST_CHECK_EQUAL(serial.startT[i], deposits[i].T0());
+      BOOST_CHECK_EQUAL(serial.endX[i], float(deposits[i].EndX()));
+    }
+  }
+
+  BOOST_CHECK(serial.trackID == parallel.trackID);
+  BOOST_CHECK(serial.numElectrons == parallel.numElectrons);
+  BOOST_CHECK(serial.energy == parallel.energy);
+  BOOST_CHECK(serial.startX == parallel.startX);
+  BOOST_CHECK(serial.endT == parallel.endT);
+
+} // EnergyDepositColumns_test()
+
+
+//------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(SimChannelColumns_TestCase) {
+  SimChannelColumns_test();
+} // BOOST_AUTO_TEST_CASE(SimChannelColumns_TestCase)
+
+BOOST_AUTO_TEST_CASE(EnergyDepositColumns_TestCase) {
+  EnergyDepositColumns_test();
+} // BOOST_AUTO_TEST_CASE(EnergyDepositColumns_TestCase)
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,104 @@
+/**
+ * @file    InterpolationAxis_test.cc
+ * @brief   Unit test for `phot::InterpolationAxis`.
+ * @see     `larsim/PhotonPropagation/InterpolationAxis.h`
+ */
+
+// Boost libraries
+#define BOOST_TEST_MODULE ( InterpolationAxis_test )
+#include <cetlib/quiet_unit_test.hpp> // BOOST_AUTO_TEST_CASE()
+#include <boost/test/test_tools.hpp> // BOOST_CHECK()
+
+// LArSoft libraries
+#include "larsim/PhotonPropagation/InterpolationAxis.h"
+
+// framework libraries
+#include "cetlib_except/exception.h"
+
+// C/C++ standard libraries
+#include <cmath> // std::sin()
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+// the interval and interpolation of the original linear search implementation
+std::size_t linearSearchInterval(std::vector<double> const& xData, double x) {
+  std::size_t const size = xData.size();
+  if (x >= xData[size - 2]) return size - 2;
+  std::size_t i = 0;
+  while (x > xData[i + 1]) ++i;
+  return i;
+}
+
+double linearSearchInterpolate
+  (std::vector<double> const& xData, std::vector<double> const& yData, double x, bool extrapolate)
+{
+  std::size_t const i = linearSearchInterval(xData, x);
+  double const xL = xData[i], xR = xData[i + 1], yL = yData[i], yR = yData[i + 1];
+  if (!extrapolate && ((x < xL) || (x > xR))) return yL;
+  double const dydx = (yR - yL) / (xR - xL);
+  return yL + dydx * (x - xL);
+}
+
+
+//------------------------------------------------------------------------------
+void checkAxis(std::vector<double> const& nodes, bool expectedUniform) {
+
+  phot::InterpolationAxis const axis { nodes };
+  BOOST_CHECK_EQUAL(axis.size(), nodes.size());
+  BOOST_CHECK_EQUAL(axis.isUniform(), expectedUniform);
+
+  std::vector<double> values;
+  for (std::size_t i = 0; i < nodes.size(); ++i) values.push_back(std::sin(1.3 * i));
+
+  // the nodes themselves, points close to them, and points outside the axis
+  std::vector<double> points;
+  for (double const node: nodes) {
+    for (double const delta: { -1e-9, 0.0, 1e-9, 0.25, 0.5 }) points.push_back(node + delta);
+  }
+  points.push_back(nodes.front() - 10.0);
+  points.push_back(nodes.back() + 10.0);
+
+  for (double const x: points) {
+    BOOST_TEST_CONTEXT("x=" << x) {
+      BOOST_CHECK_EQUAL(axis.interval(x), linearSearchInterval(nodes, x));
+      for (bool const extrapolate: { true, false }) {
+        BOOST_CHECK_EQUAL(axis.interpolate(values.data(), x, extrapolate),
+                          linearSearchInterpolate(nodes, values, x, extrapolate));
+      }
+    }
+  } // for points
+
+  // interleaved values
+  std::vector<double> interleaved;
+  for (double const value: values) {
+    interleaved.push_back(value);
+    interleaved.push_back(-2.0 * value);
+  }
+  double const x = 0.5 * (nodes[0] + nodes[1]);
+  BOOST_CHECK_EQUAL(axis.interpolate(interleaved.data() + 1, x, false, 2),
+                    -2.0 * axis.interpolate(values.data(), x, false));
+
+} // checkAxis()
+
+
+void InterpolationAxis_test() {
+
+  checkAxis({ 0.0, 25.0, 50.0, 75.0, 100.0, 125.0 }, true);
+  checkAxis({ -1.0, -0.9, -0.8, -0.7, -0.6, -0.5, -0.4, -0.3 }, true); // steps not exact
+  checkAxis({ 0.0, 1.0 }, true);
+  checkAxis({ 0.0, 5.0, 15.0, 30.0, 100.0, 300.0, 301.0 }, false);
+
+  BOOST_CHECK_THROW(phot::InterpolationAxis({ 1.0 }), cet::exception);
+  BOOST_CHECK_THROW(phot::InterpolationAxis({ 1.0, 2.0, 2.0 }), cet::exception);
+
+} // InterpolationAxis_test()
+
+
+//------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(InterpolationAxis_TestCase) {
+  InterpolationAxis_test();
+} // BOOST_AUTO_TEST_CASE(InterpolationAxis_TestCase)
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,203 @@
+/**
+ * @file    OpticalPhotonTracer_test.cc
+ * @brief   Unit test for `phot::OpticalPhotonTracer`.
+ * @see     `larsim/PhotonPropagation/OpticalPhotonTracer.h`
+ *
+ * The tracer is run on simple geometries where the detected fraction of the
+ * photons is known analytically.
+ */
+
+// Boost libraries
+#define BOOST_TEST_MODULE ( OpticalPhotonTracer_test )
+#include <cetlib/quiet_unit_test.hpp> // BOOST_AUTO_TEST_CASE()
+#include <boost/test/test_tools.hpp> // BOOST_CHECK_SMALL()
+
+// LArSoft libraries
+#include "larsim/PhotonPropagation/OpticalPhotonTracer.h"
+
+// ROOT
+#include "TGeoManager.h"
+#include "TGeoMatrix.h"
+#include "TGeoMaterial.h"
+#include "TGeoMedium.h"
+#include "TGeoNode.h"
+#include "TGeoVolume.h"
+
+// CLHEP
+#include "CLHEP/Random/MixMaxRng.h"
+#include "CLHEP/Random/RandFlat.h"
+
+// C/C++ standard libraries
+#include <cmath>
+#include <memory>
+#include <string>
+
+
+//------------------------------------------------------------------------------
+namespace {
+
+  constexpr unsigned int NPhotons = 100000;
+  constexpr double PhotonEnergy = 9.7; // eV (128 nm)
+
+  /// Builds a world of steel with a 2 m wide cube of LAr at its centre.
+  std::unique_ptr<TGeoManager> makeGeometry(TGeoVolume*& lar) {
+    auto manager = std::make_unique<TGeoManager>("OpticalPhotonTracer_test", "test geometry");
+    auto const steel = new TGeoMedium("Steel", 1, new TGeoMaterial("Steel", 55.85, 26., 7.87));
+    auto const argon = new TGeoMedium("LAr", 2, new TGeoMaterial("LAr", 39.95, 18., 1.39));
+    TGeoVolume* world = manager->MakeBox("volWorld", steel, 200., 200., 200.);
+    manager->SetTopVolume(world);
+    lar = manager->MakeBox("volLAr", argon, 100., 100., 100.);
+    world->AddNode(lar, 1);
+    return manager;
+  }
+
+  /// Material of the optical detector volumes.
+  TGeoMedium* detectorMedium() {
+    return new TGeoMedium("Glass", 3, new TGeoMaterial("Glass", 20., 10., 2.2));
+  }
+
+  /// Optical detector finder: every `volOpDet` volume is detector `0`.
+  int findOpDet(geo::Point_t const&, TGeoNode const& node) {
+    return (std::string(node.GetVolume()->GetName()) == "volOpDet")? 0: -1;
+  }
+
+  struct Counts_t {
+    unsigned int direct = 0;
+    unsigned int reflected = 0;
+  };
+
+  /// Traces `NPhotons` isotropic photons from the centre of the geometry.
+  Counts_t traceFromCentre(phot::OpticalPhotonTracer const& tracer) {
+    phot::OpticalPhotonTracer::Navigator navigator{ tracer.manager() };
+    CLHEP::MixMaxRng engine{ 12345 };
+    CLHEP::RandFlat flat{ engine };
+    Counts_t counts;
+    for (unsigned int i = 0; i < NPhotons; ++i) {
+      double const cosTheta = 2.0 * flat.fire() - 1.0;
+      double const sinTheta = std::sqrt(1.0 - cosTheta * cosTheta);
+      double const phi = 2.0 * M_PI * flat.fire();
+      geo::Vector_t const dir
+        { sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta };
+      auto const detection
+        = tracer.trace(navigator, geo::origin(), dir, PhotonEnergy, engine);
+      if (detection.opDet < 0) continue;
+      ++(detection.reflected? counts.reflected: counts.direct);
+    }
+    return counts;
+  }
+
+  /// Tolerance on the fraction `p` of `NPhotons` (5 standard deviations).
+  double tolerance(double p)
+    { return 5.0 * std::sqrt(p * (1.0 - p) / NPhotons); }
+
+} // local namespace
+
+
+//------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE(SolidAngle_test) {
+  // detector slab covering the +z side of the LAr cube, no optical processes:
+  // the detected fraction is the solid angle of its face
+  TGeoVolume* lar = nullptr;
+  auto manager = makeGeometry(lar);
+  lar->AddNode
+    (manager->MakeBox("volOpDet", detectorMedium(), 100., 100., 1.), 1,
+     new TGeoTranslation(0., 0., 99.));
+  manager->CloseGeometry();
+
+  phot::OpticalPhotonTracer::Config_t config;
+  config.media["LAr"] = {};
+  phot::OpticalPhotonTracer const tracer{ *manager, config, findOpDet };
+
+  Counts_t const counts = traceFromCentre(tracer);
+
+  // square of half side a at distance d: 4 asin(a^2 / (a^2 + d^2)) / (4 pi)
+  double const a = 100.0, d = 98.0;
+  double const expected = std::asin(a * a / (a * a + d * d)) / M_PI;
+  BOOST_TEST(counts.reflected == 0U);
+  BOOST_CHECK_SMALL(double(counts.direct) / NPhotons - expected, tolerance(expected));
+} // BOOST_AUTO_TEST_CASE(SolidAngle_test)
+
+
+//------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE(Absorption_test) {
+  // spherical detector shell of radius 50 cm around the source
+  TGeoVolume* lar = nullptr;
+  auto manager = makeGeometry(lar);
+  lar->AddNode
+    (manager->MakeSphere("volOpDet", detectorMedium(), 50., 51.), 1);
+  manager->CloseGeometry();
+
+  phot::OpticalPhotonTracer::Config_t config;
+  config.media["LAr"].absorptionLength = { { 9.0, 100.0 }, { 10.5, 100.0 } };
+  phot::OpticalPhotonTracer const tracer{ *manager, config, findOpDet };
+
+  Counts_t const counts = traceFromCentre(tracer);
+
+  double const expected = std::exp(-50.0 / 100.0);
+  BOOST_CHECK_SMALL(double(counts.direct) / NPhotons - expected, tolerance(expected));
+} // BOOST_AUTO_TEST_CASE(Absorption_test)
+
+
+//------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE(Scattering_test) {
+  // without absorption, scattered photons still all reach the detector shell
+  TGeoVolume* lar = nullptr;
+  auto manager = makeGeometry(lar);
+  lar->AddNode
+    (manager->MakeSphere("volOpDet", detectorMedium(), 50., 51.), 1);
+  manager->CloseGeometry();
+
+  phot::OpticalPhotonTracer::Config_t config;
+  config.media["LAr"].rayleighLength = { { 9.7, 30.0 } };
+  phot::OpticalPhotonTracer const tracer{ *manager, config, findOpDet };
+
+  Counts_t const counts = traceFromCentre(tracer);
+
+  BOOST_TEST(counts.direct == NPhotons);
+  BOOST_TEST(counts.reflected == 0U);
+} // BOOST_AUTO_TEST_CASE(Scattering_test)
+
+
+//------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE(Reflection_test) {
+  // mirror walls: all the photons end up in the detector slab on the +z side
+  TGeoVolume* lar = nullptr;
+  auto manager = makeGeometry(lar);
+  lar->AddNode
+    (manager->MakeBox("volOpDet", detectorMedium(), 100., 100., 1.), 1,
+     new TGeoTranslation(0., 0., 99.));
+  manager->CloseGeometry();
+
+  phot::OpticalPhotonTracer::Config_t config;
+  config.media["LAr"] = {};
+  config.surfaces["Steel"].reflectance = { { 9.7, 1.0 } };
+  phot::OpticalPhotonTracer const tracer{ *manager, config, findOpDet };
+
+  Counts_t const counts = traceFromCentre(tracer);
+
+  // photons almost parallel to the slab may bounce for too long
+  BOOST_TEST(double(counts.direct) / NPhotons >= 0.999);
+} // BOOST_AUTO_TEST_CASE(Reflection_test)
+
+
+//------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE(WavelengthShifting_test) {
+  // a shifting medium: only the photons reaching the shell unshifted are direct
+  TGeoVolume* lar = nullptr;
+  auto manager = makeGeometry(lar);
+  lar->AddNode
+    (manager->MakeSphere("volOpDet", detectorMedium(), 50., 51.), 1);
+  manager->CloseGeometry();
+
+  phot::OpticalPhotonTracer::Config_t config;
+  config.media["LAr"].wlsAbsorptionLength = { { 9.7, 10.0 } };
+  config.wlsEmission = { { 2.95, 1.0 } }; // 420 nm
+  phot::OpticalPhotonTracer const tracer{ *manager, config, findOpDet };
+
+  Counts_t const counts = traceFromCentre(tracer);
+
+  double const expected = std::exp(-50.0 / 10.0);
+  BOOST_TEST(counts.direct + counts.reflected == NPhotons);
+  BOOST_CHECK_SMALL(double(counts.direct) / NPhotons - expected, tolerance(expected));
+} // BOOST_AUTO_TEST_CASE(WavelengthShifting_test)
+
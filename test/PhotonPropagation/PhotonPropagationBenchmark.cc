@@ -0,0 +1,231 @@
+/**
+ * @file    PhotonPropagationBenchmark.cc
+ * @brief   Timing of the hot paths of the photon propagation simulation.
+ *
+ * Usage: `larsim_bench_photon [--min-time=<seconds>] [--json=<file>]`
+ *
+ * Each benchmark runs on a synthetic library (no detector geometry is needed)
+ * for at least the requested time (default: 0.1 s); the results are written
+ * as a JSON object to standard output, or to the specified file.
+ *
+ * The `PDFastSimPVS` deposit benchmark reproduces the per-deposit work of the
+ * module (visibility row, photon counts per channel, emission times) without
+ * the framework: it is meant to catch regressions in the building blocks, not
+ * to replace a profile of a full job.
+ */
+
+// LArSoft libraries
+#include "larsim/PhotonPropagation/PhotonLibrary.h"
+#include "larsim/PhotonPropagation/ScintTimeTools/ScintTimeLAr.h"
+#include "larsim/PhotonPropagation/VisibilityInterpolation.h"
+#include "larsim/Simulation/PhotonVoxels.h"
+#include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h" // geo::Point_t
+
+// framework libraries
+#include "fhiclcpp/ParameterSet.h"
+
+// CLHEP libraries
+#include "CLHEP/Random/MixMaxRng.h"
+#include "CLHEP/Random/RandFlat.h"
+#include "CLHEP/Random/RandPoissonQ.h"
+
+// C/C++ standard libraries
+#include <array>
+#include <chrono>
+#include <cstddef> // std::size_t
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility> // std::move()
+#include <vector>
+
+namespace {
+
+  // synthetic detector: 2 m x 4 m x 10 m in 10 cm voxels, 120 channels
+  constexpr std::size_t NOpChannels = 120U;
+  sim::PhotonVoxelDef const VoxelDef{-100., 100., 20, -200., 200., 40, -500., 500., 100};
+
+  // locations of the energy deposits (fixed sequence, spread over the volume)
+  constexpr std::size_t NPoints = 4096U;
+
+  /// Result of one benchmark.
+  struct BenchmarkResult_t {
+    std::string name;
+    unsigned long long iterations = 0ULL;
+    double nsPerIteration = 0.0;
+  };
+
+  /// Accumulator used to keep the compiler from dropping the benchmarked code.
+  double volatile gSink = 0.0;
+
+  /// Calls `step(i)` with increasing `i` for at least `minTime` seconds.
+  template <typename Step>
+  BenchmarkResult_t
+  runBenchmark(std::string name, double minTime, Step step)
+  {
+    using Clock_t = std::chrono::steady_clock;
+    std::chrono::duration<double> const target{minTime};
+
+    BenchmarkResult_t result;
+    result.name = std::move(name);
+    double sum = 0.0;
+    auto const start = Clock_t::now();
+    Clock_t::duration elapsed{0};
+    do {
+      for (unsigned int i = 0; i < 256U; ++i)
+        sum += step(result.iterations++);
+      elapsed = Clock_t::now() - start;
+    } while (elapsed < target);
+    gSink = gSink + sum;
+
+    result.nsPerIteration =
+      std::chrono::duration<double, std::nano>(elapsed).count() / result.iterations;
+    return result;
+  } // runBenchmark()
+
+  /// Fills a library with a smooth, channel-dependent visibility.
+  void
+  fillLibrary(phot::PhotonLibrary& library)
+  {
+    library.CreateEmptyLibrary(VoxelDef.GetNVoxels(), NOpChannels);
+    for (std::size_t voxel = 0; voxel < VoxelDef.GetNVoxels(); ++voxel) {
+      for (std::size_t channel = 0; channel < NOpChannels; ++channel)
+        library.SetCount(voxel, channel, 1e-4f * float((voxel * 7U + channel * 13U) % 101U));
+    }
+  } // fillLibrary()
+
+  std::vector<geo::Point_t>
+  makePoints()
+  {
+    CLHEP::MixMaxRng engine{12345L};
+    CLHEP::RandFlat flat{engine};
+    std::vector<geo::Point_t> points;
+    points.reserve(NPoints);
+    for (std::size_t i = 0; i < NPoints; ++i)
+      points.emplace_back(flat.fire(-99., 99.), flat.fire(-199., 199.), flat.fire(-499., 499.));
+    return points;
+  } // makePoints()
+
+  void
+  writeJSON(std::ostream& out, std::vector<BenchmarkResult_t> const& results)
+  {
+    out << "{\n  \"benchmarks\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      BenchmarkResult_t const& result = results[i];
+      out << (i ? "," : "") << "\n    { \"name\": \"" << result.name << "\""
+          << ", \"iterations\": " << result.iterations
+          << ", \"ns_per_iteration\": " << result.nsPerIteration << " }";
+    }
+    out << "\n  ]\n}\n";
+  } // writeJSON()
+
+} // local namespace
+
+//------------------------------------------------------------------------------
+int
+main(int argc, char** argv)
+{
+  double minTime = 0.1;
+  std::string jsonPath;
+  for (int iArg = 1; iArg < argc; ++iArg) {
+    std::string const arg = argv[iArg];
+    if (arg.rfind("--min-time=", 0) == 0)
+      minTime = std::stod(arg.substr(11));
+    else if (arg.rfind("--json=", 0) == 0)
+      jsonPath = arg.substr(7);
+    else {
+      std::cerr << "Unsupported argument: '" << arg << "'" << std::endl;
+      return 1;
+    }
+  } // for
+
+  phot::PhotonLibrary library;
+  fillLibrary(library);
+  std::vector<geo::Point_t> const points = makePoints();
+
+  fhicl::ParameterSet scintConfig;
+  scintConfig.put("LogLevel", 0);
+  scintConfig.put("FastDecayTime", 6.0);
+  scintConfig.put("SlowDecayTime", 1590.0);
+  phot::ScintTimeLAr scintTime{scintConfig};
+
+  fhicl::ParameterSet scintRiseConfig{scintConfig};
+  scintRiseConfig.put("FastRisingTime", 0.0);
+  scintRiseConfig.put("SlowRisingTime", 490.0);
+  phot::ScintTimeLAr scintTimeRise{scintRiseConfig};
+
+  CLHEP::MixMaxRng engine{54321L};
+  CLHEP::RandPoissonQ poisson{engine};
+  std::vector<double> times;
+
+  std::vector<BenchmarkResult_t> results;
+
+  results.push_back(runBenchmark("PhotonVoxelDef::GetVoxelID", minTime, [&](std::size_t i) {
+    return VoxelDef.GetVoxelID(points[i % NPoints]);
+  }));
+
+  results.push_back(runBenchmark("PhotonLibrary::GetCounts", minTime, [&](std::size_t i) {
+    float const* counts = library.GetCounts(VoxelDef.GetVoxelID(points[i % NPoints]));
+    double sum = 0.0;
+    for (std::size_t channel = 0; channel < NOpChannels; ++channel)
+      sum += counts[channel];
+    return sum;
+  }));
+
+  std::vector<float> interpolated(NOpChannels);
+  std::vector<float> rowBuffer;
+  results.push_back(
+    runBenchmark("PhotonLibrary::CopyCounts (interpolated)", minTime, [&](std::size_t i) {
+      std::array<sim::PhotonVoxelDef::NeiInfo, phot::NInterpolationNeighbours> neis;
+      if (!VoxelDef.GetNeighboringVoxelIDs(points[i % NPoints], neis)) return 0.0;
+      std::array<int, phot::NInterpolationNeighbours> voxels;
+      std::array<float, phot::NInterpolationNeighbours> weights;
+      for (std::size_t k = 0; k < phot::NInterpolationNeighbours; ++k) {
+        voxels[k] = neis[k].id;
+        weights[k] = static_cast<float>(neis[k].weight);
+      }
+      phot::blendLibraryRows(
+        interpolated.data(), voxels, weights, NOpChannels, NOpChannels,
+        [&library](int voxel, float* dest) { return library.CopyCounts(voxel, dest); },
+        rowBuffer);
+      return double(interpolated[i % NOpChannels]);
+    }));
+
+  results.push_back(runBenchmark("ScintTimeLAr::GenScintTime", minTime, [&](std::size_t i) {
+    scintTime.GenScintTime(i % 3U == 0U, engine);
+    return scintTime.GetScintTime();
+  }));
+
+  results.push_back(
+    runBenchmark("ScintTimeLAr::GenScintTime (rise time)", minTime, [&](std::size_t) {
+      scintTimeRise.GenScintTime(false, engine);
+      return scintTimeRise.GetScintTime();
+    }));
+
+  // one deposit of 24000 photons (about 1 MeV), as in PDFastSimPVS
+  results.push_back(runBenchmark("PDFastSimPVS deposit", minTime, [&](std::size_t i) {
+    constexpr double NPhotons = 24000.;
+    float const* visibilities = library.GetCounts(VoxelDef.GetVoxelID(points[i % NPoints]));
+    double sum = 0.0;
+    for (std::size_t channel = 0; channel < NOpChannels; ++channel) {
+      auto const nDetected = static_cast<std::size_t>(poisson.fire(visibilities[channel] * NPhotons));
+      if (nDetected == 0U) continue;
+      times.resize(nDetected);
+      scintTime.GenScintTimes(true, times.data(), nDetected, engine);
+      sum += times.front();
+    }
+    return sum;
+  }));
+
+  if (jsonPath.empty())
+    writeJSON(std::cout, results);
+  else {
+    std::ofstream out{jsonPath};
+    writeJSON(out, results);
+    if (!out) {
+      std::cerr << "Failed to write '" << jsonPath << "'" << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+} // main()
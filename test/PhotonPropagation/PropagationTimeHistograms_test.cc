@@ -0,0 +1,103 @@
+/**
+ * @file    PropagationTimeHistograms_test.cc
+ * @brief   Unit test for `phot::PropagationTimeHistograms`.
+ * @see     `larsim/PhotonPropagation/PropagationTimeHistograms.h`
+ */
+
+// Boost libraries
+#define BOOST_TEST_MODULE ( PropagationTimeHistograms_test )
+#include <cetlib/quiet_unit_test.hpp> // BOOST_AUTO_TEST_CASE()
+#include <boost/test/test_tools.hpp> // BOOST_CHECK()
+
+// LArSoft libraries
+#include "larsim/PhotonPropagation/PropagationTimeHistograms.h"
+
+// framework libraries
+#include "cetlib_except/exception.h"
+
+// C/C++ standard libraries
+#include <cstdio> // std::remove()
+#include <string>
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+void PropagationTimeHistograms_test() {
+
+  // 2 voxels, 3 channels, 4 bins, 2 distance classes
+  std::vector<float> const edges
+    { 10.0, 11.0, 12.0, 14.0, 20.0,    30.0, 32.0, 34.0, 40.0, 60.0 };
+  phot::PropagationTimeHistograms histograms { 2U, 3U, 4U, edges };
+  BOOST_CHECK_EQUAL(histograms.nBins(), 4U);
+  BOOST_CHECK_EQUAL(histograms.nClasses(), 2U);
+  BOOST_CHECK_EQUAL(histograms.nEntries(), 6U);
+  for (std::size_t entry = 0; entry < 6U; ++entry)
+    BOOST_CHECK(!histograms.isDefined(entry));
+
+  double const content[] = { 1.0, 0.0, 2.0, 1.0 };
+  histograms.setEntry(1U, 0U, content);
+  double const tiny[] = { 1000.0, 1e-6, 0.0, 1e-6 };
+  histograms.setEntry(4U, 1U, tiny);
+  double const empty[] = { 0.0, 0.0, 0.0, 0.0 };
+  histograms.setEntry(5U, 1U, empty);
+
+  BOOST_CHECK(histograms.isDefined(1U));
+  BOOST_CHECK(!histograms.voxel(0U)[0].isValid());
+  BOOST_CHECK(!histograms.voxel(1U)[0].isValid());
+
+  // limits and quantiles of the piecewise linear cumulative function
+  phot::PropagationTimeHistogram const hist = histograms.voxel(0U)[1];
+  BOOST_CHECK(hist.isValid());
+  BOOST_CHECK_CLOSE(hist.sample(0.0), 10.0, 1e-6);
+  BOOST_CHECK_CLOSE(hist.sample(1.0), 20.0, 1e-6);
+  BOOST_CHECK_CLOSE(hist.sample(0.125), 10.5, 1.0);
+  BOOST_CHECK_CLOSE(hist.sample(0.5), 13.0, 1.0);
+  BOOST_CHECK_CLOSE(hist.sample(0.875), 17.0, 1.0);
+  double previous = hist.sample(0.0);
+  for (int i = 1; i <= 100; ++i) {
+    double const t = hist.sample(i / 100.0);
+    BOOST_CHECK_GE(t, previous);
+    previous = t;
+  }
+
+  // small bins are not lost in the quantisation, empty ones stay empty
+  phot::PropagationTimeHistogram const tinyHist = histograms.histogram(4U);
+  BOOST_CHECK_LT(tinyHist.sample(0.99), 32.0);
+  BOOST_CHECK_GT(tinyHist.sample(1.0), 40.0);
+
+  // no content: the same probability in each bin
+  BOOST_CHECK_CLOSE(histograms.histogram(5U).sample(0.5), 34.0, 1.0);
+
+  // file round trip, and rejection of a different key or size
+  std::string const fileName = "PropagationTimeHistograms_test.bin";
+  histograms.writeFile(fileName, "test library");
+  phot::PropagationTimeHistograms copy { 2U, 3U, 4U, std::vector<float>(5U, 0.0f) };
+  BOOST_CHECK(!copy.readFile(fileName, "other library"));
+  BOOST_CHECK(!copy.isDefined(1U));
+  phot::PropagationTimeHistograms other { 3U, 3U, 4U, std::vector<float>(5U, 0.0f) };
+  BOOST_CHECK(!other.readFile(fileName, "test library"));
+  BOOST_CHECK(copy.readFile(fileName, "test library"));
+  BOOST_CHECK_EQUAL(copy.nClasses(), 2U);
+  for (std::size_t entry = 0; entry < 6U; ++entry) {
+    BOOST_CHECK_EQUAL(copy.isDefined(entry), histograms.isDefined(entry));
+    if (!copy.isDefined(entry)) continue;
+    for (double const u: { 0.0, 0.3, 0.7, 1.0 })
+      BOOST_CHECK_EQUAL(copy.voxel(entry / 3U)[entry % 3U].sample(u),
+                        histograms.histogram(entry).sample(u));
+  }
+  std::remove(fileName.c_str());
+
+  BOOST_CHECK_THROW(phot::PropagationTimeHistograms(1U, 1U, 4U, std::vector<float>(6U)),
+                    cet::exception);
+  BOOST_CHECK_THROW(phot::PropagationTimeHistograms(1U, 1U, 0U, {}), cet::exception);
+
+} // PropagationTimeHistograms_test()
+
+
+//------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(PropagationTimeHistograms_TestCase) {
+  PropagationTimeHistograms_test();
+} // BOOST_AUTO_TEST_CASE(PropagationTimeHistograms_TestCase)
+
+//------------------------------------------------------------------------------
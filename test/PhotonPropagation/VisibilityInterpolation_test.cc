@@ -0,0 +1,156 @@
+/**
+ * @file    VisibilityInterpolation_test.cc
+ * @brief   Unit test for `phot::blendVisibilityRows()` and `phot::blendLibraryRows()`.
+ * @see     `larsim/PhotonPropagation/VisibilityInterpolation.h`
+ */
+
+// Boost libraries
+#define BOOST_TEST_MODULE ( VisibilityInterpolation_test )
+#include <cetlib/quiet_unit_test.hpp> // BOOST_AUTO_TEST_CASE()
+#include <boost/test/test_tools.hpp> // BOOST_CHECK()
+
+// LArSoft libraries
+#include "larsim/PhotonPropagation/IPhotonLibrary.h"
+#include "larsim/PhotonPropagation/PhotonLibraryQuantized.h"
+#include "larsim/PhotonPropagation/VisibilityInterpolation.h"
+
+// C/C++ standard libraries
+#include <array>
+#include <cmath> // std::abs()
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+void blendVisibilityRows_test() {
+
+  // row sizes not multiple of any vector width, to exercise the remainders
+  for (std::size_t const n: { 0U, 1U, 7U, 8U, 17U, 37U, 300U }) {
+
+    std::array<std::vector<float>, phot::NInterpolationNeighbours> data;
+    std::array<float const*, phot::NInterpolationNeighbours> rows;
+    std::array<float, phot::NInterpolationNeighbours> const weights
+      { 0.1f, 0.2f, 0.0f, 0.15f, 0.05f, 0.3f, 0.12f, 0.08f };
+    for (std::size_t k = 0; k < phot::NInterpolationNeighbours; ++k) {
+      data[k].resize(n);
+      for (std::size_t i = 0; i < n; ++i)
+        data[k][i] = 1e-3f * float((i + 1) * (k + 3) % 97);
+      rows[k] = data[k].data();
+    }
+    rows[6] = nullptr; // a missing neighbour
+
+    std::vector<float> out(n, -1.0f);
+    phot::blendVisibilityRows(out.data(), rows, weights, n);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      double expected = 0.0;
+      for (std::size_t k = 0; k < phot::NInterpolationNeighbours; ++k) {
+        if (!rows[k]) continue;
+        expected += double(weights[k]) * data[k][i];
+      }
+      BOOST_TEST_CONTEXT("n=" << n << " i=" << i) {
+        BOOST_CHECK(std::abs(out[i] - expected) <= 1e-6 * (1.0 + expected));
+      }
+    } // for i
+
+  } // for n
+
+} // blendVisibilityRows_test()
+
+
+//------------------------------------------------------------------------------
+/// Library with all its rows in memory, direct light only.
+class TestLibrary: public phot::IPhotonLibrary {
+    public:
+  TestLibrary(std::size_t nVoxels, std::size_t nChannels)
+    : fNChannels(nChannels), fCounts(nVoxels * nChannels)
+    {
+      // different rows, with zero runs, to exercise the sparse storage
+      for (std::size_t v = 0; v < nVoxels; ++v) {
+        for (std::size_t c = 0; c < nChannels; ++c) {
+          fCounts[v * nChannels + c]
+            = ((c + v) % 5 == 0)? 0.0f: 1e-4f * float((v + 1) * (c + 2) % 89 + 1);
+        }
+      }
+    }
+
+  virtual float GetCount(size_t Voxel, size_t OpChannel) const override
+    { return fCounts[Voxel * fNChannels + OpChannel]; }
+  virtual float GetReflCount(size_t, size_t) const override { return 0.0f; }
+  virtual float GetReflT0(size_t, size_t) const override { return 0.0f; }
+
+  virtual Counts_t GetCounts(size_t Voxel) const override
+    { return isVoxelValid(Voxel)? fCounts.data() + Voxel * fNChannels: nullptr; }
+  virtual Counts_t GetReflCounts(size_t) const override { return nullptr; }
+  virtual T0s_t GetReflT0s(size_t) const override { return nullptr; }
+
+  virtual bool hasReflected() const override { return false; }
+  virtual bool hasReflectedT0() const override { return false; }
+
+  virtual int NOpChannels() const override { return fNChannels; }
+  virtual int NVoxels() const override { return fCounts.size() / fNChannels; }
+
+    private:
+  std::size_t fNChannels;
+  std::vector<float> fCounts;
+}; // class TestLibrary
+
+
+void blendLibraryRows_test(phot::PhotonLibraryQuantized::Encoding encoding) {
+
+  std::size_t const nChannels = 37U;
+  TestLibrary const source { 20U, nChannels };
+  phot::PhotonLibraryQuantized const library { source, encoding };
+
+  // the quantized library decodes all the rows into the same buffer:
+  // each row must be copied as it is fetched
+  std::array<int, phot::NInterpolationNeighbours> const voxels
+    { 3, 4, 8, 9, -1, 14, 18, 19 };
+  std::array<float, phot::NInterpolationNeighbours> const weights
+    { 0.1f, 0.2f, 0.15f, 0.05f, 0.3f, 0.12f, 0.0f, 0.08f };
+
+  std::vector<float> buffer;
+  std::vector<float> out(nChannels, -1.0f);
+  phot::blendLibraryRows(out.data(), voxels, weights, nChannels, library.NOpChannels(),
+    [&library](int voxel, float* dest){ return library.CopyCounts(voxel, dest); },
+    buffer);
+
+  for (std::size_t c = 0; c < nChannels; ++c) {
+    double expected = 0.0;
+    for (std::size_t k = 0; k < phot::NInterpolationNeighbours; ++k) {
+      if (voxels[k] < 0) continue;
+      expected += double(weights[k]) * library.GetCount(voxels[k], c);
+    }
+    BOOST_TEST_CONTEXT("channel=" << c) {
+      BOOST_CHECK(std::abs(out[c] - expected) <= 1e-6 * (1.0 + expected));
+    }
+  } // for c
+
+  // a voxel out of the library contributes nothing
+  std::array<int, phot::NInterpolationNeighbours> const outside
+    { 3, 100, -1, -1, -1, -1, -1, -1 };
+  std::array<float, phot::NInterpolationNeighbours> const halves
+    { 0.5f, 0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+  phot::blendLibraryRows(out.data(), outside, halves, nChannels, library.NOpChannels(),
+    [&library](int voxel, float* dest){ return library.CopyCounts(voxel, dest); },
+    buffer);
+  for (std::size_t c = 0; c < nChannels; ++c) {
+    BOOST_TEST_CONTEXT("channel=" << c) {
+      BOOST_CHECK_CLOSE(out[c], 0.5f * library.GetCount(3, c), 1e-4);
+    }
+  }
+
+} // blendLibraryRows_test()
+
+
+//------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(blendVisibilityRows_TestCase) {
+  blendVisibilityRows_test();
+} // BOOST_AUTO_TEST_CASE(blendVisibilityRows_TestCase)
+
+BOOST_AUTO_TEST_CASE(blendLibraryRows_TestCase) {
+  blendLibraryRows_test(phot::PhotonLibraryQuantized::Encoding::Log16);
+  blendLibraryRows_test(phot::PhotonLibraryQuantized::Encoding::Log8);
+} // BOOST_AUTO_TEST_CASE(blendLibraryRows_TestCase)
+
+//------------------------------------------------------------------------------
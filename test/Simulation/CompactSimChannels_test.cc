@@ -0,0 +1,86 @@
+/**
+ * @file    CompactSimChannels_test.cc
+ * @brief   Unit test for `sim::CompactSimChannels`.
+ * @see     `larsim/Simulation/CompactSimChannels.h`
+ */
+
+// Boost libraries
+#define BOOST_TEST_MODULE ( CompactSimChannels_test )
+#include <cetlib/quiet_unit_test.hpp> // BOOST_AUTO_TEST_CASE()
+#include <boost/test/test_tools.hpp> // BOOST_CHECK()
+
+// LArSoft libraries
+#include "larsim/Simulation/CompactSimChannels.h"
+#include "lardataobj/Simulation/SimChannel.h"
+
+// C/C++ standard libraries
+#include <cmath> // std::abs()
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+void CompactSimChannels_test() {
+
+  double const resolution = 0.01; // cm
+
+  std::vector<sim::SimChannel> channels;
+  for (raw::ChannelID_t const channel: { 12U, 3U, 40U }) {
+    sim::SimChannel& sc = channels.emplace_back(channel);
+    for (int deposit = 0; deposit < 30; ++deposit) {
+      int const trackID = ((deposit % 4) - 1) * (1 + deposit % 3); // includes negative IDs
+      unsigned int const tdc = 100U * channel + 7U * (deposit % 11);
+      double const xyz[3]
+        = { 0.37 * deposit, 150.0 - 11.3 * deposit, 0.013 * channel * deposit };
+      sc.AddIonizationElectrons
+        (trackID, tdc, 100.0 + deposit, xyz, 0.02 * deposit, trackID + 1);
+    } // for deposit
+  } // for channel
+  channels.emplace_back(7U); // an empty channel
+
+  sim::CompactSimChannels const compact
+    = sim::makeCompactSimChannels(channels, resolution);
+  BOOST_CHECK_EQUAL(compact.nChannels(), channels.size());
+
+  std::vector<sim::SimChannel> const expanded = sim::expandSimChannels(compact);
+
+  BOOST_CHECK_EQUAL(expanded.size(), channels.size());
+  for (std::size_t iChannel = 0; iChannel < expanded.size(); ++iChannel) {
+    sim::SimChannel const& sc = expanded[iChannel];
+    sim::SimChannel const& expSC = channels[iChannel];
+    double const step = compact.positionStep[iChannel];
+    BOOST_TEST_CONTEXT("channel #" << iChannel) {
+      BOOST_CHECK_EQUAL(sc.Channel(), expSC.Channel());
+      BOOST_CHECK(step >= resolution);
+      auto const& tdcs = sc.TDCIDEMap();
+      auto const& expTDCs = expSC.TDCIDEMap();
+      BOOST_CHECK_EQUAL(tdcs.size(), expTDCs.size());
+      if (tdcs.size() != expTDCs.size()) continue;
+      for (std::size_t iTDC = 0; iTDC < tdcs.size(); ++iTDC) {
+        BOOST_CHECK_EQUAL(tdcs[iTDC].first, expTDCs[iTDC].first);
+        auto const& ides = tdcs[iTDC].second;
+        auto const& expIDEs = expTDCs[iTDC].second;
+        BOOST_CHECK_EQUAL(ides.size(), expIDEs.size());
+        if (ides.size() != expIDEs.size()) continue;
+        for (std::size_t iIDE = 0; iIDE < ides.size(); ++iIDE) {
+          BOOST_CHECK_EQUAL(ides[iIDE].trackID, expIDEs[iIDE].trackID);
+          BOOST_CHECK_EQUAL(ides[iIDE].origTrackID, expIDEs[iIDE].origTrackID);
+          BOOST_CHECK_EQUAL(ides[iIDE].numElectrons, expIDEs[iIDE].numElectrons);
+          BOOST_CHECK(std::abs(ides[iIDE].energy - expIDEs[iIDE].energy) < 1e-6);
+          BOOST_CHECK(std::abs(ides[iIDE].x - expIDEs[iIDE].x) < 0.5001 * step + 1e-4);
+          BOOST_CHECK(std::abs(ides[iIDE].y - expIDEs[iIDE].y) < 0.5001 * step + 1e-4);
+          BOOST_CHECK(std::abs(ides[iIDE].z - expIDEs[iIDE].z) < 0.5001 * step + 1e-4);
+        }
+      } // for TDCs
+    }
+  } // for channels
+
+} // CompactSimChannels_test()
+
+
+//------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(CompactSimChannels_TestCase) {
+  CompactSimChannels_test();
+} // BOOST_AUTO_TEST_CASE(CompactSimChannels_TestCase)
+
+//------------------------------------------------------------------------------
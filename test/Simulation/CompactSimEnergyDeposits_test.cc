@@ -0,0 +1,94 @@
+/**
+ * @file    CompactSimEnergyDeposits_test.cc
+ * @brief   Unit test for `sim::CompactSimEnergyDeposits`.
+ * @see     `larsim/Simulation/CompactSimEnergyDeposits.h`
+ */
+
+// Boost libraries
+#define BOOST_TEST_MODULE ( CompactSimEnergyDeposits_test )
+#include <cetlib/quiet_unit_test.hpp> // BOOST_AUTO_TEST_CASE()
+#include <boost/test/test_tools.hpp> // BOOST_CHECK()
+
+// LArSoft libraries
+#include "larsim/Simulation/CompactSimEnergyDeposits.h"
+#include "lardataobj/Simulation/SimEnergyDeposit.h"
+
+// C/C++ standard libraries
+#include <cmath> // std::abs()
+#include <set>
+#include <utility> // std::pair
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+void CompactSimEnergyDeposits_test() {
+
+  double const resolution = 0.1; // ns
+
+  std::vector<sim::SimEnergyDeposit> deposits;
+  for (int deposit = 0; deposit < 40; ++deposit) {
+    int const trackID = ((deposit / 3) % 5) - 1; // includes negative IDs
+    int const pdgCode = (deposit % 7 == 0) ? 11 : 13;
+    double const t0 = 1.6e6 - 3.7 * deposit + 0.013 * deposit * deposit;
+    deposits.emplace_back(
+      1000 + 7 * deposit,                                     // photons
+      500 + 3 * deposit,                                      // electrons
+      0.1 + 0.01 * deposit,                                   // yield ratio
+      0.02 * deposit,                                         // energy
+      geo::Point_t{ 0.37 * deposit, 150.0 - 11.3 * deposit, 0.013 * deposit },
+      geo::Point_t{ 0.37 * deposit + 0.03, 150.0 - 11.3 * deposit, 0.013 * deposit - 0.04 },
+      t0, t0 + 0.001 * deposit,
+      trackID, pdgCode
+      );
+  } // for deposit
+
+  sim::CompactSimEnergyDeposits const compact
+    = sim::makeCompactSimEnergyDeposits(deposits, resolution);
+  BOOST_CHECK_EQUAL(compact.nDeposits(), deposits.size());
+  BOOST_CHECK(compact.timeStep >= resolution);
+  std::set<std::pair<int, int>> tracks;
+  for (sim::SimEnergyDeposit const& edep: deposits)
+    tracks.emplace(edep.TrackID(), edep.PdgCode());
+  BOOST_CHECK_EQUAL(compact.trackID.size(), tracks.size());
+
+  std::vector<sim::SimEnergyDeposit> const expanded
+    = sim::expandSimEnergyDeposits(compact);
+
+  BOOST_CHECK_EQUAL(expanded.size(), deposits.size());
+  if (expanded.size() != deposits.size()) return;
+  for (std::size_t i = 0; i < expanded.size(); ++i) {
+    sim::SimEnergyDeposit const& edep = expanded[i];
+    sim::SimEnergyDeposit const& expEdep = deposits[i];
+    BOOST_TEST_CONTEXT("deposit #" << i) {
+      BOOST_CHECK_EQUAL(edep.TrackID(), expEdep.TrackID());
+      BOOST_CHECK_EQUAL(edep.PdgCode(), expEdep.PdgCode());
+      BOOST_CHECK_EQUAL(edep.NumPhotons(), expEdep.NumPhotons());
+      BOOST_CHECK_EQUAL(edep.NumElectrons(), expEdep.NumElectrons());
+      BOOST_CHECK(std::abs(edep.ScintYieldRatio() - expEdep.ScintYieldRatio()) < 1e-6);
+      BOOST_CHECK(std::abs(edep.Energy() - expEdep.Energy()) < 1e-6);
+      BOOST_CHECK(std::abs(edep.StartX() - expEdep.StartX()) < 1e-4);
+      BOOST_CHECK(std::abs(edep.StartY() - expEdep.StartY()) < 1e-4);
+      BOOST_CHECK(std::abs(edep.StartZ() - expEdep.StartZ()) < 1e-4);
+      BOOST_CHECK(std::abs(edep.EndX() - expEdep.EndX()) < 1e-4);
+      BOOST_CHECK(std::abs(edep.EndY() - expEdep.EndY()) < 1e-4);
+      BOOST_CHECK(std::abs(edep.EndZ() - expEdep.EndZ()) < 1e-4);
+      BOOST_CHECK(std::abs(edep.T0() - expEdep.T0()) < 0.5001 * compact.timeStep);
+      BOOST_CHECK(
+        std::abs((edep.T1() - edep.T0()) - (expEdep.T1() - expEdep.T0())) < 1e-4);
+    }
+  } // for deposits
+
+  // an empty collection
+  BOOST_CHECK(sim::expandSimEnergyDeposits
+    (sim::makeCompactSimEnergyDeposits({}, resolution)).empty());
+
+} // CompactSimEnergyDeposits_test()
+
+
+//------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(CompactSimEnergyDeposits_TestCase) {
+  CompactSimEnergyDeposits_test();
+} // BOOST_AUTO_TEST_CASE(CompactSimEnergyDeposits_TestCase)
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,181 @@
+/**
+ * @file    DerivedDataCache_test.cc
+ * @brief   Unit test for `sim::DerivedDataCache`.
+ * @see     `larsim/Simulation/DerivedDataCache.h`
+ */
+
+// Boost libraries
+#define BOOST_TEST_MODULE ( DerivedDataCache_test )
+#include <cetlib/quiet_unit_test.hpp> // BOOST_AUTO_TEST_CASE()
+#include <boost/test/test_tools.hpp> // BOOST_CHECK()
+
+// LArSoft libraries
+#include "larsim/Simulation/DerivedDataCache.h"
+
+// C/C++ standard libraries
+#include <cstdint> // std::uintptr_t
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h> // ::getpid()
+
+
+//------------------------------------------------------------------------------
+namespace {
+
+  std::filesystem::path testDirectory(std::string const& name) {
+    std::filesystem::path const dir = std::filesystem::temp_directory_path()
+      / ("DerivedDataCache_test_" + std::to_string(::getpid()) + "_" + name);
+    std::filesystem::remove_all(dir);
+    return dir;
+  }
+
+} // local namespace
+
+
+//------------------------------------------------------------------------------
+void BuildOnce_test() {
+
+  auto const dir = testDirectory("build");
+  sim::DerivedDataCache const cache { dir.string() };
+
+  unsigned int nBuilds = 0;
+  auto const builder = [&nBuilds](std::ostream& out){ ++nBuilds; out << "payload"; };
+
+  {
+    auto const view = cache.getOrBuild("Table", "key A", builder);
+    BOOST_CHECK(view.isMapped());
+    BOOST_CHECK_EQUAL(view.bytes(), "payload");
+    BOOST_CHECK_EQUAL(
+      reinterpret_cast<std::uintptr_t>(view.data())
+        % sim::DerivedDataCache::PayloadAlignment,
+      0U
+      );
+  }
+  BOOST_CHECK_EQUAL(nBuilds, 1U);
+
+  // found in the cache: not built again
+  auto const view = cache.getOrBuild("Table", "key A", builder);
+  BOOST_CHECK_EQUAL(view.bytes(), "payload");
+  BOOST_CHECK_EQUAL(nBuilds, 1U);
+  BOOST_CHECK(cache.find("Table", "key A").isMapped());
+
+  // a different key is a different entry
+  BOOST_CHECK(!cache.find("Table", "key B").isMapped());
+  cache.getOrBuild("Table", "key B", builder);
+  BOOST_CHECK_EQUAL(nBuilds, 2U);
+
+  // the view survives the removal of the entry
+  std::filesystem::remove_all(dir);
+  BOOST_CHECK_EQUAL(view.bytes(), "payload");
+
+  BOOST_CHECK_THROW(cache.getOrBuild("bad/name", "key", builder), std::exception);
+
+} // BuildOnce_test()
+
+
+//------------------------------------------------------------------------------
+void InvalidEntry_test() {
+
+  auto const dir = testDirectory("invalid");
+  sim::DerivedDataCache const cache { dir.string() };
+
+  cache.getOrBuild("Table", "key", [](std::ostream& out){ out << "0123456789"; });
+  std::string const path = cache.entryPath("Table", "key");
+
+  // a truncated entry is replaced
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+  BOOST_CHECK(!cache.find("Table", "key").isMapped());
+  auto const view
+    = cache.getOrBuild("Table", "key", [](std::ostream& out){ out << "rebuilt"; });
+  BOOST_CHECK_EQUAL(view.bytes(), "rebuilt");
+
+  // an entry with another key (as from a digest collision) is not used
+  std::filesystem::copy_file(path, cache.entryPath("Table", "other key"));
+  BOOST_CHECK(!cache.find("Table", "other key").isMapped());
+
+  // a failed build leaves nothing behind
+  BOOST_CHECK_THROW(
+    cache.getOrBuild("Failed", "key",
+      [](std::ostream& out){ out << "partial"; throw std::runtime_error("failed"); }),
+    std::runtime_error
+    );
+  BOOST_CHECK(!std::filesystem::exists(cache.entryPath("Failed", "key")));
+
+  std::filesystem::remove_all(dir);
+
+} // InvalidEntry_test()
+
+
+//------------------------------------------------------------------------------
+void Eviction_test() {
+
+  auto const dir = testDirectory("evict");
+  sim::DerivedDataCache const cache { dir.string(), 5000 };
+
+  std::string const payload(2000, 'x');
+  auto const builder = [&payload](std::ostream& out){ out << payload; };
+
+  cache.getOrBuild("Table", "first", builder);
+  std::filesystem::last_write_time(cache.entryPath("Table", "first"),
+    std::filesystem::file_time_type::clock::now() - std::chrono::hours{2});
+  cache.getOrBuild("Table", "second", builder);
+  std::filesystem::last_write_time(cache.entryPath("Table", "second"),
+    std::filesystem::file_time_type::clock::now() - std::chrono::hours{1});
+
+  // "first" is used, "second" is then the least recently used
+  BOOST_CHECK(cache.find("Table", "first").isMapped());
+  cache.getOrBuild("Table", "third", builder);
+
+  BOOST_CHECK(cache.find("Table", "first").isMapped());
+  BOOST_CHECK(!cache.find("Table", "second").isMapped());
+  BOOST_CHECK(cache.find("Table", "third").isMapped());
+
+  std::filesystem::remove_all(dir);
+
+} // Eviction_test()
+
+
+//------------------------------------------------------------------------------
+void Unwritable_test() {
+
+  // a directory that cannot be created (its parent is a file)
+  auto const dir = testDirectory("unwritable");
+  std::filesystem::create_directories(dir);
+  std::ofstream{dir / "file"} << "not a directory";
+  sim::DerivedDataCache const cache { (dir / "file" / "cache").string() };
+
+  auto view
+    = cache.getOrBuild("Table", "key", [](std::ostream& out){ out << "in memory"; });
+  BOOST_CHECK(!view.isMapped());
+  BOOST_CHECK_EQUAL(view.bytes(), "in memory");
+
+  // the payload follows the view
+  sim::DerivedDataCache::View moved { std::move(view) };
+  BOOST_CHECK_EQUAL(moved.bytes(), "in memory");
+
+  std::filesystem::remove_all(dir);
+
+} // Unwritable_test()
+
+
+//------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(BuildOnce_TestCase) {
+  BuildOnce_test();
+} // BOOST_AUTO_TEST_CASE(BuildOnce_TestCase)
+
+BOOST_AUTO_TEST_CASE(InvalidEntry_TestCase) {
+  InvalidEntry_test();
+} // BOOST_AUTO_TEST_CASE(InvalidEntry_TestCase)
+
+BOOST_AUTO_TEST_CASE(Eviction_TestCase) {
+  Eviction_test();
+} // BOOST_AUTO_TEST_CASE(Eviction_TestCase)
+
+BOOST_AUTO_TEST_CASE(Unwritable_TestCase) {
+  Unwritable_test();
+} // BOOST_AUTO_TEST_CASE(Unwritable_TestCase)
+
+//------------------------------------------------------------------------------
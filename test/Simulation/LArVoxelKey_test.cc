@@ -0,0 +1,77 @@
+/**
+ * @file    LArVoxelKey_test.cc
+ * @brief   Unit test for `sim::LArVoxelKey`.
+ * @see     `larsim/Simulation/LArVoxelKey.h`
+ */
+
+// Boost libraries
+#define BOOST_TEST_MODULE ( LArVoxelKey_test )
+#include <cetlib/quiet_unit_test.hpp> // BOOST_AUTO_TEST_CASE()
+#include <boost/test/test_tools.hpp> // BOOST_CHECK()
+
+// LArSoft libraries
+#include "larsim/Simulation/LArVoxelKey.h"
+
+// C/C++ standard libraries
+#include <array>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+void LArVoxelKey_test() {
+
+  using Key = sim::LArVoxelKey;
+
+  // bins around zero and at the limits of each axis
+  std::vector<std::array<int, 4U>> bins;
+  for (int const x: { -65536, -1, 0, 1, 65535 })
+    for (int const y: { -65536, -7, 0, 3, 65535 })
+      for (int const z: { -262144, -2, 0, 5, 262143 })
+        for (int const t: { -1024, -1, 0, 1, 1023 })
+          bins.push_back({{ x, y, z, t }});
+
+  std::unordered_set<Key> keys;
+  for (auto const& b: bins) {
+    BOOST_TEST_CONTEXT("bins (" << b[0] << "," << b[1] << "," << b[2] << "," << b[3] << ")") {
+      BOOST_CHECK(Key::IsRepresentable(b[0], b[1], b[2], b[3]));
+      Key const key { b[0], b[1], b[2], b[3] };
+      BOOST_CHECK_EQUAL(key.XBin(), b[0]);
+      BOOST_CHECK_EQUAL(key.YBin(), b[1]);
+      BOOST_CHECK_EQUAL(key.ZBin(), b[2]);
+      BOOST_CHECK_EQUAL(key.TBin(), b[3]);
+      BOOST_CHECK(Key::FromValue(key.Value()) == key);
+      keys.insert(key);
+    }
+  }
+  BOOST_CHECK_EQUAL(keys.size(), bins.size());
+
+  // the packed order is the order of LArVoxelID: by t, z, x, then y
+  for (auto const& a: bins) {
+    for (auto const& b: { bins[17], bins[312], bins[401], bins[624] }) {
+      bool const expected = std::tie(a[3], a[2], a[0], a[1]) < std::tie(b[3], b[2], b[0], b[1]);
+      BOOST_CHECK_EQUAL(Key(a[0], a[1], a[2], a[3]) < Key(b[0], b[1], b[2], b[3]), expected);
+    }
+  }
+
+  BOOST_CHECK(Key() == Key(0, 0, 0, 0));
+  BOOST_CHECK(Key(1, 2, 3, 4) != Key(2, 1, 3, 4));
+
+  BOOST_CHECK(!Key::IsRepresentable(65536, 0, 0, 0));
+  BOOST_CHECK(!Key::IsRepresentable(0, -65537, 0, 0));
+  BOOST_CHECK(!Key::IsRepresentable(0, 0, 262144, 0));
+  BOOST_CHECK(!Key::IsRepresentable(0, 0, 0, -1025));
+
+  static_assert(Key(3, -4, 5, -6).ZBin() == 5, "LArVoxelKey is not usable at compile time");
+
+} // LArVoxelKey_test()
+
+
+//------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(LArVoxelKey_TestCase) {
+  LArVoxelKey_test();
+} // BOOST_AUTO_TEST_CASE(LArVoxelKey_TestCase)
+
+//------------------------------------------------------------------------------
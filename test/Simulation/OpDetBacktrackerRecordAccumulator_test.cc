@@ -0,0 +1,90 @@
+/**
+ * @file    OpDetBacktrackerRecordAccumulator_test.cc
+ * @brief   Unit test for `sim::OpDetBacktrackerRecordAccumulator`.
+ * @see     `larsim/Simulation/OpDetBacktrackerRecordAccumulator.h`
+ */
+
+// Boost libraries
+#define BOOST_TEST_MODULE ( OpDetBacktrackerRecordAccumulator_test )
+#include <cetlib/quiet_unit_test.hpp> // BOOST_AUTO_TEST_CASE()
+#include <boost/test/test_tools.hpp> // BOOST_CHECK()
+
+// LArSoft libraries
+#include "larsim/Simulation/OpDetBacktrackerRecordAccumulator.h"
+
+// C/C++ standard libraries
+#include <cmath> // std::abs()
+#include <map>
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+void OpDetBacktrackerRecordAccumulator_test() {
+
+  // the records made photon by photon, as the producers used to
+  std::vector<sim::OpDetBacktrackerRecord> expected;
+  std::map<int, std::size_t> expectedIndex;
+
+  sim::OpDetBacktrackerRecordAccumulator accumulator, other;
+
+  for (int deposit = 0; deposit < 40; ++deposit) {
+    int const trackID = 1 + deposit % 3;
+    double const xyz[3] = { 1.0 * deposit, 2.0 - deposit, 0.5 * (deposit % 7) };
+    // half of the deposits go to another accumulator, merged at the end
+    auto& dest = (deposit < 20)? accumulator: other;
+    for (int const opDet: { 4, 1, 6 }) {
+      auto const [ it, inserted ] = expectedIndex.try_emplace(opDet, expected.size());
+      if (inserted) expected.emplace_back(opDet);
+      for (int photon = 0; photon < (deposit + opDet) % 5; ++photon) {
+        double const time = 10.0 * ((deposit * 3 + photon) % 7);
+        expected[it->second].AddScintillationPhotons(trackID, time, 1.0, xyz, 0.25);
+        dest.addPhotons(opDet, trackID, time, 1.0, xyz, 0.25);
+      }
+      dest.addRecord(opDet);
+    } // for opDet
+  } // for deposit
+
+  accumulator.merge(other);
+  BOOST_CHECK(other.empty());
+
+  std::vector<sim::OpDetBacktrackerRecord> const records = accumulator.yield();
+  BOOST_CHECK(accumulator.empty());
+
+  BOOST_CHECK_EQUAL(records.size(), expected.size());
+  for (std::size_t iRecord = 0; iRecord < records.size(); ++iRecord) {
+    sim::OpDetBacktrackerRecord const& record = records[iRecord];
+    sim::OpDetBacktrackerRecord const& expRecord = expected[iRecord];
+    BOOST_TEST_CONTEXT("record #" << iRecord) {
+      BOOST_CHECK_EQUAL(record.OpDetNum(), expRecord.OpDetNum());
+      auto const& times = record.timePDclockSDPsMap();
+      auto const& expTimes = expRecord.timePDclockSDPsMap();
+      BOOST_CHECK_EQUAL(times.size(), expTimes.size());
+      if (times.size() != expTimes.size()) continue;
+      for (std::size_t iTime = 0; iTime < times.size(); ++iTime) {
+        BOOST_CHECK_EQUAL(times[iTime].first, expTimes[iTime].first);
+        auto const& sdps = times[iTime].second;
+        auto const& expSDPs = expTimes[iTime].second;
+        BOOST_CHECK_EQUAL(sdps.size(), expSDPs.size());
+        if (sdps.size() != expSDPs.size()) continue;
+        for (std::size_t iSDP = 0; iSDP < sdps.size(); ++iSDP) {
+          BOOST_CHECK_EQUAL(sdps[iSDP].trackID, expSDPs[iSDP].trackID);
+          BOOST_CHECK_EQUAL(sdps[iSDP].numPhotons, expSDPs[iSDP].numPhotons);
+          BOOST_CHECK(std::abs(sdps[iSDP].energy - expSDPs[iSDP].energy) < 1e-4);
+          BOOST_CHECK(std::abs(sdps[iSDP].x - expSDPs[iSDP].x) < 1e-4);
+          BOOST_CHECK(std::abs(sdps[iSDP].y - expSDPs[iSDP].y) < 1e-4);
+          BOOST_CHECK(std::abs(sdps[iSDP].z - expSDPs[iSDP].z) < 1e-4);
+        }
+      } // for times
+    }
+  } // for records
+
+} // OpDetBacktrackerRecordAccumulator_test()
+
+
+//------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(OpDetBacktrackerRecordAccumulator_TestCase) {
+  OpDetBacktrackerRecordAccumulator_test();
+} // BOOST_AUTO_TEST_CASE(OpDetBacktrackerRecordAccumulator_TestCase)
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,93 @@
+/**
+ * @file    SimPhotonsLiteBuilder_test.cc
+ * @brief   Unit test for `sim::SimPhotonsLiteBuilder`.
+ * @see     `larsim/Simulation/SimPhotonsLiteBuilder.h`
+ */
+
+// Boost libraries
+#define BOOST_TEST_MODULE ( SimPhotonsLiteBuilder_test )
+#include <cetlib/quiet_unit_test.hpp> // BOOST_AUTO_TEST_CASE()
+#include <boost/test/test_tools.hpp> // BOOST_CHECK()
+
+// LArSoft libraries
+#include "larsim/Simulation/SimPhotonsLiteBuilder.h"
+
+// C/C++ standard libraries
+#include <map>
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+void SimPhotonsLiteBuilder_test() {
+
+  using Counts_t = std::map<int, int>;
+
+  // a narrow window, so that both the growth and the sparse counts are used
+  sim::SimPhotonsLiteBuilder builder { 4U, 64 };
+
+  for (unsigned int event = 0; event < 3; ++event) {
+
+    std::map<int, Counts_t> expected;
+    auto add = [&](int channel, int time, int n)
+      { builder.add(channel, time, n); expected[channel][time] += n; };
+
+    for (int i = 0; i < 500; ++i) {
+      int const channel = (i * 7) % 6 - 1; // includes -1 and channels past 4
+      int const time = 1000 * event + ((i * 37) % 101) - ((i % 3 == 0)? 40: 0);
+      add(channel, time, 1 + i % 3);
+    }
+    add(2, -1000000, 2);  // far from all the others
+    add(2, 1000000, 1);
+    add(2, 1000000, 4);
+
+    BOOST_TEST_CONTEXT("event " << event) {
+      BOOST_CHECK(builder.toMaps() == expected);
+      BOOST_CHECK(builder.counts(2) == expected[2]);
+      BOOST_CHECK(builder.counts(-1) == expected[-1]);
+      BOOST_CHECK(builder.counts(10).empty());
+
+      // the collection as the producers prepare it, with channels 0 to 3
+      std::vector<sim::SimPhotonsLite> photons(4);
+      for (int channel = 0; channel < 4; ++channel) photons[channel].OpChannel = channel;
+      photons[1].DetectedPhotons[1000 * event] = 10; // some previous content
+
+      builder.addTo(photons);
+      BOOST_CHECK(builder.empty());
+      expected[1][1000 * event] += 10;
+
+      std::map<int, Counts_t> stored;
+      for (sim::SimPhotonsLite const& ph: photons)
+        if (!ph.DetectedPhotons.empty()) stored[ph.OpChannel] = ph.DetectedPhotons;
+      BOOST_CHECK(stored == expected);
+    }
+
+  } // for event
+
+} // SimPhotonsLiteBuilder_test()
+
+
+//------------------------------------------------------------------------------
+void addDetectedPhotons_test() {
+
+  std::map<int, int> dest { { 1, 1 }, { 5, 2 }, { 9, 3 } };
+  std::map<int, int> const src { { 0, 1 }, { 5, 1 }, { 7, 1 }, { 20, 2 } };
+  sim::addDetectedPhotons(dest, src);
+
+  std::map<int, int> const expected
+    { { 0, 1 }, { 1, 1 }, { 5, 3 }, { 7, 1 }, { 9, 3 }, { 20, 2 } };
+  BOOST_CHECK(dest == expected);
+
+} // addDetectedPhotons_test()
+
+
+//------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(SimPhotonsLiteBuilder_TestCase) {
+  SimPhotonsLiteBuilder_test();
+} // BOOST_AUTO_TEST_CASE(SimPhotonsLiteBuilder_TestCase)
+
+BOOST_AUTO_TEST_CASE(addDetectedPhotons_TestCase) {
+  addDetectedPhotons_test();
+} // BOOST_AUTO_TEST_CASE(addDetectedPhotons_TestCase)
+
+//------------------------------------------------------------------------------